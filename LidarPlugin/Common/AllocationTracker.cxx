@@ -0,0 +1,143 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "AllocationTracker.h"
+
+// STD
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+// constant initialized, so that they can be used by operator new before the
+// initialization of the library and on threads which did not start in C++
+thread_local AllocationTracker::Counters ThreadCounters;
+std::atomic<uint64_t> ProcessNumberOfAllocations(0);
+std::atomic<uint64_t> ProcessAllocatedBytes(0);
+
+#ifdef LIDARVIEW_ALLOCATION_TRACKING
+//-----------------------------------------------------------------------------
+void* Allocate(std::size_t size) noexcept
+{
+  ++ThreadCounters.NumberOfAllocations;
+  ThreadCounters.AllocatedBytes += size;
+  ProcessNumberOfAllocations.fetch_add(1, std::memory_order_relaxed);
+  ProcessAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  return std::malloc(size ? size : 1);
+}
+
+//-----------------------------------------------------------------------------
+void* AllocateOrThrow(std::size_t size)
+{
+  while (true)
+  {
+    if (void* pointer = Allocate(size))
+    {
+      return pointer;
+    }
+    // as the default operator new, give the new handler a chance to free memory
+    std::new_handler handler = std::get_new_handler();
+    if (!handler)
+    {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+#endif
+}
+
+//-----------------------------------------------------------------------------
+bool AllocationTracker::IsEnabled()
+{
+#ifdef LIDARVIEW_ALLOCATION_TRACKING
+  return true;
+#else
+  return false;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+AllocationTracker::Counters AllocationTracker::GetThreadCounters()
+{
+  return ThreadCounters;
+}
+
+//-----------------------------------------------------------------------------
+AllocationTracker::Counters AllocationTracker::GetProcessCounters()
+{
+  Counters counters;
+  counters.NumberOfAllocations = ProcessNumberOfAllocations.load(std::memory_order_relaxed);
+  counters.AllocatedBytes = ProcessAllocatedBytes.load(std::memory_order_relaxed);
+  return counters;
+}
+
+#ifdef LIDARVIEW_ALLOCATION_TRACKING
+//-----------------------------------------------------------------------------
+void* operator new(std::size_t size)
+{
+  return AllocateOrThrow(size);
+}
+
+void* operator new[](std::size_t size)
+{
+  return AllocateOrThrow(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+  return Allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+  return Allocate(size);
+}
+
+//-----------------------------------------------------------------------------
+void operator delete(void* pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+  std::free(pointer);
+}
+#endif
@@ -0,0 +1,61 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef ALLOCATIONTRACKER_H
+#define ALLOCATIONTRACKER_H
+
+#include <cstdint>
+
+#include "vvConfigure.h"
+
+/**
+ * \class AllocationTracker
+ * \brief Count the heap allocations made by each thread.
+ *
+ * When the plugin is built with ENABLE_allocation_tracking, the global operator new
+ * and operator delete are replaced to count the allocations and the bytes allocated,
+ * by the calling thread and by the whole process. The counters of a thread are only
+ * written by this thread, so that a scope can be charged the allocations it made
+ * without being disturbed by the other threads: PipelineProfiler reads them when a
+ * scope begins and ends.
+ *
+ * The replacement sees the allocations of all the libraries of the process on the
+ * platforms with symbol interposition (Linux, macOS) when the plugin is linked by the
+ * application, only those of the plugin otherwise. Without the option, nothing is
+ * replaced and the counters stay at 0.
+ */
+class LidarPlugin_EXPORT AllocationTracker
+{
+public:
+  //! Number of allocations and bytes allocated since the start of a thread or of the process
+  struct Counters
+  {
+    uint64_t NumberOfAllocations = 0;
+    uint64_t AllocatedBytes = 0;
+  };
+
+  //! True if the plugin was built with ENABLE_allocation_tracking
+  static bool IsEnabled();
+
+  //! Counters of the calling thread
+  static Counters GetThreadCounters();
+
+  //! Counters of all the threads
+  static Counters GetProcessCounters();
+};
+
+#endif // ALLOCATIONTRACKER_H
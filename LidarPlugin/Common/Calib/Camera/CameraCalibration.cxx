@@ -30,10 +30,27 @@
 
 // BOOST
 #include <boost/algorithm/string.hpp>
+#include <boost/thread.hpp>
 
 // CERES
 #include <ceres/ceres.h>
 
+namespace
+{
+//----------------------------------------------------------------------------
+ceres::Solver::Options SolverOptions(unsigned int maxIterations, unsigned int numberOfThreads)
+{
+  ceres::Solver::Options options;
+  options.max_num_iterations = maxIterations;
+  options.linear_solver_type = ceres::DENSE_QR;
+  options.minimizer_progress_to_stdout = false;
+  // the residuals of the matches are evaluated concurrently
+  options.num_threads = (numberOfThreads == 0) ?
+                        std::max(1u, boost::thread::hardware_concurrency()) : numberOfThreads;
+  return options;
+}
+}
+
 //----------------------------------------------------------------------------
 void LoadMatchesFromCSV(std::string filename, std::vector<Eigen::Vector3d>& X, std::vector<Eigen::Vector2d>& x)
 {
@@ -177,7 +194,8 @@ void GetParametersFromMatrix(const Eigen::Matrix3d& K, const Eigen::Matrix3d& R,
 }
 
 //----------------------------------------------------------------------------
-double NonLinearPinholeCalibration(const std::vector<Eigen::Vector3d>& X, const std::vector<Eigen::Vector2d>& x, Eigen::Matrix<double, 11, 1>& W)
+double NonLinearPinholeCalibration(const std::vector<Eigen::Vector3d>& X, const std::vector<Eigen::Vector2d>& x, Eigen::Matrix<double, 11, 1>& W,
+                                   unsigned int numberOfThreads)
 {
   Eigen::Matrix<double, 3, 4> P0, P1;
   GetMatrixFromParameters(W, P0);
@@ -197,10 +215,7 @@ double NonLinearPinholeCalibration(const std::vector<Eigen::Vector3d>& X, const
   }
 
   // Solve the problem
-  ceres::Solver::Options options;
-  options.max_num_iterations = 1000;
-  options.linear_solver_type = ceres::DENSE_QR;
-  options.minimizer_progress_to_stdout = false;
+  ceres::Solver::Options options = SolverOptions(1000, numberOfThreads);
 
   ceres::Solver::Summary summary;
   ceres::Solve(options, &problem, &summary);
@@ -221,7 +236,8 @@ double NonLinearPinholeCalibration(const std::vector<Eigen::Vector3d>& X, const
 
 //----------------------------------------------------------------------------
 double NonLinearFisheyeCalibration(const std::vector<Eigen::Vector3d>& X, const std::vector<Eigen::Vector2d>& x,
-                                   Eigen::Matrix<double, 15, 1>& W, unsigned int it)
+                                   Eigen::Matrix<double, 15, 1>& W, unsigned int it,
+                                   unsigned int numberOfThreads)
 {
   // We want to estimate our 15-DOF parameters using a non
   // linear least square minimization. The non linear part
@@ -237,10 +253,7 @@ double NonLinearFisheyeCalibration(const std::vector<Eigen::Vector3d>& X, const
     problem.AddResidualBlock(cost_function, nullptr, W.data());
   }
 
-  ceres::Solver::Options options;
-  options.max_num_iterations = it;
-  options.linear_solver_type = ceres::DENSE_QR;
-  options.minimizer_progress_to_stdout = false;
+  ceres::Solver::Options options = SolverOptions(it, numberOfThreads);
 
   ceres::Solver::Summary summary;
   ceres::Solve(options, &problem, &summary);
@@ -257,10 +270,35 @@ double NonLinearFisheyeCalibration(const std::vector<Eigen::Vector3d>& X, const
 double BrownConradyPinholeCalibration(const std::vector<Eigen::Vector3d>& X, const std::vector<Eigen::Vector2d>& x,
                                       Eigen::Matrix<double, 17, 1>& W, unsigned int it,
                                       double initLossScale, double finalLossScale,
-                                      const std::vector<bool>& shouldOptimizeParam)
+                                      const std::vector<bool>& shouldOptimizeParam,
+                                      unsigned int numberOfThreads)
 {
   unsigned int N = 100;
 
+  // We want to estimate our 17-DOF parameters using a non
+  // linear least square minimization. The non linear part
+  // comes from the Euler Angle parametrization of the rotation
+  // endomorphism of SO(3), the homographie rescaling and
+  // the lens distortions
+  // To minimize it, we use CERES to perform
+  // the Levenberg-Marquardt algorithm.
+  // The problem is built once, only the scale of its loss function
+  // changes between two minimizations. Since the parameters that are
+  // not optimized keep their initial value, W0 is the same for all
+  // the minimizations
+  ceres::Problem problem;
+  ceres::LossFunctionWrapper* loss = new ceres::LossFunctionWrapper(new ceres::ArctanLoss(initLossScale),
+                                                                    ceres::TAKE_OWNERSHIP);
+  for (unsigned int k = 0; k < X.size(); ++k)
+  {
+    CostFunctions::BrownConradyAlgebraicDistance* resFct = new CostFunctions::BrownConradyAlgebraicDistance(X[k], x[k]);
+    resFct->SetW0(W);
+    resFct->SetActivatedParams(shouldOptimizeParam);
+    ceres::CostFunction* cost_function = new ceres::AutoDiffCostFunction<CostFunctions::BrownConradyAlgebraicDistance, 1, 17>(resFct);
+    problem.AddResidualBlock(cost_function, loss, W.data());
+  }
+  ceres::Solver::Options options = SolverOptions(it, numberOfThreads);
+
   // The minimization algorithm will be ran multiple time
   // with an outlier rejection loss function more restrictive
   // at each iteration. We don't want to have a higly restrictive
@@ -270,28 +308,7 @@ double BrownConradyPinholeCalibration(const std::vector<Eigen::Vector3d>& X, con
   for (unsigned int minId = 0; minId < N; ++minId)
   {
     double lossScale = initLossScale + static_cast<double>(minId) * (finalLossScale - initLossScale) / (1.0 * N);
-
-    // We want to estimate our 17-DOF parameters using a non
-    // linear least square minimization. The non linear part
-    // comes from the Euler Angle parametrization of the rotation
-    // endomorphism of SO(3), the homographie rescaling and
-    // the lens distortions
-    // To minimize it, we use CERES to perform
-    // the Levenberg-Marquardt algorithm.
-    ceres::Problem problem;
-    for (unsigned int k = 0; k < X.size(); ++k)
-    {
-      CostFunctions::BrownConradyAlgebraicDistance* resFct = new CostFunctions::BrownConradyAlgebraicDistance(X[k], x[k]);
-      resFct->SetW0(W);
-      resFct->SetActivatedParams(shouldOptimizeParam);
-      ceres::CostFunction* cost_function = new ceres::AutoDiffCostFunction<CostFunctions::BrownConradyAlgebraicDistance, 1, 17>(resFct);
-      problem.AddResidualBlock(cost_function, new ceres::ArctanLoss(lossScale), W.data());
-    }
-
-    ceres::Solver::Options options;
-    options.max_num_iterations = it;
-    options.linear_solver_type = ceres::DENSE_QR;
-    options.minimizer_progress_to_stdout = false;
+    loss->Reset(new ceres::ArctanLoss(lossScale), ceres::TAKE_OWNERSHIP);
 
     ceres::Solver::Summary summary;
     ceres::Solve(options, &problem, &summary);
@@ -338,14 +355,23 @@ Eigen::Matrix<double, 3, 4> GetMatrixFromParameters(const Eigen::Matrix<double,
 }
 
 //----------------------------------------------------------------------------
-Eigen::VectorXd FullCalibrationPipelineFromMatches(std::string filename, const std::vector<bool>& activatedParams)
+Eigen::VectorXd FullCalibrationPipelineFromMatches(std::string filename, const std::vector<bool>& activatedParams,
+                                                   unsigned int numberOfThreads)
 {
-  Eigen::VectorXd Wf = Eigen::VectorXd::Zero(17, 1);
-
   // Load the 3D - 2D matches
   std::vector<Eigen::Vector3d> X;
   std::vector<Eigen::Vector2d> x;
   LoadMatchesFromCSV(filename, X, x);
+  return FullCalibrationPipelineFromMatches(X, x, activatedParams, numberOfThreads);
+}
+
+//----------------------------------------------------------------------------
+Eigen::VectorXd FullCalibrationPipelineFromMatches(const std::vector<Eigen::Vector3d>& X,
+                                                   const std::vector<Eigen::Vector2d>& x,
+                                                   const std::vector<bool>& activatedParams,
+                                                   unsigned int numberOfThreads)
+{
+  Eigen::VectorXd Wf = Eigen::VectorXd::Zero(17, 1);
   if (X.size() == 0)
   {
     return Wf;
@@ -402,7 +428,7 @@ Eigen::VectorXd FullCalibrationPipelineFromMatches(std::string filename, const s
   // Then, refine the model obtained using linear
   // estimation by using a non-linear pinhole parameters
   // estimation
-  double rmse2 = NonLinearPinholeCalibration(X, x, Wpinhole);
+  double rmse2 = NonLinearPinholeCalibration(X, x, Wpinhole, numberOfThreads);
 
   // Finally, create a first parameter vector estimation
   // by using the pinhole parameters and setting the distortion
@@ -410,7 +436,7 @@ Eigen::VectorXd FullCalibrationPipelineFromMatches(std::string filename, const s
   Eigen::Matrix<double, 17, 1> West = Eigen::Matrix<double, 17, 1>::Zero();
   West.block(0, 0, 11, 1) = Wpinhole;
 
-  double rmse3 = BrownConradyPinholeCalibration(X, x, West, 2500, 5.0, 0.6, activatedParams);
+  double rmse3 = BrownConradyPinholeCalibration(X, x, West, 2500, 5.0, 0.6, activatedParams, numberOfThreads);
 
   // copy params
   for (int i = 0; i < 17; ++i)
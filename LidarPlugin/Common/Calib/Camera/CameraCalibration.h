@@ -71,8 +71,10 @@ double LinearPinholeCalibration(const std::vector<Eigen::Vector3d>& X, const std
    * @param X 3D keypoints associated to the 2D keypoints
    * @param x 2D keypoints associated to the 3D keypoints
    * @param P W pinhole camera model parameters estimated
+   * @param numberOfThreads number of threads used to evaluate the residuals, 0 to use all the cores
    */
-double NonLinearPinholeCalibration(const std::vector<Eigen::Vector3d>& X, const std::vector<Eigen::Vector2d>& x, Eigen::Matrix<double, 11, 1>& W);
+double NonLinearPinholeCalibration(const std::vector<Eigen::Vector3d>& X, const std::vector<Eigen::Vector2d>& x, Eigen::Matrix<double, 11, 1>& W,
+                                   unsigned int numberOfThreads = 0);
 
 /**
    * @brief NonLinearFisheyeCalibration Compute the fisheye camera model parameters
@@ -88,9 +90,11 @@ double NonLinearPinholeCalibration(const std::vector<Eigen::Vector3d>& X, const
    * @param X 3D keypoints associated to the 2D keypoints
    * @param x 2D keypoints associated to the 3D keypoints
    * @param P W fisheye camera model parameters estimated
+   * @param numberOfThreads number of threads used to evaluate the residuals, 0 to use all the cores
    */
 double NonLinearFisheyeCalibration(const std::vector<Eigen::Vector3d>& X, const std::vector<Eigen::Vector2d>& x,
-                                   Eigen::Matrix<double, 15, 1>& W, unsigned int it = 1000);
+                                   Eigen::Matrix<double, 15, 1>& W, unsigned int it = 1000,
+                                   unsigned int numberOfThreads = 0);
 
 /**
    * @brief BrownConradyPinholeCalibration Compute the pinhole camera model parameters
@@ -114,11 +118,13 @@ double NonLinearFisheyeCalibration(const std::vector<Eigen::Vector3d>& X, const
    *        the default value correspond to a saturation around 3 pixels of
    *        reprojection error
    * @param shouldOptimizeParam Indicates which parameters should be optimized
+   * @param numberOfThreads number of threads used to evaluate the residuals, 0 to use all the cores
    */
 double BrownConradyPinholeCalibration(const std::vector<Eigen::Vector3d>& X, const std::vector<Eigen::Vector2d>& x,
                                       Eigen::Matrix<double, 17, 1>& W, unsigned int it = 1000,
                                       double initLossScale = 5.0, double finalLossScale = 0.60,
-                                      const std::vector<bool>& shouldOptimizeParam = std::vector<bool>(0));
+                                      const std::vector<bool>& shouldOptimizeParam = std::vector<bool>(0),
+                                      unsigned int numberOfThreads = 0);
 
 /**
    * @brief CalibrationMatrixDecomposition Decompose the pinhole camera model
@@ -160,8 +166,23 @@ Eigen::Matrix<double, 3, 4> GetMatrixFromParameters(const Eigen::Matrix<double,
    *
    * @param filename file containing the matches
    * @param activatedParams Indicates which params should be optimized
+   * @param numberOfThreads number of threads used to evaluate the residuals, 0 to use all the cores
    */
 Eigen::VectorXd FullCalibrationPipelineFromMatches(std::string filename,
-                                                   const std::vector<bool>& activatedParams = std::vector<bool>(0));
+                                                   const std::vector<bool>& activatedParams = std::vector<bool>(0),
+                                                   unsigned int numberOfThreads = 0);
+
+/**
+   * @brief FullCalibrationPipelineFromMatches Same as above using matches that
+   *        are already loaded, so that the calibration can be run again with
+   *        other activated parameters without parsing the file again
+   *
+   * @param X 3D keypoints associated to the 2D keypoints
+   * @param x 2D keypoints associated to the 3D keypoints
+   */
+Eigen::VectorXd FullCalibrationPipelineFromMatches(const std::vector<Eigen::Vector3d>& X,
+                                                   const std::vector<Eigen::Vector2d>& x,
+                                                   const std::vector<bool>& activatedParams = std::vector<bool>(0),
+                                                   unsigned int numberOfThreads = 0);
 
 #endif // CAMERA_CALIBRATION_H
@@ -25,6 +25,88 @@
 // YAML
 #include <yaml-cpp/yaml.h>
 
+namespace
+{
+//----------------------------------------------------------------------------
+// Apply the distortion of the camera model to a point of the normalized
+// image plane, the same way as ProjectPoints
+template<ProjectionType type>
+inline void Distort(const double* d, double& x, double& y)
+{
+  const double r2 = x * x + y * y;
+  if (type == ProjectionType::BrownConradyPinhole)
+  {
+    const double radial = d[0] * r2 + d[1] * r2 * r2;
+    const double tangentialScale = 1 + d[4] * r2 + d[5] * r2 * r2;
+    const double xd = x + x * radial + (d[2] * (r2 + 2 * x * x) + 2 * d[3] * x * y) * tangentialScale;
+    const double yd = y + y * radial + (2 * d[2] * x * y + d[3] * (r2 + 2 * y * y)) * tangentialScale;
+    x = xd;
+    y = yd;
+  }
+  else if (type == ProjectionType::FishEye)
+  {
+    const double r = std::sqrt(r2);
+    const double theta = std::atan(r);
+    const double theta2 = theta * theta;
+    const double thetad = theta * (1 + theta2 * (d[0] + theta2 * (d[1] + theta2 * (d[2] + theta2 * d[3]))));
+    // the scale tends to 1 at the optical center
+    const double scale = r > 0 ? thetad / r : 1.0;
+    x *= scale;
+    y *= scale;
+  }
+}
+
+//----------------------------------------------------------------------------
+template<ProjectionType type>
+void ProjectBatch(const Eigen::Matrix3d& R, const Eigen::Vector3d& T, const Eigen::Matrix3d& K,
+                  const double* d, int n, const double* x, const double* y, const double* z,
+                  double* u, double* v, double* depths, bool shouldClip)
+{
+  // rotation transposed, to express the points in the camera frame
+  const Eigen::Matrix3d Rt = R.transpose();
+  const double fx = K(0, 0), fy = K(1, 1), cx = K(0, 2), cy = K(1, 2), skew = K(0, 1);
+  for (int i = 0; i < n; ++i)
+  {
+    const double X = x[i] - T(0), Y = y[i] - T(1), Z = z[i] - T(2);
+    const double xc = Rt(0, 0) * X + Rt(0, 1) * Y + Rt(0, 2) * Z;
+    const double yc = Rt(1, 0) * X + Rt(1, 1) * Y + Rt(1, 2) * Z;
+    const double zc = Rt(2, 0) * X + Rt(2, 1) * Y + Rt(2, 2) * Z;
+    if (depths)
+    {
+      depths[i] = zc;
+    }
+
+    double xn = xc / zc;
+    double yn = yc / zc;
+    Distort<type>(d, xn, yn);
+    const bool isClipped = shouldClip && zc < 0;
+    u[i] = isClipped ? -1 : fx * xn + skew * yn + cx;
+    v[i] = isClipped ? -1 : fy * yn + cy;
+  }
+}
+
+//----------------------------------------------------------------------------
+template<ProjectionType type>
+void BuildUndistortionMap(const Eigen::Matrix3d& K, const double* d, int width, int height,
+                          float* mapU, float* mapV)
+{
+  const double fx = K(0, 0), fy = K(1, 1), cx = K(0, 2), cy = K(1, 2), skew = K(0, 1);
+  for (int v = 0; v < height; ++v)
+  {
+    for (int u = 0; u < width; ++u)
+    {
+      // back project the pixel of the pinhole camera, then distort it
+      double y = (v - cy) / fy;
+      double x = (u - cx - skew * y) / fx;
+      Distort<type>(d, x, y);
+      const size_t pixel = u + static_cast<size_t>(width) * v;
+      mapU[pixel] = static_cast<float>(fx * x + skew * y + cx);
+      mapV[pixel] = static_cast<float>(fy * y + cy);
+    }
+  }
+}
+}
+
 //----------------------------------------------------------------------------
 void CameraModel::SetParams(Eigen::VectorXd argW)
 {
@@ -50,36 +132,42 @@ void CameraModel::SetParams(Eigen::VectorXd argW)
   {
     this->Optics(i) = argW(11 + i);
   }
+  this->ClearCache();
 }
 
 //----------------------------------------------------------------------------
 void CameraModel::SetK(Eigen::Matrix3d argK)
 {
   this->K = argK;
+  this->ClearCache();
 }
 
 //----------------------------------------------------------------------------
 void CameraModel::SetR(Eigen::Matrix3d argR)
 {
   this->R = argR;
+  this->ClearCache();
 }
 
 //----------------------------------------------------------------------------
 void CameraModel::SetT(Eigen::Vector3d argT)
 {
   this->T = argT;
+  this->ClearCache();
 }
 
 //----------------------------------------------------------------------------
 void CameraModel::SetOptics(Eigen::VectorXd argOptics)
 {
   this->Optics = argOptics;
+  this->ClearCache();
 }
 
 //----------------------------------------------------------------------------
 void CameraModel::SetCameraModelType(ProjectionType type)
 {
   this->Type = type;
+  this->ClearCache();
 }
 
 //----------------------------------------------------------------------------
@@ -248,3 +336,73 @@ void CameraModel::WriteParamsToFile(std::string outFilename, Eigen::VectorXd Win
   std::ofstream fout(outFilename.c_str());
   fout << calib;
 }
+
+//------------------------------------------------------------------------------
+void CameraModel::Project(int n, const double* x, const double* y, const double* z,
+                          double* u, double* v, double* depths, bool shouldClip) const
+{
+  // distortion coefficients, missing ones being null
+  double d[6] = {0, 0, 0, 0, 0, 0};
+  for (int k = 0; k < std::min(6, static_cast<int>(this->Optics.size())); ++k)
+  {
+    d[k] = this->Optics(k);
+  }
+
+  switch (this->Type)
+  {
+  case ProjectionType::Pinhole:
+    ProjectBatch<ProjectionType::Pinhole>(this->R, this->T, this->K, d, n, x, y, z, u, v, depths, shouldClip);
+    break;
+  case ProjectionType::BrownConradyPinhole:
+    ProjectBatch<ProjectionType::BrownConradyPinhole>(this->R, this->T, this->K, d, n, x, y, z, u, v, depths, shouldClip);
+    break;
+  case ProjectionType::FishEye:
+    ProjectBatch<ProjectionType::FishEye>(this->R, this->T, this->K, d, n, x, y, z, u, v, depths, shouldClip);
+    break;
+  }
+}
+
+//------------------------------------------------------------------------------
+void CameraModel::GetUndistortionMap(int width, int height, const float*& mapU, const float*& mapV)
+{
+  const size_t nbPixels = static_cast<size_t>(std::max(width, 0)) * std::max(height, 0);
+  if (width != this->UndistortionWidth || height != this->UndistortionHeight
+      || this->UndistortionMapU.size() != nbPixels)
+  {
+    this->UndistortionMapU.resize(nbPixels);
+    this->UndistortionMapV.resize(nbPixels);
+    this->UndistortionWidth = width;
+    this->UndistortionHeight = height;
+
+    double d[6] = {0, 0, 0, 0, 0, 0};
+    for (int k = 0; k < std::min(6, static_cast<int>(this->Optics.size())); ++k)
+    {
+      d[k] = this->Optics(k);
+    }
+    float* u = this->UndistortionMapU.data();
+    float* v = this->UndistortionMapV.data();
+    switch (this->Type)
+    {
+    case ProjectionType::Pinhole:
+      BuildUndistortionMap<ProjectionType::Pinhole>(this->K, d, width, height, u, v);
+      break;
+    case ProjectionType::BrownConradyPinhole:
+      BuildUndistortionMap<ProjectionType::BrownConradyPinhole>(this->K, d, width, height, u, v);
+      break;
+    case ProjectionType::FishEye:
+      BuildUndistortionMap<ProjectionType::FishEye>(this->K, d, width, height, u, v);
+      break;
+    }
+  }
+  mapU = this->UndistortionMapU.data();
+  mapV = this->UndistortionMapV.data();
+}
+
+//------------------------------------------------------------------------------
+void CameraModel::ClearCache()
+{
+  this->UndistortionMapU.clear();
+  this->UndistortionMapV.clear();
+  this->UndistortionWidth = 0;
+  this->UndistortionHeight = 0;
+}
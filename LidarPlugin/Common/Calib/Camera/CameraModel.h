@@ -21,7 +21,10 @@
 #define CAMERA_MODEL_H
 
 // STD
+#include <algorithm>
+#include <cmath>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 // EIGEN
@@ -65,7 +68,48 @@ public:
   void LoadParamsFromFile(std::string filename);
   static void WriteParamsToFile(std::string outFilename, Eigen::VectorXd Win, ProjectionType typein);
 
+  /**
+   * @brief Project Project a batch of 3D points given as separate coordinate
+   *        arrays, the same way as ProjectPoints. The camera model type is
+   *        resolved once for the batch, so that the loop over the points has
+   *        no branch but the clipping
+   *
+   * @param n number of points
+   * @param x, y, z coordinates of the 3D points
+   * @param u, v projected points in pixel coordinates, -1 for the clipped points
+   * @param depths optional depth of the points in the camera reference frame
+   * @param shouldClip Clip points that are behind the camera plane
+   */
+  void Project(int n, const double* x, const double* y, const double* z,
+               double* u, double* v, double* depths = nullptr, bool shouldClip = false) const;
+
+  /**
+   * @brief GetUndistortionMap Get for each pixel of the undistorted image, the
+   *        position in the distorted image where it comes from. The undistorted
+   *        image is the one of a pinhole camera with the same intrinsic parameters.
+   *        The maps are only built again when the parameters or the size change
+   *
+   * @param width, height size of the images
+   * @param mapU, mapV columns and rows of the distorted image, indexed by
+   *        u + width * v
+   */
+  void GetUndistortionMap(int width, int height, const float*& mapU, const float*& mapV);
+
+  /**
+   * @brief UndistortImage Remap an image taken by the camera to the image of
+   *        the pinhole camera with the same intrinsic parameters, using a
+   *        bilinear interpolation. The pixels coming from outside of the image
+   *        are set to 0
+   *
+   * @param in, out pixels of the images, the components being interleaved
+   */
+  template<typename TPixel>
+  void UndistortImage(const TPixel* in, int width, int height, int nbComponents, TPixel* out);
+
 protected:
+  //! Forget the undistortion maps, called when the model changes
+  void ClearCache();
+
   //! intrinsic parameters of the camera model
   Eigen::Matrix3d K = Eigen::Matrix3d::Identity();
 
@@ -78,6 +122,51 @@ protected:
 
   //! type of camera model
   ProjectionType Type = ProjectionType::Pinhole;
+
+  //! undistortion maps of the current model, and their image size
+  std::vector<float> UndistortionMapU;
+  std::vector<float> UndistortionMapV;
+  int UndistortionWidth = 0;
+  int UndistortionHeight = 0;
 };
 
+//----------------------------------------------------------------------------
+template<typename TPixel>
+void CameraModel::UndistortImage(const TPixel* in, int width, int height, int nbComponents, TPixel* out)
+{
+  const float* mapU;
+  const float* mapV;
+  this->GetUndistortionMap(width, height, mapU, mapV);
+  const size_t nbPixels = static_cast<size_t>(width) * height;
+  for (size_t pixel = 0; pixel < nbPixels; ++pixel)
+  {
+    TPixel* outPixel = out + pixel * nbComponents;
+    const float u = mapU[pixel];
+    const float v = mapV[pixel];
+    if (!(u >= 0 && v >= 0 && u <= width - 1 && v <= height - 1))
+    {
+      std::fill(outPixel, outPixel + nbComponents, TPixel(0));
+      continue;
+    }
+
+    // bilinear interpolation of the 4 pixels around (u, v)
+    const int u0 = std::min(static_cast<int>(u), width - 2 < 0 ? 0 : width - 2);
+    const int v0 = std::min(static_cast<int>(v), height - 2 < 0 ? 0 : height - 2);
+    const int u1 = std::min(u0 + 1, width - 1);
+    const int v1 = std::min(v0 + 1, height - 1);
+    const float du = u - u0;
+    const float dv = v - v0;
+    const TPixel* p00 = in + (u0 + static_cast<size_t>(width) * v0) * nbComponents;
+    const TPixel* p10 = in + (u1 + static_cast<size_t>(width) * v0) * nbComponents;
+    const TPixel* p01 = in + (u0 + static_cast<size_t>(width) * v1) * nbComponents;
+    const TPixel* p11 = in + (u1 + static_cast<size_t>(width) * v1) * nbComponents;
+    for (int c = 0; c < nbComponents; ++c)
+    {
+      const float value = (1 - dv) * ((1 - du) * p00[c] + du * p10[c])
+                          + dv * ((1 - du) * p01[c] + du * p11[c]);
+      outPixel[c] = static_cast<TPixel>(std::is_integral<TPixel>::value ? std::round(value) : value);
+    }
+  }
+}
+
 #endif // CAMERA_MODEL_H
@@ -251,8 +251,9 @@ public:
     // Copy w so that we will be able to set to zero the
     // infinitesimal part of a parameter which will have
     // the effect to disable the optimization according
-    // to this parameter
-    std::vector<T> wcopy(17);
+    // to this parameter. The copy is on the stack since
+    // the residual is evaluated for each match and iteration
+    T wcopy[17];
     for (int i = 0; i < 17; ++i)
     {
       wcopy[i] = w[i];
@@ -23,6 +23,7 @@
 #include "vtkPCLConversions.h"
 #include "CameraProjection.h"
 #include "vtkEigenTools.h"
+#include "ParallelFor.h"
 
 // OPENCV
 #include <opencv2/highgui.hpp>
@@ -33,13 +34,27 @@
 #include <pcl/features/normal_3d_omp.h>
 
 //----------------------------------------------------------------------------
-double ComputeMutualInformation(cv::Mat syntheticImg, cv::Mat realImg, int dx = 0)
+// Joint histogram of the images used to compute the mutual information. It is
+// kept by the caller so that it is not allocated for each evaluated pose
+struct MutualInformationHistograms
+{
+  static const int NbrBin = 256;
+  std::vector<double> H1 = std::vector<double>(NbrBin, 0);
+  std::vector<double> H2 = std::vector<double>(NbrBin, 0);
+  std::vector<double> H12 = std::vector<double>(NbrBin * NbrBin, 0);
+};
+
+//----------------------------------------------------------------------------
+double ComputeMutualInformation(cv::Mat syntheticImg, cv::Mat realImg,
+                                MutualInformationHistograms& histograms, int dx = 0)
 {
-  const int nbrBin = 256;
-  // Compute the histograms
-  std::vector<double> h1(nbrBin, 0);
-  std::vector<double> h2(nbrBin, 0);
-  std::vector<double> h12(nbrBin * nbrBin, 0);
+  const int nbrBin = MutualInformationHistograms::NbrBin;
+  std::vector<double>& h1 = histograms.H1;
+  std::vector<double>& h2 = histograms.H2;
+  std::vector<double>& h12 = histograms.H12;
+  std::fill(h1.begin(), h1.end(), 0.0);
+  std::fill(h2.begin(), h2.end(), 0.0);
+  std::fill(h12.begin(), h12.end(), 0.0);
 
   int H = realImg.rows;
   int W = realImg.cols;
@@ -48,15 +63,17 @@ double ComputeMutualInformation(cv::Mat syntheticImg, cv::Mat realImg, int dx =
   // loop over pixels
   for (int i = 0; i < H; ++i)
   {
+    int itilde = i + dx;
+    if (itilde < 0 || itilde > H - 1)
+    {
+      continue;
+    }
+    const uchar* syntheticRow = syntheticImg.ptr<uchar>(itilde);
+    const uchar* realRow = realImg.ptr<uchar>(i);
     for (int j = 0; j < W; ++j)
     {
-      int itilde = i + dx;
-      if (itilde < 0 || itilde > H - 1)
-      {
-        continue;
-      }
-      int value1 = syntheticImg.at<uchar>(itilde, j);
-      int value2 = realImg.at<uchar>(i, j);
+      int value1 = syntheticRow[j];
+      int value2 = realRow[j];
 
       // value not available
       if (value1 == 255)
@@ -71,41 +88,34 @@ double ComputeMutualInformation(cv::Mat syntheticImg, cv::Mat realImg, int dx =
     }
   }
 
-  for (int i = 0; i < nbrBin; ++i)
+  if (countValue == 0)
   {
-    h1[i] /= countValue;
-    h2[i] /= countValue;
-    for (int j = 0; j < nbrBin; ++j)
-    {
-      h12[i + nbrBin * j] /= countValue;
-    }
+    return 0;
   }
 
-  double entropy1 = 0;
-  double entropy2 = 0;
-  double entropy12 = 0;
-
-  const double minProbability = 1e-10;
-  for (int i = 0; i < nbrBin; ++i)
+  // The entropies are computed from the counts, which avoids normalizing
+  // the joint histogram: -sum(p log(p)) = log(N) - sum(c log(c)) / N
+  auto entropy = [countValue](const std::vector<double>& h)
   {
-    if (h1[i] > minProbability)
+    double sum = 0;
+    for (double count : h)
     {
-      entropy1 += -h1[i] * std::log(h1[i]);
-    }
-    if (h2[i] > minProbability)
-    {
-      entropy2 += -h2[i] * std::log(h2[i]);
-    }
-    for (int j = 0; j < nbrBin; ++j)
-    {
-      if (h12[i + nbrBin * j] > minProbability)
+      if (count > 0)
       {
-        entropy12 += - h12[i + nbrBin * j] * std::log(h12[i + nbrBin * j]);
+        sum += count * std::log(count);
       }
     }
-  }
+    return std::log(countValue) - sum / countValue;
+  };
 
-  return ((entropy1 + entropy2) / entropy12);
+  return ((entropy(h1) + entropy(h2)) / entropy(h12));
+}
+
+//----------------------------------------------------------------------------
+double ComputeMutualInformation(cv::Mat syntheticImg, cv::Mat realImg, int dx = 0)
+{
+  MutualInformationHistograms histograms;
+  return ComputeMutualInformation(syntheticImg, realImg, histograms, dx);
 }
 
 //----------------------------------------------------------------------------
@@ -122,16 +132,27 @@ void ProjectAllPoints(pcl::PointCloud<pcl::PointXYZINormal>::Ptr cloud,
   // Get the cneter of the camera
   Eigen::Vector3d C(cameraParams[3], cameraParams[4], cameraParams[5]);
 
-  // Project all the points on the image. If two differents points
-  // are projected on the same pixel, we keep the closest one (according to
-  // the center of the camera)
-  for (int i = 0; i < cloud->size(); ++i)
+  // Project the points into the image plan at once
+  const int nbPoints = static_cast<int>(cloud->size());
+  std::vector<double> xs(nbPoints), ys(nbPoints), zs(nbPoints), us(nbPoints), vs(nbPoints);
+  for (int i = 0; i < nbPoints; ++i)
+  {
+    xs[i] = cloud->points[i].x;
+    ys[i] = cloud->points[i].y;
+    zs[i] = cloud->points[i].z;
+  }
+  CameraModel model;
+  model.SetParams(cameraParams);
+  model.SetCameraModelType(ProjectionType::BrownConradyPinhole);
+  model.Project(nbPoints, xs.data(), ys.data(), zs.data(), us.data(), vs.data(), nullptr, true);
+
+  // If two differents points are projected on the same pixel, we keep the
+  // closest one (according to the center of the camera)
+  for (int i = 0; i < nbPoints; ++i)
   {
-    // Project the point into the image plan
     pcl::PointXYZINormal pt = cloud->points[i];
     Eigen::Vector3d X(pt.x, pt.y, pt.z);
-    Eigen::Vector2d y0 = BrownConradyPinholeProjection(cameraParams, X, true);
-    Eigen::Vector2d y(H - 1 - y0(1), y0(0));
+    Eigen::Vector2d y(H - 1 - vs[i], us[i]);
     if (y(1) < 0 || y(1) >= W ||
         y(0) < 0 || y(0) >= H)
     {
@@ -266,6 +287,58 @@ void ComputePointVisibility(std::vector<bool>& isPointVisible,
   }
 }
 
+//----------------------------------------------------------------------------
+void ComputePointVisibilityZBuffer(std::vector<bool>& isPointVisible,
+                                   const std::vector<double>& projectionDepth,
+                                   const std::vector<bool>& hasPointProjected,
+                                   unsigned int H,
+                                   unsigned int W,
+                                   int L,
+                                   double tolerance)
+{
+  // A point is hidden if a point projected in its 2D-neighborhood is
+  // closer to the camera by more than the tolerance (relative to the depth).
+  // The minimal depth over the neighborhood is computed with a separable
+  // minimum filter of the depths, instead of scanning the whole window of
+  // each pixel
+  const double emptyDepth = std::numeric_limits<double>::max();
+  std::vector<double> minDepth(H * W, emptyDepth);
+  std::vector<double> minDepthAlongI(H * W, emptyDepth);
+  for (int j = 0; j < static_cast<int>(W); ++j)
+  {
+    for (int i = 0; i < static_cast<int>(H); ++i)
+    {
+      double depth = emptyDepth;
+      for (int u = std::max(0, i - L); u <= std::min(static_cast<int>(H) - 1, i + L); ++u)
+      {
+        if (hasPointProjected[u + H * j])
+        {
+          depth = std::min(depth, projectionDepth[u + H * j]);
+        }
+      }
+      minDepthAlongI[i + H * j] = depth;
+    }
+  }
+  for (int j = 0; j < static_cast<int>(W); ++j)
+  {
+    for (int v = std::max(0, j - L); v <= std::min(static_cast<int>(W) - 1, j + L); ++v)
+    {
+      for (int i = 0; i < static_cast<int>(H); ++i)
+      {
+        minDepth[i + H * j] = std::min(minDepth[i + H * j], minDepthAlongI[i + H * v]);
+      }
+    }
+  }
+
+  for (unsigned int k = 0; k < H * W; ++k)
+  {
+    if (hasPointProjected[k] && projectionDepth[k] > (1.0 + tolerance) * minDepth[k])
+    {
+      isPointVisible[k] = false;
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 int GetSectorId(int u, int v)
 {
@@ -318,6 +391,15 @@ void ComputeInterpolation(std::vector<cv::Mat> img, int L,
                           Eigen::Vector3d cameraCenter,
                           unsigned int H, unsigned int W)
 {
+  // The anchors of a missing pixel only depend on which pixels have data,
+  // which is usually the same for all the images since they are rendered
+  // from the same projected points. They are cached with the mask of the
+  // image they have been computed from, and reused for the next images
+  // having the same mask: 4 anchor pixels (or -1) per missing pixel, in the
+  // order of the loop
+  std::vector<char> anchorsMask;
+  std::vector<int> anchorsCache;
+
   for (int imgIndx = 0; imgIndx < img.size(); ++imgIndx)
   {
     // First, copy the input image
@@ -327,79 +409,79 @@ void ComputeInterpolation(std::vector<cv::Mat> img, int L,
     int H = img[imgIndx].rows;
     int W = img[imgIndx].cols;
 
+    std::vector<char> mask(H * W);
+    for (int i = 0; i < H; ++i)
+    {
+      for (int j = 0; j < W; ++j)
+      {
+        mask[i + H * j] = rawImg.at<uchar>(i, j) != 255;
+      }
+    }
+    bool useCache = (mask == anchorsMask);
+    if (!useCache)
+    {
+      anchorsMask = mask;
+      anchorsCache.clear();
+    }
+    int missingPixelIndx = 0;
+
     // loop over pixels
     for (int i = L; i < H - L; ++i)
     {
       for (int j = L; j < W - L; ++j)
       {
         // Check if the value is already available
-        double currentValue = rawImg.at<uchar>(i, j);
-        if (currentValue != 255)
+        if (mask[i + H * j])
         {
           continue;
         }
 
-        Eigen::Vector2d Xpx(i, j);
+        if (!useCache)
+        {
+          Eigen::Vector2d Xpx(i, j);
 
-        // anchor used for interpolation
-        std::vector<Eigen::Vector2d> interpolationAnchor(4, Eigen::Vector2d(0, 0));
-        std::vector<bool> anchorAvailable(4, false);
-        std::vector<double> anchorValue(4, 0);
-        std::vector<double> sectorDist(4, std::numeric_limits<double>::max());
+          // anchor used for interpolation
+          int anchors[4] = {-1, -1, -1, -1};
+          double sectorDist[4] = {std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+                                  std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
 
-        // Loop over the neighborhood. The goal is to compute
-        // per sector the anchor point used to perform the
-        // quadratic interpolation
-        for (int u = i - L; u <= i + L; ++u)
-        {
-          for (int v = j - L; v <= j + L; ++v)
+          // Loop over the neighborhood. The goal is to compute
+          // per sector the anchor point used to perform the
+          // quadratic interpolation
+          for (int u = i - L; u <= i + L; ++u)
           {
-            if (u == i && v == j)
+            for (int v = j - L; v <= j + L; ++v)
             {
-              continue;
-            }
-
-            // Get pixel value and check if data is available
-            int value = rawImg.at<uchar>(u, v);
-            if (value == 255)
-            {
-              continue;
-            }
-
-            // compute sector id
-            int sectorId = GetSectorId(u - i, v - j);
+              if (u == i && v == j)
+              {
+                continue;
+              }
 
-            if (sectorId == -1)
-            {
-              continue;
-            }
+              // Check if data is available
+              if (!mask[u + H * v])
+              {
+                continue;
+              }
 
-            Eigen::Vector2d Ypx(u, v);
-            Eigen::Vector3d Y = projectionMatching[u + H * v];
+              // compute sector id
+              int sectorId = GetSectorId(u - i, v - j);
 
-            if (!anchorAvailable[sectorId])
-            {
-              interpolationAnchor[sectorId] = Ypx - Xpx;
-              anchorAvailable[sectorId] = true;
-              anchorValue[sectorId] = value;
-              sectorDist[sectorId] = (Y - cameraCenter).norm();
-            }
-            else
-            {
-              // 2d-euclidean based distance
-              /*double currentD = interpolationAnchor[sectorId].norm();
-              double candidateD = (Ypx - Xpx).norm();*/
+              if (sectorId == -1)
+              {
+                continue;
+              }
 
               // 3d-euclidean based distance to cneter of camera
+              Eigen::Vector3d Y = projectionMatching[u + H * v];
               double candidateD = (Y - cameraCenter).norm();
-              if (candidateD < sectorDist[sectorId])
+              if (anchors[sectorId] < 0 || candidateD < sectorDist[sectorId])
               {
-                interpolationAnchor[sectorId] = Ypx - Xpx;
-                anchorValue[sectorId] = value;
+                anchors[sectorId] = u + H * v;
                 sectorDist[sectorId] = candidateD;
               }
             }
           }
+          anchorsCache.insert(anchorsCache.end(), anchors, anchors + 4);
         }
 
         // Fill anchor and values that will be used for the
@@ -408,13 +490,16 @@ void ComputeInterpolation(std::vector<cv::Mat> img, int L,
         std::vector<double> values;
         for (int sectorId = 0; sectorId < 4; ++sectorId)
         {
-          if (anchorAvailable[sectorId])
+          int anchor = anchorsCache[4 * missingPixelIndx + sectorId];
+          if (anchor >= 0)
           {
-            points.push_back(interpolationAnchor[sectorId]);
-            values.push_back(anchorValue[sectorId]);
+            int u = anchor % H;
+            int v = anchor / H;
+            points.push_back(Eigen::Vector2d(u - i, v - j));
+            values.push_back(rawImg.at<uchar>(u, v));
           }
         }
-
+        missingPixelIndx++;
 
         double interpolatedValue = 255;
         // Linear interpolation using a plan
@@ -655,12 +740,15 @@ void MIDHOGCalibration::ComputeCloudNormals()
 }
 
 //----------------------------------------------------------------------------
-void MIDHOGCalibration::CreateSyntheticImage()
+void MIDHOGCalibration::RenderSyntheticImages(const Eigen::Matrix<double, 17, 1>& cameraParams,
+                                              bool useZBufferVisibility,
+                                              std::vector<cv::Mat>& images) const
 {
   // create a white image
-  this->SyntheticImage.push_back(255.0 * cv::Mat::ones(this->Image.size(), CV_8UC1));
-  this->SyntheticImage.push_back(255.0 * cv::Mat::ones(this->Image.size(), CV_8UC1));
-  this->SyntheticImage.push_back(255.0 * cv::Mat::ones(this->Image.size(), CV_8UC1));
+  images.clear();
+  images.push_back(255.0 * cv::Mat::ones(this->Image.size(), CV_8UC1));
+  images.push_back(255.0 * cv::Mat::ones(this->Image.size(), CV_8UC1));
+  images.push_back(255.0 * cv::Mat::ones(this->Image.size(), CV_8UC1));
   unsigned int H = this->Image.rows;
   unsigned int W = this->Image.cols;
 
@@ -673,15 +761,24 @@ void MIDHOGCalibration::CreateSyntheticImage()
   std::vector<double> projectionDepth(this->Image.cols * this->Image.rows, 0);
   std::vector<double> projectionNormalAngle(this->Image.cols * this->Image.rows, 0);
   std::vector<bool> hasPointProjected(this->Image.cols * this->Image.rows, false);
-  ProjectAllPoints(this->Cloud, this->CameraParams, projectionMatching,
+  ProjectAllPoints(this->Cloud, cameraParams, projectionMatching,
                    projectionIntensity, projectionDepth, projectionNormalAngle,
                    hasPointProjected, H, W);
 
-  // Now, handle occultation using heuristic method.
-  // For each point, we will estimate the visibility
+  // Now, handle occultation, either using heuristic method or
+  // the depth of the neighborhood. For each point, we will estimate
+  // the visibility
   std::vector<bool> isPointVisible(this->Image.cols * this->Image.rows, true);
-  ComputePointVisibility(isPointVisible, projectionMatching,
-                         hasPointProjected, H, W, this->NeighborRadius);
+  if (useZBufferVisibility)
+  {
+    ComputePointVisibilityZBuffer(isPointVisible, projectionDepth, hasPointProjected,
+                                  H, W, this->NeighborRadius, this->VisibilityDepthTolerance);
+  }
+  else
+  {
+    ComputePointVisibility(isPointVisible, projectionMatching,
+                           hasPointProjected, H, W, this->NeighborRadius);
+  }
 
   // get the max intensity
   double maxD = 0;
@@ -692,28 +789,68 @@ void MIDHOGCalibration::CreateSyntheticImage()
 
   // Once the visibility has been computed, we can create the image of
   // visible projected 3D points
-  Eigen::Vector3d C(this->CameraParams[3], this->CameraParams[4], this->CameraParams[5]);
+  Eigen::Vector3d C(cameraParams[3], cameraParams[4], cameraParams[5]);
   for (int i = 0; i < H; ++i)
   {
     for (int j = 0; j < W; ++j)
     {
       if (hasPointProjected[i + H * j] && isPointVisible[i + H * j])
       {
-        this->SyntheticImage[0].at<uchar>(i, j) = projectionIntensity[i + H * j];
-        this->SyntheticImage[1].at<uchar>(i, j) = static_cast<uchar>(254.0 -  254.0 * projectionDepth[i + H * j] / maxD);
+        images[0].at<uchar>(i, j) = projectionIntensity[i + H * j];
+        images[1].at<uchar>(i, j) = static_cast<uchar>(254.0 -  254.0 * projectionDepth[i + H * j] / maxD);
         if (!std::isnan(projectionNormalAngle[i + H * j]))
         {
-          this->SyntheticImage[2].at<uchar>(i, j) = static_cast<uchar>(254.0 * projectionNormalAngle[i + H * j]);
+          images[2].at<uchar>(i, j) = static_cast<uchar>(254.0 * projectionNormalAngle[i + H * j]);
         }
       }
     }
   }
 
   // Finally, we will interpole missing data
-  ComputeInterpolation(this->SyntheticImage, this->NeighborRadiusInterpolation, projectionMatching, C, H, W);
+  ComputeInterpolation(images, this->NeighborRadiusInterpolation, projectionMatching, C, H, W);
 
   // Compute median filter to remove salt noise
-  ComputeMedianFilter(this->SyntheticImage, this->NeighborRadiusMedianFilter);
+  ComputeMedianFilter(images, this->NeighborRadiusMedianFilter);
+}
+
+//----------------------------------------------------------------------------
+std::vector<double> MIDHOGCalibration::EvaluateCandidates(
+  const std::vector<Eigen::Matrix<double, 17, 1>>& candidates) const
+{
+  std::vector<double> scores(candidates.size(), 0);
+
+  // Each thread renders the synthetic images of the candidates it takes
+  // and scores them with its own histograms
+  const unsigned int nbThreads = Parallel::GetNumberOfThreads(this->NumberOfThreads);
+  std::vector<MutualInformationHistograms> histograms(nbThreads);
+  std::vector<std::vector<cv::Mat>> images(nbThreads);
+  Parallel::ForEachChunk(candidates.size(), 1, nbThreads, [&](unsigned int thread, size_t k, size_t)
+  {
+    this->RenderSyntheticImages(candidates[k], true, images[thread]);
+    scores[k] = ComputeMutualInformation(images[thread][0], this->Image, histograms[thread]);
+  });
+  return scores;
+}
+
+//----------------------------------------------------------------------------
+int MIDHOGCalibration::SelectBestCandidate(const std::vector<Eigen::Matrix<double, 17, 1>>& candidates)
+{
+  if (candidates.empty())
+  {
+    return -1;
+  }
+  std::vector<double> scores = this->EvaluateCandidates(candidates);
+  int best = std::distance(scores.begin(), std::max_element(scores.begin(), scores.end()));
+  this->CameraParams = candidates[best];
+  return best;
+}
+
+//----------------------------------------------------------------------------
+void MIDHOGCalibration::CreateSyntheticImage()
+{
+  unsigned int H = this->Image.rows;
+  unsigned int W = this->Image.cols;
+  this->RenderSyntheticImages(this->CameraParams, false, this->SyntheticImage);
 
   std::vector<std::vector<Eigen::Vector2d>> syntheticImgGradients(3);
   std::vector<Eigen::Vector2d> realImgGradient;
@@ -68,6 +68,19 @@ public:
   // current estimation of the camera geometric and optic parameters
   void CreateSyntheticImage();
 
+  // Score candidate camera parameters with the mutual information between
+  // the real image and the intensity synthetic image rendered for each
+  // candidate. The candidates are evaluated concurrently, the visibility of
+  // the points being estimated from the depths of their neighbors
+  std::vector<double> EvaluateCandidates(const std::vector<Eigen::Matrix<double, 17, 1>>& candidates) const;
+
+  // Set the camera parameters to the candidate having the best score
+  // and return its index, -1 if there is no candidate
+  int SelectBestCandidate(const std::vector<Eigen::Matrix<double, 17, 1>>& candidates);
+
+  // Number of threads used to evaluate the candidates, 0 to use all the cores
+  void SetNumberOfThreads(unsigned int nbThreads) { this->NumberOfThreads = nbThreads; }
+
 protected:
 
   // Real image acquired from the camera we aim to calibrate.
@@ -95,6 +108,12 @@ protected:
   // Radius of the neigborhood (in pixel) used to compute the median filter
   int NeighborRadiusMedianFilter = 1;
 
+  // Relative depth difference above which a projected point is hidden by
+  // a closer point of its 2D-neighborhood, when evaluating the candidates
+  double VisibilityDepthTolerance = 0.2;
+
+  unsigned int NumberOfThreads = 0;
+
   // Point-cloud corresponding to the geometry observed by the image. The estimated
   // pose of the camera will be expressed according to the reference frame in which
   // the points are expressed. If one aims to have the relative pose of the camera
@@ -112,6 +131,12 @@ protected:
   // Estimate the normals of the points using an PCA
   // approach.
   void ComputeCloudNormals();
+
+  // Render the intensity, depth and normal angle synthetic images
+  // using the given camera parameters
+  void RenderSyntheticImages(const Eigen::Matrix<double, 17, 1>& cameraParams,
+                             bool useZBufferVisibility,
+                             std::vector<cv::Mat>& images) const;
 };
 
 #endif // MIDHOG_CALIBRATION_H
@@ -781,7 +781,7 @@ void ComputeCarCalibrationRotationScale(
 
   if (verbose)
   {
-    std::cout << "median of scales is: " << ComputeMedian(scales) << std::endl;
+    std::cout << "median of scales is: " << scale << std::endl;
   }
 
 
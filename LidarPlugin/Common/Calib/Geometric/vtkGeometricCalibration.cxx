@@ -24,10 +24,14 @@
 #include "vtkConversions.h"
 #include "vtkTemporalTransformsReader.h"
 #include "CeresCostFunctions.h"
+#include "ParallelFor.h"
 
 // STD
 #include <stdlib.h>
+#include <algorithm>
 #include <ctime>
+#include <numeric>
+#include <random>
 
 // VTK
 #include <vtkDoubleArray.h>
@@ -38,35 +42,203 @@
 // CERES
 #include <ceres/ceres.h>
 
+namespace
+{
+//! Poses of the two sensors at the two acquisition times of a "solid-system" constraint
+struct PosesConstraint
+{
+  Eigen::Matrix3d P1, P2, Q1, Q2;
+  Eigen::Vector3d V1, V2, U1, U2;
+  //! Rotation (in radian) of the source sensor between the two times
+  double Excitation;
+};
+
+//! Maximal rotation error of an inlier constraint, its translation error
+//! being compared to the outlier threshold
+const double MaximumInlierRotationError = 2.0 * vtkMath::Pi() / 180.0;
+//! Number of constraints of a RANSAC sample. Two constraints with non
+//! parallel rotation axes are enough to determine the calibration
+const size_t RansacSampleSize = 3;
+const int RansacNumberOfIterations = 512;
+//! Maximal number of constraints on which the samples are scored, the
+//! inliers of the best sample being then searched among all the constraints
+const size_t RansacNumberOfScoringConstraints = 2000;
+
 //----------------------------------------------------------------------------
-std::pair<double, AnglePositionVector> EstimateCalibrationFromPoses(const std::string& sourceSensorFilename,
-                                                                    const std::string& targetSensorFilename,
-                                                                    const double timeScaleAnalysisBound,
-                                                                    const double timeScaleAnalysisStep,
-                                                                    const double timeStep)
+Eigen::Vector3d RotationVector(const Eigen::Matrix3d& R)
 {
-  vtkSmartPointer<vtkTemporalTransforms> trans1, trans2;
-  trans1 = vtkTemporalTransformsReader::OpenTemporalTransforms(sourceSensorFilename);
-  trans2 = vtkTemporalTransformsReader::OpenTemporalTransforms(targetSensorFilename);
-  return EstimateCalibrationFromPoses(trans1, trans2);
+  Eigen::AngleAxisd angleAxis(R);
+  return angleAxis.angle() * angleAxis.axis();
 }
 
 //----------------------------------------------------------------------------
-std::pair<double, AnglePositionVector> EstimateCalibrationFromPoses(
-                                              vtkSmartPointer<vtkTemporalTransforms> sourceSensor,
-                                              vtkSmartPointer<vtkTemporalTransforms> targetSensor,
-                                              const double timeScaleAnalysisBound,
-                                              const double timeScaleAnalysisStep,
-                                              const double timeStep)
+bool SolveCalibrationInClosedForm(const std::vector<PosesConstraint>& constraints,
+                                  const std::vector<size_t>& indices,
+                                  Eigen::Matrix3d& R,
+                                  Eigen::Vector3d& T)
 {
-  Eigen::Matrix3d P1, P2, Q1, Q2;
-  Eigen::Vector3d U1, U2, V1, V2;
+  // dR1 = dR0 means that the rotation vector of the target relative motion
+  // is the one of the source relative motion rotated by R. R is the rotation
+  // that best aligns the two sets of rotation vectors (Kabsch algorithm)
+  Eigen::Matrix3d H = Eigen::Matrix3d::Zero();
+  for (size_t index : indices)
+  {
+    const PosesConstraint& c = constraints[index];
+    H += RotationVector(c.P1.transpose() * c.P2) * RotationVector(c.Q1.transpose() * c.Q2).transpose();
+  }
+  Eigen::JacobiSVD<Eigen::Matrix3d> svdH(H, Eigen::ComputeFullU | Eigen::ComputeFullV);
+  if (svdH.singularValues()(1) <= 1e-6 * svdH.singularValues()(0))
+  {
+    // all the rotation axes are parallel, the rotation is not observable
+    return false;
+  }
+  Eigen::Matrix3d D = Eigen::Matrix3d::Identity();
+  D(2, 2) = (svdH.matrixV() * svdH.matrixU().transpose()).determinant() < 0 ? -1.0 : 1.0;
+  R = svdH.matrixV() * D * svdH.matrixU().transpose();
+
+  // Knowing R, dT1 = dT0 is linear in T:
+  // (Q0' * Q1 - I) * T = R * P0' * (V1 - V0) - Q0' * (U1 - U0)
+  Eigen::Matrix3d M = Eigen::Matrix3d::Zero();
+  Eigen::Vector3d r = Eigen::Vector3d::Zero();
+  for (size_t index : indices)
+  {
+    const PosesConstraint& c = constraints[index];
+    Eigen::Matrix3d A = c.Q1.transpose() * c.Q2 - Eigen::Matrix3d::Identity();
+    Eigen::Vector3d b = R * c.P1.transpose() * (c.V2 - c.V1) - c.Q1.transpose() * (c.U2 - c.U1);
+    M += A.transpose() * A;
+    r += A.transpose() * b;
+  }
+  Eigen::JacobiSVD<Eigen::Matrix3d> svdM(M, Eigen::ComputeFullU | Eigen::ComputeFullV);
+  if (svdM.singularValues()(2) <= 1e-9 * svdM.singularValues()(0))
+  {
+    return false;
+  }
+  T = svdM.solve(r);
+  return true;
+}
 
-  // Parameters to estimate
-  // - Rotation euler angles from 0 to 2
-  // - Translation coordinates from 3 to 5
-  AnglePositionVector calibEstimation = AnglePositionVector::Zero();
+//----------------------------------------------------------------------------
+bool IsInlier(const PosesConstraint& c, const Eigen::Matrix3d& R, const Eigen::Vector3d& T, double threshold)
+{
+  // Same translation error as the residual function
+  Eigen::Vector3d dT0 = c.P1.transpose() * (c.V2 - c.V1);
+  Eigen::Vector3d dT1 = R.transpose() * (c.Q1.transpose() * (c.Q2 * T + (c.U2 - c.U1)) - T);
+  if ((dT1 - dT0).norm() > threshold)
+  {
+    return false;
+  }
+  Eigen::Matrix3d dR0 = c.P1.transpose() * c.P2;
+  Eigen::Matrix3d dR1 = R.transpose() * c.Q1.transpose() * c.Q2 * R;
+  return Eigen::AngleAxisd(dR1 * dR0.transpose()).angle() <= MaximumInlierRotationError;
+}
 
+//----------------------------------------------------------------------------
+std::vector<size_t> RejectOutliers(const std::vector<PosesConstraint>& constraints,
+                                   double threshold,
+                                   unsigned int numberOfThreads)
+{
+  std::vector<size_t> all(constraints.size());
+  std::iota(all.begin(), all.end(), 0);
+  if (constraints.size() <= RansacSampleSize)
+  {
+    return all;
+  }
+
+  // The samples are scored on constraints evenly spread along the trajectories
+  std::vector<size_t> scoring;
+  const size_t stride = (constraints.size() + RansacNumberOfScoringConstraints - 1)
+                        / RansacNumberOfScoringConstraints;
+  for (size_t k = 0; k < constraints.size(); k += stride)
+  {
+    scoring.push_back(k);
+  }
+
+  // Each thread draws its own samples and keeps its best hypothesis
+  struct Hypothesis
+  {
+    size_t NumberOfInliers = 0;
+    Eigen::Matrix3d R;
+    Eigen::Vector3d T;
+  };
+  const unsigned int nbThreads = std::min<unsigned int>(RansacNumberOfIterations,
+                                                         Parallel::GetNumberOfThreads(numberOfThreads));
+  std::vector<Hypothesis> best(nbThreads);
+  Parallel::ForEachPart(RansacNumberOfIterations, nbThreads,
+                        [&](unsigned int thread, size_t begin, size_t end)
+  {
+    std::mt19937 generator(thread + 1);
+    std::uniform_int_distribution<size_t> draw(0, constraints.size() - 1);
+    std::vector<size_t> sample(RansacSampleSize);
+    for (size_t iteration = begin; iteration < end; ++iteration)
+    {
+      for (size_t& index : sample)
+      {
+        index = draw(generator);
+      }
+      Hypothesis hypothesis;
+      if (!SolveCalibrationInClosedForm(constraints, sample, hypothesis.R, hypothesis.T))
+      {
+        continue;
+      }
+      for (size_t index : scoring)
+      {
+        hypothesis.NumberOfInliers += IsInlier(constraints[index], hypothesis.R, hypothesis.T, threshold);
+      }
+      if (hypothesis.NumberOfInliers > best[thread].NumberOfInliers)
+      {
+        best[thread] = hypothesis;
+      }
+    }
+  });
+
+  auto bestHypothesis = std::max_element(best.begin(), best.end(),
+                                         [](const Hypothesis& a, const Hypothesis& b)
+                                         { return a.NumberOfInliers < b.NumberOfInliers; });
+  if (bestHypothesis->NumberOfInliers == 0)
+  {
+    // no sample determines the calibration, nothing can be rejected
+    return all;
+  }
+  std::vector<size_t> inliers;
+  for (size_t index = 0; index < constraints.size(); ++index)
+  {
+    if (IsInlier(constraints[index], bestHypothesis->R, bestHypothesis->T, threshold))
+    {
+      inliers.push_back(index);
+    }
+  }
+  std::cout << "RANSAC: " << inliers.size() << " inliers over " << constraints.size()
+            << " constraints" << std::endl;
+  return inliers;
+}
+}
+
+//----------------------------------------------------------------------------
+IncrementalGeometricCalibration::IncrementalGeometricCalibration(const double timeScaleAnalysisBound,
+                                                                 const double timeScaleAnalysisStep,
+                                                                 const double timeStep,
+                                                                 unsigned int numberOfThreads,
+                                                                 const double minRotationExcitation,
+                                                                 const double outlierThreshold,
+                                                                 unsigned int maximumNumberOfConstraints)
+  : TimeScaleAnalysisBound(timeScaleAnalysisBound)
+  , TimeScaleAnalysisStep(timeScaleAnalysisStep)
+  , TimeStep(timeStep)
+  , NumberOfThreads(numberOfThreads)
+  , MinRotationExcitation(minRotationExcitation)
+  , OutlierThreshold(outlierThreshold)
+  , MaximumNumberOfConstraints(maximumNumberOfConstraints)
+  , Problem(new ceres::Problem)
+{
+}
+
+//----------------------------------------------------------------------------
+IncrementalGeometricCalibration::~IncrementalGeometricCalibration() = default;
+
+//----------------------------------------------------------------------------
+int IncrementalGeometricCalibration::AddConstraints(vtkSmartPointer<vtkTemporalTransforms> sourceSensor,
+                                                    vtkSmartPointer<vtkTemporalTransforms> targetSensor)
+{
   // Create the transforms interpolators
   vtkSmartPointer<vtkCustomTransformInterpolator> sourceSensorTransforms = sourceSensor->CreateInterpolator();
   vtkSmartPointer<vtkCustomTransformInterpolator> targetSensorTransforms = targetSensor->CreateInterpolator();
@@ -74,67 +246,178 @@ std::pair<double, AnglePositionVector> EstimateCalibrationFromPoses(
   targetSensorTransforms->SetInterpolationTypeToLinear();
   double tmin = std::max(sourceSensorTransforms->GetMinimumT(), targetSensorTransforms->GetMinimumT());
   double tmax = std::min(sourceSensorTransforms->GetMaximumT(), targetSensorTransforms->GetMaximumT());
-  vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
 
-  // We want to estimate our 6-DOF parameters using a non
-  // linear least square minimization. The non linear part
-  // comes from the Euler Angle parametrization of the rotation
-  // endomorphism SO(3). To minimize it we use CERES to perform
-  // the Levenberg-Marquardt algorithm.
-  ceres::Problem problem;
+  // The acquisition times follow the ones of the previous calls, so that the
+  // constraints already in the problem are not added twice
+  double firstTime = tmin + this->TimeScaleAnalysisBound;
+  if (this->HasConstraintTimes)
+  {
+    firstTime = std::max(firstTime, this->NextTime);
+  }
 
-  // Loop over the time index
-  for (double time = tmin + timeScaleAnalysisBound; time < tmax - timeScaleAnalysisBound; time += timeStep)
+  // List the two time positions of each "solid-system" geometric constraint
+  // so that the poses of each sensor are interpolated at once
+  std::vector<double> times;
+  double time = firstTime;
+  for (; time < tmax - this->TimeScaleAnalysisBound; time += this->TimeStep)
   {
     // Loop over the deltaTime multi-resolution "solid-system" assumption constraint
-    for (double dt = 0; dt <= timeScaleAnalysisBound;  dt += timeScaleAnalysisStep)
+    for (double dt = 0; dt <= this->TimeScaleAnalysisBound;  dt += this->TimeScaleAnalysisStep)
     {
-      // The two time positions that will be used to express
-      // the solid-system geometric constraints that link
-      // the two sensor poses trajectories
-      double t0 = time - dt;
-      double t1 = time + dt;
-
-      //======================== Time: t0 ==================================
-      // Sensor 1
-      sourceSensorTransforms->InterpolateTransform(t0, transform);
-      std::pair<Eigen::Vector3d, Eigen::Vector3d> sensor1T0Pose = GetPoseParamsFromTransform(transform);
-      P1 = RollPitchYawToMatrix(sensor1T0Pose.first); V1 = sensor1T0Pose.second;
-      // Sensor 2
-      targetSensorTransforms->InterpolateTransform(t0, transform);
-      std::pair<Eigen::Vector3d, Eigen::Vector3d> sensor2T0Pose = GetPoseParamsFromTransform(transform);
-      Q1 = RollPitchYawToMatrix(sensor2T0Pose.first); U1 = sensor2T0Pose.second;
-
-      //======================== Time: t1 ==================================
-      // Sensor 1
-      sourceSensorTransforms->InterpolateTransform(t1, transform);
-      std::pair<Eigen::Vector3d, Eigen::Vector3d> sensor1T1Pose = GetPoseParamsFromTransform(transform);
-      P2 = RollPitchYawToMatrix(sensor1T1Pose.first); V2 = sensor1T1Pose.second;
-      // Sensor 2
-      targetSensorTransforms->InterpolateTransform(t1, transform);
-      std::pair<Eigen::Vector3d, Eigen::Vector3d> sensor2T1Pose = GetPoseParamsFromTransform(transform);
-      Q2 = RollPitchYawToMatrix(sensor2T1Pose.first); U2 = sensor2T1Pose.second;
-
-      // add this geometric constraint non-linear least square residu to the global
-      // cost function that is the sum of all residuals functions
-      ceres::CostFunction* cost_function = new ceres::AutoDiffCostFunction<CostFunctions::FrobeniusDistanceRotationAndTranslationCalibrationResidual, 1, 6>
-                (new CostFunctions::FrobeniusDistanceRotationAndTranslationCalibrationResidual(P1, P2, Q1, Q2, V1, V2, U1, U2));
-      problem.AddResidualBlock(cost_function, nullptr, calibEstimation.data());
-    } // Loop over the deltaTime multi-resolution "solid-system" assumption constraint
-  } // Loop over the time
+      times.push_back(time - dt);
+      times.push_back(time + dt);
+    }
+  }
+  this->NextTime = time;
+  this->HasConstraintTimes = true;
+
+  const int nbTimes = static_cast<int>(times.size());
+  std::vector<double> sourceMatrices(16 * nbTimes), targetMatrices(16 * nbTimes);
+  sourceSensorTransforms->InterpolateTransforms(nbTimes, times.data(), sourceMatrices.data());
+  targetSensorTransforms->InterpolateTransforms(nbTimes, times.data(), targetMatrices.data());
+  auto rotation = [](const double* m)
+  {
+    Eigen::Matrix3d R;
+    R << m[0], m[1], m[2], m[4], m[5], m[6], m[8], m[9], m[10];
+    return R;
+  };
+  auto position = [](const double* m)
+  {
+    return Eigen::Vector3d(m[3], m[7], m[11]);
+  };
 
-  // Solve the optimization problem
+  std::vector<PosesConstraint> constraints;
+  constraints.reserve(nbTimes / 2);
+  for (int k = 0; k < nbTimes; k += 2)
+  {
+    PosesConstraint c;
+    //======================== Time: t0 ==================================
+    c.P1 = rotation(&sourceMatrices[16 * k]);
+    c.V1 = position(&sourceMatrices[16 * k]);
+    c.Q1 = rotation(&targetMatrices[16 * k]);
+    c.U1 = position(&targetMatrices[16 * k]);
+
+    //======================== Time: t1 ==================================
+    c.P2 = rotation(&sourceMatrices[16 * (k + 1)]);
+    c.V2 = position(&sourceMatrices[16 * (k + 1)]);
+    c.Q2 = rotation(&targetMatrices[16 * (k + 1)]);
+    c.U2 = position(&targetMatrices[16 * (k + 1)]);
+
+    // The rotation part of the calibration is only observable when the
+    // sensors rotate between t0 and t1. The pairs of poses without enough
+    // rotation excitation bring little information and are skipped
+    c.Excitation = Eigen::AngleAxisd(c.P1.transpose() * c.P2).angle();
+    if (this->MinRotationExcitation > 0 && c.Excitation < this->MinRotationExcitation)
+    {
+      continue;
+    }
+    constraints.push_back(c);
+  }
+
+  // Keep the most excited pairs of poses
+  if (this->MaximumNumberOfConstraints > 0 && constraints.size() > this->MaximumNumberOfConstraints)
+  {
+    std::nth_element(constraints.begin(), constraints.begin() + this->MaximumNumberOfConstraints,
+                     constraints.end(), [](const PosesConstraint& a, const PosesConstraint& b)
+                     { return a.Excitation > b.Excitation; });
+    constraints.resize(this->MaximumNumberOfConstraints);
+  }
+
+  std::vector<size_t> inliers(constraints.size());
+  std::iota(inliers.begin(), inliers.end(), 0);
+  if (this->OutlierThreshold > 0)
+  {
+    inliers = RejectOutliers(constraints, this->OutlierThreshold, this->NumberOfThreads);
+  }
+
+  // The first minimization starts from the closed-form estimation rather than
+  // from the null calibration, so that it converges for large rotations too
+  Eigen::Matrix3d R;
+  Eigen::Vector3d T;
+  if (!this->HasEstimation && SolveCalibrationInClosedForm(constraints, inliers, R, T))
+  {
+    this->Estimation << MatrixToRollPitchYaw(R), T;
+    this->HasEstimation = true;
+  }
+
+  for (size_t index : inliers)
+  {
+    const PosesConstraint& c = constraints[index];
+    // add this geometric constraint non-linear least square residu to the global
+    // cost function that is the sum of all residuals functions
+    ceres::CostFunction* cost_function = new ceres::AutoDiffCostFunction<CostFunctions::FrobeniusDistanceRotationAndTranslationCalibrationResidual, 1, 6>
+              (new CostFunctions::FrobeniusDistanceRotationAndTranslationCalibrationResidual(c.P1, c.P2, c.Q1, c.Q2, c.V1, c.V2, c.U1, c.U2));
+    this->Problem->AddResidualBlock(cost_function, nullptr, this->Estimation.data());
+  }
+  return static_cast<int>(inliers.size());
+}
+
+//----------------------------------------------------------------------------
+std::pair<double, AnglePositionVector> IncrementalGeometricCalibration::Update(
+                                              vtkSmartPointer<vtkTemporalTransforms> sourceSensor,
+                                              vtkSmartPointer<vtkTemporalTransforms> targetSensor)
+{
+  this->AddConstraints(sourceSensor, targetSensor);
+  if (this->Problem->NumResidualBlocks() == 0)
+  {
+    return std::pair<double, AnglePositionVector>(0.0, this->Estimation);
+  }
+
+  // Solve the optimization problem, starting from the previous estimation
   // Option of the solver
   ceres::Solver::Options options;
   options.max_num_iterations = 75;
   options.linear_solver_type = ceres::DENSE_QR;
   options.minimizer_progress_to_stdout = false;
+  options.num_threads = Parallel::GetNumberOfThreads(this->NumberOfThreads);
   // Solve
   ceres::Solver::Summary summary;
-  ceres::Solve(options, &problem, &summary);
+  ceres::Solve(options, this->Problem.get(), &summary);
   std::cout << summary.BriefReport() << ", Number Blocks: " << summary.num_residuals << std::endl;
 
-  return std::pair<double, AnglePositionVector>(summary.final_cost, calibEstimation);
+  return std::pair<double, AnglePositionVector>(summary.final_cost, this->Estimation);
+}
+
+//----------------------------------------------------------------------------
+std::pair<double, AnglePositionVector> EstimateCalibrationFromPoses(const std::string& sourceSensorFilename,
+                                                                    const std::string& targetSensorFilename,
+                                                                    const double timeScaleAnalysisBound,
+                                                                    const double timeScaleAnalysisStep,
+                                                                    const double timeStep,
+                                                                    unsigned int numberOfThreads,
+                                                                    const double minRotationExcitation,
+                                                                    const double outlierThreshold,
+                                                                    unsigned int maximumNumberOfConstraints)
+{
+  vtkSmartPointer<vtkTemporalTransforms> trans1, trans2;
+  trans1 = vtkTemporalTransformsReader::OpenTemporalTransforms(sourceSensorFilename);
+  trans2 = vtkTemporalTransformsReader::OpenTemporalTransforms(targetSensorFilename);
+  return EstimateCalibrationFromPoses(trans1, trans2, timeScaleAnalysisBound, timeScaleAnalysisStep,
+                                      timeStep, numberOfThreads, minRotationExcitation,
+                                      outlierThreshold, maximumNumberOfConstraints);
+}
+
+//----------------------------------------------------------------------------
+std::pair<double, AnglePositionVector> EstimateCalibrationFromPoses(
+                                              vtkSmartPointer<vtkTemporalTransforms> sourceSensor,
+                                              vtkSmartPointer<vtkTemporalTransforms> targetSensor,
+                                              const double timeScaleAnalysisBound,
+                                              const double timeScaleAnalysisStep,
+                                              const double timeStep,
+                                              unsigned int numberOfThreads,
+                                              const double minRotationExcitation,
+                                              const double outlierThreshold,
+                                              unsigned int maximumNumberOfConstraints)
+{
+  // We want to estimate our 6-DOF parameters using a non
+  // linear least square minimization. The non linear part
+  // comes from the Euler Angle parametrization of the rotation
+  // endomorphism SO(3). To minimize it we use CERES to perform
+  // the Levenberg-Marquardt algorithm.
+  IncrementalGeometricCalibration calibration(timeScaleAnalysisBound, timeScaleAnalysisStep,
+                                              timeStep, numberOfThreads, minRotationExcitation,
+                                              outlierThreshold, maximumNumberOfConstraints);
+  return calibration.Update(sourceSensor, targetSensor);
 }
 
 //----------------------------------------------------------------------------
@@ -143,10 +426,21 @@ vtkSmartPointer<vtkTemporalTransforms> EstimateCalibrationFromPosesAndApply(
                                             vtkSmartPointer<vtkTemporalTransforms> targetSensor,
                                             const double timeScaleAnalysisBound,
                                             const double timeScaleAnalysisStep,
-                                            const double timeStep)
+                                            const double timeStep,
+                                            unsigned int numberOfThreads,
+                                            const double minRotationExcitation,
+                                            const double outlierThreshold,
+                                            unsigned int maximumNumberOfConstraints)
 {
   // Estimate the cycloidic transform that match the source trajectory on the target one
-  std::pair<double, AnglePositionVector> estimation = EstimateCalibrationFromPoses(sourceSensor, targetSensor);
+  std::pair<double, AnglePositionVector> estimation = EstimateCalibrationFromPoses(sourceSensor, targetSensor,
+                                                                                   timeScaleAnalysisBound,
+                                                                                   timeScaleAnalysisStep,
+                                                                                   timeStep,
+                                                                                   numberOfThreads,
+                                                                                   minRotationExcitation,
+                                                                                   outlierThreshold,
+                                                                                   maximumNumberOfConstraints);
   // Transform the source trajectory
   std::pair<Eigen::Vector3d, Eigen::Vector3d> dof6(estimation.second.segment(0, 3), estimation.second.segment(3, 3));
   vtkSmartPointer<vtkTransform> transform = GetTransformFromPosesParams(dof6);
@@ -328,29 +622,33 @@ std::pair<double, AnglePositionVector> MatchTrajectoriesWithIsometry(vtkSmartPoi
   double tmax = std::min(sourceSensorTransforms->GetMaximumT(), targetSensorTransforms->GetMaximumT());
   const double deltaTime = 0.2; // 200ms
 
-  // usefull transform
-  auto currTransform = vtkSmartPointer<vtkTransform>::New();
+  // The positions of the sensors are interpolated at once, the times being sorted
+  std::vector<double> times;
+  for (double time = tmin; time < tmax; time += deltaTime)
+  {
+    times.push_back(time);
+  }
+  const int nbTimes = static_cast<int>(times.size());
+  std::vector<double> orientations(4 * nbTimes), sourcePositions(3 * nbTimes), targetPositions(3 * nbTimes);
+  sourceSensorTransforms->InterpolateTransforms(nbTimes, times.data(), orientations.data(), sourcePositions.data());
+  targetSensorTransforms->InterpolateTransforms(nbTimes, times.data(), orientations.data(), targetPositions.data());
 
   ceres::Problem problem;
   Eigen::Vector3d X, Y;
   AnglePositionVector transformParams = AnglePositionVector::Zero();
 
   // Loop over the time
-  for (double time = tmin; time < tmax; time += deltaTime)
+  for (int k = 0; k < nbTimes; ++k)
   {
-    // Get the position of the sensor 1 for time
-    sourceSensorTransforms->InterpolateTransform(time, currTransform);
-    X = GetPoseParamsFromTransform(currTransform).second;
-    // Get the position of the sensor 2 for time
-    targetSensorTransforms->InterpolateTransform(time, currTransform);
-    Y = GetPoseParamsFromTransform(currTransform).second;
+    // Get the positions of the sensors 1 and 2 for time
+    X = Eigen::Vector3d(sourcePositions[3 * k], sourcePositions[3 * k + 1], sourcePositions[3 * k + 2]);
+    Y = Eigen::Vector3d(targetPositions[3 * k], targetPositions[3 * k + 1], targetPositions[3 * k + 2]);
 
     // Add the geometric contraint residual function
     // to the non-linear least square problem
     // add this geometric constraint non-linear least square residu to the global
     // cost function that is the sum of all residuals functions
-    ceres::CostFunction* cost_function = new ceres::AutoDiffCostFunction<CostFunctions::EuclideanDistanceAffineIsometryResidual, 1, 6>
-              (new CostFunctions::EuclideanDistanceAffineIsometryResidual(X, Y));
+    ceres::CostFunction* cost_function = new CostFunctions::EuclideanDistanceAffineIsometryAnalyticResidual(X, Y);
     problem.AddResidualBlock(cost_function, nullptr, transformParams.data());
   }
 
@@ -72,6 +72,7 @@
 #include "vtkTemporalTransforms.h"
 
 // STD
+#include <memory>
 #include <vector>
 
 // EIGEN
@@ -79,6 +80,11 @@
 
 typedef Eigen::Matrix<double, 6, 1> AnglePositionVector;
 
+namespace ceres
+{
+class Problem;
+}
+
 /**
 * \function EstimaterEulerAngleConvention
 * \brief This function will find the correct
@@ -137,24 +143,116 @@ void EstimateEulerAngleConvention(const std::string& sourceSensorFilename,
 * \@param timeScaleAnalysisStep Step between two consecutive scale analysis
 * \@param timeStep time step between two consecutives acquisitions time
 *                  to derived the "solid-system" equations
+* \@param numberOfThreads number of threads used by CERES to evaluate the
+*                         residuals, 0 to use all the cores
+* \@param minRotationExcitation minimal rotation (in radian) of the source
+*                               sensor between the two times of a constraint,
+*                               below which the constraint is not used
+* \@param outlierThreshold maximal translation error (in meter) of a constraint
+*                          for the calibration found by a RANSAC on the
+*                          constraints, above which the constraint is an
+*                          outlier and is not used. 0 to use all the constraints
+* \@param maximumNumberOfConstraints maximal number of constraints, the ones with
+*                                    the most rotation excitation being kept.
+*                                    0 to use all the constraints
+*
+*        The minimization starts from a closed-form estimation: the rotation
+*        aligning the rotation axes of the relative motions of the two sensors,
+*        then the translation solving the linear "solid-system" equations.
 */
 std::pair<double, AnglePositionVector> EstimateCalibrationFromPoses(
                                             vtkSmartPointer<vtkTemporalTransforms> sourceSensor,
                                             vtkSmartPointer<vtkTemporalTransforms> targetSensor,
                                             const double timeScaleAnalysisBound = 5.0,
                                             const double timeScaleAnalysisStep = 0.2,
-                                            const double timeStep = 0.4);
+                                            const double timeStep = 0.4,
+                                            unsigned int numberOfThreads = 0,
+                                            const double minRotationExcitation = 0.0,
+                                            const double outlierThreshold = 0.0,
+                                            unsigned int maximumNumberOfConstraints = 0);
 std::pair<double, AnglePositionVector> EstimateCalibrationFromPoses(const std::string& sourceSensorFilename,
                                                                     const std::string& targetSensorFilename,
                                                                     const double timeScaleAnalysisBound = 5.0,
                                                                     const double timeScaleAnalysisStep = 0.2,
-                                                                    const double timeStep = 0.4);
+                                                                    const double timeStep = 0.4,
+                                                                    unsigned int numberOfThreads = 0,
+                                                                    const double minRotationExcitation = 0.0,
+                                            const double outlierThreshold = 0.0,
+                                            unsigned int maximumNumberOfConstraints = 0);
 vtkSmartPointer<vtkTemporalTransforms> EstimateCalibrationFromPosesAndApply(
                                             vtkSmartPointer<vtkTemporalTransforms> sourceSensor,
                                             vtkSmartPointer<vtkTemporalTransforms> targetSensor,
                                             const double timeScaleAnalysisBound = 5.0,
                                             const double timeScaleAnalysisStep = 0.2,
-                                            const double timeStep = 0.4);
+                                            const double timeStep = 0.4,
+                                            unsigned int numberOfThreads = 0,
+                                            const double minRotationExcitation = 0.0,
+                                            const double outlierThreshold = 0.0,
+                                            unsigned int maximumNumberOfConstraints = 0);
+
+/**
+* \class IncrementalGeometricCalibration
+* \brief Estimation of the geometric calibration of EstimateCalibrationFromPoses
+*        that can be updated while poses are appended to the trajectories,
+*        for example to calibrate the sensors during the acquisition.
+*
+*        Each update only adds the "solid-system" constraints of the
+*        acquisition times that were not available at the previous update,
+*        the constraints already added being kept, and the minimization
+*        starts from the previous estimation. The outliers and the constraints
+*        beyond the maximal number are rejected among the new constraints.
+*/
+class IncrementalGeometricCalibration
+{
+public:
+  IncrementalGeometricCalibration(const double timeScaleAnalysisBound = 5.0,
+                                  const double timeScaleAnalysisStep = 0.2,
+                                  const double timeStep = 0.4,
+                                  unsigned int numberOfThreads = 0,
+                                  const double minRotationExcitation = 0.0,
+                                  const double outlierThreshold = 0.0,
+                                  unsigned int maximumNumberOfConstraints = 0);
+  ~IncrementalGeometricCalibration();
+
+  /**
+  * \brief Add the constraints given by the poses appended to the trajectories
+  *        since the last update and estimate the calibration again.
+  *        Return the final cost and the calibration
+  */
+  std::pair<double, AnglePositionVector> Update(vtkSmartPointer<vtkTemporalTransforms> sourceSensor,
+                                                vtkSmartPointer<vtkTemporalTransforms> targetSensor);
+
+  const AnglePositionVector& GetEstimation() const { return this->Estimation; }
+
+private:
+  IncrementalGeometricCalibration(const IncrementalGeometricCalibration&) = delete;
+  void operator=(const IncrementalGeometricCalibration&) = delete;
+
+  //! Add the constraints of the new acquisition times, return their number
+  int AddConstraints(vtkSmartPointer<vtkTemporalTransforms> sourceSensor,
+                     vtkSmartPointer<vtkTemporalTransforms> targetSensor);
+
+  const double TimeScaleAnalysisBound;
+  const double TimeScaleAnalysisStep;
+  const double TimeStep;
+  const unsigned int NumberOfThreads;
+  const double MinRotationExcitation;
+  const double OutlierThreshold;
+  const unsigned int MaximumNumberOfConstraints;
+
+  // Parameters to estimate
+  // - Rotation euler angles from 0 to 2
+  // - Translation coordinates from 3 to 5
+  AnglePositionVector Estimation = AnglePositionVector::Zero();
+  //! The estimation has been initialized in closed-form
+  bool HasEstimation = false;
+
+  //! First acquisition time of the next constraints
+  double NextTime = 0.0;
+  bool HasConstraintTimes = false;
+
+  std::unique_ptr<ceres::Problem> Problem;
+};
 
 /**
 * \function MatchTrajectoriesWithIsometry
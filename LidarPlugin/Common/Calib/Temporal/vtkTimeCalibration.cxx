@@ -50,413 +50,381 @@ std::string ToString(CorrelationStrategy correlationStrategy)
   }
 }
 
-Interpolator1D<double> compute_speed_window(
-    const vtkSmartPointer<vtkCustomTransformInterpolator>& transform,
-    double window_width)
+namespace {
+//-----------------------------------------------------------------------------
+// Poses of a trajectory at the instants requested by the signals of all the
+// strategies, which are interpolated at once
+class TrajectorySamples
 {
-  std::vector<double> times = std::vector<double>();
-  std::vector<double> speeds = std::vector<double>();
-  vtkSmartPointer<vtkTransform> prev = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> next = vtkSmartPointer<vtkTransform>::New();
-
-  double minMidWindowTime = transform->GetMinimumT() + 0.5 * window_width;
-  double maxMidWindowTime = transform->GetMaximumT() - 0.5 * window_width;
-  double period = transform->GetPeriod();
-  double time = minMidWindowTime;
-  while (time < maxMidWindowTime)
+public:
+  explicit TrajectorySamples(vtkSmartPointer<vtkTemporalTransforms> trajectory)
+    : Interpolator(trajectory->CreateInterpolator())
   {
-    transform->InterpolateTransform(time - 0.5 * window_width, prev);
-    transform->InterpolateTransform(time + 0.5 * window_width, next);
-    speeds.push_back((PositionVectorFromTransform(next)
-			    - PositionVectorFromTransform(prev)).norm() / window_width);
-    times.push_back(time);
-    time = time + period;
+    this->Interpolator->SetInterpolationTypeToLinear();
+    this->MinimumT = this->Interpolator->GetMinimumT();
+    this->MaximumT = this->Interpolator->GetMaximumT();
+    this->Period = this->Interpolator->GetPeriod();
+    for (const auto& transform : this->Interpolator->GetTransformList())
+    {
+      this->KeyframeTimes.push_back(transform[0]);
+    }
   }
 
-  return Interpolator1D<double>(times, speeds);
-}
+  //! Request the pose at time t, return the index of the sample
+  int Add(double t)
+  {
+    this->Times.push_back(t);
+    return static_cast<int>(this->Times.size()) - 1;
+  }
 
-Interpolator1D<double> compute_acc_window(
-    const vtkSmartPointer<vtkCustomTransformInterpolator>& transform,
-    double window_width)
-{
-  std::vector<double> times = std::vector<double>();
-  std::vector<double> accs = std::vector<double>();
-  vtkSmartPointer<vtkTransform> prev = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> next = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> curr = vtkSmartPointer<vtkTransform>::New();
-
-  double minMidWindowTime = transform->GetMinimumT() + 0.5 * window_width;
-  double maxMidWindowTime = transform->GetMaximumT() - 0.5 * window_width;
-  double period = transform->GetPeriod();
-  double time = minMidWindowTime;
-  while (time < maxMidWindowTime)
+  //! Request the poses at the keyframes, shared by all the strategies
+  int AddKeyframes()
   {
-    transform->InterpolateTransform(time - 0.5 * window_width, prev);
-    transform->InterpolateTransform(time, curr);
-    transform->InterpolateTransform(time + 0.5 * window_width, next);
-    Eigen::Vector3d a = (PositionVectorFromTransform(next)
-		    + PositionVectorFromTransform(prev)
-		    - 2 * PositionVectorFromTransform(curr)) / (window_width * window_width);
-    accs.push_back(a.norm());
-    times.push_back(time);
-    time = time + period;
+    if (this->KeyframesOffset < 0)
+    {
+      this->KeyframesOffset = static_cast<int>(this->Times.size());
+      this->Times.insert(this->Times.end(), this->KeyframeTimes.begin(), this->KeyframeTimes.end());
+    }
+    return this->KeyframesOffset;
   }
 
-  return Interpolator1D<double>(times, accs);
-}
+  //! Interpolate all the requested poses
+  void Interpolate()
+  {
+    this->Matrices.resize(16 * this->Times.size());
+    this->Interpolator->InterpolateTransforms(static_cast<int>(this->Times.size()),
+                                              this->Times.data(), this->Matrices.data());
+  }
 
-Interpolator1D<double> compute_jerk_window(
-    const vtkSmartPointer<vtkCustomTransformInterpolator>& transform,
-    double window_width)
-{
-  std::vector<double> times = std::vector<double>();
-  std::vector<double> jerks = std::vector<double>();
-  vtkSmartPointer<vtkTransform> t1 = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> t2 = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> t3 = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> t4 = vtkSmartPointer<vtkTransform>::New();
-
-  double minMidWindowTime = transform->GetMinimumT() + 0.5 * window_width;
-  double maxMidWindowTime = transform->GetMaximumT() - 0.5 * window_width;
-  double period = transform->GetPeriod();
-  double time = minMidWindowTime;
-  while (time < maxMidWindowTime)
+  Eigen::Vector3d Position(int i) const
   {
-    transform->InterpolateTransform(time - 0.5 * window_width, t1);
-    transform->InterpolateTransform(time + (- 0.5 + 1.0/3.0) * window_width, t2);
-    transform->InterpolateTransform(time + (- 0.5 + 2.0/3.0) * window_width, t3);
-    transform->InterpolateTransform(time + (- 0.5 + 3.0/3.0) * window_width, t4);
-    Eigen::Vector3d j = (PositionVectorFromTransform(t4)
-		   - 3 * PositionVectorFromTransform(t3)
-		   + 3 * PositionVectorFromTransform(t2)
-		   - PositionVectorFromTransform(t1))
-	    / std::pow(window_width, 3.0);
-    jerks.push_back(j.norm());
-    times.push_back(time);
-    time = time + period;
+    const double* m = &this->Matrices[16 * i];
+    return Eigen::Vector3d(m[3], m[7], m[11]);
   }
 
-  return Interpolator1D<double>(times, jerks);
-}
+  Eigen::Matrix3d Rotation(int i) const
+  {
+    const double* m = &this->Matrices[16 * i];
+    Eigen::Matrix3d R;
+    R << m[0], m[1], m[2], m[4], m[5], m[6], m[8], m[9], m[10];
+    return R;
+  }
 
-Interpolator1D<double> compute_dPos(
-    const vtkSmartPointer<vtkCustomTransformInterpolator>& transform)
+  double MinimumT, MaximumT, Period;
+  std::vector<double> KeyframeTimes;
+
+private:
+  vtkSmartPointer<vtkCustomTransformInterpolator> Interpolator;
+  std::vector<double> Times;
+  std::vector<double> Matrices;
+  int KeyframesOffset = -1;
+};
+
+//-----------------------------------------------------------------------------
+// Signal of a strategy on a trajectory: the instants of its values and the
+// poses it needs, which are requested before the interpolation of the
+// trajectory and used after
+class StrategySignal
 {
-  std::vector<std::vector<double>> transforms = transform->GetTransformList();
-  std::vector<double> t = std::vector<double>(transforms.size() - 1);
-  std::vector<double> x = std::vector<double>(transforms.size() - 1);
-  vtkSmartPointer<vtkTransform> prev = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> curr = vtkSmartPointer<vtkTransform>::New();
-  for (unsigned int i = 0; i < transforms.size() - 1; i++)
+public:
+  StrategySignal(TrajectorySamples& samples, CorrelationStrategy strategy, double window)
+    : Strategy(strategy), Window(window)
   {
-    double t0 = transforms[i][0];
-    double t1 = transforms[i+1][0];
-    t[i] = 0.5 * (t0 + t1);
-    transform->InterpolateTransform(t0, prev);
-    transform->InterpolateTransform(t1, curr);
-    if (std::abs(t1 - t0) < 0.0001) {
-      x[i] = 0.0;
-    } else {
-      x[i] = (PositionVectorFromTransform(curr)
-		      - PositionVectorFromTransform(prev)).norm()
-	      / (t1 - t0);
+    const double w = window;
+    switch (strategy)
+    {
+      case CorrelationStrategy::SPEED_WINDOW:
+        this->AddAccumulatedWindows(samples, {-0.5 * w, 0.5 * w});
+        break;
+      case CorrelationStrategy::ACC_WINDOW:
+        this->AddAccumulatedWindows(samples, {-0.5 * w, 0.0, 0.5 * w});
+        break;
+      case CorrelationStrategy::JERK_WINDOW:
+        this->AddAccumulatedWindows(samples, {-0.5 * w, (-0.5 + 1.0 / 3.0) * w,
+                                              (-0.5 + 2.0 / 3.0) * w, (-0.5 + 3.0 / 3.0) * w});
+        break;
+      case CorrelationStrategy::TRAJECTORY_ANGLE:
+        this->AddSteppedWindows(samples, {-0.5 * w, 0.0, 0.5 * w});
+        break;
+      case CorrelationStrategy::ORIENTATION_ANGLE:
+        this->AddSteppedWindows(samples, {-0.5 * w, 0.5 * w});
+        break;
+      case CorrelationStrategy::DERIVATED_LENGTH:
+      case CorrelationStrategy::DERIVATED_ORIENTATION_ARC:
+        this->AddSteppedWindows(samples, {});
+        this->Offset = samples.AddKeyframes();
+        break;
+      default:
+        this->Offset = samples.AddKeyframes();
+        break;
     }
   }
-  return Interpolator1D<double>(t, x);
-}
 
-Interpolator1D<double> compute_length(
-    const vtkSmartPointer<vtkCustomTransformInterpolator>& transform)
-{
-  std::vector<std::vector<double>> transforms = transform->GetTransformList();
-  std::vector<double> t = std::vector<double>(transforms.size());
-  std::vector<double> x = std::vector<double>(transforms.size());
-  vtkSmartPointer<vtkTransform> prev = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> curr = vtkSmartPointer<vtkTransform>::New();
-  t[0] = transforms[0][0];
-  x[0] = 0.0;
-  for (unsigned int i = 1; i < transforms.size(); i++)
+  //! Compute the signal, once the trajectory is interpolated
+  Interpolator1D<double> Compute(const TrajectorySamples& samples) const
   {
-    t[i] = transforms[i][0];
-    transform->InterpolateTransform(t[i-1], prev);
-    transform->InterpolateTransform(t[i], curr);
-    x[i] = x[i - 1] + (PositionVectorFromTransform(curr)
-		    - PositionVectorFromTransform(prev)).norm();
+    const std::vector<double>& keyframes = samples.KeyframeTimes;
+    const int nKeyframes = static_cast<int>(keyframes.size());
+    const int nTimes = static_cast<int>(this->Times.size());
+    const double w = this->Window;
+    std::vector<double> t, x;
+    switch (this->Strategy)
+    {
+      case CorrelationStrategy::SPEED_WINDOW:
+        for (int i = 0; i < nTimes; i++)
+        {
+          const int s = this->Offset + 2 * i;
+          x.push_back((samples.Position(s + 1) - samples.Position(s)).norm() / w);
+        }
+        return Interpolator1D<double>(this->Times, x);
+      case CorrelationStrategy::ACC_WINDOW:
+        for (int i = 0; i < nTimes; i++)
+        {
+          const int s = this->Offset + 3 * i;
+          Eigen::Vector3d a = (samples.Position(s + 2) + samples.Position(s)
+                               - 2 * samples.Position(s + 1)) / (w * w);
+          x.push_back(a.norm());
+        }
+        return Interpolator1D<double>(this->Times, x);
+      case CorrelationStrategy::JERK_WINDOW:
+        for (int i = 0; i < nTimes; i++)
+        {
+          const int s = this->Offset + 4 * i;
+          Eigen::Vector3d j = (samples.Position(s + 3) - 3 * samples.Position(s + 2)
+                               + 3 * samples.Position(s + 1) - samples.Position(s))
+                              / std::pow(w, 3.0);
+          x.push_back(j.norm());
+        }
+        return Interpolator1D<double>(this->Times, x);
+      case CorrelationStrategy::TRAJECTORY_ANGLE:
+        for (int i = 0; i < nTimes; i++)
+        {
+          const int s = this->Offset + 3 * i;
+          x.push_back(SignedAngle(samples.Position(s + 1) - samples.Position(s),
+                                  samples.Position(s + 2) - samples.Position(s + 1)));
+        }
+        return Interpolator1D<double>(this->Times, x);
+      case CorrelationStrategy::ORIENTATION_ANGLE:
+        for (int i = 0; i < nTimes; i++)
+        {
+          const int s = this->Offset + 2 * i;
+          Eigen::AngleAxisd angleAxis(samples.Rotation(s + 1) * samples.Rotation(s).transpose());
+          x.push_back(angleAxis.angle());
+        }
+        return Interpolator1D<double>(this->Times, x);
+      case CorrelationStrategy::DPOS:
+      case CorrelationStrategy::DROT:
+        for (int i = 0; i < nKeyframes - 1; i++)
+        {
+          const double t0 = keyframes[i];
+          const double t1 = keyframes[i + 1];
+          t.push_back(0.5 * (t0 + t1));
+          if (std::abs(t1 - t0) < 0.0001)
+          {
+            x.push_back(0.0);
+          }
+          else if (this->Strategy == CorrelationStrategy::DPOS)
+          {
+            x.push_back((samples.Position(this->Offset + i + 1)
+                         - samples.Position(this->Offset + i)).norm() / (t1 - t0));
+          }
+          else
+          {
+            Eigen::AngleAxisd aa(samples.Rotation(this->Offset + i + 1)
+                                 * samples.Rotation(this->Offset + i).transpose());
+            x.push_back(std::abs(aa.angle()) / (t1 - t0));
+          }
+        }
+        return Interpolator1D<double>(t, x);
+      case CorrelationStrategy::LENGTH:
+        return this->ComputeCumulated(samples, true);
+      case CorrelationStrategy::DERIVATED_LENGTH:
+      case CorrelationStrategy::DERIVATED_ORIENTATION_ARC:
+      {
+        // the cumulated signal is an interpolator so no need to check that the
+        // sample instants are not the same (they are not, even if the
+        // interpolation mode of the trajectory is "NEAREST")
+        Interpolator1D<double> cumulated = this->ComputeCumulated(samples,
+          this->Strategy == CorrelationStrategy::DERIVATED_LENGTH);
+        std::vector<double> ends(this->Times.size()), starts(this->Times.size());
+        for (size_t i = 0; i < this->Times.size(); i++)
+        {
+          ends[i] = this->Times[i] + 0.5 * w;
+          starts[i] = this->Times[i] - 0.5 * w;
+        }
+        const std::vector<double> cumulatedEnds = cumulated.Get(ends);
+        const std::vector<double> cumulatedStarts = cumulated.Get(starts);
+        for (size_t i = 0; i < this->Times.size(); i++)
+        {
+          x.push_back((cumulatedEnds[i] - cumulatedStarts[i]) / w);
+        }
+        return Interpolator1D<double>(this->Times, x);
+      }
+      default:
+        return Interpolator1D<double>();
+    }
   }
 
-  return Interpolator1D<double>(t, x);
-}
-
-
-Interpolator1D<double> compute_derivated_length(
-    const vtkSmartPointer<vtkCustomTransformInterpolator>& transform,
-    double window_width)
-{
-  Interpolator1D<double> length = compute_length(transform);
-  double tMin = transform->GetMinimumT() + 0.5 * window_width;
-  double tMax = transform->GetMaximumT() - 0.5 * window_width;
-  int steps = (tMax - tMin) / transform->GetPeriod() + 1;
-  std::vector<double> derivated_length = std::vector<double>(steps);
-  std::vector<double> times = std::vector<double>(steps);
-  for (int i = 0; i < steps; i++)
+private:
+  //! Windows around instants separated by the period, accumulated from the
+  //! first one up to the last window fitting in the trajectory
+  void AddAccumulatedWindows(TrajectorySamples& samples, const std::vector<double>& offsets)
   {
-    double time = tMin + i * transform->GetPeriod();
-    times[i] = time;
-    // length is an interpolator so no need to check that the sample instants
-    // are not the same (they are not, even if the interpolation mode of
-    // this->Reference/Aligned is "NEAREST")
-    derivated_length[i] = (length.Get(time + 0.5 * window_width)
-                           - length.Get(time - 0.5 * window_width))
-                    / window_width;
+    const double maxMidWindowTime = samples.MaximumT - 0.5 * this->Window;
+    double time = samples.MinimumT + 0.5 * this->Window;
+    this->Offset = -1;
+    while (time < maxMidWindowTime)
+    {
+      this->AddWindow(samples, time, offsets);
+      time = time + samples.Period;
+    }
   }
 
-  return Interpolator1D<double>(times, derivated_length);
-}
-
-Interpolator1D<double> compute_dRot(
-    const vtkSmartPointer<vtkCustomTransformInterpolator>& transform)
-{
-  std::vector<std::vector<double>> transforms = transform->GetTransformList();
-  std::vector<double> t = std::vector<double>(transforms.size() - 1);
-  std::vector<double> x = std::vector<double>(transforms.size() - 1);
-  vtkSmartPointer<vtkTransform> prev = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> curr = vtkSmartPointer<vtkTransform>::New();
-  for (int i = 0; i < static_cast<int>(transforms.size()) - 1; i++)
+  //! Windows around a fixed number of instants separated by the period
+  void AddSteppedWindows(TrajectorySamples& samples, const std::vector<double>& offsets)
   {
-    double t0 = transforms[i][0];
-    double t1 = transforms[i+1][0];
-    transform->InterpolateTransform(t0, prev);
-    transform->InterpolateTransform(t1, curr);
-    Eigen::AngleAxisd aa = Eigen::AngleAxisd(RotationMatrixFromTransform(curr)
-		    * RotationMatrixFromTransform(prev).transpose());
-    t[i] = 0.5 * (t0 + t1);
-    if (std::abs(t1 - t0) < 0.0001) {
-      x[i] = 0.0;
-    } else {
-      x[i] = std::abs(aa.angle()) / (t1 - t0);
+    const double tMin = samples.MinimumT + 0.5 * this->Window;
+    const double tMax = samples.MaximumT - 0.5 * this->Window;
+    const int steps = (tMax - tMin) / samples.Period + 1;
+    this->Offset = -1;
+    for (int i = 0; i < steps; i++)
+    {
+      this->AddWindow(samples, tMin + i * samples.Period, offsets);
     }
   }
-  return Interpolator1D<double>(t, x);
-}
 
-// TODO: handle case where real_sample_time(next) == real_sample_time(prev)
-Interpolator1D<double> compute_trajectory_angle(
-    const vtkSmartPointer<vtkCustomTransformInterpolator>& transform,
-    double window_width)
-{
-  vtkSmartPointer<vtkTransform> prev = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> curr = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> next = vtkSmartPointer<vtkTransform>::New();
-  double tMin = transform->GetMinimumT() + 0.5 * window_width;
-  double tMax = transform->GetMaximumT() - 0.5 * window_width;
-  int steps = (tMax - tMin) / transform->GetPeriod() + 1;
-  std::vector<double> trajectory_angle = std::vector<double>(steps);
-  std::vector<double> times = std::vector<double>(steps);
-  for (int i = 0; i < steps; i++)
+  void AddWindow(TrajectorySamples& samples, double time, const std::vector<double>& offsets)
   {
-    double time = tMin + i * transform->GetPeriod();
-    transform->InterpolateTransform(time - 0.5 * window_width, prev);
-    transform->InterpolateTransform(time, curr);
-    transform->InterpolateTransform(time + 0.5 * window_width, next);
-    times[i] = time;
-    trajectory_angle[i] = SignedAngle(PositionVectorFromTransform(curr)
-		    - PositionVectorFromTransform(prev),
-		    PositionVectorFromTransform(next)
-		    - PositionVectorFromTransform(curr));
+    this->Times.push_back(time);
+    for (double offset : offsets)
+    {
+      const int index = samples.Add(time + offset);
+      if (this->Offset < 0)
+      {
+        this->Offset = index;
+      }
+    }
   }
 
-  return Interpolator1D<double>(times, trajectory_angle);
-}
-
-
-Interpolator1D<double> compute_orientation_arc(
-    const vtkSmartPointer<vtkCustomTransformInterpolator>& transform)
-{
-  std::vector<std::vector<double>> transforms = transform->GetTransformList();
-  std::vector<double> t = std::vector<double>(transforms.size());
-  std::vector<double> x = std::vector<double>(transforms.size());
-  vtkSmartPointer<vtkTransform> prev = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> curr = vtkSmartPointer<vtkTransform>::New();
-  t[0] = transforms[0][0];
-  x[0] = 0.0;
-  for (unsigned int i = 1; i < transforms.size(); i++)
+  //! Length of the trajectory or arc of its orientation since its start, at the keyframes
+  Interpolator1D<double> ComputeCumulated(const TrajectorySamples& samples, bool length) const
   {
-    t[i] = transforms[i][0];
-    transform->InterpolateTransform(t[i-1], prev);
-    transform->InterpolateTransform(t[i], curr);
-    Eigen::AngleAxisd aa = Eigen::AngleAxisd(RotationMatrixFromTransform(curr)
-		    * RotationMatrixFromTransform(prev).transpose());
-    x[i] = x[i - 1] + std::abs(aa.angle());
+    const std::vector<double>& keyframes = samples.KeyframeTimes;
+    std::vector<double> x(keyframes.size());
+    x[0] = 0.0;
+    for (unsigned int i = 1; i < keyframes.size(); i++)
+    {
+      if (length)
+      {
+        x[i] = x[i - 1] + (samples.Position(this->Offset + i)
+                           - samples.Position(this->Offset + i - 1)).norm();
+      }
+      else
+      {
+        Eigen::AngleAxisd aa(samples.Rotation(this->Offset + i)
+                             * samples.Rotation(this->Offset + i - 1).transpose());
+        x[i] = x[i - 1] + std::abs(aa.angle());
+      }
+    }
+    return Interpolator1D<double>(keyframes, x);
   }
 
-  return Interpolator1D<double>(t, x);
-}
-
-
-Interpolator1D<double> compute_derivated_orientation_arc(
-    const vtkSmartPointer<vtkCustomTransformInterpolator>& transform,
-    double window_width)
+  CorrelationStrategy Strategy;
+  double Window;
+  //! Instants of the values of the windowed signals
+  std::vector<double> Times;
+  //! Index of the first pose used by the signal in the samples
+  int Offset = -1;
+};
+
+//-----------------------------------------------------------------------------
+// Compute the signals of the methods on both trajectories, each trajectory
+// being interpolated once for all the methods
+void ComputeSignals(vtkSmartPointer<vtkTemporalTransforms> reference,
+                    vtkSmartPointer<vtkTemporalTransforms> aligned,
+                    const std::vector<CorrelationMethod>& methods,
+                    std::vector<Interpolator1D<double> >& sigReference,
+                    std::vector<Interpolator1D<double> >& sigAligned)
 {
-  Interpolator1D<double> orientation_arc = compute_orientation_arc(transform);
-  double tMin = transform->GetMinimumT() + 0.5 * window_width;
-  double tMax = transform->GetMaximumT() - 0.5 * window_width;
-  int steps = (tMax - tMin) / transform->GetPeriod() + 1;
-  std::vector<double> derivated_orientation_arc = std::vector<double>(steps);
-  std::vector<double> times = std::vector<double>(steps);
-  for (int i = 0; i < steps; i++)
+  TrajectorySamples referenceSamples(reference);
+  TrajectorySamples alignedSamples(aligned);
+  std::vector<StrategySignal> referenceSignals, alignedSignals;
+  for (const auto& method : methods)
   {
-    double time = tMin + i * transform->GetPeriod();
-    times[i] = time;
-    // length is an interpolator so no need to check that the sample instants
-    // are not the same (they are not, even if the interpolation mode of
-    // this->Reference/Aligned is "NEAREST")
-    derivated_orientation_arc[i] =
-                    (orientation_arc.Get(time + 0.5 * window_width)
-                     - orientation_arc.Get(time - 0.5 * window_width))
-                    / window_width;
+    referenceSignals.emplace_back(referenceSamples, method.Strategy, method.TimeWindowWidth);
+    alignedSignals.emplace_back(alignedSamples, method.Strategy, method.TimeWindowWidth);
   }
+  referenceSamples.Interpolate();
+  alignedSamples.Interpolate();
 
-  return Interpolator1D<double>(times, derivated_orientation_arc);
+  sigReference.clear();
+  sigAligned.clear();
+  for (unsigned int i = 0; i < methods.size(); i++)
+  {
+    sigReference.push_back(referenceSignals[i].Compute(referenceSamples));
+    sigAligned.push_back(alignedSignals[i].Compute(alignedSamples));
+  }
+}
 }
 
-
-// TODO: handle case where real_sample_time(next) == real_sample_time(prev)
-Interpolator1D<double> compute_orientation_angle(
-    const vtkSmartPointer<vtkCustomTransformInterpolator>& transform,
-    double window_width)
+//-----------------------------------------------------------------------------
+std::vector<double> ComputeTimeShifts(vtkSmartPointer<vtkTemporalTransforms> reference,
+                                      vtkSmartPointer<vtkTemporalTransforms> aligned,
+                                      const std::vector<CorrelationMethod>& methods,
+                                      bool substract_mean)
 {
-  vtkSmartPointer<vtkTransform> prev = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> next = vtkSmartPointer<vtkTransform>::New();
-  double tMin = transform->GetMinimumT() + 0.5 * window_width;
-  double tMax = transform->GetMaximumT() - 0.5 * window_width;
-  int steps = (tMax - tMin) / transform->GetPeriod() + 1;
-  std::vector<double> orientation_angle = std::vector<double>(steps);
-  std::vector<double> times = std::vector<double>(steps);
-  for (int i = 0; i < steps; i++)
+  std::vector<Interpolator1D<double> > sigReferences, sigAligneds;
+  ComputeSignals(reference, aligned, methods, sigReferences, sigAligneds);
+
+  FFTCorrelator<double> correlator;
+  std::vector<double> shifts(methods.size(), 0.0);
+  std::vector<double> reference_resampled, aligned_resampled;
+  for (unsigned int m = 0; m < methods.size(); m++)
   {
-    double time = tMin + i * transform->GetPeriod();
-    transform->InterpolateTransform(time - 0.5 * window_width, prev);
-    transform->InterpolateTransform(time + 0.5 * window_width, next);
-    times[i] = time;
-    Eigen::AngleAxisd angleAxis(RotationMatrixFromTransform(next)
-		    * RotationMatrixFromTransform(prev).transpose());
-    orientation_angle[i] = angleAxis.angle();
-  }
+    if (ToString(methods[m].Strategy) == "unkown")
+    {
+      std::cerr << "unknown correlation strategy" << std::endl;
+      continue;
+    }
+    Interpolator1D<double>& sig_reference = sigReferences[m];
+    Interpolator1D<double>& sig_aligned = sigAligneds[m];
 
-  return Interpolator1D<double>(times, orientation_angle);
+    if (substract_mean)
+    {
+      sig_reference.ApplyValueShift(- sig_reference.Mean());
+      sig_aligned.ApplyValueShift(- sig_aligned.Mean());
+    }
+
+    // We prefere the two signals to start at t = 0, so we time shift them,
+    // but before that we save the information that we would lose otherwise.
+    double pre_resample = sig_aligned.GetMinimumT() - sig_reference.GetMinimumT();
+    sig_aligned.ApplyTimeShift(- sig_aligned.GetMinimumT());
+    sig_reference.ApplyTimeShift(- sig_reference.GetMinimumT());
+
+    // by construction we now have tMin == 0.0;
+    double tMax = std::max(sig_reference.GetMaximumT(), sig_aligned.GetMaximumT());
+    double period = std::min(sig_reference.GetAveragePeriod(),
+                             sig_aligned.GetAveragePeriod());
+    int steps = std::floor(tMax / period);
+    sig_reference.Resample(0.0, period, steps, reference_resampled);
+    sig_aligned.Resample(0.0, period, steps, aligned_resampled);
+
+    double correlation = correlator.MaxCorrelation(reference_resampled, aligned_resampled);
+    double correction = correlation * period;
+    shifts[m] = pre_resample - correction;
+  }
+  return shifts;
 }
 
+//-----------------------------------------------------------------------------
 double ComputeTimeShift(vtkSmartPointer<vtkTemporalTransforms> reference,
                       vtkSmartPointer<vtkTemporalTransforms> aligned,
                       CorrelationStrategy correlationStrategy,
                       double time_window_width,
                       bool substract_mean)
 {
-  vtkSmartPointer<vtkCustomTransformInterpolator> referenceInterpolator
-      = reference->CreateInterpolator();
-  referenceInterpolator->SetInterpolationTypeToLinear();
-  vtkSmartPointer<vtkCustomTransformInterpolator> alignedInterpolator
-      = aligned->CreateInterpolator();
-  alignedInterpolator->SetInterpolationTypeToLinear();
-  Interpolator1D<double> sig_reference;
-  Interpolator1D<double> sig_aligned;
-  // first, compute the signals using the chosen method
-  switch (correlationStrategy)
-  {
-    case CorrelationStrategy::DPOS:
-      sig_reference = compute_dPos(referenceInterpolator);
-      sig_aligned = compute_dPos(alignedInterpolator);
-      break;
-    case CorrelationStrategy::SPEED_WINDOW:
-      sig_reference = compute_speed_window(referenceInterpolator,
-                                               time_window_width);
-      sig_aligned = compute_speed_window(alignedInterpolator,
-                                             time_window_width);
-      break;
-    case CorrelationStrategy::ACC_WINDOW:
-      sig_reference = compute_acc_window(referenceInterpolator,
-                                               time_window_width);
-      sig_aligned = compute_acc_window(alignedInterpolator,
-                                             time_window_width);
-      break;
-    case CorrelationStrategy::JERK_WINDOW:
-      sig_reference = compute_jerk_window(referenceInterpolator,
-                                               time_window_width);
-      sig_aligned = compute_jerk_window(alignedInterpolator,
-                                             time_window_width);
-      break;
-    case CorrelationStrategy::LENGTH:
-      sig_reference = compute_length(referenceInterpolator);
-      sig_aligned = compute_length(alignedInterpolator);
-      break;
-    case CorrelationStrategy::DERIVATED_LENGTH:
-      sig_reference = compute_derivated_length(referenceInterpolator,
-                                               time_window_width);
-      sig_aligned = compute_derivated_length(alignedInterpolator,
-                                             time_window_width);
-      break;
-    case CorrelationStrategy::DROT:
-      sig_reference = compute_dRot(referenceInterpolator);
-      sig_aligned = compute_dRot(alignedInterpolator);
-      break;
-    case CorrelationStrategy::TRAJECTORY_ANGLE:
-      sig_reference = compute_trajectory_angle(referenceInterpolator,
-                                               time_window_width);
-      sig_aligned = compute_trajectory_angle(alignedInterpolator,
-                                             time_window_width);
-      break;
-    case CorrelationStrategy::ORIENTATION_ANGLE:
-      sig_reference = compute_orientation_angle(referenceInterpolator,
-                                                time_window_width);
-      sig_aligned = compute_orientation_angle(alignedInterpolator,
-                                              time_window_width);
-      break;
-    case CorrelationStrategy::DERIVATED_ORIENTATION_ARC:
-      sig_reference = compute_derivated_orientation_arc(
-                              referenceInterpolator,
-                              time_window_width);
-      sig_aligned = compute_derivated_orientation_arc(
-                              alignedInterpolator,
-                              time_window_width);
-      break;
-    default:
-      std::cerr << "unknown correlation strategy" << std::endl;
-      return 0.0;
-  }
-
-  if (substract_mean)
-  {
-    sig_reference.ApplyValueShift(- sig_reference.Mean());
-    sig_aligned.ApplyValueShift(- sig_aligned.Mean());
-  }
-
-  // We prefere the two signals to start at t = 0, so we time shift them,
-  // but before that we save the information that we would lose otherwise.
-  double pre_resample = sig_aligned.GetMinimumT() - sig_reference.GetMinimumT();
-  sig_aligned.ApplyTimeShift(- sig_aligned.GetMinimumT());
-  sig_reference.ApplyTimeShift(- sig_reference.GetMinimumT());
-
-  // by construction we now have tMin == 0.0;
-  double tMax = std::max(sig_reference.GetMaximumT(), sig_aligned.GetMaximumT());
-  double period = std::min(sig_reference.GetAveragePeriod(),
-		  sig_aligned.GetAveragePeriod());
-  int steps = std::floor(tMax / period);
-  std::vector<double> reference_resampled = std::vector<double>(steps);
-  std::vector<double> aligned_resampled = std::vector<double>(steps);
-  for (int i = 0; i < steps; i++)
-  {
-    double time = 0.0 + i * period;
-    reference_resampled[i] = sig_reference.Get(time);
-    aligned_resampled[i] = sig_aligned.Get(time);
-  }
-
-  std::vector<double> test = fftcorrelate(reference_resampled, aligned_resampled);
-
-  int correlation = max_fftcorrelation(reference_resampled, aligned_resampled);
-  double correction = correlation * period;
-  double delta_t = pre_resample - correction;
-  return delta_t;
+  return ComputeTimeShifts(reference, aligned, {{correlationStrategy, time_window_width}},
+                           substract_mean)[0];
 }
 
 void ShowTrajectoryInfo(vtkSmartPointer<vtkTemporalTransforms> reference, vtkSmartPointer<vtkTemporalTransforms> aligned)
@@ -474,22 +442,25 @@ void ShowTrajectoryInfo(vtkSmartPointer<vtkTemporalTransforms> reference, vtkSma
 }
 
 void DemoAllTimesyncMethods(vtkSmartPointer<vtkTemporalTransforms> reference, vtkSmartPointer<vtkTemporalTransforms> aligned) {
-  vtkSmartPointer<vtkCustomTransformInterpolator> referenceI = reference->CreateInterpolator();
-  vtkSmartPointer<vtkCustomTransformInterpolator> alignedI = aligned->CreateInterpolator();
+  typedef CorrelationStrategy S;
+  const std::vector<CorrelationMethod> methods = {
+    {S::DPOS, 1.0}, {S::SPEED_WINDOW, 1.0}, {S::ACC_WINDOW, 3}, {S::JERK_WINDOW, 6},
+    {S::DERIVATED_LENGTH, 1.0}, {S::DROT, 1.0}, {S::TRAJECTORY_ANGLE, 10.0},
+    {S::ORIENTATION_ANGLE, 1.0}, {S::DERIVATED_ORIENTATION_ARC, 1.0}};
+  const char* labels[] = {
+    "dPos:                      ", "speed window:              ", "acceleration window:       ",
+    "jerk window:               ", "derivated length:          ", "dRot:                      ",
+    "trajectory angle:          ", "orientation angle:         ", "derivated orientation arc: "};
+  const std::vector<double> shifts = ComputeTimeShifts(reference, aligned, methods);
 
   std::cout << std::fixed;
   std::cout << std::setprecision(4);
   ShowTrajectoryInfo(reference, aligned);
   std::cout << std::endl;
-  std::cout << "dPos:                      " << ComputeTimeShift(reference, aligned, CorrelationStrategy::DPOS, 1.0) << std::endl;
-  std::cout << "speed window:              " << ComputeTimeShift(reference, aligned, CorrelationStrategy::SPEED_WINDOW, 1.0) << std::endl;
-  std::cout << "acceleration window:       " << ComputeTimeShift(reference, aligned, CorrelationStrategy::ACC_WINDOW, 3) << std::endl;
-  std::cout << "jerk window:               " << ComputeTimeShift(reference, aligned, CorrelationStrategy::JERK_WINDOW, 6) << std::endl;
-  std::cout << "derivated length:          " << ComputeTimeShift(reference, aligned, CorrelationStrategy::DERIVATED_LENGTH, 1.0) << std::endl;
-  std::cout << "dRot:                      " << ComputeTimeShift(reference, aligned, CorrelationStrategy::DROT, 1.0) << std::endl;
-  std::cout << "trajectory angle:          " << ComputeTimeShift(reference, aligned, CorrelationStrategy::TRAJECTORY_ANGLE, 10.0) << std::endl;
-  std::cout << "orientation angle:         " << ComputeTimeShift(reference, aligned, CorrelationStrategy::ORIENTATION_ANGLE, 1.0) << std::endl;
-  std::cout << "derivated orientation arc: " << ComputeTimeShift(reference, aligned, CorrelationStrategy::DERIVATED_ORIENTATION_ARC, 1.0) << std::endl;
+  for (unsigned int i = 0; i < methods.size(); i++)
+  {
+    std::cout << labels[i] << shifts[i] << std::endl;
+  }
 }
 
 
@@ -499,69 +470,43 @@ double ComputeScale(vtkSmartPointer<vtkTemporalTransforms> reference,
                   double time_window_width)
 {
   const double div_epsilon = 1e-4;
-  vtkSmartPointer<vtkCustomTransformInterpolator> referenceInterpolator = reference->CreateInterpolator();
-  referenceInterpolator->SetInterpolationTypeToLinear();
-  vtkSmartPointer<vtkCustomTransformInterpolator> alignedInterpolator = aligned->CreateInterpolator();
-  alignedInterpolator->SetInterpolationTypeToLinear();
-  Interpolator1D<double> sig_reference;
-  Interpolator1D<double> sig_aligned;
   switch (correlationStrategy)
   {
     case CorrelationStrategy::DPOS:
-      sig_reference = compute_dPos(referenceInterpolator);
-      sig_aligned = compute_dPos(alignedInterpolator);
-      break;
     case CorrelationStrategy::SPEED_WINDOW:
-      sig_reference = compute_speed_window(referenceInterpolator,
-                                               time_window_width);
-      sig_aligned = compute_speed_window(alignedInterpolator,
-                                             time_window_width);
-      break;
     case CorrelationStrategy::ACC_WINDOW:
-      sig_reference = compute_acc_window(referenceInterpolator,
-                                               time_window_width);
-      sig_aligned = compute_acc_window(alignedInterpolator,
-                                             time_window_width);
-      break;
     case CorrelationStrategy::JERK_WINDOW:
-      sig_reference = compute_jerk_window(referenceInterpolator,
-                                               time_window_width);
-      sig_aligned = compute_jerk_window(alignedInterpolator,
-                                             time_window_width);
-      break;
     case CorrelationStrategy::LENGTH:
-      sig_reference = compute_length(referenceInterpolator);
-      sig_aligned = compute_length(alignedInterpolator);
-      break;
     case CorrelationStrategy::DERIVATED_LENGTH:
-      sig_reference = compute_derivated_length(referenceInterpolator,
-                                               time_window_width);
-      sig_aligned = compute_derivated_length(alignedInterpolator,
-                                             time_window_width);
       break;
     default:
       std::cerr << "unsuported correlation strategy" << std::endl;
       return 0.0;
   }
+  std::vector<Interpolator1D<double> > sigReferences, sigAligneds;
+  ComputeSignals(reference, aligned, {{correlationStrategy, time_window_width}},
+                 sigReferences, sigAligneds);
+  Interpolator1D<double>& sig_reference = sigReferences[0];
+  Interpolator1D<double>& sig_aligned = sigAligneds[0];
 
   double tMin = std::min(sig_reference.GetMinimumT(), sig_aligned.GetMaximumT());
   double tMax = std::max(sig_reference.GetMaximumT(), sig_aligned.GetMaximumT());
   double period = std::min(sig_reference.GetAveragePeriod(),
 		  sig_aligned.GetAveragePeriod());
   int steps = std::floor((tMax - tMin) / period);
+  std::vector<double> reference_resampled, aligned_resampled;
+  sig_reference.Resample(tMin, period, steps, reference_resampled);
+  sig_aligned.Resample(tMin, period, steps, aligned_resampled);
   std::vector<double> ratios;
   for (int i = 0; i < steps; i++)
   {
-    double time = tMin + i * period;
-    double reference_resampled = sig_reference.Get(time);
-    double aligned_resampled = sig_aligned.Get(time);
-    if (reference_resampled < div_epsilon)
+    if (reference_resampled[i] < div_epsilon)
     {
       continue;
     }
     else
     {
-      ratios.push_back(aligned_resampled / reference_resampled);
+      ratios.push_back(aligned_resampled[i] / reference_resampled[i]);
     }
   }
 
@@ -47,6 +47,13 @@ enum class CorrelationStrategy
 
 std::string ToString(CorrelationStrategy strategy);
 
+//! A strategy and the width of its time window
+struct CorrelationMethod
+{
+  CorrelationStrategy Strategy;
+  double TimeWindowWidth;
+};
+
 /**
  * \brief Compute the timeshift in seconds between both pose trajectories.
  *
@@ -57,7 +64,8 @@ std::string ToString(CorrelationStrategy strategy);
  * Steps:
  * 1) Compute the two 1D signals using the method correlationStrategy
  * 2) resample them
- * 3) FFT then iFFT
+ * 3) FFT then iFFT, the peak of the correlation being refined to a
+ *    fraction of sample
  **/
 double LidarPlugin_EXPORT ComputeTimeShift(vtkSmartPointer<vtkTemporalTransforms> reference,
                       vtkSmartPointer<vtkTemporalTransforms> aligned,
@@ -65,6 +73,18 @@ double LidarPlugin_EXPORT ComputeTimeShift(vtkSmartPointer<vtkTemporalTransforms
                       double time_window_width,
                       bool substract_mean = true);
 
+/**
+ * \brief Compute the timeshifts given by several methods, see ComputeTimeShift.
+ *
+ * Both pose trajectories are interpolated once at all the instants needed by
+ * the signals of the methods, and all the correlations share the same FFT
+ * plans and buffers.
+ **/
+std::vector<double> LidarPlugin_EXPORT ComputeTimeShifts(vtkSmartPointer<vtkTemporalTransforms> reference,
+                      vtkSmartPointer<vtkTemporalTransforms> aligned,
+                      const std::vector<CorrelationMethod>& methods,
+                      bool substract_mean = true);
+
 void ShowTrajectoryInfo(vtkSmartPointer<vtkTemporalTransforms> reference,
                     vtkSmartPointer<vtkTemporalTransforms> aligned);
 
@@ -22,6 +22,7 @@
 #include "vtkEigenTools.h"
 
 // STD
+#include <cmath>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -190,3 +191,89 @@ Eigen::Vector2d BrownConradyPinholeProjection(const Eigen::Matrix<double, 17, 1>
    Eigen::Vector3d Xpix = K * Xp1dh;
    return Eigen::Vector2d(Xpix(0) / Xpix(2), Xpix(1) / Xpix(2));
 }
+
+//----------------------------------------------------------------------------
+template<typename T>
+void ProjectPoints(const Eigen::VectorXd& W, ProjectionType type,
+                   const T* points, int nbPoints, double* pixels,
+                   double* depths, bool shouldClip)
+{
+  // Get rotation matrix, transposed to express the points in the camera frame
+  const Eigen::Matrix3d Rt = RollPitchYawToMatrix(W(0), W(1), W(2)).transpose();
+  const double t[3] = {W(3), W(4), W(5)};
+
+  // Intrinsic parameters
+  const double fx = W(6), fy = W(7), cx = W(8), cy = W(9), skew = W(10);
+
+  // Optical parameters
+  double d[6] = {0, 0, 0, 0, 0, 0};
+  if (type == ProjectionType::BrownConradyPinhole)
+  {
+    for (int k = 0; k < 6; ++k)
+    {
+      d[k] = W(11 + k);
+    }
+  }
+  else if (type == ProjectionType::FishEye)
+  {
+    for (int k = 0; k < 4; ++k)
+    {
+      d[k] = W(11 + k);
+    }
+  }
+
+  for (int i = 0; i < nbPoints; ++i)
+  {
+    // Express the 3D point in the camera reference frame
+    const double X[3] = {points[3 * i] - t[0], points[3 * i + 1] - t[1], points[3 * i + 2] - t[2]};
+    const double xc = Rt(0, 0) * X[0] + Rt(0, 1) * X[1] + Rt(0, 2) * X[2];
+    const double yc = Rt(1, 0) * X[0] + Rt(1, 1) * X[1] + Rt(1, 2) * X[2];
+    const double zc = Rt(2, 0) * X[0] + Rt(2, 1) * X[1] + Rt(2, 2) * X[2];
+    if (depths)
+    {
+      depths[i] = zc;
+    }
+
+    // check that the point is not behind the camera plane
+    if (shouldClip && zc < 0)
+    {
+      pixels[2 * i] = -1;
+      pixels[2 * i + 1] = -1;
+      continue;
+    }
+
+    // Project the 3D point in the plan
+    double x = xc / zc;
+    double y = yc / zc;
+    const double r2 = x * x + y * y;
+
+    // Apply the distortion
+    if (type == ProjectionType::BrownConradyPinhole)
+    {
+      const double radial = d[0] * r2 + d[1] * r2 * r2;
+      const double tangentialScale = 1 + d[4] * r2 + d[5] * r2 * r2;
+      const double xd = x + x * radial + (d[2] * (r2 + 2 * x * x) + 2 * d[3] * x * y) * tangentialScale;
+      const double yd = y + y * radial + (2 * d[2] * x * y + d[3] * (r2 + 2 * y * y)) * tangentialScale;
+      x = xd;
+      y = yd;
+    }
+    else if (type == ProjectionType::FishEye)
+    {
+      const double r = std::sqrt(r2);
+      const double theta = std::atan(r);
+      const double theta2 = theta * theta;
+      const double thetad = theta * (1 + theta2 * (d[0] + theta2 * (d[1] + theta2 * (d[2] + theta2 * d[3]))));
+      // the scale tends to 1 at the optical center
+      const double scale = r > 0 ? thetad / r : 1.0;
+      x *= scale;
+      y *= scale;
+    }
+
+    // Express the point in the pixel coordinates
+    pixels[2 * i] = fx * x + skew * y + cx;
+    pixels[2 * i + 1] = fy * y + cy;
+  }
+}
+
+template void ProjectPoints<float>(const Eigen::VectorXd&, ProjectionType, const float*, int, double*, double*, bool);
+template void ProjectPoints<double>(const Eigen::VectorXd&, ProjectionType, const double*, int, double*, double*, bool);
@@ -27,6 +27,9 @@
 // EIGEN
 #include <Eigen/Dense>
 
+// LOCAL
+#include "CameraModel.h"
+
 /**
    * @brief LoadCameraParamsFromCSV Load parameters from a csv file
    *
@@ -72,6 +75,26 @@ Eigen::Vector2d BrownConradyPinholeProjection(const Eigen::Matrix<double, 17, 1>
                                               const Eigen::Vector3d& X,
                                               bool shouldPlaneClip = false);
 
+/**
+   * @brief ProjectPoints Project a batch of 3D points using the pinhole,
+   *        Brown-Conrady pinhole or fisheye camera model. The rotation and the
+   *        intrinsic matrix are computed once for the batch, the projection of
+   *        each point being the same as the single point functions above
+   *
+   * @param W camera model parameters, 11, 17 or 15 parameters depending on type
+   * @param type camera model
+   * @param points 3D points to project, as consecutive x, y, z coordinates
+   * @param nbPoints number of points
+   * @param pixels projected points in pixel coordinates, as consecutive u, v
+   *        coordinates, (-1, -1) for the clipped points
+   * @param depths optional depth of the points in the camera reference frame
+   * @param shouldClip Clip points that are behind the camera plane
+   */
+template<typename T>
+void ProjectPoints(const Eigen::VectorXd& W, ProjectionType type,
+                   const T* points, int nbPoints, double* pixels,
+                   double* depths = nullptr, bool shouldClip = false);
+
 /**
    * @brief GetRGBColourFromReflectivity map the reflectivity signal
    *        onto a RGB color map
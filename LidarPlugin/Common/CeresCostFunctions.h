@@ -20,6 +20,10 @@
 #ifndef CERES_COST_FUNCTIONS_H
 #define CERES_COST_FUNCTIONS_H
 
+// STD
+#include <algorithm>
+#include <cmath>
+
 // EIGEN
 #include <Eigen/Dense>
 
@@ -60,9 +64,11 @@ public:
     // Create sin / cos evaluation variables in static way.
     // The idea is that all residual function will need to
     // evaluate those sin / cos so we will only compute then
-    // once each time the parameters values change
-    static T crx, cry, crz, srx, sry, srz;
-    static T lastWValues[6] = {T(-1.0), T(-1.0), T(-1.0), T(-1.0), T(-1.0), T(-1.0)};
+    // once each time the parameters values change.
+    // They are thread local since ceres can evaluate
+    // the residuals in several threads
+    thread_local T crx, cry, crz, srx, sry, srz;
+    thread_local T lastWValues[6] = {T(-1.0), T(-1.0), T(-1.0), T(-1.0), T(-1.0), T(-1.0)};
     if ((w[0] != lastWValues[0]) || (w[1] != lastWValues[1]) || (w[2] != lastWValues[2]) ||
         (w[3] != lastWValues[3]) || (w[4] != lastWValues[4]) || (w[5] != lastWValues[5]))
     {
@@ -114,6 +120,88 @@ private:
   double lambda;
 };
 
+/**
+* \class MahalanobisDistanceAffineIsometryAnalyticResidual
+* \brief Same cost function as MahalanobisDistanceAffineIsometryResidual, with
+*        its jacobian computed analytically rather than by automatic
+*        differentiation, which is faster on the many residuals of a registration
+*/
+//-----------------------------------------------------------------------------
+class MahalanobisDistanceAffineIsometryAnalyticResidual : public ceres::SizedCostFunction<1, 6>
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  MahalanobisDistanceAffineIsometryAnalyticResidual(const Eigen::Matrix3d& argA,
+                                                    const Eigen::Vector3d& argC,
+                                                    const Eigen::Vector3d& argX,
+                                                    double argLambda)
+    : A(argA), C(argC), X(argX), lambda(argLambda) {}
+
+  bool Evaluate(double const* const* w, double* residuals, double** jacobians) const override
+  {
+    Compute(this->A, this->C, this->X, this->lambda, w[0], residuals[0],
+            (jacobians && jacobians[0]) ? jacobians[0] : nullptr);
+    return true;
+  }
+
+  // Residual and, if jacobian is not null, its derivatives with respect to the
+  // 6 parameters w = (rx, ry, rz, tx, ty, tz) of the isometry
+  static void Compute(const Eigen::Matrix3d& A, const Eigen::Vector3d& C, const Eigen::Vector3d& X,
+                      double lambda, const double* w, double& residual, double* jacobian)
+  {
+    const double crx = std::cos(w[0]), srx = std::sin(w[0]);
+    const double cry = std::cos(w[1]), sry = std::sin(w[1]);
+    const double crz = std::cos(w[2]), srz = std::sin(w[2]);
+
+    // R = Rz * Ry * Rx and its derivatives with respect to the 3 angles
+    Eigen::Matrix3d Rx, Ry, Rz, dRx, dRy, dRz;
+    Rx << 1, 0, 0, 0, crx, -srx, 0, srx, crx;
+    Ry << cry, 0, sry, 0, 1, 0, -sry, 0, cry;
+    Rz << crz, -srz, 0, srz, crz, 0, 0, 0, 1;
+    dRx << 0, 0, 0, 0, -srx, -crx, 0, crx, -srx;
+    dRy << -sry, 0, cry, 0, 0, 0, -cry, 0, -sry;
+    dRz << -srz, -crz, 0, crz, -srz, 0, 0, 0, 0;
+
+    const Eigen::Vector3d RxX = Rx * X;
+    const Eigen::Vector3d RyRxX = Ry * RxX;
+    const Eigen::Vector3d Y = Rz * RyRxX + Eigen::Vector3d(w[3], w[4], w[5]) - C;
+    const Eigen::Vector3d AY = A * Y;
+    const double squaredResidual = lambda * Y.dot(AY);
+
+    // same cut as the automatic differentiation one, where
+    // the derivative of the square root is not defined
+    if (squaredResidual < 1e-6)
+    {
+      residual = 0;
+      if (jacobian)
+      {
+        std::fill(jacobian, jacobian + 6, 0.0);
+      }
+      return;
+    }
+    residual = std::sqrt(squaredResidual);
+
+    if (jacobian)
+    {
+      // d(sqrt(lambda * Yt * A * Y)) = lambda * Yt * (A + At) * dY / (2 * residual)
+      const Eigen::Vector3d G = lambda * (AY + A.transpose() * Y) / (2.0 * residual);
+      jacobian[0] = G.dot(Rz * (Ry * (dRx * X)));
+      jacobian[1] = G.dot(Rz * (dRy * RxX));
+      jacobian[2] = G.dot(dRz * RyRxX);
+      jacobian[3] = G(0);
+      jacobian[4] = G(1);
+      jacobian[5] = G(2);
+    }
+  }
+
+private:
+  Eigen::Matrix3d A;
+  Eigen::Vector3d C;
+  Eigen::Vector3d X;
+  double lambda;
+};
+
 /**
 * \class MahalanobisDistanceLinearDistortionResidual
 * \brief Cost function to minimize to estimate the rotation R1 and translation T1 so that:
@@ -706,6 +794,33 @@ private:
   Eigen::Vector3d X, Y;
 };
 
+/**
+* \class EuclideanDistanceAffineIsometryAnalyticResidual
+* \brief Same cost function as EuclideanDistanceAffineIsometryResidual, with
+*        its jacobian computed analytically
+*/
+//-----------------------------------------------------------------------------
+class EuclideanDistanceAffineIsometryAnalyticResidual : public ceres::SizedCostFunction<1, 6>
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  EuclideanDistanceAffineIsometryAnalyticResidual(const Eigen::Vector3d& argX, const Eigen::Vector3d& argY)
+    : X(argX), Y(argY) {}
+
+  bool Evaluate(double const* const* w, double* residuals, double** jacobians) const override
+  {
+    // the euclidean distance is the mahalanobis one of the identity
+    MahalanobisDistanceAffineIsometryAnalyticResidual::Compute(Eigen::Matrix3d::Identity(), this->Y, this->X, 1.0,
+                                                               w[0], residuals[0],
+                                                               (jacobians && jacobians[0]) ? jacobians[0] : nullptr);
+    return true;
+  }
+
+private:
+  Eigen::Vector3d X, Y;
+};
+
 /**
 * \class SimilitudeResidual
 * \brief Cost function to minimize to estimate the rotation, translation and scale
@@ -0,0 +1,99 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+#ifndef GRID_DBSCAN_H
+#define GRID_DBSCAN_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Variant of DBSCAN for 3D point clouds stored in a flat buffer, which
+ * does not materialize the neighborhood of each point.
+ *
+ * The points are sorted into a grid of cells of size epsilon, so that the
+ * neighbors of a point lie in the 27 cells around its own. The core points
+ * are detected in parallel, stopping the count of the neighbors as soon as
+ * minPts is reached, then the clusters are built by merging each core point
+ * with its core neighbors in a concurrent union-find. A border point joins
+ * the cluster of one of its core neighbors.
+ *
+ * The labels are the same as DBSCAN: 0 for the noise and clusters numbered
+ * from 1 in the order of their first point, a point counting as one of its
+ * own neighbors. Unlike DBSCAN, which compares epsilon to squared distances,
+ * epsilon is a distance here.
+ */
+template<class T>
+class GridDBSCAN
+{
+public:
+  GridDBSCAN(double epsilon, int minPts, unsigned int nbThreads = 0)
+    : _epsilon(epsilon), _minPts(minPts), _nbThreads(nbThreads) {}
+
+  /**
+   * @brief run the clustering of the nbPoints points given as consecutive
+   * x, y, z coordinates and return the label of each point
+   */
+  std::vector<int> fit(const T* points, int nbPoints);
+
+  void setEpsilon(double value) { _epsilon = value; }
+  void setMinPts(int value) { _minPts = value; }
+  //! number of threads, 0 to use all the cores
+  void setNbThreads(unsigned int value) { _nbThreads = value; }
+  int getNbCluster() { return _nbCluster; }
+
+private:
+  //! sort the points into the grid
+  void buildGrid(const T* points, int nbPoints);
+
+  //! number of points, or cells, processed in a row by a thread
+  static constexpr size_t _chunkSize = 1024;
+
+  //! call f(j) for each neighbor j of the sorted point i, until f returns false
+  template<typename F>
+  void forEachNeighbor(int i, const F& f) const;
+
+  int findRoot(int i);
+  void merge(int i, int j);
+
+  enum LABEL {
+    NOISE = 0
+  };
+
+  // points sorted by cell, as consecutive x, y, z coordinates
+  std::vector<double> _sortedPoints;
+  // index in the input of each sorted point
+  std::vector<int> _order;
+  // cell of each sorted point
+  std::vector<int> _cellOf;
+  // first sorted point of each cell, followed by the number of points
+  std::vector<int> _cellStart;
+  // the 27 cells around each cell, -1 for the empty ones
+  std::vector<int> _cellNeighbors;
+  // union-find forest over the sorted points
+  std::vector<std::atomic<int>> _parent;
+
+  int _nbCluster = 0;
+  double _epsilon;
+  int _minPts;
+  unsigned int _nbThreads;
+};
+
+
+#include "GridDBSCAN.txx"
+#endif // GRID_DBSCAN_H
@@ -0,0 +1,275 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+#include "GridDBSCAN.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+
+//-----------------------------------------------------------------------------
+template<class T>
+std::vector<int> GridDBSCAN<T>::fit(const T* points, int nbPoints)
+{
+  _nbCluster = 0;
+  std::vector<int> label(nbPoints, LABEL::NOISE);
+  if (nbPoints == 0 || !(_epsilon > 0.0))
+  {
+    return label;
+  }
+  buildGrid(points, nbPoints);
+
+  // detect the core points
+  std::vector<char> isCore(nbPoints, 0);
+  const double sqEpsilon = _epsilon * _epsilon;
+  Parallel::ForEachChunk(nbPoints, _chunkSize, _nbThreads, [&](unsigned int, int begin, int end)
+  {
+    for (int i = begin; i < end; ++i)
+    {
+      const double* p = &_sortedPoints[3 * i];
+      int nbNeighbors = 0;
+      forEachNeighbor(i, [&](int j)
+      {
+        const double* q = &_sortedPoints[3 * j];
+        const double dx = p[0] - q[0], dy = p[1] - q[1], dz = p[2] - q[2];
+        nbNeighbors += dx * dx + dy * dy + dz * dz <= sqEpsilon;
+        return nbNeighbors < _minPts;
+      });
+      isCore[i] = nbNeighbors >= _minPts;
+    }
+  });
+
+  // merge the core points with their core neighbors, and attach each border
+  // point to one of its core neighbors
+  std::vector<int> coreNeighbor(nbPoints, -1);
+  Parallel::ForEachChunk(nbPoints, _chunkSize, _nbThreads, [&](unsigned int, int begin, int end)
+  {
+    for (int i = begin; i < end; ++i)
+    {
+      const double* p = &_sortedPoints[3 * i];
+      const bool core = isCore[i];
+      forEachNeighbor(i, [&](int j)
+      {
+        // each pair of core points is merged once
+        if (!isCore[j] || (core && j >= i))
+        {
+          return true;
+        }
+        const double* q = &_sortedPoints[3 * j];
+        const double dx = p[0] - q[0], dy = p[1] - q[1], dz = p[2] - q[2];
+        if (dx * dx + dy * dy + dz * dz > sqEpsilon)
+        {
+          return true;
+        }
+        if (!core)
+        {
+          coreNeighbor[i] = j;
+          return false;
+        }
+        merge(i, j);
+        return true;
+      });
+    }
+  });
+
+  // number the clusters in the order of their first point
+  std::vector<int> clusterOfRoot(nbPoints, 0);
+  std::vector<int> rank(nbPoints);
+  for (int i = 0; i < nbPoints; ++i)
+  {
+    rank[_order[i]] = i;
+  }
+  for (int k = 0; k < nbPoints; ++k)
+  {
+    const int i = rank[k];
+    const int core = isCore[i] ? i : coreNeighbor[i];
+    if (core < 0)
+    {
+      continue;
+    }
+    int& cluster = clusterOfRoot[findRoot(core)];
+    if (cluster == 0)
+    {
+      cluster = ++_nbCluster;
+    }
+    label[k] = cluster;
+  }
+  return label;
+}
+
+//-----------------------------------------------------------------------------
+template<class T>
+void GridDBSCAN<T>::buildGrid(const T* points, int nbPoints)
+{
+  double minBound[3], maxBound[3];
+  for (int k = 0; k < 3; ++k)
+  {
+    minBound[k] = maxBound[k] = static_cast<double>(points[k]);
+  }
+  for (int i = 1; i < nbPoints; ++i)
+  {
+    for (int k = 0; k < 3; ++k)
+    {
+      minBound[k] = std::min(minBound[k], static_cast<double>(points[3 * i + k]));
+      maxBound[k] = std::max(maxBound[k], static_cast<double>(points[3 * i + k]));
+    }
+  }
+  int64_t dims[3];
+  for (int k = 0; k < 3; ++k)
+  {
+    dims[k] = static_cast<int64_t>((maxBound[k] - minBound[k]) / _epsilon) + 1;
+  }
+
+  // sort the points by cell
+  auto cellCoordinate = [&](int i, int k)
+  {
+    return static_cast<int64_t>((points[3 * i + k] - minBound[k]) / _epsilon);
+  };
+  std::vector<std::pair<int64_t, int> > keys(nbPoints);
+  Parallel::ForEachChunk(nbPoints, _chunkSize, _nbThreads, [&](unsigned int, int begin, int end)
+  {
+    for (int i = begin; i < end; ++i)
+    {
+      keys[i].first = cellCoordinate(i, 0) + dims[0] * (cellCoordinate(i, 1) + dims[1] * cellCoordinate(i, 2));
+      keys[i].second = i;
+    }
+  });
+  std::sort(keys.begin(), keys.end());
+
+  _sortedPoints.resize(3 * nbPoints);
+  _order.resize(nbPoints);
+  _cellOf.resize(nbPoints);
+  _cellStart.clear();
+  std::vector<int64_t> cellKeys;
+  for (int i = 0; i < nbPoints; ++i)
+  {
+    if (i == 0 || keys[i].first != keys[i - 1].first)
+    {
+      cellKeys.push_back(keys[i].first);
+      _cellStart.push_back(i);
+    }
+    _order[i] = keys[i].second;
+    _cellOf[i] = static_cast<int>(cellKeys.size()) - 1;
+    for (int k = 0; k < 3; ++k)
+    {
+      _sortedPoints[3 * i + k] = static_cast<double>(points[3 * keys[i].second + k]);
+    }
+  }
+  const int nbCells = static_cast<int>(cellKeys.size());
+  _cellStart.push_back(nbPoints);
+
+  // find the non empty cells around each cell
+  _cellNeighbors.assign(27 * nbCells, -1);
+  Parallel::ForEachChunk(nbCells, _chunkSize, _nbThreads, [&](unsigned int, int begin, int end)
+  {
+    for (int c = begin; c < end; ++c)
+    {
+      const int64_t x = cellKeys[c] % dims[0];
+      const int64_t y = (cellKeys[c] / dims[0]) % dims[1];
+      const int64_t z = cellKeys[c] / (dims[0] * dims[1]);
+      int n = 0;
+      for (int64_t dz = -1; dz <= 1; ++dz)
+      {
+        for (int64_t dy = -1; dy <= 1; ++dy)
+        {
+          for (int64_t dx = -1; dx <= 1; ++dx)
+          {
+            if (x + dx < 0 || x + dx >= dims[0] || y + dy < 0 || y + dy >= dims[1] ||
+                z + dz < 0 || z + dz >= dims[2])
+            {
+              continue;
+            }
+            const int64_t key = x + dx + dims[0] * (y + dy + dims[1] * (z + dz));
+            auto it = std::lower_bound(cellKeys.begin(), cellKeys.end(), key);
+            if (it != cellKeys.end() && *it == key)
+            {
+              _cellNeighbors[27 * c + n++] = static_cast<int>(it - cellKeys.begin());
+            }
+          }
+        }
+      }
+    }
+  });
+
+  // each point is its own cluster
+  _parent = std::vector<std::atomic<int> >(nbPoints);
+  for (int i = 0; i < nbPoints; ++i)
+  {
+    _parent[i].store(i, std::memory_order_relaxed);
+  }
+}
+
+//-----------------------------------------------------------------------------
+template<class T>
+template<typename F>
+void GridDBSCAN<T>::forEachNeighbor(int i, const F& f) const
+{
+  const int* neighborCells = &_cellNeighbors[27 * _cellOf[i]];
+  for (int n = 0; n < 27 && neighborCells[n] >= 0; ++n)
+  {
+    for (int j = _cellStart[neighborCells[n]]; j < _cellStart[neighborCells[n] + 1]; ++j)
+    {
+      if (!f(j))
+      {
+        return;
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+template<class T>
+int GridDBSCAN<T>::findRoot(int i)
+{
+  int parent = _parent[i].load();
+  while (parent != i)
+  {
+    // path halving, which another thread may do at the same time
+    const int grandParent = _parent[parent].load();
+    _parent[i].compare_exchange_weak(parent, grandParent);
+    i = grandParent;
+    parent = _parent[i].load();
+  }
+  return i;
+}
+
+//-----------------------------------------------------------------------------
+template<class T>
+void GridDBSCAN<T>::merge(int i, int j)
+{
+  while (true)
+  {
+    i = findRoot(i);
+    j = findRoot(j);
+    if (i == j)
+    {
+      return;
+    }
+    // the root with the larger index is linked under the other one, which
+    // only succeeds if it is still a root
+    if (i < j)
+    {
+      std::swap(i, j);
+    }
+    int expected = i;
+    if (_parent[i].compare_exchange_strong(expected, j))
+    {
+      return;
+    }
+  }
+}
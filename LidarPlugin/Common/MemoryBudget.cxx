@@ -0,0 +1,225 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "MemoryBudget.h"
+
+// STD
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+//! Minimal delay between two reads of the memory available on the system
+const std::chrono::milliseconds AvailableMemoryPeriod(500);
+
+//! Part of the physical memory that the caches leave available to the system
+const unsigned long SystemReserveRatio = 10;
+}
+
+//-----------------------------------------------------------------------------
+MemoryBudget::MemoryBudget()
+{
+  this->SetLimit(0);
+}
+
+//-----------------------------------------------------------------------------
+MemoryBudget& MemoryBudget::GetInstance()
+{
+  static MemoryBudget budget;
+  return budget;
+}
+
+//-----------------------------------------------------------------------------
+void MemoryBudget::Register(Consumer* consumer, const std::string& name, int priority)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  Registration registration = { consumer, name, priority, 0 };
+  auto position = std::upper_bound(this->Consumers.begin(), this->Consumers.end(), priority,
+    [](int value, const Registration& other) { return value < other.Priority; });
+  this->Consumers.insert(position, registration);
+}
+
+//-----------------------------------------------------------------------------
+void MemoryBudget::Unregister(Consumer* consumer)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Consumers.erase(std::remove_if(this->Consumers.begin(), this->Consumers.end(),
+    [consumer](const Registration& registration) { return registration.Instance == consumer; }),
+    this->Consumers.end());
+}
+
+//-----------------------------------------------------------------------------
+unsigned long MemoryBudget::Report(Consumer* consumer, unsigned long size)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  unsigned long total = 0;
+  bool isRegistered = false;
+  for (Registration& registration : this->Consumers)
+  {
+    if (registration.Instance == consumer)
+    {
+      registration.Size = size;
+      isRegistered = true;
+    }
+    total += registration.Size;
+  }
+  const unsigned long limit = this->GetEffectiveLimit(total);
+  if (!isRegistered || total <= limit)
+  {
+    return 0;
+  }
+
+  // the caller cannot be asked to release memory while it reports, it is told
+  // how much it must release when its turn comes
+  unsigned long excess = total - limit;
+  unsigned long callerExcess = 0;
+  for (Registration& registration : this->Consumers)
+  {
+    if (excess == 0)
+    {
+      break;
+    }
+    unsigned long released = 0;
+    if (registration.Instance == consumer)
+    {
+      released = callerExcess = std::min(excess, registration.Size);
+    }
+    else if (registration.Size > 0)
+    {
+      released = std::min(registration.Instance->ReleaseMemory(excess), registration.Size);
+      registration.Size -= released;
+    }
+    excess -= std::min(excess, released);
+  }
+  return callerExcess;
+}
+
+//-----------------------------------------------------------------------------
+void MemoryBudget::SetLimit(unsigned long limit)
+{
+  const unsigned long physicalMemory = GetPhysicalMemory();
+  if (limit == 0)
+  {
+    // 4 GiB if the physical memory is unknown
+    limit = physicalMemory > 0 ? physicalMemory / 2 : 4ul << 20;
+  }
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Limit = limit;
+}
+
+//-----------------------------------------------------------------------------
+unsigned long MemoryBudget::GetLimit()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->Limit;
+}
+
+//-----------------------------------------------------------------------------
+unsigned long MemoryBudget::GetSize()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  unsigned long total = 0;
+  for (const Registration& registration : this->Consumers)
+  {
+    total += registration.Size;
+  }
+  return total;
+}
+
+//-----------------------------------------------------------------------------
+std::string MemoryBudget::GetSummary()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  std::stringstream summary;
+  for (const Registration& registration : this->Consumers)
+  {
+    summary << registration.Name << ": " << registration.Size / 1024 << " MiB\n";
+  }
+  summary << "Limit: " << this->Limit / 1024 << " MiB";
+  return summary.str();
+}
+
+//-----------------------------------------------------------------------------
+unsigned long MemoryBudget::GetEffectiveLimit(unsigned long total)
+{
+  const auto now = std::chrono::steady_clock::now();
+  if (now - this->AvailableMemoryTime > AvailableMemoryPeriod)
+  {
+    this->AvailableMemory = GetAvailableMemory();
+    this->AvailableMemoryTime = now;
+  }
+  if (this->AvailableMemory == 0)
+  {
+    return this->Limit;
+  }
+
+  // the memory of the consumers is part of the memory used, they can
+  // only grow while the system keeps its reserve
+  const unsigned long reserve = GetPhysicalMemory() / SystemReserveRatio;
+  const unsigned long systemLimit =
+    (total + this->AvailableMemory > reserve) ? total + this->AvailableMemory - reserve : 0;
+  return std::min(this->Limit, systemLimit);
+}
+
+//-----------------------------------------------------------------------------
+unsigned long MemoryBudget::GetPhysicalMemory()
+{
+#ifdef _WIN32
+  MEMORYSTATUSEX status;
+  status.dwLength = sizeof(status);
+  return GlobalMemoryStatusEx(&status) ? static_cast<unsigned long>(status.ullTotalPhys >> 10) : 0;
+#else
+  const long pages = sysconf(_SC_PHYS_PAGES);
+  const long pageSize = sysconf(_SC_PAGESIZE);
+  return (pages > 0 && pageSize > 0) ? static_cast<unsigned long>(pages) * (pageSize >> 10) : 0;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+unsigned long MemoryBudget::GetAvailableMemory()
+{
+#if defined(_WIN32)
+  MEMORYSTATUSEX status;
+  status.dwLength = sizeof(status);
+  return GlobalMemoryStatusEx(&status) ? static_cast<unsigned long>(status.ullAvailPhys >> 10) : 0;
+#elif defined(__linux__)
+  // the estimation of the kernel, which includes the page cache that can be reclaimed
+  std::ifstream meminfo("/proc/meminfo");
+  std::string line;
+  while (std::getline(meminfo, line))
+  {
+    std::istringstream fields(line);
+    std::string key;
+    unsigned long value;
+    if (fields >> key >> value && key == "MemAvailable:")
+    {
+      return value;
+    }
+  }
+  return 0;
+#else
+  return 0;
+#endif
+}
@@ -0,0 +1,131 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * \class MemoryBudget
+ * \brief Memory limit shared by all the caches of the process.
+ *
+ * Each cache has its own limit, but together they could use more memory than the
+ * computer has. The caches register to the budget as a Consumer and report their size
+ * each time it changes. When the total is over the limit, the consumers are asked to
+ * release memory, the lowest priority first: the frames decoded in advance are dropped
+ * before the frames that would be expensive to get again.
+ *
+ * The limit is also lowered when the system is running out of available memory
+ * (Linux only), so that the caches shrink before the system starts swapping.
+ *
+ * The sizes are in kibibytes, like vtkDataObject::GetActualMemorySize.
+ */
+class MemoryBudget
+{
+public:
+  /**
+   * \brief Interface of the caches sharing the budget.
+   */
+  class Consumer
+  {
+  public:
+    virtual ~Consumer() = default;
+
+    /**
+     * @brief ReleaseMemory try to release at least size kibibytes. It is called from
+     * any thread, while the budget is locked and maybe while another consumer holds its
+     * own lock: it must not block (try_lock only) and must not call the budget.
+     * @return the size released
+     */
+    virtual unsigned long ReleaseMemory(unsigned long size) = 0;
+  };
+
+  /**
+   * @brief The Priority enum orders the consumers, the lowest priority releases first
+   */
+  enum Priority
+  {
+    PrefetchedFramesPriority = 0, /*!< lidar frames decoded in advance or already played */
+    CameraFramesPriority = 10,    /*!< decoded camera images */
+  };
+
+  //! The budget of the process
+  static MemoryBudget& GetInstance();
+
+  //! Add a consumer, whose size is 0 until it is reported
+  void Register(Consumer* consumer, const std::string& name, int priority);
+
+  //! Remove a consumer, once it returns ReleaseMemory is not called anymore
+  void Unregister(Consumer* consumer);
+
+  /**
+   * @brief Report give the current size of a consumer. If the total is over the limit,
+   * the consumers are asked to release memory, the lowest priority first.
+   * Must not be called while the consumer holds the lock used by its ReleaseMemory.
+   * @return the size the caller must release itself, if its turn came. It should then
+   * release it, and report its new size.
+   */
+  unsigned long Report(Consumer* consumer, unsigned long size);
+
+  /**
+   * @brief SetLimit set the maximum size of all the consumers
+   * @param limit in kibibytes, 0 for the default limit (half of the physical memory)
+   */
+  void SetLimit(unsigned long limit);
+  unsigned long GetLimit();
+
+  //! Total size of the consumers
+  unsigned long GetSize();
+
+  //! Size of each consumer, formatted on one line per consumer
+  std::string GetSummary();
+
+  //! Physical memory of the computer, 0 if unknown
+  static unsigned long GetPhysicalMemory();
+
+  //! Memory available for new allocations without swapping, 0 if unknown
+  static unsigned long GetAvailableMemory();
+
+private:
+  MemoryBudget();
+
+  //! Limit lowered to what is available on the system, the budget must be locked
+  unsigned long GetEffectiveLimit(unsigned long total);
+
+  struct Registration
+  {
+    Consumer* Instance;
+    std::string Name;
+    int Priority;
+    unsigned long Size;
+  };
+
+  std::mutex Mutex;
+  //! Sorted by priority, the lowest first
+  std::vector<Registration> Consumers;
+  unsigned long Limit = 0;
+
+  //! Memory available on the system, read at most every AvailableMemoryPeriod
+  unsigned long AvailableMemory = 0;
+  std::chrono::steady_clock::time_point AvailableMemoryTime;
+};
+
+#endif // MEMORYBUDGET_H
@@ -27,10 +27,14 @@
 // BOOST
 #include <boost/shared_ptr.hpp>
 
+// STD
+#include <vector>
+
 // NANOFLANN
 #include <nanoflann.hpp>
 
 #include <LidarPoint.h>
+#include "ParallelFor.h"
 
 class KDTreePCLAdaptor
 {
@@ -49,7 +53,7 @@ public:
     Index->buildIndex();
   }
 
-  ~KDTreePCLAdaptor()
+  virtual ~KDTreePCLAdaptor()
   {
       delete Index;
   }
@@ -59,7 +63,7 @@ public:
     *  The user can also call index->... methods as desired.
     * \note nChecks_IGNORED is ignored but kept for compatibility with the original FLANN interface.
     */
-  inline void query(const Point& query_point, int knearest, int* out_indices, double* out_distances_sq/*, const int nChecks_IGNORED = 10*/) const
+  virtual void query(const Point& query_point, int knearest, int* out_indices, double* out_distances_sq/*, const int nChecks_IGNORED = 10*/) const
   {
     double pt[3] = {query_point.x, query_point.y, query_point.z};
     nanoflann::KNNResultSet<double, int> resultSet(knearest);
@@ -67,6 +71,31 @@ public:
     this->Index->findNeighbors(resultSet, pt, nanoflann::SearchParams());
   }
 
+  /** Query the \a knearest closest points of each query point at once, the
+    * results of the i-th query point being stored from i * knearest. Missing
+    * neighbors are given the index -1.
+    * The search structures which answer many queries faster together, for
+    * example on an accelerator, override it. By default the queries are
+    * split in chunks taken in turn by \a numberOfThreads threads.
+    */
+  virtual void batchQuery(const std::vector<Point>& queries, int knearest, std::vector<int>& out_indices,
+                          std::vector<double>& out_distances_sq, unsigned int numberOfThreads = 1) const
+  {
+    // Chunks smaller than this are not worth to be queried by another thread
+    const size_t chunkSize = 64;
+
+    out_indices.assign(queries.size() * knearest, -1);
+    out_distances_sq.assign(queries.size() * knearest, -1.0);
+    Parallel::ForEachChunk(queries.size(), chunkSize, numberOfThreads,
+                           [&](unsigned int, size_t begin, size_t end)
+    {
+      for (size_t i = begin; i < end; ++i)
+      {
+        this->query(queries[i], knearest, &out_indices[i * knearest], &out_distances_sq[i * knearest]);
+      }
+    });
+  }
+
   const KDTreePCLAdaptor & derived() const
   {
     return *this;
@@ -96,11 +125,18 @@ public:
     }
   }
 
+  // The indices returned by query are indices of the points of this cloud
   pcl::PointCloud<Point>::Ptr getInputCloud()
   {
     return this->Cloud;
   }
 
+  // Number of points which can be returned by query
+  virtual int GetNumberOfPoints() const
+  {
+    return this->Cloud->size();
+  }
+
   // Optional bounding-box computation: return false to default to a standard bbox computation loop.
   //   Return true if the BBOX was already computed by the class and returned in "bb" so it can be avoided to redo it again.
   //   Look at bb.size() to find out the expected dimensionality (e.g. 2 or 3 for point clouds)
@@ -116,6 +152,13 @@ public:
   //! the inputed data
   pcl::PointCloud<Point>::Ptr Cloud;
 protected:
+  // To be used by the derived classes which implement
+  // query with their own structure instead of the kd-tree
+  KDTreePCLAdaptor()
+    : Index(nullptr)
+    , Cloud(new pcl::PointCloud<Point>)
+  {
+  }
 
 };
 
@@ -0,0 +1,208 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "ChunkedFile.h"
+
+// STD
+#include <algorithm>
+#include <cstring>
+
+// BOOST
+#include <boost/thread.hpp>
+
+//-----------------------------------------------------------------------------
+ChunkedFile::ChunkedFile() = default;
+
+//-----------------------------------------------------------------------------
+ChunkedFile::~ChunkedFile()
+{
+  this->StopPrefetching();
+}
+
+//-----------------------------------------------------------------------------
+void ChunkedFile::StartPrefetching(int numberOfThreads)
+{
+  this->StopPrefetching();
+  this->Stop = false;
+  this->RequestedChunkIndex = 0;
+  for (int i = 0; i < numberOfThreads; ++i)
+  {
+    this->PrefetchThreads.emplace_back(new boost::thread(&ChunkedFile::Prefetch, this));
+  }
+}
+
+//-----------------------------------------------------------------------------
+void ChunkedFile::StopPrefetching()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Stop = true;
+  }
+  this->Condition.notify_all();
+  for (auto& thread : this->PrefetchThreads)
+  {
+    thread->join();
+  }
+  this->PrefetchThreads.clear();
+  this->Chunks.clear();
+  this->ChunksInProgress.clear();
+  this->CurrentChunk.reset();
+}
+
+//-----------------------------------------------------------------------------
+void ChunkedFile::SetNumberOfChunksToPrefetch(int number)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->NumberOfChunksToPrefetch = std::max(0, number);
+  }
+  this->Condition.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+const unsigned char* ChunkedFile::GetBytes(int64_t offset, size_t length)
+{
+  const size_t numberOfChunks = this->GetNumberOfChunks();
+  if (numberOfChunks == 0 || offset < 0 || offset + static_cast<int64_t>(length) > this->Size)
+  {
+    return nullptr;
+  }
+
+  // chunk containing the first byte
+  size_t first = 0, last = numberOfChunks;
+  while (last - first > 1)
+  {
+    const size_t middle = (first + last) / 2;
+    (this->GetChunkOffset(middle) <= offset ? first : last) = middle;
+  }
+  size_t chunkIndex = first;
+  if (!this->CurrentChunk || this->CurrentChunkIndex != chunkIndex)
+  {
+    this->CurrentChunk = this->GetChunk(chunkIndex);
+    this->CurrentChunkIndex = chunkIndex;
+    if (!this->CurrentChunk)
+    {
+      return nullptr;
+    }
+  }
+
+  int64_t chunkOffset = offset - this->GetChunkOffset(chunkIndex);
+  if (chunkOffset + static_cast<int64_t>(length) <= static_cast<int64_t>(this->CurrentChunk->size()))
+  {
+    return this->CurrentChunk->data() + chunkOffset;
+  }
+
+  // the bytes span several chunks
+  this->Buffer.resize(length);
+  size_t copied = 0;
+  Chunk chunk = this->CurrentChunk;
+  while (true)
+  {
+    const size_t count = std::min(length - copied, static_cast<size_t>(chunk->size() - chunkOffset));
+    std::memcpy(this->Buffer.data() + copied, chunk->data() + chunkOffset, count);
+    copied += count;
+    if (copied == length)
+    {
+      break;
+    }
+    chunk = this->GetChunk(++chunkIndex);
+    chunkOffset = 0;
+    if (!chunk)
+    {
+      return nullptr;
+    }
+  }
+  return this->Buffer.data();
+}
+
+//-----------------------------------------------------------------------------
+ChunkedFile::Chunk ChunkedFile::GetChunk(size_t chunkIndex)
+{
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  if (this->RequestedChunkIndex != chunkIndex)
+  {
+    this->RequestedChunkIndex = chunkIndex;
+    // only keep the chunks which may be read next
+    const size_t last = chunkIndex + this->NumberOfChunksToPrefetch;
+    for (auto it = this->Chunks.begin(); it != this->Chunks.end();)
+    {
+      it = it->first < chunkIndex || it->first > last ? this->Chunks.erase(it) : std::next(it);
+    }
+    this->Condition.notify_all();
+  }
+
+  // wait for the prefetching thread if it is loading the chunk
+  this->Condition.wait(lock, [&]() { return !this->ChunksInProgress.count(chunkIndex); });
+  auto cached = this->Chunks.find(chunkIndex);
+  if (cached != this->Chunks.end())
+  {
+    return cached->second;
+  }
+
+  this->ChunksInProgress.insert(chunkIndex);
+  lock.unlock();
+  Chunk chunk = this->LoadChunk(chunkIndex);
+  lock.lock();
+  this->ChunksInProgress.erase(chunkIndex);
+  this->Chunks[chunkIndex] = chunk;
+  this->Condition.notify_all();
+  return chunk;
+}
+
+//-----------------------------------------------------------------------------
+void ChunkedFile::Prefetch()
+{
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  const size_t numberOfChunks = this->GetNumberOfChunks();
+  while (true)
+  {
+    // first chunk after the requested one which is neither loaded nor in progress
+    size_t toLoad = 0;
+    auto findChunk = [&]()
+    {
+      for (int i = 1; i <= this->NumberOfChunksToPrefetch; ++i)
+      {
+        const size_t chunkIndex = this->RequestedChunkIndex + i;
+        if (chunkIndex < numberOfChunks && !this->Chunks.count(chunkIndex)
+            && !this->ChunksInProgress.count(chunkIndex))
+        {
+          toLoad = chunkIndex;
+          return true;
+        }
+      }
+      return false;
+    };
+    this->Condition.wait(lock, [&]() { return this->Stop || findChunk(); });
+    if (this->Stop)
+    {
+      return;
+    }
+
+    this->ChunksInProgress.insert(toLoad);
+    lock.unlock();
+    Chunk chunk = this->LoadChunk(toLoad);
+    lock.lock();
+    this->ChunksInProgress.erase(toLoad);
+    // the reading may have moved elsewhere meanwhile
+    if (toLoad >= this->RequestedChunkIndex
+        && toLoad <= this->RequestedChunkIndex + this->NumberOfChunksToPrefetch)
+    {
+      this->Chunks[toLoad] = chunk;
+    }
+    this->Condition.notify_all();
+  }
+}
@@ -0,0 +1,107 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef CHUNKEDFILE_H
+#define CHUNKEDFILE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace boost
+{
+class thread;
+}
+
+/**
+ * \class ChunkedFile
+ * \brief Random access to the bytes of a file which can only be loaded by chunks, like
+ *        a compressed or a remote file, the chunks following the one being read being
+ *        loaded in advance by background threads.
+ *
+ * The subclasses describe the chunks and how to load them, then call StartPrefetching
+ * once they are known, and StopPrefetching before releasing anything LoadChunk uses.
+ */
+class ChunkedFile
+{
+public:
+  ChunkedFile();
+  virtual ~ChunkedFile();
+
+  const std::string& GetLastError() const { return this->LastError; }
+
+  //! Size of the content
+  int64_t GetSize() const { return this->Size; }
+
+  /**
+   * @brief Bytes [offset, offset + length[ of the content, which stay valid until the
+   * next call
+   * @return nullptr if they are out of the file or can not be loaded
+   */
+  const unsigned char* GetBytes(int64_t offset, size_t length);
+
+  //! Number of chunks loaded in advance after the one being read, 0 to disable it
+  void SetNumberOfChunksToPrefetch(int number);
+
+protected:
+  typedef std::shared_ptr<const std::vector<unsigned char> > Chunk;
+
+  //! Number of chunks and offset of the first byte of each one
+  virtual size_t GetNumberOfChunks() const = 0;
+  virtual int64_t GetChunkOffset(size_t chunkIndex) const = 0;
+
+  //! Load a chunk, nullptr on failure. Called from any thread
+  virtual Chunk LoadChunk(size_t chunkIndex) = 0;
+
+  //! Start the threads loading the chunks in advance, once the chunks are known
+  void StartPrefetching(int numberOfThreads);
+
+  //! Stop the threads and forget the loaded chunks
+  void StopPrefetching();
+
+  std::string LastError;
+  int64_t Size = 0;
+
+private:
+  //! The chunk, loaded now or by a prefetching thread
+  Chunk GetChunk(size_t chunkIndex);
+
+  //! Loop of the prefetching threads
+  void Prefetch();
+
+  //! Chunk of the last GetBytes, and the bytes spanning several chunks
+  size_t CurrentChunkIndex = 0;
+  Chunk CurrentChunk;
+  std::vector<unsigned char> Buffer;
+
+  //! Loaded chunks, and those being loaded, protected by Mutex
+  std::mutex Mutex;
+  std::condition_variable Condition;
+  std::map<size_t, Chunk> Chunks;
+  std::set<size_t> ChunksInProgress;
+  size_t RequestedChunkIndex = 0;
+  int NumberOfChunksToPrefetch = 2;
+  bool Stop = false;
+  std::vector<std::unique_ptr<boost::thread> > PrefetchThreads;
+};
+
+#endif // CHUNKEDFILE_H
@@ -0,0 +1,513 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "CompressedPcapFile.h"
+
+// STD
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+// BOOST
+#include <boost/filesystem.hpp>
+
+// VTK
+#include <vtk_zlib.h>
+
+namespace
+{
+const char IndexMagic[8] = { 'L', 'V', 'G', 'Z', 'I', 'D', 'X', '\0' };
+const uint32_t IndexVersion = 1;
+const unsigned int WindowSize = 32768;
+const size_t InputBufferSize = 1 << 16;
+// gzip decoding with automatic header detection, and raw deflate decoding
+const int GzipWindowBits = 15 + 32;
+const int RawWindowBits = -15;
+
+//-----------------------------------------------------------------------------
+struct IndexHeader
+{
+  char Magic[8];
+  uint32_t Version;
+  uint32_t Reserved;
+  uint64_t FileSize;
+  int64_t FileModificationTime;
+  int64_t UncompressedSize;
+  uint64_t NumberOfPoints;
+};
+
+//-----------------------------------------------------------------------------
+template<typename T>
+void WriteValue(std::ostream& os, const T& value)
+{
+  os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+//-----------------------------------------------------------------------------
+template<typename T>
+bool ReadValue(std::istream& is, T& value)
+{
+  is.read(reinterpret_cast<char*>(&value), sizeof(T));
+  return is.good();
+}
+
+//-----------------------------------------------------------------------------
+bool GetFileStamp(const std::string& filename, uint64_t& size, int64_t& modificationTime)
+{
+  boost::system::error_code errCode;
+  size = boost::filesystem::file_size(filename, errCode);
+  if (errCode)
+  {
+    return false;
+  }
+  modificationTime = boost::filesystem::last_write_time(filename, errCode);
+  return !errCode;
+}
+
+//-----------------------------------------------------------------------------
+bool SeekFile(std::FILE* file, int64_t offset)
+{
+#ifdef _WIN32
+  return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+  return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// std::FILE closed when leaving the scope
+struct ScopedFile
+{
+  explicit ScopedFile(const std::string& filename) : File(std::fopen(filename.c_str(), "rb")) {}
+  ~ScopedFile()
+  {
+    if (this->File)
+    {
+      std::fclose(this->File);
+    }
+  }
+  std::FILE* File;
+};
+
+//-----------------------------------------------------------------------------
+// z_stream released when leaving the scope
+struct ScopedInflate
+{
+  ScopedInflate() { std::memset(&this->Stream, 0, sizeof(this->Stream)); }
+  ~ScopedInflate()
+  {
+    if (this->Initialized)
+    {
+      inflateEnd(&this->Stream);
+    }
+  }
+  bool Init(int windowBits)
+  {
+    this->Initialized = inflateInit2(&this->Stream, windowBits) == Z_OK;
+    return this->Initialized;
+  }
+  z_stream Stream;
+  bool Initialized = false;
+};
+
+//-----------------------------------------------------------------------------
+// Decompress the whole file once, recording an access point every ChunkSize bytes of
+// output, at the end of a deflate block or at the start of a gzip member
+bool BuildIndex(const std::string& filename, CompressedPcapFile::Index& index, std::string& error)
+{
+  ScopedFile in(filename);
+  ScopedInflate inflater;
+  if (!in.File || !inflater.Init(GzipWindowBits))
+  {
+    error = "could not open " + filename;
+    return false;
+  }
+  z_stream& strm = inflater.Stream;
+
+  std::vector<unsigned char> input(InputBufferSize);
+  std::vector<unsigned char> window(WindowSize);
+  int64_t totalIn = 0, totalOut = 0, lastPoint = 0;
+  index.Points.clear();
+  index.Points.push_back({ 0, 0, 0, true, std::vector<unsigned char>() });
+
+  strm.avail_out = 0;
+  bool memberEnded = false;
+  while (true)
+  {
+    if (strm.avail_in == 0)
+    {
+      strm.avail_in = static_cast<uInt>(std::fread(input.data(), 1, input.size(), in.File));
+      strm.next_in = input.data();
+      if (strm.avail_in == 0)
+      {
+        if (!memberEnded)
+        {
+          error = filename + " is truncated";
+          return false;
+        }
+        break;
+      }
+    }
+
+    if (memberEnded)
+    {
+      // another gzip member follows, anything else is ignored as padding
+      if (strm.next_in[0] != 0x1f)
+      {
+        break;
+      }
+      if (totalOut - lastPoint > CompressedPcapFile::ChunkSize)
+      {
+        index.Points.push_back({ totalOut, totalIn, 0, true, std::vector<unsigned char>() });
+        lastPoint = totalOut;
+      }
+      inflateReset(&strm);
+      memberEnded = false;
+    }
+
+    do
+    {
+      if (strm.avail_out == 0)
+      {
+        strm.avail_out = WindowSize;
+        strm.next_out = window.data();
+      }
+      totalIn += strm.avail_in;
+      totalOut += strm.avail_out;
+      const int ret = inflate(&strm, Z_BLOCK);
+      totalIn -= strm.avail_in;
+      totalOut -= strm.avail_out;
+      if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR)
+      {
+        error = filename + " is not a valid gzip file";
+        return false;
+      }
+      if (ret == Z_STREAM_END)
+      {
+        memberEnded = true;
+        break;
+      }
+
+      // end of a deflate block which is not the last one, the window being the last
+      // output of the circular buffer
+      if ((strm.data_type & 128) && !(strm.data_type & 64)
+          && totalOut - lastPoint > CompressedPcapFile::ChunkSize)
+      {
+        CompressedPcapFile::AccessPoint point;
+        point.Out = totalOut;
+        point.In = totalIn;
+        point.Bits = strm.data_type & 7;
+        point.IsMemberStart = false;
+        point.Window.resize(WindowSize);
+        const unsigned int tail = strm.avail_out;
+        std::memcpy(point.Window.data(), window.data() + WindowSize - tail, tail);
+        std::memcpy(point.Window.data() + tail, window.data(), WindowSize - tail);
+        index.Points.push_back(std::move(point));
+        lastPoint = totalOut;
+      }
+    } while (strm.avail_in != 0);
+  }
+
+  index.Size = totalOut;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool ReadIndex(const std::string& filename, CompressedPcapFile::Index& index)
+{
+  uint64_t fileSize = 0;
+  int64_t modificationTime = 0;
+  if (!GetFileStamp(filename, fileSize, modificationTime))
+  {
+    return false;
+  }
+  std::ifstream is(filename + CompressedPcapFile::IndexExtension, std::ios::binary);
+  if (!is.is_open())
+  {
+    return false;
+  }
+
+  IndexHeader header;
+  if (!ReadValue(is, header)
+      || std::memcmp(header.Magic, IndexMagic, sizeof(IndexMagic)) != 0
+      || header.Version != IndexVersion
+      || header.FileSize != fileSize
+      || header.FileModificationTime != modificationTime
+      || header.NumberOfPoints == 0)
+  {
+    return false;
+  }
+
+  CompressedPcapFile::Index loaded;
+  loaded.Size = header.UncompressedSize;
+  loaded.Points.resize(header.NumberOfPoints);
+  for (auto& point : loaded.Points)
+  {
+    int32_t bits = 0;
+    uint8_t isMemberStart = 0;
+    if (!ReadValue(is, point.Out) || !ReadValue(is, point.In)
+        || !ReadValue(is, bits) || !ReadValue(is, isMemberStart))
+    {
+      return false;
+    }
+    point.Bits = bits;
+    point.IsMemberStart = isMemberStart != 0;
+    if (!point.IsMemberStart)
+    {
+      point.Window.resize(WindowSize);
+      is.read(reinterpret_cast<char*>(point.Window.data()), WindowSize);
+      if (!is.good())
+      {
+        return false;
+      }
+    }
+  }
+  index = std::move(loaded);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool WriteIndex(const std::string& filename, const CompressedPcapFile::Index& index)
+{
+  IndexHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.Magic, IndexMagic, sizeof(IndexMagic));
+  header.Version = IndexVersion;
+  header.UncompressedSize = index.Size;
+  header.NumberOfPoints = index.Points.size();
+  if (!GetFileStamp(filename, header.FileSize, header.FileModificationTime))
+  {
+    return false;
+  }
+
+  const std::string indexFileName = filename + CompressedPcapFile::IndexExtension;
+  const std::string temporaryFileName = indexFileName + ".tmp";
+  {
+    std::ofstream os(temporaryFileName, std::ios::binary | std::ios::trunc);
+    if (!os.is_open())
+    {
+      return false;
+    }
+    WriteValue(os, header);
+    for (const auto& point : index.Points)
+    {
+      WriteValue(os, point.Out);
+      WriteValue(os, point.In);
+      WriteValue(os, static_cast<int32_t>(point.Bits));
+      WriteValue(os, static_cast<uint8_t>(point.IsMemberStart));
+      if (!point.IsMemberStart)
+      {
+        os.write(reinterpret_cast<const char*>(point.Window.data()), WindowSize);
+      }
+    }
+    if (!os.good())
+    {
+      os.close();
+      std::remove(temporaryFileName.c_str());
+      return false;
+    }
+  }
+
+  boost::system::error_code errCode;
+  boost::filesystem::rename(temporaryFileName, indexFileName, errCode);
+  if (errCode)
+  {
+    std::remove(temporaryFileName.c_str());
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Access points of the files opened in the process, shared by all their readers
+std::mutex IndexCacheMutex;
+std::map<std::string, std::pair<int64_t, std::weak_ptr<const CompressedPcapFile::Index> > > IndexCache;
+}
+
+//-----------------------------------------------------------------------------
+const int64_t CompressedPcapFile::ChunkSize;
+const char* const CompressedPcapFile::IndexExtension = ".lvgzindex";
+
+//-----------------------------------------------------------------------------
+bool CompressedPcapFile::IsCompressed(const std::string& filename)
+{
+  ScopedFile in(filename);
+  unsigned char magic[2] = { 0, 0 };
+  return in.File && std::fread(magic, 1, 2, in.File) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
+//-----------------------------------------------------------------------------
+CompressedPcapFile::CompressedPcapFile() = default;
+
+//-----------------------------------------------------------------------------
+CompressedPcapFile::~CompressedPcapFile()
+{
+  this->Close();
+}
+
+//-----------------------------------------------------------------------------
+bool CompressedPcapFile::Open(const std::string& filename, bool useIndexCache)
+{
+  this->Close();
+  this->LastError.clear();
+
+  uint64_t fileSize = 0;
+  int64_t modificationTime = 0;
+  if (!GetFileStamp(filename, fileSize, modificationTime))
+  {
+    this->LastError = "could not open " + filename;
+    return false;
+  }
+
+  // access points already found by another reader of this file
+  const std::string key = boost::filesystem::absolute(filename).string();
+  {
+    std::lock_guard<std::mutex> lock(IndexCacheMutex);
+    auto cached = IndexCache.find(key);
+    if (cached != IndexCache.end() && cached->second.first == modificationTime)
+    {
+      this->Points = cached->second.second.lock();
+    }
+  }
+
+  if (!this->Points)
+  {
+    std::shared_ptr<Index> index = std::make_shared<Index>();
+    if (!ReadIndex(filename, *index))
+    {
+      if (!BuildIndex(filename, *index, this->LastError))
+      {
+        return false;
+      }
+      if (useIndexCache)
+      {
+        WriteIndex(filename, *index);
+      }
+    }
+    this->Points = index;
+    std::lock_guard<std::mutex> lock(IndexCacheMutex);
+    IndexCache[key] = std::make_pair(modificationTime, std::weak_ptr<const Index>(this->Points));
+  }
+
+  this->FileName = filename;
+  this->Size = this->Points->Size;
+  this->StartPrefetching(1);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void CompressedPcapFile::Close()
+{
+  this->StopPrefetching();
+  this->Points.reset();
+  this->FileName.clear();
+  this->Size = 0;
+}
+
+//-----------------------------------------------------------------------------
+size_t CompressedPcapFile::GetNumberOfChunks() const
+{
+  return this->Points ? this->Points->Points.size() : 0;
+}
+
+//-----------------------------------------------------------------------------
+int64_t CompressedPcapFile::GetChunkOffset(size_t chunkIndex) const
+{
+  return this->Points->Points[chunkIndex].Out;
+}
+
+//-----------------------------------------------------------------------------
+CompressedPcapFile::Chunk CompressedPcapFile::LoadChunk(size_t chunkIndex)
+{
+  const std::vector<AccessPoint>& points = this->Points->Points;
+  const AccessPoint& point = points[chunkIndex];
+  const int64_t end = chunkIndex + 1 < points.size() ? points[chunkIndex + 1].Out : this->Points->Size;
+  std::shared_ptr<std::vector<unsigned char> > output =
+    std::make_shared<std::vector<unsigned char> >(static_cast<size_t>(end - point.Out));
+
+  ScopedFile in(this->FileName);
+  ScopedInflate inflater;
+  bool raw = !point.IsMemberStart;
+  if (!in.File || !SeekFile(in.File, point.In - (point.Bits ? 1 : 0))
+      || !inflater.Init(raw ? RawWindowBits : GzipWindowBits))
+  {
+    return nullptr;
+  }
+  z_stream& strm = inflater.Stream;
+
+  // restore the state of the decompressor at the access point
+  if (point.Bits)
+  {
+    const int byte = std::fgetc(in.File);
+    if (byte == EOF || inflatePrime(&strm, point.Bits, byte >> (8 - point.Bits)) != Z_OK)
+    {
+      return nullptr;
+    }
+  }
+  if (raw && inflateSetDictionary(&strm, point.Window.data(), WindowSize) != Z_OK)
+  {
+    return nullptr;
+  }
+
+  std::vector<unsigned char> input(InputBufferSize);
+  auto refill = [&]()
+  {
+    strm.avail_in = static_cast<uInt>(std::fread(input.data(), 1, input.size(), in.File));
+    strm.next_in = input.data();
+    return strm.avail_in != 0;
+  };
+
+  size_t produced = 0;
+  while (produced < output->size())
+  {
+    if (strm.avail_in == 0 && !refill())
+    {
+      return nullptr;
+    }
+    strm.next_out = output->data() + produced;
+    strm.avail_out = static_cast<uInt>(output->size() - produced);
+    const int ret = inflate(&strm, Z_NO_FLUSH);
+    produced = output->size() - strm.avail_out;
+    if (ret == Z_STREAM_END && produced < output->size())
+    {
+      // the raw decoding leaves the gzip trailer of the member to skip
+      for (int trailer = raw ? 8 : 0; trailer > 0;)
+      {
+        if (strm.avail_in == 0 && !refill())
+        {
+          return nullptr;
+        }
+        const uInt skipped = std::min<uInt>(strm.avail_in, trailer);
+        strm.next_in += skipped;
+        strm.avail_in -= skipped;
+        trailer -= skipped;
+      }
+      // continue with the next gzip member
+      raw = false;
+      if (inflateReset2(&strm, GzipWindowBits) != Z_OK)
+      {
+        return nullptr;
+      }
+    }
+    else if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+    {
+      return nullptr;
+    }
+  }
+  return output;
+}
@@ -0,0 +1,102 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef COMPRESSEDPCAPFILE_H
+#define COMPRESSEDPCAPFILE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ChunkedFile.h"
+
+/**
+ * \class CompressedPcapFile
+ * \brief Random access to the uncompressed content of a gzip compressed pcap file,
+ *        without decompressing it on the disk.
+ *
+ * The file is split in chunks of about ChunkSize uncompressed bytes, each one starting
+ * at an access point from which the decompression can restart: the state of the
+ * decompressor at the end of a deflate block, that is its position in bits in the
+ * compressed file and the last 32 kB of output, or the start of a gzip member. The
+ * access points are found by decompressing the whole file once, and are saved in a
+ * sidecar next to the file so that this is only done at its first opening. They are
+ * also shared by all the instances opening the same file in the process.
+ *
+ * The offsets given to GetBytes are the offsets in the uncompressed file, so that the
+ * records can be read as from a memory mapped pcap. A background thread decompresses
+ * the chunks following the one being read, so that a sequential reading does not wait
+ * for the decompression.
+ *
+ * Any gzip file can be read, including the concatenation of several gzip members as
+ * written by bgzip or pigz.
+ */
+class CompressedPcapFile : public ChunkedFile
+{
+public:
+  //! Uncompressed size of the chunks decompressed at once
+  static const int64_t ChunkSize = 4 * 1024 * 1024;
+
+  //! Extension of the sidecar storing the access points
+  static const char* const IndexExtension;
+
+  //! True if the file starts with the gzip magic number
+  static bool IsCompressed(const std::string& filename);
+
+  CompressedPcapFile();
+  ~CompressedPcapFile() override;
+
+  /**
+   * @brief Open a compressed file, loading its access points from its sidecar, or
+   * finding them if the sidecar is missing or out of date
+   * @param useIndexCache save the access points in a sidecar once they have been found
+   */
+  bool Open(const std::string& filename, bool useIndexCache = true);
+  void Close();
+
+  struct AccessPoint
+  {
+    //! Offset in the uncompressed content
+    int64_t Out;
+    //! Offset of the first complete byte in the compressed file
+    int64_t In;
+    //! Number of bits of the byte before In to feed first, 0 to 7
+    int Bits;
+    //! The point is the start of a gzip member, which does not need any window
+    bool IsMemberStart;
+    //! Last 32 kB of output before the point
+    std::vector<unsigned char> Window;
+  };
+
+  struct Index
+  {
+    std::vector<AccessPoint> Points;
+    int64_t Size = 0;
+  };
+
+protected:
+  size_t GetNumberOfChunks() const override;
+  int64_t GetChunkOffset(size_t chunkIndex) const override;
+  Chunk LoadChunk(size_t chunkIndex) override;
+
+private:
+  std::string FileName;
+  std::shared_ptr<const Index> Points;
+};
+
+#endif // COMPRESSEDPCAPFILE_H
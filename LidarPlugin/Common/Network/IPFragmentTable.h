@@ -0,0 +1,240 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef IPFRAGMENTTABLE_H
+#define IPFRAGMENTTABLE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * \class IPFragmentTable
+ * \brief Reassemble the payloads of fragmented IP datagrams, without allocating
+ *        memory per datagram.
+ *
+ * The datagrams being reassembled are stored in a fixed number of slots, each with a
+ * buffer of the maximum size of a datagram allocated the first time the slot is used,
+ * so that a file without fragments costs nothing. The slots are found by open addressing
+ * (linear probing) from a key made of the source address and the identification of
+ * the datagram. A datagram whose last fragment is older than Timeout seconds is evicted
+ * when a slot is needed, and if the table is full the oldest datagram is evicted.
+ *
+ * The fragments are given as the bytes following the IP header, and the offset of the
+ * fragment in the datagram, so that the reassembled datagram has the same layout as
+ * the payload of an unfragmented packet.
+ */
+class IPFragmentTable
+{
+public:
+  //! Maximum size of an IP datagram payload
+  static const unsigned int MaximumDatagramSize = 65535;
+
+  /**
+   * @brief IPFragmentTable allocate the slots of the table
+   * @param capacity number of datagrams reassembled at the same time, rounded up to a power of two
+   * @param timeout time in seconds after which an incomplete datagram can be evicted
+   */
+  explicit IPFragmentTable(size_t capacity = 16, double timeout = 1.0)
+    : Timeout(timeout)
+  {
+    size_t size = 1;
+    while (size < capacity)
+    {
+      size *= 2;
+    }
+    this->Slots.resize(size);
+  }
+
+  /**
+   * @brief AddFragment add a fragment to its datagram
+   * @param key identifies the datagram, see MakeKey
+   * @param offset position of the fragment in the datagram, in bytes
+   * @param moreFragments true if this is not the last fragment of the datagram
+   * @param time time of the fragment, in seconds
+   * @param datagram[out] the reassembled datagram, when it is complete
+   * @param datagramLength[out] its size
+   * @return true if the datagram is complete. It stays valid until Release is called
+   */
+  bool AddFragment(uint64_t key, unsigned int offset, const unsigned char* data, unsigned int length,
+                   bool moreFragments, double time,
+                   const unsigned char*& datagram, unsigned int& datagramLength)
+  {
+    if (offset + length > MaximumDatagramSize)
+    {
+      return false;
+    }
+    Slot* slot = this->Find(key);
+    if (!slot)
+    {
+      slot = this->Insert(key, time);
+    }
+    std::memcpy(slot->Data.data() + offset, data, length);
+    slot->ReceivedSize += length;
+    slot->LastTime = time;
+    if (!moreFragments)
+    {
+      slot->ExpectedSize = offset + length;
+    }
+
+    if (slot->ExpectedSize > 0 && slot->ReceivedSize >= slot->ExpectedSize)
+    {
+      datagram = slot->Data.data();
+      datagramLength = slot->ExpectedSize;
+      return true;
+    }
+    return false;
+  }
+
+  //! Free the slot of a datagram, once its data is not used anymore
+  void Release(uint64_t key)
+  {
+    Slot* slot = this->Find(key);
+    if (slot)
+    {
+      this->Erase(static_cast<size_t>(slot - this->Slots.data()));
+    }
+  }
+
+  //! Drop all the datagrams
+  void Clear()
+  {
+    for (Slot& slot : this->Slots)
+    {
+      slot.IsUsed = false;
+    }
+    this->NumberOfUsedSlots = 0;
+  }
+
+  //! Key of a datagram from the source address (in network order) and the identification
+  static uint64_t MakeKey(const unsigned char sourceIP[4], uint16_t identification)
+  {
+    uint32_t source;
+    std::memcpy(&source, sourceIP, sizeof(source));
+    return (static_cast<uint64_t>(source) << 16) | identification;
+  }
+
+  size_t GetCapacity() const { return this->Slots.size(); }
+
+  //! Number of datagrams being reassembled
+  size_t GetNumberOfPendingDatagrams() const { return this->NumberOfUsedSlots; }
+
+  //! Number of incomplete datagrams dropped to make room for others
+  size_t GetNumberOfEvictedDatagrams() const { return this->NumberOfEvictedDatagrams; }
+
+private:
+  struct Slot
+  {
+    uint64_t Key = 0;
+    bool IsUsed = false;
+    double LastTime = 0;
+    unsigned int ReceivedSize = 0;
+    unsigned int ExpectedSize = 0;
+    std::vector<unsigned char> Data;
+  };
+
+  size_t Home(uint64_t key) const
+  {
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & (this->Slots.size() - 1);
+  }
+
+  Slot* Find(uint64_t key)
+  {
+    const size_t mask = this->Slots.size() - 1;
+    for (size_t i = this->Home(key), probe = 0; probe < this->Slots.size(); i = (i + 1) & mask, ++probe)
+    {
+      if (!this->Slots[i].IsUsed)
+      {
+        return nullptr;
+      }
+      if (this->Slots[i].Key == key)
+      {
+        return &this->Slots[i];
+      }
+    }
+    return nullptr;
+  }
+
+  Slot* Insert(uint64_t key, double time)
+  {
+    // make room: the expired datagrams first, then the oldest one if the table is full
+    for (size_t i = 0; i < this->Slots.size(); ++i)
+    {
+      while (this->Slots[i].IsUsed && time - this->Slots[i].LastTime > this->Timeout)
+      {
+        this->Erase(i);
+        ++this->NumberOfEvictedDatagrams;
+      }
+    }
+    if (this->NumberOfUsedSlots == this->Slots.size())
+    {
+      size_t oldest = 0;
+      for (size_t i = 1; i < this->Slots.size(); ++i)
+      {
+        oldest = (this->Slots[i].LastTime < this->Slots[oldest].LastTime) ? i : oldest;
+      }
+      this->Erase(oldest);
+      ++this->NumberOfEvictedDatagrams;
+    }
+
+    const size_t mask = this->Slots.size() - 1;
+    size_t i = this->Home(key);
+    while (this->Slots[i].IsUsed)
+    {
+      i = (i + 1) & mask;
+    }
+    Slot& slot = this->Slots[i];
+    if (slot.Data.empty())
+    {
+      slot.Data.resize(MaximumDatagramSize);
+    }
+    slot.Key = key;
+    slot.IsUsed = true;
+    slot.LastTime = time;
+    slot.ReceivedSize = slot.ExpectedSize = 0;
+    ++this->NumberOfUsedSlots;
+    return &slot;
+  }
+
+  //! Free a slot, and move back the following datagrams of its probe sequence
+  //! so that they can still be found (backward shift deletion)
+  void Erase(size_t i)
+  {
+    const size_t mask = this->Slots.size() - 1;
+    this->Slots[i].IsUsed = false;
+    --this->NumberOfUsedSlots;
+    for (size_t j = (i + 1) & mask; this->Slots[j].IsUsed; j = (j + 1) & mask)
+    {
+      // the datagram of slot j can fill the hole if the hole is between its home and j
+      const size_t home = this->Home(this->Slots[j].Key);
+      if (((j - home) & mask) >= ((j - i) & mask))
+      {
+        std::swap(this->Slots[i], this->Slots[j]);
+        i = j;
+      }
+    }
+  }
+
+  std::vector<Slot> Slots;
+  size_t NumberOfUsedSlots = 0;
+  size_t NumberOfEvictedDatagrams = 0;
+  double Timeout;
+};
+
+#endif // IPFRAGMENTTABLE_H
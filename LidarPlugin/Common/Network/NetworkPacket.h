@@ -34,6 +34,17 @@ public:
                                            unsigned short sourcePort,
                                            unsigned short destinationPort);
 
+  // Write the header built by BuildEthernetIP4UDP in a buffer of EthIP4UDPHeaderSize bytes,
+  // so that a packet can be recorded without building a NetworkPacket
+  static void WriteEthernetIP4UDPHeader(unsigned char* header,
+                                        unsigned int payloadSize,
+                                        const unsigned char* sourceIPv4BigEndian,
+                                        unsigned short sourcePort,
+                                        unsigned short destinationPort);
+
+  // Current time, with the same clock as the reception time of the packets
+  static struct timeval CurrentTime();
+
   // Note that the memory zone returned by P->GetPayloadData() has a lifetime equal
   // to the instance P of NetworkPacket (no copy is done), and must not be freed
   // by the user of NetworkPacket
@@ -43,6 +54,8 @@ public:
   unsigned int GetPayloadSize() const;
   struct timeval ReceptionTime;
 
+  static const unsigned int EthIP4UDPHeaderSize = 42;
+
   // useful offsets in packet header:
   static const unsigned int EthIPUDPHeader_IPFRAMELEN = 16;
   static const unsigned int EthIPUDPHeader_SOURCEIP4 = 26;
@@ -0,0 +1,317 @@
+//=========================================================================
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "PacketReplayEngine.h"
+
+#include "vtkPacketFileReader.h"
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <cerrno>
+#include <sys/socket.h>
+#include <time.h>
+#endif
+
+namespace
+{
+typedef std::chrono::steady_clock Clock;
+
+//-----------------------------------------------------------------------------
+//! Sleep until shortly before the deadline, then spin until it is reached, as
+//! the sleep functions may wake up hundreds of microseconds late
+void WaitUntil(const Clock::time_point& deadline, double busyWaitThreshold)
+{
+  const Clock::time_point sleepDeadline = deadline - std::chrono::duration_cast<Clock::duration>(
+    std::chrono::duration<double, std::micro>(busyWaitThreshold));
+  if (Clock::now() < sleepDeadline)
+  {
+#ifdef __linux__
+    // steady_clock is CLOCK_MONOTONIC on Linux, an absolute deadline does not drift
+    const auto nanoseconds =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(sleepDeadline.time_since_epoch()).count();
+    timespec request;
+    request.tv_sec = static_cast<time_t>(nanoseconds / 1000000000);
+    request.tv_nsec = static_cast<long>(nanoseconds % 1000000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &request, nullptr) == EINTR)
+    {
+    }
+#else
+    std::this_thread::sleep_until(sleepDeadline);
+#endif
+  }
+  while (Clock::now() < deadline)
+  {
+  }
+}
+}
+
+//-----------------------------------------------------------------------------
+struct PacketReplayEngine::Source
+{
+  std::unique_ptr<vtkPacketFileReader> Reader;
+  PacketSource NextPacket;
+  boost::asio::ip::udp::endpoint LidarEndpoint;
+  boost::asio::ip::udp::endpoint PositionEndpoint;
+
+  //! Next packet of the file and its capture time. It is copied, as the reader
+  //! may reuse its buffer for the following packet
+  std::vector<unsigned char> Packet;
+  double Time = 0;
+  bool HasPacket = false;
+
+  void Next()
+  {
+    const unsigned char* data = nullptr;
+    unsigned int dataLength = 0;
+    this->HasPacket = this->Reader ? this->Reader->NextPacket(data, dataLength, this->Time)
+                                   : this->NextPacket(data, dataLength, this->Time);
+    if (this->HasPacket)
+    {
+      this->Packet.assign(data, data + dataLength);
+    }
+  }
+
+  const boost::asio::ip::udp::endpoint& GetEndpoint() const
+  {
+    return this->Packet.size() == 512 ? this->PositionEndpoint : this->LidarEndpoint;
+  }
+};
+
+//-----------------------------------------------------------------------------
+//! Packets sent together, and the time at which each of them was due
+struct PacketReplayEngine::Batch
+{
+  std::vector<unsigned char> Data;
+  std::vector<std::size_t> Offsets;
+  std::vector<const boost::asio::ip::udp::endpoint*> Endpoints;
+  std::vector<Clock::time_point> DueTimes;
+
+  std::size_t size() const { return this->Offsets.size(); }
+
+  std::size_t GetPacketSize(std::size_t i) const
+  {
+    return (i + 1 < this->Offsets.size() ? this->Offsets[i + 1] : this->Data.size()) - this->Offsets[i];
+  }
+
+  void Add(const Source& source, const Clock::time_point& dueTime)
+  {
+    this->Offsets.push_back(this->Data.size());
+    this->Data.insert(this->Data.end(), source.Packet.begin(), source.Packet.end());
+    this->Endpoints.push_back(&source.GetEndpoint());
+    this->DueTimes.push_back(dueTime);
+  }
+
+  void Clear()
+  {
+    this->Data.clear();
+    this->Offsets.clear();
+    this->Endpoints.clear();
+    this->DueTimes.clear();
+  }
+};
+
+//-----------------------------------------------------------------------------
+PacketReplayEngine::PacketReplayEngine(const std::string& destinationIp)
+  : Socket(IOService)
+  , DestinationAddress(boost::asio::ip::address_v4::from_string(destinationIp))
+{
+  this->Socket.open(boost::asio::ip::udp::v4());
+  this->Socket.set_option(boost::asio::ip::udp::socket::reuse_address(true));
+  // Allow to send the packet on the same machine
+  this->Socket.set_option(boost::asio::ip::multicast::enable_loopback(true));
+}
+
+//-----------------------------------------------------------------------------
+PacketReplayEngine::~PacketReplayEngine() = default;
+
+//-----------------------------------------------------------------------------
+void PacketReplayEngine::AddSource(const std::string& fileName, int lidarPort, int positionPort)
+{
+  std::unique_ptr<Source> source(new Source);
+  source->Reader.reset(new vtkPacketFileReader);
+  if (!source->Reader->Open(fileName))
+  {
+    throw std::runtime_error("Unable to open packet file " + fileName);
+  }
+  source->LidarEndpoint = boost::asio::ip::udp::endpoint(this->DestinationAddress, lidarPort);
+  source->PositionEndpoint = boost::asio::ip::udp::endpoint(this->DestinationAddress, positionPort);
+  this->Sources.push_back(std::move(source));
+}
+
+//-----------------------------------------------------------------------------
+void PacketReplayEngine::AddSource(const PacketSource& nextPacket, int lidarPort, int positionPort)
+{
+  std::unique_ptr<Source> source(new Source);
+  source->NextPacket = nextPacket;
+  source->LidarEndpoint = boost::asio::ip::udp::endpoint(this->DestinationAddress, lidarPort);
+  source->PositionEndpoint = boost::asio::ip::udp::endpoint(this->DestinationAddress, positionPort);
+  this->Sources.push_back(std::move(source));
+}
+
+//-----------------------------------------------------------------------------
+std::size_t PacketReplayEngine::Send(const Batch& batch)
+{
+#ifdef __linux__
+  std::vector<iovec> buffers(batch.size());
+  std::vector<mmsghdr> messages(batch.size());
+  for (std::size_t i = 0; i < batch.size(); ++i)
+  {
+    buffers[i].iov_base = const_cast<unsigned char*>(batch.Data.data() + batch.Offsets[i]);
+    buffers[i].iov_len = batch.GetPacketSize(i);
+    msghdr& header = messages[i].msg_hdr;
+    header = msghdr();
+    header.msg_name = const_cast<sockaddr*>(batch.Endpoints[i]->data());
+    header.msg_namelen = static_cast<socklen_t>(batch.Endpoints[i]->size());
+    header.msg_iov = &buffers[i];
+    header.msg_iovlen = 1;
+  }
+  std::size_t sent = 0;
+  while (sent < batch.size())
+  {
+    const int result = sendmmsg(this->Socket.native_handle(), messages.data() + sent,
+                                static_cast<unsigned int>(batch.size() - sent), 0);
+    if (result < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (result <= 0)
+    {
+      // skip the packet which could not be sent
+      ++sent;
+      continue;
+    }
+    sent += result;
+  }
+  std::size_t sentPackets = 0;
+  for (const auto& message : messages)
+  {
+    sentPackets += message.msg_len > 0 ? 1 : 0;
+  }
+  return sentPackets;
+#else
+  std::size_t sentPackets = 0;
+  for (std::size_t i = 0; i < batch.size(); ++i)
+  {
+    boost::system::error_code error;
+    this->Socket.send_to(boost::asio::buffer(batch.Data.data() + batch.Offsets[i], batch.GetPacketSize(i)),
+                         *batch.Endpoints[i], 0, error);
+    sentPackets += error ? 0 : 1;
+  }
+  return sentPackets;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+PacketReplayEngine::Statistics PacketReplayEngine::Replay(
+  const std::function<void(const Statistics&)>& progress, std::size_t progressInterval)
+{
+  Statistics statistics;
+  double latenessSum = 0;
+  double squaredLatenessSum = 0;
+  auto getStatistics = [&]()
+  {
+    if (statistics.PacketCount > 0)
+    {
+      statistics.MeanLateness = latenessSum / statistics.PacketCount;
+      const double variance = squaredLatenessSum / statistics.PacketCount
+                              - statistics.MeanLateness * statistics.MeanLateness;
+      statistics.Jitter = std::sqrt(std::max(0.0, variance));
+    }
+    return statistics;
+  };
+
+  // the packets of the sources are merged on their capture time
+  double pcapStartTime = std::numeric_limits<double>::max();
+  for (auto& source : this->Sources)
+  {
+    source->Next();
+    if (source->HasPacket)
+    {
+      pcapStartTime = std::min(pcapStartTime, source->Time);
+    }
+  }
+  auto nextSource = [this]()
+  {
+    Source* next = nullptr;
+    for (auto& source : this->Sources)
+    {
+      if (source->HasPacket && (!next || source->Time < next->Time))
+      {
+        next = source.get();
+      }
+    }
+    return next;
+  };
+
+  const bool isPaced = this->Speed > 0;
+  const Clock::time_point replayStartTime = Clock::now();
+  auto getDueTime = [&](const Source& source)
+  {
+    return replayStartTime + std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>((source.Time - pcapStartTime) / this->Speed));
+  };
+
+  Batch batch;
+  for (Source* next = nextSource(); next; )
+  {
+    if (isPaced)
+    {
+      WaitUntil(getDueTime(*next), this->BusyWaitThreshold);
+    }
+
+    // send at once all the packets which are due
+    batch.Clear();
+    const Clock::time_point now = Clock::now();
+    while (next && batch.size() < this->BatchSize)
+    {
+      const Clock::time_point dueTime = isPaced ? getDueTime(*next) : now;
+      if (dueTime > now)
+      {
+        break;
+      }
+      batch.Add(*next, dueTime);
+      next->Next();
+      next = nextSource();
+    }
+    const std::size_t sentPackets = this->Send(batch);
+    const Clock::time_point sendTime = Clock::now();
+
+    const std::size_t previousCount = statistics.PacketCount;
+    for (std::size_t i = 0; i < batch.size(); ++i)
+    {
+      const double lateness = std::chrono::duration<double, std::micro>(sendTime - batch.DueTimes[i]).count();
+      latenessSum += lateness;
+      squaredLatenessSum += lateness * lateness;
+      statistics.MaximumLateness = std::max(statistics.MaximumLateness, lateness);
+    }
+    statistics.PacketCount += batch.size();
+    statistics.ByteCount += batch.Data.size();
+    statistics.SendErrorCount += batch.size() - sentPackets;
+    statistics.Duration = std::chrono::duration<double>(sendTime - replayStartTime).count();
+
+    if (progress && progressInterval > 0
+        && statistics.PacketCount / progressInterval != previousCount / progressInterval)
+    {
+      progress(getStatistics());
+    }
+  }
+  return getStatistics();
+}
@@ -0,0 +1,126 @@
+//=========================================================================
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef PACKETREPLAYENGINE_H
+#define PACKETREPLAYENGINE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include <vvConfigure.h>
+
+class vtkPacketFileReader;
+
+/**
+ * @brief PacketReplayEngine sends the UDP payloads of one or several pcap files
+ * on the network, at the pace given by their capture timestamps.
+ *
+ * The packets of all the files are merged in the order of their timestamps, so
+ * that several sensors recorded at the same time are replayed in sync. Each file
+ * has its own destination ports: as in vvPacketSender, the 512 bytes packets are
+ * sent to the position port and the other ones to the lidar port.
+ *
+ * The packets are paced against the capture timestamps with an absolute
+ * deadline: the engine sleeps until shortly before the packet is due and then
+ * spins, so that the delays do not accumulate. All the packets already due are
+ * sent at once, with a single sendmmsg call on Linux, which keeps up with the
+ * rates of the largest sensors.
+ */
+class LidarPlugin_EXPORT PacketReplayEngine
+{
+public:
+  //! Statistics of a replay, the lateness is the delay between the time at which
+  //! a packet should have been sent and the time it was actually sent
+  struct Statistics
+  {
+    std::size_t PacketCount = 0;
+    std::size_t ByteCount = 0;
+    std::size_t SendErrorCount = 0;
+    //! Wall clock duration of the replay, in seconds
+    double Duration = 0;
+    //! Lateness, in microseconds
+    double MeanLateness = 0;
+    double MaximumLateness = 0;
+    //! Standard deviation of the lateness, in microseconds
+    double Jitter = 0;
+
+    double GetPacketsPerSecond() const { return this->Duration > 0 ? this->PacketCount / this->Duration : 0; }
+    double GetMegabitsPerSecond() const { return this->Duration > 0 ? 8e-6 * this->ByteCount / this->Duration : 0; }
+  };
+
+  //! Gives the next packet of a source and its time in seconds, as
+  //! vtkPacketFileReader::NextPacket. The data must stay valid until the next call
+  typedef std::function<bool(const unsigned char*& data, unsigned int& dataLength, double& time)>
+    PacketSource;
+
+  explicit PacketReplayEngine(const std::string& destinationIp = "127.0.0.1");
+  ~PacketReplayEngine();
+
+  /**
+   * @brief AddSource add a pcap file to replay
+   * @throw std::runtime_error if the file can not be opened
+   */
+  void AddSource(const std::string& fileName, int lidarPort = 2368, int positionPort = 8308);
+
+  //! Add a source of packets which are not read from a file, such as synthetic packets
+  void AddSource(const PacketSource& nextPacket, int lidarPort = 2368, int positionPort = 8308);
+
+  //! Playback speed, 2 replays twice as fast as recorded. 0 or less sends the
+  //! packets as fast as possible
+  void SetSpeed(double speed) { this->Speed = speed; }
+  double GetSpeed() const { return this->Speed; }
+
+  //! Maximum number of packets sent with a single system call
+  void SetBatchSize(std::size_t size) { this->BatchSize = std::max<std::size_t>(1, size); }
+  std::size_t GetBatchSize() const { return this->BatchSize; }
+
+  //! The engine spins instead of sleeping when a packet is due in less than this
+  //! number of microseconds. Larger values are more accurate but use more CPU
+  void SetBusyWaitThreshold(double microseconds) { this->BusyWaitThreshold = microseconds; }
+  double GetBusyWaitThreshold() const { return this->BusyWaitThreshold; }
+
+  /**
+   * @brief Replay send all the packets of the sources once
+   * @param progress if set, called with the current statistics every progressInterval packets
+   * @return the statistics of the whole replay
+   */
+  Statistics Replay(const std::function<void(const Statistics&)>& progress = nullptr,
+                    std::size_t progressInterval = 1000);
+
+private:
+  struct Source;
+  struct Batch;
+
+  //! Send the packets of the batch, return the number of packets sent
+  std::size_t Send(const Batch& batch);
+
+  boost::asio::io_service IOService;
+  boost::asio::ip::udp::socket Socket;
+  boost::asio::ip::address DestinationAddress;
+  std::vector<std::unique_ptr<Source> > Sources;
+
+  double Speed = 1.0;
+  std::size_t BatchSize = 64;
+  double BusyWaitThreshold = 200;
+};
+
+#endif // PACKETREPLAYENGINE_H
@@ -0,0 +1,123 @@
+//=========================================================================
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "PositionPacketCache.h"
+
+#include <ctime>
+#include <map>
+
+#include <boost/filesystem.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace
+{
+struct Entry
+{
+  std::weak_ptr<const PositionPacketCache::Packets> Packets;
+  // identify the version of the file the packets come from
+  boost::uintmax_t FileSize = 0;
+  std::time_t LastWriteTime = 0;
+};
+
+//-----------------------------------------------------------------------------
+bool GetFileVersion(const std::string& fileName, boost::uintmax_t& fileSize, std::time_t& lastWriteTime)
+{
+  boost::system::error_code error;
+  fileSize = boost::filesystem::file_size(fileName, error);
+  if (error)
+  {
+    return false;
+  }
+  lastWriteTime = boost::filesystem::last_write_time(fileName, error);
+  return !error;
+}
+
+//-----------------------------------------------------------------------------
+boost::mutex& GetMutex()
+{
+  static boost::mutex mutex;
+  return mutex;
+}
+
+//-----------------------------------------------------------------------------
+std::map<std::string, Entry>& GetEntries()
+{
+  static std::map<std::string, Entry> entries;
+  return entries;
+}
+}
+
+//-----------------------------------------------------------------------------
+bool PositionPacketCache::IsPositionPacket(const unsigned char* data, unsigned int dataLength)
+{
+  // the payload of the position packets starts with 14 bytes of zeros
+  if (dataLength != PacketSize)
+  {
+    return false;
+  }
+  for (int i = 0; i < 14; ++i)
+  {
+    if (data[i] != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void PositionPacketCache::Publish(const std::string& fileName, const std::shared_ptr<const Packets>& packets)
+{
+  Entry entry;
+  entry.Packets = packets;
+  const bool isVersioned = GetFileVersion(fileName, entry.FileSize, entry.LastWriteTime);
+
+  boost::mutex::scoped_lock lock(GetMutex());
+  std::map<std::string, Entry>& entries = GetEntries();
+  // forget the expired entries so that the map does not grow with each file opened
+  for (auto it = entries.begin(); it != entries.end();)
+  {
+    it = it->second.Packets.expired() ? entries.erase(it) : std::next(it);
+  }
+  if (isVersioned && packets)
+  {
+    entries[fileName] = entry;
+  }
+  else
+  {
+    entries.erase(fileName);
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::shared_ptr<const PositionPacketCache::Packets> PositionPacketCache::Find(const std::string& fileName)
+{
+  boost::uintmax_t fileSize = 0;
+  std::time_t lastWriteTime = 0;
+  if (!GetFileVersion(fileName, fileSize, lastWriteTime))
+  {
+    return nullptr;
+  }
+
+  boost::mutex::scoped_lock lock(GetMutex());
+  std::map<std::string, Entry>& entries = GetEntries();
+  auto it = entries.find(fileName);
+  if (it == entries.end() || it->second.FileSize != fileSize || it->second.LastWriteTime != lastWriteTime)
+  {
+    return nullptr;
+  }
+  return it->second.Packets.lock();
+}
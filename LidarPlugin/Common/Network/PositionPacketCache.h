@@ -0,0 +1,65 @@
+//=========================================================================
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef POSITIONPACKETCACHE_H
+#define POSITIONPACKETCACHE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vvConfigure.h>
+
+/**
+ * @brief PositionPacketCache shares the position (GPS/IMU) packets of a pcap
+ * between the readers of the same file, so that the file is only read once.
+ *
+ * vtkLidarReader collects the position packets while it builds its frame
+ * catalog and publishes them here, then vtkVelodyneHDLPositionReader uses them
+ * instead of scanning the pcap again.
+ *
+ * The cache does not own the packets: they live as long as the reader which
+ * collected them keeps them. An entry is also ignored if the file has been
+ * modified since the packets were collected.
+ */
+class LidarPlugin_EXPORT PositionPacketCache
+{
+public:
+  //! Size of the payload of a position packet, all of them are this long
+  static const unsigned int PacketSize = 512;
+
+  //! Payloads of the position packets of a file, in the order of the file
+  struct Packets
+  {
+    std::vector<unsigned char> Data;
+
+    std::size_t size() const { return this->Data.size() / PacketSize; }
+    const unsigned char* operator[](std::size_t i) const { return this->Data.data() + i * PacketSize; }
+    void Append(const unsigned char* data) { this->Data.insert(this->Data.end(), data, data + PacketSize); }
+    void Append(const Packets& other) { this->Data.insert(this->Data.end(), other.Data.begin(), other.Data.end()); }
+  };
+
+  //! Cheap test of the packets worth being collected, before a full parsing
+  static bool IsPositionPacket(const unsigned char* data, unsigned int dataLength);
+
+  //! Publish the packets collected from fileName, replacing the previous ones
+  static void Publish(const std::string& fileName, const std::shared_ptr<const Packets>& packets);
+
+  //! Packets collected from fileName, or nullptr if they are not available
+  static std::shared_ptr<const Packets> Find(const std::string& fileName);
+};
+
+#endif // POSITIONPACKETCACHE_H
@@ -0,0 +1,506 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "RemotePcapFile.h"
+
+// STD
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <istream>
+#include <map>
+#include <sstream>
+
+// BOOST
+#include <boost/asio.hpp>
+#include <boost/filesystem.hpp>
+
+namespace
+{
+const int NumberOfAttempts = 3;
+// the cache is trimmed each time this many blocks have been written
+const int BlocksBetweenTrims = 64;
+
+//-----------------------------------------------------------------------------
+struct HttpUrl
+{
+  std::string Host;
+  std::string Port = "80";
+  std::string Target = "/";
+
+  bool Parse(const std::string& url)
+  {
+    const std::string scheme = "http://";
+    if (url.compare(0, scheme.size(), scheme) != 0)
+    {
+      return false;
+    }
+    const size_t hostStart = scheme.size();
+    const size_t targetStart = url.find('/', hostStart);
+    const std::string authority = url.substr(hostStart, targetStart - hostStart);
+    const size_t colon = authority.find(':');
+    this->Host = authority.substr(0, colon);
+    if (colon != std::string::npos)
+    {
+      this->Port = authority.substr(colon + 1);
+    }
+    if (targetStart != std::string::npos)
+    {
+      this->Target = url.substr(targetStart);
+    }
+    return !this->Host.empty() && !this->Port.empty();
+  }
+};
+
+//-----------------------------------------------------------------------------
+// Stable name of the cache folder of an URL (64 bits FNV-1a)
+std::string HashName(const std::string& text)
+{
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : text)
+  {
+    hash = (hash ^ c) * 1099511628211ull;
+  }
+  char name[17];
+  std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+  return name;
+}
+
+//-----------------------------------------------------------------------------
+std::mutex SettingsMutex;
+std::string CacheDirectory;
+int64_t MaximumCacheSize = int64_t(16) * 1024 * 1024 * 1024;
+
+//-----------------------------------------------------------------------------
+// Sizes of the remote files, to only ask them once
+std::mutex SizesMutex;
+std::map<std::string, int64_t> RemoteSizes;
+
+//-----------------------------------------------------------------------------
+std::atomic<int> BlocksWritten(0);
+std::mutex TrimMutex;
+
+//-----------------------------------------------------------------------------
+// Remove the least recently used blocks of the cache until it fits its maximum size
+void TrimCache()
+{
+  std::lock_guard<std::mutex> lock(TrimMutex);
+  const boost::filesystem::path directory = RemotePcapFile::GetCacheDirectory();
+  boost::system::error_code errCode;
+  std::vector<std::pair<std::time_t, boost::filesystem::path> > blocks;
+  uintmax_t totalSize = 0;
+  for (boost::filesystem::recursive_directory_iterator it(directory, errCode), end;
+       !errCode && it != end; it.increment(errCode))
+  {
+    if (it->path().extension() == ".block")
+    {
+      blocks.emplace_back(boost::filesystem::last_write_time(it->path(), errCode), it->path());
+      totalSize += boost::filesystem::file_size(it->path(), errCode);
+    }
+  }
+  const uintmax_t maximumSize = static_cast<uintmax_t>(RemotePcapFile::GetMaximumCacheSize());
+  std::sort(blocks.begin(), blocks.end());
+  for (const auto& block : blocks)
+  {
+    if (totalSize <= maximumSize)
+    {
+      break;
+    }
+    const uintmax_t size = boost::filesystem::file_size(block.second, errCode);
+    if (boost::filesystem::remove(block.second, errCode))
+    {
+      totalSize -= size;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Write a file through a temporary file, so that a concurrent reader never sees it
+// partially written
+bool WriteFile(const boost::filesystem::path& path, const std::vector<unsigned char>& data)
+{
+  boost::system::error_code errCode;
+  boost::filesystem::create_directories(path.parent_path(), errCode);
+  const boost::filesystem::path temporaryPath =
+    path.string() + "." + boost::filesystem::unique_path().string() + ".tmp";
+  {
+    std::ofstream os(temporaryPath.string(), std::ios::binary | std::ios::trunc);
+    os.write(reinterpret_cast<const char*>(data.data()), data.size());
+    if (!os.good())
+    {
+      os.close();
+      boost::filesystem::remove(temporaryPath, errCode);
+      return false;
+    }
+  }
+  boost::filesystem::rename(temporaryPath, path, errCode);
+  if (errCode)
+  {
+    boost::filesystem::remove(temporaryPath, errCode);
+    return false;
+  }
+  return true;
+}
+}
+
+//-----------------------------------------------------------------------------
+// HTTP/1.1 keep-alive connection to a server, only supporting the responses with a
+// Content-Length
+class RemotePcapFile::Connection
+{
+public:
+  explicit Connection(const HttpUrl& url) : Location(url), Socket(IOService) {}
+
+  /**
+   * @brief Get the bytes [first, last] of the target, the whole target if last < 0
+   * @param status[out] HTTP status of the response
+   * @param headers[out] headers of the response, with lower case names
+   */
+  bool Get(int64_t first, int64_t last, int& status, std::map<std::string, std::string>& headers,
+           std::vector<unsigned char>& body, std::string& error)
+  {
+    using boost::asio::ip::tcp;
+    boost::system::error_code errCode;
+    if (!this->Socket.is_open())
+    {
+      tcp::resolver resolver(this->IOService);
+      tcp::resolver::iterator endpoints =
+        resolver.resolve(tcp::resolver::query(this->Location.Host, this->Location.Port), errCode);
+      if (!errCode)
+      {
+        boost::asio::connect(this->Socket, endpoints, errCode);
+      }
+      if (errCode)
+      {
+        error = "could not connect to " + this->Location.Host + ": " + errCode.message();
+        this->Socket.close(errCode);
+        return false;
+      }
+      this->Socket.set_option(tcp::no_delay(true), errCode);
+    }
+
+    std::ostringstream request;
+    request << "GET " << this->Location.Target << " HTTP/1.1\r\n"
+            << "Host: " << this->Location.Host
+            << (this->Location.Port != "80" ? ":" + this->Location.Port : "") << "\r\n";
+    if (last >= 0)
+    {
+      request << "Range: bytes=" << first << "-" << last << "\r\n";
+    }
+    request << "Connection: keep-alive\r\n\r\n";
+    boost::asio::write(this->Socket, boost::asio::buffer(request.str()), errCode);
+
+    // status line and headers
+    boost::asio::streambuf response;
+    if (!errCode)
+    {
+      boost::asio::read_until(this->Socket, response, "\r\n\r\n", errCode);
+    }
+    if (errCode)
+    {
+      error = "could not reach " + this->Location.Host + ": " + errCode.message();
+      this->Socket.close(errCode);
+      return false;
+    }
+    std::istream stream(&response);
+    std::string version, line;
+    stream >> version >> status;
+    std::getline(stream, line);
+    headers.clear();
+    while (std::getline(stream, line) && line != "\r")
+    {
+      const size_t colon = line.find(':');
+      if (colon == std::string::npos)
+      {
+        continue;
+      }
+      std::string name = line.substr(0, colon);
+      std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+      const size_t valueStart = line.find_first_not_of(' ', colon + 1);
+      const size_t valueEnd = line.find_last_not_of("\r ");
+      headers[name] = valueStart <= valueEnd ? line.substr(valueStart, valueEnd - valueStart + 1) : "";
+    }
+
+    auto length = headers.find("content-length");
+    if (length == headers.end())
+    {
+      // the end of the body can not be known
+      error = "unsupported response of " + this->Location.Host;
+      this->Socket.close(errCode);
+      return false;
+    }
+    const size_t bodySize = std::stoull(length->second);
+
+    // the body, of which the first bytes may have been read with the headers
+    body.resize(bodySize);
+    const size_t buffered = std::min(bodySize, response.size());
+    stream.read(reinterpret_cast<char*>(body.data()), buffered);
+    boost::asio::read(this->Socket, boost::asio::buffer(body.data() + buffered, bodySize - buffered),
+                      errCode);
+    if (errCode)
+    {
+      error = "connection to " + this->Location.Host + " lost: " + errCode.message();
+      this->Socket.close(errCode);
+      return false;
+    }
+    auto connection = headers.find("connection");
+    if (connection != headers.end() && connection->second == "close")
+    {
+      this->Socket.close(errCode);
+    }
+    return true;
+  }
+
+private:
+  HttpUrl Location;
+  boost::asio::io_service IOService;
+  boost::asio::ip::tcp::socket Socket;
+};
+
+//-----------------------------------------------------------------------------
+const int64_t RemotePcapFile::BlockSize;
+
+//-----------------------------------------------------------------------------
+bool RemotePcapFile::IsRemote(const std::string& filename)
+{
+  return filename.compare(0, 7, "http://") == 0;
+}
+
+//-----------------------------------------------------------------------------
+void RemotePcapFile::SetCacheDirectory(const std::string& directory)
+{
+  std::lock_guard<std::mutex> lock(SettingsMutex);
+  CacheDirectory = directory;
+}
+
+//-----------------------------------------------------------------------------
+std::string RemotePcapFile::GetCacheDirectory()
+{
+  std::lock_guard<std::mutex> lock(SettingsMutex);
+  if (CacheDirectory.empty())
+  {
+    boost::system::error_code errCode;
+    CacheDirectory =
+      (boost::filesystem::temp_directory_path(errCode) / "LidarViewRemoteCache").string();
+  }
+  return CacheDirectory;
+}
+
+//-----------------------------------------------------------------------------
+void RemotePcapFile::SetMaximumCacheSize(int64_t size)
+{
+  std::lock_guard<std::mutex> lock(SettingsMutex);
+  MaximumCacheSize = size;
+}
+
+//-----------------------------------------------------------------------------
+int64_t RemotePcapFile::GetMaximumCacheSize()
+{
+  std::lock_guard<std::mutex> lock(SettingsMutex);
+  return MaximumCacheSize;
+}
+
+//-----------------------------------------------------------------------------
+std::string RemotePcapFile::GetLocalFileName(const std::string& url, const std::string& name)
+{
+  return (boost::filesystem::path(GetCacheDirectory()) / HashName(url) / name).string();
+}
+
+//-----------------------------------------------------------------------------
+bool RemotePcapFile::GetRemoteSize(const std::string& url, int64_t& size, std::string& error)
+{
+  {
+    std::lock_guard<std::mutex> lock(SizesMutex);
+    auto known = RemoteSizes.find(url);
+    if (known != RemoteSizes.end())
+    {
+      size = known->second;
+      return true;
+    }
+  }
+
+  HttpUrl location;
+  if (!location.Parse(url))
+  {
+    error = "invalid URL " + url;
+    return false;
+  }
+  // the size is given by the Content-Range of the response to a 1 byte range request
+  Connection connection(location);
+  int status = 0;
+  std::map<std::string, std::string> headers;
+  std::vector<unsigned char> body;
+  if (!connection.Get(0, 0, status, headers, body, error))
+  {
+    return false;
+  }
+  auto range = headers.find("content-range");
+  const size_t slash = range != headers.end() ? range->second.rfind('/') : std::string::npos;
+  if (status != 206 || slash == std::string::npos || range->second.compare(slash + 1, 1, "*") == 0)
+  {
+    error = status == 206 || status == 200 ? url + " does not support range requests"
+                                           : url + ": HTTP error " + std::to_string(status);
+    return false;
+  }
+  size = std::stoll(range->second.substr(slash + 1));
+
+  std::lock_guard<std::mutex> lock(SizesMutex);
+  RemoteSizes[url] = size;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool RemotePcapFile::Download(const std::string& url, const std::string& localFileName)
+{
+  HttpUrl location;
+  if (!location.Parse(url))
+  {
+    return false;
+  }
+  Connection connection(location);
+  int status = 0;
+  std::map<std::string, std::string> headers;
+  std::vector<unsigned char> body;
+  std::string error;
+  return connection.Get(0, -1, status, headers, body, error) && status == 200
+         && WriteFile(localFileName, body);
+}
+
+//-----------------------------------------------------------------------------
+RemotePcapFile::RemotePcapFile() = default;
+
+//-----------------------------------------------------------------------------
+RemotePcapFile::~RemotePcapFile()
+{
+  this->Close();
+}
+
+//-----------------------------------------------------------------------------
+bool RemotePcapFile::Open(const std::string& url, int numberOfReadaheadThreads)
+{
+  this->Close();
+  this->LastError.clear();
+  int64_t size = 0;
+  if (!GetRemoteSize(url, size, this->LastError))
+  {
+    return false;
+  }
+
+  // the blocks of another version of the file are in another folder
+  this->Url = url;
+  this->Size = size;
+  this->BlockDirectory = GetLocalFileName(url, "blocks-" + std::to_string(size));
+  TrimCache();
+
+  numberOfReadaheadThreads = std::max(0, numberOfReadaheadThreads);
+  this->SetNumberOfChunksToPrefetch(2 * numberOfReadaheadThreads);
+  this->StartPrefetching(numberOfReadaheadThreads);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void RemotePcapFile::Close()
+{
+  this->StopPrefetching();
+  std::lock_guard<std::mutex> lock(this->ConnectionsMutex);
+  this->IdleConnections.clear();
+  this->Url.clear();
+  this->Size = 0;
+}
+
+//-----------------------------------------------------------------------------
+size_t RemotePcapFile::GetNumberOfChunks() const
+{
+  return static_cast<size_t>((this->Size + BlockSize - 1) / BlockSize);
+}
+
+//-----------------------------------------------------------------------------
+int64_t RemotePcapFile::GetChunkOffset(size_t chunkIndex) const
+{
+  return static_cast<int64_t>(chunkIndex) * BlockSize;
+}
+
+//-----------------------------------------------------------------------------
+std::unique_ptr<RemotePcapFile::Connection> RemotePcapFile::AcquireConnection()
+{
+  std::lock_guard<std::mutex> lock(this->ConnectionsMutex);
+  if (this->IdleConnections.empty())
+  {
+    HttpUrl location;
+    location.Parse(this->Url);
+    return std::unique_ptr<Connection>(new Connection(location));
+  }
+  std::unique_ptr<Connection> connection = std::move(this->IdleConnections.back());
+  this->IdleConnections.pop_back();
+  return connection;
+}
+
+//-----------------------------------------------------------------------------
+void RemotePcapFile::ReleaseConnection(std::unique_ptr<Connection> connection)
+{
+  std::lock_guard<std::mutex> lock(this->ConnectionsMutex);
+  this->IdleConnections.push_back(std::move(connection));
+}
+
+//-----------------------------------------------------------------------------
+RemotePcapFile::Chunk RemotePcapFile::LoadChunk(size_t chunkIndex)
+{
+  const int64_t first = this->GetChunkOffset(chunkIndex);
+  const int64_t last = std::min(first + BlockSize, this->Size) - 1;
+  const size_t blockSize = static_cast<size_t>(last - first + 1);
+  const boost::filesystem::path blockPath =
+    boost::filesystem::path(this->BlockDirectory) / (std::to_string(chunkIndex) + ".block");
+  std::shared_ptr<std::vector<unsigned char> > block =
+    std::make_shared<std::vector<unsigned char> >(blockSize);
+
+  // block of the local cache, marked as recently used
+  boost::system::error_code errCode;
+  {
+    std::ifstream is(blockPath.string(), std::ios::binary);
+    if (is.read(reinterpret_cast<char*>(block->data()), blockSize) && is.peek() == EOF)
+    {
+      boost::filesystem::last_write_time(blockPath, std::time(nullptr), errCode);
+      return block;
+    }
+  }
+
+  // the connections closed by the server are opened again
+  std::unique_ptr<Connection> connection = this->AcquireConnection();
+  for (int attempt = 0; attempt < NumberOfAttempts; ++attempt)
+  {
+    int status = 0;
+    std::map<std::string, std::string> headers;
+    std::vector<unsigned char> body;
+    std::string error;
+    if (connection->Get(first, last, status, headers, body, error) && status == 206
+        && body.size() == blockSize)
+    {
+      this->ReleaseConnection(std::move(connection));
+      if (WriteFile(blockPath, body) && ++BlocksWritten % BlocksBetweenTrims == 0)
+      {
+        TrimCache();
+      }
+      block->swap(body);
+      return block;
+    }
+  }
+  this->ReleaseConnection(std::move(connection));
+  return nullptr;
+}
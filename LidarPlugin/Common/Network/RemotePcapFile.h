@@ -0,0 +1,110 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef REMOTEPCAPFILE_H
+#define REMOTEPCAPFILE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ChunkedFile.h"
+
+/**
+ * \class RemotePcapFile
+ * \brief Random access to a pcap file served over HTTP, like an object storage
+ *        bucket, without downloading it first.
+ *
+ * The file is read by blocks of BlockSize bytes, fetched on demand with HTTP range
+ * requests and kept in a local block cache, so that the frames already viewed are not
+ * fetched again. The least recently used blocks are removed from the cache once it
+ * exceeds its maximum size. Several threads fetch the blocks following the one being
+ * read, each one over its own keep-alive connection.
+ *
+ * The sidecars of the file (frame catalog index, ...) are looked up next to it on the
+ * server, and stored in the local cache: GetLocalFileName gives where. Opening a remote
+ * file with a published index thus only fetches the index and the frames viewed.
+ *
+ * Only plain http URLs are supported.
+ */
+class RemotePcapFile : public ChunkedFile
+{
+public:
+  //! Size of the blocks fetched at once
+  static const int64_t BlockSize = 1024 * 1024;
+
+  //! True if the file name is an http URL
+  static bool IsRemote(const std::string& filename);
+
+  //! Directory of the local block cache, a folder of the temporary directory by default
+  static void SetCacheDirectory(const std::string& directory);
+  static std::string GetCacheDirectory();
+
+  //! Maximum size of the blocks kept in the local cache, in bytes
+  static void SetMaximumCacheSize(int64_t size);
+  static int64_t GetMaximumCacheSize();
+
+  /**
+   * @brief GetLocalFileName local file storing the data named name of a remote file,
+   * in the cache directory
+   */
+  static std::string GetLocalFileName(const std::string& url, const std::string& name);
+
+  /**
+   * @brief GetRemoteSize size of a remote file, which is only asked once to the server
+   * @return false if the file can not be reached or does not support range requests
+   */
+  static bool GetRemoteSize(const std::string& url, int64_t& size, std::string& error);
+
+  /**
+   * @brief Download a whole remote file, only meant for the small sidecar files. The
+   * local file is written in a temporary file which is then renamed.
+   */
+  static bool Download(const std::string& url, const std::string& localFileName);
+
+  RemotePcapFile();
+  ~RemotePcapFile() override;
+
+  /**
+   * @brief Open a remote file
+   * @param numberOfReadaheadThreads number of threads fetching the blocks in advance
+   */
+  bool Open(const std::string& url, int numberOfReadaheadThreads = 4);
+  void Close();
+
+protected:
+  size_t GetNumberOfChunks() const override;
+  int64_t GetChunkOffset(size_t chunkIndex) const override;
+  Chunk LoadChunk(size_t chunkIndex) override;
+
+private:
+  class Connection;
+
+  //! A connection to the server, reused if one is idle
+  std::unique_ptr<Connection> AcquireConnection();
+  void ReleaseConnection(std::unique_ptr<Connection> connection);
+
+  std::string Url;
+  std::string BlockDirectory;
+
+  std::mutex ConnectionsMutex;
+  std::vector<std::unique_ptr<Connection> > IdleConnections;
+};
+
+#endif // REMOTEPCAPFILE_H
@@ -34,10 +34,24 @@
 
 #include <pcap.h>
 #include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
 #include <vector>
-#include <unordered_map>
+
+#include "CompressedPcapFile.h"
+#include "IPFragmentTable.h"
+#include "RemotePcapFile.h"
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 // Some versions of libpcap do not have PCAP_NETMASK_UNKNOWN
 #if !defined(PCAP_NETMASK_UNKNOWN)
@@ -47,18 +61,177 @@
 // Packet fragment offsets are given in steps of 8 bytes.
 constexpr unsigned int FRAGMENT_OFFSET_STEP = 8;
 
-//! @brief Track fragment reassembly to confirm that all data has been
-//!        reassembled before passing it on.
-struct FragmentTracker
+//! @brief On disk pcap record header, used by the memory mapped backend.
+struct PcapRecordHeader
+{
+  uint32_t TimestampSeconds;
+  uint32_t TimestampFraction;
+  uint32_t CapturedLength;
+  uint32_t OriginalLength;
+};
+
+//! @brief Sample of the sparse time index of a file: a record and the timestamp of the
+//! first packet selected at or after it, in nanoseconds since the epoch.
+struct PcapTimeSample
+{
+  int64_t Offset;
+  int64_t Nanoseconds;
+};
+
+//! @brief Block types of the pcapng format read by the memory mapped backend.
+enum PcapngBlockType : uint32_t
+{
+  PcapngInterfaceDescriptionBlock = 0x00000001,
+  PcapngObsoletePacketBlock = 0x00000002,
+  PcapngSimplePacketBlock = 0x00000003,
+  PcapngEnhancedPacketBlock = 0x00000006,
+  PcapngSectionHeaderBlock = 0x0a0d0d0a
+};
+
+//! @brief Interface of a pcapng section, describing the packets captured on it.
+struct PcapngInterface
+{
+  uint32_t LinkType = 0;
+  uint32_t SnapLength = 0;
+  //! Timestamps in units of 10^-Resolution s, or 2^-Resolution s if BinaryResolution
+  bool BinaryResolution = false;
+  uint8_t Resolution = 6;
+  //! Seconds to add to the timestamps
+  int64_t OffsetSeconds = 0;
+
+  //! Timestamp of a packet in nanoseconds since the epoch
+  int64_t ToNanoseconds(uint64_t timestamp) const
+  {
+    int64_t nanoseconds = 0;
+    if (this->BinaryResolution)
+    {
+      const int shift = std::min<int>(this->Resolution, 63);
+      const uint64_t fraction = timestamp & ((uint64_t(1) << shift) - 1);
+      nanoseconds = static_cast<int64_t>(timestamp >> shift) * 1000000000
+                    + static_cast<int64_t>(std::ldexp(static_cast<double>(fraction), -shift) * 1e9);
+    }
+    else
+    {
+      int64_t scale = 1;
+      for (int i = this->Resolution; i < 9; ++i)
+      {
+        scale *= 10;
+      }
+      for (int i = 9; i < this->Resolution; ++i)
+      {
+        timestamp /= 10;
+      }
+      nanoseconds = static_cast<int64_t>(timestamp) * scale;
+    }
+    return nanoseconds + this->OffsetSeconds * 1000000000;
+  }
+};
+
+//! @brief Section of a pcapng file: its byte order, and the interfaces described so far.
+struct PcapngSection
 {
-  // The incrementally reassembled data.
-  std::vector<unsigned char> Data;
-  // Set when the final fragment is encountered.
-  unsigned int ExpectedSize = 0;
-  // Incremented as fragments are added to the data.
-  unsigned int CurrentSize = 0;
+  int64_t Start = 0;
+  bool Swapped = false;
+  //! The interface descriptions located before this offset have all been read
+  int64_t ScannedUpTo = 0;
+  std::vector<PcapngInterface> Interfaces;
 };
 
+/**
+ * @brief Selection of the UDP packets read from a file, by port (source or destination)
+ * and by payload size, an empty list selecting everything.
+ *
+ * It is compiled into a BPF filter, and is also checked directly on the headers by the
+ * memory mapped backend, so that the irrelevant packets of a capture mixing several
+ * sensors are skipped without running the BPF interpreter.
+ * The fragments of IP datagrams are always selected, as neither the ports nor the size
+ * of the datagram can be known from a single fragment. The IPv6 packets are selected
+ * whatever their size, as the udp[] accessors of libpcap only support IPv4.
+ */
+struct UDPPacketSelection
+{
+  std::vector<int> Ports;
+  std::vector<unsigned int> PayloadSizes;
+
+  //! pcap filter expression of the selection
+  std::string GetFilter() const
+  {
+    std::vector<std::string> conditions;
+    if (!this->Ports.empty())
+    {
+      std::string ports;
+      for (int port : this->Ports)
+      {
+        ports += (ports.empty() ? "(port " : " or port ") + std::to_string(port);
+      }
+      conditions.push_back(ports + ")");
+    }
+    if (!this->PayloadSizes.empty())
+    {
+      // the UDP length field includes its 8 bytes header
+      std::string sizes = "(ip6";
+      for (unsigned int size : this->PayloadSizes)
+      {
+        sizes += " or udp[4:2] = " + std::to_string(size + 8);
+      }
+      conditions.push_back(sizes + ")");
+    }
+
+    std::string filter = "udp";
+    if (!conditions.empty())
+    {
+      // "and" and "or" have the same precedence in pcap filters
+      filter += " and (ip[6:2] & 0x3fff != 0 or (";
+      for (size_t i = 0; i < conditions.size(); ++i)
+      {
+        filter += (i > 0 ? " and " : "") + conditions[i];
+      }
+      filter += "))";
+    }
+    return filter;
+  }
+
+  /**
+   * @brief Rejects check from the headers of an unfragmented IPv4 UDP packet that it is
+   * not selected. Any other packet is left to the BPF filter.
+   * @param frame link layer frame of the packet
+   * @param capturedLength number of bytes of the frame
+   * @param frameHeaderLength size of the link layer header
+   */
+  bool Rejects(const unsigned char* frame, unsigned int capturedLength,
+               unsigned int frameHeaderLength) const
+  {
+    if (this->Ports.empty() && this->PayloadSizes.empty())
+    {
+      return false;
+    }
+    const unsigned char* ip = frame + frameHeaderLength;
+    if (capturedLength < frameHeaderLength + 20 || (ip[0] >> 4) != 4 || ip[9] != 17
+        || (frameHeaderLength == 14 && (frame[12] != 0x08 || frame[13] != 0x00))
+        || (ip[6] & 0x3f) != 0 || ip[7] != 0)
+    {
+      return false;
+    }
+    const unsigned int ipHeaderLength = (ip[0] & 0xf) * 4;
+    if (capturedLength < frameHeaderLength + ipHeaderLength + 8)
+    {
+      return false;
+    }
+    const unsigned char* udp = ip + ipHeaderLength;
+    const int sourcePort = 0x100 * udp[0] + udp[1];
+    const int destinationPort = 0x100 * udp[2] + udp[3];
+    const unsigned int udpLength = 0x100 * udp[4] + udp[5];
+    if (!this->Ports.empty() &&
+        std::find(this->Ports.begin(), this->Ports.end(), sourcePort) == this->Ports.end() &&
+        std::find(this->Ports.begin(), this->Ports.end(), destinationPort) == this->Ports.end())
+    {
+      return true;
+    }
+    return !this->PayloadSizes.empty() &&
+      std::find(this->PayloadSizes.begin(), this->PayloadSizes.end(), udpLength - 8) ==
+      this->PayloadSizes.end();
+  }
+};
 
 
 class vtkPacketFileReader
@@ -69,6 +242,11 @@ public:
     this->PCAPFile = 0;
   }
 
+  // The position handed out by the memory mapped backend is the byte offset in the file,
+  // stored in the first bytes of the fpos_t. This matches the layout of fpos_t on
+  // glibc and macOS, so positions are interchangeable between both backends.
+  static_assert(sizeof(fpos_t) >= sizeof(int64_t), "fpos_t is too small to store an offset");
+
   ~vtkPacketFileReader()
   {
     this->Close();
@@ -79,27 +257,76 @@ public:
   // 2-A packet filter is then compile to convert an high level filtering
   //  expression in a program that can be interpreted by the kernel-level filtering engine
   // 3- The compiled filter is then associate to the capture
-  bool Open(const std::string& filename, std::string filter_arg="udp")
+  // 4- Optionally, on POSIX system, the file is mapped in memory so that the packets
+  //  are returned without any copy, straight from the mapped pages
+  // A gzip compressed file, or a file served over http, can not be read by libpcap: its
+  // records are read from its content loaded by chunks as from a mapped file, libpcap
+  // only compiling the filter.
+  bool Open(const std::string& filename, std::string filter_arg="udp",
+            bool useMemoryMapping = false)
   {
+    this->Selection = UDPPacketSelection();
     char errbuff[PCAP_ERRBUF_SIZE];
-    pcap_t* pcapFile = pcap_open_offline(filename.c_str(), errbuff);
+    std::unique_ptr<ChunkedFile> chunked;
+    pcap_t* pcapFile = nullptr;
+    if (RemotePcapFile::IsRemote(filename))
+    {
+      RemotePcapFile* remote = new RemotePcapFile;
+      chunked.reset(remote);
+      if (!remote->Open(filename))
+      {
+        this->LastError = remote->GetLastError();
+        return false;
+      }
+    }
+    else if (CompressedPcapFile::IsCompressed(filename))
+    {
+      CompressedPcapFile* compressed = new CompressedPcapFile;
+      chunked.reset(compressed);
+      if (!compressed->Open(filename))
+      {
+        this->LastError = compressed->GetLastError();
+        return false;
+      }
+    }
+
+    if (chunked)
+    {
+      // the header of the file gives the link type of the packets
+      this->Chunked = std::move(chunked);
+      this->MappedSize = this->Chunked->GetSize();
+      uint32_t linktype = 0;
+      if (this->InitMappedFormat(linktype))
+      {
+        pcapFile = pcap_open_dead(static_cast<int>(linktype), 262144);
+      }
+    }
+    else
+    {
+      pcapFile = pcap_open_offline(filename.c_str(), errbuff);
+    }
     if (!pcapFile)
     {
-      this->LastError = errbuff;
+      this->LastError = this->Chunked ? "Could not read the file header." : errbuff;
+      this->UnmapFile();
       return false;
     }
 
-    bpf_program filter;
-
-    if (pcap_compile(pcapFile, &filter, filter_arg.c_str(), 0, PCAP_NETMASK_UNKNOWN) == -1)
+    if (pcap_compile(pcapFile, &this->Filter, filter_arg.c_str(), 0, PCAP_NETMASK_UNKNOWN) == -1)
     {
       this->LastError = pcap_geterr(pcapFile);
+      this->UnmapFile();
+      pcap_close(pcapFile);
       return false;
     }
+    this->HasFilter = true;
 
-    if (pcap_setfilter(pcapFile, &filter) == -1)
+    // the filter of a chunked file is applied while reading its records
+    if (!this->Chunked && pcap_setfilter(pcapFile, &this->Filter) == -1)
     {
       this->LastError = pcap_geterr(pcapFile);
+      this->FreeFilter();
+      pcap_close(pcapFile);
       return false;
     }
 
@@ -116,32 +343,243 @@ public:
         break;
       default:
         this->LastError = "Unknown link type in pcap file. Cannot tell where the payload is.";
+        this->UnmapFile();
+        this->FreeFilter();
+        pcap_close(pcapFile);
         return false;
     }
 
     this->FileName = filename;
     this->PCAPFile = pcapFile;
     this->StartTime.tv_sec = this->StartTime.tv_usec = 0;
+
+    // If the file can not be mapped (unsupported platform, ...)
+    // silently fallback to the libpcap backend
+    if (!this->Chunked && useMemoryMapping)
+    {
+      this->MapFile(filename);
+    }
     return true;
   }
+
+  //! Open a file, only reading the packets of the selection
+  bool Open(const std::string& filename, const UDPPacketSelection& selection,
+            bool useMemoryMapping = false)
+  {
+    if (!this->Open(filename, selection.GetFilter(), useMemoryMapping))
+    {
+      return false;
+    }
+    this->Selection = selection;
+    return true;
+  }
+
   bool IsOpen() { return (this->PCAPFile != 0); }
 
+  //! True if the packets are read from a memory mapped file, or from the content of a
+  //! compressed or remote file, instead of libpcap
+  bool IsMemoryMapped() { return (this->MappedData != nullptr || this->Chunked != nullptr); }
+
+  //! Size of the memory mapped file (uncompressed), 0 if the memory mapped backend is not used
+  int64_t GetMappedFileSize() { return this->MappedSize; }
+
+  //! Offset of the next record to read in the memory mapped file
+  int64_t GetMappedOffset() { return this->MappedOffset; }
+
+  /**
+   * @brief SynchronizeOnRecord move to the first pcap record header located at or after
+   * the given offset. This only works with the memory mapped backend, and is used to start
+   * reading a file from an arbitrary position.
+   * A candidate header is only accepted if the records following it are consistent too,
+   * this make very unlikely to synchronize in the middle of a packet payload.
+   * @param offset position in bytes in the file
+   * @return false if no record has been found
+   */
+  bool SynchronizeOnRecord(int64_t offset)
+  {
+    if (!this->IsMemoryMapped())
+    {
+      return false;
+    }
+    const int numberOfRecordsToCheck = 8;
+    if (this->MappedIsPcapng)
+    {
+      // the pcapng blocks are aligned on 32 bits, and end with their length
+      for (int64_t candidate = (std::max(offset, int64_t(0)) + 3) & ~int64_t(3);
+           candidate + 12 <= this->MappedSize; candidate += 4)
+      {
+        int64_t current = candidate;
+        bool isValid = true;
+        for (int i = 0; i < numberOfRecordsToCheck && isValid && current < this->MappedSize; ++i)
+        {
+          uint32_t type = 0, length = 0;
+          isValid = this->ReadPcapngBlockHeader(current, type, length)
+                    && (type <= 0x0000000a || type == PcapngSectionHeaderBlock
+                        || (type & 0x7fffffff) == 0x00000bad);
+          const unsigned char* trailer = isValid ? this->GetMappedBytes(current + length - 4, 4) : nullptr;
+          isValid = trailer && ReadPcapng32(trailer, type == PcapngSectionHeaderBlock ? false
+                      : this->PcapngSections[this->GetPcapngSection(current)].Swapped) == length;
+          current += length;
+        }
+        if (isValid)
+        {
+          this->MappedOffset = candidate;
+          return true;
+        }
+      }
+      return false;
+    }
+    int64_t candidate = std::max(offset, static_cast<int64_t>(24));
+    for (; candidate + static_cast<int64_t>(sizeof(PcapRecordHeader)) <= this->MappedSize; ++candidate)
+    {
+      int64_t current = candidate;
+      uint32_t previousSeconds = 0;
+      bool isValid = true;
+      for (int i = 0; i < numberOfRecordsToCheck && isValid && current < this->MappedSize; ++i)
+      {
+        PcapRecordHeader record;
+        isValid = this->ReadMappedRecordHeader(current, record)
+                  && this->IsMappedRecordHeaderValid(record)
+                  && (i == 0 || (std::max(record.TimestampSeconds, previousSeconds)
+                               - std::min(record.TimestampSeconds, previousSeconds)) < 3600);
+        previousSeconds = record.TimestampSeconds;
+        current += sizeof(PcapRecordHeader) + record.CapturedLength;
+        isValid = isValid && current <= this->MappedSize;
+      }
+      if (isValid)
+      {
+        this->MappedOffset = candidate;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief BuildTimeIndex sample the timestamp of the first packet found every stride bytes
+   * of the file, so that SeekToTime can find a time without reading the whole file. Only
+   * the pages around the samples are read. This only works with the memory mapped backend,
+   * the read position is restored.
+   * @param stride distance in bytes between two samples
+   * @return false if no packet has been found
+   */
+  bool BuildTimeIndex(int64_t stride = 32 * 1024 * 1024)
+  {
+    this->TimeIndex.clear();
+    if (!this->IsMemoryMapped() || stride <= 0)
+    {
+      return false;
+    }
+    const int64_t savedOffset = this->MappedOffset;
+    for (int64_t offset = 0; offset < this->MappedSize && this->SynchronizeOnRecord(offset);
+         offset += stride)
+    {
+      // a record larger than the stride is only sampled once
+      const int64_t recordOffset = this->MappedOffset;
+      if (!this->TimeIndex.empty() && recordOffset <= this->TimeIndex.back().Offset)
+      {
+        continue;
+      }
+      pcap_pkthdr* header = nullptr;
+      const unsigned char* data = nullptr;
+      if (this->NextMappedPacket(&header, &data) < 0)
+      {
+        break;
+      }
+      this->TimeIndex.push_back({ recordOffset, this->PacketNanoseconds });
+    }
+    this->MappedOffset = savedOffset;
+    return !this->TimeIndex.empty();
+  }
+
+  //! Samples of the time index, sorted by offset, empty until BuildTimeIndex is called
+  const std::vector<PcapTimeSample>& GetTimeIndex() const { return this->TimeIndex; }
+
+  /**
+   * @brief SeekToTime move to the first packet whose timestamp is at or after the given
+   * time. The time index, built with the default stride if needed, is binary searched for
+   * the last sample before this time, then the packets are read from there. The timestamps
+   * are expected to increase through the file, as in a capture. This only works with the
+   * memory mapped backend.
+   * @param nanoseconds time since the epoch
+   * @return false if there is no packet at or after this time, the reader is then at the
+   * end of the file
+   */
+  bool SeekToTime(int64_t nanoseconds)
+  {
+    if (this->TimeIndex.empty() && !this->BuildTimeIndex())
+    {
+      return false;
+    }
+    auto sample = std::lower_bound(this->TimeIndex.begin(), this->TimeIndex.end(), nanoseconds,
+      [](const PcapTimeSample& s, int64_t time) { return s.Nanoseconds < time; });
+    this->MappedOffset = (sample == this->TimeIndex.begin() ? sample : sample - 1)->Offset;
+    while (true)
+    {
+      const int64_t recordOffset = this->MappedOffset;
+      pcap_pkthdr* header = nullptr;
+      const unsigned char* data = nullptr;
+      if (this->NextMappedPacket(&header, &data) < 0)
+      {
+        this->MappedOffset = this->MappedSize;
+        return false;
+      }
+      if (this->PacketNanoseconds >= nanoseconds)
+      {
+        this->MappedOffset = recordOffset;
+        this->PrefetchMappedData();
+        return true;
+      }
+    }
+  }
+
   void Close()
   {
     if (this->PCAPFile)
     {
+      this->UnmapFile();
+      this->FreeFilter();
       pcap_close(this->PCAPFile);
       this->PCAPFile = 0;
       this->FileName.clear();
+      this->Fragments.Clear();
+      this->RemoveAssembled = false;
+      this->TimeIndex.clear();
     }
   }
 
+  /**
+   * @brief SetSequentialAccess hint the kernel that the file is going to be read
+   * sequentially (ex: when building a frame catalog) or not (ex: scrubbing). This
+   * only has an effect with the memory mapped backend.
+   */
+  void SetSequentialAccess(bool sequential)
+  {
+#ifndef _MSC_VER
+    if (this->MappedData)
+    {
+      madvise(this->MappedData, this->MappedSize, sequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+    }
+#endif
+    this->SequentialAccess = sequential;
+  }
+
   const std::string& GetLastError() { return this->LastError; }
 
+  //! Timestamp of the last packet read in nanoseconds since the epoch, with the full
+  //! resolution of the memory mapped backend and microseconds otherwise
+  int64_t GetPacketTimestampNanoseconds() const { return this->PacketNanoseconds; }
+
   const std::string& GetFileName() { return this->FileName; }
 
   void GetFilePosition(fpos_t* position)
   {
+    if (this->IsMemoryMapped())
+    {
+      std::memset(position, 0, sizeof(fpos_t));
+      std::memcpy(position, &this->MappedOffset, sizeof(this->MappedOffset));
+      return;
+    }
 #ifdef _MSC_VER
     pcap_fgetpos(this->PCAPFile, position);
 #else
@@ -151,7 +589,13 @@ public:
   }
 
   void SetFilePosition(fpos_t* position)
-{
+  {
+    if (this->IsMemoryMapped())
+    {
+      std::memcpy(&this->MappedOffset, position, sizeof(this->MappedOffset));
+      this->PrefetchMappedData();
+      return;
+    }
 #ifdef _MSC_VER
     pcap_fsetpos(this->PCAPFile, position);
 #else
@@ -168,14 +612,12 @@ public:
       return false;
     }
 
-    // Delete reassembled fragment data from the previous call, if any. This
+    // Free the slot of the datagram reassembled by the previous call, if any. This
     // cannot be done earlier because it would invalidate the data before it is
     // returned.
     if (this->RemoveAssembled)
     {
-      auto it = this->Fragments.find(this->AssembledId);
-      this->Fragments.erase(it);
-      this->AssembledId = 0;
+      this->Fragments.Release(this->AssembledKey);
       this->RemoveAssembled = false;
     }
 
@@ -189,12 +631,18 @@ public:
       unsigned char const * tmpData = nullptr;
       unsigned int tmpDataLength;
 
-      int returnValue = pcap_next_ex(this->PCAPFile, &header, &tmpData);
+      int returnValue = this->IsMemoryMapped() ? this->NextMappedPacket(&header, &tmpData)
+                                         : pcap_next_ex(this->PCAPFile, &header, &tmpData);
       if (returnValue < 0)
       {
         this->Close();
         return false;
       }
+      if (!this->IsMemoryMapped())
+      {
+        this->PacketNanoseconds =
+          int64_t(header->ts.tv_sec) * 1000000000 + int64_t(header->ts.tv_usec) * 1000;
+      }
 
       // Collect header values before they are removed.
       uint16_t identification = 0x100 * tmpData[0x12] + tmpData[0x13];
@@ -203,10 +651,13 @@ public:
       fragmentOffset = (tmpData[0x14] & 0x1F) * 0x100 + tmpData[0x15];
 
       // Only return the payload.
-      // We read the actual IP header length (v4 & v6) + assumes UDP
+      // We read the actual IP header length (v4 & v6) + assumes UDP. Only the
+      // first fragment of a datagram starts with the UDP header
+      const bool isFragment = moreFragments || fragmentOffset > 0;
       const unsigned int ipHeaderLength = (tmpData[this->FrameHeaderLength + 0] & 0xf) * 4;
-      const unsigned int udpHeaderLength = 8;
+      const unsigned int udpHeaderLength = (fragmentOffset == 0) ? 8 : 0;
       const unsigned int bytesToSkip = this->FrameHeaderLength + ipHeaderLength + udpHeaderLength;
+      const unsigned char* sourceIP = tmpData + this->FrameHeaderLength + 12;
 
       tmpDataLength = header->len - bytesToSkip;
       if (header->len > header->caplen)
@@ -221,52 +672,27 @@ public:
       }
 
       // pcap_next_ex may reallocate the buffers it returns so the data must be
-      // copied between each call.
-      if (dataLength > 0 || moreFragments || fragmentOffset > 0)
+      // copied between each call. The memory mapped backend does not have this
+      // issue, but fragments still need to be reassembled in a contiguous buffer.
+      // The fragments are copied in the preallocated slots of the fragment table.
+      if (isFragment)
       {
-        decltype(tmpDataLength) offset = fragmentOffset * FRAGMENT_OFFSET_STEP;
-        unsigned requiredSize = offset + tmpDataLength;
-
-        auto & fragmentTracker = this->Fragments[identification];
-        auto & reassembledData = fragmentTracker.Data;
-
-        if (requiredSize > reassembledData.size())
+        // the offset is in the IP payload, which starts with the UDP header
+        const unsigned int offset = (fragmentOffset == 0) ? 0 :
+          fragmentOffset * FRAGMENT_OFFSET_STEP - 8;
+        const uint64_t key = IPFragmentTable::MakeKey(sourceIP, identification);
+        if (this->Fragments.AddFragment(key, offset, tmpData, tmpDataLength, moreFragments,
+                                        header->ts.tv_sec + 1e-6 * header->ts.tv_usec,
+                                        data, dataLength))
         {
-          reassembledData.resize(requiredSize);
-        }
-        std::copy(tmpData, tmpData + tmpDataLength, reassembledData.begin() + offset);
-
-        // Update current size, which represents the total number of bytes
-        // collected in the reassembled packet.
-        fragmentTracker.CurrentSize += tmpDataLength;
-
-        // There may be gaps of size FRAGMENT_OFFSET_STEP between fragments. Add
-        // this to the current size.
-        //
-        // Note that this assumes that <number of fragments - 1> *
-        // FRAGMENT_OFFSET_STEP is never larger than any given fragment so that
-        // it will not be omitted accidentally.
-        if (moreFragments)
-        {
-          fragmentTracker.CurrentSize += FRAGMENT_OFFSET_STEP;
-        }
-        // Set the expected size if this is the final fragment.
-        else
-        {
-          fragmentTracker.ExpectedSize = requiredSize;
-        }
-
-
-        // Return the packet if it's complete.
-        if (fragmentTracker.ExpectedSize > 0 && fragmentTracker.CurrentSize >= fragmentTracker.ExpectedSize)
-        {
-          data = reassembledData.data();
-          dataLength = reassembledData.size();
-          // Delete the associated data on the next iteration.
-          this->AssembledId = identification;
+          // Free the slot on the next call
+          this->AssembledKey = key;
           this->RemoveAssembled = true;
           return true;
         }
+        // wait for the next fragments
+        moreFragments = true;
+        dataLength = 0;
       }
       else
       {
@@ -279,25 +705,534 @@ public:
     return true;
   }
 
+  //! Reverse the byte order of a field of a pcap file written on a platform of another endianness
+  static uint32_t SwapBytes(uint32_t value)
+  {
+    return ((value & 0x000000ff) << 24) | ((value & 0x0000ff00) << 8)
+         | ((value & 0x00ff0000) >> 8)  | ((value & 0xff000000) >> 24);
+  }
+
 protected:
   double GetElapsedTime(const timeval& end, const timeval& start)
   {
     return (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.00;
   }
 
+  void FreeFilter()
+  {
+    if (this->HasFilter)
+    {
+      pcap_freecode(&this->Filter);
+      this->HasFilter = false;
+    }
+  }
+
+  /**
+   * Read the header of the mapped or chunked file, and move to its first record: the
+   * global header of a classic pcap, or the first section of a pcapng, with the sections
+   * following it as long as their length is known.
+   * @param linktype[out] link type of the packets, those of the pcapng interfaces of
+   * another link type being skipped
+   */
+  bool InitMappedFormat(uint32_t& linktype)
+  {
+    this->PcapngSections.clear();
+    this->MappedIsPcapng = false;
+    const unsigned char* header = this->GetMappedBytes(0, 24);
+    uint32_t magic = 0;
+    if (header)
+    {
+      std::memcpy(&magic, header, sizeof(magic));
+      std::memcpy(&linktype, header + 20, sizeof(linktype));
+    }
+    switch (magic)
+    {
+      case 0xa1b2c3d4: this->MappedSwapped = false; this->MappedNanoseconds = false; break;
+      case 0xd4c3b2a1: this->MappedSwapped = true;  this->MappedNanoseconds = false; break;
+      case 0xa1b23c4d: this->MappedSwapped = false; this->MappedNanoseconds = true;  break;
+      case 0x4d3cb2a1: this->MappedSwapped = true;  this->MappedNanoseconds = true;  break;
+      case PcapngSectionHeaderBlock:
+      {
+        this->MappedIsPcapng = true;
+        for (int64_t offset = 0; offset >= 0 && offset < this->MappedSize;)
+        {
+          offset = this->RegisterPcapngSection(offset);
+        }
+        if (this->PcapngSections.empty())
+        {
+          return false;
+        }
+        this->ScanPcapngInterfaces(0, this->MappedSize, true);
+        if (this->PcapngSections[0].Interfaces.empty())
+        {
+          return false;
+        }
+        // the packets captured on the first ethernet or loopback interface are read
+        const std::vector<PcapngInterface>& interfaces = this->PcapngSections[0].Interfaces;
+        auto supported = std::find_if(interfaces.begin(), interfaces.end(),
+          [](const PcapngInterface& description)
+          { return description.LinkType == DLT_EN10MB || description.LinkType == DLT_NULL; });
+        linktype = (supported != interfaces.end() ? *supported : interfaces.front()).LinkType;
+        this->MappedLinkType = linktype;
+        this->MappedOffset = 0;
+        return true;
+      }
+      default:
+        return false;
+    }
+    linktype = this->MappedSwapped ? SwapBytes(linktype) : linktype;
+    this->MappedLinkType = linktype;
+    // skip the global header
+    this->MappedOffset = 24;
+    return true;
+  }
+
+  // Map the whole pcap or pcapng file in memory
+  bool MapFile(const std::string& filename)
+  {
+#ifdef _MSC_VER
+    (void)filename;
+    return false;
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+      return false;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size < 24)
+    {
+      close(fd);
+      return false;
+    }
+    void* mapped = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid once the file descriptor is closed
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+      return false;
+    }
+
+    this->MappedData = static_cast<unsigned char*>(mapped);
+    this->MappedSize = static_cast<int64_t>(fileStat.st_size);
+    // libpcap already gave the link type of the packets
+    uint32_t linktype = 0;
+    if (!this->InitMappedFormat(linktype) || static_cast<int>(linktype) != pcap_datalink(this->PCAPFile))
+    {
+      this->UnmapFile();
+      return false;
+    }
+    this->SetSequentialAccess(this->SequentialAccess);
+    return true;
+#endif
+  }
+
+  void UnmapFile()
+  {
+#ifndef _MSC_VER
+    if (this->MappedData)
+    {
+      munmap(this->MappedData, this->MappedSize);
+    }
+#endif
+    this->MappedData = nullptr;
+    this->Chunked.reset();
+    this->MappedSize = 0;
+    this->MappedOffset = 0;
+  }
+
+  // Ask the kernel to start loading the pages that will be read next
+  void PrefetchMappedData()
+  {
+#ifndef _MSC_VER
+    // a chunked file loads its next chunks by its own threads
+    if (!this->MappedData)
+    {
+      return;
+    }
+    const int64_t prefetchSize = 8 * 1024 * 1024;
+    const int64_t pageSize = sysconf(_SC_PAGESIZE);
+    int64_t start = (this->MappedOffset / pageSize) * pageSize;
+    if (start >= this->MappedSize)
+    {
+      return;
+    }
+    int64_t length = std::min(prefetchSize, this->MappedSize - start);
+    madvise(this->MappedData + start, length, MADV_WILLNEED);
+#endif
+  }
+
+  // Bytes of the mapped file, or of the content of the chunked file. The latter are only
+  // valid until the next call
+  const unsigned char* GetMappedBytes(int64_t offset, size_t length)
+  {
+    if (offset + static_cast<int64_t>(length) > this->MappedSize)
+    {
+      return nullptr;
+    }
+    return this->MappedData ? this->MappedData + offset : this->Chunked->GetBytes(offset, length);
+  }
+
+  // Read the record header located at offset in the mapped file, in the host byte order
+  bool ReadMappedRecordHeader(int64_t offset, PcapRecordHeader& record)
+  {
+    const unsigned char* bytes = this->GetMappedBytes(offset, sizeof(PcapRecordHeader));
+    if (!bytes)
+    {
+      return false;
+    }
+    std::memcpy(&record, bytes, sizeof(record));
+    if (this->MappedSwapped)
+    {
+      record.TimestampSeconds = SwapBytes(record.TimestampSeconds);
+      record.TimestampFraction = SwapBytes(record.TimestampFraction);
+      record.CapturedLength = SwapBytes(record.CapturedLength);
+      record.OriginalLength = SwapBytes(record.OriginalLength);
+    }
+    return true;
+  }
+
+  // Sanity check of a record header, used to synchronize on records
+  bool IsMappedRecordHeaderValid(const PcapRecordHeader& record)
+  {
+    const uint32_t maximumFraction = this->MappedNanoseconds ? 1000000000 : 1000000;
+    return record.CapturedLength > 0 && record.CapturedLength <= record.OriginalLength
+           && record.CapturedLength <= 262144 && record.TimestampFraction < maximumFraction;
+  }
+
+  // Same contract as pcap_next_ex, except that the data points straight into the mapped file
+  int NextMappedPacket(pcap_pkthdr** header, const unsigned char** data)
+  {
+    if (this->MappedIsPcapng)
+    {
+      return this->NextPcapngPacket(header, data);
+    }
+    while (true)
+    {
+      PcapRecordHeader record;
+      if (!this->ReadMappedRecordHeader(this->MappedOffset, record))
+      {
+        return -2;
+      }
+      const int64_t packetOffset = this->MappedOffset + sizeof(PcapRecordHeader);
+      if (packetOffset + record.CapturedLength > this->MappedSize)
+      {
+        // truncated record
+        return -1;
+      }
+      this->MappedOffset = packetOffset + record.CapturedLength;
+
+      this->SetMappedHeader(int64_t(record.TimestampSeconds) * 1000000000
+                              + record.TimestampFraction * (this->MappedNanoseconds ? 1 : 1000),
+                            record.CapturedLength, record.OriginalLength);
+      const unsigned char* packet = this->GetMappedBytes(packetOffset, record.CapturedLength);
+      if (!packet)
+      {
+        return -1;
+      }
+      if (this->AcceptMappedPacket(packet))
+      {
+        *header = &this->MappedHeader;
+        *data = packet;
+        return 1;
+      }
+    }
+  }
+
+  void SetMappedHeader(int64_t nanoseconds, uint32_t capturedLength, uint32_t originalLength)
+  {
+    this->PacketNanoseconds = nanoseconds;
+    this->MappedHeader.ts.tv_sec = nanoseconds / 1000000000;
+    this->MappedHeader.ts.tv_usec = (nanoseconds % 1000000000) / 1000;
+    this->MappedHeader.caplen = capturedLength;
+    this->MappedHeader.len = originalLength;
+  }
+
+  // Skip the packets rejected by their headers, then apply the same filter as libpcap would
+  bool AcceptMappedPacket(const unsigned char* packet)
+  {
+    return !this->Selection.Rejects(packet, this->MappedHeader.caplen, this->FrameHeaderLength)
+      && (!this->HasFilter || pcap_offline_filter(&this->Filter, &this->MappedHeader, packet) != 0);
+  }
+
+  //! Read a 16 or 32 bits field of a pcapng block
+  static uint32_t ReadPcapng32(const unsigned char* bytes, bool swapped)
+  {
+    uint32_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return swapped ? SwapBytes(value) : value;
+  }
+  static uint16_t ReadPcapng16(const unsigned char* bytes, bool swapped)
+  {
+    uint16_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return swapped ? static_cast<uint16_t>((value >> 8) | (value << 8)) : value;
+  }
+
+  // Index of the section containing offset, the first section starting the file
+  size_t GetPcapngSection(int64_t offset)
+  {
+    auto next = std::upper_bound(this->PcapngSections.begin(), this->PcapngSections.end(), offset,
+      [](int64_t value, const PcapngSection& section) { return value < section.Start; });
+    return next == this->PcapngSections.begin() ? 0 : std::distance(this->PcapngSections.begin(), next) - 1;
+  }
+
+  // Type and total length of the block located at offset, checking that it fits in the file
+  bool ReadPcapngBlockHeader(int64_t offset, uint32_t& type, uint32_t& length)
+  {
+    const unsigned char* bytes = this->GetMappedBytes(offset, 12);
+    if (!bytes)
+    {
+      return false;
+    }
+    std::memcpy(&type, bytes, sizeof(type));
+    bool swapped = false;
+    if (type == PcapngSectionHeaderBlock)
+    {
+      // the byte order magic of the section header gives the byte order of its section
+      const uint32_t byteOrder = ReadPcapng32(bytes + 8, false);
+      if (byteOrder != 0x1a2b3c4d && byteOrder != 0x4d3c2b1a)
+      {
+        return false;
+      }
+      swapped = byteOrder != 0x1a2b3c4d;
+    }
+    else if (!this->PcapngSections.empty())
+    {
+      swapped = this->PcapngSections[this->GetPcapngSection(offset)].Swapped;
+      type = swapped ? SwapBytes(type) : type;
+    }
+    length = ReadPcapng32(bytes + 4, swapped);
+    return length >= 12 && length % 4 == 0 && offset + length <= this->MappedSize;
+  }
+
+  // Register the section whose header is located at offset
+  // @return the offset of the next section if the length of this one is known, -1 otherwise
+  int64_t RegisterPcapngSection(int64_t offset)
+  {
+    uint32_t type = 0, length = 0;
+    const unsigned char* bytes = nullptr;
+    if (!this->ReadPcapngBlockHeader(offset, type, length) || type != PcapngSectionHeaderBlock
+        || length < 28 || !(bytes = this->GetMappedBytes(offset, 24)))
+    {
+      return -1;
+    }
+    PcapngSection section;
+    section.Start = offset;
+    section.Swapped = ReadPcapng32(bytes + 8, false) != 0x1a2b3c4d;
+    section.ScannedUpTo = offset + length;
+    uint64_t sectionLength;
+    std::memcpy(&sectionLength, bytes + 16, sizeof(sectionLength));
+    if (section.Swapped)
+    {
+      sectionLength = (uint64_t(SwapBytes(static_cast<uint32_t>(sectionLength))) << 32)
+                      | SwapBytes(static_cast<uint32_t>(sectionLength >> 32));
+    }
+
+    auto next = std::upper_bound(this->PcapngSections.begin(), this->PcapngSections.end(), offset,
+      [](int64_t value, const PcapngSection& known) { return value < known.Start; });
+    if (next == this->PcapngSections.begin() || (next - 1)->Start != offset)
+    {
+      this->PcapngSections.insert(next, section);
+    }
+    return sectionLength == ~uint64_t(0) ? -1 : offset + length + static_cast<int64_t>(sectionLength);
+  }
+
+  // Add the interface described by the block located at offset to its section
+  void RegisterPcapngInterface(PcapngSection& section, int64_t offset, uint32_t length)
+  {
+    const unsigned char* bytes = this->GetMappedBytes(offset, length);
+    if (!bytes || length < 20)
+    {
+      return;
+    }
+    PcapngInterface description;
+    description.LinkType = ReadPcapng16(bytes + 8, section.Swapped);
+    description.SnapLength = ReadPcapng32(bytes + 12, section.Swapped);
+    // options, each one padded to 32 bits
+    for (uint32_t option = 16; option + 4 <= length - 4;)
+    {
+      const uint16_t code = ReadPcapng16(bytes + option, section.Swapped);
+      const uint16_t optionLength = ReadPcapng16(bytes + option + 2, section.Swapped);
+      if (code == 0 || option + 4 + optionLength > length - 4)
+      {
+        break;
+      }
+      if (code == 9 && optionLength >= 1)
+      {
+        description.BinaryResolution = (bytes[option + 4] & 0x80) != 0;
+        description.Resolution = bytes[option + 4] & 0x7f;
+      }
+      else if (code == 14 && optionLength >= 8)
+      {
+        const uint64_t low = ReadPcapng32(bytes + option + 4, section.Swapped);
+        const uint64_t high = ReadPcapng32(bytes + option + 8, section.Swapped);
+        description.OffsetSeconds = static_cast<int64_t>(section.Swapped ? (low << 32) | high
+                                                                          : (high << 32) | low);
+      }
+      option += 4 + ((optionLength + 3) & ~3u);
+    }
+    section.Interfaces.push_back(description);
+  }
+
+  // Read the interface descriptions of a section located before the given offset, which
+  // have not been read yet. It stops at the end of the section, or at the first packet
+  // block if stopAtFirstPacket
+  void ScanPcapngInterfaces(size_t sectionIndex, int64_t end, bool stopAtFirstPacket)
+  {
+    PcapngSection& section = this->PcapngSections[sectionIndex];
+    uint32_t type = 0, length = 0;
+    while (section.ScannedUpTo < end && this->ReadPcapngBlockHeader(section.ScannedUpTo, type, length)
+           && type != PcapngSectionHeaderBlock)
+    {
+      if (stopAtFirstPacket && (type == PcapngEnhancedPacketBlock || type == PcapngSimplePacketBlock
+                                || type == PcapngObsoletePacketBlock))
+      {
+        return;
+      }
+      if (type == PcapngInterfaceDescriptionBlock)
+      {
+        this->RegisterPcapngInterface(section, section.ScannedUpTo, length);
+      }
+      section.ScannedUpTo += length;
+    }
+  }
+
+  // NextMappedPacket for a pcapng file
+  int NextPcapngPacket(pcap_pkthdr** header, const unsigned char** data)
+  {
+    while (true)
+    {
+      const int64_t blockOffset = this->MappedOffset;
+      uint32_t type = 0, length = 0;
+      if (!this->ReadPcapngBlockHeader(blockOffset, type, length))
+      {
+        return blockOffset >= this->MappedSize ? -2 : -1;
+      }
+      this->MappedOffset = blockOffset + length;
+      if (type == PcapngSectionHeaderBlock)
+      {
+        this->RegisterPcapngSection(blockOffset);
+        continue;
+      }
+
+      // the interface descriptions are registered as they are read in sequence
+      const size_t sectionIndex = this->GetPcapngSection(blockOffset);
+      if (blockOffset == this->PcapngSections[sectionIndex].ScannedUpTo)
+      {
+        if (type == PcapngInterfaceDescriptionBlock)
+        {
+          this->RegisterPcapngInterface(this->PcapngSections[sectionIndex], blockOffset, length);
+        }
+        this->PcapngSections[sectionIndex].ScannedUpTo = this->MappedOffset;
+      }
+
+      // fixed fields of the packet blocks
+      const bool swapped = this->PcapngSections[sectionIndex].Swapped;
+      uint32_t interfaceId = 0, capturedLength = 0, originalLength = 0;
+      uint64_t timestamp = 0;
+      uint32_t dataOffset = 28;
+      const unsigned char* fields = nullptr;
+      if ((type == PcapngEnhancedPacketBlock || type == PcapngObsoletePacketBlock) && length >= 32
+          && (fields = this->GetMappedBytes(blockOffset + 8, 20)))
+      {
+        interfaceId = type == PcapngEnhancedPacketBlock ? ReadPcapng32(fields, swapped)
+                                                        : ReadPcapng16(fields, swapped);
+        timestamp = (uint64_t(ReadPcapng32(fields + 4, swapped)) << 32) | ReadPcapng32(fields + 8, swapped);
+        capturedLength = ReadPcapng32(fields + 12, swapped);
+        originalLength = ReadPcapng32(fields + 16, swapped);
+      }
+      else if (type == PcapngSimplePacketBlock && length >= 16
+               && (fields = this->GetMappedBytes(blockOffset + 8, 4)))
+      {
+        // the simple packets are captured on the first interface, without timestamp
+        dataOffset = 12;
+        originalLength = ReadPcapng32(fields, swapped);
+        capturedLength = std::min(originalLength, length - 16);
+      }
+      else
+      {
+        continue;
+      }
+      if (dataOffset + capturedLength + 4 > length)
+      {
+        // corrupted block
+        return -1;
+      }
+
+      // the descriptions of the interfaces are read again if the reading started after them
+      if (interfaceId >= this->PcapngSections[sectionIndex].Interfaces.size())
+      {
+        this->ScanPcapngInterfaces(sectionIndex, blockOffset, false);
+      }
+      const std::vector<PcapngInterface>& interfaces = this->PcapngSections[sectionIndex].Interfaces;
+      if (interfaceId >= interfaces.size() || interfaces[interfaceId].LinkType != this->MappedLinkType)
+      {
+        continue;
+      }
+      const PcapngInterface& captureInterface = interfaces[interfaceId];
+      if (type == PcapngSimplePacketBlock && captureInterface.SnapLength > 0)
+      {
+        capturedLength = std::min(capturedLength, captureInterface.SnapLength);
+      }
+
+      this->SetMappedHeader(type == PcapngSimplePacketBlock ? 0 : captureInterface.ToNanoseconds(timestamp),
+                            capturedLength, originalLength);
+      const unsigned char* packet = this->GetMappedBytes(blockOffset + dataOffset, capturedLength);
+      if (!packet)
+      {
+        return -1;
+      }
+      if (this->AcceptMappedPacket(packet))
+      {
+        *header = &this->MappedHeader;
+        *data = packet;
+        return 1;
+      }
+    }
+  }
+
   pcap_t* PCAPFile;
   std::string FileName;
   std::string LastError;
   timeval StartTime;
   unsigned int FrameHeaderLength;
 
+  //! @brief Compiled packet filter, also used by the memory mapped backend
+  bpf_program Filter;
+  bool HasFilter = false;
+
+  //! @brief Packets selected when the file has been opened, checked before the filter
+  UDPPacketSelection Selection;
+
+  //! @brief Memory mapped backend state, MappedData is null if it is not used or if the
+  //! records are read from a compressed or remote file
+  unsigned char* MappedData = nullptr;
+  std::unique_ptr<ChunkedFile> Chunked;
+  int64_t MappedSize = 0;
+  int64_t MappedOffset = 0;
+  bool MappedSwapped = false;
+  bool MappedNanoseconds = false;
+  uint32_t MappedLinkType = 0;
+  //! Timestamp of the last packet in nanoseconds since the epoch
+  int64_t PacketNanoseconds = 0;
+
+  //! @brief Sections of a pcapng file read by the memory mapped backend, sorted by offset
+  bool MappedIsPcapng = false;
+  std::vector<PcapngSection> PcapngSections;
+  bool SequentialAccess = false;
+  pcap_pkthdr MappedHeader;
+
+  //! @brief Sparse time index built by BuildTimeIndex
+  std::vector<PcapTimeSample> TimeIndex;
+
 
 private:
-  //! @brief A map of fragmented packet IDs to the collected array of fragments.
-  std::unordered_map<uint16_t, FragmentTracker> Fragments;
+  //! @brief The fragmented datagrams being reassembled.
+  IPFragmentTable Fragments;
 
-  //! @brief The ID of the last completed fragment.
-  uint16_t AssembledId = 0;
+  //! @brief The key of the last reassembled datagram.
+  uint64_t AssembledKey = 0;
 
   //! @brief True if there is a reassembled packet to remove.
   bool RemoveAssembled = false;
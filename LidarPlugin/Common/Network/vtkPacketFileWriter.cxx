@@ -14,7 +14,298 @@
 
 #include "vtkPacketFileWriter.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <cstring>
+#include <deque>
+#include <iostream>
+
+#include <boost/filesystem.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace
+{
+// pcap file format, in the byte order of the host as written by pcap_dump
+struct PcapFileHeader
+{
+  uint32_t Magic = 0xa1b2c3d4;
+  uint16_t VersionMajor = 2;
+  uint16_t VersionMinor = 4;
+  int32_t TimeZone = 0;
+  uint32_t TimestampAccuracy = 0;
+  uint32_t SnapshotLength = 65535;
+  uint32_t LinkType = DLT_EN10MB;
+};
+
+struct PcapRecordHeader
+{
+  uint32_t TimeSeconds;
+  uint32_t TimeMicroseconds;
+  uint32_t CapturedLength;
+  uint32_t OriginalLength;
+};
+
+const int NumberOfWriteRetries = 3;
+
+//--------------------------------------------------------------------------------
+// Name of the n-th file of a rotation, the first one keeps the name given by the user
+std::string GetRotationFileName(const std::string& filename, int index)
+{
+  if (index == 0)
+  {
+    return filename;
+  }
+  const boost::filesystem::path path(filename);
+  char suffix[16];
+  std::snprintf(suffix, sizeof(suffix), "_%03d", index);
+  return (path.parent_path() / (path.stem().string() + suffix + path.extension().string())).string();
+}
+}
+
+//--------------------------------------------------------------------------------
+struct vtkPacketFileWriter::AsyncWriter
+{
+  struct Block
+  {
+    std::vector<unsigned char> Data;
+    //! The block must be written at the beginning of the next file of the rotation
+    bool StartsNewFile = false;
+  };
+
+  // Blocks, free or full, shared with the thread
+  std::vector<Block> Blocks;
+  std::deque<Block*> FreeBlocks;
+  std::deque<Block*> FullBlocks;
+  size_t NumberOfBlocksBeingWritten = 0;
+  bool Stop = false;
+  Statistics Stats;
+  boost::mutex Mutex;
+  boost::condition_variable Condition;
+  std::unique_ptr<boost::thread> Thread;
+
+  // Only used by the thread, once started
+  std::string FileName;
+  FILE* File = nullptr;
+  int FileIndex = 0;
+
+  // Only used by the caller of WritePacket
+  size_t BlockSize = 0;
+  Block* CurrentBlock = nullptr;
+  bool NextBlockStartsNewFile = false;
+  size_t RotationSize = 0;
+  double RotationDuration = 0;
+  size_t CurrentFileSize = 0;
+  double CurrentFileStartTime = -1;
+
+  //------------------------------------------------------------------------------
+  bool OpenFile(const std::string& filename)
+  {
+    this->File = std::fopen(filename.c_str(), "wb");
+    if (!this->File)
+    {
+      return false;
+    }
+    // the blocks are already large, write them without an other copy
+    std::setvbuf(this->File, nullptr, _IONBF, 0);
+    const PcapFileHeader header;
+    return this->Write(reinterpret_cast<const unsigned char*>(&header), sizeof(header));
+  }
+
+  //------------------------------------------------------------------------------
+  bool Write(const unsigned char* data, size_t size)
+  {
+    for (int attempt = 0; attempt <= NumberOfWriteRetries; ++attempt)
+    {
+      const size_t written = std::fwrite(data, 1, size, this->File);
+      data += written;
+      size -= written;
+      if (size == 0)
+      {
+        return true;
+      }
+      // the disk may be busy or full for a moment
+      {
+        boost::mutex::scoped_lock lock(this->Mutex);
+        this->Stats.NumberOfWriteErrors++;
+      }
+      std::clearerr(this->File);
+      boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
+    }
+    boost::mutex::scoped_lock lock(this->Mutex);
+    this->Stats.NumberOfDroppedBytes += size;
+    return false;
+  }
+
+  //------------------------------------------------------------------------------
+  void WriteBlock(const Block& block)
+  {
+    if (block.StartsNewFile)
+    {
+      if (this->File)
+      {
+        std::fclose(this->File);
+        this->File = nullptr;
+      }
+      const std::string filename = GetRotationFileName(this->FileName, ++this->FileIndex);
+      const bool isOpen = this->OpenFile(filename);
+      boost::mutex::scoped_lock lock(this->Mutex);
+      if (!isOpen)
+      {
+        std::cerr << "Failed to open the packet file " << filename << std::endl;
+        this->Stats.NumberOfWriteErrors++;
+      }
+      this->Stats.NumberOfFiles++;
+    }
+    if (!this->File)
+    {
+      boost::mutex::scoped_lock lock(this->Mutex);
+      this->Stats.NumberOfDroppedBytes += block.Data.size();
+      return;
+    }
+    if (!this->Write(block.Data.data(), block.Data.size()))
+    {
+      std::cerr << "Failed to write " << block.Data.size() << " bytes in the packet file" << std::endl;
+    }
+  }
+
+  //------------------------------------------------------------------------------
+  void ThreadLoop()
+  {
+    boost::mutex::scoped_lock lock(this->Mutex);
+    while (true)
+    {
+      while (this->FullBlocks.empty() && !this->Stop)
+      {
+        this->Condition.wait(lock);
+      }
+      if (this->FullBlocks.empty())
+      {
+        return;
+      }
+      Block* block = this->FullBlocks.front();
+      this->FullBlocks.pop_front();
+      this->NumberOfBlocksBeingWritten++;
+
+      lock.unlock();
+      this->WriteBlock(*block);
+      lock.lock();
+
+      this->Stats.WrittenBytes += block->Data.size();
+      block->Data.clear();
+      block->StartsNewFile = false;
+      this->NumberOfBlocksBeingWritten--;
+      this->FreeBlocks.push_back(block);
+      this->Condition.notify_all();
+    }
+  }
+
+  //------------------------------------------------------------------------------
+  //! Give the current block to the thread
+  void Submit()
+  {
+    if (!this->CurrentBlock || (this->CurrentBlock->Data.empty() && !this->CurrentBlock->StartsNewFile))
+    {
+      return;
+    }
+    boost::mutex::scoped_lock lock(this->Mutex);
+    this->FullBlocks.push_back(this->CurrentBlock);
+    this->Stats.MaximumQueuedBlocks = std::max(this->Stats.MaximumQueuedBlocks, this->FullBlocks.size());
+    this->CurrentBlock = nullptr;
+    this->Condition.notify_all();
+  }
+
+  //------------------------------------------------------------------------------
+  //! Get a free block, waiting for the thread if all of them are full
+  void Acquire()
+  {
+    boost::mutex::scoped_lock lock(this->Mutex);
+    if (this->FreeBlocks.empty())
+    {
+      const auto start = std::chrono::steady_clock::now();
+      while (this->FreeBlocks.empty())
+      {
+        this->Condition.wait(lock);
+      }
+      this->Stats.NumberOfStalls++;
+      this->Stats.StallDuration +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    this->CurrentBlock = this->FreeBlocks.front();
+    this->FreeBlocks.pop_front();
+    this->CurrentBlock->StartsNewFile = this->NextBlockStartsNewFile;
+    this->NextBlockStartsNewFile = false;
+  }
+
+  //------------------------------------------------------------------------------
+  //! Append the header of a record of capturedLength bytes to the current block and
+  //! return where its bytes must be written
+  unsigned char* AppendRecord(const struct timeval& time, unsigned int capturedLength,
+                              unsigned int originalLength)
+  {
+    PcapRecordHeader header;
+    header.TimeSeconds = static_cast<uint32_t>(time.tv_sec);
+    header.TimeMicroseconds = static_cast<uint32_t>(time.tv_usec);
+    header.CapturedLength = capturedLength;
+    header.OriginalLength = originalLength;
+    const size_t recordSize = sizeof(header) + capturedLength;
+
+    // start a new file before the packet if the current one is complete
+    const double seconds = time.tv_sec + 1e-6 * time.tv_usec;
+    if (this->CurrentFileStartTime < 0)
+    {
+      this->CurrentFileStartTime = seconds;
+    }
+    const bool isFileEmpty = this->CurrentFileSize <= sizeof(PcapFileHeader);
+    if (!isFileEmpty &&
+        ((this->RotationSize > 0 && this->CurrentFileSize + recordSize > this->RotationSize) ||
+         (this->RotationDuration > 0 && seconds - this->CurrentFileStartTime >= this->RotationDuration)))
+    {
+      this->Submit();
+      this->NextBlockStartsNewFile = true;
+      this->CurrentFileSize = sizeof(PcapFileHeader);
+      this->CurrentFileStartTime = seconds;
+    }
+
+    if (this->CurrentBlock && this->CurrentBlock->Data.size() + recordSize > this->BlockSize)
+    {
+      this->Submit();
+    }
+    if (!this->CurrentBlock)
+    {
+      this->Acquire();
+    }
+    std::vector<unsigned char>& data = this->CurrentBlock->Data;
+    const unsigned char* headerBytes = reinterpret_cast<const unsigned char*>(&header);
+    data.insert(data.end(), headerBytes, headerBytes + sizeof(header));
+    data.resize(data.size() + capturedLength);
+    this->CurrentFileSize += recordSize;
+    return data.data() + data.size() - capturedLength;
+  }
+
+  //------------------------------------------------------------------------------
+  void WritePacket(const pcap_pkthdr* packetHeader, const unsigned char* packetData)
+  {
+    unsigned char* record = this->AppendRecord(packetHeader->ts, packetHeader->caplen, packetHeader->len);
+    std::copy(packetData, packetData + packetHeader->caplen, record);
+  }
+
+  //------------------------------------------------------------------------------
+  //! Wait until all the blocks given to the thread have been written
+  void Flush()
+  {
+    this->Submit();
+    boost::mutex::scoped_lock lock(this->Mutex);
+    while (!this->FullBlocks.empty() || this->NumberOfBlocksBeingWritten > 0)
+    {
+      this->Condition.wait(lock);
+    }
+  }
+};
 
 //--------------------------------------------------------------------------------
 vtkPacketFileWriter::vtkPacketFileWriter()
@@ -29,11 +320,74 @@ vtkPacketFileWriter::~vtkPacketFileWriter()
   this->Close();
 }
 
+//--------------------------------------------------------------------------------
+void vtkPacketFileWriter::SetAsynchronous(bool asynchronous, size_t blockSize, size_t numberOfBlocks)
+{
+  this->IsAsynchronous = asynchronous;
+  this->AsyncBlockSize = std::max<size_t>(blockSize, 1 << 16);
+  this->AsyncNumberOfBlocks = std::max<size_t>(numberOfBlocks, 2);
+}
+
+//--------------------------------------------------------------------------------
+void vtkPacketFileWriter::SetRotation(size_t maximumSize, double maximumDuration)
+{
+  this->RotationSize = maximumSize;
+  this->RotationDuration = maximumDuration;
+}
+
 //--------------------------------------------------------------------------------
 bool vtkPacketFileWriter::Open(const std::string& filename)
 {
+  if (this->IsAsynchronous)
+  {
+    std::unique_ptr<AsyncWriter> async(new AsyncWriter);
+    if (!async->OpenFile(filename))
+    {
+      this->LastError = "Cannot open " + filename + " for writing: " + std::strerror(errno);
+      if (async->File)
+      {
+        std::fclose(async->File);
+      }
+      return false;
+    }
+    async->FileName = filename;
+    async->Stats.NumberOfFiles = 1;
+    async->BlockSize = this->AsyncBlockSize;
+    async->RotationSize = this->RotationSize;
+    async->RotationDuration = this->RotationDuration;
+    async->CurrentFileSize = sizeof(PcapFileHeader);
+    async->Blocks.resize(this->AsyncNumberOfBlocks);
+    for (auto& block : async->Blocks)
+    {
+      block.Data.reserve(this->AsyncBlockSize);
+      async->FreeBlocks.push_back(&block);
+    }
+    AsyncWriter* writer = async.get();
+    async->Thread.reset(new boost::thread([writer]() { writer->ThreadLoop(); }));
+    this->Async = std::move(async);
+    this->FileName = filename;
+    return true;
+  }
+
   this->PCAPFile = pcap_open_dead(DLT_EN10MB, 65535);
+#ifdef _WIN32
+  // the FILE* of the application and of the pcap library may not share the same runtime
   this->PCAPDump = pcap_dump_open(this->PCAPFile, filename.c_str());
+#else
+  // use a large buffer, so that the packets are written to the disk in big chunks
+  FILE* file = std::fopen(filename.c_str(), "wb");
+  this->PCAPDump = nullptr;
+  if (file)
+  {
+    this->WriteBuffer.resize(WriteBufferSize);
+    std::setvbuf(file, this->WriteBuffer.data(), _IOFBF, this->WriteBuffer.size());
+    this->PCAPDump = pcap_dump_fopen(this->PCAPFile, file);
+    if (!this->PCAPDump)
+    {
+      std::fclose(file);
+    }
+  }
+#endif
 
   if (!this->PCAPDump)
   {
@@ -50,11 +404,27 @@ bool vtkPacketFileWriter::Open(const std::string& filename)
 //--------------------------------------------------------------------------------
 bool vtkPacketFileWriter::IsOpen()
 {
-  return (this->PCAPFile != 0);
+  return (this->PCAPFile != 0) || this->Async;
 }
 
 void vtkPacketFileWriter::Close()
 {
+  if (this->Async)
+  {
+    this->Async->Flush();
+    {
+      boost::mutex::scoped_lock lock(this->Async->Mutex);
+      this->Async->Stop = true;
+      this->Async->Condition.notify_all();
+    }
+    this->Async->Thread->join();
+    if (this->Async->File)
+    {
+      std::fclose(this->Async->File);
+    }
+    this->Async.reset();
+    this->FileName.clear();
+  }
   if (this->PCAPFile)
   {
     pcap_dump_close(this->PCAPDump);
@@ -65,6 +435,19 @@ void vtkPacketFileWriter::Close()
   }
 }
 
+//--------------------------------------------------------------------------------
+void vtkPacketFileWriter::Flush()
+{
+  if (this->Async)
+  {
+    this->Async->Flush();
+  }
+  if (this->PCAPDump)
+  {
+    pcap_dump_flush(this->PCAPDump);
+  }
+}
+
 //--------------------------------------------------------------------------------
 const std::string& vtkPacketFileWriter::GetLastError()
 {
@@ -77,11 +460,22 @@ const std::string& vtkPacketFileWriter::GetFileName()
   return this->FileName;
 }
 
+//--------------------------------------------------------------------------------
+vtkPacketFileWriter::Statistics vtkPacketFileWriter::GetStatistics() const
+{
+  if (!this->Async)
+  {
+    return Statistics();
+  }
+  boost::mutex::scoped_lock lock(this->Async->Mutex);
+  return this->Async->Stats;
+}
+
 //--------------------------------------------------------------------------------
 // Write an UDP packet from the data (without providing a header, so we construct it)
 bool vtkPacketFileWriter::WritePacket(const NetworkPacket& packet)
 {
-  if (!this->PCAPFile)
+  if (!this->IsOpen())
   {
     return false;
   }
@@ -90,15 +484,63 @@ bool vtkPacketFileWriter::WritePacket(const NetworkPacket& packet)
   header.caplen = packet.GetPacketSize();
   header.len = packet.GetPacketSize();
   header.ts = packet.ReceptionTime;
+  if (this->Async)
+  {
+    this->Async->WritePacket(&header, packet.GetPacketData());
+    return true;
+  }
 
   pcap_dump((u_char*)this->PCAPDump, &header, packet.GetPacketData());
   return true;
 }
 
+//--------------------------------------------------------------------------------
+bool vtkPacketFileWriter::WriteUDPPacket(const unsigned char* payload, unsigned int payloadSize,
+                                         const struct timeval& receptionTime,
+                                         const unsigned char* sourceIPv4BigEndian,
+                                         unsigned short sourcePort, unsigned short destinationPort)
+{
+  if (!this->IsOpen())
+  {
+    return false;
+  }
+
+  // The network headers are written in the record itself, in front of the payload
+  const unsigned int packetSize = NetworkPacket::EthIP4UDPHeaderSize + payloadSize;
+  unsigned char* packet = nullptr;
+  if (this->Async)
+  {
+    packet = this->Async->AppendRecord(receptionTime, packetSize, packetSize);
+  }
+  else
+  {
+    this->PacketBuffer.resize(packetSize);
+    packet = this->PacketBuffer.data();
+  }
+  NetworkPacket::WriteEthernetIP4UDPHeader(packet, payloadSize, sourceIPv4BigEndian,
+                                           sourcePort, destinationPort);
+  std::copy(payload, payload + payloadSize, packet + NetworkPacket::EthIP4UDPHeaderSize);
+
+  if (!this->Async)
+  {
+    struct pcap_pkthdr header;
+    header.caplen = packetSize;
+    header.len = packetSize;
+    header.ts = receptionTime;
+    pcap_dump((u_char*)this->PCAPDump, &header, packet);
+  }
+  return true;
+}
+
 //--------------------------------------------------------------------------------
 // Write an packet from packetHeader and packetData (which includes the packet header)
 bool vtkPacketFileWriter::WritePacket(pcap_pkthdr* packetHeader, unsigned char* packetData)
 {
+  if (this->Async)
+  {
+    this->Async->WritePacket(packetHeader, packetData);
+    return true;
+  }
   pcap_dump((u_char*)this->PCAPDump, packetHeader, packetData);
   return true;
 }
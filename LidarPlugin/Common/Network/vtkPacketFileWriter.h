@@ -33,6 +33,7 @@
 #define __vtkPacketFileWriter_h
 
 #include <pcap.h>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -47,29 +48,95 @@ public:
 
   static const unsigned short PositionPacketHeader[21];
 
+  //! Backpressure of the asynchronous mode
+  struct Statistics
+  {
+    //! Bytes written to the disk
+    size_t WrittenBytes = 0;
+    //! Number of files written, more than one with the rotation
+    size_t NumberOfFiles = 0;
+    //! Number of times WritePacket waited for the disk, as all the blocks were full
+    size_t NumberOfStalls = 0;
+    //! Total time WritePacket waited for the disk, in seconds
+    double StallDuration = 0;
+    //! Maximum number of full blocks waiting to be written at the same time
+    size_t MaximumQueuedBlocks = 0;
+    //! Number of failed writes, a block still failing after some retries is dropped
+    size_t NumberOfWriteErrors = 0;
+    size_t NumberOfDroppedBytes = 0;
+  };
+
   vtkPacketFileWriter();
 
   ~vtkPacketFileWriter();
 
+  /**
+   * @brief SetAsynchronous in asynchronous mode, the packets are copied in large blocks
+   * written to the disk by a dedicated thread, so that a slow disk or an I/O hiccup does
+   * not slow down the caller as long as a block is free. Taken into account by Open.
+   * @param blockSize size of a block in bytes
+   * @param numberOfBlocks number of blocks, 2 or more so that one block is filled while
+   * an other one is written
+   */
+  void SetAsynchronous(bool asynchronous, size_t blockSize = 4 << 20, size_t numberOfBlocks = 4);
+
+  /**
+   * @brief SetRotation asynchronous mode only, a new file is started when the current one
+   * would exceed maximumSize bytes or when its packets span maximumDuration seconds.
+   * The file N is named after the file given to Open, with the suffix _N. 0 disables a limit.
+   */
+  void SetRotation(size_t maximumSize, double maximumDuration);
+
   bool Open(const std::string& filename);
 
   bool IsOpen();
 
   void Close();
 
+  // Write the packets still in the write buffer to the file
+  void Flush();
+
   const std::string& GetLastError();
 
   const std::string& GetFileName();
 
+  //! Statistics of the asynchronous writes since the file was opened
+  Statistics GetStatistics() const;
+
   bool WritePacket(const NetworkPacket& packet);
   bool WritePacket(pcap_pkthdr* packetHeader, unsigned char* packetData);
 
+  /**
+   * @brief WriteUDPPacket write a UDP payload with the Ethernet/IPv4/UDP headers of
+   * NetworkPacket::WriteEthernetIP4UDPHeader. In asynchronous mode the headers and the
+   * payload are written directly in the block, so the payload is copied only once.
+   */
+  bool WriteUDPPacket(const unsigned char* payload, unsigned int payloadSize,
+                      const struct timeval& receptionTime,
+                      const unsigned char* sourceIPv4BigEndian,
+                      unsigned short sourcePort, unsigned short destinationPort);
+
 protected:
+  struct AsyncWriter;
+
   pcap_t* PCAPFile;
   pcap_dumper_t* PCAPDump;
 
   std::string FileName;
   std::string LastError;
+
+  // Buffer of the file, flushed to the disk when full or when the file is closed
+  static const size_t WriteBufferSize = 1 << 20;
+  std::vector<char> WriteBuffer;
+  //! Packet with its network headers, used by WriteUDPPacket in synchronous mode
+  std::vector<unsigned char> PacketBuffer;
+
+  bool IsAsynchronous = false;
+  size_t AsyncBlockSize = 4 << 20;
+  size_t AsyncNumberOfBlocks = 4;
+  size_t RotationSize = 0;
+  double RotationDuration = 0;
+  std::unique_ptr<AsyncWriter> Async;
 };
 
 #endif
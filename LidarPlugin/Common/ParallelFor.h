@@ -0,0 +1,108 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+/**
+ * \namespace Parallel
+ * \brief Loops split between threads, for the code which does not depend on VTK
+ * and thus cannot use vtkSMPTools, or which has its own number of threads.
+ *
+ * The calling thread takes part in the work, and a number of threads of 0
+ * means one thread per core.
+ */
+namespace Parallel
+{
+//-----------------------------------------------------------------------------
+//! Number of threads to use when nbThreads are requested
+inline unsigned int GetNumberOfThreads(unsigned int nbThreads)
+{
+  return nbThreads > 0 ? nbThreads : std::max(1u, boost::thread::hardware_concurrency());
+}
+
+//-----------------------------------------------------------------------------
+//! Call f(thread) for each thread of [0, nbThreads[, the first one being the calling one
+template <typename F>
+void Run(unsigned int nbThreads, const F& f)
+{
+  std::vector<std::unique_ptr<boost::thread> > threads;
+  for (unsigned int i = 1; i < nbThreads; ++i)
+  {
+    threads.emplace_back(new boost::thread([&f, i]() { f(i); }));
+  }
+  f(0u);
+  for (auto& thread : threads)
+  {
+    thread->join();
+  }
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * @brief ForEachPart call f(thread, begin, end) for nbThreads contiguous parts
+ *        of [0, n[ of the same size, the part of index thread going to the
+ *        thread of this index.
+ *
+ * The parts only depend on n and nbThreads, so that consecutive loops over the
+ * same items can reuse per part results, as the passes of a radix sort.
+ */
+template <typename F>
+void ForEachPart(size_t n, unsigned int nbThreads, const F& f)
+{
+  nbThreads = GetNumberOfThreads(nbThreads);
+  Run(nbThreads, [&](unsigned int thread)
+  {
+    f(thread, n * thread / nbThreads, n * (thread + 1) / nbThreads);
+  });
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * @brief ForEachChunk call f(thread, begin, end) on the chunks of chunkSize
+ *        items of [0, n[, taken in turn by the threads so that they stay
+ *        balanced when the items have different costs.
+ *
+ * thread is the index of the thread processing the chunk, lower than the
+ * number of threads requested, to accumulate in per thread storage.
+ */
+template <typename F>
+void ForEachChunk(size_t n, size_t chunkSize, unsigned int nbThreads, const F& f)
+{
+  const size_t nbChunks = (n + chunkSize - 1) / chunkSize;
+  nbThreads = static_cast<unsigned int>(
+    std::max<size_t>(1, std::min<size_t>(GetNumberOfThreads(nbThreads), nbChunks)));
+  std::atomic<size_t> nextChunk(0);
+  Run(nbThreads, [&](unsigned int thread)
+  {
+    for (size_t chunk = nextChunk++; chunk < nbChunks; chunk = nextChunk++)
+    {
+      f(thread, chunk * chunkSize, std::min(n, (chunk + 1) * chunkSize));
+    }
+  });
+}
+}
+
+#endif // PARALLEL_FOR_H
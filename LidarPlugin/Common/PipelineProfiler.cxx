@@ -0,0 +1,313 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "PipelineProfiler.h"
+#include "AllocationTracker.h"
+
+// STD
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+// VTK
+#include <vtkAlgorithm.h>
+#include <vtkCommand.h>
+#include <vtkDataSet.h>
+#include <vtkSmartPointer.h>
+#include <vtk_jsoncpp.h>
+#include <vtksys/SystemInformation.hxx>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+double GetMicroseconds()
+{
+  static const auto origin = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();
+}
+
+//-----------------------------------------------------------------------------
+long long GetNumberOfPoints(vtkDataObject* data)
+{
+  vtkDataSet* dataSet = vtkDataSet::SafeDownCast(data);
+  return dataSet ? static_cast<long long>(dataSet->GetNumberOfPoints()) : -1;
+}
+}
+
+//-----------------------------------------------------------------------------
+//! Ring of the samples of a thread, written by this thread and read by TakeSamples
+struct PipelineProfiler::ThreadBuffer
+{
+  static const size_t Capacity = 4096;
+
+  //! Scope begun but not ended yet
+  struct OpenScope
+  {
+    int Id;
+    double Start;
+    long long NumberOfInputPoints;
+    long long Memory;
+    AllocationTracker::Counters Allocations;
+  };
+
+  unsigned int Index = 0;
+  Sample Samples[Capacity];
+  //! Number of samples written and read since the creation of the buffer
+  std::atomic<size_t> Head;
+  std::atomic<size_t> Tail;
+  //! Only used by the thread of the buffer
+  std::vector<OpenScope> OpenScopes;
+  vtksys::SystemInformation SystemInformation;
+
+  ThreadBuffer()
+    : Head(0)
+    , Tail(0)
+  {
+  }
+};
+
+//-----------------------------------------------------------------------------
+struct PipelineProfiler::WatchedAlgorithm
+{
+  int Id;
+  unsigned long StartTag;
+  unsigned long EndTag;
+};
+
+//-----------------------------------------------------------------------------
+//! Forward the events of the executive of a watched algorithm to the profiler
+class PipelineProfiler::Observer : public vtkCommand
+{
+public:
+  static Observer* New() { return new Observer; }
+
+  void Execute(vtkObject* caller, unsigned long eventId, void*) override
+  {
+    PipelineProfiler* profiler = PipelineProfiler::GetInstance();
+    vtkAlgorithm* algorithm = vtkAlgorithm::SafeDownCast(caller);
+    if (eventId == vtkCommand::StartEvent)
+    {
+      if (profiler->GetEnabled())
+      {
+        const bool hasInput = algorithm && algorithm->GetNumberOfInputPorts() > 0 &&
+                              algorithm->GetNumberOfInputConnections(0) > 0;
+        profiler->Begin(this->Id, hasInput ? GetNumberOfPoints(algorithm->GetInputDataObject(0, 0)) : -1);
+      }
+    }
+    else
+    {
+      const bool hasOutput = algorithm && algorithm->GetNumberOfOutputPorts() > 0;
+      profiler->End(this->Id, hasOutput ? GetNumberOfPoints(algorithm->GetOutputDataObject(0)) : -1);
+    }
+  }
+
+  int Id = -1;
+};
+
+//-----------------------------------------------------------------------------
+PipelineProfiler* PipelineProfiler::GetInstance()
+{
+  static PipelineProfiler instance;
+  return &instance;
+}
+
+//-----------------------------------------------------------------------------
+PipelineProfiler::PipelineProfiler()
+  : Enabled(false)
+  , NumberOfDroppedSamples(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+int PipelineProfiler::Watch(vtkAlgorithm* algorithm, const std::string& name)
+{
+  this->Unwatch(algorithm);
+  const int id = this->Register(name);
+  auto observer = vtkSmartPointer<Observer>::New();
+  observer->Id = id;
+  WatchedAlgorithm watched;
+  watched.Id = id;
+  watched.StartTag = algorithm->AddObserver(vtkCommand::StartEvent, observer);
+  watched.EndTag = algorithm->AddObserver(vtkCommand::EndEvent, observer);
+  std::lock_guard<std::mutex> lock(this->NamesMutex);
+  this->Algorithms[algorithm] = watched;
+  return id;
+}
+
+//-----------------------------------------------------------------------------
+void PipelineProfiler::Unwatch(vtkAlgorithm* algorithm)
+{
+  std::lock_guard<std::mutex> lock(this->NamesMutex);
+  auto watched = this->Algorithms.find(algorithm);
+  if (watched != this->Algorithms.end())
+  {
+    algorithm->RemoveObserver(watched->second.StartTag);
+    algorithm->RemoveObserver(watched->second.EndTag);
+    this->Algorithms.erase(watched);
+  }
+}
+
+//-----------------------------------------------------------------------------
+int PipelineProfiler::Register(const std::string& name)
+{
+  std::lock_guard<std::mutex> lock(this->NamesMutex);
+  this->Names.push_back(name);
+  return static_cast<int>(this->Names.size() - 1);
+}
+
+//-----------------------------------------------------------------------------
+std::string PipelineProfiler::GetName(int id) const
+{
+  std::lock_guard<std::mutex> lock(this->NamesMutex);
+  return id >= 0 && static_cast<size_t>(id) < this->Names.size() ? this->Names[id] : std::string();
+}
+
+//-----------------------------------------------------------------------------
+PipelineProfiler::ThreadBuffer*& PipelineProfiler::GetCurrentThreadBuffer()
+{
+  thread_local ThreadBuffer* buffer = nullptr;
+  return buffer;
+}
+
+//-----------------------------------------------------------------------------
+PipelineProfiler::ThreadBuffer* PipelineProfiler::GetThreadBuffer()
+{
+  ThreadBuffer*& buffer = GetCurrentThreadBuffer();
+  if (!buffer)
+  {
+    std::lock_guard<std::mutex> lock(this->BuffersMutex);
+    this->Buffers.emplace_back(new ThreadBuffer);
+    buffer = this->Buffers.back().get();
+    buffer->Index = static_cast<unsigned int>(this->Buffers.size() - 1);
+  }
+  return buffer;
+}
+
+//-----------------------------------------------------------------------------
+void PipelineProfiler::Begin(int id, long long numberOfInputPoints)
+{
+  if (!this->Enabled)
+  {
+    return;
+  }
+  ThreadBuffer* buffer = this->GetThreadBuffer();
+  ThreadBuffer::OpenScope scope;
+  scope.Id = id;
+  scope.NumberOfInputPoints = numberOfInputPoints;
+  scope.Memory = buffer->SystemInformation.GetProcMemoryUsed();
+  buffer->OpenScopes.push_back(scope);
+  // the counters are read after the memory query and the growth of OpenScopes, which
+  // allocate, and the clock last so that the memory query is not measured
+  ThreadBuffer::OpenScope& open = buffer->OpenScopes.back();
+  open.Allocations = AllocationTracker::GetThreadCounters();
+  open.Start = GetMicroseconds();
+}
+
+//-----------------------------------------------------------------------------
+void PipelineProfiler::End(int id, long long numberOfOutputPoints)
+{
+  // a scope begun before the profiler was disabled is still closed
+  ThreadBuffer* buffer = GetCurrentThreadBuffer();
+  if (!buffer)
+  {
+    return;
+  }
+  auto scope = std::find_if(buffer->OpenScopes.rbegin(), buffer->OpenScopes.rend(),
+                            [id](const ThreadBuffer::OpenScope& open) { return open.Id == id; });
+  if (scope == buffer->OpenScopes.rend())
+  {
+    return;
+  }
+  const double end = GetMicroseconds();
+  const AllocationTracker::Counters allocations = AllocationTracker::GetThreadCounters();
+
+  const size_t head = buffer->Head.load(std::memory_order_relaxed);
+  if (head - buffer->Tail.load(std::memory_order_acquire) >= ThreadBuffer::Capacity)
+  {
+    ++this->NumberOfDroppedSamples;
+  }
+  else
+  {
+    Sample& sample = buffer->Samples[head % ThreadBuffer::Capacity];
+    sample.Id = id;
+    sample.Thread = buffer->Index;
+    sample.Start = scope->Start;
+    sample.Duration = end - scope->Start;
+    sample.NumberOfInputPoints = scope->NumberOfInputPoints;
+    sample.NumberOfOutputPoints = numberOfOutputPoints;
+    sample.MemoryDelta = buffer->SystemInformation.GetProcMemoryUsed() - scope->Memory;
+    sample.NumberOfAllocations =
+      allocations.NumberOfAllocations - scope->Allocations.NumberOfAllocations;
+    sample.AllocatedBytes = allocations.AllocatedBytes - scope->Allocations.AllocatedBytes;
+    buffer->Head.store(head + 1, std::memory_order_release);
+  }
+  buffer->OpenScopes.erase(std::next(scope).base());
+}
+
+//-----------------------------------------------------------------------------
+std::vector<PipelineProfiler::Sample> PipelineProfiler::TakeSamples()
+{
+  std::vector<Sample> samples;
+  std::lock_guard<std::mutex> lock(this->BuffersMutex);
+  for (const auto& buffer : this->Buffers)
+  {
+    const size_t tail = buffer->Tail.load(std::memory_order_relaxed);
+    const size_t head = buffer->Head.load(std::memory_order_acquire);
+    for (size_t i = tail; i < head; ++i)
+    {
+      samples.push_back(buffer->Samples[i % ThreadBuffer::Capacity]);
+    }
+    buffer->Tail.store(head, std::memory_order_release);
+  }
+  std::sort(samples.begin(), samples.end(),
+            [](const Sample& a, const Sample& b) { return a.Start < b.Start; });
+  return samples;
+}
+
+//-----------------------------------------------------------------------------
+bool PipelineProfiler::WriteChromeTrace(const std::string& filename,
+                                        const std::vector<Sample>& samples) const
+{
+  Json::Value events(Json::arrayValue);
+  for (const Sample& sample : samples)
+  {
+    Json::Value event;
+    event["name"] = this->GetName(sample.Id);
+    event["cat"] = "pipeline";
+    event["ph"] = "X";
+    event["ts"] = sample.Start;
+    event["dur"] = sample.Duration;
+    event["pid"] = 1;
+    event["tid"] = sample.Thread;
+    Json::Value args;
+    args["inputPoints"] = static_cast<Json::Int64>(sample.NumberOfInputPoints);
+    args["outputPoints"] = static_cast<Json::Int64>(sample.NumberOfOutputPoints);
+    args["memoryDeltaKiB"] = static_cast<Json::Int64>(sample.MemoryDelta);
+    args["allocations"] = static_cast<Json::UInt64>(sample.NumberOfAllocations);
+    args["allocatedBytes"] = static_cast<Json::UInt64>(sample.AllocatedBytes);
+    event["args"] = args;
+    events.append(event);
+  }
+  Json::Value trace;
+  trace["traceEvents"] = events;
+  trace["displayTimeUnit"] = "ms";
+
+  std::ofstream file(filename);
+  file << trace;
+  return static_cast<bool>(file);
+}
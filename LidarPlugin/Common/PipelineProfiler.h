@@ -0,0 +1,131 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef PIPELINEPROFILER_H
+#define PIPELINEPROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "vvConfigure.h"
+
+class vtkAlgorithm;
+
+/**
+ * \class PipelineProfiler
+ * \brief Measure the time spent by each algorithm of the pipeline in RequestData.
+ *
+ * An algorithm is watched by observing the StartEvent and EndEvent which its executive
+ * invokes around RequestData. Each execution is recorded as a sample with its wall time,
+ * the number of points of its first input and output, the change of the memory used
+ * by the process and, when AllocationTracker is enabled, the heap allocations of the
+ * thread. Scopes which are not algorithms, such as the renders of a view, can be
+ * recorded with Begin and End.
+ *
+ * Each thread records its samples in a buffer of its own, without locking, and a single
+ * reader collects them with TakeSamples, for instance from a timer of the GUI. When a buffer
+ * is full, the new samples are dropped until the reader catches up.
+ */
+class LidarPlugin_EXPORT PipelineProfiler
+{
+public:
+  //! An execution of an algorithm or a scope
+  struct Sample
+  {
+    //! See GetName
+    int Id = -1;
+    //! Index of the thread, in the order in which the threads recorded their first sample
+    unsigned int Thread = 0;
+    //! Start since the creation of the profiler, in microseconds
+    double Start = 0;
+    //! Wall time, in microseconds
+    double Duration = 0;
+    //! -1 if the algorithm has no input or output data set
+    long long NumberOfInputPoints = -1;
+    long long NumberOfOutputPoints = -1;
+    //! Change of the memory used by the process, in KiB
+    long long MemoryDelta = 0;
+    //! Heap allocations made by the thread during the scope, nested scopes included.
+    //! Always 0 unless the plugin is built with ENABLE_allocation_tracking
+    uint64_t NumberOfAllocations = 0;
+    uint64_t AllocatedBytes = 0;
+  };
+
+  static PipelineProfiler* GetInstance();
+
+  //! Nothing is recorded while disabled, the default
+  void SetEnabled(bool enabled) { this->Enabled = enabled; }
+  bool GetEnabled() const { return this->Enabled; }
+
+  /**
+   * @brief Watch record the executions of an algorithm under a name. The algorithm must be
+   * unwatched before it is deleted.
+   * @return the id of the samples of the algorithm
+   */
+  int Watch(vtkAlgorithm* algorithm, const std::string& name);
+  void Unwatch(vtkAlgorithm* algorithm);
+
+  //! Id of the samples of a scope recorded with Begin and End
+  int Register(const std::string& name);
+
+  //! Open and close a scope of the calling thread, the scopes may be nested
+  void Begin(int id, long long numberOfInputPoints = -1);
+  void End(int id, long long numberOfOutputPoints = -1);
+
+  std::string GetName(int id) const;
+
+  //! Samples recorded since the last call, the oldest first
+  std::vector<Sample> TakeSamples();
+
+  //! Number of samples dropped because a buffer was full
+  size_t GetNumberOfDroppedSamples() const { return this->NumberOfDroppedSamples; }
+
+  //! Write samples as the complete events of a Chrome trace (chrome://tracing)
+  bool WriteChromeTrace(const std::string& filename, const std::vector<Sample>& samples) const;
+
+private:
+  PipelineProfiler();
+  PipelineProfiler(const PipelineProfiler&) = delete;
+  void operator=(const PipelineProfiler&) = delete;
+
+  struct ThreadBuffer;
+  struct WatchedAlgorithm;
+  class Observer;
+
+  //! Buffer of the calling thread, nullptr until it records its first sample
+  static ThreadBuffer*& GetCurrentThreadBuffer();
+  //! Buffer of the calling thread, created if needed
+  ThreadBuffer* GetThreadBuffer();
+
+  std::atomic<bool> Enabled;
+  std::atomic<size_t> NumberOfDroppedSamples;
+
+  //! Held to add a buffer or read them, never to record a sample
+  std::mutex BuffersMutex;
+  std::vector<std::unique_ptr<ThreadBuffer> > Buffers;
+
+  mutable std::mutex NamesMutex;
+  std::vector<std::string> Names;
+  std::map<vtkAlgorithm*, WatchedAlgorithm> Algorithms;
+};
+
+#endif // PIPELINEPROFILER_H
@@ -121,9 +121,8 @@ Eigen::Matrix4d ICPPointToPlaneRegistration(pcl::PointCloud<pcl::PointXYZ>::Ptr
     ceres::Problem problem;
     for (unsigned int k = 0; k < Points.size(); ++k)
     {
-      ceres::CostFunction* cost_function = new ceres::AutoDiffCostFunction<CostFunctions::MahalanobisDistanceAffineIsometryResidual, 1, 6>(
-                                           new CostFunctions::MahalanobisDistanceAffineIsometryResidual(SemiDist[k], PointOnPlane[k],
-                                                                                                        Points[k], scores[k]));
+      ceres::CostFunction* cost_function = new CostFunctions::MahalanobisDistanceAffineIsometryAnalyticResidual(
+                                           SemiDist[k], PointOnPlane[k], Points[k], scores[k]);
       problem.AddResidualBlock(cost_function, nullptr, DoF6Params.data());
     }
 
@@ -15,8 +15,14 @@
 // limitations under the License.
 //=========================================================================
 
+#ifndef EIGEN_FFT_CORRELATION_H
+#define EIGEN_FFT_CORRELATION_H
+
 #include <unsupported/Eigen/FFT>
+#include <algorithm>
 #include <cmath>
+#include <complex>
+#include <vector>
 
 // This function was desgined to have the same output as
 // scipy.signal.fftconvolve
@@ -97,3 +103,107 @@ int max_fftcorrelation(const std::vector<T>& a,
       - b.size() + 1;
 }
 
+
+// Smallest size greater or equal to n whose only prime factors are 2, 3 and
+// 5, for which the FFT of Eigen (kissfft) has dedicated butterflies. Padding
+// to such a size is at most 25 % larger than n instead of twice for the next
+// power of two.
+inline int FFTFriendlySize(int n)
+{
+  int best = 1;
+  while (best < n)
+  {
+    best *= 2;
+  }
+  for (long long p5 = 1; p5 < best; p5 *= 5)
+  {
+    for (long long p35 = p5; p35 < best; p35 *= 3)
+    {
+      long long size = p35;
+      while (size < n)
+      {
+        size *= 2;
+      }
+      best = std::min(best, static_cast<int>(size));
+    }
+  }
+  return best;
+}
+
+
+// Computes the same correlations as fftcorrelate, keeping the FFT plans and
+// the buffers between calls so that correlating many signals of similar
+// lengths only pays for the transforms. Both real signals are packed in a
+// single complex signal, which gives their two spectra with one forward FFT.
+// The signals are padded to an FFT friendly size, the plans of the sizes met
+// being kept by Eigen::FFT.
+template<typename T>
+class FFTCorrelator
+{
+public:
+  // Same output as fftcorrelate(a, b)
+  const std::vector<T>& Correlate(const std::vector<T>& a,
+                                  const std::vector<T>& b)
+  {
+    assert(a.size() > 0 && b.size() > 0);
+    const int outSize = a.size() + b.size() - 1;
+    const int fshape = FFTFriendlySize(outSize);
+
+    // a as real part, b reversed as imaginary part
+    this->Packed.assign(fshape, std::complex<T>(0.0, 0.0));
+    for (unsigned int i = 0; i < a.size(); i++)
+    {
+      this->Packed[i].real(a[i]);
+    }
+    for (unsigned int i = 0; i < b.size(); i++)
+    {
+      this->Packed[i].imag(b[b.size() - 1 - i]);
+    }
+    this->FFT.fwd(this->Spectrum, this->Packed);
+
+    // split the spectra using their hermitian symmetry and multiply them
+    this->Product.resize(fshape);
+    for (int k = 0; k < fshape; k++)
+    {
+      const std::complex<T> z = this->Spectrum[k];
+      const std::complex<T> zc = std::conj(this->Spectrum[(fshape - k) % fshape]);
+      const std::complex<T> aFwd = static_cast<T>(0.5) * (z + zc);
+      const std::complex<T> bFwd = std::complex<T>(0.0, -0.5) * (z - zc);
+      this->Product[k] = aFwd * bFwd;
+    }
+    this->FFT.inv(this->Inverse, this->Product);
+
+    this->Correlation.resize(outSize);
+    for (int i = 0; i < outSize; i++)
+    {
+      this->Correlation[i] = this->Inverse[i].real();
+    }
+    return this->Correlation;
+  }
+
+  // Same as max_fftcorrelation, the position of the peak being refined to a
+  // fraction of sample by fitting a parabola on the peak and its neighbors
+  double MaxCorrelation(const std::vector<T>& a, const std::vector<T>& b)
+  {
+    const std::vector<T>& corr = this->Correlate(a, b);
+    const int peak = std::distance(corr.begin(), std::max_element(corr.begin(), corr.end()));
+    double offset = 0.0;
+    if (peak > 0 && peak + 1 < static_cast<int>(corr.size()))
+    {
+      const double left = corr[peak - 1], center = corr[peak], right = corr[peak + 1];
+      const double curvature = left - 2.0 * center + right;
+      if (curvature < 0.0)
+      {
+        offset = 0.5 * (left - right) / curvature;
+      }
+    }
+    return peak + offset - static_cast<double>(b.size()) + 1.0;
+  }
+
+private:
+  Eigen::FFT<T> FFT;
+  std::vector<std::complex<T>> Packed, Spectrum, Product, Inverse;
+  std::vector<T> Correlation;
+};
+
+#endif // EIGEN_FFT_CORRELATION_H
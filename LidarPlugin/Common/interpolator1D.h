@@ -15,12 +15,21 @@
 // limitations under the License.
 //=========================================================================
 
+#ifndef INTERPOLATOR_1D_H
+#define INTERPOLATOR_1D_H
+
 #include <vector>
 #include <iterator>
 #include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <string>
 #include <fstream>
 
+// Linear interpolation of a signal sampled at increasing instants.
+// If the instants are evenly spaced, as the resampled signals of the time
+// calibration, the interval containing a time is computed instead of being
+// searched, and the values are the same as the ones of the search.
 template<typename T>
 class Interpolator1D
 {
@@ -34,23 +43,67 @@ public:
     this->t = t; // makes a copy
     this->x = x; // makes a copy
     assert(this->t.size() == this->x.size());
+    this->DetectUniformGrid();
   }
 
-  T Get(T time)
+  T Get(T time) const
   {
     // the signal is clamped to 0.0 outside its support
-    if (time < this->t[0] || time > this->t[this->t.size() - 1])
+    if (this->t.empty() || time < this->t[0] || time > this->t[this->t.size() - 1])
     {
       return 0.0;
     }
+    if (this->t.size() == 1)
+    {
+      return this->x[0];
+    }
+    return this->Interpolate(this->FindInterval(time, -1), time);
+  }
 
-    auto lb = std::lower_bound(this->t.begin(), this->t.end(), time);
-    int sup = std::distance(this->t.begin(), lb);
-    int inf = sup - 1;
-    assert(inf >= 0);
-    assert(sup <= this->t.size() - 1);
-    T alpha = (this->t[sup] - time) / (this->t[sup] - this->t[inf]);
-    return alpha * this->x[inf] + (1.0 - alpha) * this->x[sup];
+  // Values at several instants, the same as Get. If the instants increase,
+  // each interval is searched from the previous one
+  std::vector<T> Get(const std::vector<T>& times) const
+  {
+    std::vector<T> values(times.size());
+    int inf = -1;
+    for (size_t i = 0; i < times.size(); i++)
+    {
+      const T time = times[i];
+      if (this->t.size() < 2 || time < this->t[0] || time > this->t[this->t.size() - 1])
+      {
+        values[i] = this->Get(time);
+        inf = -1;
+        continue;
+      }
+      inf = this->FindInterval(time, (i > 0 && time >= times[i - 1]) ? inf : -1);
+      values[i] = this->Interpolate(inf, time);
+    }
+    return values;
+  }
+
+  // Values at numberOfSamples instants evenly spaced by period from start,
+  // the same as Get(start + i * period)
+  void Resample(T start, T period, int numberOfSamples, std::vector<T>& values) const
+  {
+    values.resize(std::max(numberOfSamples, 0));
+    int inf = -1;
+    for (int i = 0; i < numberOfSamples; i++)
+    {
+      const T time = start + i * period;
+      if (this->t.size() < 2 || time < this->t[0] || time > this->t[this->t.size() - 1])
+      {
+        values[i] = this->Get(time);
+        inf = -1;
+        continue;
+      }
+      inf = this->FindInterval(time, period >= 0.0 ? inf : -1);
+      values[i] = this->Interpolate(inf, time);
+    }
+  }
+
+  bool IsUniformGrid() const
+  {
+    return this->IsUniform;
   }
 
   void ApplyTimeShift(T shift)
@@ -77,23 +130,23 @@ public:
     }
   }
 
-  T GetMinimumT()
+  T GetMinimumT() const
   {
     return this->t[0];
   }
 
 
-  T GetMaximumT()
+  T GetMaximumT() const
   {
     return this->t[this->t.size() - 1];
   }
 
-  T GetAveragePeriod()
+  T GetAveragePeriod() const
   {
     return (this->GetMaximumT() - this->GetMinimumT()) / (this->t.size() - 1);
   }
 
-  T Mean()
+  T Mean() const
   {
     if (this->x.size() == 0)
     {
@@ -120,6 +173,75 @@ public:
   }
 
 private:
+  // Check if the instants are evenly spaced, up to rounding errors
+  void DetectUniformGrid()
+  {
+    this->IsUniform = false;
+    if (this->t.size() < 2)
+    {
+      return;
+    }
+    this->Period = (this->t[this->t.size() - 1] - this->t[0]) / (this->t.size() - 1);
+    if (!(this->Period > 0.0))
+    {
+      return;
+    }
+    const T tolerance = 1e-6 * this->Period;
+    for (unsigned int i = 0; i < this->t.size(); i++)
+    {
+      if (std::abs(this->t[i] - (this->t[0] + i * this->Period)) > tolerance)
+      {
+        return;
+      }
+    }
+    this->IsUniform = true;
+  }
+
+  // Index of the interval containing time, within the support of the signal,
+  // as found by std::lower_bound: t[inf] < time <= t[inf + 1], or 0 if time is
+  // the first instant. On a uniform grid the interval is computed, otherwise
+  // it is searched from a previous one if it is given (not negative).
+  int FindInterval(T time, int previous) const
+  {
+    if (this->IsUniform)
+    {
+      return this->Bracket(time, static_cast<int>((time - this->t[0]) / this->Period));
+    }
+    if (previous >= 0)
+    {
+      return this->Bracket(time, previous);
+    }
+    auto lb = std::lower_bound(this->t.begin(), this->t.end(), time);
+    return std::max(static_cast<int>(std::distance(this->t.begin(), lb)), 1) - 1;
+  }
+
+  // Same as FindInterval, moving one interval at a time from a guess
+  int Bracket(T time, int guess) const
+  {
+    const int last = static_cast<int>(this->t.size()) - 2;
+    int inf = std::min(std::max(guess, 0), last);
+    while (inf > 0 && this->t[inf] >= time)
+    {
+      inf--;
+    }
+    while (inf < last && this->t[inf + 1] < time)
+    {
+      inf++;
+    }
+    return inf;
+  }
+
+  T Interpolate(int inf, T time) const
+  {
+    const int sup = inf + 1;
+    T alpha = (this->t[sup] - time) / (this->t[sup] - this->t[inf]);
+    return alpha * this->x[inf] + (1.0 - alpha) * this->x[sup];
+  }
+
   std::vector<T> t;
   std::vector<T> x;
+  bool IsUniform = false;
+  T Period = 0.0;
 };
+
+#endif // INTERPOLATOR_1D_H
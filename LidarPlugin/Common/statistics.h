@@ -15,23 +15,280 @@
 // limitations under the License.
 //=========================================================================
 
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <set>
 #include <vector>
 
-// source: https://stackoverflow.com/questions/1719070
+/**
+ * @brief ComputeMedian median of the values, the mean of the two middle values
+ *        if there is an even number of them. The values are partially reordered.
+ *
+ * A single nth_element places the upper middle value, the lower one being then
+ * the largest value of the first half.
+ */
 template<typename T>
 double ComputeMedian(std::vector<T> &v)
 {
-  size_t n = v.size() / 2;
+  if (v.empty())
+  {
+    return 0.0;
+  }
+  const size_t n = v.size() / 2;
   std::nth_element(v.begin(), v.begin() + n, v.end());
-  T vn = v[n];
-  if(v.size() % 2 == 1)
+  const double vn = static_cast<double>(v[n]);
+  if (v.size() % 2 == 1)
   {
     return vn;
   }
-  else
+  const double lower = static_cast<double>(*std::max_element(v.begin(), v.begin() + n));
+  return 0.5 * (vn + lower);
+}
+
+/**
+ * @brief ComputeMAD median absolute deviation of the values around their median.
+ *        Multiply it by 1.4826 to estimate the standard deviation of gaussian
+ *        values with outliers.
+ */
+template<typename T>
+double ComputeMAD(const std::vector<T>& v, double median)
+{
+  std::vector<double> deviations(v.size());
+  for (size_t i = 0; i < v.size(); ++i)
   {
-    std::nth_element(v.begin(), v.begin() + n - 1, v.end());
-    return 0.5 * (vn + v[n-1]);
+    deviations[i] = std::abs(static_cast<double>(v[i]) - median);
   }
+  return ComputeMedian(deviations);
 }
 
+/**
+ * \class SlidingMedian
+ * \brief Median of a window of values in which values are inserted and removed,
+ *        each update costing O(log n) instead of a new selection over the window.
+ *
+ * The values are split in two ordered sets, Low holding the smaller half and High
+ * the larger half with the extra value when their number is odd, so that the upper
+ * middle value is the first value of High.
+ */
+template<typename T>
+class SlidingMedian
+{
+public:
+  void Insert(const T& value)
+  {
+    if (!this->High.empty() && value < *this->High.begin())
+    {
+      this->Low.insert(value);
+    }
+    else
+    {
+      this->High.insert(value);
+    }
+    this->Balance();
+  }
+
+  //! Remove one occurrence of the value, return false if it is not in the window
+  bool Erase(const T& value)
+  {
+    std::multiset<T>& first = (!this->High.empty() && value < *this->High.begin()) ? this->Low : this->High;
+    std::multiset<T>& second = (&first == &this->Low) ? this->High : this->Low;
+    auto it = first.find(value);
+    if (it != first.end())
+    {
+      first.erase(it);
+    }
+    else if ((it = second.find(value)) != second.end())
+    {
+      second.erase(it);
+    }
+    else
+    {
+      return false;
+    }
+    this->Balance();
+    return true;
+  }
+
+  void Clear()
+  {
+    this->Low.clear();
+    this->High.clear();
+  }
+
+  size_t Size() const { return this->Low.size() + this->High.size(); }
+  bool Empty() const { return this->High.empty(); }
+
+  //! Value of index Size() / 2 in the sorted window, the window must not be empty
+  const T& GetUpperMedian() const { return *this->High.begin(); }
+
+  //! Median as ComputeMedian gives it, the window must not be empty
+  double GetMedian() const
+  {
+    const double upper = static_cast<double>(*this->High.begin());
+    if (this->Low.size() == this->High.size())
+    {
+      return 0.5 * (upper + static_cast<double>(*this->Low.rbegin()));
+    }
+    return upper;
+  }
+
+private:
+  void Balance()
+  {
+    while (this->Low.size() > this->High.size())
+    {
+      auto last = std::prev(this->Low.end());
+      this->High.insert(*last);
+      this->Low.erase(last);
+    }
+    while (this->High.size() > this->Low.size() + 1)
+    {
+      this->Low.insert(*this->High.begin());
+      this->High.erase(this->High.begin());
+    }
+  }
+
+  std::multiset<T> Low;
+  std::multiset<T> High;
+};
+
+/**
+ * \class P2Quantile
+ * \brief Streaming estimation of a quantile in constant memory, with the P-square
+ *        algorithm of Jain and Chlamtac (1985).
+ *
+ * Five markers follow the minimum, the quantile, the maximum and two intermediate
+ * quantiles, their heights being adjusted by a piecewise parabolic interpolation as
+ * the values arrive. The estimation is exact for the first five values.
+ */
+class P2Quantile
+{
+public:
+  //! @param p quantile to estimate, in [0, 1], 0.5 for the median
+  explicit P2Quantile(double p = 0.5)
+    : P(std::min(1.0, std::max(0.0, p)))
+  {
+    this->Clear();
+  }
+
+  void Clear()
+  {
+    this->Count = 0;
+    const double increments[5] = { 0.0, this->P / 2.0, this->P, (1.0 + this->P) / 2.0, 1.0 };
+    const double desired[5] = { 0.0, 2.0 * this->P, 4.0 * this->P, 2.0 + 2.0 * this->P, 4.0 };
+    for (int i = 0; i < 5; ++i)
+    {
+      this->Heights[i] = 0.0;
+      this->Positions[i] = i;
+      this->Desired[i] = desired[i];
+      this->Increments[i] = increments[i];
+    }
+  }
+
+  void Add(double x)
+  {
+    if (this->Count < 5)
+    {
+      this->Heights[this->Count++] = x;
+      if (this->Count == 5)
+      {
+        std::sort(this->Heights, this->Heights + 5);
+      }
+      return;
+    }
+    ++this->Count;
+
+    // cell of the value, extending the extreme markers if needed
+    int k;
+    if (x < this->Heights[0])
+    {
+      this->Heights[0] = x;
+      k = 0;
+    }
+    else if (x >= this->Heights[4])
+    {
+      this->Heights[4] = std::max(this->Heights[4], x);
+      k = 3;
+    }
+    else
+    {
+      k = 0;
+      while (x >= this->Heights[k + 1])
+      {
+        ++k;
+      }
+    }
+    for (int i = k + 1; i < 5; ++i)
+    {
+      ++this->Positions[i];
+    }
+    for (int i = 0; i < 5; ++i)
+    {
+      this->Desired[i] += this->Increments[i];
+    }
+
+    // move the middle markers toward their desired positions
+    for (int i = 1; i < 4; ++i)
+    {
+      const double d = this->Desired[i] - this->Positions[i];
+      if ((d >= 1.0 && this->Positions[i + 1] - this->Positions[i] > 1)
+          || (d <= -1.0 && this->Positions[i - 1] - this->Positions[i] < -1))
+      {
+        const int step = d > 0 ? 1 : -1;
+        const double height = this->Parabolic(i, step);
+        if (this->Heights[i - 1] < height && height < this->Heights[i + 1])
+        {
+          this->Heights[i] = height;
+        }
+        else
+        {
+          this->Heights[i] += step * (this->Heights[i + step] - this->Heights[i])
+            / (this->Positions[i + step] - this->Positions[i]);
+        }
+        this->Positions[i] += step;
+      }
+    }
+  }
+
+  //! Current estimation of the quantile, 0 if no value was added
+  double Get() const
+  {
+    if (this->Count >= 5)
+    {
+      return this->Heights[2];
+    }
+    if (this->Count == 0)
+    {
+      return 0.0;
+    }
+    std::vector<double> values(this->Heights, this->Heights + this->Count);
+    std::sort(values.begin(), values.end());
+    return values[static_cast<size_t>(std::round(this->P * (this->Count - 1)))];
+  }
+
+  size_t GetCount() const { return this->Count; }
+
+private:
+  double Parabolic(int i, int d) const
+  {
+    const double* q = this->Heights;
+    const double* n = this->Positions;
+    return q[i] + d / (n[i + 1] - n[i - 1])
+      * ((n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / (n[i + 1] - n[i])
+         + (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]));
+  }
+
+  double P;
+  size_t Count;
+  double Heights[5];
+  double Positions[5];
+  double Desired[5];
+  double Increments[5];
+};
+
+#endif // STATISTICS_H
@@ -21,95 +21,163 @@
 #include "vtkPatch/vtkCustomQuaternionInterpolator.h"
 #include "vtkTransform.h"
 #include "vtkPatch/vtkCustomTupleInterpolator.h"
-#include <list>
 #include <vector>
-#include <set>
 #include <algorithm>
-#include <iterator>
+#include <cmath>
 
 vtkStandardNewMacro(vtkCustomTransformInterpolator);
 
-// PIMPL STL encapsulation for list of transforms, and list of
-// quaternions. This just keeps track of all the data the user specifies,
-// which is later dumped into the interpolators.
-struct vtkQTransform
+// PIMPL STL encapsulation of the transforms. This just keeps track of
+// all the data the user specifies, which is later dumped into the
+// interpolators. The transforms are arranged in increasing order in T,
+// each of their parameters being stored in its own contiguous array.
+class vtkTransformStore
 {
-  double Time;
-  double P[3];
-  double S[3];
-  vtkCustomQuaterniond Q;
+public:
+  std::vector<double> Times;
+  std::vector<vtkCustomQuaterniond> Orientations;
+  std::vector<double> Positions[3];
+  std::vector<double> Scales[3];
+
+  size_t Size() const { return this->Times.size(); }
+  bool Empty() const { return this->Times.empty(); }
 
-  vtkQTransform()
+  void Clear()
   {
-    this->Time = 0.0;
-    this->P[0] = this->P[1] = this->P[2] = 0.0;
-    this->S[0] = this->S[1] = this->S[2] = 0.0;
+    this->Times.clear();
+    this->Orientations.clear();
+    for (int k = 0; k < 3; ++k)
+    {
+      this->Positions[k].clear();
+      this->Scales[k].clear();
+    }
   }
-  vtkQTransform(double t, vtkTransform* xform)
+
+  void Reserve(size_t n)
   {
-    this->Time = t;
-    if (xform)
+    this->Times.reserve(n);
+    this->Orientations.reserve(n);
+    for (int k = 0; k < 3; ++k)
     {
-      xform->GetPosition(this->P);
-      xform->GetScale(this->S);
-      double q[4];
-      xform->GetOrientationWXYZ(q); // Rotation (in degrees) around unit vector
-      q[0] = vtkMath::RadiansFromDegrees(q[0]);
-      this->Q.SetRotationAngleAndAxis(q[0], q + 1);
+      this->Positions[k].reserve(n);
+      this->Scales[k].reserve(n);
+    }
+  }
 
-      if (this->Q.GetW() < 0.0)
-      {
-        this->Q = this->Q * -1;
-      }
+  // Index of the first transform whose time is not less than t
+  size_t LowerBound(double t) const
+  {
+    return std::lower_bound(this->Times.begin(), this->Times.end(), t) - this->Times.begin();
+  }
+
+  void Insert(size_t i, double t, const double P[3], const double S[3], const vtkCustomQuaterniond& Q)
+  {
+    this->Times.insert(this->Times.begin() + i, t);
+    this->Orientations.insert(this->Orientations.begin() + i, Q);
+    for (int k = 0; k < 3; ++k)
+    {
+      this->Positions[k].insert(this->Positions[k].begin() + i, P[k]);
+      this->Scales[k].insert(this->Scales[k].begin() + i, S[k]);
     }
-    else
+  }
+
+  void Set(size_t i, const double P[3], const double S[3], const vtkCustomQuaterniond& Q)
+  {
+    this->Orientations[i] = Q;
+    for (int k = 0; k < 3; ++k)
     {
-      this->P[0] = this->P[1] = this->P[2] = 0.0;
-      this->S[0] = this->S[1] = this->S[2] = 0.0;
+      this->Positions[k][i] = P[k];
+      this->Scales[k][i] = S[k];
     }
   }
-};
 
-class vtkQTransformComparator
-{
-public:
-  bool operator () ( const vtkQTransform& transform1,
-                     const vtkQTransform& transform2 )
+  void Erase(size_t i)
+  {
+    this->Times.erase(this->Times.begin() + i);
+    this->Orientations.erase(this->Orientations.begin() + i);
+    for (int k = 0; k < 3; ++k)
+    {
+      this->Positions[k].erase(this->Positions[k].begin() + i);
+      this->Scales[k].erase(this->Scales[k].begin() + i);
+    }
+  }
+
+  void GetPosition(size_t i, double P[3]) const
+  {
+    for (int k = 0; k < 3; ++k)
     {
-      return transform1.Time < transform2.Time;
+      P[k] = this->Positions[k][i];
     }
+  }
+
+  void GetScale(size_t i, double S[3]) const
+  {
+    for (int k = 0; k < 3; ++k)
+    {
+      S[k] = this->Scales[k][i];
+    }
+  }
 };
 
-// The list is arranged in increasing order in T
-class vtkTransformList : public std::list<vtkQTransform>
+namespace {
+//----------------------------------------------------------------------------
+// Decompose a transform in position, scale and orientation, the
+// orientation being kept with a positive real part
+void DecomposeTransform(vtkTransform* xform, double P[3], double S[3], vtkCustomQuaterniond& Q)
 {
-};
-typedef vtkTransformList::iterator TransformListIterator;
+  if (!xform)
+  {
+    P[0] = P[1] = P[2] = 0.0;
+    S[0] = S[1] = S[2] = 0.0;
+    Q = vtkCustomQuaterniond();
+    return;
+  }
+  xform->GetPosition(P);
+  xform->GetScale(S);
+  double q[4];
+  xform->GetOrientationWXYZ(q); // Rotation (in degrees) around unit vector
+  q[0] = vtkMath::RadiansFromDegrees(q[0]);
+  Q.SetRotationAngleAndAxis(q[0], q + 1);
+
+  if (Q.GetW() < 0.0)
+  {
+    Q = Q * -1;
+  }
+}
+
+//----------------------------------------------------------------------------
+void SetTransform(vtkTransform* xform, const vtkTransformStore& transforms, size_t n)
+{
+  double P[3], S[3], Q[4];
+  transforms.GetPosition(n, P);
+  transforms.GetScale(n, S);
+  Q[0] = vtkMath::DegreesFromRadians(transforms.Orientations[n].GetRotationAngleAndAxis(Q + 1));
+  xform->Identity();
+  xform->Translate(P);
+  xform->RotateWXYZ(Q[0], Q + 1);
+  xform->Scale(S);
+}
+}
 
 //----------------------------------------------------------------------------
 std::vector<std::vector<double> > vtkCustomTransformInterpolator::GetTransformList()
 {
   this->InitializeInterpolation();
 
-  std::vector<std::vector<double> > transforms;
-  // Okay, insert in sorted order
-  for (TransformListIterator iter = this->TransformList->begin(); iter != this->TransformList->end(); ++iter)
+  std::vector<std::vector<double> > transforms(this->Transforms->Size(), std::vector<double>(7, 0));
+  for (size_t i = 0; i < this->Transforms->Size(); ++i)
   {
-    std::vector<double> currentTransform(7, 0);
+    std::vector<double>& currentTransform = transforms[i];
     // time
-    currentTransform[0] = iter->Time;
+    currentTransform[0] = this->Transforms->Times[i];
     // position
-    currentTransform[4] = iter->P[0];
-    currentTransform[5] = iter->P[1];
-    currentTransform[6] = iter->P[2];
+    this->Transforms->GetPosition(i, &currentTransform[4]);
     // orientation
     double A[3][3];
-    iter->Q.ToMatrix3x3(A);
+    this->Transforms->Orientations[i].ToMatrix3x3(A);
     currentTransform[1] = std::atan2(A[2][1], A[2][2]);
     currentTransform[2] = -std::asin(A[2][0]);
     currentTransform[3] = std::atan2(A[1][0], A[0][0]);
-
-    transforms.push_back(currentTransform);
   }
 
   return transforms;
@@ -127,14 +195,14 @@ vtkCustomTransformInterpolator::vtkCustomTransformInterpolator()
   this->RotationInterpolator = vtkCustomQuaternionInterpolator::New();
 
   // Quaternion interpolation
-  this->TransformList = new vtkTransformList;
+  this->Transforms = new vtkTransformStore;
   this->Initialized = 0;
 }
 
 //----------------------------------------------------------------------------
 vtkCustomTransformInterpolator::~vtkCustomTransformInterpolator()
 {
-  delete this->TransformList;
+  delete this->Transforms;
 
   if (this->PositionInterpolator)
   {
@@ -178,7 +246,7 @@ vtkMTimeType vtkCustomTransformInterpolator::GetMTime()
 //----------------------------------------------------------------------------
 int vtkCustomTransformInterpolator::GetNumberOfTransforms()
 {
-  return static_cast<int>(this->TransformList->size());
+  return static_cast<int>(this->Transforms->Size());
 }
 
 //----------------------------------------------------------------------------
@@ -186,52 +254,39 @@ void vtkCustomTransformInterpolator::GetSample(int n,
                                               vtkTransform *xform,
                                               double& xformTime)
 {
-  if (this->TransformList->empty())
-  {
-    return;
-  }
-
-  this->InitializeInterpolation();
-
-  if (n < 0 || n >= static_cast<int>(this->TransformVector.size()))
+  if (n < 0 || n >= static_cast<int>(this->Transforms->Size()))
   {
     return;
   }
 
   // Get the transform
-  xform->Identity();
-  xform->Translate(this->TransformVector[n].P);
-  double Q[4];
-  Q[0] = vtkMath::DegreesFromRadians(this->TransformVector[n].Q.GetRotationAngleAndAxis(Q+1));
-  xform->RotateWXYZ(Q[0],Q+1);
-  xform->Scale(this->TransformVector[n].S);
-
-  xformTime = this->TransformVector[n].Time;
+  SetTransform(xform, *this->Transforms, n);
+  xformTime = this->Transforms->Times[n];
 }
 
 //----------------------------------------------------------------------------
 double vtkCustomTransformInterpolator::GetMinimumT()
 {
-  if (this->TransformList->empty())
+  if (this->Transforms->Empty())
   {
     return -VTK_FLOAT_MAX;
   }
   else
   {
-    return this->TransformList->front().Time;
+    return this->Transforms->Times.front();
   }
 }
 
 //----------------------------------------------------------------------------
 double vtkCustomTransformInterpolator::GetMaximumT()
 {
-  if (this->TransformList->empty())
+  if (this->Transforms->Empty())
   {
     return VTK_FLOAT_MAX;
   }
   else
   {
-    return this->TransformList->back().Time;
+    return this->Transforms->Times.back();
   }
 }
 
@@ -244,47 +299,87 @@ double vtkCustomTransformInterpolator::GetPeriod()
 //----------------------------------------------------------------------------
 void vtkCustomTransformInterpolator::Initialize()
 {
-  this->TransformList->clear();
+  this->Transforms->Clear();
+  this->Modified();
 }
 
 //----------------------------------------------------------------------------
 void vtkCustomTransformInterpolator::AddTransform(double t, vtkTransform* xform)
 {
-  int size = static_cast<int>(this->TransformList->size());
+  double P[3], S[3];
+  vtkCustomQuaterniond Q;
+  DecomposeTransform(xform, P, S, Q);
 
-  // Check special cases: t at beginning or end of list
-  if (size <= 0 || t < this->TransformList->front().Time)
+  // appending in order is the common case, then
+  // the transform is inserted in sorted order
+  size_t i = this->Transforms->Size();
+  if (!this->Transforms->Empty() && t <= this->Transforms->Times.back())
   {
-    this->TransformList->push_front(vtkQTransform(t, xform));
-    return;
+    i = this->Transforms->LowerBound(t);
   }
-  else if (t > this->TransformList->back().Time)
+  if (i < this->Transforms->Size() && this->Transforms->Times[i] == t)
   {
-    this->TransformList->push_back(vtkQTransform(t, xform));
-    return;
+    this->Transforms->Set(i, P, S, Q);
   }
-  else if (size == 1 && t == this->TransformList->back().Time)
+  else
   {
-    this->TransformList->front() = vtkQTransform(t, xform);
-    return;
+    this->Transforms->Insert(i, t, P, S, Q);
+  }
+
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkCustomTransformInterpolator::SetTransforms(int n, const double* times,
+                                                  const double* orientations,
+                                                  const double* positions)
+{
+  this->Transforms->Clear();
+  this->Transforms->Reserve(n);
+
+  // order the transforms by time, skipping the nan times,
+  // which only requires a copy if they are already sorted
+  std::vector<int> order;
+  order.reserve(n);
+  bool sorted = true;
+  for (int i = 0; i < n; ++i)
+  {
+    if (vtkMath::IsNan(times[i]))
+    {
+      continue;
+    }
+    sorted = sorted && (order.empty() || times[order.back()] <= times[i]);
+    order.push_back(i);
+  }
+  if (!sorted)
+  {
+    std::stable_sort(order.begin(), order.end(),
+                     [times](int i, int j) { return times[i] < times[j]; });
   }
 
-  // Okay, insert in sorted order
-  TransformListIterator iter = this->TransformList->begin();
-  TransformListIterator nextIter = ++(this->TransformList->begin());
-  for (int i = 0; i < (size - 1); i++, ++iter, ++nextIter)
+  const double S[3] = {1.0, 1.0, 1.0};
+  for (int i : order)
   {
-    if (t == iter->Time)
+    const double* q = orientations + 4 * i;
+    vtkCustomQuaterniond Q(q[0], q[1], q[2], q[3]);
+    Q.Normalize();
+    if (Q.GetW() < 0.0)
+    {
+      Q = Q * -1;
+    }
+    // using the same time more than once keeps the last transform
+    if (!this->Transforms->Empty() && this->Transforms->Times.back() == times[i])
     {
-      (*iter) = vtkQTransform(t, xform);
+      this->Transforms->Set(this->Transforms->Size() - 1, positions + 3 * i, S, Q);
     }
-    else if (t > iter->Time && t < nextIter->Time)
+    else
     {
-      this->TransformList->insert(nextIter, vtkQTransform(t, xform));
+      this->Transforms->Insert(this->Transforms->Size(), times[i], positions + 3 * i, S, Q);
     }
   }
 
   this->Modified();
+  return static_cast<int>(this->Transforms->Size());
 }
 
 //----------------------------------------------------------------------------
@@ -305,18 +400,11 @@ void vtkCustomTransformInterpolator::AddTransform(double t, vtkProp3D* prop3D)
 //----------------------------------------------------------------------------
 void vtkCustomTransformInterpolator::RemoveTransform(double t)
 {
-  if (t < this->TransformList->front().Time || t > this->TransformList->back().Time)
-  {
-    return;
-  }
-
-  TransformListIterator iter = this->TransformList->begin();
-  for (; iter->Time != t && iter != this->TransformList->end(); ++iter)
+  size_t i = this->Transforms->LowerBound(t);
+  if (i < this->Transforms->Size() && this->Transforms->Times[i] == t)
   {
-  }
-  if (iter != this->TransformList->end())
-  {
-    this->TransformList->erase(iter);
+    this->Transforms->Erase(i);
+    this->Modified();
   }
 }
 
@@ -377,7 +465,7 @@ void vtkCustomTransformInterpolator::SetRotationInterpolator(vtkCustomQuaternion
 //----------------------------------------------------------------------------
 void vtkCustomTransformInterpolator::InitializeInterpolation()
 {
-  if (this->TransformList->empty())
+  if (this->Transforms->Empty())
   {
     return;
   }
@@ -405,13 +493,6 @@ void vtkCustomTransformInterpolator::InitializeInterpolation()
       this->PositionInterpolator->SetInterpolationTypeToLinear();
       this->ScaleInterpolator->SetInterpolationTypeToLinear();
       this->RotationInterpolator->SetInterpolationTypeToLinear();
-      this->TransformVector.clear();
-      this->TransformVector.resize(0);
-      std::list<vtkQTransform>::iterator transform;
-      for (transform = this->TransformList->begin(); transform != this->TransformList->end(); ++transform)
-      {
-        this->TransformVector.push_back(*transform);
-      }
     }
     else if (this->InterpolationType == INTERPOLATION_TYPE_SPLINE)
     {
@@ -431,48 +512,29 @@ void vtkCustomTransformInterpolator::InitializeInterpolation()
     this->PositionInterpolator->SetNumberOfComponents(3);
     this->ScaleInterpolator->SetNumberOfComponents(3);
 
-    // Okay, now we can load the interpolators with data
-    // Initialize the data pointers
-    int nb = this->TransformList->size();
-    double *time = new double[nb];
-    double **Position = new double*[3];
-    double **Scale = new double*[3];
+    // Okay, now we can load the interpolators with data,
+    // which is already stored by component
+    int nb = static_cast<int>(this->Transforms->Size());
+    double* Position[3];
+    double* Scale[3];
     for (int k = 0; k < 3; ++k)
     {
-      Position[k] = new double[nb];
-      Scale[k] = new double[nb];
+      Position[k] = this->Transforms->Positions[k].data();
+      Scale[k] = this->Transforms->Scales[k].data();
     }
-
-    // Fill the data pointers
-    TransformListIterator iter = this->TransformList->begin();
-    int count = 0;
-    for ( ; iter != this->TransformList->end(); ++iter)
+    for (int i = 0; i < nb; ++i)
     {
-      /*this->PositionInterpolator->AddTuple(iter->Time,iter->P);
-      this->ScaleInterpolator->AddTuple(iter->Time,iter->S);*/
-      Position[0][count] = iter->P[0];
-      Position[1][count] = iter->P[1];
-      Position[2][count] = iter->P[2];
-      Scale[0][count] = iter->S[0];
-      Scale[1][count] = iter->S[1];
-      Scale[2][count] = iter->S[2];
-      time[count] = iter->Time;
-      this->RotationInterpolator->AddQuaternion(iter->Time,iter->Q);
-      count++;
+      this->RotationInterpolator->AddQuaternion(this->Transforms->Times[i], this->Transforms->Orientations[i]);
     }
 
     // Fill the interpolators
-    this->PositionInterpolator->FillFromData(nb, time, Position);
-    this->ScaleInterpolator->FillFromData(nb, time, Scale);
+    this->PositionInterpolator->FillFromData(nb, this->Transforms->Times.data(), Position);
+    this->ScaleInterpolator->FillFromData(nb, this->Transforms->Times.data(), Scale);
 
-    for (int k = 0; k < 3; ++k)
-    {
-      delete [] Position[k];
-      delete [] Scale[k];
-    }
-
-    delete [] Position;
-    delete [] Scale;
+    // Most trajectories are almost uniformly sampled
+    this->PositionInterpolator->BuildUniformTimeIndex();
+    this->ScaleInterpolator->BuildUniformTimeIndex();
+    this->RotationInterpolator->BuildUniformTimeIndex();
 
     this->Initialized = 1;
     this->InitializeTime.Modified();
@@ -482,7 +544,7 @@ void vtkCustomTransformInterpolator::InitializeInterpolation()
 //----------------------------------------------------------------------------
 void vtkCustomTransformInterpolator::InterpolateTransform(double t, vtkTransform* xform)
 {
-  if (this->TransformList->empty())
+  if (this->Transforms->Empty())
   {
     return;
   }
@@ -499,14 +561,14 @@ void vtkCustomTransformInterpolator::InterpolateTransform(double t, vtkTransform
   this->InitializeInterpolation();
 
   // Evaluate the interpolators
-  if (t < this->TransformList->front().Time)
+  if (t < this->Transforms->Times.front())
   {
-    t = this->TransformList->front().Time;
+    t = this->Transforms->Times.front();
   }
 
-  else if (t > this->TransformList->back().Time)
+  else if (t > this->Transforms->Times.back())
   {
-    t = this->TransformList->back().Time;
+    t = this->Transforms->Times.back();
   }
 
   double P[3], S[3], Q[4];
@@ -525,36 +587,24 @@ void vtkCustomTransformInterpolator::InterpolateTransform(double t, vtkTransform
 void vtkCustomTransformInterpolator::InterpolateTransformNearest(double t,
                                                     vtkTransform *xform)
 {
-  if (this->TransformList->empty())
-  {
-    return;
-  }
-
   // Make sure the xform and this class are initialized properly
   xform->Identity();
-  this->InitializeInterpolation();
-
-  if (this->TransformVector.size() < 2)
+  if (this->Transforms->Size() < 2)
   {
     return;
   }
 
-  // vtkQTransform order relation based on the Time
-  vtkQTransformComparator comparatorTimeTransform;
-
   // Get the low bound to procees to a nearest
   // low bounded interpolator
-  vtkQTransform transform;
-  transform.Time = t;
-  std::vector<vtkQTransform>::iterator lowerBound;
-  lowerBound = std::lower_bound(this->TransformVector.begin(), this->TransformVector.end(), transform, comparatorTimeTransform);
+  size_t lowerBound = std::min(this->Transforms->LowerBound(t), this->Transforms->Size() - 1);
+  const std::vector<double>& times = this->Transforms->Times;
 
   if (this->InterpolationType == INTERPOLATION_TYPE_NEAREST_LOW_BOUNDED)
   {
     // Are we before the first node? If not take the
     // previous transform to have a low bounded nearest
     // interpolator.
-    if (!(lowerBound == this->TransformVector.begin()))
+    if (lowerBound != 0)
     {
       lowerBound--;
     }
@@ -567,20 +617,182 @@ void vtkCustomTransformInterpolator::InterpolateTransformNearest(double t,
     // Because t has already been clamped,
     // lowerBound->Time - t should be positive
     // but adding std::abs makes the code more robust.
-    if (lowerBound != this->TransformVector.begin() &&
-        t - (lowerBound - 1)->Time <= std::abs(lowerBound->Time - t))
+    if (lowerBound != 0 &&
+        t - times[lowerBound - 1] <= std::abs(times[lowerBound] - t))
     {
       lowerBound--;
     }
   }
 
   // Get the transform
-  xform->Identity();
-  xform->Translate(lowerBound->P);
-  double Q[4];
-  Q[0] = vtkMath::DegreesFromRadians(lowerBound->Q.GetRotationAngleAndAxis(Q+1));
-  xform->RotateWXYZ(Q[0],Q+1);
-  xform->Scale(lowerBound->S);
+  SetTransform(xform, *this->Transforms, lowerBound);
+}
+
+//----------------------------------------------------------------------------
+void vtkCustomTransformInterpolator::InterpolateTransforms(int n, const double* times,
+                                                          double* orientations,
+                                                          double* positions,
+                                                          double* scales)
+{
+  if (this->Transforms->Empty() || n <= 0)
+  {
+    return;
+  }
+  const vtkTransformStore& transforms = *this->Transforms;
+  const size_t last = transforms.Size() - 1;
+  const double tMin = transforms.Times.front();
+  const double tMax = transforms.Times.back();
+
+  // The splines are evaluated by the interpolators
+  if (this->InterpolationType == INTERPOLATION_TYPE_SPLINE
+      || this->InterpolationType == INTERPOLATION_TYPE_MANUAL)
+  {
+    this->InitializeInterpolation();
+    double S[3];
+    std::vector<double> clampedTimes(n);
+    for (int k = 0; k < n; ++k)
+    {
+      const double t = std::min(std::max(times[k], tMin), tMax);
+      this->PositionInterpolator->InterpolateTupleDichotomic(t, positions + 3 * k);
+      this->ScaleInterpolator->InterpolateTupleDichotomic(t, scales ? scales + 3 * k : S);
+      clampedTimes[k] = t;
+    }
+    this->RotationInterpolator->InterpolateQuaternions(n, clampedTimes.data(), orientations);
+    return;
+  }
+
+  const bool nearest = this->InterpolationType == INTERPOLATION_TYPE_NEAREST
+                    || this->InterpolationType == INTERPOLATION_TYPE_NEAREST_LOW_BOUNDED;
+  // the linear interpolation gathers the orientations bracketing each time,
+  // the first ones directly in the output, then slerps them all at once
+  std::vector<double> nextOrientations, weights;
+  if (!nearest)
+  {
+    nextOrientations.resize(4 * n);
+    weights.resize(n);
+  }
+  size_t i = 0; // transforms i and i + 1 bracket the current time
+  for (int k = 0; k < n; ++k)
+  {
+    double* Q = orientations + 4 * k;
+    double* P = positions + 3 * k;
+    double* S = scales ? scales + 3 * k : nullptr;
+
+    // same as InterpolateTransformNearest()
+    if (nearest && transforms.Size() < 2)
+    {
+      Q[0] = 1.0;
+      Q[1] = Q[2] = Q[3] = 0.0;
+      P[0] = P[1] = P[2] = 0.0;
+      if (S)
+      {
+        S[0] = S[1] = S[2] = 1.0;
+      }
+      continue;
+    }
+
+    // update the bracketing transforms, restarting the search
+    // when the time is not after the previous one
+    const double t = std::min(std::max(times[k], tMin), tMax);
+    if (t < transforms.Times[i])
+    {
+      i = 0;
+    }
+    if (i < last && transforms.Times[i + 1] <= t)
+    {
+      ++i;
+      if (i < last && transforms.Times[i + 1] <= t)
+      {
+        i = std::upper_bound(transforms.Times.begin() + i + 1, transforms.Times.end(), t)
+          - transforms.Times.begin() - 1;
+      }
+    }
+
+    size_t j = i;
+    if (this->InterpolationType == INTERPOLATION_TYPE_NEAREST_LOW_BOUNDED)
+    {
+      // the transform before the first one not less than t
+      if (transforms.Times[i] == t && i > 0)
+      {
+        j = i - 1;
+      }
+    }
+    else if (this->InterpolationType == INTERPOLATION_TYPE_NEAREST)
+    {
+      if (i < last && transforms.Times[i + 1] - t < t - transforms.Times[i])
+      {
+        j = i + 1;
+      }
+    }
+    else if (i < last)
+    {
+      // linear interpolation between the transforms i and i + 1
+      const double u = (t - transforms.Times[i]) / (transforms.Times[i + 1] - transforms.Times[i]);
+      transforms.Orientations[i].Get(Q);
+      transforms.Orientations[i + 1].Get(nextOrientations.data() + 4 * k);
+      weights[k] = u;
+      for (int c = 0; c < 3; ++c)
+      {
+        P[c] = (1.0 - u) * transforms.Positions[c][i] + u * transforms.Positions[c][i + 1];
+        if (S)
+        {
+          S[c] = (1.0 - u) * transforms.Scales[c][i] + u * transforms.Scales[c][i + 1];
+        }
+      }
+      continue;
+    }
+
+    transforms.Orientations[j].Get(Q);
+    transforms.GetPosition(j, P);
+    if (S)
+    {
+      transforms.GetScale(j, S);
+    }
+    if (!nearest)
+    {
+      transforms.Orientations[j].Get(nextOrientations.data() + 4 * k);
+      weights[k] = 0.0;
+    }
+  }
+
+  if (!nearest)
+  {
+    const double maxNlerpAngle =
+      this->RotationInterpolator ? this->RotationInterpolator->GetMaximumNlerpAngle() : 0.0;
+    vtkCustomQuaterniond::BatchSlerp(n, weights.data(), orientations, nextOrientations.data(),
+                                     orientations, maxNlerpAngle);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkCustomTransformInterpolator::InterpolateTransforms(int n, const double* times,
+                                                          double* matrices)
+{
+  if (this->Transforms->Empty() || n <= 0)
+  {
+    return;
+  }
+  std::vector<double> orientations(4 * n), positions(3 * n), scales(3 * n);
+  this->InterpolateTransforms(n, times, orientations.data(), positions.data(), scales.data());
+
+  // same composition as InterpolateTransform(): translation, rotation, then scale
+  std::vector<double> rotations(9 * n);
+  vtkCustomQuaterniond::BatchToMatrix3x3(n, orientations.data(), rotations.data());
+  for (int k = 0; k < n; ++k)
+  {
+    const double* A = rotations.data() + 9 * k;
+    double* M = matrices + 16 * k;
+    for (int r = 0; r < 3; ++r)
+    {
+      for (int c = 0; c < 3; ++c)
+      {
+        M[4 * r + c] = A[3 * r + c] * scales[3 * k + c];
+      }
+      M[4 * r + 3] = positions[3 * k + r];
+    }
+    M[12] = M[13] = M[14] = 0.0;
+    M[15] = 1.0;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -55,8 +55,7 @@ class vtkMatrix4x4;
 class vtkProp3D;
 class vtkCustomTupleInterpolator;
 class vtkCustomQuaternionInterpolator;
-class vtkTransformList;
-struct vtkQTransform;
+class vtkTransformStore;
 
 class VTK_EXPORT vtkCustomTransformInterpolator : public vtkObject
 {
@@ -99,6 +98,15 @@ public:
   void AddTransform(double t, vtkMatrix4x4* matrix);
   void AddTransform(double t, vtkProp3D* prop3D);
 
+  // Description:
+  // Replace all the transforms by n rigid transforms given as contiguous
+  // arrays of times, orientations (unit quaternions as w, x, y, z) and
+  // positions. This is linear in n when the times are sorted. The
+  // transforms with a nan time are skipped, and using the same time more
+  // than once keeps the last transform. Return the number of transforms kept.
+  int SetTransforms(int n, const double* times, const double* orientations,
+                    const double* positions);
+
   // Description:
   // Delete the transform at a particular parameter t. If there is no
   // transform defined at location t, then the method does nothing.
@@ -110,6 +118,24 @@ public:
   // (min,max) values, then t is clamped.
   void InterpolateTransform(double t, vtkTransform* xform);
 
+  // Description:
+  // Interpolate the transforms at n times at once, filling the caller
+  // provided arrays with the orientations (unit quaternions as w, x, y, z),
+  // the positions and optionally the scales. The times are clamped like in
+  // InterpolateTransform(). When they are sorted in increasing order, the
+  // transforms bracketing each time are found from the ones of the
+  // previous time, which makes the search constant for dense queries.
+  // The orientations are slerped all at once, and approximated without
+  // trigonometric function under the MaximumNlerpAngle of the rotation
+  // interpolator.
+  void InterpolateTransforms(int n, const double* times, double* orientations,
+                             double* positions, double* scales = nullptr);
+
+  // Description:
+  // Same as above, filling an array of n 4x4 matrices stored in row major
+  // order like the elements of a vtkMatrix4x4.
+  void InterpolateTransforms(int n, const double* times, double* matrices);
+
   // Description:
   // Return the transform list
   std::vector<std::vector<double> > GetTransformList();
@@ -191,8 +217,7 @@ protected:
   void InitializeInterpolation();
 
   // Keep track of inserted data
-  vtkTransformList* TransformList;
-  std::vector<vtkQTransform> TransformVector;
+  vtkTransformStore* Transforms;
 
 private:
   vtkCustomTransformInterpolator(const vtkCustomTransformInterpolator&); // Not implemented.
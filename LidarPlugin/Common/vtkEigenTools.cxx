@@ -17,55 +17,210 @@
 
 // STD
 #include <algorithm>
+#include <map>
+#include <memory>
 #include <random>
 #include <iostream>
 #include <iomanip>
 #include <numeric>
 #include <vtkMath.h>
 
+// BOOST
+#include <boost/thread.hpp>
+#include <boost/thread/barrier.hpp>
+
 // LOCAL
 #include "vtkEigenTools.h"
+#include "ParallelFor.h"
+
+namespace
+{
+// Size of the chunks of samples of the reductions: a thread is only used
+// for each chunk of samples
+const int ReductionChunkSize = 8192;
+
+//-----------------------------------------------------------------------------
+unsigned int NumberOfReductionThreads(int nbChunks, unsigned int nbThreads)
+{
+  return std::max(1u, std::min(Parallel::GetNumberOfThreads(nbThreads),
+                               static_cast<unsigned int>(std::max(1, nbChunks))));
+}
 
 //-----------------------------------------------------------------------------
-Eigen::Quaterniond AvgUnitQuaternions(const std::vector<Eigen::Quaterniond>& Q)
+// Average of the outer products q * q^T of unit quaternions given as (w, x, y, z)
+// by getQuaternion(i), its eigenvector of largest eigenvalue being the average
+template<typename F>
+Eigen::Quaterniond AvgOuterProducts(size_t size, unsigned int nbThreads, const F& getQuaternion)
 {
+  if (size == 0)
+  {
+    return Eigen::Quaterniond(0, 0, 0, 0);
+  }
+  const int nbChunks = static_cast<int>((size + ReductionChunkSize - 1) / ReductionChunkSize);
+  nbThreads = NumberOfReductionThreads(nbChunks, nbThreads);
+
+  // each thread sums the outer products of its part of the quaternions
+  std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>> partialSums(nbThreads);
+  Parallel::ForEachPart(size, nbThreads, [&](unsigned int thread, size_t begin, size_t end)
+  {
+    Eigen::Matrix4d A = Eigen::Matrix4d::Zero();
+    for (size_t i = begin; i < end; ++i)
+    {
+      const Eigen::Vector4d q = getQuaternion(i);
+      A.selfadjointView<Eigen::Lower>().rankUpdate(q);
+    }
+    partialSums[thread] = A;
+  });
   Eigen::Matrix4d A = Eigen::Matrix4d::Zero();
-  for (size_t i = 0; i < Q.size(); i++)
+  for (const Eigen::Matrix4d& partialSum : partialSums)
   {
-    Eigen::Vector4d q = Eigen::Vector4d(Q[i].w(), Q[i].x(), Q[i].y(), Q[i].z());
-    A = A + q * q.transpose();
+    A += partialSum;
   }
+  A /= static_cast<double>(size);
 
-  A = (1.0 / Q.size()) * A;
-  Eigen::EigenSolver<Eigen::Matrix4d> eig(A);
+  // A is symmetric: its eigenvalues are real and sorted in increasing order
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix4d> eig(A);
+  const Eigen::Vector4d avg = eig.eigenvectors().col(3);
+  return Eigen::Quaterniond(avg(0), avg(1), avg(2), avg(3));
+}
 
-  if ((eig.eigenvectors()(0,0).real() == eig.eigenvectors()(0,0)) &&
-      (eig.eigenvectors()(1,0).real() == eig.eigenvectors()(1,0)) &&
-      (eig.eigenvectors()(2,0).real() == eig.eigenvectors()(2,0)) &&
-      (eig.eigenvectors()(3,0).real() == eig.eigenvectors()(3,0)))
+//-----------------------------------------------------------------------------
+// Weiszfeld iterations on the columns of X, fixed-size when Dim is not dynamic.
+// The threads are started once and synchronized at each iteration. The
+// residual of the optimality condition at the current estimation, sum of the
+// unit vectors from it to the samples, is obtained from the sums of the
+// iteration that computes the next estimation: the convergence test costs
+// no additional pass over the samples
+template<int Dim>
+Eigen::Matrix<double, Dim, 1> WeiszfeldMedian(const Eigen::Matrix<double, Dim, Eigen::Dynamic>& X,
+                                              double epsilon, unsigned int maxCount,
+                                              unsigned int nbThreads)
+{
+  typedef Eigen::Matrix<double, Dim, 1> Vector;
+  const Eigen::Index nbSamples = X.cols();
+  if (nbSamples == 0)
   {
-    return Eigen::Quaterniond(eig.eigenvectors()(0,0).real(),
-                              eig.eigenvectors()(1,0).real(),
-                              eig.eigenvectors()(2,0).real(),
-                              eig.eigenvectors()(3,0).real());
+    return Vector::Zero(X.rows());
   }
-  else
+
+  // Initialize the first median estimation to the mean
+  Vector median = X.rowwise().mean();
+  if (nbSamples == 1)
   {
-    std::cerr << "eigen decomposition has complex eigen values" << std::endl;
-    // return the identity matrix
-    return Eigen::Quaterniond(0, 0, 0, 0);
+    return median;
+  }
+
+  const int nbChunks = static_cast<int>((nbSamples + ReductionChunkSize - 1) / ReductionChunkSize);
+  nbThreads = NumberOfReductionThreads(nbChunks, nbThreads);
+  // the chunks are shared between the threads by stride and their partial sums are
+  // added in order, so that the median does not depend on the number of threads
+  std::vector<Vector, Eigen::aligned_allocator<Vector>> partialSums(nbChunks, Vector::Zero(X.rows()));
+  std::vector<double> partialWeights(nbChunks, 0.0);
+  auto reduceChunks = [&](unsigned int thread)
+  {
+    for (int chunk = thread; chunk < nbChunks; chunk += nbThreads)
+    {
+      Vector sum = Vector::Zero(X.rows());
+      double weight = 0.0;
+      const Eigen::Index end = std::min(nbSamples, static_cast<Eigen::Index>(chunk + 1) * ReductionChunkSize);
+      for (Eigen::Index i = static_cast<Eigen::Index>(chunk) * ReductionChunkSize; i < end; ++i)
+      {
+        const double dist = (X.col(i) - median).norm();
+        // a sample on the estimation does not pull it in any direction
+        if (dist > 0.0)
+        {
+          const double invDist = 1.0 / dist;
+          sum += invDist * X.col(i);
+          weight += invDist;
+        }
+      }
+      partialSums[chunk] = sum;
+      partialWeights[chunk] = weight;
+    }
+  };
+
+  bool isDone = false;
+  boost::barrier start(nbThreads), finish(nbThreads);
+  std::vector<std::unique_ptr<boost::thread>> threads;
+  for (unsigned int i = 1; i < nbThreads; ++i)
+  {
+    threads.emplace_back(new boost::thread([&, i]()
+    {
+      while (start.wait(), !isDone)
+      {
+        reduceChunks(i);
+        finish.wait();
+      }
+    }));
+  }
+
+  // Refine the median estimation by iteratively re-weight least squares
+  for (unsigned int count = 0; count < maxCount; ++count)
+  {
+    if (nbThreads > 1)
+    {
+      start.wait();
+    }
+    reduceChunks(0);
+    if (nbThreads > 1)
+    {
+      finish.wait();
+    }
+
+    Vector sum = Vector::Zero(X.rows());
+    double weight = 0.0;
+    for (int chunk = 0; chunk < nbChunks; ++chunk)
+    {
+      sum += partialSums[chunk];
+      weight += partialWeights[chunk];
+    }
+    if (weight == 0.0 || (sum - weight * median).norm() <= epsilon)
+    {
+      break;
+    }
+    median = sum / weight;
+  }
+
+  isDone = true;
+  if (nbThreads > 1)
+  {
+    start.wait();
   }
+  for (auto& thread : threads)
+  {
+    thread->join();
+  }
+  return median;
+}
 }
 
 //-----------------------------------------------------------------------------
-Eigen::Matrix3d AvgRotation(const std::vector<Eigen::Matrix3d>& rotations)
+Eigen::Quaterniond AvgUnitQuaternions(const std::vector<Eigen::Quaterniond>& Q, unsigned int nbThreads)
 {
-  std::vector<Eigen::Quaterniond> Q = std::vector<Eigen::Quaterniond>(rotations.size());
-  for (size_t i = 0; i < rotations.size(); i++)
+  return AvgOuterProducts(Q.size(), nbThreads, [&Q](size_t i)
   {
-    Q[i] = Eigen::Quaterniond(rotations[i]);
-  }
-  Eigen::Quaterniond avg = AvgUnitQuaternions(Q);
+    return Eigen::Vector4d(Q[i].w(), Q[i].x(), Q[i].y(), Q[i].z());
+  });
+}
+
+//-----------------------------------------------------------------------------
+Eigen::Quaterniond AvgUnitQuaternions(const Eigen::Matrix4Xd& Q, unsigned int nbThreads)
+{
+  return AvgOuterProducts(static_cast<size_t>(Q.cols()), nbThreads, [&Q](size_t i)
+  {
+    return Eigen::Vector4d(Q.col(i));
+  });
+}
+
+//-----------------------------------------------------------------------------
+Eigen::Matrix3d AvgRotation(const std::vector<Eigen::Matrix3d>& rotations, unsigned int nbThreads)
+{
+  // the rotations are converted chunk by chunk, without storing the quaternions
+  Eigen::Quaterniond avg = AvgOuterProducts(rotations.size(), nbThreads, [&rotations](size_t i)
+  {
+    const Eigen::Quaterniond q(rotations[i]);
+    return Eigen::Vector4d(q.w(), q.x(), q.y(), q.z());
+  });
   return avg.normalized().toRotationMatrix();
 }
 
@@ -218,107 +373,147 @@ Eigen::Matrix3d ComputeHomography(const std::vector<Eigen::Vector2d>& x,
   return H;
 }
 
+namespace
+{
+//----------------------------------------------------------------------------
+// Weights of the MLS smoothing of a point having "before" neighbors before it
+// and "after" neighbors after it: the smoothed point is the projection of the
+// point on the polynome fitted on its neighborhood, which is a linear
+// combination of the neighbors that only depends on the shape of the window
+Eigen::VectorXd MLSWeights(int polDeg, int before, int after)
+{
+  int neighCardinal = before + after + 1;
+  if (neighCardinal == 1)
+  {
+    return Eigen::VectorXd::Ones(1);
+  }
+
+  // Loop over neighborhood to compute the normal equations
+  Eigen::MatrixXd M(neighCardinal, polDeg + 1);
+  for (int neighIndex = 0; neighIndex < neighCardinal; ++neighIndex)
+  {
+    // time value in [-1.0, 1.0]
+    double t = -1.0 + 2.0 * static_cast<double>(neighIndex) / static_cast<double>(neighCardinal - 1);
+    // Loop over the polynomial degree
+    for (int power = 0; power <= polDeg; ++power)
+    {
+      M(neighIndex, power) = std::pow(t, power);
+    }
+  }
+
+  // evaluation of the polynome at the time of the point
+  double t = -1.0 + 2.0 * static_cast<double>(before) / static_cast<double>(neighCardinal - 1);
+  Eigen::VectorXd powers(polDeg + 1);
+  for (int power = 0; power <= polDeg; ++power)
+  {
+    powers(power) = std::pow(t, power);
+  }
+  return M * (M.transpose() * M).inverse() * powers;
+}
+}
+
+//----------------------------------------------------------------------------
+void EuclideanMLSSmoothing(const std::vector<Eigen::VectorXd>& X,
+                           std::vector<Eigen::VectorXd>& Y,
+                           int polDeg, int kernelRadius,
+                           unsigned int nbThreads)
+{
+  EuclideanMLSSmoothing(X, Y, polDeg, kernelRadius, 0, static_cast<int>(X.size()), nbThreads);
+}
+
 //----------------------------------------------------------------------------
 void EuclideanMLSSmoothing(const std::vector<Eigen::VectorXd>& X,
                            std::vector<Eigen::VectorXd>& Y,
-                           int polDeg, int kernelRadius)
+                           int polDeg, int kernelRadius,
+                           int begin, int end,
+                           unsigned int nbThreads)
 {
-  int dim = X[0].rows();
   // initialize Y on X
   Y = X;
+  const int nbPoints = static_cast<int>(X.size());
+  begin = std::max(0, begin);
+  end = std::min(nbPoints, end);
+  if (begin >= end)
+  {
+    return;
+  }
 
-  // Loop over the points of the trajectory
-  for (int pointIndex = 0; pointIndex < Y.size(); ++pointIndex)
+  // The samples are parametrized by their index, so all the windows that
+  // are not clipped by the ends of the trajectory share the same weights.
+  // The weights of the clipped windows are computed once per shape
+  auto windowShape = [nbPoints, kernelRadius](int pointIndex)
   {
-    // neighborhood information
     int minNeighIndex = std::max(0, pointIndex - kernelRadius);
-    int maxNeighIndex = std::min(static_cast<int>(Y.size()) - 1, pointIndex + kernelRadius);
-    int neighCardinal = maxNeighIndex - minNeighIndex + 1;
-
-    // Loop over neighborhood to compute the normal equations
-    Eigen::MatrixXd M(neighCardinal, polDeg + 1);
-    std::vector<Eigen::MatrixXd> U(dim, Eigen::MatrixXd(neighCardinal, 1));
-    for (int neighIndex = minNeighIndex; neighIndex <= maxNeighIndex; ++neighIndex)
+    int maxNeighIndex = std::min(nbPoints - 1, pointIndex + kernelRadius);
+    return std::make_pair(pointIndex - minNeighIndex, maxNeighIndex - pointIndex);
+  };
+  std::map<std::pair<int, int>, Eigen::VectorXd> weights;
+  for (int pointIndex = begin; pointIndex < end; ++pointIndex)
+  {
+    std::pair<int, int> shape = windowShape(pointIndex);
+    if (weights.find(shape) == weights.end())
     {
-      // time value in [-1.0, 1.0]
-      double t = -1.0 + 2.0 * static_cast<double>(neighIndex - minNeighIndex) / static_cast<double>(maxNeighIndex - minNeighIndex);
-      // Loop over the polynomial degree
-      for (int power = 0; power <= polDeg; ++power)
-      {
-        M(neighIndex - minNeighIndex, power) = std::pow(t, power);
-      }
-      // loop over the coordinates
-      for (int coord = 0; coord < dim; ++coord)
-      {
-        U[coord](neighIndex - minNeighIndex) = X[neighIndex](coord);
-      }
+      weights[shape] = MLSWeights(polDeg, shape.first, shape.second);
     }
-
-    // Solve the normals equation to get the polynomial parameters
-    std::vector<Eigen::MatrixXd> w(dim);
-    Eigen::MatrixXd MtM_1 = (M.transpose() * M).inverse();
-    for (int coord = 0; coord < dim; ++coord)
+    // the next windows are not clipped until the end of the trajectory
+    if (shape.first == kernelRadius && shape.second == kernelRadius)
     {
-      w[coord] =MtM_1 * M.transpose() * U[coord];
+      pointIndex = std::max(pointIndex, nbPoints - kernelRadius - 1);
     }
+  }
 
-    // Now, project the point on the approximated polynome
-    double t = -1.0 + 2.0 * static_cast<double>(pointIndex - minNeighIndex) / static_cast<double>(maxNeighIndex - minNeighIndex);
-    for (int coord = 0; coord < dim; ++coord)
+  // Loop over the points of the trajectory, each thread taking a chunk of
+  // points at a time
+  const int chunkSize = 4096;
+  Parallel::ForEachChunk(end - begin, chunkSize, nbThreads,
+                         [&](unsigned int, size_t chunkBegin, size_t chunkEnd)
+  {
+    const int last = begin + static_cast<int>(chunkEnd);
+    for (int pointIndex = begin + static_cast<int>(chunkBegin); pointIndex < last; ++pointIndex)
     {
-      Y[pointIndex](coord) = 0;
-      for (int power = 0; power <= polDeg; ++power)
+      std::pair<int, int> shape = windowShape(pointIndex);
+      const Eigen::VectorXd& w = weights.find(shape)->second;
+      Eigen::VectorXd& y = Y[pointIndex];
+      y.setZero();
+      for (int k = 0; k < w.size(); ++k)
       {
-        Y[pointIndex](coord) += w[coord](power) * std::pow(t, power);
+        y += w(k) * X[pointIndex - shape.first + k];
       }
     }
-  }
+  });
 }
 
 //-----------------------------------------------------------------------------
-Eigen::VectorXd MultivariateMedian(const std::vector<Eigen::VectorXd> X, double epsilon, unsigned int maxCount)
+Eigen::VectorXd MultivariateMedian(const std::vector<Eigen::VectorXd>& X, double epsilon,
+                                   unsigned int maxCount, unsigned int nbThreads)
 {
   if (X.size() == 0)
   {
     return Eigen::VectorXd::Zero(1, 1);
   }
 
-  if (X.size() == 1)
+  // copy the samples in contiguous storage, with fixed-size columns for the
+  // usual dimensions
+  const Eigen::Index dim = X[0].size();
+  Eigen::MatrixXd samples(dim, static_cast<Eigen::Index>(X.size()));
+  for (size_t i = 0; i < X.size(); ++i)
   {
-    return X[0];
+    samples.col(i) = X[i];
   }
-
-  // Initialize the first median estimation to the mean
-  Eigen::VectorXd Median = Eigen::VectorXd::Zero(X[0].size(), 1);
-  for (int i = 0; i < X.size(); ++i)
+  if (dim == 2)
   {
-    Median += X[i] / static_cast<double>(X.size());
+    return WeiszfeldMedian<2>(samples, epsilon, maxCount, nbThreads);
   }
-
-  // Refine the median estimation by iteratively re-weight least squares
-  unsigned int count = 0;
-  bool shouldIterate = true;
-  while (shouldIterate && (count < maxCount))
+  if (dim == 3)
   {
-    Eigen::VectorXd nextMedian = Eigen::VectorXd::Zero(X[0].size(), 1);
-    double sumInvDist = 0;
-    for (int i = 0; i < X.size(); ++i)
-    {
-      sumInvDist += 1.0 / (X[i] - Median).norm();
-    }
-    for (int i = 0; i < X.size(); ++i)
-    {
-      nextMedian += X[i] / (X[i] - Median).norm();
-    }
-    Median = nextMedian / sumInvDist;
-
-    Eigen::VectorXd residual = Eigen::VectorXd::Zero(X[0].size(), 1);
-    for (int i = 0; i < X.size(); ++i)
-    {
-      residual += (X[i] - Median).normalized();
-    }
-    shouldIterate = residual.norm() > epsilon;
-    count++;
+    return WeiszfeldMedian<3>(samples, epsilon, maxCount, nbThreads);
   }
-  return Median;
+  return WeiszfeldMedian<Eigen::Dynamic>(samples, epsilon, maxCount, nbThreads);
+}
+
+//-----------------------------------------------------------------------------
+Eigen::Vector3d MultivariateMedian(const Eigen::Matrix3Xd& X, double epsilon,
+                                   unsigned int maxCount, unsigned int nbThreads)
+{
+  return WeiszfeldMedian<3>(X, epsilon, maxCount, nbThreads);
 }
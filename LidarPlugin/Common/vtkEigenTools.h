@@ -36,16 +36,25 @@
    *        to the chordal distance of the unitaries quaternions manifold derived from
    *        the canonical dot product of H
    * @param Q The list of unit quaternion we want to compute the mean
+   * @param nbThreads number of threads summing the samples, 0 to use all the cores.
+   *        The result does not depend on it
    */
-Eigen::Quaterniond AvgUnitQuaternions(const std::vector<Eigen::Quaterniond>& Q);
+Eigen::Quaterniond AvgUnitQuaternions(const std::vector<Eigen::Quaterniond>& Q, unsigned int nbThreads = 1);
+
+/**
+   * @brief AvgUnitQuaternions same as above, the unit quaternions being the
+   *        (w, x, y, z) columns of Q
+   */
+Eigen::Quaterniond AvgUnitQuaternions(const Eigen::Matrix4Xd& Q, unsigned int nbThreads = 1);
 
 /**
    * @brief AvgRotation Computes and returns the average rotation of a rotation
    *        list. The average rotation is defined according to the chordal distance
    *        of the SO(3) manifold derived from the Frobenius dot product of M3,3(R)
    * @param rotations The list of rotation we want to compute the mean
+   * @param nbThreads see AvgUnitQuaternions
    */
-Eigen::Matrix3d AvgRotation(const std::vector<Eigen::Matrix3d>& rotations);
+Eigen::Matrix3d AvgRotation(const std::vector<Eigen::Matrix3d>& rotations, unsigned int nbThreads = 1);
 
 /**
    * @brief MatrixToRollPitchYaw Computes the Euler angles from
@@ -136,10 +145,24 @@ Eigen::Matrix3d ComputeHomography(const std::vector<Eigen::Vector2d>& x,
   * @param Y trajectory smoothed
   * @param polDeg Degree of the polynomial model
   * @param kernelRadius radius of the gate kernel function
+  * @param nbThreads number of threads used, 0 to use all the cores
   */
 void EuclideanMLSSmoothing(const std::vector<Eigen::VectorXd>& X,
                            std::vector<Eigen::VectorXd>& Y,
-                           int polDeg, int kernelRadius);
+                           int polDeg, int kernelRadius,
+                           unsigned int nbThreads = 0);
+
+/**
+  * @brief EuclideanMLSSmoothing same as above, only smoothing the elements
+  *        of index in [begin, end[, the other elements of Y being copied
+  *        from X. The smoothed elements only depend on the elements of X
+  *        of index in [begin - kernelRadius, end + kernelRadius[
+  */
+void EuclideanMLSSmoothing(const std::vector<Eigen::VectorXd>& X,
+                           std::vector<Eigen::VectorXd>& Y,
+                           int polDeg, int kernelRadius,
+                           int begin, int end,
+                           unsigned int nbThreads = 0);
 
 /**
    * @brief MultivariateMedian Computes the multivariate median of a set of
@@ -147,7 +170,20 @@ void EuclideanMLSSmoothing(const std::vector<Eigen::VectorXd>& X,
    *        sum of the L2-distance using the Weiszfeld algorithm which is a gradient
    *        descent algorithm with specific step value
    * @param X The list of R^n vectors we want to compute the median
+   * @param epsilon the iterations stop when the norm of the sum of the unit vectors
+   *        from the median to the samples is below epsilon
+   * @param maxCount maximum number of iterations
+   * @param nbThreads number of threads sharing the samples at each iteration, 0 to
+   *        use all the cores. The result does not depend on it
+   */
+Eigen::VectorXd MultivariateMedian(const std::vector<Eigen::VectorXd>& X, double epsilon = 1e-6,
+                                   unsigned int maxCount = 10000, unsigned int nbThreads = 1);
+
+/**
+   * @brief MultivariateMedian same as above for points of R^3 stored as the
+   *        columns of X, without copying them
    */
-Eigen::VectorXd MultivariateMedian(const std::vector<Eigen::VectorXd> X, double epsilon = 1e-6, unsigned int maxCount = 10000);
+Eigen::Vector3d MultivariateMedian(const Eigen::Matrix3Xd& X, double epsilon = 1e-6,
+                                   unsigned int maxCount = 10000, unsigned int nbThreads = 1);
 
 #endif // VTK_EIGEN_TOOLS_H
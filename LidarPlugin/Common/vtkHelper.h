@@ -22,7 +22,9 @@
 
 // STD
 #include <string>
+#include <vector>
 // VTK
+#include <vtkDataArray.h>
 #include <vtkSmartPointer.h>
 
 template <typename T>
@@ -35,4 +37,29 @@ vtkSmartPointer<T> createArray(const std::string& Name, int NumberOfComponents =
   return array;
 }
 
+template <typename T, typename ArrayT>
+void copyComponent(const ArrayT* tuples, vtkIdType NumberOfTuples, int NumberOfComponents, T* values)
+{
+  for (vtkIdType i = 0; i < NumberOfTuples; ++i)
+  {
+    values[i] = static_cast<T>(tuples[i * NumberOfComponents]);
+  }
+}
+
+// Values of a component of the tuples of an array, read through the actual
+// type of the array. Unlike the array itself, they can then be read by
+// several threads without a virtual call per value
+template <typename T>
+std::vector<T> getComponentValues(vtkDataArray* array, int Component = 0)
+{
+  std::vector<T> values(array->GetNumberOfTuples());
+  switch (array->GetDataType())
+  {
+    vtkTemplateMacro(copyComponent(static_cast<const VTK_TT*>(array->GetVoidPointer(0)) + Component,
+                                   array->GetNumberOfTuples(), array->GetNumberOfComponents(),
+                                   values.data()));
+  }
+  return values;
+}
+
 #endif // VTK_HELPER_H
@@ -5,10 +5,11 @@
 #include <vtkCellData.h>
 #include <vtkCell.h>
 #include <vtkPolyLine.h>
-#include <vtkLine.h>
 #include <vtkTransform.h>
 
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 // Eigen
 #include <Eigen/Dense>
@@ -81,15 +82,12 @@ vtkSmartPointer<vtkTemporalTransforms> vtkTemporalTransforms::CreateFromPolyData
 //-----------------------------------------------------------------------------
 vtkSmartPointer<vtkTransform> vtkTemporalTransforms::GetTransform(unsigned int transformNumber)
 {
-  auto axisAngle = this->GetOrientationArray();
+  double xyzw[4];
+  this->GetOrientationArray()->GetTuple(transformNumber, xyzw);
   auto transform = vtkSmartPointer<vtkTransform>::New();
   transform->PostMultiply();
-  double x = axisAngle->GetTuple4(transformNumber)[0];
-  double y = axisAngle->GetTuple4(transformNumber)[1];
-  double z = axisAngle->GetTuple4(transformNumber)[2];
-  double w = axisAngle->GetTuple4(transformNumber)[3]
-      * 180 / vtkMath::Pi(); // vtk need degrees not radians
-  transform->RotateWXYZ(w, x, y, z);
+  // vtk need degrees not radians
+  transform->RotateWXYZ(xyzw[3] * 180 / vtkMath::Pi(), xyzw[0], xyzw[1], xyzw[2]);
   transform->Translate(this->GetTranslationArray()->GetTuple(transformNumber));
 
   return transform;
@@ -101,25 +99,43 @@ vtkSmartPointer<vtkCustomTransformInterpolator> vtkTemporalTransforms::CreateInt
   auto interpolator = vtkSmartPointer<vtkCustomTransformInterpolator>::New();
 
   auto timestamp = this->GetTimeArray();
+  auto axisAngle = this->GetOrientationArray();
+  auto translation = this->GetTranslationArray();
 
-  for (unsigned int i = 0; i < this->GetNumberOfPoints(); i++)
+  // gather the transforms into contiguous arrays, the orientations being
+  // converted from axis angle to quaternion, to load them at once
+  const int n = static_cast<int>(this->GetNumberOfPoints());
+  std::vector<double> times(n), orientations(4 * n), positions(3 * n);
+  for (int i = 0; i < n; i++)
   {
-    // get timestamp
-    double currentTimestamp = timestamp->GetTuple1(i);
-
-    // create the tranform
-    auto transform = this->GetTransform(i);
+    times[i] = timestamp->GetComponent(i, 0);
+    if (vtkMath::IsNan(times[i]))
+    {
+      vtkErrorMacro("Timestamp " << i << "is not a number")
+    }
 
-    // add the tranform to the interpolator
-    if (!vtkMath::IsNan(currentTimestamp))
+    double axis[3] = {axisAngle->GetComponent(i, 0),
+                      axisAngle->GetComponent(i, 1),
+                      axisAngle->GetComponent(i, 2)};
+    const double halfAngle = 0.5 * axisAngle->GetComponent(i, 3);
+    const double norm = vtkMath::Norm(axis);
+    double* q = &orientations[4 * i];
+    if (norm > 0.0)
     {
-      interpolator->AddTransform(currentTimestamp, transform);
+      const double s = std::sin(halfAngle) / norm;
+      q[0] = std::cos(halfAngle);
+      q[1] = s * axis[0];
+      q[2] = s * axis[1];
+      q[3] = s * axis[2];
     }
     else
     {
-      vtkErrorMacro("Timestamp " << i << "is not a number")
+      q[0] = 1.0;
+      q[1] = q[2] = q[3] = 0.0;
     }
+    translation->GetTuple(i, &positions[3 * i]);
   }
+  interpolator->SetTransforms(n, times.data(), orientations.data(), positions.data());
   interpolator->Modified();
   return interpolator;
 }
@@ -261,7 +277,8 @@ vtkSmartPointer<vtkTemporalTransforms> vtkTemporalTransforms::CycloidicTransform
 }
 
 //-----------------------------------------------------------------------------
-vtkSmartPointer<vtkTemporalTransforms> vtkTemporalTransforms::MLSSmoothing(int polDeg, int kernelRadius)
+vtkSmartPointer<vtkTemporalTransforms> vtkTemporalTransforms::MLSSmoothing(int polDeg, int kernelRadius,
+                                                                          unsigned int nbThreads)
 {
   auto outputPoses = vtkSmartPointer<vtkTemporalTransforms>::New();
   outputPoses->DeepCopy(this);
@@ -293,12 +310,12 @@ vtkSmartPointer<vtkTemporalTransforms> vtkTemporalTransforms::MLSSmoothing(int p
   }
 
   // Smooth the trajectory
-  EuclideanMLSSmoothing(X, Y, polDeg, kernelRadius);
+  EuclideanMLSSmoothing(X, Y, polDeg, kernelRadius, nbThreads);
 
   // Smooth the orientations using an euclidean
   // MLS algorithm and then reprojecting the points
   // onto the unit quaternion sphere
-  EuclideanMLSSmoothing(Qin, Qout, polDeg, kernelRadius);
+  EuclideanMLSSmoothing(Qin, Qout, polDeg, kernelRadius, nbThreads);
 
   // Set the points
   for (int k = 0; k < outputPoses->GetNumberOfPoints(); ++k)
@@ -318,6 +335,56 @@ vtkSmartPointer<vtkTemporalTransforms> vtkTemporalTransforms::MLSSmoothing(int p
   return outputPoses;
 }
 
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkTemporalTransforms> vtkTemporalTransforms::MLSSmoothing(int polDeg, int kernelRadius,
+                                                                          vtkIdType begin, vtkIdType end,
+                                                                          unsigned int nbThreads)
+{
+  auto outputPoses = vtkSmartPointer<vtkTemporalTransforms>::New();
+  begin = std::max(begin, static_cast<vtkIdType>(0));
+  end = std::min(end, this->GetNumberOfPoints());
+  if (begin >= end)
+  {
+    return outputPoses;
+  }
+
+  // Only the kernelRadius neighbors of the range take part in its smoothing
+  const vtkIdType first = std::max(begin - kernelRadius, static_cast<vtkIdType>(0));
+  const vtkIdType last = std::min(end + kernelRadius, this->GetNumberOfPoints());
+
+  vtkDataArray* anglesAxisArray = this->GetOrientationArray();
+  std::vector<Eigen::VectorXd> X, Y;
+  std::vector<Eigen::VectorXd> Qin, Qout;
+  X.reserve(last - first);
+  Qin.reserve(last - first);
+  for (vtkIdType k = first; k < last; ++k)
+  {
+    // Positions
+    double currPos[3];
+    this->GetPoint(k, currPos);
+    X.push_back(Eigen::Vector3d(currPos[0], currPos[1], currPos[2]));
+
+    // Orientations
+    double* xyzw = anglesAxisArray->GetTuple4(k);
+    Eigen::Quaterniond quat(Eigen::AngleAxisd(xyzw[3], Eigen::Vector3d(xyzw[0], xyzw[1], xyzw[2])));
+    Qin.push_back(Eigen::Vector4d(quat.w(), quat.x(), quat.y(), quat.z()));
+  }
+
+  EuclideanMLSSmoothing(X, Y, polDeg, kernelRadius, begin - first, end - first, nbThreads);
+  EuclideanMLSSmoothing(Qin, Qout, polDeg, kernelRadius, begin - first, end - first, nbThreads);
+
+  const vtkIdType n = end - begin;
+  std::vector<double> times(n), quaternions(4 * n), translations(3 * n);
+  for (vtkIdType k = 0; k < n; ++k)
+  {
+    times[k] = this->GetTimeArray()->GetTuple1(begin + k);
+    Eigen::Map<Eigen::Vector4d>(&quaternions[4 * k]) = Qout[begin - first + k].normalized();
+    Eigen::Map<Eigen::Vector3d>(&translations[3 * k]) = Y[begin - first + k].head<3>();
+  }
+  outputPoses->SetPoses(n, times.data(), quaternions.data(), translations.data());
+  return outputPoses;
+}
+
 //-----------------------------------------------------------------------------
 void vtkTemporalTransforms::PushBack(double time, const Eigen::AngleAxisd& orientation , const Eigen::Vector3d translation)
 {
@@ -338,11 +405,105 @@ void vtkTemporalTransforms::PushBack(double time, const Eigen::AngleAxisd& orien
 
   // if control reaches this line, we have at least two points,
   // we append one small line between the new point and the previous one
-  vtkSmartPointer<vtkCellArray> lines = this->GetLines();
-  vtkSmartPointer<vtkLine> line = vtkSmartPointer<vtkLine>::New();
-  line->GetPointIds()->SetId(0, this->GetNumberOfPoints() - 2);
-  line->GetPointIds()->SetId(1, this->GetNumberOfPoints() - 1);
-  lines->InsertNextCell(line);
+  const vtkIdType line[2] = { this->GetNumberOfPoints() - 2, this->GetNumberOfPoints() - 1 };
+  this->GetLines()->InsertNextCell(2, line);
+}
+
+//-----------------------------------------------------------------------------
+void vtkTemporalTransforms::Reserve(vtkIdType n)
+{
+  // Resize keeps the transforms already stored
+  for (vtkDataArray* array : { this->GetTimeArray(), this->GetOrientationArray(),
+                               this->GetTranslationArray() })
+  {
+    if (array->GetSize() < n * array->GetNumberOfComponents())
+    {
+      array->Resize(n);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkTemporalTransforms::SetPoses(vtkIdType n, const double* times, const double* quaternions,
+                                     const double* translations)
+{
+  vtkDoubleArray* timeArray = vtkDoubleArray::SafeDownCast(this->GetTimeArray());
+  vtkDoubleArray* orientationArray = vtkDoubleArray::SafeDownCast(this->GetOrientationArray());
+  vtkDoubleArray* translationArray = vtkDoubleArray::SafeDownCast(this->GetTranslationArray());
+  if (!timeArray || !orientationArray || !translationArray)
+  {
+    vtkErrorMacro(<< "SetPoses expects double arrays")
+    return;
+  }
+
+  timeArray->SetNumberOfTuples(n);
+  std::copy(times, times + n, timeArray->GetPointer(0));
+  translationArray->SetNumberOfTuples(n);
+  std::copy(translations, translations + 3 * n, translationArray->GetPointer(0));
+
+  // the orientations are stored as axis angle
+  orientationArray->SetNumberOfTuples(n);
+  double* xyzw = orientationArray->GetPointer(0);
+  for (vtkIdType i = 0; i < n; ++i)
+  {
+    const double* q = quaternions + 4 * i;
+    const double sinHalfAngle = std::sqrt(q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    if (sinHalfAngle > 0.0)
+    {
+      xyzw[4 * i + 0] = q[1] / sinHalfAngle;
+      xyzw[4 * i + 1] = q[2] / sinHalfAngle;
+      xyzw[4 * i + 2] = q[3] / sinHalfAngle;
+      xyzw[4 * i + 3] = 2.0 * std::atan2(sinHalfAngle, q[0]);
+    }
+    else
+    {
+      // same as Eigen::AngleAxisd for the identity
+      xyzw[4 * i + 0] = 1.0;
+      xyzw[4 * i + 1] = xyzw[4 * i + 2] = xyzw[4 * i + 3] = 0.0;
+    }
+  }
+  this->GetPoints()->Modified();
+
+  // a single polyline going through all the transforms
+  auto cells = vtkSmartPointer<vtkCellArray>::New();
+  vtkIdType* ids = cells->WritePointer(1, n + 1);
+  ids[0] = n;
+  for (vtkIdType i = 0; i < n; ++i)
+  {
+    ids[i + 1] = i;
+  }
+  this->SetLines(cells);
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+double vtkTemporalTransforms::GetTime(vtkIdType i)
+{
+  return this->GetTimeArray()->GetComponent(i, 0);
+}
+
+//-----------------------------------------------------------------------------
+Eigen::AngleAxisd vtkTemporalTransforms::GetOrientation(vtkIdType i)
+{
+  double xyzw[4];
+  this->GetOrientationArray()->GetTuple(i, xyzw);
+  return Eigen::AngleAxisd(xyzw[3], Eigen::Vector3d(xyzw[0], xyzw[1], xyzw[2]));
+}
+
+//-----------------------------------------------------------------------------
+Eigen::Vector3d vtkTemporalTransforms::GetTranslation(vtkIdType i)
+{
+  Eigen::Vector3d translation;
+  this->GetTranslationArray()->GetTuple(i, translation.data());
+  return translation;
+}
+
+//-----------------------------------------------------------------------------
+Eigen::Isometry3d vtkTemporalTransforms::GetPose(vtkIdType i)
+{
+  Eigen::Isometry3d pose(this->GetOrientation(i));
+  pose.translation() = this->GetTranslation(i);
+  return pose;
 }
 
 vtkSmartPointer<vtkTemporalTransforms> vtkTemporalTransforms::ExtractTimes(double tstart, double tend)
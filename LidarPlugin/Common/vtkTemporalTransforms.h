@@ -70,8 +70,20 @@ public:
   *
   * \@param polDeg degree of the polynomial model
   * \@param maskRadius radius of the kernel function
+  * \@param nbThreads number of threads, 0 to use all the cores
   */
-  vtkSmartPointer<vtkTemporalTransforms> MLSSmoothing(int polDeg, int kernelRadius);
+  vtkSmartPointer<vtkTemporalTransforms> MLSSmoothing(int polDeg, int kernelRadius,
+                                                      unsigned int nbThreads = 0);
+
+  /**
+  * \brief Same as above, but only return the smoothed transforms
+  *        [begin, end[, which are the same as the ones smoothed over
+  *        the whole trajectory. Only the transforms closer than
+  *        kernelRadius to this range are read.
+  */
+  vtkSmartPointer<vtkTemporalTransforms> MLSSmoothing(int polDeg, int kernelRadius,
+                                                      vtkIdType begin, vtkIdType end,
+                                                      unsigned int nbThreads = 0);
 
   //@{
   /// Get/Set the orientation array
@@ -96,6 +108,28 @@ public:
   /// Add a temporal transform to the end
   void PushBack(double time, const Eigen::AngleAxisd& orientation , const Eigen::Vector3d translation);
 
+  /// Allocate the arrays for n transforms, so that pushing them back does not reallocate
+  void Reserve(vtkIdType n);
+
+  /**
+  * \brief Replace the transforms by n ones given as contiguous arrays, the
+  *        polyline being built once all are copied.
+  *
+  * \@param times n timestamps (second)
+  * \@param quaternions n orientations as unit quaternions (w, x, y, z)
+  * \@param translations n positions (x, y, z)
+  */
+  void SetPoses(vtkIdType n, const double* times, const double* quaternions,
+                const double* translations);
+
+  //@{
+  /// Transform i, without creating any vtk object
+  double GetTime(vtkIdType i);
+  Eigen::AngleAxisd GetOrientation(vtkIdType i);
+  Eigen::Vector3d GetTranslation(vtkIdType i);
+  Eigen::Isometry3d GetPose(vtkIdType i);
+  //@}
+
   vtkSmartPointer<vtkTemporalTransforms> ExtractTimes(double tstart, double tend);
   vtkSmartPointer<vtkTemporalTransforms> Subsample(int N);
   vtkSmartPointer<vtkTemporalTransforms> ApplyTimeshift(double shift);
@@ -16,10 +16,16 @@
 
 // LOCAL
 #include "vtkBirdEyeViewSnap.h"
+#include "vtkLidarReader.h"
+#include "vtkHelper.h"
 
 // STD
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <sstream>
 #include <cmath>
 
@@ -28,10 +34,13 @@
 #include <vtkCellData.h>
 #include <vtkDataArray.h>
 #include <vtkDoubleArray.h>
+#include <vtkErrorCode.h>
 #include <vtkFloatArray.h>
 #include <vtkImageData.h>
 #include <vtkInformation.h>
+#include <vtkImageWriter.h>
 #include <vtkInformationVector.h>
+#include <vtkJPEGWriter.h>
 #include <vtkMath.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
@@ -41,6 +50,7 @@
 #include <vtkPolyLine.h>
 #include <vtkSmartPointer.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkTIFFWriter.h>
 #include <vtkTransform.h>
 #include <vtkTupleInterpolator.h>
 #include <vtkUnsignedCharArray.h>
@@ -50,6 +60,7 @@
 
 // BOOST
 #include <boost/algorithm/string.hpp>
+#include <boost/thread.hpp>
 
 // Eigen
 #include <Eigen/Dense>
@@ -102,27 +113,69 @@ int vtkBirdEyeViewSnap::RequestData(vtkInformation *vtkNotUsed(request),
     return 0;
   }
 
+  // Create the bird eye view image from the rotated points,
+  // which are also the points of the output
+  auto rotatedPoints = vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkImageData> image = this->CreateImage(input, rotatedPoints);
+  if (!image)
+  {
+    vtkGenericWarningMacro("The input has no point, no view has been created");
+    return 1;
+  }
+  output->SetPoints(rotatedPoints);
+
+  // Save the image
+  if (!this->WriteImage(image, this->Count))
+  {
+    vtkGenericWarningMacro("The view " << this->Count << " could not be written");
+  }
+
+  this->Count++;
+
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> vtkBirdEyeViewSnap::CreateImage(vtkPolyData* frame,
+                                                              vtkPoints* rotatedPoints) const
+{
+  const vtkIdType nbPoints = frame->GetNumberOfPoints();
+  if (nbPoints == 0)
+  {
+    return nullptr;
+  }
+
   // transform the input
-  Eigen::Matrix<double, 3, 1> point;
+  std::vector<Eigen::Vector3d> points(nbPoints);
+  double bounds[6] = {VTK_DOUBLE_MAX, VTK_DOUBLE_MIN,
+                      VTK_DOUBLE_MAX, VTK_DOUBLE_MIN,
+                      VTK_DOUBLE_MAX, VTK_DOUBLE_MIN};
   double vtkpoint[3];
-  for (unsigned int k = 0; k < input->GetNumberOfPoints(); ++k)
+  for (vtkIdType k = 0; k < nbPoints; ++k)
+  {
+    frame->GetPoint(k, vtkpoint);
+    points[k] = this->Orientation * Eigen::Vector3d(vtkpoint[0], vtkpoint[1], vtkpoint[2]);
+    for (int i = 0; i < 3; ++i)
+    {
+      bounds[2 * i] = std::min(bounds[2 * i], points[k](i));
+      bounds[2 * i + 1] = std::max(bounds[2 * i + 1], points[k](i));
+    }
+  }
+  if (rotatedPoints)
   {
-    input->GetPoint(k, vtkpoint);
-    point << vtkpoint[0], vtkpoint[1], vtkpoint[2];
-    point = this->Orientation * point;
-    vtkpoint[0] = point(0);
-    vtkpoint[1] = point(1);
-    vtkpoint[2] = point(2);
-    output->GetPoints()->SetPoint(k, vtkpoint);
+    rotatedPoints->SetDataType(frame->GetPoints()->GetDataType());
+    rotatedPoints->SetNumberOfPoints(nbPoints);
+    for (vtkIdType k = 0; k < nbPoints; ++k)
+    {
+      rotatedPoints->SetPoint(k, points[k].data());
+    }
   }
 
   // Create the bird eye view image
-  double bounds[6];
-  output->GetBounds(bounds);
-  unsigned int x, y;
-
-  unsigned int H = std::ceil((bounds[1] - bounds[0]) / this->pixelResX);
-  unsigned int W = std::ceil((bounds[3] - bounds[2]) / this->pixelResY);
+  unsigned int H = std::max(1.0, std::ceil((bounds[1] - bounds[0]) / this->pixelResX));
+  unsigned int W = std::max(1.0, std::ceil((bounds[3] - bounds[2]) / this->pixelResY));
+  const double scaleX = bounds[1] > bounds[0] ? (H - 1) / (bounds[1] - bounds[0]) : 0.0;
+  const double scaleY = bounds[3] > bounds[2] ? (W - 1) / (bounds[3] - bounds[2]) : 0.0;
 
   // Image
   vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
@@ -131,32 +184,147 @@ int vtkBirdEyeViewSnap::RequestData(vtkInformation *vtkNotUsed(request),
   unsigned char* dataPointer = static_cast<unsigned char*>(image->GetScalarPointer());
   std::fill(dataPointer, dataPointer + H * W, 0);
 
-  // Get the reflectivity array
-  vtkDataArray* intensity = output->GetPointData()->GetArray("intensity");
+  // Get the reflectivity array, the points are
+  // only marked in the image without it
+  vtkDataArray* intensity = frame->GetPointData()->GetArray("intensity");
+  const std::vector<unsigned char> intensities =
+    intensity ? getComponentValues<unsigned char>(intensity) : std::vector<unsigned char>();
 
-  for (unsigned int k = 0; k < output->GetNumberOfPoints(); ++k)
+  for (vtkIdType k = 0; k < nbPoints; ++k)
   {
     // Compute pixel coordinate
-    output->GetPoint(k, vtkpoint);
-    x = std::floor((vtkpoint[0] - bounds[0]) / (bounds[1] - bounds[0]) * (H - 1));
-    y = std::floor((vtkpoint[1] - bounds[2]) / (bounds[3] - bounds[2]) * (W - 1));
+    unsigned int x = std::floor((points[k](0) - bounds[0]) * scaleX);
+    unsigned int y = std::floor((points[k](1) - bounds[2]) * scaleY);
 
     // set value
-    unsigned char value = intensity->GetVariantValue(k).ToUnsignedChar();
-    image->SetScalarComponentFromDouble(x, y, 0, 0, value);
+    unsigned char value = intensity ? intensities[k] : 255;
+    dataPointer[y * H + x] = value;
   }
 
-  // Save the image
+  return image;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkBirdEyeViewSnap::WriteImage(vtkImageData* image, unsigned int count) const
+{
   std::stringstream ss;
-  ss << this->RadicalFileName << this->Count << "." << ExtensionFileName;
-  vtkSmartPointer<vtkPNGWriter> writer = vtkSmartPointer<vtkPNGWriter>::New();
+  ss << this->RadicalFileName << count << "." << this->ExtensionFileName;
+
+  vtkSmartPointer<vtkImageWriter> writer;
+  if (this->ExtensionFileName == "jpg")
+  {
+    writer = vtkSmartPointer<vtkJPEGWriter>::New();
+  }
+  else if (this->ExtensionFileName == "tif" || this->ExtensionFileName == "tiff")
+  {
+    writer = vtkSmartPointer<vtkTIFFWriter>::New();
+  }
+  else
+  {
+    writer = vtkSmartPointer<vtkPNGWriter>::New();
+  }
   writer->SetFileName(ss.str().c_str());
   writer->SetInputData(image);
   writer->Write();
+  return writer->GetErrorCode() == vtkErrorCode::NoError;
+}
 
-  this->Count++;
+//-----------------------------------------------------------------------------
+bool vtkBirdEyeViewSnap::ExportFrames(vtkLidarReader* reader, int firstFrame, int lastFrame,
+                                      int numberOfDecodeThreads, int numberOfWriteThreads)
+{
+  if (!reader)
+  {
+    vtkErrorMacro("No reader to export the frames from");
+    return false;
+  }
+  if (this->RadicalFileName == "NoRadical" ||
+      this->ExtensionFileName == "NoExtension")
+  {
+    vtkErrorMacro("Filename has not been settled or is invalid");
+    return false;
+  }
+  if (numberOfWriteThreads <= 0)
+  {
+    numberOfWriteThreads = static_cast<int>(std::max(1u, boost::thread::hardware_concurrency()));
+  }
 
-  return 1;
+  // The decoded frames waiting to be written, with the count naming their
+  // view. The decoding waits while the queue is full to bound the memory.
+  std::deque<std::pair<unsigned int, vtkSmartPointer<vtkPolyData> > > queue;
+  boost::mutex mutex;
+  boost::condition_variable frameQueued, frameDequeued;
+  bool decodingDone = false;
+  std::atomic<bool> writeFailed(false);
+
+  auto writeFrames = [&]()
+  {
+    while (true)
+    {
+      std::pair<unsigned int, vtkSmartPointer<vtkPolyData> > frame;
+      {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (queue.empty() && !decodingDone)
+        {
+          frameQueued.wait(lock);
+        }
+        if (queue.empty())
+        {
+          return;
+        }
+        frame = queue.front();
+        queue.pop_front();
+      }
+      frameDequeued.notify_one();
+
+      vtkSmartPointer<vtkImageData> image = this->CreateImage(frame.second, nullptr);
+      if (!this->WriteImage(image, frame.first))
+      {
+        writeFailed = true;
+      }
+    }
+  };
+  std::vector<std::unique_ptr<boost::thread> > threads;
+  for (int i = 0; i < numberOfWriteThreads; ++i)
+  {
+    threads.emplace_back(new boost::thread(writeFrames));
+  }
+
+  const unsigned int firstCount = this->Count;
+  bool decoded = reader->DecodeFrames(firstFrame, lastFrame, [&](int frameNumber, vtkPolyData* frame)
+  {
+    if (frame->GetNumberOfPoints() == 0)
+    {
+      return true;
+    }
+    {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      while (queue.size() >= MaxQueuedFrames)
+      {
+        frameDequeued.wait(lock);
+      }
+      queue.emplace_back(firstCount + (frameNumber - firstFrame), frame);
+    }
+    frameQueued.notify_one();
+    return !writeFailed;
+  }, numberOfDecodeThreads);
+
+  {
+    boost::unique_lock<boost::mutex> lock(mutex);
+    decodingDone = true;
+  }
+  frameQueued.notify_all();
+  for (auto& thread : threads)
+  {
+    thread->join();
+  }
+
+  this->Count = firstCount + (lastFrame - firstFrame + 1);
+  if (writeFailed)
+  {
+    vtkErrorMacro("Some views could not be written");
+  }
+  return decoded && !writeFailed;
 }
 
 //-----------------------------------------------------------------------------
@@ -202,10 +370,11 @@ void vtkBirdEyeViewSnap::SetFolderName(std::string filename)
 
   // Check that the extension is supported
   std::string extension = strs[strs.size() - 1];
-  if ((extension != "png") && (extension != "jpg"))
+  if ((extension != "png") && (extension != "jpg") &&
+      (extension != "tif") && (extension != "tiff"))
   {
     vtkGenericWarningMacro("file format not supported: " << extension
-                           << " supported file format are: jpg, png");
+                           << " supported file format are: jpg, png, tif, tiff");
     return;
   }
 
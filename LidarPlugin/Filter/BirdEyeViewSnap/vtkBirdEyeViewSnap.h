@@ -25,6 +25,9 @@
 // EIGEN
 #include <Eigen/Dense>
 
+class vtkImageData;
+class vtkLidarReader;
+
 class VTK_EXPORT vtkBirdEyeViewSnap : public vtkPolyDataAlgorithm
 {
 public:
@@ -45,6 +48,17 @@ public:
   // set the count value used to name files
   void SetCount(unsigned int count);
 
+  // Write the bird eye views of the frames firstFrame to lastFrame
+  // of a reader without going through the pipeline. The frames are
+  // decoded in parallel by the reader, then rasterized and written by
+  // a pool of threads, at most MaxQueuedFrames frames waiting for it.
+  // The view of a frame is named with Count plus its offset from
+  // firstFrame, and Count is moved after the last frame. Empty frames
+  // are skipped. Return false if a frame could not be decoded or
+  // written. 0 threads uses all the cores.
+  bool ExportFrames(vtkLidarReader* reader, int firstFrame, int lastFrame,
+                    int numberOfDecodeThreads = 0, int numberOfWriteThreads = 0);
+
 protected:
   // constructor / destructor
   vtkBirdEyeViewSnap();
@@ -58,6 +72,19 @@ private:
   vtkBirdEyeViewSnap(const vtkBirdEyeViewSnap&);
   void operator=(const vtkBirdEyeViewSnap&);
 
+  // Rotate the points of a frame and project them into the bird eye
+  // view, the rotated points being stored in rotatedPoints if it is
+  // not null. This can be called from several threads.
+  vtkSmartPointer<vtkImageData> CreateImage(vtkPolyData* frame, vtkPoints* rotatedPoints) const;
+
+  // Write the view of a count with the writer of the file extension.
+  // This can be called from several threads.
+  bool WriteImage(vtkImageData* image, unsigned int count) const;
+
+  // maximum number of decoded frames waiting to
+  // be written by ExportFrames
+  static const unsigned int MaxQueuedFrames = 32;
+
   // folder to save the bird eye
   // views generated
   std::string RadicalFileName;
@@ -0,0 +1,222 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "PointBoxLabelling.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+// Number of points labelled by a thread at a time
+const size_t PointChunkSize = 4096;
+// Depth of the hierarchy is at most log2 of the number of boxes, far below this
+const int MaxDepth = 64;
+}
+
+//-----------------------------------------------------------------------------
+void PointBoxLabelling::SetBoxes(const std::vector<Box>& boxes)
+{
+  this->Nodes.clear();
+  this->BoxIds.clear();
+  if (boxes.empty())
+  {
+    return;
+  }
+
+  // axis aligned bounds of each box, min then max
+  std::vector<double> bounds(6 * boxes.size());
+  for (size_t i = 0; i < boxes.size(); ++i)
+  {
+    for (int k = 0; k < 3; ++k)
+    {
+      double extent = 0.0;
+      for (int j = 0; j < 3; ++j)
+      {
+        extent += std::abs(boxes[i].Axes[j][k]) * boxes[i].Width[j] / 2.0;
+      }
+      bounds[6 * i + k] = boxes[i].Center[k] - extent;
+      bounds[6 * i + 3 + k] = boxes[i].Center[k] + extent;
+    }
+  }
+
+  std::vector<unsigned int> order(boxes.size());
+  for (size_t i = 0; i < order.size(); ++i)
+  {
+    order[i] = static_cast<unsigned int>(i);
+  }
+  this->Nodes.reserve(2 * boxes.size() / LeafSize + 1);
+  this->Build(order, boxes, bounds, 0, static_cast<unsigned int>(boxes.size()));
+
+  // store the boxes in the order of the leaves
+  for (int k = 0; k < 3; ++k)
+  {
+    this->Centers[k].resize(boxes.size());
+    this->HalfWidths[k].resize(boxes.size());
+    for (int j = 0; j < 3; ++j)
+    {
+      this->Axes[j][k].resize(boxes.size());
+    }
+  }
+  this->BoxIds.resize(boxes.size());
+  for (size_t i = 0; i < order.size(); ++i)
+  {
+    const Box& box = boxes[order[i]];
+    this->BoxIds[i] = static_cast<int>(order[i]);
+    for (int k = 0; k < 3; ++k)
+    {
+      this->Centers[k][i] = box.Center[k];
+      this->HalfWidths[k][i] = box.Width[k] / 2.0;
+      for (int j = 0; j < 3; ++j)
+      {
+        this->Axes[j][k][i] = box.Axes[j][k];
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+unsigned int PointBoxLabelling::Build(std::vector<unsigned int>& order, const std::vector<Box>& boxes,
+                                      const std::vector<double>& bounds, unsigned int begin, unsigned int end)
+{
+  const unsigned int index = static_cast<unsigned int>(this->Nodes.size());
+  this->Nodes.emplace_back();
+  Node node;
+  double centerMin[3], centerMax[3];
+  for (int k = 0; k < 3; ++k)
+  {
+    node.Min[k] = centerMin[k] = std::numeric_limits<double>::infinity();
+    node.Max[k] = centerMax[k] = -std::numeric_limits<double>::infinity();
+  }
+  for (unsigned int i = begin; i < end; ++i)
+  {
+    for (int k = 0; k < 3; ++k)
+    {
+      node.Min[k] = std::min(node.Min[k], bounds[6 * order[i] + k]);
+      node.Max[k] = std::max(node.Max[k], bounds[6 * order[i] + 3 + k]);
+      centerMin[k] = std::min(centerMin[k], boxes[order[i]].Center[k]);
+      centerMax[k] = std::max(centerMax[k], boxes[order[i]].Center[k]);
+    }
+  }
+
+  node.IsLeaf = end - begin <= LeafSize;
+  if (node.IsLeaf)
+  {
+    node.Begin = begin;
+    node.End = end;
+  }
+  else
+  {
+    // split at the median of the centers along their largest extent
+    int axis = 0;
+    for (int k = 1; k < 3; ++k)
+    {
+      if (centerMax[k] - centerMin[k] > centerMax[axis] - centerMin[axis])
+      {
+        axis = k;
+      }
+    }
+    const unsigned int middle = begin + (end - begin) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+                     [&](unsigned int a, unsigned int b)
+                     { return boxes[a].Center[axis] < boxes[b].Center[axis]; });
+    node.Begin = this->Build(order, boxes, bounds, begin, middle);
+    node.End = this->Build(order, boxes, bounds, middle, end);
+  }
+  this->Nodes[index] = node;
+  return index;
+}
+
+//-----------------------------------------------------------------------------
+int PointBoxLabelling::Find(const double point[3]) const
+{
+  int best = std::numeric_limits<int>::max();
+  unsigned int stack[MaxDepth];
+  int stackSize = 0;
+  stack[stackSize++] = 0;
+  while (stackSize > 0)
+  {
+    const Node& node = this->Nodes[stack[--stackSize]];
+    if (!(point[0] >= node.Min[0] && point[0] <= node.Max[0] &&
+          point[1] >= node.Min[1] && point[1] <= node.Max[1] &&
+          point[2] >= node.Min[2] && point[2] <= node.Max[2]))
+    {
+      continue;
+    }
+    if (!node.IsLeaf)
+    {
+      stack[stackSize++] = node.Begin;
+      stack[stackSize++] = node.End;
+      continue;
+    }
+
+    // coordinates of the point in the frame of each box of the leaf, without branches
+    for (unsigned int i = node.Begin; i < node.End; ++i)
+    {
+      const double d[3] = { point[0] - this->Centers[0][i], point[1] - this->Centers[1][i],
+                            point[2] - this->Centers[2][i] };
+      bool isInside = true;
+      for (int j = 0; j < 3; ++j)
+      {
+        const double local = d[0] * this->Axes[j][0][i] + d[1] * this->Axes[j][1][i] +
+                             d[2] * this->Axes[j][2][i];
+        isInside &= std::abs(local) <= this->HalfWidths[j][i];
+      }
+      best = isInside && this->BoxIds[i] < best ? this->BoxIds[i] : best;
+    }
+  }
+  return best == std::numeric_limits<int>::max() ? -1 : best;
+}
+
+//-----------------------------------------------------------------------------
+template <typename T>
+void PointBoxLabelling::LabelPoints(const T* points, size_t nbPoints, std::vector<int>& labels,
+                                    unsigned int nbThreads) const
+{
+  labels.assign(nbPoints, -1);
+  if (this->Nodes.empty() || nbPoints == 0)
+  {
+    return;
+  }
+  Parallel::ForEachChunk(nbPoints, PointChunkSize, nbThreads,
+    [&](unsigned int, size_t begin, size_t end)
+  {
+    for (size_t i = begin; i < end; ++i)
+    {
+      const double point[3] = { static_cast<double>(points[3 * i]),
+                                static_cast<double>(points[3 * i + 1]),
+                                static_cast<double>(points[3 * i + 2]) };
+      labels[i] = this->Find(point);
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+void PointBoxLabelling::Label(const float* points, size_t nbPoints, std::vector<int>& labels,
+                              unsigned int nbThreads) const
+{
+  this->LabelPoints(points, nbPoints, labels, nbThreads);
+}
+
+//-----------------------------------------------------------------------------
+void PointBoxLabelling::Label(const double* points, size_t nbPoints, std::vector<int>& labels,
+                              unsigned int nbThreads) const
+{
+  this->LabelPoints(points, nbPoints, labels, nbThreads);
+}
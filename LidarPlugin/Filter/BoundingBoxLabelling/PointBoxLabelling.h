@@ -0,0 +1,101 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef POINT_BOX_LABELLING_H
+#define POINT_BOX_LABELLING_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * \class PointBoxLabelling
+ * \brief Find the oriented box each point of a point cloud falls in.
+ *
+ * A bounding volume hierarchy is built over the axis aligned bounds of the boxes,
+ * splitting them at the median of their centers along the largest axis, so that a
+ * point is only tested against the few boxes whose bounds contain it. The boxes of a
+ * leaf are stored as structures of arrays and tested together without branches,
+ * which lets the compiler vectorize the oriented box test. The points are labelled
+ * in parallel.
+ *
+ * When boxes overlap, a point is given the lowest index of the boxes containing it,
+ * as a test of every point against every box in order would.
+ */
+class PointBoxLabelling
+{
+public:
+  //! Oriented box
+  struct Box
+  {
+    double Center[3];
+    //! Unit axes of the box, Axes[k] being the direction of Width[k]
+    double Axes[3][3];
+    //! Size along each axis
+    double Width[3];
+  };
+
+  //! Maximum number of boxes in a leaf of the hierarchy
+  static const size_t LeafSize = 4;
+
+  //! Set the boxes and build their hierarchy
+  void SetBoxes(const std::vector<Box>& boxes);
+
+  //! Number of boxes
+  size_t GetNumberOfBoxes() const { return this->BoxIds.size(); }
+
+  //@{
+  /**
+   * @brief Label the points with the index of the box they fall in, -1 if none
+   * @param points x, y, z of each point
+   * @param nbThreads number of threads, 0 to use all the cores
+   */
+  void Label(const float* points, size_t nbPoints, std::vector<int>& labels, unsigned int nbThreads = 0) const;
+  void Label(const double* points, size_t nbPoints, std::vector<int>& labels, unsigned int nbThreads = 0) const;
+  //@}
+
+private:
+  struct Node
+  {
+    double Min[3];
+    double Max[3];
+    //! Leaf: boxes [Begin, End[ of the ordered boxes. Inner node: children Begin and End
+    unsigned int Begin;
+    unsigned int End;
+    bool IsLeaf;
+  };
+
+  //! Build the nodes of the ordered boxes [begin, end[, returning the index of the root
+  unsigned int Build(std::vector<unsigned int>& order, const std::vector<Box>& boxes,
+                     const std::vector<double>& bounds, unsigned int begin, unsigned int end);
+
+  template <typename T>
+  void LabelPoints(const T* points, size_t nbPoints, std::vector<int>& labels, unsigned int nbThreads) const;
+
+  //! Index of the first box containing the point, -1 if none
+  int Find(const double point[3]) const;
+
+  std::vector<Node> Nodes;
+  //! Original index of the ordered boxes
+  std::vector<int> BoxIds;
+  //! The ordered boxes as structures of arrays: the k-th coordinate of the center,
+  //! the k-th coordinate of the axis j, and half the width along j
+  std::vector<double> Centers[3];
+  std::vector<double> Axes[3][3];
+  std::vector<double> HalfWidths[3];
+};
+
+#endif // POINT_BOX_LABELLING_H
@@ -0,0 +1,170 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// LOCAL
+#include "vtkBoundingBoxLabelling.h"
+
+// STD
+#include <cmath>
+#include <vector>
+
+// VTK
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkIntArray.h>
+#include <vtkMultiBlockDataSet.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// Implementation of the New function
+vtkStandardNewMacro(vtkBoundingBoxLabelling)
+
+namespace {
+//-----------------------------------------------------------------------------
+// Box from the corners of a 3D box of vtkBoundingBoxReader: the top face from the
+// corner (-, -, +) then the bottom face from the corner (-, -, -)
+bool BoxFromCorners(vtkPoints* corners, PointBoxLabelling::Box& box)
+{
+  if (corners->GetNumberOfPoints() != 8)
+  {
+    return false;
+  }
+  double p[8][3];
+  for (vtkIdType i = 0; i < 8; ++i)
+  {
+    corners->GetPoint(i, p[i]);
+  }
+  // the edges along each axis of the box
+  const int edges[3][2] = { { 0, 1 }, { 0, 3 }, { 4, 0 } };
+  for (int j = 0; j < 3; ++j)
+  {
+    double norm = 0.0;
+    for (int k = 0; k < 3; ++k)
+    {
+      box.Axes[j][k] = p[edges[j][1]][k] - p[edges[j][0]][k];
+      norm += box.Axes[j][k] * box.Axes[j][k];
+    }
+    box.Width[j] = std::sqrt(norm);
+    if (!(box.Width[j] > 0.0))
+    {
+      return false;
+    }
+    for (int k = 0; k < 3; ++k)
+    {
+      box.Axes[j][k] /= box.Width[j];
+    }
+  }
+  for (int k = 0; k < 3; ++k)
+  {
+    box.Center[k] = (p[0][k] + p[6][k]) / 2.0;
+  }
+  return true;
+}
+}
+
+//-----------------------------------------------------------------------------
+vtkBoundingBoxLabelling::vtkBoundingBoxLabelling()
+{
+  this->SetNumberOfInputPorts(2);
+}
+
+//-----------------------------------------------------------------------------
+void vtkBoundingBoxLabelling::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+int vtkBoundingBoxLabelling::FillInputPortInformation(int port, vtkInformation* info)
+{
+  if (port == 0)
+  {
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+    return 1;
+  }
+  if (port == 1)
+  {
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkMultiBlockDataSet");
+    return 1;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int vtkBoundingBoxLabelling::RequestData(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector,
+  vtkInformationVector* outputVector)
+{
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
+  vtkMultiBlockDataSet* boxesData = vtkMultiBlockDataSet::GetData(inputVector[1]->GetInformationObject(0));
+  vtkPolyData* output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
+  output->ShallowCopy(input);
+
+  // the 3D boxes of the frame, and the block of each of them
+  std::vector<PointBoxLabelling::Box> boxes;
+  std::vector<int> blocks;
+  for (unsigned int i = 0; boxesData && i < boxesData->GetNumberOfBlocks(); ++i)
+  {
+    vtkPolyData* boxData = vtkPolyData::SafeDownCast(boxesData->GetBlock(i));
+    PointBoxLabelling::Box box;
+    if (boxData && boxData->GetPoints() && BoxFromCorners(boxData->GetPoints(), box))
+    {
+      boxes.push_back(box);
+      blocks.push_back(static_cast<int>(i));
+    }
+  }
+  this->Labelling.SetBoxes(boxes);
+
+  // label the points, reading the coordinates in place when possible
+  const vtkIdType nbPoints = input->GetNumberOfPoints();
+  std::vector<int> labels;
+  if (nbPoints > 0)
+  {
+    vtkDataArray* coordinates = input->GetPoints()->GetData();
+    switch (coordinates->GetDataType())
+    {
+      case VTK_FLOAT:
+        this->Labelling.Label(static_cast<const float*>(coordinates->GetVoidPointer(0)),
+                              nbPoints, labels, this->NumberOfThreads);
+        break;
+      case VTK_DOUBLE:
+        this->Labelling.Label(static_cast<const double*>(coordinates->GetVoidPointer(0)),
+                              nbPoints, labels, this->NumberOfThreads);
+        break;
+      default:
+      {
+        std::vector<double> converted(3 * nbPoints);
+        for (vtkIdType i = 0; i < nbPoints; ++i)
+        {
+          input->GetPoint(i, &converted[3 * i]);
+        }
+        this->Labelling.Label(converted.data(), nbPoints, labels, this->NumberOfThreads);
+      }
+    }
+  }
+
+  vtkNew<vtkIntArray> boxIds;
+  boxIds->SetName("box_id");
+  boxIds->SetNumberOfTuples(nbPoints);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    boxIds->SetValue(i, labels[i] < 0 ? -1 : blocks[labels[i]]);
+  }
+  output->GetPointData()->AddArray(boxIds.GetPointer());
+  return 1;
+}
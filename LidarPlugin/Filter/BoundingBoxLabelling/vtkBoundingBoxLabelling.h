@@ -0,0 +1,62 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VTK_BOUNDING_BOX_LABELLING_H
+#define VTK_BOUNDING_BOX_LABELLING_H
+
+// VTK
+#include <vtkPolyDataAlgorithm.h>
+
+// LOCAL
+#include "PointBoxLabelling.h"
+
+/**
+ * @brief vtkBoundingBoxLabelling labels each point of a frame with the 3D bounding box
+ * it falls in, to check the annotations against the point cloud.
+ *
+ * It takes 2 inputs: the point cloud, and the boxes of the same frame as created by
+ * vtkBoundingBoxReader, a polydata per box holding its 8 corners. The 2D boxes, which
+ * are in image coordinates, are ignored. The output is the point cloud with a
+ * "box_id" array holding the index of the block of the box of each point, -1 for the
+ * points in no box. See PointBoxLabelling for how the boxes are searched.
+ */
+class VTK_EXPORT vtkBoundingBoxLabelling : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkBoundingBoxLabelling *New();
+  vtkTypeMacro(vtkBoundingBoxLabelling, vtkPolyDataAlgorithm)
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  //! Number of threads labelling the points, 0 to use all the cores
+  vtkGetMacro(NumberOfThreads, unsigned int)
+  vtkSetMacro(NumberOfThreads, unsigned int)
+
+protected:
+  vtkBoundingBoxLabelling();
+  ~vtkBoundingBoxLabelling() = default;
+
+  int FillInputPortInformation(int port, vtkInformation* info) override;
+  int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
+
+private:
+  vtkBoundingBoxLabelling(const vtkBoundingBoxLabelling&) = delete;
+  void operator=(const vtkBoundingBoxLabelling&) = delete;
+
+  unsigned int NumberOfThreads = 0;
+
+  //! Hierarchy of the boxes of the current frame
+  PointBoxLabelling Labelling;
+};
+
+#endif // VTK_BOUNDING_BOX_LABELLING_H
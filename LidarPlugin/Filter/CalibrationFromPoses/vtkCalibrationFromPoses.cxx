@@ -69,7 +69,11 @@ int vtkCalibrationFromPoses::RequestData(vtkInformation *vtkNotUsed(request),
   auto calibrated = EstimateCalibrationFromPosesAndApply(reference, toCalibrate,
                                                          this->TimeScaleAnalysisBound,
                                                          this->TimeScaleAnalysisStep,
-                                                         this->TimeStep);
+                                                         this->TimeStep,
+                                                         this->NumberOfThreads,
+                                                         this->MinRotationExcitation,
+                                                         this->OutlierThreshold,
+                                                         this->MaximumNumberOfConstraints);
 
   // Get the output
   vtkPolyData* output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
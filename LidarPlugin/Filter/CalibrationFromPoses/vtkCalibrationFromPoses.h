@@ -42,6 +42,18 @@ public:
   vtkSetMacro(TimeScaleAnalysisStep, double)
   vtkGetMacro(TimeScaleAnalysisStep, double)
 
+  vtkSetMacro(MinRotationExcitation, double)
+  vtkGetMacro(MinRotationExcitation, double)
+
+  vtkSetMacro(NumberOfThreads, unsigned int)
+  vtkGetMacro(NumberOfThreads, unsigned int)
+
+  vtkSetMacro(OutlierThreshold, double)
+  vtkGetMacro(OutlierThreshold, double)
+
+  vtkSetMacro(MaximumNumberOfConstraints, unsigned int)
+  vtkGetMacro(MaximumNumberOfConstraints, unsigned int)
+
 protected:
   vtkCalibrationFromPoses();
   ~vtkCalibrationFromPoses() = default;
@@ -63,6 +75,21 @@ private:
 
   //! step between two consecutives scale
   double TimeScaleAnalysisStep = 0.2;
+
+  //! Minimal rotation (in radian) between the two acquisition times of a
+  //! residual function, below which it is not used
+  double MinRotationExcitation = 0.0;
+
+  //! Number of threads used to evaluate the residual functions, 0 to use all the cores
+  unsigned int NumberOfThreads = 0;
+
+  //! Maximal translation error (in meter) of a residual function for the
+  //! calibration found by a RANSAC, above which it is not used. 0 to use them all
+  double OutlierThreshold = 0.0;
+
+  //! Maximal number of residual functions, the most excited ones being kept.
+  //! 0 to use them all
+  unsigned int MaximumNumberOfConstraints = 0;
 };
 
 #endif // VTK_CALIBRATION_FROM_POSES_H
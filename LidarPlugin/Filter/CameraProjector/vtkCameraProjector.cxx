@@ -20,19 +20,69 @@
 // LOCAL
 #include "vtkCameraProjector.h"
 #include "CameraProjection.h"
+#include "ParallelFor.h"
 #include "vtkHelper.h"
 
 // VTK
+#include <vtkCellArray.h>
 #include <vtkImageData.h>
 #include <vtkDataArray.h>
+#include <vtkIdList.h>
+#include <vtkIdTypeArray.h>
 #include <vtkIntArray.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
 #include <vtkNew.h>
 #include <vtkPointData.h>
+#include <vtkPoints.h>
 #include <vtkPolyData.h>
 #include <vtkSmartPointer.h>
 
+// STD
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace {
+// Number of points processed by a thread at a time
+const unsigned int ChunkSize = 4096;
+
+//------------------------------------------------------------------------------
+// Sample the color of the input image under each colored point, and paint the
+// reflectivity color of the points in the output image, the last point of a
+// pixel winning
+template<typename T>
+void SampleAndPaint(const T* inPixels, T* outPixels, int nbComponents,
+                    const std::vector<int>& pixelOf, const std::vector<int>& colored,
+                    vtkDataArray* intensity, int* rgb, unsigned int nThreads)
+{
+  Parallel::ForEachChunk(colored.size(), ChunkSize, nThreads,
+    [&](unsigned int, size_t begin, size_t end)
+  {
+    for (unsigned int k = begin; k < end; ++k)
+    {
+      const int pointIndex = colored[k];
+      const T* pixel = inPixels + static_cast<size_t>(pixelOf[pointIndex]) * nbComponents;
+      for (int c = 0; c < 3; ++c)
+      {
+        rgb[3 * pointIndex + c] = static_cast<int>(pixel[c]);
+      }
+    }
+  });
+
+  for (int pointIndex : colored)
+  {
+    const double intensityValue = intensity ? intensity->GetComponent(pointIndex, 0) : 0.0;
+    Eigen::Vector3d color = GetRGBColourFromReflectivity(intensityValue, 0, 255);
+    T* pixel = outPixels + static_cast<size_t>(pixelOf[pointIndex]) * nbComponents;
+    for (int c = 0; c < 3; ++c)
+    {
+      pixel[c] = static_cast<T>(color(2 - c));
+    }
+  }
+}
+}
+
 // Implementation of the New function
 vtkStandardNewMacro(vtkCameraProjector)
 
@@ -99,80 +149,175 @@ int vtkCameraProjector::RequestData(vtkInformation *vtkNotUsed(request),
   }
 
   outImg->DeepCopy(inImg);
-  outCloud->DeepCopy(pointcloud);
-  projectedCloud->DeepCopy(pointcloud);
-  projectedCloud->GetPoints()->Resize(0);
-  for (int i = 0; i < projectedCloud->GetPointData()->GetNumberOfArrays(); ++i)
+  outCloud->ShallowCopy(pointcloud);
+
+  // The undistorted image is remapped with the cached maps of the model, and
+  // the colors are then sampled from it
+  const int width = inImg->GetDimensions()[0];
+  const int height = inImg->GetDimensions()[1];
+  vtkDataArray* inScalars = inImg->GetPointData()->GetScalars();
+  vtkDataArray* outScalars = outImg->GetPointData()->GetScalars();
+  const bool undistort = this->UndistortImage && this->Model.GetType() != ProjectionType::Pinhole
+                         && inScalars && outScalars;
+  if (undistort)
   {
-    projectedCloud->GetPointData()->GetArray(i)->Resize(0);
+    switch (inScalars->GetDataType())
+    {
+      vtkTemplateMacro(this->Model.UndistortImage(static_cast<const VTK_TT*>(inScalars->GetVoidPointer(0)),
+                                                  width, height, inScalars->GetNumberOfComponents(),
+                                                  static_cast<VTK_TT*>(outScalars->GetVoidPointer(0))));
+    }
+    inScalars = outScalars;
   }
+  const int nbPoints = static_cast<int>(pointcloud->GetNumberOfPoints());
 
+  vtkDataArray* intensity = pointcloud->GetPointData()->GetArray("intensity");
 
-  vtkDataArray* intensity = outCloud->GetPointData()->GetArray("intensity");
-
-  // Try to get RGB array, if it does not exist, create it and fill it
-  vtkSmartPointer<vtkIntArray> rgbArray = vtkIntArray::SafeDownCast(outCloud->GetPointData()->GetArray(this->ColorArrayName.c_str()));
-  if (!rgbArray)
+  // Try to get RGB array, if it does not exist, create it and fill it. The
+  // output gets its own copy, the input one being left untouched
+  auto rgbArray = createArray<vtkIntArray>(std::string(this->ColorArrayName), 3, nbPoints);
+  vtkIntArray* inputRgbArray = vtkIntArray::SafeDownCast(pointcloud->GetPointData()->GetArray(this->ColorArrayName.c_str()));
+  if (inputRgbArray && inputRgbArray->GetNumberOfComponents() == 3)
+  {
+    rgbArray->DeepCopy(inputRgbArray);
+  }
+  else
   {
-    rgbArray = createArray<vtkIntArray>(std::string(this->ColorArrayName), 3, outCloud->GetNumberOfPoints());
-    outCloud->GetPointData()->AddArray(rgbArray);
-
     // fill tuples to (255, 255, 255)
     rgbArray->Fill(255);
   }
+  outCloud->GetPointData()->AddArray(rgbArray);
 
-  Eigen::VectorXd W = this->Model.GetParametersVector();
-
-  // Project the points in the image
-  for (int pointIndex = 0; pointIndex < outCloud->GetNumberOfPoints(); ++pointIndex)
+  // Project the points in the image, in batches distributed over the threads
+  const Eigen::VectorXd W = undistort ? Eigen::VectorXd(this->Model.GetParametersVector().head(11))
+                                      : this->Model.GetParametersVector();
+  const ProjectionType type = undistort ? ProjectionType::Pinhole : this->Model.GetType();
+  std::vector<double> pixels(2 * nbPoints);
+  std::vector<double> depths(nbPoints);
+  vtkDataArray* coordinates = nbPoints > 0 ? pointcloud->GetPoints()->GetData() : nullptr;
+  std::vector<double> convertedCoordinates;
+  if (coordinates && coordinates->GetDataType() != VTK_FLOAT && coordinates->GetDataType() != VTK_DOUBLE)
   {
-    double* pos = outCloud->GetPoint(pointIndex);
-    Eigen::Vector3d X(pos[0], pos[1], pos[2]);
-    Eigen::Vector2d y;
-
-    if (this->Type == ProjectionType::BrownConradyPinhole)
+    convertedCoordinates.resize(3 * nbPoints);
+    for (int i = 0; i < nbPoints; ++i)
+    {
+      pointcloud->GetPoint(i, &convertedCoordinates[3 * i]);
+    }
+  }
+  Parallel::ForEachChunk(nbPoints, ChunkSize, this->NumberOfThreads,
+    [&](unsigned int, size_t begin, size_t end)
+  {
+    const int n = end - begin;
+    if (!convertedCoordinates.empty())
     {
-      y = BrownConradyPinholeProjection(W, X, true);
+      ProjectPoints(W, type, &convertedCoordinates[3 * begin], n, &pixels[2 * begin], &depths[begin], true);
+    }
+    else if (coordinates->GetDataType() == VTK_FLOAT)
+    {
+      const float* points = static_cast<const float*>(coordinates->GetVoidPointer(0));
+      ProjectPoints(W, type, points + 3 * begin, n, &pixels[2 * begin], &depths[begin], true);
     }
     else
     {
-      y = FisheyeProjection(W, X, true);
+      const double* points = static_cast<const double*>(coordinates->GetVoidPointer(0));
+      ProjectPoints(W, type, points + 3 * begin, n, &pixels[2 * begin], &depths[begin], true);
     }
+  });
 
-    // y represents the pixel coordinates using opencv convention, we need to
-    // go back to vtkImageData pixel convention
-    int vtkRaw = y(1);
-    int vtkCol = y(0);
-
-    if ((vtkRaw < 0) || (vtkRaw >= inImg->GetDimensions()[1]) ||
-        (vtkCol < 0) || (vtkCol >= inImg->GetDimensions()[0]))
+  // pixels represent the pixel coordinates using opencv convention, we need
+  // to go back to vtkImageData pixel convention
+  std::vector<int> pixelOf(nbPoints, -1);
+  vtkNew<vtkIdList> projectedIds;
+  for (int pointIndex = 0; pointIndex < nbPoints; ++pointIndex)
+  {
+    const int vtkRaw = static_cast<int>(pixels[2 * pointIndex + 1]);
+    const int vtkCol = static_cast<int>(pixels[2 * pointIndex]);
+    if ((vtkRaw < 0) || (vtkRaw >= height) || (vtkCol < 0) || (vtkCol >= width))
     {
       continue;
     }
+    pixelOf[pointIndex] = vtkCol + width * vtkRaw;
+    projectedIds->InsertNextId(pointIndex);
+  }
 
-    vtkRaw = std::min(std::max(0, vtkRaw), inImg->GetDimensions()[1] - 1);
-    vtkCol = std::min(std::max(0, vtkCol), inImg->GetDimensions()[0] - 1);
-
-    // register the point if it is valid
-    double pt[3] = {y(0), y(1), 0};
-    projectedCloud->GetPoints()->InsertNextPoint(pt);
-    for (int i = 0; i < projectedCloud->GetPointData()->GetNumberOfArrays(); ++i)
+  // Only color the points nearest to the camera in their neighborhood
+  std::vector<int> colored;
+  colored.reserve(projectedIds->GetNumberOfIds());
+  if (this->OcclusionCulling)
+  {
+    std::vector<float> zBuffer(static_cast<size_t>(width) * height, std::numeric_limits<float>::max());
+    const int radius = std::max(0, this->OcclusionRadius);
+    for (vtkIdType k = 0; k < projectedIds->GetNumberOfIds(); ++k)
     {
-      projectedCloud->GetPointData()->GetArray(i)->InsertNextTuple(
-            pointcloud->GetPointData()->GetArray(i)->GetTuple(pointIndex));
+      const int pointIndex = projectedIds->GetId(k);
+      const int col = pixelOf[pointIndex] % width;
+      const int raw = pixelOf[pointIndex] / width;
+      for (int v = std::max(0, raw - radius); v <= std::min(height - 1, raw + radius); ++v)
+      {
+        for (int u = std::max(0, col - radius); u <= std::min(width - 1, col + radius); ++u)
+        {
+          float& depth = zBuffer[u + static_cast<size_t>(width) * v];
+          depth = std::min(depth, static_cast<float>(depths[pointIndex]));
+        }
+      }
     }
+    for (vtkIdType k = 0; k < projectedIds->GetNumberOfIds(); ++k)
+    {
+      const int pointIndex = projectedIds->GetId(k);
+      if (depths[pointIndex] <= zBuffer[pixelOf[pointIndex]] + this->OcclusionTolerance)
+      {
+        colored.push_back(pointIndex);
+      }
+    }
+  }
+  else
+  {
+    colored.assign(projectedIds->GetPointer(0), projectedIds->GetPointer(0) + projectedIds->GetNumberOfIds());
+  }
 
-    // Get its color
-    double intensityValue = intensity->GetTuple1(pointIndex);
-    Eigen::Vector3d color = GetRGBColourFromReflectivity(intensityValue, 0, 255);
+  // Get the colors, directly in the typed buffers of the images. All the colors
+  // are sampled before any point is painted, so the images can be the same
+  if (inScalars && outScalars && inScalars->GetNumberOfComponents() >= 3)
+  {
+    switch (inScalars->GetDataType())
+    {
+      vtkTemplateMacro(SampleAndPaint(static_cast<const VTK_TT*>(inScalars->GetVoidPointer(0)),
+                                      static_cast<VTK_TT*>(outScalars->GetVoidPointer(0)),
+                                      inScalars->GetNumberOfComponents(), pixelOf, colored,
+                                      intensity, rgbArray->GetPointer(0), this->NumberOfThreads));
+    }
+  }
+  else if (!colored.empty())
+  {
+    vtkWarningMacro("The image must have at least 3 components to color the points");
+  }
 
-    double rgb[3];
-    for (int k = 0; k < 3; ++k)
+  // register the points projected in the image, with their arrays
+  const vtkIdType nbProjected = projectedIds->GetNumberOfIds();
+  vtkNew<vtkPoints> projectedPoints;
+  projectedPoints->SetDataTypeToDouble();
+  projectedPoints->SetNumberOfPoints(nbProjected);
+  for (vtkIdType k = 0; k < nbProjected; ++k)
+  {
+    const vtkIdType pointIndex = projectedIds->GetId(k);
+    double pt[3] = {pixels[2 * pointIndex], pixels[2 * pointIndex + 1], 0};
+    projectedPoints->SetPoint(k, pt);
+  }
+  projectedCloud->Initialize();
+  projectedCloud->SetPoints(projectedPoints.GetPointer());
+  for (int i = 0; i < pointcloud->GetPointData()->GetNumberOfArrays(); ++i)
+  {
+    vtkDataArray* array = pointcloud->GetPointData()->GetArray(i);
+    if (!array)
     {
-      outImg->SetScalarComponentFromDouble(vtkCol, vtkRaw, 0, k, color(2 - k));
-      rgb[k] = inImg->GetScalarComponentAsDouble(vtkCol, vtkRaw, 0, k);
+      continue;
     }
-    rgbArray->SetTuple3(pointIndex, rgb[0], rgb[1], rgb[2]);
+    vtkSmartPointer<vtkDataArray> projectedArray;
+    projectedArray.TakeReference(array->NewInstance());
+    projectedArray->SetName(array->GetName());
+    projectedArray->SetNumberOfComponents(array->GetNumberOfComponents());
+    array->GetTuples(projectedIds.GetPointer(), projectedArray);
+    projectedCloud->GetPointData()->AddArray(projectedArray);
   }
 
   vtkNew<vtkIdTypeArray> cells;
@@ -37,6 +37,21 @@ public:
 
   void SetFileName(const std::string &argfilename);
 
+  vtkGetMacro(OcclusionCulling, bool)
+  vtkSetMacro(OcclusionCulling, bool)
+
+  vtkGetMacro(OcclusionRadius, int)
+  vtkSetMacro(OcclusionRadius, int)
+
+  vtkGetMacro(OcclusionTolerance, double)
+  vtkSetMacro(OcclusionTolerance, double)
+
+  vtkGetMacro(NumberOfThreads, unsigned int)
+  vtkSetMacro(NumberOfThreads, unsigned int)
+
+  vtkGetMacro(UndistortImage, bool)
+  vtkSetMacro(UndistortImage, bool)
+
 protected:
   vtkCameraProjector();
 
@@ -54,8 +69,24 @@ private:
   //! File containing the camera model and parameters
   std::string Filename;
 
-  //! Type of the camera model projection
-  ProjectionType Type = ProjectionType::FishEye;
+  //! Only color the points that are the nearest to the camera in their
+  //! neighborhood of the image, using a z-buffer of the projected depths
+  bool OcclusionCulling = false;
+
+  //! Radius in pixels of the neighborhood on which the depth of a point is
+  //! written in the z-buffer, to fill the gaps between the lidar points
+  int OcclusionRadius = 2;
+
+  //! Depth in meters behind the nearest point of a pixel under which a point
+  //! is still considered as visible
+  double OcclusionTolerance = 0.2;
+
+  //! Number of threads projecting the points, 0 to use all the cores
+  unsigned int NumberOfThreads = 0;
+
+  //! Output the image undistorted by the camera model, the points being
+  //! projected in it with the pinhole model of the same intrinsic parameters
+  bool UndistortImage = false;
 
   //! Name of the color array
   std::string ColorArrayName = "RGB";
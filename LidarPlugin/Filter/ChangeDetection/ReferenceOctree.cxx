@@ -0,0 +1,340 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "ReferenceOctree.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+namespace
+{
+const char Magic[8] = { 'L', 'V', 'O', 'C', 'T', 'R', 'E', 'E' };
+const uint32_t Version = 1;
+//! Written as is, to detect a file written with another byte order
+const uint32_t ByteOrderMark = 0x01020304;
+
+struct FileHeader
+{
+  char Magic[8];
+  uint32_t Version;
+  uint32_t ByteOrder;
+  double Origin[3];
+  uint64_t NumberOfNodes;
+  uint64_t NumberOfPoints;
+};
+
+// Number of points searched by a thread at a time
+const size_t PointChunkSize = 4096;
+
+//-----------------------------------------------------------------------------
+// Octant of a point relative to the center of a node: bit 0 for x, 1 for y, 2 for z
+int Octant(const float* point, const float center[3])
+{
+  return (point[0] >= center[0] ? 1 : 0) | (point[1] >= center[1] ? 2 : 0) | (point[2] >= center[2] ? 4 : 0);
+}
+}
+
+//-----------------------------------------------------------------------------
+void ReferenceOctree::Clear()
+{
+  this->Nodes.clear();
+  this->Points.clear();
+  std::fill(this->Origin, this->Origin + 3, 0.0);
+}
+
+//-----------------------------------------------------------------------------
+void ReferenceOctree::Build(const std::vector<double>& points, unsigned int maxPointsPerLeaf)
+{
+  this->Clear();
+  const size_t nbPoints = points.size() / 3;
+  if (nbPoints == 0)
+  {
+    return;
+  }
+
+  // the root is the cube bounding the points, centered on them
+  double min[3], max[3];
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    min[axis] = max[axis] = points[axis];
+  }
+  for (size_t i = 0; i < nbPoints; ++i)
+  {
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      min[axis] = std::min(min[axis], points[3 * i + axis]);
+      max[axis] = std::max(max[axis], points[3 * i + axis]);
+    }
+  }
+  double halfSize = 0.0;
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    this->Origin[axis] = 0.5 * (min[axis] + max[axis]);
+    halfSize = std::max(halfSize, 0.5 * (max[axis] - min[axis]));
+  }
+
+  this->Points.resize(3 * nbPoints);
+  for (size_t i = 0; i < nbPoints; ++i)
+  {
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      this->Points[3 * i + axis] = static_cast<float>(points[3 * i + axis] - this->Origin[axis]);
+    }
+  }
+
+  Node root = {};
+  root.HalfSize = static_cast<float>(halfSize) * 1.001f + 1e-3f;
+  root.NumberOfPoints = nbPoints;
+  this->Nodes.push_back(root);
+  std::vector<float> buffer;
+  this->Split(0, 0, std::max(1u, maxPointsPerLeaf), buffer);
+}
+
+//-----------------------------------------------------------------------------
+void ReferenceOctree::Split(uint32_t node, int depth, unsigned int maxPointsPerLeaf, std::vector<float>& buffer)
+{
+  const Node parent = this->Nodes[node];
+  if (parent.NumberOfPoints <= maxPointsPerLeaf || depth >= MaxDepth)
+  {
+    return;
+  }
+
+  // sort the points of the node by octant
+  float* points = this->Points.data() + 3 * parent.FirstPoint;
+  uint64_t counts[8] = {};
+  for (uint64_t i = 0; i < parent.NumberOfPoints; ++i)
+  {
+    counts[Octant(points + 3 * i, parent.Center)]++;
+  }
+  uint64_t offsets[8];
+  offsets[0] = 0;
+  for (int octant = 1; octant < 8; ++octant)
+  {
+    offsets[octant] = offsets[octant - 1] + counts[octant - 1];
+  }
+  buffer.resize(3 * parent.NumberOfPoints);
+  uint64_t next[8];
+  std::copy(offsets, offsets + 8, next);
+  for (uint64_t i = 0; i < parent.NumberOfPoints; ++i)
+  {
+    std::copy(points + 3 * i, points + 3 * i + 3, buffer.data() + 3 * next[Octant(points + 3 * i, parent.Center)]++);
+  }
+  std::copy(buffer.begin(), buffer.end(), points);
+
+  const uint32_t firstChild = static_cast<uint32_t>(this->Nodes.size());
+  this->Nodes[node].FirstChild = firstChild;
+  for (int octant = 0; octant < 8; ++octant)
+  {
+    Node child = {};
+    child.HalfSize = 0.5f * parent.HalfSize;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      child.Center[axis] = parent.Center[axis] + ((octant >> axis) & 1 ? child.HalfSize : -child.HalfSize);
+    }
+    child.FirstPoint = parent.FirstPoint + offsets[octant];
+    child.NumberOfPoints = counts[octant];
+    this->Nodes.push_back(child);
+  }
+  for (int octant = 0; octant < 8; ++octant)
+  {
+    this->Split(firstChild + octant, depth + 1, maxPointsPerLeaf, buffer);
+  }
+}
+
+//-----------------------------------------------------------------------------
+double ReferenceOctree::GetDistance(const double point[3], double maxDistance) const
+{
+  if (this->Nodes.empty())
+  {
+    return maxDistance;
+  }
+  const float p[3] = { static_cast<float>(point[0] - this->Origin[0]),
+                       static_cast<float>(point[1] - this->Origin[1]),
+                       static_cast<float>(point[2] - this->Origin[2]) };
+  float best = static_cast<float>(maxDistance * maxDistance);
+
+  // squared distance from the point to the box of a node
+  auto boxDistance = [&p](const Node& node)
+  {
+    float distance = 0.f;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      const float d = std::max(0.f, std::abs(p[axis] - node.Center[axis]) - node.HalfSize);
+      distance += d * d;
+    }
+    return distance;
+  };
+
+  // depth first search, the closest children being visited first
+  uint32_t stack[8 * (MaxDepth + 1)];
+  int stackSize = 0;
+  stack[stackSize++] = 0;
+  while (stackSize > 0)
+  {
+    const Node& node = this->Nodes[stack[--stackSize]];
+    if (boxDistance(node) >= best)
+    {
+      continue;
+    }
+    if (node.FirstChild == 0)
+    {
+      const float* points = this->Points.data() + 3 * node.FirstPoint;
+      for (uint64_t i = 0; i < node.NumberOfPoints; ++i, points += 3)
+      {
+        const float dx = points[0] - p[0], dy = points[1] - p[1], dz = points[2] - p[2];
+        best = std::min(best, dx * dx + dy * dy + dz * dz);
+      }
+      continue;
+    }
+
+    std::pair<float, uint32_t> children[8];
+    int nbChildren = 0;
+    for (uint32_t child = node.FirstChild; child < node.FirstChild + 8; ++child)
+    {
+      if (this->Nodes[child].NumberOfPoints > 0)
+      {
+        const float distance = boxDistance(this->Nodes[child]);
+        if (distance < best)
+        {
+          // insertion sort of at most 8 children
+          int i = nbChildren++;
+          for (; i > 0 && children[i - 1].first > distance; --i)
+          {
+            children[i] = children[i - 1];
+          }
+          children[i] = std::make_pair(distance, child);
+        }
+      }
+    }
+    for (int i = nbChildren - 1; i >= 0; --i)
+    {
+      stack[stackSize++] = children[i].second;
+    }
+  }
+  return std::min(maxDistance, static_cast<double>(std::sqrt(best)));
+}
+
+//-----------------------------------------------------------------------------
+void ReferenceOctree::GetDistances(const std::vector<double>& points, double maxDistance,
+                                   std::vector<float>& distances, unsigned int nbThreads) const
+{
+  const size_t nbPoints = points.size() / 3;
+  distances.resize(nbPoints);
+  Parallel::ForEachChunk(nbPoints, PointChunkSize, nbThreads,
+    [&](unsigned int, size_t begin, size_t end)
+  {
+    for (size_t i = begin; i < end; ++i)
+    {
+      distances[i] = static_cast<float>(this->GetDistance(&points[3 * i], maxDistance));
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+bool ReferenceOctree::Write(const std::string& filename) const
+{
+  FileHeader header = {};
+  std::memcpy(header.Magic, Magic, sizeof(Magic));
+  header.Version = Version;
+  header.ByteOrder = ByteOrderMark;
+  std::copy(this->Origin, this->Origin + 3, header.Origin);
+  header.NumberOfNodes = this->Nodes.size();
+  header.NumberOfPoints = this->GetNumberOfPoints();
+
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(this->Nodes.data()), this->Nodes.size() * sizeof(Node));
+  file.write(reinterpret_cast<const char*>(this->Points.data()), this->Points.size() * sizeof(float));
+  if (!file)
+  {
+    std::cerr << "Could not write the reference octree " << filename << std::endl;
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool ReferenceOctree::Read(const std::string& filename)
+{
+  this->Clear();
+  std::ifstream file(filename, std::ios::binary);
+  FileHeader header;
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+  {
+    std::cerr << "Could not read the reference octree " << filename << std::endl;
+    return false;
+  }
+  if (std::memcmp(header.Magic, Magic, sizeof(Magic)) != 0 || header.Version != Version ||
+      header.ByteOrder != ByteOrderMark)
+  {
+    std::cerr << "The file " << filename << " is not a reference octree of this version and byte order"
+              << std::endl;
+    return false;
+  }
+
+  // check the size of the file before allocating the nodes and points
+  file.seekg(0, std::ios::end);
+  const uint64_t size = static_cast<uint64_t>(file.tellg());
+  if (header.NumberOfNodes > size / sizeof(Node) || header.NumberOfPoints > size / (3 * sizeof(float)) ||
+      sizeof(header) + header.NumberOfNodes * sizeof(Node) + header.NumberOfPoints * 3 * sizeof(float) > size)
+  {
+    std::cerr << "The reference octree " << filename << " is truncated" << std::endl;
+    return false;
+  }
+  file.seekg(sizeof(header), std::ios::beg);
+  this->Nodes.resize(header.NumberOfNodes);
+  this->Points.resize(3 * header.NumberOfPoints);
+  file.read(reinterpret_cast<char*>(this->Nodes.data()), this->Nodes.size() * sizeof(Node));
+  file.read(reinterpret_cast<char*>(this->Points.data()), this->Points.size() * sizeof(float));
+  if (!file)
+  {
+    std::cerr << "Could not read the reference octree " << filename << std::endl;
+    this->Clear();
+    return false;
+  }
+
+  // the nodes must stay within the arrays and the depth of the octree
+  // within MaxDepth to be searched safely, the children following their parent
+  std::vector<int> depths(this->Nodes.size(), 0);
+  for (size_t i = 0; i < this->Nodes.size(); ++i)
+  {
+    const Node& node = this->Nodes[i];
+    bool valid = node.FirstPoint + node.NumberOfPoints <= header.NumberOfPoints;
+    if (node.FirstChild != 0)
+    {
+      valid &= node.FirstChild > i && static_cast<uint64_t>(node.FirstChild) + 8 <= header.NumberOfNodes &&
+               depths[i] < MaxDepth;
+      for (uint32_t child = node.FirstChild; valid && child < node.FirstChild + 8; ++child)
+      {
+        depths[child] = depths[i] + 1;
+      }
+    }
+    if (!valid)
+    {
+      std::cerr << "The reference octree " << filename << " is corrupted" << std::endl;
+      this->Clear();
+      return false;
+    }
+  }
+  std::copy(header.Origin, header.Origin + 3, this->Origin);
+  return true;
+}
@@ -0,0 +1,103 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef REFERENCE_OCTREE_H
+#define REFERENCE_OCTREE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * \class ReferenceOctree
+ * \brief Octree over the points of a reference scan, to compare the scans of
+ *        a later session with it.
+ *
+ * The nodes are stored in a flat array, the 8 children of a node being
+ * contiguous, and the points of a node are contiguous too, sorted by octant
+ * at each level, so that the octree can be written to a file as is and read
+ * back without being built again. The points are stored in single precision
+ * relative to the center of the reference, which keeps them precise in
+ * georeferenced coordinates.
+ *
+ * The distance of a point to the reference is searched up to a maximum
+ * distance, the nodes farther than the closest point found so far being
+ * skipped, so that a point far from the reference costs a few nodes only.
+ */
+class ReferenceOctree
+{
+public:
+  //! Build the octree on points given as x, y, z, the leaves holding at most
+  //! maxPointsPerLeaf points unless they are at the maximal depth
+  void Build(const std::vector<double>& points, unsigned int maxPointsPerLeaf = 32);
+
+  //! Remove all the points
+  void Clear();
+
+  bool IsEmpty() const { return this->Nodes.empty(); }
+
+  uint64_t GetNumberOfPoints() const { return this->Points.size() / 3; }
+
+  /**
+   * @brief Write the octree in a file, replacing it
+   * @return false if the file could not be written
+   */
+  bool Write(const std::string& filename) const;
+
+  /**
+   * @brief Read an octree written by Write, replacing this one
+   * @return false if the file could not be read or is not an octree
+   */
+  bool Read(const std::string& filename);
+
+  //! Distance from a point to the closest point of the reference, or
+  //! maxDistance if none is closer
+  double GetDistance(const double point[3], double maxDistance) const;
+
+  /**
+   * @brief Distances of points given as x, y, z to the reference, see GetDistance
+   * @param nbThreads number of threads searching the points, 0 to use all the cores
+   */
+  void GetDistances(const std::vector<double>& points, double maxDistance, std::vector<float>& distances,
+                    unsigned int nbThreads = 0) const;
+
+  //! Maximal depth of the octree, the leaves at this depth may hold more points
+  static const int MaxDepth = 20;
+
+private:
+  struct Node
+  {
+    float Center[3];
+    float HalfSize;
+    uint64_t FirstPoint;
+    uint64_t NumberOfPoints;
+    //! Index of the first of the 8 children, 0 for a leaf since the root
+    //! is no child
+    uint32_t FirstChild;
+    uint32_t Padding;
+  };
+
+  //! Split the node into 8 children if it holds too many points
+  void Split(uint32_t node, int depth, unsigned int maxPointsPerLeaf, std::vector<float>& buffer);
+
+  //! Center of the reference, the points being relative to it
+  double Origin[3] = { 0.0, 0.0, 0.0 };
+  std::vector<Node> Nodes;
+  std::vector<float> Points;
+};
+
+#endif // REFERENCE_OCTREE_H
@@ -0,0 +1,379 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "vtkChangeDetection.h"
+
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkTransform.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkUnsignedIntArray.h>
+
+#include "vtkTemporalTransforms.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+// Each integer coordinate of a voxel is stored on 21 bits, as in vtkVoxelAccumulator
+const int64_t CoordinateBits = 21;
+const int64_t CoordinateOffset = int64_t(1) << (CoordinateBits - 1);
+
+//-----------------------------------------------------------------------------
+// Polydata holding a vertex per point
+void SetPointsAndVerts(vtkPolyData* output, const std::vector<float>& coordinates)
+{
+  const vtkIdType nbPoints = static_cast<vtkIdType>(coordinates.size() / 3);
+  vtkNew<vtkPoints> points;
+  points->SetDataTypeToFloat();
+  points->SetNumberOfPoints(nbPoints);
+  std::copy(coordinates.begin(), coordinates.end(), static_cast<float*>(points->GetVoidPointer(0)));
+  vtkNew<vtkIdTypeArray> connectivity;
+  connectivity->SetNumberOfValues(2 * nbPoints);
+  vtkIdType* cell = connectivity->GetPointer(0);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    cell[2 * i] = 1;
+    cell[2 * i + 1] = i;
+  }
+  vtkNew<vtkCellArray> verts;
+  verts->SetCells(nbPoints, connectivity.GetPointer());
+  output->SetPoints(points.GetPointer());
+  output->SetVerts(verts.GetPointer());
+}
+}
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkChangeDetection)
+
+//-----------------------------------------------------------------------------
+vtkChangeDetection::vtkChangeDetection()
+{
+  this->SetNumberOfInputPorts(3);
+  this->SetNumberOfOutputPorts(2);
+  this->Interpolator = vtkSmartPointer<vtkCustomTransformInterpolator>::New();
+  this->Interpolator->SetInterpolationTypeToLinear();
+}
+
+//-----------------------------------------------------------------------------
+void vtkChangeDetection::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "ReferenceFileName: " << this->ReferenceFileName << std::endl;
+  os << indent << "MaxPointsPerLeaf: " << this->MaxPointsPerLeaf << std::endl;
+  os << indent << "DistanceThreshold: " << this->DistanceThreshold << std::endl;
+  os << indent << "MaxDistance: " << this->MaxDistance << std::endl;
+  os << indent << "StatisticsVoxelSize: " << this->StatisticsVoxelSize << std::endl;
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << std::endl;
+}
+
+//----------------------------------------------------------------------------
+vtkMTimeType vtkChangeDetection::GetMTime()
+{
+  return std::max(this->Superclass::GetMTime(), this->Interpolator->GetMTime());
+}
+
+//-----------------------------------------------------------------------------
+void vtkChangeDetection::SetReferenceFileName(const std::string& filename)
+{
+  if (this->ReferenceFileName != filename)
+  {
+    this->ReferenceFileName = filename;
+    // the octree is saved again from the reference input, if any
+    this->ReferenceMTime = 0;
+    this->ResetStatistics();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkChangeDetection::SetMaxPointsPerLeaf(unsigned int value)
+{
+  if (this->MaxPointsPerLeaf != value && value > 0)
+  {
+    this->MaxPointsPerLeaf = value;
+    // the octree is built again from the reference input, if any
+    this->ReferenceMTime = 0;
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkChangeDetection::SetStatisticsVoxelSize(double value)
+{
+  if (this->StatisticsVoxelSize != value && value > 0.0)
+  {
+    this->StatisticsVoxelSize = value;
+    this->ResetStatistics();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkChangeDetection::ResetStatistics()
+{
+  this->Statistics.clear();
+  this->LastFrameMTime = 0;
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+int64_t vtkChangeDetection::PackVoxel(const int voxel[3])
+{
+  int64_t key = 0;
+  for (int k = 0; k < 3; ++k)
+  {
+    key = (key << CoordinateBits) | (voxel[k] + CoordinateOffset);
+  }
+  return key;
+}
+
+//-----------------------------------------------------------------------------
+void vtkChangeDetection::UnpackVoxel(int64_t key, int voxel[3])
+{
+  for (int k = 2; k >= 0; --k)
+  {
+    voxel[k] = static_cast<int>((key & ((int64_t(1) << CoordinateBits) - 1)) - CoordinateOffset);
+    key >>= CoordinateBits;
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkChangeDetection::FillInputPortInformation(int port, vtkInformation* info)
+{
+  if (port == 0)
+  {
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+    return 1;
+  }
+  if (port == 1 || port == 2)
+  {
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+    info->Set(vtkAlgorithm::INPUT_IS_OPTIONAL(), 1);
+    return 1;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkChangeDetection::UpdateReference(vtkPolyData* reference)
+{
+  if (reference)
+  {
+    if (reference->GetMTime() == this->ReferenceMTime && this->ReferenceSource.empty())
+    {
+      return true;
+    }
+    std::vector<double> points(3 * reference->GetNumberOfPoints());
+    for (vtkIdType i = 0; i < reference->GetNumberOfPoints(); ++i)
+    {
+      reference->GetPoint(i, &points[3 * i]);
+    }
+    this->Reference.Build(points, this->MaxPointsPerLeaf);
+    this->ReferenceMTime = reference->GetMTime();
+    this->ReferenceSource.clear();
+    this->Statistics.clear();
+    if (!this->ReferenceFileName.empty() && !this->Reference.Write(this->ReferenceFileName))
+    {
+      vtkWarningMacro(<< "Could not save the reference octree to " << this->ReferenceFileName);
+    }
+    return true;
+  }
+
+  if (this->ReferenceFileName.empty())
+  {
+    vtkErrorMacro(<< "A reference point cloud or a reference octree file is required");
+    return false;
+  }
+  if (this->ReferenceSource == this->ReferenceFileName)
+  {
+    return true;
+  }
+  this->ReferenceMTime = 0;
+  this->ReferenceSource.clear();
+  this->Statistics.clear();
+  if (!this->Reference.Read(this->ReferenceFileName))
+  {
+    vtkErrorMacro(<< "Could not read the reference octree " << this->ReferenceFileName);
+    return false;
+  }
+  this->ReferenceSource = this->ReferenceFileName;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+int vtkChangeDetection::RequestData(vtkInformation* vtkNotUsed(request),
+                                    vtkInformationVector** inputVector,
+                                    vtkInformationVector* outputVector)
+{
+  // Get the inputs
+  vtkPolyData* pointcloud = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
+  vtkPolyData* trajectoryPoly = vtkPolyData::GetData(inputVector[1], 0);
+  vtkPolyData* reference = vtkPolyData::GetData(inputVector[2], 0);
+  vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
+  if (!this->UpdateReference(reference))
+  {
+    return 0;
+  }
+
+  // going back in time restarts the statistics
+  double frameTime = 0.0;
+  if (inInfo->Has(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP()))
+  {
+    frameTime = inInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP());
+    if (this->LastFrameMTime != 0 && frameTime < this->LastFrameTime)
+    {
+      this->Statistics.clear();
+      this->LastFrameMTime = 0;
+    }
+  }
+
+  // the frame in world coordinates
+  vtkSmartPointer<vtkTransform> pose;
+  if (trajectoryPoly && trajectoryPoly->GetNumberOfPoints() > 0)
+  {
+    // Fill the interpolator
+    if (this->Interpolator->GetNumberOfTransforms() == 0)
+    {
+      auto trajectory = vtkTemporalTransforms::CreateFromPolyData(trajectoryPoly);
+      auto type = this->Interpolator->GetInterpolationType();
+      this->Interpolator = trajectory->CreateInterpolator();
+      this->Interpolator->SetInterpolationType(type);
+    }
+    pose = vtkSmartPointer<vtkTransform>::New();
+    this->Interpolator->InterpolateTransform(frameTime, pose);
+    pose->Update();
+  }
+  const vtkIdType nbPoints = pointcloud->GetNumberOfPoints();
+  std::vector<double> points(3 * nbPoints);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    pointcloud->GetPoint(i, &points[3 * i]);
+    if (pose)
+    {
+      pose->InternalTransformPoint(&points[3 * i], &points[3 * i]);
+    }
+  }
+
+  // compare the frame with the reference, the points being searched in parallel
+  std::vector<float> distances;
+  this->Reference.GetDistances(points, std::max(this->MaxDistance, this->DistanceThreshold), distances,
+                               this->NumberOfThreads);
+
+  // only accumulate the frames that have not been compared yet
+  if (pointcloud->GetMTime() != this->LastFrameMTime)
+  {
+    if (this->Statistics.empty() && nbPoints > 0)
+    {
+      std::copy(points.begin(), points.begin() + 3, this->StatisticsOrigin);
+    }
+    for (vtkIdType i = 0; i < nbPoints; ++i)
+    {
+      int voxel[3];
+      for (int k = 0; k < 3; ++k)
+      {
+        voxel[k] = static_cast<int>(
+          std::floor((points[3 * i + k] - this->StatisticsOrigin[k]) / this->StatisticsVoxelSize));
+      }
+      VoxelStatistics& statistics = this->Statistics[PackVoxel(voxel)];
+      statistics.NumberOfPoints++;
+      statistics.NumberOfChangedPoints += distances[i] > this->DistanceThreshold;
+      statistics.SumOfDistances += distances[i];
+    }
+    this->LastFrameMTime = pointcloud->GetMTime();
+    this->LastFrameTime = frameTime;
+  }
+
+  // output 0 - the frame in world coordinates with its changes
+  vtkPolyData* output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
+  output->ShallowCopy(pointcloud);
+  vtkNew<vtkPoints> worldPoints;
+  worldPoints->SetDataTypeToDouble();
+  worldPoints->SetNumberOfPoints(nbPoints);
+  std::copy(points.begin(), points.end(), static_cast<double*>(worldPoints->GetVoidPointer(0)));
+  output->SetPoints(worldPoints.GetPointer());
+  vtkNew<vtkFloatArray> distanceArray;
+  distanceArray->SetName("change_distance");
+  distanceArray->SetNumberOfTuples(nbPoints);
+  std::copy(distances.begin(), distances.end(), distanceArray->GetPointer(0));
+  vtkNew<vtkUnsignedCharArray> changed;
+  changed->SetName("changed");
+  changed->SetNumberOfTuples(nbPoints);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    changed->SetValue(i, distances[i] > this->DistanceThreshold);
+  }
+  output->GetPointData()->AddArray(distanceArray.GetPointer());
+  output->GetPointData()->AddArray(changed.GetPointer());
+  output->GetPointData()->SetActiveScalars("change_distance");
+
+  // output 1 - the statistics of the voxels
+  this->FillStatistics(vtkPolyData::GetData(outputVector->GetInformationObject(1)));
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkChangeDetection::FillStatistics(vtkPolyData* output) const
+{
+  output->Initialize();
+  const vtkIdType nbVoxels = static_cast<vtkIdType>(this->Statistics.size());
+  std::vector<float> coordinates;
+  coordinates.reserve(3 * nbVoxels);
+  vtkNew<vtkUnsignedIntArray> nbPoints;
+  nbPoints->SetName("number_of_points");
+  nbPoints->SetNumberOfTuples(nbVoxels);
+  vtkNew<vtkUnsignedIntArray> nbChanged;
+  nbChanged->SetName("number_of_changed_points");
+  nbChanged->SetNumberOfTuples(nbVoxels);
+  vtkNew<vtkFloatArray> ratio;
+  ratio->SetName("changed_ratio");
+  ratio->SetNumberOfTuples(nbVoxels);
+  vtkNew<vtkFloatArray> meanDistance;
+  meanDistance->SetName("mean_distance");
+  meanDistance->SetNumberOfTuples(nbVoxels);
+
+  vtkIdType index = 0;
+  for (const auto& it : this->Statistics)
+  {
+    int voxel[3];
+    UnpackVoxel(it.first, voxel);
+    for (int k = 0; k < 3; ++k)
+    {
+      coordinates.push_back(
+        static_cast<float>(this->StatisticsOrigin[k] + (voxel[k] + 0.5) * this->StatisticsVoxelSize));
+    }
+    const VoxelStatistics& statistics = it.second;
+    nbPoints->SetValue(index, statistics.NumberOfPoints);
+    nbChanged->SetValue(index, statistics.NumberOfChangedPoints);
+    ratio->SetValue(index, static_cast<float>(statistics.NumberOfChangedPoints) / statistics.NumberOfPoints);
+    meanDistance->SetValue(index, static_cast<float>(statistics.SumOfDistances / statistics.NumberOfPoints));
+    ++index;
+  }
+
+  SetPointsAndVerts(output, coordinates);
+  output->GetPointData()->AddArray(nbPoints.GetPointer());
+  output->GetPointData()->AddArray(nbChanged.GetPointer());
+  output->GetPointData()->AddArray(ratio.GetPointer());
+  output->GetPointData()->AddArray(meanDistance.GetPointer());
+  output->GetPointData()->SetActiveScalars("changed_ratio");
+}
@@ -0,0 +1,191 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VTK_CHANGE_DETECTION_H
+#define VTK_CHANGE_DETECTION_H
+
+#include <vtkPolyDataAlgorithm.h>
+#include <vtkSmartPointer.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "ReferenceOctree.h"
+#include "vtkCustomTransformInterpolator.h"
+
+/**
+ * @brief The vtkChangeDetection compares the successive frames of a session with a
+ * reference session of the same site. It takes 3 inputs: the point cloud, an optional
+ * vtkTemporalTransforms giving the pose of the sensor at the time of each frame, and
+ * an optional reference point cloud in world coordinates. Without trajectory the frames
+ * are expected in world coordinates.
+ *
+ * The reference is indexed by a ReferenceOctree, which is written to ReferenceFileName
+ * when it is built from the reference input, and read from this file when the reference
+ * input is not connected, so that a reference session is only indexed once.
+ *
+ * The first output is the frame in world coordinates, with the distance of each point to
+ * the reference, searched up to MaxDistance, and whether it is beyond DistanceThreshold.
+ * The second output holds a point at the center of each voxel of StatisticsVoxelSize
+ * where frames were compared, with the number of points compared and changed and their
+ * mean distance, accumulated over the frames.
+ */
+class VTK_EXPORT vtkChangeDetection : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkChangeDetection* New();
+  vtkTypeMacro(vtkChangeDetection, vtkPolyDataAlgorithm)
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  //@{
+  /**
+   * @copydoc vtkChangeDetection::ReferenceFileName
+   */
+  vtkGetMacro(ReferenceFileName, std::string)
+  void SetReferenceFileName(const std::string& filename);
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkChangeDetection::MaxPointsPerLeaf
+   */
+  vtkGetMacro(MaxPointsPerLeaf, unsigned int)
+  void SetMaxPointsPerLeaf(unsigned int value);
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkChangeDetection::DistanceThreshold
+   */
+  vtkGetMacro(DistanceThreshold, double)
+  vtkSetMacro(DistanceThreshold, double)
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkChangeDetection::MaxDistance
+   */
+  vtkGetMacro(MaxDistance, double)
+  vtkSetMacro(MaxDistance, double)
+  //@}
+
+  //@{
+  /**
+   * @brief Size of the edges of the voxels of the statistics, in meters.
+   * Changing it resets the statistics
+   */
+  vtkGetMacro(StatisticsVoxelSize, double)
+  void SetStatisticsVoxelSize(double value);
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkChangeDetection::NumberOfThreads
+   */
+  vtkGetMacro(NumberOfThreads, unsigned int)
+  vtkSetMacro(NumberOfThreads, unsigned int)
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkChangeDetection::InterpolationType
+   */
+  int GetInterpolationType() { return this->Interpolator->GetInterpolationType(); }
+  void SetInterpolationType(int value) { this->Interpolator->SetInterpolationType(value); }
+  //@}
+
+  /**
+   * @brief Remove the accumulated statistics
+   */
+  void ResetStatistics();
+
+  /**
+   * @brief Override GetMTime() because we depend on the TransformInterpolator
+   * which may be modified outside of this class.
+   */
+  vtkMTimeType GetMTime() override;
+
+protected:
+  vtkChangeDetection();
+
+  int FillInputPortInformation(int port, vtkInformation* info) override;
+  int RequestData(vtkInformation* request,
+                  vtkInformationVector** inputVector,
+                  vtkInformationVector* outputVector) override;
+
+private:
+  //! Build the octree from the reference input, or read it from the file
+  bool UpdateReference(vtkPolyData* reference);
+
+  //! Fill the output with a point per voxel of the statistics
+  void FillStatistics(vtkPolyData* output) const;
+
+  //! Changes of the points compared in a voxel
+  struct VoxelStatistics
+  {
+    uint32_t NumberOfPoints = 0;
+    uint32_t NumberOfChangedPoints = 0;
+    double SumOfDistances = 0.0;
+  };
+
+  //! Integer coordinates of a voxel packed in a key
+  static int64_t PackVoxel(const int voxel[3]);
+  static void UnpackVoxel(int64_t key, int voxel[3]);
+
+  //! Octree file of the reference, written when the reference input is
+  //! connected and read otherwise. Empty to only use the reference input
+  std::string ReferenceFileName;
+
+  //! Maximal number of points of the leaves of the octree
+  unsigned int MaxPointsPerLeaf = 32;
+
+  //! Distance to the reference above which a point has changed, in meters
+  double DistanceThreshold = 0.2;
+
+  //! Distance up to which the closest point of the reference is searched, in
+  //! meters, the distance of the points farther being MaxDistance
+  double MaxDistance = 1.0;
+
+  double StatisticsVoxelSize = 1.0;
+
+  //! Number of threads comparing the points, 0 to use all the cores
+  unsigned int NumberOfThreads = 0;
+
+  //! The indexed reference, with the modification time of the reference
+  //! input it was built from, or the file it was read from
+  ReferenceOctree Reference;
+  vtkMTimeType ReferenceMTime = 0;
+  std::string ReferenceSource;
+
+  //! The accumulated statistics, the voxels being relative to the first
+  //! point compared to keep their packed coordinates small
+  std::unordered_map<int64_t, VoxelStatistics> Statistics;
+  double StatisticsOrigin[3] = { 0.0, 0.0, 0.0 };
+
+  //! Modification time of the last frame compared, to avoid accumulating the same
+  //! frame twice when the filter re-executes without a new frame
+  vtkMTimeType LastFrameMTime = 0;
+
+  //! Pipeline time of the last frame compared, going back in time resets the statistics
+  double LastFrameTime = 0.0;
+
+  //! Interpolator used to get the pose of the sensor
+  vtkSmartPointer<vtkCustomTransformInterpolator> Interpolator;
+
+  vtkChangeDetection(const vtkChangeDetection&) /*= delete*/;
+  void operator =(const vtkChangeDetection&) /*= delete*/;
+};
+
+#endif // VTK_CHANGE_DETECTION_H
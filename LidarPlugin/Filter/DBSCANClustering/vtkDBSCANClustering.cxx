@@ -0,0 +1,89 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "vtkDBSCANClustering.h"
+
+#include "GridDBSCAN.h"
+
+#include <vtkDataArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkIntArray.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+//-----------------------------------------------------------------------------
+template<typename T>
+std::vector<int> Cluster(const T* points, int nbPoints, double epsilon, int minPts,
+                         unsigned int nbThreads, int& nbClusters)
+{
+  GridDBSCAN<T> dbscan(epsilon, minPts, nbThreads);
+  std::vector<int> labels = dbscan.fit(points, nbPoints);
+  nbClusters = dbscan.getNbCluster();
+  return labels;
+}
+}
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkDBSCANClustering)
+
+//-----------------------------------------------------------------------------
+int vtkDBSCANClustering::RequestData(vtkInformation* vtkNotUsed(request),
+                                     vtkInformationVector** inputVector,
+                                     vtkInformationVector* outputVector)
+{
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
+  vtkPolyData* output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
+  output->ShallowCopy(input);
+  this->NumberOfClusters = 0;
+
+  if (!(this->Epsilon > 0.0))
+  {
+    vtkErrorMacro("Epsilon must be positive");
+    return 0;
+  }
+
+  vtkPoints* points = input->GetPoints();
+  const int nbPoints = points ? static_cast<int>(points->GetNumberOfPoints()) : 0;
+  std::vector<int> labels;
+  if (nbPoints > 0)
+  {
+    // the clustering reads the coordinates in place
+    vtkDataArray* coordinates = points->GetData();
+    switch (coordinates->GetDataType())
+    {
+      vtkTemplateMacro(labels = Cluster(static_cast<const VTK_TT*>(coordinates->GetVoidPointer(0)),
+                                        nbPoints, this->Epsilon, this->MinPts,
+                                        this->NumberOfThreads, this->NumberOfClusters));
+    }
+  }
+
+  vtkNew<vtkIntArray> clusters;
+  clusters->SetName("cluster_id");
+  clusters->SetNumberOfTuples(nbPoints);
+  if (!labels.empty())
+  {
+    std::copy(labels.begin(), labels.end(), clusters->GetPointer(0));
+  }
+  output->GetPointData()->AddArray(clusters.Get());
+
+  return 1;
+}
@@ -0,0 +1,82 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VTK_DBSCAN_CLUSTERING_H
+#define VTK_DBSCAN_CLUSTERING_H
+
+#include <vtkPolyDataAlgorithm.h>
+
+/**
+ * @brief vtkDBSCANClustering clusters the points of its input with DBSCAN,
+ * see GridDBSCAN. The output is the input with a "cluster_id" point array
+ * holding 0 for the noise and the index of the cluster, from 1, otherwise.
+ */
+class VTK_EXPORT vtkDBSCANClustering : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkDBSCANClustering* New();
+  vtkTypeMacro(vtkDBSCANClustering, vtkPolyDataAlgorithm)
+
+  //@{
+  /**
+   * @copydoc vtkDBSCANClustering::Epsilon
+   */
+  vtkGetMacro(Epsilon, double)
+  vtkSetMacro(Epsilon, double)
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkDBSCANClustering::MinPts
+   */
+  vtkGetMacro(MinPts, int)
+  vtkSetMacro(MinPts, int)
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkDBSCANClustering::NumberOfThreads
+   */
+  vtkGetMacro(NumberOfThreads, unsigned int)
+  vtkSetMacro(NumberOfThreads, unsigned int)
+  //@}
+
+  //! Number of clusters found in the last output
+  vtkGetMacro(NumberOfClusters, int)
+
+protected:
+  vtkDBSCANClustering() = default;
+
+  int RequestData(vtkInformation* request,
+                  vtkInformationVector** inputVector,
+                  vtkInformationVector* outputVector) override;
+
+private:
+  //! Distance under which two points are neighbors, in meters
+  double Epsilon = 0.5;
+
+  //! Number of neighbors, the point included, making a point a core point
+  int MinPts = 5;
+
+  //! Number of threads used by the clustering, 0 to use all the cores
+  unsigned int NumberOfThreads = 0;
+
+  //! Number of clusters found in the last output
+  int NumberOfClusters = 0;
+
+  vtkDBSCANClustering(const vtkDBSCANClustering&) = delete;
+  void operator=(const vtkDBSCANClustering&) = delete;
+};
+
+#endif // VTK_DBSCAN_CLUSTERING_H
@@ -0,0 +1,373 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// LOCAL
+#include "vtkDTMFilter.h"
+#include "ParallelFor.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// VTK
+#include <vtkFloatArray.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkUnsignedCharArray.h>
+
+// Implementation of the New function
+vtkStandardNewMacro(vtkDTMFilter)
+
+namespace {
+// Number of points gridded by a thread at a time
+const unsigned int PointChunkSize = 4096;
+// Number of rows smoothed by a thread at a time
+const unsigned int RowChunkSize = 16;
+// The surface is downsampled while both its dimensions are above this size
+const int MinimumPyramidSize = 100;
+
+//------------------------------------------------------------------------------
+// Row major raster of floats, kept contiguous so that the loops over the rows
+// are vectorized by the compiler
+struct Raster
+{
+  int Width = 0;
+  int Height = 0;
+  std::vector<float> Values;
+
+  Raster() = default;
+  Raster(int width, int height, float value)
+    : Width(width), Height(height), Values(static_cast<size_t>(width) * height, value) {}
+
+  float* Row(int y) { return this->Values.data() + static_cast<size_t>(y) * this->Width; }
+  const float* Row(int y) const { return this->Values.data() + static_cast<size_t>(y) * this->Width; }
+};
+
+//------------------------------------------------------------------------------
+// Take every other pixel
+Raster Downsample(const Raster& raster)
+{
+  Raster small((raster.Width + 1) / 2, (raster.Height + 1) / 2, 0.f);
+  for (int y = 0; y < small.Height; ++y)
+  {
+    const float* in = raster.Row(2 * y);
+    float* out = small.Row(y);
+    for (int x = 0; x < small.Width; ++x)
+    {
+      out[x] = in[2 * x];
+    }
+  }
+  return small;
+}
+
+//------------------------------------------------------------------------------
+// Duplicate each pixel into a block of 2x2 pixels of out
+void Upsample(const Raster& small, Raster& out)
+{
+  for (int y = 0; y < out.Height; ++y)
+  {
+    const float* in = small.Row(y / 2);
+    float* row = out.Row(y);
+    for (int x = 0; x < out.Width; ++x)
+    {
+      row[x] = in[x / 2];
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Inverted cloth draping on a surface whose missing cells are +inf
+class ClothDraping
+{
+public:
+  ClothDraping(int nbIterations, int nbTensionIterations, unsigned int nbThreads)
+    : NumberOfIterations(nbIterations)
+    , NumberOfTensionIterations(nbTensionIterations)
+    , NumberOfThreads(nbThreads) {}
+
+  // Multi-scale draping of the cloth dtm on the surface dsm: the cloth is first
+  // draped on the downsampled surface, which gives the initial cloth of the finer level
+  int RecursiveFit(Raster& dtm, const Raster& dsm, float step, int level) const
+  {
+    if (std::min(dtm.Width, dtm.Height) <= MinimumPyramidSize)
+    {
+      this->Drape(dtm, dsm, step, this->NumberOfIterations);
+      return level;
+    }
+
+    Raster smallDtm = Downsample(dtm);
+    const Raster smallDsm = Downsample(dsm);
+    const int maxLevel = this->RecursiveFit(smallDtm, smallDsm, step, level + 1);
+    Upsample(smallDtm, dtm);
+    // the step and the number of iterations decrease exponentially down the pyramid
+    const float factor = std::ldexp(1.f, maxLevel - level);
+    this->Drape(dtm, dsm, step / (2.f * factor),
+                std::max(1, static_cast<int>(this->NumberOfIterations / factor)));
+    return maxLevel;
+  }
+
+private:
+  void Drape(Raster& dtm, const Raster& dsm, float step, int nbIterations) const
+  {
+    // raising the missing cells by 0 keeps the loop free of branches
+    std::vector<float> raise(dsm.Values.size());
+    for (size_t i = 0; i < raise.size(); ++i)
+    {
+      raise[i] = std::isinf(dsm.Values[i]) ? 0.f : step;
+    }
+
+    Raster rowSums(dtm.Width, dtm.Height, 0.f);
+    for (int iteration = 0; iteration < nbIterations; ++iteration)
+    {
+      // inverted gravity
+      for (size_t i = 0; i < dtm.Values.size(); ++i)
+      {
+        dtm.Values[i] += raise[i];
+      }
+      for (int tension = 0; tension < this->NumberOfTensionIterations; ++tension)
+      {
+        // intersections with the surface, then spring tension
+        this->SnapAndBlur(dtm, dsm, rowSums);
+      }
+    }
+    for (size_t i = 0; i < dtm.Values.size(); ++i)
+    {
+      dtm.Values[i] = std::min(dtm.Values[i], dsm.Values[i]);
+    }
+  }
+
+  // dtm = 3x3 mean of min(dtm, dsm), the borders being repeated
+  void SnapAndBlur(Raster& dtm, const Raster& dsm, Raster& rowSums) const
+  {
+    const int width = dtm.Width;
+    const int height = dtm.Height;
+    // snap and sum along the rows
+    Parallel::ForEachChunk(height, RowChunkSize, this->NumberOfThreads,
+      [&](unsigned int, size_t begin, size_t end)
+    {
+      for (int y = begin; y < static_cast<int>(end); ++y)
+      {
+        float* row = dtm.Row(y);
+        const float* surface = dsm.Row(y);
+        for (int x = 0; x < width; ++x)
+        {
+          row[x] = std::min(row[x], surface[x]);
+        }
+        float* sums = rowSums.Row(y);
+        for (int x = 1; x < width - 1; ++x)
+        {
+          sums[x] = row[x - 1] + row[x] + row[x + 1];
+        }
+        sums[0] = 2.f * row[0] + row[std::min(1, width - 1)];
+        sums[width - 1] = 2.f * row[width - 1] + row[std::max(0, width - 2)];
+      }
+    });
+    // sum along the columns into dtm
+    Parallel::ForEachChunk(height, RowChunkSize, this->NumberOfThreads,
+      [&](unsigned int, size_t begin, size_t end)
+    {
+      for (int y = begin; y < static_cast<int>(end); ++y)
+      {
+        const float* previous = rowSums.Row(std::max(0, y - 1));
+        const float* current = rowSums.Row(y);
+        const float* next = rowSums.Row(std::min(height - 1, y + 1));
+        float* row = dtm.Row(y);
+        for (int x = 0; x < width; ++x)
+        {
+          row[x] = (previous[x] + current[x] + next[x]) * (1.f / 9.f);
+        }
+      }
+    });
+  }
+
+  const int NumberOfIterations;
+  const int NumberOfTensionIterations;
+  const unsigned int NumberOfThreads;
+};
+
+//------------------------------------------------------------------------------
+// Bilinear interpolation of the raster at the continuous pixel coordinates u, v
+float Interpolate(const Raster& raster, double u, double v)
+{
+  const int x0 = std::max(0, std::min(raster.Width - 1, static_cast<int>(std::floor(u))));
+  const int y0 = std::max(0, std::min(raster.Height - 1, static_cast<int>(std::floor(v))));
+  const int x1 = std::min(raster.Width - 1, x0 + 1);
+  const int y1 = std::min(raster.Height - 1, y0 + 1);
+  const float a = static_cast<float>(std::max(0., std::min(1., u - x0)));
+  const float b = static_cast<float>(std::max(0., std::min(1., v - y0)));
+  const float top = (1.f - a) * raster.Row(y0)[x0] + a * raster.Row(y0)[x1];
+  const float bottom = (1.f - a) * raster.Row(y1)[x0] + a * raster.Row(y1)[x1];
+  return (1.f - b) * top + b * bottom;
+}
+}
+
+//------------------------------------------------------------------------------
+vtkDTMFilter::vtkDTMFilter()
+{
+  this->SetNumberOfOutputPorts(2);
+}
+
+//------------------------------------------------------------------------------
+int vtkDTMFilter::FillInputPortInformation(int port, vtkInformation* info)
+{
+  if (port == 0)
+  {
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+    return 1;
+  }
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+int vtkDTMFilter::FillOutputPortInformation(int port, vtkInformation* info)
+{
+  if (port == 0)
+  {
+    info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkImageData");
+    return 1;
+  }
+  if (port == 1)
+  {
+    info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkPolyData");
+    return 1;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int vtkDTMFilter::RequestInformation(vtkInformation *vtkNotUsed(request),
+                                     vtkInformationVector **vtkNotUsed(inputVector),
+                                     vtkInformationVector *outputVector)
+{
+  if (this->Resolution[0] < 2 || this->Resolution[1] < 2)
+  {
+    vtkWarningMacro("Resolution must be at least 2x2, not " << this->Resolution[0] << "x" << this->Resolution[1] << ".")
+    return VTK_ERROR;
+  }
+
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(),
+               0, this->Resolution[0] - 1,
+               0, this->Resolution[1] - 1,
+               0, 0);
+  vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_FLOAT, 1);
+  return VTK_OK;
+}
+
+//------------------------------------------------------------------------------
+int vtkDTMFilter::RequestData(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector,
+  vtkInformationVector* outputVector)
+{
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
+  vtkImageData* outputImage = vtkImageData::GetData(outputVector->GetInformationObject(0));
+  vtkPolyData* outputPoints = vtkPolyData::GetData(outputVector->GetInformationObject(1));
+  outputPoints->ShallowCopy(input);
+
+  const unsigned int nbPoints = static_cast<unsigned int>(input->GetNumberOfPoints());
+  double bounds[6];
+  input->GetBounds(bounds);
+  if (nbPoints == 0 || bounds[1] <= bounds[0] || bounds[3] <= bounds[2])
+  {
+    vtkWarningMacro("The input point cloud is empty or flat.");
+    return VTK_OK;
+  }
+
+  // Cell of each point, the first and last cells are centered on the bounds
+  const int width = this->Resolution[0];
+  const int height = this->Resolution[1];
+  const double spacing[3] = { (bounds[1] - bounds[0]) / (width - 1),
+                              (bounds[3] - bounds[2]) / (height - 1),
+                              1. };
+  std::vector<int> cells(nbPoints);
+  Parallel::ForEachChunk(nbPoints, PointChunkSize, this->NumberOfThreads,
+    [&](unsigned int, size_t begin, size_t end)
+  {
+    double point[3];
+    for (unsigned int i = begin; i < end; ++i)
+    {
+      input->GetPoint(i, point);
+      const int x = static_cast<int>(std::lround((point[0] - bounds[0]) / spacing[0]));
+      const int y = static_cast<int>(std::lround((point[1] - bounds[2]) / spacing[1]));
+      cells[i] = std::max(0, std::min(width - 1, x)) + width * std::max(0, std::min(height - 1, y));
+    }
+  });
+
+  // Surface model with the lowest point of each cell, +inf where there is no point
+  Raster dsm(width, height, std::numeric_limits<float>::infinity());
+  for (unsigned int i = 0; i < nbPoints; ++i)
+  {
+    float& value = dsm.Values[cells[i]];
+    value = std::min(value, static_cast<float>(input->GetPoint(i)[2]));
+  }
+
+  // Drape the cloth from the lowest point up to the highest one
+  const float minHeight = static_cast<float>(bounds[4]);
+  const float maxHeight = static_cast<float>(bounds[5]);
+  Raster dtm(width, height, minHeight);
+  ClothDraping draping(this->NumberOfIterations, this->NumberOfTensionIterations, this->NumberOfThreads);
+  draping.RecursiveFit(dtm, dsm, (maxHeight - minHeight) / this->NumberOfIterations, 0);
+
+  // DTM image
+  outputImage->SetOrigin(bounds[0], bounds[2], 0.);
+  outputImage->SetSpacing(spacing);
+  outputImage->SetExtent(0, width - 1, 0, height - 1, 0, 0);
+  vtkNew<vtkFloatArray> dtmArray;
+  dtmArray->SetName("dtm");
+  dtmArray->SetNumberOfTuples(dtm.Values.size());
+  std::copy(dtm.Values.begin(), dtm.Values.end(), dtmArray->GetPointer(0));
+  outputImage->GetPointData()->SetScalars(dtmArray.GetPointer());
+  vtkNew<vtkFloatArray> dsmArray;
+  dsmArray->SetName("dsm");
+  dsmArray->SetNumberOfTuples(dsm.Values.size());
+  for (size_t i = 0; i < dsm.Values.size(); ++i)
+  {
+    dsmArray->SetValue(i, std::isinf(dsm.Values[i]) ? std::numeric_limits<float>::quiet_NaN()
+                                                    : dsm.Values[i]);
+  }
+  outputImage->GetPointData()->AddArray(dsmArray.GetPointer());
+
+  // Classified points
+  vtkNew<vtkUnsignedCharArray> groundArray;
+  groundArray->SetName("ground");
+  groundArray->SetNumberOfTuples(nbPoints);
+  vtkNew<vtkFloatArray> heightArray;
+  heightArray->SetName("height_above_ground");
+  heightArray->SetNumberOfTuples(nbPoints);
+  Parallel::ForEachChunk(nbPoints, PointChunkSize, this->NumberOfThreads,
+    [&](unsigned int, size_t begin, size_t end)
+  {
+    double point[3];
+    for (unsigned int i = begin; i < end; ++i)
+    {
+      input->GetPoint(i, point);
+      const float ground = Interpolate(dtm, (point[0] - bounds[0]) / spacing[0],
+                                       (point[1] - bounds[2]) / spacing[1]);
+      const float heightAboveGround = static_cast<float>(point[2]) - ground;
+      heightArray->SetValue(i, heightAboveGround);
+      groundArray->SetValue(i, heightAboveGround <= this->GroundThreshold ? 1 : 0);
+    }
+  });
+  outputPoints->GetPointData()->AddArray(groundArray.GetPointer());
+  outputPoints->GetPointData()->AddArray(heightArray.GetPointer());
+  return VTK_OK;
+}
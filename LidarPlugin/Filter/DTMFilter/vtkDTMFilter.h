@@ -0,0 +1,89 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VTK_DTM_FILTER_H
+#define VTK_DTM_FILTER_H
+
+// VTK
+#include <vtkImageAlgorithm.h>
+
+/**
+ * @brief vtkDTMFilter estimates the Digital Terrain Model (DTM) under a point cloud,
+ *        and classifies its points as ground or not.
+ *
+ * The points are gridded along the z axis into a Digital Surface Model holding the
+ * lowest height of each cell. An inverted cloth is then draped from below on this
+ * surface: at each iteration it is raised by a step, snapped back under the surface
+ * and smoothed by its tension, so that it stays under the buildings and the
+ * vegetation. As in python/lidarview/DTMFilter/DTM.py, which this filter replaces,
+ * the cloth is first draped on downsampled surfaces, coarse to fine.
+ *
+ * The first output is the DTM image, the second one is the input point cloud with
+ * a "ground" array set for the points which are less than GroundThreshold above
+ * the DTM.
+ */
+class VTK_EXPORT vtkDTMFilter : public vtkImageAlgorithm
+{
+public:
+  static vtkDTMFilter *New();
+  vtkTypeMacro(vtkDTMFilter, vtkImageAlgorithm)
+
+  vtkGetVector2Macro(Resolution, int)
+  vtkSetVector2Macro(Resolution, int)
+
+  vtkGetMacro(NumberOfIterations, int)
+  vtkSetClampMacro(NumberOfIterations, int, 1, VTK_INT_MAX)
+
+  vtkGetMacro(NumberOfTensionIterations, int)
+  vtkSetClampMacro(NumberOfTensionIterations, int, 1, VTK_INT_MAX)
+
+  vtkGetMacro(GroundThreshold, double)
+  vtkSetMacro(GroundThreshold, double)
+
+  vtkGetMacro(NumberOfThreads, unsigned int)
+  vtkSetMacro(NumberOfThreads, unsigned int)
+
+protected:
+  vtkDTMFilter();
+  ~vtkDTMFilter() = default;
+
+  int FillInputPortInformation(int port, vtkInformation *info) override;
+  int FillOutputPortInformation(int port, vtkInformation *info) override;
+  int RequestInformation(vtkInformation *request, vtkInformationVector **inputVector, vtkInformationVector *outputVector) override;
+  int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
+
+private:
+  vtkDTMFilter(const vtkDTMFilter&) = delete;
+  void operator=(const vtkDTMFilter&) = delete;
+
+  //! Number of cells of the grid along x and y, the cells size depends on the
+  //! bounds of the point cloud
+  int Resolution[2] = {500, 500};
+
+  //! Number of times the cloth is raised on the full resolution surface, the
+  //! downsampled ones use fewer iterations
+  int NumberOfIterations = 100;
+
+  //! Number of times the cloth is snapped and smoothed after each raise
+  int NumberOfTensionIterations = 10;
+
+  //! Maximum height above the DTM of a ground point, in meters
+  double GroundThreshold = 0.3;
+
+  //! Number of threads gridding the points and smoothing the cloth,
+  //! 0 to use all the cores
+  unsigned int NumberOfThreads = 0;
+};
+
+#endif // VTK_DTM_FILTER_H
@@ -0,0 +1,174 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "RingGroundSegmentation.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+// Number of columns classified by a thread at a time
+const size_t ColumnChunkSize = 8;
+// The points closer to the sensor are left out of the elevation of the lasers
+const float MinimumRange = 0.5f;
+
+//-----------------------------------------------------------------------------
+bool IsValid(const RingGroundSegmentation::Point& point)
+{
+  return point.Laser >= 0 && point.Range > 0.f && std::isfinite(point.Range) &&
+         std::isfinite(point.Z);
+}
+}
+
+//-----------------------------------------------------------------------------
+void RingGroundSegmentation::SetNumberOfColumns(int numberOfColumns)
+{
+  // a column is at least one hundredth of degree wide
+  this->NumberOfColumns = std::max(1, std::min(36000, numberOfColumns));
+}
+
+//-----------------------------------------------------------------------------
+void RingGroundSegmentation::ComputeRings(const std::vector<Point>& points)
+{
+  // the tangent of the elevation increases with it, and is cheaper to sum
+  const size_t nbLasers = this->Rings.size();
+  std::vector<double> sums(nbLasers, 0.0);
+  std::vector<size_t> counts(nbLasers, 0);
+  for (const Point& point : points)
+  {
+    if (IsValid(point) && point.Range >= MinimumRange)
+    {
+      sums[point.Laser] += point.Z / point.Range;
+      counts[point.Laser]++;
+    }
+  }
+
+  // the lasers without points come last
+  std::vector<int> lasers(nbLasers);
+  std::iota(lasers.begin(), lasers.end(), 0);
+  std::stable_sort(lasers.begin(), lasers.end(), [&](int a, int b)
+  {
+    if (counts[a] == 0 || counts[b] == 0)
+    {
+      return counts[a] != 0 && counts[b] == 0;
+    }
+    return sums[a] / counts[a] < sums[b] / counts[b];
+  });
+  for (size_t ring = 0; ring < nbLasers; ++ring)
+  {
+    this->Rings[lasers[ring]] = static_cast<int>(ring);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void RingGroundSegmentation::Segment(const std::vector<Point>& points,
+                                     std::vector<unsigned char>& isGround)
+{
+  const size_t nbPoints = points.size();
+  isGround.assign(nbPoints, 0);
+  int nbLasers = 0;
+  for (const Point& point : points)
+  {
+    nbLasers = std::max(nbLasers, point.Laser + 1);
+  }
+  if (nbLasers == 0)
+  {
+    return;
+  }
+  this->Rings.assign(nbLasers, 0);
+  this->ComputeRings(points);
+
+  // bucket the points by cell with a counting sort, the cells of a column being
+  // contiguous and ordered from the lowest laser to the highest one
+  const int nbColumns = this->NumberOfColumns;
+  const size_t nbCells = static_cast<size_t>(nbColumns) * nbLasers;
+  this->Cells.resize(nbPoints);
+  this->CellBegin.assign(nbCells + 1, 0);
+  for (size_t i = 0; i < nbPoints; ++i)
+  {
+    const Point& point = points[i];
+    if (!IsValid(point))
+    {
+      this->Cells[i] = -1;
+      continue;
+    }
+    const int column = std::max(0, std::min(nbColumns - 1,
+      static_cast<int>(static_cast<int64_t>(point.Azimuth) * nbColumns / 36000)));
+    this->Cells[i] = column * nbLasers + this->Rings[point.Laser];
+    this->CellBegin[this->Cells[i] + 1]++;
+  }
+  std::partial_sum(this->CellBegin.begin(), this->CellBegin.end(), this->CellBegin.begin());
+  this->SortedPoints.resize(this->CellBegin.back());
+  for (size_t i = 0; i < nbPoints; ++i)
+  {
+    if (this->Cells[i] >= 0)
+    {
+      this->SortedPoints[this->CellBegin[this->Cells[i]]++] = static_cast<uint32_t>(i);
+    }
+  }
+  // each cell now begins where the previous one did
+  std::copy_backward(this->CellBegin.begin(), this->CellBegin.end() - 1, this->CellBegin.end());
+  this->CellBegin[0] = 0;
+
+  // walk each column away from the sensor, following its ground
+  const float tanSlope = static_cast<float>(std::tan(this->MaxSlope * M_PI / 180.0));
+  const float threshold = static_cast<float>(this->HeightThreshold);
+  const float groundZ = static_cast<float>(-this->SensorHeight);
+  auto classifyColumn = [&](int column)
+  {
+    float refRange = 0.f;
+    float refZ = groundZ;
+    for (int ring = 0; ring < nbLasers; ++ring)
+    {
+      const size_t cell = static_cast<size_t>(column) * nbLasers + ring;
+      float sumRange = 0.f;
+      float sumZ = 0.f;
+      int nbGround = 0;
+      for (uint32_t k = this->CellBegin[cell]; k < this->CellBegin[cell + 1]; ++k)
+      {
+        const uint32_t index = this->SortedPoints[k];
+        const Point& point = points[index];
+        const float allowedStep = threshold + std::max(0.f, point.Range - refRange) * tanSlope;
+        const float allowedHeight = threshold + point.Range * tanSlope;
+        if (std::abs(point.Z - refZ) <= allowedStep && point.Z - groundZ <= allowedHeight)
+        {
+          isGround[index] = 1;
+          sumRange += point.Range;
+          sumZ += point.Z;
+          nbGround++;
+        }
+      }
+      if (nbGround > 0)
+      {
+        refRange = sumRange / nbGround;
+        refZ = sumZ / nbGround;
+      }
+    }
+  };
+
+  Parallel::ForEachChunk(nbColumns, ColumnChunkSize, this->NumberOfThreads,
+    [&](unsigned int, size_t begin, size_t end)
+  {
+    for (size_t column = begin; column < end; ++column)
+    {
+      classifyColumn(static_cast<int>(column));
+    }
+  });
+}
@@ -0,0 +1,106 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef RING_GROUND_SEGMENTATION_H
+#define RING_GROUND_SEGMENTATION_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * \class RingGroundSegmentation
+ * \brief Classify the points of a spinning lidar frame as ground or not, using the
+ *        scan rings instead of fitting planes.
+ *
+ * The points are split into columns of azimuth, and each column is walked from the
+ * lowest laser to the highest one, which follows the ground away from the sensor.
+ * A point is ground when the slope between it and the last ground point of its
+ * column is below MaxSlope, up to HeightThreshold, and when it is not above the cone
+ * of this slope starting at the ground under the sensor. The walk starts from the
+ * ground under the sensor, SensorHeight below it.
+ *
+ * The lasers are ordered by the mean elevation of their points in the frame, so no
+ * calibration is needed. The points are bucketed by column and laser with a counting
+ * sort and the columns are classified in parallel, which makes the whole
+ * segmentation linear in the number of points.
+ *
+ * The points are expected in the sensor frame, the z axis being vertical.
+ */
+class RingGroundSegmentation
+{
+public:
+  //! What the segmentation needs of a point
+  struct Point
+  {
+    //! horizontal distance to the sensor, in meters
+    float Range;
+    //! height relative to the sensor, in meters
+    float Z;
+    //! laser of the point, the points with a negative laser are not ground
+    int Laser;
+    //! in hundredths of degree, in [0, 36000[
+    int Azimuth;
+  };
+
+  /**
+   * @brief Classify the points
+   * @param points the points of a frame, in any order
+   * @param isGround set to 1 for the ground points and 0 for the others
+   */
+  void Segment(const std::vector<Point>& points, std::vector<unsigned char>& isGround);
+
+  //! Number of columns of azimuth the points are split into
+  int GetNumberOfColumns() const { return this->NumberOfColumns; }
+  void SetNumberOfColumns(int numberOfColumns);
+
+  //! Height of the sensor above the ground, in meters
+  double GetSensorHeight() const { return this->SensorHeight; }
+  void SetSensorHeight(double sensorHeight) { this->SensorHeight = sensorHeight; }
+
+  //! Maximum slope of the ground, in degrees
+  double GetMaxSlope() const { return this->MaxSlope; }
+  void SetMaxSlope(double maxSlope) { this->MaxSlope = maxSlope; }
+
+  //! Height difference allowed between ground points whatever their distance, in meters
+  double GetHeightThreshold() const { return this->HeightThreshold; }
+  void SetHeightThreshold(double heightThreshold) { this->HeightThreshold = heightThreshold; }
+
+  //! Number of threads classifying the columns, 0 to use all the cores
+  unsigned int GetNumberOfThreads() const { return this->NumberOfThreads; }
+  void SetNumberOfThreads(unsigned int numberOfThreads) { this->NumberOfThreads = numberOfThreads; }
+
+private:
+  //! Order the lasers by the mean elevation of their points, filling Rings
+  void ComputeRings(const std::vector<Point>& points);
+
+  int NumberOfColumns = 360;
+  double SensorHeight = 1.7;
+  double MaxSlope = 10.0;
+  double HeightThreshold = 0.15;
+  unsigned int NumberOfThreads = 0;
+
+  //! Rank of each laser from the lowest one, kept between frames to save allocations
+  std::vector<int> Rings;
+  //! First point of each cell (column, ring) in SortedPoints, and the end of the last one
+  std::vector<uint32_t> CellBegin;
+  //! Index of the points sorted by cell
+  std::vector<uint32_t> SortedPoints;
+  //! Cell of each point, -1 for the points left out
+  std::vector<int> Cells;
+};
+
+#endif // RING_GROUND_SEGMENTATION_H
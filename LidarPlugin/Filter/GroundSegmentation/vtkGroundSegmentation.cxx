@@ -0,0 +1,149 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// LOCAL
+#include "vtkGroundSegmentation.h"
+#include "ParallelFor.h"
+#include "vtkHelper.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// VTK
+#include <vtkDataArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkUnsignedCharArray.h>
+
+// Implementation of the New function
+vtkStandardNewMacro(vtkGroundSegmentation)
+
+namespace {
+// Number of points prepared by a thread at a time
+const size_t PointChunkSize = 16384;
+}
+
+//-----------------------------------------------------------------------------
+void vtkGroundSegmentation::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfColumns: " << this->GetNumberOfColumns() << std::endl;
+  os << indent << "SensorHeight: " << this->GetSensorHeight() << std::endl;
+  os << indent << "MaxSlope: " << this->GetMaxSlope() << std::endl;
+  os << indent << "HeightThreshold: " << this->GetHeightThreshold() << std::endl;
+  os << indent << "NumberOfThreads: " << this->GetNumberOfThreads() << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+void vtkGroundSegmentation::SetNumberOfColumns(int numberOfColumns)
+{
+  if (this->Segmentation.GetNumberOfColumns() != numberOfColumns)
+  {
+    this->Segmentation.SetNumberOfColumns(numberOfColumns);
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkGroundSegmentation::SetSensorHeight(double sensorHeight)
+{
+  if (this->Segmentation.GetSensorHeight() != sensorHeight)
+  {
+    this->Segmentation.SetSensorHeight(sensorHeight);
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkGroundSegmentation::SetMaxSlope(double maxSlope)
+{
+  if (this->Segmentation.GetMaxSlope() != maxSlope)
+  {
+    this->Segmentation.SetMaxSlope(maxSlope);
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkGroundSegmentation::SetHeightThreshold(double heightThreshold)
+{
+  if (this->Segmentation.GetHeightThreshold() != heightThreshold)
+  {
+    this->Segmentation.SetHeightThreshold(heightThreshold);
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkGroundSegmentation::SetNumberOfThreads(unsigned int numberOfThreads)
+{
+  if (this->Segmentation.GetNumberOfThreads() != numberOfThreads)
+  {
+    this->Segmentation.SetNumberOfThreads(numberOfThreads);
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkGroundSegmentation::RequestData(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector,
+  vtkInformationVector* outputVector)
+{
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
+  vtkPolyData* output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
+  output->ShallowCopy(input);
+
+  vtkDataArray* azimuth = input->GetPointData()->GetArray("azimuth");
+  vtkDataArray* laserIndex = input->GetPointData()->GetArray("laser_id");
+  if (!azimuth || !laserIndex)
+  {
+    vtkErrorMacro("The input polydata must contain azimuth angles and laser idx data!");
+    return 0;
+  }
+
+  // gather what the segmentation needs of the points, by chunks shared between the threads
+  const vtkIdType nbPoints = input->GetNumberOfPoints();
+  this->Points.resize(nbPoints);
+  const std::vector<int> laserIds = getComponentValues<int>(laserIndex);
+  const std::vector<int> azimuths = getComponentValues<int>(azimuth);
+  Parallel::ForEachChunk(nbPoints, PointChunkSize, this->GetNumberOfThreads(),
+    [&](unsigned int, size_t begin, size_t end)
+  {
+    double point[3];
+    for (size_t i = begin; i < end; ++i)
+    {
+      input->GetPoint(i, point);
+      RingGroundSegmentation::Point& segmentationPoint = this->Points[i];
+      segmentationPoint.Range = static_cast<float>(std::sqrt(point[0] * point[0] + point[1] * point[1]));
+      segmentationPoint.Z = static_cast<float>(point[2]);
+      segmentationPoint.Laser = laserIds[i];
+      segmentationPoint.Azimuth = azimuths[i];
+    }
+  });
+
+  this->Segmentation.Segment(this->Points, this->IsGround);
+
+  vtkNew<vtkUnsignedCharArray> groundArray;
+  groundArray->SetName("ground");
+  groundArray->SetNumberOfTuples(nbPoints);
+  std::copy(this->IsGround.begin(), this->IsGround.end(), groundArray->GetPointer(0));
+  output->GetPointData()->AddArray(groundArray.GetPointer());
+  return 1;
+}
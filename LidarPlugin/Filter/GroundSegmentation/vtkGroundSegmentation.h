@@ -0,0 +1,75 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VTK_GROUND_SEGMENTATION_H
+#define VTK_GROUND_SEGMENTATION_H
+
+// VTK
+#include <vtkPolyDataAlgorithm.h>
+
+// LOCAL
+#include "RingGroundSegmentation.h"
+
+/**
+ * @brief vtkGroundSegmentation classifies the points of a spinning lidar frame as
+ *        ground or not, fast enough to keep up with a live stream.
+ *
+ * Unlike vtkDTMFilter or a RANSAC plane fit, it uses the scan rings of the sensor,
+ * given by the "laser_id" and "azimuth" arrays of the frames of vtkLidarReader and
+ * vtkLidarStream: each column of azimuth is followed from the lowest laser to the
+ * highest one with a slope and height test, see RingGroundSegmentation.
+ *
+ * The output is the input point cloud with a "ground" array set for the ground
+ * points. The points are expected in the sensor frame, the z axis being vertical.
+ */
+class VTK_EXPORT vtkGroundSegmentation : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkGroundSegmentation *New();
+  vtkTypeMacro(vtkGroundSegmentation, vtkPolyDataAlgorithm)
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  int GetNumberOfColumns() { return this->Segmentation.GetNumberOfColumns(); }
+  void SetNumberOfColumns(int numberOfColumns);
+
+  double GetSensorHeight() { return this->Segmentation.GetSensorHeight(); }
+  void SetSensorHeight(double sensorHeight);
+
+  double GetMaxSlope() { return this->Segmentation.GetMaxSlope(); }
+  void SetMaxSlope(double maxSlope);
+
+  double GetHeightThreshold() { return this->Segmentation.GetHeightThreshold(); }
+  void SetHeightThreshold(double heightThreshold);
+
+  unsigned int GetNumberOfThreads() { return this->Segmentation.GetNumberOfThreads(); }
+  void SetNumberOfThreads(unsigned int numberOfThreads);
+
+protected:
+  vtkGroundSegmentation() = default;
+  ~vtkGroundSegmentation() = default;
+
+  int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
+
+private:
+  vtkGroundSegmentation(const vtkGroundSegmentation&) = delete;
+  void operator=(const vtkGroundSegmentation&) = delete;
+
+  //! Segmentation and its buffers, kept between the frames
+  RingGroundSegmentation Segmentation;
+  //! Points given to the segmentation, kept between the frames
+  std::vector<RingGroundSegmentation::Point> Points;
+  std::vector<unsigned char> IsGround;
+};
+
+#endif // VTK_GROUND_SEGMENTATION_H
@@ -18,16 +18,22 @@
 #include "vtkLaplacianInfilling.h"
 
 // STD
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <limits>
 #include <sstream>
 #include <cmath>
+#include <vector>
 
 // VTK
+#include <vtkDataArray.h>
 #include <vtkObjectFactory.h>
 #include <vtkImageData.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
 #include <vtkXMLImageDataWriter.h>
 
@@ -35,24 +41,19 @@
 #include <boost/algorithm/string.hpp>
 
 // Eigen
+#include <Eigen/Dense>
 #include <Eigen/Sparse>
 
 // Implementation of the New function
 vtkStandardNewMacro(vtkLaplacianInfilling)
 
+namespace {
 //-----------------------------------------------------------------------------
-int vtkLaplacianInfilling::RequestData(vtkInformation *vtkNotUsed(request),
-  vtkInformationVector **inputVector, vtkInformationVector *outputVector)
+// Historical formulation: every pixel is an unknown, the known pixels being
+// constrained to their value and the others to a null laplacian
+bool SolveAllPixels(int xBound, int yBound, const std::vector<double>& values,
+                    const std::vector<char>& known, std::vector<double>& result)
 {
-  // Get the input
-  vtkImageData * inputImage = vtkImageData::GetData(inputVector[0]->GetInformationObject(0));
-
-  // Get the output
-  vtkImageData* outputImage = vtkImageData::GetData(outputVector->GetInformationObject(0));
-  outputImage->ShallowCopy(inputImage);
-
-  int xBound = outputImage->GetDimensions()[0];
-  int yBound = outputImage->GetDimensions()[1];
   int nParams = xBound * yBound;
 
   Eigen::SparseMatrix<double> Laplacian(nParams, nParams);
@@ -60,6 +61,7 @@ int vtkLaplacianInfilling::RequestData(vtkInformation *vtkNotUsed(request),
 
   // Triplet of value: row, column and value
   std::vector<Eigen::Triplet<double> > nonZeroCoefficient;
+  nonZeroCoefficient.reserve(5 * nParams);
   for (int x = 0; x < xBound; ++x)
   {
     for (int y = 0; y < yBound; ++y)
@@ -67,13 +69,12 @@ int vtkLaplacianInfilling::RequestData(vtkInformation *vtkNotUsed(request),
       int flattenIndex = x + xBound * y;
 
       // check if the current pixel has a value
-      double value = inputImage->GetScalarComponentAsDouble(x, y, 0, 0);
-      if ((std::abs(value) > std::numeric_limits<double>::epsilon()))
+      if (known[flattenIndex])
       {
         // we don't want this value to be modified
         // contraint: xi = yi
         nonZeroCoefficient.push_back(Eigen::Triplet<double>(flattenIndex, flattenIndex, 1.0));
-        Y(flattenIndex) = value;
+        Y(flattenIndex) = values[flattenIndex];
       }
       else
       {
@@ -117,18 +118,503 @@ int vtkLaplacianInfilling::RequestData(vtkInformation *vtkNotUsed(request),
 
   // Solving:
   Eigen::SparseLU< Eigen::SparseMatrix<double> > solver(Laplacian);
-  Eigen::MatrixXd X = solver.solve(Y);
+  if (solver.info() != Eigen::Success)
+  {
+    return false;
+  }
+  Eigen::VectorXd X = solver.solve(Y);
+  result.assign(X.data(), X.data() + nParams);
+  return solver.info() == Eigen::Success;
+}
 
-  // X contains the Dirichlet solution function
-  // values i.e: 0-values pixel are filled with
-  // laplacian
-  for (int x = 0; x < xBound; ++x)
+//-----------------------------------------------------------------------------
+// System restricted to the missing pixels: for a missing pixel i with n
+// neighbors, n * xi - sum of its missing neighbors = sum of its known
+// neighbors. The matrix is symmetric, and positive definite when each group
+// of connected missing pixels touches a known one.
+struct MissingPixelsSystem
+{
+  //! Index of each pixel in the system, -1 for the known pixels
+  std::vector<int> Unknown;
+  //! Pixel of each unknown
+  std::vector<int> Pixel;
+  Eigen::SparseMatrix<double> A;
+  Eigen::VectorXd B;
+
+  MissingPixelsSystem(int xBound, int yBound, const std::vector<double>& values,
+                      const std::vector<char>& known)
   {
+    const int nPixels = xBound * yBound;
+    this->Unknown.assign(nPixels, -1);
+    for (int i = 0; i < nPixels; ++i)
+    {
+      if (!known[i])
+      {
+        this->Unknown[i] = static_cast<int>(this->Pixel.size());
+        this->Pixel.push_back(i);
+      }
+    }
+
+    const int n = static_cast<int>(this->Pixel.size());
+    std::vector<Eigen::Triplet<double> > coefficients;
+    coefficients.reserve(5 * n);
+    this->B = Eigen::VectorXd::Zero(n);
+    for (int k = 0; k < n; ++k)
+    {
+      const int i = this->Pixel[k];
+      const int x = i % xBound;
+      const int y = i / xBound;
+      const int neighbors[4] = {x != 0 ? i - 1 : -1,
+                                x != xBound - 1 ? i + 1 : -1,
+                                y != 0 ? i - xBound : -1,
+                                y != yBound - 1 ? i + xBound : -1};
+      int validNeigh = 0;
+      for (int j : neighbors)
+      {
+        if (j < 0)
+        {
+          continue;
+        }
+        validNeigh++;
+        if (known[j])
+        {
+          this->B(k) += values[j];
+        }
+        else
+        {
+          coefficients.push_back(Eigen::Triplet<double>(k, this->Unknown[j], -1.0));
+        }
+      }
+      coefficients.push_back(Eigen::Triplet<double>(k, k, static_cast<double>(validNeigh)));
+    }
+    this->A.resize(n, n);
+    this->A.setFromTriplets(coefficients.begin(), coefficients.end());
+  }
+
+  //! Copy the known values and the solution in result
+  void SetResult(const std::vector<double>& values, const Eigen::VectorXd& X,
+                 std::vector<double>& result) const
+  {
+    result = values;
+    for (size_t k = 0; k < this->Pixel.size(); ++k)
+    {
+      result[this->Pixel[k]] = X(k);
+    }
+  }
+};
+
+//-----------------------------------------------------------------------------
+// Level of the multigrid hierarchy, holding a symmetric 5-point operator:
+// (A e)_i = Diag_i e_i - W_i e_i-1 - W_i+1 e_i+1 - S_i e_i-nx - S_i+nx e_i+nx
+// where W_i (resp. S_i) couples a cell with its west (resp. south) neighbor.
+// The finest level is the grid of the pixels, the known pixels being
+// decoupled with a unit diagonal so that their correction stays null.
+struct MultigridLevel
+{
+  int Nx = 0;
+  int Ny = 0;
+  std::vector<double> Diag, W, S;
+  std::vector<double> E, Rhs, Residual;
+
+  void Resize(int nx, int ny)
+  {
+    this->Nx = nx;
+    this->Ny = ny;
+    const size_t n = static_cast<size_t>(nx) * ny;
+    this->Diag.assign(n, 0.0);
+    this->W.assign(n, 0.0);
+    this->S.assign(n, 0.0);
+    this->E.assign(n, 0.0);
+    this->Rhs.assign(n, 0.0);
+    this->Residual.assign(n, 0.0);
+  }
+
+  //! Sum of the off diagonal terms of the row i applied to v, with their sign flipped
+  double Neighbors(int i, int x, int y, const std::vector<double>& v) const
+  {
+    double sum = 0.0;
+    if (x > 0)
+    {
+      sum += this->W[i] * v[i - 1];
+    }
+    if (x < this->Nx - 1)
+    {
+      sum += this->W[i + 1] * v[i + 1];
+    }
+    if (y > 0)
+    {
+      sum += this->S[i] * v[i - this->Nx];
+    }
+    if (y < this->Ny - 1)
+    {
+      sum += this->S[i + this->Nx] * v[i + this->Nx];
+    }
+    return sum;
+  }
+
+  //! Gauss-Seidel sweep, in lexicographic order or in reverse order
+  void Smooth(bool forward)
+  {
+    const int n = this->Nx * this->Ny;
+    for (int k = 0; k < n; ++k)
+    {
+      const int i = forward ? k : n - 1 - k;
+      this->E[i] = (this->Rhs[i] + this->Neighbors(i, i % this->Nx, i / this->Nx, this->E)) / this->Diag[i];
+    }
+  }
+
+  void ComputeResidual()
+  {
+    const int n = this->Nx * this->Ny;
+    for (int i = 0; i < n; ++i)
+    {
+      this->Residual[i] = this->Rhs[i] - this->Diag[i] * this->E[i]
+                        + this->Neighbors(i, i % this->Nx, i / this->Nx, this->E);
+    }
+  }
+};
+
+//-----------------------------------------------------------------------------
+// Conjugate gradient preconditioned by a symmetric multigrid V-cycle over the
+// regular grid. The cells are aggregated by blocks of 2x2 and the coarse
+// operators are the Galerkin products P^T A P with the piecewise constant
+// prolongation P, which keeps the 5-point structure and accounts for the
+// known pixels without special cases.
+class MultigridSolver
+{
+public:
+  MultigridSolver(int xBound, int yBound, const std::vector<char>& known)
+  {
+    // finest level
+    this->Levels.emplace_back();
+    MultigridLevel& fine = this->Levels.back();
+    fine.Resize(xBound, yBound);
     for (int y = 0; y < yBound; ++y)
     {
-      int flattendIndex = x + xBound * y;
-      outputImage->SetScalarComponentFromDouble(x, y, 0, 0, X(flattendIndex));
+      for (int x = 0; x < xBound; ++x)
+      {
+        const int i = x + xBound * y;
+        if (known[i])
+        {
+          fine.Diag[i] = 1.0;
+          continue;
+        }
+        fine.Diag[i] = (x > 0) + (x < xBound - 1) + (y > 0) + (y < yBound - 1);
+        fine.W[i] = (x > 0 && !known[i - 1]) ? 1.0 : 0.0;
+        fine.S[i] = (y > 0 && !known[i - xBound]) ? 1.0 : 0.0;
+      }
+    }
+
+    // coarse levels, down to a grid small enough to be solved directly
+    while (this->Levels.back().Nx * this->Levels.back().Ny > MaxCoarsestCells)
+    {
+      this->Levels.emplace_back();
+      this->Coarsen(this->Levels[this->Levels.size() - 2], this->Levels.back());
+    }
+
+    // factorize the coarsest level
+    const MultigridLevel& coarsest = this->Levels.back();
+    const int n = coarsest.Nx * coarsest.Ny;
+    Eigen::MatrixXd A = Eigen::MatrixXd::Zero(n, n);
+    for (int i = 0; i < n; ++i)
+    {
+      const int x = i % coarsest.Nx;
+      A(i, i) = coarsest.Diag[i];
+      if (x > 0)
+      {
+        A(i, i - 1) = A(i - 1, i) = -coarsest.W[i];
+      }
+      if (i >= coarsest.Nx)
+      {
+        A(i, i - coarsest.Nx) = A(i - coarsest.Nx, i) = -coarsest.S[i];
+      }
+    }
+    this->CoarsestSolver.compute(A);
+  }
+
+  //! Solve A x = b over the pixels, x holding the initial guess.
+  //! Return true if the relative residual is below the tolerance.
+  bool Solve(const std::vector<double>& b, std::vector<double>& x,
+             double tolerance, int maxIterations, int& iterations, double& error)
+  {
+    const size_t n = b.size();
+    std::vector<double> r(n), z(n), p(n), q(n);
+
+    this->Apply(x, q);
+    double normB = 0.0, normR = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+      r[i] = b[i] - q[i];
+      normB += b[i] * b[i];
+      normR += r[i] * r[i];
+    }
+    normB = std::sqrt(normB);
+    if (normB == 0.0)
+    {
+      std::fill(x.begin(), x.end(), 0.0);
+      iterations = 0;
+      error = 0.0;
+      return true;
+    }
+
+    this->Precondition(r, z);
+    p = z;
+    double rz = Dot(r, z);
+    for (iterations = 0; iterations < maxIterations; ++iterations)
+    {
+      error = std::sqrt(normR) / normB;
+      if (error < tolerance)
+      {
+        return true;
+      }
+      this->Apply(p, q);
+      const double alpha = rz / Dot(p, q);
+      normR = 0.0;
+      for (size_t i = 0; i < n; ++i)
+      {
+        x[i] += alpha * p[i];
+        r[i] -= alpha * q[i];
+        normR += r[i] * r[i];
+      }
+      this->Precondition(r, z);
+      const double rzNext = Dot(r, z);
+      const double beta = rzNext / rz;
+      rz = rzNext;
+      for (size_t i = 0; i < n; ++i)
+      {
+        p[i] = z[i] + beta * p[i];
+      }
+    }
+    error = std::sqrt(normR) / normB;
+    return error < tolerance;
+  }
+
+private:
+  static double Dot(const std::vector<double>& a, const std::vector<double>& b)
+  {
+    double sum = 0.0;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+      sum += a[i] * b[i];
     }
+    return sum;
+  }
+
+  //! q = A v on the finest level
+  void Apply(const std::vector<double>& v, std::vector<double>& q) const
+  {
+    const MultigridLevel& fine = this->Levels.front();
+    for (int i = 0; i < fine.Nx * fine.Ny; ++i)
+    {
+      q[i] = fine.Diag[i] * v[i] - fine.Neighbors(i, i % fine.Nx, i / fine.Nx, v);
+    }
+  }
+
+  //! z = M^-1 r with a V-cycle from a null guess
+  void Precondition(const std::vector<double>& r, std::vector<double>& z)
+  {
+    MultigridLevel& fine = this->Levels.front();
+    fine.Rhs = r;
+    this->VCycle(0);
+    z = fine.E;
+  }
+
+  //! V-cycle from a null guess, with symmetric pre and post smoothing
+  void VCycle(size_t l)
+  {
+    MultigridLevel& level = this->Levels[l];
+    std::fill(level.E.begin(), level.E.end(), 0.0);
+    if (l + 1 == this->Levels.size())
+    {
+      Eigen::Map<const Eigen::VectorXd> rhs(level.Rhs.data(), level.Rhs.size());
+      Eigen::Map<Eigen::VectorXd>(level.E.data(), level.E.size()) = this->CoarsestSolver.solve(rhs);
+      return;
+    }
+
+    level.Smooth(true);
+    level.ComputeResidual();
+
+    // restriction with P^T: sum of the residuals of the children
+    MultigridLevel& coarse = this->Levels[l + 1];
+    std::fill(coarse.Rhs.begin(), coarse.Rhs.end(), 0.0);
+    for (int i = 0; i < level.Nx * level.Ny; ++i)
+    {
+      coarse.Rhs[(i % level.Nx) / 2 + coarse.Nx * ((i / level.Nx) / 2)] += level.Residual[i];
+    }
+    this->VCycle(l + 1);
+
+    // piecewise constant prolongation of the correction
+    for (int i = 0; i < level.Nx * level.Ny; ++i)
+    {
+      level.E[i] += coarse.E[(i % level.Nx) / 2 + coarse.Nx * ((i / level.Nx) / 2)];
+    }
+    level.Smooth(false);
+  }
+
+  //! Galerkin product of the fine operator with the 2x2 aggregation
+  void Coarsen(const MultigridLevel& fine, MultigridLevel& coarse)
+  {
+    coarse.Resize((fine.Nx + 1) / 2, (fine.Ny + 1) / 2);
+    for (int y = 0; y < fine.Ny; ++y)
+    {
+      for (int x = 0; x < fine.Nx; ++x)
+      {
+        const int i = x + fine.Nx * y;
+        const int c = x / 2 + coarse.Nx * (y / 2);
+        coarse.Diag[c] += fine.Diag[i];
+        if (x > 0)
+        {
+          // the coupling is internal to the aggregate or links it to its west neighbor
+          if (x % 2 == 1)
+          {
+            coarse.Diag[c] -= 2.0 * fine.W[i];
+          }
+          else
+          {
+            coarse.W[c] += fine.W[i];
+          }
+        }
+        if (y > 0)
+        {
+          if (y % 2 == 1)
+          {
+            coarse.Diag[c] -= 2.0 * fine.S[i];
+          }
+          else
+          {
+            coarse.S[c] += fine.S[i];
+          }
+        }
+      }
+    }
+
+    // an aggregate covering a whole group of missing pixels without any known
+    // neighbor has a null row, keep it out of the smoothing
+    for (double& diag : coarse.Diag)
+    {
+      if (diag <= 0.0)
+      {
+        diag = 1.0;
+      }
+    }
+  }
+
+  //! Number of cells under which a level is solved directly
+  static const int MaxCoarsestCells = 64;
+
+  std::vector<MultigridLevel> Levels;
+  Eigen::LDLT<Eigen::MatrixXd> CoarsestSolver;
+};
+}
+
+//-----------------------------------------------------------------------------
+int vtkLaplacianInfilling::RequestData(vtkInformation *vtkNotUsed(request),
+  vtkInformationVector **inputVector, vtkInformationVector *outputVector)
+{
+  // Get the input
+  vtkImageData * inputImage = vtkImageData::GetData(inputVector[0]->GetInformationObject(0));
+
+  // Get the output, with its own scalars to not modify the input ones
+  vtkImageData* outputImage = vtkImageData::GetData(outputVector->GetInformationObject(0));
+  outputImage->ShallowCopy(inputImage);
+  vtkDataArray* inputScalars = inputImage->GetPointData()->GetScalars();
+  if (!inputScalars)
+  {
+    vtkErrorMacro("The input image has no scalars");
+    return 0;
+  }
+  vtkSmartPointer<vtkDataArray> outputScalars;
+  outputScalars.TakeReference(inputScalars->NewInstance());
+  outputScalars->DeepCopy(inputScalars);
+  outputImage->GetPointData()->SetScalars(outputScalars);
+
+  int xBound = outputImage->GetDimensions()[0];
+  int yBound = outputImage->GetDimensions()[1];
+  int nParams = xBound * yBound;
+
+  // Values of the pixels, the ones without value being missing
+  std::vector<double> values(nParams);
+  std::vector<char> known(nParams);
+  int nKnown = 0;
+  for (int i = 0; i < nParams; ++i)
+  {
+    values[i] = inputScalars->GetComponent(i, 0);
+    known[i] = std::abs(values[i]) > std::numeric_limits<double>::epsilon();
+    nKnown += known[i];
+  }
+  if (nKnown == 0 || nKnown == nParams)
+  {
+    return 1;
+  }
+
+  // Fill the missing pixels with the Dirichlet solution function
+  std::vector<double> result;
+  bool solved = false;
+  if (this->SolverType == vtkLaplacianInfilling::SparseLU && !this->SolveMissingPixelsOnly)
+  {
+    solved = SolveAllPixels(xBound, yBound, values, known, result);
+  }
+  else if (this->SolverType == vtkLaplacianInfilling::SparseLU)
+  {
+    MissingPixelsSystem system(xBound, yBound, values, known);
+    Eigen::SparseLU< Eigen::SparseMatrix<double> > solver(system.A);
+    Eigen::VectorXd X = solver.solve(system.B);
+    solved = solver.info() == Eigen::Success;
+    system.SetResult(values, X, result);
+  }
+  else if (this->SolverType == vtkLaplacianInfilling::ConjugateGradient)
+  {
+    MissingPixelsSystem system(xBound, yBound, values, known);
+    Eigen::ConjugateGradient<Eigen::SparseMatrix<double>, Eigen::Lower | Eigen::Upper,
+                             Eigen::IncompleteCholesky<double> > solver;
+    solver.setTolerance(this->Tolerance);
+    solver.setMaxIterations(this->MaxIterations);
+    solver.compute(system.A);
+    Eigen::VectorXd X = solver.solve(system.B);
+    solved = solver.info() == Eigen::Success;
+    system.SetResult(values, X, result);
+    vtkDebugMacro("Conjugate gradient: " << solver.iterations() << " iterations, error "
+                  << solver.error());
+  }
+  else
+  {
+    // the right hand side of a missing pixel is the sum of its
+    // known neighbors, and the known pixels keep their value
+    std::vector<double> b(nParams, 0.0);
+    result.assign(nParams, 0.0);
+    for (int i = 0; i < nParams; ++i)
+    {
+      if (known[i])
+      {
+        b[i] = result[i] = values[i];
+        continue;
+      }
+      const int x = i % xBound;
+      const int y = i / xBound;
+      b[i] += (x > 0 && known[i - 1]) ? values[i - 1] : 0.0;
+      b[i] += (x < xBound - 1 && known[i + 1]) ? values[i + 1] : 0.0;
+      b[i] += (y > 0 && known[i - xBound]) ? values[i - xBound] : 0.0;
+      b[i] += (y < yBound - 1 && known[i + xBound]) ? values[i + xBound] : 0.0;
+    }
+    MultigridSolver solver(xBound, yBound, known);
+    int iterations = 0;
+    double error = 0.0;
+    solved = solver.Solve(b, result, this->Tolerance, this->MaxIterations, iterations, error);
+    vtkDebugMacro("Multigrid: " << iterations << " iterations, error " << error);
+  }
+
+  if (!solved)
+  {
+    vtkWarningMacro("The infilling did not converge, the missing pixels may be wrong");
+  }
+  if (result.size() != static_cast<size_t>(nParams))
+  {
+    return 1;
+  }
+
+  for (int i = 0; i < nParams; ++i)
+  {
+    outputScalars->SetComponent(i, 0, result[i]);
   }
 
   return 1;
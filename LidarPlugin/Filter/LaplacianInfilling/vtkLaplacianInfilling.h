@@ -30,6 +30,24 @@ public:
   static vtkLaplacianInfilling *New();
   vtkTypeMacro(vtkLaplacianInfilling, vtkImageAlgorithm)
 
+  enum Solver {
+    SparseLU = 0,          // direct factorization
+    ConjugateGradient,     // incomplete Cholesky preconditioned conjugate gradient
+    Multigrid              // conjugate gradient preconditioned by a multigrid V-cycle
+  };
+
+  vtkGetMacro(SolverType, int)
+  vtkSetMacro(SolverType, int)
+
+  vtkGetMacro(SolveMissingPixelsOnly, bool)
+  vtkSetMacro(SolveMissingPixelsOnly, bool)
+
+  vtkGetMacro(Tolerance, double)
+  vtkSetMacro(Tolerance, double)
+
+  vtkGetMacro(MaxIterations, int)
+  vtkSetMacro(MaxIterations, int)
+
 protected:
   vtkLaplacianInfilling() = default;
   ~vtkLaplacianInfilling() = default;
@@ -39,6 +57,20 @@ protected:
 private:
   vtkLaplacianInfilling(const vtkLaplacianInfilling&) = delete;
   void operator=(const vtkLaplacianInfilling&) = delete;
+
+  //! Solver used to fill the missing pixels, see Solver
+  int SolverType = SparseLU;
+
+  //! With the direct solver, only put the missing pixels in the system, the
+  //! known ones giving its Dirichlet boundary. Otherwise every pixel is an
+  //! unknown. The iterative solvers always solve over the missing pixels.
+  bool SolveMissingPixelsOnly = true;
+
+  //! Relative residual at which the iterative solvers stop
+  double Tolerance = 1e-6;
+
+  //! Maximum number of iterations of the iterative solvers
+  int MaxIterations = 1000;
 };
 
 #endif // VTK_LAPLACIAN_INFILLING_H
@@ -15,6 +15,8 @@
 
 // LOCAL
 #include "vtkLidarRawSignalImage.h"
+#include "ParallelFor.h"
+#include "vtkHelper.h"
 
 #include <vtkObjectFactory.h>
 #include <vtkImageData.h>
@@ -25,6 +27,28 @@
 #include <vtkStreamingDemandDrivenPipeline.h>
 #include <vtkTable.h>
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+//-----------------------------------------------------------------------------
+// Write the first component of the value of each point into its pixel,
+// the points whose pixel is -1 being outside of the image
+template <typename T>
+void FillPixels(const T* values, int nbComponents, const std::vector<int>& pixels,
+                unsigned char* image)
+{
+  for (size_t i = 0; i < pixels.size(); ++i, values += nbComponents)
+  {
+    if (pixels[i] >= 0)
+    {
+      image[pixels[i]] = static_cast<unsigned char>(*values);
+    }
+  }
+}
+}
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkLidarRawSignalImage)
 
@@ -49,6 +73,7 @@ void vtkLidarRawSignalImage::PrintSelf(ostream& os, vtkIndent indent)
   PrintParameter(Origin[0])
   PrintParameter(Origin[1])
   PrintParameter(Origin[2])
+  PrintParameter(NumberOfThreads)
 
 }
 
@@ -76,13 +101,16 @@ int vtkLidarRawSignalImage::RequestData(vtkInformation *vtkNotUsed(request),
   vtkPolyData * input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
   vtkTable* calibration = vtkTable::GetData(inputVector[1]->GetInformationObject(0));
 
-  // Initialize the filter using the provided sensor calibration table
-  if (this->VerticallySortedIndex.size() == 0)
+  // Initialize the filter using the provided sensor calibration table,
+  // the mapping being kept until the calibration changes
+  if (!calibration || this->VerticallySortedIndex.empty() ||
+      calibration->GetMTime() != this->CalibrationTime)
   {
     if (!this->InitializationFromCalibration(calibration))
     {
       return VTK_ERROR;
     }
+    this->CalibrationTime = calibration->GetMTime();
   }
 
   // Set the spacing according to the angles FoV.
@@ -118,30 +146,49 @@ int vtkLidarRawSignalImage::RequestData(vtkInformation *vtkNotUsed(request),
     return 0;
   }
 
-  // Project each point one by one into the image
-  for (unsigned int indexPoint = 0; indexPoint < input->GetNumberOfPoints(); ++indexPoint)
+  // compute the pixel of each point, by blocks shared between the threads
+  const vtkIdType numPoints = input->GetNumberOfPoints();
+  const std::vector<double> azimuths = getComponentValues<double>(azimuth);
+  const std::vector<double> laserIds = getComponentValues<double>(laserIndex);
+  std::vector<int> pixels(numPoints);
+  auto computePixels = [&](vtkIdType begin, vtkIdType end)
+  {
+    const int nbLasers = static_cast<int>(this->VerticallySortedIndex.size());
+    for (vtkIdType indexPoint = begin; indexPoint < end; ++indexPoint)
+    {
+      // compute w coordinate of the image based
+      // on the azimuth angle
+      double azimuthAngle = azimuths[indexPoint];
+      int w = std::floor(azimuthAngle / 36000.0 * this->Width);
+
+      // compute the h coordinate of the image based
+      // on the vertically sorted laser index
+      // /!\ the spherical grid is then based on the
+      // laser index which means that the solid angle
+      // represented by a "pixel" will depend on the angular
+      // resolution between two consecutives laser. For example,
+      // a VLS-128 has a non constant vertical angular resolution
+      // resulting in an observed image distorded
+      int idx = static_cast<int>(laserIds[indexPoint]);
+      if (w < 0 || w >= this->Width || idx < 0 || idx >= nbLasers)
+      {
+        pixels[indexPoint] = -1;
+        continue;
+      }
+      int h = this->VerticallySortedIndex[idx];
+      pixels[indexPoint] = h * this->Width + w;
+    }
+  };
+  const size_t blockSize = 16384;
+  Parallel::ForEachChunk(numPoints, blockSize, std::max(0, this->NumberOfThreads),
+    [&](unsigned int, size_t begin, size_t end) { computePixels(begin, end); });
+
+  // write the values in the order of the points, so that the
+  // last point of a pixel gives its value
+  switch (arrayToUse->GetDataType())
   {
-    // Get the coordinate of the input point
-    double currPoint[3];
-    input->GetPoint(indexPoint, currPoint);
-
-    // compute w coordinate of the image based
-    // on the azimuth angle
-    double azimuthAngle = azimuth->GetTuple1(indexPoint);
-    int w = std::floor(azimuthAngle / 36000.0 * this->Width);
-
-    // compute the h coordinate of the image based
-    // on the vertically sorted laser index
-    // /!\ the spherical grid is then based on the
-    // laser index which means that the solid angle
-    // represented by a "pixel" will depend on the angular
-    // resolution between two consecutives laser. For example,
-    // a VLS-128 has a non constant vertical angular resolution
-    // resulting in an observed image distorded
-    int idx = laserIndex->GetTuple1(indexPoint);
-    int h = this->VerticallySortedIndex[idx];
-    double value = arrayToUse->GetTuple1(indexPoint);
-    outputImage->SetScalarComponentFromDouble(w, h, 0, 0, value);
+    vtkTemplateMacro(FillPixels(static_cast<const VTK_TT*>(arrayToUse->GetVoidPointer(0)),
+                                arrayToUse->GetNumberOfComponents(), pixels, dataPointer));
   }
 
   return VTK_OK;
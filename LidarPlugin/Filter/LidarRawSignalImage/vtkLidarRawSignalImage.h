@@ -59,6 +59,12 @@ public:
   vtkSetMacro(Scale, double)
   //! @}
 
+  //! @{
+  //! @copydoc NumberOfThreads
+  vtkGetMacro(NumberOfThreads, int)
+  vtkSetMacro(NumberOfThreads, int)
+  //! @}
+
 protected:
   vtkLidarRawSignalImage();
   int FillInputPortInformation(int port, vtkInformation *info) override;
@@ -73,6 +79,8 @@ protected:
   // from firing index to vertical
   // ordered index
   std::vector<int> VerticallySortedIndex;
+  //! Modification time of the calibration used to fill VerticallySortedIndex
+  vtkMTimeType CalibrationTime = 0;
 
   double VerticalFOV = 30.0;
   double HorizontalFOV = 360.0;
@@ -89,6 +97,8 @@ protected:
   double Origin[3] = {0,0,0};
   ///! Scale of the image
   double Scale = 1.0;
+  //! Number of threads computing the pixels of the points, 0 to use all the cores
+  int NumberOfThreads = 0;
 
 private:
   vtkLidarRawSignalImage(const vtkLidarRawSignalImage&) = delete;
@@ -26,27 +26,73 @@
 #include <vtkSmartPointer.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
+#include <vtkDataArray.h>
 
 // STD
+#include <algorithm>
 #include <iostream>
 
 // Implementation of the New function
 vtkStandardNewMacro(vtkMLSPosesSmoothing)
 
+//-----------------------------------------------------------------------------
+vtkMLSPosesSmoothing::vtkMLSPosesSmoothing() = default;
+
+//-----------------------------------------------------------------------------
+vtkMLSPosesSmoothing::~vtkMLSPosesSmoothing() = default;
+
 //-----------------------------------------------------------------------------
 int vtkMLSPosesSmoothing::RequestData(vtkInformation *vtkNotUsed(request),
   vtkInformationVector **inputVector, vtkInformationVector *outputVector)
 {
   // Get input data
   vtkPolyData* input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
+  vtkPolyData *output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
 
   // Smooth the poses data using a MLS (moving least square)
   vtkSmartPointer<vtkTemporalTransforms> toSmoothed = vtkTemporalTransforms::CreateFromPolyData(input);
-  vtkSmartPointer<vtkTemporalTransforms> smoothed = toSmoothed->MLSSmoothing(this->PolyDeg, this->KernelSize);
+  if (!this->StreamingMode)
+  {
+    this->FinalPoses = nullptr;
+    vtkSmartPointer<vtkTemporalTransforms> smoothed =
+        toSmoothed->MLSSmoothing(this->PolyDeg, this->KernelSize, this->NumberOfThreads);
+    output->ShallowCopy(smoothed);
+    return 1;
+  }
 
-  // Get the output
-  vtkPolyData *output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
-  output->ShallowCopy(smoothed);
+  // The poses closer than KernelSize to the end of the input can still change
+  // when new poses are appended, the other ones are final
+  const vtkIdType nbPoses = toSmoothed->GetNumberOfPoints();
+  const vtkIdType nbFinal = std::max(nbPoses - this->KernelSize, static_cast<vtkIdType>(0));
+
+  // Start again if the parameters changed or if the input is not the
+  // continuation of the previous one
+  vtkIdType nbDone = this->FinalPoses ? this->FinalPoses->GetNumberOfPoints() : 0;
+  if (!this->FinalPoses || this->FinalPolyDeg != this->PolyDeg ||
+      this->FinalKernelSize != this->KernelSize || nbDone > nbFinal ||
+      (nbDone > 0 && this->FinalPoses->GetTimeArray()->GetTuple1(nbDone - 1) !=
+                     toSmoothed->GetTimeArray()->GetTuple1(nbDone - 1)))
+  {
+    this->FinalPoses = vtkSmartPointer<vtkTemporalTransforms>::New();
+    this->FinalPolyDeg = this->PolyDeg;
+    this->FinalKernelSize = this->KernelSize;
+    nbDone = 0;
+  }
+
+  // Only smooth the poses that became final since the last update
+  vtkSmartPointer<vtkTemporalTransforms> smoothed =
+      toSmoothed->MLSSmoothing(this->PolyDeg, this->KernelSize, nbDone, nbFinal, this->NumberOfThreads);
+  vtkDataArray* orientations = smoothed->GetOrientationArray();
+  for (vtkIdType k = 0; k < smoothed->GetNumberOfPoints(); ++k)
+  {
+    double* xyzw = orientations->GetTuple4(k);
+    double pos[3];
+    smoothed->GetPoint(k, pos);
+    this->FinalPoses->PushBack(smoothed->GetTimeArray()->GetTuple1(k),
+                               Eigen::AngleAxisd(xyzw[3], Eigen::Vector3d(xyzw[0], xyzw[1], xyzw[2])),
+                               Eigen::Vector3d(pos[0], pos[1], pos[2]));
+  }
 
+  output->DeepCopy(this->FinalPoses);
   return 1;
 }
@@ -22,6 +22,9 @@
 
 // VTK
 #include <vtkPolyDataAlgorithm.h>
+#include <vtkSmartPointer.h>
+
+class vtkTemporalTransforms;
 
 class VTK_EXPORT vtkMLSPosesSmoothing : public vtkPolyDataAlgorithm
 {
@@ -35,8 +38,15 @@ public:
   vtkGetMacro(KernelSize, int)
   vtkSetMacro(KernelSize, int)
 
+  vtkGetMacro(NumberOfThreads, unsigned int)
+  vtkSetMacro(NumberOfThreads, unsigned int)
+
+  vtkGetMacro(StreamingMode, bool)
+  vtkSetMacro(StreamingMode, bool)
+
 protected:
-  vtkMLSPosesSmoothing() = default;
+  vtkMLSPosesSmoothing();
+  ~vtkMLSPosesSmoothing();
 
   int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
 
@@ -46,6 +56,20 @@ protected:
 
   //! Size of the kernel rectangular function used
   int KernelSize = 10;
+
+  //! Number of threads used to smooth the poses, 0 to use all the cores
+  unsigned int NumberOfThreads = 0;
+
+  //! Only output the poses that are far enough from the end of the input to
+  //! not change anymore, and only smooth the ones that appeared since the
+  //! last update. This is meant for a growing input, like the trajectory of
+  //! a running SLAM, and delays the output by KernelSize poses.
+  bool StreamingMode = false;
+
+  //! Poses already smoothed in streaming mode, and the parameters used
+  vtkSmartPointer<vtkTemporalTransforms> FinalPoses;
+  int FinalPolyDeg = -1;
+  int FinalKernelSize = -1;
 private:
   vtkMLSPosesSmoothing(const vtkMLSPosesSmoothing&) = delete;
   void operator=(const vtkMLSPosesSmoothing&) = delete;
@@ -52,6 +52,7 @@
 #include <vtkPolyLine.h>
 #include <vtkSmartPointer.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkTable.h>
 #include <vtkQuaternion.h>
 #include <vtkUnsignedCharArray.h>
 #include <vtkUnsignedShortArray.h>
@@ -70,8 +71,8 @@ vtkStandardNewMacro(vtkMotionDetector)
 //----------------------------------------------------------------------------
 vtkMotionDetector::vtkMotionDetector()
 {
-  // One input port
-  this->SetNumberOfInputPorts(1);
+  // The frames and the optional calibration of the sensor
+  this->SetNumberOfInputPorts(2);
 
   // The accumulation of stabilized frames
   this->SetNumberOfOutputPorts(1);
@@ -93,6 +94,16 @@ void vtkMotionDetector::ResetAlgorithm()
   this->GaussianMap.ResetMap();
 }
 
+//-----------------------------------------------------------------------------
+void vtkMotionDetector::SetNumberOfThreads(unsigned int threads)
+{
+  if (this->GaussianMap.GetNumberOfThreads() != threads)
+  {
+    this->GaussianMap.SetNumberOfThreads(threads);
+    this->Modified();
+  }
+}
+
 //-----------------------------------------------------------------------------
 void vtkMotionDetector::PrintSelf(ostream& os, vtkIndent indent)
 {
@@ -106,6 +117,23 @@ void vtkMotionDetector::AddFrame(vtkSmartPointer<vtkPolyData>& polydata)
   this->GaussianMap.AddFrame(polydata);
 }
 
+//-----------------------------------------------------------------------------
+int vtkMotionDetector::FillInputPortInformation(int port, vtkInformation* info)
+{
+  if (port == 0)
+  {
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+    return 1;
+  }
+  if (port == 1)
+  {
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkTable");
+    info->Set(vtkAlgorithm::INPUT_IS_OPTIONAL(), 1);
+    return 1;
+  }
+  return 0;
+}
+
 //-----------------------------------------------------------------------------
 int vtkMotionDetector::RequestData(vtkInformation *vtkNotUsed(request),
   vtkInformationVector **inputVector, vtkInformationVector *outputVector)
@@ -118,6 +146,31 @@ int vtkMotionDetector::RequestData(vtkInformation *vtkNotUsed(request),
   vtkPolyData* output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
   output->ShallowCopy(input);
 
+  // With the calibration the points are binned
+  // using their laser ids and azimuths
+  vtkTable* calibration = vtkTable::GetData(inputVector[1]);
+  vtkMTimeType calibrationTime = calibration ? calibration->GetMTime() : 0;
+  if (calibrationTime != this->CalibrationTime)
+  {
+    std::vector<double> corrections;
+    vtkDataArray* verticalCorrection = calibration ?
+      vtkDataArray::SafeDownCast(calibration->GetColumnByName("verticalCorrection")) : nullptr;
+    if (verticalCorrection)
+    {
+      corrections.resize(verticalCorrection->GetNumberOfTuples());
+      for (vtkIdType laser = 0; laser < verticalCorrection->GetNumberOfTuples(); ++laser)
+      {
+        corrections[laser] = verticalCorrection->GetTuple1(laser);
+      }
+    }
+    else if (calibration)
+    {
+      vtkWarningMacro("The calibration does not provide the vertical corrections of the lasers");
+    }
+    this->GaussianMap.SetLaserVerticalCorrections(corrections);
+    this->CalibrationTime = calibrationTime;
+  }
+
   // Add the new points into the Gaussian Map
   this->GaussianMap.AddFrame(output);
 
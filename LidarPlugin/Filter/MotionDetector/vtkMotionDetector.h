@@ -58,11 +58,16 @@ public:
   // Reset the vtkMotionDetector algorithm
   void ResetAlgorithm();
 
+  // Number of threads updating the spherical map, 0 to use all the cores
+  void SetNumberOfThreads(unsigned int threads);
+  unsigned int GetNumberOfThreads() const { return this->GaussianMap.GetNumberOfThreads(); }
+
 protected:
   // constructor / destructor
   vtkMotionDetector();
   ~vtkMotionDetector();
 
+  int FillInputPortInformation(int port, vtkInformation* info) override;
   int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *);
 
 private:
@@ -77,6 +82,10 @@ private:
   // Gaussian map correspond to the map of gaussian
   // distributions along the vertical and azimuth angles
   vtkSphericalMap GaussianMap;
+
+  // Modification time of the calibration table
+  // given to the spherical map, 0 if there is none
+  vtkMTimeType CalibrationTime = 0;
 };
 
 #endif // VTK_MOTION_DETECTOR_H
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "vtkSphericalMap.h"
+#include "ParallelFor.h"
+#include "vtkHelper.h"
 
 // VTK
 #include <vtkDataArray.h>
@@ -20,148 +22,116 @@
 #include <vtkUnsignedShortArray.h>
 #include <vtkPNGWriter.h>
 
-//----------------------------------------------------------------------------
-Gaussian::Gaussian()
-{
-  this->N = 0;
-  this->Sigma = 0.20; // 10 cm accuracy
-  this->MaxTTL = 25;
-  this->TTL = this->MaxTTL;
-}
+// STD
+#include <algorithm>
 
-//----------------------------------------------------------------------------
-double Gaussian::operator()(double x)
-{
-  return 1.0 / (this->Sigma * sqrt(2 * vtkMath::Pi())) * exp(-std::pow(x - this->Mean, 2) / (2.0 * std::pow(this->Sigma, 2)));
-}
+namespace {
+// Parameters of a new gaussian: a starting sigma of 20 cm
+// (specific to the Lidar sensors) and the number of frames
+// it lives without receiving points
+const double InitialSigma = 0.20;
+const int MaxTTL = 25;
 
-//----------------------------------------------------------------------------
-void Gaussian::SetMean(double mean)
-{
-  this->Mean = mean;
-  this->N = 1;
-}
+// Below this density a point does not belong to a gaussian (3 sigma)
+const double ThreshProb = 0.00135;
 
-//----------------------------------------------------------------------------
-double Gaussian::GetSigma()
-{
-  return this->Sigma;
+// Number of items processed by a thread at a time
+const unsigned int ChunkSize = 4096;
 }
 
 //----------------------------------------------------------------------------
-void Gaussian::UpdateParam(double x)
+void GaussianMixture::SetGaussian(unsigned int k, double mean, double sigma, unsigned int n)
 {
-  // update the mean
-  double oldMean = this->Mean;
-  this->Mean = (static_cast<double>(N) * this->Mean + x) / (static_cast<double>(N) + 1);
-
-  // update the standard deviation
-  this->Sigma = std::sqrt((this->N * std::pow(this->Sigma, 2) + (x - oldMean) * (x - this->Mean)) / (this->N + 1));
-
-  // reset the TTL to its maximum
-  this->TTL = this->MaxTTL;
-
-  // update the number of sample
-  this->N += 1;
-}
-
-//----------------------------------------------------------------------------
-bool Gaussian::UpdateTTL()
-{
-  this->TTL -= 1;
-  return (this->TTL >= 0);
+  this->Mean[k] = mean;
+  this->Sigma[k] = sigma;
+  this->Norm[k] = 1.0 / (sigma * std::sqrt(2.0 * vtkMath::Pi()));
+  this->InvTwoVariance[k] = 1.0 / (2.0 * sigma * sigma);
+  this->N[k] = n;
+  this->TTL[k] = MaxTTL;
 }
 
 //----------------------------------------------------------------------------
-GaussianMixture::GaussianMixture()
+unsigned int GaussianMixture::GetMostLikelyGaussian(double x, double& density) const
 {
-
-}
-
-//----------------------------------------------------------------------------
-double GaussianMixture::Evaluate(double x)
-{
-  if (this->Gaussians.size() == 0)
-  {
-    return 0.0;
-  }
-
-  double proba = 0;
-  for (std::list<Gaussian>::iterator it = this->Gaussians.begin(); it != this->Gaussians.end(); ++it)
+  density = 0.0;
+  unsigned int best = 0;
+  for (unsigned int k = 0; k < this->NumberOfGaussians; ++k)
   {
-    // divide by the max
-    proba = std::max(proba, (*it)(x));
+    const double dx = x - this->Mean[k];
+    const double d = this->Norm[k] * std::exp(-dx * dx * this->InvTwoVariance[k]);
+    if (d > density)
+    {
+      density = d;
+      best = k;
+    }
   }
-
-  return proba;
+  return best;
 }
 
 //----------------------------------------------------------------------------
-double GaussianMixture::operator()(double x)
+double GaussianMixture::Evaluate(double x) const
 {
-  return 1.0 / (this->sigma * sqrt(2 * vtkMath::Pi())) * exp(-std::pow(x - this->mean, 2) / (2.0 * std::pow(this->sigma, 2)));
+  double density;
+  this->GetMostLikelyGaussian(x, density);
+  return density;
 }
 
 //----------------------------------------------------------------------------
 void GaussianMixture::AddPoint(double x)
 {
-  double maxProba = 0.0;
-  std::list<Gaussian>::iterator itMaxProba;
+  double maxProba;
+  const unsigned int k = this->GetMostLikelyGaussian(x, maxProba);
 
-  // add the point to the right gaussian
-  for (std::list<Gaussian>::iterator it = this->Gaussians.begin(); it != this->Gaussians.end(); ++it)
+  // Create new gaussian centered on x
+  if (maxProba < ThreshProb)
   {
-    double proba = (*it)(x);
-    if (proba > maxProba)
+    unsigned int newGaussian = this->NumberOfGaussians;
+    if (newGaussian == MaxNumberOfGaussians)
     {
-      maxProba = proba;
-      itMaxProba = it;
+      // replace the gaussian closest to expire
+      newGaussian = static_cast<unsigned int>(std::min_element(this->TTL, this->TTL + MaxNumberOfGaussians) - this->TTL);
     }
-  }
-
-  double threshProb = 0.00135; // 3 sigma
-
-  // Create new gaussian
-  if (maxProba < threshProb)
-  {
-    // Create new gaussian, centered on x and with a starting
-    // sigma of 2cm (specific to the Lidar sensors)
-    Gaussian newGaussian;
-    newGaussian.SetMean(x);
-    this->Gaussians.push_back(newGaussian);
+    else
+    {
+      this->NumberOfGaussians++;
+    }
+    this->SetGaussian(newGaussian, x, InitialSigma, 1);
     return;
   }
 
-  itMaxProba->UpdateParam(x);
+  // update the mean and the standard deviation
+  const double n = static_cast<double>(this->N[k]);
+  const double oldMean = this->Mean[k];
+  const double mean = (n * oldMean + x) / (n + 1);
+  const double sigma = std::sqrt((n * this->Sigma[k] * this->Sigma[k] + (x - oldMean) * (x - mean)) / (n + 1));
+
+  // this resets the TTL to its maximum
+  this->SetGaussian(k, mean, sigma, this->N[k] + 1);
 }
 
 //----------------------------------------------------------------------------
 void GaussianMixture::UpdateTTL()
 {
-  std::list<Gaussian>::iterator it = this->Gaussians.begin();
-  while (it != this->Gaussians.end())
+  // erase the expired gaussians, keeping the order of the others
+  unsigned int alive = 0;
+  for (unsigned int k = 0; k < this->NumberOfGaussians; ++k)
   {
-    // Get if the gaussian is still alive
-    bool stillAlive = it->UpdateTTL();
-
-    // erase the gaussian
-    if (!stillAlive)
+    if (--this->TTL[k] < 0)
     {
-      // erase current iterator and get next on
-      it = this->Gaussians.erase(it);
-      // no need to increment iterator here
+      continue;
     }
-    else
+    if (alive != k)
     {
-      it++; // increment iterator here
+      this->Mean[alive] = this->Mean[k];
+      this->Sigma[alive] = this->Sigma[k];
+      this->Norm[alive] = this->Norm[k];
+      this->InvTwoVariance[alive] = this->InvTwoVariance[k];
+      this->N[alive] = this->N[k];
+      this->TTL[alive] = this->TTL[k];
     }
+    alive++;
   }
-}
-
-//----------------------------------------------------------------------------
-unsigned int GaussianMixture::GetNumberOfPoints()
-{
-  return this->Gaussians.size();
+  this->NumberOfGaussians = alive;
 }
 
 //----------------------------------------------------------------------------
@@ -209,6 +179,17 @@ void vtkSphericalMap::SetNPhi(unsigned int phi)
   this->ResetMap();
 }
 
+//----------------------------------------------------------------------------
+void vtkSphericalMap::SetLaserVerticalCorrections(const std::vector<double>& corrections)
+{
+  // the vertical angles of the map are measured from ez
+  this->LaserPhi.resize(corrections.size());
+  for (unsigned int laser = 0; laser < corrections.size(); ++laser)
+  {
+    this->LaserPhi[laser] = (90.0 - corrections[laser]) * vtkMath::Pi() / 180.0;
+  }
+}
+
 //----------------------------------------------------------------------------
 unsigned int vtkSphericalMap::GetNPhi()
 {
@@ -238,8 +219,9 @@ void vtkSphericalMap::ResetMap()
   this->dTheta = (this->ThetaBounds[1] - this->ThetaBounds[0]) / static_cast<double>(this->NTheta);
 
   // reset the map
+  this->NSample = this->NPhi * this->NTheta;
   this->Map.clear();
-  this->Map.resize(this->NPhi * this->NTheta);
+  this->Map.resize(this->NSample);
 
   // reset internal parameters
   this->AddedFrames = 0;
@@ -250,7 +232,7 @@ void vtkSphericalMap::ResetMap()
 }
 
 //----------------------------------------------------------------------------
-Eigen::Matrix<double, 3, 1> vtkSphericalMap::GetSphericalCoordinates(const Eigen::Matrix<double, 3, 1>& X)
+Eigen::Matrix<double, 3, 1> vtkSphericalMap::GetSphericalCoordinates(const Eigen::Matrix<double, 3, 1>& X) const
 {
   // Express the current point in the local
   // reference frame designed by the internal
@@ -305,7 +287,7 @@ unsigned int vtkSphericalMap::GetNumberOfPoints()
 //----------------------------------------------------------------------------
 void vtkSphericalMap::AddPoint(unsigned int idxTheta, unsigned int idxPhi, double valueDepth)
 {
-  if (idxTheta > this->NTheta || idxPhi > this->NPhi)
+  if (idxTheta >= this->NTheta || idxPhi >= this->NPhi)
   {
     std::cout << "Error, required values out of bounds" << std::endl;
     std::cout << "[" << idxTheta << "," << idxPhi << "] / [" << this->NTheta << "," << this->NPhi << "]" << std::endl;
@@ -317,68 +299,156 @@ void vtkSphericalMap::AddPoint(unsigned int idxTheta, unsigned int idxPhi, doubl
 }
 
 //----------------------------------------------------------------------------
- void vtkSphericalMap::AddFrame(vtkSmartPointer<vtkPolyData> polydata)
- {
-   vtkSmartPointer<vtkDoubleArray> Phi = vtkSmartPointer<vtkDoubleArray>::New();
-   vtkSmartPointer<vtkDoubleArray> Theta = vtkSmartPointer<vtkDoubleArray>::New();
-   vtkSmartPointer<vtkDoubleArray> Motion = vtkSmartPointer<vtkDoubleArray>::New();
-   Phi->SetName("Phi");
-   Theta->SetName("Theta");
-   Motion->SetName("Motion_Probability");
-
-   double point[3];
-   Eigen::Matrix<double, 3, 1> cartesianPoint;
-   Eigen::Matrix<double, 3, 1> sphericalPoint;
-
-   for (unsigned int k = 0; k < polydata->GetNumberOfPoints(); ++k)
-   {
-     // Get point and compute its spherical coordinates
-     polydata->GetPoint(k, point);
-     cartesianPoint << point[0], point[1], point[2];
-     sphericalPoint = this->GetSphericalCoordinates(cartesianPoint);
-
-     // Convert spherical coordinates to
-     // spherical map coordinates
-     unsigned int idxPhi = static_cast<int>(std::floor((sphericalPoint(2) - this->PhiBounds[0]) / this->dPhi));
-     unsigned int idxTheta = static_cast<int>(std::floor((sphericalPoint(1) - this->ThetaBounds[0]) / this->dTheta));
-
-     // Evaluate the mixture model on the current data
-     // it return the "probability" of the point to be
-     // a point in motion
-     double proba = this->Map[idxTheta + this->NTheta * idxPhi].Evaluate(sphericalPoint(0));
-
-     // Add the depth to the correct "pixel"
-     this->AddPoint(idxTheta, idxPhi, sphericalPoint(0));
-
-     double theta = this->ThetaBounds[0] + idxTheta * this->dTheta;
-     double phi = this->PhiBounds[0] + idxPhi * this->dPhi;
-     double r = sphericalPoint(0);
-
-     point[0] = r * std::sin(phi) * std::cos(theta);
-     point[1] = r * std::sin(phi) * std::sin(theta);
-     point[2] = r * std::cos(phi);
-     //polydata->GetPoints()->SetPoint(k, point);
-
-     Theta->InsertNextTuple1(sphericalPoint(1) * 180.0 / vtkMath::Pi());
-     Phi->InsertNextTuple1(sphericalPoint(2) * 180.0 / vtkMath::Pi());
-     Motion->InsertNextTuple1(proba);
-   }
-
-   // Time to live of the gaussians
-   this->UpdateTTL();
-
-   polydata->GetPointData()->AddArray(Phi);
-   polydata->GetPointData()->AddArray(Theta);
-   polydata->GetPointData()->AddArray(Motion);
-
-   this->AddedFrames += 1;
- }
-
- //----------------------------------------------------------------------------
- void vtkSphericalMap::UpdateTTL()
- {
-   for (unsigned int k = 0; k < this->Map.size(); ++k)
-   {
-     this->Map[k].UpdateTTL();
-   }
- }
+void vtkSphericalMap::AddFrame(vtkSmartPointer<vtkPolyData> polydata)
+{
+  const unsigned int nbrPoints = static_cast<unsigned int>(polydata->GetNumberOfPoints());
+  vtkPoints* points = polydata->GetPoints();
+
+  vtkSmartPointer<vtkDoubleArray> Phi = vtkSmartPointer<vtkDoubleArray>::New();
+  vtkSmartPointer<vtkDoubleArray> Theta = vtkSmartPointer<vtkDoubleArray>::New();
+  vtkSmartPointer<vtkDoubleArray> Motion = vtkSmartPointer<vtkDoubleArray>::New();
+  Phi->SetName("Phi");
+  Theta->SetName("Theta");
+  Motion->SetName("Motion_Probability");
+  Phi->SetNumberOfTuples(nbrPoints);
+  Theta->SetNumberOfTuples(nbrPoints);
+  Motion->SetNumberOfTuples(nbrPoints);
+  double* phiValues = Phi->GetPointer(0);
+  double* thetaValues = Theta->GetPointer(0);
+  double* motionValues = Motion->GetPointer(0);
+
+  // When the frame provides the laser ids and the azimuths and the
+  // elevations of the lasers are known, the points are binned directly
+  // in the range image of the sensor, otherwise their spherical
+  // coordinates are computed from their positions
+  vtkDataArray* laserIds = polydata->GetPointData()->GetArray("laser_id");
+  vtkDataArray* azimuths = polydata->GetPointData()->GetArray("azimuth");
+  const bool useRangeImage = laserIds && azimuths && !this->LaserPhi.empty() &&
+                             laserIds->GetNumberOfTuples() == nbrPoints &&
+                             azimuths->GetNumberOfTuples() == nbrPoints;
+  const std::vector<double> laserIdValues =
+    useRangeImage ? getComponentValues<double>(laserIds) : std::vector<double>();
+  const std::vector<double> azimuthValues =
+    useRangeImage ? getComponentValues<double>(azimuths) : std::vector<double>();
+
+  // Bin the points: compute their spherical coordinates
+  // and the "pixel" of the spherical map they fall in
+  const unsigned int noPixel = this->NSample;
+  std::vector<double> depths(nbrPoints);
+  std::vector<unsigned int> pixels(nbrPoints);
+  Parallel::ForEachChunk(nbrPoints, ChunkSize, this->NumberOfThreads,
+    [&](unsigned int, size_t begin, size_t end)
+  {
+    double point[3];
+    Eigen::Matrix<double, 3, 1> sphericalPoint;
+    for (unsigned int k = begin; k < end; ++k)
+    {
+      points->GetPoint(k, point);
+      const double laserId = useRangeImage ? laserIdValues[k] : -1.0;
+      if (laserId >= 0.0 && laserId < this->LaserPhi.size())
+      {
+        // the azimuth is in hundredths of degrees, clockwise from the y axis
+        double theta = 0.5 * vtkMath::Pi() - azimuthValues[k] * vtkMath::Pi() / 18000.0;
+        theta -= 2.0 * vtkMath::Pi() * std::floor((theta + vtkMath::Pi()) / (2.0 * vtkMath::Pi()));
+        sphericalPoint << std::sqrt(point[0] * point[0] + point[1] * point[1] + point[2] * point[2]),
+                          theta,
+                          this->LaserPhi[static_cast<unsigned int>(laserId)];
+      }
+      else
+      {
+        const Eigen::Matrix<double, 3, 1> cartesianPoint(point[0], point[1], point[2]);
+        sphericalPoint = this->GetSphericalCoordinates(cartesianPoint);
+      }
+      thetaValues[k] = sphericalPoint(1) * 180.0 / vtkMath::Pi();
+      phiValues[k] = sphericalPoint(2) * 180.0 / vtkMath::Pi();
+      motionValues[k] = 0.0;
+      depths[k] = sphericalPoint(0);
+      if (!sphericalPoint.allFinite())
+      {
+        pixels[k] = noPixel;
+        continue;
+      }
+
+      // Convert spherical coordinates to
+      // spherical map coordinates
+      const double phi = std::floor((sphericalPoint(2) - this->PhiBounds[0]) / this->dPhi);
+      const double theta = std::floor((sphericalPoint(1) - this->ThetaBounds[0]) / this->dTheta);
+      const unsigned int idxPhi = static_cast<unsigned int>(std::min(std::max(phi, 0.0), this->NPhi - 1.0));
+      const unsigned int idxTheta = static_cast<unsigned int>(std::min(std::max(theta, 0.0), this->NTheta - 1.0));
+      pixels[k] = idxTheta + this->NTheta * idxPhi;
+    }
+  });
+
+  // Sort the points by pixel, keeping their acquisition
+  // order inside of a pixel
+  std::vector<unsigned int> pixelStart(this->NSample + 1, 0);
+  for (unsigned int k = 0; k < nbrPoints; ++k)
+  {
+    if (pixels[k] != noPixel)
+    {
+      pixelStart[pixels[k] + 1]++;
+    }
+  }
+  std::vector<unsigned int> usedPixels;
+  for (unsigned int pixel = 0; pixel < this->NSample; ++pixel)
+  {
+    if (pixelStart[pixel + 1] > 0)
+    {
+      usedPixels.push_back(pixel);
+    }
+    pixelStart[pixel + 1] += pixelStart[pixel];
+  }
+  std::vector<unsigned int> sortedPoints(pixelStart[this->NSample]);
+  std::vector<unsigned int> nextPosition(pixelStart.begin(), pixelStart.end() - 1);
+  for (unsigned int k = 0; k < nbrPoints; ++k)
+  {
+    if (pixels[k] != noPixel)
+    {
+      sortedPoints[nextPosition[pixels[k]]++] = k;
+    }
+  }
+
+  // The pixels are independent, update them in parallel
+  Parallel::ForEachChunk(usedPixels.size(), ChunkSize, this->NumberOfThreads,
+    [&](unsigned int, size_t begin, size_t end)
+  {
+    for (unsigned int i = begin; i < end; ++i)
+    {
+      const unsigned int pixel = usedPixels[i];
+      GaussianMixture& mixture = this->Map[pixel];
+      for (unsigned int j = pixelStart[pixel]; j < pixelStart[pixel + 1]; ++j)
+      {
+        // Evaluate the mixture model on the current data
+        // it return the "probability" of the point to be
+        // a point in motion
+        const unsigned int k = sortedPoints[j];
+        motionValues[k] = mixture.Evaluate(depths[k]);
+
+        // Add the depth to the correct "pixel"
+        mixture.AddPoint(depths[k]);
+      }
+    }
+  });
+
+  // Time to live of the gaussians
+  this->UpdateTTL();
+
+  polydata->GetPointData()->AddArray(Phi);
+  polydata->GetPointData()->AddArray(Theta);
+  polydata->GetPointData()->AddArray(Motion);
+
+  this->AddedFrames += 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkSphericalMap::UpdateTTL()
+{
+  Parallel::ForEachChunk(this->Map.size(), ChunkSize, this->NumberOfThreads,
+    [this](unsigned int, size_t begin, size_t end)
+  {
+    for (unsigned int k = begin; k < end; ++k)
+    {
+      this->Map[k].UpdateTTL();
+    }
+  });
+}
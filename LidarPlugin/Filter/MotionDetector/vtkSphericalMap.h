@@ -41,59 +41,23 @@
 // STD
 #include <vector>
 #include <cmath>
-#include <list>
-
-class Gaussian
-{
-public:
-  Gaussian();
-  double operator()(double x);
-
-  // set the mean
-  void SetMean(double mean);
-
-  // update parameters using new value
-  void UpdateParam(double x);
-
-  // Update the time to live
-  // return false if ttl falls
-  // to zero value
-  bool UpdateTTL();
-
-  // return sigma value
-  double GetSigma();
-
-private:
-  // mean of the gaussian
-  double Mean;
-
-  // standard deviation of the gaussian
-  double Sigma;
-
-  // number of points
-  unsigned int N;
-
-  // Time to live of the gaussian
-  int TTL;
-
-  // Maximum number of the TTL
-  int MaxTTL;
-};
 
+// Mixture of gaussians modeling the depths observed in a pixel of the
+// spherical map. The gaussians are stored in fixed size arrays, one per
+// parameter, along with the normalization factors of their densities so
+// that evaluating the mixture only computes an exponential per gaussian.
 class GaussianMixture
 {
 public:
-  // default constructor
-  GaussianMixture();
-
-  // Evaluation
-  double operator()(double x);
+  // Maximum number of gaussians of a mixture, if a new gaussian is
+  // needed when it is full the one closest to expire is replaced
+  static const unsigned int MaxNumberOfGaussians = 4;
 
   // Add a data
   void AddPoint(double x);
 
-  // return the number of points
-  unsigned int GetNumberOfPoints();
+  // return the number of gaussians
+  unsigned int GetNumberOfPoints() const { return this->NumberOfGaussians; }
 
   // Update the time to live
   // of the gaussians composing
@@ -102,17 +66,31 @@ public:
 
   // Evaluate the probability
   // of a point to be in motion
-  double Evaluate(double x);
+  double Evaluate(double x) const;
 
 private:
-  // mean of the gaussian
-  double mean;
+  // Index of the gaussian of highest density in x, and this density,
+  // which is 0 if there is no gaussian
+  unsigned int GetMostLikelyGaussian(double x, double& density) const;
+
+  // Set the parameters of a gaussian and its normalization factors
+  void SetGaussian(unsigned int k, double mean, double sigma, unsigned int n);
+
+  // mean and standard deviation of the gaussians
+  double Mean[MaxNumberOfGaussians];
+  double Sigma[MaxNumberOfGaussians];
 
-  // standard deviation of the gaussian
-  double sigma;
+  // density of a gaussian: Norm * exp(-(x - Mean)^2 * InvTwoVariance)
+  double Norm[MaxNumberOfGaussians];
+  double InvTwoVariance[MaxNumberOfGaussians];
 
-  // points in the distribution
-  std::list<Gaussian> Gaussians;
+  // number of points of the gaussians
+  unsigned int N[MaxNumberOfGaussians];
+
+  // Time to live of the gaussians, in frames
+  int TTL[MaxNumberOfGaussians];
+
+  unsigned int NumberOfGaussians = 0;
 };
 
 
@@ -150,6 +128,17 @@ public:
   // Set the sensor RPM
   void SetSensorRPM(double rpm);
 
+  // Vertical corrections of the lasers, in degrees, indexed by laser id.
+  // When they are set the frames providing the "laser_id" and "azimuth"
+  // arrays are binned directly in the range image of the sensor, which
+  // assumes the default base and center of the map. An empty vector
+  // restores the binning from the positions of the points
+  void SetLaserVerticalCorrections(const std::vector<double>& corrections);
+
+  // Number of threads updating the map, 0 to use all the cores
+  void SetNumberOfThreads(unsigned int threads) { this->NumberOfThreads = threads; }
+  unsigned int GetNumberOfThreads() const { return this->NumberOfThreads; }
+
 private:
   // Number of sample points along
   // Phi parameter (vertical angle
@@ -184,9 +173,16 @@ private:
   // processed by the algorithm
   unsigned int AddedFrames;
 
+  // Number of threads updating the map
+  unsigned int NumberOfThreads = 0;
+
   // The spherical map
   std::vector<GaussianMixture> Map;
 
+  // Phi angle of each laser, empty if the
+  // calibration of the sensor is unknown
+  std::vector<double> LaserPhi;
+
   // Base of R3 used. in some
   // case it can be changed
   Eigen::Matrix<double, 3, 1> ez;
@@ -199,7 +195,7 @@ private:
 
   // Convert cartesian coordinates of X point in its
   // spherical coordinates
-  Eigen::Matrix<double, 3, 1> GetSphericalCoordinates(const Eigen::Matrix<double, 3, 1>& X);
+  Eigen::Matrix<double, 3, 1> GetSphericalCoordinates(const Eigen::Matrix<double, 3, 1>& X) const;
 
   // export as images parameters
   bool ShouldExportAsImage;
@@ -0,0 +1,299 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "OccupancyGrid.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+// Number of rays cast by a thread at a time
+const size_t RayChunkSize = 1024;
+
+// Each integer coordinate of a block is stored on 21 bits, as in vtkVoxelAccumulator
+const int64_t CoordinateBits = 21;
+const int64_t CoordinateOffset = int64_t(1) << (CoordinateBits - 1);
+
+//-----------------------------------------------------------------------------
+int FloorDivide(int a, int b)
+{
+  return a >= 0 ? a / b : -((-a - 1) / b) - 1;
+}
+
+//-----------------------------------------------------------------------------
+// Index of a cell in its block
+int CellIndex(const int cell[3])
+{
+  const int size = OccupancyGrid::BlockSize;
+  return (cell[0] - FloorDivide(cell[0], size) * size) +
+         size * ((cell[1] - FloorDivide(cell[1], size) * size) +
+                 size * (cell[2] - FloorDivide(cell[2], size) * size));
+}
+}
+
+//-----------------------------------------------------------------------------
+OccupancyGrid::Block::Block()
+{
+  std::fill(this->LogOdds, this->LogOdds + BlockSize * BlockSize * BlockSize, 0.f);
+  for (auto& stamp : this->Stamps)
+  {
+    stamp.store(0, std::memory_order_relaxed);
+  }
+}
+
+//-----------------------------------------------------------------------------
+int64_t OccupancyGrid::PackBlock(const int cell[3])
+{
+  int64_t key = 0;
+  for (int k = 0; k < 3; ++k)
+  {
+    key = (key << CoordinateBits) | (FloorDivide(cell[k], BlockSize) + CoordinateOffset);
+  }
+  return key;
+}
+
+//-----------------------------------------------------------------------------
+void OccupancyGrid::UnpackBlock(int64_t key, int block[3])
+{
+  for (int k = 2; k >= 0; --k)
+  {
+    block[k] = static_cast<int>((key & ((int64_t(1) << CoordinateBits) - 1)) - CoordinateOffset);
+    key >>= CoordinateBits;
+  }
+}
+
+//-----------------------------------------------------------------------------
+template <typename F>
+void OccupancyGrid::Traverse(const double origin[3], const double end[3], bool withEnd, const F& f)
+{
+  int cell[3], endCell[3], step[3];
+  double tMax[3], tDelta[3];
+  int nbSteps = 0;
+  for (int k = 0; k < 3; ++k)
+  {
+    cell[k] = static_cast<int>(std::floor(origin[k]));
+    endCell[k] = static_cast<int>(std::floor(end[k]));
+    const double direction = end[k] - origin[k];
+    step[k] = direction > 0 ? 1 : (direction < 0 ? -1 : 0);
+    tDelta[k] = step[k] != 0 ? 1.0 / std::abs(direction) : std::numeric_limits<double>::infinity();
+    tMax[k] = step[k] > 0 ? (cell[k] + 1 - origin[k]) * tDelta[k]
+            : step[k] < 0 ? (origin[k] - cell[k]) * tDelta[k]
+            : std::numeric_limits<double>::infinity();
+    nbSteps += std::abs(endCell[k] - cell[k]);
+  }
+
+  // the rounding errors can not make the ray go further than its end cell
+  for (int i = 0; i < nbSteps; ++i)
+  {
+    f(cell);
+    const int axis = tMax[0] < tMax[1] ? (tMax[0] < tMax[2] ? 0 : 2) : (tMax[1] < tMax[2] ? 1 : 2);
+    cell[axis] += step[axis];
+    tMax[axis] += tDelta[axis];
+  }
+  if (withEnd)
+  {
+    f(endCell);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void OccupancyGrid::Clear()
+{
+  this->Blocks.clear();
+  this->NumberOfScans = 0;
+}
+
+//-----------------------------------------------------------------------------
+void OccupancyGrid::SetVoxelSize(double voxelSize)
+{
+  if (voxelSize > 0.0 && voxelSize != this->VoxelSize)
+  {
+    this->VoxelSize = voxelSize;
+    this->Clear();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void OccupancyGrid::SetTwoDimensional(bool twoDimensional)
+{
+  if (twoDimensional != this->TwoDimensional)
+  {
+    this->TwoDimensional = twoDimensional;
+    this->Clear();
+  }
+}
+
+//-----------------------------------------------------------------------------
+float OccupancyGrid::GetLogOdds(const double point[3], bool& isObserved) const
+{
+  int cell[3];
+  for (int k = 0; k < 3; ++k)
+  {
+    cell[k] = static_cast<int>(std::floor(point[k] / this->VoxelSize));
+  }
+  if (this->TwoDimensional)
+  {
+    cell[2] = 0;
+  }
+  const auto it = this->Blocks.find(PackBlock(cell));
+  const int index = CellIndex(cell);
+  isObserved = it != this->Blocks.end() && it->second->Stamps[index].load() != 0;
+  return isObserved ? it->second->LogOdds[index] : 0.f;
+}
+
+//-----------------------------------------------------------------------------
+void OccupancyGrid::InsertScan(const double origin[3], const std::vector<double>& points,
+                               unsigned int nbThreads)
+{
+  nbThreads = Parallel::GetNumberOfThreads(nbThreads);
+  const uint32_t stamp = ++this->NumberOfScans;
+
+  // the rays in cell units, cut at MaxRange, the points beyond it not being hits.
+  // In two dimensions, the rays are cast in the plane of the cells of height 0
+  const size_t nbRays = points.size() / 3;
+  const double invVoxelSize = 1.0 / this->VoxelSize;
+  double start[3];
+  for (int k = 0; k < 3; ++k)
+  {
+    start[k] = origin[k] * invVoxelSize;
+  }
+  if (this->TwoDimensional)
+  {
+    start[2] = 0.5;
+  }
+  struct Ray
+  {
+    double End[3];
+    bool IsHit;
+    bool IsValid;
+  };
+  std::vector<Ray> rays(nbRays);
+  const double limit = static_cast<double>(CoordinateOffset - 1) * BlockSize;
+
+  // first pass: the blocks crossed by the rays
+  std::vector<std::vector<int64_t> > crossedBlocks(nbThreads);
+  Parallel::ForEachChunk(nbRays, RayChunkSize, nbThreads,
+    [&](unsigned int thread, size_t begin, size_t end)
+  {
+    std::vector<int64_t>& blocks = crossedBlocks[thread];
+    for (size_t i = begin; i < end; ++i)
+    {
+      Ray& ray = rays[i];
+      const double* point = &points[3 * i];
+      double direction[3] = { point[0] - origin[0], point[1] - origin[1],
+                              this->TwoDimensional ? 0.0 : point[2] - origin[2] };
+      const double range = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] +
+                                     direction[2] * direction[2]);
+      ray.IsValid = std::isfinite(range);
+      if (!ray.IsValid)
+      {
+        continue;
+      }
+      ray.IsHit = range <= this->MaxRange;
+      const double scale = ray.IsHit ? 1.0 : this->MaxRange / range;
+      for (int k = 0; k < 3; ++k)
+      {
+        ray.End[k] = start[k] + direction[k] * scale * invVoxelSize;
+        ray.IsValid = ray.IsValid && std::abs(ray.End[k]) < limit && std::abs(start[k]) < limit;
+      }
+      if (!ray.IsValid)
+      {
+        continue;
+      }
+      int64_t lastBlock = -1;
+      Traverse(start, ray.End, true, [&](const int cell[3])
+      {
+        const int64_t block = PackBlock(cell);
+        if (block != lastBlock)
+        {
+          blocks.push_back(block);
+          lastBlock = block;
+        }
+      });
+    }
+  });
+  std::vector<int64_t> blocks;
+  for (const auto& threadBlocks : crossedBlocks)
+  {
+    blocks.insert(blocks.end(), threadBlocks.begin(), threadBlocks.end());
+  }
+  std::sort(blocks.begin(), blocks.end());
+  blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+  for (int64_t block : blocks)
+  {
+    std::unique_ptr<Block>& cells = this->Blocks[block];
+    if (!cells)
+    {
+      cells.reset(new Block);
+    }
+  }
+
+  // second pass: the cells, the map of the blocks being only read. The cell of each
+  // point is claimed first, so that the rays then only update the free cells
+  auto update = [this, stamp](const int cell[3], float logOdds, int64_t& lastKey, Block*& block)
+  {
+    const int64_t key = PackBlock(cell);
+    if (key != lastKey)
+    {
+      block = this->Blocks.find(key)->second.get();
+      lastKey = key;
+    }
+    const int index = CellIndex(cell);
+    if (block->Stamps[index].exchange(stamp) != stamp)
+    {
+      block->LogOdds[index] = std::max(this->MinLogOdds,
+        std::min(this->MaxLogOdds, block->LogOdds[index] + logOdds));
+    }
+  };
+  Parallel::ForEachChunk(nbRays, RayChunkSize, nbThreads,
+    [&](unsigned int, size_t begin, size_t end)
+  {
+    int64_t lastKey = -1;
+    Block* block = nullptr;
+    int cell[3];
+    for (size_t i = begin; i < end; ++i)
+    {
+      if (rays[i].IsValid && rays[i].IsHit)
+      {
+        for (int k = 0; k < 3; ++k)
+        {
+          cell[k] = static_cast<int>(std::floor(rays[i].End[k]));
+        }
+        update(cell, this->HitLogOdds, lastKey, block);
+      }
+    }
+  });
+  Parallel::ForEachChunk(nbRays, RayChunkSize, nbThreads,
+    [&](unsigned int, size_t begin, size_t end)
+  {
+    int64_t lastKey = -1;
+    Block* block = nullptr;
+    for (size_t i = begin; i < end; ++i)
+    {
+      if (rays[i].IsValid)
+      {
+        // the end of a ray cut at MaxRange is free too
+        Traverse(start, rays[i].End, !rays[i].IsHit, [&](const int cell[3])
+        {
+          update(cell, this->MissLogOdds, lastKey, block);
+        });
+      }
+    }
+  });
+}
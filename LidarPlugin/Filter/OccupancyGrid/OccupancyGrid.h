@@ -0,0 +1,165 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef OCCUPANCY_GRID_H
+#define OCCUPANCY_GRID_H
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \class OccupancyGrid
+ * \brief Sparse log-odds occupancy grid, updated by casting the rays of lidar scans.
+ *
+ * The cells are stored in blocks of BlockSize^3 cells, allocated when a ray first
+ * crosses them, so that the memory only depends on the observed space. A scan is
+ * inserted in two parallel passes over its rays, which are traversed with a 3D DDA
+ * (Amanatides & Woo): the first one collects the blocks to allocate, the second one
+ * updates the cells. Each cell is updated at most once per scan, as occupied if a point
+ * of the scan falls in it, else as free if a ray crosses it, whatever the number of
+ * rays and of threads: a cell is claimed for the scan with an atomic stamp, and the
+ * occupied cells are claimed before the rays are traversed.
+ *
+ * In two dimensions, the rays are cast in the horizontal plane, all the cells having
+ * the same height.
+ */
+class OccupancyGrid
+{
+public:
+  //! Number of cells along an edge of a block
+  static const int BlockSize = 8;
+
+  //! Remove all the cells
+  void Clear();
+
+  /**
+   * @brief Update the grid with a scan
+   * @param origin position of the sensor, in world coordinates
+   * @param points x, y, z of the points of the scan, in world coordinates
+   * @param nbThreads number of threads casting the rays, 0 to use all the cores
+   */
+  void InsertScan(const double origin[3], const std::vector<double>& points,
+                  unsigned int nbThreads = 0);
+
+  /**
+   * @brief Log-odds of occupancy of the cell of a point
+   * @param isObserved set to false if no ray reached the cell
+   */
+  float GetLogOdds(const double point[3], bool& isObserved) const;
+
+  //! Call f(center, logOdds) for each observed cell, center being its x, y, z
+  template <typename F>
+  void ForEachObservedCell(const F& f) const;
+
+  //! Number of blocks of cells allocated
+  size_t GetNumberOfBlocks() const { return this->Blocks.size(); }
+
+  //! Occupancy probability of a log-odds
+  static double Probability(double logOdds) { return 1.0 - 1.0 / (1.0 + std::exp(logOdds)); }
+
+  //! Size of the edges of the cells, changing it clears the grid
+  double GetVoxelSize() const { return this->VoxelSize; }
+  void SetVoxelSize(double voxelSize);
+
+  //! Cast the rays in the horizontal plane, changing it clears the grid
+  bool GetTwoDimensional() const { return this->TwoDimensional; }
+  void SetTwoDimensional(bool twoDimensional);
+
+  //! Log-odds added to a cell a point falls in
+  float GetHitLogOdds() const { return this->HitLogOdds; }
+  void SetHitLogOdds(float value) { this->HitLogOdds = value; }
+
+  //! Log-odds added to a cell a ray crosses, negative
+  float GetMissLogOdds() const { return this->MissLogOdds; }
+  void SetMissLogOdds(float value) { this->MissLogOdds = value; }
+
+  //! Bounds of the log-odds of a cell, which keep the grid able to follow changes
+  float GetMinLogOdds() const { return this->MinLogOdds; }
+  void SetMinLogOdds(float value) { this->MinLogOdds = value; }
+  float GetMaxLogOdds() const { return this->MaxLogOdds; }
+  void SetMaxLogOdds(float value) { this->MaxLogOdds = value; }
+
+  //! The rays are cut at this distance, their point not being inserted
+  double GetMaxRange() const { return this->MaxRange; }
+  void SetMaxRange(double maxRange) { this->MaxRange = maxRange; }
+
+private:
+  struct Block
+  {
+    Block();
+    float LogOdds[BlockSize * BlockSize * BlockSize];
+    //! Last scan that updated each cell, 0 if none did
+    std::atomic<uint32_t> Stamps[BlockSize * BlockSize * BlockSize];
+  };
+
+  //! Integer coordinates of a block packed in a key, see PackBlock
+  static int64_t PackBlock(const int cell[3]);
+  static void UnpackBlock(int64_t key, int block[3]);
+
+  //! Apply f to each cell crossed by the ray from origin to end, in cell units,
+  //! then to the cell of end if withEnd is set
+  template <typename F>
+  static void Traverse(const double origin[3], const double end[3], bool withEnd, const F& f);
+
+  double VoxelSize = 0.2;
+  bool TwoDimensional = false;
+  float HitLogOdds = 0.85f;
+  float MissLogOdds = -0.4f;
+  float MinLogOdds = -2.0f;
+  float MaxLogOdds = 3.5f;
+  double MaxRange = 100.0;
+
+  std::unordered_map<int64_t, std::unique_ptr<Block> > Blocks;
+  //! Number of scans inserted, which stamps the cells they update
+  uint32_t NumberOfScans = 0;
+};
+
+//-----------------------------------------------------------------------------
+template <typename F>
+void OccupancyGrid::ForEachObservedCell(const F& f) const
+{
+  for (const auto& it : this->Blocks)
+  {
+    int block[3];
+    UnpackBlock(it.first, block);
+    const Block& cells = *it.second;
+    int index = 0;
+    for (int z = 0; z < BlockSize; ++z)
+    {
+      for (int y = 0; y < BlockSize; ++y)
+      {
+        for (int x = 0; x < BlockSize; ++x, ++index)
+        {
+          if (cells.Stamps[index].load(std::memory_order_relaxed) != 0)
+          {
+            const double center[3] = {
+              (block[0] * BlockSize + x + 0.5) * this->VoxelSize,
+              (block[1] * BlockSize + y + 0.5) * this->VoxelSize,
+              this->TwoDimensional ? 0.0 : (block[2] * BlockSize + z + 0.5) * this->VoxelSize };
+            f(center, cells.LogOdds[index]);
+          }
+        }
+      }
+    }
+  }
+}
+
+#endif // OCCUPANCY_GRID_H
@@ -0,0 +1,262 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "vtkOccupancyGridAccumulator.h"
+
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkTransform.h>
+
+#include "vtkTemporalTransforms.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkOccupancyGridAccumulator)
+
+//-----------------------------------------------------------------------------
+vtkOccupancyGridAccumulator::vtkOccupancyGridAccumulator()
+{
+  this->SetNumberOfInputPorts(2);
+  this->SetNumberOfOutputPorts(1);
+  this->Interpolator = vtkSmartPointer<vtkCustomTransformInterpolator>::New();
+  this->Interpolator->SetInterpolationTypeToLinear();
+}
+
+//-----------------------------------------------------------------------------
+void vtkOccupancyGridAccumulator::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "VoxelSize: " << this->Grid.GetVoxelSize() << std::endl;
+  os << indent << "TwoDimensional: " << this->Grid.GetTwoDimensional() << std::endl;
+  os << indent << "HitLogOdds: " << this->Grid.GetHitLogOdds() << std::endl;
+  os << indent << "MissLogOdds: " << this->Grid.GetMissLogOdds() << std::endl;
+  os << indent << "MinLogOdds: " << this->Grid.GetMinLogOdds() << std::endl;
+  os << indent << "MaxLogOdds: " << this->Grid.GetMaxLogOdds() << std::endl;
+  os << indent << "MaxRange: " << this->Grid.GetMaxRange() << std::endl;
+  os << indent << "OccupancyThreshold: " << this->OccupancyThreshold << std::endl;
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << std::endl;
+}
+
+//----------------------------------------------------------------------------
+vtkMTimeType vtkOccupancyGridAccumulator::GetMTime()
+{
+  return std::max(this->Superclass::GetMTime(), this->Interpolator->GetMTime());
+}
+
+//-----------------------------------------------------------------------------
+void vtkOccupancyGridAccumulator::SetVoxelSize(double value)
+{
+  if (this->Grid.GetVoxelSize() != value && value > 0.0)
+  {
+    this->Grid.SetVoxelSize(value);
+    this->ResetAccumulation();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkOccupancyGridAccumulator::SetTwoDimensional(bool value)
+{
+  if (this->Grid.GetTwoDimensional() != value)
+  {
+    this->Grid.SetTwoDimensional(value);
+    this->ResetAccumulation();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkOccupancyGridAccumulator::SetHitLogOdds(double value)
+{
+  this->Grid.SetHitLogOdds(static_cast<float>(value));
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+void vtkOccupancyGridAccumulator::SetMissLogOdds(double value)
+{
+  this->Grid.SetMissLogOdds(static_cast<float>(value));
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+void vtkOccupancyGridAccumulator::SetMinLogOdds(double value)
+{
+  this->Grid.SetMinLogOdds(static_cast<float>(value));
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+void vtkOccupancyGridAccumulator::SetMaxLogOdds(double value)
+{
+  this->Grid.SetMaxLogOdds(static_cast<float>(value));
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+void vtkOccupancyGridAccumulator::SetMaxRange(double value)
+{
+  this->Grid.SetMaxRange(value);
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+void vtkOccupancyGridAccumulator::ResetAccumulation()
+{
+  this->Grid.Clear();
+  this->LastFrameMTime = 0;
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+int vtkOccupancyGridAccumulator::FillInputPortInformation(int port, vtkInformation* info)
+{
+  if (port == 0)
+  {
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+    return 1;
+  }
+  if (port == 1)
+  {
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+    info->Set(vtkAlgorithm::INPUT_IS_OPTIONAL(), 1);
+    return 1;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int vtkOccupancyGridAccumulator::RequestData(vtkInformation* vtkNotUsed(request),
+                                             vtkInformationVector** inputVector,
+                                             vtkInformationVector* outputVector)
+{
+  // Get the inputs
+  vtkPolyData* pointcloud = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
+  vtkPolyData* trajectoryPoly = vtkPolyData::GetData(inputVector[1], 0);
+  vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
+
+  // going back in time restarts the accumulation
+  double frameTime = 0.0;
+  if (inInfo->Has(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP()))
+  {
+    frameTime = inInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP());
+    if (this->LastFrameMTime != 0 && frameTime < this->LastFrameTime)
+    {
+      this->Grid.Clear();
+      this->LastFrameMTime = 0;
+    }
+  }
+
+  // only add the frames that have not been added yet
+  if (pointcloud->GetMTime() != this->LastFrameMTime)
+  {
+    vtkSmartPointer<vtkTransform> pose;
+    if (trajectoryPoly && trajectoryPoly->GetNumberOfPoints() > 0)
+    {
+      // Fill the interpolator
+      if (this->Interpolator->GetNumberOfTransforms() == 0)
+      {
+        auto trajectory = vtkTemporalTransforms::CreateFromPolyData(trajectoryPoly);
+        auto type = this->Interpolator->GetInterpolationType();
+        this->Interpolator = trajectory->CreateInterpolator();
+        this->Interpolator->SetInterpolationType(type);
+      }
+      pose = vtkSmartPointer<vtkTransform>::New();
+      this->Interpolator->InterpolateTransform(frameTime, pose);
+      pose->Update();
+    }
+
+    // the sensor is at the origin of its frame
+    double origin[3] = { 0.0, 0.0, 0.0 };
+    std::vector<double> points(3 * pointcloud->GetNumberOfPoints());
+    double* point = points.data();
+    for (vtkIdType i = 0; i < pointcloud->GetNumberOfPoints(); ++i, point += 3)
+    {
+      pointcloud->GetPoint(i, point);
+      if (pose)
+      {
+        pose->InternalTransformPoint(point, point);
+      }
+    }
+    if (pose)
+    {
+      pose->InternalTransformPoint(origin, origin);
+    }
+
+    this->Grid.InsertScan(origin, points, this->NumberOfThreads);
+    this->LastFrameMTime = pointcloud->GetMTime();
+    this->LastFrameTime = frameTime;
+  }
+
+  this->FillOutput(vtkPolyData::GetData(outputVector));
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkOccupancyGridAccumulator::FillOutput(vtkPolyData* output) const
+{
+  output->Initialize();
+
+  // the threshold is compared to the log-odds, which avoids an exponential per cell
+  const double threshold = std::min(std::max(this->OccupancyThreshold, 1e-6), 1.0 - 1e-6);
+  const float minLogOdds = this->OccupancyThreshold > 0.0
+    ? static_cast<float>(std::log(threshold / (1.0 - threshold)))
+    : -std::numeric_limits<float>::infinity();
+  std::vector<float> coordinates;
+  std::vector<float> probabilities;
+  this->Grid.ForEachObservedCell([&](const double center[3], float logOdds)
+  {
+    if (logOdds >= minLogOdds)
+    {
+      coordinates.insert(coordinates.end(), center, center + 3);
+      probabilities.push_back(static_cast<float>(OccupancyGrid::Probability(logOdds)));
+    }
+  });
+  const vtkIdType nbPoints = static_cast<vtkIdType>(probabilities.size());
+
+  vtkNew<vtkPoints> points;
+  points->SetDataTypeToFloat();
+  points->SetNumberOfPoints(nbPoints);
+  std::copy(coordinates.begin(), coordinates.end(), static_cast<float*>(points->GetVoidPointer(0)));
+  vtkNew<vtkFloatArray> occupancy;
+  occupancy->SetName("occupancy");
+  occupancy->SetNumberOfTuples(nbPoints);
+  std::copy(probabilities.begin(), probabilities.end(), occupancy->GetPointer(0));
+  vtkNew<vtkIdTypeArray> connectivity;
+  connectivity->SetNumberOfValues(2 * nbPoints);
+  vtkIdType* cell = connectivity->GetPointer(0);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    cell[2 * i] = 1;
+    cell[2 * i + 1] = i;
+  }
+
+  vtkNew<vtkCellArray> verts;
+  verts->SetCells(nbPoints, connectivity.GetPointer());
+  output->SetPoints(points.GetPointer());
+  output->SetVerts(verts.GetPointer());
+  output->GetPointData()->AddArray(occupancy.GetPointer());
+  output->GetPointData()->SetActiveScalars("occupancy");
+}
@@ -0,0 +1,159 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VTK_OCCUPANCY_GRID_ACCUMULATOR_H
+#define VTK_OCCUPANCY_GRID_ACCUMULATOR_H
+
+#include <vtkPolyDataAlgorithm.h>
+#include <vtkSmartPointer.h>
+
+#include "OccupancyGrid.h"
+#include "vtkCustomTransformInterpolator.h"
+
+/**
+ * @brief The vtkOccupancyGridAccumulator accumulates the successive frames of its
+ * input into a sparse 2D or 3D log-odds occupancy grid. It takes 2 inputs: the point
+ * cloud and an optional vtkTemporalTransforms giving the pose of the sensor at the
+ * time of each frame. Without trajectory the frames are expected in world coordinates,
+ * the sensor being at the origin.
+ *
+ * Each new frame casts a ray from the sensor to each of its points: the cell of the
+ * point becomes more likely occupied and the cells crossed by the ray more likely
+ * free, see OccupancyGrid. The output holds a point at the center of each observed
+ * cell whose occupancy probability reaches OccupancyThreshold.
+ */
+class VTK_EXPORT vtkOccupancyGridAccumulator : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkOccupancyGridAccumulator* New();
+  vtkTypeMacro(vtkOccupancyGridAccumulator, vtkPolyDataAlgorithm)
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  //@{
+  /**
+   * @brief Size of the edges of the cells, in meters. Changing it resets the accumulation
+   */
+  double GetVoxelSize() const { return this->Grid.GetVoxelSize(); }
+  void SetVoxelSize(double value);
+  //@}
+
+  //@{
+  /**
+   * @brief Cast the rays in the horizontal plane to build a 2D grid.
+   * Changing it resets the accumulation
+   */
+  bool GetTwoDimensional() const { return this->Grid.GetTwoDimensional(); }
+  void SetTwoDimensional(bool value);
+  //@}
+
+  //@{
+  /**
+   * @brief Log-odds added to the cells hit by a point, and to the cells crossed by a ray
+   */
+  double GetHitLogOdds() const { return this->Grid.GetHitLogOdds(); }
+  void SetHitLogOdds(double value);
+  double GetMissLogOdds() const { return this->Grid.GetMissLogOdds(); }
+  void SetMissLogOdds(double value);
+  //@}
+
+  //@{
+  /**
+   * @brief Bounds of the log-odds of the cells
+   */
+  double GetMinLogOdds() const { return this->Grid.GetMinLogOdds(); }
+  void SetMinLogOdds(double value);
+  double GetMaxLogOdds() const { return this->Grid.GetMaxLogOdds(); }
+  void SetMaxLogOdds(double value);
+  //@}
+
+  //@{
+  /**
+   * @brief Distance at which the rays are cut, in meters
+   */
+  double GetMaxRange() const { return this->Grid.GetMaxRange(); }
+  void SetMaxRange(double value);
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkOccupancyGridAccumulator::OccupancyThreshold
+   */
+  vtkGetMacro(OccupancyThreshold, double)
+  vtkSetClampMacro(OccupancyThreshold, double, 0.0, 1.0)
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkOccupancyGridAccumulator::NumberOfThreads
+   */
+  vtkGetMacro(NumberOfThreads, unsigned int)
+  vtkSetMacro(NumberOfThreads, unsigned int)
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkOccupancyGridAccumulator::InterpolationType
+   */
+  int GetInterpolationType() { return this->Interpolator->GetInterpolationType(); }
+  void SetInterpolationType(int value) { this->Interpolator->SetInterpolationType(value); }
+  //@}
+
+  /**
+   * @brief Remove all the accumulated cells
+   */
+  void ResetAccumulation();
+
+  /**
+   * @brief Override GetMTime() because we depend on the TransformInterpolator
+   * which may be modified outside of this class.
+   */
+  vtkMTimeType GetMTime() override;
+
+protected:
+  vtkOccupancyGridAccumulator();
+
+  int FillInputPortInformation(int port, vtkInformation* info) override;
+  int RequestData(vtkInformation* request,
+                  vtkInformationVector** inputVector,
+                  vtkInformationVector* outputVector) override;
+
+private:
+  //! Fill the output with a point per occupied cell
+  void FillOutput(vtkPolyData* output) const;
+
+  //! The accumulated cells
+  OccupancyGrid Grid;
+
+  //! Minimal occupancy probability of the cells in the output, 0 to output all the
+  //! observed cells, the free ones included
+  double OccupancyThreshold = 0.5;
+
+  //! Number of threads casting the rays, 0 to use all the cores
+  unsigned int NumberOfThreads = 0;
+
+  //! Modification time of the last frame added, to avoid adding the same frame
+  //! twice when the filter re-executes without a new frame
+  vtkMTimeType LastFrameMTime = 0;
+
+  //! Pipeline time of the last frame added, going back in time resets the accumulation
+  double LastFrameTime = 0.0;
+
+  //! Interpolator used to get the pose of the sensor
+  vtkSmartPointer<vtkCustomTransformInterpolator> Interpolator;
+
+  vtkOccupancyGridAccumulator(const vtkOccupancyGridAccumulator&) /*= delete*/;
+  void operator =(const vtkOccupancyGridAccumulator&) /*= delete*/;
+};
+
+#endif // VTK_OCCUPANCY_GRID_ACCUMULATOR_H
@@ -14,16 +14,21 @@
 
 #include "vtkPlaneFitter.h"
 
-#include "vtkDoubleArray.h"
-#include "vtkNew.h"
+#include "vtkDataArray.h"
+#include "vtkIdList.h"
 #include "vtkObjectFactory.h"
+#include "vtkPointData.h"
 #include "vtkPointSet.h"
-#include "vtkSmartPointer.h"
-#include "vtkThreshold.h"
-#include "vtkUnstructuredGrid.h"
+#include "vtkPoints.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPTools.h"
 
 #include <Eigen/Dense>
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 //-----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkPlaneFitter);
 
@@ -43,96 +48,133 @@ void vtkPlaneFitter::PrintSelf(ostream& os, vtkIndent indent)
   this->Superclass::PrintSelf(os, indent);
 }
 
+//-----------------------------------------------------------------------------
+namespace
+{
+//! Sum of the points and of their outer products, relatively to a reference
+//! point close to them so that the scatter matrix does not lose precision
+struct ScatterSums
+{
+  Eigen::Vector3d Sum = Eigen::Vector3d::Zero();
+  Eigen::Matrix3d Outer = Eigen::Matrix3d::Zero();
+};
+}
+
 //-----------------------------------------------------------------------------
 void vtkPlaneFitter::PlaneFit(vtkPointSet* pts, double origin[3], double normal[3], double& minDist,
   double& maxDist, double& stdDev, double channelMean[], double channelStdDev[],
   vtkIdType channelNpts[], unsigned int nchannels)
 {
-  using namespace Eigen;
-
-  vtkSmartPointer<vtkDoubleArray> ptdata = vtkSmartPointer<vtkDoubleArray>::New();
-  ptdata->DeepCopy(pts->GetPoints()->GetData());
+  vtkPlaneFitter::PlaneFit(pts, nullptr, origin, normal, minDist, maxDist, stdDev, channelMean,
+    channelStdDev, channelNpts, nchannels);
+}
 
-  const vtkIdType n = ptdata->GetNumberOfTuples();
+//-----------------------------------------------------------------------------
+void vtkPlaneFitter::PlaneFit(vtkPointSet* pts, vtkIdList* ids, double origin[3], double normal[3],
+  double& minDist, double& maxDist, double& stdDev, double channelMean[], double channelStdDev[],
+  vtkIdType channelNpts[], unsigned int nchannels)
+{
+  vtkPoints* points = pts->GetPoints();
+  if (!points)
+  {
+    return;
+  }
+  const vtkIdType n = ids ? ids->GetNumberOfIds() : points->GetNumberOfPoints();
   if (n < 1)
   {
     return;
   }
-
-  assert(ptdata->GetNumberOfComponents() == 3);
-  Map<MatrixXd> eigpointsraw(static_cast<double*>(ptdata->GetVoidPointer(0)),
-    ptdata->GetNumberOfComponents(), ptdata->GetNumberOfTuples());
-
-  MatrixXd eigpoints = eigpointsraw.transpose();
-
-  VectorXd mean(3);
-
-  mean = eigpoints.colwise().sum() / n;
-  assert(mean.size() == 3);
-
-  for (int i = 0; i < 3; ++i)
+  auto pointId = [ids](vtkIdType k) { return ids ? ids->GetId(k) : k; };
+
+  // The points are read in place, the plane is the one through their
+  // mean orthogonal to the smallest principal axis of their scatter
+  double p[3];
+  points->GetPoint(pointId(0), p);
+  const Eigen::Vector3d reference(p[0], p[1], p[2]);
+  vtkSMPThreadLocal<ScatterSums> localSums;
+  vtkSMPTools::For(0, n, [&](vtkIdType begin, vtkIdType end)
   {
-    origin[i] = mean[i];
+    ScatterSums& sums = localSums.Local();
+    double q[3];
+    for (vtkIdType k = begin; k < end; ++k)
+    {
+      points->GetPoint(pointId(k), q);
+      const Eigen::Vector3d shifted = Eigen::Vector3d(q[0], q[1], q[2]) - reference;
+      sums.Sum += shifted;
+      sums.Outer.noalias() += shifted * shifted.transpose();
+    }
+  });
+  ScatterSums sums;
+  for (auto it = localSums.begin(); it != localSums.end(); ++it)
+  {
+    sums.Sum += it->Sum;
+    sums.Outer += it->Outer;
   }
-
-  eigpoints.rowwise() -= mean.transpose();
-
-  JacobiSVD<MatrixXd> svd(eigpoints, ComputeThinU | ComputeThinV);
-
-  VectorXd enormal = svd.matrixV().col(2);
-  assert(enormal.size() == 3);
-  assert(std::fabs(enormal.norm() - 1.0) < 1.0e-8);
+  const Eigen::Vector3d mean = reference + sums.Sum / n;
+  const Eigen::Matrix3d scatter = sums.Outer - sums.Sum * sums.Sum.transpose() / n;
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eig(scatter);
+  const Eigen::Vector3d enormal = eig.eigenvectors().col(0);
 
   for (int i = 0; i < 3; ++i)
   {
+    origin[i] = mean[i];
     normal[i] = enormal[i];
   }
 
-  VectorXd distances = eigpoints * enormal;
-  assert(distances.size() == n);
-
-  minDist = distances.minCoeff();
-  maxDist = distances.maxCoeff();
-
-  stdDev = std::sqrt(distances.squaredNorm() / (n - 1));
-
-  for (unsigned int i = 0; i < nchannels; ++i)
+  // Signed distances to the plane, and indices of the points of each laser
+  std::vector<double> distances(n);
+  std::vector<std::vector<vtkIdType> > channelIds(nchannels);
+  vtkDataArray* laserIds = pts->GetPointData()->GetArray("laser_id");
+  double squaredSum = 0.0;
+  minDist = VTK_DOUBLE_MAX;
+  maxDist = VTK_DOUBLE_MIN;
+  for (vtkIdType k = 0; k < n; ++k)
   {
-    vtkNew<vtkThreshold> threshold;
-    threshold->ThresholdBetween(i, i);
-    threshold->SetInputData(pts);
-    threshold->SetInputArrayToProcess(0, 0, 0, vtkDataObject::FIELD_ASSOCIATION_POINTS, "laser_id");
-    threshold->SetOutputPointsPrecision(vtkAlgorithm::DEFAULT_PRECISION);
-    threshold->Update();
-
-    channelNpts[i] = threshold->GetOutput()->GetNumberOfPoints();
-
-    vtkSmartPointer<vtkDoubleArray> threshdata = vtkSmartPointer<vtkDoubleArray>::New();
-    threshdata->DeepCopy(threshold->GetOutput()->GetPoints()->GetData());
-
-    const vtkIdType n = threshdata->GetNumberOfTuples();
-    if (n < 2)
+    const vtkIdType id = pointId(k);
+    points->GetPoint(id, p);
+    distances[k] = (Eigen::Vector3d(p[0], p[1], p[2]) - mean).dot(enormal);
+    minDist = std::min(minDist, distances[k]);
+    maxDist = std::max(maxDist, distances[k]);
+    squaredSum += distances[k] * distances[k];
+    if (laserIds)
     {
-      channelMean[i] = 0.0;
-      channelStdDev[i] = 0.0;
-      continue;
+      const double laserId = laserIds->GetComponent(id, 0);
+      if (laserId >= 0 && laserId < nchannels && laserId == std::floor(laserId))
+      {
+        channelIds[static_cast<unsigned int>(laserId)].push_back(k);
+      }
     }
-
-    assert(threshdata->GetNumberOfComponents() == 3);
-    assert(threshdata->GetNumberOfTuples() >= 2);
-    Map<MatrixXd> channelraw(static_cast<double*>(threshdata->GetVoidPointer(0)),
-      threshdata->GetNumberOfComponents(), threshdata->GetNumberOfTuples());
-
-    MatrixXd channelpts = channelraw.transpose();
-    channelpts.rowwise() -= mean.transpose();
-
-    VectorXd channelds = channelpts * enormal;
-
-    double cmean = channelds.sum() / channelds.size();
-    double cstddev =
-      std::sqrt((channelds.array() - cmean).matrix().squaredNorm() / (channelds.size() - 1));
-
-    channelMean[i] = cmean;
-    channelStdDev[i] = cstddev;
   }
+  stdDev = (n > 1) ? std::sqrt(squaredSum / (n - 1)) : 0.0;
+
+  // The lasers are independent, their statistics are computed in parallel
+  vtkSMPTools::For(0, static_cast<vtkIdType>(nchannels), [&](vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      const std::vector<vtkIdType>& channel = channelIds[i];
+      channelNpts[i] = static_cast<vtkIdType>(channel.size());
+      if (channel.size() < 2)
+      {
+        channelMean[i] = 0.0;
+        channelStdDev[i] = 0.0;
+        continue;
+      }
+
+      double sum = 0.0;
+      for (vtkIdType k : channel)
+      {
+        sum += distances[k];
+      }
+      const double cmean = sum / channel.size();
+      double squaredDeviations = 0.0;
+      for (vtkIdType k : channel)
+      {
+        squaredDeviations += (distances[k] - cmean) * (distances[k] - cmean);
+      }
+
+      channelMean[i] = cmean;
+      channelStdDev[i] = std::sqrt(squaredDeviations / (channel.size() - 1));
+    }
+  });
 }
@@ -21,6 +21,7 @@
 
 #include <vtkObject.h>
 
+class vtkIdList;
 class vtkPointSet;
 
 class VTK_EXPORT vtkPlaneFitter : public vtkObject
@@ -31,10 +32,21 @@ public:
 
   virtual void PrintSelf(ostream& os, vtkIndent indent);
 
+  // Fit a plane to the points, and compute the mean and the standard
+  // deviation of the distances to this plane of the points of each of
+  // the nchannels lasers, given by their "laser_id" array. The points
+  // are not copied and the lasers are processed in parallel
   static void PlaneFit(vtkPointSet* pts, double origin[3], double normal[3], double& minDist,
     double& maxDist, double& stdDev, double channelMean[], double channelStdDev[],
     vtkIdType channelNpts[], unsigned int nchannels);
 
+  // Same as above for the points of pts whose ids are in ids, or all the
+  // points if ids is null. The mean and the scatter matrix of the points
+  // are accumulated in parallel
+  static void PlaneFit(vtkPointSet* pts, vtkIdList* ids, double origin[3], double normal[3],
+    double& minDist, double& maxDist, double& stdDev, double channelMean[],
+    double channelStdDev[], vtkIdType channelNpts[], unsigned int nchannels);
+
 protected:
   vtkPlaneFitter();
   virtual ~vtkPlaneFitter();
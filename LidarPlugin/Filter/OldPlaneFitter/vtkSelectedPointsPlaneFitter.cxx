@@ -0,0 +1,206 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "vtkSelectedPointsPlaneFitter.h"
+#include "vtkPlaneFitter.h"
+
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkExtractSelection.h>
+#include <vtkIdList.h>
+#include <vtkIdTypeArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkIntArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPointSet.h>
+#include <vtkSelection.h>
+#include <vtkSmartPointer.h>
+#include <vtkTable.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSelectedPointsPlaneFitter)
+
+//-----------------------------------------------------------------------------
+vtkSelectedPointsPlaneFitter::vtkSelectedPointsPlaneFitter()
+{
+  this->SetNumberOfInputPorts(2);
+}
+
+//-----------------------------------------------------------------------------
+int vtkSelectedPointsPlaneFitter::FillInputPortInformation(int port, vtkInformation* info)
+{
+  if (port == 0)
+  {
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPointSet");
+    return 1;
+  }
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkSelection");
+  info->Set(vtkAlgorithm::INPUT_IS_OPTIONAL(), 1);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkSelectedPointsPlaneFitter::GetSelectedPoints(vtkPointSet* input, vtkSelection* selection,
+                                                     vtkIdList* ids)
+{
+  const vtkIdType nbPoints = input->GetNumberOfPoints();
+  ids->Reset();
+  if (!selection)
+  {
+    ids->SetNumberOfIds(nbPoints);
+    for (vtkIdType i = 0; i < nbPoints; ++i)
+    {
+      ids->SetId(i, i);
+    }
+    return;
+  }
+
+  // With PreserveTopology the extraction only flags the selected points or
+  // cells of a shallow copy of the input with a vtkInsidedness array
+  vtkSmartPointer<vtkPointSet> frame;
+  frame.TakeReference(input->NewInstance());
+  frame->ShallowCopy(input);
+  vtkNew<vtkExtractSelection> extractor;
+  extractor->PreserveTopologyOn();
+  extractor->SetInputData(0, frame);
+  extractor->SetInputData(1, selection);
+  extractor->Update();
+  vtkDataSet* flagged = vtkDataSet::SafeDownCast(extractor->GetOutputDataObject(0));
+  if (!flagged)
+  {
+    return;
+  }
+
+  vtkDataArray* pointInside = flagged->GetPointData()->GetArray("vtkInsidedness");
+  if (pointInside)
+  {
+    for (vtkIdType i = 0; i < nbPoints; ++i)
+    {
+      if (pointInside->GetComponent(i, 0) > 0)
+      {
+        ids->InsertNextId(i);
+      }
+    }
+    return;
+  }
+
+  vtkDataArray* cellInside = flagged->GetCellData()->GetArray("vtkInsidedness");
+  if (cellInside)
+  {
+    std::vector<bool> selected(nbPoints, false);
+    vtkNew<vtkIdList> cellPoints;
+    for (vtkIdType c = 0; c < flagged->GetNumberOfCells(); ++c)
+    {
+      if (cellInside->GetComponent(c, 0) > 0)
+      {
+        flagged->GetCellPoints(c, cellPoints.GetPointer());
+        for (vtkIdType k = 0; k < cellPoints->GetNumberOfIds(); ++k)
+        {
+          selected[cellPoints->GetId(k)] = true;
+        }
+      }
+    }
+    for (vtkIdType i = 0; i < nbPoints; ++i)
+    {
+      if (selected[i])
+      {
+        ids->InsertNextId(i);
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkSelectedPointsPlaneFitter::RequestData(vtkInformation* vtkNotUsed(request),
+                                              vtkInformationVector** inputVector,
+                                              vtkInformationVector* outputVector)
+{
+  vtkPointSet* input = vtkPointSet::GetData(inputVector[0]->GetInformationObject(0));
+  vtkSelection* selection = (inputVector[1]->GetNumberOfInformationObjects() > 0) ?
+    vtkSelection::GetData(inputVector[1]->GetInformationObject(0)) : nullptr;
+  vtkTable* output = vtkTable::GetData(outputVector);
+
+  // Output columns
+  vtkNew<vtkIntArray> channel;
+  channel->SetName("channel");
+  output->AddColumn(channel.GetPointer());
+  const char* names[] = { "originx", "originy", "originz", "normalx", "normaly", "normalz",
+                          "mean", "stddev", "RMS" };
+  std::vector<vtkDoubleArray*> columns;
+  for (const char* name : names)
+  {
+    vtkNew<vtkDoubleArray> column;
+    column->SetName(name);
+    output->AddColumn(column.GetPointer());
+    columns.push_back(column.GetPointer());
+  }
+  vtkNew<vtkIdTypeArray> npts;
+  npts->SetName("npts");
+  output->AddColumn(npts.GetPointer());
+
+  vtkNew<vtkIdList> ids;
+  this->GetSelectedPoints(input, selection, ids.GetPointer());
+  if (ids->GetNumberOfIds() == 0)
+  {
+    vtkWarningMacro("No point selected, no plane fitted");
+    return 1;
+  }
+
+  unsigned int nchannels = 0;
+  vtkDataArray* laserIds = input->GetPointData()->GetArray("laser_id");
+  if (laserIds && laserIds->GetNumberOfTuples() > 0)
+  {
+    nchannels = static_cast<unsigned int>(std::max(0.0, laserIds->GetRange(0)[1]) + 1);
+  }
+
+  double origin[3] = { 0.0, 0.0, 0.0 }, normal[3] = { 0.0, 0.0, 1.0 };
+  double minDist = 0.0, maxDist = 0.0, stdDev = 0.0;
+  std::vector<double> channelMean(nchannels), channelStdDev(nchannels);
+  std::vector<vtkIdType> channelNpts(nchannels);
+  vtkPlaneFitter::PlaneFit(input, ids.GetPointer(), origin, normal, minDist, maxDist, stdDev,
+                           channelMean.data(), channelStdDev.data(), channelNpts.data(), nchannels);
+
+  // One row for all the points, then one per laser
+  const double nan = vtkMath::Nan();
+  output->SetNumberOfRows(nchannels + 1);
+  for (unsigned int row = 0; row <= nchannels; ++row)
+  {
+    const bool overall = (row == 0);
+    const vtkIdType count = overall ? ids->GetNumberOfIds() : channelNpts[row - 1];
+    const double mean = overall ? 0.0 : channelMean[row - 1];
+    const double deviation = overall ? stdDev : channelStdDev[row - 1];
+    const double values[] = { origin[0], origin[1], origin[2], normal[0], normal[1], normal[2],
+                              mean, deviation, std::sqrt(mean * mean + deviation * deviation) };
+    channel->SetValue(row, static_cast<int>(row) - 1);
+    for (size_t k = 0; k < columns.size(); ++k)
+    {
+      columns[k]->SetValue(row, (count == 0 && k >= 6) ? nan : values[k]);
+    }
+    npts->SetValue(row, count);
+  }
+  return 1;
+}
@@ -0,0 +1,70 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTK_SELECTED_POINTS_PLANE_FITTER_H
+#define VTK_SELECTED_POINTS_PLANE_FITTER_H
+
+#include <vtkTableAlgorithm.h>
+
+class vtkIdList;
+class vtkPointSet;
+class vtkSelection;
+
+/**
+ * @brief The vtkSelectedPointsPlaneFitter fits a plane to the selected points
+ * of a frame and gives the distances of the points of each laser to this plane.
+ *
+ * The selection, on the second input, is only used to find the ids of the selected
+ * points, which are then read in place in the frame by vtkPlaneFitter, so that no
+ * point is copied. A cell selection selects the points of the selected cells. Without
+ * selection, all the points are fitted.
+ *
+ * The output table has a first row for all the points, with channel -1, then one row
+ * per laser_id up to the largest one of the frame: the origin and normal of the plane,
+ * the mean, standard deviation and RMS of the distances to the plane and the number of
+ * points. The statistics of a laser without points are NaN.
+ */
+class VTK_EXPORT vtkSelectedPointsPlaneFitter : public vtkTableAlgorithm
+{
+public:
+  static vtkSelectedPointsPlaneFitter* New();
+  vtkTypeMacro(vtkSelectedPointsPlaneFitter, vtkTableAlgorithm)
+
+  //! Set the selection of the fitted points, on the second input port
+  void SetSelectionConnection(vtkAlgorithmOutput* algOutput)
+  {
+    this->SetInputConnection(1, algOutput);
+  }
+
+protected:
+  vtkSelectedPointsPlaneFitter();
+
+  int FillInputPortInformation(int port, vtkInformation* info) override;
+
+  int RequestData(vtkInformation* request,
+                  vtkInformationVector** inputVector,
+                  vtkInformationVector* outputVector) override;
+
+private:
+  //! Fill ids with the points of input selected by selection
+  void GetSelectedPoints(vtkPointSet* input, vtkSelection* selection, vtkIdList* ids);
+
+  vtkSelectedPointsPlaneFitter(const vtkSelectedPointsPlaneFitter&) /*= delete*/;
+  void operator =(const vtkSelectedPointsPlaneFitter&) /*= delete*/;
+};
+
+#endif // VTK_SELECTED_POINTS_PLANE_FITTER_H
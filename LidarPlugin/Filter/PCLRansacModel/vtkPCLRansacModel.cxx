@@ -16,6 +16,7 @@
 // local includes
 #include "vtkPCLRansacModel.h"
 #include "vtkPCLConversions.h"
+#include "ParallelFor.h"
 
 // vtk includes
 #include <vtkCellArray.h>
@@ -24,6 +25,7 @@
 #include <vtkDataSet.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
+#include <vtkIntArray.h>
 #include <vtkNew.h>
 #include <vtkPointData.h>
 #include <vtkPoints.h>
@@ -33,7 +35,8 @@
 #include <vtkUnsignedIntArray.h>
 
 // pcl includes
-#include <pcl/point_types.h>
+#include <pcl/features/normal_3d_omp.h>
+#include <pcl/search/kdtree.h>
 #include <pcl/sample_consensus/ransac.h>
 #include <pcl/sample_consensus/sac_model_circle.h>
 #include <pcl/sample_consensus/sac_model_circle3d.h>
@@ -43,11 +46,75 @@
 #include <pcl/sample_consensus/sac_model_line.h>
 #include <pcl/sample_consensus/sac_model_plane.h>
 
+// std includes
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <random>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Instantiate the model on some points of the cloud, nullptr if unknown
+pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr CreateModel(int modelType,
+  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud, const std::vector<int>& indices,
+  pcl::PointCloud<pcl::Normal>::Ptr normals, double normalDistanceWeight)
+{
+  pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr model;
+  switch (modelType)
+  {
+    case vtkPCLRansacModel::Circle2D:
+      model.reset(new pcl::SampleConsensusModelCircle2D<pcl::PointXYZ>(cloud, indices));
+      break;
+
+    case vtkPCLRansacModel::Circle3D:
+      model.reset(new pcl::SampleConsensusModelCircle3D<pcl::PointXYZ>(cloud, indices));
+      break;
+
+    case vtkPCLRansacModel::Cone:
+    {
+      auto cone = new pcl::SampleConsensusModelCone<pcl::PointXYZ, pcl::Normal>(cloud, indices);
+      cone->setInputNormals(normals);
+      cone->setNormalDistanceWeight(normalDistanceWeight);
+      model.reset(cone);
+      break;
+    }
+
+    case vtkPCLRansacModel::Cylinder:
+    {
+      auto cylinder = new pcl::SampleConsensusModelCylinder<pcl::PointXYZ, pcl::Normal>(cloud, indices);
+      cylinder->setInputNormals(normals);
+      cylinder->setNormalDistanceWeight(normalDistanceWeight);
+      model.reset(cylinder);
+      break;
+    }
+
+    case vtkPCLRansacModel::Shpere:
+      model.reset(new pcl::SampleConsensusModelSphere<pcl::PointXYZ>(cloud, indices));
+      break;
+
+    case vtkPCLRansacModel::Line:
+      model.reset(new pcl::SampleConsensusModelLine<pcl::PointXYZ>(cloud, indices));
+      break;
+
+    case vtkPCLRansacModel::Plane:
+      model.reset(new pcl::SampleConsensusModelPlane<pcl::PointXYZ>(cloud, indices));
+      break;
+
+    default:
+      break;
+  }
+  return model;
+}
+}
+
 // Implementation of the New function
 vtkStandardNewMacro(vtkPCLRansacModel);
 
 //----------------------------------------------------------------------------
 vtkPCLRansacModel::vtkPCLRansacModel()
+  : DistanceThreshold(0.2)
+  , ModelType(vtkPCLRansacModel::Line)
 {
 
 }
@@ -71,87 +138,111 @@ int vtkPCLRansacModel::RequestData(vtkInformation *vtkNotUsed(request),
 
   // Get the input
   vtkPolyData * input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
-  
-  // Convert input data in pcl format
-  pcl::PointCloud<pcl::PointXYZ>::Ptr pointCloud = vtkPCLConversions::PointCloudFromPolyData(input);
 
-  // inliers's index according to the model and threshold
-  std::vector<int> inliers;
-
-  // instantiate the model
-  pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr RANSACModel;
-
-  switch (ModelType) {
-
-    case vtkPCLRansacModel::Circle2D:
-      RANSACModel = pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr(
-            new pcl::SampleConsensusModelCircle2D<pcl::PointXYZ> (pointCloud));
-      break;
-
-    case vtkPCLRansacModel::Circle3D:
-      RANSACModel = pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr(
-            new pcl::SampleConsensusModelCircle3D<pcl::PointXYZ> (pointCloud));
-      break;
-
-// The Cone Model and the Cylinder Model require to compute the normal, so this is not wrap
-//    case vtkPCLRansacModel::Cone:
-//      RANSACModel = pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr(
-//            new pcl::SampleConsensusModelCone<pcl::PointXYZ, pcl::Normal> (pointCloud));
-//      break;
-
-//    case vtkPCLRansacModel::Cylinder:
-//      RANSACModel = pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr(
-//            new pcl::SampleConsensusModelCylinder<pcl::PointXYZ, pcl::Normal> (pointCloud));
-//      break;
-
-    case vtkPCLRansacModel::Shpere:
-      RANSACModel = pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr(
-            new pcl::SampleConsensusModelSphere<pcl::PointXYZ> (pointCloud));
-      break;
-
-    case vtkPCLRansacModel::Line:
-      RANSACModel = pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr(
-            new pcl::SampleConsensusModelLine<pcl::PointXYZ> (pointCloud));
-      break;
+  // Convert input data in pcl format, only when the input changed
+  // since the interactive changes of the parameters keep the input
+  if (!this->Cloud || this->CloudTime != input->GetMTime())
+  {
+    this->Cloud = vtkPCLConversions::PointCloudFromPolyData(input);
+    this->CloudTime = input->GetMTime();
+    this->Normals.reset();
+  }
+  pcl::PointCloud<pcl::PointXYZ>::Ptr pointCloud = this->Cloud;
 
-    case vtkPCLRansacModel::Plane:
-      RANSACModel = pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr(
-            new pcl::SampleConsensusModelLine<pcl::PointXYZ> (pointCloud));
-      break;
+  // The cone and cylinder models require the normals
+  const bool requireNormals = this->ModelType == vtkPCLRansacModel::Cone ||
+                              this->ModelType == vtkPCLRansacModel::Cylinder;
+  if (requireNormals &&
+      (!this->Normals || this->NormalsNumberOfNeighborsUsed != this->NormalsNumberOfNeighbors))
+  {
+    pcl::NormalEstimationOMP<pcl::PointXYZ, pcl::Normal> normalEstimation;
+    if (this->NumberOfThreads > 0)
+    {
+      normalEstimation.setNumberOfThreads(this->NumberOfThreads);
+    }
+    normalEstimation.setSearchMethod(pcl::search::KdTree<pcl::PointXYZ>::Ptr(new pcl::search::KdTree<pcl::PointXYZ>));
+    normalEstimation.setKSearch(this->NormalsNumberOfNeighbors);
+    normalEstimation.setInputCloud(pointCloud);
+    this->Normals.reset(new pcl::PointCloud<pcl::Normal>);
+    normalEstimation.compute(*this->Normals);
+    this->NormalsNumberOfNeighborsUsed = this->NormalsNumberOfNeighbors;
+  }
 
-    default:
-      cerr << "No model : " << ModelType << endl;
+  const unsigned int numberOfThreads =
+    Parallel::GetNumberOfThreads(static_cast<unsigned int>(std::max(0, this->NumberOfThreads)));
+
+  // Index of the model of each point, -1 for the outliers
+  vtkSmartPointer<vtkIntArray> modelArray = vtkSmartPointer<vtkIntArray>::New();
+  modelArray->SetName("model");
+  modelArray->SetNumberOfTuples(input->GetNumberOfPoints());
+  modelArray->FillComponent(0, -1);
+
+  // The models are extracted one after another from the remaining points.
+  // For each model the hypotheses are split among several independent
+  // random consensus, run in parallel, and the best model is kept
+  std::vector<int> remaining(pointCloud->size());
+  std::iota(remaining.begin(), remaining.end(), 0);
+  if (!CreateModel(this->ModelType, pointCloud, remaining, this->Normals, this->NormalDistanceWeight))
+  {
+    vtkErrorMacro(<< "No model : " << this->ModelType);
+    return 0;
+  }
+  for (int modelIndex = 0; modelIndex < this->NumberOfModels; ++modelIndex)
+  {
+    std::vector<std::vector<int> > inliers(numberOfThreads);
+    Parallel::ForEachPart(std::max(1, this->MaxIterations), numberOfThreads,
+                          [&](unsigned int thread, size_t begin, size_t end)
+    {
+      // pcl seeds the samples of all the models the same way, each thread
+      // samples among the remaining points shuffled in its own order
+      std::vector<int> indices = remaining;
+      std::shuffle(indices.begin(), indices.end(), std::mt19937(thread));
+      pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr model =
+        CreateModel(this->ModelType, pointCloud, indices, this->Normals, this->NormalDistanceWeight);
+      if (!model)
+      {
+        return;
+      }
+      pcl::RandomSampleConsensus<pcl::PointXYZ> ransac(model);
+      ransac.setDistanceThreshold(this->DistanceThreshold);
+      ransac.setMaxIterations(std::max(1, static_cast<int>(end - begin)));
+      if (ransac.computeModel())
+      {
+        ransac.getInliers(inliers[thread]);
+      }
+    });
+
+    const std::vector<int>& best = *std::max_element(inliers.begin(), inliers.end(),
+      [](const std::vector<int>& a, const std::vector<int>& b) { return a.size() < b.size(); });
+    if (best.empty())
+    {
       break;
+    }
+    std::cout << "Inliers size of model " << modelIndex << " : " << best.size() << std::endl;
+    for (int index : best)
+    {
+      modelArray->SetValue(index, modelIndex);
+    }
+    remaining.erase(std::remove_if(remaining.begin(), remaining.end(),
+      [&modelArray](int index) { return modelArray->GetValue(index) >= 0; }), remaining.end());
   }
 
-  // Instanciate and launch the random consensus
-  pcl::RandomSampleConsensus<pcl::PointXYZ> ransac (RANSACModel);
-  ransac.setDistanceThreshold (this->DistanceThreshold);
-  ransac.computeModel(); // compute ransac
-  ransac.getInliers(inliers); // get inlier list
-  std::cout << "Inliers size : " << inliers.size() << std::endl;
   // Add inlier / outlier array information to vtkPolyData input
   vtkSmartPointer<vtkUnsignedIntArray> InlierOutlierArray = vtkSmartPointer<vtkUnsignedIntArray>::New();
-  InlierOutlierArray->Allocate(input->GetNumberOfPoints());
   InlierOutlierArray->SetName("inliers");
-  InlierOutlierArray->SetNumberOfTuples(0);
-
-  // populate the new array
-  for (int k = 0; k < input->GetNumberOfPoints(); ++k)
-  {
-    InlierOutlierArray->InsertNextValue(0);
-  }
-  for (int k = 0; k < inliers.size(); ++k)
+  InlierOutlierArray->SetNumberOfTuples(input->GetNumberOfPoints());
+  for (vtkIdType k = 0; k < input->GetNumberOfPoints(); ++k)
   {
-    InlierOutlierArray->SetValue(inliers[k], 255);
+    InlierOutlierArray->SetValue(k, modelArray->GetValue(k) >= 0 ? 255 : 0);
   }
 
   // Get the output
   vtkPolyData *output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
   output->ShallowCopy(input);
 
-  // Add the array
+  // Add the arrays
   output->GetPointData()->AddArray(InlierOutlierArray);
+  output->GetPointData()->AddArray(modelArray);
 
   return 1;
 }
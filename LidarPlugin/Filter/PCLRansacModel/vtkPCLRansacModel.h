@@ -21,6 +21,10 @@
 #include <vtkPolyDataAlgorithm.h>
 #include <vtkSmartPointer.h>
 
+// pcl includes
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
 /**
  * @brief The vtkPCLRansacModel class will quickly be replace by classes from the pcl plugin
  * so no time should be spend developping this class
@@ -35,8 +39,8 @@ class VTK_EXPORT vtkPCLRansacModel : public vtkPolyDataAlgorithm
   enum Model {
     Circle2D = 0,
     Circle3D,
-    Cone,       // not implemented
-    Cylinder,   // not implemented
+    Cone,
+    Cylinder,
     Shpere,
     Line,
     Plane
@@ -48,6 +52,21 @@ class VTK_EXPORT vtkPCLRansacModel : public vtkPolyDataAlgorithm
   vtkGetMacro(ModelType, int)
   vtkSetMacro(ModelType, int)
 
+  vtkGetMacro(NumberOfModels, int)
+  vtkSetMacro(NumberOfModels, int)
+
+  vtkGetMacro(MaxIterations, int)
+  vtkSetMacro(MaxIterations, int)
+
+  vtkGetMacro(NumberOfThreads, int)
+  vtkSetMacro(NumberOfThreads, int)
+
+  vtkGetMacro(NormalsNumberOfNeighbors, int)
+  vtkSetMacro(NormalsNumberOfNeighbors, int)
+
+  vtkGetMacro(NormalDistanceWeight, double)
+  vtkSetMacro(NormalDistanceWeight, double)
+
 protected:
   // constructor / destructor
   vtkPCLRansacModel();
@@ -62,6 +81,27 @@ protected:
   //! Model to approximate
   int ModelType;
 
+  //! Number of models extracted one after another, each one from
+  //! the points which are not inliers of the previous ones
+  int NumberOfModels = 1;
+
+  //! Number of hypotheses tested to extract a model, shared by the threads
+  int MaxIterations = 1000;
+
+  //! Number of threads testing the hypotheses, 0 to use all the cores
+  int NumberOfThreads = 0;
+
+  //! Number of neighbors used to estimate the normals of the cone and cylinder models
+  int NormalsNumberOfNeighbors = 20;
+
+  //! Weight of the angular distance to the normals of the cone and cylinder models
+  double NormalDistanceWeight = 0.1;
+
+  // The converted input and its normals are kept while the input is unchanged
+  pcl::PointCloud<pcl::PointXYZ>::Ptr Cloud;
+  vtkMTimeType CloudTime = 0;
+  pcl::PointCloud<pcl::Normal>::Ptr Normals;
+  int NormalsNumberOfNeighborsUsed = 0;
 
 private:
   // copy operators
@@ -0,0 +1,259 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "vtkPointCloudLevelOfDetail.h"
+
+#include <vtkCellArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+namespace {
+// Each integer coordinate of a leaf is stored on 21 bits, so that
+// the 3 coordinates interleaved fit in a 64 bits Morton code
+const int CoordinateBits = 21;
+const uint64_t MaximumCoordinate = (uint64_t(1) << CoordinateBits) - 1;
+
+//-----------------------------------------------------------------------------
+//! Insert 2 zeros between each of the 21 lowest bits of value
+uint64_t SpreadBits(uint64_t value)
+{
+  value &= MaximumCoordinate;
+  value = (value | (value << 32)) & 0x1f00000000ffffULL;
+  value = (value | (value << 16)) & 0x1f0000ff0000ffULL;
+  value = (value | (value << 8)) & 0x100f00f00f00f00fULL;
+  value = (value | (value << 4)) & 0x10c30c30c30c30c3ULL;
+  value = (value | (value << 2)) & 0x1249249249249249ULL;
+  return value;
+}
+
+//-----------------------------------------------------------------------------
+uint64_t LeafCoordinate(double value, double origin, double invLeafSize)
+{
+  const double coordinate = std::floor((value - origin) * invLeafSize);
+  // also catches NaN
+  if (!(coordinate > 0))
+  {
+    return 0;
+  }
+  return std::min(static_cast<uint64_t>(std::min(coordinate, 1e18)), MaximumCoordinate);
+}
+
+//-----------------------------------------------------------------------------
+int HighestBit(uint64_t value)
+{
+  int bit = -1;
+  while (value)
+  {
+    value >>= 1;
+    ++bit;
+  }
+  return bit;
+}
+}
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkPointCloudLevelOfDetail)
+
+//-----------------------------------------------------------------------------
+void vtkPointCloudLevelOfDetail::SetLeafSize(double value)
+{
+  if (this->LeafSize != value && value > 0.0)
+  {
+    this->LeafSize = value;
+    this->LevelsMTime = 0;
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkPointCloudLevelOfDetail::SetNumberOfLevels(int value)
+{
+  value = std::max(1, std::min(value, CoordinateBits));
+  if (this->NumberOfLevels != value)
+  {
+    this->NumberOfLevels = value;
+    this->LevelsMTime = 0;
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkPointCloudLevelOfDetail::RequestData(vtkInformation* vtkNotUsed(request),
+                                            vtkInformationVector** inputVector,
+                                            vtkInformationVector* outputVector)
+{
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
+  vtkPolyData* output = vtkPolyData::GetData(outputVector);
+
+  if (!this->Interactive || input->GetNumberOfPoints() == 0)
+  {
+    output->ShallowCopy(input);
+    this->NumberOfRenderedPoints = static_cast<int>(input->GetNumberOfPoints());
+    return 1;
+  }
+
+  // the hierarchy only depends on the frame, not on the camera
+  if (input->GetMTime() != this->LevelsMTime)
+  {
+    this->ComputeLevels(input);
+    this->LevelsMTime = input->GetMTime();
+  }
+
+  const std::vector<vtkIdType> selected = this->SelectPoints(input);
+  const vtkIdType nbPoints = static_cast<vtkIdType>(selected.size());
+  vtkNew<vtkIdTypeArray> connectivity;
+  connectivity->SetNumberOfValues(2 * nbPoints);
+  vtkIdType* cell = connectivity->GetPointer(0);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    cell[2 * i] = 1;
+    cell[2 * i + 1] = selected[i];
+  }
+  vtkNew<vtkCellArray> verts;
+  verts->SetCells(nbPoints, connectivity.GetPointer());
+
+  output->Initialize();
+  output->SetPoints(input->GetPoints());
+  output->GetPointData()->PassData(input->GetPointData());
+  output->SetVerts(verts.GetPointer());
+  this->NumberOfRenderedPoints = static_cast<int>(nbPoints);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkPointCloudLevelOfDetail::ComputeLevels(vtkPolyData* input)
+{
+  const vtkIdType nbPoints = input->GetNumberOfPoints();
+  double bounds[6];
+  input->GetBounds(bounds);
+  const double invLeafSize = 1.0 / this->LeafSize;
+
+  // sort the points along the Morton curve, the points of a cell of any level
+  // are then contiguous
+  std::vector<std::pair<uint64_t, vtkIdType>> codes(nbPoints);
+  double point[3];
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    input->GetPoint(i, point);
+    codes[i].first = SpreadBits(LeafCoordinate(point[0], bounds[0], invLeafSize))
+                   | (SpreadBits(LeafCoordinate(point[1], bounds[2], invLeafSize)) << 1)
+                   | (SpreadBits(LeafCoordinate(point[2], bounds[4], invLeafSize)) << 2);
+    codes[i].second = i;
+  }
+  std::sort(codes.begin(), codes.end());
+
+  // a point opens a new cell at each level where its code differs from the one of the
+  // previous point, the coarsest of them is its level. The cells of level l are
+  // identified by the bits of the code above 3 * (NumberOfLevels - 1 - l).
+  const int finestLevel = this->NumberOfLevels - 1;
+  this->Levels.assign(nbPoints, 0);
+  for (vtkIdType i = 1; i < nbPoints; ++i)
+  {
+    const uint64_t difference = codes[i].first ^ codes[i - 1].first;
+    int level = this->NumberOfLevels;
+    if (difference)
+    {
+      level = std::max(0, finestLevel - HighestBit(difference) / 3);
+    }
+    this->Levels[codes[i].second] = static_cast<unsigned char>(level);
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::vector<vtkIdType> vtkPointCloudLevelOfDetail::SelectPoints(vtkPolyData* input) const
+{
+  const vtkIdType nbPoints = input->GetNumberOfPoints();
+  const int nbLevels = this->NumberOfLevels;
+
+  // a point of level l refines the cell of level l - 1 which contains it, it is
+  // only needed if this cell covers more than ScreenSpaceError pixels
+  std::vector<double> cellSizes(nbLevels);
+  for (int level = 0; level < nbLevels; ++level)
+  {
+    cellSizes[level] = std::ldexp(this->LeafSize, nbLevels - 1 - level);
+  }
+  std::vector<bool> kept(nbPoints, true);
+  std::vector<vtkIdType> countByLevel(nbLevels + 1, 0);
+  double point[3];
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    const int level = this->Levels[i];
+    if (level > 0 && this->ProjectionScale > 0)
+    {
+      input->GetPoint(i, point);
+      const double distance = std::sqrt(vtkMath::Distance2BetweenPoints(point, this->CameraPosition));
+      kept[i] = cellSizes[level - 1] * this->ProjectionScale > this->ScreenSpaceError * distance;
+    }
+    if (kept[i])
+    {
+      countByLevel[level]++;
+    }
+  }
+
+  // then keep the coarsest levels within the budget, and evenly thin the first level
+  // which does not fit
+  int cutLevel = nbLevels + 1;
+  vtkIdType cutLevelBudget = 0;
+  if (this->MaximumNumberOfPoints > 0)
+  {
+    vtkIdType remaining = this->MaximumNumberOfPoints;
+    for (int level = 0; level <= nbLevels; ++level)
+    {
+      if (countByLevel[level] > remaining)
+      {
+        cutLevel = level;
+        cutLevelBudget = remaining;
+        break;
+      }
+      remaining -= countByLevel[level];
+    }
+  }
+
+  std::vector<vtkIdType> selected;
+  selected.reserve(std::min<vtkIdType>(nbPoints, this->MaximumNumberOfPoints > 0 ? this->MaximumNumberOfPoints : nbPoints));
+  vtkIdType cutLevelIndex = 0;
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    const int level = this->Levels[i];
+    if (!kept[i] || level > cutLevel)
+    {
+      continue;
+    }
+    if (level == cutLevel)
+    {
+      // keep cutLevelBudget points out of countByLevel[cutLevel], regularly spaced
+      const vtkIdType count = countByLevel[cutLevel];
+      const bool keep = (cutLevelIndex + 1) * cutLevelBudget / count > cutLevelIndex * cutLevelBudget / count;
+      ++cutLevelIndex;
+      if (!keep)
+      {
+        continue;
+      }
+    }
+    selected.push_back(i);
+  }
+  return selected;
+}
@@ -0,0 +1,148 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VTK_POINT_CLOUD_LEVEL_OF_DETAIL_H
+#define VTK_POINT_CLOUD_LEVEL_OF_DETAIL_H
+
+#include <vector>
+
+#include <vtkPolyDataAlgorithm.h>
+
+/**
+ * @brief The vtkPointCloudLevelOfDetail reduces the number of points of a dense
+ * point cloud to render while the camera moves, and renders all of them when it stops.
+ *
+ * Each frame is sorted into an octree whose finest cells have edges of LeafSize and
+ * which has NumberOfLevels levels. A point gets the coarsest level in which it is the
+ * first point of its cell, so that keeping the points up to a level keeps a single
+ * point per cell of that level. This hierarchy is only built once per input frame.
+ *
+ * When Interactive is on, a point is kept if the cell of the level above its own,
+ * seen from CameraPosition, is larger than ScreenSpaceError pixels on screen, then
+ * the coarsest levels are kept first until MaximumNumberOfPoints is reached. The
+ * output shares the points and the arrays of its input, only its vertices change.
+ */
+class VTK_EXPORT vtkPointCloudLevelOfDetail : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkPointCloudLevelOfDetail* New();
+  vtkTypeMacro(vtkPointCloudLevelOfDetail, vtkPolyDataAlgorithm)
+
+  //@{
+  /**
+   * @copydoc vtkPointCloudLevelOfDetail::LeafSize
+   */
+  vtkGetMacro(LeafSize, double)
+  void SetLeafSize(double value);
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkPointCloudLevelOfDetail::NumberOfLevels
+   */
+  vtkGetMacro(NumberOfLevels, int)
+  void SetNumberOfLevels(int value);
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkPointCloudLevelOfDetail::Interactive
+   */
+  vtkGetMacro(Interactive, bool)
+  vtkSetMacro(Interactive, bool)
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkPointCloudLevelOfDetail::MaximumNumberOfPoints
+   */
+  vtkGetMacro(MaximumNumberOfPoints, int)
+  vtkSetClampMacro(MaximumNumberOfPoints, int, 0, VTK_INT_MAX)
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkPointCloudLevelOfDetail::ScreenSpaceError
+   */
+  vtkGetMacro(ScreenSpaceError, double)
+  vtkSetClampMacro(ScreenSpaceError, double, 0, VTK_DOUBLE_MAX)
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkPointCloudLevelOfDetail::CameraPosition
+   */
+  vtkGetVector3Macro(CameraPosition, double)
+  vtkSetVector3Macro(CameraPosition, double)
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkPointCloudLevelOfDetail::ProjectionScale
+   */
+  vtkGetMacro(ProjectionScale, double)
+  vtkSetClampMacro(ProjectionScale, double, 0, VTK_DOUBLE_MAX)
+  //@}
+
+  //! Number of points of the last output
+  vtkGetMacro(NumberOfRenderedPoints, int)
+
+protected:
+  vtkPointCloudLevelOfDetail() = default;
+
+  int RequestData(vtkInformation* request,
+                  vtkInformationVector** inputVector,
+                  vtkInformationVector* outputVector) override;
+
+private:
+  //! Compute the level of each point of the input
+  void ComputeLevels(vtkPolyData* input);
+
+  //! Select the points to render, a point of level NumberOfLevels is a duplicate
+  //! of a point in its finest cell
+  std::vector<vtkIdType> SelectPoints(vtkPolyData* input) const;
+
+  //! Size of the edges of the finest cells of the octree, in meters
+  double LeafSize = 0.05;
+
+  //! Number of levels of the octree, from 1 to 21
+  int NumberOfLevels = 10;
+
+  //! Reduce the number of points, typically while the camera moves
+  bool Interactive = false;
+
+  //! Maximum number of points rendered when Interactive is on, 0 for no limit
+  int MaximumNumberOfPoints = 500000;
+
+  //! Size in pixels under which a cell is rendered with a single point
+  double ScreenSpaceError = 2.0;
+
+  //! Position of the camera, in the coordinates of the input
+  double CameraPosition[3] = { 0.0, 0.0, 0.0 };
+
+  //! Size in pixels of an object of 1 m at 1 m of the camera, 0 to only apply
+  //! MaximumNumberOfPoints
+  double ProjectionScale = 0.0;
+
+  //! Level of each point of the input, computed once per input frame
+  std::vector<unsigned char> Levels;
+  vtkMTimeType LevelsMTime = 0;
+
+  int NumberOfRenderedPoints = 0;
+
+  vtkPointCloudLevelOfDetail(const vtkPointCloudLevelOfDetail&) /*= delete*/;
+  void operator =(const vtkPointCloudLevelOfDetail&) /*= delete*/;
+};
+
+#endif // VTK_POINT_CLOUD_LEVEL_OF_DETAIL_H
@@ -17,8 +17,12 @@
 // LOCAL
 #include "vtkPointCloudLinearProjector.h"
 #include "vtkEigenTools.h"
+#include "vtkHelper.h"
+#include "ParallelFor.h"
+#include "statistics.h"
 
 // STD
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <iostream>
@@ -42,6 +46,76 @@
 // Implementation of the New function
 vtkStandardNewMacro(vtkPointCloudLinearProjector)
 
+namespace {
+// Number of items processed by a thread at a time
+const unsigned int ChunkSize = 4096;
+// Number of rows filtered by a thread at a time
+const unsigned int RowChunkSize = 8;
+
+//------------------------------------------------------------------------------
+// Replace each non zero pixel by the median of its neighborhood in the
+// original image, the rows of the image being shared between the threads.
+// The neighborhood slides along the row, one column leaving and one entering
+// it at each pixel, so that the median is updated instead of selected again
+template<typename T>
+void MedianFilter(T* image, int dimX, int dimY, int neigh, unsigned int nThreads)
+{
+  const std::vector<T> original(image, image + dimX * dimY);
+  Parallel::ForEachChunk(dimY, RowChunkSize, nThreads, [&](unsigned int, size_t begin, size_t end)
+  {
+    SlidingMedian<T> window;
+    for (int y = begin; y < static_cast<int>(end); ++y)
+    {
+      const auto row = original.begin() + dimX * y;
+      if (std::all_of(row, row + dimX, [](const T& value) { return value == 0; }))
+      {
+        continue;
+      }
+      const int minV = std::max(0, y - neigh);
+      const int maxV = std::min(dimY - 1, y + neigh);
+      auto insertColumn = [&](int u)
+      {
+        for (int v = minV; v <= maxV; ++v)
+        {
+          window.Insert(original[u + dimX * v]);
+        }
+      };
+      auto eraseColumn = [&](int u)
+      {
+        for (int v = minV; v <= maxV; ++v)
+        {
+          window.Erase(original[u + dimX * v]);
+        }
+      };
+
+      window.Clear();
+      for (int u = 0; u <= std::min(dimX - 1, neigh); ++u)
+      {
+        insertColumn(u);
+      }
+      for (int x = 0; x < dimX; ++x)
+      {
+        if (x > 0)
+        {
+          if (x - neigh - 1 >= 0)
+          {
+            eraseColumn(x - neigh - 1);
+          }
+          if (x + neigh < dimX)
+          {
+            insertColumn(x + neigh);
+          }
+        }
+        if (original[x + dimX * y] != 0)
+        {
+          image[x + dimX * y] = window.GetUpperMedian();
+        }
+      }
+    }
+  });
+}
+}
+
 //------------------------------------------------------------------------------
 int vtkPointCloudLinearProjector::FillInputPortInformation(int port, vtkInformation* info)
 {
@@ -92,28 +166,41 @@ int vtkPointCloudLinearProjector::RequestData(vtkInformation* vtkNotUsed(request
   // Get the input
   vtkPolyData* input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
 
-  double point[3];
-  Eigen::Vector3d X;
   vtkDataArray* values = this->GetInputArrayToProcess(0, inputVector);
+  const unsigned int nbPoints = static_cast<unsigned int>(input->GetNumberOfPoints());
+  if (!this->HeightMap && !values)
+  {
+    vtkErrorMacro("No input array selected!");
+    return VTK_ERROR;
+  }
 
   // Express the data in an other reference frame to align the new
   // Z-axis with a settled direction (typically, the gravity acceleration
   // vector)
-  auto transformedPoints = vtkSmartPointer<vtkPoints>::New();
-  transformedPoints->SetNumberOfPoints(input->GetNumberOfPoints());
-  // Transform the input polydata
-  for (vtkIdType pointIndex = 0; pointIndex < input->GetNumberOfPoints(); ++pointIndex)
+  std::vector<Eigen::Vector3d> transformedPoints(nbPoints);
+  Parallel::ForEachChunk(nbPoints, ChunkSize, this->NumberOfThreads,
+    [&](unsigned int, size_t begin, size_t end)
   {
-    input->GetPoint(pointIndex, point);
-    X << point[0], point[1], point[2];
-    X = this->Projector * X;
-    transformedPoints->SetPoint(pointIndex, X.data());
-  }
+    double point[3];
+    for (unsigned int pointIndex = begin; pointIndex < end; ++pointIndex)
+    {
+      input->GetPoint(pointIndex, point);
+      transformedPoints[pointIndex] = this->Projector * Eigen::Vector3d(point[0], point[1], point[2]);
+    }
+  });
 
   // Get the point cloud bounding box parameters
-  double boundingBox[6];
-  transformedPoints->Modified();
-  transformedPoints->GetBounds(boundingBox);
+  double boundingBox[6] = {VTK_DOUBLE_MAX, VTK_DOUBLE_MIN,
+                           VTK_DOUBLE_MAX, VTK_DOUBLE_MIN,
+                           VTK_DOUBLE_MAX, VTK_DOUBLE_MIN};
+  for (const Eigen::Vector3d& X : transformedPoints)
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      boundingBox[2 * i] = std::min(boundingBox[2 * i], X(i));
+      boundingBox[2 * i + 1] = std::max(boundingBox[2 * i + 1], X(i));
+    }
+  }
 
   double pointRangeX = boundingBox[1] - boundingBox[0];
   double pointRangeY = boundingBox[3] - boundingBox[2];
@@ -153,16 +240,48 @@ int vtkPointCloudLinearProjector::RequestData(vtkInformation* vtkNotUsed(request
   {
     image->AllocateScalars(VTK_DOUBLE, 1);
   }
-  // Compute distribution about the height of the data lying in a pixel
-  std::vector<std::vector<double> > perPixelDistribution(this->Resolution[0] * this->Resolution[1]);
-  for (vtkIdType pointIndex = 0; pointIndex < input->GetNumberOfPoints(); ++pointIndex)
+
+  // Compute distribution about the height of the data lying in a pixel.
+  // The values of all the pixels are stored in a single array, sorted by
+  // pixel: the points are counted per pixel, then scattered after the
+  // values of the previous pixels.
+  const unsigned int nbPixels = this->Resolution[0] * this->Resolution[1];
+  std::vector<unsigned int> pointPixels(nbPoints);
+  std::vector<double> pointValues =
+    this->HeightMap ? std::vector<double>(nbPoints) : getComponentValues<double>(values);
+  Parallel::ForEachChunk(nbPoints, ChunkSize, this->NumberOfThreads,
+    [&](unsigned int, size_t begin, size_t end)
   {
-    transformedPoints->GetPoint(pointIndex, point);
-    int xPixelCoord = std::floor((point[0] - boundingBox[0]) * scaleX);
-    int yPixelCoord = std::floor((point[1] - boundingBox[2]) * scaleY);
-    perPixelDistribution[xPixelCoord + this->Resolution[0] * yPixelCoord].push_back(
-      this->HeightMap ? point[2] : values->GetTuple1(pointIndex)
-    );
+    for (unsigned int pointIndex = begin; pointIndex < end; ++pointIndex)
+    {
+      const Eigen::Vector3d& X = transformedPoints[pointIndex];
+      unsigned int xPixelCoord = std::min(this->Resolution[0] - 1,
+        static_cast<unsigned int>(std::floor((X(0) - boundingBox[0]) * scaleX)));
+      unsigned int yPixelCoord = std::min(this->Resolution[1] - 1,
+        static_cast<unsigned int>(std::floor((X(1) - boundingBox[2]) * scaleY)));
+      pointPixels[pointIndex] = xPixelCoord + this->Resolution[0] * yPixelCoord;
+      if (this->HeightMap)
+      {
+        pointValues[pointIndex] = X(2);
+      }
+    }
+  });
+  std::vector<unsigned int> pixelStart(nbPixels + 1, 0);
+  for (unsigned int pixel : pointPixels)
+  {
+    pixelStart[pixel + 1]++;
+  }
+  for (unsigned int pixel = 0; pixel < nbPixels; ++pixel)
+  {
+    pixelStart[pixel + 1] += pixelStart[pixel];
+  }
+  std::vector<double> perPixelDistribution(nbPoints);
+  {
+    std::vector<unsigned int> pixelEnd(pixelStart.begin(), pixelStart.end() - 1);
+    for (unsigned int pointIndex = 0; pointIndex < nbPoints; ++pointIndex)
+    {
+      perPixelDistribution[pixelEnd[pointPixels[pointIndex]]++] = pointValues[pointIndex];
+    }
   }
 
   // fill the image
@@ -179,65 +298,52 @@ int vtkPointCloudLinearProjector::RequestData(vtkInformation* vtkNotUsed(request
 
   double valueShift = (this->ExportAsChar || this->ShiftToZero) ? valueRange[0] : 0.0;
   double valueScale = valueRange[1] - valueRange[0];
-  for (unsigned int y = 0; y < this->Resolution[1]; ++y)
+  unsigned char* charPointer = static_cast<unsigned char*>(image->GetScalarPointer());
+  double* doublePointer = static_cast<double*>(image->GetScalarPointer());
+  Parallel::ForEachChunk(nbPixels, ChunkSize, this->NumberOfThreads,
+    [&](unsigned int, size_t begin, size_t end)
   {
-    for (unsigned int x = 0; x < this->Resolution[0]; ++x)
+    for (unsigned int imageIndex = begin; imageIndex < end; ++imageIndex)
     {
-      unsigned int imageIndex = this->Resolution[0] * y + x;
       double value = 0.0;
       // if the pixel is empty, skip it
-      if (perPixelDistribution[imageIndex].size() > 0)
+      auto first = perPixelDistribution.begin() + pixelStart[imageIndex];
+      auto last = perPixelDistribution.begin() + pixelStart[imageIndex + 1];
+      if (first != last)
       {
-        std::sort(perPixelDistribution[imageIndex].begin(), perPixelDistribution[imageIndex].end());
-        unsigned int rankIndex = std::floor((perPixelDistribution[imageIndex].size() - 1) * this->RankPercentile);
-        value = perPixelDistribution[imageIndex][rankIndex];
+        auto rank = first + static_cast<unsigned int>(std::floor((last - first - 1) * this->RankPercentile));
+        std::nth_element(first, rank, last);
+        value = *rank;
       }
       if (this->ExportAsChar)
       {
         value -= valueShift;
         value = std::round((value / valueScale) * 0xff);
+        charPointer[imageIndex] = static_cast<unsigned char>(value);
       }
-      else if (this->ShiftToZero)
+      else
       {
-        value -= valueShift;
+        if (this->ShiftToZero)
+        {
+          value -= valueShift;
+        }
+        // Use unscaled values to match input values and ranges.
+        doublePointer[imageIndex] = value;
       }
-      // Use unscaled values to match input values and ranges.
-      image->SetScalarComponentFromDouble(x, y, 0, 0, value);
     }
-  }
+  });
 
-  int neigh = this->MedianFilterWidth;
   if (this->ShouldMedianFilter)
   {
-    vtkSmartPointer<vtkImageData> tempImage = vtkSmartPointer<vtkImageData>::New();
-    tempImage->DeepCopy(image);
     int dimX = static_cast<int>(this->Resolution[0]);
     int dimY = static_cast<int>(this->Resolution[1]);
-    for (int x = 0; x < dimX; ++x)
+    if (this->ExportAsChar)
     {
-      for (int y = 0; y < dimY; ++y)
-      {
-        if (tempImage->GetScalarComponentAsDouble(x, y, 0, 0) == 0)
-        {
-          continue;
-        }
-        std::vector<double> neighborhoodValues;
-        unsigned int minU = std::max(0, x - neigh);
-        unsigned int maxU = std::min(dimX - 1, x + neigh);
-        unsigned int minV = std::max(0, y - neigh);
-        unsigned int maxV = std::min(dimY - 1, y + neigh);
-
-        for (unsigned int u = minU; u <= maxU; ++u)
-        {
-          for (unsigned int v = minV; v <= maxV; ++v)
-          {
-            neighborhoodValues.push_back(tempImage->GetScalarComponentAsDouble(u, v, 0, 0));
-          }
-        }
-        std::sort(neighborhoodValues.begin(), neighborhoodValues.end());
-        double medianValue = neighborhoodValues[neighborhoodValues.size() / 2];
-        image->SetScalarComponentFromDouble(x, y, 0, 0, medianValue);
-      }
+      MedianFilter(charPointer, dimX, dimY, this->MedianFilterWidth, this->NumberOfThreads);
+    }
+    else
+    {
+      MedianFilter(doublePointer, dimX, dimY, this->MedianFilterWidth, this->NumberOfThreads);
     }
   }
 
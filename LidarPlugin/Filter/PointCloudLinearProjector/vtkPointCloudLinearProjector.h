@@ -58,6 +58,9 @@ public:
   vtkGetMacro(MedianFilterWidth, int)
   vtkSetMacro(MedianFilterWidth, int)
 
+  vtkGetMacro(NumberOfThreads, unsigned int)
+  vtkSetMacro(NumberOfThreads, unsigned int)
+
   // set the plane normal coordinates on which points are projected
   void SetPlaneNormal(double w0, double w1, double w2);
 
@@ -95,6 +98,10 @@ private:
   bool ShouldMedianFilter = false;
   int MedianFilterWidth = 3;
 
+  // Number of threads projecting the points and filling
+  // the pixels, 0 to use all the cores
+  unsigned int NumberOfThreads = 0;
+
   // Information about the projector
   Eigen::Matrix3d DiagonalizedProjector = Eigen::Matrix3d::Identity();
   Eigen::Matrix3d ChangeOfBasis = Eigen::Matrix3d::Identity();
@@ -0,0 +1,229 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "PointKDTree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+enum class Side
+{
+  Outside,
+  Crossing,
+  Inside
+};
+
+struct Entry
+{
+  double Point[3];
+  uint32_t Index;
+};
+
+//-----------------------------------------------------------------------------
+template <typename NodeT>
+void ComputeBounds(const std::vector<Entry>& entries, NodeT& node)
+{
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    node.Bounds[2 * axis] = std::numeric_limits<double>::max();
+    node.Bounds[2 * axis + 1] = std::numeric_limits<double>::lowest();
+  }
+  for (uint32_t i = node.Begin; i < node.End; ++i)
+  {
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      node.Bounds[2 * axis] = std::min(node.Bounds[2 * axis], entries[i].Point[axis]);
+      node.Bounds[2 * axis + 1] = std::max(node.Bounds[2 * axis + 1], entries[i].Point[axis]);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! Position of a box relative to the intersection of the planes
+Side ClassifyBox(const double bounds[6], const std::vector<PointKDTree::Plane>& planes)
+{
+  Side side = Side::Inside;
+  for (const auto& plane : planes)
+  {
+    // the corners of the box with the lowest and the highest value for this plane
+    double lowest = plane[3];
+    double highest = plane[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      const double a = plane[axis] * bounds[2 * axis];
+      const double b = plane[axis] * bounds[2 * axis + 1];
+      lowest += std::min(a, b);
+      highest += std::max(a, b);
+    }
+    if (lowest > 0)
+    {
+      return Side::Outside;
+    }
+    if (highest > 0)
+    {
+      side = Side::Crossing;
+    }
+  }
+  return side;
+}
+}
+
+const uint32_t PointKDTree::LeafSize;
+
+//-----------------------------------------------------------------------------
+void PointKDTree::Clear()
+{
+  this->Nodes.clear();
+  this->Indices.clear();
+  this->Coordinates.clear();
+}
+
+//-----------------------------------------------------------------------------
+void PointKDTree::Build(const std::vector<double>& coordinates)
+{
+  this->Clear();
+
+  // the points are split with their coordinates, so that the comparisons read
+  // contiguous memory. The invalid points are left out, they are never inside a region
+  const uint32_t nbFramePoints = static_cast<uint32_t>(coordinates.size() / 3);
+  std::vector<Entry> entries;
+  entries.reserve(nbFramePoints);
+  for (uint32_t i = 0; i < nbFramePoints; ++i)
+  {
+    const double* point = &coordinates[3 * static_cast<size_t>(i)];
+    if (std::isfinite(point[0]) && std::isfinite(point[1]) && std::isfinite(point[2]))
+    {
+      entries.push_back(Entry{ { point[0], point[1], point[2] }, i });
+    }
+  }
+  const uint32_t nbPoints = static_cast<uint32_t>(entries.size());
+  if (nbPoints == 0)
+  {
+    return;
+  }
+
+  this->Nodes.reserve(2 * (nbPoints / LeafSize + 1));
+  this->Nodes.push_back(Node{ {}, 0, nbPoints, 0 });
+  ComputeBounds(entries, this->Nodes[0]);
+  for (size_t n = 0; n < this->Nodes.size(); ++n)
+  {
+    const Node node = this->Nodes[n];
+    if (node.End - node.Begin <= LeafSize)
+    {
+      continue;
+    }
+    int axis = 0;
+    for (int i = 1; i < 3; ++i)
+    {
+      if (node.Bounds[2 * i + 1] - node.Bounds[2 * i]
+          > node.Bounds[2 * axis + 1] - node.Bounds[2 * axis])
+      {
+        axis = i;
+      }
+    }
+    const uint32_t middle = node.Begin + (node.End - node.Begin) / 2;
+    std::nth_element(entries.begin() + node.Begin, entries.begin() + middle,
+                     entries.begin() + node.End, [axis](const Entry& a, const Entry& b) {
+                       return a.Point[axis] < b.Point[axis];
+                     });
+
+    Node first{ {}, node.Begin, middle, 0 };
+    Node second{ {}, middle, node.End, 0 };
+    ComputeBounds(entries, first);
+    ComputeBounds(entries, second);
+    this->Nodes[n].Children = static_cast<uint32_t>(this->Nodes.size());
+    this->Nodes.push_back(first);
+    this->Nodes.push_back(second);
+  }
+
+  this->Indices.resize(nbPoints);
+  this->Coordinates.resize(3 * static_cast<size_t>(nbPoints));
+  for (uint32_t i = 0; i < nbPoints; ++i)
+  {
+    this->Indices[i] = entries[i].Index;
+    std::copy_n(entries[i].Point, 3, &this->Coordinates[3 * static_cast<size_t>(i)]);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void PointKDTree::FindPointsInside(const std::vector<Plane>& planes,
+                                   std::vector<uint32_t>& indices) const
+{
+  if (this->Nodes.empty())
+  {
+    return;
+  }
+  std::vector<uint32_t> stack(1, 0);
+  while (!stack.empty())
+  {
+    const Node& node = this->Nodes[stack.back()];
+    stack.pop_back();
+    const Side side = ClassifyBox(node.Bounds, planes);
+    if (side == Side::Outside)
+    {
+      continue;
+    }
+    if (side == Side::Inside)
+    {
+      indices.insert(indices.end(), this->Indices.begin() + node.Begin,
+                     this->Indices.begin() + node.End);
+      continue;
+    }
+    if (node.Children)
+    {
+      stack.push_back(node.Children);
+      stack.push_back(node.Children + 1);
+      continue;
+    }
+    for (uint32_t i = node.Begin; i < node.End; ++i)
+    {
+      const double* point = &this->Coordinates[3 * static_cast<size_t>(i)];
+      bool inside = true;
+      for (const auto& plane : planes)
+      {
+        if (plane[0] * point[0] + plane[1] * point[1] + plane[2] * point[2] + plane[3] > 0)
+        {
+          inside = false;
+          break;
+        }
+      }
+      if (inside)
+      {
+        indices.push_back(this->Indices[i]);
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void PointKDTree::FindPointsInBounds(const double bounds[6], std::vector<uint32_t>& indices) const
+{
+  std::vector<Plane> planes;
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    Plane lower = { { 0, 0, 0, bounds[2 * axis] } };
+    lower[axis] = -1;
+    Plane upper = { { 0, 0, 0, -bounds[2 * axis + 1] } };
+    upper[axis] = 1;
+    planes.push_back(lower);
+    planes.push_back(upper);
+  }
+  this->FindPointsInside(planes, indices);
+}
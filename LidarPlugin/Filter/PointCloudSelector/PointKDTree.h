@@ -0,0 +1,85 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef POINT_KD_TREE_H
+#define POINT_KD_TREE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * \class PointKDTree
+ * \brief Balanced kd-tree of the points of a frame, to find the points inside a convex
+ *        region (a box, a view frustum) without visiting all the points.
+ *
+ * The tree is built once per frame by splitting the points at the median of the
+ * largest extent of their bounding box, down to leaves of LeafSize points. The
+ * coordinates are stored in the order of the leaves, so that a query only reads the
+ * contiguous coordinates of the leaves it crosses, and takes all the points of a node
+ * without testing them when the node is inside the region.
+ *
+ * The indices of the points are stored on 32 bits, which is enough for any frame.
+ */
+class PointKDTree
+{
+public:
+  //! a x + b y + c z + d, a point is inside the plane when this value is not positive
+  using Plane = std::array<double, 4>;
+
+  /**
+   * @brief Build the tree
+   * @param coordinates x, y, z of each point
+   */
+  void Build(const std::vector<double>& coordinates);
+
+  void Clear();
+
+  //! Number of points in the tree, the points with a NaN or infinite coordinate are left out
+  size_t GetNumberOfPoints() const { return this->Indices.size(); }
+
+  /**
+   * @brief Append the indices of the points inside all the planes, in no particular order
+   */
+  void FindPointsInside(const std::vector<Plane>& planes, std::vector<uint32_t>& indices) const;
+
+  //! Append the indices of the points inside the bounds xmin, xmax, ymin, ymax, zmin, zmax
+  void FindPointsInBounds(const double bounds[6], std::vector<uint32_t>& indices) const;
+
+  //! Maximum number of points in a leaf
+  static const uint32_t LeafSize = 64;
+
+private:
+  struct Node
+  {
+    double Bounds[6];
+    //! Points of the node, in Indices and Coordinates
+    uint32_t Begin;
+    uint32_t End;
+    //! First child, the second one follows, 0 for a leaf
+    uint32_t Children;
+  };
+
+  std::vector<Node> Nodes;
+  //! Index of the points in the frame, in the order of the leaves
+  std::vector<uint32_t> Indices;
+  //! Coordinates of the points, in the order of the leaves
+  std::vector<double> Coordinates;
+};
+
+#endif // POINT_KD_TREE_H
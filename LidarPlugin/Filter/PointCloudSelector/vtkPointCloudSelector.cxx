@@ -0,0 +1,270 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "vtkPointCloudSelector.h"
+
+#include <vtkCellArray.h>
+#include <vtkIdList.h>
+#include <vtkIdTypeArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// Number of lasers above which the points are not sorted by laser, the laser_id
+// array is then not an index of laser
+const int MaximumNumberOfLasers = 1 << 16;
+
+//-----------------------------------------------------------------------------
+//! Planes of a frustum, given as in vtkExtractSelectedFrustum, oriented so that
+//! the inside of the frustum is on their negative side
+std::vector<PointKDTree::Plane> FrustumPlanes(const double frustum[32])
+{
+  double corners[8][3];
+  double center[3] = { 0.0, 0.0, 0.0 };
+  for (int i = 0; i < 8; ++i)
+  {
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      corners[i][axis] = frustum[4 * i + axis] / frustum[4 * i + 3];
+      center[axis] += corners[i][axis] / 8.0;
+    }
+  }
+
+  // left, right, bottom, top, near and far planes, each one through 3 of its corners
+  const int faces[6][3] = { { 0, 2, 3 }, { 4, 5, 7 }, { 0, 1, 5 },
+                            { 2, 6, 7 }, { 0, 4, 6 }, { 1, 3, 7 } };
+  std::vector<PointKDTree::Plane> planes;
+  for (const auto& face : faces)
+  {
+    double u[3], v[3], normal[3];
+    vtkMath::Subtract(corners[face[0]], corners[face[1]], u);
+    vtkMath::Subtract(corners[face[2]], corners[face[1]], v);
+    vtkMath::Cross(u, v, normal);
+    if (vtkMath::Normalize(normal) == 0.0)
+    {
+      continue;
+    }
+    double offset = -vtkMath::Dot(normal, corners[face[1]]);
+    if (vtkMath::Dot(normal, center) + offset > 0)
+    {
+      vtkMath::MultiplyScalar(normal, -1.0);
+      offset = -offset;
+    }
+    planes.push_back(PointKDTree::Plane{ { normal[0], normal[1], normal[2], offset } });
+  }
+  return planes;
+}
+
+//-----------------------------------------------------------------------------
+//! Keep the points whose value is within range, wrapping around if range[0] > range[1]
+template <typename T>
+void KeepInRange(vtkDataArray* array, const T range[2], std::vector<uint32_t>& indices)
+{
+  const bool wraps = range[0] > range[1];
+  auto end = std::remove_if(indices.begin(), indices.end(), [&](uint32_t index) {
+    const double value = array->GetTuple1(index);
+    return wraps ? (value < range[0] && value > range[1])
+                 : (value < range[0] || value > range[1]);
+  });
+  indices.erase(end, indices.end());
+}
+}
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkPointCloudSelector)
+
+//-----------------------------------------------------------------------------
+void vtkPointCloudSelector::UpdateIndices(vtkPolyData* input)
+{
+  const vtkIdType nbPoints = input->GetNumberOfPoints();
+  if (this->Region != ALL_POINTS && input->GetPoints()->GetMTime() != this->TreeMTime)
+  {
+    std::vector<double> coordinates(3 * nbPoints);
+    for (vtkIdType i = 0; i < nbPoints; ++i)
+    {
+      input->GetPoint(i, &coordinates[3 * i]);
+    }
+    this->Tree.Build(coordinates);
+    this->TreeMTime = input->GetPoints()->GetMTime();
+  }
+
+  vtkDataArray* laserIds = input->GetPointData()->GetArray("laser_id");
+  if (this->Region == ALL_POINTS && this->UseLaserIdRange && laserIds
+      && laserIds->GetMTime() != this->LasersMTime)
+  {
+    // counting sort of the points by laser
+    this->LasersMTime = laserIds->GetMTime();
+    this->PointsByLaser.clear();
+    this->LaserOffsets.clear();
+    double range[2];
+    laserIds->GetRange(range, 0);
+    if (range[1] - range[0] >= MaximumNumberOfLasers)
+    {
+      return;
+    }
+    this->LaserOffsetsOrigin = static_cast<int>(std::floor(range[0]));
+    std::vector<uint32_t> laserOfPoint(nbPoints);
+    this->LaserOffsets.assign(static_cast<int>(std::floor(range[1])) - this->LaserOffsetsOrigin + 2, 0);
+    for (vtkIdType i = 0; i < nbPoints; ++i)
+    {
+      laserOfPoint[i] = static_cast<uint32_t>(std::floor(laserIds->GetTuple1(i)) - this->LaserOffsetsOrigin);
+      this->LaserOffsets[laserOfPoint[i] + 1]++;
+    }
+    for (size_t laser = 1; laser < this->LaserOffsets.size(); ++laser)
+    {
+      this->LaserOffsets[laser] += this->LaserOffsets[laser - 1];
+    }
+    std::vector<uint32_t> next(this->LaserOffsets.begin(), this->LaserOffsets.end() - 1);
+    this->PointsByLaser.resize(nbPoints);
+    for (vtkIdType i = 0; i < nbPoints; ++i)
+    {
+      this->PointsByLaser[next[laserOfPoint[i]]++] = static_cast<uint32_t>(i);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkPointCloudSelector::RequestData(vtkInformation* vtkNotUsed(request),
+                                       vtkInformationVector** inputVector,
+                                       vtkInformationVector* outputVector)
+{
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
+  vtkPolyData* output = vtkPolyData::GetData(outputVector);
+  const vtkIdType nbPoints = input->GetNumberOfPoints();
+  this->NumberOfSelectedPoints = 0;
+  if (nbPoints == 0)
+  {
+    return 1;
+  }
+  if (nbPoints > VTK_UNSIGNED_INT_MAX)
+  {
+    vtkErrorMacro("Frames of more than " << VTK_UNSIGNED_INT_MAX << " points are not supported");
+    return 0;
+  }
+
+  vtkDataArray* laserIds = input->GetPointData()->GetArray("laser_id");
+  vtkDataArray* azimuths = input->GetPointData()->GetArray("azimuth");
+  const bool useLaserIds = this->UseLaserIdRange && laserIds;
+  const bool useAzimuths = this->UseAzimuthRange && azimuths;
+  if (this->UseLaserIdRange && !laserIds)
+  {
+    vtkWarningMacro("The input has no laser_id array, the laser range is ignored");
+  }
+  if (this->UseAzimuthRange && !azimuths)
+  {
+    vtkWarningMacro("The input has no azimuth array, the azimuth range is ignored");
+  }
+  this->UpdateIndices(input);
+
+  // the most selective index gives the candidates, the other criteria filter them
+  std::vector<uint32_t> indices;
+  bool laserIdsChecked = false;
+  if (this->Region == BOX)
+  {
+    this->Tree.FindPointsInBounds(this->Bounds, indices);
+  }
+  else if (this->Region == FRUSTUM)
+  {
+    this->Tree.FindPointsInside(FrustumPlanes(this->Frustum), indices);
+  }
+  else if (useLaserIds && !this->LaserOffsets.empty())
+  {
+    const int nbLasers = static_cast<int>(this->LaserOffsets.size()) - 1;
+    const int first = std::max(0, this->LaserIdRange[0] - this->LaserOffsetsOrigin);
+    const int last = std::min(nbLasers - 1, this->LaserIdRange[1] - this->LaserOffsetsOrigin);
+    if (first <= last)
+    {
+      indices.assign(this->PointsByLaser.begin() + this->LaserOffsets[first],
+                     this->PointsByLaser.begin() + this->LaserOffsets[last + 1]);
+    }
+    laserIdsChecked = true;
+  }
+  else
+  {
+    indices.resize(nbPoints);
+    for (vtkIdType i = 0; i < nbPoints; ++i)
+    {
+      indices[i] = static_cast<uint32_t>(i);
+    }
+  }
+  if (useLaserIds && !laserIdsChecked)
+  {
+    // the laser range never wraps around
+    const int range[2] = { this->LaserIdRange[0], std::max(this->LaserIdRange[0], this->LaserIdRange[1]) };
+    KeepInRange(laserIds, range, indices);
+  }
+  if (useAzimuths)
+  {
+    KeepInRange(azimuths, this->AzimuthRange, indices);
+  }
+  std::sort(indices.begin(), indices.end());
+
+  // extract the selected points
+  const vtkIdType nbSelected = static_cast<vtkIdType>(indices.size());
+  vtkNew<vtkIdList> ids;
+  ids->SetNumberOfIds(nbSelected);
+  vtkNew<vtkIdTypeArray> originalIds;
+  originalIds->SetName("vtkOriginalPointIds");
+  originalIds->SetNumberOfValues(nbSelected);
+  vtkNew<vtkIdTypeArray> connectivity;
+  connectivity->SetNumberOfValues(2 * nbSelected);
+  vtkIdType* cell = connectivity->GetPointer(0);
+  for (vtkIdType i = 0; i < nbSelected; ++i)
+  {
+    ids->SetId(i, indices[i]);
+    originalIds->SetValue(i, indices[i]);
+    cell[2 * i] = 1;
+    cell[2 * i + 1] = i;
+  }
+
+  vtkNew<vtkPoints> points;
+  points->SetDataType(input->GetPoints()->GetDataType());
+  points->SetNumberOfPoints(nbSelected);
+  input->GetPoints()->GetPoints(ids.GetPointer(), points.GetPointer());
+  vtkNew<vtkCellArray> verts;
+  verts->SetCells(nbSelected, connectivity.GetPointer());
+  output->SetPoints(points.GetPointer());
+  output->SetVerts(verts.GetPointer());
+
+  vtkPointData* inputData = input->GetPointData();
+  vtkPointData* outputData = output->GetPointData();
+  outputData->CopyAllocate(inputData, nbSelected);
+  for (int i = 0; i < outputData->GetNumberOfArrays(); ++i)
+  {
+    vtkAbstractArray* array = outputData->GetAbstractArray(i);
+    vtkAbstractArray* inputArray = array->GetName() ? inputData->GetAbstractArray(array->GetName()) : nullptr;
+    array->SetNumberOfTuples(nbSelected);
+    if (inputArray)
+    {
+      inputArray->GetTuples(ids.GetPointer(), array);
+    }
+  }
+  outputData->AddArray(originalIds.GetPointer());
+
+  this->NumberOfSelectedPoints = static_cast<int>(nbSelected);
+  return 1;
+}
@@ -0,0 +1,120 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTK_POINT_CLOUD_SELECTOR_H
+#define VTK_POINT_CLOUD_SELECTOR_H
+
+#include <cstdint>
+#include <vector>
+
+#include <vtkPolyDataAlgorithm.h>
+
+#include "PointKDTree.h"
+
+/**
+ * @brief The vtkPointCloudSelector extracts the points of a frame inside a box or
+ * a view frustum, and within a range of laser_id and of azimuth.
+ *
+ * The generic selections of ParaView test every point of the frame, this filter keeps
+ * per frame a kd-tree of the points and the points sorted by laser, built the first time
+ * they are needed and reused by all the selections of the same frame, so that a
+ * selection only visits the points near the selected region.
+ *
+ * The output has the selected points, in the order of the input, with all their point
+ * data and a vtkOriginalPointIds array giving their index in the input, as the output
+ * of ExtractSelection.
+ */
+class VTK_EXPORT vtkPointCloudSelector : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkPointCloudSelector* New();
+  vtkTypeMacro(vtkPointCloudSelector, vtkPolyDataAlgorithm)
+
+  enum RegionType
+  {
+    ALL_POINTS = 0,
+    BOX = 1,
+    FRUSTUM = 2
+  };
+
+  //! Region of space of the selected points, see RegionType
+  vtkGetMacro(Region, int)
+  vtkSetClampMacro(Region, int, ALL_POINTS, FRUSTUM)
+
+  //! Box of the selected points when Region is BOX: xmin, xmax, ymin, ymax, zmin, zmax
+  vtkGetVector6Macro(Bounds, double)
+  vtkSetVector6Macro(Bounds, double)
+
+  //! Frustum of the selected points when Region is FRUSTUM, as the Frustum of the frustum
+  //! selections of ParaView: the homogeneous coordinates of its 8 corners, near lower left,
+  //! far lower left, near upper left, far upper left, then the same for the right side
+  vtkGetVectorMacro(Frustum, double, 32)
+  vtkSetVectorMacro(Frustum, double, 32)
+
+  //! Only select the points whose laser_id is within LaserIdRange
+  vtkGetMacro(UseLaserIdRange, bool)
+  vtkSetMacro(UseLaserIdRange, bool)
+  vtkGetVector2Macro(LaserIdRange, int)
+  vtkSetVector2Macro(LaserIdRange, int)
+
+  //! Only select the points whose azimuth is within AzimuthRange, in the unit of the
+  //! azimuth array. The range wraps around if its first value is larger than the second.
+  vtkGetMacro(UseAzimuthRange, bool)
+  vtkSetMacro(UseAzimuthRange, bool)
+  vtkGetVector2Macro(AzimuthRange, double)
+  vtkSetVector2Macro(AzimuthRange, double)
+
+  //! Number of points of the last output
+  vtkGetMacro(NumberOfSelectedPoints, int)
+
+protected:
+  vtkPointCloudSelector() = default;
+
+  int RequestData(vtkInformation* request,
+                  vtkInformationVector** inputVector,
+                  vtkInformationVector* outputVector) override;
+
+private:
+  //! Build the indices of the frame which are needed and not built yet
+  void UpdateIndices(vtkPolyData* input);
+
+  int Region = ALL_POINTS;
+  double Bounds[6] = { -1.0, 1.0, -1.0, 1.0, -1.0, 1.0 };
+  double Frustum[32] = {};
+  bool UseLaserIdRange = false;
+  int LaserIdRange[2] = { 0, 0 };
+  bool UseAzimuthRange = false;
+  double AzimuthRange[2] = { 0.0, 0.0 };
+
+  int NumberOfSelectedPoints = 0;
+
+  //! kd-tree of the points of the frame, valid while the points are not modified
+  PointKDTree Tree;
+  vtkMTimeType TreeMTime = 0;
+
+  //! Indices of the points sorted by laser_id, the points of laser l are from
+  //! LaserOffsets[l - LaserOffsetsOrigin] to LaserOffsets[l - LaserOffsetsOrigin + 1]
+  std::vector<uint32_t> PointsByLaser;
+  std::vector<uint32_t> LaserOffsets;
+  int LaserOffsetsOrigin = 0;
+  vtkMTimeType LasersMTime = 0;
+
+  vtkPointCloudSelector(const vtkPointCloudSelector&) /*= delete*/;
+  void operator =(const vtkPointCloudSelector&) /*= delete*/;
+};
+
+#endif // VTK_POINT_CLOUD_SELECTOR_H
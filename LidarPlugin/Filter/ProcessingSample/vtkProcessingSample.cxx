@@ -16,6 +16,9 @@
 //=========================================================================
 #include "vtkProcessingSample.h"
 
+#include "vtkArrayDispatch.h"
+#include "vtkDataArrayAccessor.h"
+#include "vtkFieldData.h"
 #include "vtkFloatArray.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
@@ -23,14 +26,137 @@
 #include "vtkObjectFactory.h"
 #include "vtkPointData.h"
 #include "vtkPolyData.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPTools.h"
 #include "vtkSmartPointer.h"
 #include "vtkSphereSource.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
 
 #include <Eigen/Dense>
 
+#include <algorithm>
 #include <limits>
 
+namespace
+{
+//----------------------------------------------------------------------------
+//! Sum of the points, each thread summing its ranges of points before the reduction
+template <typename PointsArrayT>
+class SumPointsFunctor
+{
+public:
+  explicit SumPointsFunctor(PointsArrayT* points) : Points(points) {}
+
+  void Initialize()
+  {
+    this->LocalSum.Local().setZero();
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkDataArrayAccessor<PointsArrayT> points(this->Points);
+    Eigen::Vector3d& sum = this->LocalSum.Local();
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      sum(0) += points.Get(i, 0);
+      sum(1) += points.Get(i, 1);
+      sum(2) += points.Get(i, 2);
+    }
+  }
+
+  void Reduce()
+  {
+    this->Sum.setZero();
+    for (auto it = this->LocalSum.begin(); it != this->LocalSum.end(); ++it)
+    {
+      this->Sum += *it;
+    }
+  }
+
+  PointsArrayT* Points;
+  vtkSMPThreadLocal<Eigen::Vector3d> LocalSum;
+  Eigen::Vector3d Sum;
+};
+
+//----------------------------------------------------------------------------
+struct MeanPointWorker
+{
+  Eigen::Vector3d Mean = Eigen::Vector3d::Zero();
+
+  template <typename PointsArrayT>
+  void operator()(PointsArrayT* points)
+  {
+    SumPointsFunctor<PointsArrayT> functor(points);
+    vtkSMPTools::For(0, points->GetNumberOfTuples(), functor);
+    this->Mean = functor.Sum / points->GetNumberOfTuples();
+  }
+};
+
+//----------------------------------------------------------------------------
+//! Minimal and maximal intensities of the points of a laser
+template <typename IntensityArrayT, typename LaserIdArrayT>
+class IntensityRangeFunctor
+{
+public:
+  IntensityRangeFunctor(IntensityArrayT* intensities, LaserIdArrayT* laserIds, int laserId)
+    : Intensities(intensities), LaserIds(laserIds), LaserId(laserId)
+  {
+  }
+
+  void Initialize()
+  {
+    this->LocalRange.Local() = { std::numeric_limits<int>::max(), 0 };
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkDataArrayAccessor<IntensityArrayT> intensities(this->Intensities);
+    vtkDataArrayAccessor<LaserIdArrayT> laserIds(this->LaserIds);
+    std::pair<int, int>& range = this->LocalRange.Local();
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      if (static_cast<int>(laserIds.Get(i, 0)) == this->LaserId)
+      {
+        const int intensity = static_cast<int>(intensities.Get(i, 0));
+        range.first = std::min(range.first, intensity);
+        range.second = std::max(range.second, intensity);
+      }
+    }
+  }
+
+  void Reduce()
+  {
+    this->Range = { std::numeric_limits<int>::max(), 0 };
+    for (auto it = this->LocalRange.begin(); it != this->LocalRange.end(); ++it)
+    {
+      this->Range.first = std::min(this->Range.first, it->first);
+      this->Range.second = std::max(this->Range.second, it->second);
+    }
+  }
+
+  IntensityArrayT* Intensities;
+  LaserIdArrayT* LaserIds;
+  const int LaserId;
+  vtkSMPThreadLocal<std::pair<int, int> > LocalRange;
+  std::pair<int, int> Range;
+};
+
+//----------------------------------------------------------------------------
+struct IntensityRangeWorker
+{
+  int LaserId = 0;
+  std::pair<int, int> Range = { std::numeric_limits<int>::max(), 0 };
+
+  template <typename IntensityArrayT, typename LaserIdArrayT>
+  void operator()(IntensityArrayT* intensities, LaserIdArrayT* laserIds)
+  {
+    IntensityRangeFunctor<IntensityArrayT, LaserIdArrayT> functor(intensities, laserIds, this->LaserId);
+    vtkSMPTools::For(0, intensities->GetNumberOfTuples(), functor);
+    this->Range = functor.Range;
+  }
+};
+}
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkProcessingSample)
 
@@ -39,6 +165,10 @@ vtkProcessingSample::vtkProcessingSample()
 {
   this->SetNumberOfInputPorts(1);
   this->SetNumberOfOutputPorts(1);
+
+  this->Sphere->SetRadius(0.5);
+  this->Values->SetName("Values");
+  this->Values->SetNumberOfComponents(1);
 }
 
 //----------------------------------------------------------------------------
@@ -62,59 +192,46 @@ int vtkProcessingSample::RequestData(vtkInformation* vtkNotUsed(request),
     return 1;
   }
 
-  Eigen::Vector3d meanpoints;
-  for (vtkIdType i = 0; i < points->GetNumberOfPoints(); ++i)
+  // The points are float or double, the other types of arrays are read
+  // through the generic vtkDataArray accessors
+  MeanPointWorker meanWorker;
+  if (!vtkArrayDispatch::DispatchByValueType<vtkArrayDispatch::Reals>::Execute(points->GetData(),
+                                                                              meanWorker))
   {
-    Eigen::Vector3d point;
-    points->GetPoint(i, point.data());
-    meanpoints += point;
+    meanWorker(points->GetData());
   }
-  meanpoints /= points->GetNumberOfPoints();
-
-  // Create a sphere at the center location
-  vtkNew<vtkSphereSource> spheresource;
-  spheresource->SetCenter(meanpoints.data());
-  spheresource->SetRadius(0.5);
-  spheresource->Update();
-
-  // Get the intensities and laser ids for points
-  vtkUnsignedCharArray* intensities =
-    vtkUnsignedCharArray::SafeDownCast(input->GetPointData()->GetArray("intensity"));
-  vtkUnsignedCharArray* laserid =
-    vtkUnsignedCharArray::SafeDownCast(input->GetPointData()->GetArray("laser_id"));
-
-  // Compute the max, min intensity for laser 3
-  int minimum_intensity = std::numeric_limits<int>::max();
-  int maximum_intensity = 0;
-  for (vtkIdType i = 0; i < points->GetNumberOfPoints(); ++i)
+
+  // Create a sphere at the center location, the sphere source only
+  // updates when the center has moved
+  this->Sphere->SetCenter(meanWorker.Mean.data());
+  this->Sphere->Update();
+
+  // Compute the max, min intensity for the laser
+  IntensityRangeWorker rangeWorker;
+  rangeWorker.LaserId = this->LaserId;
+  vtkDataArray* intensities = input->GetPointData()->GetArray("intensity");
+  vtkDataArray* laserIds = input->GetPointData()->GetArray("laser_id");
+  if (intensities && laserIds)
   {
-    int laser = laserid->GetValue(i);
-    if (laser == 3)
+    using Dispatcher =
+      vtkArrayDispatch::Dispatch2ByValueType<vtkArrayDispatch::Integrals, vtkArrayDispatch::Integrals>;
+    if (!Dispatcher::Execute(intensities, laserIds, rangeWorker))
     {
-      int point_intensity = intensities->GetValue(i);
-      if (point_intensity < minimum_intensity)
-      {
-        minimum_intensity = point_intensity;
-      }
-      if (point_intensity > maximum_intensity)
-      {
-        maximum_intensity = point_intensity;
-      }
+      rangeWorker(intensities, laserIds);
     }
   }
 
   // Add field data with some numbers
-  vtkSmartPointer<vtkFloatArray> fielddata = vtkSmartPointer<vtkFloatArray>::New();
-  fielddata->SetName("Values");
-  fielddata->SetNumberOfComponents(1);
-  fielddata->InsertNextValue(minimum_intensity);
-  fielddata->InsertNextValue(maximum_intensity);
-
-  vtkSmartPointer<vtkPolyData> outputPolyData = vtkSmartPointer<vtkPolyData>::New();
-  outputPolyData->DeepCopy(spheresource->GetOutput());
-  outputPolyData->GetFieldData()->AddArray(fielddata);
+  this->Values->SetNumberOfValues(2);
+  this->Values->SetValue(0, rangeWorker.Range.first);
+  this->Values->SetValue(1, rangeWorker.Range.second);
+  this->Values->Modified();
 
-  output->ShallowCopy(outputPolyData);
+  // The output shares the geometry of the sphere, but has its own field data
+  output->ShallowCopy(this->Sphere->GetOutput());
+  vtkNew<vtkFieldData> fieldData;
+  fieldData->AddArray(this->Values.Get());
+  output->SetFieldData(fieldData.Get());
 
   return 1;
 }
@@ -123,4 +240,5 @@ int vtkProcessingSample::RequestData(vtkInformation* vtkNotUsed(request),
 void vtkProcessingSample::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "LaserId: " << this->LaserId << endl;
 }
@@ -15,15 +15,30 @@
 // limitations under the License.
 //=========================================================================
 //
-// .NAME vtkProcessingSample -
+// .NAME vtkProcessingSample - Sample of processing of the point clouds
 // .SECTION Description
+// Outputs a sphere at the mean of the input points, with the minimal and
+// maximal intensities of a laser in the field data array "Values".
 //
+// This filter is the skeleton from which the processing filters start:
+// - the arrays are accessed with their actual value type, through
+//   vtkArrayDispatch and vtkDataArrayAccessor, rather than converting each
+//   value to double with the generic vtkDataArray accessors. Arrays of other
+//   types fall back on the generic accessors.
+// - the loops over the points are split between threads by vtkSMPTools, each
+//   thread accumulating in a vtkSMPThreadLocal reduced at the end.
+// - the pipeline objects and the arrays of the output are members kept from
+//   one update to the next, instead of being allocated at each update.
 
 #ifndef __vtkProcessingSample_h
 #define __vtkProcessingSample_h
 
+#include <vtkNew.h>
 #include <vtkPolyDataAlgorithm.h>
 
+class vtkFloatArray;
+class vtkSphereSource;
+
 class VTK_EXPORT vtkProcessingSample : public vtkPolyDataAlgorithm
 {
 public:
@@ -32,6 +47,10 @@ public:
 
   static vtkProcessingSample* New();
 
+  //! Laser whose intensities are analyzed
+  vtkGetMacro(LaserId, int)
+  vtkSetMacro(LaserId, int)
+
 protected:
   virtual int RequestData(vtkInformation* request, vtkInformationVector** inputVector,
     vtkInformationVector* outputVector);
@@ -39,6 +58,12 @@ protected:
   vtkProcessingSample();
   virtual ~vtkProcessingSample();
 
+  int LaserId = 3;
+
+  // reused at each update
+  vtkNew<vtkSphereSource> Sphere;
+  vtkNew<vtkFloatArray> Values;
+
 private:
   vtkProcessingSample(const vtkProcessingSample&); // Not implemented.
   void operator=(const vtkProcessingSample&);      // Not implemented.
@@ -18,13 +18,18 @@
 
 #include "vtkConversions.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
+#include <random>
 
 #include <vtkPointData.h>
 #include <vtkInformationVector.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkPoints.h>
+#include <vtkSMPTools.h>
 #include <vtkUnsignedIntArray.h>
 
 #include <Eigen/Dense>
@@ -108,20 +113,76 @@ void RefineRansac(std::vector<Eigen::Vector3d >& Points, vtkPolyData* output,
 }
 
 
+namespace {
+// Number of hypotheses drawn and scored in parallel before checking the stop criteria
+const unsigned int BatchSize = 32;
+
 //----------------------------------------------------------------------------
-unsigned int ComputeNumberOfInlier(std::vector<Eigen::Vector3d >& Points, Eigen::Vector3d planePoint,
-                                   Eigen::Vector3d planeNormal, double threshold)
+// Coordinates of points stored by component, so that the distances to a plane
+// are computed by vectorizable loops
+struct PointsByComponent
 {
-  unsigned int nInliers = 0;
-  for (unsigned int k = 0; k < Points.size(); ++k)
+  std::vector<float> X, Y, Z;
+
+  void Resize(size_t n)
+  {
+    this->X.resize(n);
+    this->Y.resize(n);
+    this->Z.resize(n);
+  }
+
+  void Set(size_t i, const Eigen::Vector3d& point)
   {
-    if (std::abs((Points[k] - planePoint).dot(planeNormal)) < threshold)
+    this->X[i] = static_cast<float>(point.x());
+    this->Y[i] = static_cast<float>(point.y());
+    this->Z[i] = static_cast<float>(point.z());
+  }
+
+  unsigned int CountInliers(const float plane[4], float threshold) const
+  {
+    const float a = plane[0], b = plane[1], c = plane[2], d = plane[3];
+    const float* x = this->X.data();
+    const float* y = this->Y.data();
+    const float* z = this->Z.data();
+    const size_t n = this->X.size();
+    unsigned int nInliers = 0;
+    for (size_t k = 0; k < n; ++k)
     {
-      nInliers++;
+      nInliers += std::abs(a * x[k] + b * y[k] + c * z[k] + d) < threshold;
     }
+    return nInliers;
   }
+};
 
-  return nInliers;
+//----------------------------------------------------------------------------
+// Hypothesis of a ransac batch
+struct RansacHypothesis
+{
+  unsigned int Index[3];
+  //! normalized plane equation, null for a degenerated sample
+  float Plane[4];
+  unsigned int NSubsetInliers = 0;
+  //! number of inliers among all points, only computed for the promising hypotheses
+  unsigned int NInliers = 0;
+  bool Scored = false;
+};
+
+//----------------------------------------------------------------------------
+// Number of iterations after which an all inliers sample has been drawn with
+// the given confidence, for the given ratio of inliers
+double AdaptiveIterationBound(double inliersRatio, double confidence)
+{
+  const double sampleInliersProba = inliersRatio * inliersRatio * inliersRatio;
+  if (sampleInliersProba >= 1.0)
+  {
+    return 1.0;
+  }
+  if (sampleInliersProba <= 0.0 || confidence <= 0.0)
+  {
+    return std::numeric_limits<double>::infinity();
+  }
+  return std::log(1.0 - std::min(confidence, 1.0 - 1e-12)) / std::log(1.0 - sampleInliersProba);
+}
 }
 
 // Implementation of the New function
@@ -144,86 +205,142 @@ int vtkRansacPlaneModel::RequestData(vtkInformation *vtkNotUsed(request),
 
   // Convert the point cloud in Eigen data structure point cloud
   std::vector<Eigen::Vector3d> Points = vtkPointsToEigenVector(input->GetPoints());
+  const unsigned int nPoints = static_cast<unsigned int>(Points.size());
+  if (nPoints < 3)
+  {
+    vtkWarningMacro("At least 3 points are required to fit a plane");
+    return 1;
+  }
 
-  // Create a random order of points index
-  std::vector<double> randomIndex(input->GetNumberOfPoints(), 0);
-  for (unsigned int k = 0; k < randomIndex.size(); ++k)
+  // The hypotheses are first scored on a random subset of the points, only
+  // the ones that may beat the best hypothesis being scored on all points
+  std::mt19937 generator(std::rand());
+  std::uniform_int_distribution<unsigned int> randomIndex(0, nPoints - 1);
+  PointsByComponent allPoints;
+  allPoints.Resize(nPoints);
+  for (unsigned int k = 0; k < nPoints; ++k)
+  {
+    allPoints.Set(k, Points[k]);
+  }
+  const bool useSubset = nPoints > this->PreemptiveSubsetSize;
+  PointsByComponent subsetPoints;
+  if (useSubset)
   {
-    randomIndex[k] = k;
+    subsetPoints.Resize(this->PreemptiveSubsetSize);
+    for (unsigned int k = 0; k < this->PreemptiveSubsetSize; ++k)
+    {
+      subsetPoints.Set(k, Points[randomIndex(generator)]);
+    }
   }
-  std::random_shuffle(randomIndex.begin(), randomIndex.end());
+  const PointsByComponent& preemptivePoints = useSubset ? subsetPoints : allPoints;
+
+  const float threshold = static_cast<float>(this->Threshold);
 
   // information variable about ransac iterations
-  bool shouldStopRansac = false;
   unsigned int iterationMade = 0;
-  unsigned int iterationPointer = 0;
-
-  // keep information of iterations
-  std::vector<RansacSampleInfo> samplesInfo;
-  unsigned int maxInliers = 0;
-  unsigned int indexMaxInliers = 0;
-
-  // Affine plane PlaneParameters
-  Eigen::Vector3d planeNormal, planePoint;
-
-  // indicate if ransac has "converged"
   bool hasConverged = false;
+  RansacSampleInfo bestSample(0, 0, 1, 2);
+  unsigned int maxInliers = 0;
+  unsigned int maxSubsetInliers = 0;
+  double iterationBound = std::numeric_limits<double>::infinity();
 
-  // Ransac loop
-  while (!shouldStopRansac)
+  // Ransac loop, by batches of hypotheses evaluated in parallel
+  std::vector<RansacHypothesis> batch(BatchSize);
+  while (!hasConverged && iterationMade <= this->MaxRansacIteration && iterationMade < iterationBound)
   {
-    // if we went throught the all random index we need
-    // to random shuffle again
-    if ((iterationPointer + 2) >= randomIndex.size())
+    // Draw the samples, without shuffling the whole cloud
+    for (auto& hypothesis : batch)
     {
-      std::random_shuffle(randomIndex.begin(), randomIndex.end());
-      iterationPointer = 0;
+      unsigned int* index = hypothesis.Index;
+      index[0] = randomIndex(generator);
+      do { index[1] = randomIndex(generator); } while (index[1] == index[0]);
+      do { index[2] = randomIndex(generator); } while (index[2] == index[0] || index[2] == index[1]);
+      hypothesis.Scored = false;
+      hypothesis.NInliers = 0;
     }
 
-    // Compute current sample plane PlaneParameters
-    planePoint = Points[randomIndex[iterationPointer]];
-    planeNormal = (Points[randomIndex[iterationPointer + 2]] - planePoint).cross(Points[randomIndex[iterationPointer + 1]] - planePoint);
-    planeNormal.normalize();
-
-    // Compute the number of inliers / outliers
-    unsigned int nInliers = ComputeNumberOfInlier(Points, planePoint, planeNormal, this->Threshold);
-
-    // keep info
-    RansacSampleInfo info(nInliers, randomIndex[iterationPointer], randomIndex[iterationPointer + 1], randomIndex[iterationPointer + 2]);
-    samplesInfo.push_back(info);
-
-    if (nInliers > maxInliers)
+    // Score them on the subset
+    vtkSMPTools::For(0, BatchSize, 1, [&](vtkIdType begin, vtkIdType end)
+    {
+      for (vtkIdType i = begin; i < end; ++i)
+      {
+        RansacHypothesis& hypothesis = batch[i];
+        const Eigen::Vector3d& planePoint = Points[hypothesis.Index[0]];
+        Eigen::Vector3d planeNormal = (Points[hypothesis.Index[2]] - planePoint).cross(Points[hypothesis.Index[1]] - planePoint);
+        const double norm = planeNormal.norm();
+        if (!(norm > 0.0))
+        {
+          // degenerated sample, the points are aligned
+          std::fill(hypothesis.Plane, hypothesis.Plane + 4, 0.f);
+          hypothesis.NSubsetInliers = 0;
+          continue;
+        }
+        planeNormal /= norm;
+        for (int k = 0; k < 3; ++k)
+        {
+          hypothesis.Plane[k] = static_cast<float>(planeNormal(k));
+        }
+        hypothesis.Plane[3] = static_cast<float>(-planeNormal.dot(planePoint));
+        hypothesis.NSubsetInliers = preemptivePoints.CountInliers(hypothesis.Plane, threshold);
+      }
+    });
+
+    // Score the promising ones on all the points. The tolerance of three
+    // standard deviations of the subset count keeps the hypotheses that are
+    // as good as the best one
+    for (const auto& hypothesis : batch)
     {
-      maxInliers = nInliers;
-      indexMaxInliers = iterationMade;
+      maxSubsetInliers = std::max(maxSubsetInliers, hypothesis.NSubsetInliers);
     }
-
-    // Check that the number of inliers is enought to
-    // break the ransac algorithm loop
-    if (nInliers > input->GetNumberOfPoints() * this->RatioInliersRequired)
+    const double minSubsetInliers = maxSubsetInliers - 3.0 * std::sqrt(static_cast<double>(maxSubsetInliers));
+    std::vector<unsigned int> promising;
+    for (unsigned int i = 0; i < BatchSize; ++i)
     {
-      shouldStopRansac = true;
-      hasConverged = true;
+      if (batch[i].NSubsetInliers > 0 && batch[i].NSubsetInliers >= minSubsetInliers)
+      {
+        promising.push_back(i);
+      }
     }
-
-    // check if the maximum iteration has been reached
-    if (iterationMade > this->MaxRansacIteration)
+    vtkSMPTools::For(0, static_cast<vtkIdType>(promising.size()), 1, [&](vtkIdType begin, vtkIdType end)
+    {
+      for (vtkIdType i = begin; i < end; ++i)
+      {
+        RansacHypothesis& hypothesis = batch[promising[i]];
+        hypothesis.NInliers = useSubset ? allPoints.CountInliers(hypothesis.Plane, threshold) : hypothesis.NSubsetInliers;
+        hypothesis.Scored = true;
+      }
+    });
+
+    // Keep the best hypothesis, in the drawing order
+    for (const auto& hypothesis : batch)
     {
-      shouldStopRansac = true;
+      iterationMade++;
+      if (hypothesis.Scored && hypothesis.NInliers > maxInliers)
+      {
+        maxInliers = hypothesis.NInliers;
+        bestSample = RansacSampleInfo(hypothesis.NInliers, hypothesis.Index[0], hypothesis.Index[1], hypothesis.Index[2]);
+      }
+
+      // Check that the number of inliers is enought to
+      // break the ransac algorithm loop
+      if (hypothesis.Scored && hypothesis.NInliers > nPoints * this->RatioInliersRequired)
+      {
+        hasConverged = true;
+        break;
+      }
     }
 
-    // Updates iterations index
-    iterationMade++;
-    iterationPointer += 3; 
+    // Stop when a sample without outlier has been drawn with enough confidence
+    iterationBound = AdaptiveIterationBound(static_cast<double>(maxInliers) / nPoints, this->Confidence);
   }
 
   // Now refine using all inliers
-  RefineRansac(Points, output, samplesInfo[indexMaxInliers], this->Threshold, this->PlaneParam);
+  RefineRansac(Points, output, bestSample, this->Threshold, this->PlaneParam);
 
   // output info
   std::cout << "ransac algorithm has converged: " << hasConverged << std::endl;
   std::cout << "number of iteration made: " << iterationMade << std::endl;
-  std::cout << "number of inliers: " << maxInliers << ", " << samplesInfo[indexMaxInliers].NInliers << std::endl;
+  std::cout << "number of inliers: " << maxInliers << ", " << bestSample.NInliers << std::endl;
   std::cout << "plane PlaneParams: [" << this->PlaneParam[0] << "," << this->PlaneParam[1] << "," << this->PlaneParam[2] << "," << this->PlaneParam[3] << "]" << std::endl;
 
   // flip normal if needed
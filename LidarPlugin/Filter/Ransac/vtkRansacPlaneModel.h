@@ -37,6 +37,15 @@ public:
   vtkGetMacro(RatioInliersRequired, double)
   vtkSetMacro(RatioInliersRequired, double)
 
+  /// Get/Set the confidence of having drawn a sample without outlier at which
+  /// the ransac algorithm loop stops
+  vtkGetMacro(Confidence, double)
+  vtkSetClampMacro(Confidence, double, 0.0, 1.0)
+
+  /// Get/Set the number of points on which the hypotheses are first scored
+  vtkGetMacro(PreemptiveSubsetSize, unsigned int)
+  vtkSetMacro(PreemptiveSubsetSize, unsigned int)
+
   /// Get/Set the plane fitted parameters
   vtkGetVector4Macro(PlaneParam, double)
   vtkSetVector4Macro(PlaneParam, double)
@@ -75,6 +84,15 @@ private:
   /// ratio of inliers required to break the ransac algorithm loop
   double RatioInliersRequired = 0.3;
 
+  /// confidence of having drawn a sample without outlier at which the ransac
+  /// algorithm loop stops, the number of iterations required being updated
+  /// with the ratio of inliers of the best hypothesis
+  double Confidence = 0.99;
+
+  /// number of random points on which the hypotheses are first scored, only
+  /// the ones that may beat the best hypothesis being scored on all points
+  unsigned int PreemptiveSubsetSize = 2000;
+
   /// plane fitted parameters
   double PlaneParam[4] = {0, 0, 0, 0};
 
@@ -1,6 +1,7 @@
 #include "KalmanFilter.h"
 
-#include <iostream>
+#include <algorithm>
+#include <cmath>
 
 
 //-----------------------------------------------------------------------------
@@ -32,14 +33,8 @@ void KalmanFilter::ResetKalmanFilter()
   this->EstimatorCovariance = Eigen::Matrix<double, 12, 12>::Zero();
 
   // Fill measure model
-  this->MeasureModel = Eigen::MatrixXd(this->NbrMeasures, 12);// ::Matrix<double, 6, 12>::Zero();
-  for (unsigned int j = 0; j < 12; ++j)
-  {
-    for (unsigned int i = 0; i < this->NbrMeasures; ++i)
-    {
-      this->MeasureModel(i, j) = 0.0;
-    }
-  }
+  this->MeasureModel.setZero(this->NbrMeasures, 12);
+  this->MeasureCovariance.setIdentity(this->NbrMeasures, this->NbrMeasures);
   for (unsigned int i = 0; i < 6; ++i)
   {
     this->MeasureModel(i, i) = 1.0;
@@ -72,7 +67,7 @@ void KalmanFilter::ResetKalmanFilter()
 }
 
 //-----------------------------------------------------------------------------
-void KalmanFilter::SetInitialStatevector(Eigen::Matrix<double, 12, 1> iniVector, Eigen::Matrix<double, 12, 12> iniCov)
+void KalmanFilter::SetInitialStatevector(const StateVector& iniVector, const StateMatrix& iniCov)
 {
   this->VectorState = iniVector;
   this->EstimatorCovariance = iniCov;
@@ -116,7 +111,7 @@ void KalmanFilter::SetCurrentTime(double time)
 }
 
 //-----------------------------------------------------------------------------
-void KalmanFilter::SetMeasureCovariance(Eigen::MatrixXd argCov)
+void KalmanFilter::SetMeasureCovariance(const MeasureMatrix& argCov)
 {
   this->MeasureCovariance = argCov;
 }
@@ -132,7 +127,83 @@ void KalmanFilter::Prediction()
 }
 
 //-----------------------------------------------------------------------------
-void KalmanFilter::Correction(Eigen::MatrixXd Measure)
+void KalmanFilter::Prediction(const std::vector<ImuSample>& samples)
+{
+  if (samples.empty())
+  {
+    this->Prediction();
+    return;
+  }
+
+  StateVector state = this->VectorState;
+  StateMatrix covariance = this->EstimatorCovariance;
+
+  // The angles are integrated from the angular velocity given by the
+  // gyroscope, which replaces the one of the state, and the position
+  // and the velocity from the acceleration given by the accelerometer
+  StateMatrix transition = StateMatrix::Identity();
+  for (unsigned int i = 6; i < 9; ++i)
+  {
+    transition(i, i) = 0.0;
+  }
+  StateMatrix noise = StateMatrix::Zero();
+
+  size_t k = 0;
+  double time = this->PreviousTime;
+  while (time < this->CurrentTime)
+  {
+    // sample held at this time
+    while (k + 1 < samples.size() && samples[k + 1].Time <= time)
+    {
+      ++k;
+    }
+    const double next = (k + 1 < samples.size()) ? std::min(samples[k + 1].Time, this->CurrentTime)
+                                                 : this->CurrentTime;
+    const double dt = next - time;
+    const ImuSample& sample = samples[k];
+
+    // Euler angles rates from the angular velocity in the sensor frame,
+    // the rotation being Rz(rz) * Ry(ry) * Rx(rx)
+    const double cx = std::cos(state(0)), sx = std::sin(state(0));
+    const double cy = std::max(std::cos(state(1)), 1e-6), sy = std::sin(state(1));
+    Eigen::Matrix3d eulerRates;
+    eulerRates << 1.0, sx * sy / cy, cx * sy / cy,
+                  0.0, cx,           -sx,
+                  0.0, sx / cy,      cx / cy;
+    state.segment<3>(6) = eulerRates * sample.AngularVelocity;
+
+    // Acceleration in the world reference frame
+    const Eigen::Matrix3d rotation(Eigen::AngleAxisd(state(2), Eigen::Vector3d::UnitZ())
+                                 * Eigen::AngleAxisd(state(1), Eigen::Vector3d::UnitY())
+                                 * Eigen::AngleAxisd(state(0), Eigen::Vector3d::UnitX()));
+    const Eigen::Vector3d acceleration = rotation * sample.Acceleration + this->Gravity;
+
+    state.segment<3>(0) += dt * state.segment<3>(6);
+    state.segment<3>(3) += dt * state.segment<3>(9) + 0.5 * dt * dt * acceleration;
+    state.segment<3>(9) += dt * acceleration;
+
+    for (unsigned int i = 3; i < 6; ++i)
+    {
+      transition(i, i + 6) = dt;
+    }
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+      noise(i, i) = std::pow(this->GyroscopeNoise * dt, 2);
+      noise(i + 3, i + 3) = std::pow(0.5 * this->AccelerometerNoise * dt * dt, 2);
+      noise(i + 6, i + 6) = std::pow(this->GyroscopeNoise, 2);
+      noise(i + 9, i + 9) = std::pow(this->AccelerometerNoise * dt, 2);
+    }
+    covariance = transition * covariance * transition.transpose() + noise;
+
+    time = next;
+  }
+
+  this->VectorStatePredicted = state;
+  this->EstimatorCovariance = covariance;
+}
+
+//-----------------------------------------------------------------------------
+void KalmanFilter::Correction(const MeasureVector& Measure)
 {
   // Update the measure model, since we have a non
   // linear link between the state vector and the measure
@@ -150,17 +221,20 @@ void KalmanFilter::Correction(Eigen::MatrixXd Measure)
     this->MeasureModel(6, 9) = this->VectorStatePredicted(9) / nv;
     this->MeasureModel(6, 10) = this->VectorStatePredicted(10) / nv;
     this->MeasureModel(6, 11) = this->VectorStatePredicted(11) / nv;
-    std::cout << "Vector State: " << std::endl << this->VectorStatePredicted.transpose() << std::endl;
-    std::cout << "Measure: " << std::endl << Measure.transpose() << std::endl;
-    std::cout << "Measure model: " << std::endl << this->MeasureModel << std::endl;
   }
 
-  // Update using the measure and its covariance
-  Eigen::MatrixXd novelty = (this->MeasureModel * this->EstimatorCovariance * this->MeasureModel.transpose() + this->MeasureCovariance);
-  Eigen::MatrixXd gain = this->EstimatorCovariance * this->MeasureModel.transpose() * novelty.inverse();
+  // Update using the measure and its covariance. The novelty is
+  // symmetric positive definite, the gain P * H' * S^-1 is computed
+  // as the transpose of S^-1 * H * P without inverting S
+  const MeasureMatrix novelty = this->MeasureModel * this->EstimatorCovariance * this->MeasureModel.transpose()
+                              + this->MeasureCovariance;
+  const Eigen::Matrix<double, Eigen::Dynamic, 12, 0, 7, 12> modelCovariance =
+    this->MeasureModel * this->EstimatorCovariance;
+  const Eigen::Matrix<double, 12, Eigen::Dynamic, 0, 12, 7> gain =
+    novelty.ldlt().solve(modelCovariance).transpose();
 
   // Update the vector state estimation
-  Eigen::MatrixXd errVector(this->NbrMeasures, 1);
+  MeasureVector errVector(this->NbrMeasures);
   if (this->mode > 0)
   {
     for (unsigned int k = 0; k < 6; ++k)
@@ -178,11 +252,11 @@ void KalmanFilter::Correction(Eigen::MatrixXd Measure)
   this->VectorState = this->VectorStatePredicted + gain * errVector;
 
   // Update Estimator covariance
-  this->EstimatorCovariance = this->EstimatorCovariance - gain * this->MeasureModel * this->EstimatorCovariance;
+  this->EstimatorCovariance = this->EstimatorCovariance - gain * modelCovariance;
 }
 
 //-----------------------------------------------------------------------------
-Eigen::Matrix<double, 12, 1> KalmanFilter::GetStateVector()
+KalmanFilter::StateVector KalmanFilter::GetStateVector()
 {
   return this->VectorState;
 }
@@ -199,6 +273,19 @@ void KalmanFilter::SetMaxVelocityAcceleration(double acc)
   this->MaxAcceleration = acc;
 }
 
+//-----------------------------------------------------------------------------
+void KalmanFilter::SetImuNoise(double gyroscopeNoise, double accelerometerNoise)
+{
+  this->GyroscopeNoise = gyroscopeNoise;
+  this->AccelerometerNoise = accelerometerNoise;
+}
+
+//-----------------------------------------------------------------------------
+void KalmanFilter::SetGravity(const Eigen::Vector3d& gravity)
+{
+  this->Gravity = gravity;
+}
+
 //-----------------------------------------------------------------------------
 void KalmanFilter::SetMode(int argMode)
 {
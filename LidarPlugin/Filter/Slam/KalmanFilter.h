@@ -2,12 +2,33 @@
 #define KALMANFILTER_H
 
 #include <math.h>
+#include <vector>
 
 #include <Eigen/Dense>
 
+// Sample of an inertial measurement unit, expressed
+// in the reference frame of the sensor:
+// - angular velocity measured by the gyroscope, in rad.s-1
+// - specific force measured by the accelerometer, in m.s-2,
+//   i.e. the acceleration minus the gravity
+struct ImuSample
+{
+  double Time = 0.0;
+  Eigen::Vector3d AngularVelocity = Eigen::Vector3d::Zero();
+  Eigen::Vector3d Acceleration = Eigen::Vector3d::Zero();
+};
+
+// The state has 12 components and there are at most 7 measures, all
+// the matrices are fixed-size or bounded, so that the prediction and
+// the correction steps never allocate memory on the heap
 class KalmanFilter
 {
 public:
+  typedef Eigen::Matrix<double, 12, 1> StateVector;
+  typedef Eigen::Matrix<double, 12, 12> StateMatrix;
+  typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, 7, 1> MeasureVector;
+  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, 7, 7> MeasureMatrix;
+
   // default constructor
   KalmanFilter();
 
@@ -20,12 +41,26 @@ public:
   // Prediction of the next state vector
   void Prediction();
 
+  // Prediction of the state vector at the current time, integrating
+  // the IMU samples received since the previous time instead of using
+  // the constant velocity model. The angular velocity of the state is
+  // given by the gyroscope and the acceleration by the accelerometer,
+  // each sample being held until the next one
+  void Prediction(const std::vector<ImuSample>& samples);
+
   // Correction of the prediction using
   // the input measure
-  void Correction(Eigen::MatrixXd Measure);
+  void Correction(const MeasureVector& Measure);
 
   // Set the measures variance covariance matrix
-  void SetMeasureCovariance(Eigen::MatrixXd argCov);
+  void SetMeasureCovariance(const MeasureMatrix& argCov);
+
+  // Set the standard deviation of the noise of the gyroscope (in rad.s-1)
+  // and of the accelerometer (in m.s-2) of the IMU samples
+  void SetImuNoise(double gyroscopeNoise, double accelerometerNoise);
+
+  // Set the gravity, in the world reference frame (in m.s-2)
+  void SetGravity(const Eigen::Vector3d& gravity);
 
   // Set the maximum angle acceleration
   // use to compute variance covariance matrix
@@ -36,11 +71,11 @@ public:
   void SetMaxVelocityAcceleration(double acc);
 
   // return the state vector
-  Eigen::Matrix<double, 12, 1> GetStateVector();
+  StateVector GetStateVector();
 
   // Initialize the state vector and the covariance-variance
   // estimation
-  void SetInitialStatevector(Eigen::Matrix<double, 12, 1> iniVector, Eigen::Matrix<double, 12, 12> iniCov);
+  void SetInitialStatevector(const StateVector& iniVector, const StateMatrix& iniCov);
 
   // set the kalman filter mode
   void SetMode(int argMode);
@@ -53,40 +88,47 @@ private:
   // Kalman Filter mode:
   // 0 : Motion Model
   // 1 : Motion Model + GPS velocity
-  int mode;
+  int mode = 0;
 
   // Motion model / Prediction Model
-  Eigen::Matrix<double, 12, 12> MotionModel;
+  StateMatrix MotionModel;
 
   // Link between the measures and the state vector
-  Eigen::MatrixXd MeasureModel;
+  Eigen::Matrix<double, Eigen::Dynamic, 12, 0, 7, 12> MeasureModel;
 
   // Variance-Covariance of measures
-  Eigen::MatrixXd MeasureCovariance;
+  MeasureMatrix MeasureCovariance;
 
   // Variance-Covariance of model
-  Eigen::Matrix<double, 12, 12> ModelCovariance;
+  StateMatrix ModelCovariance;
 
   // State vector composed like this:
   // -rx, ry, rz
   // -tx, ty, tz
   // -drx/dt, dry/dt, drz/dt
   // -dtx/dt, dty/dt, dtz/dt
-  Eigen::Matrix<double, 12, 1> VectorState;
-  Eigen::Matrix<double, 12, 1> VectorStatePredicted;
+  StateVector VectorState;
+  StateVector VectorStatePredicted;
 
   // Estimator variance covariance
-  Eigen::Matrix<double, 12, 12> EstimatorCovariance;
+  StateMatrix EstimatorCovariance;
 
   // delta time for prediction
-  double PreviousTime;
-  double CurrentTime;
-  double DeltaTime;
+  double PreviousTime = 0.0;
+  double CurrentTime = 0.0;
+  double DeltaTime = 0.0;
 
   // Maximale acceleration endorsed by the vehicule
   double MaxAcceleration;
   double MaxAngleAcceleration;
 
+  // Noise of the IMU samples
+  double GyroscopeNoise = 0.01;
+  double AccelerometerNoise = 0.1;
+
+  // Gravity in the world reference frame
+  Eigen::Vector3d Gravity = Eigen::Vector3d(0.0, 0.0, -9.81);
+
   // indicate the number of observed measures
   unsigned int NbrMeasures;
 };
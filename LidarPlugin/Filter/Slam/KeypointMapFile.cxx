@@ -0,0 +1,251 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "KeypointMapFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <tuple>
+
+namespace
+{
+const char Magic[8] = { 'L', 'V', 'K', 'P', 'M', 'A', 'P', '\0' };
+const uint32_t Version = 1;
+//! Written as is, to detect a file written with another byte order
+const uint32_t ByteOrderMark = 0x01020304;
+
+struct LayerHeader
+{
+  uint64_t NumberOfVoxels;
+  uint64_t NumberOfPoints;
+  uint64_t VoxelsOffset;
+  uint64_t PointsOffset;
+  uint64_t FitsOffset;
+};
+
+struct FileHeader
+{
+  char Magic[8];
+  uint32_t Version;
+  uint32_t ByteOrder;
+  double VoxelResolution;
+  LayerHeader Layers[KeypointMapFile::NumberOfLayers];
+};
+}
+
+//-----------------------------------------------------------------------------
+Eigen::Matrix3d KeypointMapFile::Fit::GetA() const
+{
+  Eigen::Matrix3d a;
+  a << this->A[0], this->A[1], this->A[2],
+       this->A[1], this->A[3], this->A[4],
+       this->A[2], this->A[4], this->A[5];
+  return a;
+}
+
+//-----------------------------------------------------------------------------
+Eigen::Vector3d KeypointMapFile::Fit::GetMean() const
+{
+  return Eigen::Vector3d(this->Mean[0], this->Mean[1], this->Mean[2]);
+}
+
+//-----------------------------------------------------------------------------
+void KeypointMapFile::Fit::SetA(const Eigen::Matrix3d& a)
+{
+  // the matrices of the distance functions are symmetric
+  this->A[0] = static_cast<float>(a(0, 0));
+  this->A[1] = static_cast<float>(0.5 * (a(0, 1) + a(1, 0)));
+  this->A[2] = static_cast<float>(0.5 * (a(0, 2) + a(2, 0)));
+  this->A[3] = static_cast<float>(a(1, 1));
+  this->A[4] = static_cast<float>(0.5 * (a(1, 2) + a(2, 1)));
+  this->A[5] = static_cast<float>(a(2, 2));
+}
+
+//-----------------------------------------------------------------------------
+bool KeypointMapFile::Write(const std::string& filename, double voxelResolution,
+                            const LayerData (&layers)[NumberOfLayers])
+{
+  // Sort the points of each layer by voxel, keeping the order of the
+  // points of a voxel, and gather the voxels
+  std::vector<Voxel> voxels[NumberOfLayers];
+  std::vector<PointRecord> points[NumberOfLayers];
+  std::vector<Fit> fits[NumberOfLayers];
+  for (int layer = 0; layer < NumberOfLayers; ++layer)
+  {
+    if (!layers[layer].Points)
+    {
+      continue;
+    }
+    const pcl::PointCloud<Point>& cloud = *layers[layer].Points;
+    if (layers[layer].Fits.size() != cloud.size())
+    {
+      std::cerr << "Could not write the keypoint map " << filename
+                << ": a fit is required for each point" << std::endl;
+      return false;
+    }
+    std::vector<std::tuple<int32_t, int32_t, int32_t> > indices(cloud.size());
+    for (size_t i = 0; i < cloud.size(); ++i)
+    {
+      indices[i] = std::make_tuple(static_cast<int32_t>(std::floor(cloud.points[i].x / voxelResolution)),
+                                   static_cast<int32_t>(std::floor(cloud.points[i].y / voxelResolution)),
+                                   static_cast<int32_t>(std::floor(cloud.points[i].z / voxelResolution)));
+    }
+    std::vector<size_t> order(cloud.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&indices](size_t a, size_t b) { return indices[a] < indices[b]; });
+
+    points[layer].reserve(order.size());
+    fits[layer].reserve(order.size());
+    for (size_t i : order)
+    {
+      const Point& p = cloud.points[i];
+      PointRecord record = {};
+      record.X = p.x;
+      record.Y = p.y;
+      record.Z = p.z;
+      record.Intensity = p.intensity;
+      record.LaserId = p.laserId;
+      record.Time = p.time;
+      if (voxels[layer].empty() || std::make_tuple(voxels[layer].back().X, voxels[layer].back().Y,
+                                                   voxels[layer].back().Z) != indices[i])
+      {
+        Voxel voxel = {};
+        std::tie(voxel.X, voxel.Y, voxel.Z) = indices[i];
+        voxel.FirstPoint = points[layer].size();
+        voxels[layer].push_back(voxel);
+      }
+      voxels[layer].back().NumberOfPoints++;
+      points[layer].push_back(record);
+      fits[layer].push_back(layers[layer].Fits[i]);
+    }
+  }
+
+  FileHeader header = {};
+  std::memcpy(header.Magic, Magic, sizeof(Magic));
+  header.Version = Version;
+  header.ByteOrder = ByteOrderMark;
+  header.VoxelResolution = voxelResolution;
+  uint64_t offset = sizeof(FileHeader);
+  for (int layer = 0; layer < NumberOfLayers; ++layer)
+  {
+    LayerHeader& layerHeader = header.Layers[layer];
+    layerHeader.NumberOfVoxels = voxels[layer].size();
+    layerHeader.NumberOfPoints = points[layer].size();
+    layerHeader.VoxelsOffset = offset;
+    offset += voxels[layer].size() * sizeof(Voxel);
+    layerHeader.PointsOffset = offset;
+    offset += points[layer].size() * sizeof(PointRecord);
+    layerHeader.FitsOffset = offset;
+    offset += fits[layer].size() * sizeof(Fit);
+  }
+
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (int layer = 0; layer < NumberOfLayers; ++layer)
+  {
+    file.write(reinterpret_cast<const char*>(voxels[layer].data()), voxels[layer].size() * sizeof(Voxel));
+    file.write(reinterpret_cast<const char*>(points[layer].data()), points[layer].size() * sizeof(PointRecord));
+    file.write(reinterpret_cast<const char*>(fits[layer].data()), fits[layer].size() * sizeof(Fit));
+  }
+  if (!file)
+  {
+    std::cerr << "Could not write the keypoint map " << filename << std::endl;
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool KeypointMapFile::Open(const std::string& filename)
+{
+  if (this->File.is_open())
+  {
+    this->File.close();
+  }
+  for (LayerView& layer : this->Layers)
+  {
+    layer = LayerView();
+  }
+  try
+  {
+    this->File.open(filename);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "Could not open the keypoint map " << filename << ": " << e.what() << std::endl;
+    return false;
+  }
+
+  // the offsets are multiples of 8 from the start of the mapping,
+  // which is page aligned, so that the records can be read in place
+  FileHeader header;
+  if (this->File.size() < sizeof(FileHeader))
+  {
+    std::cerr << "The file " << filename << " is not a keypoint map" << std::endl;
+    this->File.close();
+    return false;
+  }
+  std::memcpy(&header, this->File.data(), sizeof(header));
+  if (std::memcmp(header.Magic, Magic, sizeof(Magic)) != 0 || header.Version != Version ||
+      header.ByteOrder != ByteOrderMark)
+  {
+    std::cerr << "The file " << filename << " is not a keypoint map of this version and byte order" << std::endl;
+    this->File.close();
+    return false;
+  }
+  for (int layer = 0; layer < NumberOfLayers; ++layer)
+  {
+    const LayerHeader& layerHeader = header.Layers[layer];
+    if (layerHeader.VoxelsOffset + layerHeader.NumberOfVoxels * sizeof(Voxel) > this->File.size() ||
+        layerHeader.PointsOffset + layerHeader.NumberOfPoints * sizeof(PointRecord) > this->File.size() ||
+        layerHeader.FitsOffset + layerHeader.NumberOfPoints * sizeof(Fit) > this->File.size())
+    {
+      std::cerr << "The keypoint map " << filename << " is truncated" << std::endl;
+      this->File.close();
+      return false;
+    }
+    LayerView& view = this->Layers[layer];
+    view.NumberOfPoints = layerHeader.NumberOfPoints;
+    const Voxel* voxels = reinterpret_cast<const Voxel*>(this->File.data() + layerHeader.VoxelsOffset);
+    view.Voxels.assign(voxels, voxels + layerHeader.NumberOfVoxels);
+    view.Points = reinterpret_cast<const PointRecord*>(this->File.data() + layerHeader.PointsOffset);
+    view.Fits = reinterpret_cast<const Fit*>(this->File.data() + layerHeader.FitsOffset);
+  }
+  this->VoxelResolution = header.VoxelResolution;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void KeypointMapFile::GetPoints(int layer, uint64_t first, uint64_t count, pcl::PointCloud<Point>& points) const
+{
+  const PointRecord* records = this->Layers[layer].Points + first;
+  points.resize(count);
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    Point& p = points.points[i];
+    p.x = records[i].X;
+    p.y = records[i].Y;
+    p.z = records[i].Z;
+    p.intensity = records[i].Intensity;
+    p.laserId = records[i].LaserId;
+    p.time = records[i].Time;
+  }
+}
@@ -0,0 +1,150 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef KEYPOINT_MAP_FILE_H
+#define KEYPOINT_MAP_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <Eigen/Dense>
+
+#include "LidarPoint.h"
+
+/**
+ * \class KeypointMapFile
+ * \brief Keypoint maps of the SLAM persisted in a binary file, to localize
+ *        the sensor in them without mapping again.
+ *
+ * The file stores a layer per type of keypoints (edges, planars and blobs).
+ * The points of a layer are sorted by voxel of VoxelResolution, and a sorted
+ * table of the voxels gives the points of each of them, so that only the
+ * voxels around the sensor need to be loaded. Each point comes with the fit
+ * of its neighborhood in the map: the parameters (A, P) of the distance
+ * function of a keypoint matched with the point, or the cause of the
+ * rejection of the match, so that the localization does not need to fit the
+ * neighborhoods of the map again.
+ *
+ * The file is written in the byte order of the machine and is mapped in
+ * memory when opened, the points and the fits being read directly from it.
+ */
+class KeypointMapFile
+{
+public:
+  using Point = PointXYZTIId;
+
+  enum Layer
+  {
+    EdgesLayer = 0,
+    PlanarsLayer = 1,
+    BlobsLayer = 2,
+    NumberOfLayers = 3
+  };
+
+  //! Fit of the neighborhood of a point of the map
+  struct Fit
+  {
+    //! Upper triangle of the symmetric matrix A: xx, xy, xz, yy, yz, zz
+    float A[6];
+    float Mean[3];
+    //! Coefficient of the residual
+    float Coefficient;
+    //! Code returned by the matching of the point with the map, which is
+    //! the rejection cause if the neighborhood could not be fitted
+    int32_t Status;
+    uint32_t Valid;
+
+    Eigen::Matrix3d GetA() const;
+    Eigen::Vector3d GetMean() const;
+    void SetA(const Eigen::Matrix3d& a);
+  };
+
+  //! Integer coordinates of a voxel and its points in the layer
+  struct Voxel
+  {
+    int32_t X;
+    int32_t Y;
+    int32_t Z;
+    uint32_t NumberOfPoints;
+    uint64_t FirstPoint;
+  };
+
+  //! Points of a layer to write, with the fits of their neighborhoods
+  struct LayerData
+  {
+    pcl::PointCloud<Point>::Ptr Points;
+    std::vector<Fit> Fits;
+  };
+
+  /**
+   * @brief Write the layers in a file, replacing it
+   * @return false if the file could not be written
+   */
+  static bool Write(const std::string& filename, double voxelResolution,
+                    const LayerData (&layers)[NumberOfLayers]);
+
+  /**
+   * @brief Map a file in memory and check its header
+   * @return false if the file could not be opened or is not a keypoint map
+   */
+  bool Open(const std::string& filename);
+
+  bool IsOpen() const { return this->File.is_open(); }
+
+  double GetVoxelResolution() const { return this->VoxelResolution; }
+
+  //! Voxels of a layer containing some points, sorted by coordinates
+  const std::vector<Voxel>& GetVoxels(int layer) const { return this->Layers[layer].Voxels; }
+
+  uint64_t GetNumberOfPoints(int layer) const { return this->Layers[layer].NumberOfPoints; }
+
+  //! Copy the points [first, first + count[ of a layer in a cloud
+  void GetPoints(int layer, uint64_t first, uint64_t count, pcl::PointCloud<Point>& points) const;
+
+  //! Fit of the index-th point of a layer
+  const Fit& GetFit(int layer, uint64_t index) const { return this->Layers[layer].Fits[index]; }
+
+private:
+  //! Point as stored in the file
+  struct PointRecord
+  {
+    float X;
+    float Y;
+    float Z;
+    uint8_t Intensity;
+    uint8_t LaserId;
+    uint8_t Padding[2];
+    double Time;
+  };
+
+  struct LayerView
+  {
+    uint64_t NumberOfPoints = 0;
+    std::vector<Voxel> Voxels;
+    const PointRecord* Points = nullptr;
+    const Fit* Fits = nullptr;
+  };
+
+  boost::iostreams::mapped_file_source File;
+  double VoxelResolution = 0.0;
+  LayerView Layers[NumberOfLayers];
+};
+
+#endif // KEYPOINT_MAP_FILE_H
@@ -0,0 +1,180 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "LoopClosureGraph.h"
+#include "RegistrationTools.h"
+
+// STD
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace
+{
+//! Number of ICP iterations of the registration of a loop, the last
+//! ones matching the keypoints closer than 1 meter
+const unsigned int LoopICPIterations = 9;
+}
+
+//-----------------------------------------------------------------------------
+LoopClosureGraph::~LoopClosureGraph()
+{
+  if (this->Task.valid())
+  {
+    this->Task.wait();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void LoopClosureGraph::Reset()
+{
+  if (this->Task.valid())
+  {
+    this->Task.wait();
+  }
+  this->Task = std::future<void>();
+  this->Times.clear();
+  this->Poses.clear();
+  this->Keypoints.clear();
+  this->Descriptors.Clear();
+  this->Loops.clear();
+
+  std::lock_guard<std::mutex> lock(this->CorrectionMutex);
+  this->CorrectedPoses.clear();
+  ++this->Version;
+}
+
+//-----------------------------------------------------------------------------
+bool LoopClosureGraph::AddFrame(double time, const Eigen::Matrix4d& pose,
+                                const pcl::PointCloud<PointXYZTIId>& edges,
+                                const pcl::PointCloud<PointXYZTIId>& planars)
+{
+  if (!this->Poses.empty() &&
+      (pose.block(0, 3, 3, 1) - this->Poses.back().block(0, 3, 3, 1)).norm() < this->KeyframeDistance)
+  {
+    return false;
+  }
+
+  // Descriptor and keypoints of the new key frame
+  pcl::PointCloud<PointXYZTIId> keypoints = edges;
+  keypoints += planars;
+  ScanContext descriptor;
+  descriptor.Compute(keypoints);
+  Cloud::Ptr cloud(new Cloud);
+  cloud->reserve(keypoints.size());
+  for (const PointXYZTIId& p : keypoints)
+  {
+    cloud->push_back(pcl::PointXYZ(p.x, p.y, p.z));
+  }
+
+  this->Times.push_back(time);
+  this->Poses.push_back(pose);
+  this->Keypoints.push_back(cloud);
+
+  // Search the place among the previous key frames, unless
+  // a loop is still being closed
+  const bool isBusy = this->Task.valid() &&
+    this->Task.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+  ScanContextIndex::Candidate candidate;
+  this->Descriptors.DistanceThreshold = this->DescriptorDistanceThreshold;
+  if (!isBusy &&
+      this->Descriptors.FindLoopCandidate(descriptor, this->NumberOfExcludedKeyframes, candidate))
+  {
+    if (this->Task.valid())
+    {
+      this->Task.get();
+    }
+    this->Task = std::async(std::launch::async, &LoopClosureGraph::CloseLoop, this, this->Poses,
+                            this->Keypoints[candidate.Index], cloud, candidate.Index,
+                            ScanContext::ShiftToYaw(candidate.Shift));
+  }
+  this->Descriptors.Add(descriptor);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void LoopClosureGraph::CloseLoop(PoseVector poses, Cloud::Ptr reference, Cloud::Ptr current,
+                                 size_t candidate, double yaw)
+{
+  // Pose of the new key frame in the reference frame of the recognized one,
+  // starting from the rotation between their descriptors
+  Eigen::Matrix4d H = Eigen::Matrix4d::Identity();
+  H.block(0, 0, 3, 3) = Eigen::AngleAxisd(yaw, Eigen::Vector3d::UnitZ()).toRotationMatrix();
+  std::vector<bool> pointUsed;
+  H = ICPPointToPlaneRegistration(reference, current, H, pointUsed, LoopICPIterations);
+  const size_t numberOfInliers = std::count(pointUsed.begin(), pointUsed.end(), true);
+  if (current->empty() || numberOfInliers < this->MinimumInlierRatio * current->size())
+  {
+    return;
+  }
+
+  PoseGraphEdge loop;
+  loop.From = candidate;
+  loop.To = poses.size() - 1;
+  loop.Measure = H;
+  this->Loops.push_back(loop);
+  std::cout << "Loop closed between key frames " << loop.From << " and " << loop.To
+            << " (" << numberOfInliers << " / " << current->size() << " keypoints matched)" << std::endl;
+
+  // Odometry between consecutive key frames and the loops
+  PoseGraphEdgeVector edges;
+  edges.reserve(poses.size() + this->Loops.size());
+  for (size_t k = 0; k + 1 < poses.size(); ++k)
+  {
+    PoseGraphEdge odometry;
+    odometry.From = k;
+    odometry.To = k + 1;
+    odometry.Measure = poses[k].inverse() * poses[k + 1];
+    edges.push_back(odometry);
+  }
+  edges.insert(edges.end(), this->Loops.begin(), this->Loops.end());
+
+  PoseVector corrected = OptimizePoseGraph(poses, edges, 50, this->NumberOfThreads);
+
+  std::lock_guard<std::mutex> lock(this->CorrectionMutex);
+  this->CorrectedPoses = std::move(corrected);
+  ++this->Version;
+}
+
+//-----------------------------------------------------------------------------
+unsigned long LoopClosureGraph::GetVersion()
+{
+  std::lock_guard<std::mutex> lock(this->CorrectionMutex);
+  return this->Version;
+}
+
+//-----------------------------------------------------------------------------
+void LoopClosureGraph::GetCorrectedKeyframes(std::vector<double>& times, PoseVector& poses)
+{
+  times = this->Times;
+  poses = this->Poses;
+
+  std::lock_guard<std::mutex> lock(this->CorrectionMutex);
+  const size_t numberOfCorrected = std::min(this->CorrectedPoses.size(), poses.size());
+  if (numberOfCorrected == 0)
+  {
+    return;
+  }
+  // the last correction is propagated to the key frames added since
+  const Eigen::Matrix4d correction =
+    this->CorrectedPoses[numberOfCorrected - 1] * this->Poses[numberOfCorrected - 1].inverse();
+  for (size_t k = 0; k < poses.size(); ++k)
+  {
+    poses[k] = (k < numberOfCorrected) ? this->CorrectedPoses[k] : Eigen::Matrix4d(correction * this->Poses[k]);
+  }
+}
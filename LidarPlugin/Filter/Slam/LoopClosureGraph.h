@@ -0,0 +1,125 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef LOOP_CLOSURE_GRAPH_H
+#define LOOP_CLOSURE_GRAPH_H
+
+// STD
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// EIGEN
+#include <Eigen/Dense>
+
+// PCL
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+// LOCAL
+#include "LidarPoint.h"
+#include "PoseGraph.h"
+#include "ScanContext.h"
+
+/**
+ * \class LoopClosureGraph
+ * \brief Close the loops of the trajectory estimated by the SLAM, while it runs.
+ *
+ * A frame becomes a key frame each time the sensor has moved by KeyframeDistance,
+ * its ScanContext is computed from its keypoints and compared to the ones of the
+ * previous key frames, except the last NumberOfExcludedKeyframes ones. When a
+ * place is recognized, the keypoints of the new key frame are registered on the
+ * ones of the recognized key frame, starting from the rotation given by the
+ * descriptors, and the loop is accepted if at least MinimumInlierRatio of the
+ * keypoints are matched. The pose graph of the key frames, whose edges are the
+ * odometry between consecutive key frames and the accepted loops, is then
+ * optimized.
+ *
+ * The registration and the optimization run in a background task, so that
+ * AddFrame only computes and searches the descriptor. The places recognized
+ * while a task is running are ignored, the next key frames being compared again.
+ */
+class LoopClosureGraph
+{
+public:
+  ~LoopClosureGraph();
+
+  //! Wait for the background task and remove all the key frames
+  void Reset();
+
+  /**
+   * @brief AddFrame give the result of the SLAM for a new frame
+   * @param time time of the frame
+   * @param pose pose of the sensor in the world estimated by the SLAM
+   * @param edges edges keypoints, in the reference frame of the sensor
+   * @param planars planar keypoints, in the reference frame of the sensor
+   * @return true if the frame became a key frame
+   */
+  bool AddFrame(double time, const Eigen::Matrix4d& pose,
+                const pcl::PointCloud<PointXYZTIId>& edges,
+                const pcl::PointCloud<PointXYZTIId>& planars);
+
+  //! Version of the corrected poses, which changes each time a loop is closed
+  unsigned long GetVersion();
+
+  /**
+   * @brief GetCorrectedKeyframes give the key frames corrected by the last
+   * optimization. The key frames added since then keep their odometry relatively
+   * to the last corrected key frame
+   */
+  void GetCorrectedKeyframes(std::vector<double>& times, PoseVector& poses);
+
+  size_t GetNumberOfKeyframes() const { return this->Poses.size(); }
+
+  //! Distance (in meter) travelled between two key frames
+  double KeyframeDistance = 2.0;
+  //! Number of last key frames in which no loop is searched
+  size_t NumberOfExcludedKeyframes = 50;
+  //! Maximal distance between the ScanContext of a loop
+  double DescriptorDistanceThreshold = 0.2;
+  //! Minimal ratio of keypoints matched by the registration of a loop
+  double MinimumInlierRatio = 0.5;
+  //! Number of threads of the pose graph optimization, 0 to use all the cores
+  unsigned int NumberOfThreads = 0;
+
+private:
+  using Cloud = pcl::PointCloud<pcl::PointXYZ>;
+
+  //! Register the last key frame on the recognized one and optimize the pose
+  //! graph, run in the background task on a copy of the key frames poses
+  void CloseLoop(PoseVector poses, Cloud::Ptr reference, Cloud::Ptr current,
+                 size_t candidate, double yaw);
+
+  // Key frames, only modified by the thread calling AddFrame
+  std::vector<double> Times;
+  PoseVector Poses;
+  std::vector<Cloud::Ptr> Keypoints;
+  ScanContextIndex Descriptors;
+
+  // Loops accepted, only modified by the background task
+  PoseGraphEdgeVector Loops;
+
+  // Result of the last optimization, for the first CorrectedPoses.size() key frames
+  std::mutex CorrectionMutex;
+  PoseVector CorrectedPoses;
+  unsigned long Version = 0;
+
+  std::future<void> Task;
+};
+
+#endif // LOOP_CLOSURE_GRAPH_H
@@ -0,0 +1,116 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "MapTileStore.h"
+
+#include <iostream>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+
+#include <pcl/io/pcd_io.h>
+
+//-----------------------------------------------------------------------------
+MapTileStore::MapTileStore(const std::string& directory)
+  : Directory(directory)
+{
+  boost::system::error_code error;
+  boost::filesystem::create_directories(this->Directory, error);
+  if (error)
+  {
+    std::cerr << "Could not create the map tiles directory " << this->Directory
+              << ": " << error.message() << std::endl;
+  }
+}
+
+//-----------------------------------------------------------------------------
+MapTileStore::~MapTileStore()
+{
+  boost::system::error_code error;
+  for (const TileIndex& index : this->Tiles)
+  {
+    boost::filesystem::remove(this->GetTileFileName(index), error);
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool MapTileStore::Write(const TileIndex& index, const pcl::PointCloud<Point>& points)
+{
+  // pcl can not write an empty cloud, an empty tile is simply not stored
+  if (points.empty())
+  {
+    this->Remove(index);
+    return true;
+  }
+  pcl::PCDWriter writer;
+  if (writer.writeBinaryCompressed(this->GetTileFileName(index), points) != 0)
+  {
+    std::cerr << "Could not write the map tile " << this->GetTileFileName(index) << std::endl;
+    return false;
+  }
+  this->Tiles.insert(index);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+pcl::PointCloud<MapTileStore::Point>::Ptr MapTileStore::Read(const TileIndex& index)
+{
+  pcl::PointCloud<Point>::Ptr points = this->Peek(index);
+  this->Remove(index);
+  return points;
+}
+
+//-----------------------------------------------------------------------------
+void MapTileStore::Remove(const TileIndex& index)
+{
+  if (this->Tiles.erase(index) > 0)
+  {
+    boost::system::error_code error;
+    boost::filesystem::remove(this->GetTileFileName(index), error);
+  }
+}
+
+//-----------------------------------------------------------------------------
+pcl::PointCloud<MapTileStore::Point>::Ptr MapTileStore::Peek(const TileIndex& index) const
+{
+  if (!this->Contains(index))
+  {
+    return nullptr;
+  }
+  pcl::PointCloud<Point>::Ptr points(new pcl::PointCloud<Point>);
+  pcl::PCDReader reader;
+  if (reader.read(this->GetTileFileName(index), *points) != 0)
+  {
+    std::cerr << "Could not read the map tile " << this->GetTileFileName(index) << std::endl;
+    return nullptr;
+  }
+  return points;
+}
+
+//-----------------------------------------------------------------------------
+std::vector<MapTileStore::TileIndex> MapTileStore::GetTiles() const
+{
+  return std::vector<TileIndex>(this->Tiles.begin(), this->Tiles.end());
+}
+
+//-----------------------------------------------------------------------------
+std::string MapTileStore::GetTileFileName(const TileIndex& index) const
+{
+  std::stringstream name;
+  name << "tile_" << index[0] << "_" << index[1] << "_" << index[2] << ".pcd";
+  return (boost::filesystem::path(this->Directory) / name.str()).string();
+}
@@ -0,0 +1,86 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef MAP_TILE_STORE_H
+#define MAP_TILE_STORE_H
+
+#include <array>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "LidarPoint.h"
+
+/**
+ * \class MapTileStore
+ * \brief Tiles of a map kept on disk while they are not used.
+ *
+ * A tile is the cloud of the points of a voxel of a map, identified by the
+ * integer coordinates of the voxel. The tiles are written as binary compressed
+ * PCD files in a directory, one file per tile. Reading a tile back removes it
+ * from the store, since the map owns it again, while Peek only loads a copy.
+ *
+ * The files written are removed when the store is destroyed, the directory
+ * is only a scratch space. A store must not be used by several threads at
+ * the same time.
+ */
+class MapTileStore
+{
+public:
+  using Point = PointXYZTIId;
+  using TileIndex = std::array<int, 3>;
+
+  //! @param directory where the tiles are written, created if needed
+  explicit MapTileStore(const std::string& directory);
+
+  ~MapTileStore();
+
+  MapTileStore(const MapTileStore&) = delete;
+  MapTileStore& operator=(const MapTileStore&) = delete;
+
+  //! Write the points of a tile, replacing the tile if it is already stored.
+  //! Return false if the file could not be written.
+  bool Write(const TileIndex& index, const pcl::PointCloud<Point>& points);
+
+  //! Load the points of a tile and remove it from the store,
+  //! return nullptr if the tile is not stored or can not be read
+  pcl::PointCloud<Point>::Ptr Read(const TileIndex& index);
+
+  //! Load the points of a tile, which stays in the store
+  pcl::PointCloud<Point>::Ptr Peek(const TileIndex& index) const;
+
+  bool Contains(const TileIndex& index) const { return this->Tiles.count(index) > 0; }
+
+  //! Indices of the stored tiles, sorted
+  std::vector<TileIndex> GetTiles() const;
+
+  size_t GetNumberOfTiles() const { return this->Tiles.size(); }
+
+  const std::string& GetDirectory() const { return this->Directory; }
+
+private:
+  void Remove(const TileIndex& index);
+
+  std::string GetTileFileName(const TileIndex& index) const;
+
+  std::string Directory;
+
+  //! Indices of the tiles written in the directory
+  std::set<TileIndex> Tiles;
+};
+
+#endif // MAP_TILE_STORE_H
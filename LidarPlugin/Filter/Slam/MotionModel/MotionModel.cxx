@@ -20,6 +20,9 @@
 // LOCAL
 #include "MotionModel.h"
 
+// STD
+#include <algorithm>
+
 //-----------------------------------------------------------------------------
 AffineIsometry::AffineIsometry(const Eigen::Matrix3d& argR, const Eigen::Vector3d& argT, double argTime):
   R(argR), T(argT), time(argTime)
@@ -37,3 +40,42 @@ AffineIsometry SampledSensorPath::operator()(double time)
                                                            time);
   return AffineIsometry(H.block(0, 0, 3, 3), H.block(0, 3, 3, 1), time);
 }
+
+//-----------------------------------------------------------------------------
+void SampledSensorPath::PrecomputeBins(unsigned int nbBins)
+{
+  this->Bins.clear();
+  if (nbBins == 0)
+  {
+    return;
+  }
+
+  // Same SLERP and linear interpolations as LinearTransformInterpolation,
+  // the quaternions of the samples being only computed once
+  const Eigen::Quaterniond q0(this->Samples[0].R);
+  const Eigen::Quaterniond q1(this->Samples[1].R);
+  const double t0 = this->Samples[0].time;
+  const double t1 = this->Samples[1].time;
+  this->Bins.resize(nbBins + 1);
+  for (unsigned int k = 0; k <= nbBins; ++k)
+  {
+    const double s = static_cast<double>(k) / nbBins;
+    this->Bins[k].R = q0.slerp(s, q1).toRotationMatrix();
+    this->Bins[k].T = (1.0 - s) * this->Samples[0].T + s * this->Samples[1].T;
+    this->Bins[k].time = (1.0 - s) * t0 + s * t1;
+  }
+}
+
+//-----------------------------------------------------------------------------
+AffineIsometry SampledSensorPath::GetBinnedTransform(double time)
+{
+  const double t0 = this->Samples[0].time;
+  const double t1 = this->Samples[1].time;
+  if (this->Bins.empty() || !(time >= t0 && time <= t1) || t1 <= t0)
+  {
+    return (*this)(time);
+  }
+  const double nbBins = static_cast<double>(this->Bins.size() - 1);
+  const size_t bin = static_cast<size_t>((time - t0) / (t1 - t0) * nbBins + 0.5);
+  return this->Bins[std::min(bin, this->Bins.size() - 1)];
+}
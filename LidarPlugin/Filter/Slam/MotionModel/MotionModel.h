@@ -20,6 +20,9 @@
 #ifndef MOTION_MODEL_H
 #define MOTION_MODEL_H
 
+// STD
+#include <vector>
+
 // EIGEN
 #include <Eigen/Dense>
 
@@ -61,6 +64,21 @@ public:
   // to the requested time using a spline or
   // linear interpolation
   AffineIsometry operator()(double t);
+
+  // Precompute the affine isometries of nbBins + 1 times
+  // evenly spaced between the two samples, so that the
+  // transform of a time is looked up rather than interpolated.
+  // Must be called again once the samples are modified
+  void PrecomputeBins(unsigned int nbBins);
+
+  // return the precomputed affine isometry of the bin
+  // closest to the requested time. The isometry is
+  // interpolated if the time is outside the samples or
+  // if no bins are precomputed
+  AffineIsometry GetBinnedTransform(double t);
+
+private:
+  std::vector<AffineIsometry> Bins;
 };
 
 /**
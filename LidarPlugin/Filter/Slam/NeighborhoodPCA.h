@@ -0,0 +1,109 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef NEIGHBORHOOD_PCA_H
+#define NEIGHBORHOOD_PCA_H
+
+#include <Eigen/Dense>
+
+/**
+ * \class NeighborhoodPCA
+ * \brief Principal component analysis of a neighborhood of keypoints, used to fit
+ *        the lines, planes and ellipsoids matched by the SLAM.
+ *
+ * The scatter matrix of the neighborhood is accumulated in Scalar precision and
+ * decomposed with the closed-form eigen solver of Eigen for 3x3 symmetric matrices
+ * instead of the iterative one. No memory is allocated.
+ * The points are expressed relatively to the first one before being accumulated,
+ * so that the precision does not depend on the distance to the origin, and the
+ * scatter is accumulated on the centered points (two passes) to avoid the
+ * cancellation of the single pass formula in float.
+ * The decomposition is always done in double precision: in float, the closed-form
+ * solver loses the smallest eigen values of elongated neighborhoods (lines), which
+ * are the ones deciding the shape of the neighborhood.
+ */
+template <typename Scalar>
+class NeighborhoodPCA
+{
+public:
+  /**
+   * @brief Compute the mean, the scatter matrix and its eigen decomposition
+   * of the neighborhood made of points[indices[0]] .. points[indices[count - 1]]
+   * @param points any container of points with x, y and z members
+   */
+  template <typename PointContainer>
+  void Compute(const PointContainer& points, const int* indices, unsigned int count)
+  {
+    // The coordinates are taken relatively to the first point, so that
+    // they are of the order of the size of the neighborhood
+    const auto& origin = points[indices[0]];
+    const Scalar x0 = static_cast<Scalar>(origin.x);
+    const Scalar y0 = static_cast<Scalar>(origin.y);
+    const Scalar z0 = static_cast<Scalar>(origin.z);
+
+    Scalar sx = 0, sy = 0, sz = 0;
+    for (unsigned int k = 1; k < count; ++k)
+    {
+      const auto& p = points[indices[k]];
+      sx += static_cast<Scalar>(p.x) - x0;
+      sy += static_cast<Scalar>(p.y) - y0;
+      sz += static_cast<Scalar>(p.z) - z0;
+    }
+    const Scalar mx = sx / static_cast<Scalar>(count);
+    const Scalar my = sy / static_cast<Scalar>(count);
+    const Scalar mz = sz / static_cast<Scalar>(count);
+
+    // Only the 6 distinct coefficients of the symmetric
+    // scatter matrix are accumulated, on the centered points
+    Scalar xx = 0, xy = 0, xz = 0, yy = 0, yz = 0, zz = 0;
+    for (unsigned int k = 0; k < count; ++k)
+    {
+      const auto& p = points[indices[k]];
+      const Scalar x = static_cast<Scalar>(p.x) - x0 - mx;
+      const Scalar y = static_cast<Scalar>(p.y) - y0 - my;
+      const Scalar z = static_cast<Scalar>(p.z) - z0 - mz;
+      xx += x * x; xy += x * y; xz += x * z;
+      yy += y * y; yz += y * z; zz += z * z;
+    }
+
+    this->Mean << origin.x + static_cast<double>(mx),
+                  origin.y + static_cast<double>(my),
+                  origin.z + static_cast<double>(mz);
+    this->Scatter << xx, xy, xz,
+                     xy, yy, yz,
+                     xz, yz, zz;
+
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eig;
+    eig.computeDirect(this->Scatter);
+    this->EigenValues = eig.eigenvalues();
+    this->EigenVectors = eig.eigenvectors();
+  }
+
+  //! Barycenter of the neighborhood
+  Eigen::Vector3d Mean;
+
+  //! Sum of the outer products of the centered points
+  Eigen::Matrix3d Scatter;
+
+  //! Eigen values of the scatter matrix, in increasing order
+  Eigen::Vector3d EigenValues;
+
+  //! Unit eigen vectors of the scatter matrix, in columns
+  Eigen::Matrix3d EigenVectors;
+};
+
+#endif // NEIGHBORHOOD_PCA_H
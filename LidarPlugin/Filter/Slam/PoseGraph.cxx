@@ -0,0 +1,137 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "PoseGraph.h"
+
+// STD
+#include <algorithm>
+#include <array>
+
+// CERES
+#include <ceres/ceres.h>
+#include <ceres/rotation.h>
+
+// BOOST
+#include <boost/thread.hpp>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+struct RelativePoseResidual
+{
+  RelativePoseResidual(const Eigen::Matrix4d& measure, double rotationWeight, double translationWeight)
+    : MeasureR(measure.block(0, 0, 3, 3)), MeasureT(measure.block(0, 3, 3, 1)),
+      RotationWeight(rotationWeight), TranslationWeight(translationWeight)
+  {
+  }
+
+  // the poses are the angle-axis vector of the rotation followed by the translation
+  template <typename T>
+  bool operator()(const T* const from, const T* const to, T* residual) const
+  {
+    Eigen::Matrix<T, 3, 3> Ri, Rj;
+    ceres::AngleAxisToRotationMatrix(from, Ri.data());
+    ceres::AngleAxisToRotationMatrix(to, Rj.data());
+    const Eigen::Matrix<T, 3, 1> Ti(from[3], from[4], from[5]);
+    const Eigen::Matrix<T, 3, 1> Tj(to[3], to[4], to[5]);
+
+    // rotation error
+    Eigen::Matrix<T, 3, 3> E = this->MeasureR.transpose().cast<T>() * Ri.transpose() * Rj;
+    ceres::RotationMatrixToAngleAxis(E.data(), residual);
+    for (int k = 0; k < 3; ++k)
+    {
+      residual[k] *= T(this->RotationWeight);
+    }
+
+    // translation error
+    const Eigen::Matrix<T, 3, 1> dT = Ri.transpose() * (Tj - Ti) - this->MeasureT.cast<T>();
+    for (int k = 0; k < 3; ++k)
+    {
+      residual[3 + k] = T(this->TranslationWeight) * dT(k);
+    }
+    return true;
+  }
+
+  const Eigen::Matrix3d MeasureR;
+  const Eigen::Vector3d MeasureT;
+  const double RotationWeight;
+  const double TranslationWeight;
+};
+}
+
+//-----------------------------------------------------------------------------
+PoseVector OptimizePoseGraph(const PoseVector& poses, const PoseGraphEdgeVector& edges,
+                             int maxIteration, unsigned int numberOfThreads)
+{
+  if (poses.size() < 2 || edges.empty())
+  {
+    return poses;
+  }
+
+  std::vector<std::array<double, 6> > parameters(poses.size());
+  for (size_t k = 0; k < poses.size(); ++k)
+  {
+    Eigen::AngleAxisd angleAxis(Eigen::Matrix3d(poses[k].block(0, 0, 3, 3)));
+    Eigen::Vector3d rotation = angleAxis.angle() * angleAxis.axis();
+    std::copy(rotation.data(), rotation.data() + 3, parameters[k].data());
+    for (int i = 0; i < 3; ++i)
+    {
+      parameters[k][3 + i] = poses[k](i, 3);
+    }
+  }
+
+  ceres::Problem problem;
+  for (const PoseGraphEdge& edge : edges)
+  {
+    if (edge.From >= poses.size() || edge.To >= poses.size() || edge.From == edge.To)
+    {
+      continue;
+    }
+    ceres::CostFunction* cost = new ceres::AutoDiffCostFunction<RelativePoseResidual, 6, 6, 6>(
+      new RelativePoseResidual(edge.Measure, edge.RotationWeight, edge.TranslationWeight));
+    problem.AddResidualBlock(cost, nullptr, parameters[edge.From].data(), parameters[edge.To].data());
+  }
+  if (problem.NumResidualBlocks() == 0)
+  {
+    return poses;
+  }
+  if (problem.HasParameterBlock(parameters[0].data()))
+  {
+    problem.SetParameterBlockConstant(parameters[0].data());
+  }
+
+  ceres::Solver::Options options;
+  options.max_num_iterations = maxIteration;
+  options.linear_solver_type = ceres::SPARSE_NORMAL_CHOLESKY;
+  options.num_threads = (numberOfThreads == 0) ?
+                        std::max(1u, boost::thread::hardware_concurrency()) : numberOfThreads;
+  options.minimizer_progress_to_stdout = false;
+  ceres::Solver::Summary summary;
+  ceres::Solve(options, &problem, &summary);
+
+  PoseVector corrected(poses.size(), Eigen::Matrix4d::Identity());
+  for (size_t k = 0; k < poses.size(); ++k)
+  {
+    const Eigen::Vector3d rotation(parameters[k][0], parameters[k][1], parameters[k][2]);
+    const double angle = rotation.norm();
+    corrected[k].block(0, 0, 3, 3) = (angle > 0.0) ?
+      Eigen::AngleAxisd(angle, rotation / angle).toRotationMatrix() : Eigen::Matrix3d::Identity();
+    corrected[k].block(0, 3, 3, 1) = Eigen::Vector3d(parameters[k][3], parameters[k][4], parameters[k][5]);
+  }
+  return corrected;
+}
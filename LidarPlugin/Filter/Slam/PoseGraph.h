@@ -0,0 +1,67 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef POSE_GRAPH_H
+#define POSE_GRAPH_H
+
+// STD
+#include <cstddef>
+#include <vector>
+
+// EIGEN
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+
+/**
+* \struct PoseGraphEdge
+* \brief Measure of the pose of a node in the reference frame of another node
+*/
+struct PoseGraphEdge
+{
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  size_t From = 0;
+  size_t To = 0;
+  //! Pose of node To in the reference frame of node From
+  Eigen::Matrix4d Measure = Eigen::Matrix4d::Identity();
+  //! Weight of the rotation and of the translation errors of the edge
+  double RotationWeight = 1.0;
+  double TranslationWeight = 1.0;
+};
+using PoseGraphEdgeVector = std::vector<PoseGraphEdge, Eigen::aligned_allocator<PoseGraphEdge>>;
+using PoseVector = std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>>;
+
+/**
+ * @brief OptimizePoseGraph Correct the poses of the nodes of a graph so that
+ *        they agree with the relative poses measured by its edges, for example
+ *        the odometry between consecutive key frames and the loops closed
+ *        between a key frame and a place already visited.
+ *
+ *        For an edge measuring the pose M of node j in the frame of node i,
+ *        the residual is the angle-axis vector of M' * Ri' * Rj and the vector
+ *        Ri' * (Tj - Ti) - TM, weighted by the weights of the edge. The first
+ *        node is fixed.
+ *
+ * @param poses initial absolute poses of the nodes
+ * @param edges relative poses measured between the nodes
+ * @param maxIteration maximum number of Levenberg-Marquardt iterations
+ * @param numberOfThreads number of threads evaluating the residuals, 0 to use all the cores
+ * @return the corrected absolute poses
+ */
+PoseVector OptimizePoseGraph(const PoseVector& poses, const PoseGraphEdgeVector& edges,
+                             int maxIteration = 50, unsigned int numberOfThreads = 0);
+
+#endif // POSE_GRAPH_H
@@ -0,0 +1,227 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "ScanContext.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+//! Number of shifts around the one estimated with the sector keys
+//! for which the whole descriptors are compared
+const int ShiftSearchRadius = 2;
+}
+
+const int ScanContext::NumberOfRings;
+const int ScanContext::NumberOfSectors;
+
+//-----------------------------------------------------------------------------
+void ScanContext::Compute(const pcl::PointCloud<PointXYZTIId>& points,
+                          double maximumRadius, double heightOffset)
+{
+  this->MaximumRadius = maximumRadius;
+  this->HeightOffset = heightOffset;
+  this->Grid.fill(0.f);
+  for (const PointXYZTIId& p : points)
+  {
+    this->AddPoint(p.x, p.y, p.z);
+  }
+  this->ComputeKeys();
+}
+
+//-----------------------------------------------------------------------------
+void ScanContext::Compute(const std::vector<double>& xyz, double maximumRadius, double heightOffset)
+{
+  this->MaximumRadius = maximumRadius;
+  this->HeightOffset = heightOffset;
+  this->Grid.fill(0.f);
+  for (size_t i = 0; i + 2 < xyz.size(); i += 3)
+  {
+    this->AddPoint(xyz[i], xyz[i + 1], xyz[i + 2]);
+  }
+  this->ComputeKeys();
+}
+
+//-----------------------------------------------------------------------------
+void ScanContext::AddPoint(double x, double y, double z)
+{
+  const double radius = std::sqrt(x * x + y * y);
+  if (!(radius > 0.0 && radius < this->MaximumRadius))
+  {
+    return;
+  }
+  const int ring = std::min(NumberOfRings - 1,
+                            static_cast<int>(radius / this->MaximumRadius * NumberOfRings));
+  const double angle = std::atan2(y, x) + M_PI;
+  const int sector = std::min(NumberOfSectors - 1,
+                              static_cast<int>(angle / (2.0 * M_PI) * NumberOfSectors));
+  float& height = this->Grid[ring * NumberOfSectors + sector];
+  height = std::max(height, static_cast<float>(z + this->HeightOffset));
+}
+
+//-----------------------------------------------------------------------------
+void ScanContext::ComputeKeys()
+{
+  this->RingKey.fill(0.f);
+  this->SectorKey.fill(0.f);
+  for (int ring = 0; ring < NumberOfRings; ++ring)
+  {
+    for (int sector = 0; sector < NumberOfSectors; ++sector)
+    {
+      const float height = this->Grid[ring * NumberOfSectors + sector];
+      this->RingKey[ring] += (height > 0.f) ? 1.f : 0.f;
+      this->SectorKey[sector] += height;
+    }
+    this->RingKey[ring] /= NumberOfSectors;
+  }
+  for (float& key : this->SectorKey)
+  {
+    key /= NumberOfRings;
+  }
+}
+
+//-----------------------------------------------------------------------------
+double ScanContext::ShiftedDistance(const ScanContext& other, int shift) const
+{
+  double sum = 0.0;
+  int numberOfSectors = 0;
+  for (int sector = 0; sector < NumberOfSectors; ++sector)
+  {
+    const int otherSector = ((sector + shift) % NumberOfSectors + NumberOfSectors) % NumberOfSectors;
+    double dot = 0.0, norm = 0.0, otherNorm = 0.0;
+    for (int ring = 0; ring < NumberOfRings; ++ring)
+    {
+      const double a = this->Grid[ring * NumberOfSectors + sector];
+      const double b = other.Grid[ring * NumberOfSectors + otherSector];
+      dot += a * b;
+      norm += a * a;
+      otherNorm += b * b;
+    }
+    if (norm > 0.0 && otherNorm > 0.0)
+    {
+      sum += 1.0 - dot / std::sqrt(norm * otherNorm);
+      ++numberOfSectors;
+    }
+  }
+  return numberOfSectors > 0 ? sum / numberOfSectors : -1.0;
+}
+
+//-----------------------------------------------------------------------------
+double ScanContext::Distance(const ScanContext& other, int& shift) const
+{
+  // The sector keys give the approximate shift, the whole
+  // descriptors are only compared for the shifts around it
+  int bestKeyShift = 0;
+  double bestKeyDistance = std::numeric_limits<double>::max();
+  for (int s = 0; s < NumberOfSectors; ++s)
+  {
+    double distance = 0.0;
+    for (int sector = 0; sector < NumberOfSectors; ++sector)
+    {
+      distance += std::abs(this->SectorKey[sector] - other.SectorKey[(sector + s) % NumberOfSectors]);
+    }
+    if (distance < bestKeyDistance)
+    {
+      bestKeyDistance = distance;
+      bestKeyShift = s;
+    }
+  }
+
+  double bestDistance = 2.0;
+  shift = bestKeyShift;
+  for (int s = bestKeyShift - ShiftSearchRadius; s <= bestKeyShift + ShiftSearchRadius; ++s)
+  {
+    const double distance = this->ShiftedDistance(other, s);
+    if (distance >= 0.0 && distance < bestDistance)
+    {
+      bestDistance = distance;
+      shift = (s + NumberOfSectors) % NumberOfSectors;
+    }
+  }
+  return bestDistance;
+}
+
+//-----------------------------------------------------------------------------
+double ScanContext::ShiftToYaw(int shift)
+{
+  double yaw = shift * 2.0 * M_PI / NumberOfSectors;
+  return (yaw > M_PI) ? yaw - 2.0 * M_PI : yaw;
+}
+
+//-----------------------------------------------------------------------------
+void ScanContextIndex::Add(const ScanContext& descriptor)
+{
+  this->Descriptors.push_back(descriptor);
+  const auto& key = descriptor.GetRingKey();
+  this->RingKeys.insert(this->RingKeys.end(), key.begin(), key.end());
+}
+
+//-----------------------------------------------------------------------------
+void ScanContextIndex::Clear()
+{
+  this->Descriptors.clear();
+  this->RingKeys.clear();
+}
+
+//-----------------------------------------------------------------------------
+bool ScanContextIndex::FindLoopCandidate(const ScanContext& descriptor,
+                                         size_t numberOfExcludedDescriptors,
+                                         Candidate& candidate) const
+{
+  if (this->Descriptors.size() <= numberOfExcludedDescriptors)
+  {
+    return false;
+  }
+  const size_t numberOfSearched = this->Descriptors.size() - numberOfExcludedDescriptors;
+
+  // Nearest ring keys
+  const auto& key = descriptor.GetRingKey();
+  std::vector<std::pair<float, size_t> > distances(numberOfSearched);
+  for (size_t index = 0; index < numberOfSearched; ++index)
+  {
+    const float* other = &this->RingKeys[index * ScanContext::NumberOfRings];
+    float distance = 0.f;
+    for (int ring = 0; ring < ScanContext::NumberOfRings; ++ring)
+    {
+      const float d = key[ring] - other[ring];
+      distance += d * d;
+    }
+    distances[index] = std::make_pair(distance, index);
+  }
+  const size_t numberOfCandidates = std::min(this->NumberOfRingKeyCandidates, numberOfSearched);
+  std::partial_sort(distances.begin(), distances.begin() + numberOfCandidates, distances.end());
+
+  // Closest descriptor among them
+  bool found = false;
+  for (size_t k = 0; k < numberOfCandidates; ++k)
+  {
+    int shift = 0;
+    const size_t index = distances[k].second;
+    const double distance = descriptor.Distance(this->Descriptors[index], shift);
+    if (distance < this->DistanceThreshold && (!found || distance < candidate.Distance))
+    {
+      candidate.Index = index;
+      candidate.Distance = distance;
+      candidate.Shift = shift;
+      found = true;
+    }
+  }
+  return found;
+}
@@ -0,0 +1,139 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef SCAN_CONTEXT_H
+#define SCAN_CONTEXT_H
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include <pcl/point_cloud.h>
+
+#include "LidarPoint.h"
+
+/**
+ * \class ScanContext
+ * \brief Global descriptor of a lidar frame, to recognize a place already visited.
+ *
+ * The space around the sensor is split in NumberOfRings rings up to MaximumRadius,
+ * and in NumberOfSectors angular sectors. The descriptor is the grid of the maximal
+ * height of the points of each bin, the heights being offset by HeightOffset so that
+ * the empty bins are 0. A rotation of the sensor around its vertical axis shifts the
+ * sectors, so that two descriptors are compared for all the shifts of their sectors.
+ *
+ * The ring key, the proportion of occupied bins of each ring, does not depend on the
+ * rotation of the sensor. It is used to find the candidate places before comparing
+ * the whole descriptors.
+ */
+class ScanContext
+{
+public:
+  static const int NumberOfRings = 20;
+  static const int NumberOfSectors = 60;
+
+  //! Compute the descriptor of points expressed in the reference frame of the sensor
+  void Compute(const pcl::PointCloud<PointXYZTIId>& points,
+               double maximumRadius = 80.0, double heightOffset = 2.0);
+
+  //! Same as Compute, from coordinates x0, y0, z0, x1, ...
+  void Compute(const std::vector<double>& xyz,
+               double maximumRadius = 80.0, double heightOffset = 2.0);
+
+  /**
+   * @brief Distance between two descriptors, in [0, 2], being the mean cosine
+   * distance between their sectors for the best shift of the sectors
+   * @param other descriptor to compare to
+   * @param shift[out] best shift, sector i of this descriptor matching
+   *        the sector i + shift of the other
+   */
+  double Distance(const ScanContext& other, int& shift) const;
+
+  //! Rotation (in radian) around the vertical axis of the sensor corresponding to
+  //! a shift of the sectors, which rotates this frame into the other one
+  static double ShiftToYaw(int shift);
+
+  const std::array<float, NumberOfRings>& GetRingKey() const { return this->RingKey; }
+
+private:
+  void AddPoint(double x, double y, double z);
+  void ComputeKeys();
+
+  //! Distance for a given shift, or -1 if no sectors are both occupied
+  double ShiftedDistance(const ScanContext& other, int shift) const;
+
+  double MaximumRadius = 80.0;
+  double HeightOffset = 2.0;
+  //! Height of bin (ring, sector) at ring * NumberOfSectors + sector
+  std::array<float, NumberOfRings * NumberOfSectors> Grid;
+  std::array<float, NumberOfRings> RingKey;
+  //! Mean height of each sector, to estimate the shift
+  std::array<float, NumberOfSectors> SectorKey;
+};
+
+/**
+ * \class ScanContextIndex
+ * \brief Descriptors of the key frames of a trajectory, searched for the place
+ * recognized in a new frame.
+ *
+ * The ring keys are stored contiguously and scanned for the nearest ones, which is
+ * below the millisecond for tens of thousands of key frames and does not need any
+ * rebuild when a key frame is added. The descriptors of the nearest ring keys are
+ * then compared to the one of the new frame.
+ */
+class ScanContextIndex
+{
+public:
+  struct Candidate
+  {
+    //! Index of the key frame, in the order they were added
+    size_t Index = 0;
+    double Distance = 0.0;
+    //! Shift of the sectors, see ScanContext::Distance
+    int Shift = 0;
+  };
+
+  void Add(const ScanContext& descriptor);
+
+  void Clear();
+
+  size_t GetNumberOfDescriptors() const { return this->Descriptors.size(); }
+
+  /**
+   * @brief FindLoopCandidate find the key frame whose descriptor is the closest
+   * to the one of a new frame
+   * @param descriptor descriptor of the new frame
+   * @param numberOfExcludedDescriptors number of last key frames which are not
+   *        searched, being close to the new frame only because they are recent
+   * @param candidate[out] closest key frame
+   * @return false if no key frame is closer than DistanceThreshold
+   */
+  bool FindLoopCandidate(const ScanContext& descriptor, size_t numberOfExcludedDescriptors,
+                         Candidate& candidate) const;
+
+  //! Number of nearest ring keys whose descriptors are compared
+  size_t NumberOfRingKeyCandidates = 10;
+
+  //! Maximal distance between the descriptors of a loop
+  double DistanceThreshold = 0.2;
+
+private:
+  std::vector<ScanContext> Descriptors;
+  std::vector<float> RingKeys;
+};
+
+#endif // SCAN_CONTEXT_H
@@ -72,11 +72,24 @@
 #include "Slam.h"
 #include "CeresCostFunctions.h"
 #include "vtkEigenTools.h"
+#include "VoxelHashKNN.h"
+#include "NeighborhoodPCA.h"
+#include "KeypointMapFile.h"
+#include "MapTileStore.h"
+#include "ParallelFor.h"
 // STD
 #include <sstream>
 #include <algorithm>
+#include <atomic>
 #include <cmath>
-#include <ctime>
+#include <future>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+// BOOST
+#include <boost/thread/thread.hpp>
 // EIGEN
 #include <Eigen/Dense>
 // PCL
@@ -87,6 +100,9 @@
 #include <nanoflann.hpp>
 
 namespace {
+// Number of neighbors of a blob keypoint used to fit its ellipsoid
+const int BlobNeighborhoodSize = 25;
+
 //-----------------------------------------------------------------------------
 Eigen::Matrix3d GetRotationMatrix(Eigen::Matrix<double, 6, 1> T)
 {
@@ -97,20 +113,213 @@ Eigen::Matrix3d GetRotationMatrix(Eigen::Matrix<double, 6, 1> T)
 }
 
 //-----------------------------------------------------------------------------
-std::clock_t startTime;
+// PCA of the neighborhood of a keypoint, accumulated in float or double precision
+template <typename PointContainer>
+void AnalyseNeighborhood(const PointContainer& points, const std::vector<int>& indices, unsigned int count,
+                         bool singlePrecision, Eigen::Vector3d& mean, Eigen::Matrix3d& scatter,
+                         Eigen::Vector3d& eigenValues, Eigen::Matrix3d& eigenVectors)
+{
+  auto analyse = [&](auto& pca)
+  {
+    pca.Compute(points, indices.data(), count);
+    mean = pca.Mean;
+    scatter = pca.Scatter;
+    eigenValues = pca.EigenValues;
+    eigenVectors = pca.EigenVectors;
+  };
+  if (singlePrecision)
+  {
+    NeighborhoodPCA<float> pca;
+    analyse(pca);
+  }
+  else
+  {
+    NeighborhoodPCA<double> pca;
+    analyse(pca);
+  }
+}
 
 //-----------------------------------------------------------------------------
-void InitTime()
+// Matching data of the keypoints, filled again at each ICP iteration
+struct MatchesData
 {
-  startTime = std::clock();
-}
+  const std::vector<Eigen::Matrix3d>& A;
+  const std::vector<Eigen::Vector3d>& P;
+  const std::vector<Eigen::Vector3d>& X;
+  const std::vector<double>& Time;
+  const std::vector<double>& Coefficient;
+};
+
+//-----------------------------------------------------------------------------
+// Residual of the index-th match when the frame is not undistorted
+struct AffineIsometryMatchResidual
+{
+  AffineIsometryMatchResidual(const MatchesData& data, size_t index)
+    : Data(data), Index(index) {}
+
+  template <typename T>
+  bool operator()(const T* const w, T* residual) const
+  {
+    return CostFunctions::MahalanobisDistanceAffineIsometryResidual(
+      this->Data.A[this->Index], this->Data.P[this->Index],
+      this->Data.X[this->Index], this->Data.Coefficient[this->Index])(w, residual);
+  }
+
+  const MatchesData& Data;
+  const size_t Index;
+};
+
+//-----------------------------------------------------------------------------
+// Residual of the index-th match when the frame is not undistorted,
+// with the analytic jacobian
+class AffineIsometryMatchAnalyticResidual : public ceres::SizedCostFunction<1, 6>
+{
+public:
+  AffineIsometryMatchAnalyticResidual(const MatchesData& data, size_t index)
+    : Data(data), Index(index) {}
+
+  bool Evaluate(double const* const* w, double* residuals, double** jacobians) const override
+  {
+    CostFunctions::MahalanobisDistanceAffineIsometryAnalyticResidual::Compute(
+      this->Data.A[this->Index], this->Data.P[this->Index], this->Data.X[this->Index],
+      this->Data.Coefficient[this->Index], w[0], residuals[0],
+      (jacobians && jacobians[0]) ? jacobians[0] : nullptr);
+    return true;
+  }
+
+private:
+  const MatchesData& Data;
+  const size_t Index;
+};
+
+//-----------------------------------------------------------------------------
+// Residual of the index-th match when the frame is undistorted
+struct InterpolatedMotionMatchResidual
+{
+  InterpolatedMotionMatchResidual(const MatchesData& data, size_t index)
+    : Data(data), Index(index) {}
+
+  template <typename T>
+  bool operator()(const T* const w, T* residual) const
+  {
+    return CostFunctions::MahalanobisDistanceInterpolatedMotionResidual(
+      this->Data.A[this->Index], this->Data.P[this->Index], this->Data.X[this->Index],
+      this->Data.Time[this->Index], this->Data.Coefficient[this->Index])(w, residual);
+  }
+
+  const MatchesData& Data;
+  const size_t Index;
+};
+
+//-----------------------------------------------------------------------------
+// Arctan loss of the given scale, scaled by the coefficient of the index-th
+// match: the same as ceres::ScaledLoss(new ceres::ArctanLoss(scale), coefficient)
+class MatchLoss : public ceres::LossFunction
+{
+public:
+  MatchLoss(const double& scale, const MatchesData& data, size_t index)
+    : Scale(scale), Data(data), Index(index) {}
+
+  void Evaluate(double s, double rho[3]) const override
+  {
+    ceres::ArctanLoss(this->Scale).Evaluate(s, rho);
+    const double coefficient = this->Data.Coefficient[this->Index];
+    rho[0] *= coefficient;
+    rho[1] *= coefficient;
+    rho[2] *= coefficient;
+  }
+
+private:
+  const double& Scale;
+  const MatchesData& Data;
+  const size_t Index;
+};
+
+//-----------------------------------------------------------------------------
+// Ceres problem with one residual block per matched keypoint, kept
+// across the ICP iterations of a registration: the cost and loss
+// functions read the matching data of the current iteration, so that
+// only the residual blocks of the matches added or removed since the
+// previous iteration have to be updated
+class MatchesProblem
+{
+public:
+  MatchesProblem(double* parameters, bool undistortion, bool analyticJacobians, const MatchesData& data)
+    : Parameters(parameters), Undistortion(undistortion), AnalyticJacobians(analyticJacobians), Data(data),
+      Problem(ProblemOptions()) {}
+
+  // Use the nbrMatches first matches of the data, with the given loss scale
+  void Update(size_t nbrMatches, double lossScale)
+  {
+    this->LossScale = lossScale;
+    // The blocks are removed from the last one so that
+    // the order of the remaining ones is preserved
+    while (this->Blocks.size() > nbrMatches)
+    {
+      this->Problem.RemoveResidualBlock(this->Blocks.back());
+      this->Blocks.pop_back();
+    }
+    while (this->Blocks.size() < nbrMatches)
+    {
+      const size_t k = this->Blocks.size();
+      if (k == this->Costs.size())
+      {
+        if (this->Undistortion)
+        {
+          this->Costs.emplace_back(new ceres::AutoDiffCostFunction<InterpolatedMotionMatchResidual, 1, 12>(
+                                   new InterpolatedMotionMatchResidual(this->Data, k)));
+        }
+        else if (this->AnalyticJacobians)
+        {
+          this->Costs.emplace_back(new AffineIsometryMatchAnalyticResidual(this->Data, k));
+        }
+        else
+        {
+          this->Costs.emplace_back(new ceres::AutoDiffCostFunction<AffineIsometryMatchResidual, 1, 6>(
+                                   new AffineIsometryMatchResidual(this->Data, k)));
+        }
+        this->Losses.emplace_back(new MatchLoss(this->LossScale, this->Data, k));
+      }
+      this->Blocks.push_back(this->Problem.AddResidualBlock(this->Costs[k].get(), this->Losses[k].get(),
+                                                            this->Parameters));
+    }
+  }
+
+  ceres::Problem& GetProblem() { return this->Problem; }
+
+private:
+  static ceres::Problem::Options ProblemOptions()
+  {
+    ceres::Problem::Options options;
+    options.cost_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    options.enable_fast_removal = true;
+    return options;
+  }
+
+  double* Parameters;
+  bool Undistortion;
+  bool AnalyticJacobians;
+  MatchesData Data;
+  double LossScale = 1.0;
+  std::vector<std::unique_ptr<ceres::CostFunction> > Costs;
+  std::vector<std::unique_ptr<ceres::LossFunction> > Losses;
+  std::vector<ceres::ResidualBlockId> Blocks;
+  // Declared last so that it is destroyed before the functions it uses
+  ceres::Problem Problem;
+};
 
 //-----------------------------------------------------------------------------
-void StopTimeAndDisplay(std::string functionName)
+ceres::Solver::Options SolverOptions(unsigned int maxIterations, unsigned int numberOfThreads, int linearSolver)
 {
-  std::clock_t endTime = std::clock();
-  double dt = static_cast<double>(endTime - startTime) / CLOCKS_PER_SEC;
-  std::cout << "  -time elapsed in function <" << functionName << "> : " << dt << " sec" << std::endl;
+  ceres::Solver::Options options;
+  options.max_num_iterations = maxIterations;
+  options.linear_solver_type = (linearSolver == SolverLinearSolverType::DenseNormalCholeskySolver) ?
+                               ceres::DENSE_NORMAL_CHOLESKY : ceres::DENSE_QR;
+  options.num_threads = (numberOfThreads == 0) ?
+                        std::max(1u, boost::thread::hardware_concurrency()) : numberOfThreads;
+  options.minimizer_progress_to_stdout = false;
+  return options;
 }
 
 //-----------------------------------------------------------------------------
@@ -120,6 +329,120 @@ double Rad2Deg(double val)
 }
 }
 
+// Interface of the maps storing the keypoints around the sensor. The space is
+// split in voxels of VoxelResolution, the map keeps the voxels closer than
+// VoxelSize / 2 voxels of the sensor and the sub maps gather the voxels closer
+// than the lidar range
+class LocalMap {
+
+public:
+  virtual ~LocalMap() = default;
+
+  // move the map so that it contains the area around T
+  virtual void Roll(Eigen::Matrix<double, 6, 1> &T) = 0;
+
+  // get points arround T
+  virtual pcl::PointCloud<Slam::Point>::Ptr Get(Eigen::Matrix<double, 6, 1> &T) = 0;
+
+  // get all points
+  virtual pcl::PointCloud<Slam::Point>::Ptr Get() = 0;
+
+  // add some points to the map
+  virtual void Add(pcl::PointCloud<Slam::Point>::Ptr pointcloud) = 0;
+
+  // get a nearest neighbors search structure on the points arround T,
+  // the maps which do not maintain one build a kd-tree on the sub map
+  virtual std::shared_ptr<KDTreePCLAdaptor> GetSearchIndex(Eigen::Matrix<double, 6, 1> &T)
+  {
+    return std::make_shared<KDTreePCLAdaptor>(this->Get(T));
+  }
+
+  // get a kd-tree on the points arround T decimated on a voxel grid of
+  // leafSize, the coarse level of the map used by the first iterations
+  // of the mapping. It is kept until the points of the map change
+  std::shared_ptr<KDTreePCLAdaptor> GetCoarseSearchIndex(Eigen::Matrix<double, 6, 1> &T, double leafSize)
+  {
+    if (!this->CoarseSearchIndex || this->CoarseVersion != this->Version || this->CoarseLeafSize != leafSize)
+    {
+      pcl::PointCloud<Slam::Point>::Ptr coarse(new pcl::PointCloud<Slam::Point>());
+      pcl::VoxelGrid<Slam::Point> downSizeFilter;
+      downSizeFilter.setLeafSize(leafSize, leafSize, leafSize);
+      downSizeFilter.setInputCloud(this->Get(T));
+      downSizeFilter.filter(*coarse);
+      this->CoarseSearchIndex = std::make_shared<KDTreePCLAdaptor>(coarse);
+      this->CoarseVersion = this->Version;
+      this->CoarseLeafSize = leafSize;
+    }
+    return this->CoarseSearchIndex;
+  }
+
+  void SetPointCoudMaxRange(const double maxdist)
+  {
+    this->PointCloudSize = 2.0 * std::ceil(maxdist / this->VoxelResolution);
+  }
+
+  virtual void SetSize(int size) { this->VoxelSize = size; }
+
+  void SetResolution(double resolution) { this->VoxelResolution = resolution; }
+
+  double GetResolution() const { return this->VoxelResolution; }
+
+  virtual void SetLeafSize(double size) { this->LeafSize = size; }
+
+  // copy the parameters of another map, but not its points
+  void CopyParameters(const LocalMap& other)
+  {
+    this->SetSize(other.VoxelSize);
+    this->VoxelResolution = other.VoxelResolution;
+    this->PointCloudSize = other.PointCloudSize;
+    this->SetLeafSize(other.LeafSize);
+    this->TileStore = other.TileStore;
+  }
+
+  // keep the points evicted from the map in a store, to load them back
+  // when the sensor comes back, the maps which never evict points ignore it
+  void SetTileStore(std::shared_ptr<MapTileStore> store) { this->TileStore = store; }
+
+  // get all the points, including the ones flushed to the tile store
+  virtual pcl::PointCloud<Slam::Point>::Ptr GetComplete() { return this->Get(); }
+
+  // version of the points of the map, it changes each time points are
+  // added or removed and is never shared by two maps, like a vtkTimeStamp
+  unsigned long GetVersion() const { return this->Version; }
+
+protected:
+  LocalMap() { this->Modified(); }
+
+  // to call each time the points of the map are modified
+  void Modified()
+  {
+    static std::atomic<unsigned long> globalVersion(0);
+    this->Version = ++globalVersion;
+  }
+
+  unsigned long Version = 0;
+
+  //! Coarse level of the map, with the version and the leaf size it was built with
+  std::shared_ptr<KDTreePCLAdaptor> CoarseSearchIndex;
+  unsigned long CoarseVersion = 0;
+  double CoarseLeafSize = 0.0;
+
+  //! Store of the evicted points, none if they are dropped
+  std::shared_ptr<MapTileStore> TileStore;
+
+  //! Size of the voxel grid: n*n*n voxels
+  int VoxelSize = 50;
+
+  //! Resolution of a voxel
+  double VoxelResolution = 10;
+
+  //! Size of a pointcloud in voxel
+  int PointCloudSize = 25;
+
+  //! Size of the leaf use to downsample the pointcloud
+  double LeafSize = 0.2;
+};
+
 // The map reconstructed from the slam algorithm is stored in a voxel grid
 // which split the space in differents region. From this voxel grid it is possible
 // to only load the parts of the map which are pertinents when we run the mapping
@@ -127,7 +450,7 @@ double Rad2Deg(double val)
 // the current sensor position it is possible to remove the points stored in this region
 // and to move the voxel grid in a closest region of the sensor position. This is used
 // to decrease the memory used by the algorithm
-class RollingGrid {
+class RollingGrid : public LocalMap {
 
 public:
   RollingGrid() {}
@@ -141,7 +464,7 @@ public:
   }
 
   // roll the grid to enable adding new point cloud
-  void Roll(Eigen::Matrix<double, 6, 1> &T)
+  void Roll(Eigen::Matrix<double, 6, 1> &T) override
   {
     // Very basic implementation where the grid is not circular
 
@@ -161,11 +484,12 @@ public:
           {
             this->grid[i][j][k] = this->grid[i-1][j][k];
           }
-          this->grid[0][j][k].reset(new pcl::PointCloud<Slam::Point>());
+          this->grid[0][j][k].reset(new Voxel);
         }
       }
       frameCenterX++;
       this->VoxelGridPosition[0]--;
+      this->Modified();
     }
 
     // shift the voxel grid to the right
@@ -179,11 +503,12 @@ public:
           {
             this->grid[i][j][k] = this->grid[i+1][j][k];
           }
-          this->grid[VoxelSize-1][j][k].reset(new pcl::PointCloud<Slam::Point>());
+          this->grid[VoxelSize-1][j][k].reset(new Voxel);
         }
       }
       frameCenterX--;
       this->VoxelGridPosition[0]++;
+      this->Modified();
     }
 
     // shift the voxel grid to the bottom
@@ -197,11 +522,12 @@ public:
           {
             this->grid[i][j][k] = this->grid[i][j-1][k];
           }
-          this->grid[i][0][k].reset(new pcl::PointCloud<Slam::Point>());
+          this->grid[i][0][k].reset(new Voxel);
         }
       }
       frameCenterY++;
       this->VoxelGridPosition[1]--;
+      this->Modified();
 //      cout << "bottom";
     }
 
@@ -216,11 +542,12 @@ public:
           {
             this->grid[i][j][k] = this->grid[i][j+1][k];
           }
-          this->grid[i][VoxelSize-1][k].reset(new pcl::PointCloud<Slam::Point>());
+          this->grid[i][VoxelSize-1][k].reset(new Voxel);
         }
       }
       frameCenterY--;
       this->VoxelGridPosition[1]++;
+      this->Modified();
     }
 
     // shift the voxel grid to the "camera"
@@ -234,11 +561,12 @@ public:
           {
             this->grid[i][j][k] = this->grid[i][j][k-1];
           }
-          this->grid[i][j][0].reset(new pcl::PointCloud<Slam::Point>());
+          this->grid[i][j][0].reset(new Voxel);
         }
       }
       frameCenterZ++;
       this->VoxelGridPosition[2]--;
+      this->Modified();
     }
 
     // shift the voxel grid to the "horizon"
@@ -252,16 +580,17 @@ public:
           {
             this->grid[i][j][k] = this->grid[i][j][k+1];
           }
-          this->grid[i][j][VoxelSize-1].reset(new pcl::PointCloud<Slam::Point>());
+          this->grid[i][j][VoxelSize-1].reset(new Voxel);
         }
       }
       frameCenterZ--;
       this->VoxelGridPosition[2]++;
+      this->Modified();
     }
   }
 
   // get points arround T
-  pcl::PointCloud<Slam::Point>::Ptr Get(Eigen::Matrix<double, 6, 1> &T)
+  pcl::PointCloud<Slam::Point>::Ptr Get(Eigen::Matrix<double, 6, 1> &T) override
   {
     // compute the position of the new frame center in the grid
     int frameCenterX = std::floor(T[3] / this->VoxelSize) - this->VoxelGridPosition[0];
@@ -283,7 +612,7 @@ public:
           {
             continue;
           }
-          pcl::PointCloud<Slam::Point>:: Ptr voxel = this->grid[i][j][k];
+          pcl::PointCloud<Slam::Point>:: Ptr voxel = this->grid[i][j][k]->Points;
           for (unsigned int l = 0; l < voxel->size(); l++)
           {
             intersection->push_back(voxel->at(l));
@@ -295,7 +624,7 @@ public:
   }
 
   // get all points
-  pcl::PointCloud<Slam::Point>::Ptr Get()
+  pcl::PointCloud<Slam::Point>::Ptr Get() override
   {
     pcl::PointCloud<Slam::Point>::Ptr intersection(new pcl::PointCloud<Slam::Point>);
 
@@ -306,7 +635,7 @@ public:
       {
         for (int k = 0; k < VoxelSize; k++)
         {
-          pcl::PointCloud<Slam::Point>:: Ptr voxel = this->grid[i][j][k];
+          pcl::PointCloud<Slam::Point>:: Ptr voxel = this->grid[i][j][k]->Points;
           for (unsigned int l = 0; l < voxel->size(); l++)
           {
             intersection->push_back(voxel->at(l));
@@ -318,7 +647,7 @@ public:
   }
 
   // add some points to the grid
-  void Add(pcl::PointCloud<Slam::Point>::Ptr pointcloud)
+  void Add(pcl::PointCloud<Slam::Point>::Ptr pointcloud) override
   {
     if (pointcloud->size() == 0)
     {
@@ -326,14 +655,15 @@ public:
       return;
     }
 
-    // Voxel to filte because new points were add
-    std::vector<std::vector<std::vector<int> > > voxelToFilter(VoxelSize, std::vector<std::vector<int> >(VoxelSize, std::vector<int>(VoxelSize, 0)));
+    // Number of points averaged in the leaves modified by this call,
+    // indexed by voxel and by point of the voxel
+    std::unordered_map<uint64_t, unsigned int> weights;
 
     // Add points in the rolling grid
     int outlier = 0; // point who are not in the rolling grid
     for (unsigned int i = 0; i < pointcloud->size(); i++)
     {
-      Slam::Point pts = pointcloud->points[i];
+      const Slam::Point& pts = pointcloud->points[i];
       // find the closest coordinate
       int cubeIdxX = std::floor(pts.x / this->VoxelSize) - this->VoxelGridPosition[0];
       int cubeIdxY = std::floor(pts.y / this->VoxelSize) - this->VoxelGridPosition[1];
@@ -344,8 +674,26 @@ public:
         cubeIdxY >= 0 && cubeIdxY < this->VoxelSize &&
         cubeIdxZ >= 0 && cubeIdxZ < this->VoxelSize)
       {
-        voxelToFilter[cubeIdxX][cubeIdxY][cubeIdxZ] = 1;
-        grid[cubeIdxX][cubeIdxY][cubeIdxZ]->push_back(pts);
+        // Downsample the voxel as the points are added: a leaf holds at most
+        // one point, the mean of the points added in it as with a
+        // pcl::VoxelGrid filter, so only the new points are processed
+        Voxel& voxel = *this->grid[cubeIdxX][cubeIdxY][cubeIdxZ];
+        auto leaf = voxel.Leaves.emplace(this->GetLeafIndex(pts), voxel.Points->size());
+        if (leaf.second)
+        {
+          voxel.Points->push_back(pts);
+          continue;
+        }
+        const uint64_t voxelIndex = (static_cast<uint64_t>(cubeIdxX) * this->VoxelSize + cubeIdxY) * this->VoxelSize + cubeIdxZ;
+        unsigned int& weight = weights.emplace((voxelIndex << 32) | leaf.first->second, 1).first->second;
+        Slam::Point& mean = voxel.Points->points[leaf.first->second];
+        const double w = weight;
+        mean.x = (w * mean.x + pts.x) / (w + 1.0);
+        mean.y = (w * mean.y + pts.y) / (w + 1.0);
+        mean.z = (w * mean.z + pts.z) / (w + 1.0);
+        mean.time = (w * mean.time + pts.time) / (w + 1.0);
+        mean.intensity = static_cast<uint8_t>((w * mean.intensity + pts.intensity) / (w + 1.0) + 0.5);
+        weight++;
       }
       else
       {
@@ -353,36 +701,37 @@ public:
       }
     }
 
-    // Filter the modified pointCloud
-    pcl::VoxelGrid<Slam::Point> downSizeFilter;
-    downSizeFilter.setLeafSize(this->LeafSize, this->LeafSize, this->LeafSize);
-    for (int i = 0; i < this->VoxelSize; i++)
+    if (outlier < static_cast<int>(pointcloud->size()))
     {
-      for (int j = 0; j < this->VoxelSize; j++)
+      this->Modified();
+    }
+  }
+
+  // the points already added are indexed again by leaf, they are not
+  // downsampled again if the leaves are larger
+  void SetLeafSize(double size) override
+  {
+    this->LeafSize = size;
+    for (auto& plane : this->grid)
+    {
+      for (auto& line : plane)
       {
-        for (int k = 0; k < this->VoxelSize; k++)
+        for (auto& voxel : line)
         {
-          if (voxelToFilter[i][j][k] == 1)
+          voxel->Leaves.clear();
+          for (size_t l = 0; l < voxel->Points->size(); l++)
           {
-            pcl::PointCloud<Slam::Point>::Ptr tmp(new pcl::PointCloud<Slam::Point>());
-            downSizeFilter.setInputCloud(grid[i][j][k]);
-            downSizeFilter.filter(*tmp);
-            grid[i][j][k] = tmp;
+            voxel->Leaves.emplace(this->GetLeafIndex(voxel->Points->points[l]), l);
           }
         }
       }
     }
   }
 
-
-  void SetPointCoudMaxRange(const double maxdist)
-  {
-    this->PointCloudSize = 2.0 * std::ceil(maxdist / this->VoxelResolution);
-  }
-
-  void SetSize(int size)
+  void SetSize(int size) override
   {
     this->VoxelSize = size;
+    this->Modified();
     grid.resize(this->VoxelSize);
     for (int i = 0; i < this->VoxelSize; i++)
     {
@@ -392,36 +741,538 @@ public:
         grid[i][j].resize(this->VoxelSize);
         for (int k = 0; k < this->VoxelSize; k++)
         {
-          grid[i][j][k].reset(new pcl::PointCloud<Slam::Point>());
+          grid[i][j][k].reset(new Voxel);
         }
       }
     }
   }
 
-  void SetResolution(double resolution) { this->VoxelResolution = resolution; }
+private:
+  struct Voxel
+  {
+    pcl::PointCloud<Slam::Point>::Ptr Points{ new pcl::PointCloud<Slam::Point>() };
+    //! Index in Points of the point of each occupied leaf
+    std::unordered_map<uint64_t, size_t> Leaves;
+  };
+
+  //! Key of the leaf of the downsampling grid containing a point, the
+  //! coordinates wrapping every 2^21 leaves, far beyond the size of a voxel
+  uint64_t GetLeafIndex(const Slam::Point& p) const
+  {
+    const uint64_t mask = (1u << 21) - 1;
+    const uint64_t x = static_cast<uint64_t>(static_cast<int64_t>(std::floor(p.x / this->LeafSize))) & mask;
+    const uint64_t y = static_cast<uint64_t>(static_cast<int64_t>(std::floor(p.y / this->LeafSize))) & mask;
+    const uint64_t z = static_cast<uint64_t>(static_cast<int64_t>(std::floor(p.z / this->LeafSize))) & mask;
+    return (x << 42) | (y << 21) | z;
+  }
+
+  //! VoxelGrid of pointcloud
+  std::vector<std::vector<std::vector<std::shared_ptr<Voxel> > > > grid;
+
+  // Position of the VoxelGrid
+  int VoxelGridPosition[3] = {0,0,0};
+};
+
+// Sparse alternative to the rolling grid: only the voxels containing some
+// points are stored, in a hash map indexed by the voxel coordinates. Adding
+// points does not depend on the number of voxels of the map, moving the
+// sensor does not shift a dense array but evicts the voxels which became
+// too far, and the points around the sensor are cached until the sensor
+// enters another voxel or the voxels around it are modified. The points of
+// the map are also kept in a VoxelHashKNN, updated along with the voxels, which
+// is used to match the keypoints instead of building a kd-tree on each frame.
+class HashedVoxelGrid : public LocalMap {
+
+public:
+  HashedVoxelGrid()
+  {
+    this->SearchIndex = std::make_shared<VoxelHashKNN>(this->SearchCellsPerLeaf * this->LeafSize);
+  }
+
+  // evict the voxels too far from T, and load back
+  // the voxels of the tile store which are close again
+  void Roll(Eigen::Matrix<double, 6, 1> &T) override
+  {
+    const VoxelIndex center = this->GetVoxelIndex(T[3], T[4], T[5]);
+    if (this->IsRolled && center == this->RollCenter)
+    {
+      return;
+    }
+    this->IsRolled = true;
+    this->RollCenter = center;
+
+    const int radius = this->VoxelSize / 2;
+    for (auto it = this->Voxels.begin(); it != this->Voxels.end(); )
+    {
+      if (it->first.Distance(center) > radius)
+      {
+        if (this->TileStore)
+        {
+          this->TileStore->Write({{it->first.X, it->first.Y, it->first.Z}}, *it->second.Points);
+        }
+        this->SearchIndex->Remove(it->second.SearchIndices);
+        it = this->Voxels.erase(it);
+        this->Modified();
+      }
+      else
+      {
+        ++it;
+      }
+    }
+
+    if (!this->TileStore)
+    {
+      return;
+    }
+    for (const MapTileStore::TileIndex& tile : this->TileStore->GetTiles())
+    {
+      VoxelIndex index;
+      index.X = tile[0];
+      index.Y = tile[1];
+      index.Z = tile[2];
+      if (index.Distance(center) > radius)
+      {
+        continue;
+      }
+      pcl::PointCloud<Slam::Point>::Ptr points = this->TileStore->Read(tile);
+      if (!points)
+      {
+        continue;
+      }
+      Voxel& voxel = this->Voxels[index];
+      if (voxel.Points)
+      {
+        *points += *voxel.Points;
+        this->SearchIndex->Remove(voxel.SearchIndices);
+      }
+      voxel.Points = points;
+      this->SearchIndex->Insert(*voxel.Points, voxel.SearchIndices);
+      this->Modified();
+    }
+  }
+
+  // get points arround T
+  pcl::PointCloud<Slam::Point>::Ptr Get(Eigen::Matrix<double, 6, 1> &T) override
+  {
+    const VoxelIndex center = this->GetVoxelIndex(T[3], T[4], T[5]);
+    if (this->SubMap && this->SubMapVersion == this->Version && center == this->SubMapCenter)
+    {
+      return this->SubMap;
+    }
+
+    // Look up the voxels of the window around the sensor, or go through the
+    // voxels of the map if there are less of them than in the window
+    const int radius = this->PointCloudSize / 2;
+    const double windowSize = std::pow(2.0 * radius + 1.0, 3);
+    std::vector<VoxelMap::const_iterator> selected;
+    if (this->Voxels.size() < windowSize)
+    {
+      for (auto it = this->Voxels.cbegin(); it != this->Voxels.cend(); ++it)
+      {
+        if (it->first.Distance(center) <= radius)
+        {
+          selected.push_back(it);
+        }
+      }
+    }
+    else
+    {
+      VoxelIndex index;
+      for (index.X = center.X - radius; index.X <= center.X + radius; ++index.X)
+      {
+        for (index.Y = center.Y - radius; index.Y <= center.Y + radius; ++index.Y)
+        {
+          for (index.Z = center.Z - radius; index.Z <= center.Z + radius; ++index.Z)
+          {
+            auto it = this->Voxels.find(index);
+            if (it != this->Voxels.cend())
+            {
+              selected.push_back(it);
+            }
+          }
+        }
+      }
+    }
+
+    this->SubMap = this->Concatenate(selected);
+    this->SubMapCenter = center;
+    this->SubMapVersion = this->Version;
+    return this->SubMap;
+  }
+
+  // get all points
+  pcl::PointCloud<Slam::Point>::Ptr Get() override
+  {
+    if (this->AllPoints && this->AllPointsVersion == this->Version)
+    {
+      return this->AllPoints;
+    }
+    std::vector<VoxelMap::const_iterator> selected;
+    for (auto it = this->Voxels.cbegin(); it != this->Voxels.cend(); ++it)
+    {
+      selected.push_back(it);
+    }
+    this->AllPoints = this->Concatenate(selected);
+    this->AllPointsVersion = this->Version;
+    return this->AllPoints;
+  }
+
+  // get the points of the map and of the tile store
+  pcl::PointCloud<Slam::Point>::Ptr GetComplete() override
+  {
+    pcl::PointCloud<Slam::Point>::Ptr points = this->Get();
+    if (!this->TileStore || this->TileStore->GetNumberOfTiles() == 0)
+    {
+      return points;
+    }
+    // the cloud returned by Get is cached and must not be modified
+    pcl::PointCloud<Slam::Point>::Ptr complete(new pcl::PointCloud<Slam::Point>(*points));
+    for (const MapTileStore::TileIndex& tile : this->TileStore->GetTiles())
+    {
+      pcl::PointCloud<Slam::Point>::Ptr tilePoints = this->TileStore->Peek(tile);
+      if (tilePoints)
+      {
+        *complete += *tilePoints;
+      }
+    }
+    return complete;
+  }
+
+  // add some points to the map
+  void Add(pcl::PointCloud<Slam::Point>::Ptr pointcloud) override
+  {
+    if (pointcloud->size() == 0)
+    {
+      std::cout << "Pointcloud empty, voxel grid not updated" << std::endl;
+      return;
+    }
 
-  void SetLeafSize(double size) { this->LeafSize = size; }
+    // Add the points in their voxel, the points which would be
+    // evicted at the next roll are dropped
+    const int radius = this->VoxelSize / 2;
+    std::unordered_set<VoxelIndex, VoxelIndexHash> voxelToFilter;
+    for (const Slam::Point& pts : pointcloud->points)
+    {
+      const VoxelIndex index = this->GetVoxelIndex(pts.x, pts.y, pts.z);
+      if (this->IsRolled && index.Distance(this->RollCenter) > radius)
+      {
+        continue;
+      }
+      Voxel& voxel = this->Voxels[index];
+      if (!voxel.Points)
+      {
+        voxel.Points.reset(new pcl::PointCloud<Slam::Point>());
+      }
+      voxel.Points->push_back(pts);
+      voxelToFilter.insert(index);
+    }
+    if (voxelToFilter.empty())
+    {
+      return;
+    }
+    this->Modified();
+
+    // Filter the modified voxels and replace their points in the search index
+    pcl::VoxelGrid<Slam::Point> downSizeFilter;
+    downSizeFilter.setLeafSize(this->LeafSize, this->LeafSize, this->LeafSize);
+    for (const VoxelIndex& index : voxelToFilter)
+    {
+      Voxel& voxel = this->Voxels[index];
+      pcl::PointCloud<Slam::Point>::Ptr tmp(new pcl::PointCloud<Slam::Point>());
+      downSizeFilter.setInputCloud(voxel.Points);
+      downSizeFilter.filter(*tmp);
+      voxel.Points = tmp;
+      this->SearchIndex->Remove(voxel.SearchIndices);
+      this->SearchIndex->Insert(*voxel.Points, voxel.SearchIndices);
+    }
+  }
+
+  // The search index contains all the points of the map, which are at most
+  // VoxelSize / 2 voxels away from the sensor: it is not restricted to the
+  // lidar range like the sub map, but it does not need to be built
+  std::shared_ptr<KDTreePCLAdaptor> GetSearchIndex(Eigen::Matrix<double, 6, 1> &/*T*/) override
+  {
+    return this->SearchIndex;
+  }
+
+  // The search cells are proportional to the leaf size, so that they
+  // contain a similar number of points whatever the keypoints type
+  void SetLeafSize(double size) override
+  {
+    this->LeafSize = size;
+    this->SearchIndex->Reset(this->SearchCellsPerLeaf * this->LeafSize);
+    for (auto& voxel : this->Voxels)
+    {
+      this->SearchIndex->Insert(*voxel.second.Points, voxel.second.SearchIndices);
+    }
+  }
 
 private:
-  //! Size of the voxel grid: n*n*n voxels
-  int VoxelSize = 50;
+  //! Integer coordinates of a voxel
+  struct VoxelIndex
+  {
+    int X = 0;
+    int Y = 0;
+    int Z = 0;
 
-  //! Resolution of a voxel
-  double VoxelResolution = 10;
+    bool operator==(const VoxelIndex& other) const
+    {
+      return this->X == other.X && this->Y == other.Y && this->Z == other.Z;
+    }
 
-  //! Size of a pointcloud in voxel
-  int PointCloudSize = 25;
+    bool operator<(const VoxelIndex& other) const
+    {
+      return std::tie(this->X, this->Y, this->Z) < std::tie(other.X, other.Y, other.Z);
+    }
 
-  //! Size of the leaf use to downsample the pointcloud
-  double LeafSize = 0.2;
+    //! Number of voxels between two voxels along the farthest axis
+    int Distance(const VoxelIndex& other) const
+    {
+      return std::max(std::abs(this->X - other.X),
+                      std::max(std::abs(this->Y - other.Y), std::abs(this->Z - other.Z)));
+    }
+  };
 
-  //! VoxelGrid of pointcloud
-  std::vector<std::vector<std::vector<pcl::PointCloud<Slam::Point>::Ptr> > > grid;
+  struct VoxelIndexHash
+  {
+    size_t operator()(const VoxelIndex& index) const
+    {
+      // large primes spreading the neighbor voxels over the buckets
+      return static_cast<size_t>(index.X) * 73856093u
+           ^ static_cast<size_t>(index.Y) * 19349669u
+           ^ static_cast<size_t>(index.Z) * 83492791u;
+    }
+  };
 
-  // Position of the VoxelGrid
-  int VoxelGridPosition[3] = {0,0,0};
+  struct Voxel
+  {
+    pcl::PointCloud<Slam::Point>::Ptr Points;
+    //! Indices of the points in the search index
+    std::vector<int> SearchIndices;
+  };
+
+  typedef std::unordered_map<VoxelIndex, Voxel, VoxelIndexHash> VoxelMap;
+
+  VoxelIndex GetVoxelIndex(double x, double y, double z) const
+  {
+    VoxelIndex index;
+    index.X = static_cast<int>(std::floor(x / this->VoxelResolution));
+    index.Y = static_cast<int>(std::floor(y / this->VoxelResolution));
+    index.Z = static_cast<int>(std::floor(z / this->VoxelResolution));
+    return index;
+  }
+
+  // Gather the points of the voxels, sorted by index so that
+  // the order of the points does not depend on the hash map
+  pcl::PointCloud<Slam::Point>::Ptr Concatenate(std::vector<VoxelMap::const_iterator>& voxels) const
+  {
+    std::sort(voxels.begin(), voxels.end(),
+      [](const VoxelMap::const_iterator& a, const VoxelMap::const_iterator& b) { return a->first < b->first; });
+    size_t numberOfPoints = 0;
+    for (const auto& voxel : voxels)
+    {
+      numberOfPoints += voxel->second.Points->size();
+    }
+    pcl::PointCloud<Slam::Point>::Ptr points(new pcl::PointCloud<Slam::Point>);
+    points->reserve(numberOfPoints);
+    for (const auto& voxel : voxels)
+    {
+      *points += *voxel->second.Points;
+    }
+    return points;
+  }
+
+  //! Voxels containing some points
+  VoxelMap Voxels;
+
+  //! Nearest neighbors search structure on the points of the voxels
+  std::shared_ptr<VoxelHashKNN> SearchIndex;
+  //! Size of the search cells, in leaf size
+  const double SearchCellsPerLeaf = 4.0;
+
+  //! Voxel of the sensor at the last roll
+  VoxelIndex RollCenter;
+  bool IsRolled = false;
+
+  //! Cached sub map, returned as long as the sensor stays in SubMapCenter
+  //! and no voxel is modified. A new cloud is allocated on each update, so
+  //! that the clouds already returned are never modified.
+  pcl::PointCloud<Slam::Point>::Ptr SubMap;
+  VoxelIndex SubMapCenter;
+  unsigned long SubMapVersion = 0;
+  pcl::PointCloud<Slam::Point>::Ptr AllPoints;
+  unsigned long AllPointsVersion = 0;
 };
 
+// Map loaded from a KeypointMapFile, in which the sensor is localized. It
+// is never modified: the points added are ignored, and rolling it only moves
+// the voxels of the file in and out of its search index, which is then kept
+// for the next frames. The fits of the neighborhoods of its points are read
+// from the file rather than computed on each match.
+class PrebuiltMap : public LocalMap {
+
+public:
+  PrebuiltMap(std::shared_ptr<const KeypointMapFile> file, int layer)
+    : File(file), Layer(layer)
+  {
+    this->SearchIndex = std::make_shared<VoxelHashKNN>(this->SearchCellsPerLeaf * this->LeafSize);
+  }
+
+  // keep in the search index the voxels of the file around T
+  void Roll(Eigen::Matrix<double, 6, 1> &T) override
+  {
+    const KeypointMapFile::Voxel center = this->GetVoxel(T[3], T[4], T[5]);
+    if (this->IsRolled && center.X == this->RollCenter.X && center.Y == this->RollCenter.Y &&
+        center.Z == this->RollCenter.Z)
+    {
+      return;
+    }
+    this->IsRolled = true;
+    this->RollCenter = center;
+
+    const int radius = this->VoxelSize / 2;
+    const std::vector<KeypointMapFile::Voxel>& voxels = this->File->GetVoxels(this->Layer);
+    bool modified = false;
+    for (size_t v = 0; v < voxels.size(); ++v)
+    {
+      const bool isClose = Distance(voxels[v], center) <= radius;
+      auto loaded = this->LoadedVoxels.find(v);
+      if (isClose && loaded == this->LoadedVoxels.end())
+      {
+        pcl::PointCloud<Slam::Point> points;
+        this->File->GetPoints(this->Layer, voxels[v].FirstPoint, voxels[v].NumberOfPoints, points);
+        std::vector<int>& indices = this->LoadedVoxels[v];
+        this->SearchIndex->Insert(points, indices);
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+          if (static_cast<size_t>(indices[i]) >= this->FilePointIndices.size())
+          {
+            this->FilePointIndices.resize(indices[i] + 1);
+          }
+          this->FilePointIndices[indices[i]] = voxels[v].FirstPoint + i;
+        }
+        modified = true;
+      }
+      else if (!isClose && loaded != this->LoadedVoxels.end())
+      {
+        this->SearchIndex->Remove(loaded->second);
+        this->LoadedVoxels.erase(loaded);
+        modified = true;
+      }
+    }
+    if (modified)
+    {
+      this->Modified();
+    }
+  }
+
+  // get the points of the loaded voxels arround T
+  pcl::PointCloud<Slam::Point>::Ptr Get(Eigen::Matrix<double, 6, 1> &T) override
+  {
+    const KeypointMapFile::Voxel center = this->GetVoxel(T[3], T[4], T[5]);
+    const int radius = this->PointCloudSize / 2;
+    const std::vector<KeypointMapFile::Voxel>& voxels = this->File->GetVoxels(this->Layer);
+    pcl::PointCloud<Slam::Point>::Ptr points(new pcl::PointCloud<Slam::Point>);
+    for (const auto& loaded : this->LoadedVoxels)
+    {
+      const KeypointMapFile::Voxel& voxel = voxels[loaded.first];
+      if (Distance(voxel, center) <= radius)
+      {
+        pcl::PointCloud<Slam::Point> voxelPoints;
+        this->File->GetPoints(this->Layer, voxel.FirstPoint, voxel.NumberOfPoints, voxelPoints);
+        *points += voxelPoints;
+      }
+    }
+    return points;
+  }
+
+  // get all the points of the file, which never change
+  pcl::PointCloud<Slam::Point>::Ptr Get() override
+  {
+    if (!this->AllPoints)
+    {
+      this->AllPoints.reset(new pcl::PointCloud<Slam::Point>);
+      this->File->GetPoints(this->Layer, 0, this->File->GetNumberOfPoints(this->Layer), *this->AllPoints);
+    }
+    return this->AllPoints;
+  }
+
+  // the map is never modified
+  void Add(pcl::PointCloud<Slam::Point>::Ptr /*pointcloud*/) override {}
+
+  // the maps are not rolled by their updates when localizing,
+  // the search index is moved around T when it is requested
+  std::shared_ptr<KDTreePCLAdaptor> GetSearchIndex(Eigen::Matrix<double, 6, 1> &T) override
+  {
+    this->Roll(T);
+    return this->SearchIndex;
+  }
+
+  void SetLeafSize(double size) override
+  {
+    this->LeafSize = size;
+    this->SearchIndex->Reset(this->SearchCellsPerLeaf * this->LeafSize);
+    this->LoadedVoxels.clear();
+    this->FilePointIndices.clear();
+    this->IsRolled = false;
+    this->Modified();
+  }
+
+  // fit of the neighborhood of a point of the search index
+  const KeypointMapFile::Fit& GetFit(int searchIndex) const
+  {
+    return this->File->GetFit(this->Layer, this->FilePointIndices[searchIndex]);
+  }
+
+private:
+  KeypointMapFile::Voxel GetVoxel(double x, double y, double z) const
+  {
+    const double resolution = this->File->GetVoxelResolution();
+    KeypointMapFile::Voxel voxel = {};
+    voxel.X = static_cast<int32_t>(std::floor(x / resolution));
+    voxel.Y = static_cast<int32_t>(std::floor(y / resolution));
+    voxel.Z = static_cast<int32_t>(std::floor(z / resolution));
+    return voxel;
+  }
+
+  //! Number of voxels between two voxels along the farthest axis
+  static int Distance(const KeypointMapFile::Voxel& a, const KeypointMapFile::Voxel& b)
+  {
+    return std::max(std::abs(a.X - b.X), std::max(std::abs(a.Y - b.Y), std::abs(a.Z - b.Z)));
+  }
+
+  std::shared_ptr<const KeypointMapFile> File;
+  const int Layer;
+
+  //! Nearest neighbors search structure on the points of the loaded voxels
+  std::shared_ptr<VoxelHashKNN> SearchIndex;
+  const double SearchCellsPerLeaf = 4.0;
+
+  //! Indices in the search index of the points of the loaded
+  //! voxels, by index of the voxel in the file
+  std::map<size_t, std::vector<int> > LoadedVoxels;
+  //! Index in the file of each point of the search index
+  std::vector<uint64_t> FilePointIndices;
+
+  //! Voxel of the sensor at the last roll
+  KeypointMapFile::Voxel RollCenter = {};
+  bool IsRolled = false;
+
+  pcl::PointCloud<Slam::Point>::Ptr AllPoints;
+};
+
+namespace {
+//-----------------------------------------------------------------------------
+std::shared_ptr<LocalMap> NewLocalMap(int backend)
+{
+  if (backend == LocalMapBackend::HashedVoxelMap)
+  {
+    return std::make_shared<HashedVoxelGrid>();
+  }
+  return std::make_shared<RollingGrid>();
+}
+}
+
 //-----------------------------------------------------------------------------
 Slam::Slam()
 {
@@ -431,9 +1282,25 @@ Slam::Slam()
 //-----------------------------------------------------------------------------
 void Slam::Reset()
 {
-  this->EdgesPointsLocalMap = std::make_shared<RollingGrid>();
-  this->PlanarPointsLocalMap = std::make_shared<RollingGrid>();
-  this->BlobsPointsLocalMap = std::make_shared<RollingGrid>();
+  // drop the pending frame and wait for the background tasks
+  this->HasPendingFrame = false;
+  this->PendingFrame = ExtractedFrame();
+  this->WaitForMapsUpdate();
+  this->Timings->Reset();
+  this->LoopClosures->Reset();
+
+  // the maps of the localization are loaded from its file
+  auto newMap = [this](int layer) -> std::shared_ptr<LocalMap>
+  {
+    if (this->LocalizationMap)
+    {
+      return std::make_shared<PrebuiltMap>(this->LocalizationMap, layer);
+    }
+    return NewLocalMap(this->MapBackend);
+  };
+  this->EdgesPointsLocalMap = newMap(KeypointMapFile::EdgesLayer);
+  this->PlanarPointsLocalMap = newMap(KeypointMapFile::PlanarsLayer);
+  this->BlobsPointsLocalMap = newMap(KeypointMapFile::BlobsLayer);
 
   this->EdgesPointsLocalMap->SetResolution(10);
   this->PlanarPointsLocalMap->SetResolution(10);
@@ -442,8 +1309,16 @@ void Slam::Reset()
   this->EdgesPointsLocalMap->SetSize(50);
   this->PlanarPointsLocalMap->SetSize(50);
   this->BlobsPointsLocalMap->SetSize(50);
+  this->ResetMapTileStores();
 
   this->NbrFrameProcessed = 0;
+  this->IsKeyframe = true;
+  this->LastKeyframeTworld = Eigen::Matrix<double, 6, 1>::Zero();
+  this->MappingOverlap = 0;
+
+  // wait for the kd-trees still being built
+  this->PreviousEdgesKDTree = std::shared_future<std::shared_ptr<KDTreePCLAdaptor> >();
+  this->PreviousPlanarsKDTree = std::shared_future<std::shared_ptr<KDTreePCLAdaptor> >();
 
   // n-DoF parameters
   this->Tworld = Eigen::Matrix<double, 6, 1>::Zero();
@@ -491,93 +1366,305 @@ std::unordered_map<std::string, double> Slam::GetDebugInformation()
   map["Mapping: planes used"] = this->MappingPlanesPointsUsed;
   map["Mapping: blobs used"] = this->MappingBlobsPointsUsed;
   map["Mapping: variance error"] = this->MappingVarianceError;
+  map["Keyframe"] = this->IsKeyframe;
+  for (int stage = 0; stage < SlamStage::NbrSlamStages; ++stage)
+  {
+    map[GetStageDebugName(static_cast<SlamStage>(stage))] =
+      this->Timings->GetLastFrameTime(static_cast<SlamStage>(stage));
+  }
   return map;
 }
 
+//-----------------------------------------------------------------------------
+std::string Slam::GetStageDebugName(SlamStage stage)
+{
+  return std::string("Time: ") + SlamTimings::GetStageName(stage) + " (s)";
+}
+
 //-----------------------------------------------------------------------------
 pcl::PointCloud<PointXYZTIId>::Ptr Slam::GetEdgesMap()
 {
+  this->WaitForMapsUpdate();
   return this->EdgesPointsLocalMap->Get();
 }
 
 //-----------------------------------------------------------------------------
 pcl::PointCloud<Slam::Point>::Ptr Slam::GetPlanarsMap()
 {
+  this->WaitForMapsUpdate();
   return this->PlanarPointsLocalMap->Get();
 }
 
 //-----------------------------------------------------------------------------
 pcl::PointCloud<Slam::Point>::Ptr Slam::GetBlobsMap()
 {
+  this->WaitForMapsUpdate();
   return this->BlobsPointsLocalMap->Get();
 }
 
+//-----------------------------------------------------------------------------
+pcl::PointCloud<Slam::Point>::Ptr Slam::GetCompleteEdgesMap()
+{
+  this->WaitForMapsUpdate();
+  return this->EdgesPointsLocalMap->GetComplete();
+}
+
+//-----------------------------------------------------------------------------
+pcl::PointCloud<Slam::Point>::Ptr Slam::GetCompletePlanarsMap()
+{
+  this->WaitForMapsUpdate();
+  return this->PlanarPointsLocalMap->GetComplete();
+}
+
+//-----------------------------------------------------------------------------
+pcl::PointCloud<Slam::Point>::Ptr Slam::GetCompleteBlobsMap()
+{
+  this->WaitForMapsUpdate();
+  return this->BlobsPointsLocalMap->GetComplete();
+}
+
+//-----------------------------------------------------------------------------
+unsigned long Slam::GetEdgesMapVersion()
+{
+  this->WaitForMapsUpdate();
+  return this->EdgesPointsLocalMap->GetVersion();
+}
+
+//-----------------------------------------------------------------------------
+unsigned long Slam::GetPlanarsMapVersion()
+{
+  this->WaitForMapsUpdate();
+  return this->PlanarPointsLocalMap->GetVersion();
+}
+
+//-----------------------------------------------------------------------------
+unsigned long Slam::GetBlobsMapVersion()
+{
+  this->WaitForMapsUpdate();
+  return this->BlobsPointsLocalMap->GetVersion();
+}
+
 //-----------------------------------------------------------------------------
 void Slam::AddFrame(pcl::PointCloud<Slam::Point>::Ptr pc, std::vector<size_t> laserIdMapping)
 {
-  if (pc->size() == 0)
+  this->AddFrames({ pc }, { laserIdMapping });
+}
+
+//-----------------------------------------------------------------------------
+void Slam::AddFrames(const std::vector<pcl::PointCloud<Slam::Point>::Ptr>& frames,
+                     const std::vector<std::vector<size_t> >& laserIdMappings)
+{
+  if (frames.empty() || frames[0]->size() == 0)
   {
     std::cout << "Slam entry is an empty pointcloud" << std::endl;
     return;
   }
+  if (frames.size() > this->GetNumberOfSensors() || laserIdMappings.size() != frames.size())
+  {
+    std::cerr << "Slam entry has " << frames.size() << " frames and " << laserIdMappings.size()
+              << " laser id mappings for " << this->GetNumberOfSensors() << " sensors" << std::endl;
+    return;
+  }
+
+  if (this->PipelineMode == FramePipelineMode::SequentialPipeline)
+  {
+    // Compute the edges and planars keypoints
+    ExtractedFrame frame = this->ExtractKeypoints(frames, laserIdMappings);
 
+    this->ProcessFrame(frame);
+    this->WaitForMapsUpdate();
+    this->Timings->EndFrame();
+    return;
+  }
+
+  // Extract the keypoints of the new frame while the
+  // previous one is registered. The extraction only uses
+  // the keypoints extractors, which are not used by the
+  // registration.
+  std::future<ExtractedFrame> extraction = std::async(std::launch::async,
+    [this, &frames, &laserIdMappings]() { return this->ExtractKeypoints(frames, laserIdMappings); });
+  const bool processed = this->HasPendingFrame;
+  if (this->HasPendingFrame)
+  {
+    this->ProcessFrame(this->PendingFrame);
+  }
+  this->PendingFrame = extraction.get();
+  this->HasPendingFrame = true;
+  if (processed)
+  {
+    this->Timings->EndFrame();
+  }
+}
+
+//-----------------------------------------------------------------------------
+unsigned int Slam::AddSensor(std::shared_ptr<SpinningSensorKeypointExtractor> extractor, const Eigen::Isometry3d& pose)
+{
+  Sensor sensor;
+  sensor.Extractor = extractor;
+  sensor.Rotation = pose.linear();
+  sensor.Translation = pose.translation();
+  this->Sensors.push_back(sensor);
+  return this->Sensors.size();
+}
+
+//-----------------------------------------------------------------------------
+void Slam::Flush()
+{
+  const bool processed = this->HasPendingFrame;
+  if (this->HasPendingFrame)
+  {
+    this->HasPendingFrame = false;
+    this->ProcessFrame(this->PendingFrame);
+  }
+  this->WaitForMapsUpdate();
+  if (processed)
+  {
+    this->Timings->EndFrame();
+  }
+}
+
+//-----------------------------------------------------------------------------
+Slam::ExtractedFrame Slam::ExtractKeypoints(const std::vector<pcl::PointCloud<Point>::Ptr>& frames,
+                                            const std::vector<std::vector<size_t> >& laserIdMappings)
+{
+  SlamTimings::StageTimer timer(*this->Timings, SlamStage::KeypointsExtraction);
+
+  // The frames of the additional sensors are extracted in parallel with the
+  // one of the main sensor, each extractor being used by a single task
+  std::vector<std::future<void> > extractions;
+  for (size_t i = 1; i < frames.size(); ++i)
+  {
+    if (frames[i]->size() > 0)
+    {
+      extractions.push_back(std::async(std::launch::async, [this, &frames, &laserIdMappings, i]()
+        { this->Sensors[i - 1].Extractor->ComputeKeyPoints(frames[i], laserIdMappings[i]); }));
+    }
+  }
+  this->KeyPointsExtractor->ComputeKeyPoints(frames[0], laserIdMappings[0]);
+  for (std::future<void>& extraction : extractions)
+  {
+    extraction.get();
+  }
+
+  ExtractedFrame frame;
+  frame.Time = frames[0]->points[0].time;
+  frame.Edges = this->KeyPointsExtractor->GetEdgePoints();
+  frame.Planars = this->KeyPointsExtractor->GetPlanarPoints();
+  frame.Blobs = this->KeyPointsExtractor->GetBlobPoints();
+  frame.FarestKeypointDist = this->KeyPointsExtractor->GetFarestKeypointDist();
+  frame.NLasers = this->KeyPointsExtractor->GetNLasers();
+  if (extractions.empty())
+  {
+    return frame;
+  }
+
+  // Merge the keypoints in the referential of the main sensor, in copies of
+  // the clouds of the main extractor which may still be displayed. The laser
+  // ids of each sensor follow the ones of the previous sensors, so that the
+  // neighbors of a line keypoint are still searched on distinct lasers
+  frame.Edges.reset(new pcl::PointCloud<Point>(*frame.Edges));
+  frame.Planars.reset(new pcl::PointCloud<Point>(*frame.Planars));
+  frame.Blobs.reset(new pcl::PointCloud<Point>(*frame.Blobs));
+  for (size_t i = 1; i < frames.size(); ++i)
+  {
+    if (frames[i]->size() == 0)
+    {
+      continue;
+    }
+    const Sensor& sensor = this->Sensors[i - 1];
+    const int laserIdOffset = frame.NLasers;
+    if (laserIdOffset + sensor.Extractor->GetNLasers() > 256)
+    {
+      std::cerr << "The sensors have more than 256 lasers, the keypoints of the sensor " << i
+                << " are ignored" << std::endl;
+      continue;
+    }
+    auto merge = [&sensor, laserIdOffset](const pcl::PointCloud<Point>& keypoints, pcl::PointCloud<Point>& merged)
+    {
+      merged.reserve(merged.size() + keypoints.size());
+      for (const Point& p : keypoints)
+      {
+        Point q = p;
+        q.getVector3fMap() = (sensor.Rotation * p.getVector3fMap().cast<double>() + sensor.Translation).cast<float>();
+        q.laserId = static_cast<uint8_t>(p.laserId + laserIdOffset);
+        merged.push_back(q);
+      }
+    };
+    merge(*sensor.Extractor->GetEdgePoints(), *frame.Edges);
+    merge(*sensor.Extractor->GetPlanarPoints(), *frame.Planars);
+    merge(*sensor.Extractor->GetBlobPoints(), *frame.Blobs);
+    frame.FarestKeypointDist = std::max(frame.FarestKeypointDist,
+      sensor.Extractor->GetFarestKeypointDist() + sensor.Translation.norm());
+    frame.NLasers += sensor.Extractor->GetNLasers();
+  }
+  return frame;
+}
+
+//-----------------------------------------------------------------------------
+void Slam::ProcessFrame(const ExtractedFrame& frame)
+{
+  SlamTimings::StageTimer timer(*this->Timings, SlamStage::FrameRegistration);
   std::cout << "#########################################################" << std::endl
             << "Processing frame : " << this->NbrFrameProcessed << std:: endl
             << "#########################################################" << std::endl
             << std::endl;
 
-  double time = pc->points[0].time;
+  this->CurrentEdgesPoints = frame.Edges;
+  this->CurrentPlanarsPoints = frame.Planars;
+  this->CurrentBlobsPoints = frame.Blobs;
+  this->CurrentFarestKeypointDist = frame.FarestKeypointDist;
+  this->CurrentNLasers = frame.NLasers;
 
   // If the new frame is the first one we just add the
   // extracted keypoints into the map without running
-  // odometry and mapping steps
-  if (this->NbrFrameProcessed == 0)
+  // odometry and mapping steps, unless the map is
+  // already known
+  if (this->NbrFrameProcessed == 0 && !this->IsLocalizing())
   {
-    // Compute the edges and planars keypoints
-    this->KeyPointsExtractor->ComputeKeyPoints(pc, laserIdMapping);
-    this->CurrentEdgesPoints = this->KeyPointsExtractor->GetEdgePoints();
-    this->CurrentPlanarsPoints = this->KeyPointsExtractor->GetPlanarPoints();
-    this->CurrentBlobsPoints = this->KeyPointsExtractor->GetBlobPoints();
-
     // update map using tworld
     this->UpdateMapsUsingTworld();
+    this->IsKeyframe = true;
+    this->LastKeyframeTworld = this->Tworld;
 
     // Current keypoints become previous ones
     this->PreviousEdgesPoints = this->CurrentEdgesPoints;
     this->PreviousPlanarsPoints = this->CurrentPlanarsPoints;
     this->PreviousBlobsPoints = this->CurrentBlobsPoints;
+    this->BuildPreviousKDTrees();
     this->NbrFrameProcessed++;
     return;
   }
 
-  // Compute the edges and planars keypoints
-  InitTime();
-  this->KeyPointsExtractor->ComputeKeyPoints(pc, laserIdMapping);
-  this->CurrentEdgesPoints = this->KeyPointsExtractor->GetEdgePoints();
-  this->CurrentPlanarsPoints = this->KeyPointsExtractor->GetPlanarPoints();
-  this->CurrentBlobsPoints = this->KeyPointsExtractor->GetBlobPoints();
-  StopTimeAndDisplay("Keypoints extraction");
-
-  // Perfom EgoMotion
-  InitTime();
-  this->ComputeEgoMotion();
-  StopTimeAndDisplay("Ego-Motion");
+  // Perfom EgoMotion, the first frame being only localized
+  if (this->NbrFrameProcessed > 0)
+  {
+    this->ComputeEgoMotion();
+  }
 
   // Transform the current keypoints to the
   // referential of the sensor at the end of
   // frame acquisition
-  InitTime();
   //this->TransformCurrentKeypointsToEnd();
-  StopTimeAndDisplay("Undistortion");
 
-  // Perform Mapping
-  InitTime();
-  this->Mapping();
-  StopTimeAndDisplay("Mapping");
+  // Perform Mapping, unless the frame is not a keyframe and the sensor
+  // is still well localized in the maps. The pose predicted by the
+  // ego-motion is the end pose of the motion model with undistortion
+  const Eigen::Matrix<double, 6, 1> predictedTworld =
+    this->Undistortion ? Eigen::Matrix<double, 6, 1>(this->MotionParametersMapping.tail(6)) : this->Tworld;
+  if (this->KeyframeSkipMapping && this->NbrFrameProcessed > 0 && !this->IsLocalizing() &&
+      !this->HasMovedSinceLastKeyframe(predictedTworld) && this->MappingOverlap >= this->KeyframeMinOverlap)
+  {
+    this->SkipMapping();
+  }
+  else
+  {
+    this->Mapping();
+  }
 
   // Current keypoints become previous ones
   this->PreviousEdgesPoints = this->CurrentEdgesPoints;
   this->PreviousPlanarsPoints = this->CurrentPlanarsPoints;
+  this->BuildPreviousKDTrees();
   this->NbrFrameProcessed++;
 
   // Motion and localization parameters estimation information display
@@ -591,7 +1678,31 @@ void Slam::AddFrame(pcl::PointCloud<Slam::Point>::Ptr pc, std::vector<size_t> la
             << std::endl << std::endl << std::endl;
 
   // Update Trajectory
-  this->Trajectory.emplace_back(Transform(time, this->Tworld));
+  this->Trajectory.emplace_back(Transform(frame.Time, this->Tworld));
+
+  // Search the loops, the pose graph being optimized in the background
+  if (this->LoopClosure)
+  {
+    this->LoopClosures->KeyframeDistance = this->LoopClosureKeyframeDistance;
+    this->LoopClosures->DescriptorDistanceThreshold = this->LoopClosureDescriptorThreshold;
+    this->LoopClosures->MinimumInlierRatio = this->LoopClosureMinimumInlierRatio;
+    this->LoopClosures->NumberOfThreads = this->NumberOfThreads;
+    Eigen::Matrix4d pose = Eigen::Matrix4d::Identity();
+    pose.block(0, 0, 3, 3) = GetRotationMatrix(this->Tworld);
+    pose.block(0, 3, 3, 1) = this->Tworld.tail(3);
+    this->LoopClosures->AddFrame(frame.Time, pose, *frame.Edges, *frame.Planars);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void Slam::SetLoopClosure(bool enable)
+{
+  if (this->LoopClosure != enable)
+  {
+    // the key frames must be consecutive
+    this->LoopClosures->Reset();
+    this->LoopClosure = enable;
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -621,8 +1732,9 @@ void Slam::TransformToWorld(Point& p)
 }
 
 //-----------------------------------------------------------------------------
-int Slam::ComputeLineDistanceParameters(KDTreePCLAdaptor& kdtreePreviousEdges, Eigen::Matrix3d& R,
-                                           Eigen::Vector3d& dT, Point p, MatchingMode matchingMode)
+int Slam::ComputeLineDistanceParameters(KDTreePCLAdaptor& kdtreePreviousEdges, const Eigen::Matrix3d& R,
+                                           const Eigen::Vector3d& dT, Point p, MatchingMode matchingMode,
+                                           MatchingResults& results)
 {
   // number of neighbors edge points required to approximate
   // the corresponding egde line
@@ -692,20 +1804,10 @@ int Slam::ComputeLineDistanceParameters(KDTreePCLAdaptor& kdtreePreviousEdges, E
   // of the requiredNearest nearest edges points extracted
   // Thans to the PCA we will check the shape of the neighborhood
   // and keep it if it is distributed along a line
-  Eigen::MatrixXd data(requiredNearest, 3);
-  for (unsigned int k = 0; k < requiredNearest; k++)
-  {
-    Point pt = kdtreePreviousEdges.getInputCloud()->points[nearestIndex[k]];
-    data.row(k) << pt.x, pt.y, pt.z;
-  }
-
-  Eigen::Vector3d mean = data.colwise().mean();
-  Eigen::MatrixXd centered = data.rowwise() - mean.transpose();
-  Eigen::Matrix3d varianceCovariance = centered.transpose() * centered;
-  Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eig(varianceCovariance);
-
-  // Eigen values
-  Eigen::MatrixXd D = eig.eigenvalues();
+  Eigen::Vector3d mean, D;
+  Eigen::Matrix3d varianceCovariance, U;
+  AnalyseNeighborhood(kdtreePreviousEdges.getInputCloud()->points, nearestIndex, requiredNearest,
+                      this->SinglePrecisionPCA, mean, varianceCovariance, D, U);
 
   // if the first eigen value is significantly higher than
   // the second one, it means the sourrounding points are
@@ -713,7 +1815,7 @@ int Slam::ComputeLineDistanceParameters(KDTreePCLAdaptor& kdtreePreviousEdges, E
   if (D(2) > eigenValuesRatio * D(1))
   {
     // n is the director vector of the line
-    n = eig.eigenvectors().col(2);
+    n = U.col(2);
   }
   else
   {
@@ -756,17 +1858,19 @@ int Slam::ComputeLineDistanceParameters(KDTreePCLAdaptor& kdtreePreviousEdges, E
   double s = fitQualityCoeff;
 
   // store the distance parameters values
-  this->Avalues.emplace_back(A);
-  this->Pvalues.emplace_back(mean);
-  this->Xvalues.emplace_back(P0);
-  this->TimeValues.emplace_back(p.intensity);
-  this->residualCoefficient.emplace_back(s);
+  results.Avalues.emplace_back(A);
+  results.Pvalues.emplace_back(mean);
+  results.Xvalues.emplace_back(P0);
+  results.TimeValues.emplace_back(p.intensity);
+  results.residualCoefficient.emplace_back(s);
   return 6;
 }
 
 //-----------------------------------------------------------------------------
-int Slam::ComputePlaneDistanceParameters(KDTreePCLAdaptor& kdtreePreviousPlanes, Eigen::Matrix3d& R,
-                                            Eigen::Vector3d& dT, Point p, MatchingMode matchingMode)
+int Slam::ComputePlaneDistanceParameters(KDTreePCLAdaptor& kdtreePreviousPlanes, const Eigen::Matrix3d& R,
+                                            const Eigen::Vector3d& dT, Point p, MatchingMode matchingMode,
+                                            MatchingResults& results, const int* neighborsIndices,
+                                            const double* neighborsDistances)
 {
   // number of neighbors edge points required to approximate
   // the corresponding egde line
@@ -817,7 +1921,15 @@ int Slam::ComputePlaneDistanceParameters(KDTreePCLAdaptor& kdtreePreviousPlanes,
 
   std::vector<int> nearestIndex(requiredNearest, -1);
   std::vector<double> nearestDist(requiredNearest, -1.0);
-  kdtreePreviousPlanes.query(p, requiredNearest, nearestIndex.data(), nearestDist.data());
+  if (neighborsIndices)
+  {
+    std::copy(neighborsIndices, neighborsIndices + requiredNearest, nearestIndex.begin());
+    std::copy(neighborsDistances, neighborsDistances + requiredNearest, nearestDist.begin());
+  }
+  else
+  {
+    kdtreePreviousPlanes.query(p, requiredNearest, nearestIndex.data(), nearestDist.data());
+  }
 
   // It means that there is not enought keypoints in the neighbohood
   if (nearestIndex[requiredNearest - 1] == -1)
@@ -836,26 +1948,17 @@ int Slam::ComputePlaneDistanceParameters(KDTreePCLAdaptor& kdtreePreviousPlanes,
   // of the requiredNearest nearest edges points extracted
   // Thanks to the PCA we will check the shape of the neighborhood
   // and keep it if it is distributed along a line
-  Eigen::MatrixXd data(requiredNearest,3);
-  for (unsigned int k = 0; k < requiredNearest; k++)
-  {
-    Point pt = kdtreePreviousPlanes.getInputCloud()->points[nearestIndex[k]];
-    data.row(k) << pt.x, pt.y, pt.z;
-  }
-  Eigen::Vector3d mean = data.colwise().mean();
-  Eigen::MatrixXd centered = data.rowwise() - mean.transpose();
-  Eigen::Matrix3d varianceCovariance = centered.transpose() * centered;
-  Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eig(varianceCovariance);
-
-  // Eigenvalues
-  Eigen::VectorXd D = eig.eigenvalues();
+  Eigen::Vector3d mean, D;
+  Eigen::Matrix3d varianceCovariance, U;
+  AnalyseNeighborhood(kdtreePreviousPlanes.getInputCloud()->points, nearestIndex, requiredNearest,
+                      this->SinglePrecisionPCA, mean, varianceCovariance, D, U);
 
   // if the second eigen value is close to the highest one
   // and bigger than the smallest one it means that the points
   // are distributed among a plane
   if ( (significantlyFactor2 * D(1) > D(2)) && (D(1) > significantlyFactor1 * D(0)) )
   {
-    n = eig.eigenvectors().col(0);
+    n = U.col(0);
   }
   else
   {
@@ -894,21 +1997,23 @@ int Slam::ComputePlaneDistanceParameters(KDTreePCLAdaptor& kdtreePreviousPlanes,
   double s = fitQualityCoeff;
 
   // store the distance parameters values
-  this->Avalues.emplace_back(A);
-  this->Pvalues.emplace_back(mean);
-  this->Xvalues.emplace_back(P0);
-  this->residualCoefficient.emplace_back(s);
-  this->TimeValues.emplace_back(p.intensity);
+  results.Avalues.emplace_back(A);
+  results.Pvalues.emplace_back(mean);
+  results.Xvalues.emplace_back(P0);
+  results.residualCoefficient.emplace_back(s);
+  results.TimeValues.emplace_back(p.intensity);
   return 6;
 }
 
 //-----------------------------------------------------------------------------
-int Slam::ComputeBlobsDistanceParameters(pcl::KdTreeFLANN<Slam::Point>::Ptr kdtreePreviousBlobs, Eigen::Matrix3d& R,
-                                            Eigen::Vector3d& dT, Point p, MatchingMode /*matchingMode*/)
+int Slam::ComputeBlobsDistanceParameters(KDTreePCLAdaptor& kdtreePreviousBlobs, const Eigen::Matrix3d& R,
+                                            const Eigen::Vector3d& dT, Point p, MatchingMode /*matchingMode*/,
+                                            MatchingResults& results, const int* neighborsIndices,
+                                            const double* neighborsDistances)
 {
   // number of neighbors blobs points required to approximate
   // the corresponding ellipsoide
-  unsigned int requiredNearest = 25;
+  unsigned int requiredNearest = BlobNeighborhoodSize;
 
   // maximum distance between keypoints
   // and its neighbor
@@ -925,12 +2030,20 @@ int Slam::ComputeBlobsDistanceParameters(pcl::KdTreeFLANN<Slam::Point>::Ptr kdtr
   P = R * P + dT;
   p.x = P(0); p.y = P(1); p.z = P(2);
 
-  std::vector<int> nearestIndex;
-  std::vector<float> nearestDist;
-  kdtreePreviousBlobs->nearestKSearch(p, requiredNearest, nearestIndex, nearestDist);
+  std::vector<int> nearestIndex(requiredNearest, -1);
+  std::vector<double> nearestDist(requiredNearest, -1.0);
+  if (neighborsIndices)
+  {
+    std::copy(neighborsIndices, neighborsIndices + requiredNearest, nearestIndex.begin());
+    std::copy(neighborsDistances, neighborsDistances + requiredNearest, nearestDist.begin());
+  }
+  else
+  {
+    kdtreePreviousBlobs.query(p, requiredNearest, nearestIndex.data(), nearestDist.data());
+  }
 
   // It means that there is not enought keypoints in the neighbohood
-  if (nearestIndex.size() < requiredNearest)
+  if (nearestIndex[requiredNearest - 1] == -1)
   {
     return 0;
   }
@@ -947,38 +2060,31 @@ int Slam::ComputeBlobsDistanceParameters(pcl::KdTreeFLANN<Slam::Point>::Ptr kdtr
   // to keep this blobs. We must do that since
   // the blobs fitted ellipsoide is assume to
   // encode the local neighborhood shape.
-  float maxDiameter = 0;
+  // The distance is symmetric, each pair is checked once
+  const auto& blobs = kdtreePreviousBlobs.getInputCloud()->points;
   for (unsigned int i = 0; i < requiredNearest; ++i)
   {
-    for (unsigned int j = 0; j < requiredNearest; ++j)
+    const Point& pt1 = blobs[nearestIndex[i]];
+    for (unsigned int j = i + 1; j < requiredNearest; ++j)
     {
-      Point pt1 = kdtreePreviousBlobs->getInputCloud()->points[nearestIndex[i]];
-      Point pt2 = kdtreePreviousBlobs->getInputCloud()->points[nearestIndex[j]];
+      const Point& pt2 = blobs[nearestIndex[j]];
       float neighborhoodDiameter = std::pow(pt1.x - pt2.x, 2) + std::pow(pt1.y - pt2.y, 2) + std::pow(pt1.z - pt2.z, 2);
-      maxDiameter = std::max(maxDiameter, neighborhoodDiameter);
+      if (neighborhoodDiameter > maxDiameterTol)
+      {
+        return 2;
+      }
     }
   }
-  if (maxDiameter > maxDiameterTol)
-  {
-    return 2;
-  }
 
   // Compute PCA to determine best ellipsoide approximation
   // of the requiredNearest nearest blobs points extracted
   // Thanks to the PCA we will check the shape of the neighborhood
   // tune a distance function adapter to the distribution
   // (Mahalanobis distance)
-  Eigen::MatrixXd data(requiredNearest, 3);
-
-  for (unsigned int k = 0; k < requiredNearest; k++)
-  {
-    Point pt = kdtreePreviousBlobs->getInputCloud()->points[nearestIndex[k]];
-    data.row(k) << pt.x, pt.y, pt.z;
-  }
-
-  Eigen::Vector3d mean = data.colwise().mean();
-  Eigen::MatrixXd centered = data.rowwise() - mean.transpose();
-  Eigen::Matrix3d varianceCovariance = centered.transpose() * centered;
+  Eigen::Vector3d mean, D;
+  Eigen::Matrix3d varianceCovariance, U;
+  AnalyseNeighborhood(blobs, nearestIndex, requiredNearest,
+                      this->SinglePrecisionPCA, mean, varianceCovariance, D, U);
 
   // Sigma is the inverse of the covariance
   // Matrix encoding the mahalanobis distance
@@ -987,18 +2093,14 @@ int Slam::ComputeBlobsDistanceParameters(pcl::KdTreeFLANN<Slam::Point>::Ptr kdtr
   {
     return 3;
   }
-  Eigen::Matrix3d sigma = varianceCovariance.inverse();
-  Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eig(sigma);
 
   // rescale the variance covariance matrix to preserve the
   // shape of the mahalanobis distance but removing the
-  // variance values scaling
-  Eigen::MatrixXd D = eig.eigenvalues();
-  Eigen::MatrixXd U = eig.eigenvectors();
-  D = D / D(2);
-  Eigen::Matrix3d diagD = Eigen::Matrix3d::Zero();
-  diagD(0, 0) = D(0); diagD(1, 1) = D(1); diagD(2, 2) = D(2);
-  A = U * diagD * U.transpose();
+  // variance values scaling: sigma has the same eigen vectors
+  // than the covariance and the inverse eigen values, which
+  // are divided by the highest one 1 / D(0)
+  Eigen::Vector3d scaledD(1.0, D(0) / D(1), D(0) / D(2));
+  A = U * scaledD.asDiagonal() * U.transpose();
 
   if (!std::isfinite(A.determinant()))
   {
@@ -1013,13 +2115,57 @@ int Slam::ComputeBlobsDistanceParameters(pcl::KdTreeFLANN<Slam::Point>::Ptr kdtr
   double s = 1.0;//1.0 - nearestDist[requiredNearest - 1] / maxDist;
 
   // store the distance parameters values
-  this->Avalues.emplace_back(A);
-  this->Pvalues.emplace_back(mean);
-  this->Xvalues.emplace_back(P0);
-  this->residualCoefficient.emplace_back(s);
+  results.Avalues.emplace_back(A);
+  results.Pvalues.emplace_back(mean);
+  results.Xvalues.emplace_back(P0);
+  results.residualCoefficient.emplace_back(s);
   return 5;
 }
 
+//-----------------------------------------------------------------------------
+int Slam::ComputePrebuiltDistanceParameters(KDTreePCLAdaptor& kdtreeMap, const PrebuiltMap& map,
+                                            const Eigen::Matrix3d& R, const Eigen::Vector3d& dT, Point p,
+                                            MatchingResults& results)
+{
+  // Transform the point using the current pose estimation
+  Eigen::Vector3d P0(p.x, p.y, p.z);
+  if (this->Undistortion)
+  {
+    this->ExpressPointInOtherReferencial(p);
+  }
+  else
+  {
+    const Eigen::Vector3d P = R * P0 + dT;
+    p.x = P(0); p.y = P(1); p.z = P(2);
+  }
+
+  int nearestIndex = -1;
+  double nearestDist = -1.0;
+  kdtreeMap.query(p, 1, &nearestIndex, &nearestDist);
+  if (nearestIndex == -1)
+  {
+    return 0;
+  }
+  if (nearestDist > this->MaxDistanceForICPMatching)
+  {
+    return 1;
+  }
+
+  // The neighborhood of the nearest point of the map was fitted when the
+  // map was saved, with the same criteria as the neighborhood of a keypoint
+  const KeypointMapFile::Fit& fit = map.GetFit(nearestIndex);
+  if (!fit.Valid)
+  {
+    return fit.Status;
+  }
+  results.Avalues.emplace_back(fit.GetA());
+  results.Pvalues.emplace_back(fit.GetMean());
+  results.Xvalues.emplace_back(P0);
+  results.residualCoefficient.emplace_back(fit.Coefficient);
+  results.TimeValues.emplace_back(p.intensity);
+  return fit.Status;
+}
+
 //-----------------------------------------------------------------------------
 void Slam::GetEgoMotionLineSpecificNeighbor(std::vector<int>& nearestValid, std::vector<float>& nearestValidDist,
                                                unsigned int nearestSearch, KDTreePCLAdaptor& kdtreePreviousEdges, Point p)
@@ -1036,7 +2182,7 @@ void Slam::GetEgoMotionLineSpecificNeighbor(std::vector<int>& nearestValid, std:
   kdtreePreviousEdges.query(p, nearestSearch, nearestIndex.data(), nearestDist.data());
 
   // take the closest point
-  std::vector<int> idAlreadyTook(this->KeyPointsExtractor->GetNLasers(), 0);
+  std::vector<int> idAlreadyTook(this->CurrentNLasers, 0);
   Point closest = kdtreePreviousEdges.getInputCloud()->points[nearestIndex[0]];
   nearestValid.push_back(nearestIndex[0]);
   nearestValidDist.push_back(nearestDist[0]);
@@ -1048,7 +2194,7 @@ void Slam::GetEgoMotionLineSpecificNeighbor(std::vector<int>& nearestValid, std:
 
   // invalid all possible points from scan
   // lines that are too far from the closest one
-  for (int k = 0; k < this->KeyPointsExtractor->GetNLasers(); ++k)
+  for (int k = 0; k < this->CurrentNLasers; ++k)
   {
     if (std::abs(int(closest.laserId) - k) > 4.0)
     {
@@ -1170,9 +2316,14 @@ void Slam::ComputeEgoMotion()
   this->MotionParametersEgoMotion = Eigen::VectorXd::Zero(12, 1);
 
   // kd-tree to process fast nearest neighbor
-  // among the keypoints of the previous pointcloud
-  KDTreePCLAdaptor kdtreePreviousEdges(this->PreviousEdgesPoints);
-  KDTreePCLAdaptor kdtreePreviousPlanes(this->PreviousPlanarsPoints);
+  // among the keypoints of the previous pointcloud,
+  // built when the previous frame has been processed
+  if (!this->PreviousEdgesKDTree.valid() || !this->PreviousPlanarsKDTree.valid())
+  {
+    this->BuildPreviousKDTrees();
+  }
+  KDTreePCLAdaptor& kdtreePreviousEdges = *this->PreviousEdgesKDTree.get();
+  KDTreePCLAdaptor& kdtreePreviousPlanes = *this->PreviousPlanarsKDTree.get();
 
   std::cout << "========== Ego-Motion ==========" << std::endl;
   std::cout << "previous edges: " << this->PreviousEdgesPoints->size() << " current edges: " << this->CurrentEdgesPoints->size() << std::endl;
@@ -1180,7 +2331,6 @@ void Slam::ComputeEgoMotion()
 
   unsigned int usedEdges = 0;
   unsigned int usedPlanes = 0;
-  Point currentPoint;
 
   unsigned int toReserve =   this->CurrentEdgesPoints->size()
                            + this->CurrentPlanarsPoints->size();
@@ -1190,7 +2340,13 @@ void Slam::ComputeEgoMotion()
   this->TimeValues.resize(toReserve);
   this->residualCoefficient.resize(toReserve);
 
-
+  // The optimization problem is kept across the ICP iterations
+  const MatchesData matches = {this->Avalues, this->Pvalues, this->Xvalues,
+                               this->TimeValues, this->residualCoefficient};
+  MatchesProblem problem(this->Undistortion ? this->MotionParametersEgoMotion.data() : this->Trelative.data(),
+                         this->Undistortion, this->AnalyticJacobians, matches);
+  const ceres::Solver::Options options = SolverOptions(this->EgoMotionLMMaxIter, this->SolverNumberOfThreads,
+                                                       this->SolverLinearSolver);
 
   // ICP - Levenberg-Marquardt loop:
   // At each step of this loop an ICP matching is performed
@@ -1203,6 +2359,7 @@ void Slam::ComputeEgoMotion()
     Eigen::Matrix3d R = GetRotationMatrix(this->Trelative);
     Eigen::Vector3d T(this->Trelative(3), this->Trelative(4), this->Trelative(5));
 
+    SlamTimings::StageTimer matchingTimer(*this->Timings, SlamStage::EgoMotionMatching);
     // clear all keypoints matching data
     this->ResetDistanceParameters();
 
@@ -1215,35 +2372,36 @@ void Slam::ComputeEgoMotion()
     // loop over edges if there is engought previous edge keypoints
     if (this->PreviousEdgesPoints->size() > this->EgoMotionLineDistanceNbrNeighbors)
     {
-      for (unsigned int edgeIndex = 0; edgeIndex < this->CurrentEdgesPoints->size(); ++edgeIndex)
+      // Find the closest correspondence edge line of the current edge point
+      // Compute the parameters of the point - line distance
+      // i.e A = (I - n*n.t)^2 with n being the director vector
+      // and P a point of the line
+      this->MatchKeypoints(this->CurrentEdgesPoints, [&](size_t, const Point& currentPoint, MatchingResults& results)
       {
-        // Find the closest correspondence edge line of the current edge point
-        // Compute the parameters of the point - line distance
-        // i.e A = (I - n*n.t)^2 with n being the director vector
-        // and P a point of the line
-        currentPoint = this->CurrentEdgesPoints->points[edgeIndex];
-        int rejectionIndex = this->ComputeLineDistanceParameters(kdtreePreviousEdges, R, T, currentPoint, MatchingMode::EgoMotion);
-        this->EdgePointRejectionEgoMotion[edgeIndex] = rejectionIndex;
-        this->MatchRejectionHistogramLine[rejectionIndex] += 1;
-      }
+        return this->ComputeLineDistanceParameters(kdtreePreviousEdges, R, T, currentPoint, MatchingMode::EgoMotion, results);
+      }, &this->EdgePointRejectionEgoMotion, this->MatchRejectionHistogramLine);
     }
 
     // loop over planars if there is enought previous planar keypoints
     if (this->PreviousPlanarsPoints->size() > this->EgoMotionPlaneDistanceNbrNeighbors)
     {
-      for (unsigned int planarIndex = 0; planarIndex < this->CurrentPlanarsPoints->size(); ++planarIndex)
+      // Find the closest correspondence plane of the current planar point
+      // Compute the parameters of the point - plane distance
+      // i.e A = n * n.t with n being a normal of the plane
+      // and is a point of the plane
+      KeypointsNeighbors neighbors;
+      this->SearchKeypointsNeighbors(this->CurrentPlanarsPoints, kdtreePreviousPlanes, R, T, this->Undistortion,
+                                     this->EgoMotionPlaneDistanceNbrNeighbors, neighbors);
+      this->MatchKeypoints(this->CurrentPlanarsPoints, [&](size_t index, const Point& currentPoint, MatchingResults& results)
       {
-        // Find the closest correspondence plane of the current planar point
-        // Compute the parameters of the point - plane distance
-        // i.e A = n * n.t with n being a normal of the plane
-        // and is a point of the plane
-        currentPoint = this->CurrentPlanarsPoints->points[planarIndex];
-        int rejectionIndex = this->ComputePlaneDistanceParameters(kdtreePreviousPlanes, R, T, currentPoint, MatchingMode::EgoMotion);
-        this->PlanarPointRejectionEgoMotion[planarIndex] = rejectionIndex;
-        this->MatchRejectionHistogramPlane[rejectionIndex] += 1;
-      }
+        return this->ComputePlaneDistanceParameters(kdtreePreviousPlanes, R, T, currentPoint, MatchingMode::EgoMotion, results,
+                                                    &neighbors.Indices[index * neighbors.K],
+                                                    &neighbors.Distances[index * neighbors.K]);
+      }, &this->PlanarPointRejectionEgoMotion, this->MatchRejectionHistogramPlane);
     }
 
+    matchingTimer.Stop();
+
     usedEdges = this->MatchRejectionHistogramLine[6];
     usedPlanes = this->MatchRejectionHistogramPlane[6];
     // Skip this frame if there is too few geometric
@@ -1261,34 +2419,12 @@ void Slam::ComputeEgoMotion()
     // comes from the Euler Angle parametrization of the rotation
     // endomorphism of SO(3). To minimize it, we use CERES to perform
     // the Levenberg-Marquardt algorithm.
-    ceres::Problem problem;
-    for (unsigned int k = 0; k < Xvalues.size(); ++k)
-    {
-      if (this->Undistortion)
-      {
-        ceres::CostFunction* cost_function = new ceres::AutoDiffCostFunction<CostFunctions::MahalanobisDistanceInterpolatedMotionResidual, 1, 12>(
-                                             new CostFunctions::MahalanobisDistanceInterpolatedMotionResidual(
-                                                this->Avalues[k], this->Pvalues[k], this->Xvalues[k],
-                                                this->TimeValues[k], this->residualCoefficient[k]));
-        problem.AddResidualBlock(cost_function, new ceres::ScaledLoss(new ceres::ArctanLoss(lossScale), this->residualCoefficient[k],
-                                                                      ceres::TAKE_OWNERSHIP), this->MotionParametersEgoMotion.data());
-      }
-      else
-      {
-        ceres::CostFunction* cost_function = new ceres::AutoDiffCostFunction<CostFunctions::MahalanobisDistanceAffineIsometryResidual, 1, 6>(
-                                             new CostFunctions::MahalanobisDistanceAffineIsometryResidual(this->Avalues[k], this->Pvalues[k],
-                                                                                                          this->Xvalues[k], this->residualCoefficient[k]));
-        problem.AddResidualBlock(cost_function, new ceres::ScaledLoss(new ceres::ArctanLoss(lossScale), this->residualCoefficient[k], ceres::TAKE_OWNERSHIP), this->Trelative.data());
-      }
-    }
-
-    ceres::Solver::Options options;
-    options.max_num_iterations = this->EgoMotionLMMaxIter;
-    options.linear_solver_type = ceres::DENSE_QR;
-    options.minimizer_progress_to_stdout = false;
+    SlamTimings::StageTimer solveTimer(*this->Timings, SlamStage::EgoMotionSolve);
+    problem.Update(this->Xvalues.size(), lossScale);
 
     ceres::Solver::Summary summary;
-    ceres::Solve(options, &problem, &summary);
+    ceres::Solve(options, &problem.GetProblem(), &summary);
+    solveTimer.Stop();
     std::cout << summary.BriefReport() << std::endl;
 
     // If no L-M iteration has been made since the
@@ -1320,6 +2456,9 @@ void Slam::Mapping()
     this->MappingEdgesPointsUsed = 0;
     this->MappingPlanesPointsUsed = 0;
     this->MappingBlobsPointsUsed = 0;
+    this->MappingOverlap = 0;
+    this->IsKeyframe = true;
+    this->LastKeyframeTworld = this->Tworld;
     // update maps
     this->UpdateMapsUsingTworld();
     std::cout << "Not enought keypoints, Mapping skipped for this frame" << std::endl;
@@ -1329,7 +2468,7 @@ void Slam::Mapping()
     this->PlanarPointRejectionMapping.clear(); this->PlanarPointRejectionMapping.resize(this->CurrentPlanarsPoints->size());
 
   // Set the FarestPoint to reduce the map to the minimum size
-  this->SetLidarMaximunRange(this->KeyPointsExtractor->GetFarestKeypointDist());
+  this->SetLidarMaximunRange(this->CurrentFarestKeypointDist);
 
   // Update motion model parameters
   if (this->Undistortion)
@@ -1339,25 +2478,59 @@ void Slam::Mapping()
               this->MotionParametersMapping.data() + 6);
   }
 
-  // get keypoints from the map
-  pcl::PointCloud<Slam::Point>::Ptr subEdgesPointsLocalMap = this->EdgesPointsLocalMap->Get(this->Tworld);
-  pcl::PointCloud<Slam::Point>::Ptr subPlanarPointsLocalMap = this->PlanarPointsLocalMap->Get(this->Tworld);
+  // get the fast closest points search structures on the
+  // keypoints from the map
+  SlamTimings::StageTimer kdtreeTimer(*this->Timings, SlamStage::KDTreeBuild);
+  std::shared_ptr<KDTreePCLAdaptor> kdtreeEdges = this->EdgesPointsLocalMap->GetSearchIndex(this->Tworld);
+  std::shared_ptr<KDTreePCLAdaptor> kdtreePlanes = this->PlanarPointsLocalMap->GetSearchIndex(this->Tworld);
+  std::shared_ptr<KDTreePCLAdaptor> kdtreeBlobs;
+  if (!this->FastSlam)
+  {
+    kdtreeBlobs = this->BlobsPointsLocalMap->GetSearchIndex(this->Tworld);
+  }
+
+  // Coarse level of the maps and of the keypoints, matched
+  // by the first ICP iterations
+  // The fits of the localization maps are only known at full resolution
+  const unsigned int coarseICPIter = this->IsLocalizing() ? 0 :
+                                     std::min(this->MappingCoarseICPIter, std::max(this->MappingICPMaxIter, 1u) - 1);
+  std::shared_ptr<KDTreePCLAdaptor> coarseKdtreeEdges, coarseKdtreePlanes, coarseKdtreeBlobs;
+  pcl::PointCloud<Point>::Ptr coarseEdges, coarsePlanars, coarseBlobs;
+  if (coarseICPIter > 0)
+  {
+    auto downsample = [this](pcl::PointCloud<Point>::Ptr keypoints)
+    {
+      pcl::PointCloud<Point>::Ptr coarse(new pcl::PointCloud<Point>());
+      pcl::VoxelGrid<Point> downSizeFilter;
+      downSizeFilter.setLeafSize(this->MappingCoarseLeafSize, this->MappingCoarseLeafSize, this->MappingCoarseLeafSize);
+      downSizeFilter.setInputCloud(keypoints);
+      downSizeFilter.filter(*coarse);
+      return coarse;
+    };
+    coarseKdtreeEdges = this->EdgesPointsLocalMap->GetCoarseSearchIndex(this->Tworld, this->MappingCoarseLeafSize);
+    coarseKdtreePlanes = this->PlanarPointsLocalMap->GetCoarseSearchIndex(this->Tworld, this->MappingCoarseLeafSize);
+    coarseEdges = downsample(this->CurrentEdgesPoints);
+    coarsePlanars = downsample(this->CurrentPlanarsPoints);
+    if (!this->FastSlam)
+    {
+      coarseKdtreeBlobs = this->BlobsPointsLocalMap->GetCoarseSearchIndex(this->Tworld, this->MappingCoarseLeafSize);
+      coarseBlobs = downsample(this->CurrentBlobsPoints);
+    }
+  }
+  kdtreeTimer.Stop();
 
-  // contruct kd-tree for fast closest points search
-  KDTreePCLAdaptor kdtreeEdges(subEdgesPointsLocalMap);
-  KDTreePCLAdaptor kdtreePlanes(subPlanarPointsLocalMap);
-  pcl::KdTreeFLANN<Slam::Point>::Ptr kdtreeBlobs;
+  // When localizing, the keypoints are matched with the fits stored in the maps
+  std::shared_ptr<PrebuiltMap> prebuiltEdges = std::dynamic_pointer_cast<PrebuiltMap>(this->EdgesPointsLocalMap);
+  std::shared_ptr<PrebuiltMap> prebuiltPlanars = std::dynamic_pointer_cast<PrebuiltMap>(this->PlanarPointsLocalMap);
+  std::shared_ptr<PrebuiltMap> prebuiltBlobs = std::dynamic_pointer_cast<PrebuiltMap>(this->BlobsPointsLocalMap);
 
   std::cout << "========== Mapping ==========" << std::endl;
-  std::cout << "Edges extracted from map: " << subEdgesPointsLocalMap->points.size()
-            << "Planes extracted from map: " << subPlanarPointsLocalMap->points.size() << std::endl;
+  std::cout << "Edges extracted from map: " << kdtreeEdges->GetNumberOfPoints()
+            << "Planes extracted from map: " << kdtreePlanes->GetNumberOfPoints() << std::endl;
 
   if (!this->FastSlam)
   {
-    pcl::PointCloud<Slam::Point>::Ptr subBlobPointsLocalMap = this->BlobsPointsLocalMap->Get(this->Tworld);
-    kdtreeBlobs.reset(new pcl::KdTreeFLANN<Slam::Point>());
-    kdtreeBlobs->setInputCloud(subBlobPointsLocalMap);
-    std::cout << "blobs map: " << subBlobPointsLocalMap->points.size() << std::endl;
+    std::cout << "blobs map: " << kdtreeBlobs->GetNumberOfPoints() << std::endl;
   }
 
   // Information about matches
@@ -1365,8 +2538,6 @@ void Slam::Mapping()
   unsigned int usedPlanes = 0;
   unsigned int usedBlobs = 0;
 
-  Point currentPoint;
-
   unsigned int toReserve =   this->CurrentEdgesPoints->size()
                            + this->CurrentPlanarsPoints->size()
                            + this->CurrentBlobsPoints->size();
@@ -1376,6 +2547,14 @@ void Slam::Mapping()
   this->TimeValues.resize(toReserve);
   this->residualCoefficient.resize(toReserve);
 
+  // The optimization problem is kept across the ICP iterations
+  const MatchesData matches = {this->Avalues, this->Pvalues, this->Xvalues,
+                               this->TimeValues, this->residualCoefficient};
+  MatchesProblem problem(this->Undistortion ? this->MotionParametersMapping.data() : this->Tworld.data(),
+                         this->Undistortion, this->AnalyticJacobians, matches);
+  const ceres::Solver::Options options = SolverOptions(this->MappingLMMaxIter, this->SolverNumberOfThreads,
+                                                       this->SolverLinearSolver);
+
   // ICP - Levenberg-Marquardt loop:
   // At each step of this loop an ICP matching is performed
   // Once the keypoints matched, we estimate the the 6-DOF
@@ -1383,6 +2562,7 @@ void Slam::Mapping()
   // function using a Levenberg-Marquardt algorithm
   for (unsigned int icpCount = 0; icpCount < this->MappingICPMaxIter; ++icpCount)
   {
+    SlamTimings::StageTimer matchingTimer(*this->Timings, SlamStage::MappingMatching);
     // clear all keypoints matching data
     this->ResetDistanceParameters();
 
@@ -1396,48 +2576,84 @@ void Slam::Mapping()
     Eigen::Matrix3d R = GetRotationMatrix(this->Tworld);
     Eigen::Vector3d T(this->Tworld(3), this->Tworld(4), this->Tworld(5));
 
+    // Keypoints and maps matched at this step, the rejection
+    // causes being only reported at full resolution
+    const bool isCoarse = icpCount < coarseICPIter;
+    pcl::PointCloud<Point>::Ptr edges = isCoarse ? coarseEdges : this->CurrentEdgesPoints;
+    pcl::PointCloud<Point>::Ptr planars = isCoarse ? coarsePlanars : this->CurrentPlanarsPoints;
+    pcl::PointCloud<Point>::Ptr blobs = isCoarse ? coarseBlobs : this->CurrentBlobsPoints;
+    KDTreePCLAdaptor& edgesMap = isCoarse ? *coarseKdtreeEdges : *kdtreeEdges;
+    KDTreePCLAdaptor& planarsMap = isCoarse ? *coarseKdtreePlanes : *kdtreePlanes;
+
     // loop over edges
-    if (this->CurrentEdgesPoints->size() > 0 && subEdgesPointsLocalMap->points.size() > 10)
+    if (edges->size() > 0 && edgesMap.GetNumberOfPoints() > 10)
     {
-      for (unsigned int edgeIndex = 0; edgeIndex < this->CurrentEdgesPoints->size(); ++edgeIndex)
+      // Find the closest correspondence edge line of the current edge point
+      this->MatchKeypoints(edges, [&](size_t, const Point& currentPoint, MatchingResults& results)
       {
-        // Find the closest correspondence edge line of the current edge point
-        currentPoint = this->CurrentEdgesPoints->points[edgeIndex];
-        int rejectionIndex = this->ComputeLineDistanceParameters(kdtreeEdges, R, T, currentPoint, MatchingMode::Mapping);
-        this->EdgePointRejectionMapping[edgeIndex] = rejectionIndex;
-        this->MatchRejectionHistogramLine[rejectionIndex] += 1;
-        usedEdges = this->Xvalues.size();
-      }
+        if (prebuiltEdges)
+        {
+          return this->ComputePrebuiltDistanceParameters(edgesMap, *prebuiltEdges, R, T, currentPoint, results);
+        }
+        return this->ComputeLineDistanceParameters(edgesMap, R, T, currentPoint, MatchingMode::Mapping, results);
+      }, isCoarse ? nullptr : &this->EdgePointRejectionMapping, this->MatchRejectionHistogramLine);
+      usedEdges = this->Xvalues.size();
     }
     // loop over surfaces
-    if (this->CurrentPlanarsPoints->size() > 0 && subPlanarPointsLocalMap->size() > 10)
+    if (planars->size() > 0 && planarsMap.GetNumberOfPoints() > 10)
     {
-      for (unsigned int planarIndex = 0; planarIndex < this->CurrentPlanarsPoints->size(); ++planarIndex)
+      // Find the closest correspondence plane of the current planar point
+      KeypointsNeighbors neighbors;
+      if (!prebuiltPlanars)
       {
-        // Find the closest correspondence plane of the current planar point
-        currentPoint = this->CurrentPlanarsPoints->points[planarIndex];
-        int rejectionIndex = this->ComputePlaneDistanceParameters(kdtreePlanes, R, T, currentPoint, MatchingMode::Mapping);
-        this->PlanarPointRejectionMapping[planarIndex] = rejectionIndex;
-        this->MatchRejectionHistogramPlane[rejectionIndex] += 1;
-        usedPlanes = this->Xvalues.size() - usedEdges;
+        this->SearchKeypointsNeighbors(planars, planarsMap, R, T, this->Undistortion,
+                                       this->MappingPlaneDistanceNbrNeighbors, neighbors);
       }
+      this->MatchKeypoints(planars, [&](size_t index, const Point& currentPoint, MatchingResults& results)
+      {
+        if (prebuiltPlanars)
+        {
+          return this->ComputePrebuiltDistanceParameters(planarsMap, *prebuiltPlanars, R, T, currentPoint, results);
+        }
+        return this->ComputePlaneDistanceParameters(planarsMap, R, T, currentPoint, MatchingMode::Mapping, results,
+                                                    &neighbors.Indices[index * neighbors.K],
+                                                    &neighbors.Distances[index * neighbors.K]);
+      }, isCoarse ? nullptr : &this->PlanarPointRejectionMapping, this->MatchRejectionHistogramPlane);
+      usedPlanes = this->Xvalues.size() - usedEdges;
     }
 
-    if (!this->FastSlam && this->NbrFrameProcessed > 10)
+    if (!this->FastSlam && (this->NbrFrameProcessed > 10 || prebuiltBlobs))
     {
-      // loop over blobs
-      for (unsigned int blobIndex = 0; blobIndex < this->CurrentBlobsPoints->size(); ++blobIndex)
+      KDTreePCLAdaptor& blobsMap = isCoarse ? *coarseKdtreeBlobs : *kdtreeBlobs;
+      // Find the closest correspondence blob of the current blob point
+      // the blobs are not undistorted
+      KeypointsNeighbors neighbors;
+      if (!prebuiltBlobs)
       {
-        // Find the closest correspondence plane of the current planar point
-        currentPoint = this->CurrentBlobsPoints->points[blobIndex];
-        this->ComputeBlobsDistanceParameters(kdtreeBlobs, R, T, currentPoint, MatchingMode::Mapping);
-        usedBlobs = this->Xvalues.size() - usedPlanes - usedEdges;
+        this->SearchKeypointsNeighbors(blobs, blobsMap, R, T, false, BlobNeighborhoodSize, neighbors);
       }
+      this->MatchKeypoints(blobs, [&](size_t index, const Point& currentPoint, MatchingResults& results)
+      {
+        if (prebuiltBlobs)
+        {
+          return this->ComputePrebuiltDistanceParameters(blobsMap, *prebuiltBlobs, R, T, currentPoint, results);
+        }
+        return this->ComputeBlobsDistanceParameters(blobsMap, R, T, currentPoint, MatchingMode::Mapping, results,
+                                                    &neighbors.Indices[index * neighbors.K],
+                                                    &neighbors.Distances[index * neighbors.K]);
+      }, nullptr, this->MatchRejectionHistogramBlob);
+      usedBlobs = this->Xvalues.size() - usedPlanes - usedEdges;
     }
+    matchingTimer.Stop();
 
-    // Skip this frame if there is too few geometric keypoints matched
+    // Skip this frame if there is too few geometric keypoints matched,
+    // or go on at full resolution if the coarse level is too sparse
     if ((usedPlanes + usedEdges + usedBlobs) < 20)
     {
+      if (isCoarse)
+      {
+        continue;
+      }
       std::cout << "Too few geometric features, loop breaked" << std::endl;
       std::cout << "planes: " << usedPlanes << " edges: " << usedEdges << " Blobs: " << usedBlobs << std::endl;
       break;
@@ -1450,34 +2666,12 @@ void Slam::Mapping()
     // comes from the Euler Angle parametrization of the rotation
     // endomorphism SO(3). To minimize it we use CERES to perform
     // the Levenberg-Marquardt algorithm.
-    ceres::Problem problem;
-    for (unsigned int k = 0; k < Xvalues.size(); ++k)
-    {
-      if (this->Undistortion)
-      {
-        ceres::CostFunction* cost_function = new ceres::AutoDiffCostFunction<CostFunctions::MahalanobisDistanceInterpolatedMotionResidual, 1, 12>(
-                                                     new CostFunctions::MahalanobisDistanceInterpolatedMotionResidual(
-                                                     this->Avalues[k], this->Pvalues[k], this->Xvalues[k],
-                                                     this->TimeValues[k], this->residualCoefficient[k]));
-        problem.AddResidualBlock(cost_function, new ceres::ScaledLoss(new ceres::ArctanLoss(lossScale), this->residualCoefficient[k],
-                                                                      ceres::TAKE_OWNERSHIP), this->MotionParametersMapping.data());
-      }
-      else
-      {
-        ceres::CostFunction* cost_function = new ceres::AutoDiffCostFunction<CostFunctions::MahalanobisDistanceAffineIsometryResidual, 1, 6>(
-                                             new CostFunctions::MahalanobisDistanceAffineIsometryResidual(this->Avalues[k], this->Pvalues[k],
-                                                                                                          this->Xvalues[k], this->residualCoefficient[k]));
-        problem.AddResidualBlock(cost_function, new ceres::ScaledLoss(new ceres::ArctanLoss(lossScale), this->residualCoefficient[k], ceres::TAKE_OWNERSHIP), this->Tworld.data());
-      }
-    }
-
-    ceres::Solver::Options options;
-    options.max_num_iterations = this->MappingLMMaxIter;
-    options.linear_solver_type = ceres::DENSE_QR;
-    options.minimizer_progress_to_stdout = false;
+    SlamTimings::StageTimer solveTimer(*this->Timings, SlamStage::MappingSolve);
+    problem.Update(this->Xvalues.size(), lossScale);
 
     ceres::Solver::Summary summary;
-    ceres::Solve(options, &problem, &summary);
+    ceres::Solve(options, &problem.GetProblem(), &summary);
+    solveTimer.Stop();
     std::cout << summary.BriefReport() << std::endl;
 
     // If no L-M iteration has been made since the
@@ -1485,7 +2679,7 @@ void Slam::Mapping()
     // minimum for the ICP-LM algorithm
     if (((summary.num_successful_steps == 1) ||
         (icpCount == (this->MappingICPMaxIter - 1))) &&
-        !this->Undistortion)
+        !this->Undistortion && !isCoarse)
     {
       // Now evaluate the quality of the parameters
       // estimated using an approximate computation
@@ -1499,7 +2693,7 @@ void Slam::Mapping()
       ceres::Covariance covariance(covOptions);
       std::vector<std::pair<const double*, const double* > > covariance_blocks;
       covariance_blocks.push_back(std::make_pair(this->Tworld.data(), this->Tworld.data()));
-      covariance.Compute(covariance_blocks, &problem);
+      covariance.Compute(covariance_blocks, &problem.GetProblem());
       double covarianceMat[6 * 6];
       covariance.GetCovarianceBlock(this->Tworld.data(), this->Tworld.data(), covarianceMat);
       for (int i = 0; i < 6; ++i)
@@ -1516,6 +2710,8 @@ void Slam::Mapping()
   this->MappingEdgesPointsUsed = usedEdges;
   this->MappingPlanesPointsUsed = usedPlanes;
   this->MappingBlobsPointsUsed = usedBlobs;
+  const size_t nbrKeypoints = this->CurrentEdgesPoints->size() + this->CurrentPlanarsPoints->size();
+  this->MappingOverlap = nbrKeypoints > 0 ? static_cast<double>(usedEdges + usedPlanes) / nbrKeypoints : 0;
 
   std::cout << "Matches used: Total: " << this->Xvalues.size()
             << " edges: " << usedEdges << " planes: " << usedPlanes << " blobs: " << usedBlobs << std::endl;
@@ -1535,8 +2731,13 @@ void Slam::Mapping()
   // Add the current computed transform to the list
   this->TworldList.push_back(this->Tworld);
 
-  // Update maps
-  this->UpdateMapsUsingTworld();
+  // Update maps with the keyframes only
+  this->IsKeyframe = this->HasMovedSinceLastKeyframe(this->Tworld) || this->MappingOverlap < this->KeyframeMinOverlap;
+  if (this->IsKeyframe)
+  {
+    this->LastKeyframeTworld = this->Tworld;
+    this->UpdateMapsUsingTworld();
+  }
 
   // Transform the current keypoints
   // in the sensor reference frame
@@ -1554,6 +2755,38 @@ void Slam::Mapping()
   this->PreviousTworld = this->Tworld;
 }
 
+//-----------------------------------------------------------------------------
+bool Slam::HasMovedSinceLastKeyframe(const Eigen::Matrix<double, 6, 1>& pose) const
+{
+  const double distance = (pose.tail(3) - this->LastKeyframeTworld.tail(3)).norm();
+  const Eigen::AngleAxisd rotation(GetRotationMatrix(this->LastKeyframeTworld).transpose() * GetRotationMatrix(pose));
+  return distance >= this->KeyframeDistance || Rad2Deg(std::abs(rotation.angle())) >= this->KeyframeAngle;
+}
+
+//-----------------------------------------------------------------------------
+void Slam::SkipMapping()
+{
+  std::cout << "Not a keyframe, Mapping skipped for this frame" << std::endl;
+  this->IsKeyframe = false;
+  this->MappingEdgesPointsUsed = 0;
+  this->MappingPlanesPointsUsed = 0;
+  this->MappingBlobsPointsUsed = 0;
+
+  // Same end of the mapping than if it had not moved the pose predicted
+  // by the ego-motion, without updating the maps
+  if (this->Undistortion)
+  {
+    this->Tworld = this->MotionParametersMapping.tail(6);
+  }
+  this->TworldList.push_back(this->Tworld);
+  this->CreateWithinFrameTrajectory(this->WithinFrameTrajectory, WithinFrameTrajMode::MappingTraj);
+  if (this->Undistortion)
+  {
+    this->UpdateCurrentKeypointsUsingTworld();
+  }
+  this->PreviousTworld = this->Tworld;
+}
+
 //-----------------------------------------------------------------------------
 void Slam::UpdateCurrentKeypointsUsingTworld()
 {
@@ -1568,6 +2801,14 @@ void Slam::UpdateCurrentKeypointsUsingTworld()
 //-----------------------------------------------------------------------------
 void Slam::UpdateMapsUsingTworld()
 {
+  this->WaitForMapsUpdate();
+
+  // The maps of the localization are never updated
+  if (this->IsLocalizing())
+  {
+    return;
+  }
+
   // Init the mapping interpolator
   if (this->Undistortion)
   {
@@ -1575,15 +2816,27 @@ void Slam::UpdateMapsUsingTworld()
   }
 
   // it would nice to add the point frome the frame directly to the map
-  auto updateMap = [this] (std::shared_ptr<RollingGrid> map, pcl::PointCloud<Slam::Point>::Ptr frame) {
+  // The keypoints are expressed in the world referential right away, since
+  // the current keypoints and the pose are modified once the mapping ends.
+  // The insertion in the map and its downsampling run in the background
+  // until the map is needed by the mapping of the next frame.
+  auto updateMap = [this] (std::shared_ptr<LocalMap> map, pcl::PointCloud<Slam::Point>::Ptr frame) {
     pcl::PointCloud<Slam::Point>::Ptr temporaryMap(new pcl::PointCloud<Slam::Point>());
     for (size_t i = 0; i < frame->size(); ++i)
     {
       temporaryMap->push_back(frame->at(i));
       this->TransformToWorld(temporaryMap->at(i));
     }
-    map->Roll(this->Tworld);
-    map->Add(temporaryMap);
+    Eigen::Matrix<double, 6, 1> tworld = this->Tworld;
+    std::shared_ptr<SlamTimings> timings = this->Timings;
+    this->MapsUpdates.push_back(std::async(std::launch::async, [map, temporaryMap, tworld, timings]() mutable
+    {
+      SlamTimings::StageTimer rollTimer(*timings, SlamStage::MapRoll);
+      map->Roll(tworld);
+      rollTimer.Stop();
+      SlamTimings::StageTimer updateTimer(*timings, SlamStage::MapUpdate);
+      map->Add(temporaryMap);
+    }).share());
   };
 
   updateMap(this->EdgesPointsLocalMap, this->CurrentEdgesPoints);
@@ -1638,13 +2891,17 @@ void Slam::CreateWithinFrameTrajectory(SampledSensorPath& path, WithinFrameTrajM
   this->WithinFrameTrajectory.Samples[1].R = R1;
   this->WithinFrameTrajectory.Samples[1].T = T1;
   this->WithinFrameTrajectory.Samples[1].time = 1.0;
+
+  // The transforms of the points are then looked up
+  // rather than interpolated for each point
+  this->WithinFrameTrajectory.PrecomputeBins(this->UndistortionNumberOfBins);
 }
 
 //-----------------------------------------------------------------------------
 void Slam::ExpressPointInOtherReferencial(Point& p)
 {
-  // interpolate the transform
-  AffineIsometry iso = this->WithinFrameTrajectory(p.intensity);
+  // get the transform of the time of the point
+  AffineIsometry iso = this->WithinFrameTrajectory.GetBinnedTransform(p.intensity);
   Eigen::Vector3d X(p.x, p.y, p.z);
   Eigen::Vector3d Y = iso.R * X + iso.T;
   p.x = Y(0); p.y = Y(1); p.z = Y(2);
@@ -1659,6 +2916,35 @@ void Slam::ExpressPointCloudInOtherReferencial(pcl::PointCloud<Point>::Ptr point
   }
 }
 
+//-----------------------------------------------------------------------------
+void Slam::WaitForMapsUpdate()
+{
+  for (auto& update : this->MapsUpdates)
+  {
+    update.get();
+  }
+  this->MapsUpdates.clear();
+}
+
+//-----------------------------------------------------------------------------
+void Slam::BuildPreviousKDTrees()
+{
+  // The previous keypoints are never modified, a new cloud is
+  // allocated for the keypoints of each frame
+  const std::launch policy = this->BackgroundKDTreeBuild ? std::launch::async : std::launch::deferred;
+  std::shared_ptr<SlamTimings> timings = this->Timings;
+  auto build = [policy, timings](pcl::PointCloud<Point>::Ptr cloud)
+  {
+    return std::async(policy, [cloud, timings]()
+    {
+      SlamTimings::StageTimer timer(*timings, SlamStage::KDTreeBuild);
+      return std::make_shared<KDTreePCLAdaptor>(cloud);
+    }).share();
+  };
+  this->PreviousEdgesKDTree = build(this->PreviousEdgesPoints);
+  this->PreviousPlanarsKDTree = build(this->PreviousPlanarsPoints);
+}
+
 //-----------------------------------------------------------------------------
 void Slam::ResetDistanceParameters()
 {
@@ -1675,6 +2961,78 @@ void Slam::ResetDistanceParameters()
   this->MatchRejectionHistogramBlob.resize(this->NrejectionCauses, 0);
 }
 
+//-----------------------------------------------------------------------------
+void Slam::SearchKeypointsNeighbors(pcl::PointCloud<Point>::Ptr keypoints, KDTreePCLAdaptor& kdtree,
+                                    const Eigen::Matrix3d& R, const Eigen::Vector3d& dT, bool undistort,
+                                    int knearest, KeypointsNeighbors& neighbors)
+{
+  // Same transform as the one applied when matching each keypoint
+  std::vector<Point> queries(keypoints->points.begin(), keypoints->points.end());
+  for (Point& p : queries)
+  {
+    if (undistort)
+    {
+      this->ExpressPointInOtherReferencial(p);
+    }
+    else
+    {
+      const Eigen::Vector3d P = R * Eigen::Vector3d(p.x, p.y, p.z) + dT;
+      p.x = P(0); p.y = P(1); p.z = P(2);
+    }
+  }
+
+  unsigned int numberOfThreads = this->NumberOfThreads;
+  if (numberOfThreads == 0)
+  {
+    numberOfThreads = std::max(1u, boost::thread::hardware_concurrency());
+  }
+  neighbors.K = knearest;
+  kdtree.batchQuery(queries, knearest, neighbors.Indices, neighbors.Distances, numberOfThreads);
+}
+
+//-----------------------------------------------------------------------------
+void Slam::MatchKeypoints(pcl::PointCloud<Point>::Ptr keypoints, const KeypointMatcher& match,
+                          std::vector<int>* rejection, std::vector<double>& histogram)
+{
+  // Chunks smaller than this are not worth to be matched by another thread
+  const size_t chunkSize = 64;
+
+  // The kd-trees, the within frame trajectory and the parameters are only read
+  // while matching. Each chunk has its own results, so that they are gathered
+  // in the order of the keypoints whatever the thread which matched them
+  const size_t numberOfKeypoints = keypoints->size();
+  std::vector<MatchingResults> chunks((numberOfKeypoints + chunkSize - 1) / chunkSize);
+  Parallel::ForEachChunk(numberOfKeypoints, chunkSize, this->NumberOfThreads,
+                         [&](unsigned int, size_t begin, size_t end)
+  {
+    MatchingResults& results = chunks[begin / chunkSize];
+    results.RejectionHistogram.resize(this->NrejectionCauses, 0);
+    for (size_t k = begin; k < end; ++k)
+    {
+      int rejectionIndex = match(k, keypoints->points[k], results);
+      if (rejection)
+      {
+        (*rejection)[k] = rejectionIndex;
+      }
+      results.RejectionHistogram[rejectionIndex] += 1;
+    }
+  });
+
+  for (const MatchingResults& results : chunks)
+  {
+    this->Avalues.insert(this->Avalues.end(), results.Avalues.begin(), results.Avalues.end());
+    this->Pvalues.insert(this->Pvalues.end(), results.Pvalues.begin(), results.Pvalues.end());
+    this->Xvalues.insert(this->Xvalues.end(), results.Xvalues.begin(), results.Xvalues.end());
+    this->residualCoefficient.insert(this->residualCoefficient.end(),
+                                     results.residualCoefficient.begin(), results.residualCoefficient.end());
+    this->TimeValues.insert(this->TimeValues.end(), results.TimeValues.begin(), results.TimeValues.end());
+    for (int k = 0; k < this->NrejectionCauses; ++k)
+    {
+      histogram[k] += results.RejectionHistogram[k];
+    }
+  }
+}
+
 //-----------------------------------------------------------------------------
 void Slam::UpdateTworldUsingTrelative()
 {
@@ -1759,32 +3117,204 @@ void Slam::UpdateTworldUsingTrelative()
 //-----------------------------------------------------------------------------
 void Slam::SetVoxelGridLeafSizeEdges(double size)
 {
+  this->WaitForMapsUpdate();
   this->EdgesPointsLocalMap->SetLeafSize(size);
 }
 
 //-----------------------------------------------------------------------------
 void Slam::SetVoxelGridLeafSizePlanes(double size)
 {
+  this->WaitForMapsUpdate();
   this->PlanarPointsLocalMap->SetLeafSize(size);
 }
 
 //-----------------------------------------------------------------------------
 void Slam::SetVoxelGridLeafSizeBlobs(double size)
 {
+  this->WaitForMapsUpdate();
   this->BlobsPointsLocalMap->SetLeafSize(size);
 }
 
 //-----------------------------------------------------------------------------
 void Slam::SetVoxelGridSize(unsigned int size)
 {
+  this->WaitForMapsUpdate();
   this->EdgesPointsLocalMap->SetSize(size);
   this->PlanarPointsLocalMap->SetSize(size);
   this->BlobsPointsLocalMap->SetSize(size);
 }
 
+//-----------------------------------------------------------------------------
+void Slam::SetMapBackend(int backend)
+{
+  if (backend == this->MapBackend)
+  {
+    return;
+  }
+  this->WaitForMapsUpdate();
+  this->MapBackend = backend;
+
+  // The maps of the localization are replaced when it ends
+  if (this->IsLocalizing())
+  {
+    return;
+  }
+
+  // Move the keypoints and the parameters of the maps to the new ones
+  auto replaceMap = [this, backend] (std::shared_ptr<LocalMap>& map) {
+    std::shared_ptr<LocalMap> newMap = NewLocalMap(backend);
+    newMap->CopyParameters(*map);
+    newMap->Roll(this->Tworld);
+    pcl::PointCloud<Slam::Point>::Ptr points = map->Get();
+    if (points->size() > 0)
+    {
+      newMap->Add(points);
+    }
+    map = newMap;
+  };
+  replaceMap(this->EdgesPointsLocalMap);
+  replaceMap(this->PlanarPointsLocalMap);
+  replaceMap(this->BlobsPointsLocalMap);
+}
+
+//-----------------------------------------------------------------------------
+void Slam::SetMapTilesDirectory(const std::string& directory)
+{
+  if (directory == this->MapTilesDirectory)
+  {
+    return;
+  }
+  this->WaitForMapsUpdate();
+  this->MapTilesDirectory = directory;
+  this->ResetMapTileStores();
+}
+
+//-----------------------------------------------------------------------------
+void Slam::ResetMapTileStores()
+{
+  // one sub directory per map, the tiles of the different
+  // maps may then be written by their updates at the same time
+  auto newStore = [this](const std::string& name) -> std::shared_ptr<MapTileStore>
+  {
+    if (this->MapTilesDirectory.empty())
+    {
+      return nullptr;
+    }
+    return std::make_shared<MapTileStore>(this->MapTilesDirectory + "/" + name);
+  };
+  this->EdgesPointsLocalMap->SetTileStore(newStore("edges"));
+  this->PlanarPointsLocalMap->SetTileStore(newStore("planars"));
+  this->BlobsPointsLocalMap->SetTileStore(newStore("blobs"));
+}
+
+//-----------------------------------------------------------------------------
+void Slam::SetLocalizationMapFile(const std::string& filename)
+{
+  if (filename == this->LocalizationMapFile)
+  {
+    return;
+  }
+  this->WaitForMapsUpdate();
+  this->LocalizationMapFile = filename;
+  this->LocalizationMap.reset();
+  if (!filename.empty())
+  {
+    std::shared_ptr<KeypointMapFile> file = std::make_shared<KeypointMapFile>();
+    if (file->Open(filename))
+    {
+      this->LocalizationMap = file;
+    }
+  }
+  this->Reset();
+}
+
+//-----------------------------------------------------------------------------
+bool Slam::SaveMaps(const std::string& filename)
+{
+  this->WaitForMapsUpdate();
+
+  // The points of each map are matched with the map itself, as keypoints
+  // already in the world referential, with the parameters of the mapping
+  const bool undistortion = this->Undistortion;
+  this->Undistortion = false;
+  const Eigen::Matrix3d R = Eigen::Matrix3d::Identity();
+  const Eigen::Vector3d T = Eigen::Vector3d::Zero();
+  auto fitLayer = [&](std::shared_ptr<LocalMap> map, int successCode, KeypointMapFile::LayerData& layer,
+                      const std::function<int(KDTreePCLAdaptor&, const Point&, MatchingResults&)>& match)
+  {
+    layer.Points = map->GetComplete();
+    layer.Fits.assign(layer.Points->size(), KeypointMapFile::Fit());
+    if (layer.Points->empty())
+    {
+      return;
+    }
+    KDTreePCLAdaptor kdtree(layer.Points);
+    std::vector<int> status(layer.Points->size(), 0);
+    std::vector<double> histogram(this->NrejectionCauses, 0);
+    this->ResetDistanceParameters();
+    this->MatchKeypoints(layer.Points, [&](size_t, const Point& p, MatchingResults& results)
+    {
+      return match(kdtree, p, results);
+    }, &status, histogram);
+
+    // the parameters of the matched points are stored in their order
+    size_t matchIndex = 0;
+    for (size_t i = 0; i < status.size(); ++i)
+    {
+      KeypointMapFile::Fit& fit = layer.Fits[i];
+      fit.Status = status[i];
+      fit.Valid = status[i] == successCode;
+      if (fit.Valid)
+      {
+        fit.SetA(this->Avalues[matchIndex]);
+        for (int k = 0; k < 3; ++k)
+        {
+          fit.Mean[k] = static_cast<float>(this->Pvalues[matchIndex](k));
+        }
+        fit.Coefficient = static_cast<float>(this->residualCoefficient[matchIndex]);
+        ++matchIndex;
+      }
+    }
+    this->ResetDistanceParameters();
+  };
+
+  KeypointMapFile::LayerData layers[KeypointMapFile::NumberOfLayers];
+  fitLayer(this->EdgesPointsLocalMap, 6, layers[KeypointMapFile::EdgesLayer],
+           [&](KDTreePCLAdaptor& kdtree, const Point& p, MatchingResults& results)
+  {
+    return this->ComputeLineDistanceParameters(kdtree, R, T, p, MatchingMode::Mapping, results);
+  });
+  fitLayer(this->PlanarPointsLocalMap, 6, layers[KeypointMapFile::PlanarsLayer],
+           [&](KDTreePCLAdaptor& kdtree, const Point& p, MatchingResults& results)
+  {
+    return this->ComputePlaneDistanceParameters(kdtree, R, T, p, MatchingMode::Mapping, results);
+  });
+  fitLayer(this->BlobsPointsLocalMap, 5, layers[KeypointMapFile::BlobsLayer],
+           [&](KDTreePCLAdaptor& kdtree, const Point& p, MatchingResults& results)
+  {
+    return this->ComputeBlobsDistanceParameters(kdtree, R, T, p, MatchingMode::Mapping, results);
+  });
+  this->Undistortion = undistortion;
+
+  return KeypointMapFile::Write(filename, this->EdgesPointsLocalMap->GetResolution(), layers);
+}
+
+//-----------------------------------------------------------------------------
+void Slam::SetPipelineMode(int mode)
+{
+  if (mode == this->PipelineMode)
+  {
+    return;
+  }
+  // the frame given last is pending only in OverlappedPipeline mode
+  this->Flush();
+  this->PipelineMode = mode;
+}
+
 //-----------------------------------------------------------------------------
 void Slam::SetVoxelGridResolution(double resolution)
 {
+  this->WaitForMapsUpdate();
   this->EdgesPointsLocalMap->SetResolution(resolution);
   this->PlanarPointsLocalMap->SetResolution(resolution);
   this->BlobsPointsLocalMap->SetResolution(resolution);
@@ -1793,6 +3323,7 @@ void Slam::SetVoxelGridResolution(double resolution)
 //-----------------------------------------------------------------------------
 void Slam::SetLidarMaximunRange(const double maxRange)
 {
+  this->WaitForMapsUpdate();
   this->EdgesPointsLocalMap->SetPointCoudMaxRange(maxRange);
   this->PlanarPointsLocalMap->SetPointCoudMaxRange(maxRange);
   this->BlobsPointsLocalMap->SetPointCoudMaxRange(maxRange);
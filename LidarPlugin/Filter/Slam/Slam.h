@@ -81,16 +81,25 @@
 
 #include <Eigen/Geometry>
 
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+
 #include "LidarPoint.h"
 #include "SpinningSensorKeypointExtractor.h"
 #include "KalmanFilter.h"
 #include "KDTreePCLAdaptor.h"
 #include "MotionModel.h"
+#include "SlamTimings.h"
+#include "LoopClosureGraph.h"
 
 #define SetMacro(name,type) void Set##name (type _arg) { name = _arg; }
 #define GetMacro(name,type) type Get##name () const { return name; }
 
-class RollingGrid;
+class LocalMap;
+class PrebuiltMap;
+class KeypointMapFile;
 
 enum MatchingMode
 {
@@ -98,6 +107,24 @@ enum MatchingMode
   Mapping = 1
 };
 
+enum LocalMapBackend
+{
+  RollingGridMap = 0,
+  HashedVoxelMap = 1
+};
+
+enum FramePipelineMode
+{
+  SequentialPipeline = 0,
+  OverlappedPipeline = 1
+};
+
+enum SolverLinearSolverType
+{
+  DenseQRSolver = 0,
+  DenseNormalCholeskySolver = 1
+};
+
 enum WithinFrameTrajMode
 {
   EgoMotionTraj = 0,
@@ -144,18 +171,55 @@ public:
   // From this frame; keypoints will be computed and extracted
   // in order to recover the ego-motion of the lidar sensor
   // and to update the map using keypoints and ego-motion
+  // In OverlappedPipeline mode, the keypoints of the frame are
+  // extracted while the previous frame is registered and the results
+  // available after the call are the ones of the previous frame
   void AddFrame(pcl::PointCloud<Point>::Ptr pc, std::vector<size_t> laserIdMapping);
 
+  // Add the frames acquired at the same time by the sensors, the first
+  // one being the frame of the main sensor and the following ones the
+  // frames of the sensors added with AddSensor, in the same order.
+  // The keypoints of the frames are extracted in parallel, each sensor
+  // with its own extractor, and merged in the referential of the main
+  // sensor: the ego-motion and the mapping are solved once for all the
+  // sensors, against the same maps
+  void AddFrames(const std::vector<pcl::PointCloud<Point>::Ptr>& frames,
+                 const std::vector<std::vector<size_t> >& laserIdMappings);
+
+  // Register the frame still pending in OverlappedPipeline mode
+  // and wait for the maps to be updated
+  void Flush();
+
   // Get the computed world transform so far
   Transform GetWorldTransform();
   std::vector<double> GetTransformCovariance();
 
+  // The debug information contains the time spent in each
+  // stage during the last frame, see GetStageDebugName
   std::unordered_map<std::string, double> GetDebugInformation();
 
+  // Name of the time spent in a stage in the debug information
+  static std::string GetStageDebugName(SlamStage stage);
+
+  // Wall time spent in each stage over the last frames
+  const SlamTimings& GetTimings() const { return *this->Timings; }
+
   pcl::PointCloud<Point>::Ptr GetEdgesMap();
   pcl::PointCloud<Point>::Ptr GetPlanarsMap();
   pcl::PointCloud<Point>::Ptr GetBlobsMap();
 
+  // Points of the maps including the ones flushed to the
+  // tile stores, see MapTilesDirectory
+  pcl::PointCloud<Point>::Ptr GetCompleteEdgesMap();
+  pcl::PointCloud<Point>::Ptr GetCompletePlanarsMap();
+  pcl::PointCloud<Point>::Ptr GetCompleteBlobsMap();
+
+  // Version of the points of each map, which changes only when points
+  // are added to or removed from the map, to convert it only when needed
+  unsigned long GetEdgesMapVersion();
+  unsigned long GetPlanarsMapVersion();
+  unsigned long GetBlobsMapVersion();
+
   GetMacro(MaxDistBetweenTwoFrames, double)
   SetMacro(MaxDistBetweenTwoFrames, double)
 
@@ -168,13 +232,93 @@ public:
   SetMacro(Undistortion, bool)
   GetMacro(Undistortion, bool)
 
-  // Set RollingGrid Parameters
+  SetMacro(UndistortionNumberOfBins, unsigned int)
+  GetMacro(UndistortionNumberOfBins, unsigned int)
+
+  GetMacro(NumberOfThreads, unsigned int)
+  SetMacro(NumberOfThreads, unsigned int)
+
+  GetMacro(LoopClosure, bool)
+  void SetLoopClosure(bool enable);
+
+  GetMacro(LoopClosureKeyframeDistance, double)
+  SetMacro(LoopClosureKeyframeDistance, double)
+
+  GetMacro(LoopClosureDescriptorThreshold, double)
+  SetMacro(LoopClosureDescriptorThreshold, double)
+
+  GetMacro(LoopClosureMinimumInlierRatio, double)
+  SetMacro(LoopClosureMinimumInlierRatio, double)
+
+  // Version of the loop closed key frames, which changes each
+  // time a loop is closed, to convert them only when needed
+  unsigned long GetLoopClosureVersion() { return this->LoopClosures->GetVersion(); }
+
+  // Key frames of the trajectory corrected by the last loop closure
+  void GetLoopClosedKeyframes(std::vector<double>& times, PoseVector& poses)
+  {
+    this->LoopClosures->GetCorrectedKeyframes(times, poses);
+  }
+
+  GetMacro(BackgroundKDTreeBuild, bool)
+  SetMacro(BackgroundKDTreeBuild, bool)
+
+  GetMacro(SinglePrecisionPCA, bool)
+  SetMacro(SinglePrecisionPCA, bool)
+
+  GetMacro(AnalyticJacobians, bool)
+  SetMacro(AnalyticJacobians, bool)
+
+  GetMacro(KeyframeDistance, double)
+  SetMacro(KeyframeDistance, double)
+
+  GetMacro(KeyframeAngle, double)
+  SetMacro(KeyframeAngle, double)
+
+  GetMacro(KeyframeMinOverlap, double)
+  SetMacro(KeyframeMinOverlap, double)
+
+  GetMacro(KeyframeSkipMapping, bool)
+  SetMacro(KeyframeSkipMapping, bool)
+
+  GetMacro(PipelineMode, int)
+  void SetPipelineMode(int mode);
+
+  GetMacro(NbrFrameProcessed, unsigned int)
+
+  // Set LocalMap Parameters
   void SetVoxelGridLeafSizeEdges(double size);
   void SetVoxelGridLeafSizePlanes(double size);
   void SetVoxelGridLeafSizeBlobs(double size);
   void SetVoxelGridSize(unsigned int size);
   void SetVoxelGridResolution(double resolution);
 
+  // Select the LocalMapBackend of the maps, the keypoints
+  // already in the maps are moved to the new ones
+  GetMacro(MapBackend, int)
+  void SetMapBackend(int backend);
+
+  // Directory where the voxels evicted from the hashed voxels maps are
+  // flushed, to load them back when the sensor comes back to them.
+  // Empty to drop them. Changing it drops the voxels already flushed.
+  GetMacro(MapTilesDirectory, std::string)
+  void SetMapTilesDirectory(const std::string& directory);
+
+  // Keypoint maps saved by SaveMaps, in which the sensor is localized
+  // instead of being mapped: the frames are registered against these
+  // maps, which are never modified. Empty to map again. Changing it
+  // resets the maps, a file which can not be opened is ignored.
+  GetMacro(LocalizationMapFile, std::string)
+  void SetLocalizationMapFile(const std::string& filename);
+
+  // Is the sensor localized in the maps of LocalizationMapFile
+  bool IsLocalizing() const { return this->LocalizationMap != nullptr; }
+
+  // Save the complete keypoint maps, with the fits of the neighborhoods
+  // of their points, to localize in them later. Return false if the
+  // file could not be written
+  bool SaveMaps(const std::string& filename);
+
   // Get/Set EgoMotion
   GetMacro(EgoMotionLMMaxIter, unsigned int)
   SetMacro(EgoMotionLMMaxIter, unsigned int)
@@ -216,9 +360,21 @@ public:
   GetMacro(MappingLMMaxIter, unsigned int)
   SetMacro(MappingLMMaxIter, unsigned int)
 
+  GetMacro(SolverNumberOfThreads, unsigned int)
+  SetMacro(SolverNumberOfThreads, unsigned int)
+
+  GetMacro(SolverLinearSolver, int)
+  SetMacro(SolverLinearSolver, int)
+
   GetMacro(MappingICPMaxIter, unsigned int)
   SetMacro(MappingICPMaxIter, unsigned int)
 
+  GetMacro(MappingCoarseICPIter, unsigned int)
+  SetMacro(MappingCoarseICPIter, unsigned int)
+
+  GetMacro(MappingCoarseLeafSize, double)
+  SetMacro(MappingCoarseLeafSize, double)
+
   GetMacro(MappingLineDistanceNbrNeighbors, unsigned int)
   SetMacro(MappingLineDistanceNbrNeighbors, unsigned int)
 
@@ -255,6 +411,17 @@ public:
   void SetKeyPointsExtractor(std::shared_ptr<SpinningSensorKeypointExtractor> extractor) { this->KeyPointsExtractor = extractor; }
   std::shared_ptr<SpinningSensorKeypointExtractor> GetKeyPointsExtractor() { return this->KeyPointsExtractor; }
 
+  // Additional sensors rigidly mounted with the main one, whose keypoints
+  // extractor is KeyPointsExtractor. The pose of an additional sensor is
+  // the transform from its referential to the one of the main sensor.
+  // All the sensors must be synchronized: the time of the points of each
+  // frame is relative to its acquisition, see AddFrames
+  // Return the index of the sensor in the frames given to AddFrames
+  unsigned int AddSensor(std::shared_ptr<SpinningSensorKeypointExtractor> extractor, const Eigen::Isometry3d& pose);
+  void ClearSensors() { this->Sensors.clear(); }
+  // Number of sensors, including the main one
+  unsigned int GetNumberOfSensors() const { return 1 + this->Sensors.size(); }
+
 private:
   std::vector<Transform> Trajectory;
 
@@ -265,6 +432,7 @@ private:
   double MappingPlanesPointsUsed;
   double MappingBlobsPointsUsed;
   double MappingVarianceError;
+  double MappingOverlap = 0;
 
   // Mapping between keypoints and their corresponding
   // index in the vtk input frame
@@ -284,6 +452,95 @@ private:
   // the computation speed will decrease
   bool Undistortion = false;
 
+  // Number of time bins of a frame whose transforms are
+  // precomputed to undistord the points, the transform of
+  // a point being the one of the closest bin. 0 means that
+  // the transform of each point is interpolated
+  unsigned int UndistortionNumberOfBins = 1024;
+
+  // Should the places already visited be recognized, to correct the
+  // drift of the key frames trajectory by optimizing its pose graph.
+  // The key frames are LoopClosureKeyframeDistance meters apart, a loop
+  // is searched when the distance between their ScanContext is below
+  // LoopClosureDescriptorThreshold, and is accepted when the registration
+  // matches at least LoopClosureMinimumInlierRatio of the keypoints
+  bool LoopClosure = false;
+  double LoopClosureKeyframeDistance = 2.0;
+  double LoopClosureDescriptorThreshold = 0.2;
+  double LoopClosureMinimumInlierRatio = 0.5;
+  std::shared_ptr<LoopClosureGraph> LoopClosures = std::make_shared<LoopClosureGraph>();
+
+  // Number of threads used to match the keypoints with
+  // their neighborhood, 0 means one per hardware thread
+  unsigned int NumberOfThreads = 0;
+
+  // Should the kd-trees of the keypoints be built in a background
+  // thread once a frame is processed, so that they are ready when
+  // the ego-motion of the next frame starts
+  bool BackgroundKDTreeBuild = true;
+
+  // Should the PCA of the neighborhoods of the keypoints,
+  // used to fit the lines, planes and blobs, be computed
+  // in float rather than in double precision
+  bool SinglePrecisionPCA = true;
+
+  // Should the jacobians of the residuals of the registrations without
+  // undistortion be computed analytically rather than by the automatic
+  // differentiation of ceres, the results being the same up to rounding
+  bool AnalyticJacobians = true;
+
+  // Only the keyframes are added to the maps: the frames whose pose is
+  // at least KeyframeDistance meters or KeyframeAngle degrees away from
+  // the one of the last keyframe, or whose ratio of keypoints matched
+  // with the maps by the mapping is below KeyframeMinOverlap, among the
+  // edges and planars keypoints. With the
+  // default values, every frame is a keyframe. If KeyframeSkipMapping
+  // is enabled, the mapping of the other frames is skipped too, their
+  // pose being the one estimated by the ego-motion, as long as the
+  // last mapped frame overlapped the maps enough
+  double KeyframeDistance = 0.0;
+  double KeyframeAngle = 0.0;
+  double KeyframeMinOverlap = 0.0;
+  bool KeyframeSkipMapping = false;
+
+  // Pose of the last keyframe, and whether the current frame is one
+  Eigen::Matrix<double, 6, 1> LastKeyframeTworld = Eigen::Matrix<double, 6, 1>::Zero();
+  bool IsKeyframe = true;
+
+  // How the processing of consecutive frames is scheduled, a FramePipelineMode:
+  // - SequentialPipeline: each frame is completely registered by AddFrame
+  // - OverlappedPipeline: the keypoints extraction of a frame overlaps the
+  //   registration of the previous one, which increases the throughput at
+  //   the cost of one frame of latency
+  // In both modes the maps are updated in the background once a frame is
+  // registered, and the results are the same for a given sequence of frames
+  int PipelineMode = FramePipelineMode::SequentialPipeline;
+
+  // Keypoints of a frame, as output by the extraction stage
+  struct ExtractedFrame
+  {
+    double Time = 0;
+    pcl::PointCloud<Point>::Ptr Edges;
+    pcl::PointCloud<Point>::Ptr Planars;
+    pcl::PointCloud<Point>::Ptr Blobs;
+    double FarestKeypointDist = 0;
+    int NLasers = 0;
+  };
+
+  // Frame extracted but not registered yet in OverlappedPipeline mode
+  ExtractedFrame PendingFrame;
+  bool HasPendingFrame = false;
+
+  // Updates of the maps running in the background
+  std::vector<std::shared_future<void> > MapsUpdates;
+
+  // Wall time spent in each stage, shared with the background tasks
+  std::shared_ptr<SlamTimings> Timings = std::make_shared<SlamTimings>();
+
+  // Information given by the extractor about the current frame
+  double CurrentFarestKeypointDist = 0;
+  int CurrentNLasers = 0;
+
   // Represents estimated samples of the trajectory
   // of the sensor within a lidar frame. The orientation
   // and position of the sensor at a random time t can then
@@ -298,10 +555,28 @@ private:
   pcl::PointCloud<Point>::Ptr PreviousPlanarsPoints;
   pcl::PointCloud<Point>::Ptr PreviousBlobsPoints;
 
+  // kd-trees of the previous keypoints, built by BuildPreviousKDTrees
+  std::shared_future<std::shared_ptr<KDTreePCLAdaptor> > PreviousEdgesKDTree;
+  std::shared_future<std::shared_ptr<KDTreePCLAdaptor> > PreviousPlanarsKDTree;
+
   // keypoints local map
-  std::shared_ptr<RollingGrid> EdgesPointsLocalMap;
-  std::shared_ptr<RollingGrid> PlanarPointsLocalMap;
-  std::shared_ptr<RollingGrid> BlobsPointsLocalMap;
+  std::shared_ptr<LocalMap> EdgesPointsLocalMap;
+  std::shared_ptr<LocalMap> PlanarPointsLocalMap;
+  std::shared_ptr<LocalMap> BlobsPointsLocalMap;
+
+  // Data structure of the keypoints local maps, a LocalMapBackend:
+  // a dense grid rolled with the sensor or a hash map of the
+  // voxels containing some points
+  int MapBackend = LocalMapBackend::RollingGridMap;
+
+  // Directory of the tile stores of the maps, the evicted
+  // voxels are dropped if it is empty
+  std::string MapTilesDirectory;
+
+  // File of the maps in which the sensor is localized, opened
+  // if the localization is enabled
+  std::string LocalizationMapFile;
+  std::shared_ptr<KeypointMapFile> LocalizationMap;
 
   // Number of frame that have been processed
   unsigned int NbrFrameProcessed = 0;
@@ -324,6 +599,15 @@ private:
   // in the mapping optimization step
   unsigned int MappingLMMaxIter = 15;
 
+  // Number of threads used by ceres to evaluate the residuals
+  // of the ego-motion and mapping optimizations, 0 means one
+  // per hardware thread
+  unsigned int SolverNumberOfThreads = 1;
+
+  // Linear solver used by ceres to compute the Levenberg-Marquardt
+  // steps of the ego-motion and mapping optimizations, a SolverLinearSolverType
+  int SolverLinearSolver = SolverLinearSolverType::DenseQRSolver;
+
   // During the Levenberg-Marquardt algoritm
   // keypoints will have to be match with planes
   // and lines of the previous frame. This parameter
@@ -332,6 +616,13 @@ private:
   unsigned int EgoMotionICPMaxIter = 4;
   unsigned int MappingICPMaxIter = 3;
 
+  // Number of the first mapping ICP iterations matching a downsampled set
+  // of keypoints with a coarse level of the maps, both decimated on a voxel
+  // grid of MappingCoarseLeafSize meters. The last iteration always uses
+  // the full resolution. 0 disables the coarse level
+  unsigned int MappingCoarseICPIter = 0;
+  double MappingCoarseLeafSize = 1.5;
+
   // When computing the point<->line and point<->plane distance
   // in the ICP, the kNearest edges/planes points of the current
   // points are selected to approximate the line/plane using a PCA
@@ -365,6 +656,16 @@ private:
   std::shared_ptr<SpinningSensorKeypointExtractor> KeyPointsExtractor =
       std::make_shared<SpinningSensorKeypointExtractor>();
 
+  // Additional sensors, the pose being stored as a rotation and a
+  // translation to avoid the alignment requirements of Eigen::Isometry3d
+  struct Sensor
+  {
+    std::shared_ptr<SpinningSensorKeypointExtractor> Extractor;
+    Eigen::Matrix3d Rotation;
+    Eigen::Vector3d Translation;
+  };
+  std::vector<Sensor> Sensors;
+
   // Use or not blobs
   bool UseBlob = false;
 
@@ -419,6 +720,29 @@ private:
   int NrejectionCauses = 7;
   void ResetDistanceParameters();
 
+  // Distance parameters and rejection causes of the keypoints
+  // matched by one thread, merged into the vectors above once
+  // all the keypoints have been matched
+  struct MatchingResults
+  {
+    std::vector<Eigen::Matrix3d > Avalues;
+    std::vector<Eigen::Vector3d > Pvalues;
+    std::vector<Eigen::Vector3d > Xvalues;
+    std::vector<double> residualCoefficient;
+    std::vector<double> TimeValues;
+    std::vector<double> RejectionHistogram;
+  };
+  // the matching function is given the index of the keypoint in its cloud
+  typedef std::function<int(size_t, const Point&, MatchingResults&)> KeypointMatcher;
+
+  // Match all the keypoints of the cloud using the provided function,
+  // splitting the cloud in contiguous chunks matched in parallel. The
+  // results are merged in the keypoints order so that the residuals
+  // given to ceres do not depend on the number of threads. The rejection
+  // cause of each keypoint is stored in rejection if not null
+  void MatchKeypoints(pcl::PointCloud<Point>::Ptr keypoints, const KeypointMatcher& match,
+                      std::vector<int>* rejection, std::vector<double>& histogram);
+
   // Display information about the keypoints - neighborhood
   // mathching rejections
   void RejectionInformationDisplay();
@@ -432,6 +756,25 @@ private:
   double MappingInitLossScale = 0.7; // Saturation around 2.5 meters
   double MappingFinalLossScale = 0.05; // // Saturation around 0.4 meters
 
+  // Extract the keypoints of the frames of the sensors and merge them
+  // in the referential of the main sensor, only uses the keypoints extractors
+  ExtractedFrame ExtractKeypoints(const std::vector<pcl::PointCloud<Point>::Ptr>& frames,
+                                  const std::vector<std::vector<size_t> >& laserIdMappings);
+
+  // Register a frame whose keypoints have been extracted:
+  // ego-motion, mapping and update of the maps
+  void ProcessFrame(const ExtractedFrame& frame);
+
+  // Wait for the updates of the maps running in the background
+  void WaitForMapsUpdate();
+
+  // Give new tile stores in MapTilesDirectory to the maps
+  void ResetMapTileStores();
+
+  // Start building the kd-trees of the previous keypoints,
+  // in the background if BackgroundKDTreeBuild is set
+  void BuildPreviousKDTrees();
+
   // Find the ego motion of the sensor between
   // the current frame and the next one using
   // the keypoints extracted.
@@ -442,6 +785,14 @@ private:
   // using the map and the keypoints extracted.
   void Mapping();
 
+  // Has the sensor moved enough since the last keyframe for the
+  // pose to be the one of a new keyframe, see KeyframeDistance
+  bool HasMovedSinceLastKeyframe(const Eigen::Matrix<double, 6, 1>& pose) const;
+
+  // Keep the pose estimated by the ego-motion for a frame which is not a
+  // keyframe, instead of refining it against the maps
+  void SkipMapping();
+
   // Transform the input point already undistort into Tworld.
   void TransformToWorld(Point& p);
 
@@ -451,12 +802,43 @@ private:
   // (R * X + T - P).t * A * (R * X + T - P)
   // Where P is the mean point of the neighborhood and A is the symmetric
   // variance-covariance matrix encoding the shape of the neighborhood
-  int ComputeLineDistanceParameters(KDTreePCLAdaptor& kdtreePreviousEdges, Eigen::Matrix3d& R,
-                                    Eigen::Vector3d& dT, Point p, MatchingMode matchingMode);
-  int ComputePlaneDistanceParameters(KDTreePCLAdaptor& kdtreePreviousPlanes, Eigen::Matrix3d& R,
-                                     Eigen::Vector3d& dT, Point p, MatchingMode matchingMode);
-  int ComputeBlobsDistanceParameters(pcl::KdTreeFLANN<Point>::Ptr kdtreePreviousBlobs, Eigen::Matrix3d& R,
-                                     Eigen::Vector3d& dT, Point p, MatchingMode matchingMode);
+  // The parameters are stored in results, so that several
+  // keypoints can be matched at the same time
+  int ComputeLineDistanceParameters(KDTreePCLAdaptor& kdtreePreviousEdges, const Eigen::Matrix3d& R,
+                                    const Eigen::Vector3d& dT, Point p, MatchingMode matchingMode,
+                                    MatchingResults& results);
+  // The planes and blobs can be given the nearest neighbors of the
+  // transformed keypoint, searched with the ones of the other keypoints
+  int ComputePlaneDistanceParameters(KDTreePCLAdaptor& kdtreePreviousPlanes, const Eigen::Matrix3d& R,
+                                     const Eigen::Vector3d& dT, Point p, MatchingMode matchingMode,
+                                     MatchingResults& results, const int* neighborsIndices = nullptr,
+                                     const double* neighborsDistances = nullptr);
+  int ComputeBlobsDistanceParameters(KDTreePCLAdaptor& kdtreePreviousBlobs, const Eigen::Matrix3d& R,
+                                     const Eigen::Vector3d& dT, Point p, MatchingMode matchingMode,
+                                     MatchingResults& results, const int* neighborsIndices = nullptr,
+                                     const double* neighborsDistances = nullptr);
+  // When localizing, the keypoint is matched with the fit of the
+  // neighborhood of its nearest point in the search index of the
+  // map, which is stored in the file of the map
+  int ComputePrebuiltDistanceParameters(KDTreePCLAdaptor& kdtreeMap, const PrebuiltMap& map,
+                                        const Eigen::Matrix3d& R, const Eigen::Vector3d& dT, Point p,
+                                        MatchingResults& results);
+
+  // Nearest neighbors of all the keypoints of a matching step,
+  // those of the i-th keypoint being stored from i * K
+  struct KeypointsNeighbors
+  {
+    int K = 0;
+    std::vector<int> Indices;
+    std::vector<double> Distances;
+  };
+
+  // Search at once the knearest neighbors of all the keypoints transformed
+  // by R and dT, or undistorted, so that the search index can process them
+  // as a batch (see KDTreePCLAdaptor::batchQuery)
+  void SearchKeypointsNeighbors(pcl::PointCloud<Point>::Ptr keypoints, KDTreePCLAdaptor& kdtree,
+                                const Eigen::Matrix3d& R, const Eigen::Vector3d& dT, bool undistort,
+                                int knearest, KeypointsNeighbors& neighbors);
 
   // Instead of taking the k-nearest neigbors in the odometry
   // step we will take specific neighbor using the particularities
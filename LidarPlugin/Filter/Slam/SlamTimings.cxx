@@ -0,0 +1,174 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "SlamTimings.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+//-----------------------------------------------------------------------------
+SlamTimings::StageTimer::StageTimer(SlamTimings& timings, SlamStage stage)
+  : Timings(timings), Stage(stage), Start(std::chrono::steady_clock::now())
+{
+}
+
+//-----------------------------------------------------------------------------
+SlamTimings::StageTimer::~StageTimer()
+{
+  this->Stop();
+}
+
+//-----------------------------------------------------------------------------
+void SlamTimings::StageTimer::Stop()
+{
+  if (this->Stopped)
+  {
+    return;
+  }
+  this->Stopped = true;
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - this->Start;
+  this->Timings.Add(this->Stage, elapsed.count());
+}
+
+//-----------------------------------------------------------------------------
+const char* SlamTimings::GetStageName(SlamStage stage)
+{
+  static const char* names[NbrSlamStages] = {
+    "Keypoints extraction",
+    "KD-tree build",
+    "Ego-Motion matching",
+    "Ego-Motion solve",
+    "Mapping matching",
+    "Mapping solve",
+    "Map roll",
+    "Map update",
+    "Frame registration"
+  };
+  return names[stage];
+}
+
+//-----------------------------------------------------------------------------
+const std::vector<double>& SlamTimings::GetHistogramBinBounds()
+{
+  static const std::vector<double> bounds = {0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5};
+  return bounds;
+}
+
+//-----------------------------------------------------------------------------
+SlamTimings::SlamTimings(unsigned int windowSize)
+  : WindowSize(std::max(1u, windowSize))
+{
+  this->Reset();
+}
+
+//-----------------------------------------------------------------------------
+void SlamTimings::Add(SlamStage stage, double seconds)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Current[stage] += seconds;
+  this->Measured[stage] = true;
+}
+
+//-----------------------------------------------------------------------------
+void SlamTimings::EndFrame()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  for (int stage = 0; stage < NbrSlamStages; ++stage)
+  {
+    // A stage which did not run during this frame is not
+    // accounted as a frame spending no time in it
+    this->LastFrame[stage] = this->Current[stage];
+    if (!this->Measured[stage])
+    {
+      continue;
+    }
+    std::deque<double>& window = this->Windows[stage];
+    window.push_back(this->Current[stage]);
+    if (window.size() > this->WindowSize)
+    {
+      window.pop_front();
+    }
+    this->Current[stage] = 0;
+    this->Measured[stage] = false;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void SlamTimings::Reset()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Current.fill(0);
+  this->Measured.fill(false);
+  this->LastFrame.fill(0);
+  for (auto& window : this->Windows)
+  {
+    window.clear();
+  }
+}
+
+//-----------------------------------------------------------------------------
+double SlamTimings::GetLastFrameTime(SlamStage stage) const
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->LastFrame[stage];
+}
+
+//-----------------------------------------------------------------------------
+SlamTimings::StageStatistics SlamTimings::GetStatistics(SlamStage stage) const
+{
+  std::vector<double> samples;
+  StageStatistics statistics;
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    const std::deque<double>& window = this->Windows[stage];
+    if (window.empty())
+    {
+      return statistics;
+    }
+    samples.assign(window.begin(), window.end());
+    statistics.Last = window.back();
+  }
+
+  std::sort(samples.begin(), samples.end());
+  statistics.Count = samples.size();
+  statistics.Mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+  statistics.Min = samples.front();
+  statistics.Max = samples.back();
+  // Nearest rank percentiles
+  auto percentile = [&samples](double p)
+  {
+    size_t rank = static_cast<size_t>(std::ceil(p * samples.size()));
+    return samples[std::max(static_cast<size_t>(1), rank) - 1];
+  };
+  statistics.Median = percentile(0.5);
+  statistics.Percentile95 = percentile(0.95);
+  return statistics;
+}
+
+//-----------------------------------------------------------------------------
+std::vector<unsigned int> SlamTimings::GetHistogram(SlamStage stage) const
+{
+  const std::vector<double>& bounds = GetHistogramBinBounds();
+  std::vector<unsigned int> histogram(bounds.size() + 1, 0);
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  for (double sample : this->Windows[stage])
+  {
+    histogram[std::upper_bound(bounds.begin(), bounds.end(), sample) - bounds.begin()] += 1;
+  }
+  return histogram;
+}
@@ -0,0 +1,123 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef SLAM_TIMINGS_H
+#define SLAM_TIMINGS_H
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+//! Stages of the processing of a frame whose wall time is measured
+enum SlamStage
+{
+  KeypointsExtraction = 0,
+  KDTreeBuild = 1,
+  EgoMotionMatching = 2,
+  EgoMotionSolve = 3,
+  MappingMatching = 4,
+  MappingSolve = 5,
+  MapRoll = 6,
+  MapUpdate = 7,
+  FrameRegistration = 8,
+  NbrSlamStages = 9
+};
+
+/**
+ * \class SlamTimings
+ * \brief Wall time spent by the SLAM in each stage of the processing of the frames.
+ *
+ * The time spent in a stage is accumulated until the end of the frame, and is then
+ * added to the rolling window of the last frames of this stage, from which the
+ * statistics and the histogram of the stage are computed. A stage run in the
+ * background, such as the maps update, is accounted to the frame ending after it.
+ * The time can be added from several threads at the same time.
+ */
+class SlamTimings
+{
+public:
+  //! Statistics of a stage over the rolling window, in seconds
+  struct StageStatistics
+  {
+    unsigned int Count = 0;
+    double Last = 0;
+    double Mean = 0;
+    double Min = 0;
+    double Max = 0;
+    double Median = 0;
+    double Percentile95 = 0;
+  };
+
+  //! Measure the wall time spent in a stage until it is stopped or destroyed
+  class StageTimer
+  {
+  public:
+    StageTimer(SlamTimings& timings, SlamStage stage);
+    ~StageTimer();
+
+    //! Add the time elapsed since the construction to the stage, only once
+    void Stop();
+
+  private:
+    SlamTimings& Timings;
+    const SlamStage Stage;
+    const std::chrono::steady_clock::time_point Start;
+    bool Stopped = false;
+  };
+
+  //! Name of a stage
+  static const char* GetStageName(SlamStage stage);
+
+  //! Upper bounds, in seconds, of the bins of the histograms but the last one
+  static const std::vector<double>& GetHistogramBinBounds();
+
+  /**
+   * @param windowSize number of frames over which the statistics of a stage
+   * are computed
+   */
+  explicit SlamTimings(unsigned int windowSize = 100);
+
+  //! Add some time spent in a stage during the current frame
+  void Add(SlamStage stage, double seconds);
+
+  //! Add the time spent in each stage during the frame to the rolling windows
+  void EndFrame();
+
+  //! Forget all the measures
+  void Reset();
+
+  //! Time spent in a stage during the last ended frame, 0 if it did not run
+  double GetLastFrameTime(SlamStage stage) const;
+
+  StageStatistics GetStatistics(SlamStage stage) const;
+
+  //! Number of frames of the rolling window in each bin of GetHistogramBinBounds
+  std::vector<unsigned int> GetHistogram(SlamStage stage) const;
+
+private:
+  const unsigned int WindowSize;
+
+  mutable std::mutex Mutex;
+  std::array<double, NbrSlamStages> Current;
+  std::array<bool, NbrSlamStages> Measured;
+  std::array<double, NbrSlamStages> LastFrame;
+  std::array<std::deque<double>, NbrSlamStages> Windows;
+};
+
+#endif // SLAM_TIMINGS_H
@@ -18,7 +18,9 @@
 // limitations under the License.
 //=========================================================================
 #include "SpinningSensorKeypointExtractor.h"
+#include "ParallelFor.h"
 
+#include <algorithm>
 #include <numeric>
 
 #include <Eigen/Dense>
@@ -26,18 +28,32 @@
 
 namespace {
 //-----------------------------------------------------------------------------
+// Fill idx with the indexes of the size values of v, sorted
+// in decreasing order of the values
 template <typename T>
-std::vector<size_t> sortIdx(const std::vector<T> &v)
+void sortIdx(const T* v, size_t size, size_t* idx)
 {
   // initialize original index locations
-  std::vector<size_t> idx(v.size());
-  std::iota(idx.begin(), idx.end(), 0);
+  std::iota(idx, idx + size, 0);
 
   // sort indexes based on comparing values in v
-  std::sort(idx.begin(), idx.end(),
-       [&v](size_t i1, size_t i2) {return v[i1] > v[i2];});
+  std::sort(idx, idx + size,
+       [v](size_t i1, size_t i2) {return v[i1] > v[i2];});
+}
 
-  return idx;
+//-----------------------------------------------------------------------------
+// Call f(scanLine) for each scan line. The scan lines are independent and are
+// taken one at a time by the threads, since their sizes differ.
+template <typename F>
+void ForEachScanLine(unsigned int nLasers, unsigned int nThreads, const F& f)
+{
+  Parallel::ForEachChunk(nLasers, 1, nThreads, [&f](unsigned int, size_t begin, size_t end)
+  {
+    for (size_t scanLine = begin; scanLine < end; ++scanLine)
+    {
+      f(static_cast<unsigned int>(scanLine));
+    }
+  });
 }
 
 //-----------------------------------------------------------------------------
@@ -158,29 +174,42 @@ void LineFitting::FitFast(std::vector<Eigen::Vector3d >& points)
 //-----------------------------------------------------------------------------
 void SpinningSensorKeypointExtractor::PrepareDataForNextFrame()
 {
-  // Reset the pcl format pointcloud to store the new frame
+  // Clear the pcl format pointclouds of the scan lines to store the new
+  // frame. They are kept from one frame to the next, so that their capacity
+  // grows to the maximum number of points per scan line seen so far.
   this->pclCurrentFrameByScan.resize(this->NLasers);
   for (unsigned int k = 0; k < this->NLasers; ++k)
   {
-    this->pclCurrentFrameByScan[k].reset(new pcl::PointCloud<Point>());
+    if (this->pclCurrentFrameByScan[k])
+    {
+      this->pclCurrentFrameByScan[k]->clear();
+    }
+    else
+    {
+      this->pclCurrentFrameByScan[k].reset(new pcl::PointCloud<Point>());
+    }
   }
 
+  // The keypoints clouds are given to the caller, they
+  // can not be reused. They are reserved when filled.
   this->EdgesPoints.reset(new pcl::PointCloud<Point>());
   this->PlanarsPoints.reset(new pcl::PointCloud<Point>());
   this->BlobsPoints.reset(new pcl::PointCloud<Point>());
+}
 
-  this->Angles.clear();
-  this->Angles.resize(this->NLasers);
-  this->SaillantPoint.clear();
-  this->SaillantPoint.resize(this->NLasers);
-  this->DepthGap.clear();
-  this->DepthGap.resize(this->NLasers);
-  this->IntensityGap.clear();
-  this->IntensityGap.resize(this->NLasers);
-  this->IsPointValid.clear();
-  this->IsPointValid.resize(this->NLasers);
-  this->Label.clear();
-  this->Label.resize(this->NLasers);
+//-----------------------------------------------------------------------------
+SpinningSensorKeypointExtractor::ScanLineBuffers
+SpinningSensorKeypointExtractor::GetScanLineBuffers(unsigned int scanLine)
+{
+  const size_t offset = this->ScanLineOffsets[scanLine];
+  ScanLineBuffers line;
+  line.Angles = this->Angles.data() + offset;
+  line.DepthGap = this->DepthGap.data() + offset;
+  line.SaillantPoint = this->SaillantPoint.data() + offset;
+  line.IntensityGap = this->IntensityGap.data() + offset;
+  line.IsPointValid = this->IsPointValid.data() + offset;
+  line.Label = this->Label.data() + offset;
+  return line;
 }
 
 //-----------------------------------------------------------------------------
@@ -217,17 +246,21 @@ void SpinningSensorKeypointExtractor::ComputeKeyPoints(pcl::PointCloud<Point>::P
   this->pclCurrentFrame = pc;
   this->PrepareDataForNextFrame();
   this->ConvertAndSortScanLines();
-  // Initialize the vectors with the correct length
+  // Initialize the buffers with the correct length,
+  // their capacity is kept from one frame to the next
+  this->ScanLineOffsets.resize(this->NLasers + 1);
+  this->ScanLineOffsets[0] = 0;
   for (unsigned int k = 0; k < this->NLasers; ++k)
   {
-    size_t nbPoint = this->pclCurrentFrameByScan[k]->size();
-    this->IsPointValid[k].resize(nbPoint, 1);
-    this->Label[k].resize(nbPoint, 0);
-    this->Angles[k].resize(nbPoint, 0);
-    this->SaillantPoint[k].resize(nbPoint, 0);
-    this->DepthGap[k].resize(nbPoint, 0);
-    this->IntensityGap[k].resize(nbPoint, 0);
+    this->ScanLineOffsets[k + 1] = this->ScanLineOffsets[k] + this->pclCurrentFrameByScan[k]->size();
   }
+  size_t nbPoints = this->ScanLineOffsets[this->NLasers];
+  this->IsPointValid.assign(nbPoints, 1);
+  this->Label.assign(nbPoints, 0);
+  this->Angles.assign(nbPoints, 0);
+  this->SaillantPoint.assign(nbPoints, 0);
+  this->DepthGap.assign(nbPoints, 0);
+  this->IntensityGap.assign(nbPoints, 0);
 
   // Invalid points with bad criteria
   this->InvalidPointWithBadCriteria();
@@ -241,175 +274,188 @@ void SpinningSensorKeypointExtractor::ComputeKeyPoints(pcl::PointCloud<Point>::P
 
 //-----------------------------------------------------------------------------
 void SpinningSensorKeypointExtractor::ComputeCurvature()
+{
+  ForEachScanLine(this->NLasers, this->NumberOfThreads,
+    [this](unsigned int scanLine) { this->ComputeCurvature(scanLine); });
+}
+
+//-----------------------------------------------------------------------------
+void SpinningSensorKeypointExtractor::ComputeCurvature(unsigned int scanLine)
 {
   double squaredDistToLineThreshold = std::pow(this->DistToLineThreshold, 2);
   double squaredDepthDistCoeff = 0.25;
-  // loop over scans lines
-  for (unsigned int scanLine = 0; scanLine < this->NLasers; ++scanLine)
+  ScanLineBuffers line = this->GetScanLineBuffers(scanLine);
+  Point currentPoint, nextPoint, previousPoint;
+  Eigen::Vector3d X, centralPoint;
+  LineFitting leftLine, rightLine, farNeighborsLine;
+
+  // We will compute the line that fit the neighbors located
+  // previously the current. We will do the same for the
+  // neighbors located after the current points. We will then
+  // compute the angle between these two lines as an approximation
+  // of the "sharpness" of the current point.
+  std::vector<Eigen::Vector3d> leftNeighbor(this->NeighborWidth);
+  std::vector<Eigen::Vector3d> rightNeighbor(this->NeighborWidth);
+  std::vector<Eigen::Vector3d> farNeighbors;
+  farNeighbors.reserve(3 * this->NeighborWidth);
+
+  // loop over points in the current scan line
+  int Npts = this->pclCurrentFrameByScan[scanLine]->size();
+
+  // if the line is almost empty, skip it
+  if (Npts < 2 * this->NeighborWidth + 1)
+  {
+    return;
+  }
+
+  for (int index = this->NeighborWidth; (index + this->NeighborWidth) < Npts; ++index)
   {
-    Point currentPoint, nextPoint, previousPoint;
-    Eigen::Vector3d X, centralPoint;
-    LineFitting leftLine, rightLine, farNeighborsLine;
-
-    // We will compute the line that fit the neighbors located
-    // previously the current. We will do the same for the
-    // neighbors located after the current points. We will then
-    // compute the angle between these two lines as an approximation
-    // of the "sharpness" of the current point.
-    std::vector<Eigen::Vector3d> leftNeighbor(this->NeighborWidth);
-    std::vector<Eigen::Vector3d> rightNeighbor(this->NeighborWidth);
-    std::vector<Eigen::Vector3d> farNeighbors;
-    farNeighbors.reserve(3 * this->NeighborWidth);
-
-    // loop over points in the current scan line
-    int Npts = this->pclCurrentFrameByScan[scanLine]->size();
-
-    // if the line is almost empty, skip it
-    if (Npts < 2 * this->NeighborWidth + 1)
+    // Skip curvature computation for invalid points
+    if (line.IsPointValid[index] == 0)
     {
       continue;
     }
 
-    for (int index = this->NeighborWidth; (index + this->NeighborWidth) < Npts; ++index)
-    {
-      // Skip curvature computation for invalid points
-      if (this->IsPointValid[scanLine][index] == 0)
-      {
-        continue;
-      }
-
-      // central point
-      currentPoint = this->pclCurrentFrameByScan[scanLine]->points[index];
-      centralPoint << currentPoint.x, currentPoint.y, currentPoint.z;
+    // central point
+    currentPoint = this->pclCurrentFrameByScan[scanLine]->points[index];
+    centralPoint << currentPoint.x, currentPoint.y, currentPoint.z;
 
-      // compute intensity gap
-      nextPoint = this->pclCurrentFrameByScan[scanLine]->points[index + 1];
-      previousPoint = this->pclCurrentFrameByScan[scanLine]->points[index - 1];
-      this->IntensityGap[scanLine][index] = std::abs(nextPoint.intensity - previousPoint.intensity);
+    // compute intensity gap
+    nextPoint = this->pclCurrentFrameByScan[scanLine]->points[index + 1];
+    previousPoint = this->pclCurrentFrameByScan[scanLine]->points[index - 1];
+    line.IntensityGap[index] = std::abs(nextPoint.intensity - previousPoint.intensity);
 
-      // Fill right and left neighborhood
-      // /!\ The way the neighbors are added
-      // to the vectors matters. Especially when
-      // computing the saillancy
-      for (int j = index - this->NeighborWidth; j < index; ++j)
-      {
-        currentPoint = this->pclCurrentFrameByScan[scanLine]->points[j];
-        leftNeighbor[j -index + this->NeighborWidth] << currentPoint.x, currentPoint.y, currentPoint.z;
-      }
-      for (int j = index + 1; j <= index + this->NeighborWidth; ++j)
-      {
-        currentPoint = this->pclCurrentFrameByScan[scanLine]->points[j];
-        rightNeighbor[j - index - 1] << currentPoint.x, currentPoint.y, currentPoint.z;
-      }
+    // Fill right and left neighborhood
+    // /!\ The way the neighbors are added
+    // to the vectors matters. Especially when
+    // computing the saillancy
+    for (int j = index - this->NeighborWidth; j < index; ++j)
+    {
+      currentPoint = this->pclCurrentFrameByScan[scanLine]->points[j];
+      leftNeighbor[j -index + this->NeighborWidth] << currentPoint.x, currentPoint.y, currentPoint.z;
+    }
+    for (int j = index + 1; j <= index + this->NeighborWidth; ++j)
+    {
+      currentPoint = this->pclCurrentFrameByScan[scanLine]->points[j];
+      rightNeighbor[j - index - 1] << currentPoint.x, currentPoint.y, currentPoint.z;
+    }
 
-      // Fit line on the neighborhood and
-      // Indicate if the left and right side
-      // neighborhood of the current point is flat or not
-      bool leftFlat = leftLine.FitPCAAndCheckConsistency(leftNeighbor);
-      bool rightFlat = rightLine.FitPCAAndCheckConsistency(rightNeighbor);
+    // Fit line on the neighborhood and
+    // Indicate if the left and right side
+    // neighborhood of the current point is flat or not
+    bool leftFlat = leftLine.FitPCAAndCheckConsistency(leftNeighbor);
+    bool rightFlat = rightLine.FitPCAAndCheckConsistency(rightNeighbor);
 
-      // Measurement of the gap
-      double dist1 = 0; double dist2 = 0;
+    // Measurement of the gap
+    double dist1 = 0; double dist2 = 0;
 
-      // if both neighborhood are flat we can compute
-      // the angle between them as an approximation of the
-      // sharpness of the current point
-      if (rightFlat && leftFlat)
+    // if both neighborhood are flat we can compute
+    // the angle between them as an approximation of the
+    // sharpness of the current point
+    if (rightFlat && leftFlat)
+    {
+      // We check that the current point is not too far from its
+      // neighborhood lines. This is because we don't want a point
+      // to be considered as a angles point if it is due to gap
+      dist1 = (centralPoint - leftLine.Position).transpose() * leftLine.SemiDist * (centralPoint - leftLine.Position);
+      dist2 = (centralPoint - rightLine.Position).transpose() * rightLine.SemiDist * (centralPoint - rightLine.Position);
+
+      if ((dist1 < squaredDistToLineThreshold) && (dist2 < squaredDistToLineThreshold))
+        line.Angles[index] = std::abs((leftLine.Direction.cross(rightLine.Direction)).norm()); // sin of angle actually
+    }
+    // Here one side of the neighborhood is non flat
+    // Hence it is not worth to estimate the sharpness.
+    // Only the gap will be considered here.
+    else if (rightFlat && !leftFlat)
+    {
+      dist1 = std::numeric_limits<double>::max();
+      for (unsigned int neighIndex = 0; neighIndex < leftNeighbor.size(); ++neighIndex)
       {
-        // We check that the current point is not too far from its
-        // neighborhood lines. This is because we don't want a point
-        // to be considered as a angles point if it is due to gap
-        dist1 = (centralPoint - leftLine.Position).transpose() * leftLine.SemiDist * (centralPoint - leftLine.Position);
-        dist2 = (centralPoint - rightLine.Position).transpose() * rightLine.SemiDist * (centralPoint - rightLine.Position);
-
-        if ((dist1 < squaredDistToLineThreshold) && (dist2 < squaredDistToLineThreshold))
-          this->Angles[scanLine][index] = std::abs((leftLine.Direction.cross(rightLine.Direction)).norm()); // sin of angle actually
+        dist1 = std::min(dist1,
+                ((leftNeighbor[neighIndex] - rightLine.Position).transpose() * rightLine.SemiDist * (leftNeighbor[neighIndex] - rightLine.Position))(0));
       }
-      // Here one side of the neighborhood is non flat
-      // Hence it is not worth to estimate the sharpness.
-      // Only the gap will be considered here.
-      else if (rightFlat && !leftFlat)
+      dist1 = squaredDepthDistCoeff * dist1;
+    }
+    else if (!rightFlat && leftFlat)
+    {
+      dist2 = std::numeric_limits<double>::max();
+      for (unsigned int neighIndex = 0; neighIndex < leftNeighbor.size(); ++neighIndex)
       {
-        dist1 = std::numeric_limits<double>::max();
-        for (unsigned int neighIndex = 0; neighIndex < leftNeighbor.size(); ++neighIndex)
-        {
-          dist1 = std::min(dist1,
-                  ((leftNeighbor[neighIndex] - rightLine.Position).transpose() * rightLine.SemiDist * (leftNeighbor[neighIndex] - rightLine.Position))(0));
-        }
-        dist1 = squaredDepthDistCoeff * dist1;
+        dist2 = std::min(dist2,
+                ((rightNeighbor[neighIndex] - leftLine.Position).transpose() * leftLine.SemiDist * (rightNeighbor[neighIndex] - leftLine.Position))(0));
       }
-      else if (!rightFlat && leftFlat)
+      dist2 = squaredDepthDistCoeff * dist2;
+    }
+    else
+    {
+      // Compute saillant point score
+      double currDepth = centralPoint.norm();
+      unsigned int diffDepth = 0;
+      bool canLeftBeAdded = true; bool hasLeftEncounteredDepthGap = false;
+      bool canRightBeAdded = true; bool hasRightEncounteredDepthGap = false;
+
+      // The saillant point score is the distance between the current point
+      // and the points that have a depth gap with the current point
+      farNeighbors.resize(0);
+      for (unsigned int neighIndex = 0; neighIndex < leftNeighbor.size(); ++neighIndex)
       {
-        dist2 = std::numeric_limits<double>::max();
-        for (unsigned int neighIndex = 0; neighIndex < leftNeighbor.size(); ++neighIndex)
+        // Left neighborhood depth gap computation
+        if ((std::abs(leftNeighbor[leftNeighbor.size() - 1 - neighIndex].norm() - currDepth) > 1.5) && canLeftBeAdded)
         {
-          dist2 = std::min(dist2,
-                  ((rightNeighbor[neighIndex] - leftLine.Position).transpose() * leftLine.SemiDist * (rightNeighbor[neighIndex] - leftLine.Position))(0));
+          hasLeftEncounteredDepthGap = true;
+          diffDepth++;
+          farNeighbors.emplace_back(leftNeighbor[neighIndex]);
         }
-        dist2 = squaredDepthDistCoeff * dist2;
-      }
-      else
-      {
-        // Compute saillant point score
-        double currDepth = centralPoint.norm();
-        unsigned int diffDepth = 0;
-        bool canLeftBeAdded = true; bool hasLeftEncounteredDepthGap = false;
-        bool canRightBeAdded = true; bool hasRightEncounteredDepthGap = false;
-
-        // The saillant point score is the distance between the current point
-        // and the points that have a depth gap with the current point
-        farNeighbors.resize(0);
-        for (unsigned int neighIndex = 0; neighIndex < leftNeighbor.size(); ++neighIndex)
+        else
         {
-          // Left neighborhood depth gap computation
-          if ((std::abs(leftNeighbor[leftNeighbor.size() - 1 - neighIndex].norm() - currDepth) > 1.5) && canLeftBeAdded)
+          if (hasLeftEncounteredDepthGap)
           {
-            hasLeftEncounteredDepthGap = true;
-            diffDepth++;
-            farNeighbors.emplace_back(leftNeighbor[neighIndex]);
+            canLeftBeAdded = false;
           }
-          else
-          {
-            if (hasLeftEncounteredDepthGap)
-            {
-              canLeftBeAdded = false;
-            }
-          }
-          // Right neigborhood depth gap computation
-          if ((std::abs(rightNeighbor[neighIndex].norm() - currDepth) > 1.5) && canRightBeAdded)
-          {
-            hasRightEncounteredDepthGap = true;
-            diffDepth++;
-            farNeighbors.emplace_back(rightNeighbor[neighIndex]);
-          }
-          else
+        }
+        // Right neigborhood depth gap computation
+        if ((std::abs(rightNeighbor[neighIndex].norm() - currDepth) > 1.5) && canRightBeAdded)
+        {
+          hasRightEncounteredDepthGap = true;
+          diffDepth++;
+          farNeighbors.emplace_back(rightNeighbor[neighIndex]);
+        }
+        else
+        {
+          if (hasRightEncounteredDepthGap)
           {
-            if (hasRightEncounteredDepthGap)
-            {
-              canRightBeAdded = false;
-            }
+            canRightBeAdded = false;
           }
         }
+      }
 
-        // If there is enought neighbors with a big depth gap
-        // we propose to compute the saillancy of the current
-        // as the distance between the line that fits the neighbors
-        // with a depth gap and the current point
-        if (static_cast<double>(diffDepth) / (2.0 * this->NeighborWidth) > 0.5)
-        {
-          farNeighborsLine.FitPCA(farNeighbors);
-          this->SaillantPoint[scanLine][index] =
-            (centralPoint - farNeighborsLine.Position).transpose() * farNeighborsLine.SemiDist * (centralPoint - farNeighborsLine.Position);
-        }
+      // If there is enought neighbors with a big depth gap
+      // we propose to compute the saillancy of the current
+      // as the distance between the line that fits the neighbors
+      // with a depth gap and the current point
+      if (static_cast<double>(diffDepth) / (2.0 * this->NeighborWidth) > 0.5)
+      {
+        farNeighborsLine.FitPCA(farNeighbors);
+        line.SaillantPoint[index] =
+          (centralPoint - farNeighborsLine.Position).transpose() * farNeighborsLine.SemiDist * (centralPoint - farNeighborsLine.Position);
       }
-      this->DepthGap[scanLine][index] = std::max(dist1, dist2);
     }
+    line.DepthGap[index] = std::max(dist1, dist2);
   }
 }
 
 //-----------------------------------------------------------------------------
 void SpinningSensorKeypointExtractor::InvalidPointWithBadCriteria()
 {
+  ForEachScanLine(this->NLasers, this->NumberOfThreads,
+    [this](unsigned int scanLine) { this->InvalidPointWithBadCriteria(scanLine); });
+}
+
+//-----------------------------------------------------------------------------
+void SpinningSensorKeypointExtractor::InvalidPointWithBadCriteria(unsigned int scanLine)
+{
+  ScanLineBuffers line = this->GetScanLineBuffers(scanLine);
+
   // Temporary variables used in the next loop
   Eigen::Vector3d dX, X, Xn, Xp, Xproj, dXproj;
   Eigen::Vector3d Y, Yn, Yp, dY;
@@ -417,121 +463,117 @@ void SpinningSensorKeypointExtractor::InvalidPointWithBadCriteria()
   Point currentPoint, nextPoint, previousPoint;
   Point temp;
 
-  // loop over scan lines
-  for (unsigned int scanLine = 0; scanLine < this->NLasers; ++scanLine)
-  {
-    int Npts = this->pclCurrentFrameByScan[scanLine]->size();
+  int Npts = this->pclCurrentFrameByScan[scanLine]->size();
 
-    // if the line is almost empty, skip it
-    if (Npts < 3 * this->NeighborWidth)
-    {
-      continue;
-    }
-    // invalidate first and last points
-    for (int index = 0; index <= this->NeighborWidth; ++index)
-    {
-      this->IsPointValid[scanLine][index] = 0;
-    }
-    for (int index = Npts - 1 - this->NeighborWidth - 1; index < Npts; ++index)
-    {
-      this->IsPointValid[scanLine][index] = 0;
-    }
+  // if the line is almost empty, skip it
+  if (Npts < 3 * this->NeighborWidth)
+  {
+    return;
+  }
+  // invalidate first and last points
+  for (int index = 0; index <= this->NeighborWidth; ++index)
+  {
+    line.IsPointValid[index] = 0;
+  }
+  for (int index = Npts - 1 - this->NeighborWidth - 1; index < Npts; ++index)
+  {
+    line.IsPointValid[index] = 0;
+  }
 
-    // loop over points into the scan line
-    for (int index = this->NeighborWidth; index <  Npts - this->NeighborWidth - 1; ++index)
+  // loop over points into the scan line
+  for (int index = this->NeighborWidth; index <  Npts - this->NeighborWidth - 1; ++index)
+  {
+    currentPoint = this->pclCurrentFrameByScan[scanLine]->points[index];
+    nextPoint = this->pclCurrentFrameByScan[scanLine]->points[index + 1];
+    previousPoint = this->pclCurrentFrameByScan[scanLine]->points[index - 1];
+    X << currentPoint.x, currentPoint.y, currentPoint.z;
+    Xn << nextPoint.x, nextPoint.y, nextPoint.z;
+    Xp << previousPoint.x, previousPoint.y, previousPoint.z;
+    dX = Xn - X;
+    L = X.norm();
+    Ln = Xn.norm();
+    dLn = dX.norm();
+
+    // the expected length between two firing of the same laser
+    // depend on the distance and the angular resolution of the
+    // sensor.
+    expectedLength = 2.0 *  std::tan(this->AngleResolution / 2.0) * L;
+    double ratioExpectedLength = 10.0;
+
+    // if the length between the two firing
+    // is more than n-th the expected length
+    // it means that there is a gap. We now must
+    // determine if the gap is due to the geometry of
+    // the scene or if the gap is due to an occluded area
+    if (dLn > ratioExpectedLength * expectedLength)
     {
-      currentPoint = this->pclCurrentFrameByScan[scanLine]->points[index];
-      nextPoint = this->pclCurrentFrameByScan[scanLine]->points[index + 1];
-      previousPoint = this->pclCurrentFrameByScan[scanLine]->points[index - 1];
-      X << currentPoint.x, currentPoint.y, currentPoint.z;
-      Xn << nextPoint.x, nextPoint.y, nextPoint.z;
-      Xp << previousPoint.x, previousPoint.y, previousPoint.z;
-      dX = Xn - X;
-      L = X.norm();
-      Ln = Xn.norm();
-      dLn = dX.norm();
-
-      // the expected length between two firing of the same laser
-      // depend on the distance and the angular resolution of the
-      // sensor.
-      expectedLength = 2.0 *  std::tan(this->AngleResolution / 2.0) * L;
-      double ratioExpectedLength = 10.0;
-
-      // if the length between the two firing
-      // is more than n-th the expected length
-      // it means that there is a gap. We now must
-      // determine if the gap is due to the geometry of
-      // the scene or if the gap is due to an occluded area
-      if (dLn > ratioExpectedLength * expectedLength)
+      // Project the next point onto the
+      // sphere of center 0 and radius =
+      // norm of the current point. If the
+      // gap has disappeared it means that
+      // the gap was due to an occlusion
+      Xproj = L / Ln * Xn;
+      dXproj = Xproj - X;
+      // it is a depth gap, invalidate the part which belong
+      // to the occluded area (farest)
+      // invalid next part
+      if (L < Ln)
       {
-        // Project the next point onto the
-        // sphere of center 0 and radius =
-        // norm of the current point. If the
-        // gap has disappeared it means that
-        // the gap was due to an occlusion
-        Xproj = L / Ln * Xn;
-        dXproj = Xproj - X;
-        // it is a depth gap, invalidate the part which belong
-        // to the occluded area (farest)
-        // invalid next part
-        if (L < Ln)
+        for (int i = index + 1; i <= index + this->NeighborWidth; ++i)
         {
-          for (int i = index + 1; i <= index + this->NeighborWidth; ++i)
+          if (i > index + 1)
           {
-            if (i > index + 1)
+            temp = this->pclCurrentFrameByScan[scanLine]->points[i - 1];
+            Yp << temp.x, temp.y, temp.z;
+            temp = this->pclCurrentFrameByScan[scanLine]->points[i];
+            Y << temp.x, temp.y, temp.z;
+            dY = Y - Yp;
+            // if there is a gap in the neihborhood
+            // we do not invalidate the rest of neihborhood
+            if (dY.norm() > ratioExpectedLength * expectedLength)
             {
-              temp = this->pclCurrentFrameByScan[scanLine]->points[i - 1];
-              Yp << temp.x, temp.y, temp.z;
-              temp = this->pclCurrentFrameByScan[scanLine]->points[i];
-              Y << temp.x, temp.y, temp.z;
-              dY = Y - Yp;
-              // if there is a gap in the neihborhood
-              // we do not invalidate the rest of neihborhood
-              if (dY.norm() > ratioExpectedLength * expectedLength)
-              {
-                break;
-              }
+              break;
             }
-            this->IsPointValid[scanLine][i] = 0;
           }
+          line.IsPointValid[i] = 0;
         }
-        // invalid previous part
-        else
+      }
+      // invalid previous part
+      else
+      {
+        for (int i = index - this->NeighborWidth; i <= index; ++i)
         {
-          for (int i = index - this->NeighborWidth; i <= index; ++i)
+          if (i < index)
           {
-            if (i < index)
+            temp = this->pclCurrentFrameByScan[scanLine]->points[i + 1];
+            Yn << temp.x, temp.y, temp.z;
+            temp = this->pclCurrentFrameByScan[scanLine]->points[i];
+            Y << temp.x, temp.y, temp.z;
+            dY = Yn - Y;
+            // if there is a gap in the neihborhood
+            // we do not invalidate the rest of neihborhood
+            if (dY.norm() > ratioExpectedLength * expectedLength)
             {
-              temp = this->pclCurrentFrameByScan[scanLine]->points[i + 1];
-              Yn << temp.x, temp.y, temp.z;
-              temp = this->pclCurrentFrameByScan[scanLine]->points[i];
-              Y << temp.x, temp.y, temp.z;
-              dY = Yn - Y;
-              // if there is a gap in the neihborhood
-              // we do not invalidate the rest of neihborhood
-              if (dY.norm() > ratioExpectedLength * expectedLength)
-              {
-                break;
-              }
+              break;
             }
-            this->IsPointValid[scanLine][i] = 0;
           }
+          line.IsPointValid[i] = 0;
         }
       }
-      // Invalid points which are too close from the sensor
-      if (L < this->MinDistanceToSensor)
-      {
-        this->IsPointValid[scanLine][index] = 0;
-      }
+    }
+    // Invalid points which are too close from the sensor
+    if (L < this->MinDistanceToSensor)
+    {
+      line.IsPointValid[index] = 0;
+    }
 
-      // Invalid points which are on a planar
-      // surface nearly parallel to the laser
-      // beam direction
-      dLp = (X - Xp).norm();
-      if ((dLp > 1 / 4.0 * ratioExpectedLength * expectedLength) && (dLn > 1 / 4.0 * ratioExpectedLength * expectedLength))
-      {
-        this->IsPointValid[scanLine][index] = 0;
-      }
+    // Invalid points which are on a planar
+    // surface nearly parallel to the laser
+    // beam direction
+    dLp = (X - Xp).norm();
+    if ((dLp > 1 / 4.0 * ratioExpectedLength * expectedLength) && (dLn > 1 / 4.0 * ratioExpectedLength * expectedLength))
+    {
+      line.IsPointValid[index] = 0;
     }
   }
 }
@@ -539,229 +581,42 @@ void SpinningSensorKeypointExtractor::InvalidPointWithBadCriteria()
 //-----------------------------------------------------------------------------
 void SpinningSensorKeypointExtractor::SetKeyPointsLabels()
 {
+  // We split the validity of points between the edges
+  // keypoints and planar keypoints. This allows to take
+  // some points as planar keypoints even if they are close
+  // to an edge keypoint.
+  this->IsPointValidForPlanar = this->IsPointValid;
+
+  // the sorted indexes are fully written by each scan line
+  size_t nbPoints = this->ScanLineOffsets[this->NLasers];
+  this->SortedDepthGapIdx.resize(nbPoints);
+  this->SortedAnglesIdx.resize(nbPoints);
+  this->SortedSaillancyIdx.resize(nbPoints);
+  this->SortedIntensityGapIdx.resize(nbPoints);
+
+  this->EdgesIndexByScan.resize(this->NLasers);
+  this->PlanarIndexByScan.resize(this->NLasers);
+  this->BlobIndexByScan.resize(this->NLasers);
+  ForEachScanLine(this->NLasers, this->NumberOfThreads,
+    [this](unsigned int scanLine) { this->SetKeyPointsLabels(scanLine); });
+
+  // gather the keypoints of all the scan lines
   this->EdgesIndex.clear(); this->EdgesIndex.resize(0);
   this->PlanarIndex.clear(); this->PlanarIndex.resize(0);
   this->BlobIndex.clear(); this->BlobIndex.resize(0);
-  double squaredEdgeDepthGapThreshold = std::pow(this->EdgeDepthGapThreshold, 2);
-
-  // loop over the scan lines
   for (unsigned int scanLine = 0; scanLine < this->NLasers; ++scanLine)
   {
-    int Npts = this->pclCurrentFrameByScan[scanLine]->size();
-    unsigned int nbrEdgePicked = 0;
-    unsigned int nbrPlanarPicked = 0;
-
-    // We split the validity of points between the edges
-    // keypoints and planar keypoints. This allows to take
-    // some points as planar keypoints even if they are close
-    // to an edge keypoint.
-    std::vector<double> IsPointValidForPlanar = this->IsPointValid[scanLine];
-
-    // if the line is almost empty, skip it
-    if (Npts < 3 * this->NeighborWidth)
+    for (int index : this->EdgesIndexByScan[scanLine])
     {
-      continue;
-    }
-
-    // Sort the curvature score in a decreasing order
-    std::vector<size_t> sortedDepthGapIdx = sortIdx<double>(this->DepthGap[scanLine]);
-    std::vector<size_t> sortedAnglesIdx = sortIdx<double>(this->Angles[scanLine]);
-    std::vector<size_t> sortedSaillancyIdx = sortIdx<double>(this->SaillantPoint[scanLine]);
-    std::vector<size_t> sortedIntensityGap = sortIdx<double>(this->IntensityGap[scanLine]);
-
-    double depthGap, sinAngle, saillancy, intensity;
-    int index = 0;
-
-    // Edges using depth gap
-    for (int k = 0; k < Npts; ++k)
-    {
-      index = sortedDepthGapIdx[k];
-      depthGap = this->DepthGap[scanLine][index];
-
-      // thresh
-      if (depthGap < squaredEdgeDepthGapThreshold)
-      {
-        break;
-      }
-
-      // if the point is invalid continue
-      if (this->IsPointValid[scanLine][index] == 0)
-      {
-        continue;
-      }
-
-      // else indicate that the point is an edge
-      this->Label[scanLine][index] = 4;
       this->EdgesIndex.push_back(std::pair<int, int>(scanLine, index));
-      nbrEdgePicked++;
-      //IsPointValidForPlanar[index] = 0;
-
-      // invalid its neighborhod
-      int indexBegin = index - this->NeighborWidth + 1;
-      int indexEnd = index + this->NeighborWidth - 1;
-      indexBegin = std::max(0, indexBegin);
-      indexEnd = std::min(Npts - 1, indexEnd);
-      for (int j = indexBegin; j <= indexEnd; ++j)
-      {
-        this->IsPointValid[scanLine][j] = 0;
-      }
     }
-
-    // Edges using angles
-    for (int k = 0; k < Npts; ++k)
+    for (int index : this->PlanarIndexByScan[scanLine])
     {
-      index = sortedAnglesIdx[k];
-      sinAngle = this->Angles[scanLine][index];
-
-      // thresh
-      if (sinAngle < this->EdgeSinAngleThreshold)
-      {
-        break;
-      }
-
-      // if the point is invalid continue
-      if (this->IsPointValid[scanLine][index] == 0)
-      {
-        continue;
-      }
-
-      // else indicate that the point is an edge
-      this->Label[scanLine][index] = 4;
-      this->EdgesIndex.push_back(std::pair<int, int>(scanLine, index));
-      nbrEdgePicked++;
-      //IsPointValidForPlanar[index] = 0;
-
-      // invalid its neighborhod
-      int indexBegin = index - this->NeighborWidth;
-      int indexEnd = index + this->NeighborWidth;
-      indexBegin = std::max(0, indexBegin);
-      indexEnd = std::min(Npts - 1, indexEnd);
-      for (int j = indexBegin; j <= indexEnd; ++j)
-      {
-        this->IsPointValid[scanLine][j] = 0;
-      }
-    }
-
-    // Edges using saillancy
-    for (int k = 0; k < Npts; ++k)
-    {
-      index = sortedSaillancyIdx[k];
-      saillancy = this->SaillantPoint[scanLine][index];
-
-      // thresh
-      if (saillancy < this->SaillancyThreshold)
-      {
-        break;
-      }
-
-      // if the point is invalid continue
-      if (this->IsPointValid[scanLine][index] == 0)
-      {
-        continue;
-      }
-
-      // else indicate that the point is an edge
-      this->Label[scanLine][index] = 4;
-      this->EdgesIndex.push_back(std::pair<int, int>(scanLine, index));
-      nbrEdgePicked++;
-      //IsPointValidForPlanar[index] = 0;
-
-      // invalid its neighborhod
-      int indexBegin = index - this->NeighborWidth + 1;
-      int indexEnd = index + this->NeighborWidth - 1;
-      indexBegin = std::max(0, indexBegin);
-      indexEnd = std::min(Npts - 1, indexEnd);
-      for (int j = indexBegin; j <= indexEnd; ++j)
-      {
-        this->IsPointValid[scanLine][j] = 0;
-      }
+      this->PlanarIndex.push_back(std::pair<int, int>(scanLine, index));
     }
-
-    // Edges using intensity
-    for (int k = 0; k < Npts; ++k)
+    for (int index : this->BlobIndexByScan[scanLine])
     {
-      index = sortedIntensityGap[k];
-      intensity = this->IntensityGap[scanLine][index];
-
-      // thresh
-      if (intensity < 50.0)
-      {
-        break;
-      }
-
-      // if the point is invalid continue
-      if (this->IsPointValid[scanLine][index] == 0)
-      {
-        continue;
-      }
-
-      // else indicate that the point is an edge
-      this->Label[scanLine][index] = 4;
-      this->EdgesIndex.push_back(std::pair<int, int>(scanLine, index));
-      nbrEdgePicked++;
-      //IsPointValidForPlanar[index] = 0;
-
-      // invalid its neighborhood
-      int indexBegin = index - 1;
-      int indexEnd = index + 1;
-      indexBegin = std::max(0, indexBegin);
-      indexEnd = std::min(Npts - 1, indexEnd);
-      for (int j = indexBegin; j <= indexEnd; ++j)
-      {
-        this->IsPointValid[scanLine][j] = 0;
-      }
-    }
-
-    // Blobs Points
-//    if (!this->FastSlam)
-//    {
-      for (int k = 0; k < Npts; k = k + 3)
-      {
-        this->BlobIndex.push_back(std::pair<int, int>(scanLine, k));
-      }
-//    }
-
-    // Planes
-    for (int k = Npts - 1; k >= 0; --k)
-    {
-      index = sortedAnglesIdx[k];
-      sinAngle = this->Angles[scanLine][index];
-
-      // thresh
-      if (sinAngle > this->PlaneSinAngleThreshold)
-      {
-        break;
-      }
-
-      // if the point is invalid continue
-      if (IsPointValidForPlanar[index] == 0)
-      {
-        continue;
-      }
-
-      // else indicate that the point is a planar one
-      if ((this->Label[scanLine][index] != 4) && (this->Label[scanLine][index] != 3))
-        this->Label[scanLine][index] = 2;
-      this->PlanarIndex.push_back(std::pair<int, int>(scanLine, index));
-      IsPointValidForPlanar[index] = 0;
-      this->IsPointValid[scanLine][index] = 0;
-
-      // Invalid its neighbor so that we don't have too
-      // many planar keypoints in the same region. This is
-      // required because of the k-nearest search + plane
-      // approximation realized in the odometry part. Indeed,
-      // if all the planar points are on the same scan line the
-      // problem is degenerated since all the points are distributed
-      // on a line.
-      int indexBegin = index - 4;
-      int indexEnd = index + 4;
-      indexBegin = std::max(0, indexBegin);
-      indexEnd = std::min(Npts - 1, indexEnd);
-      for (int j = indexBegin; j <= indexEnd; ++j)
-      {
-        IsPointValidForPlanar[j] = 0;
-      }
-      nbrPlanarPicked++;
+      this->BlobIndex.push_back(std::pair<int, int>(scanLine, index));
     }
   }
 
@@ -772,6 +627,9 @@ void SpinningSensorKeypointExtractor::SetKeyPointsLabels()
 
   // fill the keypoints vectors and compute the max dist keypoints
   this->FarestKeypointDist = 0.0;
+  this->EdgesPoints->reserve(this->EdgesIndex.size());
+  this->PlanarsPoints->reserve(this->PlanarIndex.size());
+  this->BlobsPoints->reserve(this->BlobIndex.size());
   Point p;
   for (unsigned int k = 0; k < this->EdgesIndex.size(); ++k)
   {
@@ -799,17 +657,247 @@ void SpinningSensorKeypointExtractor::SetKeyPointsLabels()
             << this->BlobsPoints->size() << std::endl;
 }
 
+//-----------------------------------------------------------------------------
+void SpinningSensorKeypointExtractor::SetKeyPointsLabels(unsigned int scanLine)
+{
+  double squaredEdgeDepthGapThreshold = std::pow(this->EdgeDepthGapThreshold, 2);
+  ScanLineBuffers line = this->GetScanLineBuffers(scanLine);
+  double* IsPointValidForPlanar = this->IsPointValidForPlanar.data() + this->ScanLineOffsets[scanLine];
+  std::vector<int>& edgesIndex = this->EdgesIndexByScan[scanLine];
+  std::vector<int>& planarIndex = this->PlanarIndexByScan[scanLine];
+  std::vector<int>& blobIndex = this->BlobIndexByScan[scanLine];
+  edgesIndex.clear();
+  planarIndex.clear();
+  blobIndex.clear();
+
+  int Npts = this->pclCurrentFrameByScan[scanLine]->size();
+  unsigned int nbrEdgePicked = 0;
+  unsigned int nbrPlanarPicked = 0;
+
+  // if the line is almost empty, skip it
+  if (Npts < 3 * this->NeighborWidth)
+  {
+    return;
+  }
+
+  // Sort the curvature score in a decreasing order
+  const size_t offset = this->ScanLineOffsets[scanLine];
+  size_t* sortedDepthGapIdx = this->SortedDepthGapIdx.data() + offset;
+  size_t* sortedAnglesIdx = this->SortedAnglesIdx.data() + offset;
+  size_t* sortedSaillancyIdx = this->SortedSaillancyIdx.data() + offset;
+  size_t* sortedIntensityGap = this->SortedIntensityGapIdx.data() + offset;
+  sortIdx<double>(line.DepthGap, Npts, sortedDepthGapIdx);
+  sortIdx<double>(line.Angles, Npts, sortedAnglesIdx);
+  sortIdx<double>(line.SaillantPoint, Npts, sortedSaillancyIdx);
+  sortIdx<double>(line.IntensityGap, Npts, sortedIntensityGap);
+
+  double depthGap, sinAngle, saillancy, intensity;
+  int index = 0;
+
+  // Edges using depth gap
+  for (int k = 0; k < Npts; ++k)
+  {
+    index = sortedDepthGapIdx[k];
+    depthGap = line.DepthGap[index];
+
+    // thresh
+    if (depthGap < squaredEdgeDepthGapThreshold)
+    {
+      break;
+    }
+
+    // if the point is invalid continue
+    if (line.IsPointValid[index] == 0)
+    {
+      continue;
+    }
+
+    // else indicate that the point is an edge
+    line.Label[index] = 4;
+    edgesIndex.push_back(index);
+    nbrEdgePicked++;
+    //IsPointValidForPlanar[index] = 0;
+
+    // invalid its neighborhod
+    int indexBegin = index - this->NeighborWidth + 1;
+    int indexEnd = index + this->NeighborWidth - 1;
+    indexBegin = std::max(0, indexBegin);
+    indexEnd = std::min(Npts - 1, indexEnd);
+    for (int j = indexBegin; j <= indexEnd; ++j)
+    {
+      line.IsPointValid[j] = 0;
+    }
+  }
+
+  // Edges using angles
+  for (int k = 0; k < Npts; ++k)
+  {
+    index = sortedAnglesIdx[k];
+    sinAngle = line.Angles[index];
+
+    // thresh
+    if (sinAngle < this->EdgeSinAngleThreshold)
+    {
+      break;
+    }
+
+    // if the point is invalid continue
+    if (line.IsPointValid[index] == 0)
+    {
+      continue;
+    }
+
+    // else indicate that the point is an edge
+    line.Label[index] = 4;
+    edgesIndex.push_back(index);
+    nbrEdgePicked++;
+    //IsPointValidForPlanar[index] = 0;
+
+    // invalid its neighborhod
+    int indexBegin = index - this->NeighborWidth;
+    int indexEnd = index + this->NeighborWidth;
+    indexBegin = std::max(0, indexBegin);
+    indexEnd = std::min(Npts - 1, indexEnd);
+    for (int j = indexBegin; j <= indexEnd; ++j)
+    {
+      line.IsPointValid[j] = 0;
+    }
+  }
+
+  // Edges using saillancy
+  for (int k = 0; k < Npts; ++k)
+  {
+    index = sortedSaillancyIdx[k];
+    saillancy = line.SaillantPoint[index];
+
+    // thresh
+    if (saillancy < this->SaillancyThreshold)
+    {
+      break;
+    }
+
+    // if the point is invalid continue
+    if (line.IsPointValid[index] == 0)
+    {
+      continue;
+    }
+
+    // else indicate that the point is an edge
+    line.Label[index] = 4;
+    edgesIndex.push_back(index);
+    nbrEdgePicked++;
+    //IsPointValidForPlanar[index] = 0;
+
+    // invalid its neighborhod
+    int indexBegin = index - this->NeighborWidth + 1;
+    int indexEnd = index + this->NeighborWidth - 1;
+    indexBegin = std::max(0, indexBegin);
+    indexEnd = std::min(Npts - 1, indexEnd);
+    for (int j = indexBegin; j <= indexEnd; ++j)
+    {
+      line.IsPointValid[j] = 0;
+    }
+  }
+
+  // Edges using intensity
+  for (int k = 0; k < Npts; ++k)
+  {
+    index = sortedIntensityGap[k];
+    intensity = line.IntensityGap[index];
+
+    // thresh
+    if (intensity < 50.0)
+    {
+      break;
+    }
+
+    // if the point is invalid continue
+    if (line.IsPointValid[index] == 0)
+    {
+      continue;
+    }
+
+    // else indicate that the point is an edge
+    line.Label[index] = 4;
+    edgesIndex.push_back(index);
+    nbrEdgePicked++;
+    //IsPointValidForPlanar[index] = 0;
+
+    // invalid its neighborhood
+    int indexBegin = index - 1;
+    int indexEnd = index + 1;
+    indexBegin = std::max(0, indexBegin);
+    indexEnd = std::min(Npts - 1, indexEnd);
+    for (int j = indexBegin; j <= indexEnd; ++j)
+    {
+      line.IsPointValid[j] = 0;
+    }
+  }
+
+  // Blobs Points
+//    if (!this->FastSlam)
+//    {
+    for (int k = 0; k < Npts; k = k + 3)
+    {
+      blobIndex.push_back(k);
+    }
+//    }
+
+  // Planes
+  for (int k = Npts - 1; k >= 0; --k)
+  {
+    index = sortedAnglesIdx[k];
+    sinAngle = line.Angles[index];
+
+    // thresh
+    if (sinAngle > this->PlaneSinAngleThreshold)
+    {
+      break;
+    }
+
+    // if the point is invalid continue
+    if (IsPointValidForPlanar[index] == 0)
+    {
+      continue;
+    }
+
+    // else indicate that the point is a planar one
+    if ((line.Label[index] != 4) && (line.Label[index] != 3))
+      line.Label[index] = 2;
+    planarIndex.push_back(index);
+    IsPointValidForPlanar[index] = 0;
+    line.IsPointValid[index] = 0;
+
+    // Invalid its neighbor so that we don't have too
+    // many planar keypoints in the same region. This is
+    // required because of the k-nearest search + plane
+    // approximation realized in the odometry part. Indeed,
+    // if all the planar points are on the same scan line the
+    // problem is degenerated since all the points are distributed
+    // on a line.
+    int indexBegin = index - 4;
+    int indexEnd = index + 4;
+    indexBegin = std::max(0, indexBegin);
+    indexEnd = std::min(Npts - 1, indexEnd);
+    for (int j = indexBegin; j <= indexEnd; ++j)
+    {
+      IsPointValidForPlanar[j] = 0;
+    }
+    nbrPlanarPicked++;
+  }
+}
+
 //-----------------------------------------------------------------------------
 std::unordered_map<std::string, std::vector<double> >
 SpinningSensorKeypointExtractor::GetDebugArray()
 {
-  auto get1DVector =  [this](std::vector<std::vector<double>> array) {
+  auto get1DVector =  [this](const std::vector<double>& array) {
     std::vector<double> v (this->pclCurrentFrame->size());
-    std::vector<int> indexPerByScanLine(this->NLasers, 0);
+    std::vector<size_t> indexPerByScanLine(this->ScanLineOffsets.begin(), this->ScanLineOffsets.end() - 1);
     for (int i = 0; i < this->pclCurrentFrame->size(); i++)
     {
-      double laserId = this->LaserIdMapping[this->pclCurrentFrame->points[i].laserId];
-      v[i] = array[laserId][indexPerByScanLine[laserId]];
+      size_t laserId = this->LaserIdMapping[this->pclCurrentFrame->points[i].laserId];
+      v[i] = array[indexPerByScanLine[laserId]];
       indexPerByScanLine[laserId]++;
     }
     return v;
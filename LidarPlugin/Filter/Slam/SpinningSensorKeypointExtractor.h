@@ -61,6 +61,9 @@ public:
 
   GetMacro(NLasers, int)
 
+  GetMacro(NumberOfThreads, unsigned int)
+  SetMacro(NumberOfThreads, unsigned int)
+
   pcl::PointCloud<Point>::Ptr GetEdgePoints() { return this->EdgesPoints; }
   pcl::PointCloud<Point>::Ptr GetPlanarPoints() { return this->PlanarsPoints; }
   pcl::PointCloud<Point>::Ptr GetBlobPoints() { return this->BlobsPoints; }
@@ -84,11 +87,24 @@ private:
   // will also be sorted by their vertical angles
   void ConvertAndSortScanLines();
 
+  // Views on the values of a scan line in the flat buffers
+  struct ScanLineBuffers
+  {
+    double* Angles;
+    double* DepthGap;
+    double* SaillantPoint;
+    double* IntensityGap;
+    double* IsPointValid;
+    double* Label;
+  };
+  ScanLineBuffers GetScanLineBuffers(unsigned int scanLine);
+
   // Compute the curvature of the scan lines
   // The curvature is not the one of the surface
   // that intersected the lines but the curvature
   // of the scan lines taken in an isolated way
   void ComputeCurvature();
+  void ComputeCurvature(unsigned int scanLine);
 
   // Invalid the points with bad criteria from
   // the list of possible future keypoints.
@@ -96,9 +112,11 @@ private:
   // roughtly parallel to laser beam and points
   // close to a gap created by occlusion
   void InvalidPointWithBadCriteria();
+  void InvalidPointWithBadCriteria(unsigned int scanLine);
 
   // Labelizes point to be a keypoints or not
   void SetKeyPointsLabels();
+  void SetKeyPointsLabels(unsigned int scanLine);
 
   // with of the neighbor used to compute discrete
   // differential operators
@@ -129,6 +147,10 @@ private:
   // radius of the blob neighborhood
   double IncertitudeCoef = 3.0;
 
+  // Number of threads processing the scan lines,
+  // 0 means one per hardware thread
+  unsigned int NumberOfThreads = 0;
+
   // Mapping of the lasers id
   std::vector<size_t> LaserIdMapping;
 
@@ -138,14 +160,25 @@ private:
   // norm of the farest keypoints
   double FarestKeypointDist = 0;
 
-  // Curvature and over differntial operations
-  // scan by scan; point by point
-  std::vector<std::vector<double>> Angles;
-  std::vector<std::vector<double>> DepthGap;
-  std::vector<std::vector<double>> SaillantPoint;
-  std::vector<std::vector<double>> IntensityGap;
-  std::vector<std::vector<double>> IsPointValid;
-  std::vector<std::vector<double>> Label;
+  // Curvature and over differntial operations point by point,
+  // stored contiguously scan by scan: the values of the scan k
+  // begin at ScanLineOffsets[k]. The buffers are reused from one
+  // frame to the next.
+  std::vector<size_t> ScanLineOffsets;
+  std::vector<double> Angles;
+  std::vector<double> DepthGap;
+  std::vector<double> SaillantPoint;
+  std::vector<double> IntensityGap;
+  std::vector<double> IsPointValid;
+  std::vector<double> IsPointValidForPlanar;
+  std::vector<double> Label;
+
+  // Indexes of the points of each scan sorted by decreasing
+  // scores, stored the same way than the scores
+  std::vector<size_t> SortedDepthGapIdx;
+  std::vector<size_t> SortedAnglesIdx;
+  std::vector<size_t> SortedSaillancyIdx;
+  std::vector<size_t> SortedIntensityGapIdx;
 
   // Mapping between keypoints and their corresponding
   // index in the vtk input frame
@@ -153,6 +186,11 @@ private:
   std::vector<std::pair<int, int>> PlanarIndex;
   std::vector<std::pair<int, int>> BlobIndex;
 
+  // Index of the keypoints picked in each scan line
+  std::vector<std::vector<int>> EdgesIndexByScan;
+  std::vector<std::vector<int>> PlanarIndexByScan;
+  std::vector<std::vector<int>> BlobIndexByScan;
+
   pcl::PointCloud<Point>::Ptr EdgesPoints;
   pcl::PointCloud<Point>::Ptr PlanarsPoints;
   pcl::PointCloud<Point>::Ptr BlobsPoints;
@@ -19,7 +19,10 @@
 
 #include "TrajectoryReoptimization.h"
 // STD
+#include <algorithm>
 #include <iostream>
+// BOOST
+#include <boost/thread/thread.hpp>
 // PCL
 #include <pcl/kdtree/kdtree_flann.h>
 // CERES
@@ -71,37 +74,40 @@ PoseEstimationVector RelativePosesFromAbsolutePoses(const PoseEstimationVector&
   return relativePoses;
 }
 
+namespace
+{
+using Correction = Eigen::Matrix<double, 6, 1>;
+using CorrectionVector = std::vector<Correction, Eigen::aligned_allocator<Correction> >;
+
 //-----------------------------------------------------------------------------
-PoseEstimationVector TrajectoryReoptimization(const PoseEstimationVector& absolutePoses,
-                                              const Eigen::Matrix4d& H, int gtIndex, int maxIteration,
-                                              MeasureProvided dataMode)
+unsigned int NumberOfThreads(unsigned int numberOfThreads)
 {
-  std::vector<Eigen::Matrix4d> HList;
-  std::vector<int> gtIndexList;
-  HList.push_back(H);
-  gtIndexList.push_back(gtIndex);
-  return TrajectoryReoptimization(absolutePoses, HList, gtIndexList, maxIteration, dataMode);
+  return (numberOfThreads == 0) ? std::max(1u, boost::thread::hardware_concurrency()) : numberOfThreads;
 }
 
 //-----------------------------------------------------------------------------
-PoseEstimationVector TrajectoryReoptimization(const PoseEstimationVector& absolutePoses,
-                                              const std::vector<Eigen::Matrix4d>& H, std::vector<int> gtIndex,
-                                              int maxIteration, MeasureProvided dataMode)
+Eigen::Matrix4d CorrectedRelativePose(const PoseEstimation& relativePose, const Correction& w)
 {
-  // Relative poses estimated by the SLAM algorithm
-  // It represents the pose of the sensor at the time tk
-  // according to the reference frame attached to the sensor
-  // at time tk-1. It is the estimated odometry of the sensor
-  PoseEstimationVector relativePoses = RelativePosesFromAbsolutePoses(absolutePoses);
+  Eigen::Matrix4d dH = Eigen::Matrix4d::Identity();
+  dH.block(0, 0, 3, 3) = RollPitchYawToMatrix(w.block(0, 0, 3, 1));
+  dH.block(0, 3, 3, 1) = w.block(3, 0, 3, 1);
+  return dH * relativePose.H;
+}
 
+//-----------------------------------------------------------------------------
+// Single problem on the whole trajectory, made of two residual blocks
+// depending on all the poses, minimized by a line search
+void DenseLineSearchReoptimization(const PoseEstimationVector& relativePoses,
+                                   const std::vector<Eigen::Matrix4d>& H, const std::vector<int>& gtIndex,
+                                   const TrajectoryReoptimizationOptions& reoptimizationOptions,
+                                   CorrectionVector& W)
+{
   // Non-linear least square problem that consists of 2 residual blocks
   // - Distance to groundtruth minimization
   // - Regularizer that leads the attach to odometry data
-  std::vector<Eigen::Matrix<double, 6, 1> > W(relativePoses.size());
   std::vector<double*> parameterBlocks(relativePoses.size());
   for (int k = 0; k < relativePoses.size(); ++k)
   {
-    W[k] = Eigen::Matrix<double, 6, 1>::Zero();
     parameterBlocks[k] = W[k].data();
   }
 
@@ -109,7 +115,7 @@ PoseEstimationVector TrajectoryReoptimization(const PoseEstimationVector& absolu
   ceres::Problem problem;
   // groundtruth distance minimization
   ceres::DynamicAutoDiffCostFunction<CostFunctions::TrajectoryReoptimizationResidual, Stride>* gtFunction =
-      CostFunctions::TrajectoryReoptimizationResidual::Create(relativePoses, H, gtIndex, dataMode);
+      CostFunctions::TrajectoryReoptimizationResidual::Create(relativePoses, H, gtIndex, reoptimizationOptions.DataMode);
   // Regularizer function minimization
   ceres::DynamicAutoDiffCostFunction<CostFunctions::TrajectoryParametersRegulizer, Stride>* regFunction =
   CostFunctions::TrajectoryParametersRegulizer::Create(relativePoses.size(), relativePoses);
@@ -117,18 +123,182 @@ PoseEstimationVector TrajectoryReoptimization(const PoseEstimationVector& absolu
   problem.AddResidualBlock(regFunction, new ceres::ScaledLoss(nullptr, 1.0 / static_cast<double>(relativePoses.size()), ceres::TAKE_OWNERSHIP), parameterBlocks);
 
   ceres::Solver::Options options;
-  options.num_threads = 8;
-  options.num_linear_solver_threads = 8;
+  options.num_threads = NumberOfThreads(reoptimizationOptions.NumberOfThreads);
+  options.num_linear_solver_threads = options.num_threads;
   options.minimizer_type = ceres::LINE_SEARCH;
   //options.line_search_direction_type = ceres::STEEPEST_DESCENT;
   //options.line_search_type = ceres::ARMIJO;
-  options.max_num_iterations = maxIteration;
+  options.max_num_iterations = reoptimizationOptions.MaxIteration;
   options.linear_solver_type = ceres::DENSE_QR;
-  options.minimizer_progress_to_stdout = true;
+  options.minimizer_progress_to_stdout = reoptimizationOptions.Verbose;
 
   ceres::Solver::Summary summary;
   ceres::Solve(options, &problem, &summary);
   //std::cout << summary.FullReport() << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+// One problem per window, with a residual block per anchor and per pose, so
+// that the residuals are evaluated in parallel and the jacobian is sparse
+void SparseReoptimization(const PoseEstimationVector& relativePoses,
+                          const std::vector<Eigen::Matrix4d>& H, const std::vector<int>& gtIndex,
+                          const TrajectoryReoptimizationOptions& reoptimizationOptions,
+                          CorrectionVector& W)
+{
+  const int NPoses = relativePoses.size();
+
+  // anchors sorted by frame index
+  std::vector<int> anchors;
+  for (int anchor = 0; anchor < gtIndex.size(); ++anchor)
+  {
+    if (gtIndex[anchor] < 0 || gtIndex[anchor] >= NPoses)
+    {
+      std::cerr << "The anchor " << anchor << " of frame " << gtIndex[anchor]
+                << " is out of the trajectory, it is ignored" << std::endl;
+      continue;
+    }
+    anchors.push_back(anchor);
+  }
+  std::stable_sort(anchors.begin(), anchors.end(),
+                   [&gtIndex](int a, int b) { return gtIndex[a] < gtIndex[b]; });
+  if (anchors.empty())
+  {
+    return;
+  }
+
+  ceres::Solver::Options options;
+  options.num_threads = NumberOfThreads(reoptimizationOptions.NumberOfThreads);
+  options.minimizer_type = ceres::TRUST_REGION;
+  options.max_num_iterations = reoptimizationOptions.MaxIteration;
+  options.minimizer_progress_to_stdout = reoptimizationOptions.Verbose;
+  options.linear_solver_type = ceres::CGNR;
+  options.preconditioner_type = ceres::JACOBI;
+  if (reoptimizationOptions.Solver == ReoptimizationSolver::SparseNormalCholesky)
+  {
+    if (ceres::IsSparseLinearAlgebraLibraryTypeAvailable(ceres::SUITE_SPARSE))
+    {
+      options.linear_solver_type = ceres::SPARSE_NORMAL_CHOLESKY;
+      options.sparse_linear_algebra_library_type = ceres::SUITE_SPARSE;
+    }
+    else if (ceres::IsSparseLinearAlgebraLibraryTypeAvailable(ceres::EIGEN_SPARSE))
+    {
+      options.linear_solver_type = ceres::SPARSE_NORMAL_CHOLESKY;
+      options.sparse_linear_algebra_library_type = ceres::EIGEN_SPARSE;
+    }
+    else
+    {
+      std::cerr << "Ceres has no sparse linear algebra library, "
+                << "the conjugate gradients are used instead" << std::endl;
+    }
+  }
+
+  // The loss functions are shared by the residual blocks, the
+  // regularizers have the same weight as in the dense problem
+  ceres::Problem::Options problemOptions;
+  problemOptions.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+  ceres::ScaledLoss regularizerLoss(nullptr, 1.0 / static_cast<double>(NPoses), ceres::DO_NOT_TAKE_OWNERSHIP);
+
+  // correct the poses first to last, using the anchors of the range,
+  // the poses before first keep their current correction
+  auto solve = [&](int first, int last, std::vector<int>::const_iterator anchorsBegin,
+                   std::vector<int>::const_iterator anchorsEnd)
+  {
+    Eigen::Matrix4d prefix = Eigen::Matrix4d::Identity();
+    for (int k = 0; k < first; ++k)
+    {
+      prefix = prefix * CorrectedRelativePose(relativePoses[k], W[k]);
+    }
+
+    ceres::Problem problem(problemOptions);
+    for (auto anchor = anchorsBegin; anchor != anchorsEnd; ++anchor)
+    {
+      std::vector<double*> parameterBlocks;
+      for (int k = first; k <= gtIndex[*anchor]; ++k)
+      {
+        parameterBlocks.push_back(W[k].data());
+      }
+      problem.AddResidualBlock(new CostFunctions::AnchorPoseResidual(relativePoses, first, gtIndex[*anchor], prefix,
+                                                                     H[*anchor], reoptimizationOptions.DataMode),
+                               nullptr, parameterBlocks);
+    }
+    for (int k = first; k <= last; ++k)
+    {
+      problem.AddResidualBlock(new CostFunctions::PoseCorrectionRegularizer(relativePoses[k].Sigma),
+                               &regularizerLoss, W[k].data());
+    }
+
+    ceres::Solver::Summary summary;
+    ceres::Solve(options, &problem, &summary);
+  };
+
+  if (reoptimizationOptions.WindowSize <= 0)
+  {
+    // the poses after the last anchor are not constrained, their correction stays 0
+    solve(0, gtIndex[anchors.back()], anchors.cbegin(), anchors.cend());
+    return;
+  }
+
+  // window of each group of anchors of the same frame, after the previous frame
+  int previous = -1;
+  for (auto begin = anchors.cbegin(); begin != anchors.cend(); )
+  {
+    const int frame = gtIndex[*begin];
+    auto end = begin;
+    while (end != anchors.cend() && gtIndex[*end] == frame)
+    {
+      ++end;
+    }
+    solve(std::max(previous + 1, frame - reoptimizationOptions.WindowSize + 1), frame, begin, end);
+    previous = frame;
+    begin = end;
+  }
+}
+}
+
+//-----------------------------------------------------------------------------
+PoseEstimationVector TrajectoryReoptimization(const PoseEstimationVector& absolutePoses,
+                                              const Eigen::Matrix4d& H, int gtIndex, int maxIteration,
+                                              MeasureProvided dataMode)
+{
+  std::vector<Eigen::Matrix4d> HList;
+  std::vector<int> gtIndexList;
+  HList.push_back(H);
+  gtIndexList.push_back(gtIndex);
+  return TrajectoryReoptimization(absolutePoses, HList, gtIndexList, maxIteration, dataMode);
+}
+
+//-----------------------------------------------------------------------------
+PoseEstimationVector TrajectoryReoptimization(const PoseEstimationVector& absolutePoses,
+                                              const std::vector<Eigen::Matrix4d>& H, std::vector<int> gtIndex,
+                                              int maxIteration, MeasureProvided dataMode)
+{
+  TrajectoryReoptimizationOptions options;
+  options.MaxIteration = maxIteration;
+  options.DataMode = dataMode;
+  return TrajectoryReoptimization(absolutePoses, H, gtIndex, options);
+}
+
+//-----------------------------------------------------------------------------
+PoseEstimationVector TrajectoryReoptimization(const PoseEstimationVector& absolutePoses,
+                                              const std::vector<Eigen::Matrix4d>& H, const std::vector<int>& gtIndex,
+                                              const TrajectoryReoptimizationOptions& options)
+{
+  // Relative poses estimated by the SLAM algorithm
+  // It represents the pose of the sensor at the time tk
+  // according to the reference frame attached to the sensor
+  // at time tk-1. It is the estimated odometry of the sensor
+  PoseEstimationVector relativePoses = RelativePosesFromAbsolutePoses(absolutePoses);
+
+  // 6-dof correction of each relative pose
+  CorrectionVector W(relativePoses.size(), Correction::Zero());
+  if (options.Solver == ReoptimizationSolver::DenseLineSearch)
+  {
+    DenseLineSearchReoptimization(relativePoses, H, gtIndex, options, W);
+  }
+  else
+  {
+    SparseReoptimization(relativePoses, H, gtIndex, options, W);
+  }
 
   // absolute poses reoptimized by the algorithm
   // It represents the pose of the sensor at the time tk
@@ -65,6 +65,57 @@ public:
 };
 using PoseEstimationVector = std::vector<PoseEstimation, Eigen::aligned_allocator<PoseEstimation>>;
 
+/**
+* \enum ReoptimizationSolver
+* \brief Formulation and solver of the reoptimization problem
+*
+*        - DenseLineSearch: the whole trajectory is a single problem made
+*          of two residual blocks depending on all the poses, minimized by
+*          a line search. The evaluation of the jacobian is quadratic in the
+*          number of poses, and it ignores the window.
+*        - SparseNormalCholesky: a residual block per anchor, depending on
+*          the poses before it, and a regularizer block per pose, minimized
+*          by Levenberg-Marquardt with a sparse Cholesky factorization of the
+*          normal equations (CHOLMOD if ceres uses SuiteSparse). The
+*          anchors make the normal equations dense over the poses they
+*          depend on, it should be used with windows of a few hundred poses.
+*        - ConjugateGradients: the same problem, with the normal equations
+*          solved by preconditioned conjugate gradients, which only need
+*          products with the sparse jacobian. It scales to whole trajectories.
+*/
+enum class ReoptimizationSolver
+{
+  DenseLineSearch = 0,
+  SparseNormalCholesky = 1,
+  ConjugateGradients = 2
+};
+
+/**
+* \struct TrajectoryReoptimizationOptions
+* \brief Parameters of TrajectoryReoptimization
+*/
+struct TrajectoryReoptimizationOptions
+{
+  //! Maximum number of iteration of each optimization
+  int MaxIteration = 30;
+
+  MeasureProvided DataMode = MeasureProvided::OrientationPosition;
+
+  ReoptimizationSolver Solver = ReoptimizationSolver::DenseLineSearch;
+
+  //! If not 0, the anchors are processed one after the other, from the first
+  //! one, each correcting at most the WindowSize poses before it and after
+  //! the previous anchor, the corrections of the previous poses being fixed.
+  //! If 0, all the poses are corrected at once. Unused by DenseLineSearch.
+  int WindowSize = 0;
+
+  //! Number of threads evaluating the residuals, 0 to use all the cores
+  unsigned int NumberOfThreads = 0;
+
+  //! Print the progress of the minimizer
+  bool Verbose = true;
+};
+
 /**
  * @brief TrajectoryReoptimization Reoptimization of a poses-trajectory
  *        (both positions and orientations) estimated by the SLAM algorithm
@@ -99,6 +150,9 @@ PoseEstimationVector TrajectoryReoptimization(const PoseEstimationVector& absolu
                                               const std::vector<Eigen::Matrix4d>& H, std::vector<int> gtIndex,
                                               int maxIteration = 30,
                                               MeasureProvided dataMode = MeasureProvided::OrientationPosition);
+PoseEstimationVector TrajectoryReoptimization(const PoseEstimationVector& absolutePoses,
+                                              const std::vector<Eigen::Matrix4d>& H, const std::vector<int>& gtIndex,
+                                              const TrajectoryReoptimizationOptions& options);
 
 /**
  * @brief RelativePosesFromAbsolutePoses Compute relative sensor poses estimation
@@ -30,8 +30,12 @@
 // CERES
 #include <ceres/ceres.h>
 #include <ceres/dynamic_autodiff_cost_function.h>
+#include <ceres/jet.h>
 #include <ceres/rotation.h>
 
+// STD
+#include <vector>
+
 // Dynamic autodiff stride. The functor will evaluates
 // the partial derivatives by batches of size Stride. hence,
 // a larger stride will reduce the number of required passes
@@ -244,6 +248,163 @@ private:
   PoseEstimationVector RelativePoses;
 };
 
+
+/**
+* \class AnchorPoseResidual
+* \brief Distance between an anchor and the corrected absolute pose of its
+*        frame, as a residual block depending on the corrections of the
+*        poses First to Last, Last which is the frame of the anchor:
+*
+*        H(w) = Prefix * dH_First(w) * H_First * ... * dH_Last(w) * H_Last
+*
+*        with Prefix the corrected absolute pose of the frame First - 1. The
+*        residuals are the entries of H(w) - Hanchor used by the measure mode,
+*        so that the cost is the same as TrajectoryReoptimizationResidual.
+*        The jacobian of each correction is computed with the products of
+*        the poses before and after it, the evaluation is then linear in the
+*        number of poses instead of quadratic with DynamicAutoDiffCostFunction.
+*/
+//-----------------------------------------------------------------------------
+class AnchorPoseResidual : public ceres::CostFunction
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  AnchorPoseResidual(const PoseEstimationVector& argRelativePoses, int argFirst, int argLast,
+                     const Eigen::Matrix4d& argPrefix, const Eigen::Matrix4d& argH,
+                     MeasureProvided argMode)
+    : RelativePoses(argRelativePoses)
+    , First(argFirst)
+    , Last(argLast)
+    , Prefix(argPrefix)
+    , Hanchor(argH)
+    , MeasureMode(argMode)
+  {
+    for (int poseIndex = argFirst; poseIndex <= argLast; ++poseIndex)
+    {
+      // 6-dof correction associated to this pose
+      this->mutable_parameter_block_sizes()->push_back(6);
+    }
+    this->set_num_residuals(argMode == MeasureProvided::PositionOnly ? 3 :
+                             argMode == MeasureProvided::OrientationOnly ? 9 : 12);
+  }
+
+  bool Evaluate(double const* const* w, double* residuals, double** jacobians) const override
+  {
+    const int NPoses = this->Last - this->First + 1;
+
+    // corrected relative poses, and absolute poses of the frames before them
+    std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d> > corrected(NPoses), before(NPoses);
+    Eigen::Matrix4d Hf = this->Prefix;
+    for (int k = 0; k < NPoses; ++k)
+    {
+      before[k] = Hf;
+      corrected[k] = Correction(w[k]) * this->RelativePoses[this->First + k].H;
+      Hf = Hf * corrected[k];
+    }
+    this->Residuals(Hf, residuals);
+
+    if (!jacobians)
+    {
+      return true;
+    }
+
+    // H(w) = before[k] * dH_k(w_k) * after, with after = H_k * corrected[k + 1] * ...
+    using Jet = ceres::Jet<double, 6>;
+    Eigen::Matrix4d after = Eigen::Matrix4d::Identity();
+    std::vector<Jet> jetResiduals(this->num_residuals());
+    for (int k = NPoses - 1; k >= 0; --k)
+    {
+      if (jacobians[k])
+      {
+        Jet wk[6];
+        for (int i = 0; i < 6; ++i)
+        {
+          wk[i] = Jet(w[k][i], i);
+        }
+        const Eigen::Matrix<Jet, 4, 4> H = before[k].cast<Jet>() * Correction(wk) *
+                                           (this->RelativePoses[this->First + k].H * after).cast<Jet>();
+        this->Residuals(H, jetResiduals.data());
+        Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, 6, Eigen::RowMajor> > jacobian(jacobians[k], this->num_residuals(), 6);
+        for (int r = 0; r < this->num_residuals(); ++r)
+        {
+          jacobian.row(r) = jetResiduals[r].v.transpose();
+        }
+      }
+      after = corrected[k] * after;
+    }
+    return true;
+  }
+
+private:
+  template <typename T>
+  static Eigen::Matrix<T, 4, 4> Correction(const T* w)
+  {
+    Eigen::Matrix<T, 4, 4> dH = Eigen::Matrix<T, 4, 4>::Identity();
+    dH.block(0, 0, 3, 3) = ceres::RollPitchYawToMatrix(w[0], w[1], w[2]);
+    dH.block(0, 3, 3, 1) = Eigen::Matrix<T, 3, 1>(w[3], w[4], w[5]);
+    return dH;
+  }
+
+  template <typename T>
+  void Residuals(const Eigen::Matrix<T, 4, 4>& H, T* residuals) const
+  {
+    const int firstCol = (this->MeasureMode == MeasureProvided::PositionOnly) ? 3 : 0;
+    const int lastCol = (this->MeasureMode == MeasureProvided::OrientationOnly) ? 2 : 3;
+    int index = 0;
+    for (int col = firstCol; col <= lastCol; ++col)
+    {
+      for (int row = 0; row < 3; ++row)
+      {
+        residuals[index++] = H(row, col) - T(this->Hanchor(row, col));
+      }
+    }
+  }
+
+  const PoseEstimationVector& RelativePoses;
+  int First;
+  int Last;
+  Eigen::Matrix4d Prefix;
+  Eigen::Matrix4d Hanchor;
+  MeasureProvided MeasureMode;
+};
+
+/**
+* \class PoseCorrectionRegularizer
+* \brief Mahalanobis norm of the correction of a pose, as the residuals U * w
+*        with Sigma = U.transpose() * U. The cost is the same as a residual of
+*        TrajectoryParametersRegulizer, but it is linear and smooth around 0.
+*/
+//-----------------------------------------------------------------------------
+class PoseCorrectionRegularizer : public ceres::SizedCostFunction<6, 6>
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  explicit PoseCorrectionRegularizer(const Eigen::Matrix<double, 6, 6>& argSigma)
+  {
+    // Sigma is symmetric positive, its negative eigen values are numerical noise
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, 6, 6> > eig(argSigma);
+    this->U = eig.eigenvalues().cwiseMax(0.0).cwiseSqrt().asDiagonal() * eig.eigenvectors().transpose();
+  }
+
+  bool Evaluate(double const* const* w, double* residuals, double** jacobians) const override
+  {
+    Eigen::Map<const Eigen::Matrix<double, 6, 1> > correction(w[0]);
+    Eigen::Map<Eigen::Matrix<double, 6, 1> > residualsVector(residuals);
+    residualsVector = this->U * correction;
+    if (jacobians && jacobians[0])
+    {
+      Eigen::Map<Eigen::Matrix<double, 6, 6, Eigen::RowMajor> > jacobian(jacobians[0]);
+      jacobian = this->U;
+    }
+    return true;
+  }
+
+private:
+  Eigen::Matrix<double, 6, 6> U;
+};
+
 }
 
 #endif // TRAJECTORY_REOPTIMIZATION_COST_FUNSTIONS_H
@@ -0,0 +1,195 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "VoxelHashKNN.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <utility>
+
+//-----------------------------------------------------------------------------
+VoxelHashKNN::VoxelHashKNN(double cellSize)
+{
+  this->Reset(cellSize);
+}
+
+//-----------------------------------------------------------------------------
+void VoxelHashKNN::Reset(double cellSize)
+{
+  this->CellSize = cellSize;
+  this->Cells.clear();
+  this->FreeIndices.clear();
+  this->Cloud->clear();
+  this->NumberOfPoints = 0;
+}
+
+//-----------------------------------------------------------------------------
+VoxelHashKNN::CellIndex VoxelHashKNN::GetCellIndex(const Point& point) const
+{
+  CellIndex index;
+  index.X = static_cast<int>(std::floor(point.x / this->CellSize));
+  index.Y = static_cast<int>(std::floor(point.y / this->CellSize));
+  index.Z = static_cast<int>(std::floor(point.z / this->CellSize));
+  return index;
+}
+
+//-----------------------------------------------------------------------------
+void VoxelHashKNN::Insert(const pcl::PointCloud<Point>& points, std::vector<int>& indices)
+{
+  indices.resize(points.size());
+  for (size_t i = 0; i < points.size(); ++i)
+  {
+    int index;
+    if (!this->FreeIndices.empty())
+    {
+      index = this->FreeIndices.back();
+      this->FreeIndices.pop_back();
+      this->Cloud->points[index] = points.points[i];
+    }
+    else
+    {
+      index = static_cast<int>(this->Cloud->size());
+      this->Cloud->push_back(points.points[i]);
+    }
+    this->Cells[this->GetCellIndex(points.points[i])].push_back(index);
+    indices[i] = index;
+  }
+  this->NumberOfPoints += static_cast<int>(points.size());
+}
+
+//-----------------------------------------------------------------------------
+void VoxelHashKNN::Remove(const std::vector<int>& indices)
+{
+  for (int index : indices)
+  {
+    auto cell = this->Cells.find(this->GetCellIndex(this->Cloud->points[index]));
+    if (cell == this->Cells.end())
+    {
+      continue;
+    }
+    std::vector<int>& cellIndices = cell->second;
+    auto it = std::find(cellIndices.begin(), cellIndices.end(), index);
+    if (it == cellIndices.end())
+    {
+      continue;
+    }
+    *it = cellIndices.back();
+    cellIndices.pop_back();
+    if (cellIndices.empty())
+    {
+      this->Cells.erase(cell);
+    }
+    this->FreeIndices.push_back(index);
+    --this->NumberOfPoints;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void VoxelHashKNN::query(const Point& query_point, int knearest, int* out_indices, double* out_distances_sq) const
+{
+  if (knearest <= 0 || this->NumberOfPoints == 0)
+  {
+    return;
+  }
+
+  // The k nearest points found so far, the farthest one on top
+  std::priority_queue<std::pair<double, int> > nearest;
+  auto visitCell = [&](const std::vector<int>& cellIndices)
+  {
+    for (int index : cellIndices)
+    {
+      const Point& point = this->Cloud->points[index];
+      const double dx = point.x - query_point.x;
+      const double dy = point.y - query_point.y;
+      const double dz = point.z - query_point.z;
+      const double squaredDistance = dx * dx + dy * dy + dz * dz;
+      if (static_cast<int>(nearest.size()) < knearest)
+      {
+        nearest.emplace(squaredDistance, index);
+      }
+      else if (squaredDistance < nearest.top().first)
+      {
+        nearest.pop();
+        nearest.emplace(squaredDistance, index);
+      }
+    }
+    return cellIndices.size();
+  };
+
+  // Visit the shells of cells at a distance of 0, 1, 2... cells of the query
+  // cell. The points of the cells beyond the shell r are at least r cells away
+  // from the query point: the search stops once k points closer than that have
+  // been found. If a shell has more cells than the map, the remaining cells are
+  // visited from the hash map instead.
+  const CellIndex center = this->GetCellIndex(query_point);
+  size_t numberOfVisitedPoints = 0;
+  for (int r = 0; ; ++r)
+  {
+    const double shellSize = r == 0 ? 1.0 : std::pow(2.0 * r + 1.0, 3) - std::pow(2.0 * r - 1.0, 3);
+    if (shellSize > this->Cells.size())
+    {
+      for (const auto& cell : this->Cells)
+      {
+        const int distance = std::max(std::abs(cell.first.X - center.X),
+                             std::max(std::abs(cell.first.Y - center.Y), std::abs(cell.first.Z - center.Z)));
+        if (distance >= r)
+        {
+          visitCell(cell.second);
+        }
+      }
+      break;
+    }
+
+    CellIndex index;
+    for (int dx = -r; dx <= r; ++dx)
+    {
+      index.X = center.X + dx;
+      for (int dy = -r; dy <= r; ++dy)
+      {
+        index.Y = center.Y + dy;
+        // inside the shell only the two faces along Z belong to it
+        const bool isOnSide = std::abs(dx) == r || std::abs(dy) == r;
+        const int dzStep = (isOnSide || r == 0) ? 1 : 2 * r;
+        for (int dz = -r; dz <= r; dz += dzStep)
+        {
+          index.Z = center.Z + dz;
+          auto cell = this->Cells.find(index);
+          if (cell != this->Cells.end())
+          {
+            numberOfVisitedPoints += visitCell(cell->second);
+          }
+        }
+      }
+    }
+
+    const double searchedRadius = r * this->CellSize;
+    if (numberOfVisitedPoints == static_cast<size_t>(this->NumberOfPoints) ||
+        (static_cast<int>(nearest.size()) == knearest && nearest.top().first <= searchedRadius * searchedRadius))
+    {
+      break;
+    }
+  }
+
+  // Like nanoflann, only the found neighbors are written
+  for (int k = static_cast<int>(nearest.size()) - 1; k >= 0; --k)
+  {
+    out_indices[k] = nearest.top().second;
+    out_distances_sq[k] = nearest.top().first;
+    nearest.pop();
+  }
+}
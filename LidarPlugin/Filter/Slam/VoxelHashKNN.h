@@ -0,0 +1,101 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VOXEL_HASH_KNN_H
+#define VOXEL_HASH_KNN_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "KDTreePCLAdaptor.h"
+
+/**
+ * \class VoxelHashKNN
+ * \brief Nearest neighbors search structure which can be updated point by point.
+ *
+ * The points are stored in the cells of a regular grid, indexed by a hash map of
+ * the cells containing some points. Inserting or removing a point only modifies
+ * its cell, so that a map can be kept searchable without rebuilding a kd-tree each
+ * time it changes. The k nearest neighbors of a point are found by visiting the
+ * cells around it by increasing distance, the result is exact.
+ *
+ * The removed points leave a hole in the cloud returned by getInputCloud, filled
+ * by the next inserted points, so that the indices of the points never change.
+ * query can be called by several threads at the same time, but not while the
+ * structure is modified.
+ */
+class VoxelHashKNN : public KDTreePCLAdaptor
+{
+  using Point = PointXYZTIId;
+public:
+  /**
+   * @param cellSize size of the cells, a cell should contain a few times
+   * the number of neighbors usually requested
+   */
+  explicit VoxelHashKNN(double cellSize = 1.0);
+
+  //! Remove all the points and set the cells size
+  void Reset(double cellSize);
+
+  //! Insert some points and return their indices in the cloud
+  void Insert(const pcl::PointCloud<Point>& points, std::vector<int>& indices);
+
+  //! Remove the points of these indices, which must not be used afterwards
+  void Remove(const std::vector<int>& indices);
+
+  //! Same as KDTreePCLAdaptor::query, the neighbors are sorted by distance
+  void query(const Point& query_point, int knearest, int* out_indices, double* out_distances_sq) const override;
+
+  int GetNumberOfPoints() const override { return this->NumberOfPoints; }
+
+private:
+  struct CellIndex
+  {
+    int X;
+    int Y;
+    int Z;
+
+    bool operator==(const CellIndex& other) const
+    {
+      return this->X == other.X && this->Y == other.Y && this->Z == other.Z;
+    }
+  };
+
+  struct CellIndexHash
+  {
+    size_t operator()(const CellIndex& index) const
+    {
+      return static_cast<size_t>(index.X) * 73856093u
+           ^ static_cast<size_t>(index.Y) * 19349669u
+           ^ static_cast<size_t>(index.Z) * 83492791u;
+    }
+  };
+
+  CellIndex GetCellIndex(const Point& point) const;
+
+  double CellSize;
+
+  //! Indices of the points of each cell containing some points
+  std::unordered_map<CellIndex, std::vector<int>, CellIndexHash> Cells;
+
+  //! Indices of the removed points, reused by the next insertions
+  std::vector<int> FreeIndices;
+
+  int NumberOfPoints = 0;
+};
+
+#endif // VOXEL_HASH_KNN_H
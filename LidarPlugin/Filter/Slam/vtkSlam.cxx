@@ -78,8 +78,11 @@
 
 // STD
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include <numeric>
 #include <cstring>
+#include <sstream>
 
 // VTK
 #include <vtkCellArray.h>
@@ -87,6 +90,7 @@
 #include <vtkDataArray.h>
 #include <vtkDoubleArray.h>
 #include <vtkFloatArray.h>
+#include <vtkIntArray.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
 #include <vtkMath.h>
@@ -98,14 +102,19 @@
 #include <vtkPolyLine.h>
 #include <vtkSmartPointer.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkStringArray.h>
 #include <vtkUnsignedCharArray.h>
 #include <vtkUnsignedShortArray.h>
 #include <vtkTransform.h>
 #include <vtkPoints.h>
 #include <vtkTransform.h>
 #include <vtkTransformPolyDataFilter.h>
+#include <vtkAppendPolyData.h>
 #include <vtkTable.h>
 
+#include <pcl/common/common.h>
+#include <pcl/filters/voxel_grid.h>
+
 //-----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlam)
 
@@ -119,50 +128,217 @@ double Rad2Deg(double val)
 //-----------------------------------------------------------------------------
 void PolyDataFromPointCloud(pcl::PointCloud<Slam::Point>::Ptr pc, vtkPolyData* poly)
 {
-  auto pts = vtkSmartPointer<vtkPoints>::New();
-  poly->SetPoints(pts);
-  for (size_t i = 0; i < pc->size(); i++)
+  // the coordinates are written directly in the float array of the points
+  const vtkIdType nbPoints = pc->size();
+  auto coordinates = vtkSmartPointer<vtkFloatArray>::New();
+  coordinates->SetNumberOfComponents(3);
+  coordinates->SetNumberOfTuples(nbPoints);
+  float* xyz = coordinates->GetPointer(0);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
   {
-    Slam::Point p = pc->points[i];
-    if (!poly->GetPoints())
-      cout << "no point cloud" << endl;
-    poly->GetPoints()->InsertNextPoint(p.x, p.y, p.z);
+    const Slam::Point& p = pc->points[i];
+    xyz[i * 3] = p.x;
+    xyz[i * 3 + 1] = p.y;
+    xyz[i * 3 + 2] = p.z;
   }
+  auto pts = vtkSmartPointer<vtkPoints>::New();
+  pts->SetData(coordinates);
+  poly->SetPoints(pts);
+
   vtkNew<vtkIdTypeArray> cells;
-  cells->SetNumberOfValues(pc->size() * 2);
+  cells->SetNumberOfValues(nbPoints * 2);
   vtkIdType* ids = cells->GetPointer(0);
-  for (vtkIdType i = 0; i < pc->size(); ++i)
+  for (vtkIdType i = 0; i < nbPoints; ++i)
   {
     ids[i * 2] = 1;
     ids[i * 2 + 1] = i;
   }
 
   auto cellArray = vtkSmartPointer<vtkCellArray>::New();
-  cellArray->SetCells(pc->size(), cells.GetPointer());
+  cellArray->SetCells(nbPoints, cells.GetPointer());
   poly->SetVerts(cellArray);
 }
+
+//-----------------------------------------------------------------------------
+// Downsample the cloud on a voxel grid, with the smallest leaf size found
+// which keeps at most maxNbrPoints points. The cloud is returned as is if
+// it is small enough or if maxNbrPoints is 0.
+pcl::PointCloud<Slam::Point>::Ptr DecimateCloud(pcl::PointCloud<Slam::Point>::Ptr cloud,
+                                                unsigned int maxNbrPoints)
+{
+  if (maxNbrPoints == 0 || cloud->size() <= maxNbrPoints)
+  {
+    return cloud;
+  }
+
+  // Start with the leaf size which splits the bounding box in maxNbrPoints
+  // voxels. The leaf size is bounded so that the number of voxels of the box
+  // fits in the int indices of pcl::VoxelGrid.
+  Eigen::Vector4f minPt, maxPt;
+  pcl::getMinMax3D(*cloud, minPt, maxPt);
+  const Eigen::Array3d extent = (maxPt - minPt).head<3>().cast<double>().array().max(1e-2);
+  const double minLeafSize = 1.01 * std::cbrt(extent.prod() / std::numeric_limits<int>::max());
+  double leafSize = std::cbrt(extent.prod() / maxNbrPoints);
+
+  // The points lie on surfaces, so the number of occupied voxels is roughly
+  // inversely proportional to the square of the leaf size. A few iterations
+  // are enough to get close to maxNbrPoints from below.
+  pcl::PointCloud<Slam::Point>::Ptr best;
+  pcl::VoxelGrid<Slam::Point> downSizeFilter;
+  downSizeFilter.setInputCloud(cloud);
+  for (int iter = 0; iter < 6; ++iter)
+  {
+    leafSize = std::max(leafSize, minLeafSize);
+    pcl::PointCloud<Slam::Point>::Ptr decimated(new pcl::PointCloud<Slam::Point>());
+    downSizeFilter.setLeafSize(leafSize, leafSize, leafSize);
+    downSizeFilter.filter(*decimated);
+    if (decimated->size() <= maxNbrPoints)
+    {
+      if (!best || decimated->size() > best->size())
+      {
+        best = decimated;
+      }
+      if (decimated->size() > 0.9 * maxNbrPoints || leafSize == minLeafSize)
+      {
+        break;
+      }
+    }
+    // aim slightly below maxNbrPoints to avoid oscillating around it
+    const double ratio = static_cast<double>(decimated->size()) / (0.95 * maxNbrPoints);
+    leafSize *= std::sqrt(std::max(ratio, 1e-2));
+  }
+  if (!best)
+  {
+    // keep evenly spread points of the original cloud
+    best.reset(new pcl::PointCloud<Slam::Point>());
+    best->reserve(maxNbrPoints);
+    const double step = static_cast<double>(cloud->size()) / maxNbrPoints;
+    for (unsigned int i = 0; i < maxNbrPoints; ++i)
+    {
+      best->push_back(cloud->points[static_cast<size_t>(i * step)]);
+    }
+  }
+  return best;
+}
+
+//-----------------------------------------------------------------------------
+template <typename T, typename Setter>
+void CopyValuesToCloud(const T* values, int nbComponents, pcl::PointCloud<Slam::Point>& pc,
+                       size_t offset, const Setter& set)
+{
+  for (size_t i = offset; i < pc.size(); ++i, values += nbComponents)
+  {
+    set(pc.points[i], values);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Call set(point, values) for each point pc[offset + i] and the tuple i of the array,
+// read through the raw pointer of the array instead of its virtual accessors
+template <typename Setter>
+void CopyArrayToCloud(vtkDataArray* array, pcl::PointCloud<Slam::Point>& pc,
+                      size_t offset, const Setter& set)
+{
+  if (!array)
+  {
+    return;
+  }
+  const int nbComponents = array->GetNumberOfComponents();
+  switch (array->GetDataType())
+  {
+    vtkTemplateMacro(CopyValuesToCloud(static_cast<const VTK_TT*>(array->GetVoidPointer(0)),
+                                       nbComponents, pc, offset, set));
+  }
+}
+
+//-----------------------------------------------------------------------------
+void TableFromTimings(const SlamTimings& timings, vtkTable* table)
+{
+  auto stages = vtkSmartPointer<vtkStringArray>::New();
+  stages->SetName("Stage");
+  stages->SetNumberOfValues(SlamStage::NbrSlamStages);
+  table->AddColumn(stages);
+
+  // statistics of the rolling window, in milliseconds
+  const char* statisticsNames[] = {"Last frame (ms)", "Mean (ms)", "Min (ms)", "Max (ms)",
+                                   "Median (ms)", "95th percentile (ms)"};
+  std::vector<vtkSmartPointer<vtkDoubleArray> > statistics;
+  for (const char* name : statisticsNames)
+  {
+    statistics.push_back(createArray<vtkDoubleArray>(name, 1, SlamStage::NbrSlamStages));
+    table->AddColumn(statistics.back());
+  }
+  auto count = createArray<vtkIntArray>("Frames", 1, SlamStage::NbrSlamStages);
+  table->AddColumn(count);
+
+  // histogram of the rolling window, one column per bin
+  const std::vector<double>& bounds = SlamTimings::GetHistogramBinBounds();
+  std::vector<vtkSmartPointer<vtkIntArray> > bins;
+  for (size_t i = 0; i <= bounds.size(); ++i)
+  {
+    std::ostringstream name;
+    if (i < bounds.size())
+    {
+      name << "< " << bounds[i] * 1e3 << " ms";
+    }
+    else
+    {
+      name << ">= " << bounds.back() * 1e3 << " ms";
+    }
+    bins.push_back(createArray<vtkIntArray>(name.str(), 1, SlamStage::NbrSlamStages));
+    table->AddColumn(bins.back());
+  }
+
+  for (int stage = 0; stage < SlamStage::NbrSlamStages; ++stage)
+  {
+    const SlamStage slamStage = static_cast<SlamStage>(stage);
+    stages->SetValue(stage, SlamTimings::GetStageName(slamStage));
+    SlamTimings::StageStatistics stats = timings.GetStatistics(slamStage);
+    const double values[] = {timings.GetLastFrameTime(slamStage), stats.Mean, stats.Min, stats.Max,
+                             stats.Median, stats.Percentile95};
+    for (size_t i = 0; i < statistics.size(); ++i)
+    {
+      statistics[i]->SetValue(stage, values[i] * 1e3);
+    }
+    count->SetValue(stage, stats.Count);
+    std::vector<unsigned int> histogram = timings.GetHistogram(slamStage);
+    for (size_t i = 0; i < bins.size(); ++i)
+    {
+      bins[i]->SetValue(stage, histogram[i]);
+    }
+  }
+}
 }
 
 //-----------------------------------------------------------------------------
 void PointCloudFromPolyData(vtkPolyData* poly, pcl::PointCloud<Slam::Point>::Ptr pc)
 {
-  auto arrayPosition = poly->GetPoints() ;
-  auto arrayTime = poly->GetPointData()->GetArray("adjustedtime");
-  auto arrayLaserId = poly->GetPointData()->GetArray("laser_id");
-  auto arrayIntensity = poly->GetPointData()->GetArray("intensity");
-  for (vtkIdType i = 0; i < poly->GetNumberOfPoints(); i++)
-  {
-    double pos[3];
-    poly->GetPoint(i, pos);
-    Slam::Point p;
-    p.x = pos[0];
-    p.y = pos[1];
-    p.z = pos[2];
-    p.time = arrayTime->GetTuple1(i) * 1e-6; // time in second
-    p.laserId = arrayLaserId->GetTuple1(i);
-    p.intensity = arrayIntensity->GetTuple1(i);
-    pc->push_back(p);
+  const size_t offset = pc->size();
+  const vtkIdType nbPoints = poly->GetNumberOfPoints();
+  if (nbPoints == 0)
+  {
+    return;
   }
+  // the points are appended, each field is then copied from its array
+  pc->resize(offset + nbPoints);
+  CopyArrayToCloud(poly->GetPoints()->GetData(), *pc, offset, [](Slam::Point& p, const auto* pos)
+  {
+    p.x = static_cast<double>(pos[0]);
+    p.y = static_cast<double>(pos[1]);
+    p.z = static_cast<double>(pos[2]);
+  });
+  CopyArrayToCloud(poly->GetPointData()->GetArray("adjustedtime"), *pc, offset, [](Slam::Point& p, const auto* t)
+  {
+    p.time = static_cast<double>(*t) * 1e-6; // time in second
+  });
+  CopyArrayToCloud(poly->GetPointData()->GetArray("laser_id"), *pc, offset, [](Slam::Point& p, const auto* id)
+  {
+    p.laserId = static_cast<double>(*id);
+  });
+  CopyArrayToCloud(poly->GetPointData()->GetArray("intensity"), *pc, offset, [](Slam::Point& p, const auto* i)
+  {
+    p.intensity = static_cast<double>(*i);
+  });
 }
 
 //-----------------------------------------------------------------------------
@@ -187,6 +363,106 @@ void vtkSlam::SetKeyPointsExtractor (vtkSpinningSensorKeypointExtractor* _arg)
   this->SlamAlgo.SetKeyPointsExtractor(this->KeyPointsExtractor->GetExtractor());
 }
 
+//-----------------------------------------------------------------------------
+void vtkSlam::SetNumberOfSensorPoses(int number)
+{
+  if (static_cast<int>(this->SensorPoses.size()) != 6 * std::max(0, number))
+  {
+    this->SensorPoses.resize(6 * std::max(0, number), 0);
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::SetSensorPose(int index, double x, double y, double z, double rx, double ry, double rz)
+{
+  if (index < 0)
+  {
+    return;
+  }
+  if (6 * index >= static_cast<int>(this->SensorPoses.size()))
+  {
+    this->SensorPoses.resize(6 * (index + 1), 0);
+  }
+  const double pose[6] = { x, y, z, rx, ry, rz };
+  if (!std::equal(pose, pose + 6, this->SensorPoses.begin() + 6 * index))
+  {
+    std::copy(pose, pose + 6, this->SensorPoses.begin() + 6 * index);
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::ConfigureSensors(int numberOfSensors)
+{
+  if (static_cast<int>(this->SlamAlgo.GetNumberOfSensors()) == numberOfSensors &&
+      this->SensorsConfigurationTime > this->GetMTime() &&
+      this->SensorsConfigurationTime > this->KeyPointsExtractor->GetMTime())
+  {
+    return;
+  }
+
+  const std::shared_ptr<SpinningSensorKeypointExtractor> main = this->KeyPointsExtractor->GetExtractor();
+  this->SlamAlgo.ClearSensors();
+  for (int sensor = 1; sensor < numberOfSensors; ++sensor)
+  {
+    auto extractor = std::make_shared<SpinningSensorKeypointExtractor>();
+    extractor->SetNeighborWidth(main->GetNeighborWidth());
+    extractor->SetMinDistanceToSensor(main->GetMinDistanceToSensor());
+    extractor->SetEdgeSinAngleThreshold(main->GetEdgeSinAngleThreshold());
+    extractor->SetPlaneSinAngleThreshold(main->GetPlaneSinAngleThreshold());
+    extractor->SetEdgeDepthGapThreshold(main->GetEdgeDepthGapThreshold());
+    extractor->SetAngleResolution(main->GetAngleResolution());
+    extractor->SetSaillancyThreshold(main->GetSaillancyThreshold());
+    extractor->SetNumberOfThreads(main->GetNumberOfThreads());
+
+    Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+    if (6 * sensor <= static_cast<int>(this->SensorPoses.size()))
+    {
+      const double* p = &this->SensorPoses[6 * (sensor - 1)];
+      pose.linear() = RollPitchYawToMatrix(vtkMath::RadiansFromDegrees(p[3]), vtkMath::RadiansFromDegrees(p[4]),
+                                           vtkMath::RadiansFromDegrees(p[5]));
+      pose.translation() = Eigen::Vector3d(p[0], p[1], p[2]);
+    }
+    else
+    {
+      vtkWarningMacro(<< "No pose given for the sensor " << sensor << ", it is supposed to be the main one");
+    }
+    this->SlamAlgo.AddSensor(extractor, pose);
+  }
+  this->SensorsConfigurationTime.Modified();
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkSlam::MergeFrames(vtkInformationVector* inputs)
+{
+  vtkNew<vtkAppendPolyData> append;
+  for (int sensor = 0; sensor < inputs->GetNumberOfInformationObjects(); ++sensor)
+  {
+    vtkPolyData* input = vtkPolyData::GetData(inputs->GetInformationObject(sensor));
+    if (sensor == 0 || 6 * sensor > static_cast<int>(this->SensorPoses.size()))
+    {
+      append->AddInputData(input);
+      continue;
+    }
+    // same convention than the world transform
+    const double* p = &this->SensorPoses[6 * (sensor - 1)];
+    vtkNew<vtkTransform> transform;
+    transform->PostMultiply();
+    transform->RotateX(p[3]);
+    transform->RotateY(p[4]);
+    transform->RotateZ(p[5]);
+    transform->Translate(p[0], p[1], p[2]);
+    vtkNew<vtkTransformPolyDataFilter> transformFilter;
+    transformFilter->SetInputData(input);
+    transformFilter->SetTransform(transform.GetPointer());
+    transformFilter->Update();
+    append->AddInputData(transformFilter->GetOutput());
+  }
+  append->Update();
+  return append->GetOutput();
+}
+
 //-----------------------------------------------------------------------------
 std::vector<size_t> vtkSlam::GetLaserIdMapping(vtkTable *calib)
 {
@@ -213,15 +489,67 @@ std::vector<size_t> vtkSlam::GetLaserIdMapping(vtkTable *calib)
 int vtkSlam::RequestData(vtkInformation *vtkNotUsed(request),
 vtkInformationVector **inputVector, vtkInformationVector *outputVector)
 {
-  // Get the input
+  // Get the inputs, the frames of the additional sensors being
+  // given to the next connections of the first input
   vtkPolyData *input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
-  auto* calib = vtkTable::GetData(inputVector[1]->GetInformationObject(0));
-  std::vector<size_t> laserMapping = GetLaserIdMapping(calib);
+  const int nbSensors = inputVector[0]->GetNumberOfInformationObjects();
+  const int nbCalibs = inputVector[1]->GetNumberOfInformationObjects();
+  if (nbCalibs != 1 && nbCalibs != nbSensors)
+  {
+    vtkErrorMacro(<< "A calibration is required per sensor, or a single one shared by the sensors");
+    return 0;
+  }
+  this->ConfigureSensors(nbSensors);
 
-  pcl::PointCloud<Slam::Point>::Ptr pc (new pcl::PointCloud<Slam::Point>);
-  PointCloudFromPolyData(input, pc);
+  std::vector<pcl::PointCloud<Slam::Point>::Ptr> frames(nbSensors);
+  std::vector<std::vector<size_t> > laserMappings(nbSensors);
+  for (int sensor = 0; sensor < nbSensors; ++sensor)
+  {
+    auto* calib = vtkTable::GetData(inputVector[1]->GetInformationObject(nbCalibs == 1 ? 0 : sensor));
+    laserMappings[sensor] = GetLaserIdMapping(calib);
+    frames[sensor].reset(new pcl::PointCloud<Slam::Point>);
+    PointCloudFromPolyData(vtkPolyData::GetData(inputVector[0]->GetInformationObject(sensor)), frames[sensor]);
+  }
+  const pcl::PointCloud<Slam::Point>::Ptr& pc = frames[0];
+
+  const unsigned int nbrFrameProcessed = this->SlamAlgo.GetNbrFrameProcessed();
+  this->SlamAlgo.AddFrames(frames, laserMappings);
+
+  // output 5 - Time spent in each stage
+  TableFromTimings(this->SlamAlgo.GetTimings(), vtkTable::GetData(outputVector->GetInformationObject(5)));
+
+  // The results are the ones of the frame registered, which is the
+  // one given at the previous request in OverlappedPipeline mode
+  // With several sensors, the frame output is the merge of their frames,
+  // without the debug arrays which are only computed for the main sensor
+  vtkSmartPointer<vtkPolyData> frame = nbSensors > 1 ? this->MergeFrames(inputVector[0]) : input;
+  double frameTime = pc->points[0].time;
+  std::unordered_map<std::string, std::vector<double> > debugArray;
+  if (this->DisplayMode == true && nbSensors == 1)
+  {
+    debugArray = this->KeyPointsExtractor->GetExtractor()->GetDebugArray();
+  }
+  if (this->SlamAlgo.GetPipelineMode() == FramePipelineMode::OverlappedPipeline)
+  {
+    // the input data object may be reused by the upstream filter
+    frame = vtkSmartPointer<vtkPolyData>::New();
+    frame->ShallowCopy(input);
+    std::swap(frame, this->PendingFrame);
+    std::swap(frameTime, this->PendingFrameTime);
+    std::swap(debugArray, this->PendingDebugArray);
+  }
+  else
+  {
+    this->PendingFrame = nullptr;
+    this->PendingDebugArray.clear();
+  this->LoopClosedTrajectory = nullptr;
+  }
+  if (!frame || this->SlamAlgo.GetNbrFrameProcessed() == nbrFrameProcessed)
+  {
+    // no frame has been registered yet
+    return 1;
+  }
 
-  this->SlamAlgo.AddFrame(pc, laserMapping);
   // output 0 - Current Frame
   vtkInformation *outInfo0 = outputVector->GetInformationObject(0);
   vtkPolyData *output0 = vtkPolyData::SafeDownCast(
@@ -237,7 +565,7 @@ vtkInformationVector **inputVector, vtkInformationVector *outputVector)
   transform->Translate(Tworld.position);
   // create transform filter and transformt the current frame
   vtkSmartPointer<vtkTransformPolyDataFilter> transformFilter = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
-  transformFilter->SetInputData(input);
+  transformFilter->SetInputData(frame);
   transformFilter->SetTransform(transform);
   transformFilter->Update();
   output0->ShallowCopy(transformFilter->GetOutput());
@@ -245,8 +573,6 @@ vtkInformationVector **inputVector, vtkInformationVector *outputVector)
   // add all debug information if displayMode == True
   if (this->DisplayMode == true)
   {
-    std::unordered_map<std::string, std::vector<double> > debugArray =
-        this->KeyPointsExtractor->GetExtractor()->GetDebugArray();
     for (const auto& it : debugArray)
     {
       auto array = createArray<vtkDoubleArray>(it.first.c_str(), 1, it.second.size());
@@ -258,7 +584,7 @@ vtkInformationVector **inputVector, vtkInformationVector *outputVector)
 
   // output 1 - Trajectory
   Eigen::AngleAxisd m(RollPitchYawToMatrix(Tworld.rx, Tworld.ry, Tworld.rz));
-  this->Trajectory->PushBack(pc->points[0].time, m, Eigen::Vector3d(Tworld.position));
+  this->Trajectory->PushBack(frameTime, m, Eigen::Vector3d(Tworld.position));
   auto *output1 = vtkPolyData::GetData(outputVector->GetInformationObject(1));
   output1->ShallowCopy(this->Trajectory);
 
@@ -277,17 +603,61 @@ vtkInformationVector **inputVector, vtkInformationVector *outputVector)
   auto array = this->Trajectory->GetPointData()->GetArray("Covariance");
   array->InsertNextTuple(this->SlamAlgo.GetTransformCovariance().data());
 
+  // The maps can hold millions of points, they are only converted
+  // if they are output and if their output port is used downstream.
+  // Getting them also waits for the background update of the maps.
+  // The last conversion of each map is kept and output again as long
+  // as the points of the map and the decimation are unchanged.
+  auto outputMap = [this, outputVector](int port, unsigned long (Slam::*getVersion)(),
+                                        pcl::PointCloud<Slam::Point>::Ptr (Slam::*getMap)())
+  {
+    if (!this->OutputMaps || this->GetNumberOfOutputConnections(port) == 0)
+    {
+      return;
+    }
+    MapOutputCache& cache = this->MapsCache[port - 2];
+    const unsigned long version = (this->SlamAlgo.*getVersion)();
+    if (!cache.Map || cache.Version != version ||
+        cache.MaxNumberOfPoints != this->MapsMaxNumberOfPoints)
+    {
+      cache.Map = vtkSmartPointer<vtkPolyData>::New();
+      PolyDataFromPointCloud(DecimateCloud((this->SlamAlgo.*getMap)(), this->MapsMaxNumberOfPoints),
+                             cache.Map);
+      cache.Version = version;
+      cache.MaxNumberOfPoints = this->MapsMaxNumberOfPoints;
+    }
+    vtkPolyData::GetData(outputVector->GetInformationObject(port))->ShallowCopy(cache.Map);
+  };
+
   // output 2 - Edges Points Map
-  auto *EdgeMap = vtkPolyData::GetData(outputVector->GetInformationObject(2));
-  PolyDataFromPointCloud(this->SlamAlgo.GetEdgesMap(), EdgeMap);
+  outputMap(2, &Slam::GetEdgesMapVersion, &Slam::GetEdgesMap);
 
   // output 3 - Planar Points Map
-  auto *PlanarMap = vtkPolyData::GetData(outputVector->GetInformationObject(3));
-  PolyDataFromPointCloud(this->SlamAlgo.GetPlanarsMap(), PlanarMap);
+  outputMap(3, &Slam::GetPlanarsMapVersion, &Slam::GetPlanarsMap);
 
   // output 4 - Blob Points Map
-  auto *BlobMap = vtkPolyData::GetData(outputVector->GetInformationObject(4));
-  PolyDataFromPointCloud(this->SlamAlgo.GetBlobsMap(), BlobMap);
+  outputMap(4, &Slam::GetBlobsMapVersion, &Slam::GetBlobsMap);
+
+  // output 6 - Key frames corrected by the last loop closure, which
+  // only change when a loop is closed or a key frame is added
+  std::vector<double> keyframesTimes;
+  PoseVector keyframesPoses;
+  this->SlamAlgo.GetLoopClosedKeyframes(keyframesTimes, keyframesPoses);
+  const unsigned long loopClosureVersion = this->SlamAlgo.GetLoopClosureVersion();
+  if (!this->LoopClosedTrajectory ||
+      this->LoopClosedTrajectoryVersion != loopClosureVersion ||
+      this->LoopClosedTrajectory->GetNumberOfPoints() != static_cast<vtkIdType>(keyframesPoses.size()))
+  {
+    this->LoopClosedTrajectory = vtkSmartPointer<vtkTemporalTransforms>::New();
+    for (size_t k = 0; k < keyframesPoses.size(); ++k)
+    {
+      const Eigen::Matrix3d rotation = keyframesPoses[k].block(0, 0, 3, 3);
+      const Eigen::Vector3d translation = keyframesPoses[k].block(0, 3, 3, 1);
+      this->LoopClosedTrajectory->PushBack(keyframesTimes[k], Eigen::AngleAxisd(rotation), translation);
+    }
+    this->LoopClosedTrajectoryVersion = loopClosureVersion;
+  }
+  vtkPolyData::GetData(outputVector->GetInformationObject(6))->ShallowCopy(this->LoopClosedTrajectory);
 
   return 1;
 }
@@ -321,7 +691,7 @@ void vtkSlam::PrintSelf(ostream& os, vtkIndent indent)
 vtkSlam::vtkSlam()
 {
   this->SetNumberOfInputPorts(2);
-  this->SetNumberOfOutputPorts(5);
+  this->SetNumberOfOutputPorts(7);
   this->Reset();
 }
 
@@ -329,6 +699,8 @@ vtkSlam::vtkSlam()
 void vtkSlam::Reset()
 {
   this->SlamAlgo.Reset();
+  this->PendingFrame = nullptr;
+  this->PendingDebugArray.clear();
 
   // output of the vtk filter
   this->Trajectory = vtkSmartPointer<vtkTemporalTransforms>::New();
@@ -344,25 +716,45 @@ void vtkSlam::Reset()
       this->Trajectory->GetPointData()->AddArray(createArray<vtkDoubleArray>("Mapping: planes used"));
       this->Trajectory->GetPointData()->AddArray(createArray<vtkDoubleArray>("Mapping: blobs used"));
       this->Trajectory->GetPointData()->AddArray(createArray<vtkDoubleArray>("Mapping: variance error"));
+      this->Trajectory->GetPointData()->AddArray(createArray<vtkDoubleArray>("Keyframe"));
+      for (int stage = 0; stage < SlamStage::NbrSlamStages; ++stage)
+      {
+        this->Trajectory->GetPointData()->AddArray(createArray<vtkDoubleArray>(
+          Slam::GetStageDebugName(static_cast<SlamStage>(stage))));
+      }
   }
 }
 
 //-----------------------------------------------------------------------------
 int vtkSlam::FillInputPortInformation(int port, vtkInformation *info)
 {
+  // the frames and calibrations of several sensors can be connected
   if ( port == 0 )
   {
     info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkPolyData" );
+    info->Set(vtkAlgorithm::INPUT_IS_REPEATABLE(), 1);
     return 1;
   }
   if ( port == 1 )
   {
     info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkTable" );
+    info->Set(vtkAlgorithm::INPUT_IS_REPEATABLE(), 1);
     return 1;
   }
   return 0;
 }
 
+//-----------------------------------------------------------------------------
+int vtkSlam::FillOutputPortInformation(int port, vtkInformation *info)
+{
+  if ( port == 5 )
+  {
+    info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkTable" );
+    return 1;
+  }
+  return this->Superclass::FillOutputPortInformation(port, info);
+}
+
 //-----------------------------------------------------------------------------
 void vtkSlam::SetVoxelGridLeafSizeEdges(double size)
 {
@@ -397,3 +789,17 @@ void vtkSlam::SetVoxelGridResolution(double resolution)
   this->SlamAlgo.SetVoxelGridResolution(resolution);
   this->ParametersModificationTime.Modified();
 }
+
+//-----------------------------------------------------------------------------
+void vtkSlam::SetLocalizationMapFile(const char* filename)
+{
+  const std::string name = filename ? filename : "";
+  if (name == this->SlamAlgo.GetLocalizationMapFile())
+  {
+    return;
+  }
+  this->SlamAlgo.SetLocalizationMapFile(name);
+  this->Reset();
+  this->Modified();
+  this->ParametersModificationTime.Modified();
+}
@@ -122,6 +122,12 @@ public:
   vtkGetMacro(DisplayMode, bool)
   vtkSetMacro(DisplayMode, bool)
 
+  vtkGetMacro(OutputMaps, bool)
+  vtkSetMacro(OutputMaps, bool)
+
+  vtkGetMacro(MapsMaxNumberOfPoints, unsigned int)
+  vtkSetMacro(MapsMaxNumberOfPoints, unsigned int)
+
   vtkCustomGetMacro(MaxDistBetweenTwoFrames, double)
   vtkCustomSetMacro(MaxDistBetweenTwoFrames, double)
 
@@ -134,16 +140,76 @@ public:
   vtkCustomGetMacro(Undistortion, bool)
   vtkCustomSetMacro(Undistortion, bool)
 
+  vtkCustomGetMacro(UndistortionNumberOfBins, unsigned int)
+  vtkCustomSetMacro(UndistortionNumberOfBins, unsigned int)
+
+  vtkCustomGetMacro(NumberOfThreads, unsigned int)
+  vtkCustomSetMacro(NumberOfThreads, unsigned int)
+
+  vtkCustomGetMacro(LoopClosure, bool)
+  vtkCustomSetMacro(LoopClosure, bool)
+
+  vtkCustomGetMacro(LoopClosureKeyframeDistance, double)
+  vtkCustomSetMacro(LoopClosureKeyframeDistance, double)
+
+  vtkCustomGetMacro(LoopClosureDescriptorThreshold, double)
+  vtkCustomSetMacro(LoopClosureDescriptorThreshold, double)
+
+  vtkCustomGetMacro(LoopClosureMinimumInlierRatio, double)
+  vtkCustomSetMacro(LoopClosureMinimumInlierRatio, double)
+
+  vtkCustomGetMacro(BackgroundKDTreeBuild, bool)
+  vtkCustomSetMacro(BackgroundKDTreeBuild, bool)
+
+  vtkCustomGetMacro(SinglePrecisionPCA, bool)
+  vtkCustomSetMacro(SinglePrecisionPCA, bool)
+
+  vtkCustomGetMacro(AnalyticJacobians, bool)
+  vtkCustomSetMacro(AnalyticJacobians, bool)
+
+  vtkCustomGetMacro(KeyframeDistance, double)
+  vtkCustomSetMacro(KeyframeDistance, double)
+
+  vtkCustomGetMacro(KeyframeAngle, double)
+  vtkCustomSetMacro(KeyframeAngle, double)
+
+  vtkCustomGetMacro(KeyframeMinOverlap, double)
+  vtkCustomSetMacro(KeyframeMinOverlap, double)
+
+  vtkCustomGetMacro(KeyframeSkipMapping, bool)
+  vtkCustomSetMacro(KeyframeSkipMapping, bool)
+
+  vtkCustomGetMacro(PipelineMode, int)
+  vtkCustomSetMacro(PipelineMode, int)
+
   vtkGetObjectMacro(KeyPointsExtractor, vtkSpinningSensorKeypointExtractor)
   virtual void SetKeyPointsExtractor(vtkSpinningSensorKeypointExtractor *);
 
-  // Set RollingGrid Parameters
+  // Poses of the additional sensors, whose frames are given to the next
+  // connections of the first input, in the referential of the main sensor:
+  // translation x, y, z in meters then rotation rx, ry, rz in degrees.
+  // Their keypoints are extracted with the parameters of KeyPointsExtractor
+  void SetNumberOfSensorPoses(int number);
+  void SetSensorPose(int index, double x, double y, double z, double rx, double ry, double rz);
+
+  // Set LocalMap Parameters
   void SetVoxelGridLeafSizeEdges(double size);
   void SetVoxelGridLeafSizePlanes(double size);
   void SetVoxelGridLeafSizeBlobs(double size);
   void SetVoxelGridSize(unsigned int size);
   void SetVoxelGridResolution(double resolution);
 
+  vtkCustomGetMacro(MapBackend, int)
+  vtkCustomSetMacro(MapBackend, int)
+
+  vtkCustomSetMacro(MapTilesDirectory, const char*)
+
+  // Changing the localization map resets the slam
+  void SetLocalizationMapFile(const char* filename);
+
+  // Save the keypoint maps, to localize in them later
+  bool SaveMaps(const char* filename) { return this->SlamAlgo.SaveMaps(filename); }
+
   // Get/Set EgoMotion
   vtkCustomGetMacro(EgoMotionLMMaxIter, unsigned int)
   vtkCustomSetMacro(EgoMotionLMMaxIter, unsigned int)
@@ -185,9 +251,21 @@ public:
   vtkCustomGetMacro(MappingLMMaxIter, unsigned int)
   vtkCustomSetMacro(MappingLMMaxIter, unsigned int)
 
+  vtkCustomGetMacro(SolverNumberOfThreads, unsigned int)
+  vtkCustomSetMacro(SolverNumberOfThreads, unsigned int)
+
+  vtkCustomGetMacro(SolverLinearSolver, int)
+  vtkCustomSetMacro(SolverLinearSolver, int)
+
   vtkCustomGetMacro(MappingICPMaxIter, unsigned int)
   vtkCustomSetMacro(MappingICPMaxIter, unsigned int)
 
+  vtkCustomGetMacro(MappingCoarseICPIter, unsigned int)
+  vtkCustomSetMacro(MappingCoarseICPIter, unsigned int)
+
+  vtkCustomGetMacro(MappingCoarseLeafSize, double)
+  vtkCustomSetMacro(MappingCoarseLeafSize, double)
+
   vtkCustomGetMacro(MappingLineDistanceNbrNeighbors, unsigned int)
   vtkCustomSetMacro(MappingLineDistanceNbrNeighbors, unsigned int)
 
@@ -226,6 +304,7 @@ protected:
   void Reset();
 
   int FillInputPortInformation(int port, vtkInformation* info) override;
+  int FillOutputPortInformation(int port, vtkInformation* info) override;
   int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
 
   // Keeps track of the time the parameters have been modified
@@ -244,11 +323,52 @@ private:
   vtkSmartPointer<vtkTemporalTransforms> Trajectory;
   std::vector<size_t> GetLaserIdMapping(vtkTable *calib);
 
+  // Poses of the additional sensors, 6 values per sensor
+  std::vector<double> SensorPoses;
+
+  // Add a keypoints extractor and a pose per additional sensor to the slam
+  // when the number of sensors, their poses or the parameters of the
+  // extractor changed since the last configuration
+  void ConfigureSensors(int numberOfSensors);
+  vtkTimeStamp SensorsConfigurationTime;
+
+  // Frames of the sensors in the referential of the main one, to output
+  vtkSmartPointer<vtkPolyData> MergeFrames(vtkInformationVector* inputs);
+
+  // In OverlappedPipeline mode, the frame given at the previous
+  // request, which is the one registered by the current request,
+  // with its time and the debug arrays of its keypoints
+  vtkSmartPointer<vtkPolyData> PendingFrame;
+  double PendingFrameTime = 0;
+  std::unordered_map<std::string, std::vector<double> > PendingDebugArray;
+
   // Indicate if we are in display mode or not
   // Display mode will add arrays showing some
   // results of the slam algorithm such as
   // the keypoints extracted, curvature etc
   bool DisplayMode = true;
+
+  // Should the maps be output, they are converted at each
+  // request only if their output port is connected
+  bool OutputMaps = true;
+
+  // Level of detail of the maps output, they are decimated on a voxel
+  // grid to keep at most this number of points. 0 keeps all the points.
+  unsigned int MapsMaxNumberOfPoints = 0;
+
+  // Last conversion of a map, with the version of its points and
+  // the decimation it was converted with
+  struct MapOutputCache
+  {
+    vtkSmartPointer<vtkPolyData> Map;
+    unsigned long Version = 0;
+    unsigned int MaxNumberOfPoints = 0;
+  };
+  MapOutputCache MapsCache[3];
+
+  // Last conversion of the loop closed key frames, with their version
+  vtkSmartPointer<vtkTemporalTransforms> LoopClosedTrajectory;
+  unsigned long LoopClosedTrajectoryVersion = 0;
 };
 
 template <typename T>
@@ -19,6 +19,7 @@
 #include <vtkObjectFactory.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
+#include <vtkDataObject.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
 #include <sstream>
 
@@ -92,7 +93,7 @@ int vtkSlamManager::RequestData(vtkInformation *request, vtkInformationVector **
     {
       for (int i = 0; i < this->GetNumberOfOutputPorts(); ++i)
       {
-        auto *output = vtkPolyData::GetData(outputVector->GetInformationObject(i));
+        auto *output = vtkDataObject::GetData(outputVector, i);
         output->ShallowCopy(this->Cache[i]);
       }
       return 1;
@@ -132,8 +133,10 @@ int vtkSlamManager::RequestData(vtkInformation *request, vtkInformationVector **
     this->Cache.clear();
     for (int i = 0; i < this->GetNumberOfOutputPorts(); ++i)
     {
-      auto output = vtkSmartPointer<vtkPolyData>::New();
-      output->DeepCopy(vtkPolyData::GetData(outputVector->GetInformationObject(i)));
+      // the outputs are not all polydata
+      vtkDataObject* input = vtkDataObject::GetData(outputVector, i);
+      vtkSmartPointer<vtkDataObject> output = vtkSmartPointer<vtkDataObject>::Take(input->NewInstance());
+      output->DeepCopy(input);
       this->Cache.push_back(output);
     }
   }
@@ -95,7 +95,7 @@ private:
   bool FirstIteration = true;
   int CurrentFrame = 0;
   vtkMTimeType LastModifyTime = 0;
-  std::vector<vtkSmartPointer<vtkPolyData>> Cache;
+  std::vector<vtkSmartPointer<vtkDataObject>> Cache;
 };
 
 #endif // VTKSLAMMANAGER_H
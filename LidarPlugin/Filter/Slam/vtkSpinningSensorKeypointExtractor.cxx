@@ -50,6 +50,7 @@ void vtkSpinningSensorKeypointExtractor::PrintSelf(std::ostream &os, vtkIndent i
   PrintParameter(SaillancyThreshold)
   PrintParameter(FarestKeypointDist)
   PrintParameter(NLasers)
+  PrintParameter(NumberOfThreads)
 
 }
 
@@ -65,6 +65,8 @@ public:
 
   vtkCustomSetMacro(SaillancyThreshold, double)
 
+  vtkCustomSetMacro(NumberOfThreads, unsigned int)
+
   std::shared_ptr<SpinningSensorKeypointExtractor> GetExtractor() { return Extractor; }
 
 protected:
@@ -15,17 +15,56 @@
 #include "vtkTemporalTransformsApplier.h"
 
 #include <vtkCellData.h>
+#include <vtkDataArray.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
+#include <vtkMatrix4x4.h>
 #include <vtkObjectFactory.h>
 #include <vtkPointData.h>
+#include <vtkPoints.h>
 #include <vtkPolyData.h>
 #include <vtkSmartPointer.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
 #include <vtkTransform.h>
 
+#include "ParallelFor.h"
+#include "vtkHelper.h"
 #include "vtkTemporalTransforms.h"
 
+#include <Eigen/Geometry>
+#include <Eigen/StdVector>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Transform a point of the input into the output, which have the same data type
+void TransformPoint(vtkTransform* transform, vtkPoints* input, vtkPoints* output, vtkIdType i)
+{
+  switch (input->GetDataType())
+  {
+    case VTK_FLOAT:
+      transform->InternalTransformPoint(static_cast<float*>(input->GetVoidPointer(3 * i)),
+                                        static_cast<float*>(output->GetVoidPointer(3 * i)));
+      break;
+    case VTK_DOUBLE:
+      transform->InternalTransformPoint(static_cast<double*>(input->GetVoidPointer(3 * i)),
+                                        static_cast<double*>(output->GetVoidPointer(3 * i)));
+      break;
+    default:
+    {
+      double point[3];
+      input->GetPoint(i, point);
+      transform->InternalTransformPoint(point, point);
+      output->SetPoint(i, point);
+    }
+  }
+}
+}
+
 //-----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkTemporalTransformsApplier)
 
@@ -68,7 +107,12 @@ int vtkTemporalTransformsApplier::RequestData(vtkInformation* vtkNotUsed(request
   // Copy the input and create some new points
   vtkPolyData* output = vtkPolyData::GetData(outputVector);
   output->ShallowCopy(pointcloud);
+  // the points keep their precision
   auto points = vtkSmartPointer<vtkPoints>::New();
+  if (pointcloud->GetPoints())
+  {
+    points->SetDataType(pointcloud->GetPoints()->GetDataType());
+  }
   points->SetNumberOfPoints(pointcloud->GetNumberOfPoints());
   output->SetPoints(points);
 
@@ -88,11 +132,7 @@ int vtkTemporalTransformsApplier::RequestData(vtkInformation* vtkNotUsed(request
     // apply the transform
     for (vtkIdType i = 0; i < pointcloud->GetNumberOfPoints(); i++)
     {
-      float* inputPoint = reinterpret_cast<float*>
-          (pointcloud->GetPoints()->GetData()->WriteVoidPointer(3*i,1));
-      float* outputPoint = reinterpret_cast<float*>
-          (output->GetPoints()->GetData()->WriteVoidPointer(3*i,1));
-      transform->InternalTransformPoint(inputPoint, outputPoint);
+      TransformPoint(transform, pointcloud->GetPoints(), points, i);
     }
   }
   // Apply an individual transform to each points. The transform is determined by
@@ -105,6 +145,11 @@ int vtkTemporalTransformsApplier::RequestData(vtkInformation* vtkNotUsed(request
       vtkErrorMacro(<<"No TimeStamp array selected.")
       return 1;
     }
+    if (this->NumberOfInterpolationSamples > 0)
+    {
+      this->ApplySampledTransforms(pointcloud, timestamp, output);
+      return 1;
+    }
     for (vtkIdType i = 0; i < pointcloud->GetNumberOfPoints(); i++)
     {
       // get timestamp in seconds
@@ -116,11 +161,7 @@ int vtkTemporalTransformsApplier::RequestData(vtkInformation* vtkNotUsed(request
       transform->Update();
 
       // apply the transform
-      float* inputPoint = reinterpret_cast<float*>
-          (pointcloud->GetPoints()->GetData()->WriteVoidPointer(3*i,1));
-      float* outputPoint = reinterpret_cast<float*>
-          (output->GetPoints()->GetData()->WriteVoidPointer(3*i,1));
-      transform->InternalTransformPoint(inputPoint, outputPoint);
+      TransformPoint(transform, pointcloud->GetPoints(), points, i);
     }
   }
 
@@ -150,3 +191,98 @@ int vtkTemporalTransformsApplier::RequestInformation(vtkInformation* vtkNotUsed(
   outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(), &timesteps.front(), timesteps.size());
   return 1;
 }
+
+//-----------------------------------------------------------------------------
+void vtkTemporalTransformsApplier::ApplySampledTransforms(vtkPolyData* pointcloud,
+                                                          vtkDataArray* timestamp,
+                                                          vtkPolyData* output)
+{
+  const vtkIdType numPoints = pointcloud->GetNumberOfPoints();
+  if (numPoints == 0)
+  {
+    return;
+  }
+
+  // get the time range of the frame in seconds
+  const std::vector<double> times = getComponentValues<double>(timestamp);
+  double timeRange[2] = {std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()};
+  for (vtkIdType i = 0; i < numPoints; i++)
+  {
+    const double t = times[i] * 1e-6;
+    timeRange[0] = std::min(timeRange[0], t);
+    timeRange[1] = std::max(timeRange[1], t);
+  }
+
+  // sample the trajectory over the frame, the orientations being
+  // kept in the same hemisphere so that they can be blended
+  const unsigned int nbIntervals = this->NumberOfInterpolationSamples;
+  const double dt = (timeRange[1] - timeRange[0]) / nbIntervals;
+  std::vector<Eigen::Quaterniond, Eigen::aligned_allocator<Eigen::Quaterniond> > rotations(nbIntervals + 1);
+  std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > translations(nbIntervals + 1);
+  std::vector<double> sampleTimes(nbIntervals + 1), orientations(4 * (nbIntervals + 1)),
+                      positions(3 * (nbIntervals + 1));
+  for (unsigned int s = 0; s <= nbIntervals; ++s)
+  {
+    sampleTimes[s] = timeRange[0] + s * dt;
+  }
+  this->Interpolator->InterpolateTransforms(nbIntervals + 1, sampleTimes.data(),
+                                            orientations.data(), positions.data());
+  for (unsigned int s = 0; s <= nbIntervals; ++s)
+  {
+    const double* q = &orientations[4 * s];
+    rotations[s] = Eigen::Quaterniond(q[0], q[1], q[2], q[3]);
+    translations[s] = Eigen::Vector3d(&positions[3 * s]);
+    if (s > 0 && rotations[s].dot(rotations[s - 1]) < 0.0)
+    {
+      rotations[s].coeffs() = -rotations[s].coeffs();
+    }
+  }
+
+  // the sub-intervals are short enough for the normalized linear
+  // interpolation of the orientations to match their slerp
+  vtkPoints* inputPoints = pointcloud->GetPoints();
+  vtkPoints* outputPoints = output->GetPoints();
+  float* outputFloats = outputPoints->GetDataType() == VTK_FLOAT ?
+    static_cast<float*>(outputPoints->GetVoidPointer(0)) : nullptr;
+  double* outputDoubles = outputPoints->GetDataType() == VTK_DOUBLE ?
+    static_cast<double*>(outputPoints->GetVoidPointer(0)) : nullptr;
+  auto transformPoints = [&](vtkIdType begin, vtkIdType end)
+  {
+    double inputPoint[3];
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      double u = dt > 0.0 ? (times[i] * 1e-6 - timeRange[0]) / dt : 0.0;
+      const unsigned int s = static_cast<unsigned int>(std::min(std::max(std::floor(u), 0.0), nbIntervals - 1.0));
+      const double a = std::min(std::max(u - s, 0.0), 1.0);
+      Eigen::Quaterniond q;
+      q.coeffs() = (1.0 - a) * rotations[s].coeffs() + a * rotations[s + 1].coeffs();
+      q.normalize();
+      const Eigen::Vector3d T = (1.0 - a) * translations[s] + a * translations[s + 1];
+
+      inputPoints->GetPoint(i, inputPoint);
+      const Eigen::Vector3d X = q * Eigen::Vector3d(inputPoint[0], inputPoint[1], inputPoint[2]) + T;
+      if (outputFloats)
+      {
+        outputFloats[3 * i] = static_cast<float>(X(0));
+        outputFloats[3 * i + 1] = static_cast<float>(X(1));
+        outputFloats[3 * i + 2] = static_cast<float>(X(2));
+      }
+      else if (outputDoubles)
+      {
+        outputDoubles[3 * i] = X(0);
+        outputDoubles[3 * i + 1] = X(1);
+        outputDoubles[3 * i + 2] = X(2);
+      }
+      else
+      {
+        // each thread sets its own tuples, which does not resize the array
+        outputPoints->GetData()->SetTuple3(i, X(0), X(1), X(2));
+      }
+    }
+  };
+
+  // The points are transformed by blocks, the blocks being shared between the threads
+  const size_t blockSize = 16384;
+  Parallel::ForEachChunk(numPoints, blockSize, std::max(0, this->NumberOfThreads),
+    [&](unsigned int, size_t begin, size_t end) { transformPoints(begin, end); });
+}
@@ -48,6 +48,22 @@ public:
   vtkSetMacro(InterpolateEachPoint, bool)
   //@}
 
+  //@{
+  /**
+   * @copydoc vtkTemporalTransformsApplier::NumberOfInterpolationSamples
+   */
+  vtkGetMacro(NumberOfInterpolationSamples, unsigned int)
+  vtkSetMacro(NumberOfInterpolationSamples, unsigned int)
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkTemporalTransformsApplier::NumberOfThreads
+   */
+  vtkGetMacro(NumberOfThreads, int)
+  vtkSetMacro(NumberOfThreads, int)
+  //@}
+
   /**
    * @brief Override GetMTime() because we depend on the TransformInterpolator
    * which may be modified outside of this class.
@@ -66,12 +82,26 @@ protected:
                   vtkInformationVector* outputVector);
 
 private:
+  //! Transform the points of the pointcloud, each one by the pose
+  //! of the sensor at its timestamp, sampling the trajectory
+  void ApplySampledTransforms(vtkPolyData* pointcloud, vtkDataArray* timestamp, vtkPolyData* output);
+
     //! Indicate if a different transform should be apply to each point,
   //! or if the same transform should be apply to the whole point cloud.
   //! In the first case you must specify the array from the pointcloud containing the
   //! timestamp with 'SetInputArrayToProcess'
   bool InterpolateEachPoint;
 
+  //! When interpolating each point, number of sub-intervals of the time range
+  //! of the frame at which the trajectory is sampled. The pose of a point is
+  //! then blended from the two samples around its timestamp, which avoids
+  //! calling the interpolator for every point. 0 interpolates the trajectory
+  //! exactly at each point timestamp.
+  unsigned int NumberOfInterpolationSamples = 100;
+
+  //! Number of threads transforming the points, 0 to use all the cores
+  int NumberOfThreads = 0;
+
   //! Interpolator used to get the right transform
   vtkSmartPointer<vtkCustomTransformInterpolator> Interpolator;
 
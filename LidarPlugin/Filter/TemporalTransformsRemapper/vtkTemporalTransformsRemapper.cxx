@@ -5,8 +5,19 @@
 #include <vtkSmartPointer.h>
 #include <vtkInformationVector.h>
 
+#include "ParallelFor.h"
 #include "vtkGeometricCalibration.h"
 
+#include <algorithm>
+#include <vector>
+
+#include <Eigen/Geometry>
+
+namespace {
+// Number of times interpolated by a thread at a time
+const size_t ChunkSize = 16384;
+}
+
 //-----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkTemporalTransformsRemapper)
 
@@ -17,18 +28,148 @@ vtkTemporalTransformsRemapper::vtkTemporalTransformsRemapper()
   this->SetNumberOfOutputPorts(1);
 }
 
+//-----------------------------------------------------------------------------
+void vtkTemporalTransformsRemapper::ClearResampled()
+{
+  this->ResampledTimes = nullptr;
+  this->ResampledOrientations = nullptr;
+  this->ResampledPositions = nullptr;
+  this->Interpolator = nullptr;
+  this->InterpolatorMTime = 0;
+  this->ResampledNumberOfTransforms = 0;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkTemporalTransformsRemapper::Resample(vtkDataArray* referenceTimes, vtkPolyData* toAlignPoly)
+{
+  auto toAlign = vtkTemporalTransforms::CreateFromPolyData(toAlignPoly);
+  if (!toAlign || toAlign->GetNumberOfPoints() == 0)
+  {
+    vtkErrorMacro("ToAlign is not a trajectory with some transforms");
+    return false;
+  }
+  vtkDataArray* toAlignTimes = toAlign->GetTimeArray();
+  const vtkIdType nbToAlign = toAlign->GetNumberOfPoints();
+  const vtkIdType nbTimes = referenceTimes->GetNumberOfTuples();
+
+  // the interpolated transforms are kept when the inputs have only grown by their end,
+  // except the ones after the previous last transform of ToAlign, which were clamped
+  vtkIdType first = 0;
+  if (this->Streaming && this->ResampledTimes && this->GetMTime() == this->ResampledFilterMTime)
+  {
+    const vtkIdType nbResampled = this->ResampledTimes->GetNumberOfTuples();
+    const bool grown = nbTimes >= nbResampled && nbToAlign >= this->ResampledNumberOfTransforms
+      && toAlignTimes->GetTuple1(0) == this->ResampledTimeRange[0]
+      && toAlignTimes->GetTuple1(this->ResampledNumberOfTransforms - 1) == this->ResampledTimeRange[1]
+      && (nbResampled == 0
+          || referenceTimes->GetTuple1(nbResampled - 1) * this->ReferenceTimeScale
+             == this->ResampledTimes->GetValue(nbResampled - 1));
+    if (grown)
+    {
+      first = nbResampled;
+      while (first > 0 && this->ResampledTimes->GetValue(first - 1) >= this->ResampledTimeRange[1])
+      {
+        --first;
+      }
+    }
+  }
+  if (first == 0)
+  {
+    this->ResampledTimes = vtkSmartPointer<vtkDoubleArray>::New();
+    this->ResampledOrientations = vtkSmartPointer<vtkDoubleArray>::New();
+    this->ResampledOrientations->SetNumberOfComponents(4);
+    this->ResampledPositions = vtkSmartPointer<vtkDoubleArray>::New();
+    this->ResampledPositions->SetNumberOfComponents(3);
+  }
+  if (!this->Interpolator || toAlignPoly->GetMTime() != this->InterpolatorMTime)
+  {
+    this->Interpolator = toAlign->CreateInterpolator();
+    this->InterpolatorMTime = toAlignPoly->GetMTime();
+  }
+  // the linear interpolation only reads the transforms, so it can be shared by the threads
+  this->Interpolator->SetInterpolationTypeToLinear();
+
+  // the existing values are kept by the resizing
+  this->ResampledTimes->SetNumberOfTuples(nbTimes);
+  this->ResampledOrientations->SetNumberOfTuples(nbTimes);
+  this->ResampledPositions->SetNumberOfTuples(nbTimes);
+  double* times = this->ResampledTimes->GetPointer(0);
+  double* orientations = this->ResampledOrientations->GetPointer(0);
+  double* positions = this->ResampledPositions->GetPointer(0);
+  const double scale = this->ReferenceTimeScale;
+  vtkCustomTransformInterpolator* interpolator = this->Interpolator;
+  for (vtkIdType i = first; i < nbTimes; ++i)
+  {
+    times[i] = referenceTimes->GetComponent(i, 0) * scale;
+  }
+  Parallel::ForEachChunk(nbTimes - first, ChunkSize, this->NumberOfThreads,
+    [&](unsigned int, size_t chunkBegin, size_t chunkEnd)
+  {
+    const vtkIdType begin = first + static_cast<vtkIdType>(chunkBegin);
+    const int n = static_cast<int>(chunkEnd - chunkBegin);
+    std::vector<double> quaternions(4 * n);
+    interpolator->InterpolateTransforms(n, times + begin, quaternions.data(), positions + 3 * begin);
+
+    // the trajectories store the orientations as axis angle
+    for (int k = 0; k < n; ++k)
+    {
+      const double* q = &quaternions[4 * k];
+      const Eigen::AngleAxisd orientation(Eigen::Quaterniond(q[0], q[1], q[2], q[3]));
+      double* axisAngle = orientations + 4 * (begin + k);
+      axisAngle[0] = orientation.axis()[0];
+      axisAngle[1] = orientation.axis()[1];
+      axisAngle[2] = orientation.axis()[2];
+      axisAngle[3] = orientation.angle();
+    }
+  });
+  this->ResampledTimes->Modified();
+  this->ResampledOrientations->Modified();
+  this->ResampledPositions->Modified();
+
+  this->ResampledFilterMTime = this->GetMTime();
+  this->ResampledNumberOfTransforms = nbToAlign;
+  this->ResampledTimeRange[0] = toAlignTimes->GetTuple1(0);
+  this->ResampledTimeRange[1] = toAlignTimes->GetTuple1(nbToAlign - 1);
+  this->NumberOfInterpolatedTransforms = static_cast<int>(nbTimes - first);
+  return true;
+}
+
 //-----------------------------------------------------------------------------
 int vtkTemporalTransformsRemapper::RequestData(vtkInformation *, vtkInformationVector **inputVector, vtkInformationVector *outputVector)
 {
   vtkPolyData* referencePoly = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
   vtkPolyData* toAlignPoly = vtkPolyData::GetData(inputVector[1]->GetInformationObject(0));
+  auto *output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
 
+  if (this->Mode == RESAMPLE_ON_REFERENCE_TIMES)
+  {
+    vtkDataArray* referenceTimes =
+      referencePoly->GetPointData()->GetArray(this->ReferenceTimeArrayName.c_str());
+    if (!referenceTimes)
+    {
+      vtkErrorMacro("Reference has no " << this->ReferenceTimeArrayName << " array");
+      this->ClearResampled();
+      return 0;
+    }
+    if (!this->Resample(referenceTimes, toAlignPoly))
+    {
+      this->ClearResampled();
+      return 0;
+    }
+    auto result = vtkSmartPointer<vtkTemporalTransforms>::New();
+    result->SetTimeArray(this->ResampledTimes);
+    result->SetOrientationArray(this->ResampledOrientations);
+    result->SetTranslationArray(this->ResampledPositions);
+    output->ShallowCopy(result);
+    return VTK_OK;
+  }
+
+  this->ClearResampled();
   auto reference = vtkTemporalTransforms::CreateFromPolyData(referencePoly);
   auto toAlign = vtkTemporalTransforms::CreateFromPolyData(toAlignPoly);
 
   vtkSmartPointer<vtkTemporalTransforms> result = MatchTrajectoriesWithIsometryAndApply(reference, toAlign);
 
-  auto *output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
   output->ShallowCopy(result);
   return VTK_OK;
 }
@@ -1,22 +1,106 @@
 #ifndef vtkTemporalTransformsRemapper_H
 #define vtkTemporalTransformsRemapper_H
 
+#include <string>
+#include <vector>
+
+#include <vtkDoubleArray.h>
 #include <vtkPolyDataAlgorithm.h>
+#include <vtkSmartPointer.h>
+
+class vtkCustomTransformInterpolator;
 
+/**
+ * @brief The vtkTemporalTransformsRemapper maps the ToAlign trajectory on the Reference
+ * one, either in space or in time.
+ *
+ * In ALIGN_TRAJECTORIES mode, the isometry which best matches ToAlign on Reference is
+ * estimated and applied to ToAlign.
+ *
+ * In RESAMPLE_ON_REFERENCE_TIMES mode, ToAlign is linearly interpolated at each time of
+ * the ReferenceTimeArrayName array of Reference, which can be any poly data, for example
+ * the points of a lidar frame. The times are interpolated at once, in chunks distributed
+ * over NumberOfThreads threads, the transforms bracketing a time being found from the
+ * ones of the previous time when the times increase. The times out of ToAlign are clamped.
+ *
+ * When Streaming is on, the inputs are expected to only grow by their end, as when they
+ * are appended while they are acquired: only the new reference times and the ones after
+ * the previous last transform of ToAlign are interpolated, the others are kept.
+ */
 class VTK_EXPORT vtkTemporalTransformsRemapper : public vtkPolyDataAlgorithm
 {
 public:
   static vtkTemporalTransformsRemapper *New();
   vtkTypeMacro(vtkTemporalTransformsRemapper, vtkPolyDataAlgorithm);
 
+  enum Modes
+  {
+    ALIGN_TRAJECTORIES = 0,
+    RESAMPLE_ON_REFERENCE_TIMES = 1
+  };
+
+  vtkGetMacro(Mode, int)
+  vtkSetClampMacro(Mode, int, ALIGN_TRAJECTORIES, RESAMPLE_ON_REFERENCE_TIMES)
+
+  vtkGetMacro(ReferenceTimeArrayName, std::string)
+  vtkSetMacro(ReferenceTimeArrayName, std::string)
+
+  vtkGetMacro(ReferenceTimeScale, double)
+  vtkSetMacro(ReferenceTimeScale, double)
+
+  vtkGetMacro(Streaming, bool)
+  vtkSetMacro(Streaming, bool)
+
+  vtkGetMacro(NumberOfThreads, unsigned int)
+  vtkSetMacro(NumberOfThreads, unsigned int)
+
+  //! Number of transforms interpolated by the last update, less than the number of
+  //! reference times when some of them were kept in Streaming mode
+  vtkGetMacro(NumberOfInterpolatedTransforms, int)
+
 protected:
   vtkTemporalTransformsRemapper();
   int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
 
-
 private:
   vtkTemporalTransformsRemapper(const vtkTemporalTransformsRemapper&) = delete;
   void operator = (const vtkTemporalTransformsRemapper&) = delete;
+
+  //! Interpolate toAlign at the reference times, reusing the previous results in Streaming mode
+  bool Resample(vtkDataArray* referenceTimes, vtkPolyData* toAlignPoly);
+
+  //! Forget the transforms kept for Streaming mode
+  void ClearResampled();
+
+  //! see Modes
+  int Mode = ALIGN_TRAJECTORIES;
+
+  //! Name of the array of Reference giving the times at which ToAlign is interpolated
+  std::string ReferenceTimeArrayName = "Time";
+
+  //! Factor converting the reference times to the unit of the times of ToAlign,
+  //! for example 1e-6 for times in microseconds and transforms in seconds
+  double ReferenceTimeScale = 1.0;
+
+  //! Only interpolate the times which may have changed since the last update
+  bool Streaming = false;
+
+  //! Number of threads interpolating the transforms, 0 to use all the cores
+  unsigned int NumberOfThreads = 0;
+
+  int NumberOfInterpolatedTransforms = 0;
+
+  // Resampled transforms, with the interpolator of ToAlign they come from
+  vtkSmartPointer<vtkDoubleArray> ResampledTimes;
+  vtkSmartPointer<vtkDoubleArray> ResampledOrientations;
+  vtkSmartPointer<vtkDoubleArray> ResampledPositions;
+  vtkSmartPointer<vtkCustomTransformInterpolator> Interpolator;
+  vtkMTimeType InterpolatorMTime = 0;
+  //! Time of the properties, the number of transforms and the time range of ToAlign
+  //! when the transforms were resampled
+  vtkMTimeType ResampledFilterMTime = 0;
+  vtkIdType ResampledNumberOfTransforms = 0;
+  double ResampledTimeRange[2] = { 0.0, 0.0 };
 };
 
 #endif // vtkTemporalTransformsRemapper_H
@@ -1,8 +1,137 @@
 #include "vtkTrailingFrame.h"
 
-#include <vtkStreamingDemandDrivenPipeline.h>
-#include <vtkInformationVector.h>
+#include <vtkCellArray.h>
+#include <vtkIdTypeArray.h>
 #include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <algorithm>
+
+namespace {
+//----------------------------------------------------------------------------
+/**
+ * @brief MergedDataType returns the type of an array merging values of the two
+ * types, or -1 if they can not be merged. The frames of a single or double
+ * precision interpreter can be merged, in double precision.
+ */
+int MergedDataType(int type, int other)
+{
+  if (type == other)
+  {
+    return type;
+  }
+  const bool real = (type == VTK_FLOAT || type == VTK_DOUBLE);
+  const bool otherReal = (other == VTK_FLOAT || other == VTK_DOUBLE);
+  return (real && otherReal) ? VTK_DOUBLE : -1;
+}
+
+//----------------------------------------------------------------------------
+/**
+ * @brief MergePointClouds concatenates the points of the frames in a single polydata
+ * with a vertex per point. Only the point data arrays present in all the frames with
+ * the same type, or a single and double precision type, and the same number of
+ * components are kept. The arrays are allocated once with their final size and the
+ * frames are copied into them by range.
+ */
+void MergePointClouds(const std::vector<vtkPolyData*>& frames, vtkPolyData* output)
+{
+  output->Initialize();
+  vtkPolyData* first = nullptr;
+  vtkIdType nbPoints = 0;
+  int pointsType = -1;
+  for (vtkPolyData* frame : frames)
+  {
+    if (frame && frame->GetPoints())
+    {
+      first = first ? first : frame;
+      nbPoints += frame->GetNumberOfPoints();
+      const int frameType = frame->GetPoints()->GetDataType();
+      pointsType = (frame == first) ? frameType : MergedDataType(pointsType, frameType);
+      // points of types which can not be merged are converted to double
+      pointsType = pointsType == -1 ? VTK_DOUBLE : pointsType;
+    }
+  }
+  if (!first)
+  {
+    return;
+  }
+
+  vtkNew<vtkPoints> points;
+  points->SetDataType(pointsType);
+  points->SetNumberOfPoints(nbPoints);
+  output->SetPoints(points.GetPointer());
+
+  // allocate the arrays shared by all the frames
+  std::vector<vtkAbstractArray*> arrays;
+  vtkPointData* firstPointData = first->GetPointData();
+  for (int i = 0; i < firstPointData->GetNumberOfArrays(); ++i)
+  {
+    vtkAbstractArray* source = firstPointData->GetAbstractArray(i);
+    if (!source->GetName())
+    {
+      continue;
+    }
+    bool shared = true;
+    int dataType = source->GetDataType();
+    for (vtkPolyData* frame : frames)
+    {
+      if (frame && frame->GetPoints())
+      {
+        vtkAbstractArray* other = frame->GetPointData()->GetAbstractArray(source->GetName());
+        dataType = other ? MergedDataType(dataType, other->GetDataType()) : -1;
+        shared = shared && dataType != -1 &&
+                 other->GetNumberOfComponents() == source->GetNumberOfComponents();
+      }
+    }
+    if (!shared)
+    {
+      continue;
+    }
+    auto array = vtkSmartPointer<vtkAbstractArray>::Take(dataType == source->GetDataType() ?
+      source->NewInstance() : vtkAbstractArray::CreateArray(dataType));
+    array->SetName(source->GetName());
+    array->SetNumberOfComponents(source->GetNumberOfComponents());
+    array->SetNumberOfTuples(nbPoints);
+    output->GetPointData()->AddArray(array);
+    arrays.push_back(array);
+  }
+
+  // copy the frames one after the other
+  vtkIdType offset = 0;
+  for (vtkPolyData* frame : frames)
+  {
+    if (!frame || !frame->GetPoints())
+    {
+      continue;
+    }
+    vtkIdType n = frame->GetNumberOfPoints();
+    points->GetData()->InsertTuples(offset, n, 0, frame->GetPoints()->GetData());
+    for (vtkAbstractArray* array : arrays)
+    {
+      array->InsertTuples(offset, n, 0, frame->GetPointData()->GetAbstractArray(array->GetName()));
+    }
+    offset += n;
+  }
+
+  // a vertex per point
+  vtkNew<vtkIdTypeArray> connectivity;
+  connectivity->SetNumberOfValues(2 * nbPoints);
+  vtkIdType* cell = connectivity->GetPointer(0);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    cell[2 * i] = 1;
+    cell[2 * i + 1] = i;
+  }
+  vtkNew<vtkCellArray> verts;
+  verts->SetCells(nbPoints, connectivity.GetPointer());
+  output->SetVerts(verts.GetPointer());
+}
+}
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkTrailingFrame)
@@ -13,24 +142,94 @@ void vtkTrailingFrame::SetNumberOfTrailingFrames(const unsigned int value)
   if (this->NumberOfTrailingFrames != value)
   {
     this->NumberOfTrailingFrames = value;
-    this->CacheTimeRange[0] = -1;
-    this->CacheTimeRange[1] = -1;
+    this->ResizeCache();
     this->Modified();
   }
 }
 
+//----------------------------------------------------------------------------
+void vtkTrailingFrame::ResizeCache()
+{
+  unsigned int nbSlots = this->NumberOfTrailingFrames + 1;
+  if (this->CachedTimeIndices.size() == nbSlots)
+  {
+    return;
+  }
+
+  // move the frames to their slot in the new ring buffer,
+  // keeping the most recent one when two of them collide
+  vtkNew<vtkMultiBlockDataSet> oldCache;
+  oldCache->ShallowCopy(this->Cache.GetPointer());
+  std::vector<int> oldTimeIndices = this->CachedTimeIndices;
+  this->Cache->Initialize();
+  this->Cache->SetNumberOfBlocks(nbSlots);
+  this->CachedTimeIndices.assign(nbSlots, -1);
+  for (unsigned int oldSlot = 0; oldSlot < oldTimeIndices.size(); ++oldSlot)
+  {
+    int timeIndex = oldTimeIndices[oldSlot];
+    if (timeIndex >= 0 && timeIndex > this->CachedTimeIndices[this->GetSlot(timeIndex)])
+    {
+      this->Cache->SetBlock(this->GetSlot(timeIndex), oldCache->GetBlock(oldSlot));
+      this->CachedTimeIndices[this->GetSlot(timeIndex)] = timeIndex;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkTrailingFrame::GetSlot(int timeIndex) const
+{
+  return static_cast<unsigned int>(timeIndex) % (this->NumberOfTrailingFrames + 1);
+}
+
+//----------------------------------------------------------------------------
+int vtkTrailingFrame::ProcessRequest(vtkInformation* request,
+                                     vtkInformationVector** inputVector,
+                                     vtkInformationVector* outputVector)
+{
+  // vtkPolyDataAlgorithm always lets the executive create a vtkPolyData
+  if (request->Has(vtkDemandDrivenPipeline::REQUEST_DATA_OBJECT()))
+  {
+    return this->RequestDataObject(request, inputVector, outputVector);
+  }
+  return this->Superclass::ProcessRequest(request, inputVector, outputVector);
+}
+
 //----------------------------------------------------------------------------
 int vtkTrailingFrame::FillOutputPortInformation(int port, vtkInformation *info)
 {
   if (port == 0)
   {
-    info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkMultiBlockDataSet");
+    // a vtkMultiBlockDataSet, or a vtkPolyData when merging the frames
+    info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkDataObject");
     return 1;
   }
 
   return 0;
 }
 
+//----------------------------------------------------------------------------
+int vtkTrailingFrame::RequestDataObject(vtkInformation* vtkNotUsed(request),
+                                        vtkInformationVector** vtkNotUsed(inputVector),
+                                        vtkInformationVector* outputVector)
+{
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  vtkDataObject* output = vtkDataObject::GetData(outInfo);
+  if (!output || (vtkPolyData::SafeDownCast(output) != nullptr) != this->MergeFrames)
+  {
+    vtkSmartPointer<vtkDataObject> newOutput;
+    if (this->MergeFrames)
+    {
+      newOutput = vtkSmartPointer<vtkPolyData>::New();
+    }
+    else
+    {
+      newOutput = vtkSmartPointer<vtkMultiBlockDataSet>::New();
+    }
+    outInfo->Set(vtkDataObject::DATA_OBJECT(), newOutput);
+  }
+  return 1;
+}
+
 //----------------------------------------------------------------------------
 int vtkTrailingFrame::RequestUpdateExtent(vtkInformation* vtkNotUsed(request),
                                       vtkInformationVector** inputVector,
@@ -44,12 +243,12 @@ int vtkTrailingFrame::RequestUpdateExtent(vtkInformation* vtkNotUsed(request),
     int nb_time_steps = inInfo->Length(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
     this->TimeSteps.assign(time_steps, time_steps + nb_time_steps);
   }
+  this->ResizeCache();
 
   // If the TimeSteps size is still zero, it means
   // that we are in the presence of a live source
   if (this->TimeSteps.size() == 0)
   {
-    this->LastTimeProcessedIndex = (LastTimeProcessedIndex+1) % (this->NumberOfTrailingFrames+1);
     return 1;
   }
 
@@ -59,9 +258,9 @@ int vtkTrailingFrame::RequestUpdateExtent(vtkInformation* vtkNotUsed(request),
     // Delete the cache so it cannot be used
     if (!this->UseCache)
     {
-      this->CacheTimeRange[0] = -1;
-      this->CacheTimeRange[1] = -1;
       this->Cache->Initialize();
+      this->Cache->SetNumberOfBlocks(this->NumberOfTrailingFrames + 1);
+      std::fill(this->CachedTimeIndices.begin(), this->CachedTimeIndices.end(), -1);
     }
     // Save current pipeline time step
     this->PipelineTime = inInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP());
@@ -72,58 +271,36 @@ int vtkTrailingFrame::RequestUpdateExtent(vtkInformation* vtkNotUsed(request),
                                         std::lower_bound(this->TimeSteps.begin(),
                                                          this->TimeSteps.end(),
                                                          this->PipelineTime));
+    this->PipelineIndex = std::min(this->PipelineIndex, static_cast<int>(this->TimeSteps.size()) - 1);
     // check if the previous index is closer
     if (this->PipelineIndex > 0)
     {
       if (this->TimeSteps[this->PipelineIndex] - this->PipelineTime > this->PipelineTime - this->TimeSteps[this->PipelineIndex - 1])
         this->PipelineIndex -= 1;
     }
-    // save old TimeRange and update new one
-    int previousCacheTimeRange[2] = {this->CacheTimeRange[0], this->CacheTimeRange[1]};
-    this->CacheTimeRange[0] = std::max(this->PipelineIndex - static_cast<int>(this->NumberOfTrailingFrames), 0);
-    this->CacheTimeRange[1] = this->PipelineIndex + 1;
 
-    // handle case when changing NumberOfTrailingFrame
-    if (previousCacheTimeRange[1] == -1)
+    // only request the frames that are not in the cache yet
+    this->MissingTimeIndices.clear();
+    int firstIndex = std::max(this->PipelineIndex - static_cast<int>(this->NumberOfTrailingFrames), 0);
+    for (int timeIndex = this->PipelineIndex; timeIndex >= firstIndex; --timeIndex)
     {
-      // move the old  timestep to the right location
-      vtkNew<vtkMultiBlockDataSet> oldCache;
-      oldCache->ShallowCopy(this->Cache.GetPointer());
-      int previousNumberOfTrailingFrame = oldCache->GetNumberOfBlocks() - 1;
-      this->Cache->Initialize();
-      for (this->LastTimeProcessedIndex = this->CacheTimeRange[1] - 1;
-           this->LastTimeProcessedIndex > this->CacheTimeRange[1] - 1 - previousNumberOfTrailingFrame &&
-           this->LastTimeProcessedIndex > this->CacheTimeRange[0];
-           this->LastTimeProcessedIndex--)
+      if (this->CachedTimeIndices[this->GetSlot(timeIndex)] != timeIndex)
       {
-        unsigned int previousIndex = this->LastTimeProcessedIndex % (previousNumberOfTrailingFrame + 1);
-        unsigned int newIndex = this->LastTimeProcessedIndex % (this->NumberOfTrailingFrames + 1);
-        this->Cache->SetBlock(newIndex, oldCache->GetBlock(previousIndex));
+        this->MissingTimeIndices.push_back(timeIndex);
       }
-      this->Direction = -1;
-    }
-    // handle case when jumping backward
-    else if (this->CacheTimeRange[1] < previousCacheTimeRange[1])
-    {
-      this->Direction = -1;
-      this->LastTimeProcessedIndex = std::max(0, std::min(this->CacheTimeRange[1], previousCacheTimeRange[0]) - 1);
     }
-    // handle case when jumping forward
-    else if (this->CacheTimeRange[1] > previousCacheTimeRange[1])
+    // the input is already at the pipeline time,
+    // so refreshing the current frame is free
+    if (this->MissingTimeIndices.empty())
     {
-      this->Direction = 1;
-      this->LastTimeProcessedIndex = std::max(this->CacheTimeRange[0], previousCacheTimeRange[1]);
+      this->MissingTimeIndices.push_back(this->PipelineIndex);
     }
+    this->NextMissingTimeIndex = 0;
     this->FirstFilterIteration = false;
   }
-  // not first loop
-  else
-  {
-    this->LastTimeProcessedIndex += this->Direction;
-  }
 
   inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP(),
-              this->TimeSteps[this->LastTimeProcessedIndex]);
+              this->TimeSteps[this->MissingTimeIndices[this->NextMissingTimeIndex]]);
 
   return 1;
 }
@@ -135,66 +312,82 @@ int vtkTrailingFrame::RequestData(vtkInformation* request,
 {
   vtkPolyData* input = vtkPolyData::GetData(inputVector[0],0);
   vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
-  vtkMultiBlockDataSet* output = vtkMultiBlockDataSet::GetData(outputVector);
+  vtkDataObject* output = vtkDataObject::GetData(outputVector);
+
+  // copy the input in the cache
+  vtkNew<vtkPolyData> currentFrame;
+  currentFrame->ShallowCopy(input);
 
   // If the TimeSteps size is still zero, it means
-  // that we are in the presence of a live source
+  // that we are in the presence of a live source,
+  // each execution bringing a new frame
+  int timeIndex = this->LiveFrameCount;
   if (!this->TimeSteps.empty())
   {
+    timeIndex = this->MissingTimeIndices[this->NextMissingTimeIndex];
+  }
+  else
+  {
+    this->LiveFrameCount++;
+  }
+  unsigned int slot = this->GetSlot(timeIndex);
+  this->Cache->SetBlock(slot, currentFrame.GetPointer());
+  this->CachedTimeIndices[slot] = timeIndex;
 
-    if ((this->LastTimeProcessedIndex == this->CacheTimeRange[0] && this->Direction == -1)
-        || (this->LastTimeProcessedIndex == this->CacheTimeRange[1]-1 && this->Direction == 1))
-    {
-      // Stop the pipeline loop
-      request->Remove(vtkStreamingDemandDrivenPipeline::CONTINUE_EXECUTING());
-
-      // reset block that should be empty
-      for (unsigned int i = this->PipelineIndex + 1; i < this->NumberOfTrailingFrames + 1; i++)
-      {
-        int index = i % (this->NumberOfTrailingFrames + 1);
-        this->Cache->SetBlock(index, nullptr);
-      }
-
-      // reset some variable and pipeline time
-      this->FirstFilterIteration = true;
-      inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP(),
-                  this->PipelineTime);
-    }
-    else
+  if (!this->TimeSteps.empty())
+  {
+    if (++this->NextMissingTimeIndex < this->MissingTimeIndices.size())
     {
-      // force the pipeline loop
+      // force the pipeline loop, the output is produced
+      // once all the missing frames have been received
       request->Set(vtkStreamingDemandDrivenPipeline::CONTINUE_EXECUTING(), 1);
+      return 1;
     }
-  }
 
-  // copy the input in the multiblock
-  vtkNew<vtkPolyData> currentFrame;
-  currentFrame->ShallowCopy(input);
-  if(this->NumberOfTrailingFrames)
-  {
-    unsigned int index = static_cast<unsigned int>(this->LastTimeProcessedIndex) % (this->NumberOfTrailingFrames + 1);
-    this->Cache->SetBlock(index, currentFrame.GetPointer());
-  }
-  // handle case when no trailing frame
-  else
-  {
-    this->Cache->SetBlock(0, currentFrame.GetPointer());
+    // Stop the pipeline loop
+    request->Remove(vtkStreamingDemandDrivenPipeline::CONTINUE_EXECUTING());
+
+    // reset some variable and pipeline time
+    this->FirstFilterIteration = true;
+    inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP(),
+                this->PipelineTime);
+    timeIndex = this->PipelineIndex;
   }
-  output->ShallowCopy(this->Cache.GetPointer());
 
-  // re-order output blocks so that:
+  this->FillOutput(timeIndex, output);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkTrailingFrame::FillOutput(int currentIndex, vtkDataObject* output)
+{
+  // order the frames so that:
   //    current frame => 0
   //    current frame - 1 => 1
   //    current frame - 2 => 2
   // ...
-  int n = this->NumberOfTrailingFrames + 1;
-  if (n > 0)
+  // the frames before the first time step being empty
+  std::vector<vtkPolyData*> frames(this->NumberOfTrailingFrames + 1, nullptr);
+  for (unsigned int i = 0; i < frames.size(); ++i)
   {
-    int current_frame_index = this->PipelineIndex % n;
-    for (int i = 1; i <= n; ++i)
+    int timeIndex = currentIndex - static_cast<int>(i);
+    if (timeIndex >= 0 && this->CachedTimeIndices[this->GetSlot(timeIndex)] == timeIndex)
     {
-      output->SetBlock(n - i, this->Cache->GetBlock((current_frame_index + i) % n));
+      frames[i] = vtkPolyData::SafeDownCast(this->Cache->GetBlock(this->GetSlot(timeIndex)));
     }
   }
-  return 1;
+
+  if (vtkPolyData* merged = vtkPolyData::SafeDownCast(output))
+  {
+    MergePointClouds(frames, merged);
+    return;
+  }
+
+  vtkMultiBlockDataSet* multiblock = vtkMultiBlockDataSet::SafeDownCast(output);
+  multiblock->Initialize();
+  multiblock->SetNumberOfBlocks(frames.size());
+  for (unsigned int i = 0; i < frames.size(); ++i)
+  {
+    multiblock->SetBlock(i, frames[i]);
+  }
 }
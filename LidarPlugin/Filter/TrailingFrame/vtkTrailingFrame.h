@@ -1,7 +1,7 @@
 #ifndef VTKTRAILINGFRAME_H
 #define VTKTRAILINGFRAME_H
 
-#include <queue>
+#include <vector>
 
 #include "vtkPolyDataAlgorithm.h"
 #include <vtkNew.h>
@@ -11,6 +11,11 @@
  * @brief The vtkTrailingFrame class is a filter that combine consecutive timestep
  * of its input to produce a multiblock.
  * The input of this filter must produce only consecutive interger timestep.
+ *
+ * The frames are kept in a ring buffer indexed by their time step, so that when
+ * the pipeline time moves only the frames missing from the buffer are requested
+ * to the input. The output is either a multiblock with the current frame in the
+ * first block, or a single polydata merging all the frames.
  */
 class VTK_EXPORT vtkTrailingFrame : public vtkPolyDataAlgorithm
 {
@@ -30,10 +35,24 @@ public:
   vtkSetMacro(UseCache, bool)
   //! @}
 
+  //! @{
+  //! @copydoc MergeFrames
+  vtkGetMacro(MergeFrames, bool)
+  vtkSetMacro(MergeFrames, bool)
+  //! @}
+
+  int ProcessRequest(vtkInformation* request,
+                     vtkInformationVector** inputVector,
+                     vtkInformationVector* outputVector) override;
+
 protected:
   vtkTrailingFrame() = default;
 
   int FillOutputPortInformation(int port, vtkInformation* info) override;
+  //! Create the output, whose type depends on MergeFrames
+  int RequestDataObject(vtkInformation*,
+                        vtkInformationVector**,
+                        vtkInformationVector*);
   int RequestUpdateExtent(vtkInformation*,
                           vtkInformationVector**,
                           vtkInformationVector*) override;
@@ -42,25 +61,38 @@ protected:
                   vtkInformationVector* outputVector) override;
 
 private:
+  //! Resize the ring buffer to NumberOfTrailingFrames + 1 slots, keeping the frames it holds
+  void ResizeCache();
+
+  //! Slot of the ring buffer of a time step index
+  unsigned int GetSlot(int timeIndex) const;
+
+  //! Fill the output with the frames from currentIndex - NumberOfTrailingFrames to currentIndex
+  void FillOutput(int currentIndex, vtkDataObject* output);
+
   //! Number of previous timestep to display
   unsigned int NumberOfTrailingFrames = 0;
   //! Should the internal cache be used for speed
   bool UseCache = true;
+  //! Should the frames be merged in a single polydata instead of a multiblock
+  bool MergeFrames = false;
 
   //! Original pipeline time which must be restored after modifying the input filter time
   double PipelineTime = 0;
   //! Index of time step corresponding to PipelineTime
   int PipelineIndex = 0;
-  //! Time index range that should be in the cache, it's e right half-open interval : [Tstart, Tend[
-  int CacheTimeRange[2] = {-1, -1};
-  //! Last Time index required from the filter to its input filter
-  int LastTimeProcessedIndex = -1;
-  //! Indicate if the next time to process is after or before the last processed
-  int Direction = 1;
-  //! Cache to save ouput previously produced by the filter
+  //! Time indices that must be requested to the input before producing the output
+  std::vector<int> MissingTimeIndices;
+  //! Position in MissingTimeIndices of the time index currently requested from the input
+  unsigned int NextMissingTimeIndex = 0;
+  //! Ring buffer of the frames previously received from the input
   vtkNew<vtkMultiBlockDataSet> Cache;
+  //! Time index of the frame held in each slot of the cache, -1 if the slot is empty
+  std::vector<int> CachedTimeIndices;
   //! List of available time steps from the source
   std::vector<double> TimeSteps;
+  //! Number of frames received from a live source
+  int LiveFrameCount = 0;
 
   //! Help variable
   bool FirstFilterIteration = true;
@@ -0,0 +1,271 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "vtkVoxelAccumulator.h"
+
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkTransform.h>
+#include <vtkUnsignedIntArray.h>
+
+#include "vtkTemporalTransforms.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Each integer coordinate of a voxel is stored on 21 bits, which
+// covers more than 100 km in each direction with 10 cm voxels
+const int64_t CoordinateBits = 21;
+const int64_t CoordinateOffset = int64_t(1) << (CoordinateBits - 1);
+
+//-----------------------------------------------------------------------------
+bool PackVoxelCoordinates(const double point[3], double invVoxelSize, int64_t& key)
+{
+  key = 0;
+  for (int k = 0; k < 3; ++k)
+  {
+    double coordinate = std::floor(point[k] * invVoxelSize);
+    if (!(std::abs(coordinate) < CoordinateOffset))
+    {
+      return false;
+    }
+    key = (key << CoordinateBits) | (static_cast<int64_t>(coordinate) + CoordinateOffset);
+  }
+  return true;
+}
+}
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkVoxelAccumulator)
+
+//-----------------------------------------------------------------------------
+vtkVoxelAccumulator::vtkVoxelAccumulator()
+{
+  this->SetNumberOfInputPorts(2);
+  this->SetNumberOfOutputPorts(1);
+  this->Interpolator = vtkSmartPointer<vtkCustomTransformInterpolator>::New();
+  this->Interpolator->SetInterpolationTypeToLinear();
+}
+
+//----------------------------------------------------------------------------
+vtkMTimeType vtkVoxelAccumulator::GetMTime()
+{
+  return std::max(this->Superclass::GetMTime(), this->Interpolator->GetMTime());
+}
+
+//-----------------------------------------------------------------------------
+void vtkVoxelAccumulator::SetVoxelSize(double value)
+{
+  if (this->VoxelSize != value && value > 0.0)
+  {
+    this->VoxelSize = value;
+    this->ResetAccumulation();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkVoxelAccumulator::ResetAccumulation()
+{
+  this->Voxels.clear();
+  this->NumberOfFramesAdded = 0;
+  this->LastFrameMTime = 0;
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+int vtkVoxelAccumulator::FillInputPortInformation(int port, vtkInformation* info)
+{
+  if (port == 0)
+  {
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+    return 1;
+  }
+  if (port == 1)
+  {
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+    info->Set(vtkAlgorithm::INPUT_IS_OPTIONAL(), 1);
+    return 1;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int vtkVoxelAccumulator::RequestData(vtkInformation* vtkNotUsed(request),
+                                     vtkInformationVector** inputVector,
+                                     vtkInformationVector* outputVector)
+{
+  // Get the inputs
+  vtkPolyData* pointcloud = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
+  vtkPolyData* trajectoryPoly = vtkPolyData::GetData(inputVector[1], 0);
+  vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
+  vtkDataArray* values = this->GetInputArrayToProcess(0, inputVector);
+
+  // going back in time restarts the accumulation
+  double frameTime = 0.0;
+  if (inInfo->Has(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP()))
+  {
+    frameTime = inInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP());
+    if (this->NumberOfFramesAdded > 0 && frameTime < this->LastFrameTime)
+    {
+      this->Voxels.clear();
+      this->NumberOfFramesAdded = 0;
+      this->LastFrameMTime = 0;
+    }
+  }
+
+  // only add the frames that have not been added yet
+  if (pointcloud->GetMTime() != this->LastFrameMTime)
+  {
+    vtkSmartPointer<vtkTransform> pose;
+    if (trajectoryPoly && trajectoryPoly->GetNumberOfPoints() > 0)
+    {
+      // Fill the interpolator
+      if (this->Interpolator->GetNumberOfTransforms() == 0)
+      {
+        auto trajectory = vtkTemporalTransforms::CreateFromPolyData(trajectoryPoly);
+        auto type = this->Interpolator->GetInterpolationType();
+        this->Interpolator = trajectory->CreateInterpolator();
+        this->Interpolator->SetInterpolationType(type);
+      }
+      pose = vtkSmartPointer<vtkTransform>::New();
+      this->Interpolator->InterpolateTransform(frameTime, pose);
+      pose->Update();
+    }
+
+    this->AddFrame(pointcloud, values, pose);
+    this->RemoveOldVoxels();
+    this->LastFrameMTime = pointcloud->GetMTime();
+    this->LastFrameTime = frameTime;
+  }
+
+  this->FillOutput(vtkPolyData::GetData(outputVector), values ? values->GetName() : nullptr);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkVoxelAccumulator::AddFrame(vtkPolyData* frame, vtkDataArray* values, vtkTransform* pose)
+{
+  const double invVoxelSize = 1.0 / this->VoxelSize;
+  double point[3], worldPoint[3];
+  int64_t key;
+  for (vtkIdType i = 0; i < frame->GetNumberOfPoints(); ++i)
+  {
+    frame->GetPoint(i, point);
+    if (pose)
+    {
+      pose->InternalTransformPoint(point, worldPoint);
+    }
+    else
+    {
+      std::copy(point, point + 3, worldPoint);
+    }
+    if (!PackVoxelCoordinates(worldPoint, invVoxelSize, key))
+    {
+      continue;
+    }
+
+    Voxel& voxel = this->Voxels[key];
+    for (int k = 0; k < 3; ++k)
+    {
+      voxel.Sum[k] += worldPoint[k];
+    }
+    voxel.ValueSum += values ? values->GetComponent(i, 0) : 0.0;
+    voxel.Count++;
+    voxel.LastFrame = this->NumberOfFramesAdded;
+  }
+  this->NumberOfFramesAdded++;
+}
+
+//-----------------------------------------------------------------------------
+void vtkVoxelAccumulator::RemoveOldVoxels()
+{
+  if (this->MaxFrameAge == 0)
+  {
+    return;
+  }
+  const int currentFrame = this->NumberOfFramesAdded - 1;
+  for (auto it = this->Voxels.begin(); it != this->Voxels.end();)
+  {
+    if (currentFrame - it->second.LastFrame >= static_cast<int>(this->MaxFrameAge))
+    {
+      it = this->Voxels.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkVoxelAccumulator::FillOutput(vtkPolyData* output, const char* valuesName) const
+{
+  output->Initialize();
+  const vtkIdType nbPoints = static_cast<vtkIdType>(this->Voxels.size());
+
+  // allocate all the arrays to their final size
+  vtkNew<vtkPoints> points;
+  points->SetDataTypeToFloat();
+  points->SetNumberOfPoints(nbPoints);
+  float* coordinates = static_cast<float*>(points->GetVoidPointer(0));
+  vtkNew<vtkFloatArray> valuesArray;
+  valuesArray->SetName(valuesName ? valuesName : "values");
+  valuesArray->SetNumberOfTuples(nbPoints);
+  vtkNew<vtkUnsignedIntArray> countArray;
+  countArray->SetName("points_count");
+  countArray->SetNumberOfTuples(nbPoints);
+  vtkNew<vtkUnsignedIntArray> ageArray;
+  ageArray->SetName("age");
+  ageArray->SetNumberOfTuples(nbPoints);
+  vtkNew<vtkIdTypeArray> connectivity;
+  connectivity->SetNumberOfValues(2 * nbPoints);
+  vtkIdType* cell = connectivity->GetPointer(0);
+
+  vtkIdType i = 0;
+  for (const auto& it : this->Voxels)
+  {
+    const Voxel& voxel = it.second;
+    for (int k = 0; k < 3; ++k)
+    {
+      coordinates[3 * i + k] = static_cast<float>(voxel.Sum[k] / voxel.Count);
+    }
+    valuesArray->SetValue(i, static_cast<float>(voxel.ValueSum / voxel.Count));
+    countArray->SetValue(i, voxel.Count);
+    ageArray->SetValue(i, this->NumberOfFramesAdded - 1 - voxel.LastFrame);
+    cell[2 * i] = 1;
+    cell[2 * i + 1] = i;
+    ++i;
+  }
+
+  vtkNew<vtkCellArray> verts;
+  verts->SetCells(nbPoints, connectivity.GetPointer());
+  output->SetPoints(points.GetPointer());
+  output->SetVerts(verts.GetPointer());
+  if (valuesName)
+  {
+    output->GetPointData()->AddArray(valuesArray.GetPointer());
+  }
+  output->GetPointData()->AddArray(countArray.GetPointer());
+  output->GetPointData()->AddArray(ageArray.GetPointer());
+}
@@ -0,0 +1,144 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VTK_VOXEL_ACCUMULATOR_H
+#define VTK_VOXEL_ACCUMULATOR_H
+
+#include <cstdint>
+#include <unordered_map>
+
+#include <vtkPolyDataAlgorithm.h>
+#include <vtkSmartPointer.h>
+
+#include "vtkCustomTransformInterpolator.h"
+
+class vtkTransform;
+
+/**
+ * @brief The vtkVoxelAccumulator accumulates the successive frames of its input in
+ * world coordinates into a sparse voxel grid, which holds a single point per voxel:
+ * the centroid of the points that fell in it. It takes 2 inputs: the point cloud
+ * and an optional vtkTemporalTransforms giving the pose of the sensor at the time
+ * of each frame. Without trajectory the frames are expected in world coordinates.
+ *
+ * The grid is updated incrementally: each new frame only adds its points to their
+ * voxels, and the voxels that have not received any point during the last
+ * MaxFrameAge frames are removed. The memory and the size of the output are then
+ * bounded by the area covered by these frames, whatever the length of the trail.
+ *
+ * Each output point carries the mean of the array to process among the points of
+ * its voxel, the number of these points and the number of frames since the voxel
+ * received a point.
+ */
+class VTK_EXPORT vtkVoxelAccumulator : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkVoxelAccumulator* New();
+  vtkTypeMacro(vtkVoxelAccumulator, vtkPolyDataAlgorithm)
+
+  //@{
+  /**
+   * @copydoc vtkVoxelAccumulator::VoxelSize
+   */
+  vtkGetMacro(VoxelSize, double)
+  void SetVoxelSize(double value);
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkVoxelAccumulator::MaxFrameAge
+   */
+  vtkGetMacro(MaxFrameAge, unsigned int)
+  vtkSetMacro(MaxFrameAge, unsigned int)
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkVoxelAccumulator::InterpolationType
+   */
+  int GetInterpolationType() { return this->Interpolator->GetInterpolationType(); }
+  void SetInterpolationType(int value) { this->Interpolator->SetInterpolationType(value); }
+  //@}
+
+  /**
+   * @brief Remove all the accumulated voxels
+   */
+  void ResetAccumulation();
+
+  //! Number of voxels holding points
+  size_t GetNumberOfVoxels() const { return this->Voxels.size(); }
+
+  /**
+   * @brief Override GetMTime() because we depend on the TransformInterpolator
+   * which may be modified outside of this class.
+   */
+  vtkMTimeType GetMTime() override;
+
+protected:
+  vtkVoxelAccumulator();
+
+  int FillInputPortInformation(int port, vtkInformation* info) override;
+  int RequestData(vtkInformation* request,
+                  vtkInformationVector** inputVector,
+                  vtkInformationVector* outputVector) override;
+
+private:
+  struct Voxel
+  {
+    //! Sums of the coordinates and of the values of the points of the voxel
+    double Sum[3] = {0.0, 0.0, 0.0};
+    double ValueSum = 0.0;
+    //! Number of points in the voxel
+    unsigned int Count = 0;
+    //! Index of the last frame that added a point to the voxel
+    int LastFrame = 0;
+  };
+
+  //! Add a frame, whose points are transformed by the sensor pose at time
+  void AddFrame(vtkPolyData* frame, vtkDataArray* values, vtkTransform* pose);
+
+  //! Remove the voxels older than MaxFrameAge
+  void RemoveOldVoxels();
+
+  //! Fill the output with a point per voxel
+  void FillOutput(vtkPolyData* output, const char* valuesName) const;
+
+  //! Size of the edges of the voxels, in meters
+  double VoxelSize = 0.1;
+
+  //! Number of frames after which a voxel that did not receive
+  //! any point is removed, 0 to never remove any voxel
+  unsigned int MaxFrameAge = 50;
+
+  //! The voxels, indexed by their packed integer coordinates
+  std::unordered_map<int64_t, Voxel> Voxels;
+
+  //! Number of frames added
+  int NumberOfFramesAdded = 0;
+
+  //! Modification time of the last frame added, to avoid adding the same frame
+  //! twice when the filter re-executes without a new frame
+  vtkMTimeType LastFrameMTime = 0;
+
+  //! Pipeline time of the last frame added, going back in time resets the accumulation
+  double LastFrameTime = 0.0;
+
+  //! Interpolator used to get the pose of the sensor
+  vtkSmartPointer<vtkCustomTransformInterpolator> Interpolator;
+
+  vtkVoxelAccumulator(const vtkVoxelAccumulator&) /*= delete*/;
+  void operator =(const vtkVoxelAccumulator&) /*= delete*/;
+};
+
+#endif // VTK_VOXEL_ACCUMULATOR_H
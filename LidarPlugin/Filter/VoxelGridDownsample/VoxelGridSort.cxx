@@ -0,0 +1,196 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "VoxelGridSort.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace
+{
+// Number of bits of the key sorted by each pass of the radix sort
+const int RadixBits = 11;
+const size_t NumberOfBuckets = size_t(1) << RadixBits;
+// Below this number of points per thread, fewer threads are used
+const size_t MinimumPointsPerThread = 65536;
+
+//-----------------------------------------------------------------------------
+// Number of bits needed to store the values of [0, n[
+int BitsFor(uint64_t n)
+{
+  int bits = 0;
+  while ((uint64_t(1) << bits) < n)
+  {
+    ++bits;
+  }
+  return bits;
+}
+}
+
+//-----------------------------------------------------------------------------
+template <typename T>
+bool VoxelGridSort::Sort(const T* coordinates, size_t nbPoints, double voxelSize,
+                         unsigned int nbThreads)
+{
+  this->Keys.clear();
+  this->Order.clear();
+  this->VoxelBegin.clear();
+  nbThreads = static_cast<unsigned int>(std::max<size_t>(1,
+    std::min<size_t>(Parallel::GetNumberOfThreads(nbThreads), nbPoints / MinimumPointsPerThread)));
+
+  // bounds and number of finite points of each part
+  std::vector<std::array<double, 6> > partBounds(nbThreads);
+  std::vector<size_t> partCounts(nbThreads + 1, 0);
+  Parallel::ForEachPart(nbPoints, nbThreads, [&](unsigned int thread, size_t begin, size_t end)
+  {
+    std::array<double, 6>& bounds = partBounds[thread];
+    for (int k = 0; k < 3; ++k)
+    {
+      bounds[2 * k] = std::numeric_limits<double>::infinity();
+      bounds[2 * k + 1] = -std::numeric_limits<double>::infinity();
+    }
+    size_t count = 0;
+    for (size_t i = begin; i < end; ++i)
+    {
+      const T* p = coordinates + 3 * i;
+      if (std::isfinite(p[0]) && std::isfinite(p[1]) && std::isfinite(p[2]))
+      {
+        for (int k = 0; k < 3; ++k)
+        {
+          bounds[2 * k] = std::min(bounds[2 * k], static_cast<double>(p[k]));
+          bounds[2 * k + 1] = std::max(bounds[2 * k + 1], static_cast<double>(p[k]));
+        }
+        ++count;
+      }
+    }
+    partCounts[thread + 1] = count;
+  });
+  for (unsigned int thread = 0; thread < nbThreads; ++thread)
+  {
+    partCounts[thread + 1] += partCounts[thread];
+  }
+  const size_t nbSorted = partCounts[nbThreads];
+  if (nbSorted == 0)
+  {
+    return true;
+  }
+
+  // layout of the keys
+  double bounds[6];
+  int bits[3];
+  for (int k = 0; k < 3; ++k)
+  {
+    bounds[2 * k] = std::numeric_limits<double>::infinity();
+    bounds[2 * k + 1] = -std::numeric_limits<double>::infinity();
+    for (const auto& part : partBounds)
+    {
+      bounds[2 * k] = std::min(bounds[2 * k], part[2 * k]);
+      bounds[2 * k + 1] = std::max(bounds[2 * k + 1], part[2 * k + 1]);
+    }
+    const double extent = std::floor((bounds[2 * k + 1] - bounds[2 * k]) / voxelSize) + 1.0;
+    if (!(voxelSize > 0.0) || !(extent <= static_cast<double>(uint64_t(1) << MaxBitsPerAxis)))
+    {
+      return false;
+    }
+    bits[k] = BitsFor(static_cast<uint64_t>(extent));
+  }
+  const int shifts[3] = { 0, bits[0], bits[0] + bits[1] };
+  const int nbBits = bits[0] + bits[1] + bits[2];
+
+  // keys of the finite points, in the order of the points
+  this->Keys.resize(nbSorted);
+  this->Order.resize(nbSorted);
+  Parallel::ForEachPart(nbPoints, nbThreads, [&](unsigned int thread, size_t begin, size_t end)
+  {
+    size_t position = partCounts[thread];
+    for (size_t i = begin; i < end; ++i)
+    {
+      const T* p = coordinates + 3 * i;
+      if (std::isfinite(p[0]) && std::isfinite(p[1]) && std::isfinite(p[2]))
+      {
+        uint64_t key = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+          const uint64_t voxel = static_cast<uint64_t>((p[k] - bounds[2 * k]) / voxelSize);
+          key |= std::min(voxel, (uint64_t(1) << bits[k]) - 1) << shifts[k];
+        }
+        this->Keys[position] = key;
+        this->Order[position] = static_cast<uint32_t>(i);
+        ++position;
+      }
+    }
+  });
+
+  // stable radix sort, RadixBits at a time from the least significant ones
+  this->KeysBuffer.resize(nbSorted);
+  this->OrderBuffer.resize(nbSorted);
+  std::vector<std::vector<size_t> > histograms(nbThreads, std::vector<size_t>(NumberOfBuckets));
+  for (int shift = 0; shift < nbBits; shift += RadixBits)
+  {
+    Parallel::ForEachPart(nbSorted, nbThreads, [&](unsigned int thread, size_t begin, size_t end)
+    {
+      std::vector<size_t>& histogram = histograms[thread];
+      std::fill(histogram.begin(), histogram.end(), 0);
+      for (size_t i = begin; i < end; ++i)
+      {
+        histogram[(this->Keys[i] >> shift) & (NumberOfBuckets - 1)]++;
+      }
+    });
+    // each thread writes its points of a bucket after those of the previous threads
+    size_t offset = 0;
+    for (size_t bucket = 0; bucket < NumberOfBuckets; ++bucket)
+    {
+      for (unsigned int thread = 0; thread < nbThreads; ++thread)
+      {
+        const size_t count = histograms[thread][bucket];
+        histograms[thread][bucket] = offset;
+        offset += count;
+      }
+    }
+    Parallel::ForEachPart(nbSorted, nbThreads, [&](unsigned int thread, size_t begin, size_t end)
+    {
+      std::vector<size_t>& positions = histograms[thread];
+      for (size_t i = begin; i < end; ++i)
+      {
+        const size_t position = positions[(this->Keys[i] >> shift) & (NumberOfBuckets - 1)]++;
+        this->KeysBuffer[position] = this->Keys[i];
+        this->OrderBuffer[position] = this->Order[i];
+      }
+    });
+    this->Keys.swap(this->KeysBuffer);
+    this->Order.swap(this->OrderBuffer);
+  }
+
+  // the voxels start where the key changes
+  this->VoxelBegin.push_back(0);
+  for (size_t i = 1; i < nbSorted; ++i)
+  {
+    if (this->Keys[i] != this->Keys[i - 1])
+    {
+      this->VoxelBegin.push_back(static_cast<uint32_t>(i));
+    }
+  }
+  this->VoxelBegin.push_back(static_cast<uint32_t>(nbSorted));
+  return true;
+}
+
+template bool VoxelGridSort::Sort(const float*, size_t, double, unsigned int);
+template bool VoxelGridSort::Sort(const double*, size_t, double, unsigned int);
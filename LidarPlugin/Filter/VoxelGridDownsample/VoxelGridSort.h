@@ -0,0 +1,77 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VOXEL_GRID_SORT_H
+#define VOXEL_GRID_SORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * \class VoxelGridSort
+ * \brief Group the points of a point cloud by voxel of a regular grid, to downsample it.
+ *
+ * Each point gets the key of its voxel, the integer coordinates of the voxel in the
+ * bounding box of the points packed on as few bits as the extent of the box needs. The
+ * points are then sorted by key with a least significant digit radix sort, each pass
+ * counting and scattering contiguous parts of the points in parallel. The sort is
+ * stable: the points of a voxel stay in the order of the point cloud.
+ *
+ * The points with a NaN or infinite coordinate are left out. The buffers are kept from
+ * one sort to the next, so that sorting successive frames does not allocate.
+ */
+class VoxelGridSort
+{
+public:
+  /**
+   * @brief Sort the points by voxel
+   * @param coordinates x, y, z of each point, float or double
+   * @param nbPoints number of points
+   * @param voxelSize size of the edges of the voxels
+   * @param nbThreads number of threads sorting the points, 0 to use all the cores
+   * @return false if the voxels are too small for the extent of the points, more than
+   *         2^MaxBitsPerAxis voxels along an axis
+   */
+  template <typename T>
+  bool Sort(const T* coordinates, size_t nbPoints, double voxelSize, unsigned int nbThreads = 0);
+
+  //! Number of voxels holding points
+  size_t GetNumberOfVoxels() const
+  {
+    return this->VoxelBegin.empty() ? 0 : this->VoxelBegin.size() - 1;
+  }
+
+  //! Index of the points sorted by voxel, the points of a voxel in their original order
+  const std::vector<uint32_t>& GetOrder() const { return this->Order; }
+
+  //! Position in GetOrder of the first point of each voxel, followed by the number of
+  //! points sorted
+  const std::vector<uint32_t>& GetVoxelBegin() const { return this->VoxelBegin; }
+
+  //! Maximum number of bits of the coordinates of a voxel along an axis
+  static const int MaxBitsPerAxis = 21;
+
+private:
+  std::vector<uint64_t> Keys;
+  std::vector<uint32_t> Order;
+  std::vector<uint64_t> KeysBuffer;
+  std::vector<uint32_t> OrderBuffer;
+  std::vector<uint32_t> VoxelBegin;
+};
+
+#endif // VOXEL_GRID_SORT_H
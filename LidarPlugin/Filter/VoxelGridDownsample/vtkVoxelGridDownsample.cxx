@@ -0,0 +1,298 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// LOCAL
+#include "vtkVoxelGridDownsample.h"
+#include "ParallelFor.h"
+#include "vtkHelper.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// VTK
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkFieldData.h>
+#include <vtkIdList.h>
+#include <vtkIdTypeArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// Implementation of the New function
+vtkStandardNewMacro(vtkVoxelGridDownsample)
+
+namespace {
+// Number of voxels reduced by a thread at a time
+const size_t VoxelChunkSize = 4096;
+
+//------------------------------------------------------------------------------
+// Copy the tuples of the given indices, in their order
+template <typename T>
+void GatherTuples(const T* in, T* out, int nbComponents, const std::vector<uint32_t>& indices,
+                  unsigned int nbThreads)
+{
+  Parallel::ForEachChunk(indices.size(), VoxelChunkSize, nbThreads,
+    [&](unsigned int, size_t begin, size_t end)
+  {
+    for (size_t i = begin; i < end; ++i)
+    {
+      std::copy(in + static_cast<size_t>(indices[i]) * nbComponents,
+                in + static_cast<size_t>(indices[i] + 1) * nbComponents,
+                out + i * nbComponents);
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+// Mean of the tuples of each voxel, rounded for the integer types
+template <typename T>
+void AverageTuples(const T* in, T* out, int nbComponents, const VoxelGridSort& sort,
+                   unsigned int nbThreads)
+{
+  const std::vector<uint32_t>& order = sort.GetOrder();
+  const std::vector<uint32_t>& voxelBegin = sort.GetVoxelBegin();
+  Parallel::ForEachChunk(sort.GetNumberOfVoxels(), VoxelChunkSize, nbThreads,
+    [&](unsigned int, size_t begin, size_t end)
+  {
+    std::vector<double> sums(nbComponents);
+    for (size_t voxel = begin; voxel < end; ++voxel)
+    {
+      std::fill(sums.begin(), sums.end(), 0.0);
+      for (uint32_t k = voxelBegin[voxel]; k < voxelBegin[voxel + 1]; ++k)
+      {
+        const T* tuple = in + static_cast<size_t>(order[k]) * nbComponents;
+        for (int c = 0; c < nbComponents; ++c)
+        {
+          sums[c] += static_cast<double>(tuple[c]);
+        }
+      }
+      const double count = voxelBegin[voxel + 1] - voxelBegin[voxel];
+      for (int c = 0; c < nbComponents; ++c)
+      {
+        const double mean = sums[c] / count;
+        out[voxel * nbComponents + c] =
+          static_cast<T>(std::numeric_limits<T>::is_integer ? std::round(mean) : mean);
+      }
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+// New array of the same type, name and number of components, with n tuples
+vtkSmartPointer<vtkAbstractArray> NewArrayLike(vtkAbstractArray* in, size_t n)
+{
+  auto out = vtkSmartPointer<vtkAbstractArray>::Take(in->NewInstance());
+  out->SetName(in->GetName());
+  out->SetNumberOfComponents(in->GetNumberOfComponents());
+  out->SetNumberOfTuples(static_cast<vtkIdType>(n));
+  return out;
+}
+
+//------------------------------------------------------------------------------
+// Tuples of the given indices
+vtkSmartPointer<vtkAbstractArray> Gather(vtkAbstractArray* in, const std::vector<uint32_t>& indices,
+                                         unsigned int nbThreads)
+{
+  vtkSmartPointer<vtkAbstractArray> out = NewArrayLike(in, indices.size());
+  const int nbComponents = in->GetNumberOfComponents();
+  switch (vtkDataArray::SafeDownCast(in) ? in->GetDataType() : VTK_VOID)
+  {
+    vtkTemplateMacro(GatherTuples(static_cast<const VTK_TT*>(in->GetVoidPointer(0)),
+                                  static_cast<VTK_TT*>(out->GetVoidPointer(0)),
+                                  nbComponents, indices, nbThreads));
+    default:
+    {
+      // strings, bits...
+      vtkNew<vtkIdList> ids;
+      ids->SetNumberOfIds(static_cast<vtkIdType>(indices.size()));
+      for (size_t i = 0; i < indices.size(); ++i)
+      {
+        ids->SetId(static_cast<vtkIdType>(i), indices[i]);
+      }
+      in->GetTuples(ids.GetPointer(), out);
+    }
+  }
+  return out;
+}
+
+//------------------------------------------------------------------------------
+// Mean of the tuples of each voxel for the numerical arrays, the tuple of the
+// first point of the voxel for the others
+vtkSmartPointer<vtkAbstractArray> Average(vtkAbstractArray* in, const VoxelGridSort& sort,
+                                          const std::vector<uint32_t>& firstPoints,
+                                          unsigned int nbThreads)
+{
+  vtkSmartPointer<vtkAbstractArray> out = NewArrayLike(in, sort.GetNumberOfVoxels());
+  const int nbComponents = in->GetNumberOfComponents();
+  switch (vtkDataArray::SafeDownCast(in) ? in->GetDataType() : VTK_VOID)
+  {
+    vtkTemplateMacro(AverageTuples(static_cast<const VTK_TT*>(in->GetVoidPointer(0)),
+                                   static_cast<VTK_TT*>(out->GetVoidPointer(0)),
+                                   nbComponents, sort, nbThreads));
+    default:
+      return Gather(in, firstPoints, nbThreads);
+  }
+  return out;
+}
+}
+
+//-----------------------------------------------------------------------------
+vtkVoxelGridDownsample::vtkVoxelGridDownsample()
+{
+  this->SetInputArrayToProcess(0, 0, 0, vtkDataObject::FIELD_ASSOCIATION_POINTS, "intensity");
+}
+
+//-----------------------------------------------------------------------------
+void vtkVoxelGridDownsample::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "VoxelSize: " << this->VoxelSize << std::endl;
+  os << indent << "Reducer: " << this->Reducer << std::endl;
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+int vtkVoxelGridDownsample::RequestData(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector,
+  vtkInformationVector* outputVector)
+{
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
+  vtkPolyData* output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
+  output->Initialize();
+  output->GetFieldData()->ShallowCopy(input->GetFieldData());
+  vtkPoints* inputPoints = input->GetPoints();
+  if (!inputPoints || inputPoints->GetNumberOfPoints() == 0)
+  {
+    return 1;
+  }
+
+  // group the points by voxel, reading the coordinates in place when possible
+  vtkDataArray* coordinates = inputPoints->GetData();
+  const size_t nbPoints = static_cast<size_t>(inputPoints->GetNumberOfPoints());
+  bool isSorted = false;
+  switch (coordinates->GetDataType())
+  {
+    case VTK_FLOAT:
+      isSorted = this->Sort.Sort(static_cast<const float*>(coordinates->GetVoidPointer(0)),
+                                 nbPoints, this->VoxelSize, this->NumberOfThreads);
+      break;
+    case VTK_DOUBLE:
+      isSorted = this->Sort.Sort(static_cast<const double*>(coordinates->GetVoidPointer(0)),
+                                 nbPoints, this->VoxelSize, this->NumberOfThreads);
+      break;
+    default:
+    {
+      std::vector<double> converted(3 * nbPoints);
+      for (size_t i = 0; i < nbPoints; ++i)
+      {
+        inputPoints->GetPoint(static_cast<vtkIdType>(i), &converted[3 * i]);
+      }
+      isSorted = this->Sort.Sort(converted.data(), nbPoints, this->VoxelSize, this->NumberOfThreads);
+    }
+  }
+  if (!isSorted)
+  {
+    vtkErrorMacro("The voxels are too small for the extent of the point cloud, which spans more than "
+                  << (1 << VoxelGridSort::MaxBitsPerAxis) << " voxels along an axis.");
+    return 0;
+  }
+
+  const std::vector<uint32_t>& order = this->Sort.GetOrder();
+  const std::vector<uint32_t>& voxelBegin = this->Sort.GetVoxelBegin();
+  const size_t nbVoxels = this->Sort.GetNumberOfVoxels();
+  std::vector<uint32_t> representatives(nbVoxels);
+  for (size_t voxel = 0; voxel < nbVoxels; ++voxel)
+  {
+    representatives[voxel] = order[voxelBegin[voxel]];
+  }
+
+  if (this->Reducer == MAX_INTENSITY)
+  {
+    vtkDataArray* intensity = this->GetInputArrayToProcess(0, inputVector);
+    if (!intensity)
+    {
+      vtkErrorMacro("No input array selected!");
+      return 0;
+    }
+    const std::vector<double> intensities = getComponentValues<double>(intensity);
+    Parallel::ForEachChunk(nbVoxels, VoxelChunkSize, this->NumberOfThreads,
+      [&](unsigned int, size_t begin, size_t end)
+    {
+      for (size_t voxel = begin; voxel < end; ++voxel)
+      {
+        double maxIntensity = -std::numeric_limits<double>::infinity();
+        for (uint32_t k = voxelBegin[voxel]; k < voxelBegin[voxel + 1]; ++k)
+        {
+          const double value = intensities[order[k]];
+          if (value > maxIntensity)
+          {
+            maxIntensity = value;
+            representatives[voxel] = order[k];
+          }
+        }
+      }
+    });
+  }
+
+  // one point per voxel, with all the arrays of the input
+  auto reduce = [&](vtkAbstractArray* array)
+  {
+    return this->Reducer == CENTROID ? Average(array, this->Sort, representatives, this->NumberOfThreads)
+                                     : Gather(array, representatives, this->NumberOfThreads);
+  };
+  vtkNew<vtkPoints> points;
+  points->SetData(vtkDataArray::SafeDownCast(reduce(coordinates)));
+  output->SetPoints(points.GetPointer());
+
+  vtkPointData* inputPointData = input->GetPointData();
+  vtkPointData* outputPointData = output->GetPointData();
+  for (int i = 0; i < inputPointData->GetNumberOfArrays(); ++i)
+  {
+    vtkAbstractArray* array = inputPointData->GetAbstractArray(i);
+    if (array && array->GetNumberOfTuples() == static_cast<vtkIdType>(nbPoints))
+    {
+      outputPointData->AddArray(reduce(array));
+    }
+  }
+  for (int attribute = 0; attribute < vtkDataSetAttributes::NUM_ATTRIBUTES; ++attribute)
+  {
+    vtkAbstractArray* array = inputPointData->GetAbstractAttribute(attribute);
+    if (array && array->GetName())
+    {
+      outputPointData->SetActiveAttribute(array->GetName(), attribute);
+    }
+  }
+
+  vtkNew<vtkIdTypeArray> connectivity;
+  connectivity->SetNumberOfValues(2 * nbVoxels);
+  vtkIdType* cell = connectivity->GetPointer(0);
+  for (size_t i = 0; i < nbVoxels; ++i)
+  {
+    cell[2 * i] = 1;
+    cell[2 * i + 1] = static_cast<vtkIdType>(i);
+  }
+  vtkNew<vtkCellArray> verts;
+  verts->SetCells(static_cast<vtkIdType>(nbVoxels), connectivity.GetPointer());
+  output->SetVerts(verts.GetPointer());
+  return 1;
+}
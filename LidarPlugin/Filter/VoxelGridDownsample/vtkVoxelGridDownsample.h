@@ -0,0 +1,83 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VTK_VOXEL_GRID_DOWNSAMPLE_H
+#define VTK_VOXEL_GRID_DOWNSAMPLE_H
+
+// VTK
+#include <vtkPolyDataAlgorithm.h>
+
+// LOCAL
+#include "VoxelGridSort.h"
+
+/**
+ * @brief vtkVoxelGridDownsample keeps a single point per voxel of a regular grid.
+ *
+ * The points are grouped by voxel with VoxelGridSort, reading the coordinates of float
+ * and double points in place, and each voxel is then reduced to one point in parallel:
+ * - CENTROID: the mean of the points of the voxel, the numerical arrays being averaged
+ *   too and the other arrays taken from the first point,
+ * - FIRST_POINT: the first point of the voxel in the order of the input,
+ * - MAX_INTENSITY: the point of the voxel with the highest value of the array to
+ *   process, "intensity" by default.
+ *
+ * Unlike vtkVoxelAccumulator, which accumulates successive frames, each frame is
+ * downsampled on its own, and all the point data arrays are kept, with the type of
+ * the points.
+ */
+class VTK_EXPORT vtkVoxelGridDownsample : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkVoxelGridDownsample *New();
+  vtkTypeMacro(vtkVoxelGridDownsample, vtkPolyDataAlgorithm)
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  enum ReducerType
+  {
+    CENTROID = 0,
+    FIRST_POINT = 1,
+    MAX_INTENSITY = 2
+  };
+
+  //! Size of the edges of the voxels, in meters
+  vtkGetMacro(VoxelSize, double)
+  vtkSetClampMacro(VoxelSize, double, 1e-6, VTK_DOUBLE_MAX)
+
+  //! How the points of a voxel are reduced to one point, see ReducerType
+  vtkGetMacro(Reducer, int)
+  vtkSetClampMacro(Reducer, int, CENTROID, MAX_INTENSITY)
+
+  //! Number of threads sorting and reducing the points, 0 to use all the cores
+  vtkGetMacro(NumberOfThreads, unsigned int)
+  vtkSetMacro(NumberOfThreads, unsigned int)
+
+protected:
+  vtkVoxelGridDownsample();
+  ~vtkVoxelGridDownsample() = default;
+
+  int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
+
+private:
+  vtkVoxelGridDownsample(const vtkVoxelGridDownsample&) = delete;
+  void operator=(const vtkVoxelGridDownsample&) = delete;
+
+  double VoxelSize = 0.1;
+  int Reducer = CENTROID;
+  unsigned int NumberOfThreads = 0;
+
+  //! Sort of the points, whose buffers are kept between the frames
+  VoxelGridSort Sort;
+};
+
+#endif // VTK_VOXEL_GRID_DOWNSAMPLE_H
@@ -20,8 +20,10 @@
 // LOCAL
 #include "vtkOpenCVVideoReader.h"
 #include "vtkOpenCVConversions.h"
+#include "FrameCache.h"
 
 // STD
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -109,6 +111,13 @@ public:
    */
   void UpdateVideoInfo();
 
+  /**
+   * @brief ReadFrame decode a frame, reusing the decoder state when the
+   * frame follows the last one read
+   * @return false if the frame can not be read
+   */
+  bool ReadFrame(int frameIndex, cv::Mat& image);
+
   //! Parent OpenCVVideoReader
   vtkOpenCVVideoReader* Parent;
 
@@ -133,12 +142,28 @@ public:
   double Origin[3];
   double Scale[3];
   int NChannels;
+
+  //! Index of the frame the next Video.read() returns, -1 if unknown
+  int NextFrameIndex = -1;
+
+  //! The frames are output at 1/DecodeScale of their size
+  int DecodeScale = 1;
+
+  //! Forward jumps up to this number of frames are done by decoding the frames
+  //! in between instead of seeking
+  int MaximumFramesToSkip = 30;
+
+  //! Last frames output, in their output size, and their memory budget in megabytes
+  GenericFrameCache<vtkImageData> Cache;
+  int FrameCacheSize = 0;
 };
 
 //-----------------------------------------------------------------------------
 vtkOpenCVVideoReaderInternal::vtkOpenCVVideoReaderInternal(vtkOpenCVVideoReader* obj)
 {
   this->Parent = obj;
+  this->TimeOffset = 0.0;
+  this->Cache.JoinMemoryBudget("Video frames", MemoryBudget::CameraFramesPriority);
 }
 
 //-----------------------------------------------------------------------------
@@ -150,6 +175,7 @@ int vtkOpenCVVideoReaderInternal::ReadVideoInformation()
     this->FramesPosition[frameIndex] = VideoFramePosition(frameIndex,
                                                           static_cast<double>(frameIndex) / this->VideoInfo.Fps + this->TimeOffset);
   }
+  return static_cast<int>(this->FramesPosition.size());
 }
 
 //-----------------------------------------------------------------------------
@@ -179,17 +205,58 @@ void vtkOpenCVVideoReaderInternal::SetTimestepInformation(vtkInformation* info)
 void vtkOpenCVVideoReaderInternal::UpdateVideoInfo()
 {
   this->VideoInfo.UpdateInfo(&this->Video);
-  this->DataExtend[0] = 0; this->DataExtend[1] = this->VideoInfo.Width - 1;
-  this->DataExtend[2] = 0; this->DataExtend[3] = this->VideoInfo.Height - 1;
+  // the image keeps the same size in the scene whatever its resolution
+  const unsigned int width = std::max(1u, this->VideoInfo.Width / this->DecodeScale);
+  const unsigned int height = std::max(1u, this->VideoInfo.Height / this->DecodeScale);
+  this->DataExtend[0] = 0; this->DataExtend[1] = width - 1;
+  this->DataExtend[2] = 0; this->DataExtend[3] = height - 1;
   this->DataExtend[4] = 0; this->DataExtend[5] = 0;
-  this->Scale[0] = 100.0 / static_cast<double>(this->VideoInfo.Width);
+  this->Scale[0] = 100.0 / static_cast<double>(width);
   this->Scale[1] = this->Scale[0]; this->Scale[2] = this->Scale[0];
   this->Origin[0] = -50.0;
-  this->Origin[1] = -Scale[0] * static_cast<double>(this->VideoInfo.Height) / 2.0;
+  this->Origin[1] = -Scale[0] * static_cast<double>(height) / 2.0;
   this->Origin[2] = 0.0;
   this->NChannels = this->VideoInfo.NChannels;
 }
 
+//-----------------------------------------------------------------------------
+bool vtkOpenCVVideoReaderInternal::ReadFrame(int frameIndex, cv::Mat& image)
+{
+  // A seek decodes again from the keyframe preceding the frame, so the decoder
+  // is only moved when going backward or far forward
+  const int framesToSkip = frameIndex - this->NextFrameIndex;
+  if (this->NextFrameIndex < 0 || framesToSkip < 0 || framesToSkip > this->MaximumFramesToSkip)
+  {
+    this->Video.set(cv::CAP_PROP_POS_FRAMES, frameIndex);
+  }
+  else
+  {
+    // grab decodes the frames without converting them
+    for (int i = 0; i < framesToSkip; ++i)
+    {
+      if (!this->Video.grab())
+      {
+        this->NextFrameIndex = -1;
+        return false;
+      }
+    }
+  }
+
+  if (!this->Video.read(image))
+  {
+    this->NextFrameIndex = -1;
+    return false;
+  }
+  this->NextFrameIndex = frameIndex + 1;
+
+  if (this->DecodeScale > 1)
+  {
+    cv::resize(image, image, cv::Size(this->DataExtend[1] + 1, this->DataExtend[3] + 1),
+               0, 0, cv::INTER_AREA);
+  }
+  return true;
+}
+
 //-----------------------------------------------------------------------------
 void VideoStreamInformation::UpdateInfo(const cv::VideoCapture* video)
 {
@@ -277,32 +344,39 @@ int vtkOpenCVVideoReader::RequestData(vtkInformation *vtkNotUsed(request),
     timestep = info->Get(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP());
   }
 
-  // iterating over all timesteps until finding the first one with a greater time value
-  // this is suboptimal
-  int frameRequested = 0;
-  for (; timestep > this->Internal->FramesPosition[frameRequested].Time; frameRequested++);
-
-  if (frameRequested < 0 || frameRequested >= this->GetNumberOfFrames())
+  // first frame whose time is not smaller than the requested one
+  auto position = std::lower_bound(this->Internal->FramesPosition.begin(),
+                                   this->Internal->FramesPosition.end(),
+                                   timestep,
+                                   [](const VideoFramePosition& frame, double time)
+                                     { return frame.Time < time; });
+  const int frameRequested = static_cast<int>(
+    std::distance(this->Internal->FramesPosition.begin(), position));
+
+  if (frameRequested < 0 || frameRequested >= this->GetNumberOfFrames()
+      || position == this->Internal->FramesPosition.end())
   {
     vtkErrorMacro("Cannot meet timestep request: " << frameRequested << ".  Have "
                                                    << this->GetNumberOfFrames() << " datasets.");
     return 0;
   }
 
-  // Update Video info
-  this->Internal->UpdateVideoInfo();
-  this->Internal->Video.set(cv::CAP_PROP_POS_FRAMES, frameRequested);
-
-  // Get the image for the current position
-  cv::Mat cvImage;
-  if (!this->Internal->Video.read(cvImage))
+  // Get the image for the current position, from the cache if possible
+  vtkSmartPointer<vtkImageData> image = this->Internal->Cache.Get(frameRequested);
+  if (!image)
   {
-    vtkErrorMacro("Not able to read frame: " << frameRequested);
-    return 0;
+    cv::Mat cvImage;
+    if (!this->Internal->ReadFrame(frameRequested, cvImage))
+    {
+      vtkErrorMacro("Not able to read frame: " << frameRequested);
+      return 0;
+    }
+    // Convert cvMat to vtkImageData
+    image = CvImageToVtkImage(cvImage);
+    this->Internal->Cache.Insert(frameRequested, image);
   }
 
-  // Convert cvMat to vtkImageData
-  output->ShallowCopy(CvImageToVtkImage(cvImage));
+  output->ShallowCopy(image);
   output->SetOrigin(this->Internal->Origin);
   output->SetSpacing(this->Internal->Scale);
   output->SetExtent(this->Internal->DataExtend);
@@ -326,6 +400,8 @@ void vtkOpenCVVideoReader::SetFileName(const char* filename)
   }
   this->Internal->FileName = std::string(filename);
   this->Internal->FramesPosition = std::vector<VideoFramePosition>();
+  this->Internal->NextFrameIndex = 0;
+  this->Internal->Cache.Clear();
   this->Internal->UpdateVideoInfo();
   this->Modified();
 }
@@ -341,3 +417,48 @@ double vtkOpenCVVideoReader::GetTimeOffset()
 {
   return this->Internal->TimeOffset;
 }
+
+//-----------------------------------------------------------------------------
+void vtkOpenCVVideoReader::SetDecodeScale(int scale)
+{
+  scale = std::max(1, scale);
+  if (scale == this->Internal->DecodeScale)
+  {
+    return;
+  }
+  this->Internal->DecodeScale = scale;
+  this->Internal->Cache.Clear();
+  this->Internal->UpdateVideoInfo();
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+int vtkOpenCVVideoReader::GetDecodeScale()
+{
+  return this->Internal->DecodeScale;
+}
+
+//-----------------------------------------------------------------------------
+void vtkOpenCVVideoReader::SetMaximumFramesToSkip(int numberOfFrames)
+{
+  this->Internal->MaximumFramesToSkip = numberOfFrames;
+}
+
+//-----------------------------------------------------------------------------
+int vtkOpenCVVideoReader::GetMaximumFramesToSkip()
+{
+  return this->Internal->MaximumFramesToSkip;
+}
+
+//-----------------------------------------------------------------------------
+void vtkOpenCVVideoReader::SetFrameCacheSize(int size)
+{
+  this->Internal->FrameCacheSize = size;
+  this->Internal->Cache.SetMemoryBudget(std::max(size, 0) * 1024ul);
+}
+
+//-----------------------------------------------------------------------------
+int vtkOpenCVVideoReader::GetFrameCacheSize()
+{
+  return this->Internal->FrameCacheSize;
+}
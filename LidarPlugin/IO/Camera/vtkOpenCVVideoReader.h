@@ -41,6 +41,31 @@ public:
 
   void SetTimeOffset(double argTs);
   double GetTimeOffset();
+
+  /**
+   * @brief SetDecodeScale output the frames at 1/scale of their size, which is
+   * lighter to convert and display in the 3D view
+   */
+  void SetDecodeScale(int scale);
+  int GetDecodeScale();
+
+  /**
+   * @brief SetMaximumFramesToSkip when a frame a little after the last one read is
+   * requested, the frames in between are decoded and dropped rather than seeking,
+   * as a seek decodes again from the previous keyframe. Above this distance the
+   * reader seeks.
+   */
+  void SetMaximumFramesToSkip(int numberOfFrames);
+  int GetMaximumFramesToSkip();
+
+  /**
+   * @brief SetFrameCacheSize memory budget in megabytes of the cache of the last
+   * frames output, which makes going back and forth around a time step immediate.
+   * 0 disables the cache
+   */
+  void SetFrameCacheSize(int size);
+  int GetFrameCacheSize();
+
 protected:
   vtkOpenCVVideoReader();
   ~vtkOpenCVVideoReader() override;
@@ -20,12 +20,19 @@
 #include "vtkPCAPImageReader.h"
 
 #include <algorithm>
+#include <set>
 #include <sstream>
 
 #include "vtkPacketFileReader.h"
 #include "vtkOpenCVConversions.h"
+#include "FrameCache.h"
+#include "FrameCatalogIndex.h"
 #include "statistics.h"
 
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/imgcodecs.hpp>
@@ -35,16 +42,217 @@
 #include <vtkInformation.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
 
+//------------------------------------------------------------------------------
+struct vtkPCAPImageReader::DecodePool
+{
+  DecodePool()
+  {
+    this->Cache.JoinMemoryBudget("Camera frames", MemoryBudget::CameraFramesPriority);
+  }
+
+  //! Protect the cache and the request
+  boost::mutex Mutex;
+  boost::condition_variable Condition;
+
+  //! Decoded frames and reader MTime when they have been decoded
+  GenericFrameCache<vtkImageData> Cache;
+  vtkMTimeType CacheMTime = 0;
+
+  //! Last frame requested, and the frames already taken by a thread since this request
+  int RequestedFrame = -1;
+  std::set<int> ClaimedFrames;
+
+  std::vector<std::unique_ptr<boost::thread> > Threads;
+  bool Stop = false;
+};
+
+namespace
+{
+//------------------------------------------------------------------------------
+//! There is no sensor specific information for the images, but the frame
+//! catalog sidecar requires it to be serializable
+struct ImageFrameInformation : public SpecificFrameInformation
+{
+  void reset() override {}
+  std::unique_ptr<SpecificFrameInformation> clone() override
+  {
+    return std::unique_ptr<SpecificFrameInformation>(new ImageFrameInformation);
+  }
+  bool write(std::ostream&) const override { return true; }
+  bool read(std::istream&) override { return true; }
+};
+
+//! Extension of the frame catalog sidecar, the lidar one may be next to it
+const char* const ImageIndexExtension = ".lvimageindex";
+
+//------------------------------------------------------------------------------
+//! imdecode flags to decode an image at 1/scale of its size
+int GetDecodeFlags(int scale)
+{
+  if (scale >= 8)
+  {
+    return cv::IMREAD_REDUCED_COLOR_8;
+  }
+  if (scale >= 4)
+  {
+    return cv::IMREAD_REDUCED_COLOR_4;
+  }
+  if (scale >= 2)
+  {
+    return cv::IMREAD_REDUCED_COLOR_2;
+  }
+  return cv::IMREAD_UNCHANGED | cv::IMREAD_COLOR;
+}
+}
+
 //------------------------------------------------------------------------------
 vtkStandardNewMacro(vtkPCAPImageReader)
 
 //------------------------------------------------------------------------------
 vtkPCAPImageReader::vtkPCAPImageReader()
+  : Pool(new DecodePool)
 {
   this->SetNumberOfInputPorts(0);
   this->SetNumberOfOutputPorts(1);
 }
 
+//------------------------------------------------------------------------------
+vtkPCAPImageReader::~vtkPCAPImageReader()
+{
+  this->StopDecodePool();
+  this->Close();
+}
+
+//------------------------------------------------------------------------------
+void vtkPCAPImageReader::SetFrameCacheSize(int size)
+{
+  if (size == this->FrameCacheSize)
+  {
+    return;
+  }
+  this->StopDecodePool();
+  this->FrameCacheSize = size;
+  this->Pool->Cache.SetMemoryBudget(std::max(size, 0) * 1024ul);
+}
+
+//------------------------------------------------------------------------------
+void vtkPCAPImageReader::SetNumberOfDecodeThreads(int numberOfThreads)
+{
+  if (numberOfThreads == this->NumberOfDecodeThreads)
+  {
+    return;
+  }
+  this->StopDecodePool();
+  this->NumberOfDecodeThreads = numberOfThreads;
+}
+
+//------------------------------------------------------------------------------
+void vtkPCAPImageReader::StartDecodePool()
+{
+  if (!this->Pool->Threads.empty())
+  {
+    return;
+  }
+  int numberOfThreads = this->NumberOfDecodeThreads;
+  if (numberOfThreads <= 0)
+  {
+    numberOfThreads = static_cast<int>(std::max(1u, boost::thread::hardware_concurrency()));
+  }
+  this->Pool->Stop = false;
+  for (int i = 0; i < numberOfThreads; ++i)
+  {
+    this->Pool->Threads.emplace_back(new boost::thread(&vtkPCAPImageReader::DecodeFramesAhead, this));
+  }
+}
+
+//------------------------------------------------------------------------------
+void vtkPCAPImageReader::StopDecodePool()
+{
+  if (!this->Pool->Threads.empty())
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(this->Pool->Mutex);
+      this->Pool->Stop = true;
+    }
+    this->Pool->Condition.notify_all();
+    for (auto& thread : this->Pool->Threads)
+    {
+      thread->join();
+    }
+    this->Pool->Threads.clear();
+  }
+  this->Pool->Cache.Clear();
+  this->Pool->RequestedFrame = -1;
+  this->Pool->ClaimedFrames.clear();
+}
+
+//------------------------------------------------------------------------------
+void vtkPCAPImageReader::DecodeFramesAhead()
+{
+  DecodePool& pool = *this->Pool;
+  // each thread has its own reader, as a reader can not be shared
+  vtkPacketFileReader reader;
+  vtkMTimeType readerMTime = 0;
+
+  // next frame in the playback direction that is neither cached nor taken by another thread
+  auto nextFrameToDecode = [this, &pool]()
+  {
+    const int direction = this->PlaybackDirection < 0 ? -1 : 1;
+    for (int i = 1; pool.RequestedFrame >= 0 && i <= this->NumberOfFramesToPrefetch; ++i)
+    {
+      const int frameNumber = pool.RequestedFrame + direction * i;
+      if (frameNumber < 0 || frameNumber >= this->GetNumberOfFrames())
+      {
+        break;
+      }
+      if (!pool.Cache.Contains(frameNumber) && !pool.ClaimedFrames.count(frameNumber))
+      {
+        return frameNumber;
+      }
+    }
+    return -1;
+  };
+
+  boost::unique_lock<boost::mutex> lock(pool.Mutex);
+  while (true)
+  {
+    int frameNumber = -1;
+    pool.Condition.wait(lock, [&]()
+      { return pool.Stop || (frameNumber = nextFrameToDecode()) >= 0; });
+    if (pool.Stop)
+    {
+      return;
+    }
+    pool.ClaimedFrames.insert(frameNumber);
+    const vtkMTimeType cacheMTime = pool.CacheMTime;
+
+    // decode without the lock, so that the threads decode in parallel
+    lock.unlock();
+    if (!reader.IsOpen() || readerMTime != cacheMTime)
+    {
+      reader.Close();
+      reader.Open(this->FileName, this->GetPacketSelection());
+      readerMTime = cacheMTime;
+    }
+    vtkSmartPointer<vtkImageData> frame;
+    if (reader.IsOpen())
+    {
+      cv::Mat cvImage = this->DecodeOpenCVFrame(&reader, frameNumber);
+      if (cvImage.data)
+      {
+        frame = CvImageToVtkImage(cvImage);
+      }
+    }
+    lock.lock();
+
+    // the frame is dropped if the settings have changed meanwhile
+    if (cacheMTime == pool.CacheMTime)
+    {
+      pool.Cache.Insert(frameNumber, frame);
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 bool vtkPCAPImageReader::UpdateFrameSize()
 {
@@ -145,14 +353,35 @@ bool isImagePacket(const unsigned char* data, size_t dataLength)
 //------------------------------------------------------------------------------
 int vtkPCAPImageReader::ReadFrameInformation()
 {
+  this->StopDecodePool();
+
+  // reset the frame catalog to build a new one
+  this->FrameCatalog.clear();
+
+  // load the catalog saved the last time the file was opened, if it is up to date
+  FrameInformation prototype;
+  prototype.SpecificInformation = std::make_shared<ImageFrameInformation>();
+  const std::string frameIndexSettings = "vtkPCAPImageReader;filter=" + this->GetPacketSelection().GetFilter();
+  if (this->UseFrameIndexCache
+      && FrameCatalogIndex::Read(this->FileName, frameIndexSettings, prototype,
+                                 this->FrameCatalog, ImageIndexExtension))
+  {
+    for (size_t i = 0; i < this->FrameCatalog.size(); i++)
+    {
+      this->FrameCatalog[i].FirstPacketNetworkTime += this->TimeOffset;
+    }
+    return this->GetNumberOfFrames();
+  }
+
   this->Open();
+  if (!this->Reader)
+  {
+    return 0;
+  }
   const unsigned char* data = nullptr;
   unsigned int dataLength = 0;
   // bool firstIteration = true;
 
-  // reset the frame catalog to build a new one
-  this->FrameCatalog.clear();
-
   // keep track of the file position
   // and the network timestamp of the
   // current udp packet to process
@@ -193,16 +422,24 @@ int vtkPCAPImageReader::ReadFrameInformation()
     // "FirstPacketDataTime" makes no sens in this use case, because there is no
     // per-pixel time in the image (there is no time at all actually).
     currentFrameInfo.FirstPacketDataTime = 0.0;
-    currentFrameInfo.SpecificInformation = nullptr; // no such data
+    currentFrameInfo.SpecificInformation = prototype.SpecificInformation; // no such data
     this->FrameCatalog.push_back(currentFrameInfo);
 
     this->Reader->GetFilePosition(&lastFilePosition);
   }
 
+  this->Close();
+
   if (this->FrameCatalog.size() == 0)
   {
     vtkErrorMacro("The reader could not parse the pcap file")
   }
+  else if (this->UseFrameIndexCache)
+  {
+    // the catalog is saved without the time offset, which can change
+    FrameCatalogIndex::Write(this->FileName, frameIndexSettings, this->FrameCatalog,
+                             ImageIndexExtension);
+  }
 
   for (size_t i = 0; i < this->FrameCatalog.size(); i++)
   {
@@ -257,6 +494,7 @@ void vtkPCAPImageReader::SetFileName(const std::string &filename)
     return;
   }
 
+  this->StopDecodePool();
   this->FileName = filename;
   this->FrameCatalog.clear();
   this->Modified();
@@ -270,16 +508,21 @@ cv::Mat vtkPCAPImageReader::GetOpenCVFrame(int frameNumber)
     vtkErrorMacro("GetOpenCVFrame() called but packet file reader is not open.")
     return cv::Mat(0, 0, CV_8UC3);
   }
+  return this->DecodeOpenCVFrame(this->Reader, frameNumber);
+}
 
+//------------------------------------------------------------------------------
+cv::Mat vtkPCAPImageReader::DecodeOpenCVFrame(vtkPacketFileReader* reader, int frameNumber)
+{
   const unsigned char* data = 0;
   unsigned int dataLength = 0;
   double timeSinceStart;
 
   // Update the interpreter meta data according to the requested frame
   FrameInformation currInfo= this->FrameCatalog[frameNumber];
-  this->Reader->SetFilePosition(&currInfo.FilePosition);
+  reader->SetFilePosition(&currInfo.FilePosition);
 
-  if (!this->Reader->NextPacket(data, dataLength, timeSinceStart))
+  if (!reader->NextPacket(data, dataLength, timeSinceStart))
   {
     vtkErrorMacro("vtkPacketFileReader::GetOpenCVFrame() failed to access packet")
     return cv::Mat(0, 0, CV_8UC3);
@@ -289,8 +532,9 @@ cv::Mat vtkPCAPImageReader::GetOpenCVFrame(int frameNumber)
   // If the memory at data was written to a file you would get a standard image file
   // source: https://stackoverflow.com/questions/14727267/opencv-read-jpeg-image-from-buffer
   // Create a Size(1, nSize) Mat object of 8-bit, single-byte elements
+  // The reduced modes let libjpeg scale the image down while decoding it.
   cv::Mat rawData(1, dataLength, CV_8UC1, (void*)data);
-  cv::Mat decodedImage = cv::imdecode(rawData,cv::IMREAD_UNCHANGED|cv::IMREAD_COLOR);
+  cv::Mat decodedImage = cv::imdecode(rawData, GetDecodeFlags(this->DecodeScale));
   if (decodedImage.data == nullptr)
   {
     vtkErrorMacro("Error decoding raw image data")
@@ -299,18 +543,58 @@ cv::Mat vtkPCAPImageReader::GetOpenCVFrame(int frameNumber)
   return decodedImage;
 }
 
+//------------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> vtkPCAPImageReader::GetFrame(int frameNumber)
+{
+  if (this->FrameCacheSize <= 0)
+  {
+    //! @todo we should no open the pcap file everytime a frame is requested !!!
+    this->Open();
+    cv::Mat cvImage = this->GetOpenCVFrame(frameNumber);
+    this->Close();
+    return CvImageToVtkImage(cvImage);
+  }
+
+  this->StartDecodePool();
+  vtkSmartPointer<vtkImageData> frame;
+  vtkMTimeType cacheMTime = 0;
+  {
+    boost::lock_guard<boost::mutex> lock(this->Pool->Mutex);
+    if (this->Pool->CacheMTime != this->GetMTime())
+    {
+      this->Pool->Cache.Clear();
+      this->Pool->CacheMTime = this->GetMTime();
+    }
+    cacheMTime = this->Pool->CacheMTime;
+    frame = this->Pool->Cache.Get(frameNumber);
+    this->Pool->RequestedFrame = frameNumber;
+    this->Pool->ClaimedFrames.clear();
+  }
+  this->Pool->Condition.notify_all();
+
+  // the threads decode the next frames while this one is decoded
+  if (!frame)
+  {
+    this->Open();
+    cv::Mat cvImage = this->GetOpenCVFrame(frameNumber);
+    this->Close();
+    frame = CvImageToVtkImage(cvImage);
+    boost::lock_guard<boost::mutex> lock(this->Pool->Mutex);
+    if (cacheMTime == this->Pool->CacheMTime)
+    {
+      this->Pool->Cache.Insert(frameNumber, frame);
+    }
+  }
+  return frame;
+}
+
 //------------------------------------------------------------------------------
 void vtkPCAPImageReader::Open()
 {
   this->Close();
   this->Reader = new vtkPacketFileReader;
 
-  std::string filterPCAP = "udp";
-  if (this->NetworkPort != -1)
-  {
-    filterPCAP += " port " + std::to_string(this->NetworkPort);
-  }
-  if (!this->Reader->Open(this->FileName, filterPCAP.c_str()))
+  if (!this->Reader->Open(this->FileName, this->GetPacketSelection()))
   {
     vtkErrorMacro(<< "Failed to open packet file: " << this->FileName << "!\n"
                                                  << this->Reader->GetLastError())
@@ -318,6 +602,17 @@ void vtkPCAPImageReader::Open()
   }
 }
 
+//------------------------------------------------------------------------------
+UDPPacketSelection vtkPCAPImageReader::GetPacketSelection() const
+{
+  UDPPacketSelection selection;
+  if (this->NetworkPort != -1)
+  {
+    selection.Ports.push_back(this->NetworkPort);
+  }
+  return selection;
+}
+
 //------------------------------------------------------------------------------
 void vtkPCAPImageReader::Close()
 {
@@ -366,19 +661,14 @@ int vtkPCAPImageReader::RequestData(vtkInformation *vtkNotUsed(request),
     return 0;
   }
 
-  //! @todo we should no open the pcap file everytime a frame is requested !!!
-  this->Open();
-  cv::Mat cvImage = this->GetOpenCVFrame(frameRequested);
-  // Convert cvMat to vtkImageData
-  vtkSmartPointer<vtkImageData> vtkImage = CvImageToVtkImage(cvImage);
+  // the cached frames are shared, so the output only gets a shallow copy
+  vtkSmartPointer<vtkImageData> vtkImage = this->GetFrame(frameRequested);
 
   output->ShallowCopy(vtkImage);
   output->SetOrigin(this->Origin);
   output->SetSpacing(this->Scale);
   output->SetExtent(this->Extent);
 
-  this->Close();
-
   return 1;
 }
 
@@ -20,9 +20,13 @@
 #ifndef VTKPCAPIMAGEREADER_H
 #define VTKPCAPIMAGEREADER_H
 
+#include <memory>
+
 #include <opencv2/core.hpp>
 
 #include <vtkImageAlgorithm.h>
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
 
 #include "vtkPacketFileReader.h"
 #include "FrameInformation.h"
@@ -45,9 +49,31 @@ public:
   vtkGetMacro(TimeOffset, double)
   vtkSetMacro(TimeOffset, double)
 
+  vtkGetMacro(UseFrameIndexCache, bool)
+  vtkSetMacro(UseFrameIndexCache, bool)
+
+  vtkGetMacro(FrameCacheSize, int)
+  virtual void SetFrameCacheSize(int size);
+
+  vtkGetMacro(NumberOfFramesToPrefetch, int)
+  vtkSetMacro(NumberOfFramesToPrefetch, int)
+
+  vtkGetMacro(NumberOfDecodeThreads, int)
+  virtual void SetNumberOfDecodeThreads(int numberOfThreads);
+
+  vtkGetMacro(DecodeScale, int)
+  vtkSetClampMacro(DecodeScale, int, 1, 8)
+
+  /**
+   * @copydoc PlaybackDirection
+   * This does not modify the reader, as the output does not depend on it.
+   */
+  vtkGetMacro(PlaybackDirection, int)
+  virtual void SetPlaybackDirection(int direction) { this->PlaybackDirection = direction; }
+
 protected:
   vtkPCAPImageReader();
-  ~vtkPCAPImageReader() = default;
+  ~vtkPCAPImageReader();
 
   //! Name of the pcap file to read
   std::string FileName = "";
@@ -67,6 +93,29 @@ protected:
   //! TimeOffset in seconds relative to reception time in the PCAP
   double TimeOffset = 0.0;
 
+  //! Save the frame catalog in a sidecar file next to the pcap once it has been built,
+  //! and load it instead of parsing the whole pcap the next time the file is opened
+  bool UseFrameIndexCache = true;
+
+  //! Memory budget in megabytes of the cache of decoded frames, 0 to disable the cache
+  //! and the decoding in advance
+  int FrameCacheSize = 0;
+
+  //! Number of frames decoded in advance in the playback direction, while the frame
+  //! cache is enabled
+  int NumberOfFramesToPrefetch = 4;
+
+  //! Number of threads decoding the frames in advance, 0 to use all the cores
+  int NumberOfDecodeThreads = 2;
+
+  //! The images are decoded at 1/DecodeScale of their size, which is much faster
+  //! for a preview. The JPEG decoder supports 1, 2, 4 and 8, other values are rounded down
+  int DecodeScale = 1;
+
+  //! Direction in which the frames are played, 1 forward and -1 backward.
+  //! Used to choose which frames should be decoded in advance
+  int PlaybackDirection = 1;
+
   /**
    * @brief Open open the pcap file
    * @todo a decition should be made if the opening/closing of the pcap should be handle by
@@ -98,6 +147,40 @@ private:
    */
   int ReadFrameInformation();
 
+  /**
+   * @brief DecodeOpenCVFrame read and decode a frame with a given reader, which must be
+   * open on FileName. This does not modify the reader and can be called from any thread.
+   */
+  cv::Mat DecodeOpenCVFrame(vtkPacketFileReader* reader, int frameNumber);
+
+  /**
+   * @brief GetFrame return a frame converted to vtkImageData, from the frame cache
+   * if it has already been decoded, and request the following ones to be decoded
+   */
+  vtkSmartPointer<vtkImageData> GetFrame(int frameNumber);
+
+  //! Packets read from the file: the image packets on NetworkPort, of any size
+  UDPPacketSelection GetPacketSelection() const;
+
+  /**
+   * @brief StartDecodePool start the threads decoding frames in advance, if they are
+   * not already running
+   */
+  void StartDecodePool();
+
+  /**
+   * @brief StopDecodePool stop the threads decoding frames in advance and clear the
+   * cached frames. This must be called before changing the frame catalog.
+   */
+  void StopDecodePool();
+
+  //! Function run by each thread decoding frames in advance
+  void DecodeFramesAhead();
+
+  //! Cache of decoded frames and state of the threads filling it
+  struct DecodePool;
+  std::unique_ptr<DecodePool> Pool;
+
   int Width = 0;
   int Height = 0;
   int Extent[6] = {0, 0, 0, 0, 0, 0};
@@ -15,6 +15,7 @@
 #ifndef FRAMEINFORMATION_H
 #define FRAMEINFORMATION_H
 
+#include <iostream>
 #include <memory>
 
 /**
@@ -24,6 +25,12 @@
 struct SpecificFrameInformation {
   virtual void reset() = 0;
   virtual std::unique_ptr<SpecificFrameInformation> clone() = 0;
+
+  //! Serialize the information in a binary stream, return false if not supported
+  virtual bool write(std::ostream&) const { return false; }
+
+  //! Deserialize the information from a binary stream, return false if not supported
+  virtual bool read(std::istream&) { return false; }
 };
 
 /**
@@ -29,6 +29,7 @@
 #include "vtkApplanixPositionReader.h"
 
 #include "vtkCustomTransformInterpolator.h"
+#include "MappedTextFile.h"
 
 #include <vtkCellArray.h>
 #include <vtkDoubleArray.h>
@@ -44,6 +45,7 @@
 #include <boost/lexical_cast.hpp>
 
 #include <map>
+#include <vector>
 
 #define DATA_ARRAY(name)                                                                           \
   vtkNew<vtkDoubleArray> name##Data;                                                               \
@@ -142,21 +144,21 @@ int vtkApplanixPositionReader::RequestData(
   zoneData->SetName("zone");
 
   // Open data file
-  std::ifstream f(this->FileName);
-  if (!f.good())
+  MappedTextFile f;
+  if (!f.Open(this->FileName))
   {
     vtkErrorMacro("Failed to open input file \"" << this->FileName << "\"");
     return VTK_ERROR;
   }
 
-  std::string line;
   std::string lastLine;
 
   // Read header
   size_t numFields = 0;
-  while (std::getline(f, line))
+  size_t lineIndex = 0;
+  for (; lineIndex < f.GetNumberOfLines(); ++lineIndex)
   {
-    boost::algorithm::trim(line);
+    std::string line = f.GetLine(lineIndex).str();
     if (line.empty())
     {
       continue;
@@ -186,6 +188,7 @@ int vtkApplanixPositionReader::RequestData(
       }
 
       // Done with header
+      ++lineIndex;
       break;
     }
 
@@ -203,38 +206,83 @@ int vtkApplanixPositionReader::RequestData(
   this->Internal->SetMapping("ROLL", rollData);
   this->Internal->SetMapping("PITCH", pitchData);
   this->Internal->SetMapping("HEADING", headingData);
+  std::vector<std::pair<size_t, vtkDoubleArray*> > mapping(
+    this->Internal->FieldMapping.begin(), this->Internal->FieldMapping.end());
+
+  // Read data, parsing the lines in parallel into a buffer
+  enum LineStatus { EMPTY_LINE = 0, VALID_LINE, SHORT_LINE, INVALID_LINE };
+  const size_t firstDataLine = lineIndex;
+  const size_t numLines = f.GetNumberOfLines() - firstDataLine;
+  std::vector<char> status(numLines);
+  std::vector<double> values(numLines * mapping.size());
+  f.ParallelForLines(firstDataLine, f.GetNumberOfLines(), [&](size_t begin, size_t end)
+  {
+    std::vector<MappedTextFile::Range> fields(numFields);
+    for (size_t n = begin; n < end; ++n)
+    {
+      MappedTextFile::Range line = f.GetLine(n);
+      char& lineStatus = status[n - firstDataLine];
+      if (line.empty())
+      {
+        lineStatus = EMPTY_LINE;
+        continue;
+      }
+
+      // Split into fields
+      if (MappedTextFile::SplitFields(line, " ", fields.data(), numFields) < numFields)
+      {
+        lineStatus = SHORT_LINE;
+        continue;
+      }
+
+      lineStatus = VALID_LINE;
+      double* lineValues = &values[(n - firstDataLine) * mapping.size()];
+      for (size_t k = 0; k < mapping.size(); ++k)
+      {
+        if (!MappedTextFile::ParseDouble(fields[mapping[k].first], lineValues[k]))
+        {
+          lineStatus = INVALID_LINE;
+          break;
+        }
+      }
+    }
+  });
 
-  // Read data
+  // Assign values to data arrays
   vtkIdType count = 0;
-  while (std::getline(f, line))
+  for (size_t n = 0; n < numLines; ++n)
   {
-    boost::algorithm::trim(line);
-    if (line.empty())
+    if (status[n] == SHORT_LINE)
     {
-      continue;
+      MappedTextFile::Range line = f.GetLine(firstDataLine + n);
+      std::vector<MappedTextFile::Range> fields(numFields);
+      vtkWarningMacro("Line '" << line.str() << "' has only "
+                               << MappedTextFile::SplitFields(line, " ", fields.data(), numFields)
+                               << "fields (expected " << numFields << ")");
     }
-
-    // Split into fields
-    std::vector<std::string> fields;
-    boost::algorithm::split(
-      fields, line, boost::is_any_of(" "), boost::algorithm::token_compress_on);
-
-    if (fields.size() < numFields)
+    else if (status[n] == INVALID_LINE)
+    {
+      vtkWarningMacro("Line '" << f.GetLine(firstDataLine + n).str()
+                               << "' has a field that is not a number");
+    }
+    count += status[n] == VALID_LINE;
+  }
+  for (size_t k = 0; k < mapping.size(); ++k)
+  {
+    mapping[k].second->SetNumberOfValues(count);
+  }
+  vtkIdType record = 0;
+  for (size_t n = 0; n < numLines; ++n)
+  {
+    if (status[n] != VALID_LINE)
     {
-      vtkWarningMacro("Line '" << line << "' has only " << fields.size() << "fields "
-                               << "(expected " << numFields << ")");
       continue;
     }
-
-    // Assign values to data arrays
-    for (FieldDataMap::iterator iter = this->Internal->FieldMapping.begin();
-         iter != this->Internal->FieldMapping.end(); ++iter)
+    for (size_t k = 0; k < mapping.size(); ++k)
     {
-      const double value = boost::lexical_cast<double>(fields[iter->first]);
-      iter->second->InsertNextValue(value);
+      mapping[k].second->SetValue(record, values[n * mapping.size() + k]);
     }
-
-    ++count;
+    ++record;
   }
 
   // Verify position information
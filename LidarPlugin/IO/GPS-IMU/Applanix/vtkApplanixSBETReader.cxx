@@ -0,0 +1,210 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "vtkApplanixSBETReader.h"
+
+#include "GPSProjectionUtils.h"
+#include "vtkTemporalTransforms.h"
+
+#include <vtkByteSwap.h>
+#include <vtkInformationVector.h>
+#include <vtkMath.h>
+#include <vtkObjectFactory.h>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <Eigen/Geometry>
+
+#include <cstring>
+#include <exception>
+#include <vector>
+
+namespace
+{
+// fields of a SBET record
+enum SBETField
+{
+  TIME = 0,
+  LATITUDE,
+  LONGITUDE,
+  ALTITUDE,
+  VELOCITY_X,
+  VELOCITY_Y,
+  VELOCITY_Z,
+  ROLL,
+  PITCH,
+  PLATFORM_HEADING,
+  WANDER_ANGLE,
+  ACCELERATION_X,
+  ACCELERATION_Y,
+  ACCELERATION_Z,
+  ANGULAR_RATE_X,
+  ANGULAR_RATE_Y,
+  ANGULAR_RATE_Z,
+  NUMBER_OF_FIELDS
+};
+
+const size_t RecordSize = NUMBER_OF_FIELDS * sizeof(double);
+
+vtkSmartPointer<vtkDoubleArray> CreateArray(const char* name, int nbComponents, vtkIdType nbTuples)
+{
+  auto array = vtkSmartPointer<vtkDoubleArray>::New();
+  array->SetName(name);
+  array->SetNumberOfComponents(nbComponents);
+  array->SetNumberOfTuples(nbTuples);
+  return array;
+}
+}
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkApplanixSBETReader)
+
+//-----------------------------------------------------------------------------
+vtkApplanixSBETReader::vtkApplanixSBETReader()
+{
+  this->SetNumberOfInputPorts(0);
+  this->SetNumberOfOutputPorts(1);
+}
+
+//-----------------------------------------------------------------------------
+vtkApplanixSBETReader::~vtkApplanixSBETReader()
+{
+  this->SetFileName(nullptr);
+}
+
+//-----------------------------------------------------------------------------
+int vtkApplanixSBETReader::RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *outputVector)
+{
+  if (!this->FileName || !*this->FileName)
+  {
+    vtkErrorMacro("FileName has not been set");
+    return VTK_ERROR;
+  }
+
+  // Map the records instead of reading them, a SBET file can be large
+  boost::iostreams::mapped_file_source file;
+  try
+  {
+    file.open(this->FileName);
+  }
+  catch (const std::exception&)
+  {
+  }
+  if (!file.is_open())
+  {
+    vtkErrorMacro("Failed to open input file \"" << this->FileName << "\"");
+    return VTK_ERROR;
+  }
+  const vtkIdType nbRecords = static_cast<vtkIdType>(file.size() / RecordSize);
+  if (file.size() % RecordSize != 0)
+  {
+    vtkWarningMacro("The size of \"" << this->FileName << "\" is not a multiple of "
+                    << RecordSize << " bytes, the last incomplete record is ignored");
+  }
+  if (nbRecords == 0)
+  {
+    vtkErrorMacro("No record in input file \"" << this->FileName << "\"");
+    return VTK_ERROR;
+  }
+
+  // Fill each array once, without intermediate buffer
+  auto time = CreateArray("Time", 1, nbRecords);
+  auto orientation = CreateArray("Orientation(AxisAngle)", 4, nbRecords);
+  auto translation = CreateArray("Translation", 3, nbRecords);
+  auto lat = CreateArray("lat", 1, nbRecords);
+  auto lon = CreateArray("lon", 1, nbRecords);
+  auto roll = CreateArray("roll", 1, nbRecords);
+  auto pitch = CreateArray("pitch", 1, nbRecords);
+  auto heading = CreateArray("heading", 1, nbRecords);
+  auto velocity = CreateArray("velocity", 3, nbRecords);
+  auto acceleration = CreateArray("acceleration", 3, nbRecords);
+  auto angularRate = CreateArray("angular rate", 3, nbRecords);
+  double* timeData = time->GetPointer(0);
+  double* orientationData = orientation->GetPointer(0);
+  double* translationData = translation->GetPointer(0);
+  double* latData = lat->GetPointer(0);
+  double* lonData = lon->GetPointer(0);
+  double* rollData = roll->GetPointer(0);
+  double* pitchData = pitch->GetPointer(0);
+  double* headingData = heading->GetPointer(0);
+  double* velocityData = velocity->GetPointer(0);
+  double* accelerationData = acceleration->GetPointer(0);
+  double* angularRateData = angularRate->GetPointer(0);
+
+  const char* records = file.data();
+  for (vtkIdType n = 0; n < nbRecords; ++n)
+  {
+    // the mapping is read only and may not be aligned, so the record is
+    // copied before being swapped to the host byte order
+    double record[NUMBER_OF_FIELDS];
+    std::memcpy(record, records + n * RecordSize, RecordSize);
+    vtkByteSwap::Swap8LERange(record, NUMBER_OF_FIELDS);
+
+    timeData[n] = record[TIME] + this->TimeOffset;
+    latData[n] = vtkMath::DegreesFromRadians(record[LATITUDE]);
+    lonData[n] = vtkMath::DegreesFromRadians(record[LONGITUDE]);
+    translationData[3 * n + 2] = record[ALTITUDE];
+
+    const double trueHeading = record[PLATFORM_HEADING] - record[WANDER_ANGLE];
+    rollData[n] = vtkMath::DegreesFromRadians(record[ROLL]);
+    pitchData[n] = vtkMath::DegreesFromRadians(record[PITCH]);
+    headingData[n] = vtkMath::DegreesFromRadians(trueHeading);
+    const Eigen::AngleAxisd axisAngle(Eigen::AngleAxisd(trueHeading, Eigen::Vector3d::UnitZ())
+                                      * Eigen::AngleAxisd(record[PITCH], Eigen::Vector3d::UnitY())
+                                      * Eigen::AngleAxisd(record[ROLL], Eigen::Vector3d::UnitX()));
+    orientationData[4 * n + 0] = axisAngle.axis()(0);
+    orientationData[4 * n + 1] = axisAngle.axis()(1);
+    orientationData[4 * n + 2] = axisAngle.axis()(2);
+    orientationData[4 * n + 3] = axisAngle.angle();
+
+    for (int k = 0; k < 3; ++k)
+    {
+      velocityData[3 * n + k] = record[VELOCITY_X + k];
+      accelerationData[3 * n + k] = record[ACCELERATION_X + k];
+      angularRateData[3 * n + k] = record[ANGULAR_RATE_X + k];
+    }
+  }
+
+  // Project all the positions at once, relatively to the first one
+  std::vector<double> eastings(nbRecords), northings(nbRecords);
+  UTMProjector proj;
+  proj.ProjectMany(latData, lonData, eastings.data(), northings.data(), nbRecords);
+  this->SignedUTMZone = proj.SignedUTMZone;
+  this->Offset[0] = eastings[0];
+  this->Offset[1] = northings[0];
+  this->Offset[2] = translationData[2];
+  for (vtkIdType n = 0; n < nbRecords; ++n)
+  {
+    translationData[3 * n + 0] = eastings[n] - this->Offset[0];
+    translationData[3 * n + 1] = northings[n] - this->Offset[1];
+    translationData[3 * n + 2] -= this->Offset[2];
+  }
+
+  auto trajectory = vtkSmartPointer<vtkTemporalTransforms>::New();
+  trajectory->SetTimeArray(time);
+  trajectory->SetOrientationArray(orientation);
+  trajectory->SetTranslationArray(translation);
+  for (vtkDoubleArray* array : { lat.Get(), lon.Get(), roll.Get(), pitch.Get(), heading.Get(),
+                                 velocity.Get(), acceleration.Get(), angularRate.Get() })
+  {
+    trajectory->GetPointData()->AddArray(array);
+  }
+
+  auto *output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
+  output->ShallowCopy(trajectory);
+  return VTK_OK;
+}
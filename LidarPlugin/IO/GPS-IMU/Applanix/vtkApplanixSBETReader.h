@@ -0,0 +1,73 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTKAPPLANIXSBETREADER_H
+#define VTKAPPLANIXSBETREADER_H
+
+#include <vtkPolyDataAlgorithm.h>
+
+/**
+ * @brief Read the binary SBET (Smoothed Best Estimate of Trajectory) files
+ * exported by Applanix PosPac, without converting them to text first.
+ *
+ * A SBET file is a sequence of records of 17 little endian doubles:
+ * time (GPS seconds of week), latitude, longitude (radians), altitude
+ * (meters), velocity (x, y, z), roll, pitch, platform heading, wander angle
+ * (radians), acceleration (x, y, z) and angular rate (x, y, z).
+ *
+ * The output is a pose trajectory (TemporalTransforms): the positions are
+ * projected in the UTM zone of the first record and expressed relatively to
+ * this first record, and the orientations follow the same convention as
+ * vtkApplanixPositionReader: Rz(heading) * Ry(pitch) * Rx(roll), the true
+ * heading being the platform heading minus the wander angle. The other
+ * fields are added as point data arrays.
+ */
+class VTK_EXPORT vtkApplanixSBETReader : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkApplanixSBETReader *New();
+  vtkTypeMacro(vtkApplanixSBETReader, vtkPolyDataAlgorithm)
+
+  vtkGetStringMacro(FileName)
+  vtkSetStringMacro(FileName)
+
+  vtkGetMacro(TimeOffset, double)
+  vtkSetMacro(TimeOffset, double)
+
+  vtkGetMacro(SignedUTMZone, int)
+
+  vtkGetVector3Macro(Offset, double)
+
+protected:
+  vtkApplanixSBETReader();
+  ~vtkApplanixSBETReader();
+
+  int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
+
+  char* FileName = nullptr;
+  double TimeOffset = 0.0; // in seconds, added to the time of the records
+  int SignedUTMZone = 0; // UTM zone used. +N means "UTM zone N North" (South if -N)
+  // (easting, northing, altitude) of the first record, add it to the points
+  // of the trajectory to get UTM coordinates
+  double Offset[3] = { 0.0, 0.0, 0.0 }; // in meters
+
+private:
+  vtkApplanixSBETReader(const vtkApplanixSBETReader&) = delete;
+  void operator=(const vtkApplanixSBETReader&) = delete;
+};
+
+#endif // VTKAPPLANIXSBETREADER_H
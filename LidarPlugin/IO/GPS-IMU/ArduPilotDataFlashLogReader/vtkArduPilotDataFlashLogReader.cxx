@@ -1,15 +1,15 @@
 #include "vtkArduPilotDataFlashLogReader.h"
 
 #include <stdio.h>
+#include <vector>
 
 #include <vtkObjectFactory.h>
 #include <vtkInformationVector.h>
 
-#include <boost/algorithm/string.hpp>
-
 #include <Eigen/Geometry>
 
 #include "GPSProjectionUtils.h"
+#include "MappedTextFile.h"
 
 //-----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkArduPilotDataFlashLogReader)
@@ -25,75 +25,94 @@ vtkArduPilotDataFlashLogReader::vtkArduPilotDataFlashLogReader()
 //-----------------------------------------------------------------------------
 int vtkArduPilotDataFlashLogReader::RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *outputVector)
 {
-  std::ifstream f(this->FileName);
-  if (!f.good())
+  MappedTextFile f;
+  if (!f.Open(this->FileName))
   {
     vtkErrorMacro("Failed to open input file \"" << this->FileName << "\"");
     return VTK_ERROR;
   }
 
+  // GPS2 lines contain fields:
+  // TimeUS,Status,GMS,GWk,NSats,HDop,Lat,Lng,Alt,Spd,GCrs,VZ,U
+  // Useful: https://groups.google.com/forum/#!topic/swiftnav-discuss/XOr7WQto9ZI
+  // quoting from: https://discuss.ardupilot.org/t/correct-gps-time-stamp/14329
+  // "GMS and GWK would be the best way to get the current gps time yes.
+  // the tick with that though is there is latency vs the measurement data.
+  // so correlating that data could be interesting."
+  // GMS = GPS ms since beginning of week
+  // GWk = None # GPS week (a GPS week is 7*24h afaik)
+  // Status: 0 = no GPS, 1 = GPS but no fix, 2 = GPS with 2D fix, 3 = GPS with 3D fix
+  // I beleive "Alt" is altitude over ellipsoid (WGS84, standard for GPS)
+  // but it could be height above geoid.
+  const size_t GMS = 3; // ms since beginning of GPS week
+  const size_t LAT = 7; // latitude in degrees
+  const size_t LNG = 8; // longitude in degrees
+  const size_t ALT = 9; // in meters
+  const size_t numFields = ALT + 1;
+
+  // Parse the lines in parallel, then keep the GPS2 ones in order
+  const size_t numLines = f.GetNumberOfLines();
+  std::vector<char> isGPS(numLines, 0);
+  std::vector<double> values(4 * numLines);
+  f.ParallelForLines(0, numLines, [&](size_t begin, size_t end)
+  {
+    MappedTextFile::Range fields[numFields];
+    for (size_t n = begin; n < end; ++n)
+    {
+      MappedTextFile::Range line = f.GetLine(n);
+      isGPS[n] = line.StartsWith("GPS2")
+              && MappedTextFile::SplitFields(line, ", ", fields, numFields) >= numFields
+              && MappedTextFile::ParseDouble(fields[GMS], values[4 * n])
+              && MappedTextFile::ParseDouble(fields[LAT], values[4 * n + 1])
+              && MappedTextFile::ParseDouble(fields[LNG], values[4 * n + 2])
+              && MappedTextFile::ParseDouble(fields[ALT], values[4 * n + 3]);
+    }
+  });
+
   bool offsetFound = false;
   Eigen::Vector3d offset;
-  std::string line;
-  while (std::getline(f, line))
+  std::vector<double> times, lats, lngs, alts;
+  for (size_t n = 0; n < numLines; ++n)
   {
-    boost::algorithm::trim(line);
-    if (line.empty())
+    if (isGPS[n])
     {
-      continue;
+      times.push_back(values[4 * n] / 1e3);
+      lats.push_back(values[4 * n + 1]);
+      lngs.push_back(values[4 * n + 2]);
+      alts.push_back(values[4 * n + 3]);
     }
+  }
 
-    if (boost::starts_with(line, "GPS2"))
+  // Project all the positions at once, using the same UTM projection
+  std::vector<double> eastings(lats.size()), northings(lats.size());
+  UTMProjector proj;
+  proj.ProjectMany(lats.data(), lngs.data(), eastings.data(), northings.data(), lats.size());
+  std::vector<double> orientations(4 * lats.size(), 0.0), positions(3 * lats.size());
+  for (size_t i = 0; i < lats.size(); ++i)
+  {
+    Eigen::Vector3d  position;
+    position << eastings[i], northings[i], alts[i]; // ENU referential (right hand oriented)
+    if (offsetFound)
     {
-      // GPS2 lines contain fields:
-      // TimeUS,Status,GMS,GWk,NSats,HDop,Lat,Lng,Alt,Spd,GCrs,VZ,U
-      // Useful: https://groups.google.com/forum/#!topic/swiftnav-discuss/XOr7WQto9ZI
-      // quoting from: https://discuss.ardupilot.org/t/correct-gps-time-stamp/14329
-      // "GMS and GWK would be the best way to get the current gps time yes.
-      // the tick with that though is there is latency vs the measurement data.
-      // so correlating that data could be interesting."
-      // GMS = GPS ms since beginning of week
-      // GWk = None # GPS week (a GPS week is 7*24h afaik)
-      // Status: 0 = no GPS, 1 = GPS but no fix, 2 = GPS with 2D fix, 3 = GPS with 3D fix
-
-
-      std::vector<std::string> elements;
-      boost::algorithm::split(
-        elements, line, boost::is_any_of(", "), boost::token_compress_on);
-
-      double GMS = std::stod(elements[3]); // ms since beginning of GPS week
-      double lat = std::stod(elements[7]); // latitude in degrees
-      double lng = std::stod(elements[8]); // longitude in degrees
-      // I beleive "Alt" is altitude over ellipsoid (WGS84, standard for GPS)
-      // but it could be height above geoid.
-      double alt = std::stod(elements[9]); // in meters
-
-      double Time = GMS / 1e3;
-
-      double z = alt;
-      double easting, northing;
-      UTMProjector proj;
-      proj.Project(lat, lng, easting, northing);
-      Eigen::Vector3d  position;
-      position << easting, northing, z; // ENU referential (right hand oriented)
-      if (offsetFound)
-      {
-        position = position - offset;
-      }
-      else
-      {
-        this->SignedUTMZone = proj.SignedUTMZone;
-        offset = position;
-        position = Eigen::Vector3d::Zero();
-        this->Offset[0] = offset[0];
-        this->Offset[1] = offset[1];
-        this->Offset[2] = offset[2];
-        offsetFound = true;
-      }
-
-      GPSTrajectory->PushBack(Time + TimeOffset, Eigen::AngleAxisd(0.0, Eigen::Vector3d::UnitX()), position);
+      position = position - offset;
+    }
+    else
+    {
+      this->SignedUTMZone = proj.SignedUTMZone;
+      offset = position;
+      position = Eigen::Vector3d::Zero();
+      this->Offset[0] = offset[0];
+      this->Offset[1] = offset[1];
+      this->Offset[2] = offset[2];
+      offsetFound = true;
     }
+
+    times[i] += this->TimeOffset;
+    orientations[4 * i] = 1.0; // identity quaternion
+    Eigen::Map<Eigen::Vector3d>(&positions[3 * i]) = position;
   }
+  this->GPSTrajectory->SetPoses(static_cast<vtkIdType>(times.size()), times.data(),
+                                orientations.data(), positions.data());
 
   auto *output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
   output->ShallowCopy(this->GPSTrajectory);
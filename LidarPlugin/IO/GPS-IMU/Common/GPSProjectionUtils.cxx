@@ -1,5 +1,7 @@
 #include "GPSProjectionUtils.h"
 
+#include <algorithm>
+#include <cmath>
 #include <sstream>
 #include <cassert>
 
@@ -58,23 +60,156 @@ void UTMProjector::Project(double lat, double lon, double &easting, double &nort
     this->Init(lat, lon);
   }
 
+  if (!this->ProjectExact(lat, lon, easting, northing) && this->ShouldWarnOnWeirdGPSData)
+  {
+    vtkGenericWarningMacro("Error : WGS84 projection failed, this will create a GPS error. "
+                           "Please check the latitude and longitude inputs");
+  }
+}
+
+//------------------------------------------------------------------------------
+void UTMProjector::ProjectMany(const double* lat, const double* lon,
+                               double* easting, double* northing, std::size_t count)
+{
+  if (count == 0)
+  {
+    return;
+  }
+  if (!this->IsInitialized())
+  {
+    this->Init(lat[0], lon[0]);
+  }
+
+  if (this->ProjectLocally(lat, lon, easting, northing, count))
+  {
+    return;
+  }
+
+  bool failed = false;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    failed |= !this->ProjectExact(lat[i], lon[i], easting[i], northing[i]);
+  }
+  if (failed && this->ShouldWarnOnWeirdGPSData)
+  {
+    vtkGenericWarningMacro("Error : WGS84 projection failed, this will create a GPS error. "
+                           "Please check the latitude and longitude inputs");
+  }
+}
+
+//------------------------------------------------------------------------------
+bool UTMProjector::ProjectExact(double lat, double lon, double& easting, double& northing)
+{
   projUV lp;
   lp.u = DEG_TO_RAD * lon;
   lp.v = DEG_TO_RAD * lat;
 
   projUV xy;
   xy = pj_fwd(lp, pj_utm);
-  if (pj_utm->ctx->last_errno != 0 && this->ShouldWarnOnWeirdGPSData)
-  {
-    vtkGenericWarningMacro("Error : WGS84 projection failed, this will create a GPS error. "
-                           "Please check the latitude and longitude inputs");
-  }
 
   // I checked the correspondence between xy.u/v and  easting, northing
   // against a reliable converter for point: lat=4.613473, longitude=41.080385
   // (easting increases when you go east, northing increases when you go north)
   easting = xy.u;
   northing = xy.v;
+  return pj_utm->ctx->last_errno == 0;
+}
+
+//------------------------------------------------------------------------------
+bool UTMProjector::ProjectLocally(const double* lat, const double* lon,
+                                  double* easting, double* northing, std::size_t count)
+{
+  // below this number of points, the exact projection is as fast as
+  // building and checking the approximation
+  const std::size_t minCount = 64;
+  // extent (degrees) above which the approximation is not even tried
+  const double maxExtent = 0.1;
+  if (!(this->LocalApproximationTolerance > 0.0) || count < minCount)
+  {
+    return false;
+  }
+
+  double minLat = lat[0], maxLat = lat[0], minLon = lon[0], maxLon = lon[0];
+  for (std::size_t i = 1; i < count; ++i)
+  {
+    minLat = std::min(minLat, lat[i]);
+    maxLat = std::max(maxLat, lat[i]);
+    minLon = std::min(minLon, lon[i]);
+    maxLon = std::max(maxLon, lon[i]);
+  }
+  if (!(maxLat - minLat <= maxExtent) || !(maxLon - minLon <= maxExtent))
+  {
+    return false;
+  }
+
+  // sample the projection on a 3x3 grid covering the area, avoiding a null
+  // step for the finite differences
+  const double lat0 = 0.5 * (minLat + maxLat);
+  const double lon0 = 0.5 * (minLon + maxLon);
+  const double hLat = std::max(0.5 * (maxLat - minLat), 1e-6);
+  const double hLon = std::max(0.5 * (maxLon - minLon), 1e-6);
+  double e[3][3], n[3][3];
+  for (int i = 0; i < 3; ++i)
+  {
+    for (int j = 0; j < 3; ++j)
+    {
+      if (!this->ProjectExact(lat0 + (i - 1) * hLat, lon0 + (j - 1) * hLon, e[i][j], n[i][j]))
+      {
+        return false;
+      }
+    }
+  }
+
+  // second order Taylor expansion in the normalized offsets a (latitude) and
+  // b (longitude), which is exact at the center and on the axes of the grid
+  struct Quadric
+  {
+    double c, a, b, aa, bb, ab;
+    double operator()(double x, double y) const
+    {
+      return c + a * x + b * y + aa * x * x + bb * y * y + ab * x * y;
+    }
+  };
+  auto fit = [](const double (&f)[3][3])
+  {
+    Quadric q;
+    q.c = f[1][1];
+    q.a = 0.5 * (f[2][1] - f[0][1]);
+    q.b = 0.5 * (f[1][2] - f[1][0]);
+    q.aa = 0.5 * (f[2][1] + f[0][1]) - f[1][1];
+    q.bb = 0.5 * (f[1][2] + f[1][0]) - f[1][1];
+    q.ab = 0.25 * (f[2][2] - f[2][0] - f[0][2] + f[0][0]);
+    return q;
+  };
+  const Quadric qe = fit(e);
+  const Quadric qn = fit(n);
+
+  // check the error at the corners of the area, which are not samples of
+  // the grid, and half way between the center and the corners
+  for (const double scale : {1.0, 0.5})
+  {
+    for (int corner = 0; corner < 4; ++corner)
+    {
+      const double a = (corner & 1 ? scale : -scale);
+      const double b = (corner & 2 ? scale : -scale);
+      double exactE, exactN;
+      if (!this->ProjectExact(lat0 + a * hLat, lon0 + b * hLon, exactE, exactN) ||
+          !(std::abs(qe(a, b) - exactE) <= this->LocalApproximationTolerance) ||
+          !(std::abs(qn(a, b) - exactN) <= this->LocalApproximationTolerance))
+      {
+        return false;
+      }
+    }
+  }
+
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const double a = (lat[i] - lat0) / hLat;
+    const double b = (lon[i] - lon0) / hLon;
+    easting[i] = qe(a, b);
+    northing[i] = qn(a, b);
+  }
+  return true;
 }
 
 //------------------------------------------------------------------------------
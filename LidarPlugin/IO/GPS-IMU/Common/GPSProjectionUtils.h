@@ -18,6 +18,7 @@
 #ifndef GPSPROJECTIONUTILS_H
 #define GPSPROJECTIONUTILS_H
 
+#include <cstddef>
 #include <string>
 #include <vtk_libproj4.h>
 
@@ -34,14 +35,37 @@ class UTMProjector
 
   void Project(double lat, double lon, double& easting, double& northing);
 
+  /**
+   * @brief Project count lat/lon pairs at once, the UTM zone being the one of
+   * the first point as with Project
+   *
+   * If all the points lie in a small area, the projection is approximated
+   * by its second order Taylor expansion around the center of this area.
+   * The approximation is only used if its error, checked at the corners of
+   * the area, is below LocalApproximationTolerance.
+   */
+  void ProjectMany(const double* lat, const double* lon,
+                   double* easting, double* northing, std::size_t count);
+
   // SignedUTMZone: > 0 means northern hemisphere, < 0 southern
   int SignedUTMZone = 0;
 
+  // Maximal error of the local approximation used by ProjectMany (meters),
+  // 0 to always use the exact projection
+  double LocalApproximationTolerance = 1e-3;
+
   private:
   bool IsInitialized();
 
   void Init(double initial_lat, double initial_lon);
 
+  // Exact projection using the cached context, returns false on error
+  bool ProjectExact(double lat, double lon, double& easting, double& northing);
+
+  // Try to project the points with the local approximation
+  bool ProjectLocally(const double* lat, const double* lon,
+                      double* easting, double* northing, std::size_t count);
+
   bool ShouldWarnOnWeirdGPSData = true;
   projPJ pj_utm = nullptr;
 
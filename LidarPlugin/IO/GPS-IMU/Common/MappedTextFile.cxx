@@ -0,0 +1,182 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "MappedTextFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+
+#include <boost/filesystem.hpp>
+
+namespace
+{
+bool IsSpace(char c)
+{
+  return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+}
+
+//-----------------------------------------------------------------------------
+bool MappedTextFile::Range::StartsWith(const char* prefix) const
+{
+  const std::size_t length = std::strlen(prefix);
+  return this->size() >= length && std::strncmp(this->Begin, prefix, length) == 0;
+}
+
+//-----------------------------------------------------------------------------
+bool MappedTextFile::Open(const std::string& fileName)
+{
+  this->LineStarts.clear();
+  this->Data = nullptr;
+  this->Size = 0;
+  if (this->File.is_open())
+  {
+    this->File.close();
+  }
+
+  // an empty file can not be mapped, but has no line anyway
+  boost::system::error_code error;
+  const boost::uintmax_t fileSize = boost::filesystem::file_size(fileName, error);
+  if (error)
+  {
+    return false;
+  }
+  if (fileSize == 0)
+  {
+    return true;
+  }
+  try
+  {
+    this->File.open(fileName);
+  }
+  catch (const std::exception&)
+  {
+    return false;
+  }
+  if (!this->File.is_open())
+  {
+    return false;
+  }
+  this->Data = this->File.data();
+  this->Size = this->File.size();
+
+  // find the end of lines of each part of the file in parallel
+  const std::size_t minimumPartSize = 1 << 24;
+  const unsigned int nbThreads = this->GetNumberOfThreads((this->Size + minimumPartSize - 1) / minimumPartSize);
+  std::vector<std::vector<std::size_t> > partStarts(nbThreads);
+  Parallel::ForEachPart(this->Size, nbThreads, [&](unsigned int part, std::size_t first, std::size_t last)
+  {
+    const char* end = this->Data + last;
+    for (const char* c = this->Data + first; c < end; ++c)
+    {
+      c = static_cast<const char*>(std::memchr(c, '\n', end - c));
+      if (!c)
+      {
+        break;
+      }
+      partStarts[part].push_back(c + 1 - this->Data);
+    }
+  });
+
+  // the line after the last end of line only exists if it is not empty
+  this->LineStarts.push_back(0);
+  for (const auto& starts : partStarts)
+  {
+    this->LineStarts.insert(this->LineStarts.end(), starts.begin(), starts.end());
+  }
+  if (this->LineStarts.back() == this->Size)
+  {
+    this->LineStarts.pop_back();
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+MappedTextFile::Range MappedTextFile::GetLine(std::size_t index) const
+{
+  Range line;
+  line.Begin = this->Data + this->LineStarts[index];
+  line.End = index + 1 < this->LineStarts.size() ? this->Data + this->LineStarts[index + 1]
+                                                  : this->Data + this->Size;
+  while (line.Begin < line.End && IsSpace(*line.Begin))
+  {
+    ++line.Begin;
+  }
+  while (line.End > line.Begin && IsSpace(*(line.End - 1)))
+  {
+    --line.End;
+  }
+  return line;
+}
+
+//-----------------------------------------------------------------------------
+std::size_t MappedTextFile::SplitFields(const Range& line, const char* delimiters,
+                                        Range* fields, std::size_t maxFields)
+{
+  auto isDelimiter = [delimiters](char c) { return std::strchr(delimiters, c) != nullptr && c != '\0'; };
+  std::size_t nbFields = 0;
+  const char* begin = line.Begin;
+  while (true)
+  {
+    const char* end = begin;
+    while (end < line.End && !isDelimiter(*end))
+    {
+      ++end;
+    }
+    if (nbFields < maxFields)
+    {
+      fields[nbFields].Begin = begin;
+      fields[nbFields].End = end;
+    }
+    ++nbFields;
+    if (end == line.End)
+    {
+      return nbFields;
+    }
+    begin = end;
+    while (begin < line.End && isDelimiter(*begin))
+    {
+      ++begin;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool MappedTextFile::ParseDouble(const Range& field, double& value)
+{
+  // copy the field to get it null terminated, the file is not
+  char buffer[64];
+  if (field.empty() || field.size() >= sizeof(buffer))
+  {
+    return false;
+  }
+  std::memcpy(buffer, field.Begin, field.size());
+  buffer[field.size()] = '\0';
+  char* end = nullptr;
+  value = std::strtod(buffer, &end);
+  return end == buffer + field.size();
+}
+
+//-----------------------------------------------------------------------------
+unsigned int MappedTextFile::GetNumberOfThreads(std::size_t nbChunks) const
+{
+  return static_cast<unsigned int>(
+    std::max<std::size_t>(1, std::min<std::size_t>(Parallel::GetNumberOfThreads(this->NbThreads), nbChunks)));
+}
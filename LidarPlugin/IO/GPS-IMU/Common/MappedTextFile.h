@@ -0,0 +1,115 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef MAPPEDTEXTFILE_H
+#define MAPPEDTEXTFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <vvConfigure.h>
+
+#include "ParallelFor.h"
+
+/**
+ * @brief MappedTextFile maps a text file in memory and indexes its lines, so
+ * that the lines can be parsed in parallel without copying them.
+ *
+ * This is meant for the large text exports of the position readers (SBET,
+ * CSV, logs), which take longer to load line by line with std::getline than
+ * the lidar data they come with.
+ */
+class LidarPlugin_EXPORT MappedTextFile
+{
+public:
+  //! Characters [Begin, End[ of the file
+  struct Range
+  {
+    const char* Begin;
+    const char* End;
+
+    std::size_t size() const { return static_cast<std::size_t>(this->End - this->Begin); }
+    bool empty() const { return this->Begin == this->End; }
+    bool StartsWith(const char* prefix) const;
+    std::string str() const { return std::string(this->Begin, this->End); }
+  };
+
+  MappedTextFile(unsigned int nbThreads = 0) : NbThreads(nbThreads) {}
+
+  /**
+   * @brief Map the file and find its lines
+   * @return false if the file could not be opened
+   */
+  bool Open(const std::string& fileName);
+
+  std::size_t GetNumberOfLines() const { return this->LineStarts.size(); }
+
+  //! Line without its end of line and surrounding whitespaces
+  Range GetLine(std::size_t index) const;
+
+  /**
+   * @brief Call f(begin, end) on chunks of the lines [first, last[
+   * distributed over the threads, the calling thread taking part in the work
+   */
+  template<typename F>
+  void ParallelForLines(std::size_t first, std::size_t last, const F& f) const;
+
+  /**
+   * @brief Split the line on any of the delimiters, consecutive delimiters
+   * counting as one (like boost::split with token_compress_on)
+   *
+   * The first maxFields fields are stored, and the number of fields is
+   * returned even if it is larger than maxFields.
+   */
+  static std::size_t SplitFields(const Range& line, const char* delimiters,
+                                 Range* fields, std::size_t maxFields);
+
+  //! Parse a field which must entirely be a number
+  static bool ParseDouble(const Range& field, double& value);
+
+private:
+  unsigned int GetNumberOfThreads(std::size_t nbChunks) const;
+
+  boost::iostreams::mapped_file_source File;
+  const char* Data = nullptr;
+  std::size_t Size = 0;
+  // offset of the first character of each line
+  std::vector<std::size_t> LineStarts;
+  // number of threads, 0 to use all the cores
+  unsigned int NbThreads;
+};
+
+//-----------------------------------------------------------------------------
+template<typename F>
+void MappedTextFile::ParallelForLines(std::size_t first, std::size_t last, const F& f) const
+{
+  const std::size_t chunkSize = 4096;
+  if (last <= first)
+  {
+    return;
+  }
+  Parallel::ForEachChunk(last - first, chunkSize, this->NbThreads,
+                         [&](unsigned int, std::size_t begin, std::size_t end)
+  {
+    f(first + begin, first + end);
+  });
+}
+
+#endif // MAPPEDTEXTFILE_H
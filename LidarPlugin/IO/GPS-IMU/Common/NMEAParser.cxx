@@ -1,9 +1,9 @@
 #include "NMEAParser.h"
 
+#include <cstdlib>
 #include <cstring>
 #include <cmath>
 #include <sstream>
-#include <stdexcept>
 #include <limits>
 
 #include <vtkMath.h>
@@ -12,33 +12,103 @@
 #define UNUSED(expr) do { (void)(expr); } while (0)
 
 namespace {
+  /* parse a number at the start of the word, like std::stod but without
+   * allocation nor exception */
+  bool ParseDouble(const NMEAWords::Word& word, double& value)
+  {
+    // copy the word to get it null terminated, the sentence may not be
+    char buffer[64];
+    if (word.empty() || word.Size >= sizeof(buffer))
+    {
+      return false;
+    }
+    std::memcpy(buffer, word.Data, word.Size);
+    buffer[word.Size] = '\0';
+    char* end = nullptr;
+    value = std::strtod(buffer, &end);
+    return end != buffer;
+  }
+
+  /* parse the decimal digits of the word, like std::stoul */
+  bool ParseUnsigned(const char* data, std::size_t size, unsigned int& value)
+  {
+    if (size == 0)
+    {
+      return false;
+    }
+    value = 0;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      if (data[i] < '0' || data[i] > '9')
+      {
+        // like std::stoul, ignore what follows the number
+        return i > 0;
+      }
+      value = 10 * value + static_cast<unsigned int>(data[i] - '0');
+    }
+    return true;
+  }
+
+  /* value of a hexadecimal digit, or -1 */
+  int HexDigit(char c)
+  {
+    if (c >= '0' && c <= '9')
+    {
+      return c - '0';
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+      return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+      return c - 'a' + 10;
+    }
+    return -1;
+  }
+
+  /* point the words at the strings, to share the parsing code */
+  bool ViewWords(const std::vector<std::string>& strings, NMEAWords& words)
+  {
+    if (strings.size() > NMEAWords::MaxWords)
+    {
+      return false;
+    }
+    words.Count = static_cast<unsigned int>(strings.size());
+    for (unsigned int i = 0; i < words.Count; ++i)
+    {
+      words.Words[i].Data = strings[i].data();
+      words.Words[i].Size = strings[i].size();
+    }
+    return true;
+  }
+
   /* parse in format HHMMSS.SS (.SS optional) */
-  bool ParseUTCSecondsOfDay(const std::vector<std::string>& w,
+  bool ParseUTCSecondsOfDay(const NMEAWords& w,
                     unsigned int pos,
                     NMEALocation& location)
   {
-    try {
-      double read = std::stod(w[pos]);
-      double integral_part;
-      std::modf(read, &integral_part);
-      double fractional_part = read - integral_part;
-      int HHMMSS = static_cast<int>(vtkMath::Round(integral_part));
-      int SS = HHMMSS % 100;
-      int MM = ((HHMMSS - SS) % 10000) / 100;
-      int HH = (HHMMSS - SS - 100 * MM) / 10000;
-      location.UTCSecondsOfDay =
-          fractional_part
-          + static_cast<double>(SS)
-          + 60.0 * static_cast<double>(MM)
-          + 3600.0 * static_cast<double>(HH);
-    }
-    catch (const std::logic_error&) {
+    double read = 0.0;
+    if (!ParseDouble(w[pos], read))
+    {
       return false;
     }
+    double integral_part;
+    std::modf(read, &integral_part);
+    double fractional_part = read - integral_part;
+    int HHMMSS = static_cast<int>(vtkMath::Round(integral_part));
+    int SS = HHMMSS % 100;
+    int MM = ((HHMMSS - SS) % 10000) / 100;
+    int HH = (HHMMSS - SS - 100 * MM) / 10000;
+    location.UTCSecondsOfDay =
+        fractional_part
+        + static_cast<double>(SS)
+        + 60.0 * static_cast<double>(MM)
+        + 3600.0 * static_cast<double>(HH);
     return true;
   }
 
-  bool ParseFAA(const std::vector<std::string>& w,
+  bool ParseFAA(const NMEAWords& w,
                     unsigned int pos,
                     NMEALocation& location)
   {
@@ -86,7 +156,7 @@ namespace {
     return true;
   }
 
-  bool ParseLatLong(const std::vector<std::string>& w,
+  bool ParseLatLong(const NMEAWords& w,
                     unsigned int uLat,
                     unsigned int latNS,
                     unsigned int uLong,
@@ -97,11 +167,8 @@ namespace {
     // We make the fields ULAT, ULONG, LATNS and LONGEW mandatory
     double latDec = 0.0;
     double lonDec = 0.0;
-    try {
-      latDec = std::stod(w[uLat]);
-      lonDec = std::stod(w[uLong]);
-    }
-    catch (const std::logic_error&) {
+    if (!ParseDouble(w[uLat], latDec) || !ParseDouble(w[uLong], lonDec))
+    {
       return false;
     }
     double latDeg = std::floor(latDec / 100.0);
@@ -165,47 +232,46 @@ void NMEALocation::Init()
 
 
 //------------------------------------------------------------------------------
-bool NMEAParser::ChecksumValid(const std::string& sentence)
+bool NMEAParser::ChecksumValid(const char* sentence, std::size_t length)
 {
-  unsigned int computed = ComputeChecksum(sentence);
-  unsigned int read = ReadChecksum(sentence);
+  unsigned int computed = ComputeChecksum(sentence, length);
+  unsigned int read = ReadChecksum(sentence, length);
   // (checks that we do not have a return corresponding to an error)
   return read == computed && read != std::numeric_limits<unsigned int>::max();
 }
 
 
 //------------------------------------------------------------------------------
-unsigned int NMEAParser::ReadChecksum(const std::string& sentence)
+unsigned int NMEAParser::ReadChecksum(const char* sentence, std::size_t length)
 {
-  if (sentence.size() < 2)
+  // returns a value that does not fit in a byte,
+  // can be used to detect that Checksum is not readable
+  if (length < 2)
   {
-    // returns a value that does not fit in a byte,
-    // can be used to detect that Checksum is not readable
     return std::numeric_limits<unsigned int>::max();
   }
-
-  std::string checksumString = sentence.substr(sentence.size() - 2, 2);
-  unsigned int checksumByte; // does not seem to work with unsigned char
-  std::stringstream ss;
-  ss << std::hex << checksumString;
-  ss >> checksumByte;
-  return checksumByte;
+  const int high = HexDigit(sentence[length - 2]);
+  const int low = HexDigit(sentence[length - 1]);
+  if (high < 0 || low < 0)
+  {
+    return std::numeric_limits<unsigned int>::max();
+  }
+  return static_cast<unsigned int>(16 * high + low);
 }
 
 
 //------------------------------------------------------------------------------
-unsigned int NMEAParser::ComputeChecksum(const std::string& sentence)
+unsigned int NMEAParser::ComputeChecksum(const char* sentence, std::size_t length)
 {
-  const char* str = sentence.c_str();
-  if (strlen(str) < 1 + 1 + 2) /* at least: $, *, checksum */
+  if (length < 1 + 1 + 2) /* at least: $, *, checksum */
   {
     return std::numeric_limits<unsigned int>::max();
   }
 
   unsigned int computed = 0;
-  for (int i = 1; i < static_cast<int>(strlen(str)) - 3; i++)
+  for (std::size_t i = 1; i < length - 3; i++)
   {
-    computed ^= static_cast<unsigned int>(str[i]);
+    computed ^= static_cast<unsigned int>(sentence[i]);
   }
 
   return computed;
@@ -213,7 +279,28 @@ unsigned int NMEAParser::ComputeChecksum(const std::string& sentence)
 
 
 //------------------------------------------------------------------------------
-bool NMEAParser::ParseGPRMC(const std::vector<std::string>& w,
+bool NMEAParser::ChecksumValid(const std::string& sentence)
+{
+  return this->ChecksumValid(sentence.c_str(), std::strlen(sentence.c_str()));
+}
+
+
+//------------------------------------------------------------------------------
+unsigned int NMEAParser::ReadChecksum(const std::string& sentence)
+{
+  return this->ReadChecksum(sentence.c_str(), sentence.size());
+}
+
+
+//------------------------------------------------------------------------------
+unsigned int NMEAParser::ComputeChecksum(const std::string& sentence)
+{
+  return this->ComputeChecksum(sentence.c_str(), std::strlen(sentence.c_str()));
+}
+
+
+//------------------------------------------------------------------------------
+bool NMEAParser::ParseGPRMC(const NMEAWords& w,
                             NMEALocation& location)
 {
   const unsigned int RMC_UTC_TIME = 1;
@@ -268,10 +355,8 @@ bool NMEAParser::ParseGPRMC(const std::vector<std::string>& w,
   if (w[RMC_SPEED] != "")
   {
     location.HasSpeed = true;
-    try {
-      location.Speed = std::stod(w[RMC_SPEED]);
-    }
-    catch (const std::logic_error&) {
+    if (!ParseDouble(w[RMC_SPEED], location.Speed))
+    {
       return false;
     }
   }
@@ -286,10 +371,8 @@ bool NMEAParser::ParseGPRMC(const std::vector<std::string>& w,
   if (w[RMC_ANGLE] != "")
   {
     location.HasTrackAngle = true;
-    try {
-      location.TrackAngle = std::stod(w[RMC_ANGLE]);
-    }
-    catch (const std::logic_error&) {
+    if (!ParseDouble(w[RMC_ANGLE], location.TrackAngle))
+    {
       return false;
     }
   }
@@ -303,22 +386,21 @@ bool NMEAParser::ParseGPRMC(const std::vector<std::string>& w,
   /* Date */
   if (w[RMC_DATE] != "")
   {
-    if (w[RMC_DATE].size() != 6)
+    if (w[RMC_DATE].Size != 6)
     {
       return false;
     }
     location.HasDate = true;
-    try {
-      location.DateDay = static_cast<int>(
-                              std::stoul(w[RMC_DATE].substr(0, 2)));
-      location.DateMonth = static_cast<int>(
-                              std::stoul(w[RMC_DATE].substr(2,2)));
-      location.DateYear = static_cast<int>(
-                              std::stoul(w[RMC_DATE].substr(4,2)));
-    }
-    catch (const std::logic_error&) {
+    unsigned int day, month, year;
+    if (!ParseUnsigned(w[RMC_DATE].Data, 2, day)
+        || !ParseUnsigned(w[RMC_DATE].Data + 2, 2, month)
+        || !ParseUnsigned(w[RMC_DATE].Data + 4, 2, year))
+    {
       return false;
     }
+    location.DateDay = static_cast<int>(day);
+    location.DateMonth = static_cast<int>(month);
+    location.DateYear = static_cast<int>(year);
   }
   else
   {
@@ -342,7 +424,7 @@ bool NMEAParser::ParseGPRMC(const std::vector<std::string>& w,
 
 
 //------------------------------------------------------------------------------
-bool NMEAParser::ParseGPGGA(const std::vector<std::string>& w,
+bool NMEAParser::ParseGPGGA(const NMEAWords& w,
                             NMEALocation& location)
 {
   const unsigned int GGA_UTC_TIME = 1;
@@ -386,44 +468,43 @@ bool NMEAParser::ParseGPGGA(const std::vector<std::string>& w,
   else
   {
     location.HasTypeOfFix = true;
-    try {
-      int quality = static_cast<int>(std::stoul(w[GGA_QUALITY]));
-      switch (quality) {
-        case 0:
-          location.TypeOfFix = NMEALocation::NO_FIX;
-          break;
-        case 1:
-          location.TypeOfFix = NMEALocation::GPS_FIX;
-          break;
-        case 2:
-          location.TypeOfFix = NMEALocation::DIFFERENTIAL_GPS_FIX;
-          break;
-        case 3:
-          location.TypeOfFix = NMEALocation::PPS_FIX;
-          break;
-        case 4:
-          location.TypeOfFix = NMEALocation::RTK_FIX;
-          break;
-        case 5:
-          location.TypeOfFix = NMEALocation::FLOAT_RTK_FIX;
-          break;
-        case 6:
-          location.TypeOfFix = NMEALocation::ESTIMATED_FIX;
-          break;
-        case 7:
-          location.TypeOfFix = NMEALocation::MANUAL_INPUT_FIX;
-          break;
-        case 8:
-          location.TypeOfFix = NMEALocation::SIMULATION_FIX;
-          break;
-        default:
-          location.TypeOfFix = NMEALocation::UNDEFINED_FIX;
-          return false;
-      }
-    }
-    catch (const std::logic_error&) {
+    unsigned int quality = 0;
+    if (!ParseUnsigned(w[GGA_QUALITY].Data, w[GGA_QUALITY].Size, quality))
+    {
       return false;
     }
+    switch (quality) {
+      case 0:
+        location.TypeOfFix = NMEALocation::NO_FIX;
+        break;
+      case 1:
+        location.TypeOfFix = NMEALocation::GPS_FIX;
+        break;
+      case 2:
+        location.TypeOfFix = NMEALocation::DIFFERENTIAL_GPS_FIX;
+        break;
+      case 3:
+        location.TypeOfFix = NMEALocation::PPS_FIX;
+        break;
+      case 4:
+        location.TypeOfFix = NMEALocation::RTK_FIX;
+        break;
+      case 5:
+        location.TypeOfFix = NMEALocation::FLOAT_RTK_FIX;
+        break;
+      case 6:
+        location.TypeOfFix = NMEALocation::ESTIMATED_FIX;
+        break;
+      case 7:
+        location.TypeOfFix = NMEALocation::MANUAL_INPUT_FIX;
+        break;
+      case 8:
+        location.TypeOfFix = NMEALocation::SIMULATION_FIX;
+        break;
+      default:
+        location.TypeOfFix = NMEALocation::UNDEFINED_FIX;
+        return false;
+    }
   }
 
 
@@ -435,10 +516,8 @@ bool NMEAParser::ParseGPGGA(const std::vector<std::string>& w,
   if (w[GGA_HDOP] != "")
   {
     location.HasHorizontalDOP = true;
-    try {
-      location.HorizontalDOP = std::stod(w[GGA_HDOP]);
-    }
-    catch (const std::logic_error&) {
+    if (!ParseDouble(w[GGA_HDOP], location.HorizontalDOP))
+    {
       return false;
     }
   }
@@ -456,10 +535,8 @@ bool NMEAParser::ParseGPGGA(const std::vector<std::string>& w,
     if (w[GGA_ALTUNIT] == "M")
     {
       location.HasAltitude = true;
-      try {
-        location.Altitude = std::stod(w[GGA_ALT]);
-      }
-      catch (const std::logic_error&) {
+      if (!ParseDouble(w[GGA_ALT], location.Altitude))
+      {
         return false;
       }
     }
@@ -482,10 +559,8 @@ bool NMEAParser::ParseGPGGA(const std::vector<std::string>& w,
     if (w[GGA_GEOSEPUNIT] == "M")
     {
       location.HasGeoidalSeparation = true;
-      try {
-        location.GeoidalSeparation = std::stod(w[GGA_GEOSEP]);
-      }
-      catch (const std::logic_error&) {
+      if (!ParseDouble(w[GGA_GEOSEP], location.GeoidalSeparation))
+      {
         return false;
       }
     }
@@ -516,7 +591,7 @@ bool NMEAParser::ParseGPGGA(const std::vector<std::string>& w,
 
 
 //------------------------------------------------------------------------------
-bool NMEAParser::ParseGPGLL(const std::vector<std::string>& w,
+bool NMEAParser::ParseGPGLL(const NMEAWords& w,
                             NMEALocation& location)
 {
   const unsigned int GLL_ULAT = 1;
@@ -573,7 +648,7 @@ bool NMEAParser::ParseGPGLL(const std::vector<std::string>& w,
 
 
 //------------------------------------------------------------------------------
-bool NMEAParser::IsGPRMC(const std::vector<std::string>& w)
+bool NMEAParser::IsGPRMC(const NMEAWords& w)
 {
   const unsigned int NAME = 0;
   return w.size() > 0
@@ -583,7 +658,7 @@ bool NMEAParser::IsGPRMC(const std::vector<std::string>& w)
 
 
 //------------------------------------------------------------------------------
-bool NMEAParser::IsGPGGA(const std::vector<std::string>& w)
+bool NMEAParser::IsGPGGA(const NMEAWords& w)
 {
   const unsigned int NAME = 0;
   return w.size() > 0
@@ -593,7 +668,7 @@ bool NMEAParser::IsGPGGA(const std::vector<std::string>& w)
 
 
 //------------------------------------------------------------------------------
-bool NMEAParser::IsGPGLL(const std::vector<std::string>& w)
+bool NMEAParser::IsGPGLL(const NMEAWords& w)
 {
   const unsigned int NAME = 0;
   return w.size() > 0
@@ -603,19 +678,71 @@ bool NMEAParser::IsGPGLL(const std::vector<std::string>& w)
 
 
 //------------------------------------------------------------------------------
-bool NMEAParser::ParseLocation(const std::string& sentence, NMEALocation& location)
+bool NMEAParser::IsGPRMC(const std::vector<std::string>& w)
+{
+  NMEAWords words;
+  return ViewWords(w, words) && this->IsGPRMC(words);
+}
+
+
+//------------------------------------------------------------------------------
+bool NMEAParser::IsGPGGA(const std::vector<std::string>& w)
+{
+  NMEAWords words;
+  return ViewWords(w, words) && this->IsGPGGA(words);
+}
+
+
+//------------------------------------------------------------------------------
+bool NMEAParser::IsGPGLL(const std::vector<std::string>& w)
+{
+  NMEAWords words;
+  return ViewWords(w, words) && this->IsGPGLL(words);
+}
+
+
+//------------------------------------------------------------------------------
+bool NMEAParser::ParseGPRMC(const std::vector<std::string>& w,
+                            NMEALocation& location)
+{
+  NMEAWords words;
+  return ViewWords(w, words) && this->ParseGPRMC(words, location);
+}
+
+
+//------------------------------------------------------------------------------
+bool NMEAParser::ParseGPGGA(const std::vector<std::string>& w,
+                            NMEALocation& location)
+{
+  NMEAWords words;
+  return ViewWords(w, words) && this->ParseGPGGA(words, location);
+}
+
+
+//------------------------------------------------------------------------------
+bool NMEAParser::ParseGPGLL(const std::vector<std::string>& w,
+                            NMEALocation& location)
+{
+  NMEAWords words;
+  return ViewWords(w, words) && this->ParseGPGLL(words, location);
+}
+
+
+//------------------------------------------------------------------------------
+bool NMEAParser::ParseLocation(const char* sentence, std::size_t length,
+                               NMEALocation& location)
 {
   // reset location. This is important to do because no sentence can fill
   // all NMEALocation fields.
   location.Init();
-  std::vector<std::string> w = SplitWords(sentence);
-  if (w.size() < 1)
+  NMEAWords w;
+  if (!SplitWords(sentence, length, w) || w.size() < 1)
   {
     // the sequence is empty, so it contains no location
     return false;
   }
 
-  if (!ChecksumValid(sentence))
+  if (!ChecksumValid(sentence, length))
   {
     return false;
   }
@@ -644,10 +771,40 @@ bool NMEAParser::ParseLocation(const std::string& sentence, NMEALocation& locati
 }
 
 
+//------------------------------------------------------------------------------
+bool NMEAParser::ParseLocation(const std::string& sentence, NMEALocation& location)
+{
+  return this->ParseLocation(sentence.c_str(), std::strlen(sentence.c_str()), location);
+}
+
+
 //------------------------------------------------------------------------------
 bool NMEAParser::ParseLocation(const char* sentence, NMEALocation& location)
 {
-  return this->ParseLocation(std::string(sentence), location);
+  return this->ParseLocation(sentence, std::strlen(sentence), location);
+}
+
+
+//------------------------------------------------------------------------------
+bool NMEAParser::SplitWords(const char* sentence, std::size_t length, NMEAWords& words)
+{
+  // same words as splitting with std::getline: no word after a trailing comma
+  words.Count = 0;
+  std::size_t start = 0;
+  while (start < length)
+  {
+    if (words.Count == NMEAWords::MaxWords)
+    {
+      return false;
+    }
+    const void* comma = std::memchr(sentence + start, ',', length - start);
+    const std::size_t end = comma ? static_cast<const char*>(comma) - sentence : length;
+    words.Words[words.Count].Data = sentence + start;
+    words.Words[words.Count].Size = end - start;
+    words.Count++;
+    start = end + 1;
+  }
+  return true;
 }
 
 
@@ -1,12 +1,44 @@
 #ifndef NMEAPARSER_H
 #define NMEAPARSER_H
 
+#include <cstddef>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <vvConfigure.h>
 
 struct NMEALocation;
 
+/**
+ * @brief NMEAWords are the comma separated fields of a sentence.
+ *
+ * Each word points inside the sentence, which is neither copied nor
+ * modified, so the sentence must outlive the words. The number of words is
+ * bounded by MaxWords, which is more than any sentence providing a location.
+ */
+struct NMEAWords
+{
+  struct Word
+  {
+    const char* Data;
+    std::size_t Size;
+
+    bool empty() const { return this->Size == 0; }
+    bool operator==(const char* str) const
+    {
+      return std::strncmp(this->Data, str, this->Size) == 0 && str[this->Size] == '\0';
+    }
+    bool operator!=(const char* str) const { return !(*this == str); }
+  };
+
+  static constexpr unsigned int MaxWords = 32;
+  Word Words[MaxWords];
+  unsigned int Count = 0;
+
+  unsigned int size() const { return this->Count; }
+  const Word& operator[](unsigned int index) const { return this->Words[index]; }
+};
+
 /**
  * @brief NMEAParser parses a NMEA 0183 sentence that provides location data
  * (GPRMC, GPGGA or GPGLL sequence).
@@ -17,7 +49,15 @@ struct NMEALocation;
 class LidarPlugin_EXPORT NMEAParser
 {
 public:
+  /**
+   * @brief Split the sentence at the commas, without any allocation
+   * @return false if the sentence has more than NMEAWords::MaxWords words
+   */
+  bool SplitWords(const char* sentence, std::size_t length, NMEAWords& words);
   std::vector<std::string> SplitWords(const std::string& sentence);
+  bool IsGPGLL(const NMEAWords& w);
+  bool IsGPGGA(const NMEAWords& w);
+  bool IsGPRMC(const NMEAWords& w);
   bool IsGPGLL(const std::vector<std::string>& w);
   bool IsGPGGA(const std::vector<std::string>& w);
   bool IsGPRMC(const std::vector<std::string>& w);
@@ -30,11 +70,18 @@ public:
    * (Note that it does not mean that the GPS has a fix and provides valid
    * lat/lon. For that you have to check the member "Valid".) <br>
    * If false is returned, do not use the struct location.
+   *
+   * The overloads taking a std::vector<std::string> are kept for
+   * compatibility, the other ones do not allocate.
    */
   ///@{
+  bool ParseGPRMC(const NMEAWords& w, NMEALocation& location);
+  bool ParseGPGGA(const NMEAWords& w, NMEALocation& location);
+  bool ParseGPGLL(const NMEAWords& w, NMEALocation& location);
   bool ParseGPRMC(const std::vector<std::string>& w, NMEALocation& location);
   bool ParseGPGGA(const std::vector<std::string>& w, NMEALocation& location);
   bool ParseGPGLL(const std::vector<std::string>& w, NMEALocation& location);
+  bool ParseLocation(const char* sentence, std::size_t length, NMEALocation& location);
   bool ParseLocation(const char* sentence, NMEALocation& location);
   bool ParseLocation(const std::string& sentence, NMEALocation& location);
   ///@}
@@ -49,6 +96,9 @@ public:
    *
    * @return Returns true if the sentence has a valid checksum
    */
+  bool ChecksumValid(const char* sentence, std::size_t length);
+  unsigned int ReadChecksum(const char* sentence, std::size_t length);
+  unsigned int ComputeChecksum(const char* sentence, std::size_t length);
   bool ChecksumValid(const std::string& sentence);
   unsigned int ReadChecksum(const std::string& sentence);
   unsigned int ComputeChecksum(const std::string& sentence);
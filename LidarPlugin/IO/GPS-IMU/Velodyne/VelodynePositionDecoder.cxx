@@ -0,0 +1,218 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "VelodynePositionDecoder.h"
+
+// STD
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// VTK
+#include <vtkObject.h>
+#include <vtkSetGet.h>
+
+namespace
+{
+const double GYRO_SCALE = 0.09766;   // deg / s
+const double TEMP_SCALE = 0.1453;    // C
+const double TEMP_OFFSET = 25.0;     // C
+const double ACCEL_SCALE = 0.001221; // G
+
+// Offsets in the payload. The ethernet payload starts at byte 2A, the PPS byte is at F4
+// inside the full ethernet frame, so at F4 - 2A = 202 in the payload
+const unsigned int IMU_OFFSET = 14;
+const unsigned int TIMESTAMP_OFFSET = 14 + 3 * 8 + 160;
+const unsigned int PPS_OFFSET = 202;
+const unsigned int SENTENCE_OFFSET = 14 + 8 + 8 + 8 + 160 + 4 + 4;
+// In the 512 bytes of payload, 512 - (198 + 4 + 1 + 3) = 306 are available for the
+// NMEA sentence, its last bytes should be 0 (NMEA sentences are not that long)
+const unsigned int SENTENCE_SIZE = 306;
+
+//-----------------------------------------------------------------------------
+// Read the 12 least significant bits of a little endian field as a two's complement value
+int Read12Bits(const unsigned char* data)
+{
+  const int value = (data[0] | (data[1] << 8)) & 0x0fff;
+  return value & 0x0800 ? value - 4096 : value;
+}
+}
+
+//-----------------------------------------------------------------------------
+void VelodynePositionDecoder::Reset()
+{
+  this->HasLastLidarTime = false;
+  this->LastLidarTime = 0.0;
+  this->LidarTimeOffset = 0.0;
+  this->HasLastGPSTime = false;
+  this->LastGPSTime = 0.0;
+  this->GPSTimeOffset = 0.0;
+  this->ConvertedGPSTime = 0.0;
+  this->PreviousConvertedGPSTime = -1.0;
+  this->PPSSynced = false;
+  this->LastPPSState = PPS_ABSENT;
+  this->TimeshiftMeasurements.Clear();
+  this->NumberOfInvalidChecksums = 0;
+}
+
+//-----------------------------------------------------------------------------
+VelodynePositionDecoder::Status VelodynePositionDecoder::Decode(
+  const unsigned char* data, unsigned int length, VelodynePositionSample& sample)
+{
+  // Data-Packet Specifications says that position-packets are 512 byte long,
+  // starting with a block of zeros
+  if (length != PacketSize)
+  {
+    return InvalidPacket;
+  }
+  for (unsigned int i = 0; i < IMU_OFFSET; ++i)
+  {
+    if (data[i] != 0)
+    {
+      return InvalidPacket;
+    }
+  }
+
+  // tohTimestamp is a microseconds rolling counter provided by the lidar internal
+  // clock, giving the number of microseconds ellapsed since the top of the hour
+  uint32_t tohTimestamp;
+  std::memcpy(&tohTimestamp, data + TIMESTAMP_OFFSET, 4);
+  if (this->HasLastLidarTime && tohTimestamp - this->LastLidarTime < -1e6 * 0.5 * 3600.0)
+  {
+    // tod wrap detected
+    this->LidarTimeOffset += 1e6 * 3600.0;
+  }
+  this->HasLastLidarTime = true;
+  this->LastLidarTime = tohTimestamp;
+  const double lidarTime = tohTimestamp + this->LidarTimeOffset;
+  const unsigned char ppsState = data[PPS_OFFSET];
+
+  const char* sentence = reinterpret_cast<const char*>(data + SENTENCE_OFFSET);
+  std::size_t sentenceLength = strnlen(sentence, SENTENCE_SIZE - 1);
+  const bool hasSentence = sentenceLength > 0;
+  NMEALocation location;
+  if (hasSentence)
+  {
+    // parse the sentence in place, without the trailing whitespaces
+    while (sentenceLength > 0 && std::isspace(static_cast<unsigned char>(sentence[sentenceLength - 1])))
+    {
+      sentenceLength--;
+    }
+    location.Init();
+    this->Parser.SplitWords(sentence, sentenceLength, this->Words);
+    if (!this->Parser.ChecksumValid(sentence, sentenceLength))
+    {
+      ++this->NumberOfInvalidChecksums;
+      if (this->WarnOnInvalidSentences)
+      {
+        vtkGenericWarningMacro("NMEA sentence: "
+                               << "<" << std::string(sentence, sentenceLength) << ">"
+                               << "has invalid checksum");
+      }
+    }
+
+    const bool isGPGGA = this->Parser.IsGPGGA(this->Words);
+    if (this->UseGPGGASentences != isGPGGA
+        || (!isGPGGA && !this->Parser.IsGPRMC(this->Words)))
+    {
+      return SkippedSentence; // not the NMEA sentence we are interested in
+    }
+    if (!(isGPGGA ? this->Parser.ParseGPGGA(this->Words, location)
+                  : this->Parser.ParseGPRMC(this->Words, location)))
+    {
+      if (this->WarnOnInvalidSentences)
+      {
+        vtkGenericWarningMacro("Failed to parse NMEA sentence: "
+                               << "<" << std::string(sentence, sentenceLength) << ">");
+      }
+      return SkippedSentence;
+    }
+  }
+
+  for (int i = 0; i < 3; ++i)
+  {
+    const unsigned char* imu = data + IMU_OFFSET + i * 8;
+    sample.Gyro[i] = Read12Bits(imu) * GYRO_SCALE;
+    sample.Temperature[i] = Read12Bits(imu + 2) * TEMP_SCALE + TEMP_OFFSET;
+    sample.AccelerationX[i] = Read12Bits(imu + 4) * ACCEL_SCALE;
+    sample.AccelerationY[i] = Read12Bits(imu + 6) * ACCEL_SCALE;
+  }
+  sample.LidarTime = lidarTime;
+  sample.PPSState = ppsState;
+  sample.HasLocation = hasSentence;
+  sample.IsFixValid = hasSentence && location.Valid;
+  sample.Latitude = 0.0;
+  sample.Longitude = 0.0;
+  sample.Altitude = 0.0;
+  sample.Heading = 0.0;
+  if (!hasSentence)
+  {
+    // without GPS the last fix time is kept
+    sample.GPSTime = this->ConvertedGPSTime;
+    return Decoded;
+  }
+
+  // Gathering information on time synchronization between Lidar & GPS. We assume the
+  // Lidar will remain synchronized on gps (UTC) time even if some NMEA packets without
+  // fix are received later (tunnel, hill ...).
+  if (!this->PPSSynced && ppsState == PPS_LOCKED && location.Valid)
+  {
+    this->PPSSynced = true;
+  }
+  this->LastPPSState = static_cast<PPSState>(ppsState);
+
+  sample.Latitude = location.Lat;
+  sample.Longitude = location.Long;
+  // If sentence is GPGGA, we have a chance to get an altitude. The height above the
+  // ellipsoid is coherent with setting 'datum=WGS84' in proj4, without the geoidal
+  // separation the altitude may be above the ellipsoid or above the local MSL.
+  if (this->UseGPGGASentences && location.HasAltitude)
+  {
+    sample.Altitude = location.Altitude + (location.HasGeoidalSeparation ? location.GeoidalSeparation : 0.0);
+  }
+  if (location.HasTrackAngle)
+  {
+    sample.Heading = location.TrackAngle;
+  }
+
+  if (this->HasLastGPSTime && location.UTCSecondsOfDay - this->LastGPSTime < -12.0 * 3600.0)
+  {
+    // tod wrap detected
+    this->GPSTimeOffset += 24.0 * 3600.0;
+  }
+  this->HasLastGPSTime = true;
+  this->LastGPSTime = location.UTCSecondsOfDay;
+  this->ConvertedGPSTime = location.UTCSecondsOfDay + this->GPSTimeOffset;
+  if (this->PreviousConvertedGPSTime < 0.0)
+  {
+    this->PreviousConvertedGPSTime = this->ConvertedGPSTime;
+  }
+  if (this->ConvertedGPSTime > this->PreviousConvertedGPSTime && location.Valid)
+  {
+    // This position packet is the first one since the last fix (there are more position
+    // packets than fixes) and it refers to a valid fix, so the timeshift can be measured.
+    // The "lidar instant" of the fix is earlier than the lidar time of the packet, because
+    // of the time it took the information to go from the GPS to the lidar.
+    this->TimeshiftMeasurements.Insert(
+      this->ConvertedGPSTime - (1e-6 * lidarTime - this->AssumedHardwareLag));
+  }
+  this->PreviousConvertedGPSTime = this->ConvertedGPSTime;
+  sample.GPSTime = this->ConvertedGPSTime;
+  return Decoded;
+}
@@ -0,0 +1,149 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VELODYNEPOSITIONDECODER_H
+#define VELODYNEPOSITIONDECODER_H
+
+#include "NMEAParser.h"
+#include "statistics.h"
+
+#include <cstddef>
+
+/**
+ * @brief VelodynePositionSample values decoded from a Velodyne position packet
+ */
+struct VelodynePositionSample
+{
+  //! Lidar time of the packet in microseconds since the top of the hour, the hour
+  //! rollovers since the first packet being added
+  double LidarTime = 0.0;
+  //! UTC time of the last fix in seconds of day, the day rollovers since the first
+  //! fix being added, 0 before the first fix
+  double GPSTime = 0.0;
+  //! Angular rates in deg/s, temperatures in °C and accelerations in G of the 3 IMU axes
+  double Gyro[3] = { 0.0, 0.0, 0.0 };
+  double Temperature[3] = { 0.0, 0.0, 0.0 };
+  double AccelerationX[3] = { 0.0, 0.0, 0.0 };
+  double AccelerationY[3] = { 0.0, 0.0, 0.0 };
+  //! PPS status byte of the packet, see VelodynePositionDecoder::PPSState
+  unsigned char PPSState = 0;
+  //! Whether the packet holds a NMEA sentence with a location, the location being 0 otherwise
+  bool HasLocation = false;
+  //! Whether the GPS had a valid fix
+  bool IsFixValid = false;
+  //! In degrees
+  double Latitude = 0.0;
+  double Longitude = 0.0;
+  //! Height above the ellipsoid in meters if known, 0 for a GPRMC sentence
+  double Altitude = 0.0;
+  //! Track angle in degrees, 0 if unknown
+  double Heading = 0.0;
+};
+
+/**
+ * @brief VelodynePositionDecoder decodes the position packets of a Velodyne sensor one
+ * at a time, without any allocation: the binary IMU fields and the NMEA sentence, which
+ * is split in place. The time model (rollovers of the lidar and GPS clocks, PPS lock and
+ * timeshift between the lidar and the GPS) is updated with each packet, so that the same
+ * decoder serves a file and a live stream.
+ */
+class VelodynePositionDecoder
+{
+public:
+  //! Size of the payload of a position packet
+  static const unsigned int PacketSize = 512;
+
+  // Warning: PPS_LOCKED does not mean that Lidar is synchronized with GPS:
+  // see documentation "Webserver User Guide (VLP-16 & HDL-32E)".
+  enum PPSState { PPS_ABSENT = 0, PPS_ATTEMPTING_TO_SYNC, PPS_LOCKED, PPS_ERROR };
+
+  enum Status
+  {
+    InvalidPacket = 0,   /*!< not a position packet, nothing is decoded */
+    SkippedSentence = 1, /*!< a NMEA sentence not used or which cannot be parsed */
+    Decoded = 2,         /*!< the sample is filled */
+  };
+
+  //! Use the GPGGA sentences, which give the altitude, instead of the GPRMC ones
+  void SetUseGPGGASentences(bool use) { this->UseGPGGASentences = use; }
+  bool GetUseGPGGASentences() const { return this->UseGPGGASentences; }
+
+  //! Delay between a fix and its position packet, in seconds, see
+  //! vtkVelodyneHDLPositionReader::AssumedHardwareLag
+  void SetAssumedHardwareLag(double lag) { this->AssumedHardwareLag = lag; }
+  double GetAssumedHardwareLag() const { return this->AssumedHardwareLag; }
+
+  //! Warn about the sentences with an invalid checksum or which cannot be parsed
+  void SetWarnOnInvalidSentences(bool warn) { this->WarnOnInvalidSentences = warn; }
+
+  //! Forget the time model, before decoding another sequence of packets
+  void Reset();
+
+  /**
+   * @brief Decode decode a position packet and update the time model
+   * @param data payload of the packet
+   * @param length size of the payload
+   * @param sample[out] values of the packet, only filled if Decoded is returned
+   */
+  Status Decode(const unsigned char* data, unsigned int length, VelodynePositionSample& sample);
+
+  //! Whether the lidar clock has been synchronized on the GPS UTC time
+  bool GetPPSSynced() const { return this->PPSSynced; }
+
+  //! PPS status of the last packet with a parsed sentence
+  PPSState GetLastPPSState() const { return this->LastPPSState; }
+
+  //! Whether the timeshift between the lidar and the GPS could be measured on a new fix
+  bool GetHasTimeshiftEstimation() const { return !this->TimeshiftMeasurements.Empty(); }
+
+  //! Median of the timeshifts measured on each new fix, to add to a lidar time to get the
+  //! GPS UTC time (mod 3600), 0 if none was measured
+  double GetTimeshiftEstimation() const
+  {
+    return this->TimeshiftMeasurements.Empty() ? 0.0 : this->TimeshiftMeasurements.GetMedian();
+  }
+
+  size_t GetNumberOfTimeshiftMeasurements() const { return this->TimeshiftMeasurements.Size(); }
+
+  //! Number of sentences with an invalid checksum since the last reset, they are used anyway
+  size_t GetNumberOfInvalidChecksums() const { return this->NumberOfInvalidChecksums; }
+
+private:
+  bool UseGPGGASentences = false;
+  double AssumedHardwareLag = 0.094;
+  bool WarnOnInvalidSentences = true;
+
+  NMEAParser Parser;
+  NMEAWords Words;
+
+  bool HasLastLidarTime = false;
+  double LastLidarTime = 0.0;
+  double LidarTimeOffset = 0.0;
+  bool HasLastGPSTime = false;
+  double LastGPSTime = 0.0;
+  double GPSTimeOffset = 0.0;
+  double ConvertedGPSTime = 0.0;
+  //! Negative before the first fix
+  double PreviousConvertedGPSTime = -1.0;
+
+  bool PPSSynced = false;
+  PPSState LastPPSState = PPS_ABSENT;
+  SlidingMedian<double> TimeshiftMeasurements;
+  size_t NumberOfInvalidChecksums = 0;
+};
+
+#endif // VELODYNEPOSITIONDECODER_H
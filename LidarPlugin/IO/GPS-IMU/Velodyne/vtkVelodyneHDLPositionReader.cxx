@@ -28,6 +28,7 @@
 
 #include "vtkVelodyneHDLPositionReader.h"
 
+#include "PositionPacketCache.h"
 #include "vtkPacketFileReader.h"
 #include "vtkPacketFileWriter.h"
 #include "vtkCustomTransformInterpolator.h"
@@ -54,8 +55,7 @@
 #include <vtkUnsignedIntArray.h>
 #include <vtkUnsignedShortArray.h>
 
-#include "NMEAParser.h"
-#include "statistics.h"
+#include "VelodynePositionDecoder.h"
 
 #include <boost/foreach.hpp>
 #include <boost/property_tree/ptree.hpp>
@@ -66,8 +66,11 @@
 #include <algorithm>
 #include <map>
 #include <sstream>
+#include <vector>
 
+#include <cctype>
 #include <cmath>
+#include <cstring>
 
 #ifdef _MSC_VER
 #include <boost/cstdint.hpp>
@@ -80,29 +83,78 @@ typedef boost::uint8_t uint8_t;
 
 namespace
 {
-struct PositionPacket
+//! Arrays of the output, in the order they are added to it
+enum PositionColumn
 {
-  // tohTimestamp is a microseconds rolling counter provided by the lidar
-  // internal clock which will be adjusted using the gps data (if one is plugged)
-  // tohTimestamp gives the number of microseconds ellapsed since the top of
-  // the hour. The top of the hour is defined as (modulo 1 hour):
-  // - without a gps plugged: the instant when the lidar was powered on
-  // - with a gps: any full UTC hour (such as 12:00:00 am, UTC)
-  unsigned int tohTimestamp;
-  short gyro[3];
-  short temp[3];
-  short accelx[3];
-  short accely[3];
-  // Usage of field PPS (Pulse Per Second signal) is explained in PDF document
-  // "Webserver User Guide (VLP-16 & HDL-32E)" available at
-  // https://velodynelidar.com/downloads.html#application_notes
-  unsigned char PPSSync;
-  // UDP position packet is 554 bytes long with 42 bytes of header and 512 bytes
-  // of payload. In the payload, 512 - (198 + 4 + 1 + 3) = 306 are available for
-  // the NMEA sequence.
-  // The last bytes stored in the sentence char array should be 0 (NMEA
-  // sentences are not that long).
-  char sentance[306];
+  LAT = 0, LON, GPS_TIME, TIME,
+  ACCEL1X, ACCEL1Y, ACCEL2X, ACCEL2Y, ACCEL3X, ACCEL3Y,
+  GYRO1, GYRO2, GYRO3, HEADING, TEMP1, TEMP2, TEMP3,
+  NUMBER_OF_POSITION_COLUMNS
+};
+const char* const PositionColumnNames[NUMBER_OF_POSITION_COLUMNS] = {
+  "lat", "lon", "gpstime", "time",
+  "accel1x", "accel1y", "accel2x", "accel2y", "accel3x", "accel3y",
+  "gyro1", "gyro2", "gyro3", "heading", "temp1", "temp2", "temp3"
+};
+
+//-----------------------------------------------------------------------------
+// Output arrays written in place, sized once for the expected number of samples
+// and only grown if this number was underestimated
+struct PositionArrays
+{
+  vtkSmartPointer<vtkPoints> Points = vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkDoubleArray> Columns[NUMBER_OF_POSITION_COLUMNS];
+  double* Values[NUMBER_OF_POSITION_COLUMNS];
+  double* Coordinates = nullptr;
+  vtkIdType Capacity = 0;
+  vtkIdType Size = 0;
+
+  PositionArrays()
+  {
+    this->Points->SetDataTypeToDouble();
+    for (int i = 0; i < NUMBER_OF_POSITION_COLUMNS; ++i)
+    {
+      this->Columns[i] = vtkSmartPointer<vtkDoubleArray>::New();
+      this->Columns[i]->SetName(PositionColumnNames[i]);
+    }
+  }
+
+  void Resize(vtkIdType size)
+  {
+    this->Points->SetNumberOfPoints(size);
+    this->Coordinates = static_cast<double*>(this->Points->GetData()->GetVoidPointer(0));
+    for (int i = 0; i < NUMBER_OF_POSITION_COLUMNS; ++i)
+    {
+      this->Columns[i]->SetNumberOfValues(size);
+      this->Values[i] = this->Columns[i]->GetPointer(0);
+    }
+    this->Capacity = size;
+  }
+
+  void Append(const VelodynePositionSample& sample)
+  {
+    if (this->Size == this->Capacity)
+    {
+      this->Resize(std::max(static_cast<vtkIdType>(5000), 2 * this->Capacity));
+    }
+    const vtkIdType i = this->Size++;
+    // the positions are projected at once after reading all the packets
+    this->Coordinates[3 * i] = 0.0;
+    this->Coordinates[3 * i + 1] = 0.0;
+    this->Coordinates[3 * i + 2] = sample.Altitude;
+    this->Values[LAT][i] = sample.Latitude;
+    this->Values[LON][i] = sample.Longitude;
+    this->Values[GPS_TIME][i] = sample.GPSTime;
+    this->Values[TIME][i] = sample.LidarTime;
+    for (int k = 0; k < 3; ++k)
+    {
+      this->Values[ACCEL1X + 2 * k][i] = sample.AccelerationX[k];
+      this->Values[ACCEL1Y + 2 * k][i] = sample.AccelerationY[k];
+      this->Values[GYRO1 + k][i] = sample.Gyro[k];
+      this->Values[TEMP1 + k][i] = sample.Temperature[k];
+    }
+    this->Values[HEADING][i] = sample.Heading;
+  }
 };
 }
 
@@ -119,93 +171,17 @@ public:
     this->CalibrationTransform->Identity();
   }
 
-  int ProcessHDLPacket(const unsigned char* data, unsigned int bytes, PositionPacket& position);
-
   void InterpolateGPS(
     vtkPoints* points, vtkDataArray* gpsTime, vtkDataArray* times, vtkDataArray* heading);
 
   vtkPacketFileReader* Reader;
   double Offset[3];
+  VelodynePositionDecoder Decoder;
 
   vtkNew<vtkCustomTransformInterpolator> Interp;
   vtkNew<vtkTransform> CalibrationTransform;
 };
 
-namespace
-{
-const unsigned short BIT_12_MASK = 0x0fff;
-const unsigned short REMAINDER_12_MASK = 0x07ff;
-const unsigned short SIGN_12_MASK = 0x0800;
-
-const double GYRO_SCALE = 0.09766;   // deg / s
-const double TEMP_SCALE = 0.1453;    // C
-const double TEMP_OFFSET = 25.0;     // C
-const double ACCEL_SCALE = 0.001221; // G
-}
-
-//-----------------------------------------------------------------------------
-int vtkVelodyneHDLPositionReader::vtkInternal::ProcessHDLPacket(
-  const unsigned char* data, unsigned int bytes, PositionPacket& position)
-{
-  if (bytes != 512)
-  {
-    // Data-Packet Specifications says that position-packets are 512 byte long.
-    return 0;
-  }
-
-  for (int i = 0; i < 14; ++i)
-  {
-    if (data[i] != 0)
-    {
-      std::cerr << "unexpected data in first zeros block\n";
-      return 0;
-    }
-  }
-
-  for (int i = 0; i < 3; ++i)
-  {
-    memcpy(position.gyro + i, data + 14 + i * 8, 2);
-    memcpy(position.temp + i, data + 14 + i * 8 + 2, 2);
-    memcpy(position.accelx + i, data + 14 + i * 8 + 4, 2);
-    memcpy(position.accely + i, data + 14 + i * 8 + 6, 2);
-  }
-
-  for (int i = 0; i < 3; ++i)
-  {
-    // Selector only least significant 12 bits
-    position.gyro[i] &= BIT_12_MASK;
-    position.temp[i] &= BIT_12_MASK;
-    position.accelx[i] &= BIT_12_MASK;
-    position.accely[i] &= BIT_12_MASK;
-
-    // Perform 12 bit twos complement
-    position.gyro[i] =
-      -2048 * ((position.gyro[i] & SIGN_12_MASK) >> 11) + (position.gyro[i] & REMAINDER_12_MASK);
-    position.temp[i] =
-      -2048 * ((position.temp[i] & SIGN_12_MASK) >> 11) + (position.temp[i] & REMAINDER_12_MASK);
-    position.accelx[i] = -2048 * ((position.accelx[i] & SIGN_12_MASK) >> 11) +
-      (position.accelx[i] & REMAINDER_12_MASK);
-    position.accely[i] = -2048 * ((position.accely[i] & SIGN_12_MASK) >> 11) +
-      (position.accely[i] & REMAINDER_12_MASK);
-  }
-
-  memcpy(&position.tohTimestamp, data + 14 + 3 * 8 + 160, 4);
-
-  // ethernet payload starts at byte 2A, PPS byte is at F4 inside full ethernet
-  // frame, so PPS in payload is at F4 - 2A = 244 - 42 = 202
-  memcpy(&position.PPSSync, data + 202, 1);
-
-  const int sentence_start =  14 + 8 + 8 + 8 + 160 + 4 + 4;
-  std::copy(data + sentence_start,
-            data + sentence_start + 306,
-            position.sentance);
-  // protection to terminate the string in case the sentence does not fit in the
-  // 306 bytes.
-  position.sentance[305] = '\0';
-
-  return 1;
-}
-
 //-----------------------------------------------------------------------------
 void vtkVelodyneHDLPositionReader::SetShouldWarnOnWeirdGPSData(bool ShouldWarnOnWeirdGPSData_)
 {
@@ -318,7 +294,6 @@ vtkVelodyneHDLPositionReader::vtkVelodyneHDLPositionReader()
   this->PPSSynced = false;
   this->LastPPSState = this->PPSState::PPS_ABSENT;
   this->HasTimeshiftEstimation = false;
-  this->TimeshiftMeasurements.clear();
   this->AssumedHardwareLag = 0.094; // always positive, in seconds
 }
 
@@ -345,7 +320,7 @@ void vtkVelodyneHDLPositionReader::SetFileName(const std::string& filename)
   this->PPSSynced = false;
   this->LastPPSState = this->PPSState::PPS_ABSENT;
   this->HasTimeshiftEstimation = false;
-  this->TimeshiftMeasurements.clear();
+  this->Internal->Decoder.Reset();
   this->FileName = filename;
 
   this->Modified();
@@ -366,289 +341,121 @@ int vtkVelodyneHDLPositionReader::RequestData(vtkInformation* vtkNotUsed(request
   }
 
 
-  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
-  vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
-  vtkSmartPointer<vtkPolyLine> polyLine = vtkSmartPointer<vtkPolyLine>::New();
-  vtkSmartPointer<vtkIdList> polyIds = polyLine->GetPointIds();
-
-  // Data arrays
-  vtkSmartPointer<vtkDoubleArray> lats = vtkSmartPointer<vtkDoubleArray>::New();
-  lats->SetName("lat");
-  vtkSmartPointer<vtkDoubleArray> lons = vtkSmartPointer<vtkDoubleArray>::New();
-  lons->SetName("lon");
-
-  vtkSmartPointer<vtkDoubleArray> times = vtkSmartPointer<vtkDoubleArray>::New();
-  times->SetName("time");
-
-  vtkSmartPointer<vtkDoubleArray> gpsTime = vtkSmartPointer<vtkDoubleArray>::New();
-  gpsTime->SetName("gpstime");
-
-  typedef std::map<std::string, vtkSmartPointer<vtkDoubleArray> > VecMap;
-  VecMap dataVectors;
-  dataVectors.insert(std::make_pair("gyro1", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("gyro2", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("gyro3", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("temp1", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("temp2", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("temp3", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("accel1x", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("accel1y", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("accel2x", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("accel2y", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("accel3x", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("accel3y", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("heading", vtkSmartPointer<vtkDoubleArray>::New()));
-  for (VecMap::iterator it = dataVectors.begin(); it != dataVectors.end(); ++it)
-  {
-    it->second->SetName(it->first.c_str());
-  }
-
-  points->Allocate(5000, 5000);
-  cells->Allocate(5000, 5000);
-  lats->Allocate(5000, 5000);
-  lons->Allocate(5000, 5000);
-  gpsTime->Allocate(5000, 5000);
-
   const unsigned char* data;
   unsigned int dataLength;
   double timeSinceStart;
 
-  UTMProjector proj(this->ShouldWarnOnWeirdGPSData);
-
-  this->Open();
-  vtkIdType pointcount = 0;
-
-  bool hasLastGPSUpdateTime = false;
-  double lastGPSUpdateTime = 0.0;
-  double GPSTimeOffset = 0.0;
-  double convertedGPSUpdateTime = 0.0;
-
-  bool hasLastLidarUpdateTime = false;
-  double lastLidarUpdateTime = 0.0;
-  double lidarTimeOffset = 0.0;
-
-  double previousConvertedGPSUpdateTime = -1.0; // negative means "no previous"
-
-  while (this->Internal->Reader->NextPacket(data, dataLength, timeSinceStart))
+  // Reuse the position packets collected by a lidar reader of the same file
+  // while it built its frame catalog, otherwise read them from the pcap
+  std::shared_ptr<const PositionPacketCache::Packets> cachedPackets =
+    PositionPacketCache::Find(this->FileName);
+  std::size_t nextCachedPacket = 0;
+  if (!cachedPackets)
   {
-    PositionPacket position;
-    if (!this->Internal->ProcessHDLPacket(data, dataLength, position))
-    {
-      continue;
-    }
-
-    if (!hasLastLidarUpdateTime)
-    {
-      hasLastLidarUpdateTime = true;
-      lastLidarUpdateTime = position.tohTimestamp;
-    }
-    else
+    this->Open();
+  }
+  auto nextPacket = [&]()
+  {
+    if (cachedPackets)
     {
-      if (position.tohTimestamp - lastLidarUpdateTime < - 1e6 * 0.5 * 3600.0)
+      if (nextCachedPacket >= cachedPackets->size())
       {
-        // tod wrap detected
-        lidarTimeOffset += 1e6 * 3600.0;
+        return false;
       }
+      data = (*cachedPackets)[nextCachedPacket++];
+      dataLength = PositionPacketCache::PacketSize;
+      return true;
     }
-    double convertedLidarUpdateTime = position.tohTimestamp + lidarTimeOffset;
-
-
-    double x, y, z, lat, lon, heading, gpsUpdateTime;
-    if (std::string(position.sentance).size() == 0)
+    return this->Internal->Reader
+           && this->Internal->Reader->NextPacket(data, dataLength, timeSinceStart);
+  };
+
+  // The packets are decoded in a single pass, the samples being written in place
+  // in the output arrays. The GPS positions are projected at once afterwards.
+  PositionArrays arrays;
+  arrays.Resize(cachedPackets ? static_cast<vtkIdType>(cachedPackets->size()) : 5000);
+  std::vector<vtkIdType> projectedIds;
+  std::vector<double> projectedLats, projectedLons;
+  projectedIds.reserve(arrays.Capacity);
+  projectedLats.reserve(arrays.Capacity);
+  projectedLons.reserve(arrays.Capacity);
+
+  VelodynePositionDecoder& decoder = this->Internal->Decoder;
+  decoder.Reset();
+  decoder.SetUseGPGGASentences(this->UseGPGGASentences);
+  decoder.SetAssumedHardwareLag(this->AssumedHardwareLag);
+  VelodynePositionSample sample;
+  while (nextPacket())
+  {
+    if (decoder.Decode(data, dataLength, sample) != VelodynePositionDecoder::Decoded)
     {
-      // If there is no sentence to parse (no gps connected),
-      // we use the following:
-      x = 0.0;
-      y = 0.0;
-      z = 0.0;
-      lat = 0.0;
-      lon = 0.0;
-      heading = 0.0;
-      // the follwing value is wrong (no gps update so no update time),
-      // so it should also be 0.0 (invalid)
-      // but this value is kept to not risk breaking anything:
-      gpsUpdateTime = position.tohTimestamp;
+      continue;
     }
-    else
+    if (sample.HasLocation)
     {
-      NMEAParser parser;
-      NMEALocation parsedNMEA;
-      parsedNMEA.Init();
-      std::string NMEASentence = std::string(position.sentance);
-      boost::trim_right(NMEASentence);
-      std::vector<std::string> NMEAwords = parser.SplitWords(NMEASentence);
-      if (!parser.ChecksumValid(NMEASentence))
-      {
-        vtkGenericWarningMacro("NMEA sentence: "
-                               << "<" << NMEASentence << ">"
-                               << "has invalid checksum");
-        // TODO: should we skip or should we expect lazy NMEA implementers ?
-      }
-
-      if ((this->UseGPGGASentences && !parser.IsGPGGA(NMEAwords))
-          || (!this->UseGPGGASentences && !parser.IsGPRMC(NMEAwords)))
-      {
-        continue; // not the NMEA sentence we are interested in, skipping
-      }
-
-      if ( !( (parser.IsGPGGA(NMEAwords) && parser.ParseGPGGA(NMEAwords, parsedNMEA))
-           || (parser.IsGPRMC(NMEAwords) && parser.ParseGPRMC(NMEAwords, parsedNMEA)) ))
-      {
-        vtkGenericWarningMacro("Failed to parse NMEA sentence: "
-                               << "<" << NMEASentence << ">");
-        continue; // skipping this PositionPacket
-      }
-
-      // Gathering information on time synchronization between Lidar & GPS,
-      // see Velodyne doc mentioned at definition of PositionPacket above.
-      // We assume the Lidar will remain synchronized on gps (UTC) time even
-      // if some NMEA packets without fix are received later (tunnel, hill ...).
-      if (!this->PPSSynced
-          && position.PPSSync == PPSState::PPS_LOCKED
-          && parsedNMEA.Valid)
-      {
-        this->PPSSynced = true;
-      }
-      this->LastPPSState = static_cast<PPSState>(position.PPSSync);
-
-      lat = parsedNMEA.Lat;
-      lon = parsedNMEA.Long;
-      x = 0.0;
-      y = 0.0;
-      proj.Project(lat, lon, x, y);
-      z = 0.0;
-      // If sentence is GPGGA,  we have a chance to get an altitude
-      if (parser.IsGPGGA(NMEAwords))
-      {
-        if (parsedNMEA.HasAltitude)
-        {
-          if (parsedNMEA.HasGeoidalSeparation)
-          {
-            // setting z to Height above ellipsoid
-            // (coherent with setting 'datum=WGS84' in proj4)
-            z = parsedNMEA.Altitude + parsedNMEA.GeoidalSeparation;
-          }
-          else
-          {
-            // Two possibilities: either Altitude is actually height above
-            // ellipsoid, or it is effectively height above local MSL.
-            // In this case we could need something better than this
-            // (such as a look up table for geoid separation like GeographicLib)
-            z = parsedNMEA.Altitude;
-          }
-        }
-        else
-        {
-          z = 0.0;
-        }
-      }
-
-      if (parsedNMEA.HasTrackAngle)
-      {
-        heading = parsedNMEA.TrackAngle;
-      }
-      else
-      {
-	heading = 0.0;
-      }
-
-      gpsUpdateTime = parsedNMEA.UTCSecondsOfDay;
-      if (!hasLastGPSUpdateTime)
-      {
-        hasLastGPSUpdateTime = true;
-        lastGPSUpdateTime = gpsUpdateTime;
-      }
-      else
-      {
-        if (gpsUpdateTime - lastGPSUpdateTime < - 12.0 * 3600.0)
-        {
-          // tod wrap detected
-          GPSTimeOffset += 24.0 * 3600.0;
-        }
-      }
-
-      convertedGPSUpdateTime = gpsUpdateTime + GPSTimeOffset;
-      if (previousConvertedGPSUpdateTime < 0.0)
-      {
-        previousConvertedGPSUpdateTime = convertedGPSUpdateTime;
-      }
-
-      if (convertedGPSUpdateTime > previousConvertedGPSUpdateTime
-          && parsedNMEA.Valid)
-      {
-        // We have detected that this position packet is the first one since
-        // last gps fix (there are more position packets than there are fixes)
-        // and that the new NMEA sentence refers to a valid fix,
-        // so we can do an estimation of the timeshift.
-        this->HasTimeshiftEstimation = true;
-        // To understand this formula, think that we want to add this timeshift
-        // to a lidar time to get a gps time, and that the "lidar instant" that
-        // corresponds to the new fix is earlier than convertedLidarUpdateTime,
-        // because of the time it took the information to go from GPS to Lidar.
-        // Possible improvement: store the different estimations
-        // (one per new fix) and return the median.
-        this->TimeshiftMeasurements.push_back(
-            convertedGPSUpdateTime -
-            (1e-6 * convertedLidarUpdateTime - this->AssumedHardwareLag));
-      }
-      previousConvertedGPSUpdateTime = convertedGPSUpdateTime;
+      projectedIds.push_back(arrays.Size);
+      projectedLats.push_back(sample.Latitude);
+      projectedLons.push_back(sample.Longitude);
     }
+    arrays.Append(sample);
+  }
+  this->Close();
+  const vtkIdType pointcount = arrays.Size;
+  arrays.Resize(pointcount);
 
-    if (pointcount == 0)
-    {
-      this->Internal->Offset[0] = x;
-      this->Internal->Offset[1] = y;
-    }
+  this->PPSSynced = decoder.GetPPSSynced();
+  this->LastPPSState = static_cast<PPSState>(decoder.GetLastPPSState());
+  this->HasTimeshiftEstimation = decoder.GetHasTimeshiftEstimation();
 
-    x -= this->Internal->Offset[0];
-    y -= this->Internal->Offset[1];
-
-    points->InsertNextPoint(x, y, z);
-    lats->InsertNextValue(lat);
-    lons->InsertNextValue(lon);
-    gpsTime->InsertNextValue(convertedGPSUpdateTime);
-    polyIds->InsertNextId(pointcount);
-
-    times->InsertNextValue(convertedLidarUpdateTime);
-
-    dataVectors["gyro1"]->InsertNextValue(position.gyro[0] * GYRO_SCALE);
-    dataVectors["gyro2"]->InsertNextValue(position.gyro[1] * GYRO_SCALE);
-    dataVectors["gyro3"]->InsertNextValue(position.gyro[2] * GYRO_SCALE);
-    dataVectors["temp1"]->InsertNextValue(position.temp[0] * TEMP_SCALE + TEMP_OFFSET);
-    dataVectors["temp2"]->InsertNextValue(position.temp[1] * TEMP_SCALE + TEMP_OFFSET);
-    dataVectors["temp3"]->InsertNextValue(position.temp[2] * TEMP_SCALE + TEMP_OFFSET);
-    dataVectors["accel1x"]->InsertNextValue(position.accelx[0] * ACCEL_SCALE);
-    dataVectors["accel2x"]->InsertNextValue(position.accelx[1] * ACCEL_SCALE);
-    dataVectors["accel3x"]->InsertNextValue(position.accelx[2] * ACCEL_SCALE);
-    dataVectors["accel1y"]->InsertNextValue(position.accely[0] * ACCEL_SCALE);
-    dataVectors["accel2y"]->InsertNextValue(position.accely[1] * ACCEL_SCALE);
-    dataVectors["accel3y"]->InsertNextValue(position.accely[2] * ACCEL_SCALE);
-    dataVectors["heading"]->InsertNextValue(heading);
-
-    pointcount++;
+  // Project the GPS positions, then use the first point as origin. The
+  // points without GPS position are at (0, 0) before moving the origin.
+  std::vector<double> eastings(projectedIds.size()), northings(projectedIds.size());
+  UTMProjector proj(this->ShouldWarnOnWeirdGPSData);
+  proj.ProjectMany(projectedLats.data(), projectedLons.data(),
+                   eastings.data(), northings.data(), projectedIds.size());
+  if (pointcount > 0)
+  {
+    const bool isFirstProjected = !projectedIds.empty() && projectedIds[0] == 0;
+    this->Internal->Offset[0] = isFirstProjected ? eastings[0] : 0.0;
+    this->Internal->Offset[1] = isFirstProjected ? northings[0] : 0.0;
   }
-  this->Close();
+  double* coordinates = arrays.Coordinates;
+  for (vtkIdType k = 0; k < pointcount; ++k)
+  {
+    coordinates[3 * k] = - this->Internal->Offset[0];
+    coordinates[3 * k + 1] = - this->Internal->Offset[1];
+  }
+  for (size_t k = 0; k < projectedIds.size(); ++k)
+  {
+    coordinates[3 * projectedIds[k]] = eastings[k] - this->Internal->Offset[0];
+    coordinates[3 * projectedIds[k] + 1] = northings[k] - this->Internal->Offset[1];
+  }
+  arrays.Points->Modified();
 
-  cells->InsertNextCell(polyLine);
+  vtkNew<vtkPolyLine> polyLine;
+  vtkIdList* polyIds = polyLine->GetPointIds();
+  polyIds->SetNumberOfIds(pointcount);
+  for (vtkIdType k = 0; k < pointcount; ++k)
+  {
+    polyIds->SetId(k, k);
+  }
+  vtkNew<vtkCellArray> cells;
+  cells->InsertNextCell(polyLine.GetPointer());
 
   // Optionally interpolate the GPS values... note that we assume that the
   // first GPS point is not 0,0 if we have valid GPS data; otherwise we assume
   // that the GPS data is garbage and ignore it
-  if (lats->GetNumberOfTuples() && lons->GetNumberOfTuples() &&
-    (lats->GetValue(0) != 0.0 || lons->GetValue(0) != 0.0))
+  if (pointcount > 0 && (arrays.Values[LAT][0] != 0.0 || arrays.Values[LON][0] != 0.0))
   {
-    this->Internal->InterpolateGPS(points, gpsTime, times, dataVectors["heading"]);
+    this->Internal->InterpolateGPS(arrays.Points, arrays.Columns[GPS_TIME], arrays.Columns[TIME],
+                                   arrays.Columns[HEADING]);
   }
 
-  output->SetPoints(points);
-  output->SetLines(cells);
-  output->GetPointData()->AddArray(lats);
-  output->GetPointData()->AddArray(lons);
-  output->GetPointData()->AddArray(gpsTime);
-  output->GetPointData()->AddArray(times);
-  for (VecMap::iterator it = dataVectors.begin(); it != dataVectors.end(); ++it)
+  output->SetPoints(arrays.Points);
+  output->SetLines(cells.GetPointer());
+  for (int i = 0; i < NUMBER_OF_POSITION_COLUMNS; ++i)
   {
-    output->GetPointData()->AddArray(it->second);
+    output->GetPointData()->AddArray(arrays.Columns[i]);
   }
 
   return 1;
@@ -679,7 +486,10 @@ void vtkVelodyneHDLPositionReader::Open()
 {
   this->Close();
   this->Internal->Reader = new vtkPacketFileReader;
-  if (!this->Internal->Reader->Open(this->FileName))
+  // only the position packets are read, the lidar packets are skipped by the filter
+  UDPPacketSelection selection;
+  selection.PayloadSizes.push_back(PositionPacketCache::PacketSize);
+  if (!this->Internal->Reader->Open(this->FileName, selection))
   {
     vtkErrorMacro("Failed to open packet file: " << this->FileName << '\n'
                                                  << this->Internal->Reader->GetLastError());
@@ -696,13 +506,13 @@ void vtkVelodyneHDLPositionReader::Close()
 
 //-----------------------------------------------------------------------------
 double vtkVelodyneHDLPositionReader::GetTimeshiftEstimation() {
-  if (this->TimeshiftMeasurements.size() == 0)
+  if (!this->Internal->Decoder.GetHasTimeshiftEstimation())
   {
     vtkGenericWarningMacro("Error : timeshift estimation asked"
                            " but no measurement available.")
     return 0.0;
   }
-  return ComputeMedian(this->TimeshiftMeasurements);
+  return this->Internal->Decoder.GetTimeshiftEstimation();
 }
 
 //-----------------------------------------------------------------------------
@@ -100,12 +100,9 @@ private:
   bool PPSSynced;
   PPSState LastPPSState;
   // HasTimeshiftEstimation can be used to tell if the timeshift between GPS UTC time
-  // and Lidar ToH time could becomputed.
+  // and Lidar ToH time could becomputed. Add the timeshift to lidar time ToH time to
+  // get gps time UTC (mod 3600).
   bool HasTimeshiftEstimation;
-  // If HasTimeshiftEstimation is true, all measurements of the timeshift are
-  // available in this vector. Add the timeshift to lidar time ToH time to get
-  // gps time UTC (mod 3600).
-  std::vector<double> TimeshiftMeasurements;
   // AssumedHardwareLag is used to compute TimeshiftEstimation,
   // when there is no PPS sync, but we have some NMEA messages with valid fixes.
   // AssumedHardwareLag is the sum of:
@@ -13,12 +13,41 @@
 // limitations under the License.
 
 #include "LASFileWriter.h"
+#include "ParallelFor.h"
 
 #include <vtkPointData.h>
+#include <vtkPoints.h>
 #include <vtkPolyData.h>
 
+#include <cmath>
+#include <cstring>
+#include <memory>
+
 namespace
 {
+// Offsets of the fields of the LAS 1.2 public header updated once all the points are written
+const std::streamoff NumberOfPointRecordsOffset = 107;
+const std::streamoff MaxXOffset = 179;
+
+// Number of points encoded together by a thread
+const vtkIdType PointBlockSize = 65536;
+
+//-----------------------------------------------------------------------------
+// Rounding used by liblas to quantize the coordinates
+int32_t QuantizeCoordinate(double value, double offset, double scale)
+{
+  const double r = (value - offset) / scale;
+  return static_cast<int32_t>(r > 0.0 ? std::floor(r + 0.5) : std::ceil(r - 0.5));
+}
+
+//-----------------------------------------------------------------------------
+template<typename T>
+void WriteField(char*& record, const T& value)
+{
+  std::memcpy(record, &value, sizeof(T));
+  record += sizeof(T);
+}
+
 
 // positive are north zones, negative are south zones
 int SignedUTMToEPSG(int signedUTM)
@@ -62,6 +91,40 @@ projPJ ProjFromEPSG(int epsg)
   return pj_init_plus(ss.str().c_str());
 }
 
+//-----------------------------------------------------------------------------
+// Convert interleaved coordinates in place, with one call to proj
+void ConvertGcs(double* coordinates, long numberOfPoints, projPJ inProj, projPJ outProj)
+{
+  if (numberOfPoints == 0)
+  {
+    return;
+  }
+  if (pj_is_latlong(inProj))
+  {
+    for (long i = 0; i < numberOfPoints; ++i)
+    {
+      coordinates[3 * i] *= DEG_TO_RAD;
+      coordinates[3 * i + 1] *= DEG_TO_RAD;
+    }
+  }
+
+  int last_errno = pj_transform(inProj, outProj, numberOfPoints, 3,
+                                coordinates, coordinates + 1, coordinates + 2);
+  if (last_errno != 0)
+  {
+    vtkGenericWarningMacro("Error : CRS conversion failed with error: " << last_errno);
+  }
+
+  if (pj_is_latlong(outProj))
+  {
+    for (long i = 0; i < numberOfPoints; ++i)
+    {
+      coordinates[3 * i] *= RAD_TO_DEG;
+      coordinates[3 * i + 1] *= RAD_TO_DEG;
+    }
+  }
+}
+
 //-----------------------------------------------------------------------------
 Eigen::Vector3d ConvertGcs(Eigen::Vector3d p, projPJ inProj, projPJ outProj)
 {
@@ -116,6 +179,13 @@ int LASFileWriter::Open(const char* filename)
     this->MinPt[i] = std::numeric_limits<double>::max();
   }
 
+  this->WrittenPoints = 0;
+  for (int i = 0; i < 3; ++i)
+  {
+    this->WrittenMaxPt[i] = -std::numeric_limits<double>::max();
+    this->WrittenMinPt[i] = std::numeric_limits<double>::max();
+  }
+
   this->Stream.open(filename, std::ios::out | std::ios::trunc | std::ios::binary);
   if (!this->Stream.is_open())
   {
@@ -140,8 +210,11 @@ void LASFileWriter::Close()
 {
   if (this->Writer != nullptr)
   {
+    // liblas writes its own point count when deleted, which ignores the records
+    // not written with liblas
     delete this->Writer;
     this->Writer = nullptr;
+    this->WriteHeaderStatistics();
   }
 
   if (this->Stream.is_open())
@@ -160,6 +233,18 @@ void LASFileWriter::Close()
     pj_free(this->OutProj);
     this->OutProj = nullptr;
   }
+  this->FreeThreadProjections();
+}
+
+//-----------------------------------------------------------------------------
+void LASFileWriter::FreeThreadProjections()
+{
+  for (auto& projections : this->ThreadProjections)
+  {
+    pj_free(projections.first);
+    pj_free(projections.second);
+  }
+  this->ThreadProjections.clear();
 }
 
 //-----------------------------------------------------------------------------
@@ -234,6 +319,9 @@ void LASFileWriter::SetGeoConversionEPSG(int inEPSG, int outEPSG)
 
   this->InProj = ProjFromEPSG(inEPSG);
   this->OutProj = ProjFromEPSG(outEPSG);
+  this->InProjDefinition = "+init=epsg:" + std::to_string(inEPSG) + " ";
+  this->OutProjDefinition = "+init=epsg:" + std::to_string(outEPSG) + " ";
+  this->FreeThreadProjections();
 
   this->OutGcsEPSG = outEPSG;
 }
@@ -255,6 +343,8 @@ void LASFileWriter::SetGeoConversionUTM(int inOutSignedUTMZone, bool useLatLonFo
   utmparamsIn << "+units=m ";
   utmparamsIn << "+no_defs ";
   this->InProj = pj_init_plus(utmparamsIn.str().c_str());
+  this->InProjDefinition = utmparamsIn.str();
+  this->FreeThreadProjections();
   std::cout << "init In : " << utmparamsIn.str() << std::endl;
 
   if (useLatLonForOut)
@@ -265,6 +355,7 @@ void LASFileWriter::SetGeoConversionUTM(int inOutSignedUTMZone, bool useLatLonFo
     utmparamsOut << "+datum=WGS84 ";
     utmparamsOut << "+no_defs ";
     this->OutProj = pj_init_plus(utmparamsOut.str().c_str());
+    this->OutProjDefinition = utmparamsOut.str();
     std::cout << "init Out : " << utmparamsOut.str() << std::endl;
     // 4326 is EPSG ID code for lat-long-alt coordinates
     this->OutGcsEPSG = 4326;
@@ -285,6 +376,7 @@ void LASFileWriter::SetGeoConversionUTM(int inOutSignedUTMZone, bool useLatLonFo
     utmparamsOut << "+datum=WGS84 ";
     utmparamsOut << "+no_defs ";
     this->OutProj = pj_init_plus(utmparamsOut.str().c_str());
+    this->OutProjDefinition = utmparamsOut.str();
     this->OutGcsEPSG = SignedUTMToEPSG(inOutSignedUTMZone);
   }
 
@@ -313,53 +405,301 @@ void LASFileWriter::SetPrecision(double neTol, double hTol)
 }
 
 //-----------------------------------------------------------------------------
-void LASFileWriter::WriteFrame(vtkPolyData* data)
+void LASFileWriter::CreateWriter()
 {
-  if (!this->Writer)
+  this->header.SetCompressed(this->Compressed);
+  try
   {
     this->Writer = new liblas::Writer(this->Stream, this->header);
   }
+  catch (std::runtime_error& e)
+  {
+    if (!this->Compressed)
+    {
+      throw;
+    }
+    vtkGenericWarningMacro("Could not write a LAZ file, writing a LAS file instead: " << e.what());
+    this->Compressed = false;
+    this->header.SetCompressed(false);
+    this->Stream.clear();
+    this->Stream.seekp(0);
+    this->Writer = new liblas::Writer(this->Stream, this->header);
+  }
+}
 
-  vtkPoints* const points = data->GetPoints();
+//-----------------------------------------------------------------------------
+void LASFileWriter::AddWrittenPoint(const double* pos)
+{
+  this->WrittenPoints++;
+  for (int i = 0; i < 3; ++i)
+  {
+    this->WrittenMinPt[i] = std::min(this->WrittenMinPt[i], pos[i]);
+    this->WrittenMaxPt[i] = std::max(this->WrittenMaxPt[i], pos[i]);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void LASFileWriter::WriteHeaderStatistics()
+{
+  const uint32_t numberOfPoints = static_cast<uint32_t>(this->WrittenPoints);
+  // all the points are first returns
+  const uint32_t numberOfPointsByReturn[5] = { numberOfPoints, 0, 0, 0, 0 };
+  double bounds[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+  if (this->WrittenPoints > 0)
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      bounds[2 * i] = this->WrittenMaxPt[i];
+      bounds[2 * i + 1] = this->WrittenMinPt[i];
+    }
+  }
+
+  this->Stream.clear();
+  this->Stream.seekp(NumberOfPointRecordsOffset);
+  this->Stream.write(reinterpret_cast<const char*>(&numberOfPoints), sizeof(numberOfPoints));
+  this->Stream.write(reinterpret_cast<const char*>(numberOfPointsByReturn), sizeof(numberOfPointsByReturn));
+  this->Stream.seekp(MaxXOffset);
+  this->Stream.write(reinterpret_cast<const char*>(bounds), sizeof(bounds));
+  this->Stream.seekp(0, std::ios::end);
+}
+
+//-----------------------------------------------------------------------------
+void LASFileWriter::ProjectPositions(vtkPoints* points, vtkIdType begin, vtkIdType end, int threadIndex)
+{
+  double* positions = this->Positions.data();
+  for (vtkIdType n = begin; n < end; ++n)
+  {
+    points->GetPoint(n, positions + 3 * n);
+    for (int i = 0; i < 3; ++i)
+    {
+      positions[3 * n + i] += this->Origin[i];
+    }
+  }
+
+  if (!this->OutProj)
+  {
+    return;
+  }
+  if (this->IsLocalApproximationValid)
+  {
+    for (vtkIdType n = begin; n < end; ++n)
+    {
+      Eigen::Map<Eigen::Vector3d> pos(positions + 3 * n);
+      pos = this->ApproximationCenterOut + this->ApproximationJacobian * (pos - this->ApproximationCenterIn);
+    }
+    return;
+  }
+
+  projPJ inProj = this->InProj;
+  projPJ outProj = this->OutProj;
+  if (threadIndex > 0)
+  {
+    inProj = this->ThreadProjections[threadIndex - 1].first;
+    outProj = this->ThreadProjections[threadIndex - 1].second;
+  }
+  ConvertGcs(positions + 3 * begin, static_cast<long>(end - begin), inProj, outProj);
+}
+
+//-----------------------------------------------------------------------------
+bool LASFileWriter::ComputeLocalApproximation(const double* bounds)
+{
+  // The conversion is approximated by its secants along each axis of the bounding
+  // box of the frame, around the center of the box
+  Eigen::Vector3d center, halfSize;
+  for (int i = 0; i < 3; ++i)
+  {
+    center[i] = 0.5 * (bounds[2 * i] + bounds[2 * i + 1]) + this->Origin[i];
+    halfSize[i] = std::max(0.5 * (bounds[2 * i + 1] - bounds[2 * i]), 1e-3);
+  }
+  this->ApproximationCenterIn = center;
+  this->ApproximationCenterOut = ConvertGcs(center, this->InProj, this->OutProj);
+  for (int i = 0; i < 3; ++i)
+  {
+    Eigen::Vector3d step = Eigen::Vector3d::Zero();
+    step[i] = halfSize[i];
+    const Eigen::Vector3d after = ConvertGcs(center + step, this->InProj, this->OutProj);
+    const Eigen::Vector3d before = ConvertGcs(center - step, this->InProj, this->OutProj);
+    this->ApproximationJacobian.col(i) = (after - before) / (2.0 * halfSize[i]);
+  }
+
+  // The error, of second order, is checked on the corners, the middles of the edges and
+  // the centers of the faces of the box, where it is the largest
+  const Eigen::Vector3d tolerance(0.5 * this->header.GetScaleX(), 0.5 * this->header.GetScaleY(),
+                                  0.5 * this->header.GetScaleZ());
+  for (int sample = 0; sample < 27; ++sample)
+  {
+    const Eigen::Vector3d direction(sample % 3 - 1.0, (sample / 3) % 3 - 1.0, sample / 9 - 1.0);
+    const Eigen::Vector3d pos = center + direction.cwiseProduct(halfSize);
+    const Eigen::Vector3d exact = ConvertGcs(pos, this->InProj, this->OutProj);
+    const Eigen::Vector3d error = this->ApproximationCenterOut
+      + this->ApproximationJacobian * (pos - center) - exact;
+    if ((error.cwiseAbs().array() > tolerance.array()).any())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void LASFileWriter::EncodeBlock(vtkPolyData* data, vtkIdType begin, vtkIdType end, PointBlock& block)
+{
   vtkDataArray* const intensityData = data->GetPointData()->GetArray("intensity");
   vtkDataArray* const laserIdData = data->GetPointData()->GetArray("laser_id");
   vtkDataArray* const timestampData = data->GetPointData()->GetArray("adjustedtime");
-  vtkDataArray* const colorData = data->GetPointData()->GetArray("camera_color");
+  vtkDataArray* const colorData = this->WriteColor ? data->GetPointData()->GetArray("camera_color") : nullptr;
 
-  const vtkIdType numPoints = points->GetNumberOfPoints();
-  for (vtkIdType n = 0; n < numPoints; ++n)
+  const liblas::Header& header = this->Writer->GetHeader();
+  const size_t recordLength = header.GetDataRecordLength();
+  block.Records.assign((end - begin) * recordLength, 0);
+  block.NumberOfPoints = 0;
+  for (int i = 0; i < 3; ++i)
+  {
+    block.MaxPt[i] = -std::numeric_limits<double>::max();
+    block.MinPt[i] = std::numeric_limits<double>::max();
+  }
+
+  // Point data record format 1, followed by the color for the format 3
+  for (vtkIdType n = begin; n < end; ++n)
   {
     const double time = timestampData == nullptr ? 0.0 : timestampData->GetComponent(n, 0) * 1e-6;
     // This test implements the time-clamping feature
-    if (time >= this->MinTime && time <= this->MaxTime)
+    if (time < this->MinTime || time > this->MaxTime)
     {
-      Eigen::Vector3d pos;
-      points->GetPoint(n, pos.data());
-      pos += this->Origin;
+      continue;
+    }
 
-      if (this->OutProj)
+    const double* pos = &this->Positions[3 * n];
+    char* record = block.Records.data() + block.NumberOfPoints * recordLength;
+    WriteField(record, QuantizeCoordinate(pos[0], header.GetOffsetX(), header.GetScaleX()));
+    WriteField(record, QuantizeCoordinate(pos[1], header.GetOffsetY(), header.GetScaleY()));
+    WriteField(record, QuantizeCoordinate(pos[2], header.GetOffsetZ(), header.GetScaleZ()));
+    WriteField(record, static_cast<uint16_t>(intensityData == nullptr ? 0.0 : intensityData->GetComponent(n, 0)));
+    // return number = 1, number of returns = 1
+    WriteField(record, static_cast<uint8_t>(1 | (1 << 3)));
+    WriteField(record, static_cast<uint8_t>(0)); // classification
+    WriteField(record, static_cast<int8_t>(0)); // scan angle rank
+    WriteField(record, static_cast<uint8_t>(laserIdData == nullptr ? 0.0 : laserIdData->GetComponent(n, 0)));
+    WriteField(record, static_cast<uint16_t>(0)); // point source ID
+    WriteField(record, time);
+    if (header.GetDataFormatId() == liblas::ePointFormat3 && colorData != nullptr)
+    {
+      for (int i = 0; i < 3; ++i)
       {
-        pos = ConvertGcs(pos, this->InProj, this->OutProj);
+        WriteField(record, static_cast<uint16_t>(colorData->GetComponent(n, i)));
       }
+    }
+
+    block.NumberOfPoints++;
+    for (int i = 0; i < 3; ++i)
+    {
+      block.MinPt[i] = std::min(block.MinPt[i], pos[i]);
+      block.MaxPt[i] = std::max(block.MaxPt[i], pos[i]);
+    }
+  }
+}
 
-      liblas::Point p(&this->Writer->GetHeader());
-      p.SetCoordinates(pos[0], pos[1], pos[2]);
-      p.SetIntensity(static_cast<uint16_t>(intensityData == nullptr ? 0.0 : intensityData->GetComponent(n, 0)));
-      p.SetReturnNumber(1);
-      p.SetNumberOfReturns(1);
-      p.SetUserData(static_cast<uint8_t>(laserIdData == nullptr ? 0.0 : laserIdData->GetComponent(n, 0)));
-      if (this->WriteColor && colorData != nullptr)
+//-----------------------------------------------------------------------------
+void LASFileWriter::WriteFrame(vtkPolyData* data)
+{
+  if (!this->Writer)
+  {
+    this->CreateWriter();
+  }
+
+  vtkPoints* const points = data->GetPoints();
+  const vtkIdType numPoints = points->GetNumberOfPoints();
+
+  // Positions in the output coordinates
+  this->Positions.resize(3 * numPoints);
+  this->IsLocalApproximationValid = this->UseLocalApproximation && this->OutProj
+    && numPoints > 0 && this->ComputeLocalApproximation(points->GetBounds());
+
+  if (this->Compressed)
+  {
+    this->ProjectPositions(points, 0, numPoints, 0);
+    // laszip encodes the points one by one
+    vtkDataArray* const intensityData = data->GetPointData()->GetArray("intensity");
+    vtkDataArray* const laserIdData = data->GetPointData()->GetArray("laser_id");
+    vtkDataArray* const timestampData = data->GetPointData()->GetArray("adjustedtime");
+    vtkDataArray* const colorData = data->GetPointData()->GetArray("camera_color");
+    for (vtkIdType n = 0; n < numPoints; ++n)
+    {
+      const double time = timestampData == nullptr ? 0.0 : timestampData->GetComponent(n, 0) * 1e-6;
+      // This test implements the time-clamping feature
+      if (time >= this->MinTime && time <= this->MaxTime)
       {
-        liblas::Color color = liblas::Color(
-              static_cast<uint32_t>(colorData->GetComponent(n, 0)),
-              static_cast<uint32_t>(colorData->GetComponent(n, 1)),
-              static_cast<uint32_t>(colorData->GetComponent(n, 2))
-              );
-        p.SetColor(color);
+        const double* pos = &this->Positions[3 * n];
+        liblas::Point p(&this->Writer->GetHeader());
+        p.SetCoordinates(pos[0], pos[1], pos[2]);
+        p.SetIntensity(static_cast<uint16_t>(intensityData == nullptr ? 0.0 : intensityData->GetComponent(n, 0)));
+        p.SetReturnNumber(1);
+        p.SetNumberOfReturns(1);
+        p.SetUserData(static_cast<uint8_t>(laserIdData == nullptr ? 0.0 : laserIdData->GetComponent(n, 0)));
+        if (this->WriteColor && colorData != nullptr)
+        {
+          liblas::Color color = liblas::Color(
+                static_cast<uint32_t>(colorData->GetComponent(n, 0)),
+                static_cast<uint32_t>(colorData->GetComponent(n, 1)),
+                static_cast<uint32_t>(colorData->GetComponent(n, 2))
+                );
+          p.SetColor(color);
+        }
+        p.SetTime(time);
+
+        this->Writer->WritePoint(p);
+        this->AddWrittenPoint(pos);
       }
-      p.SetTime(time);
+    }
+    return;
+  }
+
+  // The points are encoded by blocks, the blocks being shared between the threads
+  const size_t numberOfBlocks = static_cast<size_t>((numPoints + PointBlockSize - 1) / PointBlockSize);
+  this->Blocks.resize(std::max(numberOfBlocks, this->Blocks.size()));
+  unsigned int numberOfThreads = static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(
+    Parallel::GetNumberOfThreads(static_cast<unsigned int>(std::max(0, this->NumberOfThreads))),
+    numberOfBlocks)));
+
+  // each thread but the calling one gets its own copy of the projections
+  while (this->OutProj && this->ThreadProjections.size() + 1 < numberOfThreads)
+  {
+    projPJ inProj = pj_init_plus(this->InProjDefinition.c_str());
+    projPJ outProj = pj_init_plus(this->OutProjDefinition.c_str());
+    if (!inProj || !outProj)
+    {
+      pj_free(inProj);
+      pj_free(outProj);
+      break;
+    }
+    this->ThreadProjections.emplace_back(inProj, outProj);
+  }
+  if (this->OutProj)
+  {
+    numberOfThreads = std::min(numberOfThreads, static_cast<unsigned int>(this->ThreadProjections.size()) + 1);
+  }
 
-      this->Writer->WritePoint(p);
+  Parallel::ForEachChunk(numPoints, PointBlockSize, numberOfThreads,
+                         [this, data, points](unsigned int thread, size_t begin, size_t end)
+  {
+    this->ProjectPositions(points, begin, end, thread);
+    this->EncodeBlock(data, begin, end, this->Blocks[begin / PointBlockSize]);
+  });
+
+  // Then written in order, in one call per block
+  const size_t recordLength = this->Writer->GetHeader().GetDataRecordLength();
+  for (size_t b = 0; b < numberOfBlocks; ++b)
+  {
+    const PointBlock& block = this->Blocks[b];
+    this->Stream.write(block.Records.data(), block.NumberOfPoints * recordLength);
+    if (block.NumberOfPoints > 0)
+    {
+      this->WrittenPoints += block.NumberOfPoints;
+      for (int i = 0; i < 3; ++i)
+      {
+        this->WrittenMinPt[i] = std::min(this->WrittenMinPt[i], block.MinPt[i]);
+        this->WrittenMaxPt[i] = std::max(this->WrittenMaxPt[i], block.MaxPt[i]);
+      }
     }
   }
 }
@@ -432,3 +772,18 @@ void LASFileWriter::SetWriteColor(bool shouldWrite)
 {
   this->WriteColor = shouldWrite;
 }
+
+void LASFileWriter::SetCompressed(bool compressed)
+{
+  this->Compressed = compressed;
+}
+
+void LASFileWriter::SetNumberOfThreads(int numberOfThreads)
+{
+  this->NumberOfThreads = numberOfThreads;
+}
+
+void LASFileWriter::SetUseLocalApproximation(bool useApproximation)
+{
+  this->UseLocalApproximation = useApproximation;
+}
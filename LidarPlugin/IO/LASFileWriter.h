@@ -39,6 +39,11 @@
 
 #include <Eigen/Dense>
 
+#include <string>
+#include <utility>
+#include <vector>
+
+class vtkPoints;
 class vtkPolyData;
 
 class VTK_EXPORT LASFileWriter
@@ -78,11 +83,24 @@ public:
   void SetWriteSRS(bool shouldWrite);
   void SetWriteColor(bool shouldWrite);
 
+  // Write a LAZ file. Requires liblas to be built with laszip, else a LAS file
+  // is written. Must be called before the first call to WriteFrame()
+  void SetCompressed(bool compressed);
+
+  // Number of threads projecting and encoding the point records, 0 to use all the cores
+  void SetNumberOfThreads(int numberOfThreads);
+
+  // If set, the geo conversion of the points of a frame is replaced by its first
+  // order approximation around the center of the frame, when the error of the
+  // approximation is below half of the precision set with SetPrecision()
+  void SetUseLocalApproximation(bool useApproximation);
+
   // Sets the metadata into the LAS header
   void FlushMetaData();
 
-  // UpdateMetaData() and FlushMetaData() must have been called before the
-  // first call to WriteFrame()
+  // The number of points and the bounding box of the points actually written
+  // are set in the header by Close(), so UpdateMetaData() and FlushMetaData()
+  // are not required: the frames can be written in a single pass.
   // Will use arrays:
   // - intensity
   // - laser_id (has user data field)
@@ -95,6 +113,38 @@ public:
   void WriteFrame(vtkPolyData* data);
 
 private:
+  // A block of consecutive points of a frame, encoded as LAS point records
+  struct PointBlock
+  {
+    std::vector<char> Records;
+    size_t NumberOfPoints;
+    double MinPt[3];
+    double MaxPt[3];
+  };
+
+  // Create the liblas writer, which writes the header
+  void CreateWriter();
+
+  // Compute the positions [begin, end) of a frame in the output coordinates,
+  // with the projections of the thread
+  void ProjectPositions(vtkPoints* points, vtkIdType begin, vtkIdType end, int threadIndex);
+
+  // Compute the approximation of the geo conversion for a frame,
+  // return false if it is not precise enough
+  bool ComputeLocalApproximation(const double* bounds);
+
+  // Free the projections of the threads
+  void FreeThreadProjections();
+
+  // Encode the points [begin, end) of a frame in a block
+  void EncodeBlock(vtkPolyData* data, vtkIdType begin, vtkIdType end, PointBlock& block);
+
+  // Update the statistics of the points written
+  void AddWrittenPoint(const double* pos);
+
+  // Write the number of points and the bounding box in the header of the file
+  void WriteHeaderStatistics();
+
   std::ofstream Stream;
   liblas::Writer* Writer;
 
@@ -113,10 +163,38 @@ private:
   int OutGcsEPSG; // used to tell in the LAS header which projection is used
   // Obviously, OutGcsEPSG should be coherent with OutProj
 
+  // Definitions of InProj and OutProj, used to create a copy of them for each
+  // thread as a projection can not be used by several threads at the same time
+  std::string InProjDefinition;
+  std::string OutProjDefinition;
+  // Projections used by the threads other than the calling one
+  std::vector<std::pair<projPJ, projPJ> > ThreadProjections;
+
+  // Affine approximation of the geo conversion around the center of the frame
+  bool UseLocalApproximation = false;
+  bool IsLocalApproximationValid = false;
+  Eigen::Vector3d ApproximationCenterIn;
+  Eigen::Vector3d ApproximationCenterOut;
+  Eigen::Matrix3d ApproximationJacobian;
+
   // If WriteColor is set to False, the point format liblas::ePointFormat1 is used,
   // else liblas::ePointFormat3 is used.
   bool WriteColor = false;
 
+  // If Compressed is set, the points are encoded by liblas (with laszip), else
+  // they are encoded as LAS point records by blocks, in parallel.
+  bool Compressed = false;
+  int NumberOfThreads = 0;
+
+  // Positions of the points of the frame being written, in the output coordinates
+  std::vector<double> Positions;
+  std::vector<PointBlock> Blocks;
+
+  // Number of points and bounding box of the points actually written
+  size_t WrittenPoints = 0;
+  double WrittenMinPt[3];
+  double WrittenMaxPt[3];
+
   // Setting WriteSRS to false can be used to simulate the absence of GDAL
   // library (in which case setting SRS fails), or to use the default
   // interpretation of the software that will use the LAS file.
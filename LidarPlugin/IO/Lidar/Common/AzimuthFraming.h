@@ -0,0 +1,180 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef AZIMUTHFRAMING_H
+#define AZIMUTHFRAMING_H
+
+#include <vtkObject.h>
+
+#include <cmath>
+#include <limits>
+
+/**
+ * Frame split and rotation speed of the spinning sensors, computed from the azimuths
+ * of their firings in hundredths of degree, shared by the packet interpreters.
+ */
+
+//-----------------------------------------------------------------------------
+// Structure to compute RPM and handle degenerated cases
+struct RPMCalculator
+{
+  // Determines if the rpm computation is available
+  bool IsReady;
+  // Determines if the corresponding value has been set
+  bool ValueReady[4];
+  int MinAngle;
+  int MaxAngle;
+  unsigned int MinTime;
+  unsigned int MaxTime;
+
+  void Reset()
+  {
+    this->IsReady = false;
+    this->ValueReady[0] = false;
+    this->ValueReady[1] = false;
+    this->ValueReady[2] = false;
+    this->ValueReady[3] = false;
+    this->MinAngle = std::numeric_limits<int>::max();
+    this->MaxAngle = std::numeric_limits<int>::min();
+    this->MinTime = std::numeric_limits<unsigned int>::max();
+    this->MaxTime = std::numeric_limits<unsigned int>::min();
+  }
+
+  double GetRPM()
+  {
+    // If the calculator is not ready i.e : one
+    // of the attributes is not initialized yet
+    // (MaxAngle, MinAngle, MaxTime, MinTime)
+    if (!this->IsReady)
+    {
+      return 0;
+    }
+
+    // delta angle in number of laps
+    double dAngle = static_cast<double>(this->MaxAngle - this->MinAngle) / (100.0 * 360.0);
+
+    // delta time in minutes
+    double dTime = static_cast<double>(this->MaxTime - this->MinTime) / (60e6);
+
+    // epsilon to test if the delta time / angle is not too small
+    const double epsilon = 1e-12;
+
+    // if one the deltas is too small
+    if ((std::abs(dTime) < epsilon) || (std::abs(dAngle) < epsilon))
+    {
+      return 0;
+    }
+
+    return dAngle / dTime;
+  }
+
+  // azimuth in hundredths of degree, rawtime in microseconds
+  void AddData(int azimuth, unsigned int rawtime)
+  {
+    if (azimuth < this->MinAngle)
+    {
+      this->MinAngle = azimuth;
+      this->ValueReady[0] = true;
+    }
+    if (azimuth > this->MaxAngle)
+    {
+      this->MaxAngle = azimuth;
+      this->ValueReady[1] = true;
+    }
+    if (rawtime < this->MinTime)
+    {
+      this->MinTime = rawtime;
+      this->ValueReady[2] = true;
+    }
+    if (rawtime > this->MaxTime)
+    {
+      this->MaxTime = rawtime;
+      this->ValueReady[3] = true;
+    }
+
+    // Check if all of the 4th parameters
+    // have been set
+    this->IsReady = true;
+    for (int k = 0; k < 4; ++k)
+    {
+      this->IsReady &= this->ValueReady[k];
+    }
+  }
+};
+
+//-----------------------------------------------------------------------------
+// Detect the new rotations of the sensor, when the direction of the azimuth changes
+class FramingState
+{
+  int LastAzimuth;
+  int LastAzimuthSlope;
+
+public:
+  FramingState() { reset(); }
+  void reset()
+  {
+    LastAzimuth = -1;
+    LastAzimuthSlope = 0;
+  }
+  bool hasChangedWithValue(int azimuth)
+  {
+    bool hasLastAzimuth = (LastAzimuth != -1);
+    bool azimuthFrameSplit = hasChangedWithValue(
+      azimuth, hasLastAzimuth, LastAzimuth, LastAzimuthSlope);
+    return azimuthFrameSplit;
+  }
+
+  static bool hasChangedWithValue(int curValue, bool& hasLastValue, int& lastValue, int& lastSlope)
+  {
+    // If we dont have previous value, dont change
+    if (!hasLastValue)
+    {
+      lastValue = curValue;
+      hasLastValue = true;
+      return false;
+    }
+    int curSlope = curValue - lastValue;
+    lastValue = curValue;
+    if (curSlope == 0)
+      return false;
+    int isSlopeSameDirection = curSlope * lastSlope;
+    // curSlope has same sign as lastSlope: no change
+    if (isSlopeSameDirection > 0)
+      return false;
+    // curSlope has different sign as lastSlope: change!
+    else if (isSlopeSameDirection < 0)
+    {
+      lastSlope = 0;
+      return true;
+    }
+    // LastAzimuthSlope not set: set the slope
+    if (lastSlope == 0 && curSlope != 0)
+    {
+      lastSlope = curSlope;
+      return false;
+    }
+    vtkGenericWarningMacro("Unhandled sequence of value in state.");
+    return false;
+  }
+
+  static bool willChangeWithValue(int curValue, bool hasLastValue, int lastValue, int lastSlope)
+  {
+    return hasChangedWithValue(curValue, hasLastValue, lastValue, lastSlope);
+  }
+};
+
+#endif // AZIMUTHFRAMING_H
@@ -17,77 +17,320 @@
 
 // LOCAL
 #include "CrashAnalysing.h"
+#include "NetworkPacket.h"
 
 // STD
+#include <algorithm>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
 #include <ctime>
+#include <fcntl.h>
 #include <fstream>
-#include <sstream>
+#include <mutex>
 #include <stdio.h>
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
 
 // VTK
 #include <vtkInformation.h>
 
+namespace
+{
+// pcap file format, in the byte order of the host as expected by the pcap readers
+struct PcapFileHeader
+{
+  uint32_t Magic = 0xa1b2c3d4;
+  uint16_t VersionMajor = 2;
+  uint16_t VersionMinor = 4;
+  int32_t TimeZone = 0;
+  uint32_t TimestampAccuracy = 0;
+  uint32_t SnapshotLength = 65535;
+  uint32_t LinkType = 1; // Ethernet
+};
+
+struct PcapRecordHeader
+{
+  uint32_t TimeSeconds;
+  uint32_t TimeMicroseconds;
+  uint32_t CapturedLength;
+  uint32_t OriginalLength;
+};
+
+const size_t RecordHeaderSize = sizeof(PcapRecordHeader) + NetworkPacket::EthIP4UDPHeaderSize;
+
+// Writers whose packets are saved by the signal handler
+const int MaximumNumberOfRegisteredWriters = 16;
+std::atomic<CrashAnalysisWriter*> RegisteredWriters[MaximumNumberOfRegisteredWriters];
+std::atomic_flag IsSavingCrashLogs = ATOMIC_FLAG_INIT;
+
+const int FatalSignals[] = { SIGSEGV, SIGABRT, SIGFPE, SIGILL };
+const int NumberOfFatalSignals = sizeof(FatalSignals) / sizeof(FatalSignals[0]);
+typedef void (*SignalHandler)(int);
+SignalHandler PreviousSignalHandlers[NumberOfFatalSignals];
+std::once_flag SignalHandlersInstalled;
+
+//-----------------------------------------------------------------------------
+// open, write and close are async signal safe, unlike the C and C++ streams
+int OpenLogFile(const char* filename)
+{
+#ifdef _WIN32
+  return _open(filename, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+  return open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+}
+
 //-----------------------------------------------------------------------------
-void CrashAnalysisWriter::AddPacket(const NetworkPacket& packet)
+void CloseLogFile(int fileDescriptor)
 {
-  // The idea is to store 2 .pcap files. One corresponding
-  // to the last N packets received and one corresponding to
-  // the N older ones. Switching from one file to the other
-  // insure that we always have at least the N last packets
-  // (except for the very beginning).
-  // When switching to file 0 or 1, the existing content of the
-  // file is discarded resulting in a storage of a number of packets
-  // between N and 2*N
-  if (this->PacketCount % this->NbrPacketsToStore == 0)
+#ifdef _WIN32
+  _close(fileDescriptor);
+#else
+  close(fileDescriptor);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+bool WriteAll(int fileDescriptor, const unsigned char* data, size_t size)
+{
+  while (size > 0)
   {
-    // Close the writer if it is already opened
-    if (this->Writer.IsOpen())
+#ifdef _WIN32
+    const int written = _write(fileDescriptor, data, static_cast<unsigned int>(size));
+#else
+    const ssize_t written = write(fileDescriptor, data, size);
+#endif
+    if (written <= 0)
     {
-      this->Writer.Close();
+      return false;
     }
+    data += written;
+    size -= static_cast<size_t>(written);
+  }
+  return true;
+}
 
-    // Switch the filename and open the writer
-    this->FileToStore++;
-    unsigned int nbrFile = this->FileToStore % 2; // file name: 0 or 1
-    std::stringstream ss;
-    ss << this->Filename << nbrFile << ".bin";
-    if (!this->Writer.Open(ss.str()))
+//-----------------------------------------------------------------------------
+std::string GetTimeString()
+{
+  std::time_t rawtime;
+  struct std::tm * timeinfo;
+  char buffer[80];
+  std::time(&rawtime);
+  timeinfo = std::localtime(&rawtime);
+  std::strftime(buffer, sizeof(buffer), "%d_%m_%Y_%H_%M_%S", timeinfo);
+  return std::string(buffer);
+}
+}
+
+//-----------------------------------------------------------------------------
+CrashAnalysisWriter::~CrashAnalysisWriter()
+{
+  this->UnregisterForCrash();
+}
+
+//-----------------------------------------------------------------------------
+void CrashAnalysisWriter::Allocate()
+{
+  this->SlotSize = RecordHeaderSize + this->MaximumPayloadSize;
+  this->Slots.assign(static_cast<size_t>(this->NbrPacketsToStore) * this->SlotSize, 0);
+  this->Sequences.reset(new std::atomic<unsigned int>[this->NbrPacketsToStore]);
+  for (unsigned int i = 0; i < this->NbrPacketsToStore; ++i)
+  {
+    this->Sequences[i].store(0);
+  }
+  this->PacketCount.store(0);
+  this->CrashScratch.assign(this->SlotSize, 0);
+}
+
+//-----------------------------------------------------------------------------
+void CrashAnalysisWriter::AddPacket(const unsigned char* payload, unsigned int payloadSize,
+                                    const PacketRing::PacketInformation& information)
+{
+  if (this->Slots.empty())
+  {
+    return;
+  }
+
+  // Only this thread modifies the count and the sequences, the oldest packet
+  // is overwritten once the ring is full
+  const unsigned long long count = this->PacketCount.load(std::memory_order_relaxed);
+  const size_t index = static_cast<size_t>(count % this->NbrPacketsToStore);
+  unsigned char* slot = this->Slots.data() + index * this->SlotSize;
+  std::atomic<unsigned int>& sequence = this->Sequences[index];
+  const unsigned int slotSequence = sequence.load(std::memory_order_relaxed);
+  sequence.store(slotSequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  const unsigned int storedSize = std::min(payloadSize, this->MaximumPayloadSize);
+  PcapRecordHeader header;
+  header.TimeSeconds = static_cast<uint32_t>(information.ReceptionTime.tv_sec);
+  header.TimeMicroseconds = static_cast<uint32_t>(information.ReceptionTime.tv_usec);
+  header.CapturedLength = NetworkPacket::EthIP4UDPHeaderSize + storedSize;
+  header.OriginalLength = NetworkPacket::EthIP4UDPHeaderSize + payloadSize;
+  std::memcpy(slot, &header, sizeof(header));
+  NetworkPacket::WriteEthernetIP4UDPHeader(slot + sizeof(header), payloadSize,
+    information.SourceIP, information.SourcePort, information.DestinationPort);
+  std::memcpy(slot + RecordHeaderSize, payload, storedSize);
+
+  sequence.store(slotSequence + 2, std::memory_order_release);
+  this->PacketCount.store(count + 1, std::memory_order_release);
+}
+
+//-----------------------------------------------------------------------------
+bool CrashAnalysisWriter::WriteLastPackets(int fileDescriptor, unsigned char* scratch) const
+{
+  const PcapFileHeader fileHeader;
+  if (!WriteAll(fileDescriptor, reinterpret_cast<const unsigned char*>(&fileHeader), sizeof(fileHeader)))
+  {
+    return false;
+  }
+  if (this->Slots.empty())
+  {
+    return true;
+  }
+
+  const unsigned long long count = this->PacketCount.load(std::memory_order_acquire);
+  const unsigned long long first = count > this->NbrPacketsToStore ? count - this->NbrPacketsToStore : 0;
+  for (unsigned long long n = first; n < count; ++n)
+  {
+    // the slot of the n-th packet has been written n / NbrPacketsToStore + 1 times,
+    // an other value means that it is being or has been overwritten
+    const size_t index = static_cast<size_t>(n % this->NbrPacketsToStore);
+    const unsigned int expectedSequence = static_cast<unsigned int>(2 * (n / this->NbrPacketsToStore + 1));
+    const std::atomic<unsigned int>& sequence = this->Sequences[index];
+    if (sequence.load(std::memory_order_acquire) != expectedSequence)
     {
-      vtkGenericWarningMacro("Crash analysis failed to open the log file.");
-      return;
+      continue;
+    }
+    std::memcpy(scratch, this->Slots.data() + index * this->SlotSize, this->SlotSize);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence.load(std::memory_order_relaxed) != expectedSequence)
+    {
+      continue;
+    }
+
+    PcapRecordHeader header;
+    std::memcpy(&header, scratch, sizeof(header));
+    const size_t recordSize = sizeof(header) + std::min<size_t>(header.CapturedLength,
+                                                                this->SlotSize - sizeof(header));
+    if (!WriteAll(fileDescriptor, scratch, recordSize))
+    {
+      return false;
     }
   }
+  return true;
+}
 
-  this->WriteLastPacket(packet);
-  this->PacketCount++;
+//-----------------------------------------------------------------------------
+bool CrashAnalysisWriter::SaveLastPackets(const std::string& filename) const
+{
+  const int fileDescriptor = OpenLogFile(filename.c_str());
+  if (fileDescriptor < 0)
+  {
+    vtkGenericWarningMacro("Crash analysis failed to open the log file " << filename);
+    return false;
+  }
+  std::vector<unsigned char> scratch(this->SlotSize);
+  const bool isWritten = this->WriteLastPackets(fileDescriptor, scratch.data());
+  CloseLogFile(fileDescriptor);
+  if (!isWritten)
+  {
+    vtkGenericWarningMacro("Crash analysis failed to write the log file " << filename);
+  }
+  return isWritten;
 }
 
 //-----------------------------------------------------------------------------
-void CrashAnalysisWriter::WriteLastPacket(const NetworkPacket& packet)
+void CrashAnalysisWriter::RegisterForCrash()
 {
-  // check that the writer is opened
-  if (!this->Writer.IsOpen())
+  if (this->IsRegistered)
   {
-    vtkGenericWarningMacro("Crash analysis couldn't save last packet received since the writer is not opened");
     return;
   }
+  this->CrashLogFileName = this->GetCrashLogFileName();
+
+  std::call_once(SignalHandlersInstalled, []()
+  {
+    for (int i = 0; i < NumberOfFatalSignals; ++i)
+    {
+      PreviousSignalHandlers[i] = std::signal(FatalSignals[i], &CrashAnalysisWriter::HandleFatalSignal);
+    }
+  });
 
-  this->Writer.WritePacket(packet);
+  for (auto& registeredWriter : RegisteredWriters)
+  {
+    CrashAnalysisWriter* expected = nullptr;
+    if (registeredWriter.compare_exchange_strong(expected, this))
+    {
+      this->IsRegistered = true;
+      return;
+    }
+  }
+  vtkGenericWarningMacro("Too many crash analysis logs, " << this->CrashLogFileName
+                         << " will not be saved in case of crash.");
 }
 
 //-----------------------------------------------------------------------------
-void CrashAnalysisWriter::CloseAnalyzer()
+void CrashAnalysisWriter::UnregisterForCrash()
 {
-  if (this->Writer.IsOpen())
+  if (!this->IsRegistered)
   {
-    this->Writer.Close();
     return;
   }
+  for (auto& registeredWriter : RegisteredWriters)
+  {
+    CrashAnalysisWriter* expected = this;
+    registeredWriter.compare_exchange_strong(expected, nullptr);
+  }
+  this->IsRegistered = false;
+}
+
+//-----------------------------------------------------------------------------
+void CrashAnalysisWriter::HandleFatalSignal(int signalNumber)
+{
+  // save only once, even if an other thread crashes or if saving crashes
+  if (!IsSavingCrashLogs.test_and_set())
+  {
+    for (auto& registeredWriter : RegisteredWriters)
+    {
+      const CrashAnalysisWriter* writer = registeredWriter.load();
+      if (writer)
+      {
+        const int fileDescriptor = OpenLogFile(writer->CrashLogFileName.c_str());
+        if (fileDescriptor >= 0)
+        {
+          writer->WriteLastPackets(fileDescriptor, writer->CrashScratch.data());
+          CloseLogFile(fileDescriptor);
+        }
+      }
+    }
+  }
+
+  // give the signal to the previous handler, or to the default one which terminates the process
+  SignalHandler previousHandler = SIG_DFL;
+  for (int i = 0; i < NumberOfFatalSignals; ++i)
+  {
+    if (FatalSignals[i] == signalNumber && PreviousSignalHandlers[i] != SIG_ERR
+        && PreviousSignalHandlers[i] != SIG_IGN && PreviousSignalHandlers[i] != nullptr)
+    {
+      previousHandler = PreviousSignalHandlers[i];
+    }
+  }
+  std::signal(signalNumber, previousHandler);
+  std::raise(signalNumber);
 }
 
 //-----------------------------------------------------------------------------
 void CrashAnalysisWriter::DeleteLogFiles()
 {
+  std::remove(this->GetCrashLogFileName().c_str());
+  // log files of the previous versions
   std::remove((this->Filename + "0.bin").c_str());
   std::remove((this->Filename + "1.bin").c_str());
 }
@@ -95,33 +338,25 @@ void CrashAnalysisWriter::DeleteLogFiles()
 //-----------------------------------------------------------------------------
 void CrashAnalysisWriter::ArchivePreviousLogIfExist()
 {
-  // check if the file exists
-  std::ifstream file1((this->Filename + "0.bin").c_str());
-  std::ifstream file2((this->Filename + "1.bin").c_str());
-
   // Get the date and time
-  std::time_t rawtime;
-  struct std::tm * timeinfo;
-  char buffer[80];
-  std::time(&rawtime);
-  timeinfo = std::localtime(&rawtime);
-  std::strftime(buffer, sizeof(buffer), "%d_%m_%Y_%H_%M_%S", timeinfo);
-  std::string timeStr(buffer);
+  std::string timeStr = GetTimeString();
 
   bool fileHasBeenRenamed = false;
-  // The file exists, rename it
-  if (file1.good())
-  {
-    file1.close();
-    std::rename((this->Filename + "0.bin").c_str(), (this->Filename + timeStr + "_0.bin").c_str());
-    fileHasBeenRenamed = true;
-  }
-  if (file2.good())
+  auto archive = [&](const std::string& filename, const std::string& archivedFilename)
   {
-    file2.close();
-    std::rename((this->Filename + "1.bin").c_str(), (this->Filename + timeStr + "_1.bin").c_str());
-    fileHasBeenRenamed = true;
-  }
+    // The file exists, rename it
+    std::ifstream file(filename.c_str());
+    if (file.good())
+    {
+      file.close();
+      std::rename(filename.c_str(), archivedFilename.c_str());
+      fileHasBeenRenamed = true;
+    }
+  };
+  archive(this->GetCrashLogFileName(), this->Filename + timeStr + "_Crash.pcap");
+  // log files of the previous versions
+  archive(this->Filename + "0.bin", this->Filename + timeStr + "_0.bin");
+  archive(this->Filename + "1.bin", this->Filename + timeStr + "_1.bin");
 
   if (fileHasBeenRenamed)
   {
@@ -130,3 +365,74 @@ void CrashAnalysisWriter::ArchivePreviousLogIfExist()
                            << "The log files have been renamed using timestamp: " << timeStr);
   }
 }
+
+//-----------------------------------------------------------------------------
+CrashAnalysisListener::~CrashAnalysisListener()
+{
+  this->StopListening();
+}
+
+//-----------------------------------------------------------------------------
+void CrashAnalysisListener::AddPort(int port, const std::string& filename,
+                                    unsigned int nbrPacketToStore, unsigned int maximumPayloadSize)
+{
+  Port analysedPort;
+  analysedPort.Number = port;
+  analysedPort.Writer.reset(new CrashAnalysisWriter);
+  analysedPort.Writer->SetNbrPacketsToStore(nbrPacketToStore);
+  analysedPort.Writer->SetMaximumPayloadSize(maximumPayloadSize);
+  analysedPort.Writer->SetFilename(filename);
+  analysedPort.Writer->ArchivePreviousLogIfExist();
+  analysedPort.Writer->Allocate();
+  analysedPort.Writer->RegisterForCrash();
+  this->Ports.push_back(std::move(analysedPort));
+}
+
+//-----------------------------------------------------------------------------
+void CrashAnalysisListener::Start(std::shared_ptr<PacketRing> ring, size_t reader)
+{
+  this->StartListening(ring, reader);
+}
+
+//-----------------------------------------------------------------------------
+bool CrashAnalysisListener::SaveLastPackets()
+{
+  const std::string timeStr = GetTimeString();
+  bool isSaved = true;
+  for (auto& port : this->Ports)
+  {
+    isSaved &= port.Writer->SaveLastPackets(port.Writer->GetFilename() + timeStr + ".pcap");
+  }
+  return isSaved;
+}
+
+//-----------------------------------------------------------------------------
+void CrashAnalysisListener::Stop()
+{
+  this->StopListening();
+  for (auto& port : this->Ports)
+  {
+    port.Writer->UnregisterForCrash();
+    port.Writer->SaveLastPackets(port.Writer->GetLastSessionFileName());
+    port.Writer->DeleteLogFiles();
+  }
+  this->Ports.clear();
+}
+
+//-----------------------------------------------------------------------------
+void CrashAnalysisListener::HandlePackets(const PacketRing& ring, const RawPacket* packets,
+                                          size_t numberOfPackets)
+{
+  for (size_t i = 0; i < numberOfPackets; ++i)
+  {
+    const PacketRing::PacketInformation& information = ring.GetInformation(packets[i]);
+    for (auto& port : this->Ports)
+    {
+      if (port.Number == information.DestinationPort)
+      {
+        port.Writer->AddPacket(packets[i].Data, packets[i].Length, information);
+        break;
+      }
+    }
+  }
+}
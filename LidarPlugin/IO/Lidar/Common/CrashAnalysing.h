@@ -19,31 +19,60 @@
 #define CRASH_ANALYSING_H
 
 // LOCAL
-#include "vtkPacketFileWriter.h"
-#include "NetworkPacket.h"
+#include "PacketRingListener.h"
+
+// STD
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
 
 /**
  * \class CrashAnalysisWriter
- * \brief This class is responsible to save as a .pcap file
- *        the last N packets received and remove the older ones.
+ * \brief This class keeps in memory the last N packets received, in a ring of
+ *        slots allocated once, and saves them as a .pcap file on demand.
  *        The idea is to generate a small .pcap to analyze when
  *        the software crashes in streaming mode
+ *
+ * Each slot already holds the pcap record of its packet, so adding a packet is
+ * a copy in the slot and saving the ring is a sequence of writes, which can be
+ * done from a signal handler: the writers registered with RegisterForCrash save
+ * their packets in GetCrashLogFileName() if the process receives a fatal signal.
+ *
+ * A single thread must add the packets, the ring can be saved from any thread
+ * at the same time: a packet being overwritten while it is saved is skipped.
 */
 class CrashAnalysisWriter
 {
 public:
-  // Default constructor
-  CrashAnalysisWriter() {this->PacketCount = 0;}
+  CrashAnalysisWriter() = default;
+  ~CrashAnalysisWriter();
 
-  // Setters
+  // Setters, to call before Allocate
   void SetNbrPacketsToStore(unsigned int arg) {this->NbrPacketsToStore = arg;}
+  void SetMaximumPayloadSize(unsigned int arg) {this->MaximumPayloadSize = arg;}
   void SetFilename(const std::string& arg) {this->Filename = arg;}
+  const std::string& GetFilename() const {return this->Filename;}
+
+  // Allocate the slots of the ring, the packets stored are dropped
+  void Allocate();
+
+  // Add a packet to the crash analyzer, bigger packets than the maximum payload size are truncated
+  void AddPacket(const unsigned char* payload, unsigned int payloadSize,
+                 const PacketRing::PacketInformation& information);
+
+  // Save the last packets stored as a .pcap file
+  bool SaveLastPackets(const std::string& filename) const;
+
+  // Save the packets to the crash log file when a fatal signal is received
+  void RegisterForCrash();
+  void UnregisterForCrash();
 
-  // Add a packet to the crash analyzer
-  void AddPacket(const NetworkPacket& packet);
+  // File saved when the software crashes
+  std::string GetCrashLogFileName() const { return this->Filename + "Crash.pcap"; }
 
-  // Close the pcap writer if it is opened
-  void CloseAnalyzer();
+  // File saved when the stream is stopped properly
+  std::string GetLastSessionFileName() const { return this->Filename + "LastSession.pcap"; }
 
   // Delete the logs files
   void DeleteLogFiles();
@@ -55,18 +84,84 @@ public:
   void ArchivePreviousLogIfExist();
 
 private:
+  CrashAnalysisWriter(const CrashAnalysisWriter&) = delete;
+  CrashAnalysisWriter& operator=(const CrashAnalysisWriter&) = delete;
+
+  // Write the packets in an opened file, only with async signal safe calls. Each
+  // packet is copied in the scratch buffer of SlotSize bytes before being written.
+  bool WriteLastPackets(int fileDescriptor, unsigned char* scratch) const;
+
+  // Save the registered writers then let the previous handler terminate the process
+  static void HandleFatalSignal(int signalNumber);
+
   // Export file information
   unsigned int NbrPacketsToStore = 5000;
+  unsigned int MaximumPayloadSize = 1500;
   std::string Filename = "";
+  // c_str() of GetCrashLogFileName(), usable from the signal handler
+  std::string CrashLogFileName;
+
+  // Each slot holds the pcap record header, the Ethernet/IP/UDP header and the payload
+  size_t SlotSize = 0;
+  std::vector<unsigned char> Slots;
+  // Odd while the slot is written, so that a reader can detect a slot overwritten meanwhile
+  std::unique_ptr<std::atomic<unsigned int>[]> Sequences;
+  // Number of packets added since the allocation
+  std::atomic<unsigned long long> PacketCount{0};
+  // Buffer used by the signal handler
+  mutable std::vector<unsigned char> CrashScratch;
+  bool IsRegistered = false;
+};
+
+/**
+ * \class CrashAnalysisListener
+ * \brief Feed the crash analysis writers of the reception ports with the packets of
+ *        the packet ring read by the decoder, in its own thread.
+ */
+class CrashAnalysisListener : public PacketRingListener
+{
+public:
+  ~CrashAnalysisListener() override;
 
-  // Writer
-  vtkPacketFileWriter Writer;
+  /**
+   * @brief AddPort save the packets received on a port, the log of a previous
+   * session is archived if it exists
+   * @param port the reception port
+   * @param filename the name of the log files, without extension
+   * @param nbrPacketToStore the number of packets to store
+   * @param maximumPayloadSize size of the slots of the packets, bigger packets are truncated
+   */
+  void AddPort(int port, const std::string& filename, unsigned int nbrPacketToStore,
+               unsigned int maximumPayloadSize = 1500);
 
-  // Internal parameters
-  unsigned int PacketCount = 0;
-  unsigned int FileToStore = 0;
+  //! Start storing the packets of the ring
+  void Start(std::shared_ptr<PacketRing> ring, size_t reader);
 
-  void WriteLastPacket(const NetworkPacket& packet);
+  /**
+   * @brief SaveLastPackets save the packets stored for each port now, in a log file
+   * named after the current date and time
+   * @return false if a log file could not be written
+   */
+  bool SaveLastPackets();
+
+  /**
+   * @brief Stop once all the packets have been stored, save them in the last session
+   * log files and delete the crash log files. So that, if a crash log file is present in
+   * the next session it means that the software has crashed. The ring must be stopped.
+   */
+  void Stop();
+
+protected:
+  void HandlePackets(const PacketRing& ring, const RawPacket* packets,
+                     size_t numberOfPackets) override;
+
+private:
+  struct Port
+  {
+    int Number;
+    std::unique_ptr<CrashAnalysisWriter> Writer;
+  };
+  std::vector<Port> Ports;
 };
 
 #endif // CRASH_ANALYSING_H
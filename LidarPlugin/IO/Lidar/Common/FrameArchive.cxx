@@ -0,0 +1,750 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "FrameArchive.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// VTK
+#include <vtk_zlib.h>
+
+namespace
+{
+const char ArchiveMagic[8] = { 'L', 'V', 'F', 'R', 'A', 'M', 'E', 'S' };
+const char TrailerMagic[8] = { 'L', 'V', 'F', 'R', 'I', 'D', 'X', '\0' };
+// the version 2 adds the quantized points, the archives of version 1 are still read
+const uint32_t ArchiveVersion = 2;
+const uint64_t Alignment = 8;
+//! Number of bits of each coordinate of the quantized points, so that a Morton code fits in 63 bits
+const int QuantizationBits = 21;
+
+//-----------------------------------------------------------------------------
+struct ArchiveHeader
+{
+  char Magic[8];
+  uint32_t Version;
+  uint32_t Reserved;
+};
+
+//-----------------------------------------------------------------------------
+struct FrameHeader
+{
+  uint64_t NumberOfPoints;
+  uint32_t NumberOfColumns;
+  uint32_t Reserved;
+};
+
+//-----------------------------------------------------------------------------
+struct ColumnHeader
+{
+  uint32_t NameLength;
+  uint32_t Kind;
+  int32_t DataType;
+  uint32_t ValueSize;
+  uint32_t NumberOfComponents;
+  uint32_t Compression;
+  uint64_t RawSize;
+  uint64_t StoredSize;
+};
+
+//-----------------------------------------------------------------------------
+struct ArchiveTrailer
+{
+  uint64_t IndexOffset;
+  uint64_t NumberOfFrames;
+  char Magic[8];
+};
+
+//-----------------------------------------------------------------------------
+// Stored before the compressed Morton codes of the quantized points
+struct QuantizationHeader
+{
+  double Origin[3];
+  double Step;
+  uint64_t EncodedSize;
+};
+
+enum ColumnCompression
+{
+  NoCompression = 0,
+  ShuffledZlib = 1,
+  QuantizedOctree = 2,
+};
+
+//-----------------------------------------------------------------------------
+uint64_t Align(uint64_t offset)
+{
+  return (offset + Alignment - 1) / Alignment * Alignment;
+}
+
+//-----------------------------------------------------------------------------
+// Group the n-th bytes of all the values together. The high bytes of the values
+// of a column are often the same, so they compress much better once grouped.
+void Shuffle(const unsigned char* in, size_t size, size_t valueSize, unsigned char* out)
+{
+  const size_t numberOfValues = size / valueSize;
+  for (size_t b = 0; b < valueSize; ++b)
+  {
+    for (size_t i = 0; i < numberOfValues; ++i)
+    {
+      out[b * numberOfValues + i] = in[i * valueSize + b];
+    }
+  }
+  std::memcpy(out + numberOfValues * valueSize, in + numberOfValues * valueSize,
+              size - numberOfValues * valueSize);
+}
+
+//-----------------------------------------------------------------------------
+void Unshuffle(const unsigned char* in, size_t size, size_t valueSize, unsigned char* out)
+{
+  const size_t numberOfValues = size / valueSize;
+  for (size_t b = 0; b < valueSize; ++b)
+  {
+    for (size_t i = 0; i < numberOfValues; ++i)
+    {
+      out[i * valueSize + b] = in[b * numberOfValues + i];
+    }
+  }
+  std::memcpy(out + numberOfValues * valueSize, in + numberOfValues * valueSize,
+              size - numberOfValues * valueSize);
+}
+
+//-----------------------------------------------------------------------------
+// Interleave the bits of a coordinate with two zeros, to build a Morton code
+uint64_t SpreadBits(uint64_t x)
+{
+  x &= (1ull << QuantizationBits) - 1;
+  x = (x | x << 32) & 0x001f00000000ffffull;
+  x = (x | x << 16) & 0x001f0000ff0000ffull;
+  x = (x | x << 8) & 0x100f00f00f00f00full;
+  x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+  x = (x | x << 2) & 0x1249249249249249ull;
+  return x;
+}
+
+//-----------------------------------------------------------------------------
+uint64_t CompactBits(uint64_t x)
+{
+  x &= 0x1249249249249249ull;
+  x = (x ^ (x >> 2)) & 0x10c30c30c30c30c3ull;
+  x = (x ^ (x >> 4)) & 0x100f00f00f00f00full;
+  x = (x ^ (x >> 8)) & 0x001f0000ff0000ffull;
+  x = (x ^ (x >> 16)) & 0x001f00000000ffffull;
+  x = (x ^ (x >> 32)) & ((1ull << QuantizationBits) - 1);
+  return x;
+}
+
+//-----------------------------------------------------------------------------
+void WriteVarint(uint64_t value, std::vector<unsigned char>& out)
+{
+  while (value >= 0x80)
+  {
+    out.push_back(static_cast<unsigned char>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<unsigned char>(value));
+}
+
+//-----------------------------------------------------------------------------
+bool ReadVarint(const unsigned char*& data, const unsigned char* end, uint64_t& value)
+{
+  value = 0;
+  for (int shift = 0; data < end && shift < 64; shift += 7)
+  {
+    const unsigned char byte = *data++;
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+template<typename T>
+void GetCoordinate(const unsigned char* points, uint64_t index, T& value)
+{
+  std::memcpy(&value, points + index * sizeof(T), sizeof(T));
+}
+
+//-----------------------------------------------------------------------------
+template<typename T>
+void WriteValue(std::ostream& os, const T& value)
+{
+  os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+//-----------------------------------------------------------------------------
+// Read a value at offset if it fits in the size, and move the offset after it
+template<typename T>
+bool ReadValue(const unsigned char* data, uint64_t size, uint64_t& offset, T& value)
+{
+  if (offset > size || size - offset < sizeof(T))
+  {
+    return false;
+  }
+  std::memcpy(&value, data + offset, sizeof(T));
+  offset += sizeof(T);
+  return true;
+}
+}
+
+//-----------------------------------------------------------------------------
+void FrameEncoder::SetCompressionLevel(int level)
+{
+  this->CompressionLevel = std::max(0, std::min(level, 9));
+}
+
+//-----------------------------------------------------------------------------
+void FrameEncoder::SetPositionTolerance(double tolerance)
+{
+  this->PositionTolerance = std::max(0.0, tolerance);
+}
+
+//-----------------------------------------------------------------------------
+bool FrameEncoder::QuantizePoints(uint64_t numberOfPoints, const FrameArchiveColumn& column)
+{
+  const uint64_t numberOfValues = numberOfPoints * 3;
+  auto coordinate = [&column](uint64_t index)
+  {
+    if (column.ValueSize == sizeof(float))
+    {
+      float value;
+      GetCoordinate(column.Data, index, value);
+      return static_cast<double>(value);
+    }
+    double value;
+    GetCoordinate(column.Data, index, value);
+    return value;
+  };
+
+  // a cell of the grid is twice the tolerance, so that its center is within the tolerance
+  QuantizationHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.Step = 2.0 * this->PositionTolerance;
+  double maxPt[3];
+  for (int j = 0; j < 3; ++j)
+  {
+    header.Origin[j] = coordinate(j);
+    maxPt[j] = header.Origin[j];
+  }
+  for (uint64_t i = 0; i < numberOfValues; ++i)
+  {
+    const double value = coordinate(i);
+    if (!std::isfinite(value))
+    {
+      return false;
+    }
+    header.Origin[i % 3] = std::min(header.Origin[i % 3], value);
+    maxPt[i % 3] = std::max(maxPt[i % 3], value);
+  }
+  for (int j = 0; j < 3; ++j)
+  {
+    if ((maxPt[j] - header.Origin[j]) / header.Step >= (1ull << QuantizationBits) - 1)
+    {
+      return false;
+    }
+  }
+
+  // sorting the Morton codes of the cells orders the points as the leaves of the octree,
+  // so that consecutive codes share their high bits and their differences are small
+  std::vector<std::pair<uint64_t, uint32_t> > codes(numberOfPoints);
+  for (uint64_t i = 0; i < numberOfPoints; ++i)
+  {
+    uint64_t code = 0;
+    for (int j = 0; j < 3; ++j)
+    {
+      const double cell = std::round((coordinate(i * 3 + j) - header.Origin[j]) / header.Step);
+      code |= SpreadBits(static_cast<uint64_t>(cell)) << j;
+    }
+    codes[i] = std::make_pair(code, static_cast<uint32_t>(i));
+  }
+  std::sort(codes.begin(), codes.end());
+
+  this->Order.resize(numberOfPoints);
+  this->ReorderBuffer.clear();
+  this->ReorderBuffer.reserve(numberOfPoints * 4);
+  uint64_t previous = 0;
+  for (uint64_t i = 0; i < numberOfPoints; ++i)
+  {
+    this->Order[i] = codes[i].second;
+    WriteVarint(codes[i].first - previous, this->ReorderBuffer);
+    previous = codes[i].first;
+  }
+  header.EncodedSize = this->ReorderBuffer.size();
+
+  // the differences are compressed even if the other columns are stored raw
+  uLongf compressedSize = compressBound(static_cast<uLong>(this->ReorderBuffer.size()));
+  this->QuantizedPoints.resize(sizeof(header) + compressedSize);
+  if (compress2(this->QuantizedPoints.data() + sizeof(header), &compressedSize,
+                this->ReorderBuffer.data(), static_cast<uLong>(this->ReorderBuffer.size()),
+                std::max(this->CompressionLevel, 1)) != Z_OK)
+  {
+    return false;
+  }
+  std::memcpy(this->QuantizedPoints.data(), &header, sizeof(header));
+  this->QuantizedPoints.resize(sizeof(header) + compressedSize);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void FrameEncoder::WritePadding(std::ostream& stream)
+{
+  const uint64_t position = static_cast<uint64_t>(stream.tellp());
+  const char zeros[Alignment] = { 0 };
+  stream.write(zeros, Align(position) - position);
+}
+
+//-----------------------------------------------------------------------------
+bool FrameEncoder::Encode(uint64_t numberOfPoints, const std::vector<FrameArchiveColumn>& columns,
+                          std::ostream& stream)
+{
+  FrameHeader frameHeader;
+  std::memset(&frameHeader, 0, sizeof(frameHeader));
+  frameHeader.NumberOfPoints = numberOfPoints;
+  frameHeader.NumberOfColumns = static_cast<uint32_t>(columns.size());
+  WriteValue(stream, frameHeader);
+
+  // the first points column which can be quantized gives the order of the rows of all the columns
+  const FrameArchiveColumn* quantizedColumn = nullptr;
+  this->Order.clear();
+  for (const FrameArchiveColumn& column : columns)
+  {
+    if (this->PositionTolerance > 0 && column.Kind == FrameArchiveColumn::Points
+        && (column.ValueSize == sizeof(float) || column.ValueSize == sizeof(double))
+        && column.NumberOfComponents == 3 && column.Size == numberOfPoints * 3 * column.ValueSize
+        && numberOfPoints > 0 && numberOfPoints <= UINT32_MAX)
+    {
+      if (this->QuantizePoints(numberOfPoints, column))
+      {
+        quantizedColumn = &column;
+      }
+      break;
+    }
+  }
+
+  for (const FrameArchiveColumn& column : columns)
+  {
+    ColumnHeader columnHeader;
+    std::memset(&columnHeader, 0, sizeof(columnHeader));
+    columnHeader.NameLength = static_cast<uint32_t>(column.Name.size());
+    columnHeader.Kind = column.Kind;
+    columnHeader.DataType = column.DataType;
+    columnHeader.ValueSize = column.ValueSize;
+    columnHeader.NumberOfComponents = column.NumberOfComponents;
+    columnHeader.Compression = NoCompression;
+    columnHeader.RawSize = column.Size;
+    columnHeader.StoredSize = column.Size;
+    const unsigned char* storedData = column.Data;
+
+    // the rows of the other columns follow the order of the quantized points
+    const uint64_t rowSize = static_cast<uint64_t>(column.ValueSize) * column.NumberOfComponents;
+    const unsigned char* data = column.Data;
+    if (quantizedColumn && &column != quantizedColumn && column.Size == numberOfPoints * rowSize)
+    {
+      this->ReorderBuffer.resize(column.Size);
+      for (uint64_t i = 0; i < numberOfPoints; ++i)
+      {
+        std::memcpy(this->ReorderBuffer.data() + i * rowSize, column.Data + this->Order[i] * rowSize,
+                    rowSize);
+      }
+      data = this->ReorderBuffer.data();
+      storedData = data;
+    }
+
+    if (&column == quantizedColumn)
+    {
+      columnHeader.Compression = QuantizedOctree;
+      columnHeader.StoredSize = this->QuantizedPoints.size();
+      storedData = this->QuantizedPoints.data();
+    }
+    else if (this->CompressionLevel > 0 && column.Size > 0)
+    {
+      const unsigned char* input = data;
+      if (column.ValueSize > 1)
+      {
+        this->ShuffleBuffer.resize(column.Size);
+        Shuffle(data, column.Size, column.ValueSize, this->ShuffleBuffer.data());
+        input = this->ShuffleBuffer.data();
+      }
+      uLongf compressedSize = compressBound(static_cast<uLong>(column.Size));
+      this->CompressionBuffer.resize(compressedSize);
+      if (compress2(this->CompressionBuffer.data(), &compressedSize, input,
+                    static_cast<uLong>(column.Size), this->CompressionLevel) == Z_OK
+          && compressedSize < column.Size)
+      {
+        columnHeader.Compression = ShuffledZlib;
+        columnHeader.StoredSize = compressedSize;
+        storedData = this->CompressionBuffer.data();
+      }
+    }
+
+    WriteValue(stream, columnHeader);
+    stream.write(column.Name.data(), column.Name.size());
+    this->WritePadding(stream);
+    stream.write(reinterpret_cast<const char*>(storedData), columnHeader.StoredSize);
+    this->WritePadding(stream);
+  }
+  return stream.good();
+}
+
+//-----------------------------------------------------------------------------
+bool FrameDecoder::Decode(const unsigned char* frameData, uint64_t size, uint64_t& numberOfPoints,
+                          std::vector<FrameArchiveColumn>& columns)
+{
+  columns.clear();
+  uint64_t offset = 0;
+  FrameHeader frameHeader;
+  if (!ReadValue(frameData, size, offset, frameHeader))
+  {
+    return false;
+  }
+  numberOfPoints = frameHeader.NumberOfPoints;
+
+  this->DecompressionBuffers.resize(std::max(this->DecompressionBuffers.size(),
+                                             static_cast<size_t>(frameHeader.NumberOfColumns)));
+  for (uint32_t i = 0; i < frameHeader.NumberOfColumns; ++i)
+  {
+    ColumnHeader columnHeader;
+    if (!ReadValue(frameData, size, offset, columnHeader)
+        || columnHeader.NameLength > size - offset)
+    {
+      return false;
+    }
+    FrameArchiveColumn column;
+    column.Name.assign(reinterpret_cast<const char*>(frameData + offset), columnHeader.NameLength);
+    column.Kind = static_cast<FrameArchiveColumn::ColumnKind>(columnHeader.Kind);
+    column.DataType = columnHeader.DataType;
+    column.ValueSize = columnHeader.ValueSize;
+    column.NumberOfComponents = columnHeader.NumberOfComponents;
+    column.Size = columnHeader.RawSize;
+    // the frames start on an aligned offset, so the columns can be aligned relatively to the frame
+    offset = Align(offset + columnHeader.NameLength);
+    if (offset > size || columnHeader.StoredSize > size - offset)
+    {
+      return false;
+    }
+
+    const unsigned char* storedData = frameData + offset;
+    if (columnHeader.Compression == NoCompression)
+    {
+      column.Data = storedData;
+    }
+    else if (columnHeader.Compression == ShuffledZlib)
+    {
+      std::vector<unsigned char>& buffer = this->DecompressionBuffers[i];
+      buffer.resize(columnHeader.RawSize);
+      unsigned char* output = buffer.data();
+      if (columnHeader.ValueSize > 1)
+      {
+        this->ShuffleBuffer.resize(columnHeader.RawSize);
+        output = this->ShuffleBuffer.data();
+      }
+      uLongf rawSize = static_cast<uLongf>(columnHeader.RawSize);
+      if (uncompress(output, &rawSize, storedData, static_cast<uLong>(columnHeader.StoredSize)) != Z_OK
+          || rawSize != columnHeader.RawSize)
+      {
+        return false;
+      }
+      if (columnHeader.ValueSize > 1)
+      {
+        Unshuffle(output, rawSize, columnHeader.ValueSize, buffer.data());
+      }
+      column.Data = buffer.data();
+    }
+    else if (columnHeader.Compression == QuantizedOctree)
+    {
+      if (columnHeader.NumberOfComponents != 3
+          || columnHeader.RawSize != numberOfPoints * 3 * columnHeader.ValueSize
+          || !this->DecodeQuantizedPoints(storedData, columnHeader.StoredSize, numberOfPoints,
+                                          columnHeader.ValueSize, this->DecompressionBuffers[i]))
+      {
+        return false;
+      }
+      column.Data = this->DecompressionBuffers[i].data();
+    }
+    else
+    {
+      return false;
+    }
+    columns.push_back(column);
+    offset = Align(offset + columnHeader.StoredSize);
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool FrameDecoder::DecodeQuantizedPoints(const unsigned char* data, uint64_t size,
+                                         uint64_t numberOfPoints, uint32_t valueSize,
+                                         std::vector<unsigned char>& buffer)
+{
+  QuantizationHeader header;
+  uint64_t offset = 0;
+  // a difference takes at most 9 bytes, as the codes have 63 bits
+  if ((valueSize != sizeof(float) && valueSize != sizeof(double))
+      || !ReadValue(data, size, offset, header) || header.EncodedSize > numberOfPoints * 9)
+  {
+    return false;
+  }
+  this->ShuffleBuffer.resize(header.EncodedSize);
+  uLongf encodedSize = static_cast<uLongf>(header.EncodedSize);
+  if (uncompress(this->ShuffleBuffer.data(), &encodedSize, data + offset,
+                 static_cast<uLong>(size - offset)) != Z_OK
+      || encodedSize != header.EncodedSize)
+  {
+    return false;
+  }
+
+  buffer.resize(numberOfPoints * 3 * valueSize);
+  const unsigned char* encoded = this->ShuffleBuffer.data();
+  const unsigned char* end = encoded + encodedSize;
+  uint64_t code = 0;
+  for (uint64_t i = 0; i < numberOfPoints; ++i)
+  {
+    uint64_t difference;
+    if (!ReadVarint(encoded, end, difference))
+    {
+      return false;
+    }
+    code += difference;
+    for (int j = 0; j < 3; ++j)
+    {
+      const double value = header.Origin[j] + header.Step * CompactBits(code >> j);
+      unsigned char* out = buffer.data() + (i * 3 + j) * valueSize;
+      if (valueSize == sizeof(float))
+      {
+        const float floatValue = static_cast<float>(value);
+        std::memcpy(out, &floatValue, sizeof(float));
+      }
+      else
+      {
+        std::memcpy(out, &value, sizeof(double));
+      }
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+FrameArchiveWriter::~FrameArchiveWriter()
+{
+  this->Close();
+}
+
+//-----------------------------------------------------------------------------
+bool FrameArchiveWriter::Open(const std::string& filename, int compressionLevel,
+                              double positionTolerance)
+{
+  this->Close();
+  this->Index.clear();
+  this->Encoder.SetCompressionLevel(compressionLevel);
+  this->Encoder.SetPositionTolerance(positionTolerance);
+  this->File.open(filename, std::ios::binary | std::ios::trunc);
+  if (!this->File.is_open())
+  {
+    return false;
+  }
+
+  ArchiveHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.Magic, ArchiveMagic, sizeof(ArchiveMagic));
+  header.Version = ArchiveVersion;
+  WriteValue(this->File, header);
+  return this->File.good();
+}
+
+//-----------------------------------------------------------------------------
+bool FrameArchiveWriter::WriteFrame(double time, uint64_t numberOfPoints,
+                                    const std::vector<FrameArchiveColumn>& columns)
+{
+  if (!this->File.is_open())
+  {
+    return false;
+  }
+
+  FrameArchiveIndexEntry entry;
+  entry.Offset = static_cast<uint64_t>(this->File.tellp());
+  entry.Time = time;
+  // the frames start on an aligned offset, as the archive header and the padded columns
+  if (!this->Encoder.Encode(numberOfPoints, columns, this->File))
+  {
+    return false;
+  }
+  entry.Size = static_cast<uint64_t>(this->File.tellp()) - entry.Offset;
+  this->Index.push_back(entry);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool FrameArchiveWriter::Close()
+{
+  if (!this->File.is_open())
+  {
+    return true;
+  }
+
+  ArchiveTrailer trailer;
+  std::memset(&trailer, 0, sizeof(trailer));
+  trailer.IndexOffset = static_cast<uint64_t>(this->File.tellp());
+  trailer.NumberOfFrames = this->Index.size();
+  std::memcpy(trailer.Magic, TrailerMagic, sizeof(TrailerMagic));
+  for (const FrameArchiveIndexEntry& entry : this->Index)
+  {
+    WriteValue(this->File, entry);
+  }
+  WriteValue(this->File, trailer);
+
+  const bool isGood = this->File.good();
+  this->File.close();
+  this->Index.clear();
+  return isGood;
+}
+
+//-----------------------------------------------------------------------------
+FrameArchiveReader::~FrameArchiveReader()
+{
+  this->Close();
+}
+
+//-----------------------------------------------------------------------------
+bool FrameArchiveReader::Open(const std::string& filename)
+{
+  this->Close();
+
+#ifndef _MSC_VER
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd >= 0)
+  {
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+    {
+      void* mapped = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapped != MAP_FAILED)
+      {
+        this->Data = static_cast<const unsigned char*>(mapped);
+        this->Size = static_cast<uint64_t>(fileStat.st_size);
+        this->IsMapped = true;
+      }
+    }
+    // the mapping stays valid once the file descriptor is closed
+    close(fd);
+  }
+#endif
+
+  if (!this->Data)
+  {
+    std::ifstream is(filename, std::ios::binary | std::ios::ate);
+    if (!is.is_open())
+    {
+      return false;
+    }
+    this->LoadedFile.resize(static_cast<size_t>(is.tellg()));
+    is.seekg(0);
+    is.read(reinterpret_cast<char*>(this->LoadedFile.data()), this->LoadedFile.size());
+    if (!is.good() || this->LoadedFile.empty())
+    {
+      this->LoadedFile.clear();
+      return false;
+    }
+    this->Data = this->LoadedFile.data();
+    this->Size = this->LoadedFile.size();
+  }
+
+  // check the header and the trailer, then load the index
+  uint64_t offset = 0;
+  ArchiveHeader header;
+  ArchiveTrailer trailer;
+  uint64_t trailerOffset = this->Size >= sizeof(trailer) ? this->Size - sizeof(trailer) : this->Size;
+  if (!ReadValue(this->Data, this->Size, offset, header)
+      || std::memcmp(header.Magic, ArchiveMagic, sizeof(ArchiveMagic)) != 0
+      || header.Version == 0 || header.Version > ArchiveVersion
+      || !ReadValue(this->Data, this->Size, trailerOffset, trailer)
+      || std::memcmp(trailer.Magic, TrailerMagic, sizeof(TrailerMagic)) != 0
+      || trailer.IndexOffset > this->Size - sizeof(trailer)
+      || (this->Size - sizeof(trailer) - trailer.IndexOffset) / sizeof(FrameArchiveIndexEntry)
+           != trailer.NumberOfFrames)
+  {
+    this->Close();
+    return false;
+  }
+
+  this->Index.resize(trailer.NumberOfFrames);
+  std::memcpy(this->Index.data(), this->Data + trailer.IndexOffset,
+              trailer.NumberOfFrames * sizeof(FrameArchiveIndexEntry));
+  for (const FrameArchiveIndexEntry& entry : this->Index)
+  {
+    if (entry.Offset > trailer.IndexOffset || entry.Size > trailer.IndexOffset - entry.Offset)
+    {
+      this->Close();
+      return false;
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void FrameArchiveReader::Close()
+{
+#ifndef _MSC_VER
+  if (this->IsMapped)
+  {
+    munmap(const_cast<unsigned char*>(this->Data), this->Size);
+  }
+#endif
+  this->Data = nullptr;
+  this->Size = 0;
+  this->IsMapped = false;
+  this->LoadedFile.clear();
+  this->LoadedFile.shrink_to_fit();
+  this->Index.clear();
+  this->Decoder = FrameDecoder();
+}
+
+//-----------------------------------------------------------------------------
+bool FrameArchiveReader::ReadFrame(size_t frameNumber, uint64_t& numberOfPoints,
+                                   std::vector<FrameArchiveColumn>& columns)
+{
+  return this->ReadFrame(frameNumber, this->Decoder, numberOfPoints, columns);
+}
+
+//-----------------------------------------------------------------------------
+bool FrameArchiveReader::ReadFrame(size_t frameNumber, FrameDecoder& decoder,
+                                   uint64_t& numberOfPoints,
+                                   std::vector<FrameArchiveColumn>& columns) const
+{
+  columns.clear();
+  if (frameNumber >= this->Index.size())
+  {
+    return false;
+  }
+
+  // the offsets are relative to the frame
+  const FrameArchiveIndexEntry& entry = this->Index[frameNumber];
+  return decoder.Decode(this->Data + entry.Offset, entry.Size, numberOfPoints, columns);
+}
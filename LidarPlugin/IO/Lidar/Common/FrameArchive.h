@@ -0,0 +1,246 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef FRAMEARCHIVE_H
+#define FRAMEARCHIVE_H
+
+#include <cstdint>
+#include <fstream>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/**
+ * \file FrameArchive.h
+ * \brief Binary file of decoded frames, so that a pcap does not need to be decoded
+ *        again each time it is analysed.
+ *
+ * Layout of the file, all values in the host byte order:
+ *  - a header, with a magic string and the layout version
+ *  - the frames, one after the other. A frame is a small header followed by its columns,
+ *    the points and each point data array. A column can be stored raw or byte shuffled
+ *    and compressed with zlib, it is kept raw when compressing does not reduce its size.
+ *    When a position tolerance is given, the points are quantized on a grid and stored
+ *    as the sorted Morton codes (octree order) of their cells, delta and zlib encoded,
+ *    the rows of the other columns being reordered the same way.
+ *  - the index of the frames (offset, size and time of each frame)
+ *  - a trailer giving the offset of the index, so that it is read first
+ *
+ * Every column starts on an 8 bytes boundary, so that a raw column mapped in memory
+ * can be used directly.
+ */
+
+/**
+ * @brief The FrameArchiveColumn struct describes a column of a frame:
+ * the points or a point data array
+ */
+struct FrameArchiveColumn
+{
+  enum ColumnKind
+  {
+    Points = 0,
+    PointData = 1,
+  };
+
+  std::string Name;
+  ColumnKind Kind = PointData;
+  //! VTK data type of the values, VTK_FLOAT, VTK_DOUBLE, ...
+  int DataType = 0;
+  //! Size in bytes of a value, needed to shuffle the bytes before compression
+  uint32_t ValueSize = 0;
+  uint32_t NumberOfComponents = 1;
+  //! Values of the column. Given by the caller to write a frame, they point to the
+  //! decompressed buffer or directly in the mapped file when a frame is read.
+  const unsigned char* Data = nullptr;
+  uint64_t Size = 0;
+};
+
+//! Position and time of a frame in the archive
+struct FrameArchiveIndexEntry
+{
+  uint64_t Offset;
+  uint64_t Size;
+  double Time;
+};
+
+/**
+ * \class FrameEncoder
+ * \brief Encode a frame as it is stored in a frame archive: a small header followed by
+ * its columns, each column being compressed when this reduces its size. The frames
+ * published over the network (see FramePublisher) are encoded the same way.
+ */
+class FrameEncoder
+{
+public:
+  //! 0 to store the columns raw, up to 9 for the best compression
+  void SetCompressionLevel(int level);
+  int GetCompressionLevel() const { return this->CompressionLevel; }
+
+  /**
+   * @brief SetPositionTolerance set the maximal error on each coordinate of the points,
+   * 0 to store them exactly. With a tolerance, the points are quantized and reordered
+   * along the octree of the frame, the order of the points of a frame is not kept. The
+   * points whose extent is too large for the tolerance are stored exactly.
+   */
+  void SetPositionTolerance(double tolerance);
+  double GetPositionTolerance() const { return this->PositionTolerance; }
+
+  /**
+   * @brief Encode append a frame to a stream. The columns are aligned relatively to the
+   * beginning of the stream, so the frame must start on an 8 bytes boundary
+   * @param numberOfPoints number of points of the frame
+   * @param columns points and point data of the frame
+   */
+  bool Encode(uint64_t numberOfPoints, const std::vector<FrameArchiveColumn>& columns,
+              std::ostream& stream);
+
+private:
+  void WritePadding(std::ostream& stream);
+
+  //! Quantize the points in QuantizedPoints and compute the order of the rows,
+  //! return false if the points can not be quantized with the tolerance
+  bool QuantizePoints(uint64_t numberOfPoints, const FrameArchiveColumn& column);
+
+  int CompressionLevel = 0;
+  double PositionTolerance = 0.0;
+  std::vector<unsigned char> ShuffleBuffer;
+  std::vector<unsigned char> CompressionBuffer;
+  //! Original row of each stored row, and stored column, when the points are quantized
+  std::vector<uint32_t> Order;
+  std::vector<unsigned char> QuantizedPoints;
+  std::vector<unsigned char> ReorderBuffer;
+};
+
+/**
+ * \class FrameDecoder
+ * \brief Decode a frame written by FrameEncoder
+ */
+class FrameDecoder
+{
+public:
+  /**
+   * @brief Decode read a frame.
+   * @param data the encoded frame
+   * @param size size of the encoded frame
+   * @param numberOfPoints[out] number of points of the frame
+   * @param columns[out] columns of the frame, pointing either to data or to buffers of
+   * the decoder, valid until the next call
+   * @return false if the frame is corrupted
+   */
+  bool Decode(const unsigned char* data, uint64_t size, uint64_t& numberOfPoints,
+              std::vector<FrameArchiveColumn>& columns);
+
+private:
+  //! Decode quantized points in buffer, return false if they are corrupted
+  bool DecodeQuantizedPoints(const unsigned char* data, uint64_t size, uint64_t numberOfPoints,
+                             uint32_t valueSize, std::vector<unsigned char>& buffer);
+
+  //! One buffer per compressed column of the last frame decoded
+  std::vector<std::vector<unsigned char> > DecompressionBuffers;
+  std::vector<unsigned char> ShuffleBuffer;
+};
+
+/**
+ * \class FrameArchiveWriter
+ * \brief Write a frame archive, frame by frame
+ */
+class FrameArchiveWriter
+{
+public:
+  ~FrameArchiveWriter();
+
+  /**
+   * @brief Open create the file, overwriting it
+   * @param compressionLevel 0 to store the columns raw, up to 9 for the best compression
+   * @param positionTolerance maximal error on the coordinates of the points, 0 to store
+   * them exactly, see FrameEncoder::SetPositionTolerance
+   */
+  bool Open(const std::string& filename, int compressionLevel = 0, double positionTolerance = 0.0);
+
+  /**
+   * @brief WriteFrame append a frame
+   * @param time time of the frame, used for the time steps when reading the archive
+   * @param numberOfPoints number of points of the frame
+   * @param columns points and point data of the frame
+   */
+  bool WriteFrame(double time, uint64_t numberOfPoints, const std::vector<FrameArchiveColumn>& columns);
+
+  //! Write the index of the frames and close the file, called by the destructor
+  bool Close();
+
+  bool IsOpen() const { return this->File.is_open(); }
+
+private:
+  std::ofstream File;
+  std::string FileName;
+  FrameEncoder Encoder;
+  std::vector<FrameArchiveIndexEntry> Index;
+};
+
+/**
+ * \class FrameArchiveReader
+ * \brief Read the frames of an archive in any order. The file is mapped in memory
+ * when possible, otherwise it is loaded when opened.
+ */
+class FrameArchiveReader
+{
+public:
+  FrameArchiveReader() = default;
+  ~FrameArchiveReader();
+
+  //! Open the archive and read its index, return false if it is not a valid archive
+  bool Open(const std::string& filename);
+  void Close();
+  bool IsOpen() const { return this->Data != nullptr; }
+
+  size_t GetNumberOfFrames() const { return this->Index.size(); }
+
+  //! Time given when the frame has been written
+  double GetFrameTime(size_t frameNumber) const { return this->Index[frameNumber].Time; }
+
+  /**
+   * @brief ReadFrame read a frame.
+   * @param frameNumber index of the frame, between 0 and GetNumberOfFrames
+   * @param numberOfPoints[out] number of points of the frame
+   * @param columns[out] columns of the frame, valid until the next call or until the
+   * archive is closed
+   * @return false if the frame is corrupted
+   */
+  bool ReadFrame(size_t frameNumber, uint64_t& numberOfPoints, std::vector<FrameArchiveColumn>& columns);
+
+  /**
+   * @brief ReadFrame read a frame with the given decoder, so that several frames can be
+   * read at the same time by different threads, each one with its own decoder. The
+   * columns are valid until the next use of the decoder or until the archive is closed.
+   */
+  bool ReadFrame(size_t frameNumber, FrameDecoder& decoder, uint64_t& numberOfPoints,
+                 std::vector<FrameArchiveColumn>& columns) const;
+
+private:
+  FrameArchiveReader(const FrameArchiveReader&) = delete;
+  FrameArchiveReader& operator=(const FrameArchiveReader&) = delete;
+
+  const unsigned char* Data = nullptr;
+  uint64_t Size = 0;
+  bool IsMapped = false;
+  //! Content of the file when it can not be mapped
+  std::vector<unsigned char> LoadedFile;
+  std::vector<FrameArchiveIndexEntry> Index;
+  FrameDecoder Decoder;
+};
+
+#endif // FRAMEARCHIVE_H
@@ -0,0 +1,142 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef FRAMEBUILDERARRAY_H
+#define FRAMEBUILDERARRAY_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#include <vtkAbstractArray.h>
+
+/**
+ * \class FrameBuilderArray
+ * \brief Contiguous buffer used to build the values of a point data array while
+ *        a frame is under construction.
+ *
+ * Appending a value only checks the capacity, contrary to vtkDataArray::InsertNextValue.
+ * Once the frame is complete, the buffer is given to the vtk array without any copy.
+ * The memory is allocated with malloc so that vtk can release it with free, or so that
+ * it can be taken back from the vtk array when the frame is recycled.
+ */
+template<typename T>
+class FrameBuilderArray
+{
+public:
+  FrameBuilderArray() = default;
+  FrameBuilderArray(const FrameBuilderArray&) = delete;
+  FrameBuilderArray& operator=(const FrameBuilderArray&) = delete;
+  ~FrameBuilderArray() { std::free(this->Data); }
+
+  //! Remove all the values and reserve space for the given number of values
+  void Reset(size_t capacity)
+  {
+    this->Size = 0;
+    if (capacity > this->Capacity)
+    {
+      this->Reserve(capacity);
+    }
+  }
+
+  void Reserve(size_t capacity)
+  {
+    T* data = static_cast<T*>(std::realloc(this->Data, capacity * sizeof(T)));
+    if (!data)
+    {
+      throw std::bad_alloc();
+    }
+    this->Data = data;
+    this->Capacity = capacity;
+  }
+
+  //! Set the number of values, the new values are set to zero
+  void Resize(size_t size)
+  {
+    if (size > this->Capacity)
+    {
+      this->Reserve(size);
+    }
+    std::fill(this->Data + std::min(this->Size, size), this->Data + size, T());
+    this->Size = size;
+  }
+
+  void PushBack(const T& value)
+  {
+    if (this->Size == this->Capacity)
+    {
+      this->Reserve(std::max(static_cast<size_t>(1024), 2 * this->Capacity));
+    }
+    this->Data[this->Size++] = value;
+  }
+
+  T& operator[](size_t index) { return this->Data[index]; }
+  const T& operator[](size_t index) const { return this->Data[index]; }
+
+  size_t GetSize() const { return this->Size; }
+
+  /**
+   * @brief MoveTo give the values to a vtk array, without copy. The array must
+   * have its number of components already set. The buffer is empty afterward.
+   */
+  template<typename ArrayType>
+  void MoveTo(ArrayType* array)
+  {
+    if (this->Size == 0)
+    {
+      array->SetNumberOfTuples(0);
+      return;
+    }
+    array->SetArray(this->Data, static_cast<vtkIdType>(this->Size), 0,
+                    vtkAbstractArray::VTK_DATA_ARRAY_FREE);
+    this->Data = nullptr;
+    this->Size = 0;
+    this->Capacity = 0;
+  }
+
+  /**
+   * @brief Reclaim take back the memory of a vtk array previously filled with MoveTo,
+   * so that it can be reused to build a new frame. The array is left empty. The array
+   * must not be used by anybody else, and its memory must have been allocated with malloc,
+   * which is the case of the arrays given by MoveTo, even if vtk has resized them.
+   */
+  template<typename ArrayType>
+  void Reclaim(ArrayType* array)
+  {
+    T* data = array->GetPointer(0);
+    const size_t capacity = static_cast<size_t>(array->GetSize());
+    if (!data || capacity <= this->Capacity)
+    {
+      array->Initialize();
+      return;
+    }
+    // setting the same pointer with save = 1 only drops the ownership
+    array->SetArray(data, static_cast<vtkIdType>(capacity), 1);
+    array->SetArray(nullptr, 0, 1);
+    std::free(this->Data);
+    this->Data = data;
+    this->Size = 0;
+    this->Capacity = capacity;
+  }
+
+private:
+  T* Data = nullptr;
+  size_t Size = 0;
+  size_t Capacity = 0;
+};
+
+#endif // FRAMEBUILDERARRAY_H
@@ -0,0 +1,236 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "FrameCSVWriter.h"
+#include "ParallelFor.h"
+
+// STD
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+// VTK
+#include <vtkType.h>
+#include <vtk_zlib.h>
+
+namespace
+{
+//! Write the value at index in out and return the end of the written text
+typedef char* (*FormatValue)(const unsigned char* data, uint64_t index, char* out);
+
+//! Enough for a 64 bits integer, or a double such as "-1.234567890123456e-308", and a separator
+const size_t MaxValueLength = 32;
+const uint64_t RowsPerBlock = 1 << 14;
+
+//-----------------------------------------------------------------------------
+template <typename T>
+char* FormatInteger(const unsigned char* data, uint64_t index, char* out)
+{
+  T value;
+  std::memcpy(&value, data + index * sizeof(T), sizeof(T));
+  const bool isNegative = std::is_signed<T>::value && value < static_cast<T>(0);
+  uint64_t magnitude = static_cast<uint64_t>(value);
+  if (isNegative)
+  {
+    magnitude = 0 - magnitude;
+    *out++ = '-';
+  }
+  // the digits are found from the last one
+  char digits[20];
+  char* digit = digits + sizeof(digits);
+  do
+  {
+    *--digit = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude);
+  const size_t length = digits + sizeof(digits) - digit;
+  std::memcpy(out, digit, length);
+  return out + length;
+}
+
+//-----------------------------------------------------------------------------
+template <typename T>
+char* FormatFloatingPoint(const unsigned char* data, uint64_t index, char* out)
+{
+  T value;
+  std::memcpy(&value, data + index * sizeof(T), sizeof(T));
+  return out + std::snprintf(out, MaxValueLength, "%.16g", static_cast<double>(value));
+}
+
+//-----------------------------------------------------------------------------
+FormatValue GetFormatValue(int dataType)
+{
+  switch (dataType)
+  {
+    case VTK_FLOAT: return &FormatFloatingPoint<float>;
+    case VTK_DOUBLE: return &FormatFloatingPoint<double>;
+    case VTK_CHAR: return &FormatInteger<char>;
+    case VTK_SIGNED_CHAR: return &FormatInteger<signed char>;
+    case VTK_UNSIGNED_CHAR: return &FormatInteger<unsigned char>;
+    case VTK_SHORT: return &FormatInteger<short>;
+    case VTK_UNSIGNED_SHORT: return &FormatInteger<unsigned short>;
+    case VTK_INT: return &FormatInteger<int>;
+    case VTK_UNSIGNED_INT: return &FormatInteger<unsigned int>;
+    case VTK_LONG: return &FormatInteger<long>;
+    case VTK_UNSIGNED_LONG: return &FormatInteger<unsigned long>;
+    case VTK_LONG_LONG: return &FormatInteger<long long>;
+    case VTK_UNSIGNED_LONG_LONG: return &FormatInteger<unsigned long long>;
+    case VTK_ID_TYPE: return &FormatInteger<vtkIdType>;
+    default: return nullptr;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void AppendQuoted(const std::string& name, std::string& header)
+{
+  header += '"';
+  for (char c : name)
+  {
+    header += c;
+    if (c == '"')
+    {
+      header += '"';
+    }
+  }
+  header += '"';
+}
+
+//-----------------------------------------------------------------------------
+std::string GetHeader(const std::vector<FrameArchiveColumn>& columns)
+{
+  std::string header;
+  for (const FrameArchiveColumn& column : columns)
+  {
+    const std::string name = column.Kind == FrameArchiveColumn::Points ? "Points" : column.Name;
+    for (uint32_t component = 0; component < column.NumberOfComponents; ++component)
+    {
+      if (!header.empty())
+      {
+        header += ',';
+      }
+      AppendQuoted(column.NumberOfComponents > 1 || column.Kind == FrameArchiveColumn::Points
+                   ? name + ":" + std::to_string(component) : name, header);
+    }
+  }
+  return header + '\n';
+}
+
+//-----------------------------------------------------------------------------
+//! Compress input as a complete gzip member
+bool DeflateGzip(const std::string& input, int level, std::string& output)
+{
+  z_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  // adding 16 to the window bits writes a gzip header and trailer instead of the zlib ones
+  if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+  {
+    return false;
+  }
+  output.resize(deflateBound(&stream, static_cast<uLong>(input.size())) + 32);
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  stream.avail_in = static_cast<uInt>(input.size());
+  stream.next_out = reinterpret_cast<Bytef*>(&output[0]);
+  stream.avail_out = static_cast<uInt>(output.size());
+  const bool isDeflated = deflate(&stream, Z_FINISH) == Z_STREAM_END;
+  output.resize(stream.total_out);
+  deflateEnd(&stream);
+  return isDeflated;
+}
+}
+
+//-----------------------------------------------------------------------------
+bool FrameCSVWriter::WriteFrame(const std::string& filename, uint64_t numberOfPoints,
+                                const std::vector<FrameArchiveColumn>& columns)
+{
+  std::vector<FormatValue> formats;
+  size_t valuesPerRow = 0;
+  for (const FrameArchiveColumn& column : columns)
+  {
+    formats.push_back(GetFormatValue(column.DataType));
+    if (!formats.back() || column.Size != numberOfPoints * column.NumberOfComponents * column.ValueSize)
+    {
+      return false;
+    }
+    valuesPerRow += column.NumberOfComponents;
+  }
+  if (valuesPerRow == 0)
+  {
+    numberOfPoints = 0;
+  }
+  const std::string header = GetHeader(columns);
+
+  // the header is written with the first block, so that there is at least one block
+  const size_t nbBlocks = std::max<uint64_t>(1, (numberOfPoints + RowsPerBlock - 1) / RowsPerBlock);
+  this->Blocks.resize(nbBlocks);
+  const unsigned int nbThreads =
+    Parallel::GetNumberOfThreads(static_cast<unsigned int>(std::max(0, this->NumberOfThreads)));
+
+  // text of a block of each thread, before its compression
+  std::vector<std::string> texts(nbThreads);
+  std::atomic<bool> failed(false);
+  Parallel::ForEachChunk(nbBlocks, 1, nbThreads, [&](unsigned int thread, size_t block, size_t)
+  {
+    if (failed)
+    {
+      return;
+    }
+    std::string& output = this->CompressionLevel > 0 ? texts[thread] : this->Blocks[block];
+    const uint64_t firstRow = block * RowsPerBlock;
+    const uint64_t lastRow = std::min(numberOfPoints, firstRow + RowsPerBlock);
+    const size_t headerSize = block == 0 ? header.size() : 0;
+    output.resize(headerSize + (lastRow - firstRow) * valuesPerRow * MaxValueLength);
+    char* begin = &output[0];
+    std::memcpy(begin, header.data(), headerSize);
+    char* out = begin + headerSize;
+    for (uint64_t row = firstRow; row < lastRow; ++row)
+    {
+      for (size_t i = 0; i < columns.size(); ++i)
+      {
+        const uint32_t nbComponents = columns[i].NumberOfComponents;
+        for (uint32_t component = 0; component < nbComponents; ++component)
+        {
+          out = formats[i](columns[i].Data, row * nbComponents + component, out);
+          *out++ = ',';
+        }
+      }
+      // the last separator ends the row
+      *(out - 1) = '\n';
+    }
+    output.resize(out - begin);
+
+    if (this->CompressionLevel > 0 &&
+        !DeflateGzip(output, std::min(this->CompressionLevel, 9), this->Blocks[block]))
+    {
+      failed = true;
+    }
+  });
+  if (failed)
+  {
+    return false;
+  }
+
+  std::ofstream file(filename, std::ios::binary);
+  for (const std::string& block : this->Blocks)
+  {
+    file.write(block.data(), block.size());
+  }
+  return static_cast<bool>(file);
+}
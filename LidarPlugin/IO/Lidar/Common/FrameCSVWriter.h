@@ -0,0 +1,69 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef FRAMECSVWRITER_H
+#define FRAMECSVWRITER_H
+
+#include "FrameArchive.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * \class FrameCSVWriter
+ * \brief Write the points of a frame as a csv file, one row per point.
+ *
+ * The columns are the ones of vtkLidarFrameArchiveReader::GetColumns: the coordinates
+ * of the points first, named "Points:0", "Points:1" and "Points:2", then each point data
+ * array, with one column per component. The names are quoted, the integer values are
+ * written as integers and the floating point values with 16 significant digits, as the
+ * csv writer of ParaView with a precision of 16.
+ *
+ * The rows are formatted by blocks, in parallel, then written with one call per block.
+ * When compressed, each block is deflated by the thread which formatted it into a gzip
+ * member of its own. The members are concatenated, which is still a valid gzip file.
+ */
+class FrameCSVWriter
+{
+public:
+  //! 0 to write plain text, up to 9 for the smallest gzip file
+  void SetCompressionLevel(int level) { this->CompressionLevel = level; }
+  int GetCompressionLevel() const { return this->CompressionLevel; }
+
+  //! Number of threads formatting the rows, 0 to use all the cores
+  void SetNumberOfThreads(int nbThreads) { this->NumberOfThreads = nbThreads; }
+  int GetNumberOfThreads() const { return this->NumberOfThreads; }
+
+  /**
+   * @brief WriteFrame write a frame, overwriting the file
+   * @param filename the csv file, to which the caller adds a .gz extension when compressed
+   * @param numberOfPoints number of rows
+   * @param columns points and point data of the frame
+   * @return false if a column has an unsupported type or the file could not be written
+   */
+  bool WriteFrame(const std::string& filename, uint64_t numberOfPoints,
+                  const std::vector<FrameArchiveColumn>& columns);
+
+private:
+  int CompressionLevel = 0;
+  int NumberOfThreads = 0;
+  //! Text, or compressed text, of each block of rows, kept from one frame to the next
+  std::vector<std::string> Blocks;
+};
+
+#endif // FRAMECSVWRITER_H
@@ -0,0 +1,120 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include "MemoryBudget.h"
+
+/**
+ * \class GenericFrameCache
+ * \brief Least recently used cache of decoded frames, bounded by a memory budget.
+ *
+ * FrameT is the type of the frames, a vtkDataObject whose memory size is given by
+ * GetActualMemorySize(). The cache is thread safe, so that it can also be shrunk by
+ * the MemoryBudget of the process from any thread, once it has joined it.
+ */
+template<typename FrameT>
+class GenericFrameCache : public MemoryBudget::Consumer
+{
+public:
+  GenericFrameCache() = default;
+  ~GenericFrameCache();
+
+  /**
+   * @brief JoinMemoryBudget share the MemoryBudget of the process with the other caches,
+   * in addition to the memory budget of this cache
+   * @param name name of the cache, shown to the user
+   * @param priority see MemoryBudget::Priority
+   */
+  void JoinMemoryBudget(const std::string& name, int priority);
+
+  /**
+   * @brief SetMemoryBudget set the maximum memory used by the cached frames,
+   * the least recently used frames are removed if needed
+   * @param budget in kibibytes, 0 disables the cache
+   */
+  void SetMemoryBudget(unsigned long budget);
+  unsigned long GetMemoryBudget() const { return this->Budget; }
+
+  //! Memory currently used by the cached frames, in kibibytes
+  unsigned long GetMemorySize() const
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    return this->MemorySize;
+  }
+
+  //! Return the cached frame and mark it as recently used, nullptr if it is not cached
+  vtkSmartPointer<FrameT> Get(int frameNumber);
+
+  //! True if the frame is cached, without changing its usage
+  bool Contains(int frameNumber) const
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    return this->Index.count(frameNumber) != 0;
+  }
+
+  //! Add a frame as the most recently used one
+  void Insert(int frameNumber, vtkSmartPointer<FrameT> frame);
+
+  void Clear();
+
+  //! Remove the least recently used frames to release memory, without waiting for the cache
+  unsigned long ReleaseMemory(unsigned long size) override;
+
+private:
+  GenericFrameCache(const GenericFrameCache&) = delete;
+  GenericFrameCache& operator=(const GenericFrameCache&) = delete;
+
+  //! Remove the least recently used frames until the size is below the budget,
+  //! the mutex must be locked
+  void Shrink();
+
+  //! Remove the least recently used frames to release size kibibytes, the mutex
+  //! must be locked
+  unsigned long RemoveLeastRecentlyUsed(unsigned long size);
+
+  //! Report the size to the MemoryBudget and release what it asks, the mutex must not be locked
+  void ReportMemorySize(unsigned long size);
+
+  typedef std::pair<int, vtkSmartPointer<FrameT> > Entry;
+
+  //! Cached frames, the most recently used first
+  std::list<Entry> Frames;
+  std::unordered_map<int, typename std::list<Entry>::iterator> Index;
+  unsigned long Budget = 0;
+  unsigned long MemorySize = 0;
+  mutable std::mutex Mutex;
+  bool IsInProcessBudget = false;
+};
+
+//! Cache of the lidar frames
+typedef GenericFrameCache<vtkPolyData> FrameCache;
+
+// Implementation
+#include "FrameCache.txx"
+
+#endif // FRAMECACHE_H
@@ -0,0 +1,163 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+//-----------------------------------------------------------------------------
+template<typename FrameT>
+GenericFrameCache<FrameT>::~GenericFrameCache()
+{
+  if (this->IsInProcessBudget)
+  {
+    ::MemoryBudget::GetInstance().Unregister(this);
+  }
+}
+
+//-----------------------------------------------------------------------------
+template<typename FrameT>
+void GenericFrameCache<FrameT>::JoinMemoryBudget(const std::string& name, int priority)
+{
+  if (!this->IsInProcessBudget)
+  {
+    this->IsInProcessBudget = true;
+    ::MemoryBudget::GetInstance().Register(this, name, priority);
+    this->ReportMemorySize(this->GetMemorySize());
+  }
+}
+
+//-----------------------------------------------------------------------------
+template<typename FrameT>
+void GenericFrameCache<FrameT>::SetMemoryBudget(unsigned long budget)
+{
+  unsigned long size;
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Budget = budget;
+    this->Shrink();
+    size = this->MemorySize;
+  }
+  this->ReportMemorySize(size);
+}
+
+//-----------------------------------------------------------------------------
+template<typename FrameT>
+vtkSmartPointer<FrameT> GenericFrameCache<FrameT>::Get(int frameNumber)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  auto it = this->Index.find(frameNumber);
+  if (it == this->Index.end())
+  {
+    return nullptr;
+  }
+  // move the frame at the front of the list
+  this->Frames.splice(this->Frames.begin(), this->Frames, it->second);
+  return it->second->second;
+}
+
+//-----------------------------------------------------------------------------
+template<typename FrameT>
+void GenericFrameCache<FrameT>::Insert(int frameNumber, vtkSmartPointer<FrameT> frame)
+{
+  unsigned long size;
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    if (!frame || this->Budget == 0)
+    {
+      return;
+    }
+    auto it = this->Index.find(frameNumber);
+    if (it != this->Index.end())
+    {
+      this->MemorySize -= it->second->second->GetActualMemorySize();
+      this->Frames.erase(it->second);
+    }
+    this->Frames.emplace_front(frameNumber, frame);
+    this->Index[frameNumber] = this->Frames.begin();
+    this->MemorySize += frame->GetActualMemorySize();
+    this->Shrink();
+    size = this->MemorySize;
+  }
+  this->ReportMemorySize(size);
+}
+
+//-----------------------------------------------------------------------------
+template<typename FrameT>
+void GenericFrameCache<FrameT>::Clear()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Frames.clear();
+    this->Index.clear();
+    this->MemorySize = 0;
+  }
+  this->ReportMemorySize(0);
+}
+
+//-----------------------------------------------------------------------------
+template<typename FrameT>
+unsigned long GenericFrameCache<FrameT>::ReleaseMemory(unsigned long size)
+{
+  std::unique_lock<std::mutex> lock(this->Mutex, std::try_to_lock);
+  return lock.owns_lock() ? this->RemoveLeastRecentlyUsed(size) : 0;
+}
+
+//-----------------------------------------------------------------------------
+template<typename FrameT>
+void GenericFrameCache<FrameT>::Shrink()
+{
+  if (this->MemorySize > this->Budget)
+  {
+    this->RemoveLeastRecentlyUsed(this->MemorySize - this->Budget);
+  }
+}
+
+//-----------------------------------------------------------------------------
+template<typename FrameT>
+unsigned long GenericFrameCache<FrameT>::RemoveLeastRecentlyUsed(unsigned long size)
+{
+  unsigned long released = 0;
+  while (!this->Frames.empty() && released < size)
+  {
+    const Entry& last = this->Frames.back();
+    const unsigned long frameSize = last.second->GetActualMemorySize();
+    this->MemorySize -= frameSize;
+    released += frameSize;
+    this->Index.erase(last.first);
+    this->Frames.pop_back();
+  }
+  return released;
+}
+
+//-----------------------------------------------------------------------------
+template<typename FrameT>
+void GenericFrameCache<FrameT>::ReportMemorySize(unsigned long size)
+{
+  if (!this->IsInProcessBudget)
+  {
+    return;
+  }
+  unsigned long excess = ::MemoryBudget::GetInstance().Report(this, size);
+  while (excess > 0)
+  {
+    unsigned long released;
+    {
+      std::lock_guard<std::mutex> lock(this->Mutex);
+      released = this->RemoveLeastRecentlyUsed(excess);
+      size = this->MemorySize;
+    }
+    excess = (released > 0) ? ::MemoryBudget::GetInstance().Report(this, size) : 0;
+  }
+}
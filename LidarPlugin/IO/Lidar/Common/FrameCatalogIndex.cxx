@@ -0,0 +1,235 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "FrameCatalogIndex.h"
+
+// STD
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+// BOOST
+#include <boost/filesystem.hpp>
+
+// LOCAL
+#include "RemotePcapFile.h"
+
+namespace
+{
+const char IndexMagic[8] = { 'L', 'V', 'F', 'I', 'D', 'X', '\0', '\0' };
+
+//-----------------------------------------------------------------------------
+struct IndexHeader
+{
+  char Magic[8];
+  uint32_t Version;
+  uint32_t FilePositionSize;
+  uint64_t PcapSize;
+  int64_t PcapModificationTime;
+  uint64_t NumberOfFrames;
+  uint32_t SettingsLength;
+};
+
+//-----------------------------------------------------------------------------
+template<typename T>
+void WriteValue(std::ostream& os, const T& value)
+{
+  os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+//-----------------------------------------------------------------------------
+template<typename T>
+bool ReadValue(std::istream& is, T& value)
+{
+  is.read(reinterpret_cast<char*>(&value), sizeof(T));
+  return is.good();
+}
+
+//-----------------------------------------------------------------------------
+// The modification time of a remote pcap is not checked, the sidecar published next to
+// it having been built from a local copy
+bool GetPcapStamp(const std::string& pcapFileName, uint64_t& size, int64_t& modificationTime)
+{
+  if (RemotePcapFile::IsRemote(pcapFileName))
+  {
+    int64_t remoteSize = 0;
+    std::string error;
+    modificationTime = 0;
+    if (!RemotePcapFile::GetRemoteSize(pcapFileName, remoteSize, error))
+    {
+      return false;
+    }
+    size = static_cast<uint64_t>(remoteSize);
+    return true;
+  }
+  boost::system::error_code errCode;
+  size = boost::filesystem::file_size(pcapFileName, errCode);
+  if (errCode)
+  {
+    return false;
+  }
+  modificationTime = boost::filesystem::last_write_time(pcapFileName, errCode);
+  return !errCode;
+}
+}
+
+//-----------------------------------------------------------------------------
+const char* const FrameCatalogIndex::DefaultExtension = ".lvindex";
+
+//-----------------------------------------------------------------------------
+std::string FrameCatalogIndex::GetIndexFileName(const std::string& pcapFileName,
+                                                const char* extension)
+{
+  // the sidecar of a remote pcap is kept in the local cache
+  if (RemotePcapFile::IsRemote(pcapFileName))
+  {
+    return RemotePcapFile::GetLocalFileName(pcapFileName, std::string("sidecar") + extension);
+  }
+  return pcapFileName + extension;
+}
+
+//-----------------------------------------------------------------------------
+bool FrameCatalogIndex::Read(const std::string& pcapFileName, const std::string& settings,
+                             const FrameInformation& prototype,
+                             std::vector<FrameInformation>& catalog,
+                             const char* extension)
+{
+  if (!prototype.SpecificInformation)
+  {
+    return false;
+  }
+
+  uint64_t pcapSize = 0;
+  int64_t pcapModificationTime = 0;
+  if (!GetPcapStamp(pcapFileName, pcapSize, pcapModificationTime))
+  {
+    return false;
+  }
+
+  // the sidecar of a remote pcap is fetched from the server the first time
+  const std::string indexFileName = GetIndexFileName(pcapFileName, extension);
+  const bool isRemote = RemotePcapFile::IsRemote(pcapFileName);
+  boost::system::error_code errCode;
+  if (isRemote && !boost::filesystem::exists(indexFileName, errCode))
+  {
+    RemotePcapFile::Download(pcapFileName + extension, indexFileName);
+  }
+
+  std::ifstream is(indexFileName, std::ios::binary);
+  if (!is.is_open())
+  {
+    return false;
+  }
+
+  // check that the index is up to date and has been built with the same settings
+  IndexHeader header;
+  if (!ReadValue(is, header)
+      || std::memcmp(header.Magic, IndexMagic, sizeof(IndexMagic)) != 0
+      || header.Version != FrameCatalogIndex::Version
+      || header.FilePositionSize != sizeof(fpos_t)
+      || header.PcapSize != pcapSize
+      || (!isRemote && header.PcapModificationTime != pcapModificationTime)
+      || header.SettingsLength != settings.size())
+  {
+    return false;
+  }
+  std::string storedSettings(header.SettingsLength, '\0');
+  is.read(&storedSettings[0], header.SettingsLength);
+  if (!is.good() || storedSettings != settings)
+  {
+    return false;
+  }
+
+  std::vector<FrameInformation> loadedCatalog(header.NumberOfFrames, prototype);
+  for (auto& frameInfo : loadedCatalog)
+  {
+    if (!ReadValue(is, frameInfo.FilePosition)
+        || !ReadValue(is, frameInfo.FirstPacketNetworkTime)
+        || !ReadValue(is, frameInfo.FirstPacketDataTime)
+        || !frameInfo.SpecificInformation->read(is))
+    {
+      return false;
+    }
+  }
+
+  catalog = std::move(loadedCatalog);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool FrameCatalogIndex::Write(const std::string& pcapFileName, const std::string& settings,
+                              const std::vector<FrameInformation>& catalog,
+                              const char* extension)
+{
+  IndexHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.Magic, IndexMagic, sizeof(IndexMagic));
+  header.Version = FrameCatalogIndex::Version;
+  header.FilePositionSize = sizeof(fpos_t);
+  header.NumberOfFrames = catalog.size();
+  header.SettingsLength = static_cast<uint32_t>(settings.size());
+  if (!GetPcapStamp(pcapFileName, header.PcapSize, header.PcapModificationTime))
+  {
+    return false;
+  }
+
+  const std::string indexFileName = GetIndexFileName(pcapFileName, extension);
+  const std::string temporaryFileName = indexFileName + ".tmp";
+  boost::system::error_code errCode;
+  if (RemotePcapFile::IsRemote(pcapFileName))
+  {
+    boost::filesystem::create_directories(boost::filesystem::path(indexFileName).parent_path(), errCode);
+  }
+  {
+    std::ofstream os(temporaryFileName, std::ios::binary | std::ios::trunc);
+    if (!os.is_open())
+    {
+      return false;
+    }
+
+    WriteValue(os, header);
+    os.write(settings.data(), settings.size());
+    for (const auto& frameInfo : catalog)
+    {
+      WriteValue(os, frameInfo.FilePosition);
+      WriteValue(os, frameInfo.FirstPacketNetworkTime);
+      WriteValue(os, frameInfo.FirstPacketDataTime);
+      if (!frameInfo.SpecificInformation || !frameInfo.SpecificInformation->write(os))
+      {
+        os.close();
+        std::remove(temporaryFileName.c_str());
+        return false;
+      }
+    }
+    if (!os.good())
+    {
+      os.close();
+      std::remove(temporaryFileName.c_str());
+      return false;
+    }
+  }
+
+  boost::filesystem::rename(temporaryFileName, indexFileName, errCode);
+  if (errCode)
+  {
+    std::remove(temporaryFileName.c_str());
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,82 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef FRAMECATALOGINDEX_H
+#define FRAMECATALOGINDEX_H
+
+#include <string>
+#include <vector>
+
+#include "FrameInformation.h"
+
+/**
+ * \class FrameCatalogIndex
+ * \brief Save and load the frame catalog of a pcap file in a small binary
+ *        sidecar file, so that the whole pcap does not need to be parsed
+ *        again the next time it is opened.
+ *
+ * The sidecar is keyed on the size and the last modification time of the pcap,
+ * and on a settings string provided by the caller (interpreter, port filter, ...).
+ * If any of them does not match, the sidecar is considered stale and ignored.
+ */
+class FrameCatalogIndex
+{
+public:
+  //! Version of the binary layout, to increase each time the layout changes
+  static const unsigned int Version = 1;
+
+  //! Extension of the sidecar of the lidar frames. The readers of other kinds of
+  //! frames stored in the same pcap use their own extension
+  static const char* const DefaultExtension;
+
+  /**
+   * @brief GetIndexFileName return the sidecar filename associated to a pcap file
+   * @param pcapFileName the pcap file
+   * @param extension extension appended to the pcap filename
+   */
+  static std::string GetIndexFileName(const std::string& pcapFileName,
+                                      const char* extension = DefaultExtension);
+
+  /**
+   * @brief Read load the frame catalog stored in the sidecar of a pcap file
+   * @param pcapFileName the pcap file whose sidecar should be read
+   * @param settings string describing the settings used to build the catalog
+   * @param prototype frame information used to instantiate the sensor specific information
+   * @param catalog[out] the loaded catalog, only modified on success
+   * @param extension extension of the sidecar
+   * @return true if a valid and up to date sidecar has been loaded
+   */
+  static bool Read(const std::string& pcapFileName, const std::string& settings,
+                   const FrameInformation& prototype, std::vector<FrameInformation>& catalog,
+                   const char* extension = DefaultExtension);
+
+  /**
+   * @brief Write save the frame catalog in the sidecar of a pcap file.
+   * The sidecar is first written in a temporary file which is then renamed, so that
+   * a concurrent reader never sees a partially written index.
+   * @param pcapFileName the pcap file whose sidecar should be written
+   * @param settings string describing the settings used to build the catalog
+   * @param catalog the catalog to save
+   * @param extension extension of the sidecar
+   * @return true on success
+   */
+  static bool Write(const std::string& pcapFileName, const std::string& settings,
+                    const std::vector<FrameInformation>& catalog,
+                    const char* extension = DefaultExtension);
+};
+
+#endif // FRAMECATALOGINDEX_H
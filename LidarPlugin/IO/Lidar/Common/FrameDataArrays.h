@@ -0,0 +1,170 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef FRAMEDATAARRAYS_H
+#define FRAMEDATAARRAYS_H
+
+#include "FrameBuilderArray.h"
+
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+/**
+ * Helpers shared by the packet interpreters to build the point data arrays of their
+ * frames in FrameBuilderArray buffers, and to take back the memory of the arrays of
+ * the recycled frames.
+ */
+
+//-----------------------------------------------------------------------------
+// Create a named array, added to the point data of the frame if any
+template<typename T>
+vtkSmartPointer<T> CreateDataArray(const char* name, vtkIdType np, vtkIdType prereserved_np, vtkPolyData* pd)
+{
+  vtkSmartPointer<T> array = vtkSmartPointer<T>::New();
+  array->Allocate(prereserved_np);
+  array->SetName(name);
+  if (np > 0)
+  {
+    array->SetNumberOfTuples(np);
+  }
+  if (pd)
+  {
+    pd->GetPointData()->AddArray(array);
+  }
+
+  return array;
+}
+
+//-----------------------------------------------------------------------------
+// Get the array of a recycled frame and take back its memory, or create a new array.
+// The array is part of the point data of the frame only if inPointData is true.
+template<typename T, typename Buffer>
+vtkSmartPointer<T> GetFrameDataArray(
+  const char* name, vtkPolyData* pd, bool inPointData, Buffer& buffer)
+{
+  vtkSmartPointer<T> array = T::SafeDownCast(pd->GetPointData()->GetAbstractArray(name));
+  if (!array)
+  {
+    // an array of another type is replaced
+    pd->GetPointData()->RemoveArray(name);
+    return CreateDataArray<T>(name, 0, 0, inPointData ? pd : nullptr);
+  }
+  buffer.Reclaim(array.GetPointer());
+  if (!inPointData)
+  {
+    pd->GetPointData()->RemoveArray(name);
+  }
+  return array;
+}
+
+//-----------------------------------------------------------------------------
+// Give a buffer to its array, only if the array is part of the frame. Otherwise
+// the buffer keeps its memory for the next frame.
+template<typename T, typename Buffer>
+void MoveToFrameDataArray(Buffer& buffer, T* array, vtkPolyData* pd)
+{
+  if (pd->GetPointData()->GetAbstractArray(array->GetName()) == array)
+  {
+    buffer.MoveTo(array);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Buffer of a coordinate array, built in single or double precision depending on
+// the precision asked by the interpreter when the frame starts
+class CoordinateBuilderArray
+{
+public:
+  bool IsSinglePrecision() const { return this->SinglePrecision; }
+  void SetSinglePrecision(bool singlePrecision) { this->SinglePrecision = singlePrecision; }
+
+  void Reset(size_t capacity)
+  {
+    this->SinglePrecision ? this->Float.Reset(capacity) : this->Double.Reset(capacity);
+  }
+
+  void Resize(size_t size)
+  {
+    this->SinglePrecision ? this->Float.Resize(size) : this->Double.Resize(size);
+  }
+
+  void PushBack(double value)
+  {
+    if (this->SinglePrecision)
+    {
+      this->Float.PushBack(static_cast<float>(value));
+    }
+    else
+    {
+      this->Double.PushBack(value);
+    }
+  }
+
+  double Get(size_t index) const
+  {
+    return this->SinglePrecision ? this->Float[index] : this->Double[index];
+  }
+
+  void Set(size_t index, double value)
+  {
+    if (this->SinglePrecision)
+    {
+      this->Float[index] = static_cast<float>(value);
+    }
+    else
+    {
+      this->Double[index] = value;
+    }
+  }
+
+  void Reclaim(vtkFloatArray* array) { this->Float.Reclaim(array); }
+  void Reclaim(vtkDoubleArray* array) { this->Double.Reclaim(array); }
+
+  void MoveTo(vtkDataArray* array)
+  {
+    if (this->SinglePrecision)
+    {
+      this->Float.MoveTo(vtkFloatArray::SafeDownCast(array));
+    }
+    else
+    {
+      this->Double.MoveTo(vtkDoubleArray::SafeDownCast(array));
+    }
+  }
+
+private:
+  FrameBuilderArray<float> Float;
+  FrameBuilderArray<double> Double;
+  bool SinglePrecision = false;
+};
+
+//-----------------------------------------------------------------------------
+// Same as GetFrameDataArray, for an array of the precision of its buffer
+inline vtkSmartPointer<vtkDataArray> GetFrameCoordinateArray(
+  const char* name, vtkPolyData* pd, bool inPointData, CoordinateBuilderArray& buffer)
+{
+  if (buffer.IsSinglePrecision())
+  {
+    return GetFrameDataArray<vtkFloatArray>(name, pd, inPointData, buffer);
+  }
+  return GetFrameDataArray<vtkDoubleArray>(name, pd, inPointData, buffer);
+}
+
+#endif // FRAMEDATAARRAYS_H
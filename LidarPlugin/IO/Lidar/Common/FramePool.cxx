@@ -0,0 +1,119 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "FramePool.h"
+
+// VTK
+#include <vtkCellArray.h>
+#include <vtkFieldData.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+bool AreArraysReleased(vtkFieldData* data)
+{
+  for (int i = 0; i < data->GetNumberOfArrays(); ++i)
+  {
+    vtkAbstractArray* array = data->GetAbstractArray(i);
+    if (array && array->GetReferenceCount() > 1)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+}
+
+//-----------------------------------------------------------------------------
+void FramePool::SetMaximumNumberOfFrames(size_t maximum)
+{
+  this->MaximumNumberOfFrames = maximum;
+  while (this->Frames.size() > this->MaximumNumberOfFrames)
+  {
+    this->Frames.pop_front();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void FramePool::Add(vtkPolyData* frame)
+{
+  if (this->MaximumNumberOfFrames == 0 || !frame)
+  {
+    return;
+  }
+  if (this->Frames.size() == this->MaximumNumberOfFrames)
+  {
+    this->Frames.pop_front();
+  }
+  this->Frames.push_back(frame);
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> FramePool::Acquire()
+{
+  vtkSmartPointer<vtkPolyData> acquired;
+  size_t numberOfSpareFrames = 0;
+  // the oldest frames are the most likely to have been released
+  for (auto it = this->Frames.begin(); it != this->Frames.end();)
+  {
+    if (!FramePool::IsReleased(*it))
+    {
+      ++it;
+    }
+    else if (!acquired)
+    {
+      acquired = *it;
+      it = this->Frames.erase(it);
+    }
+    else if (numberOfSpareFrames < NumberOfSpareFrames)
+    {
+      ++numberOfSpareFrames;
+      ++it;
+    }
+    else
+    {
+      // nobody uses it anymore and there are enough spare frames, release its memory
+      it = this->Frames.erase(it);
+    }
+  }
+  return acquired;
+}
+
+//-----------------------------------------------------------------------------
+bool FramePool::IsReleased(vtkPolyData* frame)
+{
+  if (frame->GetReferenceCount() > 1)
+  {
+    return false;
+  }
+  vtkPoints* points = frame->GetPoints();
+  if (points && (points->GetReferenceCount() > 1 || points->GetData()->GetReferenceCount() > 1))
+  {
+    return false;
+  }
+  // a frame without vertices returns a shared dummy cell array, which is not checked
+  vtkCellArray* verts = frame->GetVerts();
+  if (verts->GetNumberOfCells() > 0 &&
+      (verts->GetReferenceCount() > 1 || verts->GetData()->GetReferenceCount() > 1))
+  {
+    return false;
+  }
+  return AreArraysReleased(frame->GetPointData()) && AreArraysReleased(frame->GetFieldData());
+}
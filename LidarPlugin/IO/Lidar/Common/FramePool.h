@@ -0,0 +1,78 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <deque>
+
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+/**
+ * \class FramePool
+ * \brief Keep track of the frames produced by an interpreter, so that their
+ *        objects and memory can be reused once all the consumers have released them.
+ *
+ * A frame is considered released when the pool holds the only reference to it and to
+ * all its points, cells and data arrays. Checking this is safe even if the consumers
+ * live in other threads: nobody else can get a new reference to an object which is
+ * referenced only by the pool.
+ */
+class FramePool
+{
+public:
+  /**
+   * @brief SetMaximumNumberOfFrames set the maximum number of frames tracked by the pool.
+   * It should be greater than the number of frames kept by the consumers, otherwise
+   * the frames are forgotten before being released, and are never reused.
+   */
+  void SetMaximumNumberOfFrames(size_t maximum);
+  size_t GetMaximumNumberOfFrames() const { return this->MaximumNumberOfFrames; }
+
+  /**
+   * @brief Add start tracking a frame handed to the consumers
+   */
+  void Add(vtkPolyData* frame);
+
+  /**
+   * @brief Acquire return a released frame, which is not tracked anymore. Other released
+   * frames are forgotten, except a few ones for the next calls
+   * @return nullptr if no frame has been released
+   */
+  vtkSmartPointer<vtkPolyData> Acquire();
+
+  //! Forget all the frames
+  void Clear() { this->Frames.clear(); }
+
+  size_t GetNumberOfFrames() const { return this->Frames.size(); }
+
+  /**
+   * @brief IsReleased check if all the objects of a frame are only referenced once,
+   * ie by the frame itself, and the frame by the caller
+   */
+  static bool IsReleased(vtkPolyData* frame);
+
+private:
+  //! Number of released frames kept for the next calls to Acquire
+  static const size_t NumberOfSpareFrames = 2;
+
+  std::deque<vtkSmartPointer<vtkPolyData>> Frames;
+  size_t MaximumNumberOfFrames = 128;
+};
+
+#endif // FRAMEPOOL_H
@@ -0,0 +1,334 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "FramePublisher.h"
+#include "vtkLidarFrameArchiveReader.h"
+
+// STD
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+
+// VTK
+#include <vtkObject.h>
+#include <vtkSetGet.h>
+
+namespace
+{
+const char MessageMagic[4] = { 'L', 'V', 'F', 'M' };
+const char FragmentMagic[4] = { 'L', 'V', 'F', 'F' };
+}
+
+const uint32_t FramePublisher::Version;
+const size_t FramePublisher::MaximumFragmentSize;
+
+//-----------------------------------------------------------------------------
+FramePublisher::FramePublisher()
+  : MulticastSocket(IOService)
+  , NumberOfPendingFrames(0)
+  , NumberOfPublishedFrames(0)
+  , NumberOfSkippedFrames(0)
+  , NumberOfClients(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+FramePublisher::~FramePublisher()
+{
+  this->Stop();
+}
+
+//-----------------------------------------------------------------------------
+bool FramePublisher::Start()
+{
+  if (this->Thread)
+  {
+    return true;
+  }
+
+  this->IOService.reset();
+  this->Encoder.SetCompressionLevel(this->CompressionLevel);
+  this->Sequence = 0;
+  this->NumberOfPendingFrames = 0;
+  this->NumberOfPublishedFrames = 0;
+  this->NumberOfSkippedFrames = 0;
+  this->NumberOfClients = 0;
+
+  boost::system::error_code error;
+  if (this->TCPPort > 0)
+  {
+    using boost::asio::ip::tcp;
+    this->Acceptor.reset(new tcp::acceptor(this->IOService));
+    const tcp::endpoint endpoint(tcp::v4(), static_cast<unsigned short>(this->TCPPort));
+    this->Acceptor->open(endpoint.protocol(), error);
+    if (!error)
+    {
+      this->Acceptor->set_option(tcp::acceptor::reuse_address(true), error);
+      this->Acceptor->bind(endpoint, error);
+    }
+    if (!error)
+    {
+      this->Acceptor->listen(boost::asio::socket_base::max_connections, error);
+    }
+    if (error)
+    {
+      vtkGenericWarningMacro("The frames can not be published on port "
+                             << this->TCPPort << ": " << error.message());
+      this->Acceptor.reset();
+    }
+  }
+
+  this->IsMulticasting = false;
+  if (!this->MulticastAddress.empty() && this->MulticastPort > 0)
+  {
+    const auto address = boost::asio::ip::address::from_string(this->MulticastAddress, error);
+    if (!error)
+    {
+      this->MulticastEndpoint = boost::asio::ip::udp::endpoint(
+        address, static_cast<unsigned short>(this->MulticastPort));
+      this->MulticastSocket.open(this->MulticastEndpoint.protocol(), error);
+    }
+    if (!error)
+    {
+      // allow the consumers on the same machine to join the group
+      this->MulticastSocket.set_option(boost::asio::ip::multicast::enable_loopback(true), error);
+      this->IsMulticasting = true;
+    }
+    else
+    {
+      vtkGenericWarningMacro("The frames can not be published to " << this->MulticastAddress
+                             << ": " << error.message());
+    }
+  }
+
+  if (!this->SharedMemoryName.empty()
+      && !this->Ring.Create(this->SharedMemoryName, this->SharedMemoryNumberOfSlots,
+                            this->SharedMemorySlotSize))
+  {
+    vtkGenericWarningMacro("The shared memory " << this->SharedMemoryName
+                           << " can not be created");
+  }
+
+  if (!this->Acceptor && !this->IsMulticasting && !this->Ring.IsOpen())
+  {
+    return false;
+  }
+
+  if (this->Acceptor)
+  {
+    this->StartAccept();
+  }
+  this->Work.reset(new boost::asio::io_service::work(this->IOService));
+  this->Thread.reset(new boost::thread([this]() { this->IOService.run(); }));
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void FramePublisher::Stop()
+{
+  if (!this->Thread)
+  {
+    return;
+  }
+
+  this->Work.reset();
+  this->IOService.stop();
+  this->Thread->join();
+  this->Thread.reset();
+
+  boost::system::error_code ignored;
+  for (const auto& client : this->Clients)
+  {
+    client->Socket.close(ignored);
+  }
+  this->Clients.clear();
+  this->NumberOfClients = 0;
+  if (this->Acceptor)
+  {
+    this->Acceptor->close(ignored);
+  }
+  if (this->IsMulticasting)
+  {
+    this->MulticastSocket.close(ignored);
+    this->IsMulticasting = false;
+  }
+  this->Ring.Close();
+
+  // run the handlers left, the frames still queued are skipped as there is no
+  // output anymore, and the aborted operations release their client and message
+  this->IOService.reset();
+  this->IOService.poll();
+  this->Acceptor.reset();
+}
+
+//-----------------------------------------------------------------------------
+void FramePublisher::Publish(vtkSmartPointer<vtkPolyData> frame)
+{
+  if (!this->Thread || !frame)
+  {
+    return;
+  }
+  if (this->NumberOfPendingFrames.load() >= this->MaximumNumberOfPendingFrames)
+  {
+    ++this->NumberOfSkippedFrames;
+    return;
+  }
+  ++this->NumberOfPendingFrames;
+  this->IOService.post([this, frame]()
+  {
+    this->SendFrame(frame);
+    --this->NumberOfPendingFrames;
+  });
+}
+
+//-----------------------------------------------------------------------------
+void FramePublisher::StartAccept()
+{
+  auto client = std::make_shared<Client>(this->IOService);
+  this->Acceptor->async_accept(client->Socket,
+    [this, client](const boost::system::error_code& error)
+    {
+      if (error)
+      {
+        // the acceptor has been closed
+        return;
+      }
+      boost::system::error_code ignored;
+      client->Socket.set_option(boost::asio::ip::tcp::no_delay(true), ignored);
+      this->Clients.push_back(client);
+      this->NumberOfClients = this->Clients.size();
+      this->StartAccept();
+    });
+}
+
+//-----------------------------------------------------------------------------
+void FramePublisher::RemoveClient(const std::shared_ptr<Client>& client)
+{
+  boost::system::error_code ignored;
+  client->Socket.close(ignored);
+  this->Clients.erase(std::remove(this->Clients.begin(), this->Clients.end(), client),
+                      this->Clients.end());
+  this->NumberOfClients = this->Clients.size();
+}
+
+//-----------------------------------------------------------------------------
+void FramePublisher::SendFrame(vtkPolyData* frame)
+{
+  if (this->Clients.empty() && !this->IsMulticasting && !this->Ring.IsOpen())
+  {
+    return;
+  }
+
+  vtkLidarFrameArchiveReader::GetColumns(frame, this->Columns);
+  if (this->PointsAsFloat)
+  {
+    for (FrameArchiveColumn& column : this->Columns)
+    {
+      if (column.Kind == FrameArchiveColumn::Points && column.DataType == VTK_DOUBLE)
+      {
+        const size_t numberOfValues = column.Size / sizeof(double);
+        const double* values = reinterpret_cast<const double*>(column.Data);
+        this->FloatPoints.assign(values, values + numberOfValues);
+        column.DataType = VTK_FLOAT;
+        column.ValueSize = sizeof(float);
+        column.Data = reinterpret_cast<const unsigned char*>(this->FloatPoints.data());
+        column.Size = numberOfValues * sizeof(float);
+      }
+    }
+  }
+
+  // the header is a multiple of 8 bytes, so the columns stay aligned in the message
+  FrameMessageHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.Magic, MessageMagic, sizeof(MessageMagic));
+  header.Version = Version;
+  header.Sequence = this->Sequence++;
+  header.Time = std::chrono::duration<double>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  this->MessageStream.str("");
+  this->MessageStream.clear();
+  this->MessageStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  if (!this->Encoder.Encode(static_cast<uint64_t>(frame->GetNumberOfPoints()), this->Columns,
+                            this->MessageStream))
+  {
+    return;
+  }
+  auto message = std::make_shared<std::string>(this->MessageStream.str());
+  header.FrameSize = message->size() - sizeof(header);
+  std::memcpy(&(*message)[0], &header, sizeof(header));
+
+  // a client still receiving the previous frame skips this one
+  for (const auto& client : std::vector<std::shared_ptr<Client> >(this->Clients))
+  {
+    if (client->IsSending)
+    {
+      continue;
+    }
+    client->IsSending = true;
+    boost::asio::async_write(client->Socket, boost::asio::buffer(*message),
+      [this, client, message](const boost::system::error_code& error, size_t)
+      {
+        client->IsSending = false;
+        if (error)
+        {
+          this->RemoveClient(client);
+        }
+      });
+  }
+
+  if (this->IsMulticasting)
+  {
+    this->SendToMulticastGroup(*message, header.Sequence);
+  }
+  if (this->Ring.IsOpen())
+  {
+    this->Ring.Write(reinterpret_cast<const unsigned char*>(message->data()), message->size());
+  }
+  ++this->NumberOfPublishedFrames;
+}
+
+//-----------------------------------------------------------------------------
+void FramePublisher::SendToMulticastGroup(const std::string& message, uint64_t sequence)
+{
+  FrameFragmentHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.Magic, FragmentMagic, sizeof(FragmentMagic));
+  header.Version = Version;
+  header.Sequence = sequence;
+  header.NumberOfFragments =
+    static_cast<uint32_t>((message.size() + MaximumFragmentSize - 1) / MaximumFragmentSize);
+  header.MessageSize = message.size();
+
+  boost::system::error_code error;
+  for (uint32_t i = 0; i < header.NumberOfFragments; ++i)
+  {
+    header.FragmentIndex = i;
+    const size_t offset = i * MaximumFragmentSize;
+    const std::array<boost::asio::const_buffer, 2> datagram = { {
+      boost::asio::buffer(&header, sizeof(header)),
+      boost::asio::buffer(message.data() + offset,
+                          std::min(MaximumFragmentSize, message.size() - offset)) } };
+    this->MulticastSocket.send_to(datagram, this->MulticastEndpoint, 0, error);
+    if (error)
+    {
+      // the message is lost anyway for the receivers
+      return;
+    }
+  }
+}
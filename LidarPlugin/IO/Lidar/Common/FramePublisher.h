@@ -0,0 +1,181 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef FRAMEPUBLISHER_H
+#define FRAMEPUBLISHER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include "FrameArchive.h"
+#include "SharedFrameRing.h"
+
+/**
+ * @brief Header of a published frame, followed by the frame encoded by FrameEncoder.
+ * All values are in the byte order of the publisher, as in a frame archive.
+ */
+struct FrameMessageHeader
+{
+  //! "LVFM"
+  char Magic[4];
+  uint32_t Version;
+  //! Number of the frame since the publisher was started, to detect the skipped frames
+  uint64_t Sequence;
+  //! Time of the publication, in seconds since the epoch
+  double Time;
+  //! Size of the encoded frame following the header
+  uint64_t FrameSize;
+};
+
+/**
+ * @brief Header of a multicast datagram, followed by a fragment of a message
+ * (a FrameMessageHeader and the encoded frame). A message is complete once all
+ * the fragments of its sequence are received, it is lost if one of them is missing.
+ */
+struct FrameFragmentHeader
+{
+  //! "LVFF"
+  char Magic[4];
+  uint32_t Version;
+  uint64_t Sequence;
+  uint32_t FragmentIndex;
+  uint32_t NumberOfFragments;
+  //! Size of the whole message, the fragments being at FragmentIndex * MaximumFragmentSize
+  uint64_t MessageSize;
+};
+
+/**
+ * \class FramePublisher
+ * \brief Publish the decoded frames of a live stream, so that other processes get the
+ *        points without decoding the packets again.
+ *
+ * The frames are encoded as in a frame archive, with their points and point data arrays
+ * stored as columns, optionally compressed, and decoded by FrameDecoder. Each frame is
+ * sent as a message:
+ *  - to the clients connected to TCPPort, in the order of the frames, as a FrameMessageHeader
+ *    followed by the encoded frame.
+ *  - to the multicast group, split in datagrams of at most MaximumFragmentSize bytes
+ *    after their FrameFragmentHeader.
+ *  - to the named shared memory ring read by the local consumers, see SharedFrameRing,
+ *    which avoids the copies of the network stack.
+ *
+ * The frames are encoded and sent from the thread of the publisher, never from the
+ * thread decoding the packets. A frame is skipped when too many frames are waiting to
+ * be sent, and a client is skipped when it has not received the previous frame yet, so
+ * that a slow consumer never delays the decoding nor the other consumers.
+ */
+class FramePublisher
+{
+public:
+  FramePublisher();
+  ~FramePublisher();
+
+  /**
+   * @brief Start publishing, the settings below are taken into account the next time
+   * the publisher is started
+   * @return false if nothing is published, because no output is set or it can not be opened
+   */
+  bool Start();
+  void Stop();
+
+  bool IsRunning() const { return this->Thread != nullptr; }
+
+  //! Queue a frame to publish, the frame must not be modified anymore
+  void Publish(vtkSmartPointer<vtkPolyData> frame);
+
+  //! TCP port on which the clients connect, 0 to disable
+  int TCPPort = 0;
+  //! Multicast group to which the frames are sent, nothing is sent if empty
+  std::string MulticastAddress = "";
+  int MulticastPort = 0;
+  //! Name of the shared memory ring, nothing is written if empty
+  std::string SharedMemoryName = "";
+  //! Number of frames kept by the shared memory ring
+  size_t SharedMemoryNumberOfSlots = 4;
+  //! Maximum size of a message in the shared memory ring, the larger frames are skipped
+  size_t SharedMemorySlotSize = 16 << 20;
+  //! 0 to send the columns raw, up to 9 for the smallest messages
+  int CompressionLevel = 0;
+  //! Send the coordinates of the points as float, halving their size, if they are double
+  bool PointsAsFloat = false;
+  //! Number of frames which can wait to be sent, the newer frames are skipped beyond
+  size_t MaximumNumberOfPendingFrames = 2;
+
+  static const uint32_t Version = 1;
+  //! Maximum size of the fragment of a message in a datagram, so that it is not fragmented
+  //! by an ethernet network
+  static const size_t MaximumFragmentSize = 1400;
+
+  //! Number of frames sent since the publisher was started
+  size_t GetNumberOfPublishedFrames() const { return this->NumberOfPublishedFrames.load(); }
+
+  //! Number of frames skipped since the publisher was started, because it was busy
+  size_t GetNumberOfSkippedFrames() const { return this->NumberOfSkippedFrames.load(); }
+
+  //! Number of connected TCP clients
+  size_t GetNumberOfClients() const { return this->NumberOfClients.load(); }
+
+private:
+  FramePublisher(const FramePublisher&) = delete;
+  void operator=(const FramePublisher&) = delete;
+
+  struct Client
+  {
+    explicit Client(boost::asio::io_service& service) : Socket(service) {}
+    boost::asio::ip::tcp::socket Socket;
+    //! The previous message is still being sent
+    bool IsSending = false;
+  };
+
+  void StartAccept();
+  void SendFrame(vtkPolyData* frame);
+  void SendToMulticastGroup(const std::string& message, uint64_t sequence);
+  void RemoveClient(const std::shared_ptr<Client>& client);
+
+  // only used from the thread of the publisher
+  boost::asio::io_service IOService;
+  std::unique_ptr<boost::asio::io_service::work> Work;
+  std::unique_ptr<boost::asio::ip::tcp::acceptor> Acceptor;
+  std::vector<std::shared_ptr<Client> > Clients;
+  boost::asio::ip::udp::socket MulticastSocket;
+  boost::asio::ip::udp::endpoint MulticastEndpoint;
+  bool IsMulticasting = false;
+  SharedFrameRing Ring;
+  FrameEncoder Encoder;
+  std::vector<FrameArchiveColumn> Columns;
+  std::vector<float> FloatPoints;
+  std::ostringstream MessageStream;
+  uint64_t Sequence = 0;
+
+  std::atomic<size_t> NumberOfPendingFrames;
+  std::atomic<size_t> NumberOfPublishedFrames;
+  std::atomic<size_t> NumberOfSkippedFrames;
+  std::atomic<size_t> NumberOfClients;
+  std::unique_ptr<boost::thread> Thread;
+};
+
+#endif // FRAMEPUBLISHER_H
@@ -0,0 +1,231 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "FrameTensorWriter.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+// VTK
+#include <vtkType.h>
+
+namespace
+{
+//! Size of the NPY header, magic string included, large enough for any number of frames
+const size_t HeaderSize = 128;
+
+//! Read the value at index of a column as a double
+typedef double (*GetValue)(const unsigned char* data, uint64_t index);
+
+//-----------------------------------------------------------------------------
+template <typename T>
+double GetValueAs(const unsigned char* data, uint64_t index)
+{
+  T value;
+  std::memcpy(&value, data + index * sizeof(T), sizeof(T));
+  return static_cast<double>(value);
+}
+
+//-----------------------------------------------------------------------------
+GetValue GetGetValue(int dataType)
+{
+  switch (dataType)
+  {
+    case VTK_FLOAT: return &GetValueAs<float>;
+    case VTK_DOUBLE: return &GetValueAs<double>;
+    case VTK_CHAR: return &GetValueAs<char>;
+    case VTK_SIGNED_CHAR: return &GetValueAs<signed char>;
+    case VTK_UNSIGNED_CHAR: return &GetValueAs<unsigned char>;
+    case VTK_SHORT: return &GetValueAs<short>;
+    case VTK_UNSIGNED_SHORT: return &GetValueAs<unsigned short>;
+    case VTK_INT: return &GetValueAs<int>;
+    case VTK_UNSIGNED_INT: return &GetValueAs<unsigned int>;
+    case VTK_LONG: return &GetValueAs<long>;
+    case VTK_UNSIGNED_LONG: return &GetValueAs<unsigned long>;
+    case VTK_LONG_LONG: return &GetValueAs<long long>;
+    case VTK_UNSIGNED_LONG_LONG: return &GetValueAs<unsigned long long>;
+    case VTK_ID_TYPE: return &GetValueAs<vtkIdType>;
+    default: return nullptr;
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! Find a column with one value per point, nullptr if there is none
+const FrameArchiveColumn* FindColumn(const std::vector<FrameArchiveColumn>& columns,
+                                     FrameArchiveColumn::ColumnKind kind, const std::string& name,
+                                     uint32_t numberOfComponents, uint64_t numberOfPoints)
+{
+  for (const FrameArchiveColumn& column : columns)
+  {
+    if (column.Kind == kind && (kind == FrameArchiveColumn::Points || column.Name == name)
+        && column.NumberOfComponents == numberOfComponents && GetGetValue(column.DataType)
+        && column.Size == numberOfPoints * numberOfComponents * column.ValueSize)
+    {
+      return &column;
+    }
+  }
+  return nullptr;
+}
+}
+
+//-----------------------------------------------------------------------------
+FrameTensorWriter::~FrameTensorWriter()
+{
+  this->Close();
+}
+
+//-----------------------------------------------------------------------------
+std::vector<int> FrameTensorWriter::SortLasersVertically(const std::vector<double>& verticalCorrections)
+{
+  std::vector<std::pair<double, int> > sorted(verticalCorrections.size());
+  for (size_t laser = 0; laser < verticalCorrections.size(); ++laser)
+  {
+    sorted[laser] = std::make_pair(verticalCorrections[laser], static_cast<int>(laser));
+  }
+  std::sort(sorted.begin(), sorted.end());
+  std::vector<int> rows(sorted.size());
+  for (size_t row = 0; row < sorted.size(); ++row)
+  {
+    rows[sorted[row].second] = static_cast<int>(row);
+  }
+  return rows;
+}
+
+//-----------------------------------------------------------------------------
+bool FrameTensorWriter::Open(const std::string& filename, const std::vector<int>& laserRows, int width)
+{
+  this->Close();
+  if (laserRows.empty() || width <= 0)
+  {
+    return false;
+  }
+  this->LaserRows = laserRows;
+  this->Height = static_cast<int>(laserRows.size());
+  this->Width = width;
+  this->NumberOfFrames = 0;
+  this->Tensor.assign(static_cast<size_t>(NumberOfChannels) * this->Height * this->Width, 0.f);
+
+  this->File.open(filename, std::ios::binary | std::ios::trunc);
+  return this->File.is_open() && this->WriteHeader();
+}
+
+//-----------------------------------------------------------------------------
+bool FrameTensorWriter::WriteHeader()
+{
+  const uint16_t one = 1;
+  unsigned char isLittleEndian;
+  std::memcpy(&isLittleEndian, &one, 1);
+
+  // NPY format 1.0: magic string, version, little endian length of the header, and the
+  // header as a python dict padded with spaces and ending with a new line
+  std::string dict = std::string("{'descr': '") + (isLittleEndian ? "<" : ">")
+    + "f4', 'fortran_order': False, 'shape': (" + std::to_string(this->NumberOfFrames) + ", "
+    + std::to_string(static_cast<int>(NumberOfChannels)) + ", " + std::to_string(this->Height)
+    + ", " + std::to_string(this->Width) + "), }";
+  const size_t prefixSize = 10;
+  if (prefixSize + dict.size() + 1 > HeaderSize)
+  {
+    return false;
+  }
+  dict.resize(HeaderSize - prefixSize - 1, ' ');
+  dict += '\n';
+
+  const uint16_t dictSize = static_cast<uint16_t>(dict.size());
+  const unsigned char prefix[prefixSize] = { 0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0,
+    static_cast<unsigned char>(dictSize & 0xff), static_cast<unsigned char>(dictSize >> 8) };
+  this->File.seekp(0);
+  this->File.write(reinterpret_cast<const char*>(prefix), prefixSize);
+  this->File.write(dict.data(), dict.size());
+  return this->File.good();
+}
+
+//-----------------------------------------------------------------------------
+bool FrameTensorWriter::WriteFrame(uint64_t numberOfPoints, const std::vector<FrameArchiveColumn>& columns)
+{
+  if (!this->File.is_open())
+  {
+    return false;
+  }
+  const FrameArchiveColumn* points = FindColumn(columns, FrameArchiveColumn::Points, "", 3, numberOfPoints);
+  const FrameArchiveColumn* azimuth = FindColumn(columns, FrameArchiveColumn::PointData, "azimuth", 1, numberOfPoints);
+  const FrameArchiveColumn* laserId = FindColumn(columns, FrameArchiveColumn::PointData, "laser_id", 1, numberOfPoints);
+  const FrameArchiveColumn* intensity = FindColumn(columns, FrameArchiveColumn::PointData, "intensity", 1, numberOfPoints);
+  const FrameArchiveColumn* distance = FindColumn(columns, FrameArchiveColumn::PointData, "distance_m", 1, numberOfPoints);
+  if (numberOfPoints > 0 && (!points || !azimuth || !laserId))
+  {
+    return false;
+  }
+
+  std::fill(this->Tensor.begin(), this->Tensor.end(), 0.f);
+  if (numberOfPoints > 0)
+  {
+    const GetValue getPoint = GetGetValue(points->DataType);
+    const GetValue getAzimuth = GetGetValue(azimuth->DataType);
+    const GetValue getLaserId = GetGetValue(laserId->DataType);
+    const GetValue getIntensity = intensity ? GetGetValue(intensity->DataType) : nullptr;
+    const GetValue getDistance = distance ? GetGetValue(distance->DataType) : nullptr;
+    const size_t channelSize = static_cast<size_t>(this->Height) * this->Width;
+    const int numberOfLasers = static_cast<int>(this->LaserRows.size());
+    for (uint64_t i = 0; i < numberOfPoints; ++i)
+    {
+      // the pixel of the point, as in vtkLidarRawSignalImage
+      const int w = static_cast<int>(std::floor(getAzimuth(azimuth->Data, i) / 36000.0 * this->Width));
+      const int laser = static_cast<int>(getLaserId(laserId->Data, i));
+      if (w < 0 || w >= this->Width || laser < 0 || laser >= numberOfLasers)
+      {
+        continue;
+      }
+      const size_t pixel = static_cast<size_t>(this->LaserRows[laser]) * this->Width + w;
+
+      const double x = getPoint(points->Data, i * 3);
+      const double y = getPoint(points->Data, i * 3 + 1);
+      const double z = getPoint(points->Data, i * 3 + 2);
+      const double range = getDistance ? getDistance(distance->Data, i) : std::sqrt(x * x + y * y + z * z);
+      this->Tensor[Range * channelSize + pixel] = static_cast<float>(range);
+      this->Tensor[Intensity * channelSize + pixel] =
+        getIntensity ? static_cast<float>(getIntensity(intensity->Data, i)) : 0.f;
+      this->Tensor[X * channelSize + pixel] = static_cast<float>(x);
+      this->Tensor[Y * channelSize + pixel] = static_cast<float>(y);
+      this->Tensor[Z * channelSize + pixel] = static_cast<float>(z);
+    }
+  }
+
+  // the whole tensor of the frame in one write, the file stays at its end between the frames
+  this->File.write(reinterpret_cast<const char*>(this->Tensor.data()), this->Tensor.size() * sizeof(float));
+  if (!this->File.good())
+  {
+    return false;
+  }
+  ++this->NumberOfFrames;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool FrameTensorWriter::Close()
+{
+  if (!this->File.is_open())
+  {
+    return true;
+  }
+  const bool isWritten = this->File.good() && this->WriteHeader();
+  this->File.close();
+  return isWritten;
+}
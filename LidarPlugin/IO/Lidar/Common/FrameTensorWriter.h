@@ -0,0 +1,102 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef FRAMETENSORWRITER_H
+#define FRAMETENSORWRITER_H
+
+#include "FrameArchive.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * \class FrameTensorWriter
+ * \brief Write the frames projected as multi-channel images in a single NPY file,
+ * to train networks on the raw signal images without going through the GUI.
+ *
+ * Each frame is projected as vtkLidarRawSignalImage does: a row per laser, sorted by
+ * vertical angle, and a column per azimuth bin, the last point of a pixel giving its
+ * value and the empty pixels being 0. The channels are, in this order: the range, the
+ * intensity, and the x, y and z coordinates of the point.
+ *
+ * The file is a float32 array of shape (frames, channels, lasers, azimuth bins) in C
+ * order, which numpy.load can map in memory. Each frame is appended with a single write,
+ * and the number of frames is set in the header when the file is closed.
+ */
+class FrameTensorWriter
+{
+public:
+  enum Channel
+  {
+    Range = 0,
+    Intensity,
+    X,
+    Y,
+    Z,
+    NumberOfChannels
+  };
+
+  ~FrameTensorWriter();
+
+  /**
+   * @brief SortLasersVertically give the row of each laser, the lowest laser being on
+   * the row 0 as in vtkLidarRawSignalImage
+   * @param verticalCorrections vertical angle of each laser, from the calibration
+   */
+  static std::vector<int> SortLasersVertically(const std::vector<double>& verticalCorrections);
+
+  /**
+   * @brief Open create the file, overwriting it
+   * @param laserRows row of each laser, see SortLasersVertically
+   * @param width number of azimuth bins
+   */
+  bool Open(const std::string& filename, const std::vector<int>& laserRows, int width);
+
+  /**
+   * @brief WriteFrame project a frame and append it
+   * @param numberOfPoints number of points of the frame
+   * @param columns points and point data of the frame, see vtkLidarFrameArchiveReader::GetColumns.
+   * The "azimuth" (in hundredths of degree) and "laser_id" arrays are required, "intensity"
+   * and "distance_m" are used if present, the range being computed from the point otherwise.
+   * @return false if a required column is missing or the file could not be written
+   */
+  bool WriteFrame(uint64_t numberOfPoints, const std::vector<FrameArchiveColumn>& columns);
+
+  //! Write the number of frames in the header and close the file, called by the destructor
+  bool Close();
+
+  bool IsOpen() const { return this->File.is_open(); }
+  uint64_t GetNumberOfFrames() const { return this->NumberOfFrames; }
+
+  //! Tensor of the last frame written, NumberOfChannels x lasers x width
+  const std::vector<float>& GetTensor() const { return this->Tensor; }
+
+private:
+  //! Write the NPY header, always of the same size so that it can be rewritten
+  bool WriteHeader();
+
+  std::ofstream File;
+  std::vector<int> LaserRows;
+  int Height = 0;
+  int Width = 0;
+  uint64_t NumberOfFrames = 0;
+  std::vector<float> Tensor;
+};
+
+#endif // FRAMETENSORWRITER_H
@@ -0,0 +1,414 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "FrameWebWriter.h"
+#include "ParallelFor.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <unordered_set>
+
+// BOOST
+#include <boost/filesystem.hpp>
+
+// VTK
+#include <vtkType.h>
+
+namespace
+{
+//! Number of cells along an edge of a tile at the level 0
+const int FirstLevelCells = 16;
+//! The grid of the last level but one has FirstLevelCells << (MaxLevels - 2) cells per edge
+const int MaxLevels = 8;
+const double MaxQuantizedCoordinate = 65535.0;
+
+//! Read the value at index of a column as a double
+typedef double (*GetValue)(const unsigned char* data, uint64_t index);
+
+//-----------------------------------------------------------------------------
+template <typename T>
+double GetValueAs(const unsigned char* data, uint64_t index)
+{
+  T value;
+  std::memcpy(&value, data + index * sizeof(T), sizeof(T));
+  return static_cast<double>(value);
+}
+
+//-----------------------------------------------------------------------------
+GetValue GetGetValue(int dataType)
+{
+  switch (dataType)
+  {
+    case VTK_FLOAT: return &GetValueAs<float>;
+    case VTK_DOUBLE: return &GetValueAs<double>;
+    case VTK_CHAR: return &GetValueAs<char>;
+    case VTK_SIGNED_CHAR: return &GetValueAs<signed char>;
+    case VTK_UNSIGNED_CHAR: return &GetValueAs<unsigned char>;
+    case VTK_SHORT: return &GetValueAs<short>;
+    case VTK_UNSIGNED_SHORT: return &GetValueAs<unsigned short>;
+    case VTK_INT: return &GetValueAs<int>;
+    case VTK_UNSIGNED_INT: return &GetValueAs<unsigned int>;
+    case VTK_LONG: return &GetValueAs<long>;
+    case VTK_UNSIGNED_LONG: return &GetValueAs<unsigned long>;
+    case VTK_LONG_LONG: return &GetValueAs<long long>;
+    case VTK_UNSIGNED_LONG_LONG: return &GetValueAs<unsigned long long>;
+    case VTK_ID_TYPE: return &GetValueAs<vtkIdType>;
+    default: return nullptr;
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! Find a column with numberOfComponents values per point, nullptr if there is none
+const FrameArchiveColumn* FindColumn(const std::vector<FrameArchiveColumn>& columns,
+                                     FrameArchiveColumn::ColumnKind kind, const std::string& name,
+                                     uint32_t numberOfComponents, uint64_t numberOfPoints)
+{
+  for (const FrameArchiveColumn& column : columns)
+  {
+    if (column.Kind == kind && (kind == FrameArchiveColumn::Points || column.Name == name)
+        && column.NumberOfComponents == numberOfComponents && GetGetValue(column.DataType)
+        && column.Size == numberOfPoints * numberOfComponents * column.ValueSize)
+    {
+      return &column;
+    }
+  }
+  return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+//! A point with the index of its tile, to group the points by tile
+struct TiledPoint
+{
+  std::array<int, 3> Tile;
+  uint64_t Point;
+
+  bool operator<(const TiledPoint& other) const
+  {
+    return this->Tile < other.Tile || (this->Tile == other.Tile && this->Point < other.Point);
+  }
+};
+
+//-----------------------------------------------------------------------------
+void AppendUInt16(uint16_t value, std::vector<uint8_t>& buffer)
+{
+  buffer.push_back(static_cast<uint8_t>(value & 0xFF));
+  buffer.push_back(static_cast<uint8_t>(value >> 8));
+}
+}
+
+//-----------------------------------------------------------------------------
+FrameWebWriter::~FrameWebWriter()
+{
+  this->Close();
+}
+
+//-----------------------------------------------------------------------------
+bool FrameWebWriter::Open(const std::string& directory)
+{
+  this->Close();
+  if (!(this->PositionTolerance > 0.0) || !(this->TileSize > 0.0) ||
+      this->TileSize / this->GetPositionStep() > MaxQuantizedCoordinate ||
+      this->NumberOfLevels < 1 || this->NumberOfLevels > MaxLevels)
+  {
+    return false;
+  }
+  boost::system::error_code error;
+  boost::filesystem::create_directories(directory, error);
+  if (error || !boost::filesystem::is_directory(directory))
+  {
+    return false;
+  }
+  this->Directory = directory;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool FrameWebWriter::WriteFrame(double time, uint64_t numberOfPoints,
+                                const std::vector<FrameArchiveColumn>& columns)
+{
+  if (!this->IsOpen())
+  {
+    return false;
+  }
+  const FrameArchiveColumn* points =
+    FindColumn(columns, FrameArchiveColumn::Points, "", 3, numberOfPoints);
+  if (!points)
+  {
+    return false;
+  }
+
+  Frame frame;
+  char name[32];
+  std::snprintf(name, sizeof(name), "frame_%06d.bin", static_cast<int>(this->Frames.size()));
+  frame.FileName = name;
+  frame.Time = time;
+
+  // the points which can not be placed in a tile are dropped
+  const GetValue getCoordinate = GetGetValue(points->DataType);
+  this->Coordinates.resize(3 * numberOfPoints);
+  std::vector<TiledPoint> tiledPoints;
+  tiledPoints.reserve(numberOfPoints);
+  const double maxTileIndex = std::numeric_limits<int>::max() - 1;
+  for (uint64_t i = 0; i < numberOfPoints; ++i)
+  {
+    TiledPoint tiledPoint;
+    tiledPoint.Point = i;
+    bool isValid = true;
+    for (int k = 0; k < 3; ++k)
+    {
+      const double value = getCoordinate(points->Data, 3 * i + k);
+      this->Coordinates[3 * i + k] = value;
+      const double tile = std::floor(value / this->TileSize);
+      isValid &= std::abs(tile) < maxTileIndex;
+      tiledPoint.Tile[k] = isValid ? static_cast<int>(tile) : 0;
+    }
+    if (isValid)
+    {
+      tiledPoints.push_back(tiledPoint);
+    }
+  }
+  frame.NumberOfPoints = tiledPoints.size();
+  std::sort(tiledPoints.begin(), tiledPoints.end());
+
+  // the scalars are quantized over the range of the frame
+  std::vector<uint8_t> scalars;
+  const FrameArchiveColumn* scalarsColumn = this->ScalarsName.empty() ? nullptr :
+    FindColumn(columns, FrameArchiveColumn::PointData, this->ScalarsName, 1, numberOfPoints);
+  if (scalarsColumn)
+  {
+    const GetValue getScalar = GetGetValue(scalarsColumn->DataType);
+    double range[2] = { std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest() };
+    for (const TiledPoint& point : tiledPoints)
+    {
+      const double value = getScalar(scalarsColumn->Data, point.Point);
+      range[0] = std::min(range[0], value);
+      range[1] = std::max(range[1], value);
+    }
+    if (tiledPoints.empty())
+    {
+      range[0] = range[1] = 0.0;
+    }
+    const double scale = range[1] > range[0] ? 255.0 / (range[1] - range[0]) : 0.0;
+    scalars.resize(numberOfPoints, 0);
+    for (const TiledPoint& point : tiledPoints)
+    {
+      const double value = (getScalar(scalarsColumn->Data, point.Point) - range[0]) * scale;
+      scalars[point.Point] = static_cast<uint8_t>(std::min(255.0, std::max(0.0, std::round(value))));
+    }
+    frame.HasScalars = true;
+    frame.ScalarRange[0] = range[0];
+    frame.ScalarRange[1] = range[1];
+  }
+
+  // the points of each tile are contiguous once sorted
+  std::vector<uint64_t> order(tiledPoints.size());
+  std::vector<size_t> tileBegins;
+  for (size_t i = 0; i < tiledPoints.size(); ++i)
+  {
+    order[i] = tiledPoints[i].Point;
+    if (i == 0 || tiledPoints[i].Tile != tiledPoints[i - 1].Tile)
+    {
+      tileBegins.push_back(i);
+      Tile tile;
+      tile.Index = tiledPoints[i].Tile;
+      frame.Tiles.push_back(tile);
+    }
+  }
+  tileBegins.push_back(tiledPoints.size());
+  tiledPoints.clear();
+
+  // the tiles are encoded in parallel
+  const size_t nbTiles = frame.Tiles.size();
+  if (this->Buffers.size() < nbTiles)
+  {
+    this->Buffers.resize(nbTiles);
+  }
+  Parallel::ForEachChunk(nbTiles, 1, static_cast<unsigned int>(std::max(0, this->NumberOfThreads)),
+                         [&](unsigned int, size_t tile, size_t)
+  {
+    this->EncodeTile(order.data() + tileBegins[tile], tileBegins[tile + 1] - tileBegins[tile],
+                     scalars, frame.Tiles[tile], this->Buffers[tile]);
+  });
+
+  std::ofstream file((boost::filesystem::path(this->Directory) / frame.FileName).string(),
+                     std::ios::binary | std::ios::trunc);
+  uint64_t offset = 0;
+  for (size_t tile = 0; tile < nbTiles; ++tile)
+  {
+    frame.Tiles[tile].Offset = offset;
+    const std::vector<uint8_t>& buffer = this->Buffers[tile];
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    offset += buffer.size();
+  }
+  if (!file)
+  {
+    return false;
+  }
+  this->Frames.push_back(std::move(frame));
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void FrameWebWriter::EncodeTile(const uint64_t* points, size_t nbPoints, const std::vector<uint8_t>& scalars,
+                                Tile& tile, std::vector<uint8_t>& buffer) const
+{
+  // coordinates relative to the corner of the tile, in quantization steps
+  const double step = this->GetPositionStep();
+  std::vector<uint16_t> quantized(3 * nbPoints);
+  for (size_t i = 0; i < nbPoints; ++i)
+  {
+    for (int k = 0; k < 3; ++k)
+    {
+      const double corner = tile.Index[k] * this->TileSize;
+      const double value = std::round((this->Coordinates[3 * points[i] + k] - corner) / step);
+      quantized[3 * i + k] = static_cast<uint16_t>(std::min(MaxQuantizedCoordinate, std::max(0.0, value)));
+    }
+  }
+
+  // each level keeps one point per cell of its grid which holds no point of the
+  // previous levels, in the order of the frame
+  const double tileFractionPerStep = 1.0 / std::ceil(this->TileSize / step);
+  std::vector<size_t> sorted;
+  sorted.reserve(nbPoints);
+  std::vector<size_t> remaining(nbPoints);
+  for (size_t i = 0; i < nbPoints; ++i)
+  {
+    remaining[i] = i;
+  }
+  tile.LevelPoints.clear();
+  std::unordered_set<uint64_t> occupiedCells;
+  std::vector<size_t> notSelected;
+  for (int level = 0; level + 1 < this->NumberOfLevels; ++level)
+  {
+    const uint64_t nbCells = static_cast<uint64_t>(FirstLevelCells) << level;
+    auto getCell = [&](size_t i)
+    {
+      uint64_t cell = 0;
+      for (int k = 2; k >= 0; --k)
+      {
+        const uint64_t c = std::min<uint64_t>(nbCells - 1,
+          static_cast<uint64_t>(quantized[3 * i + k] * tileFractionPerStep * nbCells));
+        cell = cell * nbCells + c;
+      }
+      return cell;
+    };
+    occupiedCells.clear();
+    for (size_t i : sorted)
+    {
+      occupiedCells.insert(getCell(i));
+    }
+    const size_t levelBegin = sorted.size();
+    notSelected.clear();
+    for (size_t i : remaining)
+    {
+      if (occupiedCells.insert(getCell(i)).second)
+      {
+        sorted.push_back(i);
+      }
+      else
+      {
+        notSelected.push_back(i);
+      }
+    }
+    remaining.swap(notSelected);
+    tile.LevelPoints.push_back(static_cast<uint32_t>(sorted.size() - levelBegin));
+  }
+  sorted.insert(sorted.end(), remaining.begin(), remaining.end());
+  tile.LevelPoints.push_back(static_cast<uint32_t>(remaining.size()));
+
+  // each level is written as its positions then its scalars
+  buffer.clear();
+  buffer.reserve(nbPoints * (scalars.empty() ? 6 : 7));
+  size_t levelBegin = 0;
+  for (uint32_t levelPoints : tile.LevelPoints)
+  {
+    const size_t levelEnd = levelBegin + levelPoints;
+    for (size_t j = levelBegin; j < levelEnd; ++j)
+    {
+      for (int k = 0; k < 3; ++k)
+      {
+        AppendUInt16(quantized[3 * sorted[j] + k], buffer);
+      }
+    }
+    if (!scalars.empty())
+    {
+      for (size_t j = levelBegin; j < levelEnd; ++j)
+      {
+        buffer.push_back(scalars[points[sorted[j]]]);
+      }
+    }
+    levelBegin = levelEnd;
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool FrameWebWriter::Close()
+{
+  if (!this->IsOpen())
+  {
+    return true;
+  }
+
+  std::ofstream manifest((boost::filesystem::path(this->Directory) / "manifest.json").string(),
+                         std::ios::trunc);
+  manifest.precision(17);
+  manifest << "{\n"
+           << "  \"version\": 1,\n"
+           << "  \"position_step\": " << this->GetPositionStep() << ",\n"
+           << "  \"tile_size\": " << this->TileSize << ",\n"
+           << "  \"first_level_cells\": " << FirstLevelCells << ",\n"
+           << "  \"number_of_levels\": " << this->NumberOfLevels << ",\n"
+           << "  \"scalars\": \"" << this->ScalarsName << "\",\n"
+           << "  \"frames\": [";
+  for (size_t f = 0; f < this->Frames.size(); ++f)
+  {
+    const Frame& frame = this->Frames[f];
+    manifest << (f ? ",\n" : "\n")
+             << "    {\n"
+             << "      \"file\": \"" << frame.FileName << "\",\n"
+             << "      \"time\": " << frame.Time << ",\n"
+             << "      \"number_of_points\": " << frame.NumberOfPoints << ",\n"
+             << "      \"has_scalars\": " << (frame.HasScalars ? "true" : "false") << ",\n"
+             << "      \"scalar_range\": [" << frame.ScalarRange[0] << ", " << frame.ScalarRange[1] << "],\n"
+             << "      \"tiles\": [";
+    for (size_t t = 0; t < frame.Tiles.size(); ++t)
+    {
+      const Tile& tile = frame.Tiles[t];
+      manifest << (t ? ",\n" : "\n")
+               << "        { \"index\": [" << tile.Index[0] << ", " << tile.Index[1] << ", " << tile.Index[2]
+               << "], \"offset\": " << tile.Offset << ", \"level_points\": [";
+      for (size_t level = 0; level < tile.LevelPoints.size(); ++level)
+      {
+        manifest << (level ? ", " : "") << tile.LevelPoints[level];
+      }
+      manifest << "] }";
+    }
+    manifest << "\n      ]\n    }";
+  }
+  manifest << "\n  ]\n}\n";
+
+  this->Directory.clear();
+  this->Frames.clear();
+  this->Buffers.clear();
+  return static_cast<bool>(manifest);
+}
@@ -0,0 +1,141 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef FRAMEWEBWRITER_H
+#define FRAMEWEBWRITER_H
+
+#include "FrameArchive.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * \class FrameWebWriter
+ * \brief Write the frames in a directory for a web viewer to load them progressively.
+ *
+ * The points of each frame are split in cubic tiles of TileSize, aligned on a grid
+ * shared by all the frames, and their coordinates are quantized relative to the corner
+ * of their tile as 3 little endian uint16, with an error of at most PositionTolerance.
+ * The scalars, if any, are quantized as a uint8 over the range of the frame.
+ *
+ * The points of a tile are sorted by level of detail: the level 0 keeps one point per
+ * cell of a 16^3 grid over the tile, each following level refines the grid twice, and
+ * the last one holds the remaining points. Each level is stored as its positions then
+ * its scalars, so that any prefix of a tile ending on a level is a complete, coarser
+ * version of the tile, which a viewer can fetch with a range request.
+ *
+ * The tiles of a frame are encoded in parallel and written in a single file,
+ * "frame_<n>.bin", n being the index of the frame written with 6 digits. The manifest,
+ * "manifest.json", gives for each frame its time, its file, and for each tile its
+ * grid index, its byte offset in the file and the number of points of each level.
+ */
+class FrameWebWriter
+{
+public:
+  //! A tile of a frame, as listed in the manifest
+  struct Tile
+  {
+    //! Index of the tile on the grid, its corner being Index * TileSize
+    std::array<int, 3> Index;
+    uint64_t Offset = 0;
+    std::vector<uint32_t> LevelPoints;
+  };
+
+  //! A frame, as listed in the manifest
+  struct Frame
+  {
+    std::string FileName;
+    double Time = 0.0;
+    uint64_t NumberOfPoints = 0;
+    //! Whether the scalars are stored, their range being mapped to 0 and 255
+    bool HasScalars = false;
+    double ScalarRange[2] = { 0.0, 0.0 };
+    std::vector<Tile> Tiles;
+  };
+
+  ~FrameWebWriter();
+
+  //! Maximal error on the coordinates of the points, in meters
+  void SetPositionTolerance(double tolerance) { this->PositionTolerance = tolerance; }
+  double GetPositionTolerance() const { return this->PositionTolerance; }
+
+  //! Size of the edges of the tiles, in meters, at most 65535 quantization steps
+  void SetTileSize(double size) { this->TileSize = size; }
+  double GetTileSize() const { return this->TileSize; }
+
+  //! Number of levels of detail of the tiles, the last one holding all the remaining points
+  void SetNumberOfLevels(int nbLevels) { this->NumberOfLevels = nbLevels; }
+  int GetNumberOfLevels() const { return this->NumberOfLevels; }
+
+  //! Point data array stored with the points, empty to store the positions only
+  void SetScalarsName(const std::string& name) { this->ScalarsName = name; }
+  const std::string& GetScalarsName() const { return this->ScalarsName; }
+
+  //! Number of threads encoding the tiles, 0 to use all the cores
+  void SetNumberOfThreads(int nbThreads) { this->NumberOfThreads = nbThreads; }
+  int GetNumberOfThreads() const { return this->NumberOfThreads; }
+
+  /**
+   * @brief Open create the directory if needed, the files of a previous export in it
+   * being overwritten
+   * @return false if the directory could not be created or the settings are invalid
+   */
+  bool Open(const std::string& directory);
+
+  /**
+   * @brief WriteFrame encode a frame and write its file
+   * @param time time of the frame, written in the manifest
+   * @param numberOfPoints number of points of the frame
+   * @param columns points and point data of the frame, see vtkLidarFrameArchiveReader::GetColumns.
+   * The scalars are not stored if the frame has no column named ScalarsName.
+   * @return false if the points are missing or the file could not be written
+   */
+  bool WriteFrame(double time, uint64_t numberOfPoints, const std::vector<FrameArchiveColumn>& columns);
+
+  //! Write the manifest, called by the destructor
+  bool Close();
+
+  bool IsOpen() const { return !this->Directory.empty(); }
+
+  //! Frames written since Open, as listed in the manifest
+  const std::vector<Frame>& GetFrames() const { return this->Frames; }
+
+  //! Quantization step of the coordinates, twice the tolerance
+  double GetPositionStep() const { return 2.0 * this->PositionTolerance; }
+
+private:
+  //! Quantize the points of a tile, given by their index in the frame, and sort them by level
+  void EncodeTile(const uint64_t* points, size_t nbPoints, const std::vector<uint8_t>& scalars,
+                  Tile& tile, std::vector<uint8_t>& buffer) const;
+
+  double PositionTolerance = 0.005;
+  double TileSize = 16.0;
+  int NumberOfLevels = 4;
+  std::string ScalarsName = "intensity";
+  int NumberOfThreads = 0;
+
+  std::string Directory;
+  std::vector<Frame> Frames;
+  //! Coordinates of the points of the current frame
+  std::vector<double> Coordinates;
+  //! Encoded tiles of the current frame, kept from one frame to the next
+  std::vector<std::vector<uint8_t> > Buffers;
+};
+
+#endif // FRAMEWEBWRITER_H
@@ -0,0 +1,145 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "MultiSensorNetworkSource.h"
+#include "PacketConsumer.h"
+#include "PacketReceiver.h"
+
+// STD
+#include <algorithm>
+#include <cstring>
+
+//-----------------------------------------------------------------------------
+MultiSensorNetworkSource::MultiSensorNetworkSource()
+  : NetworkSource(nullptr, 0, 0, "0.0.0.0", false, false)
+  , NumberOfUnmatchedPackets(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+MultiSensorNetworkSource::~MultiSensorNetworkSource()
+{
+  this->Stop();
+
+  // let the threads return once all the receivers are gone
+  delete this->DummyWork;
+  this->DummyWork = nullptr;
+  for (auto& thread : this->Threads)
+  {
+    thread->join();
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool MultiSensorNetworkSource::AddSensor(std::shared_ptr<PacketConsumer> consumer, int port,
+                                         const std::string& sourceIp)
+{
+  Sensor sensor;
+  sensor.Consumer = consumer;
+  sensor.Port = port;
+  sensor.AnySourceIP = sourceIp.empty();
+  if (!sensor.AnySourceIP)
+  {
+    boost::system::error_code errCode;
+    boost::asio::ip::address_v4 address = boost::asio::ip::address_v4::from_string(sourceIp, errCode);
+    if (errCode)
+    {
+      return false;
+    }
+    // to_bytes() returns the address in network byte order
+    const boost::asio::ip::address_v4::bytes_type bytes = address.to_bytes();
+    std::copy(bytes.begin(), bytes.end(), sensor.SourceIP);
+  }
+  this->Sensors.push_back(sensor);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void MultiSensorNetworkSource::RemoveAllSensors()
+{
+  this->Sensors.clear();
+}
+
+//-----------------------------------------------------------------------------
+void MultiSensorNetworkSource::SetNumberOfReceiveThreads(int numberOfThreads)
+{
+  this->NumberOfReceiveThreads = std::max(1, numberOfThreads);
+}
+
+//-----------------------------------------------------------------------------
+void MultiSensorNetworkSource::QueuePacket(const unsigned char* data, unsigned int length,
+                                           const PacketRing::PacketInformation& information)
+{
+  // the sensors are not modified while the receivers are running, no lock is needed
+  for (const auto& sensor : this->Sensors)
+  {
+    if (sensor.Port == information.DestinationPort &&
+        (sensor.AnySourceIP || std::memcmp(sensor.SourceIP, information.SourceIP, 4) == 0))
+    {
+      sensor.Consumer->Enqueue(data, length, information);
+      return;
+    }
+  }
+  ++this->NumberOfUnmatchedPackets;
+}
+
+//-----------------------------------------------------------------------------
+void MultiSensorNetworkSource::Start()
+{
+  this->NumberOfUnmatchedPackets = 0;
+
+  if (this->Threads.empty())
+  {
+    for (int i = 0; i < this->NumberOfReceiveThreads; ++i)
+    {
+      this->Threads.push_back(boost::shared_ptr<boost::thread>(
+        new boost::thread(boost::bind(&boost::asio::io_service::run, &this->IOService))));
+    }
+  }
+
+  // one receiver per port, shared by all the sensors sending to it
+  std::vector<int> ports;
+  for (const auto& sensor : this->Sensors)
+  {
+    if (std::find(ports.begin(), ports.end(), sensor.Port) == ports.end())
+    {
+      ports.push_back(sensor.Port);
+    }
+  }
+
+  for (int port : ports)
+  {
+    boost::shared_ptr<PacketReceiver> receiver(
+      new PacketReceiver(this->IOService, port, this));
+    receiver->SetReceiveBufferSize(this->ReceiveBufferSize);
+    receiver->EnableBatchedReceive(this->UseBatchedReceive);
+    this->Receivers.push_back(receiver);
+  }
+
+  for (auto& receiver : this->Receivers)
+  {
+    receiver->StartReceive();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void MultiSensorNetworkSource::Stop()
+{
+  // the destructor of the receivers waits for their pending reception to be cancelled
+  this->Receivers.clear();
+}
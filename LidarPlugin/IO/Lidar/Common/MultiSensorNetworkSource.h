@@ -0,0 +1,92 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef MULTISENSORNETWORKSOURCE_H
+#define MULTISENSORNETWORKSOURCE_H
+
+#include "NetworkSource.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+/**
+ * \class MultiSensorNetworkSource
+ * \brief Receive the packets of several sensors with a single io_service, run by a pool
+ *        of threads, and dispatch each packet to the consumer of its sensor.
+ *
+ * A sensor is identified by the port on which its packets arrive and optionally by its
+ * source ip, so that several sensors can share the same port. A single receiver is
+ * created for each port, whatever the number of sensors using it.
+ * Each consumer is only fed by the receiver of its port, so that it keeps a single producer.
+ */
+class MultiSensorNetworkSource : public NetworkSource
+{
+public:
+  MultiSensorNetworkSource();
+
+  ~MultiSensorNetworkSource() override;
+
+  /**
+   * @brief AddSensor register a new sensor, must be called while the source is stopped
+   * @param consumer the consumer which will process the packets of this sensor
+   * @param port the port on which the packets of this sensor are received
+   * @param sourceIp the ip of the sensor, empty to accept the packets from any sender
+   * @return false if the source ip is not a valid ipv4 address
+   */
+  bool AddSensor(std::shared_ptr<PacketConsumer> consumer, int port, const std::string& sourceIp);
+
+  //! Remove all the sensors, must be called while the source is stopped
+  void RemoveAllSensors();
+
+  size_t GetNumberOfSensors() const { return this->Sensors.size(); }
+
+  /**
+   * @brief SetNumberOfReceiveThreads set the number of threads handling the sockets.
+   * Taken into account the next time the source is started from scratch.
+   */
+  void SetNumberOfReceiveThreads(int numberOfThreads);
+  int GetNumberOfReceiveThreads() const { return this->NumberOfReceiveThreads; }
+
+  //! Number of packets received which do not belong to any of the sensors
+  size_t GetNumberOfUnmatchedPackets() const { return this->NumberOfUnmatchedPackets; }
+
+  void QueuePacket(const unsigned char* data, unsigned int length,
+                   const PacketRing::PacketInformation& information) override;
+
+  void Start() override;
+
+  void Stop() override;
+
+private:
+  struct Sensor
+  {
+    std::shared_ptr<PacketConsumer> Consumer;
+    int Port = 0;
+    //! ip of the sensor in network byte order, only compared if AnySourceIP is false
+    unsigned char SourceIP[4] = { 0, 0, 0, 0 };
+    bool AnySourceIP = true;
+  };
+
+  std::vector<Sensor> Sensors;
+  std::vector<boost::shared_ptr<PacketReceiver> > Receivers;
+  std::vector<boost::shared_ptr<boost::thread> > Threads;
+  int NumberOfReceiveThreads = 2;
+  std::atomic<size_t> NumberOfUnmatchedPackets;
+};
+
+#endif // MULTISENSORNETWORKSOURCE_H
@@ -18,8 +18,11 @@
 // LOCAL
 #include "NetworkSource.h"
 #include "vtkPacketFileWriter.h"
+#include "CrashAnalysing.h"
+#include "PacketCaptureReceiver.h"
 #include "PacketReceiver.h"
 #include "PacketFileWriter.h"
+#include "PacketForwarder.h"
 #include "PacketConsumer.h"
 
 #define LIDAR_PACKET_TO_STORE_CRASH_ANALYSIS 5000
@@ -39,23 +42,19 @@ NetworkSource::~NetworkSource()
 }
 
 //-----------------------------------------------------------------------------
-void NetworkSource::QueuePackets(NetworkPacket* packet)
+void NetworkSource::QueuePacket(const unsigned char* data, unsigned int length,
+                                const PacketRing::PacketInformation& information)
 {
-  NetworkPacket* packet2 = nullptr;
-  if (this->Writer)
-  {
-    packet2 = new NetworkPacket(*packet);
-  }
-
   if (this->Consumer)
   {
-    this->Consumer->Enqueue(packet);
+    this->Consumer->Enqueue(data, length, information);
   }
+}
 
-  if (this->Writer)
-  {
-    this->Writer->Enqueue(packet2);
-  }
+//-----------------------------------------------------------------------------
+size_t NetworkSource::GetNumberOfListeners() const
+{
+  return (this->Writer ? 1 : 0) + (this->IsForwarding ? 1 : 0) + (this->IsCrashAnalysing ? 1 : 0);
 }
 
 //-----------------------------------------------------------------------------
@@ -68,17 +67,48 @@ void NetworkSource::Start()
       new boost::thread(boost::bind(&boost::asio::io_service::run, &this->IOService)));
   }
 
-  // Create work
-  this->LidarPortReceiver = boost::shared_ptr<PacketReceiver>(new PacketReceiver(
-    this->IOService, LidarPort, ForwardedLidarPort, ForwardedIpAddress, IsForwarding, this));
+  // the thread of the sockets lives until the source is destroyed, it is placed
+  // again each time the source starts
+  const ThreadPlacement placement = this->ReceiverPlacement;
+  this->IOService.post([placement]() { placement.Apply("receiver"); });
 
-  if (this->ListenGPS)
+  this->NumberOfReceivedPackets = 0;
+  this->NumberOfReceivedBytes = 0;
+  this->NumberOfSocketDrops = 0;
+
+  // The listeners read the packets from the queue of the consumer, which must be
+  // started with enough readers for them
+  std::shared_ptr<PacketRing> packets = this->Consumer ? this->Consumer->GetPacketRing() : nullptr;
+  size_t reader = 1;
+  if (packets && packets->GetNumberOfReaders() < this->GetNumberOfListeners() + 1)
+  {
+    std::cerr << "The packet queue has not enough readers, packets won't be recorded nor forwarded"
+              << std::endl;
+    packets.reset();
+  }
+
+  if (packets && this->Writer)
   {
-    this->PositionPortReceiver = boost::shared_ptr<PacketReceiver>(new PacketReceiver(
-      this->IOService, GPSPort, ForwardedGPSPort, ForwardedIpAddress, IsForwarding, this));
+    this->Writer->SetThreadPlacement(this->ListenerPlacement);
+    this->Writer->Start(packets, reader++);
+  }
+
+  if (packets && this->IsForwarding)
+  {
+    this->Forwarder.reset(new PacketForwarder);
+    if (this->Forwarder->SetDestination(this->ForwardedIpAddress))
+    {
+      this->Forwarder->AddForwardedPort(this->LidarPort, this->ForwardedLidarPort);
+      if (this->ListenGPS)
+      {
+        this->Forwarder->AddForwardedPort(this->GPSPort, this->ForwardedGPSPort);
+      }
+    }
+    this->Forwarder->SetThreadPlacement(this->ListenerPlacement);
+    this->Forwarder->Start(packets, reader++);
   }
 
-  if (this->IsCrashAnalysing)
+  if (packets && this->IsCrashAnalysing)
   {
     std::string appDir;
 
@@ -108,13 +138,56 @@ void NetworkSource::Start()
       boost::filesystem::create_directory(appDirPath);
     }
 
-    this->LidarPortReceiver->EnableCrashAnalysing(
-      appDir + "LidarLastData", LIDAR_PACKET_TO_STORE_CRASH_ANALYSIS, this->IsCrashAnalysing);
+    this->CrashAnalysis.reset(new CrashAnalysisListener);
+    this->CrashAnalysis->AddPort(
+      this->LidarPort, appDir + "LidarLastData", LIDAR_PACKET_TO_STORE_CRASH_ANALYSIS,
+      PacketConsumer::MaximumPacketSize);
     if (this->ListenGPS)
     {
-      this->PositionPortReceiver->EnableCrashAnalysing(
-        appDir + "GPSLastData", GPS_PACKET_TO_STORE_CRASH_ANALYSIS, this->IsCrashAnalysing);
+      this->CrashAnalysis->AddPort(
+        this->GPSPort, appDir + "GPSLastData", GPS_PACKET_TO_STORE_CRASH_ANALYSIS,
+        PacketConsumer::MaximumPacketSize);
     }
+    this->CrashAnalysis->SetThreadPlacement(this->ListenerPlacement);
+    this->CrashAnalysis->Start(packets, reader++);
+  }
+
+  // The capture of the interface receives all the ports from its own thread, which
+  // stays the single producer of the packet queue
+  if (this->CaptureBackend == PacketCaptureBackend)
+  {
+    std::vector<int> ports(1, this->LidarPort);
+    if (this->ListenGPS)
+    {
+      ports.push_back(this->GPSPort);
+    }
+    this->CaptureReceiver.reset(new PacketCaptureReceiver(this->CaptureInterface, ports, this));
+    if (this->CaptureReceiver->Open(this->ReceiveBufferSize, this->UseHardwareTimestamps))
+    {
+      this->CaptureReceiver->Start();
+      return;
+    }
+    std::cerr << "Cannot capture the network interface: " << this->CaptureReceiver->GetLastError()
+              << ". The packets are received by sockets instead." << std::endl;
+    this->CaptureReceiver.reset();
+  }
+
+  // Create work
+  this->LidarPortReceiver = boost::shared_ptr<PacketReceiver>(
+    new PacketReceiver(this->IOService, LidarPort, this));
+
+  if (this->ListenGPS)
+  {
+    this->PositionPortReceiver = boost::shared_ptr<PacketReceiver>(
+      new PacketReceiver(this->IOService, GPSPort, this));
+  }
+
+  this->LidarPortReceiver->SetReceiveBufferSize(this->ReceiveBufferSize);
+  this->LidarPortReceiver->EnableBatchedReceive(this->UseBatchedReceive);
+  if (this->ListenGPS)
+  {
+    this->PositionPortReceiver->SetReceiveBufferSize(this->ReceiveBufferSize);
+    this->PositionPortReceiver->EnableBatchedReceive(this->UseBatchedReceive);
   }
 
   this->LidarPortReceiver->StartReceive();
@@ -124,13 +197,44 @@ void NetworkSource::Start()
   }
 }
 
+//-----------------------------------------------------------------------------
+bool NetworkSource::SaveCrashAnalysisLog()
+{
+  return this->CrashAnalysis && this->CrashAnalysis->SaveLastPackets();
+}
+
 //-----------------------------------------------------------------------------
 void NetworkSource::Stop()
 {
   // Kill the receivers
+  if (this->CaptureReceiver)
+  {
+    this->CaptureReceiver->Stop();
+    this->CaptureReceiver.reset();
+  }
   this->LidarPortReceiver.reset();
   if (this->ListenGPS)
   {
     this->PositionPortReceiver.reset();
   }
+
+  // No packet will be received anymore, let the listeners handle the remaining ones
+  if (this->Consumer && (this->Writer || this->Forwarder || this->CrashAnalysis))
+  {
+    this->Consumer->GetPacketRing()->Stop();
+  }
+  if (this->Writer)
+  {
+    this->Writer->Stop();
+  }
+  if (this->Forwarder)
+  {
+    this->Forwarder->Stop();
+    this->Forwarder.reset();
+  }
+  if (this->CrashAnalysis)
+  {
+    this->CrashAnalysis->Stop();
+    this->CrashAnalysis.reset();
+  }
 }
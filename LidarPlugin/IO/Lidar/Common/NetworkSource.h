@@ -20,13 +20,21 @@
 #include <boost/thread/thread.hpp>
 
 #include "NetworkPacket.h"
+#include "PacketRing.h"
+#include "ThreadPlacement.h"
 
+#include <atomic>
+#include <cstdint>
 #include <deque>
+#include <memory>
 #include <queue>
 
 class PacketConsumer;
 class PacketReceiver;
+class PacketCaptureReceiver;
 class PacketFileWriter;
+class PacketForwarder;
+class CrashAnalysisListener;
 /**
 * \class PacketReceiver
 * \brief This class is responsible for the IOService and  two PacketReceiver classes
@@ -39,6 +47,15 @@ class PacketFileWriter;
 class NetworkSource
 {
 public:
+  /**
+   * @brief The CaptureBackendType enum selects how the packets are received
+   */
+  enum CaptureBackendType
+  {
+    SocketBackend = 0,       /*!< UDP sockets bound to the ports */
+    PacketCaptureBackend = 1 /*!< Capture of a network interface with libpcap, see PacketCaptureReceiver */
+  };
+
   NetworkSource(std::shared_ptr<PacketConsumer> _consumer, int argLidarPort,
     int ForwardedLidarPort_, std::string ForwardedIpAddress_,
     bool isForwarding_, bool isCrashAnalysing_)
@@ -52,18 +69,45 @@ public:
     , LidarPortReceiver()
     , Consumer(_consumer)
     , Writer()
+    , Forwarder()
+    , CrashAnalysis()
     , DummyWork(new boost::asio::io_service::work(this->IOService))
+    , NumberOfReceivedPackets(0)
+    , NumberOfReceivedBytes(0)
+    , NumberOfSocketDrops(0)
   {
       this->ListenGPS = false;
   }
 
-  ~NetworkSource();
+  virtual ~NetworkSource();
+
+  /**
+   * @brief QueuePacket give a received packet to the consumer, the writer, the forwarder
+   * and the crash analysis then read it from the packet queue of the consumer
+   * @param data payload of the packet
+   * @param length size of the payload
+   * @param information reception time, sender and reception port of the packet
+   */
+  virtual void QueuePacket(const unsigned char* data, unsigned int length,
+                           const PacketRing::PacketInformation& information);
 
-  void QueuePackets(NetworkPacket* packet);
+  /**
+   * @brief GetNumberOfListeners number of readers of the packet queue of the consumer,
+   * besides the consumer itself, needed with the current settings (writer, forwarding,
+   * crash analysis). Must be given to the consumer before it is started.
+   */
+  size_t GetNumberOfListeners() const;
 
-  void Start();
+  virtual void Start();
 
-  void Stop();
+  virtual void Stop();
+
+  /**
+   * @brief SaveCrashAnalysisLog save now the last packets kept by the crash analysis
+   * in the application directory, while streaming
+   * @return false if the crash analysis is not running or a log could not be written
+   */
+  bool SaveCrashAnalysisLog();
 
   //! @todo currently evrything is public, but it should be private
   int LidarPort;                  /*!< The port to receive LIDAR information. Default is 2368 */
@@ -74,6 +118,13 @@ public:
   std::string ForwardedIpAddress; /*!< The ip to send forwarded packets*/
   bool IsForwarding;              /*!< Allowing the forwarding of the packets*/
   bool IsCrashAnalysing;
+  bool UseBatchedReceive = true;  /*!< Drain the sockets with recvmmsg, only used on Linux*/
+  int ReceiveBufferSize = 0;      /*!< Size of the sockets receive buffer in bytes, 0 for the system default*/
+  int CaptureBackend = SocketBackend; /*!< How the packets are received, see CaptureBackendType*/
+  std::string CaptureInterface;   /*!< Interface captured by the packet capture backend, empty for all*/
+  bool UseHardwareTimestamps = false; /*!< Request the reception time from the network card with the packet capture backend*/
+  ThreadPlacement ReceiverPlacement; /*!< CPUs and scheduling of the thread receiving the packets, taken into account by Start*/
+  ThreadPlacement ListenerPlacement; /*!< CPUs and scheduling of the recording, forwarding and crash analysis threads*/
 
   boost::asio::io_service IOService; /*!< The in/out service which will handle the Packets */
   boost::shared_ptr<boost::thread> Thread;
@@ -84,10 +135,23 @@ public:
   boost::shared_ptr<PacketReceiver>
     PositionPortReceiver; /*!< The PacketReceiver configured to receive GPS information */
 
+  std::shared_ptr<PacketCaptureReceiver>
+    CaptureReceiver; /*!< Receive both ports instead of the sockets with the packet capture backend */
+
   std::shared_ptr<PacketConsumer> Consumer;
   std::shared_ptr<PacketFileWriter> Writer;
+  std::shared_ptr<PacketForwarder> Forwarder;
+  std::shared_ptr<CrashAnalysisListener> CrashAnalysis;
 
   boost::asio::io_service::work* DummyWork;
+
+  //! Counters of the packets received on all the ports since the last Start, updated by
+  //! the receivers. The socket drops are the datagrams dropped by the kernel because the
+  //! socket buffer was full (SO_RXQ_OVFL, Linux batched receive only) or the capture ring
+  //! was full (packet capture backend).
+  std::atomic<uint64_t> NumberOfReceivedPackets;
+  std::atomic<uint64_t> NumberOfReceivedBytes;
+  std::atomic<uint64_t> NumberOfSocketDrops;
 };
 
 
@@ -0,0 +1,296 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "PacketCaptureReceiver.h"
+#include "NetworkSource.h"
+
+#include <vtkMath.h>
+
+// STD
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+const unsigned short EthernetTypeIPv4 = 0x0800;
+const unsigned short EthernetTypeVLAN = 0x8100;
+const unsigned int VLANTagLength = 4;
+const unsigned int UDPHeaderLength = 8;
+const unsigned char IPProtocolUDP = 17;
+
+//-----------------------------------------------------------------------------
+unsigned short ReadBigEndian16(const unsigned char* data)
+{
+  return static_cast<unsigned short>((data[0] << 8) | data[1]);
+}
+}
+
+//-----------------------------------------------------------------------------
+PacketCaptureReceiver::PacketCaptureReceiver(const std::string& interfaceName,
+                                             const std::vector<int>& ports,
+                                             NetworkSource* parent)
+  : InterfaceName(interfaceName)
+  , Ports(ports)
+  , Parent(parent)
+  , ShouldStop(false)
+{
+}
+
+//-----------------------------------------------------------------------------
+PacketCaptureReceiver::~PacketCaptureReceiver()
+{
+  this->Stop();
+}
+
+//-----------------------------------------------------------------------------
+std::string PacketCaptureReceiver::GetFilterExpression() const
+{
+  std::ostringstream ports;
+  for (size_t i = 0; i < this->Ports.size(); ++i)
+  {
+    ports << (i == 0 ? "" : " or ") << "udp dst port " << this->Ports[i];
+  }
+  // the tagged frames are matched too, the filter offsets being shifted after "vlan"
+  return "(" + ports.str() + ") or (vlan and (" + ports.str() + "))";
+}
+
+//-----------------------------------------------------------------------------
+bool PacketCaptureReceiver::Open(int bufferSize, bool useHardwareTimestamps)
+{
+  this->Stop();
+
+  char errbuf[PCAP_ERRBUF_SIZE];
+  const std::string device = this->InterfaceName.empty() ? "any" : this->InterfaceName;
+  pcap_t* capture = pcap_create(device.c_str(), errbuf);
+  if (!capture)
+  {
+    this->LastError = errbuf;
+    return false;
+  }
+
+  pcap_set_snaplen(capture, 65535);
+  pcap_set_promisc(capture, 0);
+  // On Linux, maximum time before a partially filled block of the ring is given to the
+  // application, which bounds the latency when the packet rate is low
+  pcap_set_timeout(capture, 10);
+  if (bufferSize > 0)
+  {
+    pcap_set_buffer_size(capture, bufferSize);
+  }
+#ifdef PCAP_TSTAMP_PRECISION_NANO
+  this->HasNanosecondTimestamps =
+    pcap_set_tstamp_precision(capture, PCAP_TSTAMP_PRECISION_NANO) == 0;
+#endif
+#ifdef PCAP_TSTAMP_ADAPTER
+  if (useHardwareTimestamps && pcap_set_tstamp_type(capture, PCAP_TSTAMP_ADAPTER) != 0)
+  {
+    vtkGenericWarningMacro("Hardware timestamps are not supported by " << device
+                           << ", the kernel timestamps are used instead.");
+  }
+#else
+  if (useHardwareTimestamps)
+  {
+    vtkGenericWarningMacro("Hardware timestamps are not supported by this version of pcap");
+  }
+#endif
+
+  const int status = pcap_activate(capture);
+  if (status < 0)
+  {
+    this->LastError = pcap_geterr(capture);
+    if (this->LastError.empty())
+    {
+      this->LastError = pcap_statustostr(status);
+    }
+    pcap_close(capture);
+    return false;
+  }
+#ifdef PCAP_TSTAMP_PRECISION_NANO
+  this->HasNanosecondTimestamps =
+    pcap_get_tstamp_precision(capture) == PCAP_TSTAMP_PRECISION_NANO;
+#endif
+
+  switch (pcap_datalink(capture))
+  {
+    case DLT_EN10MB:
+      this->LinkHeaderLength = 14;
+      this->EthernetTypeOffset = 12;
+      break;
+    case DLT_LINUX_SLL:
+      this->LinkHeaderLength = 16;
+      this->EthernetTypeOffset = 14;
+      break;
+    case DLT_NULL:
+      this->LinkHeaderLength = 4;
+      this->EthernetTypeOffset = -1;
+      break;
+    default:
+      this->LastError = "Unsupported link type on " + device + ".";
+      pcap_close(capture);
+      return false;
+  }
+
+  struct bpf_program filter;
+  if (pcap_compile(capture, &filter, this->GetFilterExpression().c_str(), 1,
+                   PCAP_NETMASK_UNKNOWN) == -1)
+  {
+    this->LastError = pcap_geterr(capture);
+    pcap_close(capture);
+    return false;
+  }
+  const bool isFilterSet = pcap_setfilter(capture, &filter) == 0;
+  pcap_freecode(&filter);
+  if (!isFilterSet)
+  {
+    this->LastError = pcap_geterr(capture);
+    pcap_close(capture);
+    return false;
+  }
+
+  this->Capture = capture;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void PacketCaptureReceiver::Start()
+{
+  if (!this->Capture || this->Thread)
+  {
+    return;
+  }
+  this->ShouldStop = false;
+  this->Thread = boost::shared_ptr<boost::thread>(
+    new boost::thread(boost::bind(&PacketCaptureReceiver::ThreadLoop, this)));
+}
+
+//-----------------------------------------------------------------------------
+void PacketCaptureReceiver::Stop()
+{
+  if (this->Thread)
+  {
+    this->ShouldStop = true;
+    pcap_breakloop(this->Capture);
+    this->Thread->join();
+    this->Thread.reset();
+  }
+
+  if (this->Capture)
+  {
+    struct pcap_stat statistics;
+    if (pcap_stats(this->Capture, &statistics) == 0 && statistics.ps_drop > 0)
+    {
+      std::cerr << statistics.ps_drop << " packets have been dropped by the kernel on "
+                << (this->InterfaceName.empty() ? "any" : this->InterfaceName) << std::endl;
+    }
+    pcap_close(this->Capture);
+    this->Capture = nullptr;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void PacketCaptureReceiver::ThreadLoop()
+{
+  if (!this->Parent->ReceiverPlacement.IsDefault())
+  {
+    this->Parent->ReceiverPlacement.Apply("capture");
+  }
+
+  // pcap_dispatch returns after each block of the ring, or after the timeout
+  while (!this->ShouldStop)
+  {
+    const int status = pcap_dispatch(this->Capture, -1, &PacketCaptureReceiver::CaptureCallback,
+                                     reinterpret_cast<u_char*>(this));
+    if (status == PCAP_ERROR)
+    {
+      std::cerr << "Capture error: " << pcap_geterr(this->Capture) << std::endl;
+      return;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void PacketCaptureReceiver::CaptureCallback(u_char* user, const struct pcap_pkthdr* header,
+                                            const u_char* frame)
+{
+  reinterpret_cast<PacketCaptureReceiver*>(user)->HandleFrame(header, frame);
+}
+
+//-----------------------------------------------------------------------------
+void PacketCaptureReceiver::HandleFrame(const struct pcap_pkthdr* header,
+                                        const unsigned char* frame)
+{
+  const unsigned int length = header->caplen;
+  unsigned int offset = this->LinkHeaderLength;
+  if (this->EthernetTypeOffset >= 0)
+  {
+    unsigned int typeOffset = static_cast<unsigned int>(this->EthernetTypeOffset);
+    while (typeOffset + 2 <= length && ReadBigEndian16(frame + typeOffset) == EthernetTypeVLAN)
+    {
+      typeOffset += VLANTagLength;
+      offset += VLANTagLength;
+    }
+    if (typeOffset + 2 > length || ReadBigEndian16(frame + typeOffset) != EthernetTypeIPv4)
+    {
+      return;
+    }
+  }
+
+  // IPv4 header, the fragmented datagrams are ignored
+  if (offset + 20 > length || (frame[offset] >> 4) != 4 || frame[offset + 9] != IPProtocolUDP)
+  {
+    return;
+  }
+  const unsigned int ipHeaderLength = (frame[offset] & 0x0F) * 4u;
+  const unsigned short fragment = ReadBigEndian16(frame + offset + 6);
+  if ((fragment & 0x3FFF) != 0 || offset + ipHeaderLength + UDPHeaderLength > length)
+  {
+    return;
+  }
+  const unsigned char* ip = frame + offset;
+  const unsigned char* udp = ip + ipHeaderLength;
+
+  PacketRing::PacketInformation information;
+  information.ReceptionTime.tv_sec = header->ts.tv_sec;
+  information.ReceptionTime.tv_usec =
+    this->HasNanosecondTimestamps ? header->ts.tv_usec / 1000 : header->ts.tv_usec;
+  std::copy(ip + 12, ip + 16, information.SourceIP);
+  information.SourcePort = ReadBigEndian16(udp);
+  information.DestinationPort = ReadBigEndian16(udp + 2);
+
+  // the payload is given as is from the capture ring, truncated to the captured length
+  const unsigned int udpLength = ReadBigEndian16(udp + 4);
+  const unsigned int payloadOffset = offset + ipHeaderLength + UDPHeaderLength;
+  if (udpLength < UDPHeaderLength)
+  {
+    return;
+  }
+  const unsigned int payloadLength =
+    std::min(udpLength - UDPHeaderLength, length - payloadOffset);
+  this->Parent->QueuePacket(frame + payloadOffset, payloadLength, information);
+  this->Parent->NumberOfReceivedPackets.fetch_add(1, std::memory_order_relaxed);
+  this->Parent->NumberOfReceivedBytes.fetch_add(payloadLength, std::memory_order_relaxed);
+
+  // the statistics of the capture need a system call, they are not read for each frame
+  struct pcap_stat statistics;
+  if ((++this->PacketCounter % 1000) == 0 && pcap_stats(this->Capture, &statistics) == 0)
+  {
+    this->Parent->NumberOfSocketDrops += statistics.ps_drop - this->CaptureDrops;
+    this->CaptureDrops = statistics.ps_drop;
+  }
+}
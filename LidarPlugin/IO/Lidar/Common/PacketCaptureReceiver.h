@@ -0,0 +1,112 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef PACKETCAPTURERECEIVER_H
+#define PACKETCAPTURERECEIVER_H
+
+// LOCAL
+#include "PacketRing.h"
+
+// BOOST
+#include <boost/thread/thread.hpp>
+
+// STD
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <pcap.h>
+
+class NetworkSource;
+
+/**
+ * \class PacketCaptureReceiver
+ * \brief Receive the UDP packets of some ports by capturing a network interface with
+ *        libpcap instead of reading sockets, in its own thread.
+ *
+ * On Linux libpcap maps a TPACKET_V3 ring buffer shared with the kernel: the packets are
+ * delivered by blocks without a system call per packet, and are given to the consumer
+ * directly from the ring. The reception time is the one given by the kernel, or by the
+ * network card when hardware timestamps are requested and supported.
+ * Capturing requires the permission to open the interface (CAP_NET_RAW on Linux).
+ */
+class PacketCaptureReceiver
+{
+public:
+  /**
+   * @brief PacketCaptureReceiver
+   * @param interfaceName interface captured, empty for all the interfaces ("any", Linux only)
+   * @param ports destination ports of the packets to receive
+   * @param parent network source receiving the packets
+   */
+  PacketCaptureReceiver(const std::string& interfaceName, const std::vector<int>& ports,
+                        NetworkSource* parent);
+
+  ~PacketCaptureReceiver();
+
+  /**
+   * @brief Open the interface and filter the ports
+   * @param bufferSize size in bytes of the kernel ring buffer, 0 for the libpcap default
+   * @param useHardwareTimestamps request the reception time from the network card
+   * @return false if the interface cannot be captured, see GetLastError
+   */
+  bool Open(int bufferSize, bool useHardwareTimestamps);
+
+  //! Start the capture thread, the interface must be open
+  void Start();
+
+  //! Stop the capture thread and close the interface
+  void Stop();
+
+  const std::string& GetLastError() const { return this->LastError; }
+
+private:
+  PacketCaptureReceiver(const PacketCaptureReceiver&) = delete;
+  PacketCaptureReceiver& operator=(const PacketCaptureReceiver&) = delete;
+
+  void ThreadLoop();
+
+  static void CaptureCallback(u_char* user, const struct pcap_pkthdr* header,
+                              const u_char* frame);
+
+  //! Extract the UDP payload of a captured frame and give it to the parent
+  void HandleFrame(const struct pcap_pkthdr* header, const unsigned char* frame);
+
+  //! Build the capture filter matching the destination ports
+  std::string GetFilterExpression() const;
+
+  std::string InterfaceName;
+  std::vector<int> Ports;
+  NetworkSource* Parent;
+
+  pcap_t* Capture = nullptr;
+  std::string LastError;
+  //! Size of the link layer header of the captured frames
+  unsigned int LinkHeaderLength = 0;
+  //! Offset of the ethernet type in the link layer header, -1 if it has none
+  int EthernetTypeOffset = -1;
+  //! Whether the captured timestamps are in nanoseconds instead of microseconds
+  bool HasNanosecondTimestamps = false;
+
+  std::atomic<bool> ShouldStop;
+  boost::shared_ptr<boost::thread> Thread;
+  size_t PacketCounter = 0;
+  //! Number of frames dropped by the capture, as last reported by pcap_stats
+  unsigned int CaptureDrops = 0;
+};
+
+#endif // PACKETCAPTURERECEIVER_H
@@ -1,48 +1,208 @@
 #include "PacketConsumer.h"
+#include "FramePublisher.h"
+#include "NetworkPacket.h"
 
-#include "SynchronizedQueue.h"
+#include <algorithm>
+#include <chrono>
 
 //----------------------------------------------------------------------------
 PacketConsumer::PacketConsumer()
+  : NumberOfAvailableFrames(0)
+  , NumberOfSkippedFrames(0)
+  , NumberOfProcessedPackets(0)
+  , NumberOfCompletedFrames(0)
+  , LastFrameDecodeTime(0)
+  , LastFrameNumberOfPoints(0)
 {
-  this->Packets.reset(new SynchronizedQueue<NetworkPacket*>);
+  this->Packets = std::make_shared<PacketRing>(this->QueueCapacity, MaximumPacketSize);
 }
 
 //----------------------------------------------------------------------------
 void PacketConsumer::HandleSensorData(const unsigned char *data, unsigned int length)
 {
-  this->Interpreter->ProcessPacket(data, length);
-  if (this->Interpreter->IsNewFrameReady())
+  RawPacket packet;
+  packet.Data = data;
+  packet.Length = length;
+  this->HandleSensorData(&packet, 1);
+}
+
+//----------------------------------------------------------------------------
+void PacketConsumer::HandleSensorData(const RawPacket* packets, size_t numberOfPackets)
+{
+  this->ProcessBatch(packets, numberOfPackets, nullptr);
+}
+
+//----------------------------------------------------------------------------
+void PacketConsumer::ProcessBatch(const RawPacket* packets, size_t numberOfPackets,
+                                  const PacketRing* ring)
+{
+  if (this->DecodePositionPackets)
+  {
+    this->DecodePositions(packets, numberOfPackets);
+  }
+
+  size_t numberOfPacketsProcessed = 0;
+  while (numberOfPacketsProcessed < numberOfPackets)
   {
+    const auto start = std::chrono::steady_clock::now();
+    numberOfPacketsProcessed += this->Interpreter->ProcessPackets(
+      packets + numberOfPacketsProcessed, numberOfPackets - numberOfPacketsProcessed);
+    this->CurrentFrameDecodeTime +=
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (this->Interpreter->IsNewFrameReady())
     {
-      boost::lock_guard<boost::mutex> lock(this->ConsumerMutex);
-      this->Frames.push_back(this->Interpreter->GetLastFrameAvailable());
+      vtkSmartPointer<vtkPolyData> frame = this->Interpreter->GetLastFrameAvailable();
+      this->LastFrameDecodeTime = this->CurrentFrameDecodeTime;
+      this->LastFrameNumberOfPoints = frame ? static_cast<size_t>(frame->GetNumberOfPoints()) : 0;
+      this->CurrentFrameDecodeTime = 0;
+      ++this->NumberOfCompletedFrames;
+
+      // ProcessPackets stops right after the packet which completed the frame
+      double latency = -1;
+      if (ring && numberOfPacketsProcessed > 0)
+      {
+        const timeval& reception =
+          ring->GetInformation(packets[numberOfPacketsProcessed - 1]).ReceptionTime;
+        const timeval now = NetworkPacket::CurrentTime();
+        latency = (now.tv_sec - reception.tv_sec) + 1e-6 * (now.tv_usec - reception.tv_usec);
+      }
+      this->HandleNewFrame(frame, latency);
+      this->Interpreter->ClearAllFramesAvailable();
     }
-    this->Interpreter->ClearAllFramesAvailable();
   }
+  this->NumberOfProcessedPackets += numberOfPackets;
 }
 
 //----------------------------------------------------------------------------
-vtkSmartPointer<vtkPolyData> PacketConsumer::GetLastAvailableFrame()
+void PacketConsumer::DecodePositions(const RawPacket* packets, size_t numberOfPackets)
 {
-  return this->Frames.back();
+  VelodynePositionSample sample;
+  for (size_t i = 0; i < numberOfPackets; ++i)
+  {
+    if (packets[i].Length != VelodynePositionDecoder::PacketSize
+        || this->PositionDecoder.Decode(packets[i].Data, packets[i].Length, sample)
+          != VelodynePositionDecoder::Decoded)
+    {
+      continue;
+    }
+    boost::lock_guard<boost::mutex> lock(this->PositionMutex);
+    ++this->Position.NumberOfSamples;
+    this->Position.LastSample = sample;
+    this->Position.PPSSynced = this->PositionDecoder.GetPPSSynced();
+    this->Position.LastPPSState = this->PositionDecoder.GetLastPPSState();
+    this->Position.HasTimeshiftEstimation = this->PositionDecoder.GetHasTimeshiftEstimation();
+    this->Position.TimeshiftEstimation = this->PositionDecoder.GetTimeshiftEstimation();
+  }
 }
 
 //----------------------------------------------------------------------------
-int PacketConsumer::CheckForNewData()
+PacketConsumer::PositionStatus PacketConsumer::GetPositionStatus() const
 {
-  return this->Frames.size();
+  boost::lock_guard<boost::mutex> lock(this->PositionMutex);
+  return this->Position;
+}
+
+//----------------------------------------------------------------------------
+void PacketConsumer::HandleNewFrame(vtkSmartPointer<vtkPolyData> frame, double latency)
+{
+  if (this->Publisher)
+  {
+    this->Publisher->Publish(frame);
+  }
+
+  boost::lock_guard<boost::mutex> lock(this->FramesMutex);
+  if (latency >= 0)
+  {
+    this->FrameLatencies.push_back(latency);
+    if (this->FrameLatencies.size() > MaximumNumberOfFrameLatencies)
+    {
+      this->FrameLatencies.pop_front();
+    }
+  }
+  this->Frames.push_back(frame);
+  while (this->Frames.size() > this->FrameHistorySize)
+  {
+    this->Frames.pop_front();
+    ++this->NumberOfSkippedFrames;
+  }
+  this->NumberOfAvailableFrames = this->Frames.size();
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> PacketConsumer::TakeLastFrame(int& numberOfNewFrames)
+{
+  vtkSmartPointer<vtkPolyData> frame;
+  boost::lock_guard<boost::mutex> lock(this->FramesMutex);
+  numberOfNewFrames = static_cast<int>(this->Frames.size());
+  if (!this->Frames.empty())
+  {
+    frame = this->Frames.back();
+    this->NumberOfSkippedFrames += this->Frames.size() - 1;
+    this->Frames.clear();
+    this->NumberOfAvailableFrames = 0;
+  }
+  return frame;
+}
+
+//----------------------------------------------------------------------------
+std::vector<vtkSmartPointer<vtkPolyData> > PacketConsumer::GetAvailableFrames()
+{
+  boost::lock_guard<boost::mutex> lock(this->FramesMutex);
+  return std::vector<vtkSmartPointer<vtkPolyData> >(this->Frames.begin(), this->Frames.end());
+}
+
+//----------------------------------------------------------------------------
+bool PacketConsumer::TakeFrame(vtkPolyData* frame)
+{
+  boost::lock_guard<boost::mutex> lock(this->FramesMutex);
+  for (size_t i = 0; i < this->Frames.size(); ++i)
+  {
+    if (this->Frames[i] == frame)
+    {
+      this->NumberOfSkippedFrames += i;
+      this->Frames.erase(this->Frames.begin(), this->Frames.begin() + i + 1);
+      this->NumberOfAvailableFrames = this->Frames.size();
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+std::vector<double> PacketConsumer::TakeFrameLatencies()
+{
+  boost::lock_guard<boost::mutex> lock(this->FramesMutex);
+  std::vector<double> latencies(this->FrameLatencies.begin(), this->FrameLatencies.end());
+  this->FrameLatencies.clear();
+  return latencies;
+}
+
+//----------------------------------------------------------------------------
+void PacketConsumer::SetFrameHistorySize(size_t size)
+{
+  boost::lock_guard<boost::mutex> lock(this->FramesMutex);
+  this->FrameHistorySize = std::max(size, static_cast<size_t>(1));
 }
 
 //----------------------------------------------------------------------------
 void PacketConsumer::ThreadLoop()
 {
-  NetworkPacket* packet = nullptr;
+  // Take all the packets received since the last iteration,
+  // so that they can be processed as a batch by the interpreter
+  const size_t maximumNumberOfPackets = 256;
+  std::vector<RawPacket> batch(maximumNumberOfPackets);
+  if (!this->Placement.IsDefault())
+  {
+    // the recycled frames may have been allocated on the node of other CPUs
+    this->Placement.Apply("decoder");
+    this->Interpreter->ClearRecycledFrames();
+  }
   this->Interpreter->ResetCurrentFrame();
-  while (this->Packets->dequeue(packet))
+  while (this->Packets->WaitForPackets())
   {
-    this->HandleSensorData(packet->GetPayloadData(), packet->GetPayloadSize());
-    delete packet;
+    const size_t numberOfPackets = this->Packets->Peek(batch.data(), batch.size());
+    this->ProcessBatch(batch.data(), numberOfPackets, this->Packets.get());
+    this->Packets->Release(numberOfPackets);
   }
 }
 
@@ -54,7 +214,46 @@ void PacketConsumer::Start()
     return;
   }
 
-  this->Packets.reset(new SynchronizedQueue<NetworkPacket*>);
+  // the capacity of the ring is rounded up to a power of two. The ring is also allocated
+  // again when the decoding thread moves, so that its slots are written first (zeroed)
+  // by a thread on the CPUs of the decoding thread, and are on their NUMA node
+  if (this->Packets->GetCapacity() < this->QueueCapacity ||
+      this->Packets->GetCapacity() >= 2 * this->QueueCapacity ||
+      this->Packets->GetNumberOfReaders() != this->NumberOfListeners + 1 ||
+      this->PacketsCPUs != this->Placement.CPUs)
+  {
+    const PacketRing::OverflowPolicy policy = this->Packets->GetOverflowPolicy();
+    this->Packets.reset();
+    this->Placement.RunPinned([this]() {
+      this->Packets = std::make_shared<PacketRing>(
+        this->QueueCapacity, MaximumPacketSize, this->NumberOfListeners + 1);
+    });
+    this->Packets->SetOverflowPolicy(policy);
+    this->PacketsCPUs = this->Placement.CPUs;
+  }
+  this->Packets->Restart();
+  {
+    boost::lock_guard<boost::mutex> lock(this->FramesMutex);
+    this->Frames.clear();
+    this->NumberOfAvailableFrames = 0;
+    this->NumberOfSkippedFrames = 0;
+    this->FrameLatencies.clear();
+  }
+  this->NumberOfProcessedPackets = 0;
+  this->NumberOfCompletedFrames = 0;
+  this->LastFrameDecodeTime = 0;
+  this->LastFrameNumberOfPoints = 0;
+  this->CurrentFrameDecodeTime = 0;
+  // a stream may send many invalid sentences, they are not reported one by one
+  this->PositionDecoder.Reset();
+  this->PositionDecoder.SetWarnOnInvalidSentences(false);
+  {
+    boost::lock_guard<boost::mutex> lock(this->PositionMutex);
+    this->Position = PositionStatus();
+  }
+  // the packets are decoded in order, the gaps are counted since the consumer was started
+  this->Interpreter->ResetPacketGaps();
+  this->Interpreter->SetDetectGapsWhileDecoding(true);
   this->Thread = boost::shared_ptr<boost::thread>(
         new boost::thread(boost::bind(&PacketConsumer::ThreadLoop, this)));
 }
@@ -64,15 +263,22 @@ void PacketConsumer::Stop()
 {
   if (this->Thread)
   {
-    this->Packets->stopQueue();
+    this->Packets->Stop();
     this->Thread->join();
     this->Thread.reset();
-    this->Packets.reset();
   }
 }
 
 //----------------------------------------------------------------------------
-void PacketConsumer::Enqueue(NetworkPacket* packet)
+void PacketConsumer::Enqueue(const unsigned char* data, unsigned int length,
+                             const PacketRing::PacketInformation& information)
+{
+  this->Packets->Push(data, length, &information);
+}
+
+//----------------------------------------------------------------------------
+void PacketConsumer::SetQueueOverflowPolicy(int policy)
 {
-  this->Packets->enqueue(packet);
+  this->Packets->SetOverflowPolicy(
+    policy == PacketRing::Wait ? PacketRing::Wait : PacketRing::DropNewest);
 }
@@ -17,15 +17,18 @@
 
 #include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
+#include <atomic>
 #include <deque>
+#include <memory>
+#include <vector>
 
 #include "vtkSmartPointer.h"
 #include "vtkLidarPacketInterpreter.h"
-#include "NetworkPacket.h"
+#include "PacketRing.h"
+#include "ThreadPlacement.h"
+#include "VelodynePositionDecoder.h"
 
-
-template<typename T>
-class SynchronizedQueue;
+class FramePublisher;
 
 class PacketConsumer
 {
@@ -34,32 +37,197 @@ public:
 
   void HandleSensorData(const unsigned char* data, unsigned int length);
 
-  vtkSmartPointer<vtkPolyData> GetLastAvailableFrame();
-
-  int CheckForNewData();
-
-  void ClearAllFrames() { this->Frames.clear();}
+  //! Process a batch of packets, all the frames completed are made available
+  void HandleSensorData(const RawPacket* packets, size_t numberOfPackets);
+
+  //! Number of frames completed and not taken yet, does not lock
+  int CheckForNewData() { return static_cast<int>(this->NumberOfAvailableFrames.load()); }
+
+  /**
+   * @brief TakeLastFrame take the newest frame, the older frames not taken yet are skipped
+   * @param numberOfNewFrames[out] number of frames which were available
+   * @return the newest frame, nullptr if no frame is available
+   */
+  vtkSmartPointer<vtkPolyData> TakeLastFrame(int& numberOfNewFrames);
+
+  //! Frames completed and not taken yet, the oldest first
+  std::vector<vtkSmartPointer<vtkPolyData> > GetAvailableFrames();
+
+  /**
+   * @brief TakeFrame take one of the frames returned by GetAvailableFrames, the frames
+   * older than it are skipped and the newer ones stay available
+   * @return false if the frame is not available anymore
+   */
+  bool TakeFrame(vtkPolyData* frame);
+
+  /**
+   * @brief SetFrameHistorySize set the maximum number of completed frames kept until they
+   * are taken, the oldest frame is skipped when a new one is completed and the history is full
+   */
+  void SetFrameHistorySize(size_t size);
+  size_t GetFrameHistorySize() const { return this->FrameHistorySize; }
+
+  //! Number of frames completed but never taken since the consumer was started,
+  //! because the frames were not taken often enough
+  size_t GetNumberOfSkippedFrames() const { return this->NumberOfSkippedFrames.load(); }
+
+  //! Number of packets given to the interpreter since the consumer was started
+  size_t GetNumberOfProcessedPackets() const { return this->NumberOfProcessedPackets.load(); }
+
+  /**
+   * @brief TakeFrameLatencies take the latencies of the frames completed since the last call,
+   * in seconds, the oldest first. The latency of a frame is the delay between the reception of
+   * the packet which completed it and the moment the frame was made available. Only the frames
+   * completed from the queue are measured, and only the last MaximumNumberOfFrameLatencies are kept.
+   */
+  std::vector<double> TakeFrameLatencies();
+  static const size_t MaximumNumberOfFrameLatencies = 65536;
+
+  //! Number of frames completed since the consumer was started
+  size_t GetNumberOfCompletedFrames() const { return this->NumberOfCompletedFrames.load(); }
+
+  //! Time spent by the interpreter to decode the packets of the last completed frame, in seconds
+  double GetLastFrameDecodeTime() const { return this->LastFrameDecodeTime.load(); }
+
+  //! Number of points of the last completed frame
+  size_t GetLastFrameNumberOfPoints() const { return this->LastFrameNumberOfPoints.load(); }
+
+  //! Positions decoded since the consumer was started, see SetDecodePositionPackets
+  struct PositionStatus
+  {
+    size_t NumberOfSamples = 0;
+    VelodynePositionSample LastSample;
+    bool PPSSynced = false;
+    VelodynePositionDecoder::PPSState LastPPSState = VelodynePositionDecoder::PPS_ABSENT;
+    bool HasTimeshiftEstimation = false;
+    double TimeshiftEstimation = 0.0;
+  };
+
+  /**
+   * @brief SetDecodePositionPackets decode the position packets queued with the lidar packets,
+   * with the same decoder as vtkVelodyneHDLPositionReader. Taken into account the next time
+   * the consumer is started.
+   */
+  void SetDecodePositionPackets(bool decode) { this->DecodePositionPackets = decode; }
+  bool GetDecodePositionPackets() const { return this->DecodePositionPackets; }
+
+  //! Copy of the state of the positions, can be called from any thread
+  PositionStatus GetPositionStatus() const;
+
+  //! Number of discontinuities of the packets since the consumer was started
+  //! (see vtkLidarPacketInterpreter::GetPacketGapTable)
+  size_t GetNumberOfPacketGaps() const
+  {
+    return this->Interpreter ? this->Interpreter->GetPacketGaps().GetNumberOfGaps() : 0;
+  }
+
+  //! Number of packets missing according to the discontinuities since the consumer was started
+  size_t GetNumberOfMissingPackets() const
+  {
+    return this->Interpreter ? this->Interpreter->GetPacketGaps().GetNumberOfMissingPackets() : 0;
+  }
 
   void Start();
 
   void Stop();
 
-  void Enqueue(NetworkPacket* packet);
+  //! Copy a packet in the queue of the packets to process, must be called from a single thread
+  void Enqueue(const unsigned char* data, unsigned int length,
+               const PacketRing::PacketInformation& information);
+
+  /**
+   * @brief SetNumberOfListeners set the number of readers of the packet queue besides
+   * the consumer (see PacketRingListener). Taken into account the next time the consumer
+   * is started.
+   */
+  void SetNumberOfListeners(size_t numberOfListeners) { this->NumberOfListeners = numberOfListeners; }
+
+  //! The queue of the packets, the consumer is its reader 0
+  std::shared_ptr<PacketRing> GetPacketRing() const { return this->Packets; }
+
+  /**
+   * @brief SetQueueCapacity set the number of packets that can wait to be processed.
+   * Taken into account the next time the consumer is started.
+   */
+  void SetQueueCapacity(size_t capacity) { this->QueueCapacity = capacity; }
+  size_t GetQueueCapacity() const { return this->QueueCapacity; }
+
+  /**
+   * @brief SetQueueOverflowPolicy select what happens to a received packet when the queue
+   * is full, either it is dropped or the reception waits (see PacketRing::OverflowPolicy)
+   */
+  void SetQueueOverflowPolicy(int policy);
+  int GetQueueOverflowPolicy() const { return this->Packets->GetOverflowPolicy(); }
+
+  //! Number of packets dropped because the queue was full since the consumer was started
+  size_t GetNumberOfDroppedPackets() const { return this->Packets->GetNumberOfDroppedPackets(); }
+
+  //! Maximum number of packets waiting in the queue since the consumer was started
+  size_t GetQueueHighWaterMark() const { return this->Packets->GetHighWaterMark(); }
+
+  //! Number of packets waiting in the queue to be processed
+  size_t GetQueueDepth() const { return this->Packets->GetNumberOfPackets(); }
+
+  //! Maximum size of a packet, bigger packets are truncated
+  static const size_t MaximumPacketSize = 1500;
 
   void SetInterpreter(vtkLidarPacketInterpreter* inter) { this->Interpreter = inter;}
 
-  // Hold this when modifying internals of reader
-  boost::mutex ConsumerMutex;
+  /**
+   * @brief SetThreadPlacement set the CPUs and the scheduling of the decoding thread,
+   * taken into account the next time the consumer is started. The packet queue is then
+   * allocated on the NUMA node of these CPUs, and so are the frames, which are allocated
+   * by the decoding thread.
+   */
+  void SetThreadPlacement(const ThreadPlacement& placement) { this->Placement = placement; }
+  const ThreadPlacement& GetThreadPlacement() const { return this->Placement; }
+
+  //! Publish each completed frame, nullptr to publish nothing
+  void SetPublisher(std::shared_ptr<FramePublisher> publisher) { this->Publisher = publisher; }
 
 protected:
   void ThreadLoop();
 
-  void HandleNewData(vtkSmartPointer<vtkPolyData> polyData);
+  //! Process a batch of packets, the batch comes from the queue if ring is set
+  void ProcessBatch(const RawPacket* packets, size_t numberOfPackets, const PacketRing* ring);
 
-  std::deque<vtkSmartPointer<vtkPolyData> > Frames;
-  vtkLidarPacketInterpreter* Interpreter;
+  //! Decode the position packets of a batch, the other packets are skipped by their size
+  void DecodePositions(const RawPacket* packets, size_t numberOfPackets);
+
+  //! Add a completed frame to the history, with its latency if it is known (see TakeFrameLatencies)
+  void HandleNewFrame(vtkSmartPointer<vtkPolyData> frame, double latency = -1);
 
-  boost::shared_ptr<SynchronizedQueue<NetworkPacket*>> Packets;
+  //! Only held to add or take a frame, never while a frame is processed
+  boost::mutex FramesMutex;
+  std::deque<vtkSmartPointer<vtkPolyData> > Frames;
+  size_t FrameHistorySize = 10;
+  std::atomic<size_t> NumberOfAvailableFrames;
+  std::atomic<size_t> NumberOfSkippedFrames;
+  std::atomic<size_t> NumberOfProcessedPackets;
+  std::deque<double> FrameLatencies;
+  std::atomic<size_t> NumberOfCompletedFrames;
+  std::atomic<double> LastFrameDecodeTime;
+  std::atomic<size_t> LastFrameNumberOfPoints;
+  //! Decode time of the frame in progress, only used by the thread which processes the packets
+  double CurrentFrameDecodeTime = 0;
+  vtkLidarPacketInterpreter* Interpreter = nullptr;
+
+  std::shared_ptr<FramePublisher> Publisher;
+
+  bool DecodePositionPackets = false;
+  //! Only used by the thread which processes the packets
+  VelodynePositionDecoder PositionDecoder;
+  //! Only held to update or copy Position, once per position packet
+  mutable boost::mutex PositionMutex;
+  PositionStatus Position;
+
+  std::shared_ptr<PacketRing> Packets;
+  size_t QueueCapacity = 16384;
+  size_t NumberOfListeners = 0;
+
+  ThreadPlacement Placement;
+  //! CPUs of the thread which has allocated the packet queue
+  std::vector<int> PacketsCPUs;
 
   boost::shared_ptr<boost::thread> Thread;
 };
@@ -4,22 +4,30 @@
 #include <vtkMath.h>
 
 //-----------------------------------------------------------------------------
-void PacketFileWriter::ThreadLoop()
+PacketFileWriter::~PacketFileWriter()
 {
-  NetworkPacket* packet = nullptr;
-  while (this->Packets->dequeue(packet))
+  this->StopListening();
+}
+
+//-----------------------------------------------------------------------------
+void PacketFileWriter::HandlePackets(const PacketRing& ring, const RawPacket* packets,
+                                     size_t numberOfPackets)
+{
+  for (size_t i = 0; i < numberOfPackets; ++i)
   {
-    this->PacketWriter.WritePacket(*packet);
-    delete packet;
+    const PacketRing::PacketInformation& information = ring.GetInformation(packets[i]);
+    // TODO: IPV6 is recorded as fake ipv4 packet -> create BuildEthernetIP6UDP
+    this->PacketWriter.WriteUDPPacket(packets[i].Data, packets[i].Length, information.ReceptionTime,
+      information.SourceIP, information.SourcePort, information.DestinationPort);
   }
 }
 
 //-----------------------------------------------------------------------------
-void PacketFileWriter::Start(const std::string &filename)
+bool PacketFileWriter::Open(const std::string &filename)
 {
-  if (this->Thread)
+  if (this->IsListening())
   {
-    return;
+    return this->IsOpen();
   }
 
   if (this->PacketWriter.GetFileName() != filename)
@@ -29,42 +37,27 @@ void PacketFileWriter::Start(const std::string &filename)
 
   if (!this->PacketWriter.IsOpen())
   {
+    this->PacketWriter.SetAsynchronous(true);
     if (!this->PacketWriter.Open(filename))
     {
       vtkGenericWarningMacro("Failed to open packet file: " << filename);
-      return;
+      return false;
     }
   }
-
-  this->Packets.reset(new SynchronizedQueue<NetworkPacket*>);
-  this->Thread = boost::shared_ptr<boost::thread>(
-        new boost::thread(boost::bind(&PacketFileWriter::ThreadLoop, this)));
+  return true;
 }
 
 //-----------------------------------------------------------------------------
-void PacketFileWriter::Stop()
+void PacketFileWriter::Start(std::shared_ptr<PacketRing> ring, size_t reader)
 {
-  if (this->Thread)
+  if (this->IsOpen())
   {
-    this->Packets->stopQueue();
-    this->Thread->join();
-    this->Thread.reset();
-    this->Packets.reset();
+    this->StartListening(ring, reader);
   }
 }
 
 //-----------------------------------------------------------------------------
-void PacketFileWriter::Enqueue(NetworkPacket* packet)
+void PacketFileWriter::Stop()
 {
-  // TODO
-  // After capturing a stream and stoping the recording, Packets is NULL
-  // and this loop continues until a new reader or stream is selected.
-  if (this->Packets != NULL)
-  {
-    this->Packets->enqueue(packet);
-  }
-  else
-  {
-    this->Stop();
-  }
+  this->StopListening();
 }
@@ -16,32 +16,53 @@
 #define PACKETWRITER_H
 
 #include <string>
-#include <queue>
-#include <boost/thread/thread.hpp>
-#include <boost/asio.hpp>
 
 #include "vtkPacketFileWriter.h"
-#include "SynchronizedQueue.h"
+#include "PacketRingListener.h"
 
-class PacketFileWriter
+/**
+ * \class PacketFileWriter
+ * \brief Record the received packets in a pcap file, from the slots of the packet ring
+ *        read by the decoder, in its own thread.
+ *
+ * The file is written asynchronously by vtkPacketFileWriter, so that the packets
+ * keep being read from the ring while the disk is busy.
+ */
+class PacketFileWriter : public PacketRingListener
 {
 public:
-  void ThreadLoop();
+  ~PacketFileWriter() override;
 
-  void Start(const std::string& filename);
+  //! Open the pcap file, if it is not already open
+  bool Open(const std::string& filename);
 
-  void Stop();
+  //! Rotation of the recorded files, see vtkPacketFileWriter::SetRotation, used by Open
+  void SetRotation(size_t maximumSize, double maximumDuration)
+  {
+    this->PacketWriter.SetRotation(maximumSize, maximumDuration);
+  }
+
+  //! Backpressure of the disk since the file was opened
+  vtkPacketFileWriter::Statistics GetStatistics() const { return this->PacketWriter.GetStatistics(); }
+
+  //! Start recording the packets of the ring, the file must be open
+  void Start(std::shared_ptr<PacketRing> ring, size_t reader);
 
-  void Enqueue(NetworkPacket* packet);
+  //! Stop once all the packets of the ring have been written, the ring must be stopped
+  void Stop();
 
   bool IsOpen() { return this->PacketWriter.IsOpen(); }
 
   void Close() { this->PacketWriter.Close(); }
 
+protected:
+  void HandlePackets(const PacketRing& ring, const RawPacket* packets,
+                     size_t numberOfPackets) override;
+
+  void FinishListening() override { this->PacketWriter.Flush(); }
+
 private:
   vtkPacketFileWriter PacketWriter;
-  boost::shared_ptr<boost::thread> Thread;
-  boost::shared_ptr<SynchronizedQueue<NetworkPacket*>> Packets;
 };
 
 
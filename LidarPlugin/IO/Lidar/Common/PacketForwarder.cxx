@@ -0,0 +1,108 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "PacketForwarder.h"
+
+// VTK
+#include <vtkObject.h>
+#include <vtkSetGet.h>
+
+//-----------------------------------------------------------------------------
+PacketForwarder::PacketForwarder()
+  : Socket(IOService)
+{
+  this->Socket.open(boost::asio::ip::udp::v4()); // Opening the socket with an UDP v4 protocol
+  this->Socket.set_option(boost::asio::ip::multicast::enable_loopback(
+                            true)); // Allow to send the packet on the same machine
+}
+
+//-----------------------------------------------------------------------------
+PacketForwarder::~PacketForwarder()
+{
+  this->StopListening();
+}
+
+//-----------------------------------------------------------------------------
+bool PacketForwarder::SetDestination(const std::string& ip)
+{
+  // If the ip address is not valid we do not forward anything, as the
+  // application crashes on windows if a not valid ip address is provided
+  // with error message:
+  // Qt has caught an exception from an event handler. This
+  // is not supported in Qt.
+  boost::system::error_code errCode;
+  this->Destination = boost::asio::ip::address_v4::from_string(ip, errCode);
+  this->IsDestinationValid = !errCode;
+  if (!this->IsDestinationValid)
+  {
+    vtkGenericWarningMacro("Forward ip address not valid, packets won't be forwarded");
+  }
+  return this->IsDestinationValid;
+}
+
+//-----------------------------------------------------------------------------
+void PacketForwarder::AddForwardedPort(int receptionPort, int forwardedPort)
+{
+  ForwardedPort forwarded;
+  forwarded.ReceptionPort = receptionPort;
+  forwarded.Endpoint = boost::asio::ip::udp::endpoint(this->Destination, forwardedPort);
+  this->ForwardedPorts.push_back(forwarded);
+}
+
+//-----------------------------------------------------------------------------
+void PacketForwarder::RemoveAllForwardedPorts()
+{
+  this->ForwardedPorts.clear();
+}
+
+//-----------------------------------------------------------------------------
+void PacketForwarder::Start(std::shared_ptr<PacketRing> ring, size_t reader)
+{
+  this->StartListening(ring, reader);
+}
+
+//-----------------------------------------------------------------------------
+void PacketForwarder::Stop()
+{
+  this->StopListening();
+}
+
+//-----------------------------------------------------------------------------
+void PacketForwarder::HandlePackets(const PacketRing& ring, const RawPacket* packets,
+                                    size_t numberOfPackets)
+{
+  if (!this->IsDestinationValid)
+  {
+    return;
+  }
+
+  for (size_t i = 0; i < numberOfPackets; ++i)
+  {
+    const int receptionPort = ring.GetInformation(packets[i]).DestinationPort;
+    for (const auto& forwarded : this->ForwardedPorts)
+    {
+      if (forwarded.ReceptionPort == receptionPort)
+      {
+        boost::system::error_code errCode;
+        this->Socket.send_to(boost::asio::buffer(packets[i].Data, packets[i].Length),
+                             forwarded.Endpoint, 0, errCode);
+        break;
+      }
+    }
+  }
+}
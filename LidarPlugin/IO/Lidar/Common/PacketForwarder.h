@@ -0,0 +1,80 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef PACKETFORWARDER_H
+#define PACKETFORWARDER_H
+
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "PacketRingListener.h"
+
+/**
+ * \class PacketForwarder
+ * \brief Forward the received packets to another address, from the slots of the packet
+ *        ring read by the decoder, in its own thread.
+ *
+ * Each reception port is forwarded to its own destination port, so that the lidar and
+ * the position packets can be told apart by the receiver.
+ */
+class PacketForwarder : public PacketRingListener
+{
+public:
+  PacketForwarder();
+
+  ~PacketForwarder() override;
+
+  /**
+   * @brief SetDestination set the ip which will receive the forwarded packets
+   * @return false if the ip is not valid, the packets are then not forwarded
+   */
+  bool SetDestination(const std::string& ip);
+
+  //! Forward the packets received on receptionPort to forwardedPort of the destination,
+  //! which must be set before
+  void AddForwardedPort(int receptionPort, int forwardedPort);
+
+  //! Forward no packet anymore, must not be called while listening
+  void RemoveAllForwardedPorts();
+
+  //! Start forwarding the packets of the ring
+  void Start(std::shared_ptr<PacketRing> ring, size_t reader);
+
+  //! Stop once all the packets of the ring have been forwarded, the ring must be stopped
+  void Stop();
+
+protected:
+  void HandlePackets(const PacketRing& ring, const RawPacket* packets,
+                     size_t numberOfPackets) override;
+
+private:
+  struct ForwardedPort
+  {
+    int ReceptionPort;
+    boost::asio::ip::udp::endpoint Endpoint;
+  };
+
+  boost::asio::io_service IOService;
+  boost::asio::ip::udp::socket Socket;
+  boost::asio::ip::address Destination;
+  bool IsDestinationValid = false;
+  std::vector<ForwardedPort> ForwardedPorts;
+};
+
+#endif // PACKETFORWARDER_H
@@ -0,0 +1,183 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "PacketGapDetector.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+
+// BOOST
+#include <boost/thread/lock_guard.hpp>
+
+constexpr double PacketGapDetector::GapFactor;
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Number of steps missing in a step of several nominal steps, at least one
+uint32_t CountMissingSteps(double step, double nominalStep)
+{
+  return static_cast<uint32_t>(std::max(1.0, std::round(step / nominalStep) - 1.0));
+}
+}
+
+//-----------------------------------------------------------------------------
+void PacketGapDetector::NominalStep::Add(double step)
+{
+  if (!this->IsKnown())
+  {
+    // the first steps may contain a gap, the smallest one is the most likely to be regular
+    this->Value = this->NumberOfSamples == 0 ? step : std::min(this->Value, step);
+  }
+  else
+  {
+    this->Value += (step - this->Value) / 16.0;
+  }
+  ++this->NumberOfSamples;
+}
+
+//-----------------------------------------------------------------------------
+void PacketGapDetector::Reset()
+{
+  this->NumberOfPackets = 0;
+  this->FirstNetworkTime = 0.0;
+  this->LastTime = 0.0;
+  this->LastAzimuth = 0.0;
+  this->Period = NominalStep();
+  this->AzimuthStep = NominalStep();
+  boost::lock_guard<boost::mutex> lock(this->GapsMutex);
+  this->Gaps.clear();
+  this->NumberOfGaps = 0;
+  this->NumberOfMissingPackets = 0;
+}
+
+//-----------------------------------------------------------------------------
+void PacketGapDetector::AddPacket(double time, double azimuth, double networkTime)
+{
+  if (this->NumberOfPackets++ == 0)
+  {
+    this->FirstNetworkTime = networkTime;
+    this->LastTime = time;
+    this->LastAzimuth = azimuth;
+    return;
+  }
+
+  double timeStep = time - this->LastTime;
+  if (timeStep < -0.5 * this->TimePeriod)
+  {
+    timeStep += this->TimePeriod;
+  }
+  else if (timeStep > 0.5 * this->TimePeriod)
+  {
+    timeStep -= this->TimePeriod;
+  }
+  double azimuthStep = azimuth - this->LastAzimuth;
+  if (azimuthStep < 0.0)
+  {
+    azimuthStep += 360.0;
+  }
+  this->LastTime = time;
+  this->LastAzimuth = azimuth;
+
+  // the regular packets stop here
+  if (timeStep >= 0.0 && !this->Period.IsGap(timeStep) && !this->AzimuthStep.IsGap(azimuthStep))
+  {
+    if (timeStep > 0.0)
+    {
+      this->Period.Add(timeStep);
+    }
+    if (azimuthStep > 0.0)
+    {
+      this->AzimuthStep.Add(azimuthStep);
+    }
+    return;
+  }
+
+  Gap gap;
+  gap.Time = time;
+  gap.NetworkTime = networkTime;
+  gap.TimeStep = timeStep;
+  gap.AzimuthStep = azimuthStep;
+  if (timeStep < 0.0)
+  {
+    gap.Type = TimeJumpBack;
+  }
+  else if (this->Period.IsGap(timeStep))
+  {
+    gap.Type = TimeGap;
+    gap.NumberOfMissingPackets = CountMissingSteps(timeStep, this->Period.Value);
+  }
+  else
+  {
+    gap.Type = AzimuthGap;
+    gap.NumberOfMissingPackets = CountMissingSteps(azimuthStep, this->AzimuthStep.Value);
+  }
+  this->AddGap(gap);
+}
+
+//-----------------------------------------------------------------------------
+void PacketGapDetector::AddGap(const Gap& gap)
+{
+  boost::lock_guard<boost::mutex> lock(this->GapsMutex);
+  if (this->Gaps.size() < MaximumNumberOfGaps)
+  {
+    this->Gaps.push_back(gap);
+  }
+  this->NumberOfGaps.fetch_add(1, std::memory_order_relaxed);
+  this->NumberOfMissingPackets.fetch_add(gap.NumberOfMissingPackets, std::memory_order_relaxed);
+}
+
+//-----------------------------------------------------------------------------
+std::vector<PacketGapDetector::Gap> PacketGapDetector::GetGaps() const
+{
+  boost::lock_guard<boost::mutex> lock(this->GapsMutex);
+  return this->Gaps;
+}
+
+//-----------------------------------------------------------------------------
+void PacketGapDetector::Stitch(const PacketGapDetector& next)
+{
+  if (next.NumberOfPackets == 0)
+  {
+    return;
+  }
+  const std::vector<Gap> nextGaps = next.GetGaps();
+
+  boost::lock_guard<boost::mutex> lock(this->GapsMutex);
+  // the gap right before the first packet of next is only seen by this detector
+  auto overlap = std::find_if(this->Gaps.begin(), this->Gaps.end(),
+    [&next](const Gap& gap) { return gap.NetworkTime > next.FirstNetworkTime; });
+  for (auto it = overlap; it != this->Gaps.end(); ++it)
+  {
+    this->NumberOfGaps.fetch_sub(1, std::memory_order_relaxed);
+    this->NumberOfMissingPackets.fetch_sub(it->NumberOfMissingPackets, std::memory_order_relaxed);
+  }
+  this->Gaps.erase(overlap, this->Gaps.end());
+
+  const size_t numberOfKeptGaps = std::min(nextGaps.size(), MaximumNumberOfGaps - this->Gaps.size());
+  this->Gaps.insert(this->Gaps.end(), nextGaps.begin(), nextGaps.begin() + numberOfKeptGaps);
+  this->NumberOfGaps.fetch_add(next.GetNumberOfGaps(), std::memory_order_relaxed);
+  this->NumberOfMissingPackets.fetch_add(next.GetNumberOfMissingPackets(), std::memory_order_relaxed);
+
+  this->NumberOfPackets += next.NumberOfPackets;
+  this->LastTime = next.LastTime;
+  this->LastAzimuth = next.LastAzimuth;
+  this->Period = next.Period;
+  this->AzimuthStep = next.AzimuthStep;
+}
@@ -0,0 +1,138 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef PACKETGAPDETECTOR_H
+#define PACKETGAPDETECTOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+/**
+ * \class PacketGapDetector
+ * \brief Detect the discontinuities of the timestamps and of the azimuths of consecutive
+ *        lidar packets, from the values the interpreter already reads for each packet.
+ *
+ * The nominal period of the packets and their nominal azimuth step are estimated on the
+ * fly, as a running average of the regular steps. A packet comes after a gap if its
+ * timestamp step is above GapFactor times the nominal period, or if its timestamp goes
+ * back in time. A packet with a regular timestamp step but an azimuth step above GapFactor
+ * times the nominal one comes after an azimuth gap, i.e. the sensor has not sent a part
+ * of its rotation. The timestamps and the azimuths are expected modulo a period, their
+ * rollover is not a gap.
+ *
+ * The gaps are kept in a compact table of at most MaximumNumberOfGaps entries, the counters
+ * keep counting once it is full. The counters can be read from any thread, the table is
+ * copied under a lock only taken to add a gap, so that the regular packets cost a few
+ * comparisons.
+ */
+class PacketGapDetector
+{
+public:
+  enum GapType
+  {
+    TimeGap = 0,      /*!< packets missing, according to the timestamps */
+    TimeJumpBack = 1, /*!< the timestamp goes back in time */
+    AzimuthGap = 2,   /*!< a part of the rotation is missing, with regular timestamps */
+  };
+
+  //! A discontinuity, located at the first packet after it
+  struct Gap
+  {
+    GapType Type = TimeGap;
+    //! Timestamp of the packet, in seconds, modulo TimePeriod
+    double Time = 0.0;
+    //! Network time of the packet, 0 if it is unknown
+    double NetworkTime = 0.0;
+    //! Step of the timestamps over the gap, in seconds, negative for a jump back
+    double TimeStep = 0.0;
+    //! Step of the azimuths over the gap, in degrees in [0, 360)
+    double AzimuthStep = 0.0;
+    //! Estimation of the number of packets missing, 0 for a jump back
+    uint32_t NumberOfMissingPackets = 0;
+  };
+
+  static const size_t MaximumNumberOfGaps = 65536;
+
+  //! Ratio of the nominal step above which a step is a gap
+  static constexpr double GapFactor = 1.5;
+
+  //! Period of the timestamps, in seconds (e.g. the top of the hour)
+  void SetTimePeriod(double period) { this->TimePeriod = period; }
+  double GetTimePeriod() const { return this->TimePeriod; }
+
+  //! Forget the previous packets and the gaps
+  void Reset();
+
+  /**
+   * @brief AddPacket check a packet against the previous one
+   * @param time timestamp of the packet in seconds, modulo TimePeriod
+   * @param azimuth azimuth of the first firing of the packet in degrees, modulo 360
+   * @param networkTime network time of the packet, 0 if it is unknown
+   */
+  void AddPacket(double time, double azimuth, double networkTime = 0.0);
+
+  //! Copy of the gaps found since the last reset, the oldest first
+  std::vector<Gap> GetGaps() const;
+
+  //! Number of gaps found since the last reset, including the ones not kept in the table
+  size_t GetNumberOfGaps() const { return this->NumberOfGaps.load(std::memory_order_relaxed); }
+
+  //! Number of packets missing since the last reset, according to the timestamps and azimuths
+  size_t GetNumberOfMissingPackets() const { return this->NumberOfMissingPackets.load(std::memory_order_relaxed); }
+
+  //! Network time of the first packet checked since the last reset
+  double GetFirstNetworkTime() const { return this->FirstNetworkTime; }
+
+  /**
+   * @brief Stitch append the gaps found by a detector which has checked the packets
+   * following the ones of this one, the gaps of this one found after the first packet
+   * of the other one being removed (see vtkLidarPacketInterpreter::NewPreProcessingInstance)
+   */
+  void Stitch(const PacketGapDetector& next);
+
+private:
+  void AddGap(const Gap& gap);
+
+  //! Running average of the regular steps, the first steps being used as is
+  struct NominalStep
+  {
+    double Value = 0.0;
+    size_t NumberOfSamples = 0;
+    bool IsKnown() const { return this->NumberOfSamples >= 4; }
+    bool IsGap(double step) const { return this->IsKnown() && step > GapFactor * this->Value; }
+    void Add(double step);
+  };
+
+  double TimePeriod = 3600.0;
+
+  size_t NumberOfPackets = 0;
+  double FirstNetworkTime = 0.0;
+  double LastTime = 0.0;
+  double LastAzimuth = 0.0;
+  NominalStep Period;
+  NominalStep AzimuthStep;
+
+  std::atomic<size_t> NumberOfGaps{ 0 };
+  std::atomic<size_t> NumberOfMissingPackets{ 0 };
+  mutable boost::mutex GapsMutex;
+  std::vector<Gap> Gaps;
+};
+
+#endif // PACKETGAPDETECTOR_H
@@ -22,14 +22,24 @@
 
 #include <vtkMath.h>
 
+#include <algorithm>
+#include <cstring>
+
+#ifdef __linux__
+#include <cerrno>
+#include <time.h>
+
+namespace
+{
+//! Size of the ancillary data of a message, enough for a SCM_TIMESTAMPNS and a SO_RXQ_OVFL
+const std::size_t ControlSize = CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(uint32_t));
+}
+#endif
 
 //-----------------------------------------------------------------------------
-PacketReceiver::PacketReceiver(boost::asio::io_service &io, int port, int forwardport, std::string forwarddestinationIp, bool isforwarding, NetworkSource *parent)
-  : isForwarding(isforwarding)
-  , Port(port)
-  , PacketCounter(0)
+PacketReceiver::PacketReceiver(boost::asio::io_service &io, int port, NetworkSource *parent)
+  : Port(port)
   , Socket(io)
-  , ForwardedSocket(io)
   , Parent(parent)
   , IsReceiving(true)
   , ShouldStop(false)
@@ -39,39 +49,12 @@ PacketReceiver::PacketReceiver(boost::asio::io_service &io, int port, int forwar
                       true)); // Tell the OS we accept to re-use the port address for an other app
   this->Socket.bind(boost::asio::ip::udp::endpoint(
                 boost::asio::ip::udp::v4(), port)); // Bind the socket to the right address
-
-  // Check that the provided ipadress is valid
-  boost::system::error_code errCode;
-  boost::asio::ip::address ipAddressForwarding = boost::asio::ip::address_v4::from_string(forwarddestinationIp, errCode);
-
-  // If the ip address is not valid we replace it by a generic
-  // 0.0.0.0 ip address. This is due to the application
-  // crashes on windows if a not valid ip address is provided
-  // with error message:
-  // Qt has caught an exception from an event handler. This
-  // is not supported in Qt.
-  if (errCode)
-  {
-    ipAddressForwarding = boost::asio::ip::address_v4::from_string("0.0.0.0");
-    if (this->isForwarding)
-    {
-      vtkGenericWarningMacro("Forward ip address not valid, packets won't be forwarded");
-      this->isForwarding = false;
-    }
-  }
-
-  this->ForwardEndpoint = boost::asio::ip::udp::endpoint(ipAddressForwarding, forwardport);
-  this->ForwardedSocket.open(ForwardEndpoint.protocol()); // Opening the socket with an UDP v4 protocol
-  // toward the forwarded ip address and port
-  this->ForwardedSocket.set_option(boost::asio::ip::multicast::enable_loopback(
-                                true)); // Allow to send the packet on the same machine
 }
 
 //-----------------------------------------------------------------------------
 PacketReceiver::~PacketReceiver()
 {
   this->Socket.cancel();
-  this->ForwardedSocket.cancel();
   {
     boost::unique_lock<boost::mutex> guard(this->IsReceivingMtx);
     this->ShouldStop = true;
@@ -80,16 +63,6 @@ PacketReceiver::~PacketReceiver()
       this->IsReceivingCond.wait(guard);
     }
   }
-
-  // Close and delete the logs files. So that,
-  // if a log file is present in the next session
-  // it means that the software has been closed
-  // properly (potentially a crash)
-  if (this->IsCrashAnalysing)
-  {
-    this->CrashAnalysis.CloseAnalyzer();
-    this->CrashAnalysis.DeleteLogFiles();
-  }
 }
 
 //-----------------------------------------------------------------------------
@@ -100,6 +73,15 @@ void PacketReceiver::StartReceive()
     this->IsReceiving = true;
   }
 
+  if (this->UseBatchedReceive)
+  {
+    // only wait for the socket to be readable, the datagrams are then read by ReceiveBatch
+    this->Socket.async_receive(boost::asio::null_buffers(),
+                               boost::bind(&PacketReceiver::BatchCallback, this,
+                                           boost::asio::placeholders::error));
+    return;
+  }
+
   // expecting exactly 1206 bytes, using a larger buffer so that if a
   // larger packet arrives unexpectedly we'll notice it.
   this->Socket.async_receive_from(boost::asio::buffer(this->RXBuffer, BUFFER_SIZE),
@@ -109,19 +91,161 @@ void PacketReceiver::StartReceive()
 }
 
 //-----------------------------------------------------------------------------
-void PacketReceiver::EnableCrashAnalysing(std::string filenameCrashAnalysis_, unsigned int nbrPacketToStore_, bool isCrashAnalysing_)
+void PacketReceiver::SetReceiveBufferSize(int size)
+{
+  if (size <= 0)
+  {
+    return;
+  }
+
+  boost::system::error_code errCode;
+  this->Socket.set_option(boost::asio::socket_base::receive_buffer_size(size), errCode);
+  boost::asio::socket_base::receive_buffer_size obtainedSize;
+  this->Socket.get_option(obtainedSize, errCode);
+  // Linux reports twice the requested value to account for its bookkeeping overhead
+  if (errCode || obtainedSize.value() < size)
+  {
+    vtkGenericWarningMacro("Could not set the receive buffer size of port "
+                           << this->Port << " to " << size << " bytes, got "
+                           << obtainedSize.value() << " bytes. "
+                           << "The maximum may have to be increased in the system settings.");
+  }
+}
+
+//-----------------------------------------------------------------------------
+void PacketReceiver::EnableBatchedReceive(bool enable)
 {
-  this->IsCrashAnalysing = isCrashAnalysing_;
+#ifdef __linux__
+  this->UseBatchedReceive = enable;
+  if (!enable)
+  {
+    return;
+  }
+
+  int timestamping = 1;
+  if (setsockopt(this->Socket.native_handle(), SOL_SOCKET, SO_TIMESTAMPNS,
+                 &timestamping, sizeof(timestamping)) != 0)
+  {
+    vtkGenericWarningMacro("Kernel timestamps are not available on port " << this->Port);
+  }
+#ifdef SO_RXQ_OVFL
+  int dropCounting = 1;
+  setsockopt(this->Socket.native_handle(), SOL_SOCKET, SO_RXQ_OVFL, &dropCounting, sizeof(dropCounting));
+#endif
 
-  // Opening crash analysis file
-  if (this->IsCrashAnalysing)
+  this->BatchBuffers.resize(RECEIVE_BATCH_SIZE * BUFFER_SIZE);
+  this->BatchHeaders.resize(RECEIVE_BATCH_SIZE);
+  this->BatchVectors.resize(RECEIVE_BATCH_SIZE);
+  this->BatchSenders.resize(RECEIVE_BATCH_SIZE);
+  this->BatchControls.resize(RECEIVE_BATCH_SIZE * ControlSize);
+#else
+  (void)enable;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void PacketReceiver::StopReceiving()
+{
   {
-    this->CrashAnalysis.SetNbrPacketsToStore(nbrPacketToStore_);
-    this->CrashAnalysis.SetFilename(filenameCrashAnalysis_);
-    this->CrashAnalysis.ArchivePreviousLogIfExist();
+    boost::lock_guard<boost::mutex> guard(this->IsReceivingMtx);
+    this->IsReceiving = false;
   }
+  this->IsReceivingCond.notify_one();
 }
 
+//-----------------------------------------------------------------------------
+void PacketReceiver::BatchCallback(const boost::system::error_code& error)
+{
+#ifdef __linux__
+  if (error || this->ShouldStop || !this->ReceiveBatch())
+  {
+    this->StopReceiving();
+    return;
+  }
+  this->StartReceive();
+#else
+  (void)error;
+  this->StopReceiving();
+#endif
+}
+
+#ifdef __linux__
+//-----------------------------------------------------------------------------
+bool PacketReceiver::ReceiveBatch()
+{
+  // Drain the socket: keep reading as long as the previous call filled the whole batch
+  int numberOfMessages = RECEIVE_BATCH_SIZE;
+  while (numberOfMessages == RECEIVE_BATCH_SIZE && !this->ShouldStop)
+  {
+    for (int i = 0; i < RECEIVE_BATCH_SIZE; ++i)
+    {
+      this->BatchVectors[i].iov_base = &this->BatchBuffers[i * BUFFER_SIZE];
+      this->BatchVectors[i].iov_len = BUFFER_SIZE;
+      struct msghdr& header = this->BatchHeaders[i].msg_hdr;
+      std::memset(&header, 0, sizeof(header));
+      header.msg_name = &this->BatchSenders[i];
+      header.msg_namelen = sizeof(struct sockaddr_in);
+      header.msg_iov = &this->BatchVectors[i];
+      header.msg_iovlen = 1;
+      header.msg_control = &this->BatchControls[i * ControlSize];
+      header.msg_controllen = ControlSize;
+      this->BatchHeaders[i].msg_len = 0;
+    }
+
+    numberOfMessages = recvmmsg(this->Socket.native_handle(), this->BatchHeaders.data(),
+                                RECEIVE_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+    if (numberOfMessages < 0)
+    {
+      // nothing left to read, or interrupted by a signal: wait for the next notification
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+
+    for (int i = 0; i < numberOfMessages; ++i)
+    {
+      const struct msghdr& header = this->BatchHeaders[i].msg_hdr;
+
+      struct timeval receptionTime;
+      bool hasReceptionTime = false;
+      for (struct cmsghdr* control = CMSG_FIRSTHDR(&header); control != nullptr;
+           control = CMSG_NXTHDR(const_cast<struct msghdr*>(&header), control))
+      {
+        if (control->cmsg_level == SOL_SOCKET && control->cmsg_type == SCM_TIMESTAMPNS)
+        {
+          struct timespec kernelTime;
+          std::memcpy(&kernelTime, CMSG_DATA(control), sizeof(kernelTime));
+          receptionTime.tv_sec = kernelTime.tv_sec;
+          receptionTime.tv_usec = kernelTime.tv_nsec / 1000;
+          hasReceptionTime = true;
+        }
+#ifdef SO_RXQ_OVFL
+        // number of datagrams dropped by the socket since its creation
+        else if (control->cmsg_level == SOL_SOCKET && control->cmsg_type == SO_RXQ_OVFL)
+        {
+          uint32_t socketDrops;
+          std::memcpy(&socketDrops, CMSG_DATA(control), sizeof(socketDrops));
+          this->Parent->NumberOfSocketDrops += socketDrops - this->SocketDrops;
+          this->SocketDrops = socketDrops;
+        }
+#endif
+      }
+
+      // sourceIP has network endianess (so big endian).
+      const struct sockaddr_in& sender = this->BatchSenders[i];
+      unsigned char sourceIP[4] = {192, 168, 0, 200};
+      if (header.msg_namelen >= sizeof(struct sockaddr_in) && sender.sin_family == AF_INET)
+      {
+        std::memcpy(sourceIP, &sender.sin_addr.s_addr, 4);
+      }
+
+      this->HandlePacket(&this->BatchBuffers[i * BUFFER_SIZE], this->BatchHeaders[i].msg_len,
+                         sourceIP, ntohs(sender.sin_port),
+                         hasReceptionTime ? &receptionTime : nullptr);
+    }
+  }
+  return true;
+}
+#endif
+
 //-----------------------------------------------------------------------------
 void PacketReceiver::SocketCallback(
   const boost::system::error_code& error, std::size_t numberOfBytes)
@@ -130,16 +254,10 @@ void PacketReceiver::SocketCallback(
   {
     // This is called on cancel
     // TODO: Check other error codes
-    {
-      boost::lock_guard<boost::mutex> guard(this->IsReceivingMtx);
-      this->IsReceiving = false;
-    }
-    this->IsReceivingCond.notify_one();
-
+    this->StopReceiving();
     return;
   }
 
-  unsigned short ourPort = static_cast<unsigned short>(this->Port);
   // endpoint::port() is in host byte order
   unsigned short sourcePort = this->SenderEndpoint.port();
   // sourceIP has network endianess (so big endian).
@@ -152,12 +270,6 @@ void PacketReceiver::SocketCallback(
       sourceIP[i] = this->SenderEndpoint.address().to_v4().to_bytes()[i];
     }
   }
-  // TODO: IPV6 is recorded as fake ipv4 packet -> create BuildEthernetIP6UDP
-  NetworkPacket* packet = NetworkPacket::BuildEthernetIP4UDP(this->RXBuffer,
-                                                       numberOfBytes,
-                                                       sourceIP,
-                                                       sourcePort,
-                                                       ourPort);
 
   // std::cout << this->Socket.remote_endpoint().address() << std::endl;
 
@@ -165,23 +277,28 @@ void PacketReceiver::SocketCallback(
   // other data than ip source and port source is provided (which is normal,
   // we are working at the application level).
 
-  if (this->isForwarding)
-  {
-    ForwardedSocket.send_to(boost::asio::buffer(packet->GetPayloadData(), packet->GetPayloadSize()), ForwardEndpoint);
-  }
+  this->HandlePacket(this->RXBuffer, numberOfBytes, sourceIP, sourcePort, nullptr);
 
-  if (this->IsCrashAnalysing)
-  {
-    this->CrashAnalysis.AddPacket(*packet);
-  }
+  this->StartReceive();
+}
 
-  this->Parent->QueuePackets(packet);
+//-----------------------------------------------------------------------------
+void PacketReceiver::HandlePacket(const unsigned char* data, std::size_t numberOfBytes,
+                                  const unsigned char sourceIP[4], unsigned short sourcePort,
+                                  const struct timeval* receptionTime)
+{
+  // The payload is copied once from the reception buffer to the queue, its readers
+  // (decoder, recorder, forwarder...) work on that copy
+  PacketRing::PacketInformation information;
+  information.ReceptionTime = receptionTime ? *receptionTime : NetworkPacket::CurrentTime();
+  std::copy(sourceIP, sourceIP + 4, information.SourceIP);
+  information.SourcePort = sourcePort;
+  information.DestinationPort = static_cast<unsigned short>(this->Port);
 
-  this->StartReceive();
+  this->Parent->QueuePacket(data, static_cast<unsigned int>(numberOfBytes), information);
 
-  if ((++this->PacketCounter % 5000) == 0)
-  {
-    std::cout << "RECV packets: " << this->PacketCounter << " on " << this->Port << std::endl;
-  }
+  // a single thread receives the packets, the counters are only read by the others
+  this->Parent->NumberOfReceivedPackets.fetch_add(1, std::memory_order_relaxed);
+  this->Parent->NumberOfReceivedBytes.fetch_add(numberOfBytes, std::memory_order_relaxed);
 }
 
@@ -16,7 +16,7 @@
 #define PACKETRECEIVER_H
 
 // LOCAL
-#include "CrashAnalysing.h"
+#include "PacketRing.h"
 
 // BOOST
 #include <boost/asio.hpp>
@@ -25,20 +25,27 @@
 // STD
 #include <fstream>
 #include <iostream>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
 
 class NetworkSource;
 
 /*!< Size of the buffer used to store the data received */
 #define BUFFER_SIZE 1500
 
-/*!< Number of packed save when the option CrashAnalysing is set */
-#define NBR_PACKETS_SAVED  1500
+/*!< Maximum number of packets read by a single recvmmsg call in batched mode */
+#define RECEIVE_BATCH_SIZE 64
 
 /**
  * \class PacketReceiver
  * \brief This classs is reponsbale for listening on a socket and each time a packet is received,
  * it will enqueue the packet on a specific Queue. Here it is used to setup an UDP multicast protocol.
- * The packet receiver can forward the received packets and/or store them in a output bin file
+ * The forwarding and the recording of the packets are done by the readers of the queue,
+ * so that the reception thread only copies each packet once.
 */
 class PacketReceiver
 {
@@ -47,13 +54,9 @@ public:
    * @brief PacketReceiver
    * @param io The in/out service used to handle the reception of the packets
    * @param port The port address which will receive the packet
-   * @param forwardport The port adress which will receive the forwarded packets
-   * @param forwarddestinationIp The IP adress of the computer which will receive the forwarded packets
-   * @param isforwarding Allow or not the forwarding of the packets
    * @param parent @todo to replace by a synchronizedQueue
    */
-  PacketReceiver(boost::asio::io_service& io, int port, int forwardport,
-    std::string forwarddestinationIp, bool isforwarding, NetworkSource* parent);
+  PacketReceiver(boost::asio::io_service& io, int port, NetworkSource* parent);
 
   ~PacketReceiver();
 
@@ -64,37 +67,63 @@ public:
   void StartReceive();
 
   /**
-   * @brief EnableCrashAnalysing
-   * @param filenameCrashAnalysis_ the name of the output file
-   * @param nbrPacketToStore the number of packets to store
-   * @param isCrashAnalysing_ Enable the crash analysing
+   * @brief SetReceiveBufferSize request a specific size for the kernel receive buffer
+   * of the socket (SO_RCVBUF). The kernel may cap the value (net.core.rmem_max on Linux),
+   * a warning is raised if the size obtained is smaller than the one requested.
+   * @param size size in bytes, 0 keeps the system default
+   */
+  void SetReceiveBufferSize(int size);
+
+  /**
+   * @brief EnableBatchedReceive on Linux, drain the socket with recvmmsg each time it
+   * becomes readable instead of receiving the datagrams one by one, and use the kernel
+   * reception timestamps (SO_TIMESTAMPNS) for the recorded packets. The datagrams dropped
+   * by the kernel are counted with SO_RXQ_OVFL (see NetworkSource::NumberOfSocketDrops).
+   * Does nothing on the other platforms. Must be called before StartReceive.
    */
-  void EnableCrashAnalysing(std::string filenameCrashAnalysis_, unsigned int nbrPacketToStore_, bool isCrashAnalysing_);
+  void EnableBatchedReceive(bool enable);
+
+  //! Whether the batched receive mode is active
+  bool IsBatchedReceiveEnabled() const { return this->UseBatchedReceive; }
 
   void SocketCallback(const boost::system::error_code& error, std::size_t numberOfBytes);
 
+  //! Called when the socket becomes readable in batched mode
+  void BatchCallback(const boost::system::error_code& error);
+
 private:
-  /*!< Allow or not the forwarding of the packets */
-  bool isForwarding;
+  /**
+   * @brief HandlePacket enqueue a received datagram
+   * @param data payload of the datagram
+   * @param numberOfBytes size of the payload
+   * @param sourceIP ip of the sender, in network byte order
+   * @param sourcePort port of the sender, in host byte order
+   * @param receptionTime reception time given by the kernel, nullptr if not available
+   */
+  void HandlePacket(const unsigned char* data, std::size_t numberOfBytes,
+                    const unsigned char sourceIP[4], unsigned short sourcePort,
+                    const struct timeval* receptionTime);
+
+  //! Mark the receiver as stopped and wake up the destructor
+  void StopReceiving();
+
+#ifdef __linux__
+  //! Read all the datagrams available on the socket with recvmmsg, return false on error
+  bool ReceiveBatch();
+#endif
 
   /*!< EndPoint of the sender, contains only sender ip, sender port */
   boost::asio::ip::udp::endpoint SenderEndpoint;
 
-  /*!< EndPoint to forward to, contain information such as forward ip, forward port */
-  boost::asio::ip::udp::endpoint ForwardEndpoint;
-  
   /*!< Port address which will receive the packet */
   int Port;                
   
-  /*!< Number of packets received */
-  int PacketCounter;
+  /*!< Number of datagrams dropped by the kernel for this socket, as last reported by SO_RXQ_OVFL */
+  uint32_t SocketDrops = 0;
 
   /*!< Socket : determines the protocol used and the address used for the reception of the packets */
   boost::asio::ip::udp::socket Socket;
 
-  /*!< Socket : determines the protocol used and the address used for the reception of the forwarded packets */
-  boost::asio::ip::udp::socket ForwardedSocket;
-
   /*!< Network Shouce where the packet will be enqueue */
   NetworkSource* Parent;
 
@@ -106,9 +135,19 @@ private:
   bool ShouldStop;  /*!< Flag indicating if we should stop the listening */
   boost::mutex IsReceivingMtx; /*!< Mutex : Block the access of IsReceiving when a thread is seting the flag */
   boost::condition_variable IsReceivingCond;
-  boost::mutex IsWriting;
-  bool IsCrashAnalysing = false;
-  CrashAnalysisWriter CrashAnalysis;
+
+  //! Whether the socket is drained with recvmmsg
+  bool UseBatchedReceive = false;
+
+#ifdef __linux__
+  //! Storage of the datagrams received by a single recvmmsg call
+  std::vector<unsigned char> BatchBuffers;
+  std::vector<struct mmsghdr> BatchHeaders;
+  std::vector<struct iovec> BatchVectors;
+  std::vector<struct sockaddr_in> BatchSenders;
+  //! Ancillary data containing the kernel timestamps
+  std::vector<char> BatchControls;
+#endif
 };
 
 #endif // PACKETRECEIVER_H
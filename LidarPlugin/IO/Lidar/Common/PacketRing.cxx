@@ -0,0 +1,234 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "PacketRing.h"
+
+// STD
+#include <algorithm>
+#include <cstring>
+
+// BOOST
+#include <boost/thread/locks.hpp>
+
+namespace
+{
+// Maximum time to sleep without checking the ring, in case a notification is missed
+const int MaximumWaitMilliseconds = 10;
+
+//-----------------------------------------------------------------------------
+size_t NextPowerOfTwo(size_t value)
+{
+  size_t result = 1;
+  while (result < value)
+  {
+    result <<= 1;
+  }
+  return result;
+}
+}
+
+//-----------------------------------------------------------------------------
+PacketRing::PacketRing(size_t capacity, size_t slotSize, size_t numberOfReaders)
+  : SlotSize(slotSize)
+  , NumberOfReaders(std::max(numberOfReaders, static_cast<size_t>(1)))
+{
+  capacity = NextPowerOfTwo(std::max(capacity, static_cast<size_t>(2)));
+  this->Slots.resize(capacity * slotSize);
+  this->Lengths.resize(capacity, 0);
+  this->Informations.resize(capacity);
+  this->Mask = capacity - 1;
+  this->Head.Value = 0;
+  this->Tails.reset(new Counter[this->NumberOfReaders]);
+  for (size_t reader = 0; reader < this->NumberOfReaders; ++reader)
+  {
+    this->Tails[reader].Value = 0;
+  }
+  this->Stopped = false;
+  this->Policy = DropNewest;
+  this->NumberOfDroppedPackets = 0;
+  this->HighWaterMark = 0;
+  this->NumberOfWaitingReaders = 0;
+  this->ProducerIsWaiting = false;
+}
+
+//-----------------------------------------------------------------------------
+size_t PacketRing::GetSlowestTail() const
+{
+  size_t tail = this->Tails[0].Value.load();
+  for (size_t reader = 1; reader < this->NumberOfReaders; ++reader)
+  {
+    tail = std::min(tail, this->Tails[reader].Value.load());
+  }
+  return tail;
+}
+
+//-----------------------------------------------------------------------------
+bool PacketRing::Push(const unsigned char* data, unsigned int length,
+                      const PacketInformation* information)
+{
+  const size_t head = this->Head.Value.load(std::memory_order_relaxed);
+  size_t tail = this->GetSlowestTail();
+  while (head - tail == this->Lengths.size())
+  {
+    if (this->Stopped || this->Policy == DropNewest)
+    {
+      this->NumberOfDroppedPackets.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    // wait for the slowest reader to release some slots
+    boost::unique_lock<boost::mutex> lock(this->WaitMutex);
+    this->ProducerIsWaiting = true;
+    tail = this->GetSlowestTail();
+    if (head - tail == this->Lengths.size())
+    {
+      this->ProducerCondition.wait_for(lock, boost::chrono::milliseconds(MaximumWaitMilliseconds));
+      tail = this->GetSlowestTail();
+    }
+    this->ProducerIsWaiting = false;
+  }
+  if (this->Stopped)
+  {
+    this->NumberOfDroppedPackets.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  const size_t slot = head & this->Mask;
+  const size_t size = std::min(static_cast<size_t>(length), this->SlotSize);
+  std::memcpy(this->Slots.data() + slot * this->SlotSize, data, size);
+  this->Lengths[slot] = static_cast<unsigned int>(size);
+  if (information)
+  {
+    this->Informations[slot] = *information;
+  }
+  else
+  {
+    std::memset(&this->Informations[slot], 0, sizeof(PacketInformation));
+  }
+  // sequentially consistent, so that NumberOfWaitingReaders can not be read before the
+  // new head is visible: either a reader sees the packet, or it is notified
+  this->Head.Value.store(head + 1);
+
+  const size_t numberOfPackets = head + 1 - tail;
+  if (numberOfPackets > this->HighWaterMark.load(std::memory_order_relaxed))
+  {
+    this->HighWaterMark.store(numberOfPackets, std::memory_order_relaxed);
+  }
+
+  if (this->NumberOfWaitingReaders > 0)
+  {
+    this->NotifyReaders();
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void PacketRing::NotifyReaders()
+{
+  boost::lock_guard<boost::mutex> lock(this->WaitMutex);
+  this->ReaderCondition.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+bool PacketRing::WaitForPackets(size_t reader)
+{
+  const Counter& tail = this->Tails[reader];
+  while (!this->Stopped)
+  {
+    if (this->Head.Value.load(std::memory_order_acquire) !=
+        tail.Value.load(std::memory_order_relaxed))
+    {
+      return true;
+    }
+
+    boost::unique_lock<boost::mutex> lock(this->WaitMutex);
+    ++this->NumberOfWaitingReaders;
+    if (this->Head.Value.load() == tail.Value.load(std::memory_order_relaxed) &&
+        !this->Stopped)
+    {
+      this->ReaderCondition.wait_for(lock, boost::chrono::milliseconds(MaximumWaitMilliseconds));
+    }
+    --this->NumberOfWaitingReaders;
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+size_t PacketRing::Peek(RawPacket* packets, size_t maximum, size_t reader)
+{
+  const size_t tail = this->Tails[reader].Value.load(std::memory_order_relaxed);
+  const size_t head = this->Head.Value.load(std::memory_order_acquire);
+  const size_t numberOfPackets = std::min(head - tail, maximum);
+  for (size_t i = 0; i < numberOfPackets; ++i)
+  {
+    const size_t slot = (tail + i) & this->Mask;
+    packets[i].Data = this->Slots.data() + slot * this->SlotSize;
+    packets[i].Length = this->Lengths[slot];
+  }
+  return numberOfPackets;
+}
+
+//-----------------------------------------------------------------------------
+size_t PacketRing::GetNumberOfPackets(size_t reader) const
+{
+  const size_t tail = this->Tails[reader].Value.load(std::memory_order_relaxed);
+  const size_t head = this->Head.Value.load(std::memory_order_relaxed);
+  return head > tail ? head - tail : 0;
+}
+
+//-----------------------------------------------------------------------------
+const PacketRing::PacketInformation& PacketRing::GetInformation(const RawPacket& packet) const
+{
+  const size_t slot = static_cast<size_t>(packet.Data - this->Slots.data()) / this->SlotSize;
+  return this->Informations[slot];
+}
+
+//-----------------------------------------------------------------------------
+void PacketRing::Release(size_t numberOfPackets, size_t reader)
+{
+  Counter& tail = this->Tails[reader];
+  // sequentially consistent, for the same reason as the head in Push
+  tail.Value.store(tail.Value.load(std::memory_order_relaxed) + numberOfPackets);
+  if (this->ProducerIsWaiting)
+  {
+    boost::lock_guard<boost::mutex> lock(this->WaitMutex);
+    this->ProducerCondition.notify_one();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void PacketRing::Stop()
+{
+  boost::lock_guard<boost::mutex> lock(this->WaitMutex);
+  this->Stopped = true;
+  this->ReaderCondition.notify_all();
+  this->ProducerCondition.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+void PacketRing::Restart()
+{
+  const size_t head = this->Head.Value.load();
+  for (size_t reader = 0; reader < this->NumberOfReaders; ++reader)
+  {
+    this->Tails[reader].Value.store(head);
+  }
+  this->NumberOfDroppedPackets = 0;
+  this->HighWaterMark = 0;
+  this->Stopped = false;
+}
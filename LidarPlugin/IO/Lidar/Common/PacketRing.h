@@ -0,0 +1,185 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef PACKETRING_H
+#define PACKETRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <winsock2.h>
+#else
+#include <sys/time.h>
+#endif
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "vtkLidarPacketInterpreter.h"
+
+/**
+ * \class PacketRing
+ * \brief Bounded lock-free single producer / multiple readers queue of packets,
+ *        stored in fixed size slots allocated once.
+ *
+ * The producer copies each packet in a free slot with Push, each reader gets views
+ * on the filled slots with Peek and gives them back with Release once processed.
+ * A slot is only reused once all the readers have released it, so that the decoder,
+ * the recorder and the forwarder can all work on the same copy of a packet.
+ * No lock is taken and no memory is allocated per packet: the only synchronization
+ * is done with atomic counters. A reader only takes a lock when it has read all the
+ * packets and it has to sleep, and the producer only when a thread is sleeping.
+ *
+ * Push must always be called from the same thread, and Peek, Release and WaitForPackets
+ * of a given reader from another single thread.
+ */
+class PacketRing
+{
+public:
+  /**
+   * @brief The OverflowPolicy enum selects what Push does when the ring is full
+   */
+  enum OverflowPolicy
+  {
+    DropNewest = 0, /*!< The packet given to Push is dropped */
+    Wait = 1,       /*!< Push waits for the slowest reader to release a slot */
+  };
+
+  /**
+   * @brief The PacketInformation struct holds what is known about a packet
+   * besides its payload, needed to record it or to dispatch it
+   */
+  struct PacketInformation
+  {
+    struct timeval ReceptionTime;
+    //! in network byte order
+    unsigned char SourceIP[4];
+    unsigned short SourcePort;
+    unsigned short DestinationPort;
+  };
+
+  /**
+   * @brief PacketRing allocate the slots of the ring
+   * @param capacity number of slots, rounded up to a power of two
+   * @param slotSize maximum size of a packet, bigger packets are truncated
+   * @param numberOfReaders number of readers which must release a packet before its slot is reused
+   */
+  PacketRing(size_t capacity, size_t slotSize, size_t numberOfReaders = 1);
+
+  /**
+   * @brief Push producer: copy a packet in the ring
+   * @param information optional information about the packet, zeroed if not given
+   * @return false if the packet has been dropped
+   */
+  bool Push(const unsigned char* data, unsigned int length,
+            const PacketInformation* information = nullptr);
+
+  /**
+   * @brief WaitForPackets reader: wait until the ring contains some packets not read yet
+   * @return false if the ring has been stopped
+   */
+  bool WaitForPackets(size_t reader = 0);
+
+  /**
+   * @brief Peek reader: get the oldest packets of the ring not released yet by this
+   * reader, which stay valid until they are released
+   * @param packets[out] views on the packets
+   * @param maximum maximum number of packets
+   * @param reader the reader index
+   * @return the number of packets
+   */
+  size_t Peek(RawPacket* packets, size_t maximum, size_t reader = 0);
+
+  //! Reader: give back the slots of the numberOfPackets oldest packets
+  void Release(size_t numberOfPackets, size_t reader = 0);
+
+  //! Information about a packet returned by Peek, valid as long as the packet
+  const PacketInformation& GetInformation(const RawPacket& packet) const;
+
+  //! Stop the ring: the waiting threads are woken up and the new packets are dropped
+  void Stop();
+
+  /**
+   * @brief Restart drop all the packets of the ring, reset the counters and allow new
+   * packets. Must not be called while the reader threads are running.
+   */
+  void Restart();
+
+  void SetOverflowPolicy(OverflowPolicy policy) { this->Policy = policy; }
+  OverflowPolicy GetOverflowPolicy() const { return this->Policy; }
+
+  size_t GetCapacity() const { return this->Lengths.size(); }
+
+  size_t GetNumberOfReaders() const { return this->NumberOfReaders; }
+
+  //! Number of packets dropped because the ring was full or stopped
+  size_t GetNumberOfDroppedPackets() const { return this->NumberOfDroppedPackets.load(); }
+
+  //! Maximum number of packets that have been waiting in the ring at the same time
+  size_t GetHighWaterMark() const { return this->HighWaterMark.load(); }
+
+  //! Number of packets waiting to be released by a reader
+  size_t GetNumberOfPackets(size_t reader = 0) const;
+
+private:
+  PacketRing(const PacketRing&) = delete;
+  PacketRing& operator=(const PacketRing&) = delete;
+
+  //! Number of packets released by all the readers
+  size_t GetSlowestTail() const;
+
+  //! Wake up the readers which are sleeping
+  void NotifyReaders();
+
+  //! Padded so that the counters are on different cache lines, to avoid false sharing
+  //! between the threads. Padding is used instead of alignas so that the ring can be
+  //! allocated with new.
+  struct Counter
+  {
+    std::atomic<size_t> Value;
+    char Padding[64];
+  };
+
+  std::vector<unsigned char> Slots;
+  std::vector<unsigned int> Lengths;
+  std::vector<PacketInformation> Informations;
+  size_t SlotSize;
+  size_t Mask;
+
+  //! Number of packets pushed since the beginning, only modified by the producer
+  Counter Head;
+  //! Number of packets released by each reader since the beginning
+  std::unique_ptr<Counter[]> Tails;
+  size_t NumberOfReaders;
+
+  std::atomic<bool> Stopped;
+  std::atomic<OverflowPolicy> Policy;
+  std::atomic<size_t> NumberOfDroppedPackets;
+  std::atomic<size_t> HighWaterMark;
+
+  //! Used only to sleep when the ring is empty (readers) or full (producer)
+  std::atomic<int> NumberOfWaitingReaders;
+  std::atomic<bool> ProducerIsWaiting;
+  boost::mutex WaitMutex;
+  boost::condition_variable ReaderCondition;
+  boost::condition_variable ProducerCondition;
+};
+
+#endif // PACKETRING_H
@@ -0,0 +1,81 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "PacketRingListener.h"
+
+namespace
+{
+//! Maximum number of packets handled at once
+const size_t MaximumBatchSize = 256;
+}
+
+//-----------------------------------------------------------------------------
+void PacketRingListener::StartListening(std::shared_ptr<PacketRing> ring, size_t reader)
+{
+  if (this->Thread)
+  {
+    return;
+  }
+  this->Ring = ring;
+  this->Reader = reader;
+  this->Thread = boost::shared_ptr<boost::thread>(
+        new boost::thread(boost::bind(&PacketRingListener::ThreadLoop, this)));
+}
+
+//-----------------------------------------------------------------------------
+void PacketRingListener::StopListening()
+{
+  if (this->Thread)
+  {
+    this->Thread->join();
+    this->Thread.reset();
+    this->Ring.reset();
+  }
+}
+
+//-----------------------------------------------------------------------------
+size_t PacketRingListener::HandleAvailablePackets()
+{
+  RawPacket batch[MaximumBatchSize];
+  const size_t numberOfPackets = this->Ring->Peek(batch, MaximumBatchSize, this->Reader);
+  if (numberOfPackets > 0)
+  {
+    this->HandlePackets(*this->Ring, batch, numberOfPackets);
+    this->Ring->Release(numberOfPackets, this->Reader);
+  }
+  return numberOfPackets;
+}
+
+//-----------------------------------------------------------------------------
+void PacketRingListener::ThreadLoop()
+{
+  if (!this->Placement.IsDefault())
+  {
+    this->Placement.Apply("listener");
+  }
+  while (this->Ring->WaitForPackets(this->Reader))
+  {
+    this->HandleAvailablePackets();
+  }
+
+  // the producer is stopped, handle what is left in the ring
+  while (this->HandleAvailablePackets() > 0)
+  {
+  }
+  this->FinishListening();
+}
@@ -0,0 +1,82 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef PACKETRINGLISTENER_H
+#define PACKETRINGLISTENER_H
+
+#include <memory>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "PacketRing.h"
+#include "ThreadPlacement.h"
+
+/**
+ * \class PacketRingListener
+ * \brief Base class of the stages which read the received packets in their own thread,
+ *        in addition to the decoder, from the slots of the same PacketRing
+ *        (recording, forwarding, crash analysis...).
+ *
+ * The packets are handed in batches to HandlePackets. Once the ring is stopped, the
+ * packets not handled yet are given to HandlePackets before the thread returns.
+ * Subclasses must call StopListening in their destructor.
+ */
+class PacketRingListener
+{
+public:
+  virtual ~PacketRingListener() = default;
+
+  /**
+   * @brief StartListening start the thread reading the packets
+   * @param ring the ring to read, which must have been created with enough readers
+   * @param reader the reader index of this listener in the ring
+   */
+  void StartListening(std::shared_ptr<PacketRing> ring, size_t reader);
+
+  /**
+   * @brief StopListening wait for the thread to handle the remaining packets and return.
+   * The ring must have been stopped before.
+   */
+  void StopListening();
+
+  bool IsListening() const { return this->Thread != nullptr; }
+
+  //! CPUs and scheduling of the thread, taken into account when it is started
+  void SetThreadPlacement(const ThreadPlacement& placement) { this->Placement = placement; }
+
+protected:
+  //! Handle a batch of packets, the information of each packet is given by the ring
+  virtual void HandlePackets(const PacketRing& ring, const RawPacket* packets,
+                             size_t numberOfPackets) = 0;
+
+  //! Called in the listener thread once all the packets have been handled
+  virtual void FinishListening() {}
+
+private:
+  void ThreadLoop();
+
+  //! Give the packets available to HandlePackets, return the number of packets
+  size_t HandleAvailablePackets();
+
+  std::shared_ptr<PacketRing> Ring;
+  size_t Reader = 0;
+  boost::shared_ptr<boost::thread> Thread;
+  ThreadPlacement Placement;
+};
+
+#endif // PACKETRINGLISTENER_H
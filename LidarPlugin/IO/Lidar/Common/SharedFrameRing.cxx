@@ -0,0 +1,235 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "SharedFrameRing.h"
+
+// STD
+#include <atomic>
+#include <cstring>
+
+// BOOST
+#include <boost/interprocess/exceptions.hpp>
+
+namespace
+{
+const char RingMagic[8] = { 'L', 'V', 'S', 'H', 'R', 'I', 'N', 'G' };
+const uint64_t Alignment = 8;
+
+//-----------------------------------------------------------------------------
+uint64_t Align(uint64_t offset)
+{
+  return (offset + Alignment - 1) / Alignment * Alignment;
+}
+}
+
+//-----------------------------------------------------------------------------
+struct SharedFrameRing::Header
+{
+  char Magic[8];
+  uint32_t Version;
+  uint32_t NumberOfSlots;
+  uint64_t SlotSize;
+  std::atomic<uint64_t> NumberOfWrittenMessages;
+  //! Set by the writer when it closes the ring, which it then removes
+  std::atomic<uint64_t> IsWriterClosed;
+};
+
+//-----------------------------------------------------------------------------
+struct SharedFrameRing::SlotHeader
+{
+  std::atomic<uint64_t> Sequence;
+  std::atomic<uint64_t> Size;
+};
+
+const uint32_t SharedFrameRing::Version;
+
+//-----------------------------------------------------------------------------
+SharedFrameRing::~SharedFrameRing()
+{
+  this->Close();
+}
+
+//-----------------------------------------------------------------------------
+bool SharedFrameRing::Create(const std::string& name, size_t numberOfSlots, size_t slotSize)
+{
+  this->Close();
+  if (name.empty() || numberOfSlots == 0 || slotSize == 0)
+  {
+    return false;
+  }
+
+  using namespace boost::interprocess;
+  const uint64_t size =
+    sizeof(Header) + numberOfSlots * (sizeof(SlotHeader) + Align(slotSize));
+  try
+  {
+    shared_memory_object::remove(name.c_str());
+    this->Memory.reset(new shared_memory_object(create_only, name.c_str(), read_write));
+    this->IsOwner = true;
+    this->Name = name;
+    this->Memory->truncate(static_cast<offset_t>(size));
+    this->Region.reset(new mapped_region(*this->Memory, read_write));
+  }
+  catch (interprocess_exception&)
+  {
+    this->Close();
+    return false;
+  }
+
+  // the slots are zeroed by the truncation, so they are all empty. The magic string
+  // is written last, so that a reader never accepts a partial header
+  this->RingHeader = new (this->Region->get_address()) Header;
+  this->RingHeader->Version = Version;
+  this->RingHeader->NumberOfSlots = static_cast<uint32_t>(numberOfSlots);
+  this->RingHeader->SlotSize = Align(slotSize);
+  this->RingHeader->NumberOfWrittenMessages.store(0, std::memory_order_relaxed);
+  this->RingHeader->IsWriterClosed.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(this->RingHeader->Magic, RingMagic, sizeof(RingMagic));
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool SharedFrameRing::Open(const std::string& name)
+{
+  this->Close();
+
+  using namespace boost::interprocess;
+  try
+  {
+    this->Memory.reset(new shared_memory_object(open_only, name.c_str(), read_only));
+    this->Region.reset(new mapped_region(*this->Memory, read_only));
+  }
+  catch (interprocess_exception&)
+  {
+    this->Close();
+    return false;
+  }
+
+  // the writer may still be initializing the header, it is then opened again later
+  this->RingHeader = static_cast<Header*>(this->Region->get_address());
+  const uint64_t size = this->Region->get_size();
+  if (size < sizeof(Header)
+      || std::memcmp(this->RingHeader->Magic, RingMagic, sizeof(RingMagic)) != 0
+      || this->RingHeader->Version != Version
+      || this->RingHeader->NumberOfSlots == 0
+      || (size - sizeof(Header)) / this->RingHeader->NumberOfSlots
+           < sizeof(SlotHeader) + this->RingHeader->SlotSize)
+  {
+    this->Close();
+    return false;
+  }
+  this->Name = name;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void SharedFrameRing::Close()
+{
+  if (this->IsOwner && this->RingHeader)
+  {
+    this->RingHeader->IsWriterClosed.store(1, std::memory_order_release);
+  }
+  this->RingHeader = nullptr;
+  this->Region.reset();
+  this->Memory.reset();
+  if (this->IsOwner)
+  {
+    // the readers keep their mapping until they close the ring
+    boost::interprocess::shared_memory_object::remove(this->Name.c_str());
+    this->IsOwner = false;
+  }
+  this->Name.clear();
+}
+
+//-----------------------------------------------------------------------------
+SharedFrameRing::SlotHeader* SharedFrameRing::GetSlot(uint64_t messageNumber) const
+{
+  const uint64_t slot = messageNumber % this->RingHeader->NumberOfSlots;
+  unsigned char* slots = static_cast<unsigned char*>(this->Region->get_address()) + sizeof(Header);
+  return reinterpret_cast<SlotHeader*>(
+    slots + slot * (sizeof(SlotHeader) + this->RingHeader->SlotSize));
+}
+
+//-----------------------------------------------------------------------------
+bool SharedFrameRing::Write(const unsigned char* message, size_t size)
+{
+  if (!this->IsOwner || !this->RingHeader || size > this->RingHeader->SlotSize)
+  {
+    return false;
+  }
+
+  const uint64_t messageNumber =
+    this->RingHeader->NumberOfWrittenMessages.load(std::memory_order_relaxed);
+  SlotHeader* slot = this->GetSlot(messageNumber);
+  slot->Sequence.store(2 * messageNumber + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot->Size.store(size, std::memory_order_relaxed);
+  std::memcpy(reinterpret_cast<unsigned char*>(slot + 1), message, size);
+  slot->Sequence.store(2 * (messageNumber + 1), std::memory_order_release);
+  this->RingHeader->NumberOfWrittenMessages.store(messageNumber + 1, std::memory_order_release);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+uint64_t SharedFrameRing::GetNumberOfWrittenMessages() const
+{
+  if (!this->RingHeader)
+  {
+    return 0;
+  }
+  return this->RingHeader->NumberOfWrittenMessages.load(std::memory_order_acquire);
+}
+
+//-----------------------------------------------------------------------------
+bool SharedFrameRing::IsWriterClosed() const
+{
+  return this->RingHeader
+    && this->RingHeader->IsWriterClosed.load(std::memory_order_acquire) != 0;
+}
+
+//-----------------------------------------------------------------------------
+const unsigned char* SharedFrameRing::BeginRead(uint64_t& messageNumber, uint64_t& size) const
+{
+  const uint64_t numberOfMessages = this->GetNumberOfWrittenMessages();
+  if (numberOfMessages == 0)
+  {
+    return nullptr;
+  }
+
+  messageNumber = numberOfMessages - 1;
+  const SlotHeader* slot = this->GetSlot(messageNumber);
+  if (slot->Sequence.load(std::memory_order_acquire) != 2 * numberOfMessages)
+  {
+    return nullptr;
+  }
+  size = slot->Size.load(std::memory_order_relaxed);
+  if (size > this->RingHeader->SlotSize)
+  {
+    return nullptr;
+  }
+  return reinterpret_cast<const unsigned char*>(slot + 1);
+}
+
+//-----------------------------------------------------------------------------
+bool SharedFrameRing::EndRead(uint64_t messageNumber) const
+{
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return this->GetSlot(messageNumber)->Sequence.load(std::memory_order_relaxed)
+    == 2 * (messageNumber + 1);
+}
@@ -0,0 +1,108 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef SHAREDFRAMERING_H
+#define SHAREDFRAMERING_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+
+/**
+ * \class SharedFrameRing
+ * \brief Ring of messages in a named shared memory, written by a single process and
+ *        read by any number of processes on the same machine.
+ *
+ * The messages are the ones of FramePublisher: a FrameMessageHeader followed by a frame
+ * encoded by FrameEncoder, so that a process producing point clouds only has to write
+ * them in this layout to be read by LidarView.
+ *
+ * Layout of the shared memory, all values in the host byte order:
+ *  - a header, with a magic string, the layout version, the number and size of the
+ *    slots, the number of messages written so far and whether the writer is closed
+ *  - the slots, each one being a sequence number, the size of its message and the
+ *    message, on SlotSize bytes. Message n is written in slot n % NumberOfSlots.
+ *
+ * The writer never waits for the readers: the sequence number of a slot is odd while its
+ * message is written, and 2 * (n + 1) once message n is complete. A reader checks that the
+ * sequence has not changed after reading a message, otherwise the message has been
+ * overwritten while it was read and is discarded.
+ */
+class SharedFrameRing
+{
+public:
+  ~SharedFrameRing();
+
+  /**
+   * @brief Create the shared memory as the writer, replacing any previous one
+   * of the same name, which is removed when the ring is closed
+   * @param name name of the shared memory
+   * @param numberOfSlots number of messages kept
+   * @param slotSize maximum size of a message
+   */
+  bool Create(const std::string& name, size_t numberOfSlots, size_t slotSize);
+
+  //! Attach to the shared memory created by a writer, return false if it does not exist
+  bool Open(const std::string& name);
+
+  void Close();
+
+  bool IsOpen() const { return this->Region != nullptr; }
+
+  //! Write a message, return false if it is larger than the slots
+  bool Write(const unsigned char* message, size_t size);
+
+  //! Number of messages written since the ring has been created
+  uint64_t GetNumberOfWrittenMessages() const;
+
+  //! For a reader, true once the writer has closed the ring. A new ring of the same
+  //! name may have been created since, which is read once the ring is opened again
+  bool IsWriterClosed() const;
+
+  /**
+   * @brief BeginRead give the newest message, directly in the shared memory. The message
+   * can be overwritten while it is read, so EndRead must be checked before using what
+   * has been read.
+   * @param messageNumber[out] number of the message
+   * @param size[out] size of the message
+   * @return nullptr if no message has been written or the newest one is being written
+   */
+  const unsigned char* BeginRead(uint64_t& messageNumber, uint64_t& size) const;
+
+  //! Return false if the message has been overwritten since BeginRead
+  bool EndRead(uint64_t messageNumber) const;
+
+  static const uint32_t Version = 1;
+
+private:
+  struct Header;
+  struct SlotHeader;
+
+  bool Map(boost::interprocess::mode_t mode);
+  SlotHeader* GetSlot(uint64_t messageNumber) const;
+
+  std::string Name;
+  bool IsOwner = false;
+  std::unique_ptr<boost::interprocess::shared_memory_object> Memory;
+  std::unique_ptr<boost::interprocess::mapped_region> Region;
+  Header* RingHeader = nullptr;
+};
+
+#endif // SHAREDFRAMERING_H
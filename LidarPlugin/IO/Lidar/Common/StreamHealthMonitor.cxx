@@ -0,0 +1,251 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "StreamHealthMonitor.h"
+#include "NetworkSource.h"
+#include "PacketConsumer.h"
+
+// STD
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+// BOOST
+#include <boost/asio.hpp>
+
+// VTK
+#include <vtkObject.h>
+#include <vtkSetGet.h>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+std::string FormatStatsD(const std::string& name, const StreamHealthMonitor::Metrics& metrics)
+{
+  std::ostringstream text;
+  text << name << ".packets_per_second:" << metrics.PacketRate << "|g\n"
+       << name << ".bytes_per_second:" << metrics.ByteRate << "|g\n"
+       << name << ".received_packets:" << metrics.NumberOfReceivedPackets << "|g\n"
+       << name << ".socket_drops:" << metrics.NumberOfSocketDrops << "|g\n"
+       << name << ".queue_depth:" << metrics.QueueDepth << "|g\n"
+       << name << ".queue_high_water_mark:" << metrics.QueueHighWaterMark << "|g\n"
+       << name << ".queue_drops:" << metrics.NumberOfDroppedPackets << "|g\n"
+       << name << ".completed_frames:" << metrics.NumberOfCompletedFrames << "|g\n"
+       << name << ".skipped_frames:" << metrics.NumberOfSkippedFrames << "|g\n"
+       << name << ".packet_gaps:" << metrics.NumberOfPacketGaps << "|g\n"
+       << name << ".missing_packets:" << metrics.NumberOfMissingPackets << "|g\n"
+       << name << ".frame_decode_ms:" << 1e3 * metrics.LastFrameDecodeTime << "|g\n"
+       << name << ".frame_points:" << metrics.LastFrameNumberOfPoints << "|g";
+  return text.str();
+}
+
+//-----------------------------------------------------------------------------
+template <typename T>
+void WritePrometheusMetric(std::ostream& stream, const std::string& label, const char* name,
+                           const char* type, const char* help, T value)
+{
+  stream << "# HELP lidarview_" << name << " " << help << "\n"
+         << "# TYPE lidarview_" << name << " " << type << "\n"
+         << "lidarview_" << name << "{stream=\"" << label << "\"} " << value << "\n";
+}
+}
+
+//-----------------------------------------------------------------------------
+StreamHealthMonitor::StreamHealthMonitor(NetworkSource* network,
+                                         std::shared_ptr<PacketConsumer> consumer)
+  : Network(network)
+  , Consumer(consumer)
+{
+}
+
+//-----------------------------------------------------------------------------
+StreamHealthMonitor::~StreamHealthMonitor()
+{
+  this->Stop();
+}
+
+//-----------------------------------------------------------------------------
+void StreamHealthMonitor::Start()
+{
+  if (this->Thread)
+  {
+    return;
+  }
+  {
+    boost::lock_guard<boost::mutex> lock(this->MetricsMutex);
+    this->LastMetrics = Metrics();
+  }
+  this->IsStopping = false;
+  this->Thread.reset(new boost::thread(&StreamHealthMonitor::ThreadLoop, this));
+}
+
+//-----------------------------------------------------------------------------
+void StreamHealthMonitor::Stop()
+{
+  if (!this->Thread)
+  {
+    return;
+  }
+  {
+    boost::lock_guard<boost::mutex> lock(this->StopMutex);
+    this->IsStopping = true;
+  }
+  this->StopCondition.notify_all();
+  this->Thread->join();
+  this->Thread.reset();
+}
+
+//-----------------------------------------------------------------------------
+StreamHealthMonitor::Metrics StreamHealthMonitor::GetMetrics() const
+{
+  boost::lock_guard<boost::mutex> lock(this->MetricsMutex);
+  return this->LastMetrics;
+}
+
+//-----------------------------------------------------------------------------
+StreamHealthMonitor::Metrics StreamHealthMonitor::Sample(const Metrics& previous,
+                                                         double elapsed) const
+{
+  Metrics metrics;
+  metrics.NumberOfReceivedPackets = this->Network->NumberOfReceivedPackets.load(std::memory_order_relaxed);
+  metrics.NumberOfReceivedBytes = this->Network->NumberOfReceivedBytes.load(std::memory_order_relaxed);
+  metrics.NumberOfSocketDrops = this->Network->NumberOfSocketDrops.load(std::memory_order_relaxed);
+  metrics.QueueDepth = this->Consumer->GetQueueDepth();
+  metrics.QueueHighWaterMark = this->Consumer->GetQueueHighWaterMark();
+  metrics.NumberOfDroppedPackets = this->Consumer->GetNumberOfDroppedPackets();
+  metrics.NumberOfCompletedFrames = this->Consumer->GetNumberOfCompletedFrames();
+  metrics.NumberOfSkippedFrames = this->Consumer->GetNumberOfSkippedFrames();
+  metrics.NumberOfPacketGaps = this->Consumer->GetNumberOfPacketGaps();
+  metrics.NumberOfMissingPackets = this->Consumer->GetNumberOfMissingPackets();
+  metrics.LastFrameDecodeTime = this->Consumer->GetLastFrameDecodeTime();
+  metrics.LastFrameNumberOfPoints = this->Consumer->GetLastFrameNumberOfPoints();
+  if (elapsed > 0)
+  {
+    metrics.PacketRate = (metrics.NumberOfReceivedPackets - previous.NumberOfReceivedPackets) / elapsed;
+    metrics.ByteRate = (metrics.NumberOfReceivedBytes - previous.NumberOfReceivedBytes) / elapsed;
+  }
+  return metrics;
+}
+
+//-----------------------------------------------------------------------------
+bool StreamHealthMonitor::WritePrometheusFile(const Metrics& metrics) const
+{
+  const std::string temporaryFileName = this->PrometheusFileName + ".tmp";
+  {
+    std::ofstream file(temporaryFileName);
+    WritePrometheusMetric(file, this->Name, "packets_per_second", "gauge",
+                          "Packets received per second.", metrics.PacketRate);
+    WritePrometheusMetric(file, this->Name, "bytes_per_second", "gauge",
+                          "Bytes received per second.", metrics.ByteRate);
+    WritePrometheusMetric(file, this->Name, "received_packets_total", "counter",
+                          "Packets received since the stream was started.", metrics.NumberOfReceivedPackets);
+    WritePrometheusMetric(file, this->Name, "received_bytes_total", "counter",
+                          "Bytes received since the stream was started.", metrics.NumberOfReceivedBytes);
+    WritePrometheusMetric(file, this->Name, "socket_drops_total", "counter",
+                          "Packets dropped by the kernel before being received.", metrics.NumberOfSocketDrops);
+    WritePrometheusMetric(file, this->Name, "queue_depth", "gauge",
+                          "Packets waiting to be decoded.", metrics.QueueDepth);
+    WritePrometheusMetric(file, this->Name, "queue_high_water_mark", "gauge",
+                          "Maximum number of packets waiting to be decoded.", metrics.QueueHighWaterMark);
+    WritePrometheusMetric(file, this->Name, "queue_drops_total", "counter",
+                          "Packets dropped because the queue was full.", metrics.NumberOfDroppedPackets);
+    WritePrometheusMetric(file, this->Name, "completed_frames_total", "counter",
+                          "Frames decoded since the stream was started.", metrics.NumberOfCompletedFrames);
+    WritePrometheusMetric(file, this->Name, "skipped_frames_total", "counter",
+                          "Frames decoded but never displayed.", metrics.NumberOfSkippedFrames);
+    WritePrometheusMetric(file, this->Name, "packet_gaps_total", "counter",
+                          "Discontinuities of the timestamps or azimuths of the packets.", metrics.NumberOfPacketGaps);
+    WritePrometheusMetric(file, this->Name, "missing_packets_total", "counter",
+                          "Packets missing according to the discontinuities.", metrics.NumberOfMissingPackets);
+    WritePrometheusMetric(file, this->Name, "frame_decode_seconds", "gauge",
+                          "Time spent decoding the last frame.", metrics.LastFrameDecodeTime);
+    WritePrometheusMetric(file, this->Name, "frame_points", "gauge",
+                          "Number of points of the last frame.", metrics.LastFrameNumberOfPoints);
+    if (!file)
+    {
+      return false;
+    }
+  }
+  return std::rename(temporaryFileName.c_str(), this->PrometheusFileName.c_str()) == 0;
+}
+
+//-----------------------------------------------------------------------------
+void StreamHealthMonitor::ThreadLoop()
+{
+  // the socket is only used by this thread, it is opened once per start
+  boost::asio::io_service ioService;
+  boost::asio::ip::udp::socket socket(ioService);
+  boost::asio::ip::udp::endpoint statsDEndpoint;
+  bool pushToStatsD = false;
+  if (!this->StatsDAddress.empty())
+  {
+    boost::system::error_code error;
+    const boost::asio::ip::address address =
+      boost::asio::ip::address::from_string(this->StatsDAddress, error);
+    if (!error)
+    {
+      socket.open(address.is_v6() ? boost::asio::ip::udp::v6() : boost::asio::ip::udp::v4(), error);
+    }
+    if (error)
+    {
+      vtkGenericWarningMacro("Cannot push the metrics to " << this->StatsDAddress << ": " << error.message());
+    }
+    else
+    {
+      statsDEndpoint = boost::asio::ip::udp::endpoint(address, this->StatsDPort);
+      pushToStatsD = true;
+    }
+  }
+  bool hasWarnedPrometheus = false;
+
+  const auto interval = std::chrono::duration<double>(std::max(this->Interval, 0.01));
+  auto lastSample = std::chrono::steady_clock::now();
+  Metrics metrics = this->Sample(Metrics(), 0);
+  boost::unique_lock<boost::mutex> stopLock(this->StopMutex);
+  while (!this->IsStopping)
+  {
+    this->StopCondition.wait_for(stopLock, boost::chrono::microseconds(
+      static_cast<long long>(1e6 * interval.count())));
+    if (this->IsStopping)
+    {
+      break;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    metrics = this->Sample(metrics, std::chrono::duration<double>(now - lastSample).count());
+    lastSample = now;
+    {
+      boost::lock_guard<boost::mutex> lock(this->MetricsMutex);
+      this->LastMetrics = metrics;
+    }
+
+    if (pushToStatsD)
+    {
+      // a lost datagram is not an error, the next one carries the same gauges
+      boost::system::error_code error;
+      socket.send_to(boost::asio::buffer(FormatStatsD(this->Name, metrics)), statsDEndpoint, 0, error);
+    }
+    if (!this->PrometheusFileName.empty() && !this->WritePrometheusFile(metrics) && !hasWarnedPrometheus)
+    {
+      vtkGenericWarningMacro("Cannot write the metrics to " << this->PrometheusFileName);
+      hasWarnedPrometheus = true;
+    }
+  }
+}
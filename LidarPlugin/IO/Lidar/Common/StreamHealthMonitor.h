@@ -0,0 +1,109 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef STREAMHEALTHMONITOR_H
+#define STREAMHEALTHMONITOR_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+class NetworkSource;
+class PacketConsumer;
+
+/**
+ * \class StreamHealthMonitor
+ * \brief Sample the counters of a live stream at a fixed interval, and optionally push them
+ *        to a StatsD server or write them for a Prometheus textfile collector.
+ *
+ * The counters are maintained by the receivers and the consumer with relaxed atomic
+ * increments, the monitor only reads them from its own thread and derives the rates from
+ * two consecutive samples, so that nothing is added on the path of the packets.
+ *
+ * The StatsD metrics are sent as gauges in a single UDP datagram per interval, named
+ * "<Name>.<metric>". The Prometheus metrics are written in the text exposition format
+ * with a stream="<Name>" label, to a temporary file renamed over PrometheusFileName, so
+ * that the collector never reads a partial file.
+ */
+class StreamHealthMonitor
+{
+public:
+  //! Last sample of the counters, the totals are counted since the stream was started
+  struct Metrics
+  {
+    double PacketRate = 0;
+    double ByteRate = 0;
+    uint64_t NumberOfReceivedPackets = 0;
+    uint64_t NumberOfReceivedBytes = 0;
+    uint64_t NumberOfSocketDrops = 0;
+    size_t QueueDepth = 0;
+    size_t QueueHighWaterMark = 0;
+    size_t NumberOfDroppedPackets = 0;
+    size_t NumberOfCompletedFrames = 0;
+    size_t NumberOfSkippedFrames = 0;
+    //! Discontinuities of the timestamps or of the azimuths of the packets
+    size_t NumberOfPacketGaps = 0;
+    size_t NumberOfMissingPackets = 0;
+    //! In seconds
+    double LastFrameDecodeTime = 0;
+    size_t LastFrameNumberOfPoints = 0;
+  };
+
+  StreamHealthMonitor(NetworkSource* network, std::shared_ptr<PacketConsumer> consumer);
+  ~StreamHealthMonitor();
+
+  //! Start sampling, the settings below are taken into account the next time it is started
+  void Start();
+  void Stop();
+
+  Metrics GetMetrics() const;
+
+  //! Interval between two samples, in seconds
+  double Interval = 1.;
+  //! Prefix of the StatsD metrics and label of the Prometheus metrics
+  std::string Name = "lidarview";
+  //! Address of the StatsD server, nothing is pushed if empty
+  std::string StatsDAddress = "";
+  int StatsDPort = 8125;
+  //! File read by a Prometheus textfile collector, nothing is written if empty
+  std::string PrometheusFileName = "";
+
+private:
+  StreamHealthMonitor(const StreamHealthMonitor&) = delete;
+  void operator=(const StreamHealthMonitor&) = delete;
+
+  void ThreadLoop();
+  Metrics Sample(const Metrics& previous, double elapsed) const;
+  bool WritePrometheusFile(const Metrics& metrics) const;
+
+  NetworkSource* Network;
+  std::shared_ptr<PacketConsumer> Consumer;
+
+  mutable boost::mutex MetricsMutex;
+  Metrics LastMetrics;
+
+  boost::mutex StopMutex;
+  boost::condition_variable StopCondition;
+  bool IsStopping = false;
+  std::unique_ptr<boost::thread> Thread;
+};
+
+#endif // STREAMHEALTHMONITOR_H
@@ -16,6 +16,7 @@
 #define SYNCHRONIZEDQUEUE_H
 
 #include <queue>
+#include <vector>
 #include <boost/thread.hpp>
 
 /**
@@ -67,6 +68,36 @@ public:
     return true;
   }
 
+  /**
+   * @brief dequeue wait until the queue is not empty, and then move up to maxNumberOfItems
+   * of its items at the end of results, with a single lock
+   * @return false if the queue has been stopped
+   */
+  bool dequeue(std::vector<T> &results, size_t maxNumberOfItems)
+  {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+
+    while (queue_.empty() && (!request_to_end_))
+    {
+      cond_.wait(lock);
+    }
+
+    if (request_to_end_)
+    {
+      doEndActions();
+      return false;
+    }
+
+    while (!queue_.empty() && maxNumberOfItems > 0)
+    {
+      results.push_back(queue_.front());
+      queue_.pop();
+      maxNumberOfItems--;
+    }
+
+    return true;
+  }
+
   void stopQueue()
   {
     boost::unique_lock<boost::mutex> lock(mutex_);
@@ -0,0 +1,172 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "ThreadPlacement.h"
+
+// STD
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+// BOOST
+#include <boost/thread/thread.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+//-----------------------------------------------------------------------------
+bool ThreadPlacement::Apply(const std::string& role) const
+{
+#ifdef __linux__
+  bool isApplied = true;
+
+  // without CPUs, the thread gets back the CPUs of the process (of its main thread)
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  if (this->CPUs.empty())
+  {
+    sched_getaffinity(getpid(), sizeof(cpus), &cpus);
+  }
+  for (int cpu : this->CPUs)
+  {
+    if (cpu >= 0 && cpu < CPU_SETSIZE)
+    {
+      CPU_SET(cpu, &cpus);
+    }
+  }
+  int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  if (error != 0)
+  {
+    std::cerr << "Cannot run the " << role << " thread on CPUs " << FormatCPUList(this->CPUs)
+              << ": " << std::strerror(error) << std::endl;
+    isApplied = false;
+  }
+
+  sched_param parameters;
+  std::memset(&parameters, 0, sizeof(parameters));
+  parameters.sched_priority = std::min(std::max(this->RealTimePriority, 0), 99);
+  error = pthread_setschedparam(pthread_self(),
+                                parameters.sched_priority > 0 ? SCHED_FIFO : SCHED_OTHER, &parameters);
+  if (error != 0)
+  {
+    std::cerr << "Cannot give the real-time priority " << parameters.sched_priority << " to the "
+              << role << " thread: " << std::strerror(error)
+              << " (CAP_SYS_NICE or a RLIMIT_RTPRIO limit is needed)" << std::endl;
+    isApplied = false;
+  }
+  return isApplied;
+#else
+  (void)role;
+  return this->IsDefault();
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void ThreadPlacement::RunPinned(const std::function<void()>& function) const
+{
+  if (this->CPUs.empty())
+  {
+    function();
+    return;
+  }
+  ThreadPlacement affinity;
+  affinity.CPUs = this->CPUs;
+  boost::thread thread([&affinity, &function]() {
+    affinity.Apply("allocation");
+    function();
+  });
+  thread.join();
+}
+
+//-----------------------------------------------------------------------------
+bool ThreadPlacement::ParseCPUList(const std::string& text, std::vector<int>& cpus)
+{
+  std::vector<int> result;
+  std::stringstream stream(text);
+  std::string range;
+  while (std::getline(stream, range, ','))
+  {
+    range.erase(std::remove_if(range.begin(), range.end(), ::isspace), range.end());
+    if (range.empty())
+    {
+      continue;
+    }
+    const size_t dash = range.find('-');
+    int first, last;
+    try
+    {
+      size_t end = 0;
+      first = std::stoi(range.substr(0, dash), &end);
+      if (end != range.substr(0, dash).size())
+      {
+        return false;
+      }
+      last = first;
+      if (dash != std::string::npos)
+      {
+        last = std::stoi(range.substr(dash + 1), &end);
+        if (end != range.size() - dash - 1)
+        {
+          return false;
+        }
+      }
+    }
+    catch (const std::exception&)
+    {
+      return false;
+    }
+    if (first < 0 || last < first)
+    {
+      return false;
+    }
+    for (int cpu = first; cpu <= last; ++cpu)
+    {
+      result.push_back(cpu);
+    }
+  }
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  cpus = result;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+std::string ThreadPlacement::FormatCPUList(const std::vector<int>& cpus)
+{
+  std::string text;
+  for (size_t i = 0; i < cpus.size();)
+  {
+    size_t j = i;
+    while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+    {
+      ++j;
+    }
+    text += (text.empty() ? "" : ",") + std::to_string(cpus[i]);
+    if (j > i)
+    {
+      text += "-" + std::to_string(cpus[j]);
+    }
+    i = j + 1;
+  }
+  return text;
+}
@@ -0,0 +1,75 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef THREADPLACEMENT_H
+#define THREADPLACEMENT_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * \class ThreadPlacement
+ * \brief CPUs and scheduling policy of a thread of the live pipeline.
+ *
+ * On a multi-socket computer, a thread migrating between the cores, or running on
+ * another NUMA node than the memory it uses, causes latency spikes. Linux places a
+ * page of memory on the NUMA node of the thread which writes it first, so the buffers
+ * allocated and written by a thread pinned to the CPUs of a node are local to this
+ * node. RunPinned uses this to allocate a buffer next to the thread which uses it.
+ *
+ * Only implemented on Linux, elsewhere Apply does nothing.
+ */
+class ThreadPlacement
+{
+public:
+  //! CPUs the thread may run on, the CPUs of the process if empty
+  std::vector<int> CPUs;
+
+  //! Priority of the thread with the SCHED_FIFO policy, from 1 to 99,
+  //! 0 for the default scheduling
+  int RealTimePriority = 0;
+
+  bool IsDefault() const { return this->CPUs.empty() && this->RealTimePriority == 0; }
+
+  /**
+   * @brief Apply set the CPUs and the scheduling policy of the calling thread. A
+   * thread can be placed again, with the default placement to undo a previous one.
+   * @param role name of the thread, used in the messages
+   * @return false if it could not be done, a message is then printed. SCHED_FIFO needs
+   * the CAP_SYS_NICE capability, or a RLIMIT_RTPRIO limit (see limits.conf).
+   */
+  bool Apply(const std::string& role) const;
+
+  /**
+   * @brief RunPinned run a function in a thread pinned to the CPUs, and wait for it to
+   * return, so that the memory it allocates and writes is on their NUMA node. The function
+   * is called directly if no CPU is given.
+   */
+  void RunPinned(const std::function<void()>& function) const;
+
+  /**
+   * @brief ParseCPUList parse a list of CPUs such as "0-3,8,10"
+   * @return false if the list is malformed, cpus is then unchanged
+   */
+  static bool ParseCPUList(const std::string& text, std::vector<int>& cpus);
+
+  //! Inverse of ParseCPUList, the consecutive CPUs are given as ranges
+  static std::string FormatCPUList(const std::vector<int>& cpus);
+};
+
+#endif // THREADPLACEMENT_H
@@ -0,0 +1,375 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "vtkLidarFrameArchiveReader.h"
+
+#include "FrameArchive.h"
+#include "FrameCache.h"
+
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkCellArray> NewVertexCells(vtkIdType numberOfVerts)
+{
+  vtkNew<vtkIdTypeArray> cells;
+  cells->SetNumberOfValues(numberOfVerts * 2);
+  vtkIdType* ids = cells->GetPointer(0);
+  for (vtkIdType i = 0; i < numberOfVerts; ++i)
+  {
+    ids[i * 2] = 1;
+    ids[i * 2 + 1] = i;
+  }
+
+  vtkSmartPointer<vtkCellArray> cellArray = vtkSmartPointer<vtkCellArray>::New();
+  cellArray->SetCells(numberOfVerts, cells.GetPointer());
+  return cellArray;
+}
+
+//-----------------------------------------------------------------------------
+FrameArchiveColumn GetColumn(vtkDataArray* array, FrameArchiveColumn::ColumnKind kind)
+{
+  FrameArchiveColumn column;
+  column.Name = array->GetName() ? array->GetName() : "";
+  column.Kind = kind;
+  column.DataType = array->GetDataType();
+  column.ValueSize = array->GetDataTypeSize();
+  column.NumberOfComponents = array->GetNumberOfComponents();
+  column.Data = static_cast<const unsigned char*>(array->GetVoidPointer(0));
+  column.Size = static_cast<uint64_t>(array->GetNumberOfValues()) * column.ValueSize;
+  return column;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkDataArray> CreateArray(const FrameArchiveColumn& column)
+{
+  vtkSmartPointer<vtkDataArray> array;
+  array.TakeReference(vtkDataArray::CreateDataArray(column.DataType));
+  if (!array || array->GetDataTypeSize() != static_cast<int>(column.ValueSize)
+      || column.NumberOfComponents == 0)
+  {
+    return nullptr;
+  }
+  array->SetName(column.Name.c_str());
+  array->SetNumberOfComponents(column.NumberOfComponents);
+  array->SetNumberOfTuples(column.Size / (column.ValueSize * column.NumberOfComponents));
+  std::memcpy(array->GetVoidPointer(0), column.Data, column.Size);
+  return array;
+}
+}
+
+//-----------------------------------------------------------------------------
+struct vtkLidarFrameArchiveReader::FramePrefetcher
+{
+  FramePrefetcher()
+  {
+    this->Cache.JoinMemoryBudget("Archived frames", MemoryBudget::PrefetchedFramesPriority);
+  }
+
+  FrameCache Cache;
+};
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkLidarFrameArchiveReader)
+
+//-----------------------------------------------------------------------------
+vtkLidarFrameArchiveReader::vtkLidarFrameArchiveReader()
+  : Archive(new FrameArchiveReader)
+  , Prefetcher(new FramePrefetcher)
+{
+  this->SetNumberOfInputPorts(0);
+  this->SetNumberOfOutputPorts(1);
+  this->Prefetcher->Cache.SetMemoryBudget(this->FrameCacheSize * 1024ul);
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarFrameArchiveReader::~vtkLidarFrameArchiveReader() = default;
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameArchiveReader::SetFileName(const std::string& filename)
+{
+  if (filename == this->FileName)
+  {
+    return;
+  }
+  this->FileName = filename;
+  this->Archive->Close();
+  this->Prefetcher->Cache.Clear();
+  this->Timesteps.clear();
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameArchiveReader::SetFrameCacheSize(int size)
+{
+  if (size == this->FrameCacheSize)
+  {
+    return;
+  }
+  this->FrameCacheSize = size;
+  this->Prefetcher->Cache.SetMemoryBudget(std::max(size, 0) * 1024ul);
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarFrameArchiveReader::Open()
+{
+  if (this->Archive->IsOpen())
+  {
+    return true;
+  }
+  if (this->FileName.empty() || !this->Archive->Open(this->FileName))
+  {
+    vtkErrorMacro("Failed to open frame archive: " << this->FileName);
+    return false;
+  }
+  this->Timesteps.resize(this->Archive->GetNumberOfFrames());
+  for (size_t i = 0; i < this->Timesteps.size(); ++i)
+  {
+    this->Timesteps[i] = this->Archive->GetFrameTime(i);
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarFrameArchiveReader::GetNumberOfFrames()
+{
+  if (!this->Open())
+  {
+    return 0;
+  }
+  return static_cast<int>(this->Archive->GetNumberOfFrames());
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkLidarFrameArchiveReader::GetFrame(int frameNumber)
+{
+  if (!this->Open() || frameNumber < 0 || frameNumber >= this->GetNumberOfFrames())
+  {
+    return nullptr;
+  }
+
+  if (this->FrameCacheSize > 0)
+  {
+    vtkSmartPointer<vtkPolyData> frame = this->Prefetcher->Cache.Get(frameNumber);
+    if (!frame)
+    {
+      frame = this->PrefetchFrames(frameNumber,
+        std::min(frameNumber + std::max(this->NumberOfFramesToPrefetch, 0), this->GetNumberOfFrames() - 1));
+    }
+    return frame;
+  }
+
+  uint64_t numberOfPoints = 0;
+  std::vector<FrameArchiveColumn> columns;
+  if (!this->Archive->ReadFrame(frameNumber, numberOfPoints, columns))
+  {
+    vtkErrorMacro("Frame " << frameNumber << " of " << this->FileName << " is corrupted");
+    return nullptr;
+  }
+
+  int numberOfInvalidColumns = 0;
+  vtkSmartPointer<vtkPolyData> frame = CreateFrame(numberOfPoints, columns, numberOfInvalidColumns);
+  if (numberOfInvalidColumns > 0)
+  {
+    vtkErrorMacro(<< numberOfInvalidColumns << " columns of frame " << frameNumber
+                  << " are corrupted");
+  }
+  return frame;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkLidarFrameArchiveReader::PrefetchFrames(int first, int last)
+{
+  // each frame is decompressed by its own task and decoder, the archive is only read
+  struct DecodedFrame
+  {
+    vtkSmartPointer<vtkPolyData> Frame;
+    bool IsCorrupted = false;
+    int NumberOfInvalidColumns = 0;
+  };
+  const FrameArchiveReader& archive = *this->Archive;
+  std::vector<std::pair<int, std::future<DecodedFrame> > > tasks;
+  for (int frameNumber = first; frameNumber <= last; ++frameNumber)
+  {
+    if (frameNumber != first && this->Prefetcher->Cache.Contains(frameNumber))
+    {
+      continue;
+    }
+    tasks.emplace_back(frameNumber, std::async(std::launch::async, [&archive, frameNumber]()
+      {
+        DecodedFrame decoded;
+        FrameDecoder decoder;
+        uint64_t numberOfPoints = 0;
+        std::vector<FrameArchiveColumn> columns;
+        decoded.IsCorrupted = !archive.ReadFrame(frameNumber, decoder, numberOfPoints, columns);
+        if (!decoded.IsCorrupted)
+        {
+          decoded.Frame = CreateFrame(numberOfPoints, columns, decoded.NumberOfInvalidColumns);
+        }
+        return decoded;
+      }));
+  }
+
+  vtkSmartPointer<vtkPolyData> firstFrame;
+  for (auto& task : tasks)
+  {
+    DecodedFrame decoded = task.second.get();
+    if (decoded.IsCorrupted)
+    {
+      vtkErrorMacro("Frame " << task.first << " of " << this->FileName << " is corrupted");
+      continue;
+    }
+    if (decoded.NumberOfInvalidColumns > 0)
+    {
+      vtkErrorMacro(<< decoded.NumberOfInvalidColumns << " columns of frame " << task.first
+                    << " are corrupted");
+    }
+    if (task.first == first)
+    {
+      firstFrame = decoded.Frame;
+    }
+    this->Prefetcher->Cache.Insert(task.first, decoded.Frame);
+  }
+  return firstFrame;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkLidarFrameArchiveReader::CreateFrame(
+  uint64_t numberOfPoints, const std::vector<FrameArchiveColumn>& columns,
+  int& numberOfInvalidColumns)
+{
+  numberOfInvalidColumns = 0;
+  vtkSmartPointer<vtkPolyData> frame = vtkSmartPointer<vtkPolyData>::New();
+  for (const FrameArchiveColumn& column : columns)
+  {
+    vtkSmartPointer<vtkDataArray> array = CreateArray(column);
+    if (!array || array->GetNumberOfTuples() != static_cast<vtkIdType>(numberOfPoints))
+    {
+      ++numberOfInvalidColumns;
+      continue;
+    }
+    if (column.Kind == FrameArchiveColumn::Points)
+    {
+      vtkNew<vtkPoints> points;
+      points->SetData(array);
+      frame->SetPoints(points.Get());
+    }
+    else
+    {
+      frame->GetPointData()->AddArray(array);
+    }
+  }
+  frame->SetVerts(NewVertexCells(frame->GetNumberOfPoints()));
+  return frame;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameArchiveReader::GetColumns(vtkPolyData* frame,
+                                            std::vector<FrameArchiveColumn>& columns)
+{
+  columns.clear();
+  if (!frame)
+  {
+    return;
+  }
+  if (frame->GetPoints())
+  {
+    columns.push_back(GetColumn(frame->GetPoints()->GetData(), FrameArchiveColumn::Points));
+  }
+  vtkPointData* pointData = frame->GetPointData();
+  for (int i = 0; i < pointData->GetNumberOfArrays(); ++i)
+  {
+    // only the numeric arrays are saved
+    if (vtkDataArray* array = pointData->GetArray(i))
+    {
+      columns.push_back(GetColumn(array, FrameArchiveColumn::PointData));
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarFrameArchiveReader::RequestInformation(vtkInformation* vtkNotUsed(request),
+                                                   vtkInformationVector** vtkNotUsed(inputVector),
+                                                   vtkInformationVector* outputVector)
+{
+  vtkInformation* info = outputVector->GetInformationObject(0);
+  if (this->Open() && !this->Timesteps.empty())
+  {
+    double timeRange[2] = { this->Timesteps.front(), this->Timesteps.back() };
+    info->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(), this->Timesteps.data(),
+              static_cast<int>(this->Timesteps.size()));
+    info->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(), timeRange, 2);
+  }
+  else
+  {
+    info->Remove(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+    info->Remove(vtkStreamingDemandDrivenPipeline::TIME_RANGE());
+  }
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarFrameArchiveReader::RequestData(vtkInformation* vtkNotUsed(request),
+                                            vtkInformationVector** vtkNotUsed(inputVector),
+                                            vtkInformationVector* outputVector)
+{
+  vtkPolyData* output = vtkPolyData::GetData(outputVector);
+  vtkInformation* info = outputVector->GetInformationObject(0);
+  if (!this->Open() || this->Timesteps.empty())
+  {
+    return 0;
+  }
+
+  double timestep = 0.0;
+  if (info->Has(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP()))
+  {
+    timestep = info->Get(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP());
+  }
+
+  // first frame whose time is not before the requested time, as vtkLidarReader
+  auto idx = std::lower_bound(this->Timesteps.begin(), this->Timesteps.end(), timestep);
+  if (idx == this->Timesteps.end())
+  {
+    vtkErrorMacro("Cannot meet timestep request: " << timestep << ".  Have "
+                                                   << this->Timesteps.size() << " datasets.");
+    return 0;
+  }
+
+  vtkSmartPointer<vtkPolyData> frame = this->GetFrame(std::distance(this->Timesteps.begin(), idx));
+  if (!frame)
+  {
+    return 0;
+  }
+  output->ShallowCopy(frame);
+  return 1;
+}
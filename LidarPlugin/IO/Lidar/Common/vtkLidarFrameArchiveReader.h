@@ -0,0 +1,123 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTKLIDARFRAMEARCHIVEREADER_H
+#define VTKLIDARFRAMEARCHIVEREADER_H
+
+#include <vtkPolyDataAlgorithm.h>
+#include <vtkSmartPointer.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class vtkPolyData;
+class FrameArchiveReader;
+struct FrameArchiveColumn;
+
+/**
+ * @brief The vtkLidarFrameArchiveReader class reads the frames saved in a frame archive,
+ * see FrameArchive.h and vtkLidarReader::SaveFramesToArchive.
+ * The frames are already decoded, so they are only copied out of the mapped file.
+ * The time steps are the same as the ones of the vtkLidarReader which saved the frames.
+ *
+ * When the frame cache is enabled, a frame which is not cached is decompressed with the
+ * next NumberOfFramesToPrefetch frames, in parallel, so that playing the archive only
+ * waits for the slowest frame of each group.
+ */
+class VTK_EXPORT vtkLidarFrameArchiveReader : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkLidarFrameArchiveReader* New();
+  vtkTypeMacro(vtkLidarFrameArchiveReader, vtkPolyDataAlgorithm)
+
+  vtkGetMacro(FileName, std::string)
+  void SetFileName(const std::string& filename);
+
+  //! Memory budget of the decoded frames in megabytes, 0 to disable the cache
+  vtkGetMacro(FrameCacheSize, int)
+  void SetFrameCacheSize(int size);
+
+  //! Number of frames following the requested one decompressed with it
+  vtkGetMacro(NumberOfFramesToPrefetch, int)
+  vtkSetMacro(NumberOfFramesToPrefetch, int)
+
+  //! Number of frames of the archive, 0 if it could not be opened
+  int GetNumberOfFrames();
+
+  /**
+   * @brief GetFrame read a frame
+   * @param frameNumber beteween 0 and GetNumberOfFrames()
+   * @return nullptr if the frame could not be read
+   */
+  vtkSmartPointer<vtkPolyData> GetFrame(int frameNumber);
+
+#ifndef __VTK_WRAP__
+  /**
+   * @brief GetColumns describe the points and the point data arrays of a frame
+   * as the columns of a frame archive. The columns point to the arrays of the frame.
+   */
+  static void GetColumns(vtkPolyData* frame, std::vector<FrameArchiveColumn>& columns);
+
+  /**
+   * @brief CreateFrame create a frame from its columns, the values are copied
+   * @param numberOfInvalidColumns[out] number of columns skipped because their size
+   * or their type does not match the number of points
+   */
+  static vtkSmartPointer<vtkPolyData> CreateFrame(uint64_t numberOfPoints,
+                                                  const std::vector<FrameArchiveColumn>& columns,
+                                                  int& numberOfInvalidColumns);
+#endif
+
+protected:
+  vtkLidarFrameArchiveReader();
+  ~vtkLidarFrameArchiveReader();
+
+  int RequestInformation(vtkInformation* request,
+                         vtkInformationVector** inputVector,
+                         vtkInformationVector* outputVector) override;
+
+  int RequestData(vtkInformation* request,
+                  vtkInformationVector** inputVector,
+                  vtkInformationVector* outputVector) override;
+
+private:
+  vtkLidarFrameArchiveReader(const vtkLidarFrameArchiveReader&) = delete;
+  void operator=(const vtkLidarFrameArchiveReader&) = delete;
+
+  //! Open the archive if it is not open yet
+  bool Open();
+
+  //! Decompress the frames [first, last] which are not cached yet, in parallel, and cache
+  //! them. Return the first frame, nullptr if it is corrupted
+  vtkSmartPointer<vtkPolyData> PrefetchFrames(int first, int last);
+
+  std::string FileName = "";
+  int FrameCacheSize = 256;
+  int NumberOfFramesToPrefetch = 8;
+
+  std::unique_ptr<FrameArchiveReader> Archive;
+
+  //! Cache of the decompressed frames
+  struct FramePrefetcher;
+  std::unique_ptr<FramePrefetcher> Prefetcher;
+
+  //! Time of each frame
+  std::vector<double> Timesteps;
+};
+
+#endif // VTKLIDARFRAMEARCHIVEREADER_H
@@ -0,0 +1,268 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "vtkLidarFrameBatch.h"
+#include "vtkLidarReader.h"
+
+#include <vtkDataArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <algorithm>
+#include <cstring>
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkLidarFrameBatch)
+
+//-----------------------------------------------------------------------------
+vtkLidarFrameBatch::vtkLidarFrameBatch()
+  : Records(vtkSmartPointer<vtkUnsignedCharArray>::New()),
+    FrameOffsets(vtkSmartPointer<vtkIdTypeArray>::New())
+{
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarFrameBatch::~vtkLidarFrameBatch()
+{
+  this->SetReader(nullptr);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameBatch::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfFrames: " << this->GetNumberOfFrames() << endl;
+  os << indent << "RecordSize: " << this->RecordSize << endl;
+  for (const Field& field : this->Fields)
+  {
+    os << indent << "Field " << field.Name << ": type " << field.DataType << ", "
+       << field.NumberOfComponents << " components at offset " << field.Offset << endl;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameBatch::SetReader(vtkLidarReader* reader)
+{
+  if (this->Reader == reader)
+  {
+    return;
+  }
+  if (this->Reader)
+  {
+    this->Reader->UnRegister(this);
+  }
+  this->Reader = reader;
+  if (this->Reader)
+  {
+    this->Reader->Register(this);
+  }
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+vtkUnsignedCharArray* vtkLidarFrameBatch::GetRecords()
+{
+  return this->Records;
+}
+
+//-----------------------------------------------------------------------------
+vtkIdTypeArray* vtkLidarFrameBatch::GetFrameOffsets()
+{
+  return this->FrameOffsets;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarFrameBatch::GetFrameNumber(int i)
+{
+  return (i >= 0 && i < this->GetNumberOfFrames()) ? this->FrameNumbers[i] : -1;
+}
+
+//-----------------------------------------------------------------------------
+const char* vtkLidarFrameBatch::GetFieldName(int i)
+{
+  return (i >= 0 && i < this->GetNumberOfFields()) ? this->Fields[i].Name.c_str() : nullptr;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarFrameBatch::GetFieldDataType(int i)
+{
+  return (i >= 0 && i < this->GetNumberOfFields()) ? this->Fields[i].DataType : 0;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarFrameBatch::GetFieldNumberOfComponents(int i)
+{
+  return (i >= 0 && i < this->GetNumberOfFields()) ? this->Fields[i].NumberOfComponents : 0;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarFrameBatch::GetFieldOffset(int i)
+{
+  return (i >= 0 && i < this->GetNumberOfFields()) ? this->Fields[i].Offset : 0;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameBatch::SetFields(vtkPolyData* frame)
+{
+  this->Fields.clear();
+  this->RecordSize = 0;
+  this->NumberOfCoordinateFields = 0;
+  auto addField = [this](const std::string& name, vtkDataArray* array, int component) {
+    Field field;
+    field.Name = name;
+    field.DataType = array->GetDataType();
+    field.NumberOfComponents = (component < 0) ? array->GetNumberOfComponents() : 1;
+    field.Size = array->GetDataTypeSize() * field.NumberOfComponents;
+    field.Offset = this->RecordSize;
+    this->RecordSize += field.Size;
+    this->Fields.push_back(field);
+  };
+
+  // the coordinates are separate fields, as the columns of a point cloud
+  vtkDataArray* points = frame->GetPoints() ? frame->GetPoints()->GetData() : nullptr;
+  if (points)
+  {
+    addField("x", points, 0);
+    addField("y", points, 1);
+    addField("z", points, 2);
+    this->NumberOfCoordinateFields = 3;
+  }
+
+  vtkPointData* pointData = frame->GetPointData();
+  for (int i = 0; i < pointData->GetNumberOfArrays(); ++i)
+  {
+    vtkDataArray* array = pointData->GetArray(i);
+    // the bits of a vtkBitArray are not addressable
+    if (array && array->GetName() && array->GetDataTypeSize() > 0 &&
+        array->GetDataType() != VTK_BIT)
+    {
+      addField(array->GetName(), array, -1);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameBatch::Pack(vtkPolyData* frame, vtkIdType firstRecord)
+{
+  const vtkIdType nbPoints = frame->GetNumberOfPoints();
+  if (nbPoints == 0)
+  {
+    return;
+  }
+
+  // Source of each field in the frame and stride between two points, a field
+  // without source is left to zero
+  struct Source
+  {
+    const unsigned char* Data = nullptr;
+    vtkIdType Stride = 0;
+  };
+  std::vector<Source> sources(this->Fields.size());
+  vtkDataArray* points = frame->GetPoints() ? frame->GetPoints()->GetData() : nullptr;
+  for (size_t f = 0; f < this->Fields.size(); ++f)
+  {
+    const Field& field = this->Fields[f];
+    const bool isCoordinate = static_cast<int>(f) < this->NumberOfCoordinateFields;
+    vtkDataArray* array = isCoordinate ? points : frame->GetPointData()->GetArray(field.Name.c_str());
+    const int numberOfComponents = isCoordinate ? 1 : field.NumberOfComponents;
+    if (!array || array->GetDataType() != field.DataType ||
+        (!isCoordinate && array->GetNumberOfComponents() != numberOfComponents))
+    {
+      continue;
+    }
+    sources[f].Data = static_cast<const unsigned char*>(array->GetVoidPointer(0)) +
+                      (isCoordinate ? f * field.Size : 0);
+    sources[f].Stride = array->GetNumberOfComponents() * array->GetDataTypeSize();
+  }
+
+  unsigned char* records = this->Records->GetPointer(0) + firstRecord * this->RecordSize;
+  const vtkIdType recordSize = this->RecordSize;
+  const std::vector<Field>& fields = this->Fields;
+  vtkSMPTools::For(0, nbPoints, [&](vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      unsigned char* record = records + i * recordSize;
+      for (size_t f = 0; f < fields.size(); ++f)
+      {
+        if (sources[f].Data)
+        {
+          std::memcpy(record + fields[f].Offset, sources[f].Data + i * sources[f].Stride, fields[f].Size);
+        }
+        else
+        {
+          std::memset(record + fields[f].Offset, 0, fields[f].Size);
+        }
+      }
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarFrameBatch::Decode(int startFrame, int numberOfFrames, int numberOfThreads)
+{
+  this->FrameNumbers.clear();
+  this->Records = vtkSmartPointer<vtkUnsignedCharArray>::New();
+  this->FrameOffsets = vtkSmartPointer<vtkIdTypeArray>::New();
+  if (!this->Reader)
+  {
+    vtkErrorMacro("No reader to decode the frames from");
+    return 0;
+  }
+  const int endFrame = std::min(startFrame + numberOfFrames, this->Reader->GetNumberOfFrames()) - 1;
+  if (startFrame < 0 || endFrame < startFrame)
+  {
+    return 0;
+  }
+
+  // The decoded frames are kept to be packed in a buffer of the total size
+  std::vector<vtkSmartPointer<vtkPolyData>> frames;
+  frames.reserve(endFrame - startFrame + 1);
+  this->Reader->DecodeFrames(startFrame, endFrame, [&](int frameNumber, vtkPolyData* frame)
+  {
+    frames.push_back(frame);
+    this->FrameNumbers.push_back(frameNumber);
+    return true;
+  }, numberOfThreads);
+  if (frames.empty())
+  {
+    return 0;
+  }
+
+  this->SetFields(frames.front());
+  this->FrameOffsets->SetNumberOfValues(frames.size() + 1);
+  vtkIdType nbRecords = 0;
+  for (size_t i = 0; i < frames.size(); ++i)
+  {
+    this->FrameOffsets->SetValue(i, nbRecords);
+    nbRecords += frames[i]->GetNumberOfPoints();
+  }
+  this->FrameOffsets->SetValue(frames.size(), nbRecords);
+
+  this->Records->SetNumberOfValues(nbRecords * this->RecordSize);
+  for (size_t i = 0; i < frames.size(); ++i)
+  {
+    this->Pack(frames[i], this->FrameOffsets->GetValue(i));
+  }
+  this->Modified();
+  return static_cast<int>(frames.size());
+}
@@ -0,0 +1,121 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTK_LIDAR_FRAME_BATCH_H
+#define VTK_LIDAR_FRAME_BATCH_H
+
+#include <string>
+#include <vector>
+
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+
+class vtkIdTypeArray;
+class vtkLidarReader;
+class vtkPolyData;
+class vtkUnsignedCharArray;
+
+/**
+ * @brief The vtkLidarFrameBatch decodes a batch of frames of a vtkLidarReader and
+ * packs their points in a single buffer of records, to be viewed from Python as a
+ * NumPy structured array without any copy.
+ *
+ * A record has the fields x, y and z of the point followed by one field per point data
+ * array, with as many components as the array. The fields are the ones of the first
+ * frame of the batch, a field missing from another frame is filled with zeros. The
+ * frames are decoded with several threads by vtkLidarReader::DecodeFrames, and the
+ * records of frame i are from GetFrameOffsets()[i] to GetFrameOffsets()[i + 1].
+ *
+ * Each batch has new Records and FrameOffsets arrays, so that the views of the
+ * previous batches stay valid as long as Python holds them.
+ */
+class VTK_EXPORT vtkLidarFrameBatch : public vtkObject
+{
+public:
+  static vtkLidarFrameBatch* New();
+  vtkTypeMacro(vtkLidarFrameBatch, vtkObject)
+
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  //! Reader whose frames are decoded
+  void SetReader(vtkLidarReader* reader);
+  vtkLidarReader* GetReader() { return this->Reader; }
+
+  /**
+   * @brief Decode decode the frames [startFrame, startFrame + numberOfFrames[ of the
+   * reader, or until its last frame, and pack their points
+   * @param numberOfThreads number of decoding threads, 0 to use all the cores
+   * @return the number of frames of the batch, 0 on failure
+   */
+  int Decode(int startFrame, int numberOfFrames, int numberOfThreads = 0);
+
+  //! Records of the points of the last batch, of GetRecordSize() bytes each
+  vtkUnsignedCharArray* GetRecords();
+
+  //! Index of the first record of each frame of the last batch, and the number of records
+  vtkIdTypeArray* GetFrameOffsets();
+
+  //! Number of frames of the last batch
+  int GetNumberOfFrames() { return static_cast<int>(this->FrameNumbers.size()); }
+
+  //! Number of the i-th frame of the last batch in the reader
+  int GetFrameNumber(int i);
+
+  //! Size of a record in bytes
+  int GetRecordSize() { return this->RecordSize; }
+
+  //! Description of the fields of a record: name, VTK data type, number of
+  //! components and offset in bytes from the start of the record
+  int GetNumberOfFields() { return static_cast<int>(this->Fields.size()); }
+  const char* GetFieldName(int i);
+  int GetFieldDataType(int i);
+  int GetFieldNumberOfComponents(int i);
+  int GetFieldOffset(int i);
+
+protected:
+  vtkLidarFrameBatch();
+  ~vtkLidarFrameBatch() override;
+
+private:
+  struct Field
+  {
+    std::string Name;
+    int DataType = 0;
+    int NumberOfComponents = 0;
+    int Offset = 0;
+    int Size = 0;
+  };
+
+  //! Set the fields from the arrays of a frame
+  void SetFields(vtkPolyData* frame);
+
+  //! Copy the points of a frame to the records from the given one
+  void Pack(vtkPolyData* frame, vtkIdType firstRecord);
+
+  vtkLidarReader* Reader = nullptr;
+  std::vector<Field> Fields;
+  int RecordSize = 0;
+  int NumberOfCoordinateFields = 0;
+  std::vector<int> FrameNumbers;
+  vtkSmartPointer<vtkUnsignedCharArray> Records;
+  vtkSmartPointer<vtkIdTypeArray> FrameOffsets;
+
+  vtkLidarFrameBatch(const vtkLidarFrameBatch&) /*= delete*/;
+  void operator =(const vtkLidarFrameBatch&) /*= delete*/;
+};
+
+#endif // VTK_LIDAR_FRAME_BATCH_H
@@ -0,0 +1,260 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "vtkLidarMultiReader.h"
+
+#include "vtkLidarPacketInterpreter.h"
+#include "vtkLidarReader.h"
+#include "ParallelFor.h"
+
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMultiBlockDataSet.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPolyData.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Index of the time step closest to time, the time steps being sorted and not empty
+size_t ClosestTimeStep(const std::vector<double>& timeSteps, double time)
+{
+  auto next = std::lower_bound(timeSteps.begin(), timeSteps.end(), time);
+  if (next == timeSteps.end())
+  {
+    return timeSteps.size() - 1;
+  }
+  if (next != timeSteps.begin() && time - *(next - 1) < *next - time)
+  {
+    --next;
+  }
+  return static_cast<size_t>(std::distance(timeSteps.begin(), next));
+}
+}
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkLidarMultiReader)
+
+//-----------------------------------------------------------------------------
+vtkLidarMultiReader::vtkLidarMultiReader()
+{
+  this->SetNumberOfInputPorts(0);
+  this->SetNumberOfOutputPorts(1);
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarMultiReader::~vtkLidarMultiReader() = default;
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiReader::AddInterpreter(vtkLidarPacketInterpreter* interpreter)
+{
+  this->Interpreters.push_back(interpreter);
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiReader::RemoveAllInterpreters()
+{
+  if (!this->Interpreters.empty())
+  {
+    this->Interpreters.clear();
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiReader::SetNumberOfSensorFileNames(int number)
+{
+  this->FileNames.resize(std::max(0, number));
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiReader::SetSensorFileName(int index, const char* filename)
+{
+  if (index >= static_cast<int>(this->FileNames.size()))
+  {
+    this->FileNames.resize(index + 1);
+  }
+  if (index >= 0)
+  {
+    this->FileNames[index] = filename ? filename : "";
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiReader::SetNumberOfSensorCalibrationFileNames(int number)
+{
+  this->CalibrationFileNames.resize(std::max(0, number));
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiReader::SetSensorCalibrationFileName(int index, const char* filename)
+{
+  if (index >= static_cast<int>(this->CalibrationFileNames.size()))
+  {
+    this->CalibrationFileNames.resize(index + 1);
+  }
+  if (index >= 0)
+  {
+    this->CalibrationFileNames[index] = filename ? filename : "";
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarReader* vtkLidarMultiReader::GetReader(int index)
+{
+  return index >= 0 && index < static_cast<int>(this->Readers.size()) ? this->Readers[index].Get() : nullptr;
+}
+
+//-----------------------------------------------------------------------------
+vtkMTimeType vtkLidarMultiReader::GetMTime()
+{
+  vtkMTimeType mTime = this->Superclass::GetMTime();
+  for (const auto& interpreter : this->Interpreters)
+  {
+    if (interpreter)
+    {
+      mTime = std::max(mTime, interpreter->GetMTime());
+    }
+  }
+  return mTime;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiReader::ForEachSensor(const std::function<void(size_t)>& f)
+{
+  Parallel::ForEachChunk(this->Readers.size(), 1,
+                         static_cast<unsigned int>(std::max(0, this->NumberOfThreads)),
+                         [&f](unsigned int, size_t i, size_t) { f(i); });
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarMultiReader::RequestInformation(vtkInformation* vtkNotUsed(request),
+                                            vtkInformationVector** vtkNotUsed(inputVector),
+                                            vtkInformationVector* outputVector)
+{
+  const size_t numberOfSensors = this->Interpreters.size();
+  if (this->FileNames.size() < numberOfSensors)
+  {
+    vtkErrorMacro("a file name must be given for each of the " << numberOfSensors << " sensors");
+    return 0;
+  }
+
+  // one reader per sensor, kept while its interpreter does not change so that its
+  // frame catalog and its decoded frames are kept too
+  this->Readers.resize(numberOfSensors);
+  this->ReaderCalibrationFileNames.resize(numberOfSensors);
+  for (size_t i = 0; i < numberOfSensors; ++i)
+  {
+    if (!this->Readers[i] || this->Readers[i]->GetInterpreter() != this->Interpreters[i])
+    {
+      this->Readers[i] = vtkSmartPointer<vtkLidarReader>::New();
+      this->Readers[i]->SetInterpreter(this->Interpreters[i]);
+      this->ReaderCalibrationFileNames[i].clear();
+    }
+    this->Readers[i]->SetFileName(this->FileNames[i]);
+    const std::string calibration = i < this->CalibrationFileNames.size() ? this->CalibrationFileNames[i] : "";
+    if (calibration != this->ReaderCalibrationFileNames[i])
+    {
+      this->Readers[i]->SetCalibrationFileName(calibration);
+      this->ReaderCalibrationFileNames[i] = calibration;
+    }
+  }
+
+  // the frame catalogs are built in parallel, the readers sharing nothing
+  this->SensorTimeSteps.assign(numberOfSensors, std::vector<double>());
+  this->ForEachSensor([this](size_t i)
+  {
+    vtkLidarReader* reader = this->Readers[i];
+    reader->UpdateInformation();
+    vtkInformation* info = reader->GetOutputInformation(0);
+    if (info->Has(vtkStreamingDemandDrivenPipeline::TIME_STEPS()))
+    {
+      const double* timeSteps = info->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+      this->SensorTimeSteps[i].assign(timeSteps,
+        timeSteps + info->Length(vtkStreamingDemandDrivenPipeline::TIME_STEPS()));
+    }
+  });
+
+  // merged time index of all the sensors
+  this->TimeSteps.clear();
+  for (const auto& timeSteps : this->SensorTimeSteps)
+  {
+    this->TimeSteps.insert(this->TimeSteps.end(), timeSteps.begin(), timeSteps.end());
+  }
+  std::sort(this->TimeSteps.begin(), this->TimeSteps.end());
+  this->TimeSteps.erase(std::unique(this->TimeSteps.begin(), this->TimeSteps.end()), this->TimeSteps.end());
+
+  vtkInformation* info = outputVector->GetInformationObject(0);
+  info->Remove(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+  info->Remove(vtkStreamingDemandDrivenPipeline::TIME_RANGE());
+  if (!this->TimeSteps.empty())
+  {
+    info->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(), this->TimeSteps.data(),
+              static_cast<int>(this->TimeSteps.size()));
+    double timeRange[2] = { this->TimeSteps.front(), this->TimeSteps.back() };
+    info->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(), timeRange, 2);
+  }
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarMultiReader::RequestData(vtkInformation* vtkNotUsed(request),
+                                     vtkInformationVector** vtkNotUsed(inputVector),
+                                     vtkInformationVector* outputVector)
+{
+  vtkInformation* info = outputVector->GetInformationObject(0);
+  vtkMultiBlockDataSet* output = vtkMultiBlockDataSet::GetData(info);
+  double time = this->TimeSteps.empty() ? 0.0 : this->TimeSteps.front();
+  if (info->Has(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP()))
+  {
+    time = info->Get(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP());
+  }
+
+  // the frame of each sensor closest to the requested time, decoded concurrently
+  const size_t numberOfSensors = this->Readers.size();
+  std::vector<vtkSmartPointer<vtkPolyData> > frames(numberOfSensors);
+  this->ForEachSensor([&](size_t i)
+  {
+    const std::vector<double>& timeSteps = this->SensorTimeSteps[i];
+    const double sensorTime = timeSteps.empty() ? time : timeSteps[ClosestTimeStep(timeSteps, time)];
+    if (this->Readers[i]->UpdateTimeStep(sensorTime))
+    {
+      frames[i] = vtkSmartPointer<vtkPolyData>::New();
+      frames[i]->ShallowCopy(this->Readers[i]->GetOutput());
+    }
+  });
+
+  output->SetNumberOfBlocks(static_cast<unsigned int>(numberOfSensors));
+  for (size_t i = 0; i < numberOfSensors; ++i)
+  {
+    output->SetBlock(static_cast<unsigned int>(i), frames[i]);
+    output->GetMetaData(static_cast<unsigned int>(i))->Set(
+      vtkCompositeDataSet::NAME(), boost::filesystem::path(this->FileNames[i]).filename().string().c_str());
+  }
+  output->GetInformation()->Set(vtkDataObject::DATA_TIME_STEP(), time);
+  return 1;
+}
@@ -0,0 +1,117 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTKLIDARMULTIREADER_H
+#define VTKLIDARMULTIREADER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <vtkMultiBlockDataSetAlgorithm.h>
+#include <vtkSmartPointer.h>
+
+class vtkLidarPacketInterpreter;
+class vtkLidarReader;
+
+/**
+ * @brief The vtkLidarMultiReader class plays back a rig of sensors, each one logged in
+ * its own pcap file, as vtkLidarMultiStream does for the live packets.
+ *
+ * Each sensor is read by its own vtkLidarReader, with its own interpreter, so that the
+ * sensors share nothing: their frame catalogs are built in parallel, and the frames of
+ * a time step are decoded concurrently. The time steps of all the files are merged in a
+ * single sorted index.
+ *
+ * The output contains one block per sensor, holding the frame of its file which is the
+ * closest in time to the requested time step.
+ */
+class VTK_EXPORT vtkLidarMultiReader : public vtkMultiBlockDataSetAlgorithm
+{
+public:
+  static vtkLidarMultiReader* New();
+  vtkTypeMacro(vtkLidarMultiReader, vtkMultiBlockDataSetAlgorithm)
+
+  /**
+   * @brief AddInterpreter add the interpreter of a new sensor, the sensors are
+   * described by the interpreters, file names and calibration files of same index
+   */
+  void AddInterpreter(vtkLidarPacketInterpreter* interpreter);
+  void RemoveAllInterpreters();
+  int GetNumberOfSensors() { return static_cast<int>(this->Interpreters.size()); }
+
+  /**
+   * @brief SetSensorFileName set the pcap file of a sensor
+   */
+  void SetNumberOfSensorFileNames(int number);
+  void SetSensorFileName(int index, const char* filename);
+
+  /**
+   * @brief SetSensorCalibrationFileName set the calibration file of a sensor
+   */
+  void SetNumberOfSensorCalibrationFileNames(int number);
+  void SetSensorCalibrationFileName(int index, const char* filename);
+
+  /**
+   * @brief GetReader the reader of a sensor, created by the last RequestInformation
+   */
+  vtkLidarReader* GetReader(int index);
+
+  //! Number of threads reading the files, 0 to use all the cores
+  vtkGetMacro(NumberOfThreads, int)
+  vtkSetMacro(NumberOfThreads, int)
+
+  vtkMTimeType GetMTime() override;
+
+protected:
+  vtkLidarMultiReader();
+  ~vtkLidarMultiReader();
+
+  int RequestInformation(vtkInformation* request,
+                         vtkInformationVector** inputVector,
+                         vtkInformationVector* outputVector) override;
+
+  int RequestData(vtkInformation* request,
+                  vtkInformationVector** inputVector,
+                  vtkInformationVector* outputVector) override;
+
+  std::vector<vtkSmartPointer<vtkLidarPacketInterpreter> > Interpreters;
+  std::vector<std::string> FileNames;
+  std::vector<std::string> CalibrationFileNames;
+
+  //! Number of threads reading the files, 0 to use all the cores
+  int NumberOfThreads = 0;
+
+private:
+  //! Call f(i) for each sensor i, the sensors being distributed over the threads
+  void ForEachSensor(const std::function<void(size_t)>& f);
+
+  //! One reader per sensor
+  std::vector<vtkSmartPointer<vtkLidarReader> > Readers;
+
+  //! Calibration file set on each reader, to only set it when it changes
+  std::vector<std::string> ReaderCalibrationFileNames;
+
+  //! Time steps of each reader, and the merged time steps of all of them
+  std::vector<std::vector<double> > SensorTimeSteps;
+  std::vector<double> TimeSteps;
+
+  vtkLidarMultiReader(const vtkLidarMultiReader&) = delete;
+  void operator=(const vtkLidarMultiReader&) = delete;
+};
+
+#endif // VTKLIDARMULTIREADER_H
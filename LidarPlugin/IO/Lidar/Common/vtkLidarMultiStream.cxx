@@ -0,0 +1,316 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "vtkLidarMultiStream.h"
+
+#include "MultiSensorNetworkSource.h"
+#include "PacketConsumer.h"
+#include "vtkLidarPacketInterpreter.h"
+
+#include <vtkDataArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMultiBlockDataSet.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkLidarMultiStream)
+
+//-----------------------------------------------------------------------------
+vtkLidarMultiStream::vtkLidarMultiStream()
+{
+  this->Network = std::make_unique<MultiSensorNetworkSource>();
+  this->SetNumberOfInputPorts(0);
+  this->SetNumberOfOutputPorts(1);
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarMultiStream::~vtkLidarMultiStream()
+{
+  this->Stop();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiStream::AddInterpreter(vtkLidarPacketInterpreter* interpreter)
+{
+  this->Interpreters.push_back(interpreter);
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiStream::RemoveAllInterpreters()
+{
+  if (!this->Interpreters.empty())
+  {
+    this->Interpreters.clear();
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiStream::SetNumberOfSensorPorts(int number)
+{
+  this->Ports.resize(std::max(0, number), 2368);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiStream::SetSensorPort(int index, int port)
+{
+  if (index >= static_cast<int>(this->Ports.size()))
+  {
+    this->Ports.resize(index + 1, 2368);
+  }
+  if (index >= 0 && this->Ports[index] != port)
+  {
+    this->Ports[index] = port;
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiStream::SetNumberOfSensorSourceIps(int number)
+{
+  this->SourceIps.resize(std::max(0, number));
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiStream::SetSensorSourceIp(int index, const char* ip)
+{
+  if (index >= static_cast<int>(this->SourceIps.size()))
+  {
+    this->SourceIps.resize(index + 1);
+  }
+  if (index >= 0)
+  {
+    this->SourceIps[index] = ip ? ip : "";
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiStream::SetNumberOfSensorCalibrationFileNames(int number)
+{
+  this->CalibrationFileNames.resize(std::max(0, number));
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiStream::SetSensorCalibrationFileName(int index, const char* filename)
+{
+  if (index >= static_cast<int>(this->CalibrationFileNames.size()))
+  {
+    this->CalibrationFileNames.resize(index + 1);
+  }
+  if (index >= 0)
+  {
+    this->CalibrationFileNames[index] = filename ? filename : "";
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarMultiStream::GetNumberOfReceiveThreads()
+{
+  return this->Network->GetNumberOfReceiveThreads();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiStream::SetNumberOfReceiveThreads(int numberOfThreads)
+{
+  this->Network->SetNumberOfReceiveThreads(numberOfThreads);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarMultiStream::GetNumberOfUnmatchedPackets()
+{
+  return static_cast<int>(this->Network->GetNumberOfUnmatchedPackets());
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarMultiStream::GetNeedsUpdate()
+{
+  for (auto& consumer : this->Consumers)
+  {
+    if (consumer->CheckForNewData())
+    {
+      this->Modified();
+      return true;
+    }
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarMultiStream::GetFrameTime(vtkPolyData* frame)
+{
+  if (!frame || frame->GetNumberOfPoints() == 0)
+  {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  vtkDataArray* time = frame->GetPointData()->GetArray("adjustedtime");
+  if (!time)
+  {
+    time = frame->GetPointData()->GetArray("timestamp");
+  }
+  return time ? time->GetTuple1(0) : std::numeric_limits<double>::quiet_NaN();
+}
+
+//-----------------------------------------------------------------------------
+vtkMTimeType vtkLidarMultiStream::GetMTime()
+{
+  vtkMTimeType mTime = this->Superclass::GetMTime();
+  for (const auto& interpreter : this->Interpreters)
+  {
+    if (interpreter)
+    {
+      mTime = std::max(mTime, interpreter->GetMTime());
+    }
+  }
+  return mTime;
+}
+
+//----------------------------------------------------------------------------
+void vtkLidarMultiStream::Start()
+{
+  this->Stop();
+
+  const size_t numberOfSensors = this->Interpreters.size();
+  if (numberOfSensors == 0)
+  {
+    vtkErrorMacro("no interpreter is set");
+    return;
+  }
+  if (this->Ports.size() < numberOfSensors)
+  {
+    vtkErrorMacro("a port must be given for each of the " << numberOfSensors << " sensors");
+    return;
+  }
+
+  this->Consumers.resize(numberOfSensors);
+  this->LastFrames.assign(numberOfSensors, nullptr);
+  this->Network->RemoveAllSensors();
+  for (size_t i = 0; i < numberOfSensors; ++i)
+  {
+    vtkLidarPacketInterpreter* interpreter = this->Interpreters[i];
+    const std::string calibration = i < this->CalibrationFileNames.size() ? this->CalibrationFileNames[i] : "";
+    if (!calibration.empty() && interpreter->GetCalibrationFileName() != calibration)
+    {
+      interpreter->SetCalibrationFileName(calibration);
+      interpreter->LoadCalibration(calibration);
+    }
+
+    if (!this->Consumers[i])
+    {
+      this->Consumers[i] = std::make_shared<PacketConsumer>();
+    }
+    this->Consumers[i]->SetInterpreter(interpreter);
+    this->Consumers[i]->Start();
+
+    const std::string sourceIp = i < this->SourceIps.size() ? this->SourceIps[i] : "";
+    if (!this->Network->AddSensor(this->Consumers[i], this->Ports[i], sourceIp))
+    {
+      vtkWarningMacro("Invalid source ip " << sourceIp << " for sensor " << i
+                      << ", the packets of any sender on port " << this->Ports[i] << " are accepted");
+      this->Network->AddSensor(this->Consumers[i], this->Ports[i], "");
+    }
+  }
+
+  this->Network->Start();
+}
+
+//----------------------------------------------------------------------------
+void vtkLidarMultiStream::Stop()
+{
+  this->Network->Stop();
+  for (auto& consumer : this->Consumers)
+  {
+    consumer->Stop();
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkLidarMultiStream::RequestData(vtkInformation* vtkNotUsed(request),
+                                     vtkInformationVector** vtkNotUsed(inputVector),
+                                     vtkInformationVector* outputVector)
+{
+  vtkMultiBlockDataSet* output = vtkMultiBlockDataSet::GetData(outputVector);
+
+  // take the frames of all the sensors at once, so that they can be aligned
+  const size_t numberOfSensors = this->Consumers.size();
+  std::vector<std::vector<vtkSmartPointer<vtkPolyData> > > frames(numberOfSensors);
+  for (size_t i = 0; i < numberOfSensors; ++i)
+  {
+    frames[i] = this->Consumers[i]->GetAvailableFrames();
+  }
+
+  // reference time: the newest frame of the slowest sensor, which all the others have reached
+  double referenceTime = std::numeric_limits<double>::infinity();
+  for (const auto& sensorFrames : frames)
+  {
+    if (!sensorFrames.empty())
+    {
+      const double time = GetFrameTime(sensorFrames.back());
+      if (!std::isnan(time))
+      {
+        referenceTime = std::min(referenceTime, time);
+      }
+    }
+  }
+
+  output->SetNumberOfBlocks(static_cast<unsigned int>(numberOfSensors));
+  for (size_t i = 0; i < numberOfSensors; ++i)
+  {
+    if (!frames[i].empty())
+    {
+      // the frame closest to the reference time, or the newest one without time information
+      size_t selected = frames[i].size() - 1;
+      if (!std::isinf(referenceTime))
+      {
+        double smallestOffset = std::numeric_limits<double>::infinity();
+        for (size_t j = 0; j < frames[i].size(); ++j)
+        {
+          const double offset = std::abs(GetFrameTime(frames[i][j]) - referenceTime);
+          if (offset < smallestOffset)
+          {
+            smallestOffset = offset;
+            selected = j;
+          }
+        }
+      }
+      this->LastFrames[i] = frames[i][selected];
+
+      // the frames newer than the selected one are kept for the next update
+      this->Consumers[i]->TakeFrame(frames[i][selected]);
+    }
+
+    if (this->LastFrames[i])
+    {
+      vtkNew<vtkPolyData> block;
+      block->ShallowCopy(this->LastFrames[i]);
+      output->SetBlock(static_cast<unsigned int>(i), block);
+    }
+    output->GetMetaData(static_cast<unsigned int>(i))->Set(
+      vtkCompositeDataSet::NAME(), ("Sensor " + std::to_string(i)).c_str());
+  }
+
+  return 1;
+}
@@ -0,0 +1,132 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTKLIDARMULTISTREAM_H
+#define VTKLIDARMULTISTREAM_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vtkMultiBlockDataSetAlgorithm.h>
+#include <vtkSmartPointer.h>
+
+class vtkLidarPacketInterpreter;
+class vtkPolyData;
+class PacketConsumer;
+class MultiSensorNetworkSource;
+
+/**
+ * @brief The vtkLidarMultiStream class receives the live packets of a rig of sensors.
+ *
+ * All the sockets are handled by a single pool of receive threads, and each sensor has
+ * its own consumer thread which decodes its packets with its own interpreter.
+ * Sensors are identified by a port, and optionally a source ip when several sensors
+ * send to the same port.
+ *
+ * The output contains one block per sensor. The frames are aligned on the sensor
+ * timestamps: the reference time is the time of the newest frame of the slowest sensor,
+ * and each block holds the frame of its sensor which is the closest to that time.
+ */
+class VTK_EXPORT vtkLidarMultiStream : public vtkMultiBlockDataSetAlgorithm
+{
+public:
+  static vtkLidarMultiStream* New();
+  vtkTypeMacro(vtkLidarMultiStream, vtkMultiBlockDataSetAlgorithm)
+
+  void Start();
+  void Stop();
+
+  /**
+   * @brief AddInterpreter add the interpreter of a new sensor, the sensors are
+   * described by the interpreters, ports, source ips and calibration files of same index
+   */
+  void AddInterpreter(vtkLidarPacketInterpreter* interpreter);
+  void RemoveAllInterpreters();
+  int GetNumberOfSensors() { return static_cast<int>(this->Interpreters.size()); }
+
+  /**
+   * @brief SetSensorPort set the port on which the packets of a sensor are received
+   */
+  void SetNumberOfSensorPorts(int number);
+  void SetSensorPort(int index, int port);
+
+  /**
+   * @brief SetSensorSourceIp set the ip of a sensor, empty to accept any sender.
+   * Only needed when several sensors send their packets to the same port.
+   */
+  void SetNumberOfSensorSourceIps(int number);
+  void SetSensorSourceIp(int index, const char* ip);
+
+  /**
+   * @brief SetSensorCalibrationFileName set the calibration file of a sensor,
+   * loaded when the stream is started
+   */
+  void SetNumberOfSensorCalibrationFileNames(int number);
+  void SetSensorCalibrationFileName(int index, const char* filename);
+
+  /**
+   * @copydoc MultiSensorNetworkSource::SetNumberOfReceiveThreads
+   */
+  int GetNumberOfReceiveThreads();
+  void SetNumberOfReceiveThreads(int numberOfThreads);
+
+  /**
+   * @copydoc MultiSensorNetworkSource::GetNumberOfUnmatchedPackets
+   */
+  int GetNumberOfUnmatchedPackets();
+
+  /**
+   * @brief GetNeedsUpdate
+   * @return true if a new frame is ready for at least one sensor
+   */
+  bool GetNeedsUpdate();
+
+  /**
+   * @brief GetFrameTime return the time of a frame, the time of its first point,
+   * or NaN if the frame has no time information
+   */
+  static double GetFrameTime(vtkPolyData* frame);
+
+  vtkMTimeType GetMTime() override;
+
+protected:
+  vtkLidarMultiStream();
+  ~vtkLidarMultiStream();
+
+  int RequestData(vtkInformation* request,
+                  vtkInformationVector** inputVector,
+                  vtkInformationVector* outputVector) override;
+
+  std::vector<vtkSmartPointer<vtkLidarPacketInterpreter> > Interpreters;
+  std::vector<int> Ports;
+  std::vector<std::string> SourceIps;
+  std::vector<std::string> CalibrationFileNames;
+
+  //! One consumer per sensor
+  std::vector<std::shared_ptr<PacketConsumer> > Consumers;
+  std::unique_ptr<MultiSensorNetworkSource> Network;
+
+  //! Last frame output for each sensor, kept when a sensor has no new frame
+  std::vector<vtkSmartPointer<vtkPolyData> > LastFrames;
+
+private:
+  vtkLidarMultiStream(const vtkLidarMultiStream&) = delete;
+  void operator=(const vtkLidarMultiStream&) = delete;
+};
+
+#endif // VTKLIDARMULTISTREAM_H
@@ -1,6 +1,18 @@
 #include "vtkLidarPacketInterpreter.h"
 
+#include <vtkDoubleArray.h>
+#include <vtkFieldData.h>
+#include <vtkIdList.h>
+#include <vtkIntArray.h>
+#include <vtkMatrix4x4.h>
+#include <vtkPointData.h>
+#include <vtkStringArray.h>
 #include <vtkTransform.h>
+#include <vtkUnsignedIntArray.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 namespace {
 //-----------------------------------------------------------------------------
@@ -20,6 +32,59 @@ vtkSmartPointer<vtkCellArray> NewVertexCells(vtkIdType numberOfVerts)
   return cellArray;
 }
 
+//-----------------------------------------------------------------------------
+// Identify the sector of a frame, or remove the identification of a recycled frame
+void SetSectorFieldData(vtkPolyData* polyData, double sectorSize, int sector, int rotation)
+{
+  vtkFieldData* fieldData = polyData->GetFieldData();
+  if (sectorSize <= 0.)
+  {
+    fieldData->RemoveArray("RotationIndex");
+    fieldData->RemoveArray("SectorIndex");
+    fieldData->RemoveArray("SectorAzimuthRange");
+    return;
+  }
+  vtkNew<vtkIntArray> rotationIndex;
+  rotationIndex->SetName("RotationIndex");
+  rotationIndex->InsertNextValue(rotation);
+  fieldData->AddArray(rotationIndex.GetPointer());
+  vtkNew<vtkIntArray> sectorIndex;
+  sectorIndex->SetName("SectorIndex");
+  sectorIndex->InsertNextValue(sector);
+  fieldData->AddArray(sectorIndex.GetPointer());
+  vtkNew<vtkDoubleArray> azimuthRange;
+  azimuthRange->SetName("SectorAzimuthRange");
+  azimuthRange->SetNumberOfComponents(2);
+  azimuthRange->InsertNextTuple2(sector * sectorSize, std::min(360., (sector + 1) * sectorSize));
+  fieldData->AddArray(azimuthRange.GetPointer());
+}
+
+//-----------------------------------------------------------------------------
+// Set one vertex cell per point, reusing the cell array of a recycled frame if any
+void SetVertexCells(vtkPolyData* polyData)
+{
+  const vtkIdType numberOfVerts = polyData->GetNumberOfPoints();
+  // a polydata without vertices returns a shared dummy cell array, which must not be modified
+  vtkCellArray* verts = polyData->GetVerts();
+  if (verts->GetNumberOfCells() == 0)
+  {
+    polyData->SetVerts(NewVertexCells(numberOfVerts));
+    return;
+  }
+
+  vtkIdTypeArray* cells = verts->GetData();
+  const vtkIdType previousNumberOfVerts = verts->GetNumberOfCells();
+  cells->SetNumberOfValues(numberOfVerts * 2);
+  vtkIdType* ids = cells->GetPointer(0);
+  for (vtkIdType i = previousNumberOfVerts; i < numberOfVerts; ++i)
+  {
+    ids[i * 2] = 1;
+    ids[i * 2 + 1] = i;
+  }
+  verts->SetCells(numberOfVerts, cells);
+  polyData->Modified();
+}
+
 //-----------------------------------------------------------------------------
 // Returns the value that is equal to x modulo mod, and that is inside to (0, mod(
 // mod must be > 0.0
@@ -54,6 +119,20 @@ bool inside_interval_mod(double x, double a, double b, double mod)
 }
 }
 
+//-----------------------------------------------------------------------------
+size_t vtkLidarPacketInterpreter::ProcessPackets(const RawPacket* packets, size_t numberOfPackets)
+{
+  for (size_t i = 0; i < numberOfPackets; ++i)
+  {
+    this->ProcessPacket(packets[i].Data, packets[i].Length);
+    if (this->IsNewFrameReady())
+    {
+      return i + 1;
+    }
+  }
+  return numberOfPackets;
+}
+
 //-----------------------------------------------------------------------------
 bool vtkLidarPacketInterpreter::SplitFrame(bool force)
 {
@@ -64,9 +143,11 @@ bool vtkLidarPacketInterpreter::SplitFrame(bool force)
   }
 
   // add vertex to the polydata
-  this->CurrentFrame->SetVerts(NewVertexCells(this->CurrentFrame->GetNumberOfPoints()));
+  SetVertexCells(this->CurrentFrame);
+  SetSectorFieldData(this->CurrentFrame, this->SectorSize, this->CurrentSector, this->RotationIndex);
   // split the frame
   this->Frames.push_back(this->CurrentFrame);
+  this->RecycledFrames.Add(this->CurrentFrame);
   // create a new frame
   this->CurrentFrame = this->CreateNewEmptyFrame(0, nPtsOfCurrentDataset);
 
@@ -110,9 +191,259 @@ bool vtkLidarPacketInterpreter::shouldBeCroppedOut(double pos[3])
   return !((pointInside && !this->CropOutside) || (!pointInside && this->CropOutside));
 }
 
+//-----------------------------------------------------------------------------
+bool vtkLidarPacketInterpreter::IsAzimuthInSector(double azimuth) const
+{
+  if (this->AzimuthSector[0] == this->AzimuthSector[1])
+  {
+    return true;
+  }
+  return inside_interval_mod(azimuth, this->AzimuthSector[0], this->AzimuthSector[1], 360.0);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPacketInterpreter::ComputeLaserMask(
+  const int* verticalRank, int numberOfLasers, bool* mask) const
+{
+  for (int laserId = 0; laserId < numberOfLasers; ++laserId)
+  {
+    const bool selected = !this->ApplySelectionWhileDecoding ||
+      laserId >= static_cast<int>(this->LaserSelection.size()) || this->LaserSelection[laserId];
+    mask[laserId] = selected &&
+      (this->LaserDecimation <= 1 || verticalRank[laserId] % this->LaserDecimation == 0) &&
+      laserId % this->NumberOfPieces == this->Piece;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPacketInterpreter::ComputeRawDistanceRange(double positionOffset, double range[2]) const
+{
+  // distance gate converted to raw distances, so that it is checked without any conversion
+  range[0] = 0.;
+  range[1] = std::numeric_limits<double>::max();
+  if (this->DistanceResolutionM <= 0.)
+  {
+    return;
+  }
+  range[0] = this->DistanceGate[0] / this->DistanceResolutionM;
+  if (this->DistanceGate[1] > 0.)
+  {
+    range[1] = this->DistanceGate[1] / this->DistanceResolutionM;
+  }
+
+  // The radius of a spherical crop bounds the distances before any trigonometry, with
+  // a margin for the offsets of the lasers. The exact crop is still applied on the
+  // positions, this only skips the returns that it would remove.
+  if (!this->ApplySelectionWhileDecoding || this->CropMode != CROP_MODE::Spherical || this->CropOutside)
+  {
+    return;
+  }
+  double margin = positionOffset + 1e-3;
+  if (this->SensorTransform)
+  {
+    // a rigid transform only changes the norm by its translation
+    vtkMatrix4x4* matrix = this->SensorTransform->GetMatrix();
+    for (int i = 0; i < 3; ++i)
+    {
+      for (int j = 0; j < 3; ++j)
+      {
+        double dot = 0.;
+        for (int k = 0; k < 3; ++k)
+        {
+          dot += matrix->GetElement(i, k) * matrix->GetElement(j, k);
+        }
+        if (std::abs(dot - (i == j ? 1. : 0.)) > 1e-6)
+        {
+          return;
+        }
+      }
+    }
+    margin += std::sqrt(matrix->GetElement(0, 3) * matrix->GetElement(0, 3) +
+      matrix->GetElement(1, 3) * matrix->GetElement(1, 3) +
+      matrix->GetElement(2, 3) * matrix->GetElement(2, 3));
+  }
+  range[0] = std::max(range[0], (this->CropRegion[4] - margin) / this->DistanceResolutionM);
+  range[1] = std::min(range[1], (this->CropRegion[5] + margin) / this->DistanceResolutionM);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPacketInterpreter::SetPiece(int piece, int numberOfPieces)
+{
+  numberOfPieces = std::max(1, numberOfPieces);
+  piece = std::min(std::max(0, piece), numberOfPieces - 1);
+  if (piece != this->Piece || numberOfPieces != this->NumberOfPieces)
+  {
+    this->Piece = piece;
+    this->NumberOfPieces = numberOfPieces;
+    // the reader sets the piece while it executes, so only the decoded frames
+    // are invalidated and the pipeline is not modified
+    this->DecodingTime.Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarPacketInterpreter::SplitSector(double azimuth, bool isNewRotation)
+{
+  if (isNewRotation)
+  {
+    ++this->RotationIndex;
+  }
+  if (this->SectorSize <= 0.)
+  {
+    return false;
+  }
+  const int sector = static_cast<int>(azimuth / this->SectorSize);
+  // the frame keeps the index of its sector until it is split
+  bool isSplit = false;
+  if (!isNewRotation && this->CurrentSector != -1 && sector != this->CurrentSector)
+  {
+    isSplit = this->SplitFrame();
+  }
+  this->CurrentSector = sector;
+  return isSplit;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPacketInterpreter::CopyDecodingSettings(vtkLidarPacketInterpreter* instance) const
+{
+  instance->CalibrationFileName = this->CalibrationFileName;
+  instance->CalibrationReportedNumLasers = this->CalibrationReportedNumLasers;
+  instance->IsCalibrated = this->IsCalibrated;
+  instance->TimeOffset = this->TimeOffset;
+  instance->LaserSelection = this->LaserSelection;
+  instance->DistanceResolutionM = this->DistanceResolutionM;
+  instance->Frequency = this->Frequency;
+  instance->IgnoreZeroDistances = this->IgnoreZeroDistances;
+  instance->IgnoreEmptyFrames = this->IgnoreEmptyFrames;
+  instance->ApplyTransform = this->ApplyTransform;
+  if (this->SensorTransform)
+  {
+    // each instance gets its own copy, so that it can be used without lock
+    vtkNew<vtkTransform> sensorTransform;
+    sensorTransform->DeepCopy(this->SensorTransform);
+    instance->SetSensorTransform(sensorTransform.GetPointer());
+  }
+  instance->CropMode = this->CropMode;
+  instance->CropOutside = this->CropOutside;
+  std::copy(this->CropRegion, this->CropRegion + 6, instance->CropRegion);
+  instance->LaserDecimation = this->LaserDecimation;
+  instance->Piece = this->Piece;
+  instance->NumberOfPieces = this->NumberOfPieces;
+  std::copy(this->AzimuthSector, this->AzimuthSector + 2, instance->AzimuthSector);
+  std::copy(this->DistanceGate, this->DistanceGate + 2, instance->DistanceGate);
+}
+
 //-----------------------------------------------------------------------------
 vtkCxxSetObjectMacro(vtkLidarPacketInterpreter, SensorTransform, vtkTransform)
 
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkLidarPacketInterpreter::ApplySelection(vtkPolyData* frame)
+{
+  if (!frame || this->ApplySelectionWhileDecoding)
+  {
+    return frame;
+  }
+  vtkDataArray* laserIds = frame->GetPointData()->GetArray("laser_id");
+  const bool hasLaserSelection = laserIds &&
+    std::find(this->LaserSelection.begin(), this->LaserSelection.end(), false) != this->LaserSelection.end();
+  const bool hasCrop = this->CropMode != CROP_MODE::None;
+  const vtkIdType numberOfPoints = frame->GetNumberOfPoints();
+  if (numberOfPoints == 0 || (!hasLaserSelection && !hasCrop))
+  {
+    return frame;
+  }
+
+  // the points kept, checked as the decoder would have
+  vtkNew<vtkIdList> kept;
+  kept->Allocate(numberOfPoints);
+  const int numberOfSelectableLasers = static_cast<int>(this->LaserSelection.size());
+  double position[3];
+  for (vtkIdType pointId = 0; pointId < numberOfPoints; ++pointId)
+  {
+    if (hasLaserSelection)
+    {
+      const int laserId = static_cast<int>(laserIds->GetTuple1(pointId));
+      if (laserId >= 0 && laserId < numberOfSelectableLasers && !this->LaserSelection[laserId])
+      {
+        continue;
+      }
+    }
+    if (hasCrop)
+    {
+      frame->GetPoint(pointId, position);
+      if (this->shouldBeCroppedOut(position))
+      {
+        continue;
+      }
+    }
+    kept->InsertNextId(pointId);
+  }
+  const vtkIdType numberOfKeptPoints = kept->GetNumberOfIds();
+  if (numberOfKeptPoints == numberOfPoints)
+  {
+    return frame;
+  }
+
+  // compact the points and each array, the decoded frame being left untouched
+  vtkSmartPointer<vtkPolyData> selected = vtkSmartPointer<vtkPolyData>::New();
+  vtkNew<vtkPoints> points;
+  points->SetDataType(frame->GetPoints()->GetDataType());
+  points->SetNumberOfPoints(numberOfKeptPoints);
+  frame->GetPoints()->GetPoints(kept.GetPointer(), points.GetPointer());
+  selected->SetPoints(points.GetPointer());
+
+  vtkPointData* pointData = frame->GetPointData();
+  for (int i = 0; i < pointData->GetNumberOfArrays(); ++i)
+  {
+    vtkAbstractArray* array = pointData->GetAbstractArray(i);
+    vtkSmartPointer<vtkAbstractArray> keptValues;
+    keptValues.TakeReference(array->NewInstance());
+    keptValues->SetName(array->GetName());
+    keptValues->SetNumberOfComponents(array->GetNumberOfComponents());
+    keptValues->SetNumberOfTuples(numberOfKeptPoints);
+    array->GetTuples(kept.GetPointer(), keptValues);
+    selected->GetPointData()->AddArray(keptValues);
+  }
+  if (pointData->GetScalars())
+  {
+    selected->GetPointData()->SetActiveScalars(pointData->GetScalars()->GetName());
+  }
+  selected->GetFieldData()->ShallowCopy(frame->GetFieldData());
+  if (frame->GetNumberOfVerts() > 0)
+  {
+    selected->SetVerts(NewVertexCells(numberOfKeptPoints));
+  }
+  return selected;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPacketInterpreter::Modified()
+{
+  this->DecodingTime.Modified();
+  this->Superclass::Modified();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPacketInterpreter::SelectionModified()
+{
+  this->Superclass::Modified();
+}
+
+//-----------------------------------------------------------------------------
+vtkMTimeType vtkLidarPacketInterpreter::GetDecodingMTime()
+{
+  if (this->ApplySelectionWhileDecoding)
+  {
+    return std::max(this->GetMTime(), this->DecodingTime.GetMTime());
+  }
+  vtkMTimeType time = this->DecodingTime.GetMTime();
+  if (this->SensorTransform)
+  {
+    time = std::max(time, this->SensorTransform->GetMTime());
+  }
+  return time;
+}
+
 //-----------------------------------------------------------------------------
 vtkMTimeType vtkLidarPacketInterpreter::GetMTime()
 {
@@ -122,3 +453,48 @@ vtkMTimeType vtkLidarPacketInterpreter::GetMTime()
   }
   return this->Superclass::GetMTime();
 }
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkTable> vtkLidarPacketInterpreter::GetPacketGapTable() const
+{
+  const std::vector<PacketGapDetector::Gap> gaps = this->PacketGaps.GetGaps();
+  const vtkIdType numberOfGaps = static_cast<vtkIdType>(gaps.size());
+
+  vtkNew<vtkStringArray> type;
+  type->SetName("Type");
+  type->SetNumberOfValues(numberOfGaps);
+  auto newDoubleColumn = [numberOfGaps](const char* name) {
+    vtkSmartPointer<vtkDoubleArray> column = vtkSmartPointer<vtkDoubleArray>::New();
+    column->SetName(name);
+    column->SetNumberOfValues(numberOfGaps);
+    return column;
+  };
+  vtkSmartPointer<vtkDoubleArray> time = newDoubleColumn("Time");
+  vtkSmartPointer<vtkDoubleArray> networkTime = newDoubleColumn("NetworkTime");
+  vtkSmartPointer<vtkDoubleArray> timeStep = newDoubleColumn("TimeStep");
+  vtkSmartPointer<vtkDoubleArray> azimuthStep = newDoubleColumn("AzimuthStep");
+  vtkNew<vtkUnsignedIntArray> missingPackets;
+  missingPackets->SetName("MissingPackets");
+  missingPackets->SetNumberOfValues(numberOfGaps);
+
+  const char* typeNames[] = { "time gap", "time jump back", "azimuth gap" };
+  for (vtkIdType i = 0; i < numberOfGaps; ++i)
+  {
+    const PacketGapDetector::Gap& gap = gaps[i];
+    type->SetValue(i, typeNames[gap.Type]);
+    time->SetValue(i, gap.Time);
+    networkTime->SetValue(i, gap.NetworkTime);
+    timeStep->SetValue(i, gap.TimeStep);
+    azimuthStep->SetValue(i, gap.AzimuthStep);
+    missingPackets->SetValue(i, gap.NumberOfMissingPackets);
+  }
+
+  vtkSmartPointer<vtkTable> table = vtkSmartPointer<vtkTable>::New();
+  table->AddColumn(type.GetPointer());
+  table->AddColumn(time);
+  table->AddColumn(networkTime);
+  table->AddColumn(timeStep);
+  table->AddColumn(azimuthStep);
+  table->AddColumn(missingPackets.GetPointer());
+  return table;
+}
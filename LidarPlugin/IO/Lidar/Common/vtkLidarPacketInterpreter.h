@@ -23,9 +23,29 @@
 #include <vtkAlgorithm.h>
 
 #include "FrameInformation.h"
+#include "FramePool.h"
+#include "PacketGapDetector.h"
+
+#include <algorithm>
+#include <vector>
 
 class vtkTransform;
 
+/**
+ * @brief RawPacket raw data packet, as given to vtkLidarPacketInterpreter::ProcessPackets
+ */
+struct RawPacket
+{
+  unsigned char const* Data = nullptr;
+  unsigned int Length = 0;
+};
+
+/**
+ * @brief vtkLidarPacketInterpreter base class of the decoders of the packets of a sensor.
+ * A new sensor only decodes the layout of its packets, the frames are built with the
+ * helpers of FrameDataArrays.h, split and timed with AzimuthFraming.h, and the returns
+ * are selected with ComputeLaserMask and ComputeRawDistanceRange.
+ */
 class VTK_EXPORT  vtkLidarPacketInterpreter : public vtkAlgorithm
 {
 public:
@@ -69,6 +89,17 @@ public:
    */
   virtual void ProcessPacket(unsigned char const * data, unsigned int dataLength) = 0;
 
+  /**
+   * @brief ProcessPackets process several data packets at once, in order, and stop
+   * as soon as a new frame is ready. This is equivalent to calling ProcessPacket on each
+   * packet and checking IsNewFrameReady after each call, but enables interpreters to do the
+   * per packet work only once for the whole batch.
+   * @param packets raw data packets, which must stay valid during the call
+   * @param numberOfPackets number of packets
+   * @return the number of packets processed
+   */
+  virtual size_t ProcessPackets(const RawPacket* packets, size_t numberOfPackets);
+
   /**
    * @brief SplitFrame take the current frame under construction and place it in another buffer
    * @param force force the split even if the frame is empty
@@ -94,6 +125,34 @@ public:
                                 fpos_t filePosition = fpos_t(), double packetNetworkTime = 0,
                                 std::vector<FrameInformation>* frameCatalog = nullptr) = 0;
 
+  /**
+   * @brief NewPreProcessingInstance create a new interpreter with the same settings as this one,
+   * that can be used to run PreProcessPacket on another part of the same file in parallel.
+   * The caller takes the ownership of the returned instance.
+   * @return nullptr if the interpreter does not support to be run in parallel
+   */
+  virtual vtkLidarPacketInterpreter* NewPreProcessingInstance() { return nullptr; }
+
+  /**
+   * @brief NewDecodingInstance create a new interpreter with the same settings and calibration
+   * as this one, that can be used to decode other frames of the same file in parallel, in
+   * another thread. The caller takes the ownership of the returned instance.
+   * @return nullptr if the interpreter does not support to be run in parallel,
+   * or is not calibrated yet
+   */
+  virtual vtkLidarPacketInterpreter* NewDecodingInstance() { return nullptr; }
+
+  /**
+   * @brief RebaseFrameInformation adapt a frame information, obtained with an instance returned
+   * by NewPreProcessingInstance, so that it is consistent with the frames found before it
+   * (ex: time rollover count).
+   * @param info[in,out] frame information to adapt
+   * @param reference frame found by both instances, as given by the previous instance
+   * @param local same frame, as given by the instance which has produced info
+   */
+  virtual void RebaseFrameInformation(FrameInformation& vtkNotUsed(info),
+    const FrameInformation& vtkNotUsed(reference), const FrameInformation& vtkNotUsed(local)) {}
+
   /**
    * @brief IsLidarPacket check if the given packet is really a lidar packet
    * @param data raw data packet
@@ -101,12 +160,22 @@ public:
    */
   virtual bool IsLidarPacket(unsigned char const * data, unsigned int dataLength) = 0;
 
+  /**
+   * @brief GetLidarPacketSizes give the sizes of the lidar packets accepted by IsLidarPacket,
+   * so that the other packets can be filtered out when reading a file
+   * @return an empty list if the size of the packets is not known in advance
+   */
+  virtual std::vector<unsigned int> GetLidarPacketSizes() const { return {}; }
+
   /**
    * @brief ResetCurrentFrame reset all information to handle some new frame. This reset the
    * frame container, some information about the current frame, guesses about the sensor type, etc
    */
   virtual void ResetCurrentFrame() { this->CurrentFrame = this->CreateNewEmptyFrame(0); }
 
+  //! Forget the frames kept to be reused, so that the next frames are allocated again
+  void ClearRecycledFrames() { this->RecycledFrames.Clear(); }
+
   /**
    * @brief isNewFrameReady check if a new frame is ready
    */
@@ -152,6 +221,26 @@ public:
    */
   virtual void SetParserMetaData(const FrameInformation& metaData) { this->ParserMetaData = metaData; }
 
+  /**
+   * @brief GetPacketGapTable return a table with a row per discontinuity of the timestamps
+   * or of the azimuths of the packets (see PacketGapDetector), found by PreProcessPacket while
+   * the frame catalog is built, and by ProcessPacket if DetectGapsWhileDecoding is set.
+   * The gaps are not found again when the catalog is read from its index cache.
+   */
+  vtkSmartPointer<vtkTable> GetPacketGapTable() const;
+
+  //! Gaps found since the last reset, its counters can be read from any thread
+  const PacketGapDetector& GetPacketGaps() const { return this->PacketGaps; }
+  void ResetPacketGaps() { this->PacketGaps.Reset(); }
+
+  //! Append the gaps found by an instance returned by NewPreProcessingInstance on the
+  //! packets following the ones preprocessed by this instance
+  void StitchPacketGaps(vtkLidarPacketInterpreter* next) { this->PacketGaps.Stitch(next->PacketGaps); }
+
+  //! Also detect the gaps while decoding, only meaningful when the packets are decoded in order
+  bool GetDetectGapsWhileDecoding() const { return this->DetectGapsWhileDecoding; }
+  void SetDetectGapsWhileDecoding(bool detect) { this->DetectGapsWhileDecoding = detect; }
+
   virtual int GetNumberOfChannels() { return this->CalibrationReportedNumLasers; }
 
   vtkGetMacro(CalibrationFileName, std::string)
@@ -169,9 +258,9 @@ public:
   /**
    * @copydoc LidarPacketInterpreter::LaserSelection
    */
-  virtual void SetLaserSelection(const bool* v) { this->LaserSelection = std::vector<bool>(v, v + this->CalibrationReportedNumLasers); }
+  virtual void SetLaserSelection(const bool* v) { this->LaserSelection = std::vector<bool>(v, v + this->CalibrationReportedNumLasers); this->SelectionModified(); }
   virtual void GetLaserSelection(bool* v) { std::copy(this->LaserSelection.begin(), this->LaserSelection.end(), v);}
-  virtual void SetLaserSelection(const std::vector<bool>& v) { this->LaserSelection = v; }
+  virtual void SetLaserSelection(const std::vector<bool>& v) { this->LaserSelection = v; this->SelectionModified(); }
   virtual std::vector<bool> GetLaserSelection() const { return this->LaserSelection; }
 
   vtkGetMacro(DistanceResolutionM, double)
@@ -193,16 +282,86 @@ public:
   virtual void SetSensorTransform(vtkTransform *);
 
   vtkGetMacro(CropMode, int)
-  vtkSetMacro(CropMode, int)
+  virtual void SetCropMode(int mode) { if (mode != this->CropMode) { this->CropMode = mode; this->SelectionModified(); } }
 
   vtkGetMacro(CropOutside, bool)
-  vtkSetMacro(CropOutside, bool)
+  virtual void SetCropOutside(bool outside) { if (outside != this->CropOutside) { this->CropOutside = outside; this->SelectionModified(); } }
+
+  virtual void SetCropRegion(double xmin, double xmax, double ymin, double ymax, double zmin, double zmax)
+  {
+    const double region[6] = { xmin, xmax, ymin, ymax, zmin, zmax };
+    this->SetCropRegion(region);
+  }
+  virtual void SetCropRegion(const double region[6])
+  {
+    if (!std::equal(region, region + 6, this->CropRegion))
+    {
+      std::copy(region, region + 6, this->CropRegion);
+      this->SelectionModified();
+    }
+  }
+
+  /**
+   * @brief ApplySelectionWhileDecoding if true (the default), the returns removed by
+   * LaserSelection and the crop are skipped by the decoder. If false they are decoded, and
+   * ApplySelection removes them from the decoded frames: a reader keeping the decoded frames
+   * then only filters them again when the selection changes, instead of decoding them again.
+   */
+  vtkGetMacro(ApplySelectionWhileDecoding, bool)
+  vtkSetMacro(ApplySelectionWhileDecoding, bool)
+
+  /**
+   * @brief ApplySelection keep the points of a frame that LaserSelection and the crop select,
+   * when they are not applied while decoding
+   * @return the frame itself if all its points are kept, otherwise a new frame with the
+   * points kept, in the same order, and the same arrays
+   */
+  vtkSmartPointer<vtkPolyData> ApplySelection(vtkPolyData* frame);
+
+  /**
+   * @brief GetDecodingMTime modification time of the settings that change the decoded frames.
+   * It is the MTime, except that LaserSelection and the crop are ignored when they are not
+   * applied while decoding.
+   */
+  vtkMTimeType GetDecodingMTime();
 
-  vtkSetVector6Macro(CropRegion, double)
+  vtkGetMacro(LaserDecimation, int)
+  vtkSetClampMacro(LaserDecimation, int, 1, VTK_INT_MAX)
+
+  vtkGetVector2Macro(AzimuthSector, double)
+  vtkSetVector2Macro(AzimuthSector, double)
+
+  vtkGetVector2Macro(DistanceGate, double)
+  vtkSetVector2Macro(DistanceGate, double)
+
+  /**
+   * @brief SectorSize in degrees, if not 0 the rotations are split into sectors of this size,
+   * each sector being made available as a frame as soon as it is complete. The frames then
+   * carry the field data RotationIndex, SectorIndex and SectorAzimuthRange, so that the
+   * sectors of a rotation can be stitched back together. Only meant for live streams.
+   */
+  vtkGetMacro(SectorSize, double)
+  vtkSetClampMacro(SectorSize, double, 0., 360.)
+
+  /**
+   * @brief SetPiece select the piece of the frames to decode when the frames are split in
+   * pieces between several processes. The lasers are distributed between the pieces, the
+   * laser i belonging to the piece i % numberOfPieces. This does not modify the
+   * interpreter, only its decoding MTime, as it is set by the reader during RequestData.
+   */
+  void SetPiece(int piece, int numberOfPieces);
+  int GetPiece() const { return this->Piece; }
+  int GetNumberOfPieces() const { return this->NumberOfPieces; }
 
   vtkMTimeType GetMTime() override;
 
+  //! Update DecodingTime too, for all the settings but the selection
+  void Modified() override;
+
 protected:
+  //! Update the MTime but not DecodingTime, for LaserSelection and the crop
+  void SelectionModified();
+
   /**
    * @brief shouldBeCroppedOut Returns true if a point should be removed,
    * i.e. if it lays *outside* the cropping volume.
@@ -218,12 +377,60 @@ protected:
    */
   bool shouldBeCroppedOut(double pos[3]);
 
+  /**
+   * @brief IsAzimuthInSector Returns true if a firing at this azimuth should be decoded,
+   * according to AzimuthSector. Meant to be checked on the raw data, before the positions
+   * are computed.
+   * @param azimuth azimuth of the firing in the sensor frame, in degrees
+   */
+  bool IsAzimuthInSector(double azimuth) const;
+
+  /**
+   * @brief ComputeLaserMask computes which lasers are kept by LaserSelection and
+   * LaserDecimation, so that the selection is checked with a single lookup per return.
+   * @param verticalRank rank of each laser sorted by vertical angle
+   * @param numberOfLasers size of verticalRank and mask
+   * @param mask true for the lasers to decode
+   */
+  void ComputeLaserMask(const int* verticalRank, int numberOfLasers, bool* mask) const;
+
+  /**
+   * @brief ComputeRawDistanceRange computes the interval of raw distances kept by the
+   * DistanceGate and by a spherical crop, to reject the returns before computing their
+   * position. The exact crop must still be applied on the positions.
+   * @param positionOffset bound of the difference between the distance of a return and
+   * the norm of its position in the sensor frame, due to the offsets of the lasers
+   * @param range raw distances to keep, in units of DistanceResolutionM
+   */
+  void ComputeRawDistanceRange(double positionOffset, double range[2]) const;
+
+  /**
+   * @brief SplitSector splits the current frame if the firing at this azimuth starts a
+   * new sector (see SectorSize). Must be called for each firing, after the frame was split
+   * if the firing starts a new rotation.
+   * @param azimuth azimuth of the firing in the sensor frame, in degrees in [0, 360)
+   * @param isNewRotation true if the firing starts a new rotation
+   * @return true if the frame was split
+   */
+  bool SplitSector(double azimuth, bool isNewRotation);
+
+  /**
+   * @brief CopyDecodingSettings copy to another instance the settings of this class used
+   * to decode the frames (calibration state, selection, cropping, ...), to implement
+   * NewDecodingInstance. The sensor transform is copied, not shared.
+   */
+  void CopyDecodingSettings(vtkLidarPacketInterpreter* instance) const;
+
   //! Buffer to store the frame once they are ready
   std::vector<vtkSmartPointer<vtkPolyData> > Frames;
 
   //! Frame under construction
   vtkSmartPointer<vtkPolyData> CurrentFrame;
 
+  //! Frames given to the consumers, which can be reused by CreateNewEmptyFrame
+  //! once they have been released
+  FramePool RecycledFrames;
+
   //! File containing all calibration information
   std::string CalibrationFileName = "";
 
@@ -271,6 +478,12 @@ protected:
   //! If false, the region within the area is cropped/removed.
   bool CropOutside = false;
 
+  //! Skip the returns removed by LaserSelection and the crop while decoding
+  bool ApplySelectionWhileDecoding = true;
+
+  //! Last modification of a setting other than the selection
+  vtkTimeStamp DecodingTime;
+
   //! Meta data required to correctly parse the
   //! data contained within the udp packets
   FrameInformation ParserMetaData;
@@ -286,6 +499,40 @@ protected:
   //! all distances are in meters and all angles are in degrees
   double CropRegion[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
 
+  //! The filters below are applied on the raw returns, before any position is computed,
+  //! so that the dropped returns cost almost nothing to decode. They come in addition
+  //! to the crop, which is applied on the positions.
+
+  //! Keep one laser over LaserDecimation, taken in the order of the vertical angles
+  //! so that the remaining lasers are evenly spread
+  int LaserDecimation = 1;
+
+  //! [azimuth_min, azimuth_max] in degrees in the sensor frame, modulo 360°, outside
+  //! of which the firings are dropped. The whole turn is kept if min == max.
+  double AzimuthSector[2] = { 0.0, 0.0 };
+
+  //! [distance_min, distance_max] in meters, outside of which the returns are dropped.
+  //! The raw distance is used, before its correction by the calibration.
+  //! There is no upper bound if distance_max <= 0.
+  double DistanceGate[2] = { 0.0, 0.0 };
+
+  //! Piece of the frames to decode, see SetPiece
+  int Piece = 0;
+  int NumberOfPieces = 1;
+
+  //! Size of the sectors of the rotations in degrees, 0 to make frames of whole rotations
+  double SectorSize = 0.;
+
+  //! Sector of the frame under construction, -1 before the first firing
+  int CurrentSector = -1;
+
+  //! Number of rotations started since the last reset of the current frame
+  int RotationIndex = 0;
+
+  //! Discontinuities of the packets, see GetPacketGapTable
+  PacketGapDetector PacketGaps;
+  bool DetectGapsWhileDecoding = false;
+
   vtkLidarPacketInterpreter() = default;
   virtual ~vtkLidarPacketInterpreter() = default;
 
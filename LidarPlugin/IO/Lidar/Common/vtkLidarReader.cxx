@@ -1,19 +1,129 @@
 #include "vtkLidarReader.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <map>
 #include <sstream>
 
+#include "vtkLidarFrameArchiveReader.h"
 #include "vtkLidarPacketInterpreter.h"
 #include "vtkPacketFileWriter.h"
 #include "vtkPacketFileReader.h"
+#include "FrameArchive.h"
+#include "FrameCSVWriter.h"
+#include "FrameTensorWriter.h"
+#include "FrameWebWriter.h"
+#include "FrameCatalogIndex.h"
+#include "FrameCache.h"
 #include "statistics.h"
 
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <vtkDataArray.h>
 #include <vtkInformationVector.h>
 #include <vtkInformation.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkTable.h>
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+#ifndef _MSC_VER
+namespace
+{
+//-----------------------------------------------------------------------------
+//! Byte offset stored in a file position, see vtkPacketFileReader::GetFilePosition
+int64_t FileOffset(const fpos_t& position)
+{
+  int64_t offset;
+  std::memcpy(&offset, &position, sizeof(offset));
+  return offset;
+}
+
+//-----------------------------------------------------------------------------
+//! Copy size bytes at offset of a file to the end of another one, in the kernel
+//! when possible. Return the number of bytes copied, -1 on failure
+ssize_t CopyFileRange(int input, int output, int64_t offset, size_t size)
+{
+#ifdef __linux__
+  off_t inputOffset = static_cast<off_t>(offset);
+  const ssize_t copied = sendfile(output, input, &inputOffset, size);
+  if (copied >= 0 || (errno != EINVAL && errno != ENOSYS))
+  {
+    return copied;
+  }
+#endif
+  // through a buffer, if the kernel can not copy between these files
+  std::vector<char> buffer(std::min(size, static_cast<size_t>(1 << 20)));
+  const ssize_t length = pread(input, buffer.data(), buffer.size(), static_cast<off_t>(offset));
+  if (length <= 0)
+  {
+    return length;
+  }
+  ssize_t written = 0;
+  while (written < length)
+  {
+    const ssize_t count = write(output, buffer.data() + written, length - written);
+    if (count < 0)
+    {
+      return -1;
+    }
+    written += count;
+  }
+  return written;
+}
+}
+#endif
+
+//-----------------------------------------------------------------------------
+struct vtkLidarReader::FramePrefetcher
+{
+  FramePrefetcher()
+  {
+    this->Cache.JoinMemoryBudget("Lidar frames", MemoryBudget::PrefetchedFramesPriority);
+  }
+
+  //! Protect the cache, the request and the use of the interpreters
+  boost::mutex Mutex;
+  boost::condition_variable Condition;
+
+  //! Decoded frames and decoding MTime of the reader when they have been decoded
+  FrameCache Cache;
+  vtkMTimeType CacheMTime = 0;
+
+  //! Copy of the interpreter and packet selection of the reader at CacheMTime, so that
+  //! the prefetch thread does not use the interpreter the pipeline modifies
+  vtkSmartPointer<vtkLidarPacketInterpreter> Interpreter;
+  UDPPacketSelection PacketSelection;
+
+  //! Last frame decoded while the cache is disabled
+  vtkSmartPointer<vtkPolyData> LastFrame;
+  int LastFrameNumber = -1;
+  vtkMTimeType LastFrameMTime = 0;
+
+  //! Last frame requested, and a counter incremented on each request
+  int RequestedFrame = -1;
+  unsigned int Generation = 0;
+
+  std::unique_ptr<boost::thread> Thread;
+  bool Stop = false;
+};
 
 //-----------------------------------------------------------------------------
 int vtkLidarReader::ReadFrameInformation()
 {
+  this->StopFramePrefetcher();
   this->Open();
   const unsigned char* data = 0;
   unsigned int dataLength = 0;
@@ -21,9 +131,36 @@ int vtkLidarReader::ReadFrameInformation()
 
   // reset the frame catalog to build a new one
   this->FrameCatalog.clear();
+  this->NumberOfScannedChunks = 1;
 
-  // reset the interpreter parser meta data
+  // reset the interpreter parser meta data and the gaps found by a previous scan
   this->Interpreter->ResetParserMetaData();
+  this->Interpreter->ResetPacketGaps();
+
+  // the position packets are only seen if the packets are not filtered on the lidar port,
+  // and they are all seen only if the whole file is read
+  const bool isWindowed = this->IsWindowed();
+  this->PositionPackets.reset();
+  std::shared_ptr<PositionPacketCache::Packets> positionPackets;
+  if (this->CollectPositionPackets && this->LidarPort == -1 && !isWindowed)
+  {
+    positionPackets = std::make_shared<PositionPacketCache::Packets>();
+  }
+
+  // The catalog sidecar can only be used if the calibration does not come from
+  // the pcap itself, as the live calibration is read while parsing the file.
+  // It describes the whole file, so it is not used for a window
+  const bool canUseFrameIndex =
+    this->UseFrameIndexCache && this->Interpreter->GetIsCalibrated() && !isWindowed;
+  const std::string frameIndexSettings = this->GetFrameIndexSettings();
+  this->WaitForFrameIndexWriter();
+  if (canUseFrameIndex
+      && FrameCatalogIndex::Read(this->FileName, frameIndexSettings,
+                                 this->Interpreter->GetParserMetaData(), this->FrameCatalog))
+  {
+    this->ComputeNetworkTimeToDataTime();
+    return this->GetNumberOfFrames();
+  }
 
   // keep track of the file position
   // and the network timestamp of the
@@ -31,8 +168,33 @@ int vtkLidarReader::ReadFrameInformation()
   fpos_t lastFilePosition;
   double lastPacketNetworkTime = 0;
   this->Reader->GetFilePosition(&lastFilePosition);
+  this->Reader->SetSequentialAccess(true);
+
+  bool isScanned = !isWindowed && this->ScanFrameCatalogInParallel(positionPackets.get());
+  if (!isScanned)
+  {
+    // the parallel scan may have moved the reader
+    this->FrameCatalog.clear();
+    this->Interpreter->ResetParserMetaData();
+    this->Interpreter->ResetPacketGaps();
+    this->Reader->SetFilePosition(&lastFilePosition);
+    if (positionPackets)
+    {
+      positionPackets->Data.clear();
+    }
+  }
+
+  // the packets before the window are skipped, and the scan stops after it
+  double windowBegin = -std::numeric_limits<double>::infinity();
+  double windowEnd = std::numeric_limits<double>::infinity();
+  int64_t windowEndOffset = std::numeric_limits<int64_t>::max();
+  if (isWindowed)
+  {
+    this->SeekToWindow(windowBegin, windowEnd, windowEndOffset);
+    this->Reader->GetFilePosition(&lastFilePosition);
+  }
 
-  while (this->Reader->NextPacket(data, dataLength, lastPacketNetworkTime))
+  while (!isScanned && this->Reader->NextPacket(data, dataLength, lastPacketNetworkTime))
   {
     // This command sends a signal that can be observed from outside
     // and that is used to diplay a Qt progress dialog from Python
@@ -44,10 +206,25 @@ int vtkLidarReader::ReadFrameInformation()
     // skip it and update the file position
     if (!this->Interpreter->IsLidarPacket(data, dataLength))
     {
+      if (positionPackets && PositionPacketCache::IsPositionPacket(data, dataLength))
+      {
+        positionPackets->Append(data);
+      }
       this->Reader->GetFilePosition(&lastFilePosition);
       continue;
     }
 
+    if (lastPacketNetworkTime < windowBegin)
+    {
+      this->Reader->GetFilePosition(&lastFilePosition);
+      continue;
+    }
+    if (lastPacketNetworkTime > windowEnd
+        || (this->Reader->IsMemoryMapped() && this->Reader->GetMappedOffset() > windowEndOffset))
+    {
+      break;
+    }
+
     // add an index for the first Lidar packet
     if (firstIteration)
     {
@@ -56,6 +233,11 @@ int vtkLidarReader::ReadFrameInformation()
       // this 2 frames will have the same timestep. So to avoid that we
       // artificatially move the first timeStep back by one.
       this->FrameCatalog.push_back(this->Interpreter->GetParserMetaData());
+      if (isWindowed)
+      {
+        // the first frame of a window does not start at the beginning of the file
+        this->FrameCatalog.back().FilePosition = lastFilePosition;
+      }
       firstIteration = false;
     }
 
@@ -66,11 +248,233 @@ int vtkLidarReader::ReadFrameInformation()
     this->Reader->GetFilePosition(&lastFilePosition);
   }
 
-  if (this->FrameCatalog.size() == 1)
+  if (isWindowed && this->FrameCatalog.size() <= 1)
+  {
+    vtkErrorMacro("No frame could be found in the window of the pcap file")
+  }
+  else if (this->FrameCatalog.size() == 1)
   {
     vtkErrorMacro("The reader could not parse the pcap file")
   }
+  this->Reader->SetSequentialAccess(false);
+
+  this->ComputeNetworkTimeToDataTime();
+
+  if (positionPackets)
+  {
+    this->PositionPackets = positionPackets;
+    PositionPacketCache::Publish(this->FileName, this->PositionPackets);
+  }
+
+  // Save the catalog in the background so that opening the file is not slower
+  if (canUseFrameIndex && this->FrameCatalog.size() > 1)
+  {
+    std::string fileName = this->FileName;
+    std::vector<FrameInformation> catalog = this->FrameCatalog;
+    this->FrameIndexWriter.reset(new boost::thread([fileName, frameIndexSettings, catalog]()
+    {
+      FrameCatalogIndex::Write(fileName, frameIndexSettings, catalog);
+    }));
+  }
+
+  return this->GetNumberOfFrames();
+}
+
+//-----------------------------------------------------------------------------
+namespace
+{
+//! Part of the pcap file scanned by a single thread
+struct CatalogChunk
+{
+  //! Offset of the first record of the chunk
+  int64_t Begin = 0;
+  //! Offset right after the last record of the chunk
+  int64_t End = 0;
+  //! Frames starting in the chunk
+  std::vector<FrameInformation> Catalog;
+  //! First frames starting after the chunk, used to stitch it with the next one
+  std::vector<FrameInformation> Overflow;
+  //! Position packets of the chunk, only collected if CollectPositions is set
+  PositionPacketCache::Packets Positions;
+  bool CollectPositions = false;
+};
+
+//-----------------------------------------------------------------------------
+bool IsSameFrame(const FrameInformation& a, const FrameInformation& b)
+{
+  return std::memcmp(&a.FilePosition, &b.FilePosition, sizeof(fpos_t)) == 0
+         && a.FirstPacketDataTime == b.FirstPacketDataTime;
+}
+
+//-----------------------------------------------------------------------------
+void ScanCatalogChunk(vtkPacketFileReader* reader, vtkLidarPacketInterpreter* interpreter,
+                      CatalogChunk& chunk, bool isFirstChunk)
+{
+  // Keep scanning after the end of the chunk until enough frames have been found,
+  // so that at least one of them is also found by the next chunk
+  const size_t numberOfOverflowFrames = 3;
+
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  double lastPacketNetworkTime = 0;
+  fpos_t lastFilePosition;
+  int64_t lastOffset = reader->GetMappedOffset();
+  reader->GetFilePosition(&lastFilePosition);
+
+  while (chunk.Overflow.size() < numberOfOverflowFrames
+         && reader->NextPacket(data, dataLength, lastPacketNetworkTime))
+  {
+    if (interpreter->IsLidarPacket(data, dataLength))
+    {
+      if (isFirstChunk && chunk.Catalog.empty())
+      {
+        chunk.Catalog.push_back(interpreter->GetParserMetaData());
+      }
+      std::vector<FrameInformation>* catalog =
+        lastOffset < chunk.End ? &chunk.Catalog : &chunk.Overflow;
+      interpreter->PreProcessPacket(data, dataLength, lastFilePosition, lastPacketNetworkTime,
+                                    catalog);
+    }
+    else if (chunk.CollectPositions && lastOffset < chunk.End
+             && PositionPacketCache::IsPositionPacket(data, dataLength))
+    {
+      chunk.Positions.Append(data);
+    }
+    lastOffset = reader->GetMappedOffset();
+    reader->GetFilePosition(&lastFilePosition);
+  }
+}
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::ScanFrameCatalogInParallel(PositionPacketCache::Packets* positionPackets)
+{
+  if (this->NumberOfScanThreads == 1 || !this->Reader->IsMemoryMapped())
+  {
+    return false;
+  }
+  int numberOfThreads = this->NumberOfScanThreads;
+  if (numberOfThreads <= 0)
+  {
+    numberOfThreads = static_cast<int>(std::max(1u, boost::thread::hardware_concurrency()));
+  }
+  const int64_t fileSize = this->Reader->GetMappedFileSize();
+  const int64_t beginOffset = this->Reader->GetMappedOffset();
+  const int64_t minimumChunkSize = std::max<int64_t>(1, this->MinimumScanChunkSize);
+  const int numberOfChunks = static_cast<int>(
+    std::min(static_cast<int64_t>(numberOfThreads), (fileSize - beginOffset) / minimumChunkSize));
+  if (numberOfChunks < 2)
+  {
+    return false;
+  }
+
+  const UDPPacketSelection selection = this->GetPacketSelection();
+
+  // Each chunk but the first one get its own reader and interpreter.
+  // The chunk boundaries are moved to the next record header.
+  std::vector<CatalogChunk> chunks(numberOfChunks);
+  std::vector<std::unique_ptr<vtkPacketFileReader> > readers(numberOfChunks);
+  std::vector<vtkSmartPointer<vtkLidarPacketInterpreter> > interpreters(numberOfChunks);
+  interpreters[0] = this->Interpreter;
+  chunks[0].Begin = beginOffset;
+  for (int i = 1; i < numberOfChunks; ++i)
+  {
+    interpreters[i].TakeReference(this->Interpreter->NewPreProcessingInstance());
+    readers[i].reset(new vtkPacketFileReader);
+    if (!interpreters[i] || !readers[i]->Open(this->FileName, selection, true)
+        || !readers[i]->SynchronizeOnRecord(beginOffset + i * (fileSize - beginOffset) / numberOfChunks))
+    {
+      return false;
+    }
+    readers[i]->SetSequentialAccess(true);
+    chunks[i].Begin = readers[i]->GetMappedOffset();
+    chunks[i - 1].End = chunks[i].Begin;
+  }
+  chunks.back().End = fileSize;
+  for (auto& chunk : chunks)
+  {
+    chunk.CollectPositions = positionPackets != nullptr;
+  }
+
+  // The first chunk is scanned by this thread with the reader interpreter
+  std::vector<std::unique_ptr<boost::thread> > threads;
+  for (int i = 1; i < numberOfChunks; ++i)
+  {
+    vtkPacketFileReader* reader = readers[i].get();
+    vtkLidarPacketInterpreter* interpreter = interpreters[i];
+    CatalogChunk* chunk = &chunks[i];
+    threads.emplace_back(new boost::thread([reader, interpreter, chunk]()
+    {
+      ScanCatalogChunk(reader, interpreter, *chunk, false);
+    }));
+  }
+  ScanCatalogChunk(this->Reader, this->Interpreter, chunks[0], true);
+  for (auto& thread : threads)
+  {
+    thread->join();
+  }
+  this->UpdateProgress(0.0);
 
+  // Stitch the chunks. A chunk can miss the frames starting right after its beginning,
+  // while its frame splitting state is not established. Once both the previous and the
+  // current chunk have found the same frame, they will find the same following ones.
+  std::vector<FrameInformation> catalog = chunks[0].Catalog;
+  for (int i = 1; i < numberOfChunks; ++i)
+  {
+    const std::vector<FrameInformation>& overflow = chunks[i - 1].Overflow;
+    std::vector<FrameInformation>& current = chunks[i].Catalog;
+    size_t overflowSeam = 0, currentSeam = 0;
+    bool isSeamFound = false;
+    for (size_t j = 0; j < overflow.size() && !isSeamFound; ++j)
+    {
+      for (size_t k = 0; k < current.size() && !isSeamFound; ++k)
+      {
+        if (IsSameFrame(overflow[j], current[k]))
+        {
+          overflowSeam = j;
+          currentSeam = k;
+          isSeamFound = true;
+        }
+      }
+    }
+    if (!isSeamFound)
+    {
+      vtkWarningMacro("Could not stitch the frame catalog chunks, the pcap will be read sequentially");
+      return false;
+    }
+
+    catalog.insert(catalog.end(), overflow.begin(), overflow.begin() + overflowSeam);
+    const FrameInformation reference = overflow[overflowSeam];
+    const FrameInformation local = current[currentSeam];
+    for (auto it = current.begin() + currentSeam; it != current.end(); ++it)
+    {
+      this->Interpreter->RebaseFrameInformation(*it, reference, local);
+      catalog.push_back(*it);
+    }
+    for (auto& frameInfo : chunks[i].Overflow)
+    {
+      this->Interpreter->RebaseFrameInformation(frameInfo, reference, local);
+    }
+  }
+
+  this->FrameCatalog = std::move(catalog);
+  this->NumberOfScannedChunks = numberOfChunks;
+  // the gaps of the overflow of a chunk are also found by the next chunk
+  for (int i = 1; i < numberOfChunks; ++i)
+  {
+    this->Interpreter->StitchPacketGaps(interpreters[i]);
+  }
+  // each position packet belongs to the chunk it starts in, so there is nothing to stitch
+  for (int i = 0; positionPackets && i < numberOfChunks; ++i)
+  {
+    positionPackets->Append(chunks[i].Positions);
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::ComputeNetworkTimeToDataTime()
+{
   this->NetworkTimeToDataTime = 0.0; // default value if no frames seen
   if (this->FrameCatalog.size() > 0)
   {
@@ -81,8 +485,83 @@ int vtkLidarReader::ReadFrameInformation()
       }
       this->NetworkTimeToDataTime = ComputeMedian(diffs);
   }
+}
 
-  return this->GetNumberOfFrames();
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::IsWindowed() const
+{
+  return this->TimeWindow[1] > this->TimeWindow[0] || this->OffsetWindow[1] > this->OffsetWindow[0];
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SeekToWindow(double& begin, double& end, int64_t& endOffset)
+{
+  const bool isTimeWindow = this->TimeWindow[1] > this->TimeWindow[0];
+  const bool isOffsetWindow = this->OffsetWindow[1] > this->OffsetWindow[0];
+  const double bytesPerMegabyte = 1024. * 1024.;
+
+  if (!this->Reader->IsMemoryMapped())
+  {
+    if (isOffsetWindow)
+    {
+      vtkWarningMacro("The offset window requires the memory mapping, it is ignored");
+    }
+    if (isTimeWindow)
+    {
+      // read the time of the first packet, the packets are then read up to the window
+      fpos_t start;
+      this->Reader->GetFilePosition(&start);
+      const unsigned char* data = nullptr;
+      unsigned int dataLength = 0;
+      double firstPacketTime = 0;
+      if (this->Reader->NextPacket(data, dataLength, firstPacketTime))
+      {
+        this->Reader->SetFilePosition(&start);
+        begin = firstPacketTime + this->TimeWindow[0];
+        end = firstPacketTime + this->TimeWindow[1];
+      }
+    }
+    return;
+  }
+
+  if (isTimeWindow && this->Reader->BuildTimeIndex())
+  {
+    const int64_t firstPacketTime = this->Reader->GetTimeIndex().front().Nanoseconds;
+    const int64_t beginTime = firstPacketTime + static_cast<int64_t>(1e9 * this->TimeWindow[0]);
+    begin = 1e-9 * beginTime;
+    end = 1e-9 * firstPacketTime + this->TimeWindow[1];
+    this->Reader->SeekToTime(beginTime);
+  }
+  if (isOffsetWindow)
+  {
+    const int64_t beginOffset = static_cast<int64_t>(bytesPerMegabyte * this->OffsetWindow[0]);
+    if (beginOffset > this->Reader->GetMappedOffset())
+    {
+      this->Reader->SynchronizeOnRecord(beginOffset);
+    }
+    endOffset = static_cast<int64_t>(bytesPerMegabyte * this->OffsetWindow[1]);
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarReader::GetFrameIndexSettings()
+{
+  std::stringstream settings;
+  settings << this->Interpreter->GetClassName()
+           << ";port=" << this->LidarPort
+           << ";ignoreZeroDistances=" << this->Interpreter->GetIgnoreZeroDistances()
+           << ";ignoreEmptyFrames=" << this->Interpreter->GetIgnoreEmptyFrames();
+  return settings.str();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::WaitForFrameIndexWriter()
+{
+  if (this->FrameIndexWriter)
+  {
+    this->FrameIndexWriter->join();
+    this->FrameIndexWriter.reset();
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -128,6 +607,145 @@ void vtkLidarReader::SetTimestepInformation(vtkInformation *info)
 //-----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkLidarReader)
 
+//-----------------------------------------------------------------------------
+vtkLidarReader::vtkLidarReader()
+  : Prefetcher(new FramePrefetcher)
+{
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarReader::~vtkLidarReader()
+{
+  this->StopFramePrefetcher();
+  this->WaitForFrameIndexWriter();
+  this->Close();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SetInterpreter(vtkLidarPacketInterpreter* interpreter)
+{
+  if (interpreter != this->Interpreter)
+  {
+    this->StopFramePrefetcher();
+  }
+  this->Superclass::SetInterpreter(interpreter);
+  // the frames are kept as decoded and filtered by GetFrame, so that a change of the
+  // laser selection or of the crop does not decode them again
+  if (this->Interpreter)
+  {
+    this->Interpreter->SetApplySelectionWhileDecoding(false);
+  }
+}
+
+//-----------------------------------------------------------------------------
+vtkMTimeType vtkLidarReader::GetDecodingMTime()
+{
+  const vtkMTimeType time = this->vtkAlgorithm::GetMTime();
+  return this->Interpreter ? std::max(time, this->Interpreter->GetDecodingMTime()) : time;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SetFrameCacheSize(int size)
+{
+  if (size == this->FrameCacheSize)
+  {
+    return;
+  }
+  this->StopFramePrefetcher();
+  this->FrameCacheSize = size;
+  this->Prefetcher->Cache.SetMemoryBudget(std::max(size, 0) * 1024ul);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::StartFramePrefetcher()
+{
+  if (this->Prefetcher->Thread)
+  {
+    return;
+  }
+  this->Prefetcher->Stop = false;
+  this->Prefetcher->Thread.reset(new boost::thread(&vtkLidarReader::PrefetchFrames, this));
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::StopFramePrefetcher()
+{
+  if (this->Prefetcher->Thread)
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(this->Prefetcher->Mutex);
+      this->Prefetcher->Stop = true;
+    }
+    this->Prefetcher->Condition.notify_one();
+    this->Prefetcher->Thread->join();
+    this->Prefetcher->Thread.reset();
+  }
+  this->Prefetcher->Cache.Clear();
+  this->Prefetcher->CacheMTime = 0;
+  this->Prefetcher->Interpreter = nullptr;
+  this->Prefetcher->RequestedFrame = -1;
+  this->Prefetcher->LastFrame = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::PrefetchFrames()
+{
+  FramePrefetcher& prefetcher = *this->Prefetcher;
+  // a dedicated reader is used, as the main one is opened and closed for each frame
+  vtkPacketFileReader reader;
+  vtkMTimeType readerMTime = 0;
+
+  boost::unique_lock<boost::mutex> lock(prefetcher.Mutex);
+  unsigned int handledGeneration = prefetcher.Generation;
+  while (true)
+  {
+    prefetcher.Condition.wait(lock, [&prefetcher, handledGeneration]()
+      { return prefetcher.Stop || prefetcher.Generation != handledGeneration; });
+    if (prefetcher.Stop)
+    {
+      return;
+    }
+    handledGeneration = prefetcher.Generation;
+    // the frames which are going to be played, the skipped ones are not decoded
+    const int direction = (this->PlaybackDirection < 0 ? -1 : 1) * std::max(1, this->PlaybackStride);
+
+    for (int i = 1; i <= this->NumberOfFramesToPrefetch; ++i)
+    {
+      // stop if a new frame has been requested meanwhile, GetFrame updating the
+      // interpreter of the prefetcher when the settings have changed
+      if (prefetcher.Stop || prefetcher.Generation != handledGeneration || !prefetcher.Interpreter)
+      {
+        break;
+      }
+      const int frameNumber = prefetcher.RequestedFrame + direction * i;
+      if (frameNumber < 0 || frameNumber >= this->GetNumberOfFrames())
+      {
+        break;
+      }
+      if (prefetcher.Cache.Contains(frameNumber))
+      {
+        continue;
+      }
+
+      if (!reader.IsOpen() || readerMTime != prefetcher.CacheMTime)
+      {
+        reader.Close();
+        if (!reader.Open(this->FileName, prefetcher.PacketSelection, this->UseMemoryMapping))
+        {
+          break;
+        }
+        readerMTime = prefetcher.CacheMTime;
+      }
+      prefetcher.Cache.Insert(frameNumber, this->DecodeFrame(&reader, prefetcher.Interpreter, frameNumber));
+
+      // give the opportunity to GetFrame to take the lock between two frames
+      lock.unlock();
+      boost::this_thread::yield();
+      lock.lock();
+    }
+  }
+}
+
 //-----------------------------------------------------------------------------
 void vtkLidarReader::SetFileName(const std::string &filename)
 {
@@ -136,6 +754,7 @@ void vtkLidarReader::SetFileName(const std::string &filename)
     return;
   }
 
+  this->StopFramePrefetcher();
   this->FileName = filename;
   this->FrameCatalog.clear();
   this->Modified();
@@ -144,15 +763,230 @@ void vtkLidarReader::SetFileName(const std::string &filename)
 //-----------------------------------------------------------------------------
 vtkSmartPointer<vtkPolyData> vtkLidarReader::GetFrame(int frameNumber)
 {
-  this->Interpreter->ResetCurrentFrame();
-  this->Interpreter->ClearAllFramesAvailable();
+  if (this->FrameCacheSize <= 0)
+  {
+    // without cache, the last frame is still kept for the changes of the selection
+    FramePrefetcher& prefetcher = *this->Prefetcher;
+    const vtkMTimeType decodingMTime = this->GetDecodingMTime();
+    if (!prefetcher.LastFrame || prefetcher.LastFrameNumber != frameNumber
+        || prefetcher.LastFrameMTime != decodingMTime)
+    {
+      prefetcher.LastFrame = this->DecodeFrame(this->Reader, frameNumber);
+      prefetcher.LastFrameNumber = frameNumber;
+      prefetcher.LastFrameMTime = decodingMTime;
+    }
+    return this->Interpreter->ApplySelection(prefetcher.LastFrame);
+  }
 
-  if (!this->Reader)
+  this->StartFramePrefetcher();
+  vtkSmartPointer<vtkPolyData> frame;
+  {
+    boost::lock_guard<boost::mutex> lock(this->Prefetcher->Mutex);
+    // the cached frames stay valid when only the selection changes
+    const vtkMTimeType decodingMTime = this->GetDecodingMTime();
+    if (this->Prefetcher->CacheMTime != decodingMTime)
+    {
+      this->Prefetcher->Cache.Clear();
+      this->Prefetcher->CacheMTime = decodingMTime;
+      // copied here, as DecodeFrames does, since only the pipeline modifies the interpreter
+      this->Prefetcher->Interpreter.TakeReference(this->Interpreter->NewDecodingInstance());
+      this->Prefetcher->PacketSelection = this->GetPacketSelection();
+    }
+    frame = this->Prefetcher->Cache.Get(frameNumber);
+    if (!frame)
+    {
+      frame = this->DecodeFrame(this->Reader, frameNumber);
+      this->Prefetcher->Cache.Insert(frameNumber, frame);
+    }
+    this->Prefetcher->RequestedFrame = frameNumber;
+    this->Prefetcher->Generation++;
+  }
+  this->Prefetcher->Condition.notify_one();
+  return this->Interpreter->ApplySelection(frame);
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::DecodeFrames(int startFrame, int endFrame, const FrameCallback& callback,
+                                  int numberOfThreads)
+{
+  std::vector<int> frameNumbers;
+  for (int frameNumber = std::max(startFrame, 0);
+       frameNumber <= std::min(endFrame, this->GetNumberOfFrames() - 1); ++frameNumber)
+  {
+    frameNumbers.push_back(frameNumber);
+  }
+  return this->DecodeFrames(frameNumbers, callback, numberOfThreads);
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::DecodeFrames(const std::vector<int>& requestedFrames, const FrameCallback& callback,
+                                  int numberOfThreads)
+{
+  // The catalog is in the order of the file, so the sorted frames are decoded in a single
+  // forward sweep, each one from the catalog position of its first packet: the packets of
+  // the frames which are not requested are never read
+  std::vector<int> frameNumbers;
+  frameNumbers.reserve(requestedFrames.size());
+  for (int frameNumber : requestedFrames)
+  {
+    if (frameNumber >= 0 && frameNumber < this->GetNumberOfFrames())
+    {
+      frameNumbers.push_back(frameNumber);
+    }
+  }
+  std::sort(frameNumbers.begin(), frameNumbers.end());
+  frameNumbers.erase(std::unique(frameNumbers.begin(), frameNumbers.end()), frameNumbers.end());
+  const int numberOfFrames = static_cast<int>(frameNumbers.size());
+  if (numberOfFrames == 0)
+  {
+    return true;
+  }
+  if (numberOfThreads <= 0)
+  {
+    numberOfThreads = static_cast<int>(std::max(1u, boost::thread::hardware_concurrency()));
+  }
+  numberOfThreads = std::min(numberOfThreads, numberOfFrames);
+
+  // Each thread decodes with its own copy of the interpreter and its own reader,
+  // so that nothing but the frame catalog, which is only read, is shared
+  std::vector<std::unique_ptr<vtkPacketFileReader> > readers;
+  std::vector<vtkSmartPointer<vtkLidarPacketInterpreter> > interpreters;
+  for (int i = 0; i < numberOfThreads && numberOfThreads > 1; ++i)
+  {
+    vtkSmartPointer<vtkLidarPacketInterpreter> interpreter;
+    interpreter.TakeReference(this->Interpreter->NewDecodingInstance());
+    std::unique_ptr<vtkPacketFileReader> reader(new vtkPacketFileReader);
+    if (!interpreter || !reader->Open(this->FileName, this->GetPacketSelection(), this->UseMemoryMapping))
+    {
+      readers.clear();
+      interpreters.clear();
+      break;
+    }
+    readers.push_back(std::move(reader));
+    interpreters.push_back(interpreter);
+  }
+
+  if (interpreters.empty())
+  {
+    for (int frameNumber : frameNumbers)
+    {
+      if (!callback(frameNumber, this->GetFrame(frameNumber)))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // The frames are given to the threads in turn. A thread does not decode a frame
+  // too far ahead of the one the callback is waiting for, to bound the memory used.
+  const int lookahead = 2 * numberOfThreads;
+  boost::mutex mutex;
+  boost::condition_variable condition;
+  std::map<int, vtkSmartPointer<vtkPolyData> > decodedFrames;
+  int nextIndexToDeliver = 0;
+  bool stop = false;
+
+  std::vector<std::unique_ptr<boost::thread> > threads;
+  for (int i = 0; i < numberOfThreads; ++i)
+  {
+    vtkPacketFileReader* reader = readers[i].get();
+    vtkLidarPacketInterpreter* interpreter = interpreters[i];
+    threads.emplace_back(new boost::thread([&, reader, interpreter, i]()
+    {
+      // the frames are counted by their index in frameNumbers
+      for (int index = i; index < numberOfFrames; index += numberOfThreads)
+      {
+        {
+          boost::unique_lock<boost::mutex> lock(mutex);
+          condition.wait(lock, [&]()
+            { return stop || index < nextIndexToDeliver + lookahead; });
+          if (stop)
+          {
+            return;
+          }
+        }
+        vtkSmartPointer<vtkPolyData> frame = this->DecodeFrame(reader, interpreter, frameNumbers[index]);
+        {
+          boost::lock_guard<boost::mutex> lock(mutex);
+          decodedFrames[index] = frame;
+        }
+        condition.notify_all();
+      }
+    }));
+  }
+
+  bool isCompleted = true;
+  for (int index = 0; index < numberOfFrames; ++index)
+  {
+    vtkSmartPointer<vtkPolyData> frame;
+    {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      condition.wait(lock, [&]() { return decodedFrames.count(index) != 0; });
+      frame = decodedFrames[index];
+      decodedFrames.erase(index);
+      nextIndexToDeliver = index + 1;
+    }
+    condition.notify_all();
+
+    if (!callback(frameNumbers[index], frame))
+    {
+      isCompleted = false;
+      break;
+    }
+  }
+
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    stop = true;
+  }
+  condition.notify_all();
+  for (auto& thread : threads)
+  {
+    thread->join();
+  }
+  return isCompleted;
+}
+
+//-----------------------------------------------------------------------------
+UDPPacketSelection vtkLidarReader::GetPacketSelection() const
+{
+  UDPPacketSelection selection;
+  if (this->LidarPort != -1)
+  {
+    selection.Ports.push_back(this->LidarPort);
+  }
+  if (this->Interpreter)
+  {
+    selection.PayloadSizes = this->Interpreter->GetLidarPacketSizes();
+  }
+  if (!selection.PayloadSizes.empty() && this->CollectPositionPackets && this->LidarPort == -1)
+  {
+    selection.PayloadSizes.push_back(PositionPacketCache::PacketSize);
+  }
+  return selection;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkLidarReader::DecodeFrame(vtkPacketFileReader* reader, int frameNumber)
+{
+  return this->DecodeFrame(reader, this->Interpreter, frameNumber);
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkLidarReader::DecodeFrame(vtkPacketFileReader* reader,
+                                                         vtkLidarPacketInterpreter* interpreter,
+                                                         int frameNumber)
+{
+  interpreter->ResetCurrentFrame();
+  interpreter->ClearAllFramesAvailable();
+
+  if (!reader)
   {
     vtkErrorMacro("GetFrame() called but packet file reader is not open.");
     return 0;
   }
-  if (!this->Interpreter->GetIsCalibrated())
+  if (!interpreter->GetIsCalibrated())
   {
     vtkErrorMacro("Calibration data has not been loaded.");
     return 0;
@@ -164,29 +998,239 @@ vtkSmartPointer<vtkPolyData> vtkLidarReader::GetFrame(int frameNumber)
 
   // Update the interpreter meta data according to the requested frame
   FrameInformation currInfo= this->FrameCatalog[frameNumber];
-  this->Interpreter->SetParserMetaData(this->FrameCatalog[frameNumber]);
-  this->Reader->SetFilePosition(&currInfo.FilePosition);
+  interpreter->SetParserMetaData(this->FrameCatalog[frameNumber]);
+  reader->SetFilePosition(&currInfo.FilePosition);
 
-  while (this->Reader->NextPacket(data, dataLength, timeSinceStart))
+  // The lidar packets are copied and given by batch to the interpreter,
+  // as the data returned by the reader is only valid until the next packet
+  const size_t batchSize = 32;
+  std::vector<unsigned char> batchData;
+  std::vector<unsigned int> batchLengths;
+  std::vector<RawPacket> batch;
+  bool isEndOfFile = false;
+  while (!isEndOfFile)
   {
-    // If the current packet is not a lidar packet,
-    // skip it and update the file position
-    if (!this->Interpreter->IsLidarPacket(data, dataLength))
+    batchData.clear();
+    batchLengths.clear();
+    while (batchLengths.size() < batchSize)
     {
-      continue;
+      if (!reader->NextPacket(data, dataLength, timeSinceStart))
+      {
+        isEndOfFile = true;
+        break;
+      }
+      // If the current packet is not a lidar packet, skip it
+      if (interpreter->IsLidarPacket(data, dataLength))
+      {
+        batchData.insert(batchData.end(), data, data + dataLength);
+        batchLengths.push_back(dataLength);
+      }
     }
 
-    // Process the lidar packet and check
+    batch.resize(batchLengths.size());
+    size_t offset = 0;
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+      batch[i].Data = batchData.data() + offset;
+      batch[i].Length = batchLengths[i];
+      offset += batchLengths[i];
+    }
+
+    // Process the lidar packets and check
     // if the required frame is ready
-    this->Interpreter->ProcessPacket(data, dataLength);
-    if (this->Interpreter->IsNewFrameReady())
+    interpreter->ProcessPackets(batch.data(), batch.size());
+    if (interpreter->IsNewFrameReady())
     {
-      return this->Interpreter->GetLastFrameAvailable();
+      return interpreter->GetLastFrameAvailable();
     }
   }
 
-  this->Interpreter->SplitFrame(true);
-  return this->Interpreter->GetLastFrameAvailable();
+  interpreter->SplitFrame(true);
+  return interpreter->GetLastFrameAvailable();
+}
+
+//-----------------------------------------------------------------------------
+std::vector<int> vtkLidarReader::GetFramesToSave(int startFrame, int endFrame, int frameStride) const
+{
+  // Ensure that frame indexes match between what is effectively shown
+  // and what is saved, as in SaveFrame
+  const int shownFrameOffset = (!this->ShowFirstAndLastFrame && this->FrameCatalog.size() >= 3) ? 1 : 0;
+  std::vector<int> frameNumbers;
+  for (int frame = startFrame; frame <= endFrame; frame += std::max(1, frameStride))
+  {
+    frameNumbers.push_back(frame + shownFrameOffset);
+  }
+  return frameNumbers;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::SaveFramesToArchive(int startFrame, int endFrame, const std::string& filename,
+                                         int compressionLevel, double positionTolerance, int frameStride)
+{
+  FrameArchiveWriter writer;
+  if (!writer.Open(filename, compressionLevel, positionTolerance))
+  {
+    vtkErrorMacro("Failed to open frame archive for writing: " << filename);
+    return false;
+  }
+
+  // the frames keep the time steps of this reader
+  const std::vector<int> frameNumbers = this->GetFramesToSave(startFrame, endFrame, frameStride);
+  const double timeOffset = this->Interpreter->GetTimeOffset();
+  std::vector<FrameArchiveColumn> columns;
+  size_t savedFrames = 0;
+  this->Open();
+  bool isWritten = this->DecodeFrames(frameNumbers,
+    [this, &writer, &columns, &savedFrames, &frameNumbers, timeOffset](int frameNumber, vtkPolyData* frame)
+    {
+      if (!frame)
+      {
+        return false;
+      }
+      vtkLidarFrameArchiveReader::GetColumns(frame, columns);
+      this->UpdateProgress(static_cast<double>(savedFrames++) / frameNumbers.size());
+      return writer.WriteFrame(this->FrameCatalog[frameNumber].FirstPacketNetworkTime + timeOffset,
+                               frame->GetNumberOfPoints(), columns);
+    });
+  this->Close();
+  isWritten = writer.Close() && isWritten;
+  if (!isWritten)
+  {
+    vtkErrorMacro("Failed to write the frame archive: " << filename);
+  }
+  return isWritten;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::SaveFramesToCSV(int startFrame, int endFrame, const std::string& filename,
+                                     int compressionLevel, int frameStride)
+{
+  const std::string prefix = filename.substr(0, filename.rfind(".csv"));
+  const std::string extension = compressionLevel > 0 ? ".csv.gz" : ".csv";
+
+  // the files are named after the frames as they are shown
+  const int shownFrameOffset = (!this->ShowFirstAndLastFrame && this->FrameCatalog.size() >= 3) ? 1 : 0;
+  const std::vector<int> frameNumbers = this->GetFramesToSave(startFrame, endFrame, frameStride);
+
+  // the frames are decoded in parallel, and the rows of each frame formatted in parallel
+  FrameCSVWriter writer;
+  writer.SetCompressionLevel(compressionLevel);
+  std::vector<FrameArchiveColumn> columns;
+  size_t savedFrames = 0;
+  this->Open();
+  bool isWritten = this->DecodeFrames(frameNumbers,
+    [this, &writer, &columns, &prefix, &extension, &savedFrames, &frameNumbers, shownFrameOffset]
+    (int frameNumber, vtkPolyData* frame)
+    {
+      if (!frame)
+      {
+        return false;
+      }
+      char frameName[32];
+      std::snprintf(frameName, sizeof(frameName), " (Frame %04d)", frameNumber - shownFrameOffset);
+      const std::string frameFileName = prefix + frameName + extension;
+      vtkLidarFrameArchiveReader::GetColumns(frame, columns);
+      this->UpdateProgress(static_cast<double>(savedFrames++) / frameNumbers.size());
+      if (!writer.WriteFrame(frameFileName, frame->GetNumberOfPoints(), columns))
+      {
+        vtkErrorMacro("Failed to write the csv file: " << frameFileName);
+        return false;
+      }
+      return true;
+    });
+  this->Close();
+  return isWritten;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::SaveFramesToTensors(int startFrame, int endFrame, const std::string& filename,
+                                         int width, int frameStride)
+{
+  vtkTable* calibration = this->Interpreter->GetCalibrationTable();
+  vtkDataArray* verticalCorrection = calibration ? vtkDataArray::SafeDownCast(
+    calibration->GetColumnByName("verticalCorrection")) : nullptr;
+  if (!verticalCorrection || verticalCorrection->GetNumberOfTuples() == 0)
+  {
+    vtkErrorMacro("The calibration does not provide the vertical correction of the lasers");
+    return false;
+  }
+  std::vector<double> verticalCorrections(verticalCorrection->GetNumberOfTuples());
+  for (vtkIdType laser = 0; laser < verticalCorrection->GetNumberOfTuples(); ++laser)
+  {
+    verticalCorrections[laser] = verticalCorrection->GetTuple1(laser);
+  }
+
+  FrameTensorWriter writer;
+  if (!writer.Open(filename, FrameTensorWriter::SortLasersVertically(verticalCorrections), width))
+  {
+    vtkErrorMacro("Failed to open the tensor file for writing: " << filename);
+    return false;
+  }
+
+  // the frames are decoded in parallel, and projected in order by the calling thread
+  const std::vector<int> frameNumbers = this->GetFramesToSave(startFrame, endFrame, frameStride);
+  std::vector<FrameArchiveColumn> columns;
+  size_t savedFrames = 0;
+  this->Open();
+  bool isWritten = this->DecodeFrames(frameNumbers,
+    [this, &writer, &columns, &savedFrames, &frameNumbers](int, vtkPolyData* frame)
+    {
+      if (!frame)
+      {
+        return false;
+      }
+      vtkLidarFrameArchiveReader::GetColumns(frame, columns);
+      this->UpdateProgress(static_cast<double>(savedFrames++) / frameNumbers.size());
+      return writer.WriteFrame(frame->GetNumberOfPoints(), columns);
+    });
+  this->Close();
+  isWritten = writer.Close() && isWritten;
+  if (!isWritten)
+  {
+    vtkErrorMacro("Failed to write the tensor file: " << filename);
+  }
+  return isWritten;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::SaveFramesToWeb(int startFrame, int endFrame, const std::string& directory,
+                                     double positionTolerance, double tileSize, int frameStride)
+{
+  FrameWebWriter writer;
+  writer.SetPositionTolerance(positionTolerance);
+  writer.SetTileSize(tileSize);
+  if (!writer.Open(directory))
+  {
+    vtkErrorMacro("Failed to open the web export directory, or invalid tolerance or tile size: "
+                  << directory);
+    return false;
+  }
+
+  // the frames are decoded in parallel, and the tiles of each frame encoded in parallel
+  const std::vector<int> frameNumbers = this->GetFramesToSave(startFrame, endFrame, frameStride);
+  const double timeOffset = this->Interpreter->GetTimeOffset();
+  std::vector<FrameArchiveColumn> columns;
+  size_t savedFrames = 0;
+  this->Open();
+  bool isWritten = this->DecodeFrames(frameNumbers,
+    [this, &writer, &columns, &savedFrames, &frameNumbers, timeOffset](int frameNumber, vtkPolyData* frame)
+    {
+      if (!frame)
+      {
+        return false;
+      }
+      vtkLidarFrameArchiveReader::GetColumns(frame, columns);
+      this->UpdateProgress(static_cast<double>(savedFrames++) / frameNumbers.size());
+      return writer.WriteFrame(this->FrameCatalog[frameNumber].FirstPacketNetworkTime + timeOffset,
+                               frame->GetNumberOfPoints(), columns);
+    });
+  this->Close();
+  isWritten = writer.Close() && isWritten;
+  if (!isWritten)
+  {
+    vtkErrorMacro("Failed to write the web export: " << directory);
+  }
+  return isWritten;
 }
 
 //-----------------------------------------------------------------------------
@@ -233,12 +1277,7 @@ void vtkLidarReader::Open()
   this->Close();
   this->Reader = new vtkPacketFileReader;
 
-  std::string filterPCAP = "udp";
-  if (this->LidarPort != -1)
-  {
-    filterPCAP += " port " + std::to_string(this->LidarPort);
-  }
-  if (!this->Reader->Open(this->FileName, filterPCAP.c_str()))
+  if (!this->Reader->Open(this->FileName, this->GetPacketSelection(), this->UseMemoryMapping))
   {
     vtkErrorMacro(<< "Failed to open packet file: " << this->FileName << "!\n"
                                                  << this->Reader->GetLastError())
@@ -254,22 +1293,41 @@ void vtkLidarReader::Close()
 }
 
 //-----------------------------------------------------------------------------
-void vtkLidarReader::SaveFrame(int startFrame, int endFrame, const std::string &filename)
+vtkLidarReader* vtkLidarReader::NewExportInstance()
 {
-  if (!this->Reader)
+  if (!this->Interpreter)
   {
-    vtkErrorMacro("SaveFrame() called but packet file reader is not open.")
-    return;
+    return nullptr;
+  }
+  vtkSmartPointer<vtkLidarPacketInterpreter> interpreter;
+  interpreter.TakeReference(this->Interpreter->NewDecodingInstance());
+  if (!interpreter)
+  {
+    return nullptr;
   }
 
-  vtkPacketFileWriter writer;
-  if (!writer.Open(filename))
+  // only what is needed to decode and save the frames is copied, the frame cache
+  // stays disabled
+  vtkLidarReader* reader = vtkLidarReader::New();
+  reader->SetInterpreter(interpreter);
+  reader->FileName = this->FileName;
+  reader->FrameCatalog = this->FrameCatalog;
+  reader->NetworkTimeToDataTime = this->NetworkTimeToDataTime;
+  reader->ShowFirstAndLastFrame = this->ShowFirstAndLastFrame;
+  reader->UseMemoryMapping = this->UseMemoryMapping;
+  reader->LidarPort = this->LidarPort;
+  return reader;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SaveFrame(int startFrame, int endFrame, const std::string &filename)
+{
+  if (!this->Reader)
   {
-    vtkErrorMacro("Failed to open packet file for writing: " << filename);
+    vtkErrorMacro("SaveFrame() called but packet file reader is not open.")
     return;
   }
 
-
   // Ensure that frame indexes match between what is effectively shown
   // and what is present inside the PCAP
   size_t numberOfTimesteps = this->FrameCatalog.size();
@@ -279,6 +1337,18 @@ void vtkLidarReader::SaveFrame(int startFrame, int endFrame, const std::string &
     endFrame++;
   }
 
+  if (this->SaveFrameByteRange(startFrame, endFrame, filename))
+  {
+    return;
+  }
+
+  vtkPacketFileWriter writer;
+  if (!writer.Open(filename))
+  {
+    vtkErrorMacro("Failed to open packet file for writing: " << filename);
+    return;
+  }
+
   // because fpos_t is plateform specific and should not be used for comparaison
   // it's not possible to simply interate from FiePositions[start] to FilePositions[end]
   // we need to detect new frame in the pcap directly once again
@@ -311,6 +1381,9 @@ void vtkLidarReader::SaveFrame(int startFrame, int endFrame, const std::string &
 
   this->Reader->SetFilePosition(&this->FrameCatalog[startFrame].FilePosition);
 
+  // The interpreter is shared with the frame prefetcher
+  boost::lock_guard<boost::mutex> lock(this->Prefetcher->Mutex);
+
   // Since the PreProcessPacket method of the interpreter can change
   // its internal state, we store and then restore the contained meta
   // data
@@ -328,7 +1401,14 @@ void vtkLidarReader::SaveFrame(int startFrame, int endFrame, const std::string &
       // we need to count frames and some are split in multiple packets
       bool isNewFrame = this->Interpreter->PreProcessPacket(data, dataLength);
       currentFrame += static_cast<int>(isNewFrame);
-      this->UpdateProgress(0.0);
+      if (isNewFrame)
+      {
+        this->UpdateProgress(static_cast<double>(currentFrame - startFrame) / (endFrame - startFrame + 2));
+        if (this->GetAbortExecute())
+        {
+          break;
+        }
+      }
     }
   }
   writer.Close();
@@ -336,17 +1416,134 @@ void vtkLidarReader::SaveFrame(int startFrame, int endFrame, const std::string &
   this->Interpreter->SetParserMetaData(storedMetaData);
 }
 
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::SaveFrameByteRange(int startFrame, int endFrame, const std::string& filename)
+{
+#ifdef _MSC_VER
+  return false;
+#else
+  if (startFrame < 0 || startFrame >= static_cast<int>(this->FrameCatalog.size()) || endFrame < startFrame)
+  {
+    return false;
+  }
+
+  // Only the classic pcap format has its records stored one after the other
+  int input = open(this->FileName.c_str(), O_RDONLY);
+  if (input < 0)
+  {
+    return false;
+  }
+  unsigned char fileHeader[24];
+  struct stat fileStat;
+  uint32_t magic = 0;
+  if (pread(input, fileHeader, sizeof(fileHeader), 0) == sizeof(fileHeader))
+  {
+    std::memcpy(&magic, fileHeader, sizeof(magic));
+  }
+  const bool isSwapped = (magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1);
+  if ((!isSwapped && magic != 0xa1b2c3d4 && magic != 0xa1b23c4d) || fstat(input, &fileStat) != 0)
+  {
+    close(input);
+    return false;
+  }
+
+  // The packets saved by the decoding path are the ones from the packet where startFrame
+  // begins to the one where endFrame + 1 begins, see SaveFrame, which are copied as is.
+  const int64_t begin = FileOffset(this->FrameCatalog[startFrame].FilePosition);
+  int64_t end = static_cast<int64_t>(fileStat.st_size);
+  if (endFrame + 1 < static_cast<int>(this->FrameCatalog.size()))
+  {
+    const int64_t last = FileOffset(this->FrameCatalog[endFrame + 1].FilePosition);
+    PcapRecordHeader record;
+    if (pread(input, &record, sizeof(record), last) != sizeof(record))
+    {
+      close(input);
+      return false;
+    }
+    const uint32_t capturedLength = isSwapped ?
+      vtkPacketFileReader::SwapBytes(record.CapturedLength) : record.CapturedLength;
+    end = std::min(end, last + static_cast<int64_t>(sizeof(record)) + capturedLength);
+  }
+  if (begin < static_cast<int64_t>(sizeof(fileHeader)) || end <= begin)
+  {
+    close(input);
+    return false;
+  }
+
+  int output = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (output < 0)
+  {
+    close(input);
+    vtkErrorMacro("Failed to open packet file for writing: " << filename);
+    return true;
+  }
+
+  // Copy the file header then the records in large chunks, the kernel copies
+  // them without going through the user space when the file systems allow it
+  const size_t chunkSize = 64 << 20;
+  bool isCopied = (write(output, fileHeader, sizeof(fileHeader)) == sizeof(fileHeader));
+  for (int64_t offset = begin; isCopied && offset < end;)
+  {
+    const ssize_t copied = CopyFileRange(input, output, offset,
+      static_cast<size_t>(std::min(static_cast<int64_t>(chunkSize), end - offset)));
+    isCopied = (copied > 0);
+    offset += std::max(copied, static_cast<ssize_t>(0));
+    this->UpdateProgress(static_cast<double>(offset - begin) / (end - begin));
+    if (this->GetAbortExecute())
+    {
+      break;
+    }
+  }
+  close(input);
+  close(output);
+  if (!isCopied)
+  {
+    // let the decoding path write the file
+    std::remove(filename.c_str());
+    return false;
+  }
+  return true;
+#endif
+}
+
 //-----------------------------------------------------------------------------
 void vtkLidarReader::SetLidarPort(int _arg)
 {
   if (this->LidarPort != _arg)
   {
+    this->StopFramePrefetcher();
     this->LidarPort = _arg;
     this->FrameCatalog.clear();
     this->Modified();
   }
 }
 
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SetTimeWindow(double begin, double end)
+{
+  if (this->TimeWindow[0] != begin || this->TimeWindow[1] != end)
+  {
+    this->StopFramePrefetcher();
+    this->TimeWindow[0] = begin;
+    this->TimeWindow[1] = end;
+    this->FrameCatalog.clear();
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SetOffsetWindow(double begin, double end)
+{
+  if (this->OffsetWindow[0] != begin || this->OffsetWindow[1] != end)
+  {
+    this->StopFramePrefetcher();
+    this->OffsetWindow[0] = begin;
+    this->OffsetWindow[1] = end;
+    this->FrameCatalog.clear();
+    this->Modified();
+  }
+}
+
 //-----------------------------------------------------------------------------
 int vtkLidarReader::RequestData(vtkInformation *vtkNotUsed(request),
                                 vtkInformationVector **vtkNotUsed(inputVector),
@@ -419,6 +1616,14 @@ int vtkLidarReader::RequestData(vtkInformation *vtkNotUsed(request),
   }
   this->LastFrameProcessed = frameRequested;
 
+  // under MPI, each process decodes the lasers of its piece
+  if (info->Has(vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_PIECES()))
+  {
+    boost::lock_guard<boost::mutex> lock(this->Prefetcher->Mutex);
+    this->Interpreter->SetPiece(info->Get(vtkStreamingDemandDrivenPipeline::UPDATE_PIECE_NUMBER()),
+      info->Get(vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_PIECES()));
+  }
+
   //! @todo we should no open the pcap file everytime a frame is requested !!!
   this->Open();
   output->ShallowCopy(this->GetFrame(frameRequested));
@@ -432,6 +1637,8 @@ int vtkLidarReader::RequestInformation(vtkInformation* request,
                                        vtkInformationVector** inputVector,
                                        vtkInformationVector* outputVector)
 {
+  // the calibration may be reloaded by the superclass
+  this->StopFramePrefetcher();
   this->Superclass::RequestInformation(request, inputVector, outputVector);
   if (this->Interpreter && !this->FileName.empty() && this->FrameCatalog.empty())
   {
@@ -439,5 +1646,6 @@ int vtkLidarReader::RequestInformation(vtkInformation* request,
   }
   vtkInformation* info = outputVector->GetInformationObject(0);
   this->SetTimestepInformation(info);
+  info->Set(vtkAlgorithm::CAN_HANDLE_PIECE_REQUEST(), 1);
   return 1;
 }
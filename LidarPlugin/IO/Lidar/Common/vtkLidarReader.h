@@ -16,9 +16,18 @@
 #ifndef VTKLIDARREADER_H
 #define VTKLIDARREADER_H
 
+#include <algorithm>
+#include <functional>
+#include <memory>
 #include "vtkLidarProvider.h"
+#include "PositionPacketCache.h"
 
 class vtkPacketFileReader;
+struct UDPPacketSelection;
+namespace boost
+{
+class thread;
+}
 
 //! @todo a decition should be made if the opening/closing of the pcap should be handle by
 //! the class itself of the class user. Currently this is not clear
@@ -47,6 +56,39 @@ public:
    */
   virtual vtkSmartPointer<vtkPolyData> GetFrame(int frameNumber);
 
+#ifndef __VTK_WRAP__
+  /**
+   * @brief FrameCallback receives a decoded frame and its number, returns false to stop
+   */
+  typedef std::function<bool(int, vtkPolyData*)> FrameCallback;
+
+  /**
+   * @brief DecodeFrames decode a range of frames, as GetFrame, with several threads and
+   * give them in order to a callback, which is called from the calling thread.
+   * Each thread gets its own copy of the interpreter, see
+   * vtkLidarPacketInterpreter::NewDecodingInstance, and its own file reader.
+   * The frames are decoded with GetFrame if the interpreter can not be copied.
+   * @param startFrame first frame to decode
+   * @param endFrame last frame to decode, this frame is included
+   * @param callback called with each frame in order, decoding stops if it returns false
+   * @param numberOfThreads 0 to use all the cores
+   * @return false if the decoding has been stopped by the callback or has failed
+   */
+  virtual bool DecodeFrames(int startFrame, int endFrame, const FrameCallback& callback,
+                            int numberOfThreads = 0);
+
+  /**
+   * @brief DecodeFrames same as above for any set of frames, for instance every n-th frame.
+   * The frames are sorted and decoded in a single forward pass through the file, each one
+   * from its position in the frame catalog, so that the cost only depends on the number of
+   * frames decoded and not on the frames in between.
+   * @param frameNumbers frames to decode, in any order, the duplicates and the frames out of
+   * range being ignored. The callback gets them in increasing order
+   */
+  virtual bool DecodeFrames(const std::vector<int>& frameNumbers, const FrameCallback& callback,
+                            int numberOfThreads = 0);
+#endif
+
   /**
    * @brief GetFrameForPacketTime returns the requested frame
    * @param packetTime udp packet time requested
@@ -90,21 +132,148 @@ public:
   /**
    * @brief SaveFrame save the packet corresponding to the desired frames in a pcap file.
    * Because we are saving network packet, part of previous and/or next frames could be included in generated the pcap
+   * For a classic pcap file, the records between the catalog positions of the frames are copied as is
+   * in large chunks, including the records filtered out by the reader, otherwise the packets are read
+   * and written one by one.
+   * The progress is reported as ProgressEvent, and the saving stops when AbortExecute is set.
    * @param startFrame first frame to record
    * @param endFrame last frame to record, this frame is included
    * @param filename where to save the generate pcap file
    */
   virtual void SaveFrame(int startFrame, int endFrame, const std::string& filename);
 
+  /**
+   * @brief NewExportInstance create a new reader on the same file, with a copy of the
+   * frame catalog and of the interpreter, see vtkLidarPacketInterpreter::NewDecodingInstance.
+   * It shares nothing with this reader, so that it can save frames on another thread
+   * while this one keeps being used.
+   * @return nullptr if the interpreter can not be copied, the caller owns the reader
+   */
+  virtual vtkLidarReader* NewExportInstance();
+
+  /**
+   * @brief SaveFramesToArchive decode the desired frames and save them in a frame archive,
+   * which can be read later by vtkLidarFrameArchiveReader without decoding the packets again.
+   * The frames are numbered as in SaveFrame.
+   * @param startFrame first frame to save
+   * @param endFrame last frame to save, this frame is included
+   * @param filename the archive to write
+   * @param compressionLevel 0 to store the arrays raw, up to 9 for the smallest archive
+   * @param positionTolerance maximal error in meters on the coordinates of the points, 0 to
+   * store them exactly. With a tolerance, the points of each frame are reordered, see
+   * FrameEncoder::SetPositionTolerance
+   * @param frameStride only save one frame every frameStride frames from startFrame
+   * @return false if the archive could not be written
+   */
+  virtual bool SaveFramesToArchive(int startFrame, int endFrame, const std::string& filename,
+                                   int compressionLevel = 0, double positionTolerance = 0.0,
+                                   int frameStride = 1);
+
+  /**
+   * @brief SaveFramesToCSV decode the desired frames and save each of them in a csv file,
+   * see FrameCSVWriter. The frame n is saved in "<filename without extension> (Frame n).csv",
+   * n being written with 4 digits at least, followed by ".gz" when compressed.
+   * The frames are numbered as in SaveFrame.
+   * @param startFrame first frame to save
+   * @param endFrame last frame to save, this frame is included
+   * @param filename name of the csv file of a frame, from which the names of the files are made
+   * @param compressionLevel 0 to write plain text, up to 9 for the smallest gzip files
+   * @param frameStride only save one frame every frameStride frames from startFrame
+   * @return false if a file could not be written
+   */
+  virtual bool SaveFramesToCSV(int startFrame, int endFrame, const std::string& filename,
+                               int compressionLevel = 0, int frameStride = 1);
+
+  /**
+   * @brief SaveFramesToTensors decode the desired frames and save their raw signal images,
+   * range, intensity and coordinates per laser and azimuth bin, in a NPY file, see
+   * FrameTensorWriter. The rows are the lasers sorted by the vertical correction of the
+   * calibration. The frames are numbered as in SaveFrame.
+   * @param startFrame first frame to save
+   * @param endFrame last frame to save, this frame is included
+   * @param filename the NPY file to write
+   * @param width number of azimuth bins of the images
+   * @param frameStride only save one frame every frameStride frames from startFrame
+   * @return false if the file could not be written
+   */
+  virtual bool SaveFramesToTensors(int startFrame, int endFrame, const std::string& filename,
+                                   int width = 1024, int frameStride = 1);
+
+  /**
+   * @brief SaveFramesToWeb decode the desired frames and save them in a directory for a
+   * web viewer, quantized and split in tiles with levels of detail, see FrameWebWriter.
+   * The frames are decoded in parallel and the tiles of each frame encoded in parallel.
+   * The frames are numbered as in SaveFrame.
+   * @param startFrame first frame to save
+   * @param endFrame last frame to save, this frame is included
+   * @param directory the directory of the frame files and of their manifest
+   * @param positionTolerance maximal error in meters on the coordinates of the points
+   * @param tileSize size of the edges of the tiles, in meters
+   * @param frameStride only save one frame every frameStride frames from startFrame
+   * @return false if a file could not be written
+   */
+  virtual bool SaveFramesToWeb(int startFrame, int endFrame, const std::string& directory,
+                               double positionTolerance = 0.005, double tileSize = 16.0,
+                               int frameStride = 1);
+
   vtkGetMacro(ShowFirstAndLastFrame, bool)
   vtkSetMacro(ShowFirstAndLastFrame, bool)
 
+  vtkGetMacro(UseFrameIndexCache, bool)
+  vtkSetMacro(UseFrameIndexCache, bool)
+
+  vtkGetMacro(UseMemoryMapping, bool)
+  vtkSetMacro(UseMemoryMapping, bool)
+
+  vtkGetMacro(NumberOfScanThreads, int)
+  vtkSetMacro(NumberOfScanThreads, int)
+
+  vtkGetMacro(MinimumScanChunkSize, int64_t)
+  vtkSetMacro(MinimumScanChunkSize, int64_t)
+
+  //! Number of chunks of the pcap scanned in parallel when the frame catalog was
+  //! last built, 1 if the pcap was scanned sequentially
+  vtkGetMacro(NumberOfScannedChunks, int)
+
+  vtkGetMacro(CollectPositionPackets, bool)
+  vtkSetMacro(CollectPositionPackets, bool)
+
+  //! @copydoc TimeWindow
+  vtkGetVector2Macro(TimeWindow, double)
+  virtual void SetTimeWindow(double begin, double end);
+
+  //! @copydoc OffsetWindow
+  vtkGetVector2Macro(OffsetWindow, double)
+  virtual void SetOffsetWindow(double begin, double end);
+
+  vtkGetMacro(FrameCacheSize, int)
+  virtual void SetFrameCacheSize(int size);
+
+  vtkGetMacro(NumberOfFramesToPrefetch, int)
+  vtkSetMacro(NumberOfFramesToPrefetch, int)
+
+  /**
+   * @copydoc PlaybackDirection
+   * This does not modify the reader, as the output does not depend on it.
+   */
+  vtkGetMacro(PlaybackDirection, int)
+  virtual void SetPlaybackDirection(int direction) { this->PlaybackDirection = direction; }
+
+  /**
+   * @copydoc PlaybackStride
+   * This does not modify the reader, as the output does not depend on it.
+   */
+  vtkGetMacro(PlaybackStride, int)
+  virtual void SetPlaybackStride(int stride) { this->PlaybackStride = std::max(1, stride); }
+
+  void SetInterpreter(vtkLidarPacketInterpreter* interpreter) override;
+
   int GetLidarPort() override { return this->LidarPort; }
   void SetLidarPort(int _arg) override;
 
 protected:
-  vtkLidarReader() = default;
-  ~vtkLidarReader() = default;
+  vtkLidarReader();
+  ~vtkLidarReader();
 
   int RequestData(vtkInformation* request,
                   vtkInformationVector** inputVector,
@@ -124,6 +293,55 @@ protected:
   //! Show/Hide the first and last frame that most of the time are partial frames
   bool ShowFirstAndLastFrame = false;
 
+  //! Save the frame catalog in a sidecar file next to the pcap once it has been built,
+  //! and load it instead of parsing the whole pcap the next time the file is opened
+  bool UseFrameIndexCache = true;
+
+  //! Read the pcap through a memory mapping of the file instead of libpcap.
+  //! Only available on POSIX systems for classic pcap files, ignored otherwise
+  bool UseMemoryMapping = false;
+
+  //! Number of threads used to build the frame catalog, 0 to use all the cores.
+  //! The pcap is split in chunks scanned in parallel, this requires the memory mapping
+  int NumberOfScanThreads = 1;
+
+  //! Size in bytes under which a chunk of the pcap is not worth to be scanned by another
+  //! thread. Mainly lowered by the tests, so that their small pcaps are split
+  int64_t MinimumScanChunkSize = 64 * 1024 * 1024;
+
+  int NumberOfScannedChunks = 1;
+
+  //! Keep the position packets met while building the frame catalog and share them
+  //! through PositionPacketCache, so that the position reader does not read the pcap again.
+  //! Only possible when all the packets are read (LidarPort is -1)
+  bool CollectPositionPackets = true;
+
+  //! Only catalog the frames of this time window, in seconds since the first packet of the
+  //! file. With the memory mapping, the start is found by a binary search on a sparse time
+  //! index of the pcap (see vtkPacketFileReader::SeekToTime) instead of reading the packets
+  //! before it. Disabled if the end is not after the start
+  double TimeWindow[2] = { 0, 0 };
+
+  //! Only catalog the frames of this part of the file, in megabytes from its beginning.
+  //! This requires the memory mapping. Disabled if the end is not after the start
+  double OffsetWindow[2] = { 0, 0 };
+
+  //! Memory budget in megabytes of the cache of decoded frames, 0 to disable the cache
+  int FrameCacheSize = 0;
+
+  //! Number of frames decoded in advance in the background, in the playback direction,
+  //! while the frame cache is enabled
+  int NumberOfFramesToPrefetch = 4;
+
+  //! Direction in which the frames are played, 1 forward and -1 backward.
+  //! Used to choose which frames should be decoded in advance
+  int PlaybackDirection = 1;
+
+  //! Number of frames from one frame played to the next, more than 1 when the player
+  //! skips frames to hold the playback speed. Used to choose which frames should be
+  //! decoded in advance
+  int PlaybackStride = 1;
+
   //! libpcap wrapped reader which enable to get the raw pcap packet from the pcap file
   vtkPacketFileReader* Reader = nullptr;
 
@@ -132,11 +350,106 @@ protected:
   int LidarPort = -1;
 
 private:
+  /**
+   * @brief GetDecodingMTime modification time of the settings that change the decoded
+   * frames, those which are not only filtered by the selection of the interpreter.
+   * The decoded frames are kept while it does not change.
+   */
+  vtkMTimeType GetDecodingMTime();
+
+  /**
+   * @brief GetFramesToSave frames of the catalog to save for a range of frames as they are
+   * shown, which do not include the first and last frames unless ShowFirstAndLastFrame is set
+   */
+  std::vector<int> GetFramesToSave(int startFrame, int endFrame, int frameStride) const;
+
   /**
    * @brief ReadFrameInformation read the whole pcap and create a frame index.
    * In case the calibration is contained in the pcap file, this will also read it
    */
   int ReadFrameInformation();
+
+  /**
+   * @brief DecodeFrame decode a frame from the pcap, without using the frame cache
+   * @param reader reader used to read the packets, which must be open on FileName
+   * @param frameNumber beteween 0 and vtkLidarReader::GetNumberOfFrames()
+   */
+  vtkSmartPointer<vtkPolyData> DecodeFrame(vtkPacketFileReader* reader, int frameNumber);
+
+  /**
+   * @brief DecodeFrame decode a frame from the pcap with a given interpreter
+   * @param interpreter interpreter used to decode the packets, which is reset
+   */
+  vtkSmartPointer<vtkPolyData> DecodeFrame(vtkPacketFileReader* reader,
+                                           vtkLidarPacketInterpreter* interpreter, int frameNumber);
+
+  //! Packets read from the file: the lidar packets on LidarPort, and the position
+  //! packets when they are collected during the catalog scan
+  UDPPacketSelection GetPacketSelection() const;
+
+  /**
+   * @brief SaveFrameByteRange fast path of SaveFrame, which copies the records of the
+   * frames of a classic pcap file without decoding them, with the frame indices of the file
+   * @return false if the file can not be saved this way, nothing has then been written
+   */
+  bool SaveFrameByteRange(int startFrame, int endFrame, const std::string& filename);
+
+  /**
+   * @brief StartFramePrefetcher start the background thread decoding frames in advance,
+   * if it is not already running
+   */
+  void StartFramePrefetcher();
+
+  /**
+   * @brief StopFramePrefetcher stop the background thread decoding frames in advance and
+   * clear the cached frames. This must be called before changing anything used to decode
+   * the frames (frame catalog, interpreter, calibration, ...)
+   */
+  void StopFramePrefetcher();
+
+  /**
+   * @brief PrefetchFrames function run by the background thread
+   */
+  void PrefetchFrames();
+
+  /**
+   * @brief ComputeNetworkTimeToDataTime estimate NetworkTimeToDataTime from the frame catalog
+   */
+  void ComputeNetworkTimeToDataTime();
+
+  /**
+   * @brief ScanFrameCatalogInParallel build the frame catalog by splitting the pcap in chunks
+   * which are preprocessed in parallel, each one with its own interpreter, and then stitched.
+   * @param positionPackets if not null, the position packets are appended to it
+   * @return false if the file can not be scanned in parallel, the catalog must then be built
+   * sequentially
+   */
+  bool ScanFrameCatalogInParallel(PositionPacketCache::Packets* positionPackets);
+
+  //! True if only the frames of a time or offset window are cataloged
+  bool IsWindowed() const;
+
+  /**
+   * @brief SeekToWindow move the reader to the beginning of the time and offset windows
+   * @param begin network time of the beginning of the time window, the packets before it
+   * must still be skipped
+   * @param end network time of the end of the time window
+   * @param endOffset offset in bytes of the end of the offset window
+   */
+  void SeekToWindow(double& begin, double& end, int64_t& endOffset);
+
+  /**
+   * @brief GetFrameIndexSettings return a string describing all the settings that have
+   * an impact on the frame catalog. A saved catalog is only reused if its settings match.
+   */
+  std::string GetFrameIndexSettings();
+
+  /**
+   * @brief WaitForFrameIndexWriter wait for the background thread saving the
+   * frame catalog sidecar to finish, if any
+   */
+  void WaitForFrameIndexWriter();
+
   /**
    * @brief SetTimestepInformation Set the timestep available
    * @param info
@@ -153,6 +466,16 @@ private:
    * Example of "data time": the time of the lidar points.
    */
   double NetworkTimeToDataTime = 0.0;
+
+  //! Thread writing the frame catalog sidecar once the pcap has been parsed
+  std::unique_ptr<boost::thread> FrameIndexWriter;
+
+  //! Position packets collected with the last frame catalog, shared with PositionPacketCache
+  std::shared_ptr<const PositionPacketCache::Packets> PositionPackets;
+
+  //! Cache of decoded frames and state of the thread filling it
+  struct FramePrefetcher;
+  std::unique_ptr<FramePrefetcher> Prefetcher;
 };
 
 #endif // VTKLIDARREADER_H
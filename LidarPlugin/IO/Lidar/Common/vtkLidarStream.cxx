@@ -17,11 +17,14 @@
 
 #include "vtkLidarStream.h"
 
+#include <algorithm>
 #include <sstream>
 
+#include "FramePublisher.h"
 #include "NetworkSource.h"
 #include "PacketConsumer.h"
 #include "PacketFileWriter.h"
+#include "StreamHealthMonitor.h"
 
 #include <vtkInformationVector.h>
 #include <vtkInformation.h>
@@ -35,6 +38,8 @@ vtkLidarStream::vtkLidarStream()
   this->Consumer = std::make_shared<PacketConsumer>();
   this->Writer = std::make_shared<PacketFileWriter>();
   this->Network = std::make_unique<NetworkSource>(this->Consumer, 2368, 2369, "127.0.0.1", false, false);
+  this->HealthMonitor = std::make_unique<StreamHealthMonitor>(this->Network.get(), this->Consumer);
+  this->Publisher = std::make_shared<FramePublisher>();
 }
 
 //-----------------------------------------------------------------------------
@@ -145,6 +150,45 @@ void vtkLidarStream::EnableGPSListening(bool value)
   this->Network->ListenGPS = value;
 }
 
+//-----------------------------------------------------------------------------
+bool vtkLidarStream::GetPPSSynced()
+{
+  return this->Consumer->GetPositionStatus().PPSSynced;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetLastPPSState()
+{
+  return this->Consumer->GetPositionStatus().LastPPSState;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarStream::GetHasTimeshiftEstimation()
+{
+  return this->Consumer->GetPositionStatus().HasTimeshiftEstimation;
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetTimeshiftEstimation()
+{
+  return this->Consumer->GetPositionStatus().TimeshiftEstimation;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetNumberOfPositionSamples()
+{
+  return static_cast<int>(this->Consumer->GetPositionStatus().NumberOfSamples);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::GetLastGPSLocation(double location[3])
+{
+  const PacketConsumer::PositionStatus status = this->Consumer->GetPositionStatus();
+  location[0] = status.LastSample.Latitude;
+  location[1] = status.LastSample.Longitude;
+  location[2] = status.LastSample.Altitude;
+}
+
 
 //-----------------------------------------------------------------------------
 void vtkLidarStream::SetIsForwarding(bool value)
@@ -164,10 +208,384 @@ void vtkLidarStream::SetIsCrashAnalysing(bool value)
   this->Network->IsCrashAnalysing = value;
 }
 
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SaveCrashAnalysisLog()
+{
+  if (!this->Network->SaveCrashAnalysisLog())
+  {
+    vtkWarningMacro("The last packets received could not be saved, is the crash analysis enabled?");
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarStream::GetUseBatchedReceive()
+{
+  return this->Network->UseBatchedReceive;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetUseBatchedReceive(bool value)
+{
+  this->Network->UseBatchedReceive = value;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetReceiveBufferSize()
+{
+  return this->Network->ReceiveBufferSize;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetReceiveBufferSize(int size)
+{
+  this->Network->ReceiveBufferSize = size;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetCaptureBackend()
+{
+  return this->Network->CaptureBackend;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetCaptureBackend(int backend)
+{
+  this->Network->CaptureBackend = backend;
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarStream::GetCaptureInterface()
+{
+  return this->Network->CaptureInterface;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetCaptureInterface(const std::string& interfaceName)
+{
+  this->Network->CaptureInterface = interfaceName;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarStream::GetUseHardwareTimestamps()
+{
+  return this->Network->UseHardwareTimestamps;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetUseHardwareTimestamps(bool value)
+{
+  this->Network->UseHardwareTimestamps = value;
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarStream::GetReceiverCPUs()
+{
+  return ThreadPlacement::FormatCPUList(this->Network->ReceiverPlacement.CPUs);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetReceiverCPUs(const std::string& cpus)
+{
+  if (!ThreadPlacement::ParseCPUList(cpus, this->Network->ReceiverPlacement.CPUs))
+  {
+    vtkErrorMacro("Invalid list of CPUs for the receiver: " << cpus);
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarStream::GetDecoderCPUs()
+{
+  return ThreadPlacement::FormatCPUList(this->Consumer->GetThreadPlacement().CPUs);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetDecoderCPUs(const std::string& cpus)
+{
+  ThreadPlacement placement = this->Consumer->GetThreadPlacement();
+  if (!ThreadPlacement::ParseCPUList(cpus, placement.CPUs))
+  {
+    vtkErrorMacro("Invalid list of CPUs for the decoder: " << cpus);
+    return;
+  }
+  this->Consumer->SetThreadPlacement(placement);
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarStream::GetListenerCPUs()
+{
+  return ThreadPlacement::FormatCPUList(this->Network->ListenerPlacement.CPUs);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetListenerCPUs(const std::string& cpus)
+{
+  if (!ThreadPlacement::ParseCPUList(cpus, this->Network->ListenerPlacement.CPUs))
+  {
+    vtkErrorMacro("Invalid list of CPUs for the listeners: " << cpus);
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetReceiverRealTimePriority()
+{
+  return this->Network->ReceiverPlacement.RealTimePriority;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetReceiverRealTimePriority(int priority)
+{
+  this->Network->ReceiverPlacement.RealTimePriority = std::min(std::max(priority, 0), 99);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetFrameHistorySize()
+{
+  return static_cast<int>(this->Consumer->GetFrameHistorySize());
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetFrameHistorySize(int size)
+{
+  if (size > 0 && static_cast<size_t>(size) != this->Consumer->GetFrameHistorySize())
+  {
+    this->Consumer->SetFrameHistorySize(static_cast<size_t>(size));
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetNumberOfSkippedFrames()
+{
+  return static_cast<int>(this->Consumer->GetNumberOfSkippedFrames());
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetPacketQueueCapacity()
+{
+  return static_cast<int>(this->Consumer->GetQueueCapacity());
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetPacketQueueCapacity(int capacity)
+{
+  if (capacity > 0 && static_cast<size_t>(capacity) != this->Consumer->GetQueueCapacity())
+  {
+    this->Consumer->SetQueueCapacity(static_cast<size_t>(capacity));
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetPacketQueueOverflowPolicy()
+{
+  return this->Consumer->GetQueueOverflowPolicy();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetPacketQueueOverflowPolicy(int policy)
+{
+  if (policy != this->Consumer->GetQueueOverflowPolicy())
+  {
+    this->Consumer->SetQueueOverflowPolicy(policy);
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetNumberOfDroppedPackets()
+{
+  return static_cast<int>(this->Consumer->GetNumberOfDroppedPackets());
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetPacketQueueHighWaterMark()
+{
+  return static_cast<int>(this->Consumer->GetQueueHighWaterMark());
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetPacketQueueDepth()
+{
+  return static_cast<int>(this->Consumer->GetQueueDepth());
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetReceivedPacketRate()
+{
+  return this->HealthMonitor->GetMetrics().PacketRate;
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetReceivedByteRate()
+{
+  return this->HealthMonitor->GetMetrics().ByteRate;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetNumberOfReceivedPackets()
+{
+  return static_cast<int>(this->Network->NumberOfReceivedPackets.load());
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetNumberOfSocketDrops()
+{
+  return static_cast<int>(this->Network->NumberOfSocketDrops.load());
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetLastFrameDecodeTime()
+{
+  return this->Consumer->GetLastFrameDecodeTime();
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetLastFrameNumberOfPoints()
+{
+  return static_cast<int>(this->Consumer->GetLastFrameNumberOfPoints());
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetHealthMetricsInterval()
+{
+  return this->HealthMonitor->Interval;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetHealthMetricsInterval(double interval)
+{
+  this->HealthMonitor->Interval = interval;
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarStream::GetHealthMetricsName()
+{
+  return this->HealthMonitor->Name;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetHealthMetricsName(const std::string& name)
+{
+  this->HealthMonitor->Name = name;
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarStream::GetStatsDAddress()
+{
+  return this->HealthMonitor->StatsDAddress;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetStatsDAddress(const std::string& address)
+{
+  this->HealthMonitor->StatsDAddress = address;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetStatsDPort()
+{
+  return this->HealthMonitor->StatsDPort;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetStatsDPort(int port)
+{
+  this->HealthMonitor->StatsDPort = port;
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarStream::GetPrometheusFileName()
+{
+  return this->HealthMonitor->PrometheusFileName;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetPrometheusFileName(const std::string& filename)
+{
+  this->HealthMonitor->PrometheusFileName = filename;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetPublishedFramesPort()
+{
+  return this->Publisher->TCPPort;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetPublishedFramesPort(int port)
+{
+  this->Publisher->TCPPort = port;
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarStream::GetPublishedFramesMulticastAddress()
+{
+  return this->Publisher->MulticastAddress;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetPublishedFramesMulticastAddress(const std::string& address)
+{
+  this->Publisher->MulticastAddress = address;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetPublishedFramesMulticastPort()
+{
+  return this->Publisher->MulticastPort;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetPublishedFramesMulticastPort(int port)
+{
+  this->Publisher->MulticastPort = port;
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarStream::GetPublishedFramesSharedMemoryName()
+{
+  return this->Publisher->SharedMemoryName;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetPublishedFramesSharedMemoryName(const std::string& name)
+{
+  this->Publisher->SharedMemoryName = name;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetPublishedFramesCompressionLevel()
+{
+  return this->Publisher->CompressionLevel;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetPublishedFramesCompressionLevel(int level)
+{
+  this->Publisher->CompressionLevel = level;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarStream::GetPublishPointsAsFloat()
+{
+  return this->Publisher->PointsAsFloat;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetPublishPointsAsFloat(bool value)
+{
+  this->Publisher->PointsAsFloat = value;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetNumberOfSkippedPublishedFrames()
+{
+  return static_cast<int>(this->Publisher->GetNumberOfSkippedFrames());
+}
+
 //-----------------------------------------------------------------------------
 bool vtkLidarStream::GetNeedsUpdate()
 {
-  boost::lock_guard<boost::mutex> lock(this->Consumer->ConsumerMutex);
   if (this->Consumer->CheckForNewData())
   {
     this->Modified();
@@ -184,9 +602,16 @@ void vtkLidarStream::Start()
     vtkErrorMacro("no interpreter is set")
   }
   this->Consumer->SetInterpreter(this->Interpreter);
+  this->Consumer->SetDecodePositionPackets(this->Network->ListenGPS);
+  if (this->Interpreter)
+  {
+    this->Interpreter->SetSectorSize(this->SectorSize);
+  }
   if (this->OutputFileName.length())
   {
-    this->Writer->Start(this->OutputFileName);
+    this->Writer->SetRotation(static_cast<size_t>(std::max(0, this->OutputFileMaximumSize)) << 20,
+                              std::max(0., this->OutputFileMaximumDuration));
+    this->Writer->Open(this->OutputFileName);
   }
 
   this->Network->Writer.reset();
@@ -196,16 +621,27 @@ void vtkLidarStream::Start()
     this->Network->Writer = this->Writer;
   }
 
+  // the frames are published only if an output is set
+  this->Consumer->SetPublisher(this->Publisher->Start() ? this->Publisher : nullptr);
+
+  // the writer, the forwarder and the crash analysis read the queue of the consumer
+  this->Consumer->SetNumberOfListeners(this->Network->GetNumberOfListeners());
   this->Consumer->Start();
+  this->LastNumberOfDroppedPackets = 0;
+  this->LastNumberOfPacketGaps = 0;
+  this->LastNumberOfRecordingStalls = 0;
 
   this->Network->Start();
+  this->HealthMonitor->Start();
 }
 
 //----------------------------------------------------------------------------
 void vtkLidarStream::Stop()
 {
+  this->HealthMonitor->Stop();
   this->Network->Stop();
   this->Consumer->Stop();
+  this->Publisher->Stop();
   this->Writer->Stop();
 }
 
@@ -216,17 +652,13 @@ int vtkLidarStream::RequestData(vtkInformation* vtkNotUsed(request),
 {
   vtkPolyData* output = vtkPolyData::GetData(outputVector);
 
+  // the consumer is only blocked while the frame is taken, not while it is copied
   int numberOfFrameAvailable = 0;
+  vtkSmartPointer<vtkPolyData> polyData = this->Consumer->TakeLastFrame(numberOfFrameAvailable);
+  if (polyData)
   {
-    boost::lock_guard<boost::mutex> lock(this->Consumer->ConsumerMutex);
-    numberOfFrameAvailable = this->Consumer->CheckForNewData();
-    if (numberOfFrameAvailable != 0)
-    {
-      vtkSmartPointer<vtkPolyData> polyData = this->Consumer->GetLastAvailableFrame();
-      output->ShallowCopy(polyData);
-      this->Consumer->ClearAllFrames();
-      this->LastFrameProcessed += numberOfFrameAvailable;
-    }
+    output->ShallowCopy(polyData);
+    this->LastFrameProcessed += numberOfFrameAvailable;
   }
 
   if (this->DetectFrameDropping)
@@ -238,6 +670,35 @@ int vtkLidarStream::RequestData(vtkInformation* vtkNotUsed(request),
            << " Drop " << std::right << std::setw(2) << numberOfFrameAvailable-1 << " frame(s)\n";
       vtkWarningMacro( << text.str() )
     }
+
+    const size_t numberOfDroppedPackets = this->Consumer->GetNumberOfDroppedPackets();
+    if (numberOfDroppedPackets > this->LastNumberOfDroppedPackets)
+    {
+      vtkWarningMacro(<< "WARNING : Drop "
+                      << numberOfDroppedPackets - this->LastNumberOfDroppedPackets
+                      << " packet(s), the packet queue is full (high water mark: "
+                      << this->Consumer->GetQueueHighWaterMark() << ")");
+      this->LastNumberOfDroppedPackets = numberOfDroppedPackets;
+    }
+
+    const size_t numberOfPacketGaps = this->Consumer->GetNumberOfPacketGaps();
+    if (numberOfPacketGaps > this->LastNumberOfPacketGaps)
+    {
+      vtkWarningMacro(<< "WARNING : " << numberOfPacketGaps - this->LastNumberOfPacketGaps
+                      << " gap(s) in the packets sent by the sensor ("
+                      << this->Consumer->GetNumberOfMissingPackets() << " packet(s) missing in total)");
+      this->LastNumberOfPacketGaps = numberOfPacketGaps;
+    }
+
+    const vtkPacketFileWriter::Statistics recording = this->Writer->GetStatistics();
+    if (recording.NumberOfStalls > this->LastNumberOfRecordingStalls)
+    {
+      vtkWarningMacro(<< "WARNING : The recording waited "
+                      << recording.NumberOfStalls - this->LastNumberOfRecordingStalls
+                      << " time(s) for the disk (" << recording.StallDuration << " s in total, "
+                      << recording.NumberOfWriteErrors << " write error(s))");
+      this->LastNumberOfRecordingStalls = recording.NumberOfStalls;
+    }
   }
 
   vtkTable* calibration = vtkTable::GetData(outputVector,1);
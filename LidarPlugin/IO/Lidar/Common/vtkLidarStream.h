@@ -19,9 +19,11 @@
 #include <memory>
 #include "vtkLidarProvider.h"
 
+class FramePublisher;
 class PacketConsumer;
 class PacketFileWriter;
 class NetworkSource;
+class StreamHealthMonitor;
 
 class VTK_EXPORT vtkLidarStream : public vtkLidarProvider
 {
@@ -40,6 +42,28 @@ public:
   std::string GetOutputFile();
   void SetOutputFile(const std::string& filename);
 
+  /**
+   * @brief OutputFileMaximumSize start a new output file when the current one reaches
+   * this size in MB, 0 for a single file. Taken into account when the recording starts.
+   */
+  vtkGetMacro(OutputFileMaximumSize, int)
+  vtkSetMacro(OutputFileMaximumSize, int)
+
+  /**
+   * @brief OutputFileMaximumDuration start a new output file when the current one spans
+   * this duration in seconds, 0 for a single file. Taken into account when the recording starts.
+   */
+  vtkGetMacro(OutputFileMaximumDuration, double)
+  vtkSetMacro(OutputFileMaximumDuration, double)
+
+  /**
+   * @brief SectorSize split the rotations into sectors of this size in degrees, made
+   * available as soon as they are complete, 0 for whole rotations. Taken into account
+   * when the stream starts, see vtkLidarPacketInterpreter::SectorSize.
+   */
+  vtkGetMacro(SectorSize, double)
+  vtkSetClampMacro(SectorSize, double, 0., 360.)
+
   /**
    * @copydoc NetworkSource::LidarPort
    */
@@ -72,6 +96,18 @@ public:
 
   void EnableGPSListening(bool);
 
+  /**
+   * @brief The position packets received on the GPS port are decoded as they arrive, with
+   * the time model of vtkVelodyneHDLPositionReader. These getters give its last state.
+   */
+  bool GetPPSSynced();
+  int GetLastPPSState();
+  bool GetHasTimeshiftEstimation();
+  double GetTimeshiftEstimation();
+  int GetNumberOfPositionSamples();
+  //! Latitude, longitude (degrees) and altitude (meters) of the last position packet
+  void GetLastGPSLocation(double location[3]);
+
   /**
    * @copydoc NetworkSource::IsForwarding
    */
@@ -84,6 +120,195 @@ public:
   bool GetIsCrashAnalysing();
   void SetIsCrashAnalysing(bool value);
 
+  /**
+   * @copydoc NetworkSource::SaveCrashAnalysisLog
+   */
+  void SaveCrashAnalysisLog();
+
+  /**
+   * @copydoc NetworkSource::UseBatchedReceive
+   */
+  bool GetUseBatchedReceive();
+  void SetUseBatchedReceive(bool value);
+
+  /**
+   * @copydoc NetworkSource::ReceiveBufferSize
+   */
+  int GetReceiveBufferSize();
+  void SetReceiveBufferSize(int size);
+
+  /**
+   * @copydoc NetworkSource::CaptureBackend
+   */
+  int GetCaptureBackend();
+  void SetCaptureBackend(int backend);
+
+  /**
+   * @copydoc NetworkSource::CaptureInterface
+   */
+  std::string GetCaptureInterface();
+  void SetCaptureInterface(const std::string& interfaceName);
+
+  /**
+   * @copydoc NetworkSource::UseHardwareTimestamps
+   */
+  bool GetUseHardwareTimestamps();
+  void SetUseHardwareTimestamps(bool value);
+
+  /**
+   * @brief ReceiverCPUs CPUs on which the thread receiving the packets runs, given as a
+   * list such as "0-3,8", the CPUs of the application if empty. DecoderCPUs is the same
+   * for the thread decoding the packets into frames, and ListenerCPUs for the threads
+   * recording, forwarding and analysing the packets. Taken into account when the stream
+   * starts, see ThreadPlacement.
+   */
+  std::string GetReceiverCPUs();
+  void SetReceiverCPUs(const std::string& cpus);
+  std::string GetDecoderCPUs();
+  void SetDecoderCPUs(const std::string& cpus);
+  std::string GetListenerCPUs();
+  void SetListenerCPUs(const std::string& cpus);
+
+  /**
+   * @copydoc ThreadPlacement::RealTimePriority
+   * Only used by the thread receiving the packets.
+   */
+  int GetReceiverRealTimePriority();
+  void SetReceiverRealTimePriority(int priority);
+
+  /**
+   * @copydoc PacketConsumer::SetFrameHistorySize
+   */
+  int GetFrameHistorySize();
+  void SetFrameHistorySize(int size);
+
+  /**
+   * @copydoc PacketConsumer::GetNumberOfSkippedFrames
+   */
+  int GetNumberOfSkippedFrames();
+
+  /**
+   * @copydoc PacketConsumer::SetQueueCapacity
+   */
+  int GetPacketQueueCapacity();
+  void SetPacketQueueCapacity(int capacity);
+
+  /**
+   * @copydoc PacketConsumer::SetQueueOverflowPolicy
+   */
+  int GetPacketQueueOverflowPolicy();
+  void SetPacketQueueOverflowPolicy(int policy);
+
+  /**
+   * @copydoc PacketConsumer::GetNumberOfDroppedPackets
+   */
+  int GetNumberOfDroppedPackets();
+
+  /**
+   * @copydoc PacketConsumer::GetQueueHighWaterMark
+   */
+  int GetPacketQueueHighWaterMark();
+
+  /**
+   * @copydoc PacketConsumer::GetQueueDepth
+   */
+  int GetPacketQueueDepth();
+
+  /**
+   * @brief GetReceivedPacketRate number of packets received per second, over the last
+   * interval of the health metrics
+   */
+  double GetReceivedPacketRate();
+
+  /**
+   * @brief GetReceivedByteRate number of bytes received per second, over the last
+   * interval of the health metrics
+   */
+  double GetReceivedByteRate();
+
+  /**
+   * @copydoc NetworkSource::NumberOfReceivedPackets
+   */
+  int GetNumberOfReceivedPackets();
+
+  /**
+   * @copydoc NetworkSource::NumberOfSocketDrops
+   */
+  int GetNumberOfSocketDrops();
+
+  /**
+   * @copydoc PacketConsumer::GetLastFrameDecodeTime
+   */
+  double GetLastFrameDecodeTime();
+
+  /**
+   * @copydoc PacketConsumer::GetLastFrameNumberOfPoints
+   */
+  int GetLastFrameNumberOfPoints();
+
+  /**
+   * @copydoc StreamHealthMonitor::Interval
+   */
+  double GetHealthMetricsInterval();
+  void SetHealthMetricsInterval(double interval);
+
+  /**
+   * @copydoc StreamHealthMonitor::Name
+   */
+  std::string GetHealthMetricsName();
+  void SetHealthMetricsName(const std::string& name);
+
+  /**
+   * @copydoc StreamHealthMonitor::StatsDAddress
+   */
+  std::string GetStatsDAddress();
+  void SetStatsDAddress(const std::string& address);
+  int GetStatsDPort();
+  void SetStatsDPort(int port);
+
+  /**
+   * @copydoc StreamHealthMonitor::PrometheusFileName
+   */
+  std::string GetPrometheusFileName();
+  void SetPrometheusFileName(const std::string& filename);
+
+  /**
+   * @copydoc FramePublisher::TCPPort
+   */
+  int GetPublishedFramesPort();
+  void SetPublishedFramesPort(int port);
+
+  /**
+   * @copydoc FramePublisher::MulticastAddress
+   */
+  std::string GetPublishedFramesMulticastAddress();
+  void SetPublishedFramesMulticastAddress(const std::string& address);
+  int GetPublishedFramesMulticastPort();
+  void SetPublishedFramesMulticastPort(int port);
+
+  /**
+   * @copydoc FramePublisher::SharedMemoryName
+   */
+  std::string GetPublishedFramesSharedMemoryName();
+  void SetPublishedFramesSharedMemoryName(const std::string& name);
+
+  /**
+   * @copydoc FramePublisher::CompressionLevel
+   */
+  int GetPublishedFramesCompressionLevel();
+  void SetPublishedFramesCompressionLevel(int level);
+
+  /**
+   * @copydoc FramePublisher::PointsAsFloat
+   */
+  bool GetPublishPointsAsFloat();
+  void SetPublishPointsAsFloat(bool value);
+
+  /**
+   * @copydoc FramePublisher::GetNumberOfSkippedFrames
+   */
+  int GetNumberOfSkippedPublishedFrames();
+
   /**
    * @brief GetNeedsUpdate
    * @return true if a new frame is ready
@@ -100,9 +325,20 @@ protected:
 
   //! where to save a live record of the sensor
   std::string OutputFileName = "";
+  int OutputFileMaximumSize = 0;
+  double OutputFileMaximumDuration = 0;
+  double SectorSize = 0;
   std::shared_ptr<PacketConsumer> Consumer;
   std::shared_ptr<PacketFileWriter> Writer;
   std::unique_ptr<NetworkSource> Network;
+  std::unique_ptr<StreamHealthMonitor> HealthMonitor;
+  std::shared_ptr<FramePublisher> Publisher;
+  //! Number of dropped packets already reported
+  size_t LastNumberOfDroppedPackets = 0;
+  //! Number of gaps of the packets already reported
+  size_t LastNumberOfPacketGaps = 0;
+  //! Number of stalls of the recording already reported
+  size_t LastNumberOfRecordingStalls = 0;
 private:
   vtkLidarStream(const vtkLidarStream&) = delete;
   void operator=(const vtkLidarStream&) = delete;
@@ -0,0 +1,153 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "vtkSharedMemoryFrameStream.h"
+
+#include "FrameArchive.h"
+#include "FramePublisher.h"
+#include "SharedFrameRing.h"
+#include "vtkLidarFrameArchiveReader.h"
+
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkPolyData.h>
+
+#include <cstring>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSharedMemoryFrameStream)
+
+//-----------------------------------------------------------------------------
+vtkSharedMemoryFrameStream::vtkSharedMemoryFrameStream()
+  : Ring(new SharedFrameRing)
+  , Decoder(new FrameDecoder)
+{
+  this->SetNumberOfInputPorts(0);
+  this->SetNumberOfOutputPorts(1);
+}
+
+//-----------------------------------------------------------------------------
+vtkSharedMemoryFrameStream::~vtkSharedMemoryFrameStream()
+{
+  this->Stop();
+}
+
+//-----------------------------------------------------------------------------
+void vtkSharedMemoryFrameStream::Start()
+{
+  this->Stop();
+  if (this->SharedMemoryName.empty())
+  {
+    vtkErrorMacro("no shared memory name is set");
+    return;
+  }
+  this->IsStarted = true;
+  this->NumberOfSkippedFrames = 0;
+  this->LastFrame = nullptr;
+  this->OpenRing();
+}
+
+//-----------------------------------------------------------------------------
+void vtkSharedMemoryFrameStream::Stop()
+{
+  this->IsStarted = false;
+  this->Ring->Close();
+}
+
+//-----------------------------------------------------------------------------
+bool vtkSharedMemoryFrameStream::OpenRing()
+{
+  if (this->Ring->IsOpen() && this->Ring->IsWriterClosed())
+  {
+    // the writer has stopped, it may have created a new ring since
+    this->Ring->Close();
+  }
+  if (!this->Ring->IsOpen())
+  {
+    if (!this->IsStarted || !this->Ring->Open(this->SharedMemoryName))
+    {
+      return false;
+    }
+    this->NumberOfReadMessages = 0;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkSharedMemoryFrameStream::GetNeedsUpdate()
+{
+  if (this->OpenRing()
+      && this->Ring->GetNumberOfWrittenMessages() > this->NumberOfReadMessages)
+  {
+    this->Modified();
+    return true;
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+int vtkSharedMemoryFrameStream::RequestData(vtkInformation* vtkNotUsed(request),
+                                            vtkInformationVector** vtkNotUsed(inputVector),
+                                            vtkInformationVector* outputVector)
+{
+  vtkPolyData* output = vtkPolyData::GetData(outputVector);
+
+  uint64_t messageNumber = 0;
+  uint64_t size = 0;
+  const unsigned char* message =
+    this->OpenRing() ? this->Ring->BeginRead(messageNumber, size) : nullptr;
+  if (message && messageNumber >= this->NumberOfReadMessages)
+  {
+    // the frame is copied straight from the shared memory into the arrays of the frame,
+    // and dropped if the writer has overwritten it meanwhile
+    FrameMessageHeader header;
+    uint64_t numberOfPoints = 0;
+    std::vector<FrameArchiveColumn> columns;
+    vtkSmartPointer<vtkPolyData> frame;
+    if (size >= sizeof(header))
+    {
+      std::memcpy(&header, message, sizeof(header));
+      if (header.FrameSize <= size - sizeof(header)
+          && this->Decoder->Decode(message + sizeof(header), header.FrameSize, numberOfPoints,
+                                   columns))
+      {
+        int numberOfInvalidColumns = 0;
+        frame = vtkLidarFrameArchiveReader::CreateFrame(numberOfPoints, columns,
+                                                        numberOfInvalidColumns);
+      }
+    }
+
+    this->NumberOfSkippedFrames += messageNumber - this->NumberOfReadMessages;
+    this->NumberOfReadMessages = messageNumber + 1;
+    if (frame && this->Ring->EndRead(messageNumber))
+    {
+      this->LastFrame = frame;
+    }
+    else
+    {
+      ++this->NumberOfSkippedFrames;
+    }
+  }
+
+  if (this->LastFrame)
+  {
+    output->ShallowCopy(this->LastFrame);
+  }
+  return 1;
+}
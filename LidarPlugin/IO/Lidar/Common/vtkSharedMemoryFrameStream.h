@@ -0,0 +1,93 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTKSHAREDMEMORYFRAMESTREAM_H
+#define VTKSHAREDMEMORYFRAMESTREAM_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <vtkPolyDataAlgorithm.h>
+#include <vtkSmartPointer.h>
+
+class FrameDecoder;
+class SharedFrameRing;
+
+/**
+ * @brief The vtkSharedMemoryFrameStream class outputs the newest frame written in a
+ * shared memory ring by another process of the same machine, see SharedFrameRing.
+ *
+ * The frames are the messages of FramePublisher, so the ring can be written by the
+ * publisher of a vtkLidarStream or by any process producing point clouds in this layout.
+ * The frames are already decoded, they are copied once from the shared memory into the
+ * arrays of the output, without any network round trip.
+ *
+ * As vtkLidarStream, the source is started and stopped, and GetNeedsUpdate tells if a
+ * new frame is available. The ring can be created after the source is started, and
+ * it is attached again when its writer is restarted.
+ */
+class VTK_EXPORT vtkSharedMemoryFrameStream : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkSharedMemoryFrameStream* New();
+  vtkTypeMacro(vtkSharedMemoryFrameStream, vtkPolyDataAlgorithm)
+
+  //! Name of the shared memory ring, taken into account when the stream starts
+  vtkGetMacro(SharedMemoryName, std::string)
+  vtkSetMacro(SharedMemoryName, std::string)
+
+  void Start();
+  void Stop();
+
+  /**
+   * @brief GetNeedsUpdate
+   * @return true if a new frame is ready
+   */
+  bool GetNeedsUpdate();
+
+  //! Number of frames written in the ring but never output, because the frames were
+  //! not requested often enough or were overwritten while being copied
+  int GetNumberOfSkippedFrames() { return static_cast<int>(this->NumberOfSkippedFrames); }
+
+protected:
+  vtkSharedMemoryFrameStream();
+  ~vtkSharedMemoryFrameStream();
+
+  int RequestData(vtkInformation* request,
+                  vtkInformationVector** inputVector,
+                  vtkInformationVector* outputVector) override;
+
+  //! Attach to the ring if needed, return false if it does not exist yet
+  bool OpenRing();
+
+  std::string SharedMemoryName = "";
+  bool IsStarted = false;
+  std::unique_ptr<SharedFrameRing> Ring;
+  std::unique_ptr<FrameDecoder> Decoder;
+  //! Number of messages of the ring already read, the next message is this one
+  uint64_t NumberOfReadMessages = 0;
+  uint64_t NumberOfSkippedFrames = 0;
+  //! Last frame output, kept when no new frame could be read
+  vtkSmartPointer<vtkPolyData> LastFrame;
+
+private:
+  vtkSharedMemoryFrameStream(const vtkSharedMemoryFrameStream&) = delete;
+  void operator=(const vtkSharedMemoryFrameStream&) = delete;
+};
+
+#endif // VTKSHAREDMEMORYFRAMESTREAM_H
@@ -6,12 +6,18 @@
 #include <vtkPoints.h>
 #include <vtkPointData.h>
 #include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
 #include <vtkPolyData.h>
 #include <vtkMath.h>
 
+#include <cmath>
+#include <fstream>
+#include <iomanip>
 #include <sstream>
+#include <vector>
 
 # include <boost/filesystem.hpp>
+# include <boost/thread/thread.hpp>
 
 namespace  {
 //-----------------------------------------------------------------------------
@@ -33,10 +39,11 @@ vtkSmartPointer<vtkCellArray> NewVertexCells(vtkIdType numberOfVerts)
 
 //-----------------------------------------------------------------------------
 template<typename T>
-vtkSmartPointer<T> CreateDataArray(const char* name, vtkPolyData* pd)
+vtkSmartPointer<T> CreateDataArray(const char* name, vtkIdType nbPoints, vtkPolyData* pd)
 {
   vtkSmartPointer<T> array = vtkSmartPointer<T>::New();
   array->SetName(name);
+  array->SetNumberOfTuples(nbPoints);
   pd->GetPointData()->AddArray(array);
   return array;
 }
@@ -47,11 +54,142 @@ typedef struct point {
   float z;
   float intensity;
 } point_t;
+
+//-----------------------------------------------------------------------------
+//! Read all the points of a .bin file at once
+bool ReadScan(const std::string& filename, std::vector<point_t>& scan)
+{
+  scan.clear();
+  std::ifstream is(filename, std::ios::binary | std::ios::in);
+  if (!is)
+  {
+    return false;
+  }
+  is.seekg(0, std::ios::end);
+  const std::streamoff length = is.tellg();
+  is.seekg(0, std::ios::beg);
+  scan.resize(static_cast<size_t>(length) / sizeof(point_t));
+  is.read(reinterpret_cast<char*>(scan.data()), scan.size() * sizeof(point_t));
+  return static_cast<bool>(is);
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * @brief Fill the point arrays of the frame from the scan, in a single pass
+ * @return the number of points filled, which is smaller than the scan if more
+ * than nbLasers lasers are detected
+ */
+template<typename ArrayT>
+vtkIdType ConvertScan(const std::vector<point_t>& scan, int nbLasers, vtkPolyData* poly)
+{
+  typedef typename ArrayT::ValueType T;
+  const vtkIdType nbPoints = static_cast<vtkIdType>(scan.size());
+  auto xArray = CreateDataArray<ArrayT>("X", nbPoints, poly);
+  auto yArray = CreateDataArray<ArrayT>("Y", nbPoints, poly);
+  auto zArray = CreateDataArray<ArrayT>("Z", nbPoints, poly);
+  auto intensityArray = CreateDataArray<ArrayT>("intensity", nbPoints, poly);
+  auto azimutArray = CreateDataArray<ArrayT>("azimuth", nbPoints, poly);
+  auto elevationArray = CreateDataArray<ArrayT>("elevation", nbPoints, poly);
+  auto radiusArray = CreateDataArray<ArrayT>("radius", nbPoints, poly);
+  auto idArray = CreateDataArray<vtkDoubleArray>("laser_id", nbPoints, poly);
+  auto timestamp = CreateDataArray<vtkDoubleArray>("timestamp", nbPoints, poly);
+  auto adjustedTime = CreateDataArray<vtkDoubleArray>("adjustedtime", nbPoints, poly);
+  T* x = xArray->GetPointer(0);
+  T* y = yArray->GetPointer(0);
+  T* z = zArray->GetPointer(0);
+  T* intensity = intensityArray->GetPointer(0);
+  T* azimuth = azimutArray->GetPointer(0);
+  T* elevation = elevationArray->GetPointer(0);
+  T* radius = radiusArray->GetPointer(0);
+  double* id = idArray->GetPointer(0);
+  double* time = timestamp->GetPointer(0);
+  double* adjusted = adjustedTime->GetPointer(0);
+
+  // variable used to detect a laser jump
+  const double radToDeg = 180 / vtkMath::Pi();
+  double old_thetaProj = 0;
+  int laser_id = 0;
+  vtkIdType n = 0;
+  for (; n < nbPoints; ++n)
+  {
+    const point_t& pt = scan[n];
+    const double thetaProj = radToDeg * std::atan2(pt.y, pt.x);
+    if (old_thetaProj < 0 && thetaProj >= 0)
+    {
+      laser_id++;
+      if (laser_id >= nbLasers)
+      {
+        break;
+      }
+    }
+    old_thetaProj = thetaProj;
+
+    double azimut = radToDeg * std::atan2(pt.x, pt.y);
+    if (azimut < 0)
+    {
+      azimut += 360;
+    }
+    const double projRadius = std::sqrt(pt.x * pt.x + pt.y * pt.y);
+    x[n] = pt.x;
+    y[n] = pt.y;
+    z[n] = pt.z;
+    intensity[n] = pt.intensity;
+    azimuth[n] = azimut;
+    elevation[n] = radToDeg * std::atan2(pt.z, projRadius);
+    radius[n] = std::sqrt(static_cast<double>(pt.x) * pt.x + static_cast<double>(pt.y) * pt.y
+                          + static_cast<double>(pt.z) * pt.z);
+    id[n] = laser_id;
+    time[n] = azimut / 360.0;
+    adjusted[n] = time[n];
+  }
+
+  // drop the points which have not been processed
+  if (n < nbPoints)
+  {
+    vtkPointData* pointData = poly->GetPointData();
+    for (int i = 0; i < pointData->GetNumberOfArrays(); ++i)
+    {
+      pointData->GetArray(i)->SetNumberOfTuples(n);
+    }
+  }
+  return n;
+}
 }
 
+//-----------------------------------------------------------------------------
+struct vtkLidarKITTIDataSetReader::ScanPrefetcher
+{
+  //! Frame being read, -1 if none
+  int Frame = -1;
+  std::vector<point_t> Scan;
+  bool IsRead = false;
+  std::unique_ptr<boost::thread> Thread;
+
+  void Wait()
+  {
+    if (this->Thread)
+    {
+      this->Thread->join();
+      this->Thread.reset();
+    }
+  }
+};
+
 //-----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkLidarKITTIDataSetReader)
 
+//-----------------------------------------------------------------------------
+vtkLidarKITTIDataSetReader::vtkLidarKITTIDataSetReader()
+  : NextScan(new ScanPrefetcher)
+{
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarKITTIDataSetReader::~vtkLidarKITTIDataSetReader()
+{
+  this->NextScan->Wait();
+}
+
 //----------------------------------------------------------------------------
 void vtkLidarKITTIDataSetReader::SetFileName(const std::string &filename)
 {
@@ -67,6 +205,10 @@ void vtkLidarKITTIDataSetReader::SetFileName(const std::string &filename)
     return;
   }
 
+  // the prefetched scan belongs to the previous folder
+  this->NextScan->Wait();
+  this->NextScan->Frame = -1;
+
   // count number of frames inside the folder
   this->NumberOfFrames = 0;
   boost::filesystem::path folder(filename);
@@ -87,99 +229,67 @@ std::string vtkLidarKITTIDataSetReader::GetSensorInformation()
           The data are the .bin file contain in following folder: " + this->FileName;
 }
 
+//-----------------------------------------------------------------------------
+std::string vtkLidarKITTIDataSetReader::GetScanFileName(int frameNumber) const
+{
+  // produce path to the required .bin file
+  std::stringstream ss;
+  ss << std::setw(10) << std::setfill('0') << frameNumber;
+  return this->FileName + ss.str() + ".bin";
+}
+
 //-----------------------------------------------------------------------------
 vtkSmartPointer<vtkPolyData> vtkLidarKITTIDataSetReader::GetFrame(int frameNumber)
 {
-  // create a new empty frame
+  // use the scan read in the background if it is the requested one
+  std::vector<point_t> scan;
+  this->NextScan->Wait();
+  if (this->NextScan->Frame == frameNumber && this->NextScan->IsRead)
+  {
+    scan.swap(this->NextScan->Scan);
+  }
+  else if (!ReadScan(this->GetScanFileName(frameNumber), scan))
+  {
+    vtkErrorMacro("Could not read the scan file " << this->GetScanFileName(frameNumber));
+  }
+
+  // read the next scan while this one is converted and processed downstream
+  this->NextScan->Frame = -1;
+  const int nextFrame = frameNumber + (this->PlaybackDirection < 0 ? -1 : 1);
+  if (this->PrefetchNextScan && nextFrame >= 0 && nextFrame < this->NumberOfFrames)
+  {
+    ScanPrefetcher* prefetcher = this->NextScan.get();
+    prefetcher->Frame = nextFrame;
+    prefetcher->IsRead = false;
+    const std::string filename = this->GetScanFileName(nextFrame);
+    prefetcher->Thread.reset(new boost::thread([prefetcher, filename]()
+    {
+      prefetcher->IsRead = ReadScan(filename, prefetcher->Scan);
+    }));
+  }
+
+  // create a new frame
   vtkSmartPointer<vtkPolyData> poly = vtkSmartPointer<vtkPolyData>::New();
+  const vtkIdType nbPoints = this->UseFloatArrays ? ConvertScan<vtkFloatArray>(scan, this->NbrLaser, poly)
+                                                  : ConvertScan<vtkDoubleArray>(scan, this->NbrLaser, poly);
+  if (nbPoints < static_cast<vtkIdType>(scan.size()))
+  {
+    vtkErrorMacro("An error occur while parsing the frame, more than 64 lasers where detected. The last point won't be processed")
+  }
 
+  // the points are copied straight from the file, in float
   vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
   points->SetDataTypeToFloat();
-  points->SetNumberOfPoints(0);
+  points->SetNumberOfPoints(nbPoints);
   points->GetData()->SetName("Points_m_XYZ");
-  poly->SetPoints(points.GetPointer());
-
-  vtkSmartPointer<vtkDoubleArray> xArray = CreateDataArray<vtkDoubleArray>("X", poly);
-  vtkSmartPointer<vtkDoubleArray> yArray = CreateDataArray<vtkDoubleArray>("Y", poly);
-  vtkSmartPointer<vtkDoubleArray> zArray = CreateDataArray<vtkDoubleArray>("Z", poly);
-  vtkSmartPointer<vtkDoubleArray> intensityArray = CreateDataArray<vtkDoubleArray>("intensity", poly);
-  vtkSmartPointer<vtkDoubleArray> azimutArray = CreateDataArray<vtkDoubleArray>("azimuth", poly);
-  vtkSmartPointer<vtkDoubleArray> elevationArray = CreateDataArray<vtkDoubleArray>("elevation", poly);
-  vtkSmartPointer<vtkDoubleArray> radiusArray = CreateDataArray<vtkDoubleArray>("radius", poly);
-  vtkSmartPointer<vtkDoubleArray> idArray = CreateDataArray<vtkDoubleArray>("laser_id", poly);
-  vtkSmartPointer<vtkDoubleArray> timestamp = CreateDataArray<vtkDoubleArray>("timestamp", poly);
-  vtkSmartPointer<vtkDoubleArray> adjustedTime = CreateDataArray<vtkDoubleArray>("adjustedtime", poly);
-
-  int startFrame = std::max(0, frameNumber);
-  for (int i = startFrame; i <= frameNumber; i++)
-  {
-    // produce path to the required .bin file
-    std::stringstream ss;
-    ss << std::setw(10) << std::setfill('0') << i;
-    std::string filename = this->GetFileName() + ss.str() + ".bin";
-
-    ifstream is;
-    is.open(filename, ios::binary|ios::in);
-    // get length of file:
-    is.seekg(0, ios::end);
-    int length = is.tellg();
-    is.seekg(0, ios::beg);
-
-    // variable used to detect a laser jump
-    double old_thetaProj = 0;
-    int laser_id = 0;
-
-    // buffer used to read the points
-    char buffer[16];
-    const int nbPoints = length / 16;
-    for (int i = 0; i < nbPoints; i++)
-    {
-      is.read(buffer, 16);
-      point_t* pt;
-      pt = reinterpret_cast<point_t*>(buffer);
-      double x = pt->x;
-      double y = pt->y;
-      double z = pt->z;
-
-      double radius = sqrt(x*x + y*y + z*z);
-      double thetaProj = 180 / vtkMath::Pi() * std::atan2(pt->y, pt->x);
-      double azimut = 180 / vtkMath::Pi() * std::atan2(pt->x, pt->y);
-
-      if (azimut < 0)
-        azimut = 360 + azimut;
-
-      if(old_thetaProj < 0 && thetaProj >= 0)
-      {
-        laser_id++;
-        if (laser_id >= this->NbrLaser)
-        {
-          vtkErrorMacro("An error occur while parsing the frame, more than 64 lasers where detected. The last point won't be processed")
-          break;
-        }
-      }
-      double projRadius = std::sqrt(pt->x * pt->x + pt->y * pt->y);
-      double elevation = 180 / vtkMath::Pi() * std::atan2(pt->z, projRadius);
-
-      double time = azimut / 360.0;
-
-      // fill the polydata
-      points->InsertNextPoint(pt->x, pt->y, pt->z);
-      xArray->InsertNextValue(pt->x);
-      yArray->InsertNextValue(pt->y);
-      zArray->InsertNextValue(pt->z);
-      radiusArray->InsertNextValue(radius);
-      intensityArray->InsertNextValue(pt->intensity);
-      azimutArray->InsertNextValue(azimut);
-      idArray->InsertNextValue(laser_id);
-      elevationArray->InsertNextValue(elevation);
-      timestamp->InsertNextValue(time);
-      adjustedTime->InsertNextValue(time);
-
-      // update old azimut
-      old_thetaProj = thetaProj;
-    }
-    is.close();
+  float* xyz = static_cast<float*>(points->GetVoidPointer(0));
+  for (vtkIdType n = 0; n < nbPoints; ++n)
+  {
+    xyz[3 * n + 0] = scan[n].x;
+    xyz[3 * n + 1] = scan[n].y;
+    xyz[3 * n + 2] = scan[n].z;
   }
+  poly->SetPoints(points.GetPointer());
 
   poly->SetVerts(NewVertexCells(poly->GetNumberOfPoints()));
 
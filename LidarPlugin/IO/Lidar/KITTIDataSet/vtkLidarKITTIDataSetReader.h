@@ -6,6 +6,8 @@
 #include <vtkSmartPointer.h>
 #include <vtkPolyData.h>
 
+#include <memory>
+
 #ifndef _WIN32
 #define notImpementedBody \
 std::cerr << typeid(this).name() << "::" << __func__ << " is not implemented" << std::endl;
@@ -44,14 +46,24 @@ public:
   void SaveFrame(int vtkNotUsed(startFrame), int vtkNotUsed(endFrame),
                  const std::string& vtkNotUsed(filename)) override {notImpementedBody}
 
+  //! Not implemented
+  vtkLidarReader* NewExportInstance() override { return nullptr; }
+
   //! Not implemented
   std::string GetSensorInformation();
 
   // return the number of channels
   vtkGetMacro(NbrLaser, int)
 
+  vtkGetMacro(UseFloatArrays, bool)
+  vtkSetMacro(UseFloatArrays, bool)
+
+  vtkGetMacro(PrefetchNextScan, bool)
+  vtkSetMacro(PrefetchNextScan, bool)
+
 private:
-  vtkLidarKITTIDataSetReader() = default;
+  vtkLidarKITTIDataSetReader();
+  ~vtkLidarKITTIDataSetReader();
 
   int RequestData(vtkInformation* request,
                           vtkInformationVector** inputVector,
@@ -71,6 +83,20 @@ private:
 
   int NbrLaser = 64;
 
+  //! Store the point arrays in float, the precision of the .bin files, instead of double.
+  //! The time arrays stay in double
+  bool UseFloatArrays = false;
+
+  //! Read the next scan in the playback direction in the background
+  bool PrefetchNextScan = true;
+
+  //! .bin file of a frame
+  std::string GetScanFileName(int frameNumber) const;
+
+  //! Scan read in the background and state of the thread reading it
+  struct ScanPrefetcher;
+  std::unique_ptr<ScanPrefetcher> NextScan;
+
   vtkLidarKITTIDataSetReader(const vtkLidarKITTIDataSetReader&) = delete;
   void operator=(const vtkLidarKITTIDataSetReader&) = delete;
 };
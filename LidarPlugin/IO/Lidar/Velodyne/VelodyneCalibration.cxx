@@ -0,0 +1,352 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "VelodyneCalibration.h"
+
+#include <boost/foreach.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <utility>
+
+using namespace DataPacketFixedLength;
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Header of the compiled calibrations, followed by a version and a byte order mark
+const char CompiledCalibrationMagic[] = "LidarViewVelodyneCalibration";
+const uint32_t CompiledCalibrationVersion = 1;
+const uint32_t ByteOrderMark = 0x01020304;
+
+//-----------------------------------------------------------------------------
+// Items of a list of the calibration, such as minIntensity_, parsed with a stream
+template<typename T, typename F>
+void ForEachItem(const boost::property_tree::ptree& list, F f)
+{
+  int index = 0;
+  BOOST_FOREACH (const boost::property_tree::ptree::value_type& v, list)
+  {
+    if (v.first == "item")
+    {
+      std::stringstream ss;
+      ss << v.second.data();
+      T value = T();
+      ss >> value;
+      f(index, value, !ss.fail());
+      index++;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void ParseXMLCalibration(std::istream& stream, VelodyneCalibration& calibration)
+{
+  boost::property_tree::ptree pt;
+  read_xml(stream, pt, boost::property_tree::xml_parser::trim_whitespace);
+
+  // Read distLSB if provided
+  BOOST_FOREACH (boost::property_tree::ptree::value_type& v, pt.get_child("boost_serialization.DB"))
+  {
+    if (v.first == "distLSB_")
+    { // Stored in cm in xml
+      calibration.DistanceResolutionM = atof(v.second.data().c_str()) / 100.0;
+    }
+  }
+
+  int i = 0;
+  BOOST_FOREACH (
+    boost::property_tree::ptree::value_type& p, pt.get_child("boost_serialization.DB.colors_"))
+  {
+    if (p.first == "item")
+    {
+      ForEachItem<double>(p.second.get_child("rgb"), [&](int j, double value, bool) {
+        if (i < HDL_MAX_NUM_LASERS && j < 3)
+        {
+          calibration.ColorTable[i][j] = value;
+        }
+      });
+      i++;
+    }
+  }
+
+  calibration.NumberOfLasers = 0;
+  ForEachItem<int>(pt.get_child("boost_serialization.DB.enabled_"), [&](int, int value, bool ok) {
+    calibration.NumberOfLasers += (ok && value == 1) ? 1 : 0;
+  });
+
+  BOOST_FOREACH (
+    boost::property_tree::ptree::value_type& v, pt.get_child("boost_serialization.DB.points_"))
+  {
+    if (v.first == "item")
+    {
+      BOOST_FOREACH (boost::property_tree::ptree::value_type& px, v.second)
+      {
+        if (px.first == "px")
+        {
+          int index = -1;
+          HDLLaserCorrection xmlData;
+          BOOST_FOREACH (boost::property_tree::ptree::value_type& item, px.second)
+          {
+            if (item.first == "id_")
+              index = atoi(item.second.data().c_str());
+            if (item.first == "rotCorrection_")
+              xmlData.rotationalCorrection = atof(item.second.data().c_str());
+            if (item.first == "vertCorrection_")
+              xmlData.verticalCorrection = atof(item.second.data().c_str());
+            if (item.first == "distCorrection_")
+              xmlData.distanceCorrection = atof(item.second.data().c_str());
+            if (item.first == "distCorrectionX_")
+              xmlData.distanceCorrectionX = atof(item.second.data().c_str());
+            if (item.first == "distCorrectionY_")
+              xmlData.distanceCorrectionY = atof(item.second.data().c_str());
+            if (item.first == "vertOffsetCorrection_")
+              xmlData.verticalOffsetCorrection = atof(item.second.data().c_str());
+            if (item.first == "horizOffsetCorrection_")
+              xmlData.horizontalOffsetCorrection = atof(item.second.data().c_str());
+            if (item.first == "focalDistance_")
+              xmlData.focalDistance = atof(item.second.data().c_str());
+            if (item.first == "focalSlope_")
+              xmlData.focalSlope = atof(item.second.data().c_str());
+            if (item.first == "closeSlope_")
+              xmlData.closeSlope = atof(item.second.data().c_str());
+          }
+          if (index >= 0 && index < HDL_MAX_NUM_LASERS)
+          {
+            HDLLaserCorrection& correction = calibration.Corrections[index];
+            correction = xmlData;
+            // Angles are already stored in degrees in xml
+            // Distances are stored in centimeters in xml, and we store meters.
+            correction.distanceCorrection /= 100.0;
+            correction.distanceCorrectionX /= 100.0;
+            correction.distanceCorrectionY /= 100.0;
+            correction.verticalOffsetCorrection /= 100.0;
+            correction.horizontalOffsetCorrection /= 100.0;
+            correction.focalDistance /= 100.0;
+            correction.focalSlope /= 100.0;
+            correction.closeSlope /= 100.0;
+            if (correction.closeSlope == 0.0)
+              correction.closeSlope = correction.focalSlope;
+          }
+        }
+      }
+    }
+  }
+
+  ForEachItem<int>(pt.get_child("boost_serialization.DB.minIntensity_"), [&](int idx, int value, bool ok) {
+    if (ok && idx < HDL_MAX_NUM_LASERS)
+    {
+      calibration.Corrections[idx].minIntensity = value;
+    }
+  });
+  ForEachItem<int>(pt.get_child("boost_serialization.DB.maxIntensity_"), [&](int idx, int value, bool ok) {
+    if (ok && idx < HDL_MAX_NUM_LASERS)
+    {
+      calibration.Corrections[idx].maxIntensity = value;
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+// Values of the compiled calibrations, written as raw bytes
+template<typename T>
+void Write(std::ostream& stream, const T& value)
+{
+  stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+//-----------------------------------------------------------------------------
+class CompiledCalibrationReader
+{
+public:
+  CompiledCalibrationReader(const std::string& content, size_t offset)
+    : Content(content), Offset(offset)
+  {
+  }
+
+  template<typename T>
+  T Read()
+  {
+    T value = T();
+    if (this->Offset + sizeof(T) <= this->Content.size())
+    {
+      std::memcpy(&value, this->Content.data() + this->Offset, sizeof(T));
+    }
+    this->Offset += sizeof(T);
+    return value;
+  }
+
+  bool IsComplete() const { return this->Offset == this->Content.size(); }
+
+private:
+  const std::string& Content;
+  size_t Offset;
+};
+
+//-----------------------------------------------------------------------------
+bool ParseCompiledCalibration(
+  const std::string& content, VelodyneCalibration& calibration, std::string& error)
+{
+  CompiledCalibrationReader reader(content, sizeof(CompiledCalibrationMagic));
+  if (reader.Read<uint32_t>() != CompiledCalibrationVersion)
+  {
+    error = "unsupported version of compiled calibration";
+    return false;
+  }
+  if (reader.Read<uint32_t>() != ByteOrderMark)
+  {
+    error = "compiled calibration written with another byte order";
+    return false;
+  }
+  calibration.DistanceResolutionM = reader.Read<double>();
+  calibration.NumberOfLasers = reader.Read<int32_t>();
+  for (int i = 0; i < HDL_MAX_NUM_LASERS; ++i)
+  {
+    for (int j = 0; j < 3; ++j)
+    {
+      calibration.ColorTable[i][j] = reader.Read<double>();
+    }
+  }
+  for (int i = 0; i < HDL_MAX_NUM_LASERS; ++i)
+  {
+    HDLLaserCorrection& correction = calibration.Corrections[i];
+    correction.rotationalCorrection = reader.Read<double>();
+    correction.verticalCorrection = reader.Read<double>();
+    correction.distanceCorrection = reader.Read<double>();
+    correction.distanceCorrectionX = reader.Read<double>();
+    correction.distanceCorrectionY = reader.Read<double>();
+    correction.verticalOffsetCorrection = reader.Read<double>();
+    correction.horizontalOffsetCorrection = reader.Read<double>();
+    correction.focalDistance = reader.Read<double>();
+    correction.focalSlope = reader.Read<double>();
+    correction.closeSlope = reader.Read<double>();
+    correction.minIntensity = reader.Read<int16_t>();
+    correction.maxIntensity = reader.Read<int16_t>();
+  }
+  if (!reader.IsComplete())
+  {
+    error = "truncated or corrupted compiled calibration";
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Calibrations already parsed, keyed by the size and the hash of their content
+boost::mutex CalibrationCacheMutex;
+std::map<std::pair<size_t, size_t>, std::shared_ptr<const VelodyneCalibration> > CalibrationCache;
+}
+
+//-----------------------------------------------------------------------------
+bool ParseVelodyneCalibration(
+  const std::string& content, VelodyneCalibration& calibration, std::string& error)
+{
+  const size_t magicLength = sizeof(CompiledCalibrationMagic);
+  if (content.size() >= magicLength &&
+    std::memcmp(content.data(), CompiledCalibrationMagic, magicLength) == 0)
+  {
+    return ParseCompiledCalibration(content, calibration, error);
+  }
+
+  try
+  {
+    std::istringstream stream(content);
+    ParseXMLCalibration(stream, calibration);
+  }
+  catch (const boost::property_tree::ptree_error& e)
+  {
+    error = e.what();
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool WriteCompiledVelodyneCalibration(const VelodyneCalibration& calibration, std::ostream& stream)
+{
+  stream.write(CompiledCalibrationMagic, sizeof(CompiledCalibrationMagic));
+  Write(stream, CompiledCalibrationVersion);
+  Write(stream, ByteOrderMark);
+  Write(stream, calibration.DistanceResolutionM);
+  Write(stream, static_cast<int32_t>(calibration.NumberOfLasers));
+  for (int i = 0; i < HDL_MAX_NUM_LASERS; ++i)
+  {
+    for (int j = 0; j < 3; ++j)
+    {
+      Write(stream, calibration.ColorTable[i][j]);
+    }
+  }
+  for (int i = 0; i < HDL_MAX_NUM_LASERS; ++i)
+  {
+    const HDLLaserCorrection& correction = calibration.Corrections[i];
+    Write(stream, correction.rotationalCorrection);
+    Write(stream, correction.verticalCorrection);
+    Write(stream, correction.distanceCorrection);
+    Write(stream, correction.distanceCorrectionX);
+    Write(stream, correction.distanceCorrectionY);
+    Write(stream, correction.verticalOffsetCorrection);
+    Write(stream, correction.horizontalOffsetCorrection);
+    Write(stream, correction.focalDistance);
+    Write(stream, correction.focalSlope);
+    Write(stream, correction.closeSlope);
+    Write(stream, static_cast<int16_t>(correction.minIntensity));
+    Write(stream, static_cast<int16_t>(correction.maxIntensity));
+  }
+  return stream.good();
+}
+
+//-----------------------------------------------------------------------------
+std::shared_ptr<const VelodyneCalibration> LoadVelodyneCalibration(
+  const std::string& filename, std::string& error)
+{
+  std::ifstream file(filename, std::ios::binary);
+  std::stringstream content;
+  content << file.rdbuf();
+  if (!file || content.fail())
+  {
+    error = "can not read the file";
+    return nullptr;
+  }
+  const std::string data = content.str();
+  const std::pair<size_t, size_t> key(data.size(), std::hash<std::string>()(data));
+
+  {
+    boost::lock_guard<boost::mutex> lock(CalibrationCacheMutex);
+    auto cached = CalibrationCache.find(key);
+    if (cached != CalibrationCache.end())
+    {
+      return cached->second;
+    }
+  }
+
+  // parsed without lock, two threads loading the same new file both parse it
+  auto calibration = std::make_shared<VelodyneCalibration>();
+  if (!ParseVelodyneCalibration(data, *calibration, error))
+  {
+    return nullptr;
+  }
+  boost::lock_guard<boost::mutex> lock(CalibrationCacheMutex);
+  return CalibrationCache.emplace(key, calibration).first->second;
+}
@@ -0,0 +1,74 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VELODYNECALIBRATION_H
+#define VELODYNECALIBRATION_H
+
+#include "vtkDataPacket.h"
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+/**
+ * \struct VelodyneCalibration
+ * \brief Content of a Velodyne calibration file, the distances being converted to
+ *        meters. The precomputed values of the corrections are not set.
+ */
+struct VelodyneCalibration
+{
+  //! Distance resolution in meters, 0 if the file does not give it
+  double DistanceResolutionM = 0.;
+
+  //! Number of lasers enabled by the file
+  int NumberOfLasers = 0;
+
+  double ColorTable[DataPacketFixedLength::HDL_MAX_NUM_LASERS][3] = {};
+
+  DataPacketFixedLength::HDLLaserCorrection Corrections[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+};
+
+/**
+ * @brief ParseVelodyneCalibration parses a calibration, either the xml file given
+ * by the sensor or the compiled file written by WriteCompiledVelodyneCalibration,
+ * which is recognized by its header.
+ * @param content the content of the file
+ * @param calibration the parsed calibration
+ * @param error the reason of the failure, if any
+ * @return false if the content is not a valid calibration
+ */
+bool ParseVelodyneCalibration(
+  const std::string& content, VelodyneCalibration& calibration, std::string& error);
+
+/**
+ * @brief WriteCompiledVelodyneCalibration writes a calibration in a binary form
+ * which is parsed without any conversion. The values are written in the byte order
+ * of the machine, a compiled file is rejected by a machine of another byte order.
+ */
+bool WriteCompiledVelodyneCalibration(const VelodyneCalibration& calibration, std::ostream& stream);
+
+/**
+ * @brief LoadVelodyneCalibration returns the calibration of a file. The calibrations
+ * are cached for the whole process, keyed by the hash of the content of the file,
+ * so that the interpreters opening the same calibration share it and only pay for
+ * reading the file. The calibration is immutable once cached.
+ * @return nullptr if the file can not be read or is not a valid calibration
+ */
+std::shared_ptr<const VelodyneCalibration> LoadVelodyneCalibration(
+  const std::string& filename, std::string& error);
+
+#endif // VELODYNECALIBRATION_H
@@ -0,0 +1,591 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "VelodyneFiringDecoder.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FIRING_DECODER_HAS_AVX2
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define FIRING_DECODER_HAS_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace DataPacketFixedLength;
+
+namespace
+{
+typedef void (*FiringPositionsFunction)(const LaserCorrectionArrays&, int, double, FiringBuffer&);
+typedef void (*FiringIntensitiesFunction)(const LaserCorrectionArrays&, int, FiringBuffer&);
+typedef void (*FiringTransformFunction)(const double*, FiringBuffer&);
+
+//-----------------------------------------------------------------------------
+//! Term of the intensity correction depending on the raw distance, for each raw distance
+const double* GetDistanceIntensityTerms()
+{
+  struct Terms
+  {
+    double Values[65536];
+    Terms()
+    {
+      // as in the manual, the distance is the raw one
+      for (int distance = 0; distance < 65536; ++distance)
+      {
+        this->Values[distance] = 256 * std::pow(1.0 - static_cast<double>(distance) / 65535.0f, 2);
+      }
+    }
+  };
+  // thread safe initialization, done once
+  static const Terms terms;
+  return terms.Values;
+}
+
+#ifdef FIRING_DECODER_HAS_AVX2
+//-----------------------------------------------------------------------------
+// Multiplications and additions are kept separate (no FMA) to give exactly
+// the same results as the scalar implementation
+__attribute__((target("avx2")))
+void ComputeFiringPositionsAVX2(const LaserCorrectionArrays& c, int laserOffset,
+                                double distanceResolution, FiringBuffer& b)
+{
+  const __m256d resolution = _mm256_set1_pd(distanceResolution);
+  for (int i = 0; i < HDL_LASER_PER_FIRING; i += 4)
+  {
+    const int l = laserOffset + i;
+    const __m256d cosTable = _mm256_load_pd(b.CosAzimuth + i);
+    const __m256d sinTable = _mm256_load_pd(b.SinAzimuth + i);
+    const __m256d cosRot = _mm256_loadu_pd(c.CosRotationalCorrection + l);
+    const __m256d sinRot = _mm256_loadu_pd(c.SinRotationalCorrection + l);
+
+    // cos(a-b) = cos(a)*cos(b) + sin(a)*sin(b)
+    // sin(a-b) = sin(a)*cos(b) - cos(a)*sin(b)
+    const __m256d cosAzimuth =
+      _mm256_add_pd(_mm256_mul_pd(cosTable, cosRot), _mm256_mul_pd(sinTable, sinRot));
+    const __m256d sinAzimuth =
+      _mm256_sub_pd(_mm256_mul_pd(sinTable, cosRot), _mm256_mul_pd(cosTable, sinRot));
+
+    const __m256d distance = _mm256_add_pd(
+      _mm256_mul_pd(_mm256_load_pd(b.RawDistance + i), resolution),
+      _mm256_loadu_pd(c.DistanceCorrection + l));
+    const __m256d xyDistance =
+      _mm256_sub_pd(_mm256_mul_pd(distance, _mm256_loadu_pd(c.CosVertCorrection + l)),
+                    _mm256_loadu_pd(c.SinVertOffsetCorrection + l));
+    const __m256d horizontalOffset = _mm256_loadu_pd(c.HorizontalOffsetCorrection + l);
+
+    _mm256_store_pd(b.X + i, _mm256_sub_pd(_mm256_mul_pd(xyDistance, sinAzimuth),
+                                           _mm256_mul_pd(horizontalOffset, cosAzimuth)));
+    _mm256_store_pd(b.Y + i, _mm256_add_pd(_mm256_mul_pd(xyDistance, cosAzimuth),
+                                           _mm256_mul_pd(horizontalOffset, sinAzimuth)));
+    _mm256_store_pd(b.Z + i,
+                    _mm256_add_pd(_mm256_mul_pd(distance, _mm256_loadu_pd(c.SinVertCorrection + l)),
+                                  _mm256_loadu_pd(c.VerticalOffsetCorrection + l)));
+    _mm256_store_pd(b.Distance + i, distance);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// The masked gather, with all the lanes enabled, avoids a spurious uninitialized
+// warning of some GCC versions on the source of the unmasked one
+__attribute__((target("avx2")))
+inline __m256d GatherAVX2(const double* table, __m128i index)
+{
+  return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), table, index,
+                                  _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+}
+
+//-----------------------------------------------------------------------------
+__attribute__((target("avx2")))
+void ComputeFiringIntensitiesAVX2(const LaserCorrectionArrays& c, int laserOffset, FiringBuffer& b)
+{
+  const double* distanceTerms = GetDistanceIntensityTerms();
+  const double* rescaled = &c.RescaledIntensity[0][0];
+  const __m256d signMask = _mm256_set1_pd(-0.);
+  const __m256d maxIntensity = _mm256_set1_pd(255.);
+  for (int i = 0; i < HDL_LASER_PER_FIRING; i += 4)
+  {
+    const int l = laserOffset + i;
+    const __m128i intensityIndex = _mm_add_epi32(
+      _mm_load_si128(reinterpret_cast<const __m128i*>(b.RawIntensity + i)),
+      _mm_setr_epi32(256 * l, 256 * (l + 1), 256 * (l + 2), 256 * (l + 3)));
+    const __m128i distanceIndex = _mm256_cvttpd_epi32(_mm256_load_pd(b.RawDistance + i));
+    const __m256d intensity = GatherAVX2(rescaled, intensityIndex);
+    const __m256d focal = _mm256_andnot_pd(signMask,
+      _mm256_sub_pd(_mm256_loadu_pd(c.FocalOffset + l), GatherAVX2(distanceTerms, distanceIndex)));
+    const __m256d corrected =
+      _mm256_add_pd(intensity, _mm256_mul_pd(_mm256_loadu_pd(c.FocalSlope + l), focal));
+    _mm256_store_pd(b.Intensity + i, _mm256_max_pd(_mm256_min_pd(corrected, maxIntensity),
+                                                   _mm256_loadu_pd(c.MinIntensity + l)));
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Same order of the operations as vtkLinearTransformPoint, without FMA
+__attribute__((target("avx2")))
+void TransformFiringPositionsAVX2(const double* m, FiringBuffer& b)
+{
+  __m256d row[3][4];
+  for (int r = 0; r < 3; ++r)
+  {
+    for (int c = 0; c < 4; ++c)
+    {
+      row[r][c] = _mm256_set1_pd(m[4 * r + c]);
+    }
+  }
+  for (int i = 0; i < HDL_LASER_PER_FIRING; i += 4)
+  {
+    const __m256d x = _mm256_load_pd(b.X + i);
+    const __m256d y = _mm256_load_pd(b.Y + i);
+    const __m256d z = _mm256_load_pd(b.Z + i);
+    double* outputs[3] = { b.X + i, b.Y + i, b.Z + i };
+    for (int r = 0; r < 3; ++r)
+    {
+      _mm256_store_pd(outputs[r], _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(
+        _mm256_mul_pd(row[r][0], x), _mm256_mul_pd(row[r][1], y)), _mm256_mul_pd(row[r][2], z)),
+        row[r][3]));
+    }
+  }
+}
+#endif
+
+#ifdef FIRING_DECODER_HAS_NEON
+//-----------------------------------------------------------------------------
+// vmulq/vaddq are used instead of vfmaq to give exactly the same results as
+// the scalar implementation
+void ComputeFiringPositionsNEON(const LaserCorrectionArrays& c, int laserOffset,
+                                double distanceResolution, FiringBuffer& b)
+{
+  const float64x2_t resolution = vdupq_n_f64(distanceResolution);
+  for (int i = 0; i < HDL_LASER_PER_FIRING; i += 2)
+  {
+    const int l = laserOffset + i;
+    const float64x2_t cosTable = vld1q_f64(b.CosAzimuth + i);
+    const float64x2_t sinTable = vld1q_f64(b.SinAzimuth + i);
+    const float64x2_t cosRot = vld1q_f64(c.CosRotationalCorrection + l);
+    const float64x2_t sinRot = vld1q_f64(c.SinRotationalCorrection + l);
+
+    const float64x2_t cosAzimuth =
+      vaddq_f64(vmulq_f64(cosTable, cosRot), vmulq_f64(sinTable, sinRot));
+    const float64x2_t sinAzimuth =
+      vsubq_f64(vmulq_f64(sinTable, cosRot), vmulq_f64(cosTable, sinRot));
+
+    const float64x2_t distance = vaddq_f64(vmulq_f64(vld1q_f64(b.RawDistance + i), resolution),
+                                           vld1q_f64(c.DistanceCorrection + l));
+    const float64x2_t xyDistance = vsubq_f64(vmulq_f64(distance, vld1q_f64(c.CosVertCorrection + l)),
+                                             vld1q_f64(c.SinVertOffsetCorrection + l));
+    const float64x2_t horizontalOffset = vld1q_f64(c.HorizontalOffsetCorrection + l);
+
+    vst1q_f64(b.X + i, vsubq_f64(vmulq_f64(xyDistance, sinAzimuth),
+                                 vmulq_f64(horizontalOffset, cosAzimuth)));
+    vst1q_f64(b.Y + i, vaddq_f64(vmulq_f64(xyDistance, cosAzimuth),
+                                 vmulq_f64(horizontalOffset, sinAzimuth)));
+    vst1q_f64(b.Z + i, vaddq_f64(vmulq_f64(distance, vld1q_f64(c.SinVertCorrection + l)),
+                                 vld1q_f64(c.VerticalOffsetCorrection + l)));
+    vst1q_f64(b.Distance + i, distance);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void TransformFiringPositionsNEON(const double* m, FiringBuffer& b)
+{
+  for (int i = 0; i < HDL_LASER_PER_FIRING; i += 2)
+  {
+    const float64x2_t x = vld1q_f64(b.X + i);
+    const float64x2_t y = vld1q_f64(b.Y + i);
+    const float64x2_t z = vld1q_f64(b.Z + i);
+    double* outputs[3] = { b.X + i, b.Y + i, b.Z + i };
+    for (int r = 0; r < 3; ++r)
+    {
+      const double* row = m + 4 * r;
+      vst1q_f64(outputs[r], vaddq_f64(vaddq_f64(vaddq_f64(vmulq_n_f64(x, row[0]),
+        vmulq_n_f64(y, row[1])), vmulq_n_f64(z, row[2])), vdupq_n_f64(row[3])));
+    }
+  }
+}
+#endif
+
+//-----------------------------------------------------------------------------
+struct FiringPositionsImplementation
+{
+  FiringPositionsFunction Function;
+  FiringIntensitiesFunction IntensitiesFunction;
+  FiringTransformFunction TransformFunction;
+  const char* Name;
+};
+
+//-----------------------------------------------------------------------------
+FiringPositionsImplementation SelectImplementation()
+{
+#ifdef FIRING_DECODER_HAS_AVX2
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+  {
+    return { &ComputeFiringPositionsAVX2, &ComputeFiringIntensitiesAVX2, &TransformFiringPositionsAVX2,
+             "AVX2" };
+  }
+#endif
+#ifdef FIRING_DECODER_HAS_NEON
+  // without gather instructions, the tables are read as fast by the scalar implementation
+  return { &ComputeFiringPositionsNEON, &ComputeFiringIntensitiesScalar, &TransformFiringPositionsNEON,
+           "NEON" };
+#else
+  return { &ComputeFiringPositionsScalar, &ComputeFiringIntensitiesScalar,
+           &TransformFiringPositionsScalar, "scalar" };
+#endif
+}
+
+//-----------------------------------------------------------------------------
+const FiringPositionsImplementation& GetImplementation()
+{
+  // thread safe initialization, done once
+  static const FiringPositionsImplementation implementation = SelectImplementation();
+  return implementation;
+}
+
+//-----------------------------------------------------------------------------
+// Offsets in microseconds of the returns from the start of the packet, as given by the
+// sensor manuals. They are constexpr so that the timing tables are built by the compiler.
+constexpr int FloorDivide(int a, int b)
+{
+  return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+//-----------------------------------------------------------------------------
+constexpr double HDL32AdjustTimeStamp(int firingblock, int dsr, bool isDualReturnMode)
+{
+  return (isDualReturnMode ? firingblock / 2 : firingblock) * 46.08 + (dsr * 1.152);
+}
+
+//-----------------------------------------------------------------------------
+constexpr double VLP16AdjustTimeStamp(
+  int firingblock, int dsr, int firingwithinblock, bool isDualReturnMode)
+{
+  return (isDualReturnMode ? firingblock / 2 : firingblock) * 110.592 + (dsr * 2.304) +
+    (firingwithinblock * 55.296);
+}
+
+//-----------------------------------------------------------------------------
+constexpr double VLP32AdjustTimeStamp(int firingblock, int dsr, bool isDualReturnMode)
+{
+  return (isDualReturnMode ? firingblock / 2 : firingblock) * 55.296 + (dsr / 2) * 2.304;
+}
+
+//-----------------------------------------------------------------------------
+constexpr double HDL64EAdjustTimeStamp(int firingblock, int dsr, bool isDualReturnMode)
+{
+  const int dsrReversed = HDL_LASER_PER_FIRING - dsr - 1;
+  const int firingblockReversed = HDL_FIRING_PER_PKT - firingblock - 1;
+  const double singleOffsets[4] = { 2.34, 3.54, 4.74, 6.0 };
+  const double dualOffsets[4] = { 3.5, 4.7, 5.9, 7.2 };
+  const double* offsets = isDualReturnMode ? dualOffsets : singleOffsets;
+  // the next firing block of the last ones has a negative reversed index
+  return (isDualReturnMode ? FloorDivide(firingblockReversed, 4) * 57.6
+                           : FloorDivide(firingblockReversed, 2) * 48.0) +
+    offsets[dsrReversed % 4] + (dsrReversed / 4) * offsets[3];
+}
+
+//-----------------------------------------------------------------------------
+constexpr double VLS128AdjustTimeStamp(int firingblock, int dsr, bool isDualReturnMode)
+{
+  return 13.0 * (isDualReturnMode ? firingblock / 2 : firingblock) + (dsr / 4) * 1.4;
+}
+
+//-----------------------------------------------------------------------------
+// Same rounding as vtkMath::Round
+constexpr double Round(double value)
+{
+  return static_cast<double>(static_cast<int>(value >= 0. ? value + 0.5 : value - 0.5));
+}
+
+//-----------------------------------------------------------------------------
+// Offset of a return, with the offsets of the first returns of its firing block and
+// of the next firing block between which its azimuth is interpolated
+struct ReturnTiming
+{
+  double Return;
+  double Block;
+  double NextBlock;
+};
+
+//-----------------------------------------------------------------------------
+constexpr ReturnTiming GetReturnTiming(FiringTimingModel model, bool dual, int block, int dsr)
+{
+  switch (model)
+  {
+    case FiringTimingModel::VLS128:
+      return { VLS128AdjustTimeStamp(block, dsr, dual),
+               VLS128AdjustTimeStamp(block, 0, dual),
+               VLS128AdjustTimeStamp(block + (dual ? 8 : 4), 0, dual) };
+    case FiringTimingModel::HDL64:
+      return { -HDL64EAdjustTimeStamp(block, dsr, dual),
+               -HDL64EAdjustTimeStamp(block, 0, dual),
+               -HDL64EAdjustTimeStamp(block + (dual ? 4 : 2), 0, dual) };
+    case FiringTimingModel::VLP32:
+      return { VLP32AdjustTimeStamp(block, dsr, dual),
+               VLP32AdjustTimeStamp(block, 0, dual),
+               VLP32AdjustTimeStamp(block + (dual ? 2 : 1), 0, dual) };
+    case FiringTimingModel::HDL32:
+      return { HDL32AdjustTimeStamp(block, dsr, dual),
+               HDL32AdjustTimeStamp(block, 0, dual),
+               HDL32AdjustTimeStamp(block + (dual ? 2 : 1), 0, dual) };
+    case FiringTimingModel::VLP16:
+      // the second half of the returns of a firing block belong to a second firing
+      return { VLP16AdjustTimeStamp(block, dsr % 16, dsr / 16, dual),
+               VLP16AdjustTimeStamp(block, 0, 0, dual),
+               VLP16AdjustTimeStamp(block + (dual ? 2 : 1), 0, 0, dual) };
+    default:
+      return { 0., 0., 1. };
+  }
+}
+
+//-----------------------------------------------------------------------------
+constexpr FiringTimingTable MakeFiringTimingTable(FiringTimingModel model, bool dual)
+{
+  FiringTimingTable table{};
+  for (int block = 0; block < HDL_FIRING_PER_PKT; ++block)
+  {
+    for (int dsr = 0; dsr < HDL_LASER_PER_FIRING; ++dsr)
+    {
+      const ReturnTiming timing = GetReturnTiming(model, dual, block, dsr);
+      table.TimestampAdjustment[block][dsr] = Round(timing.Return);
+      table.AzimuthFraction[block][dsr] =
+        (timing.Return - timing.Block) / (timing.NextBlock - timing.Block);
+    }
+  }
+  return table;
+}
+
+//-----------------------------------------------------------------------------
+template<FiringTimingModel Model, bool IsDual>
+const FiringTimingTable& FiringTimingTableOf()
+{
+  static constexpr FiringTimingTable table = MakeFiringTimingTable(Model, IsDual);
+  return table;
+}
+
+//-----------------------------------------------------------------------------
+template<FiringTimingModel Model>
+const FiringTimingTable& FiringTimingTableOf(bool isDual)
+{
+  return isDual ? FiringTimingTableOf<Model, true>() : FiringTimingTableOf<Model, false>();
+}
+
+//-----------------------------------------------------------------------------
+// Returns true if value is the element of the given rank of the sorted differences,
+// otherwise below tells on which side it is
+bool IsElementOfRank(const int* diffs, int numberOfDiffs, int rank, int value, int& below)
+{
+  below = 0;
+  int equal = 0;
+  for (int i = 0; i < numberOfDiffs; ++i)
+  {
+    // no branch, the comparisons are not predictable
+    below += static_cast<int>(diffs[i] < value);
+    equal += static_cast<int>(diffs[i] == value);
+  }
+  return below <= rank && rank < below + equal;
+}
+}
+
+//-----------------------------------------------------------------------------
+void LaserCorrectionArrays::Set(const HDLLaserCorrection* corrections)
+{
+  for (int i = 0; i < HDL_MAX_NUM_LASERS; ++i)
+  {
+    const HDLLaserCorrection& correction = corrections[i];
+    this->CosRotationalCorrection[i] = correction.cosRotationalCorrection;
+    this->SinRotationalCorrection[i] = correction.sinRotationalCorrection;
+    this->DistanceCorrection[i] = correction.distanceCorrection;
+    this->CosVertCorrection[i] = correction.cosVertCorrection;
+    this->SinVertCorrection[i] = correction.sinVertCorrection;
+    this->SinVertOffsetCorrection[i] = correction.sinVertOffsetCorrection;
+    this->HorizontalOffsetCorrection[i] = correction.horizontalOffsetCorrection;
+    this->VerticalOffsetCorrection[i] = correction.verticalOffsetCorrection;
+
+    // the lasers without min and max intensities keep their raw intensity
+    const bool isCorrected = correction.minIntensity < correction.maxIntensity;
+    const double minIntensity = static_cast<double>(correction.minIntensity);
+    const double maxIntensity = static_cast<double>(correction.maxIntensity);
+    for (int intensity = 0; intensity < 256; ++intensity)
+    {
+      this->RescaledIntensity[i][intensity] = isCorrected
+        ? std::max((intensity - minIntensity) / (maxIntensity - minIntensity) * 255.0, 0.0)
+        : intensity;
+    }
+    // the manual gives the focal distance in centimeters
+    this->FocalOffset[i] = isCorrected ? 256 * std::pow(1.0 - correction.focalDistance / 131.0, 2) : 0.;
+    this->FocalSlope[i] = isCorrected ? correction.focalSlope : 0.;
+    this->MinIntensity[i] = isCorrected ? 1. : 0.;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void ComputeFiringPositionsScalar(const LaserCorrectionArrays& c, int laserOffset,
+                                  double distanceResolution, FiringBuffer& b)
+{
+  for (int i = 0; i < HDL_LASER_PER_FIRING; ++i)
+  {
+    const int l = laserOffset + i;
+    // realAzimuth = azimuth/100 - rotationalCorrection
+    // cos(a-b) = cos(a)*cos(b) + sin(a)*sin(b)
+    // sin(a-b) = sin(a)*cos(b) - cos(a)*sin(b)
+    const double cosAzimuth =
+      b.CosAzimuth[i] * c.CosRotationalCorrection[l] + b.SinAzimuth[i] * c.SinRotationalCorrection[l];
+    const double sinAzimuth =
+      b.SinAzimuth[i] * c.CosRotationalCorrection[l] - b.CosAzimuth[i] * c.SinRotationalCorrection[l];
+
+    // Compute the distance in the xy plane (w/o accounting for rotation)
+    const double distance = b.RawDistance[i] * distanceResolution + c.DistanceCorrection[l];
+    const double xyDistance = distance * c.CosVertCorrection[l] - c.SinVertOffsetCorrection[l];
+
+    b.X[i] = xyDistance * sinAzimuth - c.HorizontalOffsetCorrection[l] * cosAzimuth;
+    b.Y[i] = xyDistance * cosAzimuth + c.HorizontalOffsetCorrection[l] * sinAzimuth;
+    b.Z[i] = distance * c.SinVertCorrection[l] + c.VerticalOffsetCorrection[l];
+    b.Distance[i] = distance;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void ComputeFiringPositions(const LaserCorrectionArrays& corrections, int laserOffset,
+                            double distanceResolution, FiringBuffer& buffer)
+{
+  GetImplementation().Function(corrections, laserOffset, distanceResolution, buffer);
+}
+
+//-----------------------------------------------------------------------------
+const char* GetFiringPositionsImplementationName()
+{
+  return GetImplementation().Name;
+}
+
+//-----------------------------------------------------------------------------
+void ComputeFiringIntensitiesScalar(const LaserCorrectionArrays& c, int laserOffset, FiringBuffer& b)
+{
+  const double* distanceTerms = GetDistanceIntensityTerms();
+  for (int i = 0; i < HDL_LASER_PER_FIRING; ++i)
+  {
+    const int l = laserOffset + i;
+    const double focal =
+      std::abs(c.FocalOffset[l] - distanceTerms[static_cast<int>(b.RawDistance[i])]);
+    const double corrected = c.RescaledIntensity[l][b.RawIntensity[i]] + c.FocalSlope[l] * focal;
+    b.Intensity[i] = std::max(std::min(corrected, 255.), c.MinIntensity[l]);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void ComputeFiringIntensities(const LaserCorrectionArrays& corrections, int laserOffset,
+                              FiringBuffer& buffer)
+{
+  GetImplementation().IntensitiesFunction(corrections, laserOffset, buffer);
+}
+
+//-----------------------------------------------------------------------------
+void TransformFiringPositionsScalar(const double m[12], FiringBuffer& b)
+{
+  for (int i = 0; i < HDL_LASER_PER_FIRING; ++i)
+  {
+    const double x = b.X[i];
+    const double y = b.Y[i];
+    const double z = b.Z[i];
+    b.X[i] = m[0] * x + m[1] * y + m[2] * z + m[3];
+    b.Y[i] = m[4] * x + m[5] * y + m[6] * z + m[7];
+    b.Z[i] = m[8] * x + m[9] * y + m[10] * z + m[11];
+  }
+}
+
+//-----------------------------------------------------------------------------
+void TransformFiringPositions(const double matrix[12], FiringBuffer& buffer)
+{
+  GetImplementation().TransformFunction(matrix, buffer);
+}
+
+//-----------------------------------------------------------------------------
+const FiringTimingTable& GetFiringTimingTable(FiringTimingModel model, bool isDualReturnPacket)
+{
+  switch (model)
+  {
+    case FiringTimingModel::HDL32:
+      return FiringTimingTableOf<FiringTimingModel::HDL32>(isDualReturnPacket);
+    case FiringTimingModel::VLP16:
+      return FiringTimingTableOf<FiringTimingModel::VLP16>(isDualReturnPacket);
+    case FiringTimingModel::VLP32:
+      return FiringTimingTableOf<FiringTimingModel::VLP32>(isDualReturnPacket);
+    case FiringTimingModel::HDL64:
+      return FiringTimingTableOf<FiringTimingModel::HDL64>(isDualReturnPacket);
+    case FiringTimingModel::VLS128:
+      return FiringTimingTableOf<FiringTimingModel::VLS128>(isDualReturnPacket);
+    default:
+      return FiringTimingTableOf<FiringTimingModel::None, false>();
+  }
+}
+
+//-----------------------------------------------------------------------------
+const int* AzimuthAdjustmentCache::Get(const FiringTimingTable& table, int firingBlock,
+                                       int azimuthDiff)
+{
+  int* adjustments = this->Adjustments[firingBlock];
+  if (this->Table[firingBlock] != &table || this->AzimuthDiff[firingBlock] != azimuthDiff)
+  {
+    const double* fractions = table.AzimuthFraction[firingBlock];
+    for (int dsr = 0; dsr < HDL_LASER_PER_FIRING; ++dsr)
+    {
+      // same rounding as vtkMath::Round
+      const double adjustment = azimuthDiff * fractions[dsr];
+      adjustments[dsr] = static_cast<int>(adjustment >= 0. ? adjustment + 0.5 : adjustment - 0.5);
+    }
+    this->Table[firingBlock] = &table;
+    this->AzimuthDiff[firingBlock] = azimuthDiff;
+  }
+  return adjustments;
+}
+
+//-----------------------------------------------------------------------------
+int AzimuthStepEstimator::Update(int* azimuthDiffs, int numberOfDiffs, int rank)
+{
+  if (this->HasLastStep)
+  {
+    int below = 0;
+    if (IsElementOfRank(azimuthDiffs, numberOfDiffs, rank, this->LastStep, below))
+    {
+      return this->LastStep;
+    }
+    // the rotation speed has slightly changed: the step is on the side given by the count
+    const int neighbour = below > rank ? this->LastStep - 1 : this->LastStep + 1;
+    if (IsElementOfRank(azimuthDiffs, numberOfDiffs, rank, neighbour, below))
+    {
+      this->LastStep = neighbour;
+      return neighbour;
+    }
+    ++this->NumberOfMispredictions;
+  }
+
+  std::nth_element(azimuthDiffs, azimuthDiffs + rank, azimuthDiffs + numberOfDiffs);
+  this->LastStep = azimuthDiffs[rank];
+  this->HasLastStep = true;
+  return this->LastStep;
+}
+
+//-----------------------------------------------------------------------------
+void AzimuthStepEstimator::Reset()
+{
+  this->HasLastStep = false;
+  this->NumberOfMispredictions = 0;
+}
@@ -0,0 +1,251 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VELODYNEFIRINGDECODER_H
+#define VELODYNEFIRINGDECODER_H
+
+#include "vtkDataPacket.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * \struct LaserCorrectionArrays
+ * \brief Per laser corrections used to compute the position of a return, stored
+ *        as one contiguous array per correction so that a whole firing can be
+ *        processed with SIMD instructions.
+ *
+ * The arrays are not over-aligned so that the structure can be allocated with new;
+ * the firing buffer, which is allocated on the stack, is aligned.
+ */
+struct LaserCorrectionArrays
+{
+  double CosRotationalCorrection[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  double SinRotationalCorrection[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  double DistanceCorrection[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  double CosVertCorrection[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  double SinVertCorrection[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  double SinVertOffsetCorrection[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  double HorizontalOffsetCorrection[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  double VerticalOffsetCorrection[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+
+  // intensity correction of the HDL-64, see ComputeFiringIntensities
+  double FocalOffset[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  double FocalSlope[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  //! Lower bound of the intensity, 1 for the lasers whose intensity is corrected, 0 otherwise
+  double MinIntensity[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  //! Raw intensity of each laser rescaled between its min and max intensities
+  double RescaledIntensity[DataPacketFixedLength::HDL_MAX_NUM_LASERS][256];
+
+  //! Copy the corrections, whose cos/sin must already be precomputed, and tabulate
+  //! the intensity correction
+  void Set(const DataPacketFixedLength::HDLLaserCorrection* corrections);
+};
+
+/**
+ * \struct FiringBuffer
+ * \brief Inputs and outputs of the position computation of the returns of one firing.
+ *        Meant to be allocated on the stack.
+ */
+struct FiringBuffer
+{
+  // inputs: cos/sin of the azimuth of each return (before rotational correction)
+  // and raw distance
+  alignas(32) double CosAzimuth[DataPacketFixedLength::HDL_LASER_PER_FIRING];
+  alignas(32) double SinAzimuth[DataPacketFixedLength::HDL_LASER_PER_FIRING];
+  alignas(32) double RawDistance[DataPacketFixedLength::HDL_LASER_PER_FIRING];
+  //! only needed by ComputeFiringIntensities
+  alignas(32) int32_t RawIntensity[DataPacketFixedLength::HDL_LASER_PER_FIRING];
+
+  // outputs: position and corrected distance of each return
+  alignas(32) double X[DataPacketFixedLength::HDL_LASER_PER_FIRING];
+  alignas(32) double Y[DataPacketFixedLength::HDL_LASER_PER_FIRING];
+  alignas(32) double Z[DataPacketFixedLength::HDL_LASER_PER_FIRING];
+  alignas(32) double Distance[DataPacketFixedLength::HDL_LASER_PER_FIRING];
+  //! only written by ComputeFiringIntensities, to be truncated to an integer
+  alignas(32) double Intensity[DataPacketFixedLength::HDL_LASER_PER_FIRING];
+};
+
+/**
+ * @brief ComputeFiringPositions compute the position of the HDL_LASER_PER_FIRING
+ * returns of a firing. The implementation is selected once at runtime depending
+ * on the instructions supported by the CPU (AVX2, NEON or scalar fallback), all
+ * of them giving the same results as the scalar computation.
+ * @param corrections the per laser corrections
+ * @param laserOffset the id of the first laser of the firing (firing block laser offset)
+ * @param distanceResolution size of a distance unit, in meters
+ * @param buffer the inputs of the firing, where the outputs are written
+ */
+void ComputeFiringPositions(const LaserCorrectionArrays& corrections, int laserOffset,
+                            double distanceResolution, FiringBuffer& buffer);
+
+/**
+ * @brief ComputeFiringPositionsScalar scalar implementation of ComputeFiringPositions,
+ * exposed to be able to check the other implementations
+ */
+void ComputeFiringPositionsScalar(const LaserCorrectionArrays& corrections, int laserOffset,
+                                  double distanceResolution, FiringBuffer& buffer);
+
+/**
+ * @brief GetFiringPositionsImplementationName name of the implementation used
+ * by ComputeFiringPositions on this CPU
+ */
+const char* GetFiringPositionsImplementationName();
+
+/**
+ * @brief ComputeFiringIntensities correct the raw intensities of the HDL_LASER_PER_FIRING
+ * returns of a firing with the focal distance and slope of their laser, as described in
+ * the appendix F of the HDL-64E S3 manual. The intensities of the lasers without min and
+ * max intensities are left as is.
+ *
+ * The terms depending on the raw intensity and on the raw distance are read from tables,
+ * computed once when the corrections are set for the former and once for all for the
+ * latter, so that a return costs a few additions and comparisons. The implementation is
+ * selected as for ComputeFiringPositions, AVX2 gathering the tables, all of them giving
+ * the same results as the scalar computation.
+ * @param corrections the per laser corrections and intensity tables
+ * @param laserOffset the id of the first laser of the firing (firing block laser offset)
+ * @param buffer the raw distances and intensities of the firing, where the corrected
+ * intensities are written
+ */
+void ComputeFiringIntensities(const LaserCorrectionArrays& corrections, int laserOffset,
+                              FiringBuffer& buffer);
+
+/**
+ * @brief ComputeFiringIntensitiesScalar scalar implementation of ComputeFiringIntensities,
+ * exposed to be able to check the other implementations
+ */
+void ComputeFiringIntensitiesScalar(const LaserCorrectionArrays& corrections, int laserOffset,
+                                    FiringBuffer& buffer);
+
+/**
+ * @brief TransformFiringPositions apply an affine transform, such as the mounting of the
+ * sensor, to the positions of the HDL_LASER_PER_FIRING returns of a firing. The
+ * implementation is selected as for ComputeFiringPositions, all of them giving exactly
+ * the results of vtkLinearTransform::TransformPoint.
+ * @param matrix the 3 first rows of the 4x4 matrix of the transform, row by row
+ * @param buffer the firing whose positions are transformed in place
+ */
+void TransformFiringPositions(const double matrix[12], FiringBuffer& buffer);
+
+/**
+ * @brief TransformFiringPositionsScalar scalar implementation of TransformFiringPositions,
+ * exposed to be able to check the other implementations
+ */
+void TransformFiringPositionsScalar(const double matrix[12], FiringBuffer& buffer);
+
+/**
+ * \brief FiringTimingModel timing of the firings within the firing blocks of a sensor model,
+ * used to adjust the timestamp and the azimuth of each return
+ */
+enum class FiringTimingModel
+{
+  None, //!< no intra-firing adjustment
+  HDL32,
+  VLP16,
+  VLP32,
+  HDL64,
+  VLS128
+};
+
+/**
+ * \struct FiringTimingTable
+ * \brief Intra-firing adjustments of each return of each firing block of a packet,
+ *        computed at compile time for each sensor model and return mode.
+ */
+struct FiringTimingTable
+{
+  //! Offset of the return from the packet timestamp, rounded to the microsecond
+  double TimestampAdjustment[DataPacketFixedLength::HDL_FIRING_PER_PKT]
+                            [DataPacketFixedLength::HDL_LASER_PER_FIRING];
+  //! Fraction of the azimuth step between two firing blocks to add to the azimuth of the return
+  double AzimuthFraction[DataPacketFixedLength::HDL_FIRING_PER_PKT]
+                        [DataPacketFixedLength::HDL_LASER_PER_FIRING];
+};
+
+/**
+ * @brief GetFiringTimingTable get the intra-firing adjustments of a sensor model, they are
+ * all 0 for FiringTimingModel::None
+ * @param model timing of the sensor
+ * @param isDualReturnPacket true if the firing blocks hold the two returns of each firing
+ */
+const FiringTimingTable& GetFiringTimingTable(FiringTimingModel model, bool isDualReturnPacket);
+
+/**
+ * \class AzimuthAdjustmentCache
+ * \brief Azimuth adjustments of the returns of each firing block of a packet, in hundredths
+ *        of degree, for a given timing table and azimuth step between the firing blocks.
+ *
+ * The azimuth step only changes with the rotation speed, so the adjustments are computed
+ * again only when it changes, and the returns of the other packets only read them.
+ */
+class AzimuthAdjustmentCache
+{
+public:
+  /**
+   * @brief Get the adjustments of the returns of a firing block
+   * @param table intra-firing timing of the sensor
+   * @param firingBlock index of the firing block in the packet
+   * @param azimuthDiff azimuth step between the firing blocks, in hundredths of degree
+   * @return HDL_LASER_PER_FIRING adjustments, valid until the next call for this firing block
+   */
+  const int* Get(const FiringTimingTable& table, int firingBlock, int azimuthDiff);
+
+private:
+  const FiringTimingTable* Table[DataPacketFixedLength::HDL_FIRING_PER_PKT] = {};
+  int AzimuthDiff[DataPacketFixedLength::HDL_FIRING_PER_PKT] = {};
+  int Adjustments[DataPacketFixedLength::HDL_FIRING_PER_PKT]
+                 [DataPacketFixedLength::HDL_LASER_PER_FIRING];
+};
+
+/**
+ * \class AzimuthStepEstimator
+ * \brief Streaming estimate of the azimuth step between the firing blocks of a packet,
+ *        defined as the element of a given rank of the sorted azimuth differences of the
+ *        packet (the median for most sensors).
+ *
+ * The step only changes with the rotation speed, so the step of the previous packet is
+ * checked first, then its neighbour, by counting the differences smaller than and equal to
+ * it. This gives exactly the element of the requested rank without sorting, the differences
+ * are only partially sorted when the step has changed by more than one unit.
+ */
+class AzimuthStepEstimator
+{
+public:
+  /**
+   * @brief Update get the azimuth step of a packet
+   * @param azimuthDiffs azimuth differences between the successive firing blocks,
+   * may be reordered
+   * @param numberOfDiffs number of differences
+   * @param rank rank of the step in the sorted differences, lower than numberOfDiffs
+   * @return the difference of rank 'rank'
+   */
+  int Update(int* azimuthDiffs, int numberOfDiffs, int rank);
+
+  //! Forget the previous step
+  void Reset();
+
+  //! Number of updates for which the previous step and its neighbour were not the right one
+  size_t GetNumberOfMispredictions() const { return this->NumberOfMispredictions; }
+
+private:
+  int LastStep = 0;
+  bool HasLastStep = false;
+  size_t NumberOfMispredictions = 0;
+};
+
+#endif // VELODYNEFIRINGDECODER_H
@@ -0,0 +1,434 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "VelodynePacketGenerator.h"
+
+// STD
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace DataPacketFixedLength;
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Layout and timing of the packets of a model, see VelodyneFiringDecoder.cxx
+struct ModelDescription
+{
+  const char* Name;
+  SensorType Type;
+  int NumberOfLasers;
+  //! Number of blocks of 32 lasers fired together
+  int NumberOfBanks;
+  //! Delay between the banks of a firing, in microseconds
+  double BankDuration;
+  //! Duration of a firing of all the lasers in single and dual return, in microseconds
+  double FiringDuration[2];
+  //! Vertical field of view, in degrees, used without calibration
+  double MinimumVerticalAngle;
+  double MaximumVerticalAngle;
+};
+
+const ModelDescription Models[VelodynePacketGenerator::NumberOfModels] = {
+  { "VLP-16", VLP16, 16, 1, 0., { 110.592, 110.592 }, -15., 15. },
+  { "VLP-32c", VLP32C, 32, 1, 0., { 55.296, 55.296 }, -25., 15. },
+  { "HDL-64", HDL64, 64, 2, 0., { 48.0, 57.6 }, -24.9, 2. },
+  { "VLS-128", VLS128, 128, 4, 13., { 52., 52. }, -25., 15. },
+};
+
+const unsigned short BlockIdentifiers[4] = { BLOCK_0_TO_31, BLOCK_32_TO_63, BLOCK_64_TO_95,
+  BLOCK_96_TO_127 };
+
+const double DegreesToRadians = 3.14159265358979323846 / 180.;
+
+// Procedural street, in meters. The street runs along Y, the ground being under the sensor
+const double SensorHeight = 1.8;
+const double StreetHalfWidth = 9.;
+//! Each lot has a building followed by an alley
+const double LotLength = 30.;
+const double AlleyWidth = 5.;
+const double MinimumBuildingHeight = 5.;
+const double MaximumBuildingHeight = 25.;
+//! Wall seen through the alleys, behind the facades
+const double FarWallOffset = 20.;
+const double FarWallHeight = 30.;
+const double PoleOffset = 1.5;
+const double PoleSpacing = 15.;
+const double PoleRadius = 0.2;
+const double PoleHeight = 7.;
+//! A ray going farther than the pole radius times this factor from its axis also hits
+//! what is behind the pole
+const double PoleEdgeFactor = 0.6;
+const double MaximumRange = 120.;
+const double RangeNoise = 0.015;
+
+const unsigned char GroundIntensity = 15;
+const unsigned char FacadeIntensity = 60;
+const unsigned char FarWallIntensity = 40;
+const unsigned char PoleIntensity = 150;
+const int IntensityNoise = 10;
+
+//-----------------------------------------------------------------------------
+// splitmix64, a hash whose outputs are uniformly distributed
+uint64_t Hash(uint64_t value)
+{
+  value += 0x9e3779b97f4a7c15ull;
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+  return value ^ (value >> 31);
+}
+
+//-----------------------------------------------------------------------------
+// Value in [0, 1) given by a hash
+double Uniform(uint64_t hash)
+{
+  return (hash >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//-----------------------------------------------------------------------------
+uint64_t HashLot(uint64_t seed, int side, int64_t lot, uint64_t salt)
+{
+  return Hash(Hash(Hash(seed ^ salt) + static_cast<uint64_t>(side + 1)) + static_cast<uint64_t>(lot));
+}
+
+//-----------------------------------------------------------------------------
+// Delay of a return after the first one of its block, in microseconds
+double GetReturnTimeOffset(VelodynePacketGenerator::Model model, int dsr)
+{
+  switch (model)
+  {
+    case VelodynePacketGenerator::VLP16:
+      // the blocks hold two firings of the 16 lasers
+      return (dsr % 16) * 2.304 + (dsr / 16) * 55.296;
+    case VelodynePacketGenerator::VLP32C:
+      return (dsr / 2) * 2.304;
+    case VelodynePacketGenerator::VLS128:
+      return (dsr / 4) * 1.4;
+    default:
+      return 0.;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Index in the packet of the block of a bank of a firing, the dual returns being
+// laid out as expected by vtkVelodynePacketInterpreter::GetDualFiringGroupSize
+int GetBlockIndex(VelodynePacketGenerator::Model model, bool dualReturn, int numberOfBanks,
+  int firing, int bank, int returnIndex)
+{
+  if (!dualReturn)
+  {
+    return firing * numberOfBanks + bank;
+  }
+  if (model == VelodynePacketGenerator::HDL64)
+  {
+    // upper and lower blocks of the first returns, then of the dual returns
+    return 4 * firing + 2 * returnIndex + bank;
+  }
+  return 2 * (firing * numberOfBanks + bank) + returnIndex;
+}
+}
+
+//-----------------------------------------------------------------------------
+const char* VelodynePacketGenerator::GetModelName(Model model)
+{
+  return model < NumberOfModels ? Models[model].Name : "Unknown";
+}
+
+//-----------------------------------------------------------------------------
+bool VelodynePacketGenerator::GetModelFromName(const std::string& name, Model& model)
+{
+  for (int i = 0; i < NumberOfModels; ++i)
+  {
+    const std::string modelName = Models[i].Name;
+    if (modelName.size() == name.size() &&
+      std::equal(name.begin(), name.end(), modelName.begin(), [](char a, char b) {
+        return std::tolower(static_cast<unsigned char>(a)) ==
+          std::tolower(static_cast<unsigned char>(b));
+      }))
+    {
+      model = static_cast<Model>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+VelodynePacketGenerator::VelodynePacketGenerator(Model model, bool dualReturn)
+  : SensorModel(model < NumberOfModels ? model : VLP16)
+  , DualReturn(dualReturn)
+{
+  const ModelDescription& description = Models[this->SensorModel];
+  const int numberOfLasers = description.NumberOfLasers;
+  for (int i = 0; i < HDL_MAX_NUM_LASERS; ++i)
+  {
+    const double angle = description.MinimumVerticalAngle +
+      std::min(i, numberOfLasers - 1) *
+        (description.MaximumVerticalAngle - description.MinimumVerticalAngle) / (numberOfLasers - 1);
+    this->CosVertical[i] = std::cos(angle * DegreesToRadians);
+    this->SinVertical[i] = std::sin(angle * DegreesToRadians);
+    this->RotationalCorrection[i] = 0.;
+    this->DistanceCorrection[i] = 0.;
+  }
+}
+
+//-----------------------------------------------------------------------------
+int VelodynePacketGenerator::GetNumberOfLasers() const
+{
+  return Models[this->SensorModel].NumberOfLasers;
+}
+
+//-----------------------------------------------------------------------------
+bool VelodynePacketGenerator::SetCalibration(const VelodyneCalibration& calibration)
+{
+  const int numberOfLasers = this->GetNumberOfLasers();
+  if (calibration.NumberOfLasers != numberOfLasers)
+  {
+    return false;
+  }
+  for (int i = 0; i < numberOfLasers; ++i)
+  {
+    const HDLLaserCorrection& correction = calibration.Corrections[i];
+    this->CosVertical[i] = std::cos(correction.verticalCorrection * DegreesToRadians);
+    this->SinVertical[i] = std::sin(correction.verticalCorrection * DegreesToRadians);
+    this->RotationalCorrection[i] = correction.rotationalCorrection;
+    this->DistanceCorrection[i] = correction.distanceCorrection;
+  }
+  if (calibration.DistanceResolutionM > 0.)
+  {
+    this->DistanceResolution = calibration.DistanceResolutionM;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+double VelodynePacketGenerator::GetPacketPeriod() const
+{
+  const ModelDescription& description = Models[this->SensorModel];
+  const int blocksPerFiring = description.NumberOfBanks * (this->DualReturn ? 2 : 1);
+  const int firingsPerPacket = HDL_FIRING_PER_PKT / blocksPerFiring;
+  return 1e-6 * firingsPerPacket * description.FiringDuration[this->DualReturn ? 1 : 0];
+}
+
+//-----------------------------------------------------------------------------
+double VelodynePacketGenerator::GeneratePacket(unsigned char* data)
+{
+  return this->GeneratePacket(this->PacketIndex++, data);
+}
+
+//-----------------------------------------------------------------------------
+double VelodynePacketGenerator::GeneratePacket(uint64_t packetIndex, unsigned char* data) const
+{
+  const ModelDescription& description = Models[this->SensorModel];
+  const int numberOfBanks = description.NumberOfBanks;
+  const int numberOfReturns = this->DualReturn ? 2 : 1;
+  const int firingsPerPacket = HDL_FIRING_PER_PKT / (numberOfBanks * numberOfReturns);
+  const double firingDuration = description.FiringDuration[this->DualReturn ? 1 : 0];
+  const double packetTime = packetIndex * this->GetPacketPeriod();
+  const double degreesPerSecond = 6. * this->RPM;
+  auto getRotationalPosition = [degreesPerSecond](double time) {
+    return static_cast<uint16_t>(std::llround(100. * degreesPerSecond * time) % 36000);
+  };
+
+  std::memset(data, 0, PacketSize);
+  HDLDataPacket* packet = reinterpret_cast<HDLDataPacket*>(data);
+  const long long microseconds = std::llround(1e6 * (this->StartTime + packetTime));
+  packet->gpsTimestamp = static_cast<uint32_t>(microseconds % 3600000000ll);
+  // the status bytes of the HDL-64 are not emulated, it is read with a calibration file
+  if (this->SensorModel != HDL64)
+  {
+    packet->factoryField1 = this->DualReturn ? DUAL_RETURN : STRONGEST_RETURN;
+    packet->factoryField2 = description.Type;
+  }
+
+  for (int firing = 0; firing < firingsPerPacket; ++firing)
+  {
+    for (int bank = 0; bank < numberOfBanks; ++bank)
+    {
+      const double blockTime =
+        packetTime + 1e-6 * (firing * firingDuration + bank * description.BankDuration);
+      HDLFiringData* blocks[2];
+      for (int returnIndex = 0; returnIndex < numberOfReturns; ++returnIndex)
+      {
+        blocks[returnIndex] = &packet->firingData[GetBlockIndex(
+          this->SensorModel, this->DualReturn, numberOfBanks, firing, bank, returnIndex)];
+        blocks[returnIndex]->blockIdentifier = BlockIdentifiers[bank];
+        blocks[returnIndex]->rotationalPosition = getRotationalPosition(blockTime);
+      }
+
+      for (int dsr = 0; dsr < HDL_LASER_PER_FIRING; ++dsr)
+      {
+        const int laser = this->SensorModel == VLP16 ? dsr % 16 : bank * HDL_LASER_PER_FIRING + dsr;
+        const double returnTime = blockTime + 1e-6 * GetReturnTimeOffset(this->SensorModel, dsr);
+        // the decoded azimuth is the rotational position minus the rotational correction
+        const double azimuth =
+          (degreesPerSecond * returnTime - this->RotationalCorrection[laser]) * DegreesToRadians;
+        const uint64_t noiseKey =
+          (packetIndex * HDL_FIRING_PER_PKT + firing * numberOfBanks + bank) * HDL_LASER_PER_FIRING +
+          dsr;
+        Hit last, strongest;
+        this->CastRay(this->Speed * returnTime, std::cos(azimuth), std::sin(azimuth), laser,
+          noiseKey, last, strongest);
+
+        const Hit* hits[2] = { this->DualReturn ? &last : &strongest, &strongest };
+        for (int returnIndex = 0; returnIndex < numberOfReturns; ++returnIndex)
+        {
+          const double rawDistance =
+            std::round((hits[returnIndex]->Distance - this->DistanceCorrection[laser]) /
+              this->DistanceResolution);
+          if (hits[returnIndex]->Distance > 0. && rawDistance > 0. &&
+            rawDistance <= std::numeric_limits<uint16_t>::max())
+          {
+            blocks[returnIndex]->laserReturns[dsr].distance = static_cast<uint16_t>(rawDistance);
+            blocks[returnIndex]->laserReturns[dsr].intensity = hits[returnIndex]->Intensity;
+          }
+        }
+      }
+    }
+  }
+
+  // In dual return, a VLS-128 packet holds a single firing followed by dummy blocks,
+  // whose rotational position gives the azimuth step of the last bank
+  for (int block = firingsPerPacket * numberOfBanks * numberOfReturns; block < HDL_FIRING_PER_PKT;
+       ++block)
+  {
+    packet->firingData[block].blockIdentifier = 0xFFFF;
+    packet->firingData[block].rotationalPosition =
+      getRotationalPosition(packetTime + 1e-6 * numberOfBanks * description.BankDuration);
+  }
+  return packetTime;
+}
+
+//-----------------------------------------------------------------------------
+double VelodynePacketGenerator::GetFacadeHeight(int side, double y) const
+{
+  const double lot = std::floor(y / LotLength);
+  if (y - lot * LotLength > LotLength - AlleyWidth)
+  {
+    return 0.;
+  }
+  return MinimumBuildingHeight +
+    (MaximumBuildingHeight - MinimumBuildingHeight) *
+    Uniform(HashLot(this->Seed, side, static_cast<int64_t>(lot), 1));
+}
+
+//-----------------------------------------------------------------------------
+void VelodynePacketGenerator::CastRay(double sensorY, double cosAzimuth, double sinAzimuth,
+  int laser, uint64_t noiseKey, Hit& last, Hit& strongest) const
+{
+  // the decoded point is at x = d*cos(v)*sin(a), y = d*cos(v)*cos(a), z = d*sin(v)
+  const double dx = this->CosVertical[laser] * sinAzimuth;
+  const double dy = this->CosVertical[laser] * cosAzimuth;
+  const double dz = this->SinVertical[laser];
+
+  // background: ground, facades and far walls
+  Hit background;
+  double range = MaximumRange;
+  if (dz < 0. && -SensorHeight / dz < range)
+  {
+    range = -SensorHeight / dz;
+    background.Distance = range;
+    background.Intensity = GroundIntensity;
+  }
+  const int side = dx > 0. ? 1 : -1;
+  const double absDx = std::abs(dx);
+  if (absDx > 1e-9)
+  {
+    const double facadeRange = StreetHalfWidth / absDx;
+    if (facadeRange < range)
+    {
+      const double height = this->GetFacadeHeight(side, sensorY + facadeRange * dy);
+      const double farWallRange = (StreetHalfWidth + FarWallOffset) / absDx;
+      if (facadeRange * dz <= height - SensorHeight && height > 0.)
+      {
+        range = facadeRange;
+        background.Distance = range;
+        background.Intensity = FacadeIntensity;
+      }
+      else if (height == 0. && farWallRange < range && farWallRange * dz <= FarWallHeight - SensorHeight)
+      {
+        range = farWallRange;
+        background.Distance = range;
+        background.Intensity = FarWallIntensity;
+      }
+    }
+  }
+
+  // poles, in front of the background
+  Hit pole;
+  double edge = 0.;
+  if (absDx > 1e-9)
+  {
+    const double poleX = side * (StreetHalfWidth - PoleOffset);
+    const double horizontalNorm = std::sqrt(dx * dx + dy * dy);
+    const double nearestPole = std::round((sensorY + std::abs(poleX) / absDx * dy) / PoleSpacing);
+    for (int k = -1; k <= 1; ++k)
+    {
+      const double index = nearestPole + k;
+      const double poleY = index * PoleSpacing +
+        (Uniform(HashLot(this->Seed, side, static_cast<int64_t>(index), 2)) - 0.5) * 0.4 * PoleSpacing;
+      // distance of the axis of the pole to the ray, in the horizontal plane
+      const double cx = poleX;
+      const double cy = poleY - sensorY;
+      const double along = (cx * dx + cy * dy) / (horizontalNorm * horizontalNorm);
+      const double across = std::abs(cx * dy - cy * dx) / horizontalNorm;
+      if (along <= 0. || across >= PoleRadius)
+      {
+        continue;
+      }
+      const double poleRange =
+        along - std::sqrt(PoleRadius * PoleRadius - across * across) / horizontalNorm;
+      const double z = poleRange * dz;
+      if (poleRange > 0. && poleRange < range && (pole.Distance == 0. || poleRange < pole.Distance) &&
+        z >= -SensorHeight && z <= PoleHeight - SensorHeight)
+      {
+        pole.Distance = poleRange;
+        pole.Intensity = PoleIntensity;
+        edge = across / PoleRadius;
+      }
+    }
+  }
+
+  const uint64_t noise = Hash(this->Seed ^ Hash(noiseKey));
+  auto addNoise = [noise](Hit& hit, int shift) {
+    if (hit.Distance > 0.)
+    {
+      hit.Distance += (2. * Uniform(Hash(noise + shift)) - 1.) * RangeNoise;
+      const int intensity =
+        hit.Intensity + static_cast<int>((noise >> (8 * shift)) % (2 * IntensityNoise + 1)) - IntensityNoise;
+      hit.Intensity = static_cast<unsigned char>(std::max(1, std::min(255, intensity)));
+    }
+  };
+  addNoise(background, 1);
+  addNoise(pole, 2);
+
+  if (pole.Distance > 0.)
+  {
+    strongest = pole;
+    // the edge of the beam goes past the pole
+    last = edge > PoleEdgeFactor ? background : pole;
+  }
+  else
+  {
+    strongest = background;
+    last = background;
+  }
+}
@@ -0,0 +1,143 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VELODYNEPACKETGENERATOR_H
+#define VELODYNEPACKETGENERATOR_H
+
+#include "VelodyneCalibration.h"
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief VelodynePacketGenerator synthesizes the lidar packets of a Velodyne sensor
+ * driving down a procedural street, to test the decoding, the SLAM and the exports
+ * at any scale without recording.
+ *
+ * The street runs along the Y axis of the sensor (azimuth 0), which moves forward at
+ * a constant speed: a flat ground, facades of random heights on both sides with alleys
+ * between the buildings, a farther wall seen through the alleys, and poles along the
+ * sidewalks. With dual return, a return near the edge of a pole also gives the
+ * surface behind it.
+ *
+ * The packets follow the layout, timing and factory bytes expected by
+ * vtkVelodynePacketInterpreter. A packet only depends on its index, the settings and
+ * the seed, so that the same capture is generated on every machine and the packets
+ * can be generated in parallel.
+ */
+class VelodynePacketGenerator
+{
+public:
+  enum Model
+  {
+    VLP16 = 0,
+    VLP32C,
+    HDL64,
+    VLS128,
+    NumberOfModels
+  };
+
+  //! Size of the payload of a lidar packet
+  static const unsigned int PacketSize = 1206;
+
+  //! Name of the model, as in the calibration files of the share directory
+  static const char* GetModelName(Model model);
+
+  //! Model of a name given by GetModelName, the case is ignored
+  static bool GetModelFromName(const std::string& name, Model& model);
+
+  explicit VelodynePacketGenerator(Model model = VLP16, bool dualReturn = false);
+
+  Model GetModel() const { return this->SensorModel; }
+  bool GetDualReturn() const { return this->DualReturn; }
+  int GetNumberOfLasers() const;
+
+  //! Rotation speed, in revolutions per minute
+  void SetRPM(double rpm) { this->RPM = rpm; }
+  double GetRPM() const { return this->RPM; }
+
+  //! Speed of the sensor along the street, in m/s
+  void SetSpeed(double speed) { this->Speed = speed; }
+  double GetSpeed() const { return this->Speed; }
+
+  //! Time of the first packet, in seconds since the top of the hour
+  void SetStartTime(double time) { this->StartTime = time; }
+  double GetStartTime() const { return this->StartTime; }
+
+  //! Seed of the scene (heights of the buildings, positions of the poles) and of the noise
+  void SetSeed(uint64_t seed) { this->Seed = seed; }
+  uint64_t GetSeed() const { return this->Seed; }
+
+  /**
+   * @brief SetCalibration use the vertical, rotational and distance corrections of a
+   * calibration, so that the points decoded with it lie on the scene. By default, the
+   * lasers are evenly spread over the vertical field of view of the model.
+   * @return false if the calibration does not have the lasers of the model
+   */
+  bool SetCalibration(const VelodyneCalibration& calibration);
+
+  //! Time between two packets, in seconds
+  double GetPacketPeriod() const;
+
+  //! Index of the next packet given by GeneratePacket
+  uint64_t GetPacketIndex() const { return this->PacketIndex; }
+  void SetPacketIndex(uint64_t index) { this->PacketIndex = index; }
+
+  /**
+   * @brief GeneratePacket write the next packet
+   * @param data PacketSize bytes
+   * @return the time of the packet, in seconds since the first packet
+   */
+  double GeneratePacket(unsigned char* data);
+
+  //! Write the packet of the given index, without changing the next packet. Can be
+  //! called from several threads at once
+  double GeneratePacket(uint64_t packetIndex, unsigned char* data) const;
+
+private:
+  //! Distance in meters and intensity of the returns of a laser
+  struct Hit
+  {
+    double Distance = 0.;
+    unsigned char Intensity = 0;
+  };
+
+  //! Last and strongest returns of a ray, from the sensor at y = sensorY
+  void CastRay(double sensorY, double cosAzimuth, double sinAzimuth, int laser, uint64_t noiseKey,
+    Hit& last, Hit& strongest) const;
+
+  //! Height of the building facing the point at y on a side, 0 in an alley
+  double GetFacadeHeight(int side, double y) const;
+
+  Model SensorModel;
+  bool DualReturn;
+  double RPM = 600.;
+  double Speed = 5.;
+  double StartTime = 0.;
+  uint64_t Seed = 0;
+  uint64_t PacketIndex = 0;
+
+  double DistanceResolution = 0.002;
+  double CosVertical[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  double SinVertical[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  //! In degrees
+  double RotationalCorrection[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  //! In meters
+  double DistanceCorrection[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+};
+
+#endif // VELODYNEPACKETGENERATOR_H
@@ -31,16 +31,18 @@ void vtkRollingDataAccumulator::clear()
   this->accumulatedValue.clear();
 }
 
-void vtkRollingDataAccumulator::appendData(TypeValueDataPair valuePair)
+bool vtkRollingDataAccumulator::appendData(TypeValueDataPair valuePair)
 {
-  if (valuePair.dataType == this->beginMarkerValuePair.dataType &&
-    valuePair.dataValue == this->beginMarkerValuePair.dataValue)
+  const bool isBeginMarker = valuePair.dataType == this->beginMarkerValuePair.dataType &&
+    valuePair.dataValue == this->beginMarkerValuePair.dataValue;
+  if (isBeginMarker)
   {
     beginPosition.push_back(this->accumulatedData.size());
   }
   this->accumulatedData.push_back(valuePair);
   this->accumulatedDataType.push_back(valuePair.dataType);
   this->accumulatedValue.push_back(valuePair.dataValue);
+  return isBeginMarker;
 }
 bool vtkRollingDataAccumulator::areRollingDataReady() const
 {
@@ -71,10 +73,10 @@ bool vtkRollingDataAccumulator::getGoodSequenceId(int& idRollingSequence) const
   return true;
 }
 
-void vtkRollingDataAccumulator::appendData(
+bool vtkRollingDataAccumulator::appendData(
   unsigned int timestamp, unsigned char dataType, unsigned char dataValue)
 {
-  this->appendData(TypeValueDataPair(timestamp, dataType, dataValue));
+  return this->appendData(TypeValueDataPair(timestamp, dataType, dataValue));
 }
 bool vtkRollingDataAccumulator::getAlignedRollingData(std::vector<unsigned char>& data) const
 {
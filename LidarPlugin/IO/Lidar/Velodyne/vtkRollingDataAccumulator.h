@@ -32,8 +32,9 @@ struct TypeValueDataPair
 class vtkRollingDataAccumulator
 {
 public:
-  void appendData(TypeValueDataPair valuePair);
-  void appendData(unsigned int timestamp, unsigned char dataType, unsigned char dataValue);
+  // Return true if the data begins a new status cycle, which completes the previous one
+  bool appendData(TypeValueDataPair valuePair);
+  bool appendData(unsigned int timestamp, unsigned char dataType, unsigned char dataValue);
   void setTotalExpectedDataLength();
   bool areRollingDataReady() const;
   bool getDSRCalibrationData() const;
@@ -3,13 +3,23 @@
 #include <vtkPoints.h>
 #include <vtkPointData.h>
 #include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkMatrix4x4.h>
 #include <vtkTransform.h>
 
-#include <boost/property_tree/xml_parser.hpp>
-#include <boost/property_tree/ptree.hpp>
-#include <boost/foreach.hpp>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <numeric>
+#include <sstream>
 #include "vtkDataPacket.h"
 #include "vtkRollingDataAccumulator.h"
+#include "AzimuthFraming.h"
+#include "FrameDataArrays.h"
+#include "VelodyneFiringDecoder.h"
+#include "VelodyneCalibration.h"
 
 using namespace DataPacketFixedLength;
 
@@ -21,109 +31,135 @@ using namespace DataPacketFixedLength;
     }                                                                                              \
   }
 
-//namespace
-//{
-//! @todo this method are actually usefull for every Interpreter and should go to the top
-template<typename T>
-vtkSmartPointer<T> CreateDataArray(const char* name, vtkIdType np, vtkIdType prereserved_np, vtkPolyData* pd)
-{
-  vtkSmartPointer<T> array = vtkSmartPointer<T>::New();
-  array->Allocate(prereserved_np);
-  array->SetName(name);
-  if (np > 0)
-  {
-    array->SetNumberOfTuples(np);
-  }
-  if (pd)
-  {
-    pd->GetPointData()->AddArray(array);
-  }
+//-----------------------------------------------------------------------------
+// Names of the optional arrays, the bit of the array i in OptionalArrays being 1 << i
+const char* const OptionalArrayNames[] = { "X", "Y", "Z", "distance_raw", "timestamp",
+  "vertical_angle", "dual_distance", "dual_intensity", "dual_return_matching" };
 
-  return array;
-}
+//-----------------------------------------------------------------------------
+// Packets kept while the HDL64 corrections are read from the stream, a few status
+// cycles of 4160 packets, the oldest ones are dropped beyond
+const size_t MaxPacketsWaitingForCalibration = 4 * 4160;
 
-// Structure to compute RPM and handle degenerated cases
-struct RPMCalculator
+//-----------------------------------------------------------------------------
+// Contiguous buffers in which the frame under construction is built, one per point data array
+struct VelodyneFrameBuffers
 {
-  // Determines if the rpm computation is available
-  bool IsReady;
-  // Determines if the corresponding value has been set
-  bool ValueReady[4];
-  int MinAngle;
-  int MaxAngle;
-  unsigned int MinTime;
-  unsigned int MaxTime;
-
-  void Reset()
-  {
-    this->IsReady = false;
-    this->ValueReady[0] = false;
-    this->ValueReady[1] = false;
-    this->ValueReady[2] = false;
-    this->ValueReady[3] = false;
-    this->MinAngle = std::numeric_limits<int>::max();
-    this->MaxAngle = std::numeric_limits<int>::min();
-    this->MinTime = std::numeric_limits<unsigned int>::max();
-    this->MaxTime = std::numeric_limits<unsigned int>::min();
-  }
-
-  double GetRPM()
-  {
-    // If the calculator is not ready i.e : one
-    // of the attributes is not initialized yet
-    // (MaxAngle, MinAngle, MaxTime, MinTime)
-    if (!this->IsReady)
+  FrameBuilderArray<float> Points;
+  CoordinateBuilderArray PointsX;
+  CoordinateBuilderArray PointsY;
+  CoordinateBuilderArray PointsZ;
+  FrameBuilderArray<unsigned char> Intensity;
+  FrameBuilderArray<unsigned char> LaserId;
+  FrameBuilderArray<unsigned short> Azimuth;
+  CoordinateBuilderArray Distance;
+  FrameBuilderArray<unsigned short> DistanceRaw;
+  FrameBuilderArray<double> Timestamp;
+  CoordinateBuilderArray VerticalAngle;
+  FrameBuilderArray<unsigned int> RawTime;
+  FrameBuilderArray<int> IntensityFlag;
+  FrameBuilderArray<int> DistanceFlag;
+  FrameBuilderArray<unsigned int> Flags;
+  FrameBuilderArray<vtkIdType> DualReturnMatching;
+
+  //! Optional arrays filled for the frame under construction, see
+  //! vtkVelodynePacketInterpreter::OptionalArray. They stay empty otherwise.
+  unsigned int Arrays = vtkVelodynePacketInterpreter::ALL_OPTIONAL_ARRAYS;
+
+  //! Remove all the points and reserve space for the given number of points
+  void Reset(size_t numberOfPoints)
+  {
+    this->Points.Reset(3 * numberOfPoints);
+    this->PointsX.Reset(this->SizeOf(vtkVelodynePacketInterpreter::ARRAY_X, numberOfPoints));
+    this->PointsY.Reset(this->SizeOf(vtkVelodynePacketInterpreter::ARRAY_Y, numberOfPoints));
+    this->PointsZ.Reset(this->SizeOf(vtkVelodynePacketInterpreter::ARRAY_Z, numberOfPoints));
+    this->Intensity.Reset(numberOfPoints);
+    this->LaserId.Reset(numberOfPoints);
+    this->Azimuth.Reset(numberOfPoints);
+    this->Distance.Reset(numberOfPoints);
+    this->DistanceRaw.Reset(this->SizeOf(vtkVelodynePacketInterpreter::ARRAY_DISTANCE_RAW, numberOfPoints));
+    this->Timestamp.Reset(numberOfPoints);
+    this->VerticalAngle.Reset(this->SizeOf(vtkVelodynePacketInterpreter::ARRAY_VERTICAL_ANGLE, numberOfPoints));
+    this->RawTime.Reset(this->SizeOf(vtkVelodynePacketInterpreter::ARRAY_RAW_TIME, numberOfPoints));
+    this->IntensityFlag.Reset(this->SizeOf(vtkVelodynePacketInterpreter::ARRAY_DUAL_INTENSITY, numberOfPoints));
+    this->DistanceFlag.Reset(this->SizeOf(vtkVelodynePacketInterpreter::ARRAY_DUAL_DISTANCE, numberOfPoints));
+    this->Flags.Reset(numberOfPoints);
+    this->DualReturnMatching.Reset(this->SizeOf(vtkVelodynePacketInterpreter::ARRAY_DUAL_RETURN_MATCHING, numberOfPoints));
+  }
+
+  //! Set the number of points, the new points are set to zero
+  void Resize(size_t numberOfPoints)
+  {
+    this->Points.Resize(3 * numberOfPoints);
+    this->PointsX.Resize(this->SizeOf(vtkVelodynePacketInterpreter::ARRAY_X, numberOfPoints));
+    this->PointsY.Resize(this->SizeOf(vtkVelodynePacketInterpreter::ARRAY_Y, numberOfPoints));
+    this->PointsZ.Resize(this->SizeOf(vtkVelodynePacketInterpreter::ARRAY_Z, numberOfPoints));
+    this->Intensity.Resize(numberOfPoints);
+    this->LaserId.Resize(numberOfPoints);
+    this->Azimuth.Resize(numberOfPoints);
+    this->Distance.Resize(numberOfPoints);
+    this->DistanceRaw.Resize(this->SizeOf(vtkVelodynePacketInterpreter::ARRAY_DISTANCE_RAW, numberOfPoints));
+    this->Timestamp.Resize(numberOfPoints);
+    this->VerticalAngle.Resize(this->SizeOf(vtkVelodynePacketInterpreter::ARRAY_VERTICAL_ANGLE, numberOfPoints));
+    this->RawTime.Resize(this->SizeOf(vtkVelodynePacketInterpreter::ARRAY_RAW_TIME, numberOfPoints));
+    this->IntensityFlag.Resize(this->SizeOf(vtkVelodynePacketInterpreter::ARRAY_DUAL_INTENSITY, numberOfPoints));
+    this->DistanceFlag.Resize(this->SizeOf(vtkVelodynePacketInterpreter::ARRAY_DUAL_DISTANCE, numberOfPoints));
+    this->Flags.Resize(numberOfPoints);
+    this->DualReturnMatching.Resize(this->SizeOf(vtkVelodynePacketInterpreter::ARRAY_DUAL_RETURN_MATCHING, numberOfPoints));
+  }
+
+  bool Has(unsigned int array) const { return (this->Arrays & array) != 0; }
+
+  void SetSinglePrecisionCoordinates(bool singlePrecision)
+  {
+    this->PointsX.SetSinglePrecision(singlePrecision);
+    this->PointsY.SetSinglePrecision(singlePrecision);
+    this->PointsZ.SetSinglePrecision(singlePrecision);
+    this->Distance.SetSinglePrecision(singlePrecision);
+    this->VerticalAngle.SetSinglePrecision(singlePrecision);
+  }
+
+  //! Number of values of an optional array for the given number of points
+  size_t SizeOf(unsigned int array, size_t numberOfPoints) const
+  {
+    return this->Has(array) ? numberOfPoints : 0;
+  }
+
+  //! Append a value to an optional array, if it is filled
+  template<typename Buffer, typename V>
+  void PushBackOptional(unsigned int array, Buffer& buffer, V value)
+  {
+    if (this->Has(array))
     {
-      return 0;
+      buffer.PushBack(value);
     }
+  }
 
-    // delta angle in number of laps
-    double dAngle = static_cast<double>(this->MaxAngle - this->MinAngle) / (100.0 * 360.0);
-
-    // delta time in minutes
-    double dTime = static_cast<double>(this->MaxTime - this->MinTime) / (60e6);
-
-    // epsilon to test if the delta time / angle is not too small
-    const double epsilon = 1e-12;
-
-    // if one the deltas is too small
-    if ((std::abs(dTime) < epsilon) || (std::abs(dAngle) < epsilon))
+  //! Set a value of an optional array, if it is filled
+  template<typename T, typename V>
+  void SetOptional(unsigned int array, FrameBuilderArray<T>& buffer, vtkIdType pointId, V value)
+  {
+    if (this->Has(array))
     {
-      return 0;
+      buffer[pointId] = value;
     }
-
-    return dAngle / dTime;
   }
 
-  void AddData(const HDLDataPacket* HDLPacket, unsigned int rawtime)
+  void SetOptional(unsigned int array, CoordinateBuilderArray& buffer, vtkIdType pointId, double value)
   {
-    if (HDLPacket->firingData[0].rotationalPosition < this->MinAngle)
+    if (this->Has(array))
     {
-      this->MinAngle = HDLPacket->firingData[0].rotationalPosition;
-      this->ValueReady[0] = true;
-    }
-    if (HDLPacket->firingData[0].rotationalPosition > this->MaxAngle)
-    {
-      this->MaxAngle = HDLPacket->firingData[0].rotationalPosition;
-      this->ValueReady[1] = true;
-    }
-    if (rawtime < this->MinTime)
-    {
-      this->MinTime = rawtime;
-      this->ValueReady[2] = true;
-    }
-    if (rawtime > this->MaxTime)
-    {
-      this->MaxTime = rawtime;
-      this->ValueReady[3] = true;
+      buffer.Set(pointId, value);
     }
+  }
+
+  vtkIdType GetNumberOfPoints() const { return static_cast<vtkIdType>(this->Intensity.GetSize()); }
 
-    // Check if all of the 4th parameters
-    // have been set
-    this->IsReady = true;
-    for (int k = 0; k < 4; ++k)
+  void SetPoint(vtkIdType pointId, const double pos[3])
+  {
+    for (int i = 0; i < 3; ++i)
     {
-      this->IsReady &= this->ValueReady[k];
+      this->Points[3 * pointId + i] = static_cast<float>(pos[i]);
     }
   }
 };
@@ -149,136 +185,125 @@ int MapIntensityFlag(unsigned int flags)
 }
 
 //-----------------------------------------------------------------------------
-double HDL32AdjustTimeStamp(int firingblock, int dsr, const bool isDualReturnMode)
+// Set the dual return flags of a point, the single returns having neither a dual
+// distance flag nor a dual intensity flag
+void SetDualFlags(VelodyneFrameBuffers& frame, vtkIdType pointId, unsigned int flags)
 {
-  if (!isDualReturnMode)
-  {
-    return (firingblock * 46.08) + (dsr * 1.152);
-  }
-  else
-  {
-    return (firingblock / 2 * 46.08) + (dsr * 1.152);
-  }
+  const bool isSingle = flags == vtkVelodynePacketInterpreter::DUAL_DOUBLED;
+  frame.Flags[pointId] = flags;
+  frame.SetOptional(vtkVelodynePacketInterpreter::ARRAY_DUAL_DISTANCE, frame.DistanceFlag,
+    pointId, isSingle ? 0 : MapDistanceFlag(flags));
+  frame.SetOptional(vtkVelodynePacketInterpreter::ARRAY_DUAL_INTENSITY, frame.IntensityFlag,
+    pointId, isSingle ? 0 : MapIntensityFlag(flags));
 }
 
 //-----------------------------------------------------------------------------
-double VLP16AdjustTimeStamp(
-  int firingblock, int dsr, int firingwithinblock, const bool isDualReturnMode)
+// Append the dual return flags of a point and its matching point, -1 if it has none
+void PushBackDualFlags(VelodyneFrameBuffers& frame, unsigned int flags, vtkIdType dualPointId)
 {
-  if (!isDualReturnMode)
-  {
-    return (firingblock * 110.592) + (dsr * 2.304) + (firingwithinblock * 55.296);
-  }
-  else
-  {
-    return (firingblock / 2 * 110.592) + (dsr * 2.304) + (firingwithinblock * 55.296);
-  }
+  const bool isSingle = flags == vtkVelodynePacketInterpreter::DUAL_DOUBLED;
+  frame.Flags.PushBack(flags);
+  frame.PushBackOptional(vtkVelodynePacketInterpreter::ARRAY_DUAL_DISTANCE, frame.DistanceFlag,
+    isSingle ? 0 : MapDistanceFlag(flags));
+  frame.PushBackOptional(vtkVelodynePacketInterpreter::ARRAY_DUAL_INTENSITY, frame.IntensityFlag,
+    isSingle ? 0 : MapIntensityFlag(flags));
+  frame.PushBackOptional(vtkVelodynePacketInterpreter::ARRAY_DUAL_RETURN_MATCHING,
+    frame.DualReturnMatching, dualPointId);
 }
 
 //-----------------------------------------------------------------------------
-double VLP32AdjustTimeStamp(int firingblock, int dsr, const bool isDualReturnMode)
+// Returns of a dual return pair kept by PairDualReturns
+enum DualReturnPairing
+{
+  KEEP_FIRST_RETURN,
+  KEEP_DUAL_RETURN,
+  KEEP_BOTH_RETURNS
+};
+
+//-----------------------------------------------------------------------------
+// Compare a dual return with the first return of the same laser, update their
+// flags and tell which of them are kept by the dual return filter. The flags are
+// left untouched if the dual return duplicates the first one, which is kept.
+DualReturnPairing PairDualReturns(double firstDistance, short firstIntensity,
+  double dualDistance, short dualIntensity, unsigned int filter,
+  unsigned int& firstFlags, unsigned int& dualFlags)
 {
-  if (!isDualReturnMode)
+  if (firstDistance == dualDistance && firstIntensity == dualIntensity)
+  {
+    // ignore duplicate point and leave first with original flags
+    return KEEP_FIRST_RETURN;
+  }
+
+  dualFlags = 0;
+  if (firstIntensity < dualIntensity)
   {
-    return (firingblock * 55.296) + (dsr / 2) * 2.304;
+    firstFlags &= ~vtkVelodynePacketInterpreter::DUAL_INTENSITY_HIGH;
+    dualFlags |= vtkVelodynePacketInterpreter::DUAL_INTENSITY_HIGH;
   }
   else
   {
-    return (firingblock / 2 * 55.296) + (dsr / 2) * 2.304;
+    firstFlags &= ~vtkVelodynePacketInterpreter::DUAL_INTENSITY_LOW;
+    dualFlags |= vtkVelodynePacketInterpreter::DUAL_INTENSITY_LOW;
   }
-}
 
-//-----------------------------------------------------------------------------
-double HDL64EAdjustTimeStamp(int firingblock, int dsr, const bool isDualReturnMode)
-{
-  const int dsrReversed = HDL_LASER_PER_FIRING - dsr - 1;
-  const int firingblockReversed = HDL_FIRING_PER_PKT - firingblock - 1;
-  if (!isDualReturnMode)
+  if (firstDistance < dualDistance)
   {
-    const double TimeOffsetMicroSec[4] = { 2.34, 3.54, 4.74, 6.0 };
-    return (std::floor(static_cast<double>(firingblockReversed) / 2.0) * 48.0) +
-      TimeOffsetMicroSec[(dsrReversed % 4)] + (dsrReversed / 4) * TimeOffsetMicroSec[3];
+    firstFlags &= ~vtkVelodynePacketInterpreter::DUAL_DISTANCE_FAR;
+    dualFlags |= vtkVelodynePacketInterpreter::DUAL_DISTANCE_FAR;
   }
   else
   {
-    const double TimeOffsetMicroSec[4] = { 3.5, 4.7, 5.9, 7.2 };
-    return (std::floor(static_cast<double>(firingblockReversed) / 4.0) * 57.6) +
-      TimeOffsetMicroSec[(dsrReversed % 4)] + (dsrReversed / 4) * TimeOffsetMicroSec[3];
+    firstFlags &= ~vtkVelodynePacketInterpreter::DUAL_DISTANCE_NEAR;
+    dualFlags |= vtkVelodynePacketInterpreter::DUAL_DISTANCE_NEAR;
   }
-}
 
-//-----------------------------------------------------------------------------
-double VLS128AdjustTimeStamp(int firingblock, int dsr, const bool isDualReturnMode)
-{
-  if (!isDualReturnMode)
+  // We will output only one point if one of them does not match the filter
+  if (filter && !(dualFlags & filter))
   {
-    return 13.0 * (firingblock) + (dsr / 4) * 1.4;
+    return KEEP_FIRST_RETURN;
   }
-  else
+  if (filter && !(firstFlags & filter))
   {
-    return 13.0 * (firingblock / 2) + (dsr / 4) * 1.4;
+    return KEEP_DUAL_RETURN;
   }
+  return KEEP_BOTH_RETURNS;
 }
 
-
 //-----------------------------------------------------------------------------
-class FramingState
+// Offset of the laser ids of a firing block
+int GetFiringLaserOffset(const HDLFiringData& firingData)
 {
-  int LastAzimuth;
-  int LastAzimuthSlope;
-
-public:
-  FramingState() { reset(); }
-  void reset()
-  {
-    LastAzimuth = -1;
-    LastAzimuthSlope = 0;
-  }
-  bool hasChangedWithValue(const HDLFiringData& firingData)
-  {
-    bool hasLastAzimuth = (LastAzimuth != -1);
-    bool azimuthFrameSplit = hasChangedWithValue(
-      firingData.rotationalPosition, hasLastAzimuth, LastAzimuth, LastAzimuthSlope);
-    return azimuthFrameSplit;
-  }
+  // clang-format off
+  return
+    (firingData.blockIdentifier == BLOCK_0_TO_31)  ?  0 :(
+    (firingData.blockIdentifier == BLOCK_32_TO_63) ? 32 :(
+    (firingData.blockIdentifier == BLOCK_64_TO_95) ? 64 :(
+    (firingData.blockIdentifier == BLOCK_96_TO_127)? 96 :(
+                                                      0))));
+  // clang-format on
+}
 
-  static bool hasChangedWithValue(int curValue, bool& hasLastValue, int& lastValue, int& lastSlope)
-  {
-    // If we dont have previous value, dont change
-    if (!hasLastValue)
-    {
-      lastValue = curValue;
-      hasLastValue = true;
-      return false;
-    }
-    int curSlope = curValue - lastValue;
-    lastValue = curValue;
-    if (curSlope == 0)
-      return false;
-    int isSlopeSameDirection = curSlope * lastSlope;
-    // curSlope has same sign as lastSlope: no change
-    if (isSlopeSameDirection > 0)
-      return false;
-    // curSlope has different sign as lastSlope: change!
-    else if (isSlopeSameDirection < 0)
-    {
-      lastSlope = 0;
-      return true;
-    }
-    // LastAzimuthSlope not set: set the slope
-    if (lastSlope == 0 && curSlope != 0)
-    {
-      lastSlope = curSlope;
-      return false;
-    }
-    vtkGenericWarningMacro("Unhandled sequence of value in state.");
-    return false;
-  }
+//-----------------------------------------------------------------------------
+// A laser return decoded by vtkVelodynePacketInterpreter::DecodeFiring
+struct DecodedReturn
+{
+  double Position[3];
+  double Distance;
+  double Timestamp;
+  unsigned int RawTime;
+  unsigned short Azimuth;
+  unsigned short RawDistance;
+  unsigned char Intensity;
+  unsigned char LaserId;
+  unsigned char RawLaserId;
+};
 
-  static bool willChangeWithValue(int curValue, bool hasLastValue, int lastValue, int lastSlope)
-  {
-    return hasChangedWithValue(curValue, hasLastValue, lastValue, lastSlope);
-  }
+//-----------------------------------------------------------------------------
+// The returns of a firing, only those which are kept being decoded entirely
+struct DecodedFiring
+{
+  DecodedReturn Returns[HDL_LASER_PER_FIRING];
+  bool Kept[HDL_LASER_PER_FIRING];
 };
 
 #pragma pack(push, 1)
@@ -449,12 +474,18 @@ vtkVelodynePacketInterpreter::vtkVelodynePacketInterpreter()
   this->OutputPacketProcessingDebugInfo = false;
   this->SensorPowerMode = 0;
   this->CurrentFrameState = new FramingState;
+  this->PreProcessFrameState = new FramingState;
+  this->CurrentFrameBuffers = new VelodyneFrameBuffers;
+  this->FiringCorrections = new LaserCorrectionArrays();
+  this->AzimuthStep = new AzimuthStepEstimator();
+  this->AzimuthAdjustments = new AzimuthAdjustmentCache();
   this->LastTimestamp = std::numeric_limits<unsigned int>::max();
   this->TimeAdjust = std::numeric_limits<double>::quiet_NaN();
   this->FiringsSkip = 0;
   this->ShouldCheckSensor = true;
 
   std::fill(this->LastPointId, this->LastPointId + HDL_MAX_NUM_LASERS, -1);
+  std::iota(this->LaserVerticalRank, this->LaserVerticalRank + HDL_MAX_NUM_LASERS, 0);
 
   this->LaserSelection.resize(HDL_MAX_NUM_LASERS, true);
   this->DualReturnFilter = 0;
@@ -477,6 +508,11 @@ vtkVelodynePacketInterpreter::~vtkVelodynePacketInterpreter()
     delete this->rollingCalibrationData;
   }
   delete this->CurrentFrameState;
+  delete this->PreProcessFrameState;
+  delete this->CurrentFrameBuffers;
+  delete this->FiringCorrections;
+  delete this->AzimuthStep;
+  delete this->AzimuthAdjustments;
 }
 
 //-----------------------------------------------------------------------------
@@ -494,192 +530,24 @@ void vtkVelodynePacketInterpreter::LoadCalibration(const std::string& filename)
     this->IsCorrectionFromLiveStream = false;
   }
 
-  boost::property_tree::ptree pt;
-  try
-  {
-    read_xml(filename, pt, boost::property_tree::xml_parser::trim_whitespace);
-  }
-  catch (boost::exception const&)
+  std::string error;
+  std::shared_ptr<const VelodyneCalibration> calibration = LoadVelodyneCalibration(filename, error);
+  if (!calibration)
   {
     vtkGenericWarningMacro(
-      "LoadCalibration: error reading calibration file: " << filename);
+      "LoadCalibration: error reading calibration file: " << filename << " (" << error << ")");
     return;
   }
   // Read distLSB if provided
-  BOOST_FOREACH (boost::property_tree::ptree::value_type& v, pt.get_child("boost_serialization.DB"))
-  {
-    if (v.first == "distLSB_")
-    { // Stored in cm in xml
-      DistanceResolutionM = atof(v.second.data().c_str()) / 100.0;
-    }
-  }
-
-  int i, j;
-  i = 0;
-  BOOST_FOREACH (
-    boost::property_tree::ptree::value_type& p, pt.get_child("boost_serialization.DB.colors_"))
-  {
-    if (p.first == "item")
-    {
-      j = 0;
-      BOOST_FOREACH (boost::property_tree::ptree::value_type& v, p.second.get_child("rgb"))
-        if (v.first == "item")
-        {
-          std::stringstream ss;
-          double val;
-          ss << v.second.data();
-          ss >> val;
-
-          XMLColorTable[i][j] = val;
-          j++;
-        }
-      i++;
-    }
-  }
-
-  int enabledCount = 0;
-  BOOST_FOREACH (
-    boost::property_tree::ptree::value_type& v, pt.get_child("boost_serialization.DB.enabled_"))
+  if (calibration->DistanceResolutionM > 0.)
   {
-    std::stringstream ss;
-    if (v.first == "item")
-    {
-      ss << v.second.data();
-      int test = 0;
-      ss >> test;
-      if (!ss.fail() && test == 1)
-      {
-        enabledCount++;
-      }
-    }
-  }
-  this->CalibrationReportedNumLasers = enabledCount;
-
-  // Getting min & max intensities from XML
-  int laserId = 0;
-  int minIntensity[HDL_MAX_NUM_LASERS], maxIntensity[HDL_MAX_NUM_LASERS];
-  BOOST_FOREACH (boost::property_tree::ptree::value_type& v,
-    pt.get_child("boost_serialization.DB.minIntensity_"))
-  {
-    std::stringstream ss;
-    if (v.first == "item")
-    {
-      ss << v.second.data();
-      ss >> minIntensity[laserId];
-      laserId++;
-    }
-  }
-
-  laserId = 0;
-  BOOST_FOREACH (boost::property_tree::ptree::value_type& v,
-    pt.get_child("boost_serialization.DB.maxIntensity_"))
-  {
-    std::stringstream ss;
-    if (v.first == "item")
-    {
-      ss << v.second.data();
-      ss >> maxIntensity[laserId];
-      laserId++;
-    }
-  }
-
-  BOOST_FOREACH (
-    boost::property_tree::ptree::value_type& v, pt.get_child("boost_serialization.DB.points_"))
-  {
-    if (v.first == "item")
-    {
-      boost::property_tree::ptree points = v.second;
-      BOOST_FOREACH (boost::property_tree::ptree::value_type& px, points)
-      {
-        if (px.first == "px")
-        {
-          boost::property_tree::ptree calibrationData = px.second;
-          int index = -1;
-          HDLLaserCorrection xmlData;
-
-          BOOST_FOREACH (boost::property_tree::ptree::value_type& item, calibrationData)
-          {
-            if (item.first == "id_")
-              index = atoi(item.second.data().c_str());
-            if (item.first == "rotCorrection_")
-              xmlData.rotationalCorrection = atof(item.second.data().c_str());
-            if (item.first == "vertCorrection_")
-              xmlData.verticalCorrection = atof(item.second.data().c_str());
-            if (item.first == "distCorrection_")
-              xmlData.distanceCorrection = atof(item.second.data().c_str());
-            if (item.first == "distCorrectionX_")
-              xmlData.distanceCorrectionX = atof(item.second.data().c_str());
-            if (item.first == "distCorrectionY_")
-              xmlData.distanceCorrectionY = atof(item.second.data().c_str());
-            if (item.first == "vertOffsetCorrection_")
-              xmlData.verticalOffsetCorrection = atof(item.second.data().c_str());
-            if (item.first == "horizOffsetCorrection_")
-              xmlData.horizontalOffsetCorrection = atof(item.second.data().c_str());
-            if (item.first == "focalDistance_")
-              xmlData.focalDistance = atof(item.second.data().c_str());
-            if (item.first == "focalSlope_")
-              xmlData.focalSlope = atof(item.second.data().c_str());
-            if (item.first == "closeSlope_")
-              xmlData.closeSlope = atof(item.second.data().c_str());
-          }
-          if (index != -1 && index < HDL_MAX_NUM_LASERS)
-          {
-            laser_corrections_[index] = xmlData;
-            // Angles are already stored in degrees in xml
-            // Distances are stored in centimeters in xml, and we store meters.
-            laser_corrections_[index].distanceCorrection /= 100.0;
-            laser_corrections_[index].distanceCorrectionX /= 100.0;
-            laser_corrections_[index].distanceCorrectionY /= 100.0;
-            laser_corrections_[index].verticalOffsetCorrection /= 100.0;
-            laser_corrections_[index].horizontalOffsetCorrection /= 100.0;
-            laser_corrections_[index].focalDistance /= 100.0;
-            laser_corrections_[index].focalSlope /= 100.0;
-            laser_corrections_[index].closeSlope /= 100.0;
-            if (laser_corrections_[index].closeSlope == 0.0)
-              laser_corrections_[index].closeSlope = laser_corrections_[index].focalSlope;
-            laser_corrections_[index].minIntensity = minIntensity[index];
-            laser_corrections_[index].maxIntensity = maxIntensity[index];
-          }
-        }
-      }
-    }
-  }
-
-  int idx = 0;
-  BOOST_FOREACH (boost::property_tree::ptree::value_type& v,
-    pt.get_child("boost_serialization.DB.minIntensity_"))
-  {
-    std::stringstream ss;
-    if (v.first == "item")
-    {
-      ss << v.second.data();
-      int intensity = 0;
-      ss >> intensity;
-      if (!ss.fail() && idx < HDL_MAX_NUM_LASERS)
-      {
-        laser_corrections_[idx].minIntensity = intensity;
-      }
-      idx++;
-    }
-  }
-
-  idx = 0;
-  BOOST_FOREACH (boost::property_tree::ptree::value_type& v,
-    pt.get_child("boost_serialization.DB.maxIntensity_"))
-  {
-    std::stringstream ss;
-    if (v.first == "item")
-    {
-      ss << v.second.data();
-      int intensity = 0;
-      ss >> intensity;
-      if (!ss.fail() && idx < HDL_MAX_NUM_LASERS)
-      {
-        laser_corrections_[idx].maxIntensity = intensity;
-      }
-      idx++;
-    }
+    this->DistanceResolutionM = calibration->DistanceResolutionM;
   }
+  std::copy(&calibration->ColorTable[0][0], &calibration->ColorTable[0][0] + HDL_MAX_NUM_LASERS * 3,
+    &this->XMLColorTable[0][0]);
+  this->CalibrationReportedNumLasers = calibration->NumberOfLasers;
+  std::copy(calibration->Corrections, calibration->Corrections + HDL_MAX_NUM_LASERS,
+    this->laser_corrections_);
 
   PrecomputeCorrectionCosSin();
   this->IsCalibrated = true;
@@ -714,8 +582,46 @@ void vtkVelodynePacketInterpreter::LoadCalibration(const std::string& filename)
   AddToCalibrationDataRowNamed("cosVertOffsetCorrection",   cosVertOffsetCorrection)
 }
 
+//-----------------------------------------------------------------------------
+bool vtkVelodynePacketInterpreter::SaveCompiledCalibration(const std::string& filename)
+{
+  if (!this->IsCalibrated)
+  {
+    return false;
+  }
+  VelodyneCalibration calibration;
+  calibration.DistanceResolutionM = this->DistanceResolutionM;
+  calibration.NumberOfLasers = this->CalibrationReportedNumLasers;
+  std::copy(&this->XMLColorTable[0][0], &this->XMLColorTable[0][0] + HDL_MAX_NUM_LASERS * 3,
+    &calibration.ColorTable[0][0]);
+  std::copy(this->laser_corrections_, this->laser_corrections_ + HDL_MAX_NUM_LASERS,
+    calibration.Corrections);
+  std::ofstream file(filename, std::ios::binary);
+  return WriteCompiledVelodyneCalibration(calibration, file);
+}
+
 //-----------------------------------------------------------------------------
 void vtkVelodynePacketInterpreter::ProcessPacket(unsigned char const * data, unsigned int dataLength)
+{
+  this->ProcessDataPacket(data, dataLength);
+}
+
+//-----------------------------------------------------------------------------
+size_t vtkVelodynePacketInterpreter::ProcessPackets(const RawPacket* packets, size_t numberOfPackets)
+{
+  for (size_t i = 0; i < numberOfPackets; ++i)
+  {
+    this->ProcessDataPacket(packets[i].Data, packets[i].Length);
+    if (this->IsNewFrameReady())
+    {
+      return i + 1;
+    }
+  }
+  return numberOfPackets;
+}
+
+//-----------------------------------------------------------------------------
+void vtkVelodynePacketInterpreter::ProcessDataPacket(unsigned char const * data, unsigned int dataLength)
 {
   if (!this->IsLidarPacket(data, dataLength))
   {
@@ -726,12 +632,28 @@ void vtkVelodynePacketInterpreter::ProcessPacket(unsigned char const * data, uns
 
   this->IsHDL64Data |= dataPacket->isHDL64();
 
-  // Accumulate HDL64 Status byte data
+  // Accumulate HDL64 Status byte data, the packets are kept to be decoded
+  // once the corrections are known
   if (IsHDL64Data && this->IsCorrectionFromLiveStream &&
     !this->IsCalibrated)
   {
-    this->rollingCalibrationData->appendData(dataPacket->gpsTimestamp, dataPacket->factoryField1, dataPacket->factoryField2);
-    this->HDL64LoadCorrectionsFromStreamData();
+    this->PacketsWaitingForCalibration.emplace_back(data, data + dataLength);
+    if (this->PacketsWaitingForCalibration.size() > MaxPacketsWaitingForCalibration)
+    {
+      this->PacketsWaitingForCalibration.pop_front();
+    }
+    // the corrections can only be complete when a new status cycle begins
+    if (this->rollingCalibrationData->appendData(
+          dataPacket->gpsTimestamp, dataPacket->factoryField1, dataPacket->factoryField2) &&
+      this->HDL64LoadCorrectionsFromStreamData())
+    {
+      std::deque<std::vector<unsigned char> > packets;
+      packets.swap(this->PacketsWaitingForCalibration);
+      for (const auto& packet : packets)
+      {
+        this->ProcessDataPacket(packet.data(), static_cast<unsigned int>(packet.size()));
+      }
+    }
     return;
   }
 
@@ -741,6 +663,8 @@ void vtkVelodynePacketInterpreter::ProcessPacket(unsigned char const * data, uns
     ShouldCheckSensor = false;
   }
 
+  this->UpdateDecodingMasks();
+
   // Check if the time has rolled during this packet
   if (dataPacket->gpsTimestamp < this->ParserMetaData.FirstPacketDataTime)
   {
@@ -753,11 +677,12 @@ void vtkVelodynePacketInterpreter::ProcessPacket(unsigned char const * data, uns
   const double timestamp = this->ComputeTimestamp(dataPacket->gpsTimestamp, this->ParserMetaData);
 
   // Update the rpm computation (by packets)
-  this->RpmCalculator_->AddData(dataPacket, rawtime);
+  this->RpmCalculator_->AddData(dataPacket->firingData[0].rotationalPosition, rawtime);
 
-  // Update the transforms here and then call internal
-  // transform
-  if (SensorTransform) this->SensorTransform->Update();
+  if (this->DetectGapsWhileDecoding)
+  {
+    this->PacketGaps.AddPacket(1e-6 * rawtime, 0.01 * dataPacket->firingData[0].rotationalPosition);
+  }
 
   VelodyneSpecificFrameInformation* velodyneFrameInfo =
       reinterpret_cast<VelodyneSpecificFrameInformation*>(this->ParserMetaData.SpecificInformation.get());
@@ -765,16 +690,6 @@ void vtkVelodynePacketInterpreter::ProcessPacket(unsigned char const * data, uns
   velodyneFrameInfo->FiringToSkip = 0;
 
   bool isVLS128 = dataPacket->isVLS128();
-  // Compute the list of total azimuth advanced during one full firing block
-  std::vector<int> diffs(HDL_FIRING_PER_PKT - 1);
-  for (int i = 0; i < HDL_FIRING_PER_PKT - 1; ++i)
-  {
-    int localDiff = (36000 + 18000 + dataPacket->firingData[i + 1].rotationalPosition -
-                      dataPacket->firingData[i].rotationalPosition) %
-      36000 - 18000;
-    diffs[i] = localDiff;
-  }
-
 
   if (!IsHDL64Data)
   { // with HDL64, it should be filled by LoadCorrectionsFromStreamData
@@ -782,40 +697,56 @@ void vtkVelodynePacketInterpreter::ProcessPacket(unsigned char const * data, uns
     this->ReportedSensorReturnMode = dataPacket->getDualReturnSensorMode();
   }
 
-  std::sort(diffs.begin(), diffs.end());
-  // Assume the median of the packet's rotationalPosition differences
-  int azimuthDiff = diffs[HDL_FIRING_PER_PKT / 2];
-  if (this->IsHDL64Data)
+  // With VLS-128 the azimuth difference is given per firing block
+  int azimuthDiff = 0;
+  if (!isVLS128)
   {
-    azimuthDiff = diffs[HDL_FIRING_PER_PKT - 2];
-  }
-  else if (isVLS128)
-  {
-    azimuthDiff = diffs[HDL_FIRING_PER_PKT - 1];
+    // Compute the list of total azimuth advanced during one full firing block
+    std::array<int, HDL_FIRING_PER_PKT - 1> diffs;
+    for (int i = 0; i < HDL_FIRING_PER_PKT - 1; ++i)
+    {
+      int localDiff = (36000 + 18000 + dataPacket->firingData[i + 1].rotationalPosition -
+                        dataPacket->firingData[i].rotationalPosition) %
+        36000 - 18000;
+      diffs[i] = localDiff;
+    }
+
+    // Assume the median of the packet's rotationalPosition differences, which is predicted
+    // from the previous packet and only checked, without sorting, in the common case
+    const int azimuthDiffIndex =
+      this->IsHDL64Data ? HDL_FIRING_PER_PKT - 2 : HDL_FIRING_PER_PKT / 2;
+    azimuthDiff = this->AzimuthStep->Update(diffs.data(), HDL_FIRING_PER_PKT - 1, azimuthDiffIndex);
   }
 
   // assert(azimuthDiff > 0);
 
+  // The intra-firing adjustments of the sensor are selected once for the whole packet
+  const FiringTimingTable& timing =
+    GetFiringTimingTable(this->GetFiringTimingModel(), dataPacket->isDualModeReturn());
+
   // Add DualReturn-specific arrays if newly detected dual return packet
   if (dataPacket->isDualModeReturn() && !this->HasDualReturn)
   {
     this->HasDualReturn = true;
-    this->CurrentFrame->GetPointData()->AddArray(this->DistanceFlag.GetPointer());
-    this->CurrentFrame->GetPointData()->AddArray(this->IntensityFlag.GetPointer());
-    this->CurrentFrame->GetPointData()->AddArray(this->DualReturnMatching.GetPointer());
+    const VelodyneFrameBuffers& frame = *this->CurrentFrameBuffers;
+    if (frame.Has(ARRAY_DUAL_DISTANCE))
+    {
+      this->CurrentFrame->GetPointData()->AddArray(this->DistanceFlag.GetPointer());
+    }
+    if (frame.Has(ARRAY_DUAL_INTENSITY))
+    {
+      this->CurrentFrame->GetPointData()->AddArray(this->IntensityFlag.GetPointer());
+    }
+    if (frame.Has(ARRAY_DUAL_RETURN_MATCHING))
+    {
+      this->CurrentFrame->GetPointData()->AddArray(this->DualReturnMatching.GetPointer());
+    }
   }
 
   for (; firingBlock < HDL_FIRING_PER_PKT; ++firingBlock)
   {
     const HDLFiringData* firingData = &(dataPacket->firingData[firingBlock]);
-    // clang-format off
-    int multiBlockLaserIdOffset =
-        (firingData->blockIdentifier == BLOCK_0_TO_31)  ?  0 :(
-        (firingData->blockIdentifier == BLOCK_32_TO_63) ? 32 :(
-        (firingData->blockIdentifier == BLOCK_64_TO_95) ? 64 :(
-        (firingData->blockIdentifier == BLOCK_96_TO_127)? 96 :(
-                                                           0))));
-    // clang-format on
+    int multiBlockLaserIdOffset = GetFiringLaserOffset(*firingData);
 
     // Skip dummy blocks of VLS-128 dual mode last 4 blocks
     if (isVLS128 && (firingData->blockIdentifier == 0 || firingData->blockIdentifier == 0xFFFF))
@@ -824,26 +755,107 @@ void vtkVelodynePacketInterpreter::ProcessPacket(unsigned char const * data, uns
     }
 
 
-    if (this->CurrentFrameState->hasChangedWithValue(*firingData))
+    const bool isNewRotation =
+      this->CurrentFrameState->hasChangedWithValue(firingData->rotationalPosition);
+    if (isNewRotation)
     {
       this->SplitFrame();
       this->LastTimestamp = std::numeric_limits<unsigned int>::max();
     }
+    this->SplitSector((firingData->rotationalPosition % 36000) * 0.01, isNewRotation);
 
     if (isVLS128)
     {
       azimuthDiff = dataPacket->getRotationalDiffForVLS128(firingBlock);
     }
 
+    // The dual returns are paired with the first returns before being added to the frame
+    const int dualFiringGroupSize = this->GetDualFiringGroupSize(dataPacket, firingBlock);
+    if (dualFiringGroupSize > 0)
+    {
+      this->ProcessDualFirings(
+        dataPacket, firingBlock, dualFiringGroupSize, azimuthDiff, timestamp, rawtime, timing);
+      firingBlock += dualFiringGroupSize - 1;
+      continue;
+    }
+
     // Skip this firing every PointSkip
     if (this->FiringsSkip == 0 || firingBlock % (this->FiringsSkip + 1) == 0)
     {
       this->ProcessFiring(firingData, multiBlockLaserIdOffset, firingBlock, azimuthDiff, timestamp,
-        rawtime, dataPacket->isDualReturnFiringBlock(firingBlock), dataPacket->isDualModeReturn());
+        rawtime, dataPacket->isDualReturnFiringBlock(firingBlock), timing);
     }
   }
 }
 
+//-----------------------------------------------------------------------------
+int vtkVelodynePacketInterpreter::GetNumberOfOptionalArrays()
+{
+  return static_cast<int>(sizeof(OptionalArrayNames) / sizeof(OptionalArrayNames[0]));
+}
+
+//-----------------------------------------------------------------------------
+const char* vtkVelodynePacketInterpreter::GetOptionalArrayName(int index)
+{
+  if (index < 0 || index >= this->GetNumberOfOptionalArrays())
+  {
+    return nullptr;
+  }
+  return OptionalArrayNames[index];
+}
+
+//-----------------------------------------------------------------------------
+int vtkVelodynePacketInterpreter::GetOptionalArrayStatus(const char* name)
+{
+  for (int i = 0; name && i < this->GetNumberOfOptionalArrays(); ++i)
+  {
+    if (std::strcmp(name, OptionalArrayNames[i]) == 0)
+    {
+      return (this->OptionalArrays & (1u << i)) ? 1 : 0;
+    }
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+void vtkVelodynePacketInterpreter::SetOptionalArrayStatus(const char* name, int status)
+{
+  for (int i = 0; name && i < this->GetNumberOfOptionalArrays(); ++i)
+  {
+    if (std::strcmp(name, OptionalArrayNames[i]) == 0)
+    {
+      // the selection is used from the next frame
+      this->SetOptionalArrays(status ? (this->OptionalArrays | (1u << i))
+                                     : (this->OptionalArrays & ~(1u << i)));
+      return;
+    }
+  }
+  vtkWarningMacro("Unknown optional array: " << (name ? name : "(null)"));
+}
+
+//-----------------------------------------------------------------------------
+FiringTimingModel vtkVelodynePacketInterpreter::GetFiringTimingModel() const
+{
+  if (!this->UseIntraFiringAdjustment)
+  {
+    return FiringTimingModel::None;
+  }
+  switch (this->CalibrationReportedNumLasers)
+  {
+    case 128:
+      return FiringTimingModel::VLS128;
+    case 64:
+      return FiringTimingModel::HDL64;
+    case 32:
+      return (this->ReportedSensor == VLP32AB || this->ReportedSensor == VLP32C)
+        ? FiringTimingModel::VLP32 : FiringTimingModel::HDL32;
+    case 16:
+      return FiringTimingModel::VLP16;
+    default:
+      return FiringTimingModel::None;
+  }
+}
+
 //-----------------------------------------------------------------------------
 bool vtkVelodynePacketInterpreter::IsLidarPacket(unsigned char const * data, unsigned int dataLength)
 {
@@ -858,263 +870,340 @@ bool vtkVelodynePacketInterpreter::IsLidarPacket(unsigned char const * data, uns
 }
 
 //-----------------------------------------------------------------------------
-void vtkVelodynePacketInterpreter::ProcessFiring(const HDLFiringData *firingData, int firingBlockLaserOffset, int firingBlock, int azimuthDiff, double timestamp, unsigned int rawtime, bool isThisFiringDualReturnData, bool isDualReturnPacket)
+void vtkVelodynePacketInterpreter::ProcessFiring(const HDLFiringData *firingData, int firingBlockLaserOffset, int firingBlock, int azimuthDiff, double timestamp, unsigned int rawtime, bool isThisFiringDualReturnData, const FiringTimingTable& timing)
 {
   // First return block of a dual return packet: init last point of laser
   if (!isThisFiringDualReturnData &&
     (!this->IsHDL64Data || (this->IsHDL64Data && ((firingBlock % 4) == 0))))
   {
-    this->FirstPointIdOfDualReturnPair = this->Points->GetNumberOfPoints();
+    this->FirstPointIdOfDualReturnPair = this->CurrentFrameBuffers->GetNumberOfPoints();
   }
 
-  for (int dsr = 0; dsr < HDL_LASER_PER_FIRING; dsr++)
+  if (this->CalibrationReportedNumLasers == 16 && firingBlockLaserOffset != 0)
   {
-    const unsigned char rawLaserId = static_cast<unsigned char>(dsr + firingBlockLaserOffset);
-    unsigned char laserId = rawLaserId;
-    const unsigned short azimuth = firingData->rotationalPosition;
-
-    // Detect VLP-16 data and adjust laser id if necessary
-    int firingWithinBlock = 0;
-
-    if (this->CalibrationReportedNumLasers == 16)
+    if (!this->alreadyWarnedForIgnoredHDL64FiringPacket)
     {
-      if (firingBlockLaserOffset != 0)
-      {
-        if (!this->alreadyWarnedForIgnoredHDL64FiringPacket)
-        {
-          vtkGenericWarningMacro("Error: Received a HDL-64 UPPERBLOCK firing packet "
-                                 "with a VLP-16 calibration file. Ignoring the firing.");
-          this->alreadyWarnedForIgnoredHDL64FiringPacket = true;
-        }
-        return;
-      }
-      if (laserId >= 16)
-      {
-        laserId -= 16;
-        firingWithinBlock = 1;
-      }
+      vtkGenericWarningMacro("Error: Received a HDL-64 UPPERBLOCK firing packet "
+                             "with a VLP-16 calibration file. Ignoring the firing.");
+      this->alreadyWarnedForIgnoredHDL64FiringPacket = true;
     }
+    return;
+  }
 
-    // Interpolate azimuths and timestamps per laser within firing blocks
-    double timestampadjustment = 0;
-    int azimuthadjustment = 0;
-    if (this->UseIntraFiringAdjustment)
-    {
-      double blockdsr0 = 0, nextblockdsr0 = 1;
-      switch (this->CalibrationReportedNumLasers)
-      {
-        case 128:
-        {
-          timestampadjustment = VLS128AdjustTimeStamp(firingBlock, dsr, isDualReturnPacket);
-          nextblockdsr0 = VLS128AdjustTimeStamp(
-            firingBlock + (isDualReturnPacket ? 8 : 4), 0, isDualReturnPacket);
-          blockdsr0 = VLS128AdjustTimeStamp(firingBlock, 0, isDualReturnPacket);
-          break;
-        }
-        case 64:
-        {
-          timestampadjustment = -HDL64EAdjustTimeStamp(firingBlock, dsr, isDualReturnPacket);
-          nextblockdsr0 = -HDL64EAdjustTimeStamp(
-            firingBlock + (isDualReturnPacket ? 4 : 2), 0, isDualReturnPacket);
-          blockdsr0 = -HDL64EAdjustTimeStamp(firingBlock, 0, isDualReturnPacket);
-          break;
-        }
-        case 32:
-        {
-          if (this->ReportedSensor == VLP32AB || this->ReportedSensor == VLP32C)
-          {
-            timestampadjustment = VLP32AdjustTimeStamp(firingBlock, dsr, isDualReturnPacket);
-            nextblockdsr0 = VLP32AdjustTimeStamp(
-              firingBlock + (isDualReturnPacket ? 2 : 1), 0, isDualReturnPacket);
-            blockdsr0 = VLP32AdjustTimeStamp(firingBlock, 0, isDualReturnPacket);
-          }
-          else
-          {
-            timestampadjustment = HDL32AdjustTimeStamp(firingBlock, dsr, isDualReturnPacket);
-            nextblockdsr0 = HDL32AdjustTimeStamp(
-              firingBlock + (isDualReturnPacket ? 2 : 1), 0, isDualReturnPacket);
-            blockdsr0 = HDL32AdjustTimeStamp(firingBlock, 0, isDualReturnPacket);
-          }
-          break;
-        }
-        case 16:
-        {
-          timestampadjustment =
-            VLP16AdjustTimeStamp(firingBlock, laserId, firingWithinBlock, isDualReturnPacket);
-          nextblockdsr0 = VLP16AdjustTimeStamp(
-            firingBlock + (isDualReturnPacket ? 2 : 1), 0, 0, isDualReturnPacket);
-          blockdsr0 = VLP16AdjustTimeStamp(firingBlock, 0, 0, isDualReturnPacket);
-          break;
-        }
-        default:
-        {
-          timestampadjustment = 0.0;
-          blockdsr0 = 0.0;
-          nextblockdsr0 = 1.0;
-        }
-      }
-      azimuthadjustment = vtkMath::Round(
-        azimuthDiff * ((timestampadjustment - blockdsr0) / (nextblockdsr0 - blockdsr0)));
-      timestampadjustment = vtkMath::Round(timestampadjustment);
-    }
-    if ((!this->IgnoreZeroDistances || firingData->laserReturns[dsr].distance != 0.0) &&
-      this->LaserSelection[laserId])
+  DecodedFiring firing;
+  this->DecodeFiring(firingData, firingBlockLaserOffset, firingBlock, azimuthDiff, timestamp,
+    rawtime, timing, firing);
+  for (int dsr = 0; dsr < HDL_LASER_PER_FIRING; dsr++)
+  {
+    if (firing.Kept[dsr])
     {
-      this->PushFiringData(laserId, rawLaserId, azimuth + azimuthadjustment,
-        timestamp + timestampadjustment, rawtime + static_cast<unsigned int>(timestampadjustment),
-        &(firingData->laserReturns[dsr]), &(laser_corrections_[dsr + firingBlockLaserOffset]),
-        isThisFiringDualReturnData);
+      this->PushFiringData(firing.Returns[dsr], isThisFiringDualReturnData);
     }
   }
 }
 
 //-----------------------------------------------------------------------------
-void vtkVelodynePacketInterpreter::PushFiringData(unsigned char laserId, unsigned char rawLaserId,
-                                                  unsigned short azimuth, double timestamp,
-                                                  unsigned int rawtime, const HDLLaserReturn *laserReturn,
-                                                  const HDLLaserCorrection *correction, bool isFiringDualReturnData)
+void vtkVelodynePacketInterpreter::DecodeFiring(const HDLFiringData* firingData,
+  int firingBlockLaserOffset, int firingBlock, int azimuthDiff, double timestamp,
+  unsigned int rawtime, const FiringTimingTable& timing, DecodedFiring& firing)
 {
-  azimuth %= 36000;
-  const vtkIdType thisPointId = this->Points->GetNumberOfPoints();
-  short intensity = laserReturn->intensity;
-
-  // Compute raw position
-  double distanceM;
-  double pos[3];
-  bool applyIntensityCorrection =
-    this->WantIntensityCorrection && this->IsHDL64Data && !(this->SensorPowerMode == CorrectionOn);
-  ComputeCorrectedValues(
-    azimuth, laserReturn, correction, pos, distanceM, intensity, applyIntensityCorrection);
+  std::fill(firing.Kept, firing.Kept + HDL_LASER_PER_FIRING, false);
+
+  // Pre-decode filter: drop the whole firing before any computation if it is outside of
+  // the azimuth sector. Both returns of a dual return pair share the same azimuth.
+  if (!this->IsAzimuthInSector(firingData->rotationalPosition * 0.01))
+  {
+    return;
+  }
 
-  // Apply sensor transform
-  if (SensorTransform) this->SensorTransform->InternalTransformPoint(pos, pos);
+  const double minimumRawDistance = this->RawDistanceRange[0];
+  const double maximumRawDistance = this->RawDistanceRange[1];
 
-  if (this->shouldBeCroppedOut(pos))
+  // First pass: compute the azimuth and the timestamp of each return, then the
+  // positions of the whole firing are computed at once with SIMD instructions
+  FiringBuffer positions;
+  int numberOfReturnsKept = 0;
+  // Interpolate azimuths and timestamps per laser within firing blocks
+  const double* timestampAdjustments = timing.TimestampAdjustment[firingBlock];
+  const int* azimuthAdjustments = this->AzimuthAdjustments->Get(timing, firingBlock, azimuthDiff);
+  // VLP-16 firing blocks hold two firings of the 16 lasers
+  const bool isVLP16 = this->CalibrationReportedNumLasers == 16;
+  const unsigned short azimuth = firingData->rotationalPosition;
+  for (int dsr = 0; dsr < HDL_LASER_PER_FIRING; dsr++)
+  {
+    DecodedReturn& laserReturn = firing.Returns[dsr];
+    const unsigned char rawLaserId = static_cast<unsigned char>(dsr + firingBlockLaserOffset);
+    const unsigned char laserId = (isVLP16 && rawLaserId >= 16) ? rawLaserId - 16 : rawLaserId;
+    const unsigned short rawDistance = firingData->laserReturns[dsr].distance;
+    firing.Kept[dsr] = this->LaserMask[laserId] &&
+      (!this->IgnoreZeroDistances || rawDistance != 0) &&
+      rawDistance >= minimumRawDistance && rawDistance <= maximumRawDistance;
+    numberOfReturnsKept += firing.Kept[dsr] ? 1 : 0;
+
+    laserReturn.LaserId = laserId;
+    laserReturn.RawLaserId = rawLaserId;
+    laserReturn.RawDistance = rawDistance;
+    laserReturn.Azimuth = static_cast<unsigned short>(azimuth + azimuthAdjustments[dsr]) % 36000;
+    laserReturn.Timestamp = timestamp + timestampAdjustments[dsr];
+    laserReturn.RawTime = rawtime + static_cast<unsigned int>(timestampAdjustments[dsr]);
+    positions.CosAzimuth[dsr] = this->cos_lookup_table_[laserReturn.Azimuth];
+    positions.SinAzimuth[dsr] = this->sin_lookup_table_[laserReturn.Azimuth];
+    positions.RawDistance[dsr] = rawDistance;
+    positions.RawIntensity[dsr] = firingData->laserReturns[dsr].intensity;
+  }
+
+  if (numberOfReturnsKept == 0)
+  {
     return;
+  }
 
-  // Do not add any data before here as this might short-circuit
-  if (isFiringDualReturnData)
+  ComputeFiringPositions(
+    *this->FiringCorrections, firingBlockLaserOffset, this->DistanceResolutionM, positions);
+  if (this->ApplySensorMatrix)
+  {
+    TransformFiringPositions(this->SensorMatrix, positions);
+  }
+  // Intensity corrected with the focal distance and slope of the laser (HDL-64 only)
+  const bool applyIntensityCorrection =
+    this->WantIntensityCorrection && this->IsHDL64Data && !(this->SensorPowerMode == CorrectionOn);
+  if (applyIntensityCorrection)
+  {
+    ComputeFiringIntensities(*this->FiringCorrections, firingBlockLaserOffset, positions);
+  }
+
+  // Second pass: intensity and crop of the returns
+  for (int dsr = 0; dsr < HDL_LASER_PER_FIRING; dsr++)
   {
-    const vtkIdType dualPointId = this->LastPointId[rawLaserId];
-    if (dualPointId < this->FirstPointIdOfDualReturnPair)
+    if (!firing.Kept[dsr])
     {
-      // No matching point from first set (skipped?)
-      this->Flags->InsertNextValue(DUAL_DOUBLED);
-      this->DistanceFlag->InsertNextValue(0);
-      this->DualReturnMatching->InsertNextValue(-1); // std::numeric_limits<vtkIdType>::quiet_NaN()
-      this->IntensityFlag->InsertNextValue(0);
+      continue;
     }
-    else
+    DecodedReturn& laserReturn = firing.Returns[dsr];
+    laserReturn.Position[0] = positions.X[dsr];
+    laserReturn.Position[1] = positions.Y[dsr];
+    laserReturn.Position[2] = positions.Z[dsr];
+    laserReturn.Distance = positions.Distance[dsr];
+    laserReturn.Intensity = applyIntensityCorrection
+      ? static_cast<unsigned char>(positions.Intensity[dsr])
+      : firingData->laserReturns[dsr].intensity;
+
+    if (this->ApplySelectionWhileDecoding && this->CropMode != CROP_MODE::None &&
+        this->shouldBeCroppedOut(laserReturn.Position))
     {
-      const short dualIntensity = this->Intensity->GetValue(dualPointId);
-      const double dualDistance = this->Distance->GetValue(dualPointId);
-      unsigned int firstFlags = this->Flags->GetValue(dualPointId);
-      unsigned int secondFlags = 0;
+      firing.Kept[dsr] = false;
+    }
+  }
+}
 
-      if (dualDistance == distanceM && intensity == dualIntensity)
-      {
-        // ignore duplicate point and leave first with original flags
-        return;
-      }
+//-----------------------------------------------------------------------------
+int vtkVelodynePacketInterpreter::GetDualFiringGroupSize(
+  const HDLDataPacket* dataPacket, int firingBlock) const
+{
+  if (!dataPacket->isDualModeReturn() || this->FiringsSkip != 0)
+  {
+    return 0;
+  }
+  const int groupSize = dataPacket->isHDL64() ? 4 : 2;
+  const int half = groupSize / 2;
+  if (firingBlock % groupSize != 0 || firingBlock + groupSize > HDL_FIRING_PER_PKT)
+  {
+    return 0;
+  }
 
-      if (dualIntensity < intensity)
-      {
-        firstFlags &= ~DUAL_INTENSITY_HIGH;
-        secondFlags |= DUAL_INTENSITY_HIGH;
-      }
-      else
-      {
-        firstFlags &= ~DUAL_INTENSITY_LOW;
-        secondFlags |= DUAL_INTENSITY_LOW;
-      }
+  const HDLFiringData* group = &dataPacket->firingData[firingBlock];
+  for (int i = 0; i < groupSize; ++i)
+  {
+    const unsigned short blockIdentifier = group[i].blockIdentifier;
+    // the frame split is only checked with the azimuth of the first block
+    if (group[i].rotationalPosition != group[0].rotationalPosition ||
+      dataPacket->isDualReturnFiringBlock(firingBlock + i) != (i >= half) ||
+      (i >= half && blockIdentifier != group[i - half].blockIdentifier) ||
+      (i > 0 && i < half && blockIdentifier == group[0].blockIdentifier) ||
+      (dataPacket->isVLS128() && (blockIdentifier == 0 || blockIdentifier == 0xFFFF)) ||
+      (this->CalibrationReportedNumLasers == 16 && GetFiringLaserOffset(group[i]) != 0))
+    {
+      return 0;
+    }
+  }
+  return groupSize;
+}
 
-      if (dualDistance < distanceM)
-      {
-        firstFlags &= ~DUAL_DISTANCE_FAR;
-        secondFlags |= DUAL_DISTANCE_FAR;
-      }
-      else
-      {
-        firstFlags &= ~DUAL_DISTANCE_NEAR;
-        secondFlags |= DUAL_DISTANCE_NEAR;
-      }
+//-----------------------------------------------------------------------------
+void vtkVelodynePacketInterpreter::ProcessDualFirings(const HDLDataPacket* dataPacket,
+  int firingBlock, int numberOfBlocks, int azimuthDiff, double timestamp, unsigned int rawtime,
+  const FiringTimingTable& timing)
+{
+  const int maximumNumberOfReturns = 4 * HDL_LASER_PER_FIRING;
+  DecodedFiring firings[4];
+  for (int i = 0; i < numberOfBlocks; ++i)
+  {
+    const int block = firingBlock + i;
+    const HDLFiringData* firingData = &dataPacket->firingData[block];
+    this->DecodeFiring(firingData, GetFiringLaserOffset(*firingData), block,
+      dataPacket->isVLS128() ? dataPacket->getRotationalDiffForVLS128(block) : azimuthDiff,
+      timestamp, rawtime, timing, firings[i]);
+  }
+
+  // Pair each dual return with the first return of the same laser. The returns of the
+  // blocks are numbered in order, the first returns being in the first half.
+  const int numberOfReturns = numberOfBlocks * HDL_LASER_PER_FIRING;
+  const DecodedReturn* returns[maximumNumberOfReturns];
+  unsigned int flags[maximumNumberOfReturns];
+  int dualReturn[maximumNumberOfReturns];
+  int firstReturnOfLaser[HDL_MAX_NUM_LASERS];
+  std::fill(firstReturnOfLaser, firstReturnOfLaser + HDL_MAX_NUM_LASERS, -1);
+  for (int r = 0; r < numberOfReturns; ++r)
+  {
+    const DecodedFiring& firing = firings[r / HDL_LASER_PER_FIRING];
+    const int dsr = r % HDL_LASER_PER_FIRING;
+    returns[r] = firing.Kept[dsr] ? &firing.Returns[dsr] : nullptr;
+    flags[r] = DUAL_DOUBLED;
+    dualReturn[r] = -1;
+    if (!returns[r])
+    {
+      continue;
+    }
+    if (r < numberOfReturns / 2)
+    {
+      firstReturnOfLaser[returns[r]->RawLaserId] = r;
+      continue;
+    }
+    const int first = firstReturnOfLaser[returns[r]->RawLaserId];
+    if (first == -1)
+    {
+      // No matching point from first set (skipped?)
+      continue;
+    }
+    switch (PairDualReturns(returns[first]->Distance, returns[first]->Intensity,
+      returns[r]->Distance, returns[r]->Intensity, this->DualReturnFilter, flags[first], flags[r]))
+    {
+      case KEEP_FIRST_RETURN:
+        returns[r] = nullptr;
+        break;
+      case KEEP_DUAL_RETURN:
+        // the dual return takes the place of the first one
+        returns[first] = returns[r];
+        flags[first] = flags[r];
+        returns[r] = nullptr;
+        break;
+      default:
+        dualReturn[first] = r;
+        dualReturn[r] = first;
+    }
+  }
 
-      // We will output only one point so return out of this
-      if (this->DualReturnFilter)
-      {
-        if (!(secondFlags & this->DualReturnFilter))
-        {
-          // second return does not match filter; skip
-          this->Flags->SetValue(dualPointId, firstFlags);
-          this->DistanceFlag->SetValue(dualPointId, MapDistanceFlag(firstFlags));
-          this->IntensityFlag->SetValue(dualPointId, MapIntensityFlag(firstFlags));
-          return;
-        }
-        if (!(firstFlags & this->DualReturnFilter))
-        {
-          // first return does not match filter; replace with second return
-          this->Points->SetPoint(dualPointId, pos);
-          this->Distance->SetValue(dualPointId, distanceM);
-          this->DistanceRaw->SetValue(dualPointId, laserReturn->distance);
-          this->Intensity->SetValue(dualPointId, intensity);
-          this->Timestamp->SetValue(dualPointId, timestamp);
-          this->RawTime->SetValue(dualPointId, rawtime);
-          this->Flags->SetValue(dualPointId, secondFlags);
-          this->DistanceFlag->SetValue(dualPointId, MapDistanceFlag(secondFlags));
-          this->IntensityFlag->SetValue(dualPointId, MapIntensityFlag(secondFlags));
-          return;
-        }
-      }
+  // Add the returns to the frame in order, with their final flags
+  VelodyneFrameBuffers& frame = *this->CurrentFrameBuffers;
+  this->FirstPointIdOfDualReturnPair = frame.GetNumberOfPoints();
+  vtkIdType pointIds[maximumNumberOfReturns];
+  vtkIdType nextPointId = frame.GetNumberOfPoints();
+  for (int r = 0; r < numberOfReturns; ++r)
+  {
+    pointIds[r] = returns[r] ? nextPointId++ : -1;
+  }
+  for (int r = 0; r < numberOfReturns; ++r)
+  {
+    if (returns[r])
+    {
+      this->AppendReturn(*returns[r], flags[r], dualReturn[r] == -1 ? -1 : pointIds[dualReturn[r]]);
+    }
+  }
+}
 
-      this->Flags->SetValue(dualPointId, firstFlags);
-      this->DistanceFlag->SetValue(dualPointId, MapDistanceFlag(firstFlags));
-      this->IntensityFlag->SetValue(dualPointId, MapIntensityFlag(firstFlags));
-      this->Flags->InsertNextValue(secondFlags);
-      this->DistanceFlag->InsertNextValue(MapDistanceFlag(secondFlags));
-      this->IntensityFlag->InsertNextValue(MapIntensityFlag(secondFlags));
+//-----------------------------------------------------------------------------
+void vtkVelodynePacketInterpreter::PushFiringData(
+  const DecodedReturn& laserReturn, bool isFiringDualReturnData)
+{
+  VelodyneFrameBuffers& frame = *this->CurrentFrameBuffers;
+  const vtkIdType dualPointId = this->LastPointId[laserReturn.RawLaserId];
+  if (!isFiringDualReturnData || dualPointId < this->FirstPointIdOfDualReturnPair)
+  {
+    // Single return, or no matching point from first set (skipped?)
+    this->AppendReturn(laserReturn, DUAL_DOUBLED, -1);
+    return;
+  }
+
+  // The first return is already part of the frame, its values are patched
+  unsigned int firstFlags = frame.Flags[dualPointId];
+  unsigned int secondFlags = DUAL_DOUBLED;
+  switch (PairDualReturns(frame.Distance.Get(dualPointId), frame.Intensity[dualPointId],
+    laserReturn.Distance, laserReturn.Intensity, this->DualReturnFilter, firstFlags, secondFlags))
+  {
+    case KEEP_FIRST_RETURN:
+      SetDualFlags(frame, dualPointId, firstFlags);
+      return;
+    case KEEP_DUAL_RETURN:
+      // replace the first return with the dual return
+      frame.SetPoint(dualPointId, laserReturn.Position);
+      frame.SetOptional(ARRAY_X, frame.PointsX, dualPointId, laserReturn.Position[0]);
+      frame.SetOptional(ARRAY_Y, frame.PointsY, dualPointId, laserReturn.Position[1]);
+      frame.SetOptional(ARRAY_Z, frame.PointsZ, dualPointId, laserReturn.Position[2]);
+      frame.Azimuth[dualPointId] = laserReturn.Azimuth;
+      frame.Distance.Set(dualPointId, laserReturn.Distance);
+      frame.SetOptional(ARRAY_DISTANCE_RAW, frame.DistanceRaw, dualPointId, laserReturn.RawDistance);
+      frame.Intensity[dualPointId] = laserReturn.Intensity;
+      frame.Timestamp[dualPointId] = laserReturn.Timestamp;
+      frame.SetOptional(ARRAY_RAW_TIME, frame.RawTime, dualPointId, laserReturn.RawTime);
+      SetDualFlags(frame, dualPointId, secondFlags);
+      return;
+    default:
       // The first return indicates the dual return
       // and the dual return indicates the first return
-      this->DualReturnMatching->InsertNextValue(dualPointId);
-      this->DualReturnMatching->SetValue(dualPointId, thisPointId);
-    }
+      SetDualFlags(frame, dualPointId, firstFlags);
+      frame.SetOptional(ARRAY_DUAL_RETURN_MATCHING, frame.DualReturnMatching, dualPointId,
+        frame.GetNumberOfPoints());
+      this->AppendReturn(laserReturn, secondFlags, dualPointId);
   }
-  else
-  {
-    this->Flags->InsertNextValue(DUAL_DOUBLED);
-    this->DistanceFlag->InsertNextValue(0);
-    this->IntensityFlag->InsertNextValue(0);
-    this->DualReturnMatching->InsertNextValue(-1); // std::numeric_limits<vtkIdType>::quiet_NaN()
-  }
-
-  this->Points->InsertNextPoint(pos);
-  this->PointsX->InsertNextValue(pos[0]);
-  this->PointsY->InsertNextValue(pos[1]);
-  this->PointsZ->InsertNextValue(pos[2]);
-  this->Azimuth->InsertNextValue(azimuth);
-  this->Intensity->InsertNextValue(intensity);
-  this->LaserId->InsertNextValue(laserId);
-  this->Timestamp->InsertNextValue(timestamp);
-  this->RawTime->InsertNextValue(rawtime);
-  this->Distance->InsertNextValue(distanceM);
-  this->DistanceRaw->InsertNextValue(laserReturn->distance);
-  this->LastPointId[rawLaserId] = thisPointId;
-  this->VerticalAngle->InsertNextValue(this->laser_corrections_[laserId].verticalCorrection);
+}
+
+//-----------------------------------------------------------------------------
+void vtkVelodynePacketInterpreter::AppendReturn(
+  const DecodedReturn& laserReturn, unsigned int dualFlags, vtkIdType dualPointId)
+{
+  VelodyneFrameBuffers& frame = *this->CurrentFrameBuffers;
+  this->LastPointId[laserReturn.RawLaserId] = frame.GetNumberOfPoints();
+  const double* pos = laserReturn.Position;
+  frame.Points.PushBack(static_cast<float>(pos[0]));
+  frame.Points.PushBack(static_cast<float>(pos[1]));
+  frame.Points.PushBack(static_cast<float>(pos[2]));
+  frame.PushBackOptional(ARRAY_X, frame.PointsX, pos[0]);
+  frame.PushBackOptional(ARRAY_Y, frame.PointsY, pos[1]);
+  frame.PushBackOptional(ARRAY_Z, frame.PointsZ, pos[2]);
+  frame.Azimuth.PushBack(laserReturn.Azimuth);
+  frame.Intensity.PushBack(laserReturn.Intensity);
+  frame.LaserId.PushBack(laserReturn.LaserId);
+  frame.Timestamp.PushBack(laserReturn.Timestamp);
+  frame.PushBackOptional(ARRAY_RAW_TIME, frame.RawTime, laserReturn.RawTime);
+  frame.Distance.PushBack(laserReturn.Distance);
+  frame.PushBackOptional(ARRAY_DISTANCE_RAW, frame.DistanceRaw, laserReturn.RawDistance);
+  frame.PushBackOptional(ARRAY_VERTICAL_ANGLE, frame.VerticalAngle,
+    this->laser_corrections_[laserReturn.LaserId].verticalCorrection);
+  PushBackDualFlags(frame, dualFlags, dualPointId);
 }
 
 //-----------------------------------------------------------------------------
 void vtkVelodynePacketInterpreter::InitTrigonometricTables()
 {
-  if (cos_lookup_table_.size() == 0 || sin_lookup_table_.size() == 0)
+  // the tables only depend on the angle resolution, they are shared by all the interpreters
+  struct TrigonometricTables
   {
-    cos_lookup_table_.resize(HDL_NUM_ROT_ANGLES);
-    sin_lookup_table_.resize(HDL_NUM_ROT_ANGLES);
-    for (unsigned int i = 0; i < HDL_NUM_ROT_ANGLES; i++)
+    TrigonometricTables()
+      : Cos(HDL_NUM_ROT_ANGLES)
+      , Sin(HDL_NUM_ROT_ANGLES)
     {
-      double rad = HDL_Grabber_toRadians(i / 100.0);
-      cos_lookup_table_[i] = std::cos(rad);
-      sin_lookup_table_[i] = std::sin(rad);
+      for (unsigned int i = 0; i < HDL_NUM_ROT_ANGLES; i++)
+      {
+        double rad = HDL_Grabber_toRadians(i / 100.0);
+        this->Cos[i] = std::cos(rad);
+        this->Sin[i] = std::sin(rad);
+      }
     }
-  }
+    std::vector<double> Cos;
+    std::vector<double> Sin;
+  };
+  static const TrigonometricTables tables;
+  this->cos_lookup_table_ = tables.Cos.data();
+  this->sin_lookup_table_ = tables.Sin.data();
 }
 
 //-----------------------------------------------------------------------------
@@ -1135,98 +1224,84 @@ void vtkVelodynePacketInterpreter::PrecomputeCorrectionCosSin()
     correction.cosVertOffsetCorrection =
       correction.verticalOffsetCorrection * correction.cosVertCorrection;
   }
-}
+  this->FiringCorrections->Set(this->laser_corrections_);
 
-//-----------------------------------------------------------------------------
-void vtkVelodynePacketInterpreter::Init()
-{
-  this->InitTrigonometricTables();
-  this->ResetCurrentFrame();
-}
+  // The position is distance * u + verticalOffset * v + horizontalOffset * w, with u, v
+  // and w unit vectors, and the distance includes the distance correction
+  this->MaximumPositionOffset = 0.;
+  for (int i = 0; i < HDL_MAX_NUM_LASERS; i++)
+  {
+    const HDLLaserCorrection& correction = this->laser_corrections_[i];
+    this->MaximumPositionOffset = std::max(this->MaximumPositionOffset,
+      std::abs(correction.distanceCorrection) + std::abs(correction.verticalOffsetCorrection) +
+        std::abs(correction.horizontalOffsetCorrection));
+  }
+  this->DecodingMasksTime = 0;
 
-//-----------------------------------------------------------------------------
-double vtkVelodynePacketInterpreter::ComputeTimestamp(unsigned int tohTime, const FrameInformation& frameInfo)
-{
-  VelodyneSpecificFrameInformation* velInfo = reinterpret_cast<VelodyneSpecificFrameInformation*>(frameInfo.SpecificInformation.get());
-  static const double hourInMilliseconds = 3600.0 * 1e6;
-  return tohTime + velInfo->NbrOfRollingTime * hourInMilliseconds;
+  const int numberOfLasers =
+    std::max(0, std::min(this->CalibrationReportedNumLasers, static_cast<int>(HDL_MAX_NUM_LASERS)));
+  std::vector<int> lasersByVerticalAngle(numberOfLasers);
+  std::iota(lasersByVerticalAngle.begin(), lasersByVerticalAngle.end(), 0);
+  std::stable_sort(lasersByVerticalAngle.begin(), lasersByVerticalAngle.end(),
+    [this](int a, int b) {
+      return this->laser_corrections_[a].verticalCorrection <
+        this->laser_corrections_[b].verticalCorrection;
+    });
+  std::iota(this->LaserVerticalRank, this->LaserVerticalRank + HDL_MAX_NUM_LASERS, 0);
+  for (int rank = 0; rank < numberOfLasers; ++rank)
+  {
+    this->LaserVerticalRank[lasersByVerticalAngle[rank]] = rank;
+  }
 }
 
 //-----------------------------------------------------------------------------
-void vtkVelodynePacketInterpreter::ComputeCorrectedValues(const unsigned short azimuth, const HDLLaserReturn *laserReturn, const HDLLaserCorrection *correction, double pos[], double &distanceM, short &intensity, bool correctIntensity)
+void vtkVelodynePacketInterpreter::UpdateDecodingMasks()
 {
-  intensity = laserReturn->intensity;
-
-  double cosAzimuth, sinAzimuth;
-  if (correction->rotationalCorrection == 0)
+  // the piece only updates the decoding MTime, see SetPiece
+  const vtkMTimeType time = std::max(this->GetMTime(), this->GetDecodingMTime());
+  if (time == this->DecodingMasksTime)
   {
-    cosAzimuth = this->cos_lookup_table_[azimuth];
-    sinAzimuth = this->sin_lookup_table_[azimuth];
+    return;
   }
-  else
+  this->DecodingMasksTime = time;
+
+  bool laserMask[HDL_MAX_NUM_LASERS];
+  this->ComputeLaserMask(this->LaserVerticalRank, HDL_MAX_NUM_LASERS, laserMask);
+  for (int laserId = 0; laserId < HDL_MAX_NUM_LASERS; ++laserId)
   {
-    // realAzimuth = azimuth/100 - rotationalCorrection
-    // cos(a-b) = cos(a)*cos(b) + sin(a)*sin(b)
-    // sin(a-b) = sin(a)*cos(b) - cos(a)*sin(b)
-    cosAzimuth = this->cos_lookup_table_[azimuth] * correction->cosRotationalCorrection +
-      this->sin_lookup_table_[azimuth] * correction->sinRotationalCorrection;
-    sinAzimuth = this->sin_lookup_table_[azimuth] * correction->cosRotationalCorrection -
-      this->cos_lookup_table_[azimuth] * correction->sinRotationalCorrection;
+    this->LaserMask[laserId] = laserMask[laserId];
   }
-  // Compute the distance in the xy plane (w/o accounting for rotation)
-  /**the new term of 'vert_offset * sin_vert_angle'
-   * was added to the expression due to the mathemathical
-   * model we used.
-   */
-  double distanceMRaw = laserReturn->distance * this->DistanceResolutionM;
-  distanceM = distanceMRaw + correction->distanceCorrection;
-  double xyDistance =
-    distanceM * correction->cosVertCorrection - correction->sinVertOffsetCorrection;
-
-  pos[0] = xyDistance * sinAzimuth - correction->horizontalOffsetCorrection * cosAzimuth;
-  pos[1] = xyDistance * cosAzimuth + correction->horizontalOffsetCorrection * sinAzimuth;
-  pos[2] = distanceM * correction->sinVertCorrection + correction->verticalOffsetCorrection;
+  this->ComputeRawDistanceRange(this->MaximumPositionOffset, this->RawDistanceRange);
 
-  if (correctIntensity && (correction->minIntensity < correction->maxIntensity))
+  // the matrix is read once here instead of going through the transform for each point
+  this->ApplySensorMatrix = false;
+  if (this->SensorTransform)
   {
-    // Compute corrected intensity
-
-    /* Please refer to the manual:
-      "Velodyne, Inc. ©2013  63‐HDL64ES3 REV G" Appendix F. Pages 45-46
-      PLease note: in the manual, focalDistance is in centimeters, distance is the raw short from
-      the laser
-      & the graph is in meter */
-
-    // Casting the input values to double for the computation
-
-    double computedIntensity = static_cast<double>(intensity);
-    double minIntensity = static_cast<double>(correction->minIntensity);
-    double maxIntensity = static_cast<double>(correction->maxIntensity);
-
-    // Rescale the intensity between 0 and 255
-    computedIntensity = (computedIntensity - minIntensity) / (maxIntensity - minIntensity) * 255.0;
-
-    if (computedIntensity < 0)
+    vtkMatrix4x4* matrix = this->SensorTransform->GetMatrix();
+    for (int i = 0; i < 3; ++i)
     {
-      computedIntensity = 0;
+      for (int j = 0; j < 4; ++j)
+      {
+        this->SensorMatrix[4 * i + j] = matrix->GetElement(i, j);
+        this->ApplySensorMatrix |= matrix->GetElement(i, j) != (i == j ? 1. : 0.);
+      }
     }
+  }
+}
 
-    double focalOffset = 256 * pow(1.0 - correction->focalDistance / 131.0, 2);
-    double insideAbsValue = std::abs(
-      focalOffset - 256 * pow(1.0 - static_cast<double>(laserReturn->distance) / 65535.0f, 2));
-
-    if (insideAbsValue > 0)
-    {
-      computedIntensity = computedIntensity + correction->focalSlope * insideAbsValue;
-    }
-    else
-    {
-      computedIntensity = computedIntensity + correction->closeSlope * insideAbsValue;
-    }
-    computedIntensity = std::max(std::min(computedIntensity, 255.0), 1.0);
+//-----------------------------------------------------------------------------
+void vtkVelodynePacketInterpreter::Init()
+{
+  this->InitTrigonometricTables();
+  this->ResetCurrentFrame();
+}
 
-    intensity = static_cast<short>(computedIntensity);
-  }
+//-----------------------------------------------------------------------------
+double vtkVelodynePacketInterpreter::ComputeTimestamp(unsigned int tohTime, const FrameInformation& frameInfo)
+{
+  VelodyneSpecificFrameInformation* velInfo = reinterpret_cast<VelodyneSpecificFrameInformation*>(frameInfo.SpecificInformation.get());
+  static const double hourInMilliseconds = 3600.0 * 1e6;
+  return tohTime + velInfo->NbrOfRollingTime * hourInMilliseconds;
 }
 
 //-----------------------------------------------------------------------------
@@ -1293,61 +1368,106 @@ vtkSmartPointer<vtkPolyData> vtkVelodynePacketInterpreter::CreateNewEmptyFrame(v
   // prereserve for 50% points more than actually received in previous frame
   prereservedNumberOfPoints = std::max(static_cast<int>(prereservedNumberOfPoints * 1.5), defaultPrereservedNumberOfPointsPerFrame);
 
-  vtkSmartPointer<vtkPolyData> polyData = vtkSmartPointer<vtkPolyData>::New();
+  // reuse a frame released by the consumers if possible, with its arrays and their memory
+  vtkSmartPointer<vtkPolyData> polyData = this->RecycledFrames.Acquire();
+  if (!polyData)
+  {
+    polyData = vtkSmartPointer<vtkPolyData>::New();
+  }
+  VelodyneFrameBuffers& frame = *this->CurrentFrameBuffers;
 
   // points
-  vtkNew<vtkPoints> points;
-  points->SetDataTypeToFloat();
-  points->Allocate(prereservedNumberOfPoints);
-  if (numberOfPoints > 0 )
-  {
-    points->SetNumberOfPoints(numberOfPoints);
-  }
-  points->GetData()->SetName("Points_m_XYZ");
-  polyData->SetPoints(points.GetPointer());
-//  polyData->SetVerts(NewVertexCells(numberOfPoints));
-
-  // intensity
-  this->Points = points.GetPointer();
-  this->PointsX = CreateDataArray<vtkDoubleArray>("X", numberOfPoints, prereservedNumberOfPoints, polyData);
-  this->PointsY = CreateDataArray<vtkDoubleArray>("Y", numberOfPoints, prereservedNumberOfPoints, polyData);
-  this->PointsZ = CreateDataArray<vtkDoubleArray>("Z", numberOfPoints, prereservedNumberOfPoints, polyData);
-  this->Intensity = CreateDataArray<vtkUnsignedCharArray>("intensity", numberOfPoints, prereservedNumberOfPoints, polyData);
-  this->LaserId = CreateDataArray<vtkUnsignedCharArray>("laser_id", numberOfPoints, prereservedNumberOfPoints, polyData);
-  this->Azimuth = CreateDataArray<vtkUnsignedShortArray>("azimuth", numberOfPoints, prereservedNumberOfPoints, polyData);
-  this->Distance = CreateDataArray<vtkDoubleArray>("distance_m", numberOfPoints, prereservedNumberOfPoints, polyData);
-  this->DistanceRaw =
-    CreateDataArray<vtkUnsignedShortArray>("distance_raw", numberOfPoints, prereservedNumberOfPoints, polyData);
-  this->Timestamp = CreateDataArray<vtkDoubleArray>("adjustedtime", numberOfPoints, prereservedNumberOfPoints, polyData);
-  this->RawTime = CreateDataArray<vtkUnsignedIntArray>("timestamp", numberOfPoints, prereservedNumberOfPoints, polyData);
-  this->DistanceFlag = CreateDataArray<vtkIntArray>("dual_distance", numberOfPoints, prereservedNumberOfPoints, nullptr);
-  this->IntensityFlag = CreateDataArray<vtkIntArray>("dual_intensity", numberOfPoints, prereservedNumberOfPoints, nullptr);
-  this->Flags = CreateDataArray<vtkUnsignedIntArray>("dual_flags", numberOfPoints, prereservedNumberOfPoints, nullptr);
-  this->DualReturnMatching =
-    CreateDataArray<vtkIdTypeArray>("dual_return_matching", numberOfPoints, prereservedNumberOfPoints, nullptr);
-  this->VerticalAngle = CreateDataArray<vtkDoubleArray>("vertical_angle", numberOfPoints, prereservedNumberOfPoints, polyData);
+  vtkSmartPointer<vtkPoints> points = polyData->GetPoints();
+  vtkFloatArray* pointsData = points ? vtkFloatArray::SafeDownCast(points->GetData()) : nullptr;
+  if (pointsData)
+  {
+    frame.Points.Reclaim(pointsData);
+  }
+  else
+  {
+    points = vtkSmartPointer<vtkPoints>::New();
+    points->SetDataTypeToFloat();
+    points->GetData()->SetName("Points_m_XYZ");
+    polyData->SetPoints(points);
+  }
+  this->Points = points;
+
+  // point data, the optional arrays which are not selected are not part of the frame
+  frame.Arrays = this->OptionalArrays;
+  frame.SetSinglePrecisionCoordinates(this->SinglePrecisionCoordinates);
+  this->PointsX = GetFrameCoordinateArray("X", polyData, frame.Has(ARRAY_X), frame.PointsX);
+  this->PointsY = GetFrameCoordinateArray("Y", polyData, frame.Has(ARRAY_Y), frame.PointsY);
+  this->PointsZ = GetFrameCoordinateArray("Z", polyData, frame.Has(ARRAY_Z), frame.PointsZ);
+  this->Intensity = GetFrameDataArray<vtkUnsignedCharArray>("intensity", polyData, true, frame.Intensity);
+  this->LaserId = GetFrameDataArray<vtkUnsignedCharArray>("laser_id", polyData, true, frame.LaserId);
+  this->Azimuth = GetFrameDataArray<vtkUnsignedShortArray>("azimuth", polyData, true, frame.Azimuth);
+  this->Distance = GetFrameCoordinateArray("distance_m", polyData, true, frame.Distance);
+  this->DistanceRaw = GetFrameDataArray<vtkUnsignedShortArray>(
+    "distance_raw", polyData, frame.Has(ARRAY_DISTANCE_RAW), frame.DistanceRaw);
+  this->Timestamp = GetFrameDataArray<vtkDoubleArray>("adjustedtime", polyData, true, frame.Timestamp);
+  this->RawTime = GetFrameDataArray<vtkUnsignedIntArray>(
+    "timestamp", polyData, frame.Has(ARRAY_RAW_TIME), frame.RawTime);
+  this->DistanceFlag = GetFrameDataArray<vtkIntArray>("dual_distance", polyData,
+    this->HasDualReturn && frame.Has(ARRAY_DUAL_DISTANCE), frame.DistanceFlag);
+  this->IntensityFlag = GetFrameDataArray<vtkIntArray>("dual_intensity", polyData,
+    this->HasDualReturn && frame.Has(ARRAY_DUAL_INTENSITY), frame.IntensityFlag);
+  this->Flags = GetFrameDataArray<vtkUnsignedIntArray>("dual_flags", polyData, false, frame.Flags);
+  this->DualReturnMatching = GetFrameDataArray<vtkIdTypeArray>("dual_return_matching", polyData,
+    this->HasDualReturn && frame.Has(ARRAY_DUAL_RETURN_MATCHING), frame.DualReturnMatching);
+  this->VerticalAngle = GetFrameCoordinateArray(
+    "vertical_angle", polyData, frame.Has(ARRAY_VERTICAL_ANGLE), frame.VerticalAngle);
+
+  // The values are accumulated in contiguous buffers, which are given to the
+  // data arrays without copy when the frame is split (see MoveFrameBuffersToArrays),
+  // so the data arrays themselves do not need to be allocated
+  frame.Reset(std::max(numberOfPoints, prereservedNumberOfPoints));
+  frame.Resize(numberOfPoints);
 
   // FieldData : RPM
-  vtkSmartPointer<vtkDoubleArray> rpmData = vtkSmartPointer<vtkDoubleArray>::New();
-  rpmData->SetNumberOfTuples(1);     // One tuple
-  rpmData->SetNumberOfComponents(1); // One value per tuple, the scalar
-  rpmData->SetName("RotationPerMinute");
-  rpmData->SetTuple1(0, this->Frequency);
-  polyData->GetFieldData()->AddArray(rpmData);
-
-  if (this->HasDualReturn)
+  vtkDataArray* rpmData = polyData->GetFieldData()->GetArray("RotationPerMinute");
+  if (!rpmData)
   {
-    polyData->GetPointData()->AddArray(this->DistanceFlag.GetPointer());
-    polyData->GetPointData()->AddArray(this->IntensityFlag.GetPointer());
-    polyData->GetPointData()->AddArray(this->DualReturnMatching.GetPointer());
+    vtkSmartPointer<vtkDoubleArray> newRpmData = vtkSmartPointer<vtkDoubleArray>::New();
+    newRpmData->SetNumberOfTuples(1);     // One tuple
+    newRpmData->SetNumberOfComponents(1); // One value per tuple, the scalar
+    newRpmData->SetName("RotationPerMinute");
+    polyData->GetFieldData()->AddArray(newRpmData);
+    rpmData = newRpmData;
   }
+  rpmData->SetTuple1(0, this->Frequency);
 
   return polyData;
 }
 
+//-----------------------------------------------------------------------------
+void vtkVelodynePacketInterpreter::MoveFrameBuffersToArrays()
+{
+  VelodyneFrameBuffers& frame = *this->CurrentFrameBuffers;
+  frame.Points.MoveTo(vtkFloatArray::SafeDownCast(this->Points->GetData()));
+  this->Points->Modified();
+  vtkPolyData* pd = this->CurrentFrame;
+  MoveToFrameDataArray(frame.PointsX, this->PointsX.GetPointer(), pd);
+  MoveToFrameDataArray(frame.PointsY, this->PointsY.GetPointer(), pd);
+  MoveToFrameDataArray(frame.PointsZ, this->PointsZ.GetPointer(), pd);
+  MoveToFrameDataArray(frame.Intensity, this->Intensity.GetPointer(), pd);
+  MoveToFrameDataArray(frame.LaserId, this->LaserId.GetPointer(), pd);
+  MoveToFrameDataArray(frame.Azimuth, this->Azimuth.GetPointer(), pd);
+  MoveToFrameDataArray(frame.Distance, this->Distance.GetPointer(), pd);
+  MoveToFrameDataArray(frame.DistanceRaw, this->DistanceRaw.GetPointer(), pd);
+  MoveToFrameDataArray(frame.Timestamp, this->Timestamp.GetPointer(), pd);
+  MoveToFrameDataArray(frame.VerticalAngle, this->VerticalAngle.GetPointer(), pd);
+  MoveToFrameDataArray(frame.RawTime, this->RawTime.GetPointer(), pd);
+  // the dual return arrays are part of the frame only if the data has dual returns
+  MoveToFrameDataArray(frame.IntensityFlag, this->IntensityFlag.GetPointer(), pd);
+  MoveToFrameDataArray(frame.DistanceFlag, this->DistanceFlag.GetPointer(), pd);
+  MoveToFrameDataArray(frame.Flags, this->Flags.GetPointer(), pd);
+  MoveToFrameDataArray(frame.DualReturnMatching, this->DualReturnMatching.GetPointer(), pd);
+}
+
 //-----------------------------------------------------------------------------
 bool vtkVelodynePacketInterpreter::SplitFrame(bool force)
 {
+  this->MoveFrameBuffersToArrays();
   if (this->vtkLidarPacketInterpreter::SplitFrame(force))
   {
     for (size_t n = 0; n < HDL_MAX_NUM_LASERS; ++n)
@@ -1372,10 +1492,13 @@ void vtkVelodynePacketInterpreter::ResetCurrentFrame()
 {
   std::fill(this->LastPointId, this->LastPointId + HDL_MAX_NUM_LASERS, -1);
   this->CurrentFrameState->reset();
+  this->CurrentSector = -1;
+  this->RotationIndex = 0;
   this->LastTimestamp = std::numeric_limits<unsigned int>::max();
   this->TimeAdjust = std::numeric_limits<double>::quiet_NaN();
 
   this->rollingCalibrationData->clear();
+  this->PacketsWaitingForCalibration.clear();
   this->HasDualReturn = false;
   this->IsHDL64Data = false;
   this->IsVLS128 = false;
@@ -1391,12 +1514,11 @@ bool vtkVelodynePacketInterpreter::PreProcessPacket(unsigned char const * data,
                                                     std::vector<FrameInformation>* frameCatalog)
 {
   const HDLDataPacket* dataPacket = reinterpret_cast<const HDLDataPacket*>(data);
-  //! @todo don't use static value here this is ugly...
-  static bool isEmptyFrame = true;
-  static FramingState currentFrameState;
-  static int numberOfFiringPackets = 0;
-  static int lastnumberOfFiringPackets = 0;
-  static int frameNumber;
+  bool& isEmptyFrame = this->PreProcessIsEmptyFrame;
+  FramingState& currentFrameState = *this->PreProcessFrameState;
+  int& numberOfFiringPackets = this->PreProcessNumberOfFiringPackets;
+  int& lastnumberOfFiringPackets = this->PreProcessLastNumberOfFiringPackets;
+  int& frameNumber = this->PreProcessFrameNumber;
 
   numberOfFiringPackets++;
   bool isNewFrame = false;
@@ -1408,11 +1530,9 @@ bool vtkVelodynePacketInterpreter::PreProcessPacket(unsigned char const * data,
     this->ShouldCheckSensor = false;
   }
 
-  //    unsigned int timeDiff = dataPacket->gpsTimestamp - lastTimestamp;
-  //    if (timeDiff > 600 && lastTimestamp != 0)
-  //      {
-  //      printf("missed %d packets\n",  static_cast<int>(floor((timeDiff/553.0) + 0.5)));
-  //      }
+  // the timestamp is in microseconds since the top of the hour
+  this->PacketGaps.AddPacket(1e-6 * dataPacket->gpsTimestamp,
+                             0.01 * dataPacket->firingData[0].rotationalPosition, packetNetworkTime);
 
   // Check if the time has rolled between this packet and
   // the previous one. There is only one timestamp per packet
@@ -1462,7 +1582,7 @@ bool vtkVelodynePacketInterpreter::PreProcessPacket(unsigned char const * data,
       isEmptyFrame = false;
     }
 
-    if (currentFrameState.hasChangedWithValue(firingData))
+    if (currentFrameState.hasChangedWithValue(firingData.rotationalPosition))
     {
       // Add file position if the frame is not empty
       if (!isEmptyFrame || !this->IgnoreEmptyFrames)
@@ -1494,12 +1614,94 @@ bool vtkVelodynePacketInterpreter::PreProcessPacket(unsigned char const * data,
   if (IsHDL64Data && this->IsCorrectionFromLiveStream &&
     !this->IsCalibrated)
   {
-    this->rollingCalibrationData->appendData(dataPacket->gpsTimestamp, dataPacket->factoryField1, dataPacket->factoryField2);
-    this->HDL64LoadCorrectionsFromStreamData();
+    if (this->rollingCalibrationData->appendData(
+          dataPacket->gpsTimestamp, dataPacket->factoryField1, dataPacket->factoryField2))
+    {
+      this->HDL64LoadCorrectionsFromStreamData();
+    }
   }
   return isNewFrame;
 }
 
+//-----------------------------------------------------------------------------
+vtkLidarPacketInterpreter* vtkVelodynePacketInterpreter::NewPreProcessingInstance()
+{
+  // Live calibration is accumulated while preprocessing the packets,
+  // which can not be split between several instances
+  if (this->IsCorrectionFromLiveStream && !this->IsCalibrated)
+  {
+    return nullptr;
+  }
+  vtkVelodynePacketInterpreter* instance = vtkVelodynePacketInterpreter::New();
+  instance->IgnoreZeroDistances = this->IgnoreZeroDistances;
+  instance->IgnoreEmptyFrames = this->IgnoreEmptyFrames;
+  instance->IsCalibrated = this->IsCalibrated;
+  instance->IsCorrectionFromLiveStream = this->IsCorrectionFromLiveStream;
+  instance->CalibrationReportedNumLasers = this->CalibrationReportedNumLasers;
+  // the consistency with the calibration is already checked by this instance
+  instance->ShouldCheckSensor = false;
+  instance->ResetParserMetaData();
+  return instance;
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarPacketInterpreter* vtkVelodynePacketInterpreter::NewDecodingInstance()
+{
+  if (!this->IsCalibrated)
+  {
+    return nullptr;
+  }
+  vtkVelodynePacketInterpreter* instance = vtkVelodynePacketInterpreter::New();
+  this->CopyDecodingSettings(instance);
+
+  // calibration, copied once so that each instance can read it without lock
+  std::copy(this->laser_corrections_, this->laser_corrections_ + HDL_MAX_NUM_LASERS,
+    instance->laser_corrections_);
+  std::copy(this->LaserVerticalRank, this->LaserVerticalRank + HDL_MAX_NUM_LASERS,
+    instance->LaserVerticalRank);
+  std::copy(&this->XMLColorTable[0][0], &this->XMLColorTable[0][0] + HDL_MAX_NUM_LASERS * 3,
+    &instance->XMLColorTable[0][0]);
+  *instance->FiringCorrections = *this->FiringCorrections;
+  instance->IsCorrectionFromLiveStream = this->IsCorrectionFromLiveStream;
+  instance->SensorPowerMode = this->SensorPowerMode;
+  instance->ReportedSensor = this->ReportedSensor;
+  instance->ReportedSensorReturnMode = this->ReportedSensorReturnMode;
+
+  // user settings
+  instance->WantIntensityCorrection = this->WantIntensityCorrection;
+  instance->FiringsSkip = this->FiringsSkip;
+  instance->UseIntraFiringAdjustment = this->UseIntraFiringAdjustment;
+  instance->DualReturnFilter = this->DualReturnFilter;
+  instance->OptionalArrays = this->OptionalArrays;
+  instance->SinglePrecisionCoordinates = this->SinglePrecisionCoordinates;
+
+  // the consistency with the calibration is already checked by this instance
+  instance->ShouldCheckSensor = false;
+  return instance;
+}
+
+//-----------------------------------------------------------------------------
+void vtkVelodynePacketInterpreter::RebaseFrameInformation(FrameInformation& info,
+  const FrameInformation& reference, const FrameInformation& local)
+{
+  auto infoVel = reinterpret_cast<VelodyneSpecificFrameInformation*>(info.SpecificInformation.get());
+  auto referenceVel = reinterpret_cast<VelodyneSpecificFrameInformation*>(reference.SpecificInformation.get());
+  auto localVel = reinterpret_cast<VelodyneSpecificFrameInformation*>(local.SpecificInformation.get());
+  infoVel->NbrOfRollingTime += referenceVel->NbrOfRollingTime - localVel->NbrOfRollingTime;
+}
+
+//-----------------------------------------------------------------------------
+void vtkVelodynePacketInterpreter::ResetParserMetaData()
+{
+  this->vtkLidarPacketInterpreter::ResetParserMetaData();
+  this->PreProcessFrameState->reset();
+  this->PreProcessIsEmptyFrame = true;
+  this->PreProcessNumberOfFiringPackets = 0;
+  this->PreProcessLastNumberOfFiringPackets = 0;
+  this->PreProcessFrameNumber = 0;
+  this->lastGpsTimestamp = 0;
+}
+
 //-----------------------------------------------------------------------------
 bool vtkVelodynePacketInterpreter::CheckReportedSensorAndCalibrationFileConsistent(const HDLDataPacket* dataPacket)
 {
@@ -6,12 +6,22 @@
 #include <vtkUnsignedCharArray.h>
 #include <vtkUnsignedIntArray.h>
 #include <vtkUnsignedShortArray.h>
+#include <bitset>
+#include <deque>
 #include <memory>
 
 using namespace DataPacketFixedLength;
 
-class RPMCalculator;
+struct RPMCalculator;
+class AzimuthStepEstimator;
+class AzimuthAdjustmentCache;
 class FramingState;
+struct VelodyneFrameBuffers;
+struct LaserCorrectionArrays;
+struct FiringTimingTable;
+struct DecodedReturn;
+struct DecodedFiring;
+enum class FiringTimingModel;
 class vtkRollingDataAccumulator;
 
 
@@ -32,14 +42,44 @@ public:
     DUAL_INTENSITY_MASK = 0xc,
   };
 
+  //! Point data arrays which are only filled when they are enabled, they can be
+  //! derived from the other arrays or are only needed by a few filters
+  enum OptionalArray
+  {
+    ARRAY_X = 0x1,
+    ARRAY_Y = 0x2,
+    ARRAY_Z = 0x4,
+    ARRAY_DISTANCE_RAW = 0x8,
+    ARRAY_RAW_TIME = 0x10,
+    ARRAY_VERTICAL_ANGLE = 0x20,
+    ARRAY_DUAL_DISTANCE = 0x40,
+    ARRAY_DUAL_INTENSITY = 0x80,
+    ARRAY_DUAL_RETURN_MATCHING = 0x100,
+    ALL_OPTIONAL_ARRAYS = 0x1ff,
+  };
+
   void LoadCalibration(const std::string& filename) override;
 
+  /**
+   * @brief SaveCompiledCalibration writes the loaded calibration in a binary form
+   * that LoadCalibration reads back without parsing any xml.
+   * @return false if no calibration is loaded or the file can not be written
+   */
+  bool SaveCompiledCalibration(const std::string& filename);
+
   void ProcessPacket(unsigned char const * data, unsigned int dataLength) override;
 
+  size_t ProcessPackets(const RawPacket* packets, size_t numberOfPackets) override;
+
   bool SplitFrame(bool force = false) override;
 
   bool IsLidarPacket(unsigned char const * data, unsigned int dataLength) override;
 
+  std::vector<unsigned int> GetLidarPacketSizes() const override
+  {
+    return { HDLDataPacket::getDataByteLength() };
+  }
+
   vtkSmartPointer<vtkPolyData> CreateNewEmptyFrame(vtkIdType numberOfPoints, vtkIdType prereservedNumberOfPoints = 60000) override;
 
   void ResetCurrentFrame() override;
@@ -48,6 +88,15 @@ public:
                         fpos_t filePosition = fpos_t(), double packetNetworkTime = 0,
                         std::vector<FrameInformation>* frameCatalog = nullptr) override;
 
+  vtkLidarPacketInterpreter* NewPreProcessingInstance() override;
+
+  vtkLidarPacketInterpreter* NewDecodingInstance() override;
+
+  void RebaseFrameInformation(FrameInformation& info, const FrameInformation& reference,
+                              const FrameInformation& local) override;
+
+  void ResetParserMetaData() override;
+
   std::string GetSensorInformation() override;
 
   void GetXMLColorTable(double XMLColorTable[]);
@@ -72,6 +121,28 @@ public:
 
   vtkSetMacro(DualReturnFilter, unsigned int)
 
+  //@{
+  /**
+   * Selection of the optional arrays of the frames, see OptionalArray. The arrays
+   * which are not selected are not filled at all, which saves the memory and the
+   * time needed to build them. They are all selected by default.
+   */
+  vtkGetMacro(OptionalArrays, unsigned int)
+  vtkSetMacro(OptionalArrays, unsigned int)
+  int GetNumberOfOptionalArrays();
+  const char* GetOptionalArrayName(int index);
+  int GetOptionalArrayStatus(const char* name);
+  void SetOptionalArrayStatus(const char* name, int status);
+  //@}
+
+  /**
+   * Build the X, Y, Z, distance_m and vertical_angle arrays in single precision,
+   * which is enough for the centimetric accuracy of the sensors and halves their
+   * memory. The points are always in single precision and the timestamps in double.
+   */
+  vtkGetMacro(SinglePrecisionCoordinates, bool)
+  vtkSetMacro(SinglePrecisionCoordinates, bool)
+
 protected:
   // Process the laser return from the firing data
   // firingData - one of HDL_FIRING_PER_PKT from the packet
@@ -79,43 +150,69 @@ protected:
   // firingBlock - block of packet for firing [0-11]
   // azimuthDiff - average azimuth change between firings
   // timestamp - the timestamp of the packet
-  // geotransform - georeferencing transform
+  // timing - intra-firing adjustments of the sensor, see GetFiringTimingModel
   void ProcessFiring(const HDLFiringData* firingData,
     int firingBlockLaserOffset, int firingBlock, int azimuthDiff, double timestamp,
-    unsigned int rawtime, bool isThisFiringDualReturnData, bool isDualReturnPacket);
+    unsigned int rawtime, bool isThisFiringDualReturnData, const FiringTimingTable& timing);
+
+  // Timing of the firings of the sensor, given by the calibration and the reported sensor
+  FiringTimingModel GetFiringTimingModel() const;
+
+  // Process a packet, the sensor transform must be up to date
+  void ProcessDataPacket(unsigned char const * data, unsigned int dataLength);
+
+  // Give the values accumulated for the current frame to its data arrays
+  void MoveFrameBuffersToArrays();
+
+  // Decode the returns of a firing: the returns which are kept by the laser selection,
+  // the distance gate and the crop are positioned with the sensor transform
+  void DecodeFiring(const HDLFiringData* firingData, int firingBlockLaserOffset,
+    int firingBlock, int azimuthDiff, double timestamp, unsigned int rawtime,
+    const FiringTimingTable& timing, DecodedFiring& firing);
 
-  void PushFiringData(unsigned char laserId, unsigned char rawLaserId,
-                      unsigned short azimuth, double timestamp,
-                      unsigned int rawtime, const HDLLaserReturn* laserReturn,
-                      const HDLLaserCorrection* correction, bool isFiringDualReturnData);
+  // Number of firing blocks of a dual return packet, starting at firingBlock, which hold
+  // the first returns then the dual returns of the same lasers, 0 if they can not be paired
+  int GetDualFiringGroupSize(const HDLDataPacket* dataPacket, int firingBlock) const;
+
+  // Process a group of firing blocks given by GetDualFiringGroupSize. Each dual return is
+  // paired with its first return before any of them is added to the frame, so that they
+  // are written once with their final flags, in the same order as ProcessFiring.
+  void ProcessDualFirings(const HDLDataPacket* dataPacket, int firingBlock, int numberOfBlocks,
+    int azimuthDiff, double timestamp, unsigned int rawtime, const FiringTimingTable& timing);
+
+  // Add a return to the frame, patching the first return of the laser if it is a dual return
+  void PushFiringData(const DecodedReturn& laserReturn, bool isFiringDualReturnData);
+
+  // Append a return to the frame with its dual flags and the id of its matching point
+  void AppendReturn(const DecodedReturn& laserReturn, unsigned int dualFlags, vtkIdType dualPointId);
 
   void InitTrigonometricTables();
 
+  // Update the laser mask, the raw distance interval and the sensor matrix if the
+  // interpreter or its sensor transform was modified
+  void UpdateDecodingMasks();
+
   void PrecomputeCorrectionCosSin();
 
   void Init();
 
   double ComputeTimestamp(unsigned int tohTime, const FrameInformation& frameInfo);
 
-  void ComputeCorrectedValues(const unsigned short azimuth,
-                              const HDLLaserReturn* laserReturn, const HDLLaserCorrection* correction, double pos[3],
-                              double& distanceM, short& intensity, bool correctIntensity);
-
   bool HDL64LoadCorrectionsFromStreamData();
 
   bool CheckReportedSensorAndCalibrationFileConsistent(const HDLDataPacket* dataPacket);
 
   vtkSmartPointer<vtkPoints> Points;
-  vtkSmartPointer<vtkDoubleArray> PointsX;
-  vtkSmartPointer<vtkDoubleArray> PointsY;
-  vtkSmartPointer<vtkDoubleArray> PointsZ;
+  vtkSmartPointer<vtkDataArray> PointsX;
+  vtkSmartPointer<vtkDataArray> PointsY;
+  vtkSmartPointer<vtkDataArray> PointsZ;
   vtkSmartPointer<vtkUnsignedCharArray> Intensity;
   vtkSmartPointer<vtkUnsignedCharArray> LaserId;
   vtkSmartPointer<vtkUnsignedShortArray> Azimuth;
-  vtkSmartPointer<vtkDoubleArray> Distance;
+  vtkSmartPointer<vtkDataArray> Distance;
   vtkSmartPointer<vtkUnsignedShortArray> DistanceRaw;
   vtkSmartPointer<vtkDoubleArray> Timestamp;
-  vtkSmartPointer<vtkDoubleArray> VerticalAngle;
+  vtkSmartPointer<vtkDataArray> VerticalAngle;
   vtkSmartPointer<vtkUnsignedIntArray> RawTime;
   vtkSmartPointer<vtkIntArray> IntensityFlag;
   vtkSmartPointer<vtkIntArray> DistanceFlag;
@@ -150,7 +247,14 @@ protected:
 
   RPMCalculator* RpmCalculator_;
 
+  // Azimuth step between the firing blocks of the packets
+  AzimuthStepEstimator* AzimuthStep;
+
+  // Intra-firing azimuth adjustments for the current azimuth step
+  AzimuthAdjustmentCache* AzimuthAdjustments;
+
   FramingState* CurrentFrameState;
+  VelodyneFrameBuffers* CurrentFrameBuffers;
   unsigned int LastTimestamp;
   std::vector<double> RpmByFrames;
   double TimeAdjust;
@@ -160,15 +264,36 @@ protected:
   unsigned char SensorPowerMode;
 
   // Parameters ready by calibration
-  std::vector<double> cos_lookup_table_;
-  std::vector<double> sin_lookup_table_;
+  // Process-wide tables indexed by the azimuth in hundredths of degree
+  const double* cos_lookup_table_ = nullptr;
+  const double* sin_lookup_table_ = nullptr;
   HDLLaserCorrection laser_corrections_[HDL_MAX_NUM_LASERS];
+  // Rank of each laser sorted by vertical angle, used by the laser decimation
+  int LaserVerticalRank[HDL_MAX_NUM_LASERS];
+  // Lasers kept by the laser selection and the laser decimation
+  std::bitset<HDL_MAX_NUM_LASERS> LaserMask;
+  // Raw distances kept by the distance gate and the spherical crop, checked before
+  // the position of the returns is computed
+  double RawDistanceRange[2] = { 0., 0. };
+  // Modification time of the interpreter when the masks were updated, 0 to force it
+  vtkMTimeType DecodingMasksTime = 0;
+  // Bound of the difference between the distance and the norm of the position of a return
+  double MaximumPositionOffset = 0.;
+  // Copy of the corrections arranged for the vectorized firing decoding
+  LaserCorrectionArrays* FiringCorrections;
+  // 3 first rows of the matrix of the sensor transform, applied to the positions of the
+  // firings if it is not the identity
+  double SensorMatrix[12];
+  bool ApplySensorMatrix = false;
   double XMLColorTable[HDL_MAX_NUM_LASERS][3];
   bool IsCorrectionFromLiveStream = true;
 
   // Sensor parameters presented as rolling data, extracted from enough packets
   vtkRollingDataAccumulator* rollingCalibrationData;
 
+  // Packets received before the end of the live calibration, decoded once it is known
+  std::deque<std::vector<unsigned char> > PacketsWaitingForCalibration;
+
   // User configurable parameters
   int FiringsSkip;
 
@@ -177,8 +302,19 @@ protected:
   bool ShouldCheckSensor;
   uint32_t lastGpsTimestamp = 0;
 
+  // State of the frame splitting done by PreProcessPacket
+  FramingState* PreProcessFrameState;
+  bool PreProcessIsEmptyFrame = true;
+  int PreProcessNumberOfFiringPackets = 0;
+  int PreProcessLastNumberOfFiringPackets = 0;
+  int PreProcessFrameNumber = 0;
+
   unsigned int DualReturnFilter;
 
+  unsigned int OptionalArrays = ALL_OPTIONAL_ARRAYS;
+
+  bool SinglePrecisionCoordinates = false;
+
   vtkVelodynePacketInterpreter();
   ~vtkVelodynePacketInterpreter();
 
@@ -205,6 +341,20 @@ struct VelodyneSpecificFrameInformation : public SpecificFrameInformation
 
   void reset() { *this = VelodyneSpecificFrameInformation(); }
   std::unique_ptr<SpecificFrameInformation> clone() { return std::make_unique<VelodyneSpecificFrameInformation>(*this); }
+
+  bool write(std::ostream& os) const override
+  {
+    os.write(reinterpret_cast<const char*>(&this->FiringToSkip), sizeof(this->FiringToSkip));
+    os.write(reinterpret_cast<const char*>(&this->NbrOfRollingTime), sizeof(this->NbrOfRollingTime));
+    return os.good();
+  }
+
+  bool read(std::istream& is) override
+  {
+    is.read(reinterpret_cast<char*>(&this->FiringToSkip), sizeof(this->FiringToSkip));
+    is.read(reinterpret_cast<char*>(&this->NbrOfRollingTime), sizeof(this->NbrOfRollingTime));
+    return is.good();
+  }
 };
 
 #endif // VELODYNEPACKETINTERPRETOR_H
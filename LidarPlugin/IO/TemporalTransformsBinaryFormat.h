@@ -0,0 +1,65 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TEMPORALTRANSFORMSBINARYFORMAT_H
+#define TEMPORALTRANSFORMSBINARYFORMAT_H
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief Binary pose trajectory format (.lvtraj) shared by vtkTemporalTransformsReader
+ * and vtkTemporalTransformsWriter.
+ *
+ * All the values are little endian. The file starts with the header below, followed by
+ * columns of NumberOfPoses float64 values each, so that each column can be mapped as is:
+ * - time, in seconds
+ * - orientation quaternion, as 4 values per pose: w, x, y, z
+ * - translation, as 3 values per pose: x, y, z, in meters
+ * - if HasCovariance is set, the 6x6 row major covariance of each pose, as the
+ *   "Covariance" array of the SLAM trajectory
+ */
+namespace TemporalTransformsBinaryFormat
+{
+const char Magic[8] = { 'L', 'V', 'T', 'R', 'A', 'J', '\r', '\n' };
+const uint32_t Version = 1;
+
+enum Flags
+{
+  HasCovariance = 1 << 0,
+};
+
+struct Header
+{
+  char Magic[8];
+  uint32_t Version;
+  uint32_t Flags;
+  uint64_t NumberOfPoses;
+  uint64_t Reserved;
+};
+static_assert(sizeof(Header) == 32, "the columns must stay aligned on 8 bytes");
+
+const int QuaternionSize = 4;
+const int TranslationSize = 3;
+const int CovarianceSize = 36;
+const char* const CovarianceArrayName = "Covariance";
+const char* const Extension = ".lvtraj";
+
+inline bool HasMagic(const char* data)
+{
+  return std::memcmp(data, Magic, sizeof(Magic)) == 0;
+}
+}
+
+#endif // TEMPORALTRANSFORMSBINARYFORMAT_H
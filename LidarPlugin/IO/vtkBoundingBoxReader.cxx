@@ -2,6 +2,8 @@
 
 #include <yaml-cpp/yaml.h>
 
+#include <vtkByteSwap.h>
+#include <vtkInformation.h>
 #include <vtkInformationVector.h>
 #include <vtkFieldData.h>
 #include <vtkNew.h>
@@ -12,9 +14,17 @@
 #include <vtkStringArray.h>
 #include <vtkTransform.h>
 #include <vtkTransformPolyDataFilter.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
 
 #include <Eigen/Geometry>
 
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
 #include "vtkEigenTools.h"
 #include "vtkHelper.h"
 
@@ -131,6 +141,21 @@ vtkSmartPointer<vtkPolyData> CreateBoundingBox3D(const Eigen::Isometry3d& p, con
   transformFilter->Update();
   return transformFilter->GetOutput();
 }
+
+// Binary format: the header, then for each box its time, center, dimensions and
+// rotation as float64, its dimension and the length of its label as uint32, and
+// its label. All the values are little endian.
+const char BinaryMagic[8] = { 'L', 'V', 'B', 'B', 'O', 'X', '\r', '\n' };
+const uint32_t BinaryVersion = 1;
+
+struct BinaryHeader
+{
+  char Magic[8];
+  uint32_t Version;
+  uint32_t NumberOfBoxes;
+};
+
+const size_t BinaryRecordSize = 10 * sizeof(double) + 2 * sizeof(uint32_t);
 }
 //-----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkBoundingBoxReader)
@@ -142,65 +167,283 @@ vtkBoundingBoxReader::vtkBoundingBoxReader()
 }
 
 //-----------------------------------------------------------------------------
-int vtkBoundingBoxReader::RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *outputVector)
+bool vtkBoundingBoxReader::ReadYAMLFile(std::vector<Box>& boxes)
 {
-  if (this->FileName.empty())
+  YAML::Node node;
+  try
   {
-    vtkErrorMacro("Please specify a file name")
-    return VTK_ERROR;
+    node = YAML::LoadFile(this->FileName);
+  }
+  catch (YAML::Exception& e)
+  {
+    vtkErrorMacro(<< "Failed to read " << this->FileName << ": " << e.what())
+    return false;
   }
-  auto *output = vtkMultiBlockDataSet::GetData(outputVector->GetInformationObject(0));
-
-  YAML::Node node = YAML::LoadFile(this->FileName);
   YAML::Node objects = node["objects"];
   if (!objects)
+  {
     vtkErrorMacro("In yaml file, no 'objects' key at level 0!")
+    return false;
+  }
 
-  output->SetNumberOfBlocks(objects.size());
-  for (int i = 0; i < objects.size(); ++i)
+  boxes.reserve(objects.size());
+  for (size_t i = 0; i < objects.size(); ++i)
   {
     try {
+      Box box;
       std::string type = objects[i]["selector"]["type"].as<std::string>();
-      vtkSmartPointer<vtkPolyData> bb = nullptr;
       if (type == "2D bounding box")
       {
-        std::vector<double> center = objects[i]["selector"]["center"].as<std::vector<double>>();
-        center[1] = this->ImageHeight - center[1]; // due to image processing vs vtk convention
-        std::vector<double> dimension= objects[i]["selector"]["dimensions"].as<std::vector<double>>();
-
-        bb = CreateBoundingBox2D(center[0] - dimension[0]/2.,center[1] - dimension[1]/2., dimension[0], dimension[1]);
+        box.Dimension = 2;
       }
       else if (type == "3D bounding box")
       {
-        std::vector<double> center = objects[i]["selector"]["center"].as<std::vector<double>>();
+        box.Dimension = 3;
         std::vector<double> rotation = objects[i]["selector"]["rotation"].as<std::vector<double>>();
-
-        Eigen::Matrix3d r = RollPitchYawInDegreeToMatrix(rotation[0], rotation[1], rotation[2]);
-        Eigen::Translation3d t(center[0], center[1], center[2]);
-        Eigen::Isometry3d pose(t*Eigen::Quaterniond(r));
-
-        std::vector<double> dimension= objects[i]["selector"]["dimensions"].as<std::vector<double>>();
-        Eigen::Vector3d d(dimension.data());
-
-        bb = CreateBoundingBox3D(pose, d);
+        std::copy(rotation.begin(), rotation.begin() + 3, box.Rotation);
       }
       else
       {
         vtkErrorMacro("Either the 'type' key is missing or this type of bounding box is not supported")
+        continue;
       }
-
-      // Add label
-      std::string label = objects[i]["label"].as<std::string>();
-      auto labelData = createArray<vtkStringArray>("Label", 1, 1);
-      labelData->SetValue(0, label);
-      bb->GetFieldData()->AddArray(labelData);
-
-      output->SetBlock(i, bb);
+      std::vector<double> center = objects[i]["selector"]["center"].as<std::vector<double>>();
+      std::vector<double> dimension = objects[i]["selector"]["dimensions"].as<std::vector<double>>();
+      std::copy(center.begin(), center.begin() + box.Dimension, box.Center);
+      std::copy(dimension.begin(), dimension.begin() + box.Dimension, box.Dimensions);
+      box.Label = objects[i]["label"].as<std::string>();
+      if (objects[i]["timestamp"])
+      {
+        box.Time = objects[i]["timestamp"].as<double>();
+      }
+      boxes.push_back(box);
 
     } catch (YAML::BadConversion& e) {
       vtkErrorMacro(<< "YAML::BadConversion : " << e.what() << "\nThe yaml file is ill-formed")
     }
   }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkBoundingBoxReader::ReadBinaryFile(std::vector<Box>& boxes)
+{
+  // read the whole file at once, then decode the records in place
+  std::ifstream file(this->FileName, std::ios::binary | std::ios::ate);
+  std::vector<char> data(file ? static_cast<size_t>(file.tellg()) : 0);
+  file.seekg(0);
+  if (!file || !file.read(data.data(), data.size()) || data.size() < sizeof(BinaryHeader))
+  {
+    vtkErrorMacro(<< "Failed to read " << this->FileName)
+    return false;
+  }
+  BinaryHeader header;
+  std::memcpy(&header, data.data(), sizeof(header));
+  vtkByteSwap::Swap4LE(&header.Version);
+  vtkByteSwap::Swap4LE(&header.NumberOfBoxes);
+  if (header.Version > BinaryVersion)
+  {
+    vtkErrorMacro(<< this->FileName << " has the version " << header.Version
+                  << ", only the versions up to " << BinaryVersion << " are supported")
+    return false;
+  }
+
+  boxes.resize(header.NumberOfBoxes);
+  size_t offset = sizeof(header);
+  for (Box& box : boxes)
+  {
+    if (offset + BinaryRecordSize > data.size())
+    {
+      vtkErrorMacro(<< this->FileName << " is truncated")
+      return false;
+    }
+    double values[10];
+    uint32_t sizes[2];
+    std::memcpy(values, data.data() + offset, sizeof(values));
+    std::memcpy(sizes, data.data() + offset + sizeof(values), sizeof(sizes));
+    vtkByteSwap::Swap8LERange(values, 10);
+    vtkByteSwap::Swap4LERange(sizes, 2);
+    offset += BinaryRecordSize;
+    if (offset + sizes[1] > data.size())
+    {
+      vtkErrorMacro(<< this->FileName << " is truncated")
+      return false;
+    }
+    box.Time = values[0];
+    std::copy(values + 1, values + 4, box.Center);
+    std::copy(values + 4, values + 7, box.Dimensions);
+    std::copy(values + 7, values + 10, box.Rotation);
+    box.Dimension = sizes[0];
+    box.Label.assign(data.data() + offset, sizes[1]);
+    offset += sizes[1];
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkBoundingBoxReader::UpdateIndex()
+{
+  boost::system::error_code error;
+  const std::time_t fileTime = boost::filesystem::last_write_time(this->FileName, error);
+  if (!error && this->IndexedFileName == this->FileName && this->IndexedFileTime == fileTime)
+  {
+    return true;
+  }
+  this->IndexedFileName.clear();
+  this->Boxes.clear();
+  this->FrameTimes.clear();
+  this->FrameOffsets.clear();
+
+  std::vector<Box> boxes;
+  char magic[sizeof(BinaryMagic)] = {};
+  std::ifstream(this->FileName, std::ios::binary).read(magic, sizeof(magic));
+  const bool isRead = std::memcmp(magic, BinaryMagic, sizeof(magic)) == 0 ? this->ReadBinaryFile(boxes)
+                                                                          : this->ReadYAMLFile(boxes);
+  if (!isRead)
+  {
+    return false;
+  }
+
+  // sort the boxes by time, keeping the order of the file for the boxes of a frame,
+  // then record where each frame starts
+  std::stable_sort(boxes.begin(), boxes.end(), [](const Box& a, const Box& b) { return a.Time < b.Time; });
+  const bool hasTimestamps = !boxes.empty() && (boxes.front().Time != 0 || boxes.back().Time != 0);
+  this->FrameOffsets.push_back(0);
+  for (size_t i = 0; i < boxes.size(); ++i)
+  {
+    if (hasTimestamps && (i == 0 || boxes[i].Time != boxes[i - 1].Time))
+    {
+      if (i > 0)
+      {
+        this->FrameOffsets.push_back(i);
+      }
+      this->FrameTimes.push_back(boxes[i].Time);
+    }
+  }
+  this->FrameOffsets.push_back(boxes.size());
+  this->Boxes = std::move(boxes);
+  this->IndexedFileName = this->FileName;
+  this->IndexedFileTime = error ? 0 : fileTime;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkBoundingBoxReader::SaveBinaryFile(const std::string& filename)
+{
+  if (this->FileName.empty() || !this->UpdateIndex())
+  {
+    return false;
+  }
+  std::ofstream file(filename, std::ios::binary);
+  BinaryHeader header;
+  std::memcpy(header.Magic, BinaryMagic, sizeof(header.Magic));
+  header.Version = BinaryVersion;
+  header.NumberOfBoxes = static_cast<uint32_t>(this->Boxes.size());
+  vtkByteSwap::Swap4LE(&header.Version);
+  vtkByteSwap::Swap4LE(&header.NumberOfBoxes);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (const Box& box : this->Boxes)
+  {
+    double values[10] = { box.Time };
+    std::copy(box.Center, box.Center + 3, values + 1);
+    std::copy(box.Dimensions, box.Dimensions + 3, values + 4);
+    std::copy(box.Rotation, box.Rotation + 3, values + 7);
+    uint32_t sizes[2] = { box.Dimension, static_cast<uint32_t>(box.Label.size()) };
+    vtkByteSwap::Swap8LERange(values, 10);
+    vtkByteSwap::Swap4LERange(sizes, 2);
+    file.write(reinterpret_cast<const char*>(values), sizeof(values));
+    file.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+    file.write(box.Label.data(), box.Label.size());
+  }
+  if (!file)
+  {
+    vtkErrorMacro(<< "Failed to write " << filename)
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+int vtkBoundingBoxReader::RequestInformation(vtkInformation *, vtkInformationVector **, vtkInformationVector *outputVector)
+{
+  if (this->FileName.empty())
+  {
+    vtkErrorMacro("Please specify a file name")
+    return VTK_ERROR;
+  }
+  if (!this->UpdateIndex())
+  {
+    return VTK_ERROR;
+  }
+
+  vtkInformation* info = outputVector->GetInformationObject(0);
+  info->Remove(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+  info->Remove(vtkStreamingDemandDrivenPipeline::TIME_RANGE());
+  if (!this->FrameTimes.empty())
+  {
+    info->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(), this->FrameTimes.data(),
+              static_cast<int>(this->FrameTimes.size()));
+    double timeRange[2] = { this->FrameTimes.front(), this->FrameTimes.back() };
+    info->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(), timeRange, 2);
+  }
+  return VTK_OK;
+}
+
+//-----------------------------------------------------------------------------
+int vtkBoundingBoxReader::RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *outputVector)
+{
+  if (this->FileName.empty())
+  {
+    vtkErrorMacro("Please specify a file name")
+    return VTK_ERROR;
+  }
+  if (!this->UpdateIndex())
+  {
+    return VTK_ERROR;
+  }
+  vtkInformation* info = outputVector->GetInformationObject(0);
+  auto *output = vtkMultiBlockDataSet::GetData(info);
+
+  // find the last frame which starts before the requested time
+  size_t frame = 0;
+  if (!this->FrameTimes.empty() && info->Has(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP()))
+  {
+    const double time = info->Get(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP());
+    auto next = std::upper_bound(this->FrameTimes.begin(), this->FrameTimes.end(), time);
+    frame = next == this->FrameTimes.begin() ? 0 : std::distance(this->FrameTimes.begin(), next) - 1;
+    output->GetInformation()->Set(vtkDataObject::DATA_TIME_STEP(), this->FrameTimes[frame]);
+  }
+
+  // only the boxes of this frame are created
+  const size_t begin = this->FrameOffsets[frame];
+  const size_t end = this->FrameOffsets[frame + 1];
+  output->SetNumberOfBlocks(static_cast<unsigned int>(end - begin));
+  for (size_t i = begin; i < end; ++i)
+  {
+    const Box& box = this->Boxes[i];
+    vtkSmartPointer<vtkPolyData> bb = nullptr;
+    if (box.Dimension == 2)
+    {
+      const double centerY = this->ImageHeight - box.Center[1]; // due to image processing vs vtk convention
+      bb = CreateBoundingBox2D(box.Center[0] - box.Dimensions[0]/2., centerY - box.Dimensions[1]/2.,
+                               box.Dimensions[0], box.Dimensions[1]);
+    }
+    else
+    {
+      Eigen::Matrix3d r = RollPitchYawInDegreeToMatrix(box.Rotation[0], box.Rotation[1], box.Rotation[2]);
+      Eigen::Translation3d t(box.Center[0], box.Center[1], box.Center[2]);
+      Eigen::Isometry3d pose(t*Eigen::Quaterniond(r));
+
+      bb = CreateBoundingBox3D(pose, Eigen::Vector3d(box.Dimensions));
+    }
+
+    // Add label
+    auto labelData = createArray<vtkStringArray>("Label", 1, 1);
+    labelData->SetValue(0, box.Label);
+    bb->GetFieldData()->AddArray(labelData);
+
+    output->SetBlock(static_cast<unsigned int>(i - begin), bb);
+  }
 
   return VTK_OK;
 }
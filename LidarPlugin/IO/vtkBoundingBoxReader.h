@@ -1,12 +1,22 @@
 #ifndef VTKBOUNDINGBOXREADER_H
 #define VTKBOUNDINGBOXREADER_H
 
+#include <ctime>
 #include <string>
+#include <vector>
 
 #include <vtkMultiBlockDataSetAlgorithm.h>
 
 /**
- * @brief The vtkBoundingBoxReader create Bounding boxes from a specific yaml format. Right now only 2D bounding boxes are supported.
+ * @brief The vtkBoundingBoxReader create Bounding boxes from a specific yaml format.
+ *
+ * Each object of the file may have a "timestamp" key, in seconds, so that a single
+ * file holds the detections of many frames. The boxes are then indexed by time when
+ * the file is loaded: the reader provides one time step per timestamp and only
+ * creates the boxes of the requested time step, found by binary search.
+ *
+ * The boxes can also be read from a binary .lvbbox file, written by SaveBinaryFile,
+ * which is loaded without any parsing.
  */
 class VTK_EXPORT vtkBoundingBoxReader : public vtkMultiBlockDataSetAlgorithm
 {
@@ -18,16 +28,53 @@ public:
 
   vtkSetMacro(ImageHeight, int)
 
+  /**
+   * @brief SaveBinaryFile save the boxes of FileName in the binary format, which is
+   * faster to load
+   * @return false if FileName could not be read or the file could not be written
+   */
+  bool SaveBinaryFile(const std::string& filename);
+
 protected:
   vtkBoundingBoxReader();
 
+  int RequestInformation(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
+
   int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
 
+  //! Box as read from the file, without the polydata which is only created when needed
+  struct Box
+  {
+    double Time = 0;
+    //! 2 or 3 for a 2D or a 3D bounding box
+    unsigned int Dimension = 0;
+    double Center[3] = { 0, 0, 0 };
+    double Dimensions[3] = { 0, 0, 0 };
+    //! roll, pitch, yaw in degree, 3D boxes only
+    double Rotation[3] = { 0, 0, 0 };
+    std::string Label;
+  };
+
+  //! Load and index the boxes of FileName, unless they are up to date
+  bool UpdateIndex();
+  bool ReadYAMLFile(std::vector<Box>& boxes);
+  bool ReadBinaryFile(std::vector<Box>& boxes);
+
   //! yaml annotation file containnig bounding box informations
   std::string FileName = "";
   //! image height needed to go from the image referential to the vtk referential
   int ImageHeight = 0;
 
+  //! Boxes sorted by time
+  std::vector<Box> Boxes;
+  //! Distinct times of the boxes, empty if the boxes have no timestamp
+  std::vector<double> FrameTimes;
+  //! The boxes of the frame i are in [FrameOffsets[i], FrameOffsets[i + 1][
+  std::vector<size_t> FrameOffsets;
+  //! File the index has been built from, and its modification time
+  std::string IndexedFileName;
+  std::time_t IndexedFileTime = 0;
+
 private:
   vtkBoundingBoxReader(const vtkBoundingBoxReader&) = delete;
   void operator =(const vtkBoundingBoxReader&) = delete;
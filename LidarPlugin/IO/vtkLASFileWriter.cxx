@@ -49,6 +49,8 @@ int vtkLASFileWriter::Write()
 
   this->LASWriter.SetWriteSRS(this->WriteSRS);
   this->LASWriter.SetWriteColor(this->WriteColor);
+  this->LASWriter.SetCompressed(this->Compressed);
+  this->LASWriter.SetUseLocalApproximation(this->UseLocalApproximation);
   this->LASWriter.Open(this->FileName);
 
   bool useLatLonForOut = this->ExportType == EXPORT_LATLONG;
@@ -152,10 +154,8 @@ int vtkLASFileWriter::RequestInformation(vtkInformation* vtkNotUsed(request),
     std::cout << "vtkLASFileWriter::RequestInformation: skipping metadata pass"
               << std::endl;
 #endif
+    // the bounding box is set in the header when the writer is closed
     this->CurrentPass = 1;
-    const double zero[3] = {0.0, 0.0, 0.0};
-    this->LASWriter.SetMinPt(zero);
-    this->LASWriter.SetMaxPt(zero);
   }
 
   return 1;
@@ -246,6 +246,7 @@ int vtkLASFileWriter::RequestData(vtkInformation *request,
     if (this->CurrentPass == this->PassCount - 1)
     {
       request->Remove(vtkStreamingDemandDrivenPipeline::CONTINUE_EXECUTING());
+      this->LASWriter.Close();
       this->End = std::chrono::steady_clock::now();
       double dt = 1e-6 * std::chrono::duration_cast<std::chrono::microseconds>(this->End - this->Start).count();
       std::cout << "Exported LAS in " << dt << " seconds" << std::endl;
@@ -35,7 +35,7 @@
 //   RequestUpdateExtent()
 //   RequestData()
 // }
-// Second and last pass:
+// Second and last pass, the only one if SkipMetaDataPass is set:
 // for (i = firstFrame; i < lastFrame; i++) {
 //   RequestUpdateExtent()
 //   RequestData()
@@ -62,6 +62,12 @@ public:
   vtkSetMacro(WriteColor, bool)
   vtkGetMacro(WriteColor, bool)
 
+  vtkSetMacro(Compressed, bool)
+  vtkGetMacro(Compressed, bool)
+
+  vtkSetMacro(UseLocalApproximation, bool)
+  vtkGetMacro(UseLocalApproximation, bool)
+
   vtkSetMacro(LastFrame, int)
   vtkGetMacro(LastFrame, int)
 
@@ -117,6 +123,8 @@ private:
   char* FileName = nullptr;
   bool WriteSRS = true;
   bool WriteColor = false;
+  bool Compressed = false;
+  bool UseLocalApproximation = false;
   int FirstFrame = 0;
   int LastFrame = -1; // negative numbers can be used à la Python list indexes
   int FrameStride = 1;
@@ -13,8 +13,11 @@
 // limitations under the License.
 
 #include "vtkTemporalTransformsReader.h"
+#include "TemporalTransformsBinaryFormat.h"
 
 #include <vtkAbstractArray.h>
+#include <vtkByteSwap.h>
+#include <vtkCallbackCommand.h>
 #include <vtkDelimitedTextReader.h>
 #include <vtkDoubleArray.h>
 #include <vtkInformation.h>
@@ -27,6 +30,12 @@
 
 #include <Eigen/Geometry>
 
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <memory>
 #include <unordered_map>
 
 #include "vtkTemporalTransforms.h"
@@ -112,6 +121,12 @@ int vtkTemporalTransformsReader::RequestData(vtkInformation* vtkNotUsed(request)
     return 1;
   }
 
+  if (IsBinaryTrajectory(this->FileName))
+  {
+    this->ReadBinaryData(vtkPolyData::GetData(outputVector));
+    return 1;
+  }
+
   // Read the data from the file
   vtkNew<vtkDelimitedTextReader> csvReader;
   csvReader->SetFileName(this->FileName);
@@ -187,6 +202,94 @@ int vtkTemporalTransformsReader::RequestData(vtkInformation* vtkNotUsed(request)
 }
 
 //-----------------------------------------------------------------------------
+bool vtkTemporalTransformsReader::ReadBinaryData(vtkPolyData* output)
+{
+  namespace Format = TemporalTransformsBinaryFormat;
+
+  // The mapping is private, so that the arrays can be modified without modifying the file
+  auto file = std::make_shared<boost::iostreams::mapped_file>();
+  boost::iostreams::mapped_file_params parameters(this->FileName);
+  parameters.flags = boost::iostreams::mapped_file::priv;
+  try
+  {
+    file->open(parameters);
+  }
+  catch (const std::exception&)
+  {
+  }
+  if (!file->is_open() || file->size() < sizeof(Format::Header))
+  {
+    vtkErrorMacro("Failed to read the binary trajectory \"" << this->FileName << "\"");
+    return false;
+  }
+
+  Format::Header header;
+  std::memcpy(&header, file->data(), sizeof(header));
+  vtkByteSwap::Swap4LE(&header.Version);
+  vtkByteSwap::Swap4LE(&header.Flags);
+  vtkByteSwap::Swap8LE(&header.NumberOfPoses);
+  if (header.Version > Format::Version)
+  {
+    vtkErrorMacro("The binary trajectory \"" << this->FileName << "\" has the version "
+                  << header.Version << ", only the versions up to " << Format::Version
+                  << " are supported");
+    return false;
+  }
+  const bool hasCovariance = header.Flags & Format::HasCovariance;
+  const vtkIdType nbPoses = static_cast<vtkIdType>(header.NumberOfPoses);
+  const size_t nbValuesPerPose = 1 + Format::QuaternionSize + Format::TranslationSize
+                                 + (hasCovariance ? Format::CovarianceSize : 0);
+  if (file->size() < sizeof(header) + header.NumberOfPoses * nbValuesPerPose * sizeof(double))
+  {
+    vtkErrorMacro("The binary trajectory \"" << this->FileName << "\" is truncated");
+    return false;
+  }
+
+  size_t offset = sizeof(header);
+  auto time = MapColumn(file, offset, nbPoses, 1);
+  offset += nbPoses * sizeof(double);
+  if (this->TimeOffset != 0)
+  {
+    double* timeData = time->GetPointer(0);
+    for (vtkIdType i = 0; i < nbPoses; ++i)
+    {
+      timeData[i] += this->TimeOffset;
+    }
+  }
+
+  // vtkTemporalTransforms stores an axis-angle, the only column converted
+  auto axisAngle = vtkSmartPointer<vtkDoubleArray>::New();
+  axisAngle->SetNumberOfComponents(4);
+  axisAngle->SetNumberOfTuples(nbPoses);
+  const char* quaternions = file->data() + offset;
+  for (vtkIdType i = 0; i < nbPoses; ++i)
+  {
+    double wxyz[Format::QuaternionSize];
+    std::memcpy(wxyz, quaternions + i * sizeof(wxyz), sizeof(wxyz));
+    vtkByteSwap::Swap8LERange(wxyz, Format::QuaternionSize);
+    const Eigen::AngleAxisd rotation(Eigen::Quaterniond(wxyz[0], wxyz[1], wxyz[2], wxyz[3]).normalized());
+    axisAngle->SetTuple4(i, rotation.axis()[0], rotation.axis()[1], rotation.axis()[2], rotation.angle());
+  }
+  offset += nbPoses * Format::QuaternionSize * sizeof(double);
+
+  auto translation = MapColumn(file, offset, nbPoses, Format::TranslationSize);
+  offset += nbPoses * Format::TranslationSize * sizeof(double);
+
+  auto trajectory = vtkSmartPointer<vtkTemporalTransforms>::New();
+  trajectory->SetTranslationArray(translation);
+  trajectory->SetTimeArray(time);
+  trajectory->SetOrientationArray(axisAngle);
+  if (hasCovariance)
+  {
+    auto covariance = MapColumn(file, offset, nbPoses, Format::CovarianceSize);
+    covariance->SetName(Format::CovarianceArrayName);
+    trajectory->GetPointData()->AddArray(covariance);
+  }
+
+  output->ShallowCopy(trajectory);
+  return true;
+}
+
 vtkSmartPointer<vtkTemporalTransforms> vtkTemporalTransformsReader::OpenTemporalTransforms(const std::string& filename)
 {
   auto reader1 = vtkSmartPointer<vtkTemporalTransformsReader>::New();
@@ -37,6 +37,11 @@
  * - yaw   : expresses the sensor rotation around the Z axis and is in degree
  * - the rotation matrix can be recomposed this way: R = Rz(z)*Ry(y)*Rx(x)
  *
+ * Files in the binary .lvtraj format, see TemporalTransformsBinaryFormat.h, are
+ * recognized by their header whatever their extension. Their columns are mapped
+ * in memory and used as is by the arrays of the output, except the orientation
+ * which is converted from a quaternion to an axis-angle.
+ *
  * Remark: if you get from LidarView UI the error:
  * "vtkSIProxyDefinitionManager: No proxy that matches: group= and proxy= were found."
  * when you tried to open a file with a ".csv" extension and was asked to chose
@@ -68,6 +73,9 @@ protected:
   //! can throw an error
   void ReadData();
 
+  //! Read a binary .lvtraj file in output, return false on error
+  bool ReadBinaryData(vtkPolyData* output);
+
   int RequestData(vtkInformation* request,
                   vtkInformationVector** inputVector,
                   vtkInformationVector* outputVector);
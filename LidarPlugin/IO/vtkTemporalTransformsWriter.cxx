@@ -1,15 +1,42 @@
 #include "vtkTemporalTransforms.h"
 #include "vtkTemporalTransformsWriter.h"
+#include "TemporalTransformsBinaryFormat.h"
 
 #include "vtkTransform.h"
 #include "vtkNew.h"
 #include <vtkObjectFactory.h>
 #include "vtkInformationVector.h"
 #include "vtkInformation.h"
+#include <vtkByteSwap.h>
 #include <iostream>
+#include <vector>
+
+#include <boost/algorithm/string/predicate.hpp>
 
 #include "vtkConversions.h"
 
+namespace
+{
+//-----------------------------------------------------------------------------
+bool WriteColumn(std::ofstream& file, std::vector<double>& values)
+{
+  vtkByteSwap::Swap8LERange(values.data(), values.size());
+  return static_cast<bool>(file.write(reinterpret_cast<const char*>(values.data()),
+                                      values.size() * sizeof(double)));
+}
+
+//-----------------------------------------------------------------------------
+std::vector<double> GetColumn(vtkDataArray* array, vtkIdType nbTuples, int nbComponents)
+{
+  std::vector<double> values(nbTuples * nbComponents);
+  for (vtkIdType i = 0; i < nbTuples; ++i)
+  {
+    array->GetTuple(i, values.data() + i * nbComponents);
+  }
+  return values;
+}
+}
+
 //-----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkTemporalTransformsWriter)
 
@@ -44,6 +71,12 @@ int vtkTemporalTransformsWriter::RequestData(vtkInformation *vtkNotUsed(request)
     return 0;
   }
 
+  if (boost::algorithm::iends_with(std::string(this->FileName),
+                                   TemporalTransformsBinaryFormat::Extension))
+  {
+    return this->WriteBinaryData(transforms) ? 1 : 0;
+  }
+
   vtkDataArray* time = transforms->GetTimeArray();
 
   std::ofstream file(this->FileName);
@@ -82,3 +115,65 @@ int vtkTemporalTransformsWriter::RequestData(vtkInformation *vtkNotUsed(request)
   file.close();
   return 1;
 }
+
+//-----------------------------------------------------------------------------
+bool vtkTemporalTransformsWriter::WriteBinaryData(vtkTemporalTransforms* transforms)
+{
+  namespace Format = TemporalTransformsBinaryFormat;
+
+  const vtkIdType nbPoses = transforms->GetNumberOfPoints();
+  vtkDataArray* covariance = transforms->GetPointData()->GetArray(Format::CovarianceArrayName);
+  if (covariance && covariance->GetNumberOfComponents() != Format::CovarianceSize)
+  {
+    covariance = nullptr;
+  }
+
+  Format::Header header;
+  std::memcpy(header.Magic, Format::Magic, sizeof(header.Magic));
+  header.Version = Format::Version;
+  header.Flags = covariance ? Format::HasCovariance : 0;
+  header.NumberOfPoses = static_cast<uint64_t>(nbPoses);
+  header.Reserved = 0;
+  vtkByteSwap::Swap4LE(&header.Version);
+  vtkByteSwap::Swap4LE(&header.Flags);
+  vtkByteSwap::Swap8LE(&header.NumberOfPoses);
+
+  std::ofstream file(this->FileName, std::ios::binary);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  // Each column is written at once, the values are kept in full precision
+  std::vector<double> time = GetColumn(transforms->GetTimeArray(), nbPoses, 1);
+  bool isWritten = WriteColumn(file, time);
+
+  vtkDataArray* orientation = transforms->GetOrientationArray();
+  std::vector<double> quaternions(nbPoses * Format::QuaternionSize);
+  for (vtkIdType i = 0; i < nbPoses; ++i)
+  {
+    double axisAngle[4];
+    orientation->GetTuple(i, axisAngle);
+    const Eigen::Quaterniond q(Eigen::AngleAxisd(axisAngle[3],
+      Eigen::Vector3d(axisAngle[0], axisAngle[1], axisAngle[2]).normalized()));
+    double* wxyz = quaternions.data() + i * Format::QuaternionSize;
+    wxyz[0] = q.w();
+    wxyz[1] = q.x();
+    wxyz[2] = q.y();
+    wxyz[3] = q.z();
+  }
+  isWritten &= WriteColumn(file, quaternions);
+
+  std::vector<double> translation = GetColumn(transforms->GetTranslationArray(), nbPoses,
+                                              Format::TranslationSize);
+  isWritten &= WriteColumn(file, translation);
+
+  if (covariance)
+  {
+    std::vector<double> covariances = GetColumn(covariance, nbPoses, Format::CovarianceSize);
+    isWritten &= WriteColumn(file, covariances);
+  }
+
+  if (!isWritten)
+  {
+    vtkErrorMacro("Failed to write the binary trajectory \"" << this->FileName << "\"");
+  }
+  return isWritten;
+}
@@ -18,6 +18,14 @@
 // #include <vtkPolyDataAlgorithm.h>
 #include <vtkPolyDataWriter.h>
 
+class vtkTemporalTransforms;
+
+/**
+ * @brief vtkTemporalTransformsWriter writes a vtkTemporalTransforms in a csv file,
+ * or in the binary .lvtraj format if the file has this extension, see
+ * TemporalTransformsBinaryFormat.h. The binary format keeps the full precision of
+ * the values and the "Covariance" array of the poses if there is one.
+ */
 // Inspired by vtkObjWriter
 class VTK_EXPORT vtkTemporalTransformsWriter : public vtkPolyDataWriter
 {
@@ -34,6 +42,9 @@ protected:
   vtkTemporalTransformsWriter() = default;
   ~vtkTemporalTransformsWriter();
 
+  //! Write the transforms in the binary format, return false on error
+  bool WriteBinaryData(vtkTemporalTransforms* transforms);
+
 private:
   vtkTemporalTransformsWriter(const vtkTemporalTransformsWriter&) = delete;
   void operator =(const vtkTemporalTransformsWriter&) = delete;
@@ -0,0 +1,298 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "vtkLidarPointCloudMapper.h"
+
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkOpenGLBufferObject.h>
+#include <vtkOpenGLHelper.h>
+#include <vtkOpenGLRenderWindow.h>
+#include <vtkOpenGLVertexArrayObject.h>
+#include <vtkPolyData.h>
+#include <vtkRenderer.h>
+#include <vtkScalarsToColors.h>
+#include <vtkShader.h>
+#include <vtkShaderProgram.h>
+#include <vtkTextureObject.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+namespace {
+//! Number of samples of the lookup table
+const int NumberOfColors = 1024;
+}
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkLidarPointCloudMapper)
+
+//-----------------------------------------------------------------------------
+vtkLidarPointCloudMapper::vtkLidarPointCloudMapper()
+{
+  this->ScalarBuffer = vtkOpenGLBufferObject::New();
+  this->ScalarBuffer->SetType(vtkOpenGLBufferObject::ArrayBuffer);
+  this->ColorTexture = vtkTextureObject::New();
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarPointCloudMapper::~vtkLidarPointCloudMapper()
+{
+  this->ScalarBuffer->Delete();
+  this->ColorTexture->Delete();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudMapper::SetRoundPoints(bool value)
+{
+  if (this->RoundPoints != value)
+  {
+    this->RoundPoints = value;
+    this->ShaderOptionsTime.Modified();
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudMapper::ReleaseGraphicsResources(vtkWindow* window)
+{
+  this->ScalarBuffer->ReleaseGraphicsResources();
+  this->UploadedScalars = nullptr;
+  this->ColorTexture->ReleaseGraphicsResources(window);
+  this->ColorTextureTime = vtkTimeStamp();
+  this->Superclass::ReleaseGraphicsResources(window);
+}
+
+//-----------------------------------------------------------------------------
+vtkDataArray* vtkLidarPointCloudMapper::GetShaderScalars(vtkPolyData* poly, int& component)
+{
+  vtkScalarsToColors* lut = this->LookupTable;
+  if (!this->ScalarVisibility || !lut || lut->GetIndexedLookup())
+  {
+    return nullptr;
+  }
+
+  int cellFlag = 0;
+  vtkDataArray* scalars = vtkAbstractMapper::GetScalars(poly, this->ScalarMode,
+    this->ArrayAccessMode, this->ArrayId, this->ArrayName, cellFlag);
+  if (!scalars || cellFlag != 0 || scalars->GetNumberOfTuples() != poly->GetNumberOfPoints())
+  {
+    return nullptr;
+  }
+  // unsigned chars are used as colors unless they are explicitly mapped
+  if (this->ColorMode != VTK_COLOR_MODE_MAP_SCALARS && scalars->GetDataType() == VTK_UNSIGNED_CHAR)
+  {
+    return nullptr;
+  }
+
+  if (scalars->GetNumberOfComponents() == 1)
+  {
+    component = 0;
+  }
+  else if (lut->GetVectorMode() == vtkScalarsToColors::COMPONENT &&
+           lut->GetVectorComponent() < scalars->GetNumberOfComponents())
+  {
+    component = lut->GetVectorComponent();
+  }
+  else
+  {
+    return nullptr;
+  }
+  return scalars;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudMapper::BuildBufferObjects(vtkRenderer* ren, vtkActor* act)
+{
+  int component = 0;
+  vtkDataArray* scalars = this->GetShaderScalars(this->CurrentInput, component);
+  if (static_cast<bool>(scalars) != this->UseShaderColors)
+  {
+    this->UseShaderColors = scalars != nullptr;
+    this->ShaderOptionsTime.Modified();
+  }
+
+  if (!this->UseShaderColors)
+  {
+    this->Superclass::BuildBufferObjects(ren, act);
+    return;
+  }
+
+  // the superclass must not build the array of colors, the member is changed
+  // directly so that the mapper is not modified
+  this->ScalarVisibility = 0;
+  this->Superclass::BuildBufferObjects(ren, act);
+  this->ScalarVisibility = 1;
+
+  this->UploadScalars(scalars, component);
+  this->UploadLookupTable(ren);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudMapper::UploadScalars(vtkDataArray* scalars, int component)
+{
+  // a frame taken back from the pool keeps its arrays, only their values change
+  if (scalars == this->UploadedScalars && component == this->UploadedComponent &&
+      scalars->GetMTime() < this->ScalarBufferTime)
+  {
+    return;
+  }
+
+  const vtkIdType nbPoints = scalars->GetNumberOfTuples();
+  std::vector<float> values(nbPoints);
+  if (scalars->GetDataType() == VTK_FLOAT && scalars->GetNumberOfComponents() == 1)
+  {
+    const float* data = static_cast<const float*>(scalars->GetVoidPointer(0));
+    std::copy(data, data + nbPoints, values.begin());
+  }
+  else
+  {
+    for (vtkIdType i = 0; i < nbPoints; ++i)
+    {
+      values[i] = static_cast<float>(scalars->GetComponent(i, component));
+    }
+  }
+  this->ScalarBuffer->Upload(values, vtkOpenGLBufferObject::ArrayBuffer);
+  this->UploadedScalars = scalars;
+  this->UploadedComponent = component;
+  this->ScalarBufferTime.Modified();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudMapper::UploadLookupTable(vtkRenderer* ren)
+{
+  vtkScalarsToColors* lut = this->LookupTable;
+  if (this->ColorTextureTime > lut->GetMTime() && this->ColorTexture->GetHandle())
+  {
+    return;
+  }
+
+  const double* range = lut->GetRange();
+  this->ColorTextureRange[0] = range[0];
+  this->ColorTextureRange[1] = range[1];
+  vtkNew<vtkDoubleArray> ramp;
+  ramp->SetNumberOfTuples(NumberOfColors);
+  for (int i = 0; i < NumberOfColors; ++i)
+  {
+    ramp->SetValue(i, range[0] + (range[1] - range[0]) * i / (NumberOfColors - 1));
+  }
+  vtkUnsignedCharArray* colors = lut->MapScalars(ramp.GetPointer(), VTK_COLOR_MODE_MAP_SCALARS, 0);
+
+  this->ColorTexture->SetContext(vtkOpenGLRenderWindow::SafeDownCast(ren->GetRenderWindow()));
+  this->ColorTexture->SetWrapS(vtkTextureObject::ClampToEdge);
+  this->ColorTexture->SetWrapT(vtkTextureObject::ClampToEdge);
+  this->ColorTexture->SetMinificationFilter(vtkTextureObject::Linear);
+  this->ColorTexture->SetMagnificationFilter(vtkTextureObject::Linear);
+  this->ColorTexture->Create2DFromRaw(NumberOfColors, 1, colors->GetNumberOfComponents(),
+                                      VTK_UNSIGNED_CHAR, colors->GetVoidPointer(0));
+  colors->Delete();
+  this->ColorTextureTime.Modified();
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarPointCloudMapper::GetNeedToRebuildShaders(vtkOpenGLHelper& cellBO,
+                                                       vtkRenderer* ren, vtkActor* act)
+{
+  return cellBO.ShaderSourceTime < this->ShaderOptionsTime ||
+         this->Superclass::GetNeedToRebuildShaders(cellBO, ren, act);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudMapper::ReplaceShaderValues(std::map<vtkShader::Type, vtkShader*> shaders,
+                                                   vtkRenderer* ren, vtkActor* act)
+{
+  // the code is inserted before the tags so that the superclass still replaces them,
+  // and before the lighting so that it overrides the colors of the superclass
+  std::string vertexSource = shaders[vtkShader::Vertex]->GetSource();
+  std::string fragmentSource = shaders[vtkShader::Fragment]->GetSource();
+  std::ostringstream fragmentImpl;
+
+  if (this->UseShaderColors)
+  {
+    vtkShaderProgram::Substitute(vertexSource, "//VTK::Color::Dec",
+      "attribute float lidarScalar;\n"
+      "varying float lidarScalarVSOutput;\n"
+      "//VTK::Color::Dec");
+    vtkShaderProgram::Substitute(vertexSource, "//VTK::Color::Impl",
+      "lidarScalarVSOutput = lidarScalar;\n"
+      "//VTK::Color::Impl");
+    vtkShaderProgram::Substitute(fragmentSource, "//VTK::Color::Dec",
+      "varying float lidarScalarVSOutput;\n"
+      "uniform sampler2D lidarColorTexture;\n"
+      "uniform vec2 lidarScalarRange;\n"
+      "//VTK::Color::Dec");
+    // lidarScalarRange holds the minimum and the inverse of the width of the range,
+    // the texture coordinate hits the centers of the first and last texels
+    fragmentImpl
+      << "  float lidarValue = clamp((lidarScalarVSOutput - lidarScalarRange.x) * lidarScalarRange.y, 0.0, 1.0);\n"
+      << "  vec4 lidarColor = texture2D(lidarColorTexture, vec2((lidarValue * "
+      << NumberOfColors - 1 << ".0 + 0.5) / " << NumberOfColors << ".0, 0.5));\n"
+      << "  ambientColor = ambientIntensity * lidarColor.rgb;\n"
+      << "  diffuseColor = diffuseIntensity * lidarColor.rgb;\n"
+      << "  opacity = opacity * lidarColor.a;\n";
+  }
+  if (this->RoundPoints)
+  {
+    fragmentImpl << "  vec2 lidarPointCoord = gl_PointCoord - vec2(0.5);\n"
+                 << "  if (dot(lidarPointCoord, lidarPointCoord) > 0.25) { discard; }\n";
+  }
+  if (!fragmentImpl.str().empty())
+  {
+    vtkShaderProgram::Substitute(fragmentSource, "//VTK::Light::Impl",
+      fragmentImpl.str() + "//VTK::Light::Impl", false);
+  }
+
+  shaders[vtkShader::Vertex]->SetSource(vertexSource);
+  shaders[vtkShader::Fragment]->SetSource(fragmentSource);
+  this->Superclass::ReplaceShaderValues(shaders, ren, act);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudMapper::SetMapperShaderParameters(vtkOpenGLHelper& cellBO,
+                                                         vtkRenderer* ren, vtkActor* act)
+{
+  this->Superclass::SetMapperShaderParameters(cellBO, ren, act);
+  if (!this->UseShaderColors || !cellBO.Program->IsAttributeUsed("lidarScalar"))
+  {
+    return;
+  }
+
+  cellBO.VAO->Bind();
+  if (!cellBO.VAO->AddAttributeArray(cellBO.Program, this->ScalarBuffer, "lidarScalar",
+                                     0, sizeof(float), VTK_FLOAT, 1, false))
+  {
+    vtkErrorMacro("Error setting lidarScalar in shader VAO.");
+  }
+
+  this->ColorTexture->Activate();
+  cellBO.Program->SetUniformi("lidarColorTexture", this->ColorTexture->GetTextureUnit());
+  const double width = this->ColorTextureRange[1] - this->ColorTextureRange[0];
+  const float range[2] = { static_cast<float>(this->ColorTextureRange[0]),
+                           static_cast<float>(width > 0 ? 1.0 / width : 0.0) };
+  cellBO.Program->SetUniform2f("lidarScalarRange", range);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudMapper::RenderPieceFinish(vtkRenderer* ren, vtkActor* act)
+{
+  if (this->UseShaderColors)
+  {
+    this->ColorTexture->Deactivate();
+  }
+  this->Superclass::RenderPieceFinish(ren, act);
+}
@@ -0,0 +1,99 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VTK_LIDAR_POINT_CLOUD_MAPPER_H
+#define VTK_LIDAR_POINT_CLOUD_MAPPER_H
+
+#include <vtkOpenGLPolyDataMapper.h>
+
+class vtkDataArray;
+class vtkOpenGLBufferObject;
+class vtkTextureObject;
+
+/**
+ * @brief The vtkLidarPointCloudMapper maps the scalars of a point cloud to colors on
+ * the GPU, instead of building an array of colors on the CPU at each new frame.
+ *
+ * The values of the colored array are uploaded as a float attribute to a buffer which
+ * is kept between the frames and only updated when the array changes. The lookup table
+ * is sampled once into a texture, which the fragment shader reads. The points can also
+ * be rendered as discs instead of squares.
+ *
+ * Only the point arrays with a single component, or colored by a component, mapped
+ * through a lookup table which is not categorical are mapped on the GPU, the others
+ * are mapped by vtkOpenGLPolyDataMapper.
+ */
+class VTK_EXPORT vtkLidarPointCloudMapper : public vtkOpenGLPolyDataMapper
+{
+public:
+  static vtkLidarPointCloudMapper* New();
+  vtkTypeMacro(vtkLidarPointCloudMapper, vtkOpenGLPolyDataMapper)
+
+  //@{
+  /**
+   * @copydoc vtkLidarPointCloudMapper::RoundPoints
+   */
+  vtkGetMacro(RoundPoints, bool)
+  void SetRoundPoints(bool value);
+  //@}
+
+  void ReleaseGraphicsResources(vtkWindow* window) override;
+
+protected:
+  vtkLidarPointCloudMapper();
+  ~vtkLidarPointCloudMapper();
+
+  void BuildBufferObjects(vtkRenderer* ren, vtkActor* act) override;
+  bool GetNeedToRebuildShaders(vtkOpenGLHelper& cellBO, vtkRenderer* ren, vtkActor* act) override;
+  void ReplaceShaderValues(std::map<vtkShader::Type, vtkShader*> shaders,
+                           vtkRenderer* ren, vtkActor* act) override;
+  void SetMapperShaderParameters(vtkOpenGLHelper& cellBO, vtkRenderer* ren, vtkActor* act) override;
+  void RenderPieceFinish(vtkRenderer* ren, vtkActor* act) override;
+
+private:
+  //! Array colored on the GPU and its component, nullptr if the colors must be
+  //! mapped on the CPU
+  vtkDataArray* GetShaderScalars(vtkPolyData* poly, int& component);
+
+  //! Upload the values of the array, if they changed since the last upload
+  void UploadScalars(vtkDataArray* scalars, int component);
+
+  //! Sample the lookup table into the color texture, if it changed since the last upload
+  void UploadLookupTable(vtkRenderer* ren);
+
+  //! Render the points as discs
+  bool RoundPoints = false;
+
+  //! Whether the colors of the last buffers are mapped on the GPU
+  bool UseShaderColors = false;
+
+  //! Last change of the options which modify the shaders
+  vtkTimeStamp ShaderOptionsTime;
+
+  //! Values of the colored array, one float per point
+  vtkOpenGLBufferObject* ScalarBuffer;
+  vtkDataArray* UploadedScalars = nullptr;
+  int UploadedComponent = -1;
+  vtkTimeStamp ScalarBufferTime;
+
+  //! Lookup table sampled over its range
+  vtkTextureObject* ColorTexture;
+  vtkTimeStamp ColorTextureTime;
+  double ColorTextureRange[2] = { 0.0, 1.0 };
+
+  vtkLidarPointCloudMapper(const vtkLidarPointCloudMapper&) /*= delete*/;
+  void operator =(const vtkLidarPointCloudMapper&) /*= delete*/;
+};
+
+#endif // VTK_LIDAR_POINT_CLOUD_MAPPER_H
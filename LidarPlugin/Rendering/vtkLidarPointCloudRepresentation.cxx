@@ -0,0 +1,201 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "vtkLidarPointCloudRepresentation.h"
+#include "vtkLidarPointCloudMapper.h"
+
+#include <vtkActor.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMath.h>
+#include <vtkObjectFactory.h>
+#include <vtkPVRenderView.h>
+#include <vtkPolyData.h>
+#include <vtkProperty.h>
+#include <vtkRenderer.h>
+#include <vtkScalarsToColors.h>
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkLidarPointCloudRepresentation)
+
+//-----------------------------------------------------------------------------
+vtkLidarPointCloudRepresentation::vtkLidarPointCloudRepresentation()
+{
+  this->Cache = vtkSmartPointer<vtkPolyData>::New();
+  vtkMath::UninitializeBounds(this->DataBounds);
+  this->Mapper = vtkSmartPointer<vtkLidarPointCloudMapper>::New();
+  this->Mapper->SetUseLookupTableScalarRange(1);
+  this->Mapper->SetColorModeToMapScalars();
+  this->Actor = vtkSmartPointer<vtkActor>::New();
+  this->Actor->SetMapper(this->Mapper);
+  // all the cells are rendered as their points
+  this->Actor->GetProperty()->SetRepresentationToPoints();
+  this->Actor->GetProperty()->SetInterpolationToFlat();
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarPointCloudRepresentation::~vtkLidarPointCloudRepresentation() = default;
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudRepresentation::SetVisibility(bool value)
+{
+  this->Superclass::SetVisibility(value);
+  this->Actor->SetVisibility(value ? 1 : 0);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudRepresentation::SetLookupTable(vtkScalarsToColors* lut)
+{
+  this->Mapper->SetLookupTable(lut);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudRepresentation::SetMapScalars(int value)
+{
+  if (value)
+  {
+    this->Mapper->SetColorModeToMapScalars();
+  }
+  else
+  {
+    this->Mapper->SetColorModeToDirectScalars();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudRepresentation::SetPointSize(double value)
+{
+  this->Actor->GetProperty()->SetPointSize(value);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudRepresentation::SetOpacity(double value)
+{
+  this->Actor->GetProperty()->SetOpacity(value);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudRepresentation::SetDiffuseColor(double red, double green, double blue)
+{
+  this->Actor->GetProperty()->SetDiffuseColor(red, green, blue);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudRepresentation::SetRoundPoints(bool value)
+{
+  this->Mapper->SetRoundPoints(value);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarPointCloudRepresentation::FillInputPortInformation(int vtkNotUsed(port), vtkInformation* info)
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+  info->Set(vtkAlgorithm::INPUT_IS_OPTIONAL(), 1);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarPointCloudRepresentation::RequestData(vtkInformation* request,
+                                                  vtkInformationVector** inputVector,
+                                                  vtkInformationVector* outputVector)
+{
+  vtkMath::UninitializeBounds(this->DataBounds);
+  this->Cache->Initialize();
+  if (inputVector[0]->GetNumberOfInformationObjects() == 1)
+  {
+    // the shallow copy shares the arrays of the frame, so that the mapper
+    // recognizes them and only uploads their new values
+    vtkPolyData* input = vtkPolyData::GetData(inputVector[0], 0);
+    this->Cache->ShallowCopy(input);
+    if (this->Cache->GetNumberOfPoints() > 0)
+    {
+      this->Cache->GetBounds(this->DataBounds);
+    }
+  }
+  return this->Superclass::RequestData(request, inputVector, outputVector);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarPointCloudRepresentation::ProcessViewRequest(vtkInformationRequestKey* request_type,
+                                                         vtkInformation* inInfo,
+                                                         vtkInformation* outInfo)
+{
+  if (!this->Superclass::ProcessViewRequest(request_type, inInfo, outInfo))
+  {
+    return 0;
+  }
+
+  if (request_type == vtkPVView::REQUEST_UPDATE())
+  {
+    vtkPVRenderView::SetPiece(inInfo, this, this->Cache);
+    vtkPVRenderView::SetGeometryBounds(inInfo, this->DataBounds);
+  }
+  else if (request_type == vtkPVView::REQUEST_RENDER())
+  {
+    this->Mapper->SetInputConnection(vtkPVRenderView::GetPieceProducer(inInfo, this));
+    this->UpdateColoringParameters();
+  }
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudRepresentation::UpdateColoringParameters()
+{
+  vtkInformation* info = this->GetInputArrayInformation(0);
+  const char* arrayName = nullptr;
+  if (info && info->Has(vtkDataObject::FIELD_NAME()) && info->Has(vtkDataObject::FIELD_ASSOCIATION()))
+  {
+    arrayName = info->Get(vtkDataObject::FIELD_NAME());
+  }
+  if (!arrayName || !arrayName[0])
+  {
+    this->Mapper->SetScalarVisibility(0);
+    return;
+  }
+
+  this->Mapper->SetScalarVisibility(1);
+  this->Mapper->SelectColorArray(arrayName);
+  if (info->Get(vtkDataObject::FIELD_ASSOCIATION()) == vtkDataObject::FIELD_ASSOCIATION_CELLS)
+  {
+    this->Mapper->SetScalarModeToUseCellFieldData();
+  }
+  else
+  {
+    this->Mapper->SetScalarModeToUsePointFieldData();
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarPointCloudRepresentation::AddToView(vtkView* view)
+{
+  vtkPVRenderView* renderView = vtkPVRenderView::SafeDownCast(view);
+  if (renderView)
+  {
+    renderView->GetRenderer()->AddActor(this->Actor);
+    return this->Superclass::AddToView(view);
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarPointCloudRepresentation::RemoveFromView(vtkView* view)
+{
+  vtkPVRenderView* renderView = vtkPVRenderView::SafeDownCast(view);
+  if (renderView)
+  {
+    renderView->GetRenderer()->RemoveActor(this->Actor);
+    return this->Superclass::RemoveFromView(view);
+  }
+  return false;
+}
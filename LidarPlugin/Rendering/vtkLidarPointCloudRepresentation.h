@@ -0,0 +1,85 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VTK_LIDAR_POINT_CLOUD_REPRESENTATION_H
+#define VTK_LIDAR_POINT_CLOUD_REPRESENTATION_H
+
+#include <vtkPVDataRepresentation.h>
+#include <vtkSmartPointer.h>
+
+class vtkActor;
+class vtkLidarPointCloudMapper;
+class vtkPolyData;
+class vtkScalarsToColors;
+
+/**
+ * @brief The vtkLidarPointCloudRepresentation renders the points of a point cloud with
+ * a vtkLidarPointCloudMapper, which maps the colored array to colors on the GPU.
+ *
+ * It is added to the representations of the geometry as "Point Cloud", and shares
+ * the coloring properties of the surface representation, so that switching to it
+ * keeps the array, the lookup table, the point size and the opacity.
+ */
+class VTK_EXPORT vtkLidarPointCloudRepresentation : public vtkPVDataRepresentation
+{
+public:
+  static vtkLidarPointCloudRepresentation* New();
+  vtkTypeMacro(vtkLidarPointCloudRepresentation, vtkPVDataRepresentation)
+
+  int ProcessViewRequest(vtkInformationRequestKey* request_type,
+                         vtkInformation* inInfo,
+                         vtkInformation* outInfo) override;
+
+  void SetVisibility(bool value) override;
+
+  //@{
+  /**
+   * Coloring and display properties, forwarded to the mapper and the actor
+   */
+  void SetLookupTable(vtkScalarsToColors* lut);
+  void SetMapScalars(int value);
+  void SetPointSize(double value);
+  void SetOpacity(double value);
+  void SetDiffuseColor(double red, double green, double blue);
+  void SetRoundPoints(bool value);
+  //@}
+
+protected:
+  vtkLidarPointCloudRepresentation();
+  ~vtkLidarPointCloudRepresentation();
+
+  int FillInputPortInformation(int port, vtkInformation* info) override;
+  int RequestData(vtkInformation* request,
+                  vtkInformationVector** inputVector,
+                  vtkInformationVector* outputVector) override;
+
+  bool AddToView(vtkView* view) override;
+  bool RemoveFromView(vtkView* view) override;
+
+private:
+  //! Select the colored array of the mapper from the array to process
+  void UpdateColoringParameters();
+
+  //! Shallow copy of the input, delivered to the view
+  vtkSmartPointer<vtkPolyData> Cache;
+  double DataBounds[6];
+
+  vtkSmartPointer<vtkLidarPointCloudMapper> Mapper;
+  vtkSmartPointer<vtkActor> Actor;
+
+  vtkLidarPointCloudRepresentation(const vtkLidarPointCloudRepresentation&) /*= delete*/;
+  void operator =(const vtkLidarPointCloudRepresentation&) /*= delete*/;
+};
+
+#endif // VTK_LIDAR_POINT_CLOUD_REPRESENTATION_H
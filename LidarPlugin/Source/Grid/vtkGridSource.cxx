@@ -37,8 +37,13 @@
 #include "vtkNew.h"
 #include "vtkObjectFactory.h"
 #include "vtkPlaneSource.h"
+#include "vtkPoints.h"
 #include "vtkPolyData.h"
 #include "vtkSmartPointer.h"
+#include "vtkTransform.h"
+
+#include <algorithm>
+#include <cmath>
 
 //-----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkGridSource)
@@ -63,6 +68,9 @@ vtkGridSource::vtkGridSource()
   this->Color[1] = 0.2;
   this->Color[2] = 0.2;
 
+  this->ReferenceGridNbTicks = 0;
+  this->ReferenceScale = 0.0;
+
   this->SetNumberOfInputPorts(0);
   this->SetNumberOfOutputPorts(1);
 }
@@ -113,6 +121,33 @@ vtkSmartPointer<vtkPolyData> vtkGridSource::CreateGrid(
   return polyData;
 }
 
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkTransform> vtkGridSource::CreateGridTransform(double origin[3], double normal[3])
+{
+  vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
+  transform->PostMultiply();
+
+  // same rotation as vtkPlaneSource::SetNormal, around the axis orthogonal to both normals
+  double n[3] = { normal[0], normal[1], normal[2] };
+  if (vtkMath::Normalize(n) > 0.0)
+  {
+    const double zAxis[3] = { 0.0, 0.0, 1.0 };
+    double axis[3];
+    vtkMath::Cross(zAxis, n, axis);
+    const double angle = vtkMath::DegreesFromRadians(std::acos(std::max(-1.0, std::min(1.0, n[2]))));
+    if (vtkMath::Normalize(axis) > 1e-12)
+    {
+      transform->RotateWXYZ(angle, axis);
+    }
+    else if (n[2] < 0.0)
+    {
+      transform->RotateX(180.0);
+    }
+  }
+  transform->Translate(origin);
+  return transform;
+}
+
 //-----------------------------------------------------------------------------
 int vtkGridSource::RequestData(vtkInformation* vtkNotUsed(request),
                                           vtkInformationVector** vtkNotUsed(inputVector),
@@ -128,7 +163,23 @@ int vtkGridSource::RequestData(vtkInformation* vtkNotUsed(request),
     return 0;
   }
 
-  output->ShallowCopy(this->CreateGrid(this->GridNbTicks, this->Scale, this->Origin, this->Normal));
+  // the lines and circles only depend on the number of ticks and their spacing, the
+  // origin and normal changed while the grid is dragged only move the points
+  if (!this->ReferenceGrid || this->ReferenceGridNbTicks != this->GridNbTicks
+    || this->ReferenceScale != this->Scale)
+  {
+    double origin[3] = { 0.0, 0.0, 0.0 };
+    double normal[3] = { 0.0, 0.0, 1.0 };
+    this->ReferenceGrid = this->CreateGrid(this->GridNbTicks, this->Scale, origin, normal);
+    this->ReferenceGridNbTicks = this->GridNbTicks;
+    this->ReferenceScale = this->Scale;
+  }
+
+  vtkNew<vtkPoints> points;
+  this->CreateGridTransform(this->Origin, this->Normal)
+    ->TransformPoints(this->ReferenceGrid->GetPoints(), points.GetPointer());
+  output->ShallowCopy(this->ReferenceGrid);
+  output->SetPoints(points.GetPointer());
   return 1;
 }
 
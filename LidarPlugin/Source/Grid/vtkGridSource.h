@@ -35,6 +35,8 @@
 #include <vtkPolyDataAlgorithm.h>
 #include <vtkSmartPointer.h>
 
+class vtkTransform;
+
 class VTK_EXPORT vtkGridSource : public vtkPolyDataAlgorithm
 {
 public:
@@ -66,6 +68,11 @@ public:
   static vtkSmartPointer<vtkPolyData> CreateGrid(
     int gridNbTicks, double scale, double origin[3], double normal[3]);
 
+  // Description:
+  // Rotation taking the z axis to normal, then translation to origin, which places
+  // the grid created around the origin with the z axis as normal
+  static vtkSmartPointer<vtkTransform> CreateGridTransform(double origin[3], double normal[3]);
+
 protected:
   vtkGridSource();
   ~vtkGridSource();
@@ -81,6 +88,12 @@ protected:
   double Normal[3];
   double Color[3];
 
+  // Grid around the origin with the z axis as normal, only created again when
+  // GridNbTicks or Scale change. Moving the grid only transforms its points.
+  vtkSmartPointer<vtkPolyData> ReferenceGrid;
+  int ReferenceGridNbTicks;
+  double ReferenceScale;
+
 private:
   vtkGridSource(const vtkGridSource&);
   void operator=(const vtkGridSource&);
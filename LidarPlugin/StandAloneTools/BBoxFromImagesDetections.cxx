@@ -29,11 +29,18 @@
 #include "vtkEigenTools.h"
 
 // STD
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <stdexcept>
 
 // BOOST
 #include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
 
 // YAML
 #include <yaml-cpp/yaml.h>
@@ -65,23 +72,47 @@ public:
 };
 
 //------------------------------------------------------------------------------
-size_t GetNumberOfClouds(std::string cloudFrameSeries)
+// Inputs of a camera, loaded once and shared by the worker threads
+struct CameraInputs
 {
-  YAML::Node series = YAML::LoadFile(cloudFrameSeries);
-  return series["files"].size();
-}
+  std::string imageFolder;
+  std::string pspnetFolder;
+  std::string yoloFolder;
+  //! parameters of the camera model
+  Eigen::VectorXd W;
+  //! time of each image of the folder
+  std::vector<double> imageTimes;
+};
+
+//------------------------------------------------------------------------------
+// Buffers of a worker thread, reused from one lidar frame to the next
+struct ProjectionBuffers
+{
+  //! each thread interpolates the trajectory with its own interpolator
+  vtkSmartPointer<vtkCustomTransformInterpolator> interpolator;
+  vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkSmartPointer<vtkPolyData> transformedCloud = vtkSmartPointer<vtkPolyData>::New();
+  std::vector<std::vector<Eigen::VectorXd>> pointsInBB;
+};
 
-void ReadFromSeries(std::string fileSeries, size_t index, std::string& path, double& time)
+// the worker threads share the standard output
+std::mutex OutputMutex;
+
+//------------------------------------------------------------------------------
+void ReadSeries(std::string fileSeries, std::vector<std::string>& paths, std::vector<double>& times)
 {
   YAML::Node series = YAML::LoadFile(fileSeries);
   YAML::Node files = series["files"];
 
   // compute absolute file paths from the relative one present in the .series
   boost::filesystem::path dirname = boost::filesystem::path(fileSeries).parent_path();
-  boost::filesystem::path basename = boost::filesystem::path(files[index]["name"].as<std::string>());
-  path = (dirname / basename).string();
-
-  time = files[index]["time"].as<double>();
+  for (size_t index = 0; index < files.size(); ++index)
+  {
+    boost::filesystem::path basename = boost::filesystem::path(files[index]["name"].as<std::string>());
+    paths.push_back((dirname / basename).string());
+    times.push_back(files[index]["time"].as<double>());
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -96,13 +127,11 @@ vtkSmartPointer<vtkPolyData> ReadCloudFrame(std::string pathToVTP)
 }
 
 //------------------------------------------------------------------------------
-std::pair<Eigen::Matrix3d, Eigen::Vector3d> GetRTFromTime(vtkSmartPointer<vtkCustomTransformInterpolator> interpolator,
-                                                          double time)
+std::pair<Eigen::Matrix3d, Eigen::Vector3d> GetRTFromTime(ProjectionBuffers& buffers, double time)
 {
-  vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
-  interpolator->InterpolateTransform(time, transform);
-  vtkSmartPointer<vtkMatrix4x4> M0 = vtkSmartPointer<vtkMatrix4x4>::New();
-  transform->GetMatrix(M0);
+  buffers.interpolator->InterpolateTransform(time, buffers.transform);
+  vtkMatrix4x4* M0 = buffers.matrix;
+  buffers.transform->GetMatrix(M0);
   Eigen::Matrix3d R0;
   Eigen::Vector3d T0;
   for (int i = 0; i < 3; ++i)
@@ -119,15 +148,15 @@ std::pair<Eigen::Matrix3d, Eigen::Vector3d> GetRTFromTime(vtkSmartPointer<vtkCus
 
 //------------------------------------------------------------------------------
 vtkSmartPointer<vtkPolyData> ReferenceFrameChange(vtkSmartPointer<vtkPolyData> cloud,
-                                                  vtkSmartPointer<vtkCustomTransformInterpolator> interpolator,
+                                                  ProjectionBuffers& buffers,
                                                   double time)
 {
-  vtkSmartPointer<vtkPolyData> transformedCloud = vtkSmartPointer<vtkPolyData>::New();
+  vtkSmartPointer<vtkPolyData> transformedCloud = buffers.transformedCloud;
   transformedCloud->DeepCopy(cloud);
   vtkSmartPointer<vtkDataArray> timeArray = transformedCloud->GetPointData()->GetArray("adjustedtime");
 
   // Get the target reference frame pose
-  std::pair<Eigen::Matrix3d, Eigen::Vector3d> H0 = GetRTFromTime(interpolator, time);
+  std::pair<Eigen::Matrix3d, Eigen::Vector3d> H0 = GetRTFromTime(buffers, time);
 
   // transforms the points
   for (int pointIdx = 0; pointIdx < transformedCloud->GetNumberOfPoints(); ++pointIdx)
@@ -139,7 +168,7 @@ vtkSmartPointer<vtkPolyData> ReferenceFrameChange(vtkSmartPointer<vtkPolyData> c
     Eigen::Vector3d X(pt[0], pt[1], pt[2]);
 
     // Get the transformed associated to the current time
-    std::pair<Eigen::Matrix3d, Eigen::Vector3d> H1 = GetRTFromTime(interpolator, ptTime);
+    std::pair<Eigen::Matrix3d, Eigen::Vector3d> H1 = GetRTFromTime(buffers, ptTime);
 
     // Reference frame changing
     Eigen::Vector3d Y = H0.first.transpose() * (H1.first * X + H1.second - H0.second);
@@ -256,11 +285,22 @@ std::vector<SemanticCentroid> DetectAndComputeCentroid(vtkSmartPointer<vtkPolyDa
                                                        vtkSmartPointer<vtkImageData> pspMsk,
                                                        vtkSmartPointer<vtkImageData> img,
                                                        vtkSmartPointer<vtkMultiBlockDataSet> bbs,
-                                                       Eigen::VectorXd W)
+                                                       const Eigen::VectorXd& W,
+                                                       ProjectionBuffers& buffers)
 {
   // Convert the polydata to 2D boundingbox structure
   std::vector<OrientedBoundingBox<2>> bbList = Create2DBBFromPolyData(bbs);
-  std::vector<std::vector<Eigen::VectorXd>> pointsInBB(bbList.size());
+
+  // the point lists of the previous frame keep their memory
+  std::vector<std::vector<Eigen::VectorXd>>& pointsInBB = buffers.pointsInBB;
+  if (pointsInBB.size() < bbList.size())
+  {
+    pointsInBB.resize(bbList.size());
+  }
+  for (size_t bbIdx = 0; bbIdx < bbList.size(); ++bbIdx)
+  {
+    pointsInBB[bbIdx].clear();
+  }
 
   // Discard a potential bounding box if there is no
   // consistency between psp-net and yolo
@@ -291,8 +331,8 @@ std::vector<SemanticCentroid> DetectAndComputeCentroid(vtkSmartPointer<vtkPolyDa
     // loop over the bounding box
     for (unsigned int bbIdx = 0; bbIdx < bbList.size(); ++bbIdx)
     {
-      OrientedBoundingBox<2> bb = bbList[bbIdx];
-      std::string type = bb.Type;
+      const OrientedBoundingBox<2>& bb = bbList[bbIdx];
+      const std::string& type = bb.Type;
 
       // reject over kind of object
       if (type == "car" || type == "truck" || type == "person" ||
@@ -320,7 +360,7 @@ std::vector<SemanticCentroid> DetectAndComputeCentroid(vtkSmartPointer<vtkPolyDa
 
   // compute the centroid
   std::vector<SemanticCentroid> positions;
-  for (unsigned int objectIdx = 0; objectIdx < pointsInBB.size(); ++objectIdx)
+  for (unsigned int objectIdx = 0; objectIdx < bbList.size(); ++objectIdx)
   {
     if (pointsInBB[objectIdx].size() > 0)
     {
@@ -332,6 +372,7 @@ std::vector<SemanticCentroid> DetectAndComputeCentroid(vtkSmartPointer<vtkPolyDa
       centroid.center = MultivariateMedian(closestPoints, 1e-6);
       centroid.type = bbList[objectIdx].Type;
       positions.push_back(centroid);
+      std::lock_guard<std::mutex> lock(OutputMutex);
       std::cout << "Centroid of " << centroid.type << " is: " << centroid.center.transpose() << std::endl;
     }
   }
@@ -339,41 +380,58 @@ std::vector<SemanticCentroid> DetectAndComputeCentroid(vtkSmartPointer<vtkPolyDa
   return positions;
 }
 
+//------------------------------------------------------------------------------
+CameraInputs LoadCameraInputs(std::string imageFolder, std::string pspnetFolder,
+                              std::string yoloFolder, std::string calibFilename)
+{
+  CameraInputs camera;
+  camera.imageFolder = imageFolder;
+  camera.pspnetFolder = pspnetFolder;
+  camera.yoloFolder = yoloFolder;
+
+  // Load the calibration
+  CameraModel Model;
+  Model.LoadParamsFromFile(calibFilename);
+  camera.W = Model.GetParametersVector();
+
+  // Get the time of the images
+  std::string filename = imageFolder + "/image.jpg.series";
+  YAML::Node imageInfo = YAML::LoadFile(filename);
+  for (unsigned int imgIndex = 0; imgIndex < imageInfo["files"].size(); ++imgIndex)
+  {
+    camera.imageTimes.push_back(imageInfo["files"][imgIndex]["time"].as<double>());
+  }
+
+  return camera;
+}
+
 //------------------------------------------------------------------------------
 std::vector<SemanticCentroid> LaunchDetectionBackProjection(vtkSmartPointer<vtkPolyData> cloud,
-                                vtkSmartPointer<vtkCustomTransformInterpolator> interpolator,
-                                double timeshift, std::string imageFolder,
-                                std::string pspnetFolder, std::string yoloFolder,
-                                std::string calibFilename)
+                                ProjectionBuffers& buffers,
+                                double timeshift, const CameraInputs& camera)
 {
   // Get the time of the cloud
   // Define the time of the cloud as being the middle time
   vtkDataArray* timeArray = cloud->GetPointData()->GetArray("adjustedtime");
   double time = 1e-6 * static_cast<double>((timeArray->GetTuple1(0) + timeArray->GetTuple1(cloud->GetNumberOfPoints() - 1))) / 2.0 - timeshift;
 
-  // Get the name of the temporally closest image
-  std::string filename = imageFolder + "/image.jpg.series";
-  YAML::Node imageInfo = YAML::LoadFile(filename);
-
+  // Get the temporally closest image
   double maxTemporalDist = std::numeric_limits<double>::max();
   double closestImgTime = 0;
   int closestImgIndex = -1;
-  std::string closestImgName;
-  for (unsigned int imgIndex = 0; imgIndex < imageInfo["files"].size(); ++imgIndex)
+  for (unsigned int imgIndex = 0; imgIndex < camera.imageTimes.size(); ++imgIndex)
   {
-    double imgTime = imageInfo["files"][imgIndex]["time"].as<double>();
+    double imgTime = camera.imageTimes[imgIndex];
     if (std::abs(imgTime - time) < maxTemporalDist)
     {
       maxTemporalDist = std::abs(imgTime - time);
       closestImgTime = imgTime;
       closestImgIndex = static_cast<int>(imgIndex);
-      closestImgName = imageInfo["files"][imgIndex]["name"].as<std::string>();
     }
   }
 
   if (maxTemporalDist > 1.0) {
-      std::cout << "image closest to lidar frame is too far in time. Are exports complete ? You could try running on less lidar frames" << std::endl;
-      exit(1);
+      throw std::runtime_error("image closest to lidar frame is too far in time. Are exports complete ? You could try running on less lidar frames");
   }
 
   // Express the closest image time in the lidar time clock system
@@ -381,29 +439,25 @@ std::vector<SemanticCentroid> LaunchDetectionBackProjection(vtkSmartPointer<vtkP
 
   // Now, express the pointcloud in the vehicle reference frame corresponding
   // to the camera timestamp
-  vtkSmartPointer<vtkPolyData> transformedCloud = ReferenceFrameChange(cloud, interpolator, closestImgTime);
-
-  // Load the calibration
-  CameraModel Model;
-  Model.LoadParamsFromFile(calibFilename);
+  vtkSmartPointer<vtkPolyData> transformedCloud = ReferenceFrameChange(cloud, buffers, closestImgTime);
 
   // load the image
   std::stringstream ss; ss << std::setw(4) << std::setfill('0') << closestImgIndex;
-  std::string imgFilename = imageFolder + "/" + ss.str() + ".jpg";
+  std::string imgFilename = camera.imageFolder + "/" + ss.str() + ".jpg";
   vtkSmartPointer<vtkJPEGReader> imgReader0 = vtkSmartPointer<vtkJPEGReader>::New();
   imgReader0->SetFileName(imgFilename.c_str());
   imgReader0->Update();
   vtkSmartPointer<vtkImageData> img = imgReader0->GetOutput();
 
   // load corresponding pspnet
-  std::string pspNetMaskFilename = pspnetFolder + "/" + ss.str() + ".png";
+  std::string pspNetMaskFilename = camera.pspnetFolder + "/" + ss.str() + ".png";
   vtkSmartPointer<vtkPNGReader> imgReader = vtkSmartPointer<vtkPNGReader>::New();
   imgReader->SetFileName(pspNetMaskFilename.c_str());
   imgReader->Update();
   vtkSmartPointer<vtkImageData> pspMask = imgReader->GetOutput();
 
   // load yolo
-  std::string yoloBBFilename = yoloFolder + "/" + ss.str() + ".yml";
+  std::string yoloBBFilename = camera.yoloFolder + "/" + ss.str() + ".yml";
   vtkSmartPointer<vtkBoundingBoxReader> bbReader = vtkSmartPointer<vtkBoundingBoxReader>::New();
   bbReader->SetFileName(yoloBBFilename);
   bbReader->SetImageHeight(img->GetDimensions()[1]);
@@ -411,8 +465,7 @@ std::vector<SemanticCentroid> LaunchDetectionBackProjection(vtkSmartPointer<vtkP
   vtkSmartPointer<vtkMultiBlockDataSet> bbs = bbReader->GetOutput();
 
   // Launch 3D median center computation
-  Eigen::VectorXd W = Model.GetParametersVector();
-  std::vector<SemanticCentroid> results = DetectAndComputeCentroid(transformedCloud, pspMask, img, bbs, W);
+  std::vector<SemanticCentroid> results = DetectAndComputeCentroid(transformedCloud, pspMask, img, bbs, camera.W, buffers);
 
   return results;
 }
@@ -483,6 +536,8 @@ void Export3DBBAsYaml(std::vector<std::vector<SemanticCentroid>> objects,
 //------------------------------------------------------------------------------
 // negative numbers (python like indexes) are accepted for {first,last}LidarFrameToProcess
 // so to run on all frames pass respectively 0 and -1
+// an optional last input gives the number of threads processing the lidar frames,
+// 0 (the default) to use all the cores and 1 to process them sequentially
 int main(int argc, char* argv[])
 {
   // Check if there is the minimal number of inputs
@@ -503,7 +558,8 @@ int main(int argc, char* argv[])
 
   // Check if there is the expected number of inputs
   unsigned int expectedNbrInput = 8 + nbrCameras * 4;
-  if (static_cast<unsigned int>(argc) != expectedNbrInput)
+  if (static_cast<unsigned int>(argc) != expectedNbrInput &&
+      static_cast<unsigned int>(argc) != expectedNbrInput + 1)
   {
     std::cout << "Unexpected nbr of inputs" << std::endl;
     std::cout << "Got: " << argc << " inputs" << std::endl;
@@ -512,16 +568,13 @@ int main(int argc, char* argv[])
   }
 
   // Get the folder of the images and detections
-  std::vector<std::string> imageFolders(0);
-  std::vector<std::string> pspnetFolders(0);
-  std::vector<std::string> yoloFolders(0);
-  std::vector<std::string> calibFilenames(0);
+  std::vector<CameraInputs> cameras(0);
   for (unsigned int cameraIndex = 0; cameraIndex < nbrCameras; ++cameraIndex)
   {
-    imageFolders.push_back(std::string(argv[8 + cameraIndex]));
-    pspnetFolders.push_back(std::string(argv[8 + nbrCameras + cameraIndex]));
-    yoloFolders.push_back(std::string(argv[8 + 2 * nbrCameras + cameraIndex]));
-    calibFilenames.push_back(std::string(argv[8 + 3 * nbrCameras + cameraIndex]));
+    cameras.push_back(LoadCameraInputs(std::string(argv[8 + cameraIndex]),
+                                       std::string(argv[8 + nbrCameras + cameraIndex]),
+                                       std::string(argv[8 + 2 * nbrCameras + cameraIndex]),
+                                       std::string(argv[8 + 3 * nbrCameras + cameraIndex])));
 
     std::cout << cameraIndex << std::endl;
     std::cout << std::string(argv[8 + cameraIndex]) << std::endl;
@@ -540,10 +593,11 @@ int main(int argc, char* argv[])
   reader->Update();
   vtkSmartPointer<vtkPolyData> polyTraj = reader->GetOutput();
   vtkSmartPointer<vtkTemporalTransforms> trajectory = vtkTemporalTransforms::CreateFromPolyData(polyTraj);
-  vtkSmartPointer<vtkCustomTransformInterpolator> interpolator = trajectory->CreateInterpolator();
-  interpolator->SetInterpolationTypeToLinear();
 
-  size_t nbrClouds = GetNumberOfClouds(cloudFrameSeries);
+  std::vector<std::string> cloudPaths;
+  std::vector<double> cloudTimes;
+  ReadSeries(cloudFrameSeries, cloudPaths, cloudTimes);
+  size_t nbrClouds = cloudPaths.size();
 
   // allow negative (python like) indexes
   if (firstLidarFrameToProcess < 0) {
@@ -552,41 +606,94 @@ int main(int argc, char* argv[])
   if (lastLidarFrameToProcess < 0) {
       lastLidarFrameToProcess += nbrClouds;
   }
+  const size_t firstCloud = static_cast<size_t>(firstLidarFrameToProcess);
+  const size_t lastCloud = static_cast<size_t>(lastLidarFrameToProcess);
+  if (firstLidarFrameToProcess < 0 || lastCloud >= nbrClouds || firstCloud > lastCloud)
+  {
+    std::cout << "Invalid range of lidar frames" << std::endl;
+    return EXIT_FAILURE;
+  }
 
-  Json::Value outputSeries;
-  Json::Value files(Json::arrayValue);
+  // Set up the buffers of each thread
+  unsigned int nbrThreads = argc > static_cast<int>(expectedNbrInput) ? std::atoi(argv[expectedNbrInput]) : 0;
+  if (nbrThreads == 0)
+  {
+    nbrThreads = std::max(1u, boost::thread::hardware_concurrency());
+  }
+  nbrThreads = std::min(nbrThreads, static_cast<unsigned int>(lastCloud - firstCloud + 1));
+  std::vector<ProjectionBuffers> buffers(nbrThreads);
+  for (ProjectionBuffers& threadBuffers : buffers)
+  {
+    threadBuffers.interpolator = trajectory->CreateInterpolator();
+    threadBuffers.interpolator->SetInterpolationTypeToLinear();
+  }
 
-  // For each lidar frame, launch the detection and tracking process
-  for (size_t cloudIndex = static_cast<size_t>(firstLidarFrameToProcess); cloudIndex < static_cast<size_t>(lastLidarFrameToProcess + 1); ++cloudIndex)
+  // For each lidar frame, launch the detection and tracking process. The frames
+  // are independent, so each thread processes the next frame that is left
+  std::vector<std::string> yamlOutputs(lastCloud - firstCloud + 1);
+  std::atomic<size_t> nextCloud(firstCloud);
+  std::atomic<bool> failed(false);
+  auto work = [&](ProjectionBuffers& threadBuffers)
   {
-    // read cloud
-    std::string vtpPath = "";
-    double vtpPipelineTime = 0.0; // network time, not used for projection (points have their own lidar time)
-    ReadFromSeries(cloudFrameSeries, cloudIndex, vtpPath, vtpPipelineTime);
-    vtkSmartPointer<vtkPolyData> cloud = ReadCloudFrame(vtpPath);
+    for (size_t cloudIndex = nextCloud++; cloudIndex <= lastCloud && !failed; cloudIndex = nextCloud++)
+    {
+      try
+      {
+        // read cloud
+        const std::string& vtpPath = cloudPaths[cloudIndex];
+        vtkSmartPointer<vtkPolyData> cloud = ReadCloudFrame(vtpPath);
 
-    // object detected
-    std::vector<std::vector<SemanticCentroid>> objects;
+        // object detected
+        std::vector<std::vector<SemanticCentroid>> objects;
 
-    // for each image, launch detection back projection
-    for (unsigned int cameraIndex = 0; cameraIndex < imageFolders.size(); ++cameraIndex)
-    {
-      std::vector<SemanticCentroid> currentCamObjects = LaunchDetectionBackProjection(cloud, interpolator, timeshift,
-                                                                                      imageFolders[cameraIndex],
-                                                                                      pspnetFolders[cameraIndex],
-                                                                                      yoloFolders[cameraIndex],
-                                                                                      calibFilenames[cameraIndex]);
-      std::cout << "Added: " << currentCamObjects.size() << " objects for camera: " << cameraIndex << std::endl;
-      objects.push_back(currentCamObjects);
+        // for each image, launch detection back projection
+        for (unsigned int cameraIndex = 0; cameraIndex < cameras.size(); ++cameraIndex)
+        {
+          std::vector<SemanticCentroid> currentCamObjects = LaunchDetectionBackProjection(cloud, threadBuffers, timeshift,
+                                                                                          cameras[cameraIndex]);
+          {
+            std::lock_guard<std::mutex> lock(OutputMutex);
+            std::cout << "Added: " << currentCamObjects.size() << " objects for camera: " << cameraIndex << std::endl;
+          }
+          objects.push_back(currentCamObjects);
+        }
+
+        // Export as yaml
+        std::string yamlOutput = (boost::filesystem::path(export3DBBFolder) / boost::filesystem::path(vtpPath).stem()).string() + ".yml";
+        Export3DBBAsYaml(objects, yamlOutput);
+        yamlOutputs[cloudIndex - firstCloud] = yamlOutput;
+      }
+      catch (std::exception& e)
+      {
+        std::lock_guard<std::mutex> lock(OutputMutex);
+        std::cout << e.what() << std::endl;
+        failed = true;
+      }
     }
+  };
+  std::vector<std::unique_ptr<boost::thread> > threads;
+  for (unsigned int i = 1; i < nbrThreads; ++i)
+  {
+    threads.emplace_back(new boost::thread(work, std::ref(buffers[i])));
+  }
+  work(buffers[0]);
+  for (auto& thread : threads)
+  {
+    thread->join();
+  }
+  if (failed)
+  {
+    return EXIT_FAILURE;
+  }
 
-    // Export as yaml
-    std::string yamlOutput = (boost::filesystem::path(export3DBBFolder) / boost::filesystem::path(vtpPath).stem()).string() + ".yml";
-    Export3DBBAsYaml(objects, yamlOutput);
-    //std::vector<std::string>["files"] = YAML::NodeType.
+  // the series lists the frames in order, whatever the thread which processed them
+  Json::Value outputSeries;
+  Json::Value files(Json::arrayValue);
+  for (size_t cloudIndex = firstCloud; cloudIndex <= lastCloud; ++cloudIndex)
+  {
     Json::Value node;
-    node["name"] = boost::filesystem::path(yamlOutput).filename().string();
-    node["time"] = vtpPipelineTime;
+    node["name"] = boost::filesystem::path(yamlOutputs[cloudIndex - firstCloud]).filename().string();
+    node["time"] = cloudTimes[cloudIndex]; // network time, not used for projection (points have their own lidar time)
     files.append(node);
   }
 
@@ -0,0 +1,123 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+// .NAME BatchBirdEyeView -
+// .SECTION Description
+// This program writes the bird eye view of each frame of a pcap file without
+// the VTK pipeline. The frames are decoded in parallel, and their views are
+// rasterized and written by a pool of threads, see
+// vtkBirdEyeViewSnap::ExportFrames.
+
+#include "vtkBirdEyeViewSnap.h"
+#include "vtkLidarReader.h"
+#include "vtkVelodynePacketInterpreter.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include <vtkSmartPointer.h>
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  // parse the command line options
+  po::options_description visible("Allowed options");
+  visible.add_options()
+      ("help", "produce help message")
+      ("calibration", po::value<std::string>(), "calibration file of the sensor")
+      ("output", po::value<std::string>()->default_value("view.png"), "name of the views, followed by the frame count and a png, jpg or tif extension")
+      ("resolution", po::value<double>()->default_value(0.2), "size of a pixel in meters")
+      ("first-frame", po::value<int>()->default_value(0), "first frame to process")
+      ("last-frame", po::value<int>()->default_value(-1), "last frame to process, -1 for the last frame of the file")
+      ("decode-threads", po::value<int>()->default_value(0), "number of threads decoding the frames, 0 to use all the cores")
+      ("write-threads", po::value<int>()->default_value(0), "number of threads rasterizing and writing the views, 0 to use all the cores")
+      ;
+
+  po::options_description hidden("Hidden options");
+  hidden.add_options()
+      ("input-file", po::value<std::string>(), "input file")
+      ;
+
+  po::positional_options_description p;
+  p.add("input-file", -1);
+
+  po::options_description cmdline_options;
+  cmdline_options.add(visible).add(hidden);
+
+  po::variables_map vm;
+  try
+  {
+    po::store(po::command_line_parser(argc, argv).
+              options(cmdline_options).positional(p).run(), vm);
+    po::notify(vm);
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  if (vm.count("help") || !vm.count("input-file") || !vm.count("calibration")) {
+      std::cout << "Usage: BatchBirdEyeView <pcap_file> --calibration <calibration_file> [options]\n";
+      std::cout << visible << "\n";
+      return 1;
+  }
+
+  const std::string filename = vm["input-file"].as<std::string>();
+
+  // open the pcap and build its frame catalog
+  auto reader = vtkSmartPointer<vtkLidarReader>::New();
+  reader->SetInterpreter(vtkSmartPointer<vtkVelodynePacketInterpreter>::New());
+  reader->SetFileName(filename);
+  reader->SetCalibrationFileName(vm["calibration"].as<std::string>());
+  reader->Update();
+  if (reader->GetNumberOfFrames() == 0)
+  {
+    std::cerr << "No frame could be read from " << filename << std::endl;
+    return 1;
+  }
+
+  const int firstFrame = vm["first-frame"].as<int>();
+  int lastFrame = vm["last-frame"].as<int>();
+  if (lastFrame < 0)
+  {
+    lastFrame = reader->GetNumberOfFrames() - 1;
+  }
+
+  auto snap = vtkSmartPointer<vtkBirdEyeViewSnap>::New();
+  snap->SetFolderName(vm["output"].as<std::string>());
+  snap->SetResolution(vm["resolution"].as<double>(), vm["resolution"].as<double>());
+  snap->SetCount(firstFrame);
+
+  auto start = std::chrono::steady_clock::now();
+  bool exported = snap->ExportFrames(reader, firstFrame, lastFrame,
+                                     vm["decode-threads"].as<int>(),
+                                     vm["write-threads"].as<int>());
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  std::cout << lastFrame - firstFrame + 1 << " frames exported in "
+            << elapsed.count() << " s" << std::endl;
+  if (!exported)
+  {
+    std::cerr << "The export of the views failed" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,392 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+// .NAME BatchPcapProcessing -
+// .SECTION Description
+// This program runs the exports listed in a job manifest over many pcap files
+// without the VTK pipeline. Each line of the manifest is a job:
+//
+//   <pcap file>;<calibration file>;<task>;<output file>[;<first frame>;<last frame>]
+//
+// where the task is "las" (or "laz"), "archive", "csv", "tensors" or "web", as saveLASFrames,
+// saveFrameArchive, saveCSVFrames, saveFrameTensors and saveWebFrames of the application, the
+// output of "web" being a directory. Empty lines and lines starting with '#' are ignored.
+//
+// The jobs are run by a pool of workers, each worker taking the next job as soon
+// as it is done with the previous one, the largest pcap files first so that a long
+// job does not end the batch alone. The calibrations are cached for the whole
+// process, see LoadVelodyneCalibration, and the frame catalog of each pcap is read
+// from, or saved to, its frame index cache.
+//
+// Several machines can share a manifest: each one runs the jobs whose number
+// modulo --node-count is its --node-index.
+//
+// A report gives the status and the timings of each job, as a csv file.
+
+#include "LASFileWriter.h"
+#include "vtkLidarReader.h"
+#include "vtkVelodynePacketInterpreter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include <vtkSmartPointer.h>
+
+namespace
+{
+struct Job
+{
+  //! Line of the job in the manifest, from 1
+  int Line = 0;
+  std::string PcapFile;
+  std::string CalibrationFile;
+  std::string Task;
+  std::string OutputFile;
+  int FirstFrame = 0;
+  int LastFrame = -1;
+  uintmax_t PcapSize = 0;
+
+  // filled by the worker running the job
+  bool Succeeded = false;
+  std::string Message;
+  int NumberOfFrames = 0;
+  double OpenDuration = 0.;
+  double ExportDuration = 0.;
+};
+
+//-----------------------------------------------------------------------------
+bool ReadManifest(const std::string& filename, std::vector<Job>& jobs)
+{
+  std::ifstream manifest(filename);
+  if (!manifest.is_open())
+  {
+    std::cerr << "Could not open the manifest " << filename << std::endl;
+    return false;
+  }
+
+  std::string line;
+  for (int lineNumber = 1; std::getline(manifest, line); ++lineNumber)
+  {
+    boost::algorithm::trim(line);
+    if (line.empty() || line[0] == '#')
+    {
+      continue;
+    }
+
+    std::vector<std::string> fields;
+    boost::algorithm::split(fields, line, boost::is_any_of(";"));
+    for (auto& field : fields)
+    {
+      boost::algorithm::trim(field);
+    }
+    if (fields.size() != 4 && fields.size() != 6)
+    {
+      std::cerr << filename << ":" << lineNumber << ": expected 4 or 6 fields separated by ';'"
+                << std::endl;
+      return false;
+    }
+
+    Job job;
+    job.Line = lineNumber;
+    job.PcapFile = fields[0];
+    job.CalibrationFile = fields[1];
+    job.Task = boost::algorithm::to_lower_copy(fields[2]);
+    job.OutputFile = fields[3];
+    if (job.Task != "las" && job.Task != "laz" && job.Task != "archive" && job.Task != "csv"
+        && job.Task != "tensors" && job.Task != "web")
+    {
+      std::cerr << filename << ":" << lineNumber << ": unknown task " << fields[2] << std::endl;
+      return false;
+    }
+    if (fields.size() == 6)
+    {
+      try
+      {
+        job.FirstFrame = std::stoi(fields[4]);
+        job.LastFrame = std::stoi(fields[5]);
+      }
+      catch (std::exception&)
+      {
+        std::cerr << filename << ":" << lineNumber << ": invalid frame range" << std::endl;
+        return false;
+      }
+    }
+    jobs.push_back(job);
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void RunJob(Job& job, int decodeThreads, int compressionLevel, double positionTolerance,
+            int tensorWidth)
+{
+  using Clock = std::chrono::steady_clock;
+  auto start = Clock::now();
+
+  auto reader = vtkSmartPointer<vtkLidarReader>::New();
+  reader->SetInterpreter(vtkSmartPointer<vtkVelodynePacketInterpreter>::New());
+  reader->SetFileName(job.PcapFile);
+  reader->SetCalibrationFileName(job.CalibrationFile);
+  reader->Update();
+  job.OpenDuration = std::chrono::duration<double>(Clock::now() - start).count();
+
+  if (reader->GetNumberOfFrames() == 0)
+  {
+    job.Message = "no frame could be read";
+    return;
+  }
+
+  const int firstFrame = std::max(job.FirstFrame, 0);
+  int lastFrame = job.LastFrame;
+  if (lastFrame < 0 || lastFrame >= reader->GetNumberOfFrames())
+  {
+    lastFrame = reader->GetNumberOfFrames() - 1;
+  }
+  if (firstFrame > lastFrame)
+  {
+    job.Message = "empty frame range";
+    return;
+  }
+  job.NumberOfFrames = lastFrame - firstFrame + 1;
+
+  start = Clock::now();
+  if (job.Task == "archive")
+  {
+    job.Succeeded =
+      reader->SaveFramesToArchive(firstFrame, lastFrame, job.OutputFile, compressionLevel,
+                                  positionTolerance);
+  }
+  else if (job.Task == "csv")
+  {
+    job.Succeeded =
+      reader->SaveFramesToCSV(firstFrame, lastFrame, job.OutputFile, compressionLevel);
+  }
+  else if (job.Task == "tensors")
+  {
+    job.Succeeded = reader->SaveFramesToTensors(firstFrame, lastFrame, job.OutputFile, tensorWidth);
+  }
+  else if (job.Task == "web")
+  {
+    job.Succeeded = reader->SaveFramesToWeb(firstFrame, lastFrame, job.OutputFile,
+                                            positionTolerance > 0. ? positionTolerance : 0.005);
+  }
+  else
+  {
+    // in the sensor referential, as saveLASFrames without a position provider
+    LASFileWriter writer;
+    writer.Open(job.OutputFile.c_str());
+    writer.SetPrecision(1e-3, 1e-3);
+    writer.SetGeoConversionUTM(0, false);
+    writer.SetOrigin(0., 0., 0.);
+    writer.SetCompressed(job.Task == "laz");
+
+    reader->Open();
+    job.Succeeded = reader->DecodeFrames(firstFrame, lastFrame,
+      [&writer](int, vtkPolyData* data)
+      {
+        writer.WriteFrame(data);
+        return true;
+      },
+      decodeThreads);
+    writer.Close();
+    reader->Close();
+  }
+  job.ExportDuration = std::chrono::duration<double>(Clock::now() - start).count();
+
+  if (!job.Succeeded)
+  {
+    job.Message = "the export failed";
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::string QuoteCSV(const std::string& value)
+{
+  return "\"" + boost::algorithm::replace_all_copy(value, "\"", "\"\"") + "\"";
+}
+
+//-----------------------------------------------------------------------------
+bool WriteReport(const std::string& filename, const std::vector<Job>& jobs)
+{
+  std::ofstream report(filename);
+  if (!report.is_open())
+  {
+    return false;
+  }
+  report << "line,pcap,task,output,status,frames,open_s,export_s,message\n";
+  for (const auto& job : jobs)
+  {
+    report << job.Line << ","
+           << QuoteCSV(job.PcapFile) << ","
+           << job.Task << ","
+           << QuoteCSV(job.OutputFile) << ","
+           << (job.Succeeded ? "ok" : "failed") << ","
+           << job.NumberOfFrames << ","
+           << job.OpenDuration << ","
+           << job.ExportDuration << ","
+           << QuoteCSV(job.Message) << "\n";
+  }
+  return report.good();
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  // parse the command line options
+  po::options_description visible("Allowed options");
+  visible.add_options()
+      ("help", "produce help message")
+      ("report", po::value<std::string>()->default_value("report.csv"), "csv file giving the status and timings of each job")
+      ("workers", po::value<int>()->default_value(0), "number of jobs run at the same time, 0 to use all the cores")
+      ("decode-threads", po::value<int>()->default_value(1), "number of threads decoding the frames of a las job, 0 to use all the cores")
+      ("compression-level", po::value<int>()->default_value(0), "compression of the archive and csv jobs, from 0 for none to 9")
+      ("position-tolerance", po::value<double>()->default_value(0.), "maximal error in meters on the points of the archive jobs, 0 to store them exactly, and of the web jobs, 0 for 5 mm")
+      ("tensor-width", po::value<int>()->default_value(1024), "number of azimuth bins of the images of the tensors jobs")
+      ("node-index", po::value<int>()->default_value(0), "index of this machine among the ones sharing the manifest")
+      ("node-count", po::value<int>()->default_value(1), "number of machines sharing the manifest")
+      ;
+
+  po::options_description hidden("Hidden options");
+  hidden.add_options()
+      ("manifest", po::value<std::string>(), "job manifest")
+      ;
+
+  po::positional_options_description p;
+  p.add("manifest", -1);
+
+  po::options_description cmdline_options;
+  cmdline_options.add(visible).add(hidden);
+
+  po::variables_map vm;
+  try
+  {
+    po::store(po::command_line_parser(argc, argv).
+              options(cmdline_options).positional(p).run(), vm);
+    po::notify(vm);
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  if (vm.count("help") || !vm.count("manifest")) {
+      std::cout << "Usage: BatchPcapProcessing <manifest_file> [options]\n";
+      std::cout << visible << "\n";
+      return 1;
+  }
+
+  const int nodeIndex = vm["node-index"].as<int>();
+  const int nodeCount = vm["node-count"].as<int>();
+  if (nodeCount < 1 || nodeIndex < 0 || nodeIndex >= nodeCount)
+  {
+    std::cerr << "The node index must be in [0, node-count[" << std::endl;
+    return 1;
+  }
+
+  std::vector<Job> manifestJobs;
+  if (!ReadManifest(vm["manifest"].as<std::string>(), manifestJobs))
+  {
+    return 1;
+  }
+
+  // keep the jobs of this node, the largest pcap files first
+  std::vector<Job> jobs;
+  for (size_t i = 0; i < manifestJobs.size(); ++i)
+  {
+    if (static_cast<int>(i % nodeCount) == nodeIndex)
+    {
+      boost::system::error_code error;
+      manifestJobs[i].PcapSize = boost::filesystem::file_size(manifestJobs[i].PcapFile, error);
+      jobs.push_back(manifestJobs[i]);
+    }
+  }
+  std::vector<size_t> order(jobs.size());
+  for (size_t i = 0; i < order.size(); ++i)
+  {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(),
+    [&jobs](size_t a, size_t b) { return jobs[a].PcapSize > jobs[b].PcapSize; });
+
+  int numberOfWorkers = vm["workers"].as<int>();
+  if (numberOfWorkers <= 0)
+  {
+    numberOfWorkers = std::max(1u, std::thread::hardware_concurrency());
+  }
+  numberOfWorkers = std::min<int>(numberOfWorkers, std::max<size_t>(jobs.size(), 1));
+  const int decodeThreads = vm["decode-threads"].as<int>();
+  const int compressionLevel = vm["compression-level"].as<int>();
+  const double positionTolerance = vm["position-tolerance"].as<double>();
+  const int tensorWidth = vm["tensor-width"].as<int>();
+
+  std::atomic<size_t> nextJob(0);
+  std::mutex outputMutex;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int w = 0; w < numberOfWorkers; ++w)
+  {
+    workers.emplace_back([&]()
+    {
+      for (size_t i = nextJob++; i < order.size(); i = nextJob++)
+      {
+        Job& job = jobs[order[i]];
+        RunJob(job, decodeThreads, compressionLevel, positionTolerance, tensorWidth);
+
+        std::lock_guard<std::mutex> lock(outputMutex);
+        std::cout << (job.Succeeded ? "[ok] " : "[failed] ") << job.PcapFile << " -> "
+                  << job.OutputFile << " (" << job.NumberOfFrames << " frames, "
+                  << job.OpenDuration + job.ExportDuration << " s)";
+        if (!job.Message.empty())
+        {
+          std::cout << ": " << job.Message;
+        }
+        std::cout << std::endl;
+      }
+    });
+  }
+  for (auto& worker : workers)
+  {
+    worker.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  const auto failed = std::count_if(jobs.begin(), jobs.end(),
+    [](const Job& job) { return !job.Succeeded; });
+  std::cout << jobs.size() << " jobs run in " << elapsed.count() << " s by "
+            << numberOfWorkers << " workers, " << failed << " failed" << std::endl;
+
+  if (!WriteReport(vm["report"].as<std::string>(), jobs))
+  {
+    std::cerr << "Could not write the report " << vm["report"].as<std::string>() << std::endl;
+    return 1;
+  }
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,281 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+// .NAME BatchSlam -
+// .SECTION Description
+// This program runs the SLAM over the frames of a pcap file without the
+// VTK pipeline. The frames are decoded in parallel a few frames ahead of
+// the SLAM, which extracts the keypoints of a frame while registering the
+// previous one. The trajectory is written as a trajectory csv file, and the
+// registered frames can be streamed to a binary PLY file as the map.
+
+#include "vtkLidarReader.h"
+#include "vtkVelodynePacketInterpreter.h"
+#include "vtkTemporalTransforms.h"
+#include "vtkTemporalTransformsWriter.h"
+#include "vtkEigenTools.h"
+#include "vtkSlam.h"
+#include "Slam.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include <vtkDataArray.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTable.h>
+
+namespace {
+//-----------------------------------------------------------------------------
+std::vector<size_t> ComputeLaserMapping(vtkTable* calib)
+{
+  std::vector<size_t> laserIdMapping;
+  auto array = vtkDataArray::SafeDownCast(calib->GetColumnByName("verticalCorrection"));
+  if (array)
+  {
+    std::vector<double> verticalCorrection(array->GetNumberOfTuples());
+    for (vtkIdType i = 0; i < array->GetNumberOfTuples(); ++i)
+    {
+      verticalCorrection[i] = array->GetTuple1(i);
+    }
+    laserIdMapping = sortIdx(verticalCorrection);
+  }
+  return laserIdMapping;
+}
+
+/**
+ * @brief MapWriter streams points to a binary little endian PLY file, with
+ * their world coordinates, intensity and time. The number of points is
+ * written in the header once the file is closed.
+ */
+class MapWriter
+{
+public:
+  bool Open(const std::string& filename)
+  {
+    this->File.open(filename, std::ios::binary | std::ios::trunc);
+    if (!this->File)
+    {
+      return false;
+    }
+    this->File << "ply\n"
+               << "format binary_little_endian 1.0\n"
+               << "element vertex ";
+    this->CountPosition = this->File.tellp();
+    this->File << std::setw(CountWidth) << std::left << 0 << "\n"
+               << "property float x\n"
+               << "property float y\n"
+               << "property float z\n"
+               << "property float intensity\n"
+               << "property double time\n"
+               << "end_header\n";
+    return static_cast<bool>(this->File);
+  }
+
+  void Add(const Slam::Point& p, const Eigen::Matrix3d& R, const Eigen::Vector3d& T)
+  {
+    const Eigen::Vector3d X = R * Eigen::Vector3d(p.x, p.y, p.z) + T;
+    const float values[4] = {static_cast<float>(X(0)), static_cast<float>(X(1)),
+                             static_cast<float>(X(2)), static_cast<float>(p.intensity)};
+    const double time = p.time;
+    this->File.write(reinterpret_cast<const char*>(values), sizeof(values));
+    this->File.write(reinterpret_cast<const char*>(&time), sizeof(time));
+    this->NumberOfPoints++;
+  }
+
+  bool Close()
+  {
+    this->File.seekp(this->CountPosition);
+    this->File << std::setw(CountWidth) << std::left << this->NumberOfPoints;
+    this->File.close();
+    return !this->File.fail();
+  }
+
+  bool IsOpen() const { return this->File.is_open(); }
+
+private:
+  // enough digits for any number of points, padded with spaces
+  static const int CountWidth = 20;
+  std::ofstream File;
+  std::streampos CountPosition;
+  uint64_t NumberOfPoints = 0;
+};
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  // parse the command line options
+  po::options_description visible("Allowed options");
+  visible.add_options()
+      ("help", "produce help message")
+      ("calibration", po::value<std::string>(), "calibration file of the sensor")
+      ("trajectory", po::value<std::string>()->default_value("trajectory.csv"), "trajectory csv file to write")
+      ("map", po::value<std::string>(), "binary PLY file where the registered frames are streamed")
+      ("map-decimation", po::value<unsigned int>()->default_value(1), "keep one point out of N in the map")
+      ("first-frame", po::value<int>()->default_value(0), "first frame to process")
+      ("last-frame", po::value<int>()->default_value(-1), "last frame to process, -1 for the last frame of the file")
+      ("decode-threads", po::value<int>()->default_value(0), "number of threads decoding the frames, 0 to use all the cores")
+      ("slam-threads", po::value<unsigned int>()->default_value(0), "number of threads matching the keypoints, 0 to use all the cores")
+      ("map-tiles", po::value<std::string>(), "directory where the far voxels of the slam maps are flushed, to bound the memory on long runs")
+      ;
+
+  po::options_description hidden("Hidden options");
+  hidden.add_options()
+      ("input-file", po::value<std::string>(), "input file")
+      ;
+
+  po::positional_options_description p;
+  p.add("input-file", -1);
+
+  po::options_description cmdline_options;
+  cmdline_options.add(visible).add(hidden);
+
+  po::variables_map vm;
+  try
+  {
+    po::store(po::command_line_parser(argc, argv).
+              options(cmdline_options).positional(p).run(), vm);
+    po::notify(vm);
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  if (vm.count("help") || !vm.count("input-file") || !vm.count("calibration")) {
+      std::cout << "Usage: BatchSlam <pcap_file> --calibration <calibration_file> [options]\n";
+      std::cout << visible << "\n";
+      return 1;
+  }
+
+  const std::string filename = vm["input-file"].as<std::string>();
+  const std::string calibration = vm["calibration"].as<std::string>();
+  const std::string trajectoryFilename = vm["trajectory"].as<std::string>();
+  const unsigned int mapDecimation = std::max(1u, vm["map-decimation"].as<unsigned int>());
+
+  // open the pcap and build its frame catalog
+  auto reader = vtkSmartPointer<vtkLidarReader>::New();
+  reader->SetInterpreter(vtkSmartPointer<vtkVelodynePacketInterpreter>::New());
+  reader->SetFileName(filename);
+  reader->SetCalibrationFileName(calibration);
+  reader->Update();
+  if (reader->GetNumberOfFrames() == 0)
+  {
+    std::cerr << "No frame could be read from " << filename << std::endl;
+    return 1;
+  }
+  std::vector<size_t> laserIdMapping =
+    ComputeLaserMapping(vtkTable::SafeDownCast(reader->GetOutputDataObject(1)));
+
+  const int firstFrame = vm["first-frame"].as<int>();
+  int lastFrame = vm["last-frame"].as<int>();
+  if (lastFrame < 0)
+  {
+    lastFrame = reader->GetNumberOfFrames() - 1;
+  }
+
+  MapWriter map;
+  if (vm.count("map") && !map.Open(vm["map"].as<std::string>()))
+  {
+    std::cerr << "Could not open " << vm["map"].as<std::string>() << std::endl;
+    return 1;
+  }
+
+  Slam slam;
+  slam.SetNumberOfThreads(vm["slam-threads"].as<unsigned int>());
+  slam.SetPipelineMode(FramePipelineMode::OverlappedPipeline);
+  if (vm.count("map-tiles"))
+  {
+    // only the hashed voxels evict voxels to the tile stores
+    slam.SetMapBackend(LocalMapBackend::HashedVoxelMap);
+    slam.SetMapTilesDirectory(vm["map-tiles"].as<std::string>());
+  }
+  auto trajectory = vtkSmartPointer<vtkTemporalTransforms>::New();
+
+  // The frames given to the slam and not registered yet, in order
+  std::deque<pcl::PointCloud<Slam::Point>::Ptr> pendingFrames;
+  auto collectRegisteredFrames = [&]()
+  {
+    // each frame registered since the last call gets the current pose,
+    // the slam registers at most one frame per call to AddFrame
+    while (!pendingFrames.empty() &&
+           trajectory->GetNumberOfPoints() < static_cast<vtkIdType>(slam.GetNbrFrameProcessed()))
+    {
+      pcl::PointCloud<Slam::Point>::Ptr frame = pendingFrames.front();
+      pendingFrames.pop_front();
+
+      Transform Tworld = slam.GetWorldTransform();
+      const Eigen::Matrix3d R = RollPitchYawToMatrix(Tworld.rx, Tworld.ry, Tworld.rz);
+      const Eigen::Vector3d T(Tworld.position);
+      trajectory->PushBack(frame->points[0].time, Eigen::AngleAxisd(R), T);
+      if (map.IsOpen())
+      {
+        for (size_t i = 0; i < frame->size(); i += mapDecimation)
+        {
+          map.Add(frame->points[i], R, T);
+        }
+      }
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  bool decoded = reader->DecodeFrames(firstFrame, lastFrame, [&](int frameNumber, vtkPolyData* polydata)
+  {
+    pcl::PointCloud<Slam::Point>::Ptr pc(new pcl::PointCloud<Slam::Point>);
+    PointCloudFromPolyData(polydata, pc);
+    if (pc->empty())
+    {
+      std::cout << "Frame " << frameNumber << " is empty, skipped" << std::endl;
+      return true;
+    }
+    pendingFrames.push_back(pc);
+    slam.AddFrame(pc, laserIdMapping);
+    collectRegisteredFrames();
+    return true;
+  }, vm["decode-threads"].as<int>());
+  if (!decoded)
+  {
+    std::cerr << "The decoding of the frames failed, the trajectory is partial" << std::endl;
+  }
+  slam.Flush();
+  collectRegisteredFrames();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  std::cout << trajectory->GetNumberOfPoints() << " frames registered in "
+            << elapsed.count() << " s" << std::endl;
+
+  auto writer = vtkSmartPointer<vtkTemporalTransformsWriter>::New();
+  writer->SetInputData(trajectory);
+  writer->SetFileName(trajectoryFilename.c_str());
+  writer->Write();
+
+  if (map.IsOpen() && !map.Close())
+  {
+    std::cerr << "Could not write the map" << std::endl;
+    return 1;
+  }
+  return 0;
+}
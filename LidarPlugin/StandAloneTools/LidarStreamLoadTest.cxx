@@ -0,0 +1,327 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+// .NAME LidarStreamLoadTest -
+// .SECTION Description
+// This program replays a pcap on the local host into a vtkLidarStream, once for
+// each requested speed, and reports as JSON where the lidar packets were lost and
+// how long the frames took to be completed:
+//  - socket: packets sent but never received, lost by the kernel or the receiver
+//  - queue: packets received but dropped because the packet queue was full
+//  - consumer: frames completed but never taken, because the history was full
+//  - latency: delay between the reception of the packet which completed a frame
+//    and the moment the frame was available, as percentiles
+// The frames are taken as soon as they are available, as the application does
+// with its own period. The program exits with 1 if a loss exceeds --max-loss, so
+// that it can be run from a script to validate a machine.
+
+#include "PacketConsumer.h"
+#include "PacketReplayEngine.h"
+#include "vtkLidarStream.h"
+#include "vtkPacketFileReader.h"
+#include "vtkVelodynePacketInterpreter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <boost/thread/thread.hpp>
+namespace po = boost::program_options;
+
+#include <vtkObjectFactory.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtk_jsoncpp.h>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+//! Give access to the consumer of the stream, whose counters are not exposed to the pipeline
+class LoadTestStream : public vtkLidarStream
+{
+public:
+  static LoadTestStream* New();
+  vtkTypeMacro(LoadTestStream, vtkLidarStream)
+
+  PacketConsumer* GetConsumer() { return this->Consumer.get(); }
+
+protected:
+  LoadTestStream() = default;
+};
+vtkStandardNewMacro(LoadTestStream)
+
+//-----------------------------------------------------------------------------
+//! Number of packets sent to the lidar port, the 512 bytes packets go to the position port
+size_t CountLidarPackets(const std::string& filename)
+{
+  vtkPacketFileReader reader;
+  if (!reader.Open(filename))
+  {
+    return 0;
+  }
+  size_t count = 0;
+  const unsigned char* data = nullptr;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  while (reader.NextPacket(data, dataLength, timeSinceStart))
+  {
+    count += dataLength != 512 ? 1 : 0;
+  }
+  return count;
+}
+
+//-----------------------------------------------------------------------------
+//! Value below which a fraction of the sorted values are, by nearest rank
+double Percentile(const std::vector<double>& sortedValues, double fraction)
+{
+  if (sortedValues.empty())
+  {
+    return 0;
+  }
+  const size_t rank = static_cast<size_t>(fraction * (sortedValues.size() - 1) + 0.5);
+  return sortedValues[std::min(rank, sortedValues.size() - 1)];
+}
+
+//-----------------------------------------------------------------------------
+double Ratio(size_t part, size_t total)
+{
+  return total > 0 ? static_cast<double>(part) / total : 0;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  // parse the command line options
+  po::options_description visible("Allowed options");
+  visible.add_options()
+      ("help", "produce help message")
+      ("calibration", po::value<std::string>(), "calibration file of the sensor")
+      ("speed", po::value<std::vector<double> >()->multitoken()->default_value({ 1 }, "1"),
+       "replay speeds, as multiples of the sensor rate, one run per speed. 0 sends as fast as possible")
+      ("lidarPort", po::value<int>()->default_value(2368), "port on which the stream listens")
+      ("queue-capacity", po::value<int>()->default_value(16384), "number of packets the queue of the stream can hold")
+      ("history-size", po::value<int>()->default_value(10), "number of frames the stream keeps until they are taken")
+      ("drain-timeout", po::value<double>()->default_value(2), "seconds to wait for the stream to process the last packets")
+      ("max-loss", po::value<double>()->default_value(1), "fail if the fraction of packets or frames lost at a stage exceeds it")
+      ("output", po::value<std::string>(), "file in which the JSON report is written, instead of the standard output")
+      ;
+
+  po::options_description hidden("Hidden options");
+  hidden.add_options()
+      ("input-file", po::value<std::string>(), "input file")
+      ;
+
+  po::positional_options_description p;
+  p.add("input-file", -1);
+
+  po::options_description cmdline_options;
+  cmdline_options.add(visible).add(hidden);
+
+  po::variables_map vm;
+  try
+  {
+    po::store(po::command_line_parser(argc, argv).
+              options(cmdline_options).positional(p).run(), vm);
+    po::notify(vm);
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  if (vm.count("help") || !vm.count("input-file") || !vm.count("calibration")) {
+      std::cout << "Usage: LidarStreamLoadTest <pcap_file> --calibration <calibration_file> [options]\n";
+      std::cout << visible << "\n";
+      return 1;
+  }
+
+  const std::string filename = vm["input-file"].as<std::string>();
+  const int lidarPort = vm["lidarPort"].as<int>();
+  const double drainTimeout = vm["drain-timeout"].as<double>();
+  const double maximumLoss = vm["max-loss"].as<double>();
+
+  const size_t numberOfLidarPackets = CountLidarPackets(filename);
+  if (numberOfLidarPackets == 0)
+  {
+    std::cerr << "No lidar packet could be read from " << filename << std::endl;
+    return 1;
+  }
+
+  Json::Value report;
+  report["pcap"] = filename;
+  report["lidarPackets"] = static_cast<Json::UInt64>(numberOfLidarPackets);
+  Json::Value runs(Json::arrayValue);
+  bool isWithinLimits = true;
+
+  for (double speed : vm["speed"].as<std::vector<double> >())
+  {
+    auto stream = vtkSmartPointer<LoadTestStream>::New();
+    stream->SetInterpreter(vtkSmartPointer<vtkVelodynePacketInterpreter>::New());
+    stream->SetCalibrationFileName(vm["calibration"].as<std::string>());
+    stream->SetLidarPort(lidarPort);
+    stream->SetIsForwarding(false);
+    stream->SetIsCrashAnalysing(false);
+    stream->SetPacketQueueCapacity(vm["queue-capacity"].as<int>());
+    stream->SetFrameHistorySize(vm["history-size"].as<int>());
+    stream->Start();
+    PacketConsumer* consumer = stream->GetConsumer();
+
+    // take the frames as soon as they are available, while the packets are sent
+    std::atomic<bool> isReplaying(true);
+    std::atomic<size_t> numberOfTakenFrames(0);
+    std::vector<double> latencies;
+    auto takeFrames = [&]()
+    {
+      for (vtkPolyData* frame : consumer->GetAvailableFrames())
+      {
+        numberOfTakenFrames += consumer->TakeFrame(frame) ? 1 : 0;
+      }
+      std::vector<double> newLatencies = consumer->TakeFrameLatencies();
+      latencies.insert(latencies.end(), newLatencies.begin(), newLatencies.end());
+    };
+    boost::thread taker([&]()
+    {
+      while (isReplaying)
+      {
+        takeFrames();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+      }
+    });
+
+    PacketReplayEngine::Statistics statistics;
+    try
+    {
+      // let the receiver bind its socket before sending
+      boost::this_thread::sleep_for(boost::chrono::milliseconds(200));
+      PacketReplayEngine engine("127.0.0.1");
+      engine.SetSpeed(speed);
+      engine.AddSource(filename, lidarPort, lidarPort + 1);
+      statistics = engine.Replay();
+    }
+    catch (std::exception& e)
+    {
+      isReplaying = false;
+      taker.join();
+      stream->Stop();
+      std::cerr << "Caught Exception: " << e.what() << std::endl;
+      return 1;
+    }
+
+    // wait for the packets still in the queue, until all of them are accounted for
+    // or the counters stop moving
+    const size_t numberOfSentPackets = std::min(numberOfLidarPackets,
+                                                statistics.PacketCount - statistics.SendErrorCount);
+    auto received = [&]() { return consumer->GetNumberOfProcessedPackets() + consumer->GetNumberOfDroppedPackets(); };
+    const auto drainStart = std::chrono::steady_clock::now();
+    size_t lastReceived = received();
+    auto lastChange = drainStart;
+    while (received() < numberOfSentPackets &&
+           std::chrono::steady_clock::now() - lastChange < std::chrono::milliseconds(200) &&
+           std::chrono::steady_clock::now() - drainStart < std::chrono::duration<double>(drainTimeout))
+    {
+      boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
+      if (received() != lastReceived)
+      {
+        lastReceived = received();
+        lastChange = std::chrono::steady_clock::now();
+      }
+    }
+    isReplaying = false;
+    taker.join();
+    takeFrames();
+    stream->Stop();
+
+    const size_t numberOfProcessedPackets = consumer->GetNumberOfProcessedPackets();
+    const size_t numberOfDroppedPackets = consumer->GetNumberOfDroppedPackets();
+    const size_t numberOfReceivedPackets = numberOfProcessedPackets + numberOfDroppedPackets;
+    const size_t numberOfLostPackets =
+      numberOfSentPackets > numberOfReceivedPackets ? numberOfSentPackets - numberOfReceivedPackets : 0;
+    const size_t numberOfSkippedFrames = consumer->GetNumberOfSkippedFrames();
+    const size_t numberOfFrames = numberOfTakenFrames + numberOfSkippedFrames;
+    std::sort(latencies.begin(), latencies.end());
+
+    Json::Value run;
+    run["speed"] = speed;
+    Json::Value replay;
+    replay["packetsSent"] = static_cast<Json::UInt64>(statistics.PacketCount - statistics.SendErrorCount);
+    replay["sendErrors"] = static_cast<Json::UInt64>(statistics.SendErrorCount);
+    replay["duration"] = statistics.Duration;
+    replay["packetsPerSecond"] = statistics.GetPacketsPerSecond();
+    replay["megabitsPerSecond"] = statistics.GetMegabitsPerSecond();
+    replay["meanLatenessUs"] = statistics.MeanLateness;
+    replay["jitterUs"] = statistics.Jitter;
+    run["replay"] = replay;
+    Json::Value socket;
+    socket["sent"] = static_cast<Json::UInt64>(numberOfSentPackets);
+    socket["received"] = static_cast<Json::UInt64>(numberOfReceivedPackets);
+    socket["lost"] = static_cast<Json::UInt64>(numberOfLostPackets);
+    socket["lossRatio"] = Ratio(numberOfLostPackets, numberOfSentPackets);
+    run["socket"] = socket;
+    Json::Value queue;
+    queue["processed"] = static_cast<Json::UInt64>(numberOfProcessedPackets);
+    queue["dropped"] = static_cast<Json::UInt64>(numberOfDroppedPackets);
+    queue["lossRatio"] = Ratio(numberOfDroppedPackets, numberOfReceivedPackets);
+    queue["highWaterMark"] = static_cast<Json::UInt64>(consumer->GetQueueHighWaterMark());
+    queue["capacity"] = static_cast<Json::UInt64>(consumer->GetQueueCapacity());
+    run["queue"] = queue;
+    Json::Value frames;
+    frames["completed"] = static_cast<Json::UInt64>(numberOfFrames);
+    frames["taken"] = static_cast<Json::UInt64>(numberOfTakenFrames.load());
+    frames["skipped"] = static_cast<Json::UInt64>(numberOfSkippedFrames);
+    frames["lossRatio"] = Ratio(numberOfSkippedFrames, numberOfFrames);
+    run["consumer"] = frames;
+    Json::Value latency;
+    latency["frames"] = static_cast<Json::UInt64>(latencies.size());
+    latency["p50Ms"] = 1e3 * Percentile(latencies, 0.5);
+    latency["p90Ms"] = 1e3 * Percentile(latencies, 0.9);
+    latency["p99Ms"] = 1e3 * Percentile(latencies, 0.99);
+    latency["maxMs"] = 1e3 * (latencies.empty() ? 0 : latencies.back());
+    run["latency"] = latency;
+    runs.append(run);
+
+    isWithinLimits = isWithinLimits &&
+                     socket["lossRatio"].asDouble() <= maximumLoss &&
+                     queue["lossRatio"].asDouble() <= maximumLoss &&
+                     frames["lossRatio"].asDouble() <= maximumLoss;
+  }
+  report["runs"] = runs;
+  report["maxLoss"] = maximumLoss;
+  report["passed"] = isWithinLimits;
+
+  if (vm.count("output"))
+  {
+    std::ofstream output(vm["output"].as<std::string>());
+    output << report << std::endl;
+    if (!output)
+    {
+      std::cerr << "Could not write the report " << vm["output"].as<std::string>() << std::endl;
+      return 1;
+    }
+  }
+  else
+  {
+    std::cout << report << std::endl;
+  }
+
+  return isWithinLimits ? 0 : 1;
+}
@@ -27,24 +27,31 @@
 =========================================================================*/
 // .NAME PacketFileSender -
 // .SECTION Description
-// This program reads a pcap file and sends the packets using UDP.
-// The default playback speed is based on the timestamps specified in the pcap file
+// This program reads one or several pcap files and sends the packets using UDP.
+// The default playback speed is based on the timestamps specified in the pcap
+// files, the packets of all the files are merged on these timestamps so that
+// sensors recorded together are replayed in sync.
 
-#include "vtkPacketFileReader.h"
-#include "vvPacketSender.h"
+#include "PacketReplayEngine.h"
 
 #include <cstdlib>
-#include <ctime>
+#include <iomanip>
 #include <iostream>
 #include <string>
-#include <chrono>
+#include <vector>
 
-#include <boost/thread/thread.hpp>
 #include <boost/program_options.hpp>
 namespace po = boost::program_options;
 
 const int OUTPUT_WIDTH = 15; // width of the column (#packet, duration, ...) in the output stream
 
+//-----------------------------------------------------------------------------
+//! Port of the i-th file, the last port given is used for the remaining files
+unsigned int GetPort(const std::vector<unsigned int>& ports, size_t i)
+{
+  return ports[std::min(i, ports.size() - 1)];
+}
+
 int main(int argc, char* argv[])
 {
   bool loop = false;  // run the capture 1 time or in loop
@@ -55,15 +62,19 @@ int main(int argc, char* argv[])
       ("help", "produce help message")
       ("ip", po::value<std::string>()->default_value("127.0.0.1"), "destination ip adress")
       ("loop", po::bool_switch(&loop), "run the capture in loop")
-      ("lidarPort", po::value<unsigned int>()->default_value(2368), "destination port for lidar packets")
-      ("GPSPort", po::value<unsigned int>()->default_value(8308), "destination port for GPS packets")
-      ("speed", po::value<double>()->default_value(1), "playback speed")
+      ("lidarPort", po::value<std::vector<unsigned int> >()->multitoken()->default_value({ 2368 }, "2368"),
+       "destination port for lidar packets, one per input file")
+      ("GPSPort", po::value<std::vector<unsigned int> >()->multitoken()->default_value({ 8308 }, "8308"),
+       "destination port for GPS packets, one per input file")
+      ("speed", po::value<double>()->default_value(1), "playback speed, 0 sends the packets as fast as possible")
+      ("batch-size", po::value<unsigned int>()->default_value(64), "maximum number of packets sent at once")
+      ("busy-wait", po::value<double>()->default_value(200), "spin instead of sleeping when the next packet is due in less than X us")
       ("display-frequency", po::value<unsigned int>()->default_value(1000), "print information after every interval of X sent packets")
       ;
 
   po::options_description hidden("Hidden options");
   hidden.add_options()
-      ("input-file", po::value<std::string>(), "input file")
+      ("input-file", po::value<std::vector<std::string> >(), "input files")
       ;
 
   po::positional_options_description p;
@@ -77,85 +88,72 @@ int main(int argc, char* argv[])
             options(cmdline_options).positional(p).run(), vm);
   po::notify(vm);
 
-  if (vm.count("help") || argc < 2) {
-      cout << "Usage: PacketFileSender <pcap_file> [options]\n";
-      cout << visible << "\n";
+  if (vm.count("help") || !vm.count("input-file")) {
+      std::cout << "Usage: PacketFileSender <pcap_file> [<pcap_file> ...] [options]\n";
+      std::cout << visible << "\n";
       return 1;
   }
 
   // convert to the right type
-  std::string filename = vm["input-file"].as<std::string>();
+  std::vector<std::string> filenames = vm["input-file"].as<std::vector<std::string> >();
   double speed = vm["speed"].as<double>();
   std::string destinationIp = vm["ip"].as<std::string>();
-  unsigned int lidarPort =  vm["lidarPort"].as<unsigned int>();
-  unsigned int GPSPort = vm["GPSPort"].as<unsigned int>();
+  std::vector<unsigned int> lidarPorts = vm["lidarPort"].as<std::vector<unsigned int> >();
+  std::vector<unsigned int> GPSPorts = vm["GPSPort"].as<std::vector<unsigned int> >();
+  unsigned int batchSize = vm["batch-size"].as<unsigned int>();
+  double busyWait = vm["busy-wait"].as<double>();
   unsigned int display_frequency = vm["display-frequency"].as<unsigned int>();
 
-  const int microSecondsPerSecond = 1e6;
-
   std::cout << "Start sending" << std::endl;
 
   try
   {
     do
     {
-      auto replayStartTime = std::chrono::steady_clock::now();
-
       // output the column header for the displayed values
       std::cout << "----------------------------------------------------------------------------" << std::endl
                 << std::right << std::setw(OUTPUT_WIDTH) << "# packets"
                 << std::right << std::setw(OUTPUT_WIDTH) << "duration (s)"
                 << std::right << std::setw(OUTPUT_WIDTH) << "f (Hz)"
                 << std::right << std::setw(OUTPUT_WIDTH) << "delay (us)"
+                << std::right << std::setw(OUTPUT_WIDTH) << "jitter (us)"
                 << std::endl
                 << "----------------------------------------------------------------------------" << std::endl;
 
-      // Create a Packet Sender
-      vvPacketSender sender(filename, destinationIp, lidarPort, GPSPort);
-
-      // Case starting time
-      double pcapStartTime = sender.pumpPacket();
-
-      while (!sender.IsDone())
+      // Create a replay engine, the files are opened again for each loop
+      PacketReplayEngine engine(destinationIp);
+      engine.SetSpeed(speed);
+      engine.SetBatchSize(batchSize);
+      engine.SetBusyWaitThreshold(busyWait);
+      for (size_t i = 0; i < filenames.size(); ++i)
       {
-        // time from the pcap file
-        double pcapCurrentTime = sender.pumpPacket();
-        double pcapmicroSecondsSinceStart = (pcapCurrentTime - pcapStartTime) * microSecondsPerSecond;
-
-        // time from the wall clock
-        auto replayCurrentTime = std::chrono::steady_clock::now();
-        int replaymicroSecondsSinceStart =
-            std::chrono::duration_cast<std::chrono::microseconds>(replayCurrentTime - replayStartTime).count();
-
-        // check if the replay is to much in advance compared to the pcap time step
-        // if this is the case, we sleep the thread until the pcap catch up the replay
-        double time_delay = static_cast<double>(pcapmicroSecondsSinceStart) / speed  - replaymicroSecondsSinceStart;
-
-        if (time_delay > 0)
-        {
-        boost::this_thread::sleep(
-          boost::posix_time::microseconds(static_cast<int>(time_delay)));
-        }
-
-        // Display the user some information
-        if ((sender.GetPacketCount() % display_frequency) == 0)
-        {
-          // Compute nb of packets sended including the one from previous loops
-          int nbPacketSended = sender.GetPacketCount();
-
-          // Compute time since the replay began
-          double secondSinceStart = static_cast<double>(replaymicroSecondsSinceStart) / microSecondsPerSecond;
-
-          // Nice output
-          std::cout << std::fixed
-                    << std::right << std::setw(OUTPUT_WIDTH) << nbPacketSended
-                    << std::fixed << std::right << std::setw(OUTPUT_WIDTH) << secondSinceStart
-                    << std::right << std::setw(OUTPUT_WIDTH)
-                    << static_cast<double>(nbPacketSended) /  secondSinceStart
-                    << std::right << std::setw(OUTPUT_WIDTH) << time_delay
-                    << std::endl;
-        }
+        engine.AddSource(filenames[i], GetPort(lidarPorts, i), GetPort(GPSPorts, i));
       }
+
+      // Display the user some information
+      auto display = [](const PacketReplayEngine::Statistics& statistics)
+      {
+        std::cout << std::fixed
+                  << std::right << std::setw(OUTPUT_WIDTH) << statistics.PacketCount
+                  << std::right << std::setw(OUTPUT_WIDTH) << statistics.Duration
+                  << std::right << std::setw(OUTPUT_WIDTH) << statistics.GetPacketsPerSecond()
+                  << std::right << std::setw(OUTPUT_WIDTH) << statistics.MeanLateness
+                  << std::right << std::setw(OUTPUT_WIDTH) << statistics.Jitter
+                  << std::endl;
+      };
+      PacketReplayEngine::Statistics statistics = engine.Replay(display, display_frequency);
+
+      // Summary of the whole replay
+      std::cout << "----------------------------------------------------------------------------" << std::endl
+                << "packets sent:      " << statistics.PacketCount - statistics.SendErrorCount
+                << " / " << statistics.PacketCount << std::endl
+                << "bytes sent:        " << statistics.ByteCount << std::endl
+                << "duration (s):      " << statistics.Duration << std::endl
+                << "rate:              " << statistics.GetPacketsPerSecond() << " packets/s, "
+                << statistics.GetMegabitsPerSecond() << " Mbit/s" << std::endl
+                << "delay (us):        mean " << statistics.MeanLateness
+                << ", max " << statistics.MaximumLateness
+                << ", jitter " << statistics.Jitter << std::endl;
     } while (loop);
   }
   catch (std::exception& e)
@@ -0,0 +1,240 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+// .NAME PacketGenerator -
+// .SECTION Description
+// This program synthesizes the lidar packets of a Velodyne sensor driving down a
+// procedural street (see VelodynePacketGenerator), to soak test the decoding, the
+// SLAM and the exports at scale. The packets are either written to a pcap file as
+// fast as the disk allows, the packets being generated by several threads, or sent
+// on the network at a multiple of the rate of the sensor as PacketFileSender does.
+// The same options and seed always give the same packets.
+
+#include "PacketReplayEngine.h"
+#include "VelodyneCalibration.h"
+#include "VelodynePacketGenerator.h"
+#include "vtkPacketFileWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <boost/thread/thread.hpp>
+namespace po = boost::program_options;
+
+namespace
+{
+//! Number of packets generated at once before being written
+const uint64_t BATCH_SIZE = 8192;
+
+//! Capture date of the first packet written to a pcap, 2019-01-01 00:00:00 UTC
+const long FIRST_CAPTURE_SECOND = 1546300800;
+
+//-----------------------------------------------------------------------------
+//! Write the packets in a pcap, return the number of packets written
+uint64_t WritePcap(const VelodynePacketGenerator& generator, uint64_t numberOfPackets,
+                   const std::string& filename, unsigned int numberOfThreads, int lidarPort)
+{
+  vtkPacketFileWriter writer;
+  writer.SetAsynchronous(true);
+  if (!writer.Open(filename))
+  {
+    std::cerr << "Could not open " << filename << ": " << writer.GetLastError() << std::endl;
+    return 0;
+  }
+
+  const unsigned int packetSize = VelodynePacketGenerator::PacketSize;
+  const unsigned char sourceIP[4] = { 192, 168, 1, 201 };
+  std::vector<unsigned char> packets(BATCH_SIZE * packetSize);
+  std::vector<double> times(BATCH_SIZE);
+  uint64_t written = 0;
+  for (uint64_t first = 0; first < numberOfPackets; first += BATCH_SIZE)
+  {
+    // each thread generates a contiguous range of the batch
+    const uint64_t batchSize = std::min(BATCH_SIZE, numberOfPackets - first);
+    const uint64_t rangeSize = (batchSize + numberOfThreads - 1) / numberOfThreads;
+    boost::thread_group threads;
+    for (uint64_t begin = 0; begin < batchSize; begin += rangeSize)
+    {
+      const uint64_t end = std::min(batchSize, begin + rangeSize);
+      threads.create_thread([&, begin, end]()
+      {
+        for (uint64_t i = begin; i < end; ++i)
+        {
+          times[i] = generator.GeneratePacket(first + i, packets.data() + i * packetSize);
+        }
+      });
+    }
+    threads.join_all();
+
+    for (uint64_t i = 0; i < batchSize; ++i)
+    {
+      const long long microseconds = static_cast<long long>(1e6 * times[i]);
+      struct timeval time;
+      time.tv_sec = FIRST_CAPTURE_SECOND + microseconds / 1000000;
+      time.tv_usec = microseconds % 1000000;
+      if (!writer.WriteUDPPacket(packets.data() + i * packetSize, packetSize, time, sourceIP,
+                                 lidarPort, lidarPort))
+      {
+        std::cerr << "Could not write the packet " << first + i << ": " << writer.GetLastError() << std::endl;
+        writer.Close();
+        return written;
+      }
+      ++written;
+    }
+  }
+  writer.Close();
+
+  const vtkPacketFileWriter::Statistics statistics = writer.GetStatistics();
+  if (statistics.NumberOfWriteErrors > 0)
+  {
+    std::cerr << statistics.NumberOfWriteErrors << " blocks could not be written, "
+              << statistics.NumberOfDroppedBytes << " bytes were dropped" << std::endl;
+  }
+  return written;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  bool dualReturn = false;
+
+  // parse the command line options
+  po::options_description visible("Allowed options");
+  visible.add_options()
+      ("help", "produce help message")
+      ("sensor", po::value<std::string>()->default_value("VLP-16"), "VLP-16, VLP-32c, HDL-64 or VLS-128")
+      ("dual", po::bool_switch(&dualReturn), "dual return instead of strongest return")
+      ("rpm", po::value<double>()->default_value(600), "rotation speed of the sensor")
+      ("vehicle-speed", po::value<double>()->default_value(5), "speed of the sensor along the street, in m/s")
+      ("seed", po::value<uint64_t>()->default_value(0), "seed of the scene and of the noise")
+      ("calibration", po::value<std::string>(), "calibration the packets are generated for, the lasers being evenly spread otherwise")
+      ("duration", po::value<double>()->default_value(60), "seconds of sensor data to generate")
+      ("size", po::value<double>()->default_value(0), "size of the data to generate in GB, overrides the duration")
+      ("output", po::value<std::string>(), "pcap file to write, the packets are sent on the network otherwise")
+      ("threads", po::value<unsigned int>()->default_value(boost::thread::hardware_concurrency()), "number of threads generating the packets of a pcap")
+      ("ip", po::value<std::string>()->default_value("127.0.0.1"), "destination ip adress")
+      ("lidarPort", po::value<unsigned int>()->default_value(2368), "destination port for lidar packets")
+      ("rate", po::value<double>()->default_value(1), "sending rate as a multiple of the rate of the sensor, 0 sends the packets as fast as possible")
+      ("batch-size", po::value<unsigned int>()->default_value(64), "maximum number of packets sent at once")
+      ;
+
+  po::variables_map vm;
+  try
+  {
+    po::store(po::parse_command_line(argc, argv, visible), vm);
+    po::notify(vm);
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  VelodynePacketGenerator::Model model;
+  if (vm.count("help") || !VelodynePacketGenerator::GetModelFromName(vm["sensor"].as<std::string>(), model))
+  {
+    std::cout << "Usage: PacketGenerator [--output <pcap_file>] [options]\n";
+    std::cout << visible << "\n";
+    return 1;
+  }
+
+  VelodynePacketGenerator generator(model, dualReturn);
+  generator.SetRPM(vm["rpm"].as<double>());
+  generator.SetSpeed(vm["vehicle-speed"].as<double>());
+  generator.SetSeed(vm["seed"].as<uint64_t>());
+  if (vm.count("calibration"))
+  {
+    std::string error;
+    std::shared_ptr<const VelodyneCalibration> calibration =
+      LoadVelodyneCalibration(vm["calibration"].as<std::string>(), error);
+    if (!calibration || !generator.SetCalibration(*calibration))
+    {
+      std::cerr << "The calibration " << vm["calibration"].as<std::string>() << " can not be used with a "
+                << VelodynePacketGenerator::GetModelName(model) << " " << error << std::endl;
+      return 1;
+    }
+  }
+
+  const double gigabytes = vm["size"].as<double>();
+  const uint64_t numberOfPackets = gigabytes > 0
+    ? static_cast<uint64_t>(gigabytes * 1e9 / VelodynePacketGenerator::PacketSize)
+    : static_cast<uint64_t>(vm["duration"].as<double>() / generator.GetPacketPeriod());
+  const unsigned int lidarPort = vm["lidarPort"].as<unsigned int>();
+
+  std::cout << "Generating " << numberOfPackets << " packets of a "
+            << VelodynePacketGenerator::GetModelName(model) << (dualReturn ? " in dual return" : "")
+            << ", " << numberOfPackets * generator.GetPacketPeriod() << " s of data" << std::endl;
+
+  try
+  {
+    const auto start = std::chrono::steady_clock::now();
+    uint64_t numberOfSentPackets = 0;
+    if (vm.count("output"))
+    {
+      const unsigned int numberOfThreads = std::max(1u, vm["threads"].as<unsigned int>());
+      numberOfSentPackets =
+        WritePcap(generator, numberOfPackets, vm["output"].as<std::string>(), numberOfThreads, lidarPort);
+      if (numberOfSentPackets != numberOfPackets)
+      {
+        return 1;
+      }
+    }
+    else
+    {
+      std::vector<unsigned char> packet(VelodynePacketGenerator::PacketSize);
+      PacketReplayEngine engine(vm["ip"].as<std::string>());
+      engine.SetSpeed(vm["rate"].as<double>());
+      engine.SetBatchSize(vm["batch-size"].as<unsigned int>());
+      engine.AddSource([&](const unsigned char*& data, unsigned int& dataLength, double& time)
+      {
+        if (generator.GetPacketIndex() >= numberOfPackets)
+        {
+          return false;
+        }
+        time = generator.GeneratePacket(packet.data());
+        data = packet.data();
+        dataLength = VelodynePacketGenerator::PacketSize;
+        return true;
+      }, lidarPort, lidarPort + 1);
+      const PacketReplayEngine::Statistics statistics = engine.Replay();
+      numberOfSentPackets = statistics.PacketCount - statistics.SendErrorCount;
+      std::cout << "delay (us):        mean " << statistics.MeanLateness
+                << ", max " << statistics.MaximumLateness
+                << ", jitter " << statistics.Jitter << std::endl;
+    }
+
+    const double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "packets:           " << numberOfSentPackets << " / " << numberOfPackets << std::endl
+              << "duration (s):      " << duration << std::endl
+              << "rate:              " << numberOfSentPackets / duration << " packets/s, "
+              << 1e-6 * numberOfSentPackets * VelodynePacketGenerator::PacketSize / duration << " MB/s, "
+              << numberOfSentPackets * generator.GetPacketPeriod() / duration << " x real time" << std::endl;
+  }
+  catch (std::exception& e)
+  {
+    std::cout << "Caught Exception: " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,111 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Measure the time of the fisheye calibration of the 3D - 2D matches of the
+// tests: the whole calibration, then its non-linear refinement from the same
+// initial guess evaluating the residuals on a single thread and on all the cores.
+//
+// Each stage is run several times and the fastest run is reported, as one line
+// per stage which can be parsed to compare two builds:
+//   BENCHMARK <stage> seconds=<n>
+
+#include "CameraCalibration.h"
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace
+{
+const int NumberOfRuns = 5;
+
+//----------------------------------------------------------------------------
+//! Print the fastest of NumberOfRuns runs of the stage
+void Measure(const std::string& stage, const std::function<void()>& run)
+{
+  double best = std::numeric_limits<double>::max();
+  for (int i = 0; i < NumberOfRuns; ++i)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    run();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  std::cout << "BENCHMARK " << stage << " seconds=" << best << std::endl;
+}
+
+//----------------------------------------------------------------------------
+//! Initial guess of the fisheye parameters, from the pinhole calibration
+Eigen::Matrix<double, 15, 1> PinholeGuess(const std::vector<Eigen::Vector3d>& X,
+                                          const std::vector<Eigen::Vector2d>& x)
+{
+  Eigen::Matrix<double, 3, 4> P;
+  LinearPinholeCalibration(X, x, P);
+  Eigen::Matrix3d R, K;
+  Eigen::Vector3d T;
+  CalibrationMatrixDecomposition(P, K, R, T);
+  Eigen::Matrix<double, 11, 1> W;
+  GetParametersFromMatrix(K, R, T, W);
+  NonLinearPinholeCalibration(X, x, W);
+  Eigen::Matrix<double, 15, 1> Wf = Eigen::Matrix<double, 15, 1>::Zero();
+  Wf.head<11>() = W;
+  return Wf;
+}
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc != 2)
+  {
+    std::cerr << "Usage: " << argv[0] << " <directory of fisheye_camera.csv>" << std::endl;
+    return 1;
+  }
+
+  std::vector<Eigen::Vector3d> X;
+  std::vector<Eigen::Vector2d> x;
+  LoadMatchesFromCSV(std::string(argv[1]) + "/fisheye_camera.csv", X, x);
+  if (X.empty())
+  {
+    std::cerr << "No match to calibrate the camera" << std::endl;
+    return 1;
+  }
+  std::cout << X.size() << " matches" << std::endl;
+
+  Measure("FisheyeCalibration", [&]() {
+    Eigen::Matrix<double, 15, 1> W = PinholeGuess(X, x);
+    NonLinearFisheyeCalibration(X, x, W);
+  });
+
+  const Eigen::Matrix<double, 15, 1> Winit = PinholeGuess(X, x);
+  Measure("FisheyeRefinement SingleThread", [&]() {
+    Eigen::Matrix<double, 15, 1> W = Winit;
+    NonLinearFisheyeCalibration(X, x, W, 1000, 1);
+  });
+  Measure("FisheyeRefinement AllCores", [&]() {
+    Eigen::Matrix<double, 15, 1> W = Winit;
+    NonLinearFisheyeCalibration(X, x, W, 1000, 0);
+  });
+
+  return 0;
+}
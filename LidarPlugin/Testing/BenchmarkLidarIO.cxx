@@ -0,0 +1,201 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Measure the throughput of the reading and writing of the files of a recording:
+// the packets of the pcap read by vtkPacketFileReader, read through libpcap or
+// memory mapped, the seeks of vtkLidarReader::GetFrame to frames in a random order
+// (as when the user jumps in the timeline), and the export of the decoded frames
+// to a LAS file in the working directory by LASFileWriter.
+//
+// Each stage is run several times and the fastest run is reported as in
+// BenchmarkPacketDecoding, as one line per stage which can be parsed:
+//   BENCHMARK <stage> packets/s=<n> points/s=<n> frames/s=<n> MB/s=<n>
+// The files are read once before the first run, so that the reads are measured
+// with the recording in the cache of the system.
+
+#include "LASFileWriter.h"
+#include "vtkLidarReader.h"
+#include "vtkPacketFileReader.h"
+#include "vtkVelodynePacketInterpreter.h"
+
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Result of a run of a stage
+struct StageRun
+{
+  double Seconds = 0;
+  uint64_t NumberOfPackets = 0;
+  uint64_t NumberOfPoints = 0;
+  uint64_t NumberOfFrames = 0;
+  uint64_t NumberOfBytes = 0;
+};
+
+//-----------------------------------------------------------------------------
+// Run a stage several times and print its fastest run
+void Report(const std::string& stage, int nbRepetitions, const std::function<StageRun()>& run)
+{
+  StageRun best;
+  best.Seconds = std::numeric_limits<double>::max();
+  for (int i = 0; i < nbRepetitions; ++i)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    StageRun current = run();
+    current.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (current.Seconds < best.Seconds)
+    {
+      best = current;
+    }
+  }
+  const double seconds = std::max(best.Seconds, 1e-9);
+  std::cout << "BENCHMARK " << stage
+            << " packets/s=" << static_cast<uint64_t>(best.NumberOfPackets / seconds)
+            << " points/s=" << static_cast<uint64_t>(best.NumberOfPoints / seconds)
+            << " frames/s=" << static_cast<uint64_t>(best.NumberOfFrames / seconds)
+            << " MB/s=" << 1e-6 * best.NumberOfBytes / seconds
+            << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+// Read all the packets of a pcap
+StageRun ReadPackets(const std::string& filename, bool useMemoryMapping)
+{
+  StageRun run;
+  vtkPacketFileReader reader;
+  if (!reader.Open(filename, "udp", useMemoryMapping))
+  {
+    return run;
+  }
+  const unsigned char* data = nullptr;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  while (reader.NextPacket(data, dataLength, timeSinceStart))
+  {
+    run.NumberOfPackets++;
+    run.NumberOfBytes += dataLength;
+  }
+  reader.Close();
+  return run;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Wrong number of arguments. Usage: BenchmarkLidarIO <pcapFileName> "
+              << "<correctionFileName> [numberOfRepetitions]" << std::endl;
+    return 1;
+  }
+  const std::string pcapFileName = argv[1];
+  const std::string correctionFileName = argv[2];
+  const int nbRepetitions = argc > 3 ? std::max(1, std::atoi(argv[3])) : 5;
+
+  if (ReadPackets(pcapFileName, false).NumberOfPackets == 0)
+  {
+    std::cerr << "No packet could be read from " << pcapFileName << std::endl;
+    return 1;
+  }
+
+  // packets
+  Report("vtkPacketFileReader::NextPacket", nbRepetitions,
+         [&]() { return ReadPackets(pcapFileName, false); });
+  Report("vtkPacketFileReader::NextPacket(mapped)", nbRepetitions,
+         [&]() { return ReadPackets(pcapFileName, true); });
+
+  // seeks, without the cache of the reader so that each frame is read and decoded
+  vtkNew<vtkLidarReader> reader;
+  reader->SetInterpreter(vtkSmartPointer<vtkVelodynePacketInterpreter>::New());
+  reader->SetFileName(pcapFileName);
+  // do not write the sidecar of the frame catalog next to the test data
+  reader->SetUseFrameIndexCache(false);
+  reader->SetCalibrationFileName(correctionFileName);
+  reader->SetUseMemoryMapping(true);
+  reader->SetFrameCacheSize(0);
+  reader->SetNumberOfFramesToPrefetch(0);
+  reader->Update();
+  const int nbFrames = reader->GetNumberOfFrames();
+  if (nbFrames == 0)
+  {
+    std::cerr << "The reader could not find any frame in " << pcapFileName << std::endl;
+    return 1;
+  }
+  // the same order for every run and every build
+  std::vector<int> order(nbFrames);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), std::mt19937(0));
+  reader->Open();
+  std::vector<vtkSmartPointer<vtkPolyData> > frames(nbFrames);
+  Report("vtkLidarReader::GetFrame(seek)", nbRepetitions, [&]()
+  {
+    StageRun run;
+    for (int frame : order)
+    {
+      frames[frame] = reader->GetFrame(frame);
+      run.NumberOfPoints += frames[frame] ? frames[frame]->GetNumberOfPoints() : 0;
+    }
+    run.NumberOfFrames = nbFrames;
+    return run;
+  });
+  reader->Close();
+
+  // export, in the sensor referential as BatchPcapProcessing
+  const std::string lasFileName = "BenchmarkLidarIO.las";
+  Report("LASFileWriter::WriteFrame", nbRepetitions, [&]()
+  {
+    StageRun run;
+    LASFileWriter writer;
+    writer.Open(lasFileName.c_str());
+    writer.SetPrecision(1e-3, 1e-3);
+    writer.SetGeoConversionUTM(0, false);
+    writer.SetOrigin(0., 0., 0.);
+    for (const vtkSmartPointer<vtkPolyData>& frame : frames)
+    {
+      if (frame)
+      {
+        writer.WriteFrame(frame);
+        run.NumberOfPoints += frame->GetNumberOfPoints();
+        run.NumberOfFrames++;
+      }
+    }
+    writer.Close();
+    const std::streamoff size = std::ifstream(lasFileName, std::ios::binary | std::ios::ate).tellg();
+    run.NumberOfBytes = static_cast<uint64_t>(std::max<std::streamoff>(0, size));
+    return run;
+  });
+  std::remove(lasFileName.c_str());
+
+  return 0;
+}
@@ -0,0 +1,381 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Measure the throughput of the decoding of the lidar packets of a pcap, stage
+// by stage: PreProcessPacket (frame catalog), ProcessPacket and SplitFrame, the
+// batched ProcessPackets, and vtkLidarReader::GetFrame. The packets are loaded
+// in memory first, so that only the decoding is measured, except for GetFrame
+// which reads the packets from the memory mapped file as the application does.
+//
+// Each stage is run several times and the fastest run is reported, as one line
+// per stage which can be parsed to compare two builds:
+//   BENCHMARK <stage> packets/s=<n> points/s=<n> frames/s=<n> allocations/frame=<n> bytes/frame=<n>
+// The allocations are counted by replacing the global operator new, which sees
+// the allocations of the plugin library on the platforms with symbol interposition
+// (Linux, macOS). They are reported as 0 elsewhere. When the plugin is built with
+// ENABLE_allocation_tracking, the counters of AllocationTracker are used instead.
+//
+// Instead of a pcap, "synthetic:<sensor>:<Single|Dual>:<seconds>" measures packets
+// synthesized by VelodynePacketGenerator for the calibration, which are written to
+// a pcap in the working directory first, so that the scale does not depend on the
+// recordings of TestData.
+
+#include "AllocationTracker.h"
+#include "VelodynePacketGenerator.h"
+#include "vtkLidarReader.h"
+#include "vtkPacketFileReader.h"
+#include "vtkPacketFileWriter.h"
+#include "vtkVelodynePacketInterpreter.h"
+
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef LIDARVIEW_ALLOCATION_TRACKING
+namespace
+{
+std::atomic<uint64_t> NumberOfAllocations(0);
+std::atomic<uint64_t> AllocatedBytes(0);
+}
+
+//-----------------------------------------------------------------------------
+void* operator new(std::size_t size)
+{
+  ++NumberOfAllocations;
+  AllocatedBytes += size;
+  if (void* pointer = std::malloc(size ? size : 1))
+  {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+  std::free(pointer);
+}
+#endif
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Allocations made by the process since its start
+AllocationTracker::Counters GetAllocations()
+{
+#ifdef LIDARVIEW_ALLOCATION_TRACKING
+  return AllocationTracker::GetProcessCounters();
+#else
+  AllocationTracker::Counters counters;
+  counters.NumberOfAllocations = NumberOfAllocations;
+  counters.AllocatedBytes = AllocatedBytes;
+  return counters;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Lidar packets of a pcap, copied one after the other in a single buffer
+struct PacketsInMemory
+{
+  std::vector<unsigned char> Data;
+  std::vector<RawPacket> Packets;
+
+  bool Load(const std::string& filename, vtkLidarPacketInterpreter* interpreter)
+  {
+    vtkPacketFileReader reader;
+    if (!reader.Open(filename))
+    {
+      return false;
+    }
+    std::vector<unsigned int> lengths;
+    const unsigned char* data = nullptr;
+    unsigned int dataLength = 0;
+    double timeSinceStart = 0;
+    while (reader.NextPacket(data, dataLength, timeSinceStart))
+    {
+      if (interpreter->IsLidarPacket(data, dataLength))
+      {
+        this->Data.insert(this->Data.end(), data, data + dataLength);
+        lengths.push_back(dataLength);
+      }
+    }
+    // the addresses are only known once the buffer does not grow anymore
+    this->Packets.resize(lengths.size());
+    size_t offset = 0;
+    for (size_t i = 0; i < lengths.size(); ++i)
+    {
+      this->Packets[i].Data = this->Data.data() + offset;
+      this->Packets[i].Length = lengths[i];
+      offset += lengths[i];
+    }
+    return !this->Packets.empty();
+  }
+};
+
+//-----------------------------------------------------------------------------
+// Result of a run of a stage
+struct StageRun
+{
+  double Seconds = 0;
+  uint64_t NumberOfPackets = 0;
+  uint64_t NumberOfPoints = 0;
+  uint64_t NumberOfFrames = 0;
+  uint64_t NumberOfAllocations = 0;
+  uint64_t AllocatedBytes = 0;
+};
+
+//-----------------------------------------------------------------------------
+// Run a stage several times and print its fastest run
+void Report(const std::string& stage, int nbRepetitions, const std::function<StageRun()>& run)
+{
+  StageRun best;
+  best.Seconds = std::numeric_limits<double>::max();
+  for (int i = 0; i < nbRepetitions; ++i)
+  {
+    const AllocationTracker::Counters allocationsBefore = GetAllocations();
+    const auto start = std::chrono::steady_clock::now();
+    StageRun current = run();
+    current.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const AllocationTracker::Counters allocationsAfter = GetAllocations();
+    current.NumberOfAllocations = allocationsAfter.NumberOfAllocations - allocationsBefore.NumberOfAllocations;
+    current.AllocatedBytes = allocationsAfter.AllocatedBytes - allocationsBefore.AllocatedBytes;
+    if (current.Seconds < best.Seconds)
+    {
+      best = current;
+    }
+  }
+  const double seconds = std::max(best.Seconds, 1e-9);
+  std::cout << "BENCHMARK " << stage
+            << " packets/s=" << static_cast<uint64_t>(best.NumberOfPackets / seconds)
+            << " points/s=" << static_cast<uint64_t>(best.NumberOfPoints / seconds)
+            << " frames/s=" << static_cast<uint64_t>(best.NumberOfFrames / seconds)
+            << " allocations/frame="
+            << (best.NumberOfFrames ? best.NumberOfAllocations / best.NumberOfFrames : 0)
+            << " bytes/frame="
+            << (best.NumberOfFrames ? best.AllocatedBytes / best.NumberOfFrames : 0)
+            << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+// Write the packets described by "synthetic:<sensor>:<Single|Dual>:<seconds>" for
+// the calibration, return the name of the pcap or an empty string on failure
+std::string WriteSyntheticPcap(const std::string& description, const std::string& calibrationFileName)
+{
+  std::stringstream stream(description);
+  std::string prefix, sensor, mode, seconds;
+  std::getline(stream, prefix, ':');
+  std::getline(stream, sensor, ':');
+  std::getline(stream, mode, ':');
+  std::getline(stream, seconds, ':');
+  VelodynePacketGenerator::Model model;
+  if (!VelodynePacketGenerator::GetModelFromName(sensor, model) || (mode != "Single" && mode != "Dual"))
+  {
+    std::cerr << "Invalid synthetic data: " << description << std::endl;
+    return "";
+  }
+  VelodynePacketGenerator generator(model, mode == "Dual");
+  std::string error;
+  std::shared_ptr<const VelodyneCalibration> calibration =
+    LoadVelodyneCalibration(calibrationFileName, error);
+  if (!calibration || !generator.SetCalibration(*calibration))
+  {
+    std::cerr << "The calibration can not be used for synthetic data: " << error << std::endl;
+    return "";
+  }
+
+  const std::string filename = sensor + "_" + mode + "_synthetic.pcap";
+  vtkPacketFileWriter writer;
+  writer.SetAsynchronous(true);
+  if (!writer.Open(filename))
+  {
+    std::cerr << "Could not open " << filename << ": " << writer.GetLastError() << std::endl;
+    return "";
+  }
+  const unsigned char sourceIP[4] = { 192, 168, 1, 201 };
+  std::vector<unsigned char> packet(VelodynePacketGenerator::PacketSize);
+  const uint64_t numberOfPackets =
+    static_cast<uint64_t>(std::atof(seconds.c_str()) / generator.GetPacketPeriod());
+  for (uint64_t i = 0; i < numberOfPackets; ++i)
+  {
+    const double time = generator.GeneratePacket(packet.data());
+    struct timeval timestamp;
+    timestamp.tv_sec = static_cast<long>(time);
+    timestamp.tv_usec = static_cast<long>(1e6 * (time - timestamp.tv_sec));
+    writer.WriteUDPPacket(packet.data(), VelodynePacketGenerator::PacketSize, timestamp, sourceIP,
+                          2368, 2368);
+  }
+  writer.Close();
+  return filename;
+}
+
+//-----------------------------------------------------------------------------
+// Count the points of the frames ready, and release them
+void CollectFrames(vtkLidarPacketInterpreter* interpreter, StageRun& run)
+{
+  if (interpreter->IsNewFrameReady())
+  {
+    run.NumberOfPoints += interpreter->GetLastFrameAvailable()->GetNumberOfPoints();
+    run.NumberOfFrames++;
+    interpreter->ClearAllFramesAvailable();
+  }
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Wrong number of arguments. Usage: BenchmarkPacketDecoding <pcapFileName> "
+              << "<correctionFileName> [numberOfRepetitions]" << std::endl
+              << "<pcapFileName> can be synthetic:<sensor>:<Single|Dual>:<seconds>" << std::endl;
+    return 1;
+  }
+  std::string pcapFileName = argv[1];
+  const std::string correctionFileName = argv[2];
+  const int nbRepetitions = argc > 3 ? std::max(1, std::atoi(argv[3])) : 5;
+
+  auto interpreter = vtkSmartPointer<vtkVelodynePacketInterpreter>::New();
+  interpreter->SetCalibrationFileName(correctionFileName);
+  interpreter->LoadCalibration(correctionFileName);
+  if (!interpreter->GetIsCalibrated())
+  {
+    std::cerr << "Could not load the calibration " << correctionFileName << std::endl;
+    return 1;
+  }
+
+  if (pcapFileName.compare(0, 10, "synthetic:") == 0)
+  {
+    pcapFileName = WriteSyntheticPcap(pcapFileName, correctionFileName);
+    if (pcapFileName.empty())
+    {
+      return 1;
+    }
+  }
+
+  PacketsInMemory packets;
+  if (!packets.Load(pcapFileName, interpreter))
+  {
+    std::cerr << "No lidar packet could be read from " << pcapFileName << std::endl;
+    return 1;
+  }
+  std::cout << "Pcap: " << pcapFileName << std::endl
+            << "Lidar packets: " << packets.Packets.size() << std::endl;
+
+  // frame catalog
+  Report("PreProcessPacket", nbRepetitions, [&]()
+  {
+    StageRun run;
+    std::vector<FrameInformation> frameCatalog;
+    interpreter->ResetParserMetaData();
+    for (const RawPacket& packet : packets.Packets)
+    {
+      interpreter->PreProcessPacket(packet.Data, packet.Length, fpos_t(), 0, &frameCatalog);
+    }
+    run.NumberOfPackets = packets.Packets.size();
+    run.NumberOfFrames = frameCatalog.size();
+    return run;
+  });
+
+  // decoding packet by packet, the frames being split when complete
+  Report("ProcessPacket+SplitFrame", nbRepetitions, [&]()
+  {
+    StageRun run;
+    interpreter->ResetParserMetaData();
+    interpreter->ResetCurrentFrame();
+    interpreter->ClearAllFramesAvailable();
+    for (const RawPacket& packet : packets.Packets)
+    {
+      interpreter->ProcessPacket(packet.Data, packet.Length);
+      CollectFrames(interpreter, run);
+    }
+    interpreter->SplitFrame(true);
+    CollectFrames(interpreter, run);
+    run.NumberOfPackets = packets.Packets.size();
+    return run;
+  });
+
+  // batched decoding, as done by vtkLidarReader
+  Report("ProcessPackets", nbRepetitions, [&]()
+  {
+    StageRun run;
+    interpreter->ResetParserMetaData();
+    interpreter->ResetCurrentFrame();
+    interpreter->ClearAllFramesAvailable();
+    const size_t nbPackets = packets.Packets.size();
+    for (size_t processed = 0; processed < nbPackets; )
+    {
+      processed += std::max<size_t>(1, interpreter->ProcessPackets(packets.Packets.data() + processed,
+                                                                    std::min<size_t>(32, nbPackets - processed)));
+      CollectFrames(interpreter, run);
+    }
+    interpreter->SplitFrame(true);
+    CollectFrames(interpreter, run);
+    run.NumberOfPackets = nbPackets;
+    return run;
+  });
+
+  // whole reader, without its cache so that each frame is decoded
+  vtkNew<vtkLidarReader> reader;
+  reader->SetInterpreter(vtkSmartPointer<vtkVelodynePacketInterpreter>::New());
+  reader->SetFileName(pcapFileName);
+  // do not write the sidecar of the frame catalog next to the test data
+  reader->SetUseFrameIndexCache(false);
+  reader->SetCalibrationFileName(correctionFileName);
+  reader->SetUseMemoryMapping(true);
+  reader->SetFrameCacheSize(0);
+  reader->SetNumberOfFramesToPrefetch(0);
+  reader->Update();
+  const int nbFrames = reader->GetNumberOfFrames();
+  if (nbFrames == 0)
+  {
+    std::cerr << "The reader could not find any frame in " << pcapFileName << std::endl;
+    return 1;
+  }
+  reader->Open();
+  Report("vtkLidarReader::GetFrame", nbRepetitions, [&]()
+  {
+    StageRun run;
+    for (int frame = 0; frame < nbFrames; ++frame)
+    {
+      vtkSmartPointer<vtkPolyData> polyData = reader->GetFrame(frame);
+      run.NumberOfPoints += polyData ? polyData->GetNumberOfPoints() : 0;
+    }
+    run.NumberOfPackets = packets.Packets.size();
+    run.NumberOfFrames = nbFrames;
+    return run;
+  });
+  reader->Close();
+
+  return 0;
+}
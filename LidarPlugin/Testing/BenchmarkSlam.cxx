@@ -0,0 +1,811 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Measure the speed and the accuracy of the SLAM over a list of datasets, for each
+// combination of a sweep of its parameters. A dataset is either a pcap with the
+// calibration of its sensor, or a KITTI sequence read by vtkLidarKITTIDataSetReader,
+// with a ground truth trajectory in one of these formats:
+// - a KITTI poses file (.txt), optionally moved to the lidar frame with the "Tr"
+//   matrix of the calib.txt of the sequence
+// - a trajectory file read by vtkTemporalTransformsReader (.csv or .lvtraj)
+// - a polydata whose points are the positions of the frames (.vtp), as RefSlam.vtp
+//
+// The frames are decoded before being given to the SLAM, so that only the SLAM is
+// timed. For each run, the wall time of each stage measured by SlamTimings is
+// reported next to the drift against the ground truth:
+// - the absolute trajectory error (ATE), after a rigid alignment of the positions
+// - the relative pose error (RPE) over a number of frames, in translation and in
+//   rotation, and the drift as a percentage of the distance traveled. Without the
+//   orientations of the ground truth, only the translation is compared, in the
+//   aligned frame.
+//
+// The configuration is a JSON file:
+//   {
+//     "datasets": [
+//       { "name": "kitti-00", "type": "kitti", "path": ".../sequences/00/velodyne",
+//         "groundTruth": ".../poses/00.txt", "groundTruthCalibration": ".../sequences/00/calib.txt" },
+//       { "name": "vlp16", "type": "pcap", "path": "slam.pcap", "calibration": "VLP-16.xml",
+//         "groundTruth": "RefSlam.vtp", "firstFrame": 1, "lastFrame": 50, "groundTruthFirstFrame": 1,
+//         "maximumATE": 0.5 }
+//     ],
+//     "parameters": { "FastSlam": 1 },
+//     "sweep": { "VoxelGridLeafSizeEdges": [0.3, 0.6], "MappingICPMaxIter": [3, 5] },
+//     "rpeDelta": 10
+//   }
+// The relative paths are relative to the configuration file. The frame n of a dataset
+// is compared to the pose n - groundTruthFirstFrame of its ground truth.
+//
+// Each run is printed as a line which can be parsed:
+//   BENCHMARK slam <dataset> <parameters> frames/s=<n> ate=<m> rpe=<m> drift=<%> allocations/frame=<n>
+// and all the runs are written to <output>.json and <output>.csv, with a label, for
+// instance the commit, to compare the results of several commits.
+// The allocations of AddFrame are only counted when the plugin is built with
+// ENABLE_allocation_tracking (see AllocationTracker), they are reported as 0 otherwise.
+// The program returns 1 if a dataset can not be read or if its ATE exceeds maximumATE.
+
+#include "AllocationTracker.h"
+#include "vtkEigenTools.h"
+#include "vtkLidarKITTIDataSetReader.h"
+#include "vtkLidarReader.h"
+#include "vtkSlam.h"
+#include "vtkTemporalTransforms.h"
+#include "vtkTemporalTransformsReader.h"
+#include "vtkVelodynePacketInterpreter.h"
+#include "Slam.h"
+
+#include <vtkDataArray.h>
+#include <vtkMath.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTable.h>
+#include <vtkXMLPolyDataReader.h>
+#include <vtk_jsoncpp.h>
+
+#include <Eigen/Geometry>
+#include <Eigen/StdVector>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+typedef std::map<std::string, double> ParameterSet;
+typedef std::vector<Eigen::Isometry3d, Eigen::aligned_allocator<Eigen::Isometry3d> > PoseVector;
+
+//-----------------------------------------------------------------------------
+// Parameters of the SLAM which can be set or swept, by name
+const std::map<std::string, std::function<void(Slam&, double)> >& GetParameterSetters()
+{
+#define DOUBLE_PARAMETER(name) { #name, [](Slam& slam, double value) { slam.Set##name(value); } }
+#define UNSIGNED_PARAMETER(name) \
+  { #name, [](Slam& slam, double value) { slam.Set##name(static_cast<unsigned int>(value)); } }
+#define BOOL_PARAMETER(name) { #name, [](Slam& slam, double value) { slam.Set##name(value != 0); } }
+  static const std::map<std::string, std::function<void(Slam&, double)> > setters = {
+    DOUBLE_PARAMETER(VoxelGridLeafSizeEdges),
+    DOUBLE_PARAMETER(VoxelGridLeafSizePlanes),
+    DOUBLE_PARAMETER(VoxelGridLeafSizeBlobs),
+    DOUBLE_PARAMETER(VoxelGridResolution),
+    UNSIGNED_PARAMETER(VoxelGridSize),
+    DOUBLE_PARAMETER(MaxDistBetweenTwoFrames),
+    DOUBLE_PARAMETER(MaxDistanceForICPMatching),
+    BOOL_PARAMETER(FastSlam),
+    BOOL_PARAMETER(Undistortion),
+    BOOL_PARAMETER(AnalyticJacobians),
+    DOUBLE_PARAMETER(KeyframeDistance),
+    DOUBLE_PARAMETER(KeyframeAngle),
+    DOUBLE_PARAMETER(KeyframeMinOverlap),
+    BOOL_PARAMETER(KeyframeSkipMapping),
+    UNSIGNED_PARAMETER(NumberOfThreads),
+    { "MapBackend", [](Slam& slam, double value) { slam.SetMapBackend(static_cast<int>(value)); } },
+    UNSIGNED_PARAMETER(EgoMotionLMMaxIter),
+    UNSIGNED_PARAMETER(EgoMotionICPMaxIter),
+    UNSIGNED_PARAMETER(EgoMotionLineDistanceNbrNeighbors),
+    UNSIGNED_PARAMETER(EgoMotionMinimumLineNeighborRejection),
+    UNSIGNED_PARAMETER(EgoMotionPlaneDistanceNbrNeighbors),
+    DOUBLE_PARAMETER(EgoMotionMaxLineDistance),
+    DOUBLE_PARAMETER(EgoMotionMaxPlaneDistance),
+    UNSIGNED_PARAMETER(MappingLMMaxIter),
+    UNSIGNED_PARAMETER(MappingICPMaxIter),
+    UNSIGNED_PARAMETER(MappingCoarseICPIter),
+    DOUBLE_PARAMETER(MappingCoarseLeafSize),
+    UNSIGNED_PARAMETER(MappingLineDistanceNbrNeighbors),
+    UNSIGNED_PARAMETER(MappingMinimumLineNeighborRejection),
+    UNSIGNED_PARAMETER(MappingPlaneDistanceNbrNeighbors),
+    DOUBLE_PARAMETER(MappingMaxLineDistance),
+    DOUBLE_PARAMETER(MappingMaxPlaneDistance),
+    DOUBLE_PARAMETER(MappingLineMaxDistInlier),
+  };
+#undef DOUBLE_PARAMETER
+#undef UNSIGNED_PARAMETER
+#undef BOOL_PARAMETER
+  return setters;
+}
+
+//-----------------------------------------------------------------------------
+struct Dataset
+{
+  std::string Name;
+  std::string Type;
+  std::string Path;
+  std::string Calibration;
+  std::string GroundTruth;
+  std::string GroundTruthCalibration;
+  int GroundTruthFirstFrame = 0;
+  int FirstFrame = 0;
+  int LastFrame = -1;
+  double MaximumATE = -1;
+};
+
+//-----------------------------------------------------------------------------
+// Poses of a trajectory, the orientations are the identity if they are not known
+struct Trajectory
+{
+  PoseVector Poses;
+  bool HasOrientations = false;
+};
+
+//-----------------------------------------------------------------------------
+struct Summary
+{
+  double Mean = 0;
+  double Median = 0;
+  double Percentile95 = 0;
+  double Max = 0;
+};
+
+//-----------------------------------------------------------------------------
+Summary Summarize(std::vector<double> values)
+{
+  Summary summary;
+  if (values.empty())
+  {
+    return summary;
+  }
+  std::sort(values.begin(), values.end());
+  double sum = 0;
+  for (double value : values)
+  {
+    sum += value;
+  }
+  summary.Mean = sum / values.size();
+  summary.Median = values[values.size() / 2];
+  summary.Percentile95 = values[std::min(values.size() - 1, static_cast<size_t>(0.95 * values.size()))];
+  summary.Max = values.back();
+  return summary;
+}
+
+//-----------------------------------------------------------------------------
+double RootMeanSquare(const std::vector<double>& values)
+{
+  if (values.empty())
+  {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  double sum = 0;
+  for (double value : values)
+  {
+    sum += value * value;
+  }
+  return std::sqrt(sum / values.size());
+}
+
+//-----------------------------------------------------------------------------
+std::string ResolvePath(const std::string& path, const std::string& directory)
+{
+  if (path.empty() || path[0] == '/' || (path.size() > 1 && path[1] == ':'))
+  {
+    return path;
+  }
+  return directory + path;
+}
+
+//-----------------------------------------------------------------------------
+bool HasExtension(const std::string& filename, const std::string& extension)
+{
+  return filename.size() >= extension.size() &&
+         filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+//-----------------------------------------------------------------------------
+// Read the 3x4 matrices of a line, as the poses and the calibration of KITTI
+bool ReadMatrix(std::istream& stream, Eigen::Isometry3d& pose)
+{
+  Eigen::Matrix4d matrix = Eigen::Matrix4d::Identity();
+  for (int i = 0; i < 12; ++i)
+  {
+    if (!(stream >> matrix(i / 4, i % 4)))
+    {
+      return false;
+    }
+  }
+  pose.matrix() = matrix;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool ReadKITTIPoses(const std::string& filename, const std::string& calibration, Trajectory& trajectory)
+{
+  // the poses are the ones of the left camera, Tr moves the lidar points to its frame
+  Eigen::Isometry3d lidarToCamera = Eigen::Isometry3d::Identity();
+  if (!calibration.empty())
+  {
+    std::ifstream calibrationFile(calibration);
+    std::string line;
+    bool found = false;
+    while (!found && std::getline(calibrationFile, line))
+    {
+      if (line.compare(0, 3, "Tr:") == 0)
+      {
+        std::istringstream values(line.substr(3));
+        found = ReadMatrix(values, lidarToCamera);
+      }
+    }
+    if (!found)
+    {
+      std::cerr << "No Tr matrix in " << calibration << std::endl;
+      return false;
+    }
+  }
+
+  std::ifstream file(filename);
+  std::string line;
+  while (std::getline(file, line))
+  {
+    std::istringstream values(line);
+    Eigen::Isometry3d pose;
+    if (!ReadMatrix(values, pose))
+    {
+      continue;
+    }
+    trajectory.Poses.push_back(lidarToCamera.inverse() * pose * lidarToCamera);
+  }
+  trajectory.HasOrientations = true;
+  return !trajectory.Poses.empty();
+}
+
+//-----------------------------------------------------------------------------
+bool ReadGroundTruth(const Dataset& dataset, Trajectory& trajectory)
+{
+  if (HasExtension(dataset.GroundTruth, ".txt"))
+  {
+    return ReadKITTIPoses(dataset.GroundTruth, dataset.GroundTruthCalibration, trajectory);
+  }
+
+  if (HasExtension(dataset.GroundTruth, ".vtp"))
+  {
+    auto reader = vtkSmartPointer<vtkXMLPolyDataReader>::New();
+    reader->SetFileName(dataset.GroundTruth.c_str());
+    reader->Update();
+    vtkPolyData* positions = reader->GetOutput();
+    for (vtkIdType i = 0; positions && i < positions->GetNumberOfPoints(); ++i)
+    {
+      Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+      positions->GetPoint(i, pose.translation().data());
+      trajectory.Poses.push_back(pose);
+    }
+    trajectory.HasOrientations = false;
+    return !trajectory.Poses.empty();
+  }
+
+  vtkSmartPointer<vtkTemporalTransforms> transforms =
+    vtkTemporalTransformsReader::OpenTemporalTransforms(dataset.GroundTruth);
+  if (!transforms)
+  {
+    return false;
+  }
+  for (vtkIdType i = 0; i < transforms->GetNumberOfPoints(); ++i)
+  {
+    // the orientations are stored as an axis followed by an angle
+    double orientation[4];
+    transforms->GetOrientationArray()->GetTuple(i, orientation);
+    Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+    pose.linear() = Eigen::AngleAxisd(orientation[3],
+      Eigen::Vector3d(orientation[0], orientation[1], orientation[2]).normalized()).toRotationMatrix();
+    transforms->GetTranslationArray()->GetTuple(i, pose.translation().data());
+    trajectory.Poses.push_back(pose);
+  }
+  trajectory.HasOrientations = true;
+  return !trajectory.Poses.empty();
+}
+
+//-----------------------------------------------------------------------------
+// Errors of an estimated trajectory against the ground truth, in meters and degrees
+struct TrajectoryErrors
+{
+  size_t NumberOfPoses = 0;
+  double ATE = std::numeric_limits<double>::quiet_NaN();
+  double MaximumATE = std::numeric_limits<double>::quiet_NaN();
+  double RPETranslation = std::numeric_limits<double>::quiet_NaN();
+  double RPERotation = std::numeric_limits<double>::quiet_NaN();
+  double Drift = std::numeric_limits<double>::quiet_NaN();
+};
+
+//-----------------------------------------------------------------------------
+TrajectoryErrors ComputeErrors(const PoseVector& estimated, const PoseVector& groundTruth,
+                               bool hasOrientations, size_t delta)
+{
+  TrajectoryErrors errors;
+  const size_t n = std::min(estimated.size(), groundTruth.size());
+  errors.NumberOfPoses = n;
+  if (n == 0)
+  {
+    return errors;
+  }
+
+  // rigid alignment of the estimated positions on the ground truth
+  Eigen::Matrix3Xd source(3, n), target(3, n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    source.col(i) = estimated[i].translation();
+    target.col(i) = groundTruth[i].translation();
+  }
+  Eigen::Isometry3d alignment = Eigen::Isometry3d::Identity();
+  if (n >= 3)
+  {
+    alignment.matrix() = Eigen::umeyama(source, target, false);
+  }
+
+  std::vector<double> absoluteErrors(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    absoluteErrors[i] = (alignment * source.col(i) - target.col(i)).norm();
+  }
+  errors.ATE = RootMeanSquare(absoluteErrors);
+  errors.MaximumATE = *std::max_element(absoluteErrors.begin(), absoluteErrors.end());
+
+  // distance traveled along the ground truth since the first pose
+  std::vector<double> distances(n, 0.);
+  for (size_t i = 1; i < n; ++i)
+  {
+    distances[i] = distances[i - 1] + (target.col(i) - target.col(i - 1)).norm();
+  }
+
+  std::vector<double> translationErrors, rotationErrors, drifts;
+  for (size_t i = 0; i + delta < n; ++i)
+  {
+    const size_t j = i + delta;
+    double translationError;
+    if (hasOrientations)
+    {
+      const Eigen::Isometry3d error = (groundTruth[i].inverse() * groundTruth[j]).inverse() *
+                                      (estimated[i].inverse() * estimated[j]);
+      translationError = error.translation().norm();
+      rotationErrors.push_back(vtkMath::DegreesFromRadians(Eigen::AngleAxisd(error.linear()).angle()));
+    }
+    else
+    {
+      translationError = (alignment.linear() * (source.col(j) - source.col(i)) -
+                          (target.col(j) - target.col(i))).norm();
+    }
+    translationErrors.push_back(translationError);
+    const double length = distances[j] - distances[i];
+    if (length > 1e-3)
+    {
+      drifts.push_back(100. * translationError / length);
+    }
+  }
+  errors.RPETranslation = RootMeanSquare(translationErrors);
+  errors.RPERotation = RootMeanSquare(rotationErrors);
+  if (!drifts.empty())
+  {
+    errors.Drift = Summarize(drifts).Mean;
+  }
+  return errors;
+}
+
+//-----------------------------------------------------------------------------
+// Reader of the frames of a dataset, with the laser mapping of its sensor
+struct FrameSource
+{
+  vtkSmartPointer<vtkLidarReader> Reader;
+  std::vector<size_t> LaserIdMapping;
+  int FirstFrame = 0;
+  int LastFrame = -1;
+};
+
+//-----------------------------------------------------------------------------
+bool OpenDataset(const Dataset& dataset, FrameSource& source)
+{
+  if (dataset.Type == "kitti")
+  {
+    auto reader = vtkSmartPointer<vtkLidarKITTIDataSetReader>::New();
+    reader->SetFileName(dataset.Path);
+    reader->UpdateInformation();
+    // the scan lines of a KITTI scan are read from the top laser to the bottom one
+    source.LaserIdMapping.resize(reader->GetNbrLaser());
+    for (size_t i = 0; i < source.LaserIdMapping.size(); ++i)
+    {
+      source.LaserIdMapping[i] = i;
+    }
+    source.Reader = reader;
+  }
+  else if (dataset.Type == "pcap")
+  {
+    auto reader = vtkSmartPointer<vtkLidarReader>::New();
+    reader->SetInterpreter(vtkSmartPointer<vtkVelodynePacketInterpreter>::New());
+    reader->SetFileName(dataset.Path);
+    // do not write the sidecar of the frame catalog next to the datasets
+    reader->SetUseFrameIndexCache(false);
+    reader->SetCalibrationFileName(dataset.Calibration);
+    reader->Update();
+    vtkTable* calibration = vtkTable::SafeDownCast(reader->GetOutputDataObject(1));
+    auto array = calibration ?
+      vtkDataArray::SafeDownCast(calibration->GetColumnByName("verticalCorrection")) : nullptr;
+    if (array)
+    {
+      std::vector<double> verticalCorrection(array->GetNumberOfTuples());
+      for (vtkIdType i = 0; i < array->GetNumberOfTuples(); ++i)
+      {
+        verticalCorrection[i] = array->GetTuple1(i);
+      }
+      source.LaserIdMapping = sortIdx(verticalCorrection);
+    }
+    source.Reader = reader;
+  }
+  else
+  {
+    std::cerr << "Unknown type of dataset " << dataset.Type << std::endl;
+    return false;
+  }
+
+  const int numberOfFrames = source.Reader->GetNumberOfFrames();
+  source.FirstFrame = std::max(0, dataset.FirstFrame);
+  source.LastFrame = dataset.LastFrame < 0 ? numberOfFrames - 1 : std::min(dataset.LastFrame, numberOfFrames - 1);
+  return numberOfFrames > 0 && source.FirstFrame <= source.LastFrame;
+}
+
+//-----------------------------------------------------------------------------
+// Result of the SLAM over a dataset with a set of parameters
+struct Run
+{
+  std::string Dataset;
+  ParameterSet Parameters;
+  size_t NumberOfFrames = 0;
+  double SlamTime = 0;
+  uint64_t NumberOfAllocations = 0;
+  uint64_t AllocatedBytes = 0;
+  std::vector<double> FrameTimes;
+  std::vector<std::vector<double> > StageTimes = std::vector<std::vector<double> >(NbrSlamStages);
+  TrajectoryErrors Errors;
+};
+
+//-----------------------------------------------------------------------------
+Run RunSlam(const Dataset& dataset, FrameSource& source, const Trajectory& groundTruth,
+            const ParameterSet& parameters, size_t rpeDelta)
+{
+  Run run;
+  run.Dataset = dataset.Name;
+  run.Parameters = parameters;
+
+  Slam slam;
+  for (const auto& parameter : parameters)
+  {
+    GetParameterSetters().at(parameter.first)(slam, parameter.second);
+  }
+
+  PoseVector estimated, matched;
+  for (int frame = source.FirstFrame; frame <= source.LastFrame; ++frame)
+  {
+    const int groundTruthIndex = frame - dataset.GroundTruthFirstFrame;
+    if (groundTruthIndex >= static_cast<int>(groundTruth.Poses.size()))
+    {
+      break;
+    }
+
+    vtkSmartPointer<vtkPolyData> polyData = source.Reader->GetFrame(frame);
+    pcl::PointCloud<Slam::Point>::Ptr pc(new pcl::PointCloud<Slam::Point>);
+    PointCloudFromPolyData(polyData, pc);
+    if (pc->empty())
+    {
+      continue;
+    }
+
+    const AllocationTracker::Counters allocationsBefore = AllocationTracker::GetProcessCounters();
+    const auto start = std::chrono::steady_clock::now();
+    slam.AddFrame(pc, source.LaserIdMapping);
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const AllocationTracker::Counters allocationsAfter = AllocationTracker::GetProcessCounters();
+    run.NumberOfAllocations += allocationsAfter.NumberOfAllocations - allocationsBefore.NumberOfAllocations;
+    run.AllocatedBytes += allocationsAfter.AllocatedBytes - allocationsBefore.AllocatedBytes;
+    run.SlamTime += elapsed;
+    run.FrameTimes.push_back(elapsed);
+    for (int stage = 0; stage < NbrSlamStages; ++stage)
+    {
+      run.StageTimes[stage].push_back(slam.GetTimings().GetLastFrameTime(static_cast<SlamStage>(stage)));
+    }
+
+    if (groundTruthIndex >= 0)
+    {
+      const Transform world = slam.GetWorldTransform();
+      Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+      pose.linear() = RollPitchYawToMatrix(world.rx, world.ry, world.rz);
+      pose.translation() = Eigen::Vector3d(world.x, world.y, world.z);
+      estimated.push_back(pose);
+      matched.push_back(groundTruth.Poses[groundTruthIndex]);
+    }
+  }
+  run.NumberOfFrames = run.FrameTimes.size();
+  run.Errors = ComputeErrors(estimated, matched, groundTruth.HasOrientations, rpeDelta);
+  return run;
+}
+
+//-----------------------------------------------------------------------------
+// Every combination of the values of the swept parameters, added to the fixed ones
+std::vector<ParameterSet> ExpandSweep(const ParameterSet& fixed,
+                                      const std::map<std::string, std::vector<double> >& sweep)
+{
+  std::vector<ParameterSet> combinations(1, fixed);
+  for (const auto& parameter : sweep)
+  {
+    std::vector<ParameterSet> expanded;
+    for (const ParameterSet& combination : combinations)
+    {
+      for (double value : parameter.second)
+      {
+        expanded.push_back(combination);
+        expanded.back()[parameter.first] = value;
+      }
+    }
+    combinations.swap(expanded);
+  }
+  return combinations;
+}
+
+//-----------------------------------------------------------------------------
+std::string FormatParameters(const ParameterSet& parameters)
+{
+  std::ostringstream text;
+  for (const auto& parameter : parameters)
+  {
+    text << (text.tellp() > 0 ? "," : "") << parameter.first << "=" << parameter.second;
+  }
+  return parameters.empty() ? std::string("default") : text.str();
+}
+
+//-----------------------------------------------------------------------------
+Json::Value SummaryToJson(const Summary& summary)
+{
+  Json::Value value;
+  value["mean"] = summary.Mean;
+  value["median"] = summary.Median;
+  value["p95"] = summary.Percentile95;
+  value["max"] = summary.Max;
+  return value;
+}
+
+//-----------------------------------------------------------------------------
+// NaN is not valid JSON, unknown errors are written as null
+Json::Value NumberToJson(double value)
+{
+  return std::isnan(value) ? Json::Value() : Json::Value(value);
+}
+
+//-----------------------------------------------------------------------------
+bool WriteResults(const std::string& output, const std::string& label, size_t rpeDelta,
+                  const std::vector<std::string>& parameterNames, const std::vector<Run>& runs)
+{
+  Json::Value root;
+  root["label"] = label;
+  root["rpeDelta"] = static_cast<Json::UInt64>(rpeDelta);
+  Json::Value jsonRuns(Json::arrayValue);
+
+  std::ofstream csv(output + ".csv");
+  csv << "label,dataset";
+  for (const std::string& name : parameterNames)
+  {
+    csv << "," << name;
+  }
+  csv << ",frames,slam_time_s,frames_per_s,ate_rmse_m,ate_max_m,rpe_translation_rmse_m,"
+         "rpe_rotation_rmse_deg,drift_percent,frame_time_mean_ms,frame_time_p95_ms,"
+         "allocations_per_frame,allocated_bytes_per_frame";
+  for (int stage = 0; stage < NbrSlamStages; ++stage)
+  {
+    csv << "," << SlamTimings::GetStageName(static_cast<SlamStage>(stage)) << "_mean_ms";
+  }
+  csv << "\n";
+
+  for (const Run& run : runs)
+  {
+    const Summary frameTime = Summarize(run.FrameTimes);
+    const double framesPerSecond = run.SlamTime > 0 ? run.NumberOfFrames / run.SlamTime : 0;
+    const uint64_t allocationsPerFrame = run.NumberOfFrames ? run.NumberOfAllocations / run.NumberOfFrames : 0;
+    const uint64_t bytesPerFrame = run.NumberOfFrames ? run.AllocatedBytes / run.NumberOfFrames : 0;
+
+    Json::Value jsonRun;
+    jsonRun["dataset"] = run.Dataset;
+    Json::Value parameters(Json::objectValue);
+    for (const auto& parameter : run.Parameters)
+    {
+      parameters[parameter.first] = parameter.second;
+    }
+    jsonRun["parameters"] = parameters;
+    jsonRun["frames"] = static_cast<Json::UInt64>(run.NumberOfFrames);
+    jsonRun["slamTime"] = run.SlamTime;
+    jsonRun["framesPerSecond"] = framesPerSecond;
+    jsonRun["frameTime"] = SummaryToJson(frameTime);
+    jsonRun["allocationsPerFrame"] = static_cast<Json::UInt64>(allocationsPerFrame);
+    jsonRun["allocatedBytesPerFrame"] = static_cast<Json::UInt64>(bytesPerFrame);
+    Json::Value stages;
+    for (int stage = 0; stage < NbrSlamStages; ++stage)
+    {
+      stages[SlamTimings::GetStageName(static_cast<SlamStage>(stage))] =
+        SummaryToJson(Summarize(run.StageTimes[stage]));
+    }
+    jsonRun["stages"] = stages;
+    jsonRun["poses"] = static_cast<Json::UInt64>(run.Errors.NumberOfPoses);
+    jsonRun["ate"]["rmse"] = NumberToJson(run.Errors.ATE);
+    jsonRun["ate"]["max"] = NumberToJson(run.Errors.MaximumATE);
+    jsonRun["rpe"]["translationRMSE"] = NumberToJson(run.Errors.RPETranslation);
+    jsonRun["rpe"]["rotationRMSE"] = NumberToJson(run.Errors.RPERotation);
+    jsonRun["rpe"]["drift"] = NumberToJson(run.Errors.Drift);
+    jsonRuns.append(jsonRun);
+
+    csv << label << "," << run.Dataset;
+    for (const std::string& name : parameterNames)
+    {
+      auto value = run.Parameters.find(name);
+      csv << ",";
+      if (value != run.Parameters.end())
+      {
+        csv << value->second;
+      }
+    }
+    csv << "," << run.NumberOfFrames << "," << run.SlamTime << "," << framesPerSecond << ","
+        << run.Errors.ATE << "," << run.Errors.MaximumATE << "," << run.Errors.RPETranslation << ","
+        << run.Errors.RPERotation << "," << run.Errors.Drift << "," << 1e3 * frameTime.Mean << ","
+        << 1e3 * frameTime.Percentile95 << "," << allocationsPerFrame << "," << bytesPerFrame;
+    for (int stage = 0; stage < NbrSlamStages; ++stage)
+    {
+      csv << "," << 1e3 * Summarize(run.StageTimes[stage]).Mean;
+    }
+    csv << "\n";
+  }
+  root["runs"] = jsonRuns;
+
+  std::ofstream json(output + ".json");
+  json << root;
+  return static_cast<bool>(json) && static_cast<bool>(csv);
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 3 || argc > 4)
+  {
+    std::cerr << "Wrong number of arguments. Usage: "
+              << "BenchmarkSlam <configuration.json> <output prefix> [label]" << std::endl;
+    return 1;
+  }
+  const std::string configurationFileName = argv[1];
+  const std::string output = argv[2];
+  const std::string label = argc == 4 ? argv[3] : "";
+
+  Json::Value configuration;
+  {
+    std::ifstream file(configurationFileName);
+    Json::Reader reader;
+    if (!file || !reader.parse(file, configuration))
+    {
+      std::cerr << "Could not read " << configurationFileName << std::endl;
+      return 1;
+    }
+  }
+  const size_t slash = configurationFileName.find_last_of("/\\");
+  const std::string directory =
+    slash == std::string::npos ? std::string() : configurationFileName.substr(0, slash + 1);
+
+  // parameters, checked before anything is run
+  ParameterSet fixed;
+  std::map<std::string, std::vector<double> > sweep;
+  std::vector<std::string> parameterNames;
+  for (const std::string& name : configuration["parameters"].getMemberNames())
+  {
+    fixed[name] = configuration["parameters"][name].asDouble();
+    parameterNames.push_back(name);
+  }
+  for (const std::string& name : configuration["sweep"].getMemberNames())
+  {
+    for (const Json::Value& value : configuration["sweep"][name])
+    {
+      sweep[name].push_back(value.asDouble());
+    }
+    if (!fixed.count(name))
+    {
+      parameterNames.push_back(name);
+    }
+  }
+  for (const std::string& name : parameterNames)
+  {
+    if (!GetParameterSetters().count(name))
+    {
+      std::cerr << "Unknown SLAM parameter " << name << std::endl;
+      return 1;
+    }
+  }
+  const std::vector<ParameterSet> combinations = ExpandSweep(fixed, sweep);
+  const size_t rpeDelta = std::max(1u, configuration.get("rpeDelta", 10).asUInt());
+
+  int retVal = 0;
+  std::vector<Run> runs;
+  for (const Json::Value& item : configuration["datasets"])
+  {
+    Dataset dataset;
+    dataset.Name = item["name"].asString();
+    dataset.Type = item.get("type", "pcap").asString();
+    dataset.Path = ResolvePath(item["path"].asString(), directory);
+    dataset.Calibration = ResolvePath(item["calibration"].asString(), directory);
+    dataset.GroundTruth = ResolvePath(item["groundTruth"].asString(), directory);
+    dataset.GroundTruthCalibration = ResolvePath(item["groundTruthCalibration"].asString(), directory);
+    dataset.GroundTruthFirstFrame = item.get("groundTruthFirstFrame", 0).asInt();
+    dataset.FirstFrame = item.get("firstFrame", 0).asInt();
+    dataset.LastFrame = item.get("lastFrame", -1).asInt();
+    dataset.MaximumATE = item.get("maximumATE", -1).asDouble();
+
+    FrameSource source;
+    Trajectory groundTruth;
+    if (!OpenDataset(dataset, source))
+    {
+      std::cerr << "ERROR, no frame could be read from the dataset " << dataset.Name << std::endl;
+      retVal += 1;
+      continue;
+    }
+    if (!ReadGroundTruth(dataset, groundTruth))
+    {
+      std::cerr << "ERROR, the ground truth of the dataset " << dataset.Name
+                << " could not be read from " << dataset.GroundTruth << std::endl;
+      retVal += 1;
+      continue;
+    }
+
+    for (const ParameterSet& parameters : combinations)
+    {
+      runs.push_back(RunSlam(dataset, source, groundTruth, parameters, rpeDelta));
+      const Run& run = runs.back();
+      std::cout << "BENCHMARK slam " << dataset.Name << " " << FormatParameters(parameters)
+                << std::fixed << std::setprecision(3)
+                << " frames/s=" << (run.SlamTime > 0 ? run.NumberOfFrames / run.SlamTime : 0)
+                << " ate=" << run.Errors.ATE << " rpe=" << run.Errors.RPETranslation
+                << " drift=" << run.Errors.Drift << std::defaultfloat
+                << " allocations/frame=" << (run.NumberOfFrames ? run.NumberOfAllocations / run.NumberOfFrames : 0)
+                << std::endl;
+      if (dataset.MaximumATE >= 0 && !(run.Errors.ATE <= dataset.MaximumATE))
+      {
+        std::cerr << "ERROR, the ATE of " << dataset.Name << " with " << FormatParameters(parameters)
+                  << " is " << run.Errors.ATE << " m, more than " << dataset.MaximumATE << " m" << std::endl;
+        retVal += 1;
+      }
+    }
+  }
+
+  if (!WriteResults(output, label, rpeDelta, parameterNames, runs))
+  {
+    std::cerr << "Could not write the results to " << output << ".json and " << output << ".csv" << std::endl;
+    return 1;
+  }
+  return retVal;
+}
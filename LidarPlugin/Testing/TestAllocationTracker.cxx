@@ -0,0 +1,92 @@
+#include "AllocationTracker.h"
+#include "PipelineProfiler.h"
+#include "TestCheck.h"
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+//! Make 2 * count + 1 allocations, count of them of size bytes, which the compiler can not elide
+void Allocate(int count, size_t size)
+{
+  std::vector<std::unique_ptr<std::vector<char> > > blocks;
+  blocks.reserve(count);
+  for (int i = 0; i < count; ++i)
+  {
+    blocks.emplace_back(new std::vector<char>(size));
+  }
+}
+}
+
+int main()
+{
+  int retVal = 0;
+  const bool enabled = AllocationTracker::IsEnabled();
+
+  // the counters of the thread only see its own allocations
+  const AllocationTracker::Counters before = AllocationTracker::GetThreadCounters();
+  std::thread other([]() { Allocate(100, 64); });
+  other.join();
+  const AllocationTracker::Counters afterOther = AllocationTracker::GetThreadCounters();
+  Allocate(10, 1000);
+  const AllocationTracker::Counters after = AllocationTracker::GetThreadCounters();
+  const uint64_t threadAllocations = after.NumberOfAllocations - afterOther.NumberOfAllocations;
+  const uint64_t threadBytes = after.AllocatedBytes - afterOther.AllocatedBytes;
+  if (enabled)
+  {
+    // joining the thread may allocate, but not a hundred times
+    retVal += Check(afterOther.NumberOfAllocations - before.NumberOfAllocations < 100,
+                    "the allocations of another thread are counted");
+    retVal += Check(threadAllocations == 21, std::to_string(threadAllocations) + " allocations instead of 21");
+    retVal += Check(threadBytes >= 10000, std::to_string(threadBytes) + " bytes allocated");
+    retVal += Check(AllocationTracker::GetProcessCounters().NumberOfAllocations >= after.NumberOfAllocations + 100,
+                    "the allocations of the process are not counted");
+  }
+  else
+  {
+    retVal += Check(threadAllocations == 0 && threadBytes == 0, "allocations counted without tracking");
+  }
+
+  // a scope is charged the allocations of its nested scopes
+  PipelineProfiler* profiler = PipelineProfiler::GetInstance();
+  const int outerId = profiler->Register("outer");
+  const int innerId = profiler->Register("inner");
+  profiler->SetEnabled(true);
+  profiler->Begin(outerId);
+  Allocate(5, 100);
+  profiler->Begin(innerId);
+  Allocate(20, 100);
+  profiler->End(innerId);
+  profiler->End(outerId);
+  profiler->SetEnabled(false);
+
+  const std::vector<PipelineProfiler::Sample> samples = profiler->TakeSamples();
+  retVal += Check(samples.size() == 2, std::to_string(samples.size()) + " samples instead of 2");
+  for (const PipelineProfiler::Sample& sample : samples)
+  {
+    const std::string name = profiler->GetName(sample.Id);
+    if (!enabled)
+    {
+      retVal += Check(sample.NumberOfAllocations == 0 && sample.AllocatedBytes == 0,
+                      name + " has allocations without tracking");
+    }
+    else if (sample.Id == innerId)
+    {
+      retVal += Check(sample.NumberOfAllocations == 41,
+                      std::to_string(sample.NumberOfAllocations) + " allocations in the inner scope");
+      retVal += Check(sample.AllocatedBytes >= 2000, "the bytes of the inner scope are not counted");
+    }
+    else
+    {
+      // the beginning of the inner scope may allocate
+      retVal += Check(sample.NumberOfAllocations >= 52,
+                      std::to_string(sample.NumberOfAllocations) + " allocations in the outer scope");
+    }
+  }
+
+  return retVal;
+}
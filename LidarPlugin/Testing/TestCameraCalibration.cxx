@@ -4,6 +4,8 @@
 
 #include <Eigen/Dense>
 
+#include <algorithm>
+
 //----------------------------------------------------------------------------
 int TestFisheyeModelCalibration(std::string matchedFilename, std::string groundtruthFilename)
 {
@@ -34,8 +36,22 @@ int TestFisheyeModelCalibration(std::string matchedFilename, std::string groundt
   {
     Wf(i) = W(i);
   }
+  const Eigen::Matrix<double, 15, 1> Winit = Wf;
   NonLinearFisheyeCalibration(X, x, Wf);
 
+  // The residuals evaluated on all the cores give the same parameters as on
+  // a single thread, up to the order of the sums
+  Eigen::Matrix<double, 15, 1> Wst = Winit;
+  NonLinearFisheyeCalibration(X, x, Wst, 1000, 1);
+  for (int i = 0; i < 15; ++i)
+  {
+    if (std::abs(Wst(i) - Wf(i)) > 1e-6 * std::max(1.0, std::abs(Wf(i))))
+    {
+      std::cout << "Using a single thread: " << Wst(i) << " using all the cores: " << Wf(i) << std::endl;
+      return 1;
+    }
+  }
+
   // Load the expected parameters and test
   Eigen::VectorXd Wg;
   LoadCameraParamsFromCSV(groundtruthFilename, Wg);
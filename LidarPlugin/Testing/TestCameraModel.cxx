@@ -0,0 +1,99 @@
+#include "CameraModel.h"
+#include "CameraProjection.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+//! Same parameters as a typical calibrated camera: 11 pinhole parameters then the optics
+Eigen::VectorXd MakeParameters(ProjectionType type)
+{
+  Eigen::VectorXd W(type == ProjectionType::FishEye ? 15 : 17);
+  W.head(11) << 0.1, -0.05, 1.5, 0.3, -0.2, 1.1, 800, 810, 640, 360, 0.5;
+  if (type == ProjectionType::FishEye)
+  {
+    W.tail(4) << 0.05, -0.01, 0.002, -0.0005;
+  }
+  else
+  {
+    W.tail(6) << -0.2, 0.05, 0.001, -0.002, 0.01, 0.001;
+  }
+  return W;
+}
+}
+
+int main()
+{
+  int errors = 0;
+  std::mt19937 generator(5);
+  std::uniform_real_distribution<double> coordinate(-20, 20);
+
+  const int n = 1000;
+  std::vector<double> points(3 * n), x(n), y(n), z(n);
+  for (int i = 0; i < n; ++i)
+  {
+    x[i] = points[3 * i] = coordinate(generator);
+    y[i] = points[3 * i + 1] = coordinate(generator);
+    z[i] = points[3 * i + 2] = coordinate(generator);
+  }
+
+  for (ProjectionType type : { ProjectionType::BrownConradyPinhole, ProjectionType::FishEye })
+  {
+    const Eigen::VectorXd W = MakeParameters(type);
+    CameraModel model;
+    model.SetParams(W);
+    model.SetCameraModelType(type);
+
+    // the batch of separate coordinates is projected as the interleaved one
+    std::vector<double> pixels(2 * n), depths(n), u(n), v(n), batchDepths(n);
+    ProjectPoints(W, type, points.data(), n, pixels.data(), depths.data(), true);
+    model.Project(n, x.data(), y.data(), z.data(), u.data(), v.data(), batchDepths.data(), true);
+    bool projectionOk = true;
+    for (int i = 0; i < n; ++i)
+    {
+      projectionOk &= std::abs(u[i] - pixels[2 * i]) < 1e-6 && std::abs(v[i] - pixels[2 * i + 1]) < 1e-6
+                      && std::abs(batchDepths[i] - depths[i]) < 1e-9;
+    }
+    errors += Check(projectionOk, "Project differs from ProjectPoints");
+
+    // a pixel of the undistorted image comes from where the distorted model
+    // projects the points projected on it by the pinhole model
+    const int width = 1280, height = 720;
+    const float* mapU = nullptr;
+    const float* mapV = nullptr;
+    model.GetUndistortionMap(width, height, mapU, mapV);
+    bool mapOk = true;
+    for (int pv = 0; pv < height; pv += 37)
+    {
+      for (int pu = 0; pu < width; pu += 41)
+      {
+        // point seen on this pixel by the pinhole camera
+        const double yn = (pv - W(9)) / W(7);
+        const double xn = (pu - W(8) - W(10) * yn) / W(6);
+        const Eigen::Vector3d X = model.GetR() * Eigen::Vector3d(5 * xn, 5 * yn, 5) + model.GetT();
+        double du, dv;
+        model.Project(1, &X(0), &X(1), &X(2), &du, &dv);
+        mapOk &= std::abs(mapU[pu + width * pv] - du) < 1e-2 && std::abs(mapV[pu + width * pv] - dv) < 1e-2;
+      }
+    }
+    errors += Check(mapOk, "wrong undistortion map");
+
+    // undistorting an uniform image leaves it uniform where it is defined
+    std::vector<unsigned char> image(3 * width * height, 100), undistorted(image.size());
+    model.UndistortImage(image.data(), width, height, 3, undistorted.data());
+    const size_t center = 3 * (width / 2 + static_cast<size_t>(width) * (height / 2));
+    errors += Check(undistorted[center] == 100, "wrong undistorted image");
+
+    // the maps follow the model, the corner being moved by the distortion
+    const float cornerU = mapU[0];
+    model.SetOptics(Eigen::VectorXd::Zero(W.size() - 11));
+    model.GetUndistortionMap(width, height, mapU, mapV);
+    errors += Check(std::abs(mapU[0] - cornerU) > 1, "undistortion map not updated");
+  }
+  return errors;
+}
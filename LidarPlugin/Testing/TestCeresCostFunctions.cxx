@@ -0,0 +1,79 @@
+#include "CeresCostFunctions.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+
+namespace
+{
+//! Same residual and jacobian from both cost functions at the given parameters
+bool SameEvaluation(const ceres::CostFunction& analytic, const ceres::CostFunction& autoDiff, const double* w)
+{
+  double analyticResidual, autoDiffResidual;
+  double analyticJacobian[6], autoDiffJacobian[6];
+  double* analyticJacobians[1] = { analyticJacobian };
+  double* autoDiffJacobians[1] = { autoDiffJacobian };
+  const double* parameters[1] = { w };
+  if (!analytic.Evaluate(parameters, &analyticResidual, analyticJacobians)
+      || !autoDiff.Evaluate(parameters, &autoDiffResidual, autoDiffJacobians))
+  {
+    return false;
+  }
+  bool same = std::abs(analyticResidual - autoDiffResidual) < 1e-9 * (1 + std::abs(autoDiffResidual));
+  for (int i = 0; i < 6; ++i)
+  {
+    same &= std::abs(analyticJacobian[i] - autoDiffJacobian[i]) < 1e-8 * (1 + std::abs(autoDiffJacobian[i]));
+  }
+
+  // the residual alone
+  double residual;
+  same &= analytic.Evaluate(parameters, &residual, nullptr) && residual == analyticResidual;
+  return same;
+}
+}
+
+int main()
+{
+  int errors = 0;
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<double> coordinate(-10, 10);
+  std::uniform_real_distribution<double> angle(-M_PI, M_PI);
+  auto randomVector = [&]() { return Eigen::Vector3d(coordinate(generator), coordinate(generator), coordinate(generator)); };
+
+  bool mahalanobisOk = true, euclideanOk = true;
+  for (int k = 0; k < 1000; ++k)
+  {
+    // a variance covariance matrix, not necessarily symmetric to check the derivative of the quadratic form
+    const Eigen::Matrix3d M = Eigen::Matrix3d::Random();
+    const Eigen::Matrix3d A = M * M.transpose() + 0.1 * Eigen::Matrix3d::Random();
+    const Eigen::Vector3d C = randomVector(), X = randomVector(), Y = randomVector();
+    const double lambda = 0.1 + std::abs(coordinate(generator));
+    const double w[6] = { angle(generator), angle(generator), angle(generator),
+                          coordinate(generator), coordinate(generator), coordinate(generator) };
+
+    using namespace CostFunctions;
+    const MahalanobisDistanceAffineIsometryAnalyticResidual mahalanobis(A, C, X, lambda);
+    const ceres::AutoDiffCostFunction<MahalanobisDistanceAffineIsometryResidual, 1, 6> mahalanobisAutoDiff(
+      new MahalanobisDistanceAffineIsometryResidual(A, C, X, lambda));
+    mahalanobisOk &= SameEvaluation(mahalanobis, mahalanobisAutoDiff, w);
+
+    const EuclideanDistanceAffineIsometryAnalyticResidual euclidean(X, Y);
+    const ceres::AutoDiffCostFunction<EuclideanDistanceAffineIsometryResidual, 1, 6> euclideanAutoDiff(
+      new EuclideanDistanceAffineIsometryResidual(X, Y));
+    euclideanOk &= SameEvaluation(euclidean, euclideanAutoDiff, w);
+  }
+  errors += Check(mahalanobisOk, "wrong mahalanobis jacobian");
+  errors += Check(euclideanOk, "wrong euclidean jacobian");
+
+  // at the minimum, both residual and jacobian are zero
+  const Eigen::Vector3d X(1, 2, 3);
+  const double w[6] = { 0, 0, 0, 0, 0, 0 };
+  const CostFunctions::EuclideanDistanceAffineIsometryAnalyticResidual euclidean(X, X);
+  const ceres::AutoDiffCostFunction<CostFunctions::EuclideanDistanceAffineIsometryResidual, 1, 6> euclideanAutoDiff(
+    new CostFunctions::EuclideanDistanceAffineIsometryResidual(X, X));
+  errors += Check(SameEvaluation(euclidean, euclideanAutoDiff, w), "wrong jacobian at the minimum");
+  return errors;
+}
@@ -0,0 +1,72 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+// Helpers of the unit tests, header only and without VTK unlike TestHelpers.h
+
+#include <iostream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+//-----------------------------------------------------------------------------
+//! Print the message if the condition does not hold. Return the number of
+//! errors, 0 or 1, so that the test returns the sum of its checks
+inline int Check(bool condition, const std::string& message)
+{
+  if (!condition)
+  {
+    std::cerr << "Test failed: " << message << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * @brief ScratchDirectory create an empty directory of a unique name in the
+ *        temporary directory, and remove it with its content when destroyed,
+ *        so that the early returns of a test do not leave it behind.
+ */
+class ScratchDirectory
+{
+public:
+  explicit ScratchDirectory(const std::string& prefix)
+    : Path(boost::filesystem::temp_directory_path() /
+           boost::filesystem::unique_path(prefix + "-%%%%-%%%%"))
+  {
+    boost::filesystem::create_directories(this->Path);
+  }
+
+  ~ScratchDirectory()
+  {
+    boost::system::error_code error;
+    boost::filesystem::remove_all(this->Path, error);
+  }
+
+  ScratchDirectory(const ScratchDirectory&) = delete;
+  ScratchDirectory& operator=(const ScratchDirectory&) = delete;
+
+  const boost::filesystem::path& GetPath() const { return this->Path; }
+
+private:
+  const boost::filesystem::path Path;
+};
+
+#endif // TEST_CHECK_H
@@ -0,0 +1,107 @@
+#include "CompressedPcapFile.h"
+#include "TestCheck.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <vtk_zlib.h>
+
+namespace
+{
+//! Compress data as a gzip member
+std::vector<unsigned char> Gzip(const unsigned char* data, size_t size)
+{
+  z_stream strm;
+  std::memset(&strm, 0, sizeof(strm));
+  deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+  std::vector<unsigned char> compressed(deflateBound(&strm, static_cast<uLong>(size)));
+  strm.next_in = const_cast<unsigned char*>(data);
+  strm.avail_in = static_cast<uInt>(size);
+  strm.next_out = compressed.data();
+  strm.avail_out = static_cast<uInt>(compressed.size());
+  deflate(&strm, Z_FINISH);
+  compressed.resize(strm.total_out);
+  deflateEnd(&strm);
+  return compressed;
+}
+
+//! Packets looking like lidar data: a repeated header and noisy payload
+std::vector<unsigned char> MakeContent(size_t size)
+{
+  std::mt19937 generator(7);
+  std::uniform_int_distribution<int> noise(0, 15);
+  std::vector<unsigned char> content(size);
+  for (size_t i = 0; i < size; ++i)
+  {
+    content[i] = i % 1248 < 42 ? static_cast<unsigned char>(i % 1248)
+                               : static_cast<unsigned char>((i / 7) % 200 + noise(generator));
+  }
+  return content;
+}
+}
+
+int main()
+{
+  int errors = 0;
+  const ScratchDirectory scratch("TestCompressedPcapFile");
+  const boost::filesystem::path& directory = scratch.GetPath();
+  const std::string filename = (directory / "capture.pcap.gz").string();
+
+  // two gzip members, as written by parallel compressors
+  const std::vector<unsigned char> content = MakeContent(3 * CompressedPcapFile::ChunkSize + 12345);
+  const size_t split = content.size() / 3;
+  {
+    std::ofstream os(filename, std::ios::binary);
+    for (const auto& member : { Gzip(content.data(), split),
+                                Gzip(content.data() + split, content.size() - split) })
+    {
+      os.write(reinterpret_cast<const char*>(member.data()), member.size());
+    }
+  }
+
+  errors += Check(CompressedPcapFile::IsCompressed(filename), "gzip file not detected");
+
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    // the first pass finds the access points, the second one loads them from the sidecar
+    CompressedPcapFile file;
+    if (Check(file.Open(filename), "could not open the file: " + file.GetLastError()))
+    {
+      return 1;
+    }
+    errors += Check(boost::filesystem::exists(filename + CompressedPcapFile::IndexExtension),
+                    "sidecar not written");
+    errors += Check(file.GetSize() == static_cast<int64_t>(content.size()), "wrong uncompressed size");
+
+    // sequential reading of records, some of them spanning two chunks
+    bool sequentialOk = true;
+    for (size_t offset = 0; offset < content.size(); offset += 1248)
+    {
+      const size_t length = std::min<size_t>(1248, content.size() - offset);
+      const unsigned char* bytes = file.GetBytes(offset, length);
+      sequentialOk &= bytes && std::memcmp(bytes, content.data() + offset, length) == 0;
+    }
+    errors += Check(sequentialOk, "wrong bytes in sequential reading");
+
+    // random seeks
+    std::mt19937 generator(pass);
+    std::uniform_int_distribution<size_t> offsets(0, content.size() - 5000);
+    bool randomOk = true;
+    for (int i = 0; i < 50; ++i)
+    {
+      const size_t offset = offsets(generator);
+      const unsigned char* bytes = file.GetBytes(offset, 5000);
+      randomOk &= bytes && std::memcmp(bytes, content.data() + offset, 5000) == 0;
+    }
+    errors += Check(randomOk, "wrong bytes after a seek");
+    errors += Check(!file.GetBytes(content.size() - 10, 11), "bytes read past the end");
+  }
+
+  return errors;
+}
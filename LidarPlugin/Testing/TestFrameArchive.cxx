@@ -0,0 +1,276 @@
+#include "FrameArchive.h"
+#include "TestCheck.h"
+
+#include <vtkType.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+namespace
+{
+// Points on a ring, and an intensity and a laser id per point
+struct TestFrame
+{
+  std::vector<float> Points;
+  std::vector<double> Intensity;
+  std::vector<unsigned char> LaserId;
+
+  explicit TestFrame(int frameNumber)
+  {
+    const int numberOfPoints = 1000 + 10 * frameNumber;
+    for (int i = 0; i < numberOfPoints; ++i)
+    {
+      const double angle = 2.0 * 3.14159265358979 * i / numberOfPoints;
+      this->Points.push_back(static_cast<float>(10.0 * std::cos(angle)));
+      this->Points.push_back(static_cast<float>(10.0 * std::sin(angle)));
+      this->Points.push_back(static_cast<float>(0.01 * (i % 16)));
+      this->Intensity.push_back((i * 7 + frameNumber) % 256);
+      this->LaserId.push_back(static_cast<unsigned char>(i % 16));
+    }
+  }
+
+  uint64_t GetNumberOfPoints() const { return this->LaserId.size(); }
+
+  std::vector<FrameArchiveColumn> GetColumns() const
+  {
+    std::vector<FrameArchiveColumn> columns(3);
+    columns[0].Kind = FrameArchiveColumn::Points;
+    columns[0].DataType = VTK_FLOAT;
+    columns[0].ValueSize = sizeof(float);
+    columns[0].NumberOfComponents = 3;
+    columns[0].Data = reinterpret_cast<const unsigned char*>(this->Points.data());
+    columns[0].Size = this->Points.size() * sizeof(float);
+    columns[1].Name = "intensity";
+    columns[1].DataType = VTK_DOUBLE;
+    columns[1].ValueSize = sizeof(double);
+    columns[1].Data = reinterpret_cast<const unsigned char*>(this->Intensity.data());
+    columns[1].Size = this->Intensity.size() * sizeof(double);
+    columns[2].Name = "laser_id";
+    columns[2].DataType = VTK_UNSIGNED_CHAR;
+    columns[2].ValueSize = 1;
+    columns[2].Data = this->LaserId.data();
+    columns[2].Size = this->LaserId.size();
+    return columns;
+  }
+};
+
+int TestRoundTrip(const std::string& filename, int compressionLevel)
+{
+  int retVal = 0;
+  const int numberOfFrames = 5;
+  {
+    FrameArchiveWriter writer;
+    retVal += Check(writer.Open(filename, compressionLevel), "could not create the archive");
+    for (int i = 0; i < numberOfFrames; ++i)
+    {
+      TestFrame frame(i);
+      retVal += Check(writer.WriteFrame(0.1 * i, frame.GetNumberOfPoints(), frame.GetColumns()),
+                      "could not write a frame");
+    }
+    retVal += Check(writer.Close(), "could not write the index");
+  }
+
+  FrameArchiveReader reader;
+  retVal += Check(reader.Open(filename), "could not open the archive");
+  retVal += Check(reader.GetNumberOfFrames() == numberOfFrames, "wrong number of frames");
+  if (retVal)
+  {
+    return retVal;
+  }
+
+  // read the frames out of order, as when scrubbing
+  const int order[numberOfFrames] = { 3, 0, 4, 1, 2 };
+  for (int frameNumber : order)
+  {
+    TestFrame expected(frameNumber);
+    const std::vector<FrameArchiveColumn> expectedColumns = expected.GetColumns();
+    uint64_t numberOfPoints = 0;
+    std::vector<FrameArchiveColumn> columns;
+    retVal += Check(reader.ReadFrame(frameNumber, numberOfPoints, columns), "could not read a frame");
+    retVal += Check(std::abs(reader.GetFrameTime(frameNumber) - 0.1 * frameNumber) < 1e-12,
+                    "wrong frame time");
+    retVal += Check(numberOfPoints == expected.GetNumberOfPoints(), "wrong number of points");
+    retVal += Check(columns.size() == expectedColumns.size(), "wrong number of columns");
+    for (size_t i = 0; i < columns.size() && i < expectedColumns.size(); ++i)
+    {
+      const FrameArchiveColumn& column = columns[i];
+      const FrameArchiveColumn& expectedColumn = expectedColumns[i];
+      retVal += Check(column.Name == expectedColumn.Name && column.Kind == expectedColumn.Kind
+                      && column.DataType == expectedColumn.DataType
+                      && column.NumberOfComponents == expectedColumn.NumberOfComponents,
+                      "wrong description of column " + expectedColumn.Name);
+      retVal += Check(column.Size == expectedColumn.Size
+                      && std::memcmp(column.Data, expectedColumn.Data, column.Size) == 0,
+                      "wrong values in column " + expectedColumn.Name);
+      retVal += Check(reinterpret_cast<uintptr_t>(column.Data) % 8 == 0,
+                      "column " + expectedColumn.Name + " is not aligned");
+    }
+  }
+  uint64_t numberOfPoints = 0;
+  std::vector<FrameArchiveColumn> columns;
+  retVal += Check(!reader.ReadFrame(numberOfFrames, numberOfPoints, columns),
+                  "a frame out of the archive should not be read");
+  return retVal;
+}
+
+// the quantized points are within the tolerance, and the rows of the other columns
+// follow them, as checked with a column giving the original row of each point
+template<typename T>
+int TestQuantizedPoints(const std::string& filename, double tolerance, bool expectQuantized)
+{
+  int retVal = 0;
+  const uint32_t numberOfPoints = 20000;
+  std::vector<T> points;
+  std::vector<uint32_t> rows;
+  for (uint32_t i = 0; i < numberOfPoints; ++i)
+  {
+    const double angle = 0.0031 * i;
+    const double range = 5.0 + 20.0 * ((i * 37) % 101) / 101.0;
+    points.push_back(static_cast<T>(range * std::cos(angle)));
+    points.push_back(static_cast<T>(range * std::sin(angle)));
+    points.push_back(static_cast<T>(-1.5 + 0.2 * (i % 32)));
+    rows.push_back(i);
+  }
+  std::vector<FrameArchiveColumn> columns(2);
+  columns[0].Kind = FrameArchiveColumn::Points;
+  columns[0].DataType = sizeof(T) == sizeof(float) ? VTK_FLOAT : VTK_DOUBLE;
+  columns[0].ValueSize = sizeof(T);
+  columns[0].NumberOfComponents = 3;
+  columns[0].Data = reinterpret_cast<const unsigned char*>(points.data());
+  columns[0].Size = points.size() * sizeof(T);
+  columns[1].Name = "row";
+  columns[1].DataType = VTK_UNSIGNED_INT;
+  columns[1].ValueSize = sizeof(uint32_t);
+  columns[1].Data = reinterpret_cast<const unsigned char*>(rows.data());
+  columns[1].Size = rows.size() * sizeof(uint32_t);
+
+  uint64_t sizes[2];
+  for (int exact = 1; exact >= 0; --exact)
+  {
+    FrameArchiveWriter writer;
+    writer.Open(filename, 6, exact ? 0.0 : tolerance);
+    writer.WriteFrame(0.0, numberOfPoints, columns);
+    // an empty frame is kept as is
+    writer.WriteFrame(0.1, 0, std::vector<FrameArchiveColumn>());
+    retVal += Check(writer.Close(), "could not write the quantized archive");
+    std::ifstream is(filename, std::ios::binary | std::ios::ate);
+    sizes[exact] = static_cast<uint64_t>(is.tellg());
+  }
+  retVal += Check(!expectQuantized || sizes[0] < sizes[1], "the quantized points are not smaller");
+  retVal += Check(expectQuantized || sizes[0] == sizes[1], "the points should be stored exactly");
+
+  FrameArchiveReader reader;
+  FrameDecoder decoder;
+  uint64_t readPoints = 0;
+  std::vector<FrameArchiveColumn> readColumns;
+  retVal += Check(reader.Open(filename) && reader.GetNumberOfFrames() == 2,
+                  "could not open the quantized archive");
+  retVal += Check(reader.ReadFrame(0, decoder, readPoints, readColumns) && readPoints == numberOfPoints
+                  && readColumns.size() == 2, "could not read the quantized frame");
+  if (retVal)
+  {
+    return retVal;
+  }
+  const T* readXYZ = reinterpret_cast<const T*>(readColumns[0].Data);
+  const uint32_t* readRows = reinterpret_cast<const uint32_t*>(readColumns[1].Data);
+  std::vector<bool> isRead(numberOfPoints, false);
+  double maxError = 0.0;
+  for (uint32_t i = 0; i < numberOfPoints; ++i)
+  {
+    const uint32_t row = readRows[i];
+    if (row >= numberOfPoints || isRead[row])
+    {
+      return Check(false, "the rows are not a permutation");
+    }
+    isRead[row] = true;
+    for (int j = 0; j < 3; ++j)
+    {
+      maxError = std::max(maxError, std::abs(static_cast<double>(readXYZ[i * 3 + j]) - points[row * 3 + j]));
+    }
+  }
+  retVal += Check(maxError <= tolerance * 1.0001 + 1e-5, "the quantized points exceed the tolerance");
+  retVal += Check(reader.ReadFrame(1, decoder, readPoints, readColumns) && readPoints == 0,
+                  "could not read the empty frame");
+  return retVal;
+}
+
+// the frames published over the network are encoded in memory, after a header
+int TestEncoder(int compressionLevel)
+{
+  int retVal = 0;
+  TestFrame expected(2);
+  const std::vector<FrameArchiveColumn> expectedColumns = expected.GetColumns();
+
+  FrameEncoder encoder;
+  encoder.SetCompressionLevel(compressionLevel);
+  std::ostringstream stream;
+  const std::string header(32, 'H');
+  stream << header;
+  retVal += Check(encoder.Encode(expected.GetNumberOfPoints(), expectedColumns, stream),
+                  "could not encode a frame");
+  const std::string message = stream.str();
+
+  FrameDecoder decoder;
+  uint64_t numberOfPoints = 0;
+  std::vector<FrameArchiveColumn> columns;
+  retVal += Check(decoder.Decode(reinterpret_cast<const unsigned char*>(message.data()) + header.size(),
+                                 message.size() - header.size(), numberOfPoints, columns),
+                  "could not decode a frame");
+  retVal += Check(numberOfPoints == expected.GetNumberOfPoints(), "wrong number of decoded points");
+  retVal += Check(columns.size() == expectedColumns.size(), "wrong number of decoded columns");
+  for (size_t i = 0; i < columns.size() && i < expectedColumns.size(); ++i)
+  {
+    retVal += Check(columns[i].Size == expectedColumns[i].Size
+                    && std::memcmp(columns[i].Data, expectedColumns[i].Data, columns[i].Size) == 0,
+                    "wrong decoded values in column " + expectedColumns[i].Name);
+  }
+
+  // a truncated frame is rejected
+  retVal += Check(!decoder.Decode(reinterpret_cast<const unsigned char*>(message.data()) + header.size(),
+                                  (message.size() - header.size()) / 2, numberOfPoints, columns),
+                  "a truncated frame should be rejected");
+  return retVal;
+}
+}
+
+int main()
+{
+  int retVal = 0;
+  const ScratchDirectory scratch("TestFrameArchive");
+  const std::string filename = (scratch.GetPath() / "frames.lvframes").string();
+
+  retVal += TestRoundTrip(filename, 0);
+  retVal += TestRoundTrip(filename, 6);
+  retVal += TestEncoder(0);
+  retVal += TestEncoder(6);
+  retVal += TestQuantizedPoints<float>(filename, 0.005, true);
+  retVal += TestQuantizedPoints<double>(filename, 0.001, true);
+  // the extent of the points does not fit in the grid of a too small tolerance
+  retVal += TestQuantizedPoints<double>(filename, 1e-9, false);
+
+  // a truncated archive, as when the writer has not been closed, is rejected
+  {
+    FrameArchiveWriter writer;
+    writer.Open(filename);
+    TestFrame frame(0);
+    writer.WriteFrame(0.0, frame.GetNumberOfPoints(), frame.GetColumns());
+  }
+  std::string content;
+  {
+    std::ifstream is(filename, std::ios::binary);
+    content.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream os(filename, std::ios::binary | std::ios::trunc);
+    os.write(content.data(), content.size() - 4);
+  }
+  FrameArchiveReader reader;
+  retVal += Check(!reader.Open(filename), "a truncated archive should be rejected");
+
+  return retVal;
+}
@@ -0,0 +1,179 @@
+#include "FrameCSVWriter.h"
+#include "TestCheck.h"
+
+#include <vtkType.h>
+#include <vtk_zlib.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+namespace
+{
+std::string ReadFile(const std::string& filename)
+{
+  std::ifstream is(filename, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+// Inflate the concatenated gzip members of a file
+bool Gunzip(const std::string& compressed, std::string& text)
+{
+  z_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, 15 + 16) != Z_OK)
+  {
+    return false;
+  }
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+  stream.avail_in = static_cast<uInt>(compressed.size());
+  char buffer[1 << 16];
+  int status = Z_OK;
+  while (status == Z_OK || (status == Z_STREAM_END && stream.avail_in > 0))
+  {
+    if (status == Z_STREAM_END)
+    {
+      inflateReset(&stream);
+    }
+    stream.next_out = reinterpret_cast<Bytef*>(buffer);
+    stream.avail_out = sizeof(buffer);
+    status = inflate(&stream, Z_NO_FLUSH);
+    text.append(buffer, sizeof(buffer) - stream.avail_out);
+  }
+  inflateEnd(&stream);
+  return status == Z_STREAM_END;
+}
+
+// Points on a line, and point data of several types, with more points than
+// a block of rows so that the frame is formatted by several threads
+struct TestFrame
+{
+  std::vector<float> Points;
+  std::vector<double> Intensity;
+  std::vector<unsigned char> LaserId;
+  std::vector<int> Offset;
+  std::vector<short> Pair;
+
+  TestFrame()
+  {
+    const int numberOfPoints = 40000;
+    for (int i = 0; i < numberOfPoints; ++i)
+    {
+      this->Points.push_back(0.5f * i);
+      this->Points.push_back(-0.25f * i);
+      this->Points.push_back(0.f);
+      this->Intensity.push_back(0.1 * (i % 100));
+      this->LaserId.push_back(static_cast<unsigned char>(i % 16));
+      this->Offset.push_back(i - numberOfPoints / 2);
+      this->Pair.push_back(static_cast<short>(i % 7));
+      this->Pair.push_back(static_cast<short>(-(i % 5)));
+    }
+  }
+
+  uint64_t GetNumberOfPoints() const { return this->LaserId.size(); }
+
+  std::vector<FrameArchiveColumn> GetColumns() const
+  {
+    std::vector<FrameArchiveColumn> columns(5);
+    columns[0].Kind = FrameArchiveColumn::Points;
+    columns[0].DataType = VTK_FLOAT;
+    columns[0].ValueSize = sizeof(float);
+    columns[0].NumberOfComponents = 3;
+    columns[0].Data = reinterpret_cast<const unsigned char*>(this->Points.data());
+    columns[0].Size = this->Points.size() * sizeof(float);
+    columns[1].Name = "intensity";
+    columns[1].DataType = VTK_DOUBLE;
+    columns[1].ValueSize = sizeof(double);
+    columns[1].Data = reinterpret_cast<const unsigned char*>(this->Intensity.data());
+    columns[1].Size = this->Intensity.size() * sizeof(double);
+    columns[2].Name = "laser_id";
+    columns[2].DataType = VTK_UNSIGNED_CHAR;
+    columns[2].ValueSize = 1;
+    columns[2].Data = this->LaserId.data();
+    columns[2].Size = this->LaserId.size();
+    columns[3].Name = "offset";
+    columns[3].DataType = VTK_INT;
+    columns[3].ValueSize = sizeof(int);
+    columns[3].Data = reinterpret_cast<const unsigned char*>(this->Offset.data());
+    columns[3].Size = this->Offset.size() * sizeof(int);
+    columns[4].Name = "pair";
+    columns[4].DataType = VTK_SHORT;
+    columns[4].ValueSize = sizeof(short);
+    columns[4].NumberOfComponents = 2;
+    columns[4].Data = reinterpret_cast<const unsigned char*>(this->Pair.data());
+    columns[4].Size = this->Pair.size() * sizeof(short);
+    return columns;
+  }
+};
+
+int TestContent(const std::string& text, const TestFrame& frame)
+{
+  int retVal = 0;
+  std::istringstream is(text);
+  std::string line;
+  std::getline(is, line);
+  retVal += Check(line == "\"Points:0\",\"Points:1\",\"Points:2\",\"intensity\",\"laser_id\","
+                          "\"offset\",\"pair:0\",\"pair:1\"", "unexpected header: " + line);
+  uint64_t row = 0;
+  while (std::getline(is, line))
+  {
+    // the values written with 16 digits are read back exactly
+    double x, y, z, intensity;
+    int laserId, offset, pair0, pair1;
+    const bool isRead = std::sscanf(line.c_str(), "%lf,%lf,%lf,%lf,%d,%d,%d,%d",
+                                    &x, &y, &z, &intensity, &laserId, &offset, &pair0, &pair1) == 8;
+    if (!isRead || row >= frame.GetNumberOfPoints() ||
+        x != frame.Points[3 * row] || y != frame.Points[3 * row + 1] || z != frame.Points[3 * row + 2] ||
+        std::abs(intensity - frame.Intensity[row]) > 1e-15 || laserId != frame.LaserId[row] ||
+        offset != frame.Offset[row] || pair0 != frame.Pair[2 * row] || pair1 != frame.Pair[2 * row + 1])
+    {
+      retVal += Check(false, "unexpected row " + std::to_string(row) + ": " + line);
+      break;
+    }
+    ++row;
+  }
+  retVal += Check(row == frame.GetNumberOfPoints(), "unexpected number of rows");
+  return retVal;
+}
+}
+
+int main()
+{
+  int retVal = 0;
+  const ScratchDirectory scratch("TestFrameCSVWriter");
+  const std::string filename = (scratch.GetPath() / "frame.csv").string();
+  TestFrame frame;
+
+  // the file does not depend on the number of threads
+  FrameCSVWriter writer;
+  writer.SetNumberOfThreads(1);
+  retVal += Check(writer.WriteFrame(filename, frame.GetNumberOfPoints(), frame.GetColumns()),
+                  "could not write the sequential csv");
+  const std::string sequential = ReadFile(filename);
+  writer.SetNumberOfThreads(4);
+  retVal += Check(writer.WriteFrame(filename, frame.GetNumberOfPoints(), frame.GetColumns()),
+                  "could not write the parallel csv");
+  const std::string parallel = ReadFile(filename);
+  retVal += Check(sequential == parallel, "the parallel csv differs from the sequential one");
+  retVal += TestContent(parallel, frame);
+
+  // the compressed blocks form a single gzip file
+  writer.SetCompressionLevel(6);
+  retVal += Check(writer.WriteFrame(filename + ".gz", frame.GetNumberOfPoints(), frame.GetColumns()),
+                  "could not write the compressed csv");
+  std::string text;
+  retVal += Check(Gunzip(ReadFile(filename + ".gz"), text), "could not decompress the csv");
+  retVal += Check(text == parallel, "the decompressed csv differs from the plain one");
+
+  // a column smaller than the number of points is rejected
+  std::vector<FrameArchiveColumn> columns = frame.GetColumns();
+  columns[1].Size -= sizeof(double);
+  retVal += Check(!writer.WriteFrame(filename, frame.GetNumberOfPoints(), columns),
+                  "a truncated column should be rejected");
+
+  return retVal;
+}
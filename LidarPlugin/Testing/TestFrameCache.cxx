@@ -0,0 +1,56 @@
+#include "FrameCache.h"
+#include "TestCheck.h"
+
+#include <vtkNew.h>
+#include <vtkPoints.h>
+
+#include <iostream>
+
+namespace
+{
+// Create a frame with roughly `size` kibibytes of points
+vtkSmartPointer<vtkPolyData> CreateFrame(int size)
+{
+  auto frame = vtkSmartPointer<vtkPolyData>::New();
+  vtkNew<vtkPoints> points;
+  points->SetDataTypeToDouble();
+  points->SetNumberOfPoints(size * 1024 / (3 * sizeof(double)));
+  frame->SetPoints(points.Get());
+  return frame;
+}
+}
+
+int main()
+{
+  int retVal = 0;
+
+  // disabled cache
+  FrameCache cache;
+  cache.Insert(0, CreateFrame(100));
+  retVal += Check(!cache.Contains(0), "a disabled cache should not keep any frame");
+
+  // the least recently used frame is removed when the budget is exceeded
+  const unsigned long frameSize = CreateFrame(100)->GetActualMemorySize();
+  cache.SetMemoryBudget(3 * frameSize);
+  cache.Insert(0, CreateFrame(100));
+  cache.Insert(1, CreateFrame(100));
+  cache.Insert(2, CreateFrame(100));
+  retVal += Check(cache.Contains(0) && cache.Contains(1) && cache.Contains(2),
+                  "all the frames should fit in the budget");
+  retVal += Check(cache.Get(0) != nullptr, "frame 0 should be cached");
+  cache.Insert(3, CreateFrame(100));
+  retVal += Check(!cache.Contains(1), "frame 1 was the least recently used one");
+  retVal += Check(cache.Contains(0) && cache.Contains(2) && cache.Contains(3),
+                  "frames 0, 2 and 3 should be cached");
+  retVal += Check(cache.GetMemorySize() <= cache.GetMemoryBudget(), "budget exceeded");
+
+  // reducing the budget shrinks the cache
+  cache.SetMemoryBudget(frameSize);
+  retVal += Check(cache.Contains(3) && !cache.Contains(0) && !cache.Contains(2),
+                  "only the most recently used frame should be kept");
+
+  cache.Clear();
+  retVal += Check(!cache.Contains(3) && cache.GetMemorySize() == 0, "the cache should be empty");
+
+  return retVal;
+}
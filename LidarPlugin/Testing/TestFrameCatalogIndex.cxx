@@ -0,0 +1,157 @@
+#include "FrameCatalogIndex.h"
+#include "TestCheck.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+namespace
+{
+// Sensor specific information of the frames of the test
+struct TestFrameInformation : public SpecificFrameInformation
+{
+  int Value = 0;
+
+  void reset() override { this->Value = 0; }
+  std::unique_ptr<SpecificFrameInformation> clone() override
+  {
+    return std::unique_ptr<SpecificFrameInformation>(new TestFrameInformation(*this));
+  }
+  bool write(std::ostream& os) const override
+  {
+    os.write(reinterpret_cast<const char*>(&this->Value), sizeof(this->Value));
+    return os.good();
+  }
+  bool read(std::istream& is) override
+  {
+    is.read(reinterpret_cast<char*>(&this->Value), sizeof(this->Value));
+    return is.good();
+  }
+};
+
+FrameInformation MakePrototype()
+{
+  FrameInformation prototype;
+  std::memset(&prototype.FilePosition, 0, sizeof(prototype.FilePosition));
+  prototype.SpecificInformation = std::make_shared<TestFrameInformation>();
+  return prototype;
+}
+
+std::vector<FrameInformation> MakeCatalog(int numberOfFrames)
+{
+  std::vector<FrameInformation> catalog(numberOfFrames, MakePrototype());
+  for (int i = 0; i < numberOfFrames; ++i)
+  {
+    // the file position is opaque, only its bytes matter
+    unsigned char* position = reinterpret_cast<unsigned char*>(&catalog[i].FilePosition);
+    for (size_t byte = 0; byte < sizeof(fpos_t); ++byte)
+    {
+      position[byte] = static_cast<unsigned char>(7 * i + byte);
+    }
+    catalog[i].FirstPacketNetworkTime = 1e9 + 0.1 * i;
+    catalog[i].FirstPacketDataTime = 3.6e9 + 0.1 * i;
+    static_cast<TestFrameInformation*>(catalog[i].SpecificInformation.get())->Value = 100 + i;
+  }
+  return catalog;
+}
+
+bool SameCatalog(const std::vector<FrameInformation>& a, const std::vector<FrameInformation>& b)
+{
+  if (a.size() != b.size())
+  {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i)
+  {
+    if (std::memcmp(&a[i].FilePosition, &b[i].FilePosition, sizeof(fpos_t)) != 0
+        || a[i].FirstPacketNetworkTime != b[i].FirstPacketNetworkTime
+        || a[i].FirstPacketDataTime != b[i].FirstPacketDataTime
+        || static_cast<TestFrameInformation*>(a[i].SpecificInformation.get())->Value
+           != static_cast<TestFrameInformation*>(b[i].SpecificInformation.get())->Value)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void WriteBytes(const std::string& fileName, size_t size, std::ios::openmode mode)
+{
+  std::ofstream os(fileName, std::ios::binary | mode);
+  os << std::string(size, 'p');
+}
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  int errors = 0;
+  const ScratchDirectory scratch("TestFrameCatalogIndex");
+  const std::string pcap = (scratch.GetPath() / "capture.pcap").string();
+  WriteBytes(pcap, 1000, std::ios::trunc);
+  const std::string settings = "VLP-16.xml port=2368";
+  const std::vector<FrameInformation> catalog = MakeCatalog(50);
+  const FrameInformation prototype = MakePrototype();
+  std::vector<FrameInformation> loaded;
+
+  errors += Check(FrameCatalogIndex::GetIndexFileName(pcap) == pcap + ".lvindex",
+                  "unexpected name of the sidecar");
+  errors += Check(!FrameCatalogIndex::Read(pcap, settings, prototype, loaded), "a missing sidecar was read");
+
+  // round trip
+  errors += Check(FrameCatalogIndex::Write(pcap, settings, catalog), "the sidecar could not be written");
+  errors += Check(!boost::filesystem::exists(FrameCatalogIndex::GetIndexFileName(pcap) + ".tmp"),
+                  "the temporary sidecar was left");
+  errors += Check(FrameCatalogIndex::Read(pcap, settings, prototype, loaded) && SameCatalog(loaded, catalog),
+                  "the catalog read differs from the one written");
+
+  // an empty catalog is a valid one
+  errors += Check(FrameCatalogIndex::Write(pcap, settings, {}, ".lvempty")
+                  && FrameCatalogIndex::Read(pcap, settings, prototype, loaded, ".lvempty") && loaded.empty(),
+                  "the empty catalog was not read back");
+  errors += Check(FrameCatalogIndex::Read(pcap, settings, prototype, loaded) && SameCatalog(loaded, catalog),
+                  "the sidecars of the other extensions are not separate");
+
+  // the catalog is not modified when the sidecar is stale
+  const std::vector<FrameInformation> other = MakeCatalog(3);
+  loaded = other;
+  errors += Check(!FrameCatalogIndex::Read(pcap, "HDL-32.xml port=2368", prototype, loaded),
+                  "a sidecar built with other settings was read");
+  errors += Check(SameCatalog(loaded, other), "the catalog was modified by a failed read");
+  FrameInformation noSpecificInformation;
+  errors += Check(!FrameCatalogIndex::Read(pcap, settings, noSpecificInformation, loaded),
+                  "read without the sensor specific information");
+
+  // modification time of the pcap
+  const std::time_t modificationTime = boost::filesystem::last_write_time(pcap);
+  boost::filesystem::last_write_time(pcap, modificationTime + 10);
+  errors += Check(!FrameCatalogIndex::Read(pcap, settings, prototype, loaded),
+                  "a sidecar older than the pcap was read");
+  boost::filesystem::last_write_time(pcap, modificationTime);
+  errors += Check(FrameCatalogIndex::Read(pcap, settings, prototype, loaded),
+                  "the sidecar is not read back with the original modification time");
+
+  // size of the pcap, with the same modification time
+  WriteBytes(pcap, 24, std::ios::app);
+  boost::filesystem::last_write_time(pcap, modificationTime);
+  errors += Check(!FrameCatalogIndex::Read(pcap, settings, prototype, loaded),
+                  "a sidecar of a pcap of another size was read");
+
+  // a truncated sidecar, as left by a crash without the temporary file
+  errors += Check(FrameCatalogIndex::Write(pcap, settings, catalog), "the sidecar could not be rewritten");
+  const std::string sidecar = FrameCatalogIndex::GetIndexFileName(pcap);
+  boost::filesystem::resize_file(sidecar, boost::filesystem::file_size(sidecar) - 5);
+  errors += Check(!FrameCatalogIndex::Read(pcap, settings, prototype, loaded), "a truncated sidecar was read");
+
+  // no sidecar for a missing pcap
+  boost::filesystem::remove(pcap);
+  errors += Check(!FrameCatalogIndex::Write(pcap, settings, catalog), "a sidecar was written without pcap");
+
+  return errors;
+}
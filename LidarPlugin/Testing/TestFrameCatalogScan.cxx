@@ -0,0 +1,88 @@
+#include "TestCheck.h"
+#include "TestHelpers.h"
+#include "vtkLidarReader.h"
+#include "vtkVelodynePacketInterpreter.h"
+
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <iostream>
+#include <string>
+
+namespace
+{
+// Build the frame catalog of a pcap with the given number of scan threads.
+// The chunks are allowed to be as small as possible, so that the test pcaps are split
+vtkSmartPointer<vtkLidarReader> ScanPcap(const std::string& pcapFileName,
+                                         const std::string& correctionFileName, int numberOfThreads)
+{
+  auto reader = vtkSmartPointer<vtkLidarReader>::New();
+  reader->SetInterpreter(vtkSmartPointer<vtkVelodynePacketInterpreter>::New());
+  reader->SetFileName(pcapFileName);
+  // do not write the sidecar of the frame catalog next to the test data, nor read it
+  reader->SetUseFrameIndexCache(false);
+  reader->SetCalibrationFileName(correctionFileName);
+  reader->SetUseMemoryMapping(true);
+  reader->SetNumberOfScanThreads(numberOfThreads);
+  reader->SetMinimumScanChunkSize(1);
+  reader->SetFrameCacheSize(0);
+  reader->SetNumberOfFramesToPrefetch(0);
+  reader->Update();
+  return reader;
+}
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Wrong number of arguments. Usage: TestFrameCatalogScan <pcapFileName> "
+              << "<correctionFileName>" << std::endl;
+    return 1;
+  }
+  const std::string pcapFileName = argv[1];
+  const std::string correctionFileName = argv[2];
+  int retVal = 0;
+
+  vtkSmartPointer<vtkLidarReader> sequential = ScanPcap(pcapFileName, correctionFileName, 1);
+  const int nbFrames = sequential->GetNumberOfFrames();
+  retVal += Check(nbFrames > 0, "no frame found in " + pcapFileName);
+  retVal += Check(sequential->GetNumberOfScannedChunks() == 1, "the pcap was not scanned sequentially");
+
+  for (int numberOfThreads : { 2, 4 })
+  {
+    const std::string threads = std::to_string(numberOfThreads) + " threads";
+    vtkSmartPointer<vtkLidarReader> parallel = ScanPcap(pcapFileName, correctionFileName, numberOfThreads);
+    // a failed stitching falls back to a sequential scan, which would hide it
+    retVal += Check(parallel->GetNumberOfScannedChunks() == numberOfThreads,
+                    "the pcap was not split in chunks for " + threads);
+    if (Check(parallel->GetNumberOfFrames() == nbFrames, "different number of frames with " + threads))
+    {
+      retVal++;
+      continue;
+    }
+    retVal += Check(parallel->GetNetworkTimeToDataTime() == sequential->GetNetworkTimeToDataTime(),
+                    "different network time offset with " + threads);
+
+    // the frames are decoded from the file positions of the catalogs
+    sequential->Open();
+    parallel->Open();
+    for (int frame = 0; frame < nbFrames; ++frame)
+    {
+      vtkSmartPointer<vtkPolyData> expected = sequential->GetFrame(frame);
+      vtkSmartPointer<vtkPolyData> actual = parallel->GetFrame(frame);
+      if (Check(expected && actual, "the frame " + std::to_string(frame) + " could not be read")
+          || TestPointCount(actual, expected)
+          || TestPointDataValues(actual, expected)
+          || TestPointPositions(actual, expected))
+      {
+        std::cerr << "the frame " << frame << " differs with " << threads << std::endl;
+        retVal++;
+      }
+    }
+    sequential->Close();
+    parallel->Close();
+  }
+
+  return retVal;
+}
@@ -0,0 +1,69 @@
+#include "FramePool.h"
+#include "TestCheck.h"
+
+#include <vtkDoubleArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+
+#include <iostream>
+
+namespace
+{
+vtkSmartPointer<vtkPolyData> CreateFrame()
+{
+  auto frame = vtkSmartPointer<vtkPolyData>::New();
+  vtkNew<vtkPoints> points;
+  points->SetNumberOfPoints(10);
+  frame->SetPoints(points.Get());
+  vtkNew<vtkDoubleArray> array;
+  array->SetName("intensity");
+  array->SetNumberOfTuples(10);
+  frame->GetPointData()->AddArray(array.Get());
+  return frame;
+}
+}
+
+int main()
+{
+  int retVal = 0;
+
+  FramePool pool;
+  retVal += Check(pool.Acquire() == nullptr, "an empty pool should not return any frame");
+
+  // a frame still used by a consumer must not be reused
+  vtkSmartPointer<vtkPolyData> used = CreateFrame();
+  pool.Add(used);
+  retVal += Check(pool.Acquire() == nullptr, "a used frame should not be reused");
+
+  // nor a frame whose arrays are still used, for example after a shallow copy
+  vtkNew<vtkPolyData> output;
+  output->ShallowCopy(used);
+  vtkPolyData* usedPointer = used.GetPointer();
+  used = nullptr;
+  retVal += Check(pool.Acquire() == nullptr, "a frame whose arrays are used should not be reused");
+
+  // once released, the frame is given back
+  output->Initialize();
+  vtkSmartPointer<vtkPolyData> acquired = pool.Acquire();
+  retVal += Check(acquired.GetPointer() == usedPointer, "the released frame should be reused");
+  retVal += Check(pool.GetNumberOfFrames() == 0, "an acquired frame should not be tracked anymore");
+
+  // the pool forgets the oldest frames when it is full
+  pool.SetMaximumNumberOfFrames(2);
+  pool.Add(CreateFrame());
+  pool.Add(CreateFrame());
+  pool.Add(CreateFrame());
+  retVal += Check(pool.GetNumberOfFrames() == 2, "the pool should not track more frames than allowed");
+
+  // only a few released frames are kept as spares
+  pool.SetMaximumNumberOfFrames(10);
+  for (int i = 0; i < 8; ++i)
+  {
+    pool.Add(CreateFrame());
+  }
+  retVal += Check(pool.Acquire() != nullptr, "a released frame should be reused");
+  retVal += Check(pool.GetNumberOfFrames() == 2, "only two spare frames should be kept");
+
+  return retVal;
+}
@@ -0,0 +1,132 @@
+#include "FrameTensorWriter.h"
+#include "TestCheck.h"
+
+#include <vtkType.h>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+// One point per laser and per 10 degrees, the range increasing with the frame
+struct TestFrame
+{
+  std::vector<double> Points;
+  std::vector<unsigned short> Azimuth;
+  std::vector<unsigned char> LaserId;
+  std::vector<unsigned char> Intensity;
+
+  TestFrame(int frameNumber, int numberOfLasers)
+  {
+    for (int azimuth = 0; azimuth < 36000; azimuth += 1000)
+    {
+      for (int laser = 0; laser < numberOfLasers; ++laser)
+      {
+        const double range = 10.0 + frameNumber;
+        const double angle = azimuth / 100.0 * 3.14159265358979 / 180.0;
+        this->Points.push_back(range * std::cos(angle));
+        this->Points.push_back(range * std::sin(angle));
+        this->Points.push_back(0.1 * laser);
+        this->Azimuth.push_back(static_cast<unsigned short>(azimuth));
+        this->LaserId.push_back(static_cast<unsigned char>(laser));
+        this->Intensity.push_back(static_cast<unsigned char>(laser * 10 + frameNumber));
+      }
+    }
+  }
+
+  uint64_t GetNumberOfPoints() const { return this->LaserId.size(); }
+
+  std::vector<FrameArchiveColumn> GetColumns() const
+  {
+    std::vector<FrameArchiveColumn> columns(4);
+    columns[0].Kind = FrameArchiveColumn::Points;
+    columns[0].DataType = VTK_DOUBLE;
+    columns[0].ValueSize = sizeof(double);
+    columns[0].NumberOfComponents = 3;
+    columns[0].Data = reinterpret_cast<const unsigned char*>(this->Points.data());
+    columns[0].Size = this->Points.size() * sizeof(double);
+    columns[1].Name = "azimuth";
+    columns[1].DataType = VTK_UNSIGNED_SHORT;
+    columns[1].ValueSize = sizeof(unsigned short);
+    columns[1].Data = reinterpret_cast<const unsigned char*>(this->Azimuth.data());
+    columns[1].Size = this->Azimuth.size() * sizeof(unsigned short);
+    columns[2].Name = "laser_id";
+    columns[2].DataType = VTK_UNSIGNED_CHAR;
+    columns[2].ValueSize = 1;
+    columns[2].Data = this->LaserId.data();
+    columns[2].Size = this->LaserId.size();
+    columns[3].Name = "intensity";
+    columns[3].DataType = VTK_UNSIGNED_CHAR;
+    columns[3].ValueSize = 1;
+    columns[3].Data = this->Intensity.data();
+    columns[3].Size = this->Intensity.size();
+    return columns;
+  }
+};
+}
+
+int main()
+{
+  int retVal = 0;
+  const ScratchDirectory scratch("TestFrameTensorWriter");
+  const std::string filename = (scratch.GetPath() / "frames.npy").string();
+  const int numberOfFrames = 3;
+  const int width = 72;
+
+  // the lasers are not in vertical order
+  const std::vector<double> verticalCorrections = { 2.0, -1.0, 0.5, -3.0 };
+  const std::vector<int> rows = FrameTensorWriter::SortLasersVertically(verticalCorrections);
+  retVal += Check(rows == std::vector<int>({ 3, 1, 2, 0 }), "wrong rows of the lasers");
+
+  {
+    FrameTensorWriter writer;
+    retVal += Check(writer.Open(filename, rows, width), "could not create the file");
+    for (int i = 0; i < numberOfFrames; ++i)
+    {
+      TestFrame frame(i, static_cast<int>(rows.size()));
+      retVal += Check(writer.WriteFrame(frame.GetNumberOfPoints(), frame.GetColumns()),
+                      "could not write a frame");
+    }
+    // the laser 2 at 90 degrees in the last frame
+    const std::vector<float>& tensor = writer.GetTensor();
+    const size_t channelSize = rows.size() * width;
+    const size_t pixel = 2 * width + 18;
+    retVal += Check(std::abs(tensor[FrameTensorWriter::Range * channelSize + pixel] - std::sqrt(144.04f)) < 1e-5
+                    && std::abs(tensor[FrameTensorWriter::Intensity * channelSize + pixel] - 22.f) < 1e-5
+                    && std::abs(tensor[FrameTensorWriter::Y * channelSize + pixel] - 12.f) < 1e-5
+                    && std::abs(tensor[FrameTensorWriter::Z * channelSize + pixel] - 0.2f) < 1e-5,
+                    "wrong pixel values");
+    retVal += Check(tensor[FrameTensorWriter::Range * channelSize + pixel + 1] == 0.f,
+                    "an empty pixel should be 0");
+
+    // a frame without the laser ids can not be projected
+    std::vector<FrameArchiveColumn> columns = TestFrame(0, 4).GetColumns();
+    columns.erase(columns.begin() + 2);
+    retVal += Check(!writer.WriteFrame(TestFrame(0, 4).GetNumberOfPoints(), columns),
+                    "a frame without laser ids should be rejected");
+    retVal += Check(writer.Close(), "could not close the file");
+  }
+
+  std::string content;
+  {
+    std::ifstream is(filename, std::ios::binary);
+    content.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+  }
+  const size_t frameSize = FrameTensorWriter::NumberOfChannels * rows.size() * width * sizeof(float);
+  retVal += Check(content.size() == 128 + numberOfFrames * frameSize, "wrong file size");
+  retVal += Check(content.compare(0, 6, "\x93NUMPY") == 0 && content[6] == 1, "wrong magic string");
+  retVal += Check(content.find("'shape': (3, 5, 4, 72)") != std::string::npos, "wrong shape in the header");
+  retVal += Check(content[127] == '\n', "the header should end with a new line");
+
+  // the first frame, laser 1 (row 1) at 0 degree, the range is computed from the point
+  float range;
+  std::memcpy(&range, content.data() + 128 + (1 * width + 0) * sizeof(float), sizeof(float));
+  retVal += Check(std::abs(range - std::sqrt(100.01f)) < 1e-5, "wrong range in the file");
+
+  return retVal;
+}
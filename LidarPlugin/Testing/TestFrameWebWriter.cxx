@@ -0,0 +1,182 @@
+#include "FrameWebWriter.h"
+#include "TestCheck.h"
+
+#include <vtkType.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+namespace
+{
+std::string ReadFile(const std::string& filename)
+{
+  std::ifstream is(filename, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+// Points on a georeferenced grid spanning several tiles, the point i being
+// at a distinct node of the grid so that it is found back from its position
+struct TestFrame
+{
+  static constexpr int Side = 60;
+  static constexpr double Spacing = 0.5;
+  double Offset[3] = { 650000.0, 5400000.0, 100.0 };
+  std::vector<double> Points;
+  std::vector<unsigned short> Intensity;
+
+  TestFrame()
+  {
+    for (int i = 0; i < Side; ++i)
+    {
+      for (int j = 0; j < Side; ++j)
+      {
+        for (int k = 0; k < 4; ++k)
+        {
+          this->Points.push_back(this->Offset[0] + i * Spacing);
+          this->Points.push_back(this->Offset[1] + j * Spacing);
+          this->Points.push_back(this->Offset[2] + k * Spacing);
+          this->Intensity.push_back(static_cast<unsigned short>(10 * ((i + j + k) % 26)));
+        }
+      }
+    }
+  }
+
+  uint64_t GetNumberOfPoints() const { return this->Intensity.size(); }
+
+  //! Index of the point closest to a position
+  uint64_t FindPoint(const double position[3]) const
+  {
+    const int i = static_cast<int>(std::round((position[0] - this->Offset[0]) / Spacing));
+    const int j = static_cast<int>(std::round((position[1] - this->Offset[1]) / Spacing));
+    const int k = static_cast<int>(std::round((position[2] - this->Offset[2]) / Spacing));
+    return (static_cast<uint64_t>(i) * Side + j) * 4 + k;
+  }
+
+  std::vector<FrameArchiveColumn> GetColumns() const
+  {
+    std::vector<FrameArchiveColumn> columns(2);
+    columns[0].Kind = FrameArchiveColumn::Points;
+    columns[0].DataType = VTK_DOUBLE;
+    columns[0].ValueSize = sizeof(double);
+    columns[0].NumberOfComponents = 3;
+    columns[0].Data = reinterpret_cast<const unsigned char*>(this->Points.data());
+    columns[0].Size = this->Points.size() * sizeof(double);
+    columns[1].Name = "intensity";
+    columns[1].DataType = VTK_UNSIGNED_SHORT;
+    columns[1].ValueSize = sizeof(unsigned short);
+    columns[1].Data = reinterpret_cast<const unsigned char*>(this->Intensity.data());
+    columns[1].Size = this->Intensity.size() * sizeof(unsigned short);
+    return columns;
+  }
+};
+
+// Decode a frame file with its manifest entry, and check that each point is
+// found back once, within the tolerance
+int TestFrameContent(const FrameWebWriter& writer, const FrameWebWriter::Frame& frame,
+                     const std::string& data, const TestFrame& test)
+{
+  int retVal = 0;
+  std::vector<int> found(test.GetNumberOfPoints(), 0);
+  double maxError = 0.0;
+  int maxScalarError = 0;
+  bool isCoarseLevelSparse = true;
+  uint64_t offset = 0;
+  for (const FrameWebWriter::Tile& tile : frame.Tiles)
+  {
+    retVal += Check(tile.Offset == offset, "unexpected tile offset");
+    isCoarseLevelSparse &= tile.LevelPoints.front() <= 16 * 16 * 16;
+    for (uint32_t levelPoints : tile.LevelPoints)
+    {
+      if (offset + levelPoints * 7 > data.size())
+      {
+        return retVal + Check(false, "the frame file is too small");
+      }
+      const unsigned char* positions = reinterpret_cast<const unsigned char*>(data.data()) + offset;
+      const unsigned char* scalars = positions + 6 * levelPoints;
+      for (uint32_t p = 0; p < levelPoints; ++p)
+      {
+        double position[3];
+        for (int k = 0; k < 3; ++k)
+        {
+          const int quantized = positions[6 * p + 2 * k] | (positions[6 * p + 2 * k + 1] << 8);
+          position[k] = tile.Index[k] * writer.GetTileSize() + quantized * writer.GetPositionStep();
+        }
+        const uint64_t point = test.FindPoint(position);
+        if (point >= test.GetNumberOfPoints())
+        {
+          return retVal + Check(false, "a decoded point is outside of the frame");
+        }
+        ++found[point];
+        for (int k = 0; k < 3; ++k)
+        {
+          maxError = std::max(maxError, std::abs(position[k] - test.Points[3 * point + k]));
+        }
+        const double intensity = frame.ScalarRange[0] +
+          scalars[p] * (frame.ScalarRange[1] - frame.ScalarRange[0]) / 255.0;
+        maxScalarError = std::max(maxScalarError,
+          static_cast<int>(std::round(std::abs(intensity - test.Intensity[point]))));
+      }
+      offset += levelPoints * 7;
+    }
+  }
+  retVal += Check(offset == data.size(), "unexpected size of the frame file");
+  retVal += Check(std::all_of(found.begin(), found.end(), [](int n) { return n == 1; }),
+                  "a point is missing or duplicated");
+  retVal += Check(maxError <= writer.GetPositionTolerance() + 1e-9,
+                  "position error above the tolerance: " + std::to_string(maxError));
+  retVal += Check(maxScalarError <= 1, "unexpected scalars");
+  retVal += Check(isCoarseLevelSparse, "the first level holds more than one point per cell");
+  return retVal;
+}
+}
+
+int main()
+{
+  int retVal = 0;
+  const ScratchDirectory scratch("TestFrameWebWriter");
+  const boost::filesystem::path& directory = scratch.GetPath();
+  TestFrame test;
+
+  // invalid settings are rejected
+  FrameWebWriter writer;
+  writer.SetTileSize(1000.0);
+  retVal += Check(!writer.Open(directory.string()), "a tile too large to be quantized was accepted");
+  writer.SetTileSize(8.0);
+  writer.SetPositionTolerance(0.002);
+  writer.SetNumberOfLevels(3);
+  retVal += Check(writer.Open(directory.string()), "could not open the directory");
+
+  // the files do not depend on the number of threads
+  writer.SetNumberOfThreads(1);
+  retVal += Check(writer.WriteFrame(1.5, test.GetNumberOfPoints(), test.GetColumns()),
+                  "could not write the sequential frame");
+  writer.SetNumberOfThreads(4);
+  retVal += Check(writer.WriteFrame(2.5, test.GetNumberOfPoints(), test.GetColumns()),
+                  "could not write the parallel frame");
+  const std::vector<FrameWebWriter::Frame> frames = writer.GetFrames();
+  retVal += Check(frames.size() == 2 && frames[0].Tiles.size() > 1, "unexpected frames");
+  const std::string sequential = ReadFile((directory / frames[0].FileName).string());
+  const std::string parallel = ReadFile((directory / frames[1].FileName).string());
+  retVal += Check(sequential == parallel, "the parallel frame differs from the sequential one");
+  retVal += TestFrameContent(writer, frames[1], parallel, test);
+
+  // a frame without points is rejected
+  std::vector<FrameArchiveColumn> columns = test.GetColumns();
+  columns.erase(columns.begin());
+  retVal += Check(!writer.WriteFrame(3.5, test.GetNumberOfPoints(), columns),
+                  "a frame without points was accepted");
+
+  retVal += Check(writer.Close(), "could not write the manifest");
+  const std::string manifest = ReadFile((directory / "manifest.json").string());
+  retVal += Check(manifest.find("\"frame_000001.bin\"") != std::string::npos &&
+                  manifest.find("\"level_points\"") != std::string::npos, "unexpected manifest");
+
+  return retVal;
+}
@@ -0,0 +1,89 @@
+#include "IPFragmentTable.h"
+#include "TestCheck.h"
+
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace
+{
+//! Add the fragments of a datagram in the given order, return true if the
+//! datagram is complete after the last one and equal to the original
+bool AddDatagram(IPFragmentTable& table, uint64_t key, const std::vector<unsigned char>& datagram,
+                 unsigned int fragmentSize, const std::vector<size_t>& order, double time)
+{
+  const size_t numberOfFragments = (datagram.size() + fragmentSize - 1) / fragmentSize;
+  const unsigned char* data = nullptr;
+  unsigned int length = 0;
+  bool isComplete = false;
+  for (size_t k = 0; k < order.size() && k < numberOfFragments; ++k)
+  {
+    const size_t fragment = order[k];
+    const unsigned int offset = static_cast<unsigned int>(fragment * fragmentSize);
+    const unsigned int size = std::min<unsigned int>(fragmentSize, datagram.size() - offset);
+    isComplete = table.AddFragment(key, offset, datagram.data() + offset, size,
+                                   fragment + 1 < numberOfFragments, time, data, length);
+    if (isComplete && k + 1 < numberOfFragments)
+    {
+      return false;
+    }
+  }
+  return isComplete && length == datagram.size() &&
+    std::equal(datagram.begin(), datagram.end(), data);
+}
+}
+
+int main()
+{
+  int retVal = 0;
+
+  std::vector<unsigned char> datagram(4000);
+  std::iota(datagram.begin(), datagram.end(), 0);
+  const unsigned char sourceA[4] = { 192, 168, 1, 201 };
+  const unsigned char sourceB[4] = { 192, 168, 1, 202 };
+
+  // in order and out of order fragments
+  IPFragmentTable table(4, 1.0);
+  const uint64_t keyA = IPFragmentTable::MakeKey(sourceA, 7);
+  retVal += Check(AddDatagram(table, keyA, datagram, 1480, { 0, 1, 2 }, 0.0), "in order datagram");
+  table.Release(keyA);
+  retVal += Check(AddDatagram(table, keyA, datagram, 1480, { 2, 0, 1 }, 0.1), "out of order datagram");
+  table.Release(keyA);
+  retVal += Check(table.GetNumberOfPendingDatagrams() == 0, "released datagrams still pending");
+
+  // interleaved datagrams with the same identification from two sources
+  const uint64_t keyB = IPFragmentTable::MakeKey(sourceB, 7);
+  std::vector<unsigned char> other(datagram.rbegin(), datagram.rend());
+  const unsigned char* data = nullptr;
+  unsigned int length = 0;
+  table.AddFragment(keyA, 0, datagram.data(), 2000, true, 0.2, data, length);
+  table.AddFragment(keyB, 0, other.data(), 2000, true, 0.2, data, length);
+  bool isComplete = table.AddFragment(keyB, 2000, other.data() + 2000, 2000, false, 0.2, data, length);
+  retVal += Check(isComplete && std::equal(other.begin(), other.end(), data), "second source datagram");
+  table.Release(keyB);
+  isComplete = table.AddFragment(keyA, 2000, datagram.data() + 2000, 2000, false, 0.2, data, length);
+  retVal += Check(isComplete && std::equal(datagram.begin(), datagram.end(), data), "first source datagram");
+  table.Release(keyA);
+
+  // the incomplete datagrams expire, and the oldest is evicted when the table is full
+  for (uint16_t id = 0; id < 4; ++id)
+  {
+    table.AddFragment(IPFragmentTable::MakeKey(sourceA, id), 0, datagram.data(), 8, true,
+                      1.0 + 0.01 * id, data, length);
+  }
+  retVal += Check(table.GetNumberOfPendingDatagrams() == 4, "pending datagrams");
+  table.AddFragment(IPFragmentTable::MakeKey(sourceA, 10), 0, datagram.data(), 8, true, 1.5, data, length);
+  retVal += Check(table.GetNumberOfPendingDatagrams() == 4 && table.GetNumberOfEvictedDatagrams() == 1,
+                  "oldest datagram not evicted");
+  table.AddFragment(IPFragmentTable::MakeKey(sourceA, 11), 0, datagram.data(), 8, true, 2.6, data, length);
+  retVal += Check(table.GetNumberOfPendingDatagrams() == 1 && table.GetNumberOfEvictedDatagrams() == 5,
+                  "expired datagrams not evicted");
+
+  // the remaining datagram can still be completed after the evictions
+  isComplete = table.AddFragment(IPFragmentTable::MakeKey(sourceA, 11), 8, datagram.data() + 8, 8, false,
+                                 2.6, data, length);
+  retVal += Check(isComplete && length == 16, "datagram after eviction");
+
+  return retVal;
+}
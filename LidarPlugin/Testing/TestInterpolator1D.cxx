@@ -0,0 +1,138 @@
+#include "eigenFFTCorrelation.h"
+#include "interpolator1D.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+//! Same values as the search of the interval with std::lower_bound, with the batch APIs too
+int CheckValues(const Interpolator1D<double>& signal, const std::vector<double>& t,
+                const std::vector<double>& x, const std::string& name)
+{
+  int errors = 0;
+  const double start = signal.GetMinimumT() - 0.3;
+  const double period = 0.0137;
+  const int numberOfSamples = static_cast<int>((signal.GetMaximumT() - start) / period) + 20;
+  std::vector<double> times(numberOfSamples);
+  bool isSame = true;
+  for (int i = 0; i < numberOfSamples; ++i)
+  {
+    const double time = start + i * period;
+    times[i] = time;
+    double expected = 0.0;
+    if (time >= t.front() && time <= t.back())
+    {
+      const int sup = std::max(1, static_cast<int>(std::lower_bound(t.begin(), t.end(), time) - t.begin()));
+      const double alpha = (t[sup] - time) / (t[sup] - t[sup - 1]);
+      expected = alpha * x[sup - 1] + (1.0 - alpha) * x[sup];
+    }
+    isSame &= signal.Get(time) == expected;
+  }
+  errors += Check(isSame, "wrong values of the " + name + " signal");
+
+  std::vector<double> resampled;
+  signal.Resample(start, period, numberOfSamples, resampled);
+  const std::vector<double> values = signal.Get(times);
+  std::vector<double> shuffled = times;
+  std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(1));
+  const std::vector<double> shuffledValues = signal.Get(shuffled);
+  for (int i = 0; i < numberOfSamples; ++i)
+  {
+    isSame &= resampled[i] == signal.Get(times[i]) && values[i] == resampled[i]
+              && shuffledValues[i] == signal.Get(shuffled[i]);
+  }
+  errors += Check(isSame, "the batch values of the " + name + " signal are not the same");
+  return errors;
+}
+}
+
+int main()
+{
+  int errors = 0;
+
+  // the same samples, evenly spaced or not
+  for (double jitter : { 0.0, 0.004 })
+  {
+    const std::string name = jitter == 0.0 ? "uniform" : "irregular";
+    std::vector<double> t(500), x(500);
+    std::mt19937 generator(0);
+    std::uniform_real_distribution<double> noise(-jitter, jitter);
+    for (int i = 0; i < 500; ++i)
+    {
+      t[i] = 12.5 + i * 0.01 + noise(generator);
+      x[i] = std::sin(0.37 * i) + 0.1 * i;
+    }
+    Interpolator1D<double> signal(t, x);
+    errors += Check(signal.IsUniformGrid() == (jitter == 0.0), "wrong grid detection of the " + name + " signal");
+    errors += CheckValues(signal, t, x, name);
+
+    // the interval of the first instant is the first one
+    errors += Check(signal.Get(t.front()) == x.front(), "wrong value at the first instant");
+  }
+
+  // FFT friendly sizes
+  errors += Check(FFTFriendlySize(1) == 1 && FFTFriendlySize(7) == 8 && FFTFriendlySize(1000) == 1000
+                  && FFTFriendlySize(1001) == 1024 && FFTFriendlySize(1025) == 1080,
+                  "wrong FFT friendly sizes");
+  for (int n = 1; n < 3000; ++n)
+  {
+    int size = FFTFriendlySize(n);
+    const bool isLarger = size >= n;
+    for (int factor : { 2, 3, 5 })
+    {
+      while (size % factor == 0)
+      {
+        size /= factor;
+      }
+    }
+    if (!isLarger || size != 1)
+    {
+      errors += Check(false, "wrong FFT friendly size of " + std::to_string(n));
+      break;
+    }
+  }
+
+  // the correlator gives the same correlation as scipy with padded sizes of any factors
+  FFTCorrelator<double> correlator;
+  std::mt19937 generator(2);
+  std::normal_distribution<double> noise(0.0, 1.0);
+  for (int size : { 1, 17, 250, 777, 1000 })
+  {
+    std::vector<double> a(size), b(size + 13);
+    for (double& value : a)
+    {
+      value = noise(generator);
+    }
+    for (double& value : b)
+    {
+      value = noise(generator);
+    }
+    const std::vector<double> expected = fftcorrelate(a, b);
+    const std::vector<double>& correlation = correlator.Correlate(a, b);
+    double maximumError = 0.0;
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+      maximumError = std::max(maximumError, std::abs(expected[i] - correlation[i]));
+    }
+    errors += Check(correlation.size() == expected.size() && maximumError < 1e-9,
+                    "wrong correlation of size " + std::to_string(size));
+  }
+
+  // a shifted signal is found back
+  std::vector<double> reference(600), shifted(600);
+  for (int i = 0; i < 600; ++i)
+  {
+    reference[i] = std::exp(-0.001 * (i - 300) * (i - 300));
+    shifted[i] = std::exp(-0.001 * (i - 342) * (i - 342));
+  }
+  errors += Check(std::abs(correlator.MaxCorrelation(reference, shifted) + 42.0) < 0.1,
+                  "wrong shift found by the correlator");
+
+  return errors;
+}
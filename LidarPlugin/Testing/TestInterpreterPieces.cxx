@@ -0,0 +1,95 @@
+#include "VelodynePacketGenerator.h"
+#include "vtkVelodynePacketInterpreter.h"
+#include "TestCheck.h"
+
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+// Decode a second of synthetic VLP-16 packets, and count the points of each laser
+std::vector<vtkIdType> CountPointsPerLaser(vtkVelodynePacketInterpreter* interpreter)
+{
+  interpreter->ResetCurrentFrame();
+  interpreter->ClearAllFramesAvailable();
+  VelodynePacketGenerator generator(VelodynePacketGenerator::VLP16, false);
+  std::vector<vtkIdType> counts(16, 0);
+  std::vector<unsigned char> packet(VelodynePacketGenerator::PacketSize);
+  while (generator.GeneratePacket(packet.data()) < 1.0)
+  {
+    interpreter->ProcessPacket(packet.data(), VelodynePacketGenerator::PacketSize);
+    if (!interpreter->IsNewFrameReady())
+    {
+      continue;
+    }
+    vtkSmartPointer<vtkPolyData> frame = interpreter->GetLastFrameAvailable();
+    interpreter->ClearAllFramesAvailable();
+    vtkDataArray* laserIds = frame->GetPointData()->GetArray("laser_id");
+    for (vtkIdType i = 0; laserIds && i < frame->GetNumberOfPoints(); ++i)
+    {
+      const int laserId = static_cast<int>(laserIds->GetTuple1(i));
+      if (laserId >= 0 && laserId < static_cast<int>(counts.size()))
+      {
+        counts[laserId]++;
+      }
+    }
+  }
+  return counts;
+}
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Wrong number of arguments. Usage: TestInterpreterPieces <VLP-16.xml>" << std::endl;
+    return 1;
+  }
+  int retVal = 0;
+
+  // the same interpreter is used for all the pieces, as the reader does
+  auto interpreter = vtkSmartPointer<vtkVelodynePacketInterpreter>::New();
+  interpreter->SetCalibrationFileName(argv[1]);
+  interpreter->LoadCalibration(argv[1]);
+  retVal += Check(interpreter->GetIsCalibrated(), "the calibration could not be loaded");
+  const std::vector<vtkIdType> allLasers = CountPointsPerLaser(interpreter);
+  for (vtkIdType count : allLasers)
+  {
+    retVal += Check(count > 0, "a laser has no point");
+  }
+
+  for (int numberOfPieces : { 2, 3, 16 })
+  {
+    std::vector<vtkIdType> merged(allLasers.size(), 0);
+    bool isOverlapping = false;
+    for (int piece = 0; piece < numberOfPieces; ++piece)
+    {
+      interpreter->SetPiece(piece, numberOfPieces);
+      const std::vector<vtkIdType> counts = CountPointsPerLaser(interpreter);
+      for (size_t laserId = 0; laserId < counts.size(); ++laserId)
+      {
+        isOverlapping |= counts[laserId] > 0 && merged[laserId] > 0;
+        retVal += Check(counts[laserId] == 0 || static_cast<int>(laserId) % numberOfPieces == piece,
+                        "the laser " + std::to_string(laserId) + " is decoded in the piece "
+                        + std::to_string(piece) + " of " + std::to_string(numberOfPieces));
+        merged[laserId] += counts[laserId];
+      }
+    }
+    retVal += Check(!isOverlapping, "a laser belongs to several of the "
+                    + std::to_string(numberOfPieces) + " pieces");
+    retVal += Check(merged == allLasers, "the " + std::to_string(numberOfPieces)
+                    + " pieces do not cover all the lasers");
+  }
+
+  // back to the whole frames
+  interpreter->SetPiece(0, 1);
+  retVal += Check(CountPointsPerLaser(interpreter) == allLasers, "a single piece is not the whole frame");
+
+  return retVal;
+}
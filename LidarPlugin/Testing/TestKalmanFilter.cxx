@@ -0,0 +1,84 @@
+#include "KalmanFilter.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  int errors = 0;
+
+  // Constant velocity model, the measures being the poses of a sensor
+  // moving at 2 m.s-1 along x and turning at 0.1 rad.s-1 around z
+  for (int mode = 0; mode < 2; ++mode)
+  {
+    KalmanFilter filter;
+    filter.SetMode(mode);
+    filter.SetInitialStatevector(KalmanFilter::StateVector::Zero(), KalmanFilter::StateMatrix::Identity());
+    filter.SetCurrentTime(0.0);
+    KalmanFilter::MeasureMatrix covariance =
+      1e-4 * KalmanFilter::MeasureMatrix::Identity(filter.GetNbrMeasure(), filter.GetNbrMeasure());
+    filter.SetMeasureCovariance(covariance);
+    KalmanFilter::MeasureVector measure(filter.GetNbrMeasure());
+
+    for (int k = 1; k <= 100; ++k)
+    {
+      const double time = 0.1 * k;
+      filter.SetCurrentTime(time);
+      filter.Prediction();
+      measure.setZero();
+      measure(2) = 0.1 * time;
+      measure(3) = 2.0 * time;
+      if (mode > 0)
+      {
+        measure(6) = 2.0;
+      }
+      filter.Correction(measure);
+    }
+
+    const KalmanFilter::StateVector state = filter.GetStateVector();
+    errors += Check(std::abs(state(9) - 2.0) < 1e-2, "wrong velocity estimated");
+    errors += Check(std::abs(state(8) - 0.1) < 1e-2, "wrong angular velocity estimated");
+  }
+
+  // IMU prediction of a sensor turning at 0.2 rad.s-1 around z and
+  // accelerating at 1 m.s-2 along its x axis, the IMU running at 200 Hz
+  {
+    KalmanFilter filter;
+    filter.SetInitialStatevector(KalmanFilter::StateVector::Zero(), KalmanFilter::StateMatrix::Zero());
+    filter.SetCurrentTime(0.0);
+    std::vector<ImuSample> samples(201);
+    for (size_t k = 0; k < samples.size(); ++k)
+    {
+      samples[k].Time = k / 200.0;
+      samples[k].AngularVelocity = Eigen::Vector3d(0.0, 0.0, 0.2);
+      samples[k].Acceleration = Eigen::Vector3d(1.0, 0.0, 9.81);
+    }
+    filter.SetCurrentTime(1.0);
+    filter.Prediction(samples);
+
+    // the predicted state is only given by a correction
+    KalmanFilter::MeasureVector measure(filter.GetNbrMeasure());
+    measure.setZero();
+    filter.SetMeasureCovariance(1e6 * KalmanFilter::MeasureMatrix::Identity(6, 6));
+    filter.Correction(measure);
+    const KalmanFilter::StateVector state = filter.GetStateVector();
+
+    // exact integration of the acceleration rotating with the sensor
+    const double w = 0.2;
+    const double vx = std::sin(w) / w, vy = (1.0 - std::cos(w)) / w;
+    const double x = (1.0 - std::cos(w)) / (w * w), y = (w - std::sin(w)) / (w * w);
+    errors += Check(std::abs(state(2) - 0.2) < 1e-3, "wrong predicted yaw");
+    errors += Check(std::abs(state(8) - 0.2) < 1e-9, "wrong predicted angular velocity");
+    errors += Check(std::abs(state(9) - vx) < 1e-2 && std::abs(state(10) - vy) < 1e-2,
+                    "wrong predicted velocity");
+    errors += Check(std::abs(state(3) - x) < 1e-2 && std::abs(state(4) - y) < 1e-2,
+                    "wrong predicted position");
+    errors += Check(std::abs(state(5)) < 1e-9 && std::abs(state(11)) < 1e-9, "gravity not compensated");
+  }
+
+  return errors;
+}
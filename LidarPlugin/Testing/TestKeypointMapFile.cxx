@@ -0,0 +1,129 @@
+#include "KeypointMapFile.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <tuple>
+
+#include <boost/filesystem.hpp>
+
+namespace
+{
+const double Resolution = 10.0;
+
+//! Points spread over several voxels, numbered by their time, with a fit
+//! depending on the number of the point, one in three being rejected
+KeypointMapFile::LayerData MakeLayer(int nbPoints, std::mt19937& generator)
+{
+  std::uniform_real_distribution<float> coordinate(-35, 35);
+  KeypointMapFile::LayerData layer;
+  layer.Points.reset(new pcl::PointCloud<PointXYZTIId>);
+  for (int i = 0; i < nbPoints; ++i)
+  {
+    PointXYZTIId point;
+    point.x = coordinate(generator);
+    point.y = coordinate(generator);
+    point.z = coordinate(generator) / 10;
+    point.time = i;
+    point.intensity = static_cast<uint8_t>(i);
+    point.laserId = static_cast<uint8_t>(i % 16);
+    layer.Points->push_back(point);
+
+    KeypointMapFile::Fit fit = {};
+    fit.Valid = i % 3 != 0;
+    fit.Status = fit.Valid ? 6 : 2;
+    Eigen::Matrix3d A;
+    A << i, 1, 2,
+         1, 3, 4,
+         2, 4, 5;
+    fit.SetA(A);
+    fit.Mean[0] = point.x;
+    fit.Mean[1] = -0.5f * i;
+    fit.Mean[2] = 1;
+    fit.Coefficient = 0.5f;
+    layer.Fits.push_back(fit);
+  }
+  return layer;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  int errors = 0;
+  const ScratchDirectory scratch("TestKeypointMapFile");
+  const boost::filesystem::path& directory = scratch.GetPath();
+  const std::string filename = (directory / "map.lvmap").string();
+
+  std::mt19937 generator(11);
+  const int nbPoints[KeypointMapFile::NumberOfLayers] = { 2000, 5000, 0 };
+  KeypointMapFile::LayerData layers[KeypointMapFile::NumberOfLayers];
+  for (int layer = 0; layer < KeypointMapFile::NumberOfLayers; ++layer)
+  {
+    layers[layer] = MakeLayer(nbPoints[layer], generator);
+  }
+  errors += Check(KeypointMapFile::Write(filename, Resolution, layers), "could not write the map");
+
+  KeypointMapFile file;
+  if (Check(file.Open(filename), "could not open the map"))
+  {
+    return 1;
+  }
+  errors += Check(file.GetVoxelResolution() == Resolution, "wrong resolution");
+
+  for (int layer = 0; layer < KeypointMapFile::NumberOfLayers; ++layer)
+  {
+    errors += Check(file.GetNumberOfPoints(layer) == static_cast<uint64_t>(nbPoints[layer]), "wrong number of points");
+
+    // the voxels are sorted, and contain the points sorted by voxel
+    const std::vector<KeypointMapFile::Voxel>& voxels = file.GetVoxels(layer);
+    bool voxelsOk = true;
+    uint64_t nextPoint = 0;
+    std::map<int, bool> seen;
+    for (size_t v = 0; v < voxels.size(); ++v)
+    {
+      const KeypointMapFile::Voxel& voxel = voxels[v];
+      if (v > 0)
+      {
+        const KeypointMapFile::Voxel& previous = voxels[v - 1];
+        voxelsOk &= std::tie(previous.X, previous.Y, previous.Z) < std::tie(voxel.X, voxel.Y, voxel.Z);
+      }
+      voxelsOk &= voxel.FirstPoint == nextPoint && voxel.NumberOfPoints > 0;
+      nextPoint += voxel.NumberOfPoints;
+
+      pcl::PointCloud<PointXYZTIId> points;
+      file.GetPoints(layer, voxel.FirstPoint, voxel.NumberOfPoints, points);
+      for (uint64_t i = 0; i < voxel.NumberOfPoints; ++i)
+      {
+        const PointXYZTIId& point = points.points[i];
+        voxelsOk &= std::floor(point.x / Resolution) == voxel.X && std::floor(point.y / Resolution) == voxel.Y &&
+                    std::floor(point.z / Resolution) == voxel.Z;
+
+        // the point and its fit are the ones written
+        const int number = static_cast<int>(point.time);
+        const PointXYZTIId& written = layers[layer].Points->points[number];
+        const KeypointMapFile::Fit& fit = file.GetFit(layer, voxel.FirstPoint + i);
+        voxelsOk &= !seen[number] && point.x == written.x && point.y == written.y && point.z == written.z &&
+                    point.intensity == written.intensity && point.laserId == written.laserId;
+        voxelsOk &= fit.Valid == layers[layer].Fits[number].Valid && fit.Status == layers[layer].Fits[number].Status &&
+                    fit.GetA()(0, 0) == number && fit.GetA()(2, 1) == 4 && fit.GetMean()(1) == -0.5f * number;
+        seen[number] = true;
+      }
+    }
+    errors += Check(voxelsOk && nextPoint == file.GetNumberOfPoints(layer), "wrong voxels");
+  }
+
+  // a file which is not a map is rejected
+  const std::string other = (directory / "other.lvmap").string();
+  {
+    std::ofstream os(other, std::ios::binary);
+    os << std::string(1000, 'x');
+  }
+  errors += Check(!file.Open(other) && !file.IsOpen(), "a file which is not a map was opened");
+
+  return errors;
+}
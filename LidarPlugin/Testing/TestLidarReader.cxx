@@ -90,6 +90,8 @@ int main(int argc, char* argv[])
   auto interp = vtkSmartPointer<vtkVelodynePacketInterpreter>::New();
   HDLReader->SetInterpreter(interp);
   HDLReader->SetFileName(pcapFileName);
+  // scan the pcap, and do not write the sidecar of its catalog next to the test data
+  HDLReader->SetUseFrameIndexCache(false);
   HDLReader->SetCalibrationFileName(correctionFileName);
   HDLReader->Update();
 
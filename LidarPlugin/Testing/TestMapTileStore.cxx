@@ -0,0 +1,85 @@
+#include "MapTileStore.h"
+#include "TestCheck.h"
+
+#include <iostream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+namespace
+{
+pcl::PointCloud<PointXYZTIId> MakeTile(int index, int nbPoints)
+{
+  pcl::PointCloud<PointXYZTIId> tile;
+  for (int i = 0; i < nbPoints; ++i)
+  {
+    PointXYZTIId point;
+    point.x = index * 10.0 + 0.01 * i;
+    point.y = -0.5 * i;
+    point.z = 0.25 * index;
+    point.time = 1e6 + index + 1e-3 * i;
+    point.intensity = static_cast<uint8_t>(i);
+    point.laserId = static_cast<uint8_t>(i % 16);
+    tile.push_back(point);
+  }
+  return tile;
+}
+
+bool SameTile(const pcl::PointCloud<PointXYZTIId>& a, const pcl::PointCloud<PointXYZTIId>& b)
+{
+  if (a.size() != b.size())
+  {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i)
+  {
+    if (a.points[i].x != b.points[i].x || a.points[i].y != b.points[i].y ||
+        a.points[i].z != b.points[i].z || a.points[i].time != b.points[i].time ||
+        a.points[i].intensity != b.points[i].intensity || a.points[i].laserId != b.points[i].laserId)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  const ScratchDirectory scratch("TestMapTileStore");
+  const boost::filesystem::path& directory = scratch.GetPath();
+  int errors = 0;
+  {
+    MapTileStore store(directory.string());
+    const MapTileStore::TileIndex first = {{1, -2, 0}};
+    const MapTileStore::TileIndex second = {{-3, 4, 1}};
+
+    errors += Check(store.Write(first, MakeTile(1, 500)), "first tile not written");
+    errors += Check(store.Write(second, MakeTile(2, 20)), "second tile not written");
+    errors += Check(store.GetNumberOfTiles() == 2, "wrong number of tiles");
+    errors += Check(store.Contains(first) && store.Contains(second), "tile missing");
+    errors += Check(!store.Read({{0, 0, 0}}), "reading a tile which was not written");
+
+    // peek keeps the tile in the store, read removes it
+    auto peeked = store.Peek(first);
+    errors += Check(peeked && SameTile(*peeked, MakeTile(1, 500)), "wrong points peeked");
+    errors += Check(store.Contains(first), "peeked tile removed");
+    auto read = store.Read(first);
+    errors += Check(read && SameTile(*read, MakeTile(1, 500)), "wrong points read");
+    errors += Check(!store.Contains(first) && store.GetNumberOfTiles() == 1, "read tile not removed");
+
+    // writing again replaces the tile, an empty tile removes it
+    errors += Check(store.Write(second, MakeTile(3, 7)), "tile not replaced");
+    auto replaced = store.Peek(second);
+    errors += Check(replaced && SameTile(*replaced, MakeTile(3, 7)), "wrong points replaced");
+    errors += Check(store.Write(second, pcl::PointCloud<PointXYZTIId>()), "empty tile not written");
+    errors += Check(store.GetNumberOfTiles() == 0, "empty tile stored");
+
+    errors += Check(store.Write(first, MakeTile(4, 3)), "tile not written again");
+  }
+  // the destruction of the store removes its files
+  errors += Check(boost::filesystem::is_empty(directory), "tile files left in the directory");
+
+  return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+#include "MemoryBudget.h"
+#include "TestCheck.h"
+
+#include <iostream>
+#include <string>
+
+namespace
+{
+//! Consumer made of blocks of 100 KiB, which can refuse to release memory
+struct TestConsumer : public MemoryBudget::Consumer
+{
+  unsigned long Size = 0;
+  bool IsLocked = false;
+
+  unsigned long ReleaseMemory(unsigned long size) override
+  {
+    unsigned long released = 0;
+    while (!this->IsLocked && released < size && this->Size > 0)
+    {
+      this->Size -= 100;
+      released += 100;
+    }
+    return released;
+  }
+
+  //! Grow and release what the budget asks
+  void Grow(unsigned long size)
+  {
+    this->Size += size;
+    MemoryBudget& budget = MemoryBudget::GetInstance();
+    unsigned long excess = budget.Report(this, this->Size);
+    while (excess > 0)
+    {
+      const unsigned long released = this->ReleaseMemory(excess);
+      excess = released > 0 ? budget.Report(this, this->Size) : 0;
+    }
+  }
+};
+}
+
+int main()
+{
+  int retVal = 0;
+  MemoryBudget& budget = MemoryBudget::GetInstance();
+  budget.SetLimit(1000);
+
+  TestConsumer frames, images, maps;
+  budget.Register(&maps, "maps", 20);
+  budget.Register(&frames, "frames", 0);
+  budget.Register(&images, "images", 10);
+
+  frames.Grow(600);
+  images.Grow(300);
+  retVal += Check(budget.GetSize() == 900, "consumers shrunk under the limit");
+
+  // the lowest priority releases first
+  maps.Grow(300);
+  retVal += Check(frames.Size == 400 && images.Size == 300 && maps.Size == 300,
+                  "wrong consumer released memory");
+
+  // the caller releases itself when its turn comes
+  images.Grow(500);
+  retVal += Check(frames.Size == 0 && images.Size == 700 && maps.Size == 300,
+                  "caller not asked to release");
+
+  // a consumer which cannot release now is skipped
+  images.IsLocked = true;
+  frames.Grow(200);
+  retVal += Check(frames.Size == 0 && images.Size == 700, "locked consumer");
+  images.IsLocked = false;
+  retVal += Check(budget.GetSize() <= 1000, "over the limit");
+
+  // an unregistered consumer is not counted anymore
+  budget.Unregister(&images);
+  retVal += Check(budget.GetSize() == maps.Size + frames.Size, "unregistered consumer counted");
+  budget.Unregister(&frames);
+  budget.Unregister(&maps);
+
+  // the default limit
+  budget.SetLimit(0);
+  retVal += Check(budget.GetLimit() > 0, "no default limit");
+
+  return retVal;
+}
@@ -1,7 +1,11 @@
 #include "NMEAParser.h"
 
+#include <chrono>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
+#include <string>
+#include <vector>
 
 #include "TestHelpers.h"
 
@@ -112,8 +116,118 @@ bool test_sentence(NMEAParser& parser,
 }
 
 
+//------------------------------------------------------------------------------
+// Parse the sentence copying each word, as ParseLocation did before parsing in place
+bool parse_copying_words(NMEAParser& parser, const std::string& sentence, NMEALocation& location)
+{
+  location.Init();
+  std::vector<std::string> w = parser.SplitWords(sentence);
+  return parser.ChecksumValid(sentence)
+         && ((parser.IsGPRMC(w) && parser.ParseGPRMC(w, location))
+             || (parser.IsGPGGA(w) && parser.ParseGPGGA(w, location))
+             || (parser.IsGPGLL(w) && parser.ParseGPGLL(w, location)));
+}
+
+
+//------------------------------------------------------------------------------
+// Check that the parser that splits the sentences in place gives the same
+// locations as the one that copies each word
+bool test_parsing_equivalence(NMEAParser& parser, const std::vector<std::string>& sentences)
+{
+  bool allSame = true;
+  for (const std::string& sentence : sentences)
+  {
+    NMEALocation inPlace, copy;
+    const bool parsedInPlace = parser.ParseLocation(sentence.c_str(), sentence.size(), inPlace);
+    const bool parsedCopy = parse_copying_words(parser, sentence, copy);
+    const bool same = parsedInPlace == parsedCopy && inPlace.Valid == copy.Valid
+      && compare(&inPlace.Lat, &copy.Lat, 1, epsilon)
+      && compare(&inPlace.Long, &copy.Long, 1, epsilon)
+      && compare(&inPlace.UTCSecondsOfDay, &copy.UTCSecondsOfDay, 1, epsilon)
+      && inPlace.HasAltitude == copy.HasAltitude
+      && (!inPlace.HasAltitude || compare(&inPlace.Altitude, &copy.Altitude, 1, epsilon))
+      && inPlace.HasGeoidalSeparation == copy.HasGeoidalSeparation
+      && (!inPlace.HasGeoidalSeparation
+          || compare(&inPlace.GeoidalSeparation, &copy.GeoidalSeparation, 1, epsilon))
+      && inPlace.HasTypeOfFix == copy.HasTypeOfFix
+      && (!inPlace.HasTypeOfFix || inPlace.TypeOfFix == copy.TypeOfFix)
+      && inPlace.HasHorizontalDOP == copy.HasHorizontalDOP
+      && (!inPlace.HasHorizontalDOP || compare(&inPlace.HorizontalDOP, &copy.HorizontalDOP, 1, epsilon))
+      && inPlace.HasSpeed == copy.HasSpeed
+      && (!inPlace.HasSpeed || compare(&inPlace.Speed, &copy.Speed, 1, epsilon))
+      && inPlace.HasTrackAngle == copy.HasTrackAngle
+      && (!inPlace.HasTrackAngle || compare(&inPlace.TrackAngle, &copy.TrackAngle, 1, epsilon))
+      && inPlace.HasDate == copy.HasDate
+      && (!inPlace.HasDate || (inPlace.DateDay == copy.DateDay && inPlace.DateMonth == copy.DateMonth
+                               && inPlace.DateYear == copy.DateYear))
+      && inPlace.HasFAA == copy.HasFAA
+      && (!inPlace.HasFAA || inPlace.FAA == copy.FAA);
+    if (!parsedInPlace || !same)
+    {
+      std::cerr << "The sentence " << sentence << " is not parsed in place as when copying its words" << std::endl;
+      allSame = false;
+    }
+  }
+  return allSame;
+}
+
+
+//------------------------------------------------------------------------------
+// Measure the throughput of the parsing of the sentences, using the parser
+// that splits the sentence in place, then the one that copies each word
+bool benchmark_parsing(NMEAParser& parser, const std::vector<std::string>& sentences)
+{
+  const int nbRepetitions = 100000;
+  NMEALocation location;
+  bool allParsed = true;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < nbRepetitions; ++i)
+  {
+    for (const std::string& sentence : sentences)
+    {
+      allParsed &= parser.ParseLocation(sentence.c_str(), sentence.size(), location);
+    }
+  }
+  std::chrono::duration<double> elapsedInPlace = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < nbRepetitions; ++i)
+  {
+    for (const std::string& sentence : sentences)
+    {
+      allParsed &= parse_copying_words(parser, sentence, location);
+    }
+  }
+  std::chrono::duration<double> elapsedCopy = std::chrono::steady_clock::now() - start;
+
+  const double nbSentences = static_cast<double>(nbRepetitions * sentences.size());
+  std::cout << "BENCHMARK InPlace sentences/s=" << nbSentences / elapsedInPlace.count() << std::endl;
+  std::cout << "BENCHMARK CopyingWords sentences/s=" << nbSentences / elapsedCopy.count() << std::endl;
+  if (!allParsed)
+  {
+    std::cerr << "Some sentences could not be parsed during the benchmark" << std::endl;
+  }
+  return allParsed;
+}
+
+
 int main(int argc, char* argv[])
 {
+  const std::vector<std::string> sentences = {
+    "$GPGGA,123519.5,4807.038,S,01131.000,W,1,08,0.9,545.4,M,46.9,M,,*53",
+    "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W,*46",
+    "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W,A,*2B",
+    "$GPGLL,4916.45,N,12311.12,W,225444,A,*1D",
+    "$GPGLL,4916.45,N,12311.12,W,225444,A,D,*75"};
+
+  // the benchmark does not test the parsing of the other sentences
+  if (argc > 1 && std::string(argv[1]) == "--benchmark")
+  {
+    NMEAParser parser;
+    return benchmark_parsing(parser, sentences) ? 0 : 1;
+  }
+
   double unused_double = 42.0;
   int unused_int = 42;
   NMEALocation::FixType unused_type_of_fix = NMEALocation::GPS_FIX;
@@ -251,6 +365,17 @@ int main(int argc, char* argv[])
                            true, // no FAA
                            NMEALocation::DIFFERENTIAL_FAA);
 
+  // the sentence does not need to be null terminated
+  const std::string packet = "$GPGLL,4916.45,N,12311.12,W,225444,A,D,*75\r\n0123";
+  NMEALocation location;
+  if (!parser.ParseLocation(packet.c_str(), std::strlen("$GPGLL,4916.45,N,12311.12,W,225444,A,D,*75"), location)
+      || location.FAA != NMEALocation::DIFFERENTIAL_FAA)
+  {
+    std::cerr << "Could not parse a sentence inside a larger buffer" << std::endl;
+    allgood = false;
+  }
+
+  allgood &= test_parsing_equivalence(parser, sentences);
 
   return allgood ? 0 : 1;
 }
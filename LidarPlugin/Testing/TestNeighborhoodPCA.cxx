@@ -0,0 +1,147 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "NeighborhoodPCA.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct TestPoint
+{
+  float x, y, z;
+};
+
+// Neighborhood of count points around center, spread with the given
+// standard deviations along the axes of a random orientation
+std::vector<TestPoint> MakeNeighborhood(std::mt19937& generator, const Eigen::Vector3d& center,
+                                        const Eigen::Vector3d& sigmas, unsigned int count)
+{
+  std::normal_distribution<double> normal(0.0, 1.0);
+  Eigen::Quaterniond orientation(normal(generator), normal(generator), normal(generator), normal(generator));
+  Eigen::Matrix3d R = orientation.normalized().toRotationMatrix();
+  std::vector<TestPoint> points(count);
+  for (TestPoint& point : points)
+  {
+    Eigen::Vector3d X(sigmas(0) * normal(generator), sigmas(1) * normal(generator), sigmas(2) * normal(generator));
+    X = center + R * X;
+    point.x = X(0);
+    point.y = X(1);
+    point.z = X(2);
+  }
+  return points;
+}
+
+// Compare the PCA with the iterative double precision solver
+// on the points, as done previously by the SLAM
+template <typename Scalar>
+int CheckNeighborhood(const std::vector<TestPoint>& points, double eigenValueTolerance,
+                      double directionTolerance, const std::string& name)
+{
+  std::vector<int> indices(points.size());
+  for (unsigned int k = 0; k < indices.size(); ++k)
+  {
+    indices[k] = static_cast<int>(indices.size() - 1 - k);
+  }
+  NeighborhoodPCA<Scalar> pca;
+  pca.Compute(points, indices.data(), indices.size());
+
+  Eigen::MatrixXd data(points.size(), 3);
+  for (unsigned int k = 0; k < points.size(); ++k)
+  {
+    data.row(k) << points[k].x, points[k].y, points[k].z;
+  }
+  Eigen::Vector3d mean = data.colwise().mean();
+  Eigen::MatrixXd centered = data.rowwise() - mean.transpose();
+  Eigen::Matrix3d varianceCovariance = centered.transpose() * centered;
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eig(varianceCovariance);
+  Eigen::Vector3d D = eig.eigenvalues();
+
+  int errors = 0;
+  errors += Check((pca.Mean - mean).norm() < 1e-4, name + ": wrong mean");
+  errors += Check((pca.Scatter - varianceCovariance).norm() <= eigenValueTolerance * D(2),
+                  name + ": wrong scatter matrix");
+  for (int i = 0; i < 3; ++i)
+  {
+    errors += Check(std::abs(pca.EigenValues(i) - D(i)) <= eigenValueTolerance * D(2),
+                    name + ": wrong eigen value " + std::to_string(i));
+  }
+  // the directions are only compared when their eigen value is isolated
+  for (int i = 0; i < 3; ++i)
+  {
+    double gap = std::min(i > 0 ? D(i) - D(i - 1) : D(2), i < 2 ? D(i + 1) - D(i) : D(2));
+    if (gap > 0.1 * D(2))
+    {
+      double cosAngle = std::abs(pca.EigenVectors.col(i).dot(eig.eigenvectors().col(i)));
+      errors += Check(cosAngle > 1.0 - directionTolerance,
+                      name + ": wrong eigen vector " + std::to_string(i));
+    }
+  }
+  return errors;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  int errors = 0;
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> position(-2000.0, 2000.0);
+
+  // Shape of the neighborhoods fitted by the SLAM: edges,
+  // planes and blobs, with their number of neighbors
+  struct Shape
+  {
+    std::string Name;
+    Eigen::Vector3d Sigmas;
+    unsigned int Count;
+  };
+  const std::vector<Shape> shapes = {
+    { "line", Eigen::Vector3d(0.5, 0.02, 0.01), 5 },
+    { "line", Eigen::Vector3d(1.0, 0.01, 0.005), 10 },
+    { "plane", Eigen::Vector3d(0.5, 0.4, 0.01), 5 },
+    { "plane", Eigen::Vector3d(1.0, 0.8, 0.02), 15 },
+    { "blob", Eigen::Vector3d(0.3, 0.2, 0.1), 25 }
+  };
+
+  for (const Shape& shape : shapes)
+  {
+    for (int trial = 0; trial < 200; ++trial)
+    {
+      Eigen::Vector3d center(position(generator), position(generator), 0.01 * position(generator));
+      std::vector<TestPoint> points = MakeNeighborhood(generator, center, shape.Sigmas, shape.Count);
+      errors += CheckNeighborhood<double>(points, 1e-9, 1e-9, "double " + shape.Name);
+      errors += CheckNeighborhood<float>(points, 1e-6, 1e-6, "float " + shape.Name);
+    }
+  }
+
+  // degenerated neighborhood: dual returns on the same point
+  std::vector<TestPoint> duplicated(5, TestPoint{ 1000.5f, -20.25f, 3.0f });
+  std::vector<int> indices = { 0, 1, 2, 3, 4 };
+  NeighborhoodPCA<float> pca;
+  pca.Compute(duplicated, indices.data(), indices.size());
+  errors += Check(pca.EigenValues.norm() == 0, "non null eigen values of a single point");
+  errors += Check(std::abs(pca.Mean(0) - 1000.5) < 1e-9, "wrong mean of a single point");
+
+  return errors;
+}
@@ -0,0 +1,126 @@
+#include "OccupancyGrid.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+//! Points of a wall at x = wallX, facing a sensor at the origin
+std::vector<double> Wall(double wallX)
+{
+  std::vector<double> points;
+  for (double y = -5.0; y <= 5.0; y += 0.05)
+  {
+    for (double z = -2.0; z <= 2.0; z += 0.05)
+    {
+      points.insert(points.end(), { wallX, y, z });
+    }
+  }
+  return points;
+}
+
+//! Log-odds of all the observed cells
+std::map<std::tuple<long, long, long>, float> Cells(const OccupancyGrid& grid)
+{
+  std::map<std::tuple<long, long, long>, float> cells;
+  grid.ForEachObservedCell([&](const double center[3], float logOdds)
+  {
+    cells[std::make_tuple(std::lround(center[0] * 100), std::lround(center[1] * 100),
+                          std::lround(center[2] * 100))] = logOdds;
+  });
+  return cells;
+}
+
+float LogOdds(const OccupancyGrid& grid, double x, double y, double z, bool& isObserved)
+{
+  const double point[3] = { x, y, z };
+  return grid.GetLogOdds(point, isObserved);
+}
+}
+
+int main()
+{
+  int retVal = 0;
+  const double origin[3] = { 0.0, 0.0, 0.0 };
+  bool isObserved = false;
+
+  // a wall in front of the sensor, and one behind it
+  std::vector<double> points = Wall(10.02);
+  const std::vector<double> backWall = Wall(-7.02);
+  points.insert(points.end(), backWall.begin(), backWall.end());
+
+  OccupancyGrid grid;
+  grid.SetVoxelSize(0.2);
+  grid.InsertScan(origin, points, 1);
+  retVal += Check(LogOdds(grid, 10.05, 0.1, 0.1, isObserved) == grid.GetHitLogOdds() && isObserved,
+                  "a cell with many points is updated once per scan");
+  retVal += Check(LogOdds(grid, 5.05, 0.1, 0.1, isObserved) == grid.GetMissLogOdds() && isObserved,
+                  "a cell crossed by many rays is updated once per scan");
+  retVal += Check(LogOdds(grid, -7.05, 0.1, 0.1, isObserved) > 0.f && isObserved,
+                  "the negative coordinates are handled");
+  LogOdds(grid, 12.05, 0.1, 0.1, isObserved);
+  retVal += Check(!isObserved, "the cells behind a wall are not observed");
+
+  // the log-odds are clamped
+  for (int scan = 0; scan < 20; ++scan)
+  {
+    grid.InsertScan(origin, points, 1);
+  }
+  retVal += Check(LogOdds(grid, 10.05, 0.1, 0.1, isObserved) == grid.GetMaxLogOdds(), "clamped occupied cell");
+  retVal += Check(LogOdds(grid, 5.05, 0.1, 0.1, isObserved) == grid.GetMinLogOdds(), "clamped free cell");
+  retVal += Check(OccupancyGrid::Probability(grid.GetMaxLogOdds()) > 0.9, "probability of the log-odds");
+
+  // same grid whatever the number of threads, the cells of the points having
+  // priority over the rays crossing them
+  OccupancyGrid threadedGrid;
+  threadedGrid.SetVoxelSize(0.2);
+  OccupancyGrid singleGrid;
+  singleGrid.SetVoxelSize(0.2);
+  std::vector<double> sloped;
+  for (size_t i = 0; i < points.size(); i += 3)
+  {
+    sloped.insert(sloped.end(), { points[i] + 0.3 * points[i + 1], points[i + 1], points[i + 2] });
+  }
+  for (int scan = 0; scan < 3; ++scan)
+  {
+    const double sensor[3] = { 0.3 * scan, -0.1 * scan, 0.05 };
+    singleGrid.InsertScan(sensor, sloped, 1);
+    threadedGrid.InsertScan(sensor, sloped, 4);
+  }
+  retVal += Check(Cells(singleGrid) == Cells(threadedGrid), "the threads do not change the grid");
+
+  // the rays are cut at MaxRange
+  OccupancyGrid rangeGrid;
+  rangeGrid.SetVoxelSize(0.5);
+  rangeGrid.SetMaxRange(50.0);
+  rangeGrid.InsertScan(origin, { 80.1, 0.1, 0.1 }, 0);
+  retVal += Check(LogOdds(rangeGrid, 49.6, 0.1, 0.1, isObserved) < 0.f && isObserved,
+                  "the ray is cast up to MaxRange");
+  LogOdds(rangeGrid, 80.1, 0.1, 0.1, isObserved);
+  retVal += Check(!isObserved, "the point beyond MaxRange is not inserted");
+
+  // in two dimensions, all the cells have the same height
+  OccupancyGrid planeGrid;
+  planeGrid.SetVoxelSize(0.2);
+  planeGrid.SetTwoDimensional(true);
+  planeGrid.InsertScan(origin, points, 2);
+  retVal += Check(LogOdds(planeGrid, 10.05, 0.1, 1.5, isObserved) == planeGrid.GetHitLogOdds(),
+                  "the points are projected on the plane");
+  size_t nbCells = 0;
+  bool isFlat = true;
+  planeGrid.ForEachObservedCell([&](const double center[3], float)
+  {
+    isFlat = isFlat && center[2] == 0.0;
+    ++nbCells;
+  });
+  retVal += Check(isFlat && nbCells > 0, "the cells are at height 0");
+
+  grid.Clear();
+  retVal += Check(grid.GetNumberOfBlocks() == 0 && Cells(grid).empty(), "clear");
+  return retVal;
+}
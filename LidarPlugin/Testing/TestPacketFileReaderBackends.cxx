@@ -0,0 +1,116 @@
+#include "TestCheck.h"
+#include "vtkPacketFileReader.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+// A packet as returned by vtkPacketFileReader::NextPacket, with the file position before it
+struct Packet
+{
+  std::vector<unsigned char> Data;
+  double TimeSinceStart = 0;
+  int64_t Nanoseconds = 0;
+  unsigned int HeaderLength = 0;
+  int64_t Offset = 0;
+};
+
+// Offset in the file of a position returned by vtkPacketFileReader::GetFilePosition.
+// The position of the libpcap backend is the one of its stream, which only the C library
+// can interpret, and the one of the memory mapped backend stores the offset itself
+int64_t GetOffset(vtkPacketFileReader& reader, FILE* file)
+{
+  if (reader.IsMemoryMapped())
+  {
+    return reader.GetMappedOffset();
+  }
+  fpos_t position;
+  reader.GetFilePosition(&position);
+  return std::fsetpos(file, &position) == 0 ? static_cast<int64_t>(std::ftell(file)) : -1;
+}
+
+// Read all the packets of a pcap with one of the backends
+std::vector<Packet> ReadPackets(const std::string& filename, bool useMemoryMapping)
+{
+  std::vector<Packet> packets;
+  vtkPacketFileReader reader;
+  FILE* file = std::fopen(filename.c_str(), "rb");
+  if (!file || !reader.Open(filename, "udp", useMemoryMapping)
+      || reader.IsMemoryMapped() != useMemoryMapping)
+  {
+    if (file)
+    {
+      std::fclose(file);
+    }
+    return packets;
+  }
+  const unsigned char* data = nullptr;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  pcap_pkthdr* header = nullptr;
+  unsigned int headerLength = 0;
+  int64_t offset = GetOffset(reader, file);
+  while (reader.NextPacket(data, dataLength, timeSinceStart, &header, &headerLength))
+  {
+    Packet packet;
+    packet.Data.assign(data, data + dataLength);
+    packet.TimeSinceStart = timeSinceStart;
+    packet.Nanoseconds = reader.GetPacketTimestampNanoseconds();
+    packet.HeaderLength = headerLength;
+    packet.Offset = offset;
+    packets.push_back(std::move(packet));
+    // the reader closes itself after the last packet
+    offset = reader.IsOpen() ? GetOffset(reader, file) : -1;
+  }
+  std::fclose(file);
+  return packets;
+}
+
+bool IsSamePacket(const Packet& a, const Packet& b)
+{
+  // the timestamps of the libpcap backend are truncated to microseconds
+  return a.Data == b.Data && a.TimeSinceStart == b.TimeSinceStart
+    && a.Nanoseconds / 1000 == b.Nanoseconds / 1000 && a.HeaderLength == b.HeaderLength
+    && a.Offset == b.Offset;
+}
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Wrong number of arguments. Usage: TestPacketFileReaderBackends <pcapFileName>"
+              << std::endl;
+    return 1;
+  }
+#ifdef _MSC_VER
+  std::cout << "The memory mapping is not available on this platform" << std::endl;
+  return 0;
+#else
+  const std::string filename = argv[1];
+  int errors = 0;
+
+  const std::vector<Packet> libpcap = ReadPackets(filename, false);
+  const std::vector<Packet> mapped = ReadPackets(filename, true);
+  errors += Check(!libpcap.empty(), "no packet read by libpcap from " + filename);
+  errors += Check(!mapped.empty(), "no packet read from the mapping of " + filename);
+  errors += Check(libpcap.size() == mapped.size(), "the backends read "
+                  + std::to_string(libpcap.size()) + " and " + std::to_string(mapped.size()) + " packets");
+  for (size_t i = 0; i < std::min(libpcap.size(), mapped.size()); ++i)
+  {
+    if (Check(IsSamePacket(libpcap[i], mapped[i]), "the backends differ on the packet " + std::to_string(i)))
+    {
+      // the following packets are likely shifted, one error is enough
+      errors++;
+      break;
+    }
+  }
+
+  return errors;
+#endif
+}
@@ -0,0 +1,101 @@
+#include "PacketGapDetector.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+// Packets of a sensor sending a packet every 1.33 ms and turning by 4.8 degrees per packet,
+// the timestamps being in seconds since the top of the hour
+struct TestSensor
+{
+  static constexpr double Period = 1.33e-3;
+  static constexpr double AzimuthStep = 4.8;
+  //! Index of the next packet
+  int Index = 0;
+  //! Offsets added to the values computed from the index
+  double TimeOffset = 0.0;
+  double AzimuthOffset = 0.0;
+
+  void Skip(int numberOfPackets) { this->Index += numberOfPackets; }
+
+  void Send(PacketGapDetector& detector, int numberOfPackets)
+  {
+    for (int i = 0; i < numberOfPackets; ++i, ++this->Index)
+    {
+      detector.AddPacket(std::fmod(3599.9 + this->TimeOffset + this->Index * Period, 3600.0),
+                         std::fmod(this->AzimuthOffset + this->Index * AzimuthStep, 360.0),
+                         100.0 + this->Index * Period);
+    }
+  }
+};
+}
+
+int main()
+{
+  int retVal = 0;
+
+  // the rollovers of the time and of the azimuth are not gaps
+  PacketGapDetector detector;
+  TestSensor sensor;
+  sensor.Send(detector, 1000);
+  retVal += Check(detector.GetNumberOfGaps() == 0, "a regular stream has gaps");
+
+  // 5 packets lost by the network
+  sensor.Skip(5);
+  sensor.Send(detector, 100);
+  // the sensor has not sent 10 packets worth of rotation
+  sensor.AzimuthOffset += 10 * TestSensor::AzimuthStep;
+  sensor.Send(detector, 100);
+  // the clock of the sensor is set back
+  sensor.TimeOffset -= 0.5;
+  sensor.Send(detector, 100);
+
+  const std::vector<PacketGapDetector::Gap> gaps = detector.GetGaps();
+  retVal += Check(gaps.size() == 3 && detector.GetNumberOfGaps() == 3, "unexpected number of gaps");
+  if (gaps.size() == 3)
+  {
+    retVal += Check(gaps[0].Type == PacketGapDetector::TimeGap && gaps[0].NumberOfMissingPackets == 5
+                    && std::abs(gaps[0].TimeStep - 6 * TestSensor::Period) < 1e-6,
+                    "unexpected time gap");
+    retVal += Check(gaps[1].Type == PacketGapDetector::AzimuthGap && gaps[1].NumberOfMissingPackets == 10,
+                    "unexpected azimuth gap");
+    retVal += Check(gaps[2].Type == PacketGapDetector::TimeJumpBack && gaps[2].NumberOfMissingPackets == 0
+                    && gaps[2].TimeStep < 0.0, "unexpected jump back");
+  }
+  retVal += Check(detector.GetNumberOfMissingPackets() == 15, "unexpected number of missing packets");
+
+  // the same stream checked in two overlapping parts gives the same gaps
+  PacketGapDetector first, second;
+  TestSensor firstSensor, secondSensor;
+  firstSensor.Send(first, 200);
+  secondSensor.Skip(150);
+  secondSensor.Send(second, 50);
+  firstSensor.Skip(3);
+  secondSensor.Skip(3);
+  firstSensor.Send(first, 10);
+  secondSensor.Send(second, 200);
+  retVal += Check(first.GetNumberOfGaps() == 1 && second.GetNumberOfGaps() == 1, "the parts have no gap");
+  first.Stitch(second);
+  retVal += Check(first.GetNumberOfGaps() == 1 && first.GetGaps().size() == 1
+                  && first.GetNumberOfMissingPackets() == 3, "the stitched gap is duplicated");
+
+  // a gap right before the first packet of the second part is only seen by the first one
+  PacketGapDetector head, tail;
+  TestSensor headSensor, tailSensor;
+  headSensor.Send(head, 100);
+  headSensor.Skip(2);
+  headSensor.Send(head, 10);
+  tailSensor.Skip(102);
+  tailSensor.Send(tail, 100);
+  head.Stitch(tail);
+  retVal += Check(head.GetNumberOfGaps() == 1 && head.GetNumberOfMissingPackets() == 2,
+                  "the gap at the seam is lost");
+
+  detector.Reset();
+  retVal += Check(detector.GetNumberOfGaps() == 0 && detector.GetGaps().empty(), "the gaps are not reset");
+  return retVal;
+}
@@ -0,0 +1,159 @@
+#include "PacketRing.h"
+#include "PacketRingListener.h"
+#include "TestCheck.h"
+
+#include <boost/thread.hpp>
+
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+void PushCounter(PacketRing& ring, size_t value)
+{
+  unsigned char data[sizeof(size_t)];
+  std::memcpy(data, &value, sizeof(size_t));
+  PacketRing::PacketInformation information;
+  std::memset(&information, 0, sizeof(information));
+  information.DestinationPort = static_cast<unsigned short>(value % 65536);
+  ring.Push(data, sizeof(size_t), &information);
+}
+
+//! Check that the packets are received in order, with their information
+class CountingListener : public PacketRingListener
+{
+public:
+  ~CountingListener() override { this->StopListening(); }
+
+  size_t NumberOfPackets = 0;
+  bool InOrder = true;
+
+protected:
+  void HandlePackets(const PacketRing& ring, const RawPacket* packets,
+                     size_t numberOfPackets) override
+  {
+    for (size_t i = 0; i < numberOfPackets; ++i)
+    {
+      size_t value = 0;
+      std::memcpy(&value, packets[i].Data, sizeof(size_t));
+      this->InOrder = this->InOrder && value == this->NumberOfPackets &&
+        ring.GetInformation(packets[i]).DestinationPort == value % 65536;
+      ++this->NumberOfPackets;
+    }
+  }
+};
+}
+
+int main()
+{
+  int retVal = 0;
+
+  // full ring with the drop policy
+  PacketRing ring(5, 16);
+  retVal += Check(ring.GetCapacity() == 8, "the capacity should be rounded up to a power of two");
+  for (size_t i = 0; i < 10; ++i)
+  {
+    PushCounter(ring, i);
+  }
+  retVal += Check(ring.GetNumberOfDroppedPackets() == 2, "two packets should have been dropped");
+  retVal += Check(ring.GetHighWaterMark() == 8, "the ring should have been full");
+  RawPacket packets[16];
+  const size_t numberOfPackets = ring.Peek(packets, 16);
+  retVal += Check(numberOfPackets == 8, "all the slots should be filled");
+  size_t first = 0;
+  std::memcpy(&first, packets[0].Data, sizeof(size_t));
+  retVal += Check(first == 0 && packets[0].Length == sizeof(size_t), "the oldest packet should be first");
+  ring.Release(numberOfPackets);
+  retVal += Check(ring.Peek(packets, 16) == 0, "the ring should be empty");
+
+  // too big packets are truncated
+  unsigned char big[32] = { 0 };
+  ring.Push(big, sizeof(big));
+  retVal += Check(ring.Peek(packets, 1) == 1 && packets[0].Length == 16, "the packet should be truncated");
+  ring.Release(1);
+
+  // producer and consumer in different threads, no packet lost
+  const size_t numberOfPacketsToSend = 100000;
+  PacketRing threadedRing(64, 16);
+  threadedRing.SetOverflowPolicy(PacketRing::Wait);
+  boost::thread producer([&threadedRing, numberOfPacketsToSend]() {
+    for (size_t i = 0; i < numberOfPacketsToSend; ++i)
+    {
+      PushCounter(threadedRing, i);
+    }
+  });
+  size_t expected = 0;
+  bool inOrder = true;
+  while (expected < numberOfPacketsToSend && threadedRing.WaitForPackets())
+  {
+    const size_t n = threadedRing.Peek(packets, 16);
+    for (size_t i = 0; i < n; ++i)
+    {
+      size_t value = 0;
+      std::memcpy(&value, packets[i].Data, sizeof(size_t));
+      inOrder = inOrder && (value == expected);
+      ++expected;
+    }
+    threadedRing.Release(n);
+  }
+  producer.join();
+  retVal += Check(inOrder && expected == numberOfPacketsToSend, "packets lost or out of order");
+  retVal += Check(threadedRing.GetNumberOfDroppedPackets() == 0, "no packet should be dropped");
+
+  // a stopped ring wakes up the consumer and drops the new packets
+  threadedRing.Stop();
+  retVal += Check(!threadedRing.WaitForPackets(), "a stopped ring should not wait");
+  PushCounter(threadedRing, 0);
+  retVal += Check(threadedRing.GetNumberOfDroppedPackets() == 1, "a stopped ring should drop packets");
+  threadedRing.Restart();
+  retVal += Check(threadedRing.GetNumberOfDroppedPackets() == 0, "restart should reset the counters");
+
+  // the slots are only reused once all the readers have released them
+  {
+    PacketRing sharedRing(4, 16, 2);
+    for (size_t i = 0; i < 4; ++i)
+    {
+      PushCounter(sharedRing, i);
+    }
+    sharedRing.Release(sharedRing.Peek(packets, 16, 0), 0);
+    PushCounter(sharedRing, 4);
+    retVal += Check(sharedRing.GetNumberOfDroppedPackets() == 1,
+                    "a slot not released by all the readers should not be reused");
+    retVal += Check(sharedRing.Peek(packets, 16, 1) == 4, "the second reader should see all the packets");
+    retVal += Check(sharedRing.GetInformation(packets[3]).DestinationPort == 3,
+                    "the information should follow the packet");
+    sharedRing.Release(1, 1);
+    PushCounter(sharedRing, 4);
+    retVal += Check(sharedRing.Peek(packets, 16, 0) == 1, "the first reader should see the new packet");
+  }
+
+  // a decoder and a listener reading the same packets in their own threads
+  {
+    PacketRing sharedRing(64, 16, 2);
+    sharedRing.SetOverflowPolicy(PacketRing::Wait);
+    std::shared_ptr<PacketRing> sharedRingPtr(&sharedRing, [](PacketRing*) {});
+    CountingListener listener;
+    listener.StartListening(sharedRingPtr, 1);
+    boost::thread producer([&sharedRing, numberOfPacketsToSend]() {
+      for (size_t i = 0; i < numberOfPacketsToSend; ++i)
+      {
+        PushCounter(sharedRing, i);
+      }
+    });
+    size_t received = 0;
+    while (received < numberOfPacketsToSend && sharedRing.WaitForPackets(0))
+    {
+      const size_t n = sharedRing.Peek(packets, 16, 0);
+      received += n;
+      sharedRing.Release(n, 0);
+    }
+    producer.join();
+    sharedRing.Stop();
+    listener.StopListening();
+    retVal += Check(received == numberOfPacketsToSend, "the decoder should get all the packets");
+    retVal += Check(listener.InOrder && listener.NumberOfPackets == numberOfPacketsToSend,
+                    "the listener should get all the packets in order");
+  }
+
+  return retVal;
+}
@@ -0,0 +1,234 @@
+#include "vtkPacketFileReader.h"
+#include "TestCheck.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <vtk_zlib.h>
+
+namespace
+{
+//! Writer of the pcapng blocks, in the native or the swapped byte order
+class PcapngWriter
+{
+public:
+  std::string Content;
+  bool Swapped = false;
+
+  void SectionHeader(int64_t sectionLength)
+  {
+    std::string body;
+    Append32(body, 0x1a2b3c4d);
+    Append16(body, 1);
+    Append16(body, 0);
+    Append64(body, static_cast<uint64_t>(sectionLength));
+    this->Block(PcapngSectionHeaderBlock, body);
+  }
+
+  void InterfaceDescription(uint16_t linkType, int resolution, int64_t offsetSeconds)
+  {
+    std::string body;
+    Append16(body, linkType);
+    Append16(body, 0);
+    Append32(body, 65535);
+    if (resolution >= 0)
+    {
+      Append16(body, 9);
+      Append16(body, 1);
+      body += static_cast<char>(resolution);
+      body.append(3, '\0');
+    }
+    if (offsetSeconds != 0)
+    {
+      Append16(body, 14);
+      Append16(body, 8);
+      Append64(body, static_cast<uint64_t>(offsetSeconds));
+    }
+    Append32(body, 0);
+    this->Block(PcapngInterfaceDescriptionBlock, body);
+  }
+
+  //! An ethernet frame holding an UDP datagram of the lidar, numbered by its 2 first bytes
+  void EnhancedPacket(uint32_t interfaceId, uint64_t timestamp, int number)
+  {
+    std::vector<unsigned char> frame(14 + 20 + 8 + 1206, 0);
+    frame[12] = 0x08;
+    frame[14] = 0x45;
+    frame[14 + 9] = 17;
+    frame[14 + 20 + 4] = (1214 >> 8);
+    frame[14 + 20 + 5] = 1214 & 0xff;
+    frame[14 + 20 + 8] = number & 0xff;
+    frame[14 + 20 + 9] = (number >> 8) & 0xff;
+
+    std::string body;
+    Append32(body, interfaceId);
+    // the timestamps are written as two 32 bits words, the high one first
+    Append32(body, static_cast<uint32_t>(timestamp >> 32));
+    Append32(body, static_cast<uint32_t>(timestamp));
+    Append32(body, static_cast<uint32_t>(frame.size()));
+    Append32(body, static_cast<uint32_t>(frame.size()));
+    body.append(reinterpret_cast<const char*>(frame.data()), frame.size());
+    body.append((4 - frame.size() % 4) % 4, '\0');
+    this->Block(PcapngEnhancedPacketBlock, body);
+  }
+
+private:
+  void Block(uint32_t type, const std::string& body)
+  {
+    const uint32_t length = static_cast<uint32_t>(12 + body.size());
+    Append32(this->Content, type);
+    Append32(this->Content, length);
+    this->Content += body;
+    Append32(this->Content, length);
+  }
+
+  void Append16(std::string& bytes, uint16_t value)
+  {
+    value = this->Swapped ? static_cast<uint16_t>((value >> 8) | (value << 8)) : value;
+    bytes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+  void Append32(std::string& bytes, uint32_t value)
+  {
+    value = this->Swapped ? vtkPacketFileReader::SwapBytes(value) : value;
+    bytes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+  void Append64(std::string& bytes, uint64_t value)
+  {
+    Append32(bytes, static_cast<uint32_t>(this->Swapped ? value >> 32 : value));
+    Append32(bytes, static_cast<uint32_t>(this->Swapped ? value : value >> 32));
+  }
+};
+
+const int NumberOfPackets = 6000;
+
+//! Timestamps written in the file below
+int64_t ExpectedNanoseconds(int number)
+{
+  const int64_t seconds = number / 100 + (number < NumberOfPackets / 2 ? 0 : 100);
+  return seconds * 1000000000 + (number % 100) * 1000 + (number < NumberOfPackets / 2 ? 7 : 0);
+}
+
+//! Two sections: the first one with nanosecond timestamps and an interface of another
+//! link type, the second one of unknown length, in the other byte order, with
+//! microsecond timestamps shifted by 100 s
+std::string MakePcapng()
+{
+  PcapngWriter packets;
+  packets.InterfaceDescription(DLT_EN10MB, 9, 0);
+  packets.InterfaceDescription(101, -1, 0);
+  for (int i = 0; i < NumberOfPackets / 2; ++i)
+  {
+    packets.EnhancedPacket(0, static_cast<uint64_t>(ExpectedNanoseconds(i)), i);
+    if (i % 10 == 0)
+    {
+      packets.EnhancedPacket(1, 0, 60000);
+    }
+  }
+  PcapngWriter file;
+  file.SectionHeader(static_cast<int64_t>(packets.Content.size()));
+  file.Content += packets.Content;
+
+  file.Swapped = true;
+  file.SectionHeader(-1);
+  file.InterfaceDescription(DLT_EN10MB, -1, 100);
+  for (int i = NumberOfPackets / 2; i < NumberOfPackets; ++i)
+  {
+    file.EnhancedPacket(0, static_cast<uint64_t>(ExpectedNanoseconds(i) / 1000 - 100000000), i);
+  }
+  return file.Content;
+}
+
+int PacketNumber(const unsigned char* data)
+{
+  return data[0] + 256 * data[1];
+}
+
+int CheckFile(const std::string& filename, bool useMemoryMapping)
+{
+  int errors = 0;
+  vtkPacketFileReader reader;
+  if (Check(reader.Open(filename, "udp", useMemoryMapping), "could not open " + filename
+            + ": " + reader.GetLastError()))
+  {
+    return 1;
+  }
+  errors += Check(reader.IsMemoryMapped(), "pcapng not read natively: " + filename);
+
+  const unsigned char* data = nullptr;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  int number = 0;
+  bool packetsOk = true;
+  fpos_t position;
+  while (reader.NextPacket(data, dataLength, timeSinceStart))
+  {
+    packetsOk &= dataLength == 1206 && PacketNumber(data) == number
+                 && reader.GetPacketTimestampNanoseconds() == ExpectedNanoseconds(number);
+    if (number == 4500)
+    {
+      reader.GetFilePosition(&position);
+    }
+    ++number;
+  }
+  errors += Check(number == NumberOfPackets, "wrong number of packets in " + filename);
+  errors += Check(packetsOk, "wrong packets in " + filename);
+
+  // seek in the second section, its interfaces not being read yet
+  reader.Open(filename, "udp", useMemoryMapping);
+  reader.SetFilePosition(&position);
+  errors += Check(reader.NextPacket(data, dataLength, timeSinceStart) && PacketNumber(data) == 4501
+                  && reader.GetPacketTimestampNanoseconds() == ExpectedNanoseconds(4501),
+                  "wrong packet after seeking in " + filename);
+
+  reader.Open(filename, "udp", useMemoryMapping);
+  errors += Check(reader.SynchronizeOnRecord(reader.GetMappedFileSize() / 3)
+                  && reader.NextPacket(data, dataLength, timeSinceStart), "could not synchronize");
+
+  // binary search of a time in each section through a sparse time index
+  reader.Open(filename, "udp", useMemoryMapping);
+  errors += Check(reader.BuildTimeIndex(64 * 1024) && reader.GetTimeIndex().size() > 10
+                  && reader.GetTimeIndex().front().Nanoseconds == ExpectedNanoseconds(0),
+                  "wrong time index of " + filename);
+  for (int number : { 0, 1234, 4321, NumberOfPackets - 1 })
+  {
+    errors += Check(reader.SeekToTime(ExpectedNanoseconds(number) - (number % 2))
+                    && reader.NextPacket(data, dataLength, timeSinceStart)
+                    && PacketNumber(data) == number,
+                    "wrong packet after seeking the time of " + std::to_string(number));
+  }
+  reader.Open(filename, "udp", useMemoryMapping);
+  errors += Check(!reader.SeekToTime(ExpectedNanoseconds(NumberOfPackets - 1) + 1),
+                  "a packet found after the end of " + filename);
+  return errors;
+}
+}
+
+int main()
+{
+  int errors = 0;
+  const ScratchDirectory scratch("TestPcapngFile");
+  const boost::filesystem::path& directory = scratch.GetPath();
+  const std::string content = MakePcapng();
+
+  const std::string filename = (directory / "capture.pcapng").string();
+  {
+    std::ofstream os(filename, std::ios::binary);
+    os.write(content.data(), content.size());
+  }
+#ifndef _MSC_VER
+  errors += CheckFile(filename, true);
+#endif
+
+  const std::string compressedFilename = filename + ".gz";
+  gzFile compressed = gzopen(compressedFilename.c_str(), "wb");
+  gzwrite(compressed, content.data(), static_cast<unsigned int>(content.size()));
+  gzclose(compressed);
+  errors += CheckFile(compressedFilename, false);
+
+  return errors;
+}
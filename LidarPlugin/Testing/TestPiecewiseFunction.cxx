@@ -0,0 +1,155 @@
+#include "vtkPatch/vtkCustomPiecewiseFunction.h"
+#include "TestCheck.h"
+
+#include <vtkNew.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+//! Same values with the batch evaluation, the dichotomic one and the
+//! original GetValue(), at the nodes, between them and out of their range
+int CheckValues(vtkCustomPiecewiseFunction* function, const std::string& name)
+{
+  int errors = 0;
+  double range[2];
+  function->GetRange(range);
+  const double margin = 0.1 * (range[1] - range[0]) + 1.0;
+  std::mt19937 generator(3);
+  std::uniform_real_distribution<double> uniform(range[0] - margin, range[1] + margin);
+
+  std::vector<double> x;
+  for (int i = 0; i < function->GetSize(); ++i)
+  {
+    double node[4];
+    function->GetNodeValue(i, node);
+    x.push_back(node[0]);
+  }
+  for (int i = 0; i < 5000; ++i)
+  {
+    x.push_back(uniform(generator));
+  }
+  std::sort(x.begin() + function->GetSize(), x.begin() + function->GetSize() + 2000);
+  const vtkIdType n = static_cast<vtkIdType>(x.size());
+
+  std::vector<double> values(n), strided(2 * n, -1.0);
+  std::vector<float> xf(x.begin(), x.end()), valuesf(n);
+  function->GetValues(n, x.data(), values.data());
+  function->GetValues(n, x.data(), strided.data() + 1, 2);
+  function->GetValues(n, xf.data(), valuesf.data());
+
+  double maxError = 0.0;
+  bool isSame = true;
+  bool isStrided = true;
+  bool isFloat = true;
+  for (vtkIdType i = 0; i < n; ++i)
+  {
+    // without clamping, GetValue() interpolates the end nodes while the
+    // dichotomic evaluations consider them out of the range
+    if (function->GetClamping() || (x[i] != range[0] && x[i] != range[1]))
+    {
+      maxError = std::max(maxError, std::abs(values[i] - function->GetValue(x[i])));
+    }
+    isSame &= values[i] == function->GetValueDichotomic(x[i]);
+    isStrided &= strided[2 * i + 1] == values[i] && strided[2 * i] == -1.0;
+    isFloat &= valuesf[i] == static_cast<float>(function->GetValueDichotomic(xf[i]));
+  }
+  errors += Check(maxError < 1e-12, name + ": the batch values differ from GetValue() by "
+                  + std::to_string(maxError));
+  errors += Check(isSame, name + ": the batch values differ from GetValueDichotomic()");
+  errors += Check(isStrided, name + ": wrong strided batch values");
+  errors += Check(isFloat, name + ": wrong float batch values");
+
+  // the table is the same as the one of the original function
+  const int size = 777;
+  std::vector<double> table(size), expectedTable(size);
+  function->GetTableDichotomic(range[0] - margin, range[1] + margin, size, table.data());
+  function->GetTable(range[0] - margin, range[1] + margin, size, expectedTable.data());
+  maxError = 0.0;
+  for (int i = 0; i < size; ++i)
+  {
+    maxError = std::max(maxError, std::abs(table[i] - expectedTable[i]));
+  }
+  errors += Check(maxError < 1e-12, name + ": the dichotomic table differs from GetTable() by "
+                  + std::to_string(maxError));
+  return errors;
+}
+}
+
+int main()
+{
+  int errors = 0;
+  std::mt19937 generator(5);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+
+  // uniformly spaced linear nodes, as intensity or timing curves
+  vtkNew<vtkCustomPiecewiseFunction> function;
+  std::vector<double> table(1000);
+  for (double& value : table)
+  {
+    value = 10.0 * uniform(generator);
+  }
+  function->BuildFunctionFromTable(-3.0, 250.0, static_cast<int>(table.size()), table.data());
+  errors += CheckValues(function.GetPointer(), "uniform");
+  function->ClampingOff();
+  errors += CheckValues(function.GetPointer(), "uniform without clamping");
+  function->ClampingOn();
+
+  // jittered nodes, still almost uniform
+  std::vector<double> nodes(2 * 500);
+  for (int i = 0; i < 500; ++i)
+  {
+    nodes[2 * i] = 0.1 * i + 0.0005 * uniform(generator);
+    nodes[2 * i + 1] = uniform(generator);
+  }
+  function->FillFromDataPointer(500, nodes.data());
+  errors += CheckValues(function.GetPointer(), "jittered");
+
+  // irregular nodes, with and without the index
+  double x = 0.0;
+  for (int i = 0; i < 500; ++i)
+  {
+    x += std::exp(3.0 * uniform(generator));
+    nodes[2 * i] = x;
+  }
+  function->FillFromDataPointer(500, nodes.data());
+  errors += CheckValues(function.GetPointer(), "irregular");
+  function->BuildUniformIndex();
+  errors += CheckValues(function.GetPointer(), "irregular indexed");
+
+  // nodes moved after the index was built
+  double node[4];
+  function->GetNodeValue(10, node);
+  node[0] = x + 100.0;
+  function->SetNodeValue(10, node);
+  function->RemovePoint(nodes[2 * 20]);
+  function->AddSegment(nodes[2 * 30], 1.0, nodes[2 * 40], -1.0);
+  errors += CheckValues(function.GetPointer(), "modified");
+
+  // curved and constant segments
+  for (int i = 0; i < function->GetSize(); ++i)
+  {
+    function->GetNodeValue(i, node);
+    node[2] = 0.5 + 0.5 * uniform(generator);
+    node[3] = i % 3 == 0 ? 1.0 : 0.5 + 0.5 * uniform(generator);
+    function->SetNodeValue(i, node);
+  }
+  errors += CheckValues(function.GetPointer(), "curved");
+
+  // a single node, and no node
+  function->RemoveAllPoints();
+  function->AddPoint(2.0, 4.0);
+  errors += CheckValues(function.GetPointer(), "single node");
+  function->RemoveAllPoints();
+  double value = -1.0;
+  const double location = 1.0;
+  function->GetValues(1, &location, &value);
+  errors += Check(value == 0.0, "a function without node is not null");
+
+  return errors;
+}
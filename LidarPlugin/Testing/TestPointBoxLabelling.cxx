@@ -0,0 +1,117 @@
+#include "BoundingBox.h"
+#include "PointBoxLabelling.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+//! Box of the given size and yaw
+PointBoxLabelling::Box MakeBox(double x, double y, double z, double length, double width,
+                               double height, double yaw)
+{
+  PointBoxLabelling::Box box = { { x, y, z },
+                                 { { std::cos(yaw), std::sin(yaw), 0.0 },
+                                   { -std::sin(yaw), std::cos(yaw), 0.0 },
+                                   { 0.0, 0.0, 1.0 } },
+                                 { length, width, height } };
+  return box;
+}
+
+//! Index of the first box containing each point, by testing every box
+std::vector<int> BruteForce(const std::vector<PointBoxLabelling::Box>& boxes,
+                            const std::vector<double>& points)
+{
+  std::vector<OrientedBoundingBox<3> > obbs;
+  for (const auto& box : boxes)
+  {
+    Eigen::Matrix3d orientation;
+    for (int j = 0; j < 3; ++j)
+    {
+      for (int k = 0; k < 3; ++k)
+      {
+        orientation(k, j) = box.Axes[j][k];
+      }
+    }
+    obbs.emplace_back(Eigen::Vector3d(box.Center), Eigen::Vector3d(box.Width), orientation);
+  }
+  std::vector<int> labels(points.size() / 3, -1);
+  for (size_t i = 0; i < labels.size(); ++i)
+  {
+    for (size_t b = 0; b < obbs.size() && labels[i] < 0; ++b)
+    {
+      if (obbs[b].IsPointInside(Eigen::Vector3d(&points[3 * i])))
+      {
+        labels[i] = static_cast<int>(b);
+      }
+    }
+  }
+  return labels;
+}
+}
+
+int main()
+{
+  int retVal = 0;
+
+  // an urban like frame: hundreds of boxes, some of them overlapping
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> position(-50.0, 50.0);
+  std::uniform_real_distribution<double> size(0.5, 5.0);
+  std::uniform_real_distribution<double> angle(-3.14, 3.14);
+  std::vector<PointBoxLabelling::Box> boxes;
+  for (int i = 0; i < 300; ++i)
+  {
+    boxes.push_back(MakeBox(position(generator), position(generator), 0.5 * size(generator),
+                            size(generator), size(generator), size(generator), angle(generator)));
+  }
+  std::vector<double> points(3 * 20000);
+  std::uniform_real_distribution<double> height(-1.0, 3.0);
+  for (size_t i = 0; i < points.size(); i += 3)
+  {
+    points[i] = position(generator);
+    points[i + 1] = position(generator);
+    points[i + 2] = height(generator);
+  }
+  points[3] = std::nan("");
+
+  PointBoxLabelling labelling;
+  labelling.SetBoxes(boxes);
+  std::vector<int> labels;
+  labelling.Label(points.data(), points.size() / 3, labels, 1);
+  const std::vector<int> expected = BruteForce(boxes, points);
+  retVal += Check(labels == expected, "the labels match the test of every box");
+  size_t nbLabelled = 0;
+  for (int label : expected)
+  {
+    nbLabelled += label >= 0;
+  }
+  retVal += Check(nbLabelled > 100, "many points are in a box");
+  retVal += Check(labels[1] == -1, "a non finite point is in no box");
+
+  // same labels whatever the number of threads and the type of the coordinates
+  std::vector<int> threadedLabels;
+  labelling.Label(points.data(), points.size() / 3, threadedLabels, 4);
+  retVal += Check(threadedLabels == labels, "the threads do not change the labels");
+  std::vector<float> floatPoints(points.begin(), points.end());
+  std::vector<int> floatLabels;
+  labelling.Label(floatPoints.data(), floatPoints.size() / 3, floatLabels, 0);
+  retVal += Check(floatLabels == BruteForce(boxes, std::vector<double>(floatPoints.begin(), floatPoints.end())),
+                  "float coordinates");
+
+  // nested boxes: the first one wins
+  std::vector<PointBoxLabelling::Box> nested = { MakeBox(0, 0, 0, 1, 1, 1, 0.3), MakeBox(0, 0, 0, 4, 4, 4, 0.0) };
+  labelling.SetBoxes(nested);
+  const std::vector<double> queries = { 0.1, 0.1, 0.1, 1.5, 0.0, 0.0, 3.0, 0.0, 0.0 };
+  labelling.Label(queries.data(), 3, labels, 1);
+  retVal += Check(labels == std::vector<int>({ 0, 1, -1 }), "the lowest box index wins");
+
+  labelling.SetBoxes({});
+  labelling.Label(queries.data(), 3, labels, 1);
+  retVal += Check(labels == std::vector<int>({ -1, -1, -1 }), "no box");
+  return retVal;
+}
@@ -0,0 +1,91 @@
+#include "PointKDTree.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+//! Indices of the points inside all the planes, by testing every point
+std::vector<uint32_t> BruteForce(const std::vector<double>& coordinates,
+                                 const std::vector<PointKDTree::Plane>& planes)
+{
+  std::vector<uint32_t> indices;
+  for (size_t i = 0; i < coordinates.size() / 3; ++i)
+  {
+    const double* p = &coordinates[3 * i];
+    bool inside = std::isfinite(p[0]) && std::isfinite(p[1]) && std::isfinite(p[2]);
+    for (const auto& plane : planes)
+    {
+      inside = inside && plane[0] * p[0] + plane[1] * p[1] + plane[2] * p[2] + plane[3] <= 0;
+    }
+    if (inside)
+    {
+      indices.push_back(static_cast<uint32_t>(i));
+    }
+  }
+  return indices;
+}
+
+std::vector<uint32_t> Sorted(std::vector<uint32_t> indices)
+{
+  std::sort(indices.begin(), indices.end());
+  return indices;
+}
+}
+
+int main()
+{
+  int retVal = 0;
+
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> distribution(-50.0, 50.0);
+  std::vector<double> coordinates(3 * 20000);
+  for (double& value : coordinates)
+  {
+    value = distribution(generator);
+  }
+  // invalid points are never selected
+  coordinates[30] = std::numeric_limits<double>::quiet_NaN();
+
+  PointKDTree tree;
+  tree.Build(coordinates);
+  retVal += Check(tree.GetNumberOfPoints() == 19999, "the invalid point should be left out");
+
+  const double bounds[6] = { -10.0, 5.0, -20.0, 0.0, -3.0, 30.0 };
+  std::vector<uint32_t> inBounds;
+  tree.FindPointsInBounds(bounds, inBounds);
+  const std::vector<PointKDTree::Plane> boxPlanes = {
+    { { -1, 0, 0, -10.0 } }, { { 1, 0, 0, -5.0 } },  { { 0, -1, 0, -20.0 } },
+    { { 0, 1, 0, 0.0 } },    { { 0, 0, -1, -3.0 } }, { { 0, 0, 1, -30.0 } }
+  };
+  retVal += Check(!inBounds.empty() && Sorted(inBounds) == BruteForce(coordinates, boxPlanes),
+                  "wrong points in a box");
+
+  // an oblique region, crossing many nodes
+  const double s = 1.0 / std::sqrt(3.0);
+  const std::vector<PointKDTree::Plane> planes = { { { s, s, s, -10.0 } },
+                                                   { { -s, s, 0, -5.0 } },
+                                                   { { 0, 0, -1, -40.0 } } };
+  std::vector<uint32_t> inside;
+  tree.FindPointsInside(planes, inside);
+  retVal += Check(Sorted(inside) == BruteForce(coordinates, planes), "wrong points in a region");
+
+  // all the points, taken without being tested
+  const double all[6] = { -100.0, 100.0, -100.0, 100.0, -100.0, 100.0 };
+  std::vector<uint32_t> everything;
+  tree.FindPointsInBounds(all, everything);
+  retVal += Check(everything.size() == 19999, "all the valid points should be in the box");
+
+  tree.Build(std::vector<double>());
+  std::vector<uint32_t> none;
+  tree.FindPointsInBounds(all, none);
+  retVal += Check(tree.GetNumberOfPoints() == 0 && none.empty(), "an empty tree has no point");
+
+  return retVal;
+}
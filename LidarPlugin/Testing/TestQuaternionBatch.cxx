@@ -0,0 +1,134 @@
+#include "vtkPatch/vtkCustomQuaternion.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+//! Distance between two unit quaternions representing the same rotation or
+//! close ones, which is about half the angle between the rotations, unlike
+//! the arc cosine of their dot product which is not accurate for close ones
+double Distance(const double* a, const double* b)
+{
+  double difference = 0.0, sum = 0.0;
+  for (int i = 0; i < 4; ++i)
+  {
+    difference += (a[i] - b[i]) * (a[i] - b[i]);
+    sum += (a[i] + b[i]) * (a[i] + b[i]);
+  }
+  return std::sqrt(std::min(difference, sum));
+}
+
+double Dot(const double* a, const double* b)
+{
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+}
+
+//! Unit quaternion rotating by an angle around a random axis, composed with q
+vtkCustomQuaterniond Rotate(const vtkCustomQuaterniond& q, double angle, std::mt19937& generator)
+{
+  std::normal_distribution<double> normal;
+  double axis[3] = { normal(generator), normal(generator), normal(generator) };
+  vtkCustomQuaterniond rotation;
+  rotation.SetRotationAngleAndAxis(angle, axis);
+  return (rotation * q).Normalized();
+}
+}
+
+int main()
+{
+  int errors = 0;
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  // pairs at angles from 1e-8 to pi, some of them in opposite hemispheres
+  const int n = 1000;
+  std::vector<double> t(n), q0(4 * n), q1(4 * n);
+  std::vector<double> angles(n);
+  for (int k = 0; k < n; ++k)
+  {
+    vtkCustomQuaterniond a = Rotate(vtkCustomQuaterniond(), 2.0 * uniform(generator), generator);
+    angles[k] = std::pow(10.0, -8.0 + 8.5 * uniform(generator));
+    vtkCustomQuaterniond b = Rotate(a, std::min(angles[k], 3.14), generator);
+    if (k % 3 == 0)
+    {
+      b = b * -1.0;
+    }
+    t[k] = k % 10 == 0 ? 0.0 : (k % 10 == 1 ? 1.0 : uniform(generator));
+    a.Get(&q0[4 * k]);
+    b.Get(&q1[4 * k]);
+  }
+
+  // exact slerp, same results as one pair at a time once normalized, as
+  // Slerp() does not normalize its linear interpolation of close quaternions
+  std::vector<double> q(4 * n);
+  vtkCustomQuaterniond::BatchSlerp(n, t.data(), q0.data(), q1.data(), q.data());
+  double maxError = 0.0;
+  for (int k = 0; k < n; ++k)
+  {
+    double expected[4];
+    vtkCustomQuaterniond(&q0[4 * k]).Slerp(t[k], vtkCustomQuaterniond(&q1[4 * k])).Normalized().Get(expected);
+    for (int i = 0; i < 4; ++i)
+    {
+      maxError = std::max(maxError, std::abs(q[4 * k + i] - expected[i]));
+    }
+  }
+  errors += Check(maxError < 1e-12, "the batch slerp differs from Slerp() by " + std::to_string(maxError));
+
+  // the output may be one of the inputs
+  std::vector<double> inPlace = q0;
+  vtkCustomQuaterniond::BatchSlerp(n, t.data(), inPlace.data(), q1.data(), inPlace.data());
+  errors += Check(inPlace == q, "the batch slerp in place gives other results");
+
+  // corrected nlerp under 0.1 rad, exact slerp above
+  const double maxNlerpAngle = 0.1;
+  std::vector<double> approximated(4 * n);
+  vtkCustomQuaterniond::BatchSlerp(n, t.data(), q0.data(), q1.data(), approximated.data(),
+                                   maxNlerpAngle);
+  double maxNlerpError = 0.0;
+  maxError = 0.0;
+  for (int k = 0; k < n; ++k)
+  {
+    const double error = Distance(&q[4 * k], &approximated[4 * k]);
+    if (std::abs(Dot(&q0[4 * k], &q1[4 * k])) >= std::cos(maxNlerpAngle))
+    {
+      maxNlerpError = std::max(maxNlerpError, error);
+    }
+    else
+    {
+      maxError = std::max(maxError, error);
+    }
+  }
+  errors += Check(maxNlerpError < 1e-10, "the corrected nlerp is off by " + std::to_string(maxNlerpError));
+  errors += Check(maxError < 1e-12, "the pairs far apart are not slerped when the nlerp is enabled");
+
+  // matrices of the quaternions, including a null one and a non unit one
+  q0[0] = q0[1] = q0[2] = q0[3] = 0.0;
+  for (int i = 0; i < 4; ++i)
+  {
+    q0[4 + i] *= 3.0;
+  }
+  std::vector<double> matrices(9 * n);
+  vtkCustomQuaterniond::BatchToMatrix3x3(n, q0.data(), matrices.data());
+  maxError = 0.0;
+  for (int k = 0; k < n; ++k)
+  {
+    double A[3][3];
+    vtkCustomQuaterniond(&q0[4 * k]).ToMatrix3x3(A);
+    for (int r = 0; r < 3; ++r)
+    {
+      for (int c = 0; c < 3; ++c)
+      {
+        maxError = std::max(maxError, std::abs(matrices[9 * k + 3 * r + c] - A[r][c]));
+      }
+    }
+  }
+  errors += Check(maxError < 1e-14, "the batch matrices differ from ToMatrix3x3() by " + std::to_string(maxError));
+
+  return errors;
+}
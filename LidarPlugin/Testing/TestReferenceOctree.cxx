@@ -0,0 +1,107 @@
+#include "ReferenceOctree.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+namespace
+{
+//! Distance to the closest point, searched exhaustively
+double BruteForceDistance(const std::vector<double>& points, const double* point, double maxDistance)
+{
+  double best = maxDistance;
+  for (size_t i = 0; i < points.size(); i += 3)
+  {
+    const double dx = points[i] - point[0], dy = points[i + 1] - point[1], dz = points[i + 2] - point[2];
+    best = std::min(best, std::sqrt(dx * dx + dy * dy + dz * dz));
+  }
+  return best;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  int errors = 0;
+  std::mt19937 generator(5);
+
+  // a georeferenced scene: a ground, a wall, and some duplicated points
+  // which can not be split by the octree
+  const double offset[3] = { 650000.0, 5400000.0, 100.0 };
+  std::uniform_real_distribution<double> coordinate(-20.0, 20.0);
+  std::vector<double> reference;
+  for (int i = 0; i < 20000; ++i)
+  {
+    reference.insert(reference.end(), { offset[0] + coordinate(generator), offset[1] + coordinate(generator),
+                                        offset[2] + 0.01 * coordinate(generator) });
+  }
+  for (int i = 0; i < 5000; ++i)
+  {
+    reference.insert(reference.end(), { offset[0] + 5.0, offset[1] + coordinate(generator),
+                                        offset[2] + std::abs(coordinate(generator)) / 4 });
+  }
+  for (int i = 0; i < 100; ++i)
+  {
+    reference.insert(reference.end(), { offset[0] + 1.0, offset[1] + 2.0, offset[2] + 3.0 });
+  }
+
+  ReferenceOctree octree;
+  errors += Check(octree.IsEmpty(), "an octree not built is not empty");
+  octree.Build(reference, 16);
+  errors += Check(!octree.IsEmpty() && octree.GetNumberOfPoints() == reference.size() / 3, "wrong number of points");
+
+  // the distances of points near and far from the reference, bounded by the maximum distance
+  const double maxDistance = 1.0;
+  std::vector<double> queries;
+  for (int i = 0; i < 2000; ++i)
+  {
+    queries.insert(queries.end(), { offset[0] + 1.2 * coordinate(generator), offset[1] + 1.2 * coordinate(generator),
+                                    offset[2] + 0.1 * coordinate(generator) });
+  }
+  queries.insert(queries.end(), { offset[0] + 1.0, offset[1] + 2.0, offset[2] + 3.0 });
+  std::vector<float> distances;
+  octree.GetDistances(queries, maxDistance, distances, 4);
+  bool distancesOk = distances.size() == queries.size() / 3;
+  for (size_t i = 0; distancesOk && i < distances.size(); ++i)
+  {
+    distancesOk &= std::abs(distances[i] - BruteForceDistance(reference, &queries[3 * i], maxDistance)) < 1e-3;
+  }
+  errors += Check(distancesOk, "wrong distances");
+  errors += Check(distances.back() < 1e-3, "a point of the reference is not at distance 0");
+
+  // the octree written and read back gives the same distances
+  const ScratchDirectory scratch("TestReferenceOctree");
+  const boost::filesystem::path& directory = scratch.GetPath();
+  const std::string filename = (directory / "reference.lvoctree").string();
+  errors += Check(octree.Write(filename), "could not write the octree");
+  ReferenceOctree read;
+  errors += Check(read.Read(filename), "could not read the octree");
+  std::vector<float> readDistances;
+  read.GetDistances(queries, maxDistance, readDistances, 1);
+  errors += Check(readDistances == distances, "wrong distances after reading the octree");
+
+  // a truncated file and a file which is not an octree are rejected
+  const boost::uintmax_t size = boost::filesystem::file_size(filename);
+  boost::filesystem::resize_file(filename, size - 100);
+  errors += Check(!read.Read(filename) && read.IsEmpty(), "a truncated octree was read");
+  {
+    std::ofstream os(filename, std::ios::binary | std::ios::trunc);
+    os << std::string(1000, 'x');
+  }
+  errors += Check(!read.Read(filename) && read.IsEmpty(), "a file which is not an octree was read");
+
+  // an empty reference is at the maximum distance of everything
+  octree.Build(std::vector<double>(), 16);
+  const double point[3] = { 0.0, 0.0, 0.0 };
+  errors += Check(octree.IsEmpty() && octree.GetDistance(point, maxDistance) == maxDistance,
+                  "wrong distance to an empty reference");
+
+  return errors;
+}
@@ -0,0 +1,168 @@
+#include "RemotePcapFile.h"
+#include "TestCheck.h"
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+namespace
+{
+//! Minimal HTTP server answering the range requests on a single file, one connection
+//! at a time
+class RangeServer
+{
+public:
+  RangeServer(const std::vector<unsigned char>& content)
+    : Content(content)
+    , Acceptor(IOService, boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0))
+    , Thread([this]() { this->Run(); })
+  {
+  }
+
+  ~RangeServer()
+  {
+    this->Stop = true;
+    // unblock the acceptor
+    boost::asio::ip::tcp::socket socket(this->IOService);
+    boost::system::error_code error;
+    socket.connect(this->Acceptor.local_endpoint(), error);
+    this->Thread.join();
+  }
+
+  std::string GetUrl() const
+  {
+    return "http://127.0.0.1:" + std::to_string(this->Acceptor.local_endpoint().port()) + "/capture.pcap";
+  }
+
+  std::atomic<int> NumberOfRequests{ 0 };
+
+private:
+  void Run()
+  {
+    while (!this->Stop)
+    {
+      boost::asio::ip::tcp::socket socket(this->IOService);
+      boost::system::error_code error;
+      this->Acceptor.accept(socket, error);
+      boost::asio::streambuf request;
+      while (!this->Stop && !error)
+      {
+        boost::asio::read_until(socket, request, "\r\n\r\n", error);
+        if (error)
+        {
+          break;
+        }
+        std::istream stream(&request);
+        std::string line, range;
+        while (std::getline(stream, line) && line != "\r")
+        {
+          if (line.compare(0, 13, "Range: bytes=") == 0)
+          {
+            range = line.substr(13);
+          }
+        }
+        ++this->NumberOfRequests;
+        long long first = 0, last = static_cast<long long>(this->Content.size()) - 1;
+        std::sscanf(range.c_str(), "%lld-%lld", &first, &last);
+        std::ostringstream header;
+        header << "HTTP/1.1 " << (range.empty() ? "200 OK" : "206 Partial Content") << "\r\n"
+               << "Content-Length: " << last - first + 1 << "\r\n"
+               << "Content-Range: bytes " << first << "-" << last << "/" << this->Content.size()
+               << "\r\n\r\n";
+        boost::asio::write(socket, boost::asio::buffer(header.str()), error);
+        boost::asio::write(socket, boost::asio::buffer(&this->Content[first], last - first + 1), error);
+      }
+    }
+  }
+
+  const std::vector<unsigned char>& Content;
+  boost::asio::io_service IOService;
+  boost::asio::ip::tcp::acceptor Acceptor;
+  std::atomic<bool> Stop{ false };
+  boost::thread Thread;
+};
+}
+
+int main()
+{
+  int errors = 0;
+  const ScratchDirectory scratch("TestRemotePcapFile");
+  const boost::filesystem::path& directory = scratch.GetPath();
+  RemotePcapFile::SetCacheDirectory(directory.string());
+
+  std::mt19937 generator(3);
+  std::vector<unsigned char> content(5 * RemotePcapFile::BlockSize + 4321);
+  for (auto& byte : content)
+  {
+    byte = static_cast<unsigned char>(generator());
+  }
+
+  RangeServer server(content);
+  {
+    // no readahead, as the server only serves a connection at a time
+    RemotePcapFile file;
+    if (Check(file.Open(server.GetUrl(), 0), "could not open the file: " + file.GetLastError()))
+    {
+      return 1;
+    }
+    errors += Check(file.GetSize() == static_cast<int64_t>(content.size()), "wrong size");
+
+    std::uniform_int_distribution<size_t> offsets(0, content.size() - 3000);
+    bool randomOk = true;
+    for (int i = 0; i < 100; ++i)
+    {
+      const size_t offset = offsets(generator);
+      const unsigned char* bytes = file.GetBytes(offset, 3000);
+      randomOk &= bytes && std::memcmp(bytes, content.data() + offset, 3000) == 0;
+    }
+    errors += Check(randomOk, "wrong bytes");
+    errors += Check(!file.GetBytes(content.size() - 10, 11), "bytes read past the end");
+    errors += Check(file.GetBytes(content.size() - 10, 10) != nullptr, "last bytes not read");
+  }
+
+  // the blocks are now read from the local cache
+  const int numberOfRequests = server.NumberOfRequests;
+  {
+    RemotePcapFile file;
+    file.Open(server.GetUrl(), 0);
+    bool cachedOk = true;
+    for (size_t offset = 0; offset + 1000 <= content.size(); offset += 1000)
+    {
+      const unsigned char* bytes = file.GetBytes(offset, 1000);
+      cachedOk &= bytes && std::memcmp(bytes, content.data() + offset, 1000) == 0;
+    }
+    errors += Check(cachedOk, "wrong bytes read from the cache");
+    errors += Check(server.NumberOfRequests == numberOfRequests, "cached blocks fetched again");
+  }
+
+  // the least recently used blocks are removed beyond the maximum size
+  RemotePcapFile::SetMaximumCacheSize(2 * RemotePcapFile::BlockSize);
+  {
+    RemotePcapFile file;
+    file.Open(server.GetUrl(), 0);
+  }
+  uintmax_t cacheSize = 0;
+  for (boost::filesystem::recursive_directory_iterator it(directory), end; it != end; ++it)
+  {
+    if (it->path().extension() == ".block")
+    {
+      cacheSize += boost::filesystem::file_size(it->path());
+    }
+  }
+  errors += Check(cacheSize <= 2 * RemotePcapFile::BlockSize, "cache not trimmed");
+
+  // the sidecars are downloaded whole
+  const std::string sidecar = RemotePcapFile::GetLocalFileName(server.GetUrl(), "sidecar.lvindex");
+  errors += Check(RemotePcapFile::Download(server.GetUrl(), sidecar)
+                  && boost::filesystem::file_size(sidecar) == content.size(), "download failed");
+
+  return errors;
+}
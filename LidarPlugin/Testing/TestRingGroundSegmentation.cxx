@@ -0,0 +1,144 @@
+#include "RingGroundSegmentation.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+const double SensorHeight = 1.7;
+
+//! Distance along the ray of direction d to the ground, flat up to x = 10 and
+//! then rising with a 5% slope, infinity if the ray does not hit it
+double HitGround(const double d[3])
+{
+  if (d[2] < 0 && -SensorHeight / d[2] * d[0] <= 10.0)
+  {
+    return -SensorHeight / d[2];
+  }
+  const double t = -(SensorHeight + 0.5) / (d[2] - 0.05 * d[0]);
+  return (t > 0 && t * d[0] > 10.0) ? t : std::numeric_limits<double>::infinity();
+}
+
+//! Distance along the ray of direction d to a 1.5 m high box standing on the ground
+double HitBox(const double d[3])
+{
+  const double boxMin[3] = { 8.0, -1.0, -SensorHeight };
+  const double boxMax[3] = { 10.0, 1.0, -SensorHeight + 1.5 };
+  double tMin = 0.0;
+  double tMax = std::numeric_limits<double>::infinity();
+  for (int k = 0; k < 3; ++k)
+  {
+    if (std::abs(d[k]) < 1e-12)
+    {
+      if (0.0 < boxMin[k] || 0.0 > boxMax[k])
+      {
+        return std::numeric_limits<double>::infinity();
+      }
+      continue;
+    }
+    double t1 = boxMin[k] / d[k];
+    double t2 = boxMax[k] / d[k];
+    tMin = std::max(tMin, std::min(t1, t2));
+    tMax = std::min(tMax, std::max(t1, t2));
+  }
+  return tMin <= tMax ? tMin : std::numeric_limits<double>::infinity();
+}
+}
+
+int main()
+{
+  int retVal = 0;
+
+  // 32 lasers from -25 to 15 degrees, fired in a shuffled order, turning by 0.2 degree
+  const int nbLasers = 32;
+  std::vector<int> firingOrder(nbLasers);
+  for (int i = 0; i < nbLasers; ++i)
+  {
+    firingOrder[i] = i;
+  }
+  std::shuffle(firingOrder.begin(), firingOrder.end(), std::mt19937(42));
+
+  std::vector<RingGroundSegmentation::Point> points;
+  std::vector<bool> isGroundTruth;
+  std::vector<bool> isHighOnBox;
+  for (int azimuth = 0; azimuth < 36000; azimuth += 20)
+  {
+    for (int laser = 0; laser < nbLasers; ++laser)
+    {
+      const double elevation = (-25.0 + 40.0 * firingOrder[laser] / (nbLasers - 1)) * M_PI / 180.0;
+      const double angle = azimuth / 100.0 * M_PI / 180.0;
+      const double d[3] = { std::cos(elevation) * std::cos(angle),
+                            std::cos(elevation) * std::sin(angle),
+                            std::sin(elevation) };
+      const double tGround = HitGround(d);
+      const double tBox = HitBox(d);
+      const double t = std::min(tGround, tBox);
+      if (t > 100.0)
+      {
+        continue;
+      }
+      RingGroundSegmentation::Point point;
+      point.Range = static_cast<float>(t * std::cos(elevation));
+      point.Z = static_cast<float>(t * d[2]);
+      point.Laser = laser;
+      point.Azimuth = azimuth;
+      points.push_back(point);
+      isGroundTruth.push_back(tGround <= tBox);
+      isHighOnBox.push_back(tBox < tGround && point.Z > -SensorHeight + 0.3);
+    }
+  }
+  // points left out
+  RingGroundSegmentation::Point invalid = { std::numeric_limits<float>::quiet_NaN(), 0.f, 0, 0 };
+  points.push_back(invalid);
+  invalid = { 5.f, static_cast<float>(-SensorHeight), -1, 0 };
+  points.push_back(invalid);
+
+  RingGroundSegmentation segmentation;
+  segmentation.SetSensorHeight(SensorHeight);
+  segmentation.SetNumberOfThreads(1);
+  std::vector<unsigned char> isGround;
+  segmentation.Segment(points, isGround);
+  retVal += Check(isGround.size() == points.size(), "one label per point");
+
+  size_t nbGround = 0, nbGroundFound = 0, nbHighOnBox = 0, nbHighOnBoxFound = 0;
+  for (size_t i = 0; i < isGroundTruth.size(); ++i)
+  {
+    nbGround += isGroundTruth[i];
+    nbGroundFound += isGroundTruth[i] && isGround[i];
+    nbHighOnBox += isHighOnBox[i];
+    nbHighOnBoxFound += isHighOnBox[i] && isGround[i];
+  }
+  retVal += Check(nbHighOnBox > 100, "the box is seen");
+  retVal += Check(nbHighOnBoxFound == 0, "the box is not ground");
+  retVal += Check(nbGroundFound > 0.99 * nbGround, "the ground, flat and sloped, is found");
+  retVal += Check(!isGround[points.size() - 1] && !isGround[points.size() - 2],
+                  "the invalid points are not ground");
+
+  // same labels whatever the number of threads
+  segmentation.SetNumberOfThreads(4);
+  std::vector<unsigned char> isGroundThreaded;
+  segmentation.Segment(points, isGroundThreaded);
+  retVal += Check(isGround == isGroundThreaded, "the threads do not change the labels");
+
+  // a sensor mounted higher than expected finds a tilted ground under it too steep
+  segmentation.SetSensorHeight(SensorHeight + 1.0);
+  segmentation.Segment(points, isGroundThreaded);
+  size_t nbGroundFoundTooHigh = 0;
+  for (size_t i = 0; i < isGroundTruth.size(); ++i)
+  {
+    nbGroundFoundTooHigh += isGroundTruth[i] && isGroundThreaded[i];
+  }
+  retVal += Check(nbGroundFoundTooHigh < nbGroundFound, "the sensor height is used");
+
+  // an empty frame
+  segmentation.Segment(std::vector<RingGroundSegmentation::Point>(), isGround);
+  retVal += Check(isGround.empty(), "no labels for an empty frame");
+
+  return retVal;
+}
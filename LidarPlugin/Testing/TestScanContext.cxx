@@ -0,0 +1,77 @@
+#include "ScanContext.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+// Random boxes of various heights around the sensor, as seen from a pose
+std::vector<double> MakePlace(std::mt19937& generator, double yaw, double dx, double dy)
+{
+  std::uniform_real_distribution<double> coordinate(-60.0, 60.0);
+  std::uniform_real_distribution<double> height(0.0, 8.0);
+  std::uniform_real_distribution<double> offset(-1.0, 1.0);
+  std::vector<double> xyz;
+  for (int box = 0; box < 150; ++box)
+  {
+    const double cx = coordinate(generator), cy = coordinate(generator), h = height(generator);
+    for (int p = 0; p < 40; ++p)
+    {
+      const double x = cx + offset(generator) - dx, y = cy + offset(generator) - dy;
+      xyz.push_back(std::cos(yaw) * x + std::sin(yaw) * y);
+      xyz.push_back(-std::sin(yaw) * x + std::cos(yaw) * y);
+      xyz.push_back(h * (offset(generator) + 1.0) / 2.0 - 2.0);
+    }
+  }
+  return xyz;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  const int numberOfPlaces = 100;
+  const int revisited = 17;
+  const double yaw = 0.7;
+
+  std::vector<ScanContext> descriptors(numberOfPlaces);
+  ScanContextIndex index;
+  index.DistanceThreshold = 0.3;
+  for (int place = 0; place < numberOfPlaces; ++place)
+  {
+    std::mt19937 generator(place);
+    descriptors[place].Compute(MakePlace(generator, 0.0, 0.0, 0.0));
+    index.Add(descriptors[place]);
+  }
+
+  // The same place seen with another heading and a small offset
+  std::mt19937 generator(revisited);
+  ScanContext query;
+  query.Compute(MakePlace(generator, yaw, 0.3, -0.2));
+
+  int shift = 0;
+  const double distance = query.Distance(descriptors[revisited], shift);
+  int errors = Check(distance < index.DistanceThreshold, "revisited place is too far");
+  errors += Check(std::abs(ScanContext::ShiftToYaw(shift) - yaw) < 2.0 * 2.0 * M_PI / ScanContext::NumberOfSectors,
+                  "wrong yaw between the descriptors");
+
+  ScanContextIndex::Candidate candidate;
+  errors += Check(index.FindLoopCandidate(query, 0, candidate), "revisited place not found");
+  errors += Check(candidate.Index == revisited, "wrong place found");
+
+  // The last descriptors are excluded from the search
+  errors += Check(!index.FindLoopCandidate(query, numberOfPlaces - revisited, candidate) ||
+                  candidate.Index != revisited, "excluded place found");
+
+  // A new place is not recognized
+  std::mt19937 newGenerator(numberOfPlaces + 1);
+  ScanContext newPlace;
+  newPlace.Compute(MakePlace(newGenerator, 0.0, 0.0, 0.0));
+  errors += Check(!index.FindLoopCandidate(newPlace, 0, candidate), "new place recognized");
+
+  return errors;
+}
@@ -0,0 +1,69 @@
+#include "SharedFrameRing.h"
+#include "TestCheck.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+std::vector<unsigned char> MakeMessage(int number)
+{
+  return std::vector<unsigned char>(100 + number, static_cast<unsigned char>(number));
+}
+}
+
+int main()
+{
+  int retVal = 0;
+  const std::string name = "LidarViewTestSharedFrameRing";
+
+  SharedFrameRing reader;
+  retVal += Check(!reader.Open(name), "a ring which does not exist should not be opened");
+
+  SharedFrameRing writer;
+  retVal += Check(writer.Create(name, 3, 1024), "could not create the ring");
+  retVal += Check(reader.Open(name), "could not open the ring");
+  if (retVal)
+  {
+    return retVal;
+  }
+
+  uint64_t messageNumber = 0;
+  uint64_t size = 0;
+  retVal += Check(!reader.BeginRead(messageNumber, size), "an empty ring should have no message");
+
+  // the reader gets the newest message, even once the ring has wrapped around
+  for (int i = 0; i < 5; ++i)
+  {
+    const std::vector<unsigned char> message = MakeMessage(i);
+    retVal += Check(writer.Write(message.data(), message.size()), "could not write a message");
+  }
+  retVal += Check(reader.GetNumberOfWrittenMessages() == 5, "wrong number of written messages");
+  const unsigned char* data = reader.BeginRead(messageNumber, size);
+  retVal += Check(data && messageNumber == 4 && size == MakeMessage(4).size()
+                  && std::vector<unsigned char>(data, data + size) == MakeMessage(4),
+                  "wrong newest message");
+  retVal += Check(reader.EndRead(messageNumber), "the newest message should still be valid");
+
+  // a message overwritten while it is read is detected
+  for (int i = 5; i < 8; ++i)
+  {
+    const std::vector<unsigned char> message = MakeMessage(i);
+    writer.Write(message.data(), message.size());
+  }
+  retVal += Check(!reader.EndRead(messageNumber), "an overwritten message should be detected");
+
+  const std::vector<unsigned char> tooLarge(2048);
+  retVal += Check(!writer.Write(tooLarge.data(), tooLarge.size()),
+                  "a message larger than the slots should be rejected");
+
+  // the reader is told when the writer closes the ring, which is then removed
+  retVal += Check(!reader.IsWriterClosed(), "the writer should not be closed yet");
+  writer.Close();
+  retVal += Check(reader.IsWriterClosed(), "the writer should be closed");
+  SharedFrameRing lateReader;
+  retVal += Check(!lateReader.Open(name), "a closed ring should be removed");
+
+  return retVal;
+}
@@ -88,6 +88,8 @@ int main(int argc, char* argv[])
   auto interp = vtkSmartPointer<vtkVelodynePacketInterpreter>::New();
   HDLReader->SetInterpreter(interp);
   HDLReader->SetFileName(pcapFileName);
+  // do not write the sidecar of the frame catalog next to the test data
+  HDLReader->SetUseFrameIndexCache(false);
   HDLReader->SetCalibrationFileName(correctionFileName);
   HDLReader->Update();
 
@@ -101,6 +103,11 @@ int main(int argc, char* argv[])
 
   Slam slam = Slam();
 
+  // The overlapped pipeline must register the same frames, one frame later
+  Slam overlappedSlam = Slam();
+  overlappedSlam.SetPipelineMode(FramePipelineMode::OverlappedPipeline);
+  double previousResSlam[3] = {0.0, 0.0, 0.0};
+
   for (int idFrame = 0; idFrame < expectedTraj->GetNumberOfPoints(); ++idFrame)
   {
     vtkPolyData* currentFrame = GetCurrentFrame(HDLReader.Get(), idFrame+1);
@@ -125,6 +132,19 @@ int main(int argc, char* argv[])
     {
       retVal +=1;
     }
+
+    overlappedSlam.AddFrame(pc, laserIdMapping);
+    if (idFrame > 0)
+    {
+      Transform overlappedT = overlappedSlam.GetWorldTransform();
+      double resOverlappedSlam[3] = {overlappedT.x, overlappedT.y, overlappedT.z};
+      if (!compare(previousResSlam, resOverlappedSlam, 3, 1e-9))
+      {
+        std::cerr << "Overlapped pipeline differs at frame " << idFrame - 1 << std::endl;
+        retVal +=1;
+      }
+    }
+    std::copy(resSlam, resSlam + 3, previousResSlam);
   }
   return retVal;
 }
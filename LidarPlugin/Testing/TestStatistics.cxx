@@ -0,0 +1,104 @@
+#include "statistics.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+//! Median by sorting a copy, as a reference
+double SortedMedian(std::vector<double> values)
+{
+  std::sort(values.begin(), values.end());
+  const size_t n = values.size() / 2;
+  return values.size() % 2 ? values[n] : 0.5 * (values[n - 1] + values[n]);
+}
+}
+
+int main()
+{
+  int retVal = 0;
+  std::mt19937 generator(42);
+  std::normal_distribution<double> gaussian(3.0, 2.0);
+
+  // medians of odd and even numbers of values, with duplicates
+  for (size_t size : { 1, 2, 7, 8, 101, 1000 })
+  {
+    std::vector<double> values(size);
+    for (double& value : values)
+    {
+      value = std::round(gaussian(generator) * 4.0) / 4.0;
+    }
+    const double expected = SortedMedian(values);
+    retVal += Check(ComputeMedian(values) == expected, "median of " + std::to_string(size) + " values");
+  }
+  std::vector<int> integers = { 4, 1, 3, 2 };
+  retVal += Check(ComputeMedian(integers) == 2.5, "median of integers");
+
+  // median absolute deviation, with outliers that do not change it much
+  std::vector<double> values(10001);
+  for (double& value : values)
+  {
+    value = gaussian(generator);
+  }
+  for (size_t i = 0; i < 500; ++i)
+  {
+    values[i] = 1e6;
+  }
+  double median = ComputeMedian(values);
+  const double sigma = 1.4826 * ComputeMAD(values, median);
+  retVal += Check(std::abs(median - 3.0) < 0.2, "median with outliers");
+  retVal += Check(std::abs(sigma - 2.0) < 0.3, "standard deviation from the MAD");
+
+  // sliding window compared to a median of the window
+  SlidingMedian<int> window;
+  std::uniform_int_distribution<int> uniform(0, 20);
+  std::vector<int> stream(500);
+  for (int& value : stream)
+  {
+    value = uniform(generator);
+  }
+  const size_t width = 15;
+  bool isSlidingCorrect = true;
+  for (size_t i = 0; i < stream.size(); ++i)
+  {
+    window.Insert(stream[i]);
+    if (i >= width)
+    {
+      isSlidingCorrect &= window.Erase(stream[i - width]);
+    }
+    std::vector<int> content(stream.begin() + (i >= width ? i - width + 1 : 0), stream.begin() + i + 1);
+    std::vector<int> sorted = content;
+    std::sort(sorted.begin(), sorted.end());
+    isSlidingCorrect &= window.Size() == content.size();
+    isSlidingCorrect &= window.GetUpperMedian() == sorted[sorted.size() / 2];
+    isSlidingCorrect &= window.GetMedian() == ComputeMedian(content);
+  }
+  retVal += Check(isSlidingCorrect, "sliding median");
+  retVal += Check(!window.Erase(100), "value not in the window erased");
+
+  // streaming quantiles
+  P2Quantile small(0.5);
+  for (double value : { 5.0, 1.0, 3.0 })
+  {
+    small.Add(value);
+  }
+  retVal += Check(small.Get() == 3.0, "exact median of the first values");
+
+  std::exponential_distribution<double> exponential(1.0);
+  P2Quantile streamingMedian(0.5), streaming90(0.9);
+  for (int i = 0; i < 100000; ++i)
+  {
+    const double value = exponential(generator);
+    streamingMedian.Add(value);
+    streaming90.Add(value);
+  }
+  retVal += Check(std::abs(streamingMedian.Get() - std::log(2.0)) < 0.02, "streaming median");
+  retVal += Check(std::abs(streaming90.Get() - std::log(10.0)) < 0.05, "streaming 90th percentile");
+
+  return retVal;
+}
@@ -0,0 +1,58 @@
+#include "vtkTemporalTransforms.h"
+#include "TestCheck.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <vtkCellArray.h>
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+
+int main()
+{
+  int errors = 0;
+  const vtkIdType n = 1000;
+
+  // the same trajectory built pose by pose and at once
+  std::vector<double> times(n), quaternions(4 * n), translations(3 * n);
+  auto pushed = vtkSmartPointer<vtkTemporalTransforms>::New();
+  pushed->Reserve(n);
+  for (vtkIdType i = 0; i < n; ++i)
+  {
+    times[i] = 0.1 * i;
+    const Eigen::AngleAxisd orientation(0.001 * i, Eigen::Vector3d(1.0, 2.0, 3.0).normalized());
+    const Eigen::Quaterniond q(orientation);
+    quaternions[4 * i] = q.w();
+    quaternions[4 * i + 1] = q.x();
+    quaternions[4 * i + 2] = q.y();
+    quaternions[4 * i + 3] = q.z();
+    const Eigen::Vector3d translation(i, 2.0 * i, -0.5 * i);
+    Eigen::Map<Eigen::Vector3d>(&translations[3 * i]) = translation;
+    pushed->PushBack(times[i], orientation, translation);
+  }
+  errors += Check(pushed->GetNumberOfPoints() == n && pushed->GetLines()->GetNumberOfCells() == n - 1,
+                  "wrong trajectory built by PushBack");
+
+  auto set = vtkSmartPointer<vtkTemporalTransforms>::New();
+  set->SetPoses(n, times.data(), quaternions.data(), translations.data());
+  errors += Check(set->GetNumberOfPoints() == n && set->GetLines()->GetNumberOfCells() == 1,
+                  "wrong trajectory built by SetPoses");
+
+  bool posesOk = true;
+  for (vtkIdType i = 0; i < n; ++i)
+  {
+    posesOk &= set->GetTime(i) == pushed->GetTime(i);
+    posesOk &= set->GetPose(i).isApprox(pushed->GetPose(i), 1e-9);
+    posesOk &= set->GetPose(i).matrix().isApprox(
+      Eigen::Map<Eigen::Matrix4d>(set->GetTransform(i)->GetMatrix()->GetData()).transpose(), 1e-9);
+  }
+  errors += Check(posesOk, "SetPoses and PushBack poses differ");
+
+  // the poses are replaced
+  set->SetPoses(2, times.data(), quaternions.data(), translations.data());
+  errors += Check(set->GetNumberOfPoints() == 2 && set->GetTimeArray()->GetNumberOfTuples() == 2,
+                  "poses not replaced");
+  return errors;
+}
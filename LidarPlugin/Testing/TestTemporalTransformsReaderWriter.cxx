@@ -4,6 +4,7 @@
 #include <iostream>
 #include <iomanip>
 #include <stdio.h>
+#include <string>
 
 #include "vtkPolyData.h"
 
@@ -124,5 +125,16 @@ int main(int argc, char* argv[])
     return 1;
   }
 
+  // Then test the binary format
+  std::string temporaryBinaryFile = std::string(temporaryFile) + ".lvtraj";
+  read_write_trajectory(referenceTrajectory, &temporaryBinaryFile[0]);
+  if (! check_mm04_orbslam2_no_loop_closure(&temporaryBinaryFile[0]))
+  {
+    std::cout << "Reading file written using vtkTemporalTransformsWriter"
+                 " in binary format does not seem to work" << std::endl;
+    return 1;
+  }
+  std::remove(temporaryBinaryFile.c_str());
+
   return 0;
 }
@@ -0,0 +1,38 @@
+#include "ThreadPlacement.h"
+#include "TestCheck.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main()
+{
+  int retVal = 0;
+
+  // CPU lists
+  std::vector<int> cpus;
+  retVal += Check(ThreadPlacement::ParseCPUList(" 8, 0-3,10,2 ", cpus), "valid list rejected");
+  retVal += Check(cpus == std::vector<int>({ 0, 1, 2, 3, 8, 10 }), "wrong CPUs parsed");
+  retVal += Check(ThreadPlacement::FormatCPUList(cpus) == "0-3,8,10", "wrong CPUs formatted");
+  retVal += Check(ThreadPlacement::ParseCPUList("", cpus) && cpus.empty(), "empty list");
+
+  cpus = { 1 };
+  for (const char* invalid : { "3-1", "a", "1-", "-2", "1,2x" })
+  {
+    retVal += Check(!ThreadPlacement::ParseCPUList(invalid, cpus), std::string("invalid list accepted: ") + invalid);
+  }
+  retVal += Check(cpus == std::vector<int>({ 1 }), "CPUs modified by an invalid list");
+
+  // the default placement can always be applied
+  ThreadPlacement placement;
+  retVal += Check(placement.IsDefault() && placement.Apply("test"), "default placement");
+
+  // the function is run whatever the CPUs, even if they cannot be used
+  int numberOfCalls = 0;
+  placement.RunPinned([&numberOfCalls]() { ++numberOfCalls; });
+  placement.CPUs = { 0 };
+  placement.RunPinned([&numberOfCalls]() { ++numberOfCalls; });
+  retVal += Check(numberOfCalls == 2, "pinned function not run");
+
+  return retVal;
+}
@@ -27,6 +27,10 @@
 #include <vtkDoubleArray.h>
 #include <vtkSmartPointer.h>
 
+// STD
+#include <chrono>
+#include <random>
+
 // EIGEN
 #include <Eigen/Dense>
 
@@ -315,6 +319,128 @@ int TestComputeSimilitude()
   return 0;
 }
 
+//----------------------------------------------------------------------------
+// Poses of a trajectory whose relative poses are a constant motion,
+// perturbed by a drift of the yaw and of the scale and by some noise
+PoseEstimationVector SyntheticTrajectory(int NPoses, double yawDrift, double scaleDrift, std::mt19937& generator)
+{
+  std::normal_distribution<double> noise(0.0, 1e-3);
+  PoseEstimationVector poses(NPoses);
+  Eigen::Matrix4d H = Eigen::Matrix4d::Identity();
+  for (int poseIndex = 0; poseIndex < NPoses; ++poseIndex)
+  {
+    poses[poseIndex].H = H;
+    poses[poseIndex].Sigma = 100.0 * Eigen::Matrix<double, 6, 6>::Identity();
+    Eigen::Matrix4d dH = Eigen::Matrix4d::Identity();
+    dH.block(0, 0, 3, 3) = RollPitchYawToMatrix(noise(generator), noise(generator), 2e-3 + yawDrift + noise(generator));
+    dH.block(0, 3, 3, 1) = (1.0 + scaleDrift) * Eigen::Vector3d(1.0, 0.0, 0.0) +
+                           Eigen::Vector3d(noise(generator), noise(generator), noise(generator));
+    H = H * dH;
+  }
+  return poses;
+}
+
+//----------------------------------------------------------------------------
+double MeanPositionError(const PoseEstimationVector& poses, const PoseEstimationVector& reference)
+{
+  double error = 0;
+  for (int poseIndex = 0; poseIndex < poses.size(); ++poseIndex)
+  {
+    error += (poses[poseIndex].H.block(0, 3, 3, 1) - reference[poseIndex].H.block(0, 3, 3, 1)).norm();
+  }
+  return error / static_cast<double>(poses.size());
+}
+
+//----------------------------------------------------------------------------
+// Reoptimize a drifting trajectory using some poses of the true one as anchors.
+// Return the corrected poses, and the wall time of the reoptimization and the
+// mean position errors of the drifting and of the corrected trajectories.
+PoseEstimationVector ReoptimizeSyntheticTrajectory(int NPoses, int anchorsStep, const TrajectoryReoptimizationOptions& options,
+                                                   double& elapsed, double& slamError, double& correctedError)
+{
+  std::mt19937 generator(42);
+  const PoseEstimationVector groundTruth = SyntheticTrajectory(NPoses, 0.0, 0.0, generator);
+  const PoseEstimationVector slamPoses = SyntheticTrajectory(NPoses, 1e-4, 1e-3, generator);
+
+  std::vector<Eigen::Matrix4d> Hanchors;
+  std::vector<int> anchorsIndex;
+  for (int poseIndex = anchorsStep - 1; poseIndex < NPoses; poseIndex += anchorsStep)
+  {
+    Hanchors.push_back(groundTruth[poseIndex].H);
+    anchorsIndex.push_back(poseIndex);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  PoseEstimationVector correctedPoses = TrajectoryReoptimization(slamPoses, Hanchors, anchorsIndex, options);
+  elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  slamError = MeanPositionError(slamPoses, groundTruth);
+  correctedError = MeanPositionError(correctedPoses, groundTruth);
+  return correctedPoses;
+}
+
+//----------------------------------------------------------------------------
+// The sparse solvers correct a short drifting trajectory as the dense problem does
+int TestTrajectoryReoptimizationSolvers()
+{
+  int errors = 0;
+  TrajectoryReoptimizationOptions options;
+  options.Verbose = false;
+  double elapsed, slamError, correctedError;
+
+  options.Solver = ReoptimizationSolver::DenseLineSearch;
+  const PoseEstimationVector densePoses = ReoptimizeSyntheticTrajectory(300, 150, options, elapsed, slamError, correctedError);
+  errors += (correctedError < 0.5 * slamError) ? 0 : 1;
+
+  for (ReoptimizationSolver solver : { ReoptimizationSolver::ConjugateGradients, ReoptimizationSolver::SparseNormalCholesky })
+  {
+    options.Solver = solver;
+    options.WindowSize = (solver == ReoptimizationSolver::SparseNormalCholesky) ? 150 : options.WindowSize;
+    const PoseEstimationVector sparsePoses = ReoptimizeSyntheticTrajectory(300, 150, options, elapsed, slamError, correctedError);
+    const double difference = MeanPositionError(sparsePoses, densePoses);
+    if (correctedError >= 0.5 * slamError || difference >= 0.1 * slamError)
+    {
+      std::cout << "Solver " << static_cast<int>(solver) << ": mean position error " << slamError << " m -> "
+                << correctedError << " m, " << difference << " m from the dense problem" << std::endl;
+      errors++;
+    }
+  }
+  return errors;
+}
+
+//----------------------------------------------------------------------------
+// Time the reoptimization of a short trajectory with each solver, and of a one
+// hour trajectory at 10 Hz with an anchor per minute with the conjugate gradients
+int BenchmarkTrajectoryReoptimization()
+{
+  int errors = 0;
+  TrajectoryReoptimizationOptions options;
+  options.Verbose = false;
+  const char* solverNames[] = { "DenseLineSearch", "SparseNormalCholesky", "ConjugateGradients" };
+  auto measure = [&](int NPoses, int anchorsStep)
+  {
+    double elapsed, slamError, correctedError;
+    ReoptimizeSyntheticTrajectory(NPoses, anchorsStep, options, elapsed, slamError, correctedError);
+    std::cout << "BENCHMARK " << solverNames[static_cast<int>(options.Solver)] << " " << NPoses
+              << " seconds=" << elapsed << " error=" << correctedError << std::endl;
+    errors += (correctedError < 0.5 * slamError) ? 0 : 1;
+  };
+
+  options.Solver = ReoptimizationSolver::DenseLineSearch;
+  measure(300, 150);
+  options.Solver = ReoptimizationSolver::ConjugateGradients;
+  measure(300, 150);
+  options.Solver = ReoptimizationSolver::SparseNormalCholesky;
+  options.WindowSize = 150;
+  measure(300, 150);
+
+  options.Solver = ReoptimizationSolver::ConjugateGradients;
+  options.WindowSize = 600;
+  measure(36000, 600);
+
+  return errors;
+}
+
 //----------------------------------------------------------------------------
 int main(int argc, char* argv[])
 {
@@ -323,6 +449,12 @@ int main(int argc, char* argv[])
     return 1;
   }
 
+  // the benchmark does not need the test data
+  if (std::string(argv[1]) == "--benchmark")
+  {
+    return BenchmarkTrajectoryReoptimization();
+  }
+
   int errors = 0;
   std::string referenceFilename = std::string(argv[1]) + "/ReferenceCloudFiltered.vtp";
   std::string toAlignedFilename = std::string(argv[1]) + "/ToAlignedCloudFiltered.vtp";
@@ -336,6 +468,7 @@ int main(int argc, char* argv[])
   errors += TestRelocation(referenceFilename, toAlignedFilename);
   errors += TestTrajectoryReoptimizationLoopClosure(rawTrajFileName, optimizedTrajFileName);
   errors += TestTrajectoryReoptimizationGPSIMU(rawTrajFileName, gpsIMUTrajFileName);
+  errors += TestTrajectoryReoptimizationSolvers();
 
   return errors;
 }
@@ -0,0 +1,74 @@
+#include "VelodyneCalibration.h"
+#include "TestCheck.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace DataPacketFixedLength;
+
+namespace
+{
+bool SameCorrection(const HDLLaserCorrection& a, const HDLLaserCorrection& b)
+{
+  return a.rotationalCorrection == b.rotationalCorrection &&
+    a.verticalCorrection == b.verticalCorrection && a.distanceCorrection == b.distanceCorrection &&
+    a.distanceCorrectionX == b.distanceCorrectionX &&
+    a.distanceCorrectionY == b.distanceCorrectionY &&
+    a.verticalOffsetCorrection == b.verticalOffsetCorrection &&
+    a.horizontalOffsetCorrection == b.horizontalOffsetCorrection &&
+    a.focalDistance == b.focalDistance && a.focalSlope == b.focalSlope &&
+    a.closeSlope == b.closeSlope && a.minIntensity == b.minIntensity &&
+    a.maxIntensity == b.maxIntensity;
+}
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Wrong number of arguments. Usage: TestVelodyneCalibration <calibration.xml>"
+              << std::endl;
+    return 1;
+  }
+
+  std::ifstream file(argv[1], std::ios::binary);
+  std::stringstream content;
+  content << file.rdbuf();
+
+  int retVal = 0;
+  std::string error;
+  VelodyneCalibration xml;
+  bool parsed = ParseVelodyneCalibration(content.str(), xml, error);
+  retVal += Check(parsed, "xml parsing: " + error);
+  retVal += Check(xml.NumberOfLasers > 0, "no enabled laser");
+
+  // the compiled calibration must give back exactly the parsed xml
+  std::stringstream compiled;
+  retVal += Check(WriteCompiledVelodyneCalibration(xml, compiled), "compiled writing");
+  VelodyneCalibration binary;
+  parsed = ParseVelodyneCalibration(compiled.str(), binary, error);
+  retVal += Check(parsed, "compiled parsing: " + error);
+  retVal += Check(binary.DistanceResolutionM == xml.DistanceResolutionM, "distance resolution");
+  retVal += Check(binary.NumberOfLasers == xml.NumberOfLasers, "number of lasers");
+  retVal += Check(std::memcmp(binary.ColorTable, xml.ColorTable, sizeof(xml.ColorTable)) == 0,
+    "color table");
+  for (int i = 0; i < HDL_MAX_NUM_LASERS; ++i)
+  {
+    retVal += Check(SameCorrection(binary.Corrections[i], xml.Corrections[i]),
+      "corrections of laser " + std::to_string(i));
+  }
+
+  // a truncated compiled calibration must be rejected
+  const std::string truncated = compiled.str().substr(0, compiled.str().size() / 2);
+  retVal += Check(!ParseVelodyneCalibration(truncated, binary, error), "truncated calibration");
+
+  // loading the same file twice returns the cached calibration
+  auto first = LoadVelodyneCalibration(argv[1], error);
+  auto second = LoadVelodyneCalibration(argv[1], error);
+  retVal += Check(first && first == second, "calibration cache");
+
+  return retVal;
+}
@@ -0,0 +1,251 @@
+#include "VelodyneFiringDecoder.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+using namespace DataPacketFixedLength;
+
+namespace
+{
+const double DegreesToRadians = 3.14159265358979323846 / 180.;
+
+// Intensity corrected with the formula of the HDL-64E S3 manual, computed for one return
+double CorrectIntensity(int rawIntensity, int rawDistance, const HDLLaserCorrection& correction)
+{
+  if (correction.minIntensity >= correction.maxIntensity)
+  {
+    return rawIntensity;
+  }
+  double intensity = (rawIntensity - static_cast<double>(correction.minIntensity)) /
+    (correction.maxIntensity - static_cast<double>(correction.minIntensity)) * 255.0;
+  intensity = std::max(intensity, 0.);
+  const double focalOffset = 256 * std::pow(1.0 - correction.focalDistance / 131.0, 2);
+  intensity += correction.focalSlope *
+    std::abs(focalOffset - 256 * std::pow(1.0 - static_cast<double>(rawDistance) / 65535.0f, 2));
+  return std::max(std::min(intensity, 255.0), 1.0);
+}
+}
+
+int main()
+{
+  int retVal = 0;
+
+  // arbitrary but realistic corrections
+  static HDLLaserCorrection corrections[HDL_MAX_NUM_LASERS];
+  for (int i = 0; i < HDL_MAX_NUM_LASERS; ++i)
+  {
+    HDLLaserCorrection& correction = corrections[i];
+    const double rotational = (i % 7 == 0) ? 0. : -0.1 * (i % 5);
+    const double vertical = -25. + 0.3 * i;
+    correction.cosRotationalCorrection = std::cos(rotational * DegreesToRadians);
+    correction.sinRotationalCorrection = std::sin(rotational * DegreesToRadians);
+    correction.cosVertCorrection = std::cos(vertical * DegreesToRadians);
+    correction.sinVertCorrection = std::sin(vertical * DegreesToRadians);
+    correction.distanceCorrection = 0.01 * (i % 11);
+    correction.verticalOffsetCorrection = 0.002 * (i % 3);
+    correction.horizontalOffsetCorrection = (i % 2) ? 0.026 : -0.026;
+    correction.sinVertOffsetCorrection =
+      correction.verticalOffsetCorrection * correction.sinVertCorrection;
+  }
+  LaserCorrectionArrays arrays;
+  arrays.Set(corrections);
+
+  std::cout << "Firing decoder implementation: " << GetFiringPositionsImplementationName()
+            << std::endl;
+
+  // the dispatched implementation must give exactly the scalar results
+  for (int laserOffset = 0; laserOffset < HDL_MAX_NUM_LASERS; laserOffset += HDL_LASER_PER_FIRING)
+  {
+    FiringBuffer dispatched, scalar;
+    for (int i = 0; i < HDL_LASER_PER_FIRING; ++i)
+    {
+      const double azimuth = (laserOffset * 97 + i * 1013) % 36000 * DegreesToRadians / 100.;
+      dispatched.CosAzimuth[i] = scalar.CosAzimuth[i] = std::cos(azimuth);
+      dispatched.SinAzimuth[i] = scalar.SinAzimuth[i] = std::sin(azimuth);
+      dispatched.RawDistance[i] = scalar.RawDistance[i] = (i * 2311 + laserOffset) % 65536;
+    }
+    ComputeFiringPositions(arrays, laserOffset, 0.002, dispatched);
+    ComputeFiringPositionsScalar(arrays, laserOffset, 0.002, scalar);
+
+    for (int i = 0; i < HDL_LASER_PER_FIRING; ++i)
+    {
+      retVal += Check(dispatched.X[i] == scalar.X[i] && dispatched.Y[i] == scalar.Y[i] &&
+                        dispatched.Z[i] == scalar.Z[i] &&
+                        dispatched.Distance[i] == scalar.Distance[i],
+        "positions differ from the scalar implementation for laser " +
+          std::to_string(laserOffset + i));
+    }
+  }
+
+  // the dispatched transform must give exactly the scalar results, here a rotation of 90
+  // degrees around z followed by a translation
+  const double matrix[12] = { 0., -1., 0., 1.5, 1., 0., 0., -0.25, 0., 0., 1., 2. };
+  FiringBuffer dispatched, scalar;
+  for (int i = 0; i < HDL_LASER_PER_FIRING; ++i)
+  {
+    dispatched.X[i] = scalar.X[i] = 0.1 * i;
+    dispatched.Y[i] = scalar.Y[i] = 3. - 0.7 * i;
+    dispatched.Z[i] = scalar.Z[i] = -1.8 + 0.01 * i;
+  }
+  TransformFiringPositions(matrix, dispatched);
+  TransformFiringPositionsScalar(matrix, scalar);
+  for (int i = 0; i < HDL_LASER_PER_FIRING; ++i)
+  {
+    retVal += Check(dispatched.X[i] == scalar.X[i] && dispatched.Y[i] == scalar.Y[i] &&
+                      dispatched.Z[i] == scalar.Z[i],
+      "transformed positions differ from the scalar implementation for return " + std::to_string(i));
+    retVal += Check(std::abs(scalar.X[i] - (1.5 - 3. + 0.7 * i)) < 1e-12 &&
+                      std::abs(scalar.Y[i] - (0.1 * i - 0.25)) < 1e-12 &&
+                      std::abs(scalar.Z[i] - (0.2 + 0.01 * i)) < 1e-12,
+      "wrong transformed position for return " + std::to_string(i));
+  }
+
+  // a laser looking straight ahead without correction
+  FiringBuffer firing;
+  for (int i = 0; i < HDL_LASER_PER_FIRING; ++i)
+  {
+    firing.CosAzimuth[i] = 1.;
+    firing.SinAzimuth[i] = 0.;
+    firing.RawDistance[i] = 500.;
+  }
+  static HDLLaserCorrection neutral[HDL_MAX_NUM_LASERS];
+  for (int i = 0; i < HDL_MAX_NUM_LASERS; ++i)
+  {
+    neutral[i].cosRotationalCorrection = 1.;
+    neutral[i].sinRotationalCorrection = 0.;
+    neutral[i].cosVertCorrection = 1.;
+    neutral[i].sinVertCorrection = 0.;
+    neutral[i].sinVertOffsetCorrection = 0.;
+  }
+  arrays.Set(neutral);
+  ComputeFiringPositions(arrays, 0, 0.002, firing);
+  retVal += Check(std::abs(firing.X[0]) < 1e-12 && std::abs(firing.Y[0] - 1.) < 1e-12 &&
+                    std::abs(firing.Z[0]) < 1e-12 && std::abs(firing.Distance[0] - 1.) < 1e-12,
+    "a 1 m return at azimuth 0 should be on the y axis");
+
+  // the tabulated intensity correction must give exactly the intensities of the manual's
+  // formula, the lasers without min and max intensities keeping their raw intensity
+  for (int i = 0; i < HDL_MAX_NUM_LASERS; ++i)
+  {
+    corrections[i].focalDistance = 0.5 * i;
+    corrections[i].focalSlope = 0.3 + 0.05 * (i % 9);
+    corrections[i].closeSlope = corrections[i].focalSlope;
+    corrections[i].minIntensity = static_cast<short>(i % 13);
+    corrections[i].maxIntensity = (i % 10 == 3) ? corrections[i].minIntensity
+                                                : static_cast<short>(255 - 2 * i);
+  }
+  arrays.Set(corrections);
+  bool isIntensityRight = true;
+  for (int laserOffset = 0; laserOffset < HDL_MAX_NUM_LASERS; laserOffset += HDL_LASER_PER_FIRING)
+  {
+    for (int rawIntensity = 0; rawIntensity < 256 && isIntensityRight; rawIntensity += 3)
+    {
+      for (int rawDistance = 0; rawDistance < 65536 && isIntensityRight; rawDistance += 97)
+      {
+        FiringBuffer dispatched, scalar;
+        for (int i = 0; i < HDL_LASER_PER_FIRING; ++i)
+        {
+          dispatched.RawIntensity[i] = scalar.RawIntensity[i] = (rawIntensity + 7 * i) % 256;
+          dispatched.RawDistance[i] = scalar.RawDistance[i] = (rawDistance + 1031 * i) % 65536;
+        }
+        ComputeFiringIntensities(arrays, laserOffset, dispatched);
+        ComputeFiringIntensitiesScalar(arrays, laserOffset, scalar);
+        for (int i = 0; i < HDL_LASER_PER_FIRING; ++i)
+        {
+          const double expected = CorrectIntensity(scalar.RawIntensity[i],
+            static_cast<int>(scalar.RawDistance[i]), corrections[laserOffset + i]);
+          isIntensityRight = isIntensityRight && dispatched.Intensity[i] == scalar.Intensity[i] &&
+            static_cast<int>(scalar.Intensity[i]) == static_cast<int>(expected);
+        }
+      }
+    }
+  }
+  retVal += Check(isIntensityRight, "the tabulated intensity correction differs from the formula");
+
+  // the azimuth step estimator must give exactly the element of the requested rank, on
+  // packets like the ones of a sensor slowly changing its speed: single return, dual
+  // return (pairs of firings at the same azimuth), HDL-64 (upper and lower blocks)
+  const int numberOfDiffs = HDL_FIRING_PER_PKT - 1;
+  const int ranks[3] = { HDL_FIRING_PER_PKT / 2, HDL_FIRING_PER_PKT / 2, HDL_FIRING_PER_PKT - 2 };
+  const int periods[3] = { 1, 2, 2 };
+  for (int mode = 0; mode < 3; ++mode)
+  {
+    AzimuthStepEstimator estimator;
+    unsigned int seed = 12345;
+    int azimuth = 0;
+    for (int packet = 0; packet < 20000; ++packet)
+    {
+      // step between 15 and 45 hundredths of degree, with some jitter
+      const int speed = 30 + static_cast<int>(15 * std::sin(packet * 1e-3));
+      int diffs[numberOfDiffs];
+      for (int i = 0; i < numberOfDiffs; ++i)
+      {
+        seed = seed * 1103515245u + 12345u;
+        const int jitter = static_cast<int>((seed >> 16) % 3) - 1;
+        diffs[i] = ((azimuth + i) % periods[mode] == 0) ? speed * periods[mode] + jitter : 0;
+      }
+      azimuth += numberOfDiffs;
+
+      int sorted[numberOfDiffs];
+      std::copy(diffs, diffs + numberOfDiffs, sorted);
+      std::sort(sorted, sorted + numberOfDiffs);
+      const int step = estimator.Update(diffs, numberOfDiffs, ranks[mode]);
+      if (Check(step == sorted[ranks[mode]], "wrong azimuth step for packet " +
+            std::to_string(packet) + " in mode " + std::to_string(mode)))
+      {
+        ++retVal;
+        break;
+      }
+    }
+    std::cout << "Azimuth step mispredictions in mode " << mode << ": "
+              << estimator.GetNumberOfMispredictions() << " / 20000" << std::endl;
+  }
+
+  // the timing tables must hold the offsets given by the sensor manuals
+  const FiringTimingTable& none = GetFiringTimingTable(FiringTimingModel::None, false);
+  bool isNoneZero = true;
+  for (int block = 0; block < HDL_FIRING_PER_PKT; ++block)
+  {
+    for (int dsr = 0; dsr < HDL_LASER_PER_FIRING; ++dsr)
+    {
+      isNoneZero = isNoneZero && none.TimestampAdjustment[block][dsr] == 0. &&
+        none.AzimuthFraction[block][dsr] == 0.;
+    }
+  }
+  retVal += Check(isNoneZero, "there should be no adjustment without a timing model");
+
+  const FiringTimingTable& hdl32 = GetFiringTimingTable(FiringTimingModel::HDL32, false);
+  retVal += Check(hdl32.TimestampAdjustment[3][5] == std::round(3 * 46.08 + 5 * 1.152) &&
+                    std::abs(hdl32.AzimuthFraction[3][5] - 5 * 1.152 / 46.08) < 1e-12,
+    "wrong HDL-32 timing");
+  const FiringTimingTable& vlp16Dual = GetFiringTimingTable(FiringTimingModel::VLP16, true);
+  retVal += Check(vlp16Dual.TimestampAdjustment[5][20] ==
+                      std::round(2 * 110.592 + 4 * 2.304 + 55.296) &&
+                    std::abs(vlp16Dual.AzimuthFraction[5][20] - (4 * 2.304 + 55.296) / 110.592) < 1e-12,
+    "wrong VLP-16 dual return timing");
+  const FiringTimingTable& hdl64 = GetFiringTimingTable(FiringTimingModel::HDL64, false);
+  retVal += Check(hdl64.TimestampAdjustment[11][31] == -2. &&
+                    hdl64.TimestampAdjustment[0][0] == -std::round(5 * 48.0 + 6.0 + 7 * 6.0),
+    "wrong HDL-64 timing");
+
+  // the cached azimuth adjustments must follow the azimuth step
+  AzimuthAdjustmentCache adjustmentCache;
+  for (int azimuthDiff : { 20, 20, 40, -20 })
+  {
+    const int* adjustments = adjustmentCache.Get(hdl32, 3, azimuthDiff);
+    bool isAdjustmentRight = true;
+    for (int dsr = 0; dsr < HDL_LASER_PER_FIRING; ++dsr)
+    {
+      const double expected = azimuthDiff * hdl32.AzimuthFraction[3][dsr];
+      isAdjustmentRight = isAdjustmentRight &&
+        adjustments[dsr] == static_cast<int>(expected >= 0. ? expected + 0.5 : expected - 0.5);
+    }
+    retVal += Check(isAdjustmentRight,
+      "wrong azimuth adjustments for a step of " + std::to_string(azimuthDiff));
+  }
+
+  return retVal;
+}
@@ -0,0 +1,109 @@
+#include "VelodynePacketGenerator.h"
+#include "vtkVelodynePacketInterpreter.h"
+#include "TestCheck.h"
+
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+// Decode a second of synthetic packets, return the number of frames and check that the
+// returns of the ground, recognized by their intensity, are at the height of the ground
+int CheckDecoding(const std::string& calibrationFileName, bool dualReturn, int& numberOfFrames)
+{
+  int retVal = 0;
+  auto interpreter = vtkSmartPointer<vtkVelodynePacketInterpreter>::New();
+  interpreter->SetCalibrationFileName(calibrationFileName);
+  interpreter->LoadCalibration(calibrationFileName);
+  retVal += Check(interpreter->GetIsCalibrated(), "the calibration could not be loaded");
+
+  VelodynePacketGenerator generator(VelodynePacketGenerator::VLP16, dualReturn);
+  std::string error;
+  retVal += Check(generator.SetCalibration(*LoadVelodyneCalibration(calibrationFileName, error)),
+                  "the calibration is not the one of a VLP-16");
+
+  numberOfFrames = 0;
+  vtkIdType numberOfGroundPoints = 0, numberOfMisplacedGroundPoints = 0;
+  std::vector<unsigned char> packet(VelodynePacketGenerator::PacketSize);
+  while (generator.GeneratePacket(packet.data()) < 1.0)
+  {
+    retVal += Check(interpreter->IsLidarPacket(packet.data(), VelodynePacketGenerator::PacketSize),
+                    "a packet is not a lidar packet");
+    interpreter->ProcessPacket(packet.data(), VelodynePacketGenerator::PacketSize);
+    if (!interpreter->IsNewFrameReady())
+    {
+      continue;
+    }
+    vtkSmartPointer<vtkPolyData> frame = interpreter->GetLastFrameAvailable();
+    interpreter->ClearAllFramesAvailable();
+    ++numberOfFrames;
+    vtkDataArray* intensities = frame->GetPointData()->GetArray("intensity");
+    for (vtkIdType i = 0; intensities && i < frame->GetNumberOfPoints(); ++i)
+    {
+      double point[3];
+      frame->GetPoint(i, point);
+      if (intensities->GetTuple1(i) <= 25 && std::hypot(point[0], point[1]) < 7.)
+      {
+        ++numberOfGroundPoints;
+        numberOfMisplacedGroundPoints += std::abs(point[2] + 1.8) > 0.1 ? 1 : 0;
+      }
+    }
+  }
+  retVal += Check(numberOfGroundPoints > 1000, "the ground is not seen");
+  retVal += Check(numberOfMisplacedGroundPoints < numberOfGroundPoints / 100,
+                  std::to_string(numberOfMisplacedGroundPoints) + " ground points are not on the ground");
+  retVal += Check(interpreter->GetHasDualReturn() == dualReturn, "unexpected return mode");
+  return retVal;
+}
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Wrong number of arguments. Usage: TestVelodynePacketGenerator <VLP-16.xml>"
+              << std::endl;
+    return 1;
+  }
+  int retVal = 0;
+
+  // the packets only depend on their index and on the seed
+  for (int model = 0; model < VelodynePacketGenerator::NumberOfModels; ++model)
+  {
+    VelodynePacketGenerator generator(static_cast<VelodynePacketGenerator::Model>(model), true);
+    std::vector<unsigned char> sequential(VelodynePacketGenerator::PacketSize);
+    std::vector<unsigned char> indexed(VelodynePacketGenerator::PacketSize);
+    for (int i = 0; i < 100; ++i)
+    {
+      generator.GeneratePacket(sequential.data());
+    }
+    generator.GeneratePacket(99, indexed.data());
+    retVal += Check(sequential == indexed, "a packet depends on the previous ones");
+    generator.SetSeed(1);
+    generator.GeneratePacket(99, indexed.data());
+    retVal += Check(sequential != indexed, "the seed is not used");
+  }
+
+  VelodynePacketGenerator::Model model;
+  retVal += Check(VelodynePacketGenerator::GetModelFromName("hdl-64", model)
+                  && model == VelodynePacketGenerator::HDL64, "the model names are not found");
+  retVal += Check(!VelodynePacketGenerator::GetModelFromName("HDL-32", model), "unexpected model");
+
+  // a VLP-16 turning at 600 rpm completes about 10 frames per second
+  int numberOfFrames = 0;
+  retVal += CheckDecoding(argv[1], false, numberOfFrames);
+  retVal += Check(numberOfFrames >= 9 && numberOfFrames <= 10,
+                  "unexpected number of frames: " + std::to_string(numberOfFrames));
+  retVal += CheckDecoding(argv[1], true, numberOfFrames);
+  retVal += Check(numberOfFrames >= 9 && numberOfFrames <= 10,
+                  "unexpected number of dual return frames: " + std::to_string(numberOfFrames));
+
+  return retVal;
+}
@@ -0,0 +1,124 @@
+#include "VelodynePositionDecoder.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+// Write a 12 bits two's complement value in a little endian field whose upper bits are noise
+void Write12Bits(unsigned char* data, int value)
+{
+  const int field = (value & 0x0fff) | 0xa000;
+  data[0] = static_cast<unsigned char>(field & 0xff);
+  data[1] = static_cast<unsigned char>(field >> 8);
+}
+
+// NMEA sentence with its checksum
+std::string MakeSentence(const std::string& body)
+{
+  unsigned int checksum = 0;
+  for (char c : body)
+  {
+    checksum ^= static_cast<unsigned char>(c);
+  }
+  char suffix[8];
+  std::snprintf(suffix, sizeof(suffix), "*%02X\r\n", checksum);
+  return "$" + body + suffix;
+}
+
+std::vector<unsigned char> MakePacket(uint32_t tohTimestamp, unsigned char pps, const std::string& sentence)
+{
+  std::vector<unsigned char> packet(VelodynePositionDecoder::PacketSize, 0);
+  for (int i = 0; i < 3; ++i)
+  {
+    Write12Bits(packet.data() + 14 + i * 8, 100 * (i + 1));
+    Write12Bits(packet.data() + 14 + i * 8 + 2, -10 * (i + 1));
+    Write12Bits(packet.data() + 14 + i * 8 + 4, -2048);
+    Write12Bits(packet.data() + 14 + i * 8 + 6, 2047);
+  }
+  std::memcpy(packet.data() + 198, &tohTimestamp, 4);
+  packet[202] = pps;
+  std::memcpy(packet.data() + 206, sentence.data(), sentence.size());
+  return packet;
+}
+
+std::string MakeGPRMC(int utcSeconds, bool isValid)
+{
+  char body[128];
+  std::snprintf(body, sizeof(body), "GPRMC,%02d%02d%02d,%c,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W,",
+                utcSeconds / 3600, (utcSeconds / 60) % 60, utcSeconds % 60, isValid ? 'A' : 'V');
+  return MakeSentence(body);
+}
+}
+
+int main()
+{
+  int retVal = 0;
+  VelodynePositionDecoder decoder;
+  decoder.SetAssumedHardwareLag(0.1);
+  VelodynePositionSample sample;
+
+  // the packets which are not position packets are rejected
+  std::vector<unsigned char> packet = MakePacket(0, 0, "");
+  retVal += Check(decoder.Decode(packet.data(), 554, sample) == VelodynePositionDecoder::InvalidPacket,
+                  "a packet of the wrong size was decoded");
+  packet[3] = 1;
+  retVal += Check(decoder.Decode(packet.data(), 512, sample) == VelodynePositionDecoder::InvalidPacket,
+                  "a packet without its leading zeros was decoded");
+
+  // a packet without GPS gives the IMU values only
+  packet = MakePacket(1000000, VelodynePositionDecoder::PPS_ABSENT, "");
+  retVal += Check(decoder.Decode(packet.data(), 512, sample) == VelodynePositionDecoder::Decoded
+                  && !sample.HasLocation && sample.LidarTime == 1e6 && sample.GPSTime == 0.0,
+                  "unexpected packet without GPS");
+  retVal += Check(std::abs(sample.Gyro[1] - 200 * 0.09766) < 1e-9
+                  && std::abs(sample.Temperature[2] - (-30 * 0.1453 + 25.0)) < 1e-9
+                  && std::abs(sample.AccelerationX[0] + 2048 * 0.001221) < 1e-9
+                  && std::abs(sample.AccelerationY[0] - 2047 * 0.001221) < 1e-9,
+                  "unexpected IMU values");
+
+  // a new fix each second, the lidar clock being 1.5 s late on the UTC top of the hour
+  // and wrapping at the end of the hour, the PPS being locked from the third fix
+  const int firstFix = 12 * 3600 + 59 * 60 + 58;
+  for (int i = 0; i < 6; ++i)
+  {
+    const double lidarTime = std::fmod(firstFix + i + 0.1 - 1.5, 3600.0);
+    const unsigned char pps = i < 2 ? VelodynePositionDecoder::PPS_ATTEMPTING_TO_SYNC
+                                    : VelodynePositionDecoder::PPS_LOCKED;
+    packet = MakePacket(static_cast<uint32_t>(std::round(1e6 * lidarTime)), pps, MakeGPRMC(firstFix + i, true));
+    retVal += Check(decoder.Decode(packet.data(), 512, sample) == VelodynePositionDecoder::Decoded,
+                    "a GPRMC sentence was not decoded");
+    retVal += Check(sample.GPSTime == firstFix + i, "unexpected GPS time");
+  }
+  retVal += Check(sample.HasLocation && sample.IsFixValid && std::abs(sample.Latitude - 48.1173) < 1e-4
+                  && std::abs(sample.Heading - 84.4) < 1e-9, "unexpected location");
+  retVal += Check(std::abs(sample.LidarTime - 1e6 * (firstFix % 3600 + 5 + 0.1 - 1.5)) < 1.0,
+                  "the rollover of the lidar time is not handled");
+  retVal += Check(decoder.GetPPSSynced() && decoder.GetLastPPSState() == VelodynePositionDecoder::PPS_LOCKED,
+                  "the PPS lock is not found");
+  // the timeshift is measured on each new fix but the first one, the hardware lag
+  // compensating the 0.1 s between the fix and its packet
+  retVal += Check(decoder.GetNumberOfTimeshiftMeasurements() == 5, "unexpected number of timeshifts");
+  const double timeshift = decoder.GetTimeshiftEstimation();
+  retVal += Check(std::abs(std::fmod(timeshift, 3600.0) - 1.5) < 1e-6,
+                  "unexpected timeshift: " + std::to_string(timeshift));
+
+  // the GPGGA sentences are skipped unless they are selected, and then give the altitude
+  const std::string gpgga = MakeSentence("GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,");
+  packet = MakePacket(0, VelodynePositionDecoder::PPS_LOCKED, gpgga);
+  retVal += Check(decoder.Decode(packet.data(), 512, sample) == VelodynePositionDecoder::SkippedSentence,
+                  "a GPGGA sentence was not skipped");
+  decoder.Reset();
+  decoder.SetUseGPGGASentences(true);
+  retVal += Check(decoder.Decode(packet.data(), 512, sample) == VelodynePositionDecoder::Decoded
+                  && std::abs(sample.Altitude - (545.4 + 46.9)) < 1e-9, "unexpected GPGGA altitude");
+  retVal += Check(!decoder.GetHasTimeshiftEstimation(), "the time model is not reset");
+
+  return retVal;
+}
@@ -0,0 +1,106 @@
+#include "VoxelGridSort.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+//! Points of each voxel, in their order, by testing every point
+template <typename T>
+std::vector<std::vector<uint32_t> > BruteForce(const std::vector<T>& coordinates, double voxelSize)
+{
+  double minimum[3] = { std::numeric_limits<double>::infinity(),
+                        std::numeric_limits<double>::infinity(),
+                        std::numeric_limits<double>::infinity() };
+  for (size_t i = 0; i < coordinates.size(); ++i)
+  {
+    if (std::isfinite(coordinates[i]))
+    {
+      minimum[i % 3] = std::min(minimum[i % 3], static_cast<double>(coordinates[i]));
+    }
+  }
+  std::map<std::tuple<long, long, long>, std::vector<uint32_t> > voxels;
+  for (size_t i = 0; i < coordinates.size() / 3; ++i)
+  {
+    const T* p = &coordinates[3 * i];
+    if (std::isfinite(p[0]) && std::isfinite(p[1]) && std::isfinite(p[2]))
+    {
+      // the voxels are sorted by z, y, then x
+      voxels[std::make_tuple(static_cast<long>((p[2] - minimum[2]) / voxelSize),
+                             static_cast<long>((p[1] - minimum[1]) / voxelSize),
+                             static_cast<long>((p[0] - minimum[0]) / voxelSize))]
+        .push_back(static_cast<uint32_t>(i));
+    }
+  }
+  std::vector<std::vector<uint32_t> > result;
+  for (const auto& voxel : voxels)
+  {
+    result.push_back(voxel.second);
+  }
+  return result;
+}
+
+//! Points of each voxel found by the sort
+std::vector<std::vector<uint32_t> > Voxels(const VoxelGridSort& sort)
+{
+  std::vector<std::vector<uint32_t> > result(sort.GetNumberOfVoxels());
+  for (size_t voxel = 0; voxel < result.size(); ++voxel)
+  {
+    result[voxel].assign(sort.GetOrder().begin() + sort.GetVoxelBegin()[voxel],
+                         sort.GetOrder().begin() + sort.GetVoxelBegin()[voxel + 1]);
+  }
+  return result;
+}
+
+template <typename T>
+int TestSort(unsigned int seed)
+{
+  int retVal = 0;
+  std::mt19937 generator(seed);
+  std::uniform_real_distribution<double> distribution(-20.0, 20.0);
+  std::vector<T> coordinates(3 * 300000);
+  for (T& value : coordinates)
+  {
+    value = static_cast<T>(distribution(generator));
+  }
+  coordinates[42] = std::numeric_limits<T>::quiet_NaN();
+  coordinates[3 * 1000] = std::numeric_limits<T>::infinity();
+
+  VoxelGridSort sort;
+  const std::vector<std::vector<uint32_t> > expected = BruteForce(coordinates, 0.5);
+  retVal += Check(sort.Sort(coordinates.data(), coordinates.size() / 3, 0.5, 1), "sorted");
+  retVal += Check(Voxels(sort) == expected, "the points of the voxels match, in their order");
+  retVal += Check(sort.GetVoxelBegin().back() == coordinates.size() / 3 - 2,
+                  "the points with a non finite coordinate are left out");
+
+  // same result with several threads, the buffers being reused
+  retVal += Check(sort.Sort(coordinates.data(), coordinates.size() / 3, 0.5, 4), "threaded sort");
+  retVal += Check(Voxels(sort) == expected, "the threads do not change the result");
+
+  // a single voxel, then too many voxels
+  retVal += Check(sort.Sort(coordinates.data(), coordinates.size() / 3, 100.0, 0) &&
+                  sort.GetNumberOfVoxels() == 1, "a single voxel");
+  retVal += Check(!sort.Sort(coordinates.data(), coordinates.size() / 3, 1e-6, 0),
+                  "too many voxels along an axis");
+  return retVal;
+}
+}
+
+int main()
+{
+  int retVal = 0;
+  retVal += TestSort<float>(42);
+  retVal += TestSort<double>(1992);
+
+  VoxelGridSort sort;
+  retVal += Check(sort.Sort(static_cast<const double*>(nullptr), 0, 0.1) &&
+                  sort.GetNumberOfVoxels() == 0, "empty point cloud");
+  return retVal;
+}
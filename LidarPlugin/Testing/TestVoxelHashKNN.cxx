@@ -0,0 +1,113 @@
+#include "VoxelHashKNN.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+PointXYZTIId MakePoint(double x, double y, double z)
+{
+  PointXYZTIId point;
+  point.x = x;
+  point.y = y;
+  point.z = z;
+  return point;
+}
+
+double SquaredDistance(const PointXYZTIId& a, const PointXYZTIId& b)
+{
+  const double dx = a.x - b.x;
+  const double dy = a.y - b.y;
+  const double dz = a.z - b.z;
+  return dx * dx + dy * dy + dz * dz;
+}
+
+// Compare the neighbors found by the index with a brute force search
+// on the points which are still in the index
+int CheckQueries(const VoxelHashKNN& index, const pcl::PointCloud<PointXYZTIId>& cloud,
+                 const std::vector<int>& indices, std::mt19937& generator)
+{
+  std::uniform_real_distribution<double> coordinate(-40.0, 40.0);
+  const int knearest = 10;
+  for (int q = 0; q < 200; ++q)
+  {
+    const PointXYZTIId query = MakePoint(coordinate(generator), coordinate(generator), coordinate(generator) / 10.0);
+    std::vector<double> expected;
+    for (int i : indices)
+    {
+      expected.push_back(SquaredDistance(cloud.points[i], query));
+    }
+    std::sort(expected.begin(), expected.end());
+
+    std::vector<int> nearestIndex(knearest, -1);
+    std::vector<double> nearestDist(knearest, -1.0);
+    index.query(query, knearest, nearestIndex.data(), nearestDist.data());
+    for (int k = 0; k < knearest; ++k)
+    {
+      if (Check(nearestIndex[k] >= 0, "missing neighbor") ||
+          Check(std::abs(nearestDist[k] - expected[k]) < 1e-9, "wrong neighbor distance") ||
+          Check(std::abs(SquaredDistance(cloud.points[nearestIndex[k]], query) - nearestDist[k]) < 1e-9,
+                "neighbor index does not match its distance"))
+      {
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> coordinate(-30.0, 30.0);
+
+  VoxelHashKNN index(1.5);
+  pcl::PointCloud<PointXYZTIId> points;
+  for (int i = 0; i < 5000; ++i)
+  {
+    points.push_back(MakePoint(coordinate(generator), coordinate(generator), coordinate(generator) / 10.0));
+  }
+  std::vector<int> indices;
+  index.Insert(points, indices);
+  int errors = Check(index.GetNumberOfPoints() == 5000, "wrong number of inserted points");
+  errors += CheckQueries(index, *index.getInputCloud(), indices, generator);
+
+  // Remove some points, then insert new ones in their slots
+  std::vector<int> removed(indices.begin(), indices.begin() + 2000);
+  index.Remove(removed);
+  std::vector<int> remaining(indices.begin() + 2000, indices.end());
+  errors += Check(index.GetNumberOfPoints() == 3000, "wrong number of points after removal");
+  errors += CheckQueries(index, *index.getInputCloud(), remaining, generator);
+
+  pcl::PointCloud<PointXYZTIId> newPoints;
+  for (int i = 0; i < 500; ++i)
+  {
+    newPoints.push_back(MakePoint(3.0 * coordinate(generator), coordinate(generator), 0.0));
+  }
+  std::vector<int> newIndices;
+  index.Insert(newPoints, newIndices);
+  errors += Check(index.getInputCloud()->size() == 5000, "the removed slots are not reused");
+  remaining.insert(remaining.end(), newIndices.begin(), newIndices.end());
+  errors += CheckQueries(index, *index.getInputCloud(), remaining, generator);
+
+  // With less points than requested, the missing neighbors are left untouched
+  VoxelHashKNN sparseIndex(1.0);
+  pcl::PointCloud<PointXYZTIId> twoPoints;
+  twoPoints.push_back(MakePoint(0.0, 0.0, 0.0));
+  twoPoints.push_back(MakePoint(100.0, 0.0, 0.0));
+  sparseIndex.Insert(twoPoints, indices);
+  std::vector<int> nearestIndex(3, -1);
+  std::vector<double> nearestDist(3, -1.0);
+  sparseIndex.query(MakePoint(80.0, 0.0, 0.0), 3, nearestIndex.data(), nearestDist.data());
+  errors += Check(nearestIndex[0] == indices[1] && nearestIndex[1] == indices[0] && nearestIndex[2] == -1,
+                  "wrong neighbors in a sparse index");
+
+  return errors == 0 ? 0 : 1;
+}
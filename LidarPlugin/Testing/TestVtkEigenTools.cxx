@@ -1,5 +1,6 @@
 #include <iostream>
 #include <stdlib.h>
+#include <vector>
 
 #include "TestHelpers.h"
 #include "vtkEigenTools.h"
@@ -94,6 +95,100 @@ int TestGetSphericalCoordinates()
   return nbrErrors;
 }
 
+//-----------------------------------------------------------------------------
+int TestMultivariateMedian()
+{
+  int nbrErrors = 0;
+
+  // points spread around a center, with far outliers on one side
+  const Eigen::Vector3d center(1.0, -2.0, 3.0);
+  const int nbPoints = 20000;
+  std::vector<Eigen::VectorXd> X(nbPoints);
+  Eigen::Matrix3Xd contiguous(3, nbPoints);
+  for (int i = 0; i < nbPoints; ++i)
+  {
+    Eigen::Vector3d offset = Eigen::Vector3d::Random();
+    if (i % 10 == 0)
+    {
+      offset += Eigen::Vector3d(1000.0, 0.0, 0.0);
+    }
+    contiguous.col(i) = center + offset;
+    X[i] = contiguous.col(i);
+  }
+
+  const Eigen::VectorXd median = MultivariateMedian(X, 1e-6, 10000, 1);
+  const Eigen::Vector3d threadedMedian = MultivariateMedian(contiguous, 1e-6, 10000, 4);
+  if (median.size() != 3 || (median - threadedMedian).norm() > 1e-12)
+  {
+    nbrErrors++;
+  }
+  // the outliers only move the median by a fraction of the spread of the points
+  if ((threadedMedian - center).norm() > 0.3)
+  {
+    nbrErrors++;
+  }
+
+  // at the median, the unit vectors to the points cancel out
+  Eigen::Vector3d residual = Eigen::Vector3d::Zero();
+  for (int i = 0; i < nbPoints; ++i)
+  {
+    residual += (contiguous.col(i) - threadedMedian).normalized();
+  }
+  if (residual.norm() > 1e-3)
+  {
+    nbrErrors++;
+  }
+
+  // other dimensions and a single point
+  std::vector<Eigen::VectorXd> Y = { Eigen::Vector4d(0, 0, 0, 0), Eigen::Vector4d(1, 0, 0, 0),
+                                     Eigen::Vector4d(0, 1, 0, 0), Eigen::Vector4d(1, 1, 0, 0) };
+  if ((MultivariateMedian(Y) - Eigen::Vector4d(0.5, 0.5, 0, 0)).norm() > 1e-9)
+  {
+    nbrErrors++;
+  }
+  if ((MultivariateMedian(std::vector<Eigen::VectorXd>(1, Y[3])) - Y[3]).norm() > 0)
+  {
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestAvgRotation()
+{
+  int nbrErrors = 0;
+
+  // noisy rotations around a reference rotation, some given with the
+  // opposite quaternion
+  const Eigen::Matrix3d reference = RollPitchYawToMatrix(0.3, -0.2, 1.2);
+  const int nbRotations = 20000;
+  std::vector<Eigen::Matrix3d> rotations(nbRotations);
+  std::vector<Eigen::Quaterniond> quaternions(nbRotations);
+  for (int i = 0; i < nbRotations; ++i)
+  {
+    const Eigen::Vector3d noise = 0.05 * Eigen::Vector3d::Random();
+    rotations[i] = reference * RollPitchYawToMatrix(noise);
+    quaternions[i] = Eigen::Quaterniond(rotations[i]);
+    if (i % 2)
+    {
+      quaternions[i].coeffs() *= -1.0;
+    }
+  }
+
+  const Eigen::Matrix3d avg = AvgRotation(rotations, 1);
+  const Eigen::Matrix3d threadedAvg = AvgRotation(rotations, 4);
+  const Eigen::Matrix3d avgFromQuaternions = AvgUnitQuaternions(quaternions).normalized().toRotationMatrix();
+  if ((avg - threadedAvg).norm() > 1e-12 || (avg - avgFromQuaternions).norm() > 1e-9)
+  {
+    nbrErrors++;
+  }
+  if ((avg - reference).norm() > 1e-2)
+  {
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
 //-----------------------------------------------------------------------------
 int main()
 {
@@ -104,5 +199,7 @@ int main()
   int nbrErrors = 0;
   nbrErrors += TestSignedAngle();
   nbrErrors += TestGetSphericalCoordinates();
+  nbrErrors += TestMultivariateMedian();
+  nbrErrors += TestAvgRotation();
   return nbrErrors;
 }
@@ -0,0 +1,203 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+#include "vvExportJobQueue.h"
+
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+//-----------------------------------------------------------------------------
+class vvExportJobQueue::pqInternal
+{
+public:
+  struct QueuedJob
+  {
+    int Id;
+    QString Name;
+    Job Run;
+  };
+
+  mutable boost::mutex Mutex;
+  boost::condition_variable Condition;
+  std::deque<QueuedJob> Jobs;
+  //! Identifier of the job being run, -1 if none
+  int RunningJob = -1;
+  int NextId = 0;
+  bool Stop = false;
+  std::atomic<bool> CancelRunningJob{false};
+
+  //! Started with the first job
+  std::unique_ptr<boost::thread> Thread;
+};
+
+//-----------------------------------------------------------------------------
+vvExportJobQueue::vvExportJobQueue(QObject* p)
+  : QObject(p)
+{
+  this->Internal = new pqInternal;
+}
+
+//-----------------------------------------------------------------------------
+vvExportJobQueue::~vvExportJobQueue()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(this->Internal->Mutex);
+    this->Internal->Stop = true;
+    this->Internal->Jobs.clear();
+    this->Internal->CancelRunningJob = true;
+  }
+  this->Internal->Condition.notify_all();
+  if (this->Internal->Thread)
+  {
+    this->Internal->Thread->join();
+  }
+  delete this->Internal;
+}
+
+//-----------------------------------------------------------------------------
+int vvExportJobQueue::enqueue(const QString& name, const Job& job)
+{
+  int id;
+  {
+    boost::lock_guard<boost::mutex> lock(this->Internal->Mutex);
+    id = this->Internal->NextId++;
+    this->Internal->Jobs.push_back({ id, name, job });
+    if (!this->Internal->Thread)
+    {
+      this->Internal->Thread.reset(new boost::thread(&vvExportJobQueue::runJobs, this));
+    }
+  }
+  this->Internal->Condition.notify_all();
+  return id;
+}
+
+//-----------------------------------------------------------------------------
+int vvExportJobQueue::numberOfJobs() const
+{
+  boost::lock_guard<boost::mutex> lock(this->Internal->Mutex);
+  return static_cast<int>(this->Internal->Jobs.size()) + (this->Internal->RunningJob >= 0 ? 1 : 0);
+}
+
+//-----------------------------------------------------------------------------
+void vvExportJobQueue::waitForAllJobs()
+{
+  boost::unique_lock<boost::mutex> lock(this->Internal->Mutex);
+  this->Internal->Condition.wait(lock, [this]()
+    { return this->Internal->Jobs.empty() && this->Internal->RunningJob < 0; });
+}
+
+//-----------------------------------------------------------------------------
+void vvExportJobQueue::cancel(int id)
+{
+  bool isRemoved = false;
+  QString name;
+  {
+    boost::lock_guard<boost::mutex> lock(this->Internal->Mutex);
+    if (id == this->Internal->RunningJob)
+    {
+      this->Internal->CancelRunningJob = true;
+      return;
+    }
+    auto& jobs = this->Internal->Jobs;
+    for (auto it = jobs.begin(); it != jobs.end(); ++it)
+    {
+      if (it->Id == id)
+      {
+        name = it->Name;
+        jobs.erase(it);
+        isRemoved = true;
+        break;
+      }
+    }
+  }
+  if (isRemoved)
+  {
+    this->Internal->Condition.notify_all();
+    emit this->jobFinished(id, name, false);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vvExportJobQueue::cancelAll()
+{
+  std::deque<pqInternal::QueuedJob> removed;
+  {
+    boost::lock_guard<boost::mutex> lock(this->Internal->Mutex);
+    removed.swap(this->Internal->Jobs);
+    if (this->Internal->RunningJob >= 0)
+    {
+      this->Internal->CancelRunningJob = true;
+    }
+  }
+  this->Internal->Condition.notify_all();
+  for (const auto& job : removed)
+  {
+    emit this->jobFinished(job.Id, job.Name, false);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vvExportJobQueue::runJobs()
+{
+  while (true)
+  {
+    pqInternal::QueuedJob job;
+    {
+      boost::unique_lock<boost::mutex> lock(this->Internal->Mutex);
+      this->Internal->Condition.wait(lock, [this]()
+        { return this->Internal->Stop || !this->Internal->Jobs.empty(); });
+      if (this->Internal->Stop)
+      {
+        return;
+      }
+      job = this->Internal->Jobs.front();
+      this->Internal->Jobs.pop_front();
+      this->Internal->RunningJob = job.Id;
+      this->Internal->CancelRunningJob = false;
+    }
+
+    emit this->jobStarted(job.Id, job.Name);
+    bool isCompleted = false;
+    try
+    {
+      const int id = job.Id;
+      isCompleted = job.Run([this, id](double progress)
+        {
+          emit this->jobProgress(id, progress);
+          return !this->Internal->CancelRunningJob;
+        });
+    }
+    catch (const std::exception& e)
+    {
+      std::cerr << "Export \"" << job.Name.toStdString() << "\" failed: " << e.what() << std::endl;
+    }
+    isCompleted = isCompleted && !this->Internal->CancelRunningJob;
+
+    {
+      boost::lock_guard<boost::mutex> lock(this->Internal->Mutex);
+      this->Internal->RunningJob = -1;
+    }
+    this->Internal->Condition.notify_all();
+    emit this->jobFinished(job.Id, job.Name, isCompleted);
+  }
+}
@@ -0,0 +1,85 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+#ifndef __vvExportJobQueue_h
+#define __vvExportJobQueue_h
+
+#include <QObject>
+#include <QString>
+
+#include "vvConfigure.h"
+
+#include <functional>
+
+/**
+ * @brief vvExportJobQueue runs export jobs one after the other on a background thread,
+ * so that saving long frame ranges does not freeze the application.
+ *
+ * A job usually decodes its frames with several threads, see vtkLidarReader::DecodeFrames,
+ * and writes them on the background thread while the next ones are decoded. It must
+ * only use objects which are not used by the application meanwhile, such as a reader
+ * created with vtkLidarReader::NewExportInstance.
+ *
+ * The signals are emitted from the background thread, they are queued to the
+ * objects living in the main thread.
+ */
+class LidarPlugin_EXPORT vvExportJobQueue : public QObject
+{
+  Q_OBJECT
+public:
+  //! Receives the progress of a job, between 0 and 1, returns false if the job is canceled
+  typedef std::function<bool(double)> ProgressCallback;
+
+  //! Function run on the background thread, returns false if the job was canceled or failed
+  typedef std::function<bool(const ProgressCallback&)> Job;
+
+  vvExportJobQueue(QObject* p = 0);
+  //! Cancel the jobs and wait for the running one to stop
+  virtual ~vvExportJobQueue();
+
+  /**
+   * @brief enqueue add a job after the ones already queued
+   * @param name describes the job to the user
+   * @return the identifier of the job
+   */
+  int enqueue(const QString& name, const Job& job);
+
+  //! Number of jobs queued or running
+  int numberOfJobs() const;
+
+  //! Block until all the jobs are done
+  void waitForAllJobs();
+
+public slots:
+  //! Remove a queued job, or stop it if it is running
+  void cancel(int id);
+  void cancelAll();
+
+signals:
+  void jobStarted(int id, const QString& name);
+  void jobProgress(int id, double progress);
+  void jobFinished(int id, const QString& name, bool completed);
+
+private:
+  void runJobs();
+
+  class pqInternal;
+  pqInternal* Internal;
+
+  Q_DISABLE_COPY(vvExportJobQueue)
+};
+
+#endif
@@ -0,0 +1,145 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+#include "vvLevelOfDetailBehavior.h"
+
+#include <pqApplicationCore.h>
+#include <pqPipelineSource.h>
+#include <pqRenderView.h>
+#include <pqServerManagerModel.h>
+
+#include <vtkCamera.h>
+#include <vtkCommand.h>
+#include <vtkEventQtSlotConnect.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkRenderer.h>
+#include <vtkSMPropertyHelper.h>
+#include <vtkSMProxy.h>
+#include <vtkSMRenderViewProxy.h>
+
+#include <QMap>
+#include <QPointer>
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+//! Set the properties of all the PointCloudLevelOfDetail filters
+void SetLevelOfDetail(bool interactive, const double cameraPosition[3], double projectionScale)
+{
+  pqServerManagerModel* model = pqApplicationCore::instance()->getServerManagerModel();
+  foreach (pqPipelineSource* source, model->findItems<pqPipelineSource*>())
+  {
+    vtkSMProxy* proxy = source->getProxy();
+    if (std::strcmp(proxy->GetXMLName(), "PointCloudLevelOfDetail") != 0)
+    {
+      continue;
+    }
+    if (interactive)
+    {
+      vtkSMPropertyHelper(proxy, "CameraPosition").Set(cameraPosition, 3);
+      vtkSMPropertyHelper(proxy, "ProjectionScale").Set(projectionScale);
+    }
+    vtkSMPropertyHelper(proxy, "Interactive").Set(interactive ? 1 : 0);
+    proxy->UpdateVTKObjects();
+  }
+}
+}
+
+//-----------------------------------------------------------------------------
+class vvLevelOfDetailBehavior::pqInternal
+{
+public:
+  vtkNew<vtkEventQtSlotConnect> Connector;
+  //! Render view of each interactor
+  QMap<vtkObject*, QPointer<pqRenderView> > Views;
+};
+
+//-----------------------------------------------------------------------------
+vvLevelOfDetailBehavior::vvLevelOfDetailBehavior(QObject* p)
+  : QObject(p)
+{
+  this->Internal = new pqInternal;
+
+  pqServerManagerModel* model = pqApplicationCore::instance()->getServerManagerModel();
+  foreach (pqView* view, model->findItems<pqView*>())
+  {
+    this->onViewAdded(view);
+  }
+  this->connect(model, SIGNAL(viewAdded(pqView*)), SLOT(onViewAdded(pqView*)));
+}
+
+//-----------------------------------------------------------------------------
+vvLevelOfDetailBehavior::~vvLevelOfDetailBehavior()
+{
+  this->Internal->Connector->Disconnect();
+  delete this->Internal;
+}
+
+//-----------------------------------------------------------------------------
+void vvLevelOfDetailBehavior::onViewAdded(pqView* view)
+{
+  pqRenderView* renderView = qobject_cast<pqRenderView*>(view);
+  if (!renderView || !renderView->getRenderViewProxy()->GetInteractor())
+  {
+    return;
+  }
+  vtkObject* interactor = renderView->getRenderViewProxy()->GetInteractor();
+  this->Internal->Views[interactor] = renderView;
+  this->Internal->Connector->Connect(interactor, vtkCommand::StartInteractionEvent,
+    this, SLOT(onStartInteraction(vtkObject*)));
+  this->Internal->Connector->Connect(interactor, vtkCommand::EndInteractionEvent,
+    this, SLOT(onEndInteraction(vtkObject*)));
+}
+
+//-----------------------------------------------------------------------------
+void vvLevelOfDetailBehavior::onStartInteraction(vtkObject* interactor)
+{
+  pqRenderView* view = this->Internal->Views.value(interactor);
+  if (!view)
+  {
+    return;
+  }
+
+  // with a parallel projection the size on screen does not depend on the
+  // distance, only the maximum number of points is then applied
+  vtkSMRenderViewProxy* viewProxy = view->getRenderViewProxy();
+  vtkCamera* camera = viewProxy->GetActiveCamera();
+  double projectionScale = 0.0;
+  if (!camera->GetParallelProjection())
+  {
+    const int height = viewProxy->GetRenderer()->GetSize()[1];
+    projectionScale =
+      height / (2.0 * std::tan(vtkMath::RadiansFromDegrees(camera->GetViewAngle()) / 2.0));
+  }
+  SetLevelOfDetail(true, camera->GetPosition(), projectionScale);
+  // the pipeline is not updated by the interactive renders
+  view->forceRender();
+}
+
+//-----------------------------------------------------------------------------
+void vvLevelOfDetailBehavior::onEndInteraction(vtkObject* interactor)
+{
+  pqRenderView* view = this->Internal->Views.value(interactor);
+  if (!view)
+  {
+    return;
+  }
+  SetLevelOfDetail(false, nullptr, 0.0);
+  view->render();
+}
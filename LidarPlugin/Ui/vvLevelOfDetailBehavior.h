@@ -0,0 +1,55 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+#ifndef __vvLevelOfDetailBehavior_h
+#define __vvLevelOfDetailBehavior_h
+
+#include <QObject>
+
+#include "vvConfigure.h"
+
+class pqView;
+class vtkObject;
+
+/**
+ * @brief vvLevelOfDetailBehavior switches the PointCloudLevelOfDetail filters to
+ * their reduced output while the camera of a render view moves.
+ *
+ * When an interaction starts in a render view, the position of its camera and the
+ * size in pixels of 1 m at 1 m of it are given to every PointCloudLevelOfDetail
+ * filter, which then renders only the points visible at this distance. When the
+ * interaction ends, the filters render all their points again.
+ */
+class LidarPlugin_EXPORT vvLevelOfDetailBehavior : public QObject
+{
+  Q_OBJECT
+public:
+  vvLevelOfDetailBehavior(QObject* p = 0);
+  virtual ~vvLevelOfDetailBehavior();
+
+protected slots:
+  void onViewAdded(pqView* view);
+  void onStartInteraction(vtkObject* interactor);
+  void onEndInteraction(vtkObject* interactor);
+
+private:
+  class pqInternal;
+  pqInternal* Internal;
+
+  Q_DISABLE_COPY(vvLevelOfDetailBehavior)
+};
+
+#endif
@@ -0,0 +1,303 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+#include "vvPipelineProfilerWidget.h"
+
+#include "AllocationTracker.h"
+#include "PipelineProfiler.h"
+
+#include <pqApplicationCore.h>
+#include <pqPipelineSource.h>
+#include <pqServerManagerModel.h>
+#include <pqView.h>
+
+#include <vtkAlgorithm.h>
+#include <vtkSMProxy.h>
+
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QMap>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QTimer>
+#include <QVBoxLayout>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+//! Statistics of the samples of a source or a view
+struct SourceStatistics
+{
+  QString Name;
+  int NumberOfCalls = 0;
+  double TotalDuration = 0;
+  double MaximumDuration = 0;
+  PipelineProfiler::Sample Last;
+};
+
+enum Columns
+{
+  NAME = 0,
+  CALLS,
+  LAST_TIME,
+  MEAN_TIME,
+  MAX_TIME,
+  INPUT_POINTS,
+  OUTPUT_POINTS,
+  MEMORY_DELTA,
+  ALLOCATIONS,
+  ALLOCATED_BYTES,
+  NUMBER_OF_COLUMNS
+};
+
+//! Maximum number of samples kept for the trace, the oldest are forgotten first
+const size_t MaximumNumberOfSamples = 1000000;
+}
+
+//-----------------------------------------------------------------------------
+class vvPipelineProfilerWidget::pqInternal
+{
+public:
+  QPushButton* RecordButton;
+  QTableWidget* Table;
+  QLabel* Status;
+  QTimer Timer;
+
+  //! Statistics by sample id, in the order of the rows
+  QMap<int, SourceStatistics> Statistics;
+  std::vector<PipelineProfiler::Sample> Samples;
+  //! Watched algorithms of the sources, to unwatch them when the sources are deleted
+  QMap<pqPipelineSource*, vtkAlgorithm*> Algorithms;
+
+  void setItem(int row, int column, const QString& text)
+  {
+    QTableWidgetItem* item = this->Table->item(row, column);
+    if (!item)
+    {
+      item = new QTableWidgetItem;
+      item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+      if (column != NAME)
+      {
+        item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+      }
+      this->Table->setItem(row, column, item);
+    }
+    item->setText(text);
+  }
+
+  static QString points(long long numberOfPoints)
+  {
+    return numberOfPoints < 0 ? QString("-") : QString::number(numberOfPoints);
+  }
+};
+
+//-----------------------------------------------------------------------------
+vvPipelineProfilerWidget::vvPipelineProfilerWidget(QWidget* p)
+  : QWidget(p)
+{
+  this->Internal = new pqInternal;
+
+  this->Internal->RecordButton = new QPushButton("Record", this);
+  this->Internal->RecordButton->setCheckable(true);
+  QPushButton* resetButton = new QPushButton("Reset", this);
+  QPushButton* exportButton = new QPushButton("Export Trace...", this);
+  this->Internal->Status = new QLabel(this);
+
+  this->Internal->Table = new QTableWidget(0, NUMBER_OF_COLUMNS, this);
+  this->Internal->Table->setHorizontalHeaderLabels(QStringList() << "Source"
+                                                                 << "Calls"
+                                                                 << "Last (ms)"
+                                                                 << "Mean (ms)"
+                                                                 << "Max (ms)"
+                                                                 << "Input points"
+                                                                 << "Output points"
+                                                                 << "Memory delta (KiB)"
+                                                                 << "Allocations"
+                                                                 << "Allocated (KiB)");
+  // the allocations are only counted by the builds which track them
+  this->Internal->Table->setColumnHidden(ALLOCATIONS, !AllocationTracker::IsEnabled());
+  this->Internal->Table->setColumnHidden(ALLOCATED_BYTES, !AllocationTracker::IsEnabled());
+  this->Internal->Table->verticalHeader()->hide();
+  this->Internal->Table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+  this->Internal->Table->horizontalHeader()->setStretchLastSection(true);
+
+  QHBoxLayout* buttons = new QHBoxLayout;
+  buttons->addWidget(this->Internal->RecordButton);
+  buttons->addWidget(resetButton);
+  buttons->addWidget(exportButton);
+  buttons->addStretch();
+  buttons->addWidget(this->Internal->Status);
+  QVBoxLayout* layout = new QVBoxLayout(this);
+  layout->addLayout(buttons);
+  layout->addWidget(this->Internal->Table);
+
+  this->connect(this->Internal->RecordButton, SIGNAL(toggled(bool)), SLOT(onRecord(bool)));
+  this->connect(resetButton, SIGNAL(clicked()), SLOT(onReset()));
+  this->connect(exportButton, SIGNAL(clicked()), SLOT(onExportTrace()));
+  this->connect(&this->Internal->Timer, SIGNAL(timeout()), SLOT(onRefresh()));
+  this->Internal->Timer.setInterval(500);
+
+  // watch the sources and views which already exist and the ones to come
+  pqServerManagerModel* model = pqApplicationCore::instance()->getServerManagerModel();
+  foreach (pqPipelineSource* source, model->findItems<pqPipelineSource*>())
+  {
+    this->onSourceAdded(source);
+  }
+  foreach (pqView* view, model->findItems<pqView*>())
+  {
+    this->onViewAdded(view);
+  }
+  this->connect(model, SIGNAL(sourceAdded(pqPipelineSource*)), SLOT(onSourceAdded(pqPipelineSource*)));
+  this->connect(model, SIGNAL(preSourceRemoved(pqPipelineSource*)), SLOT(onSourceRemoved(pqPipelineSource*)));
+  this->connect(model, SIGNAL(viewAdded(pqView*)), SLOT(onViewAdded(pqView*)));
+}
+
+//-----------------------------------------------------------------------------
+vvPipelineProfilerWidget::~vvPipelineProfilerWidget()
+{
+  PipelineProfiler::GetInstance()->SetEnabled(false);
+  foreach (vtkAlgorithm* algorithm, this->Internal->Algorithms)
+  {
+    PipelineProfiler::GetInstance()->Unwatch(algorithm);
+  }
+  delete this->Internal;
+}
+
+//-----------------------------------------------------------------------------
+void vvPipelineProfilerWidget::onSourceAdded(pqPipelineSource* source)
+{
+  vtkAlgorithm* algorithm = vtkAlgorithm::SafeDownCast(source->getProxy()->GetClientSideObject());
+  if (algorithm)
+  {
+    const QString name = QString("%1 (%2)").arg(source->getSMName(), source->getProxy()->GetXMLName());
+    PipelineProfiler::GetInstance()->Watch(algorithm, name.toStdString());
+    this->Internal->Algorithms[source] = algorithm;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vvPipelineProfilerWidget::onSourceRemoved(pqPipelineSource* source)
+{
+  if (this->Internal->Algorithms.contains(source))
+  {
+    PipelineProfiler::GetInstance()->Unwatch(this->Internal->Algorithms.take(source));
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vvPipelineProfilerWidget::onViewAdded(pqView* view)
+{
+  const int id = PipelineProfiler::GetInstance()->Register(
+    QString("Render %1").arg(view->getSMName()).toStdString());
+  QObject::connect(view, &pqView::beginRender, this, [id]() { PipelineProfiler::GetInstance()->Begin(id); });
+  QObject::connect(view, &pqView::endRender, this, [id]() { PipelineProfiler::GetInstance()->End(id); });
+}
+
+//-----------------------------------------------------------------------------
+void vvPipelineProfilerWidget::onRecord(bool record)
+{
+  PipelineProfiler::GetInstance()->SetEnabled(record);
+  if (record)
+  {
+    this->Internal->Timer.start();
+  }
+  else
+  {
+    this->Internal->Timer.stop();
+    this->onRefresh();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vvPipelineProfilerWidget::onReset()
+{
+  PipelineProfiler::GetInstance()->TakeSamples();
+  this->Internal->Samples.clear();
+  this->Internal->Statistics.clear();
+  this->Internal->Table->setRowCount(0);
+  this->Internal->Status->clear();
+}
+
+//-----------------------------------------------------------------------------
+void vvPipelineProfilerWidget::onRefresh()
+{
+  PipelineProfiler* profiler = PipelineProfiler::GetInstance();
+  const std::vector<PipelineProfiler::Sample> samples = profiler->TakeSamples();
+  for (const PipelineProfiler::Sample& sample : samples)
+  {
+    SourceStatistics& statistics = this->Internal->Statistics[sample.Id];
+    if (statistics.NumberOfCalls == 0)
+    {
+      statistics.Name = QString::fromStdString(profiler->GetName(sample.Id));
+    }
+    statistics.NumberOfCalls++;
+    statistics.TotalDuration += sample.Duration;
+    statistics.MaximumDuration = std::max(statistics.MaximumDuration, sample.Duration);
+    statistics.Last = sample;
+  }
+
+  std::vector<PipelineProfiler::Sample>& kept = this->Internal->Samples;
+  kept.insert(kept.end(), samples.begin(), samples.end());
+  if (kept.size() > MaximumNumberOfSamples)
+  {
+    kept.erase(kept.begin(), kept.begin() + (kept.size() - MaximumNumberOfSamples));
+  }
+
+  // durations are recorded in microseconds
+  this->Internal->Table->setRowCount(this->Internal->Statistics.size());
+  int row = 0;
+  foreach (const SourceStatistics& statistics, this->Internal->Statistics)
+  {
+    this->Internal->setItem(row, NAME, statistics.Name);
+    this->Internal->setItem(row, CALLS, QString::number(statistics.NumberOfCalls));
+    this->Internal->setItem(row, LAST_TIME, QString::number(1e-3 * statistics.Last.Duration, 'f', 2));
+    this->Internal->setItem(row, MEAN_TIME,
+      QString::number(1e-3 * statistics.TotalDuration / statistics.NumberOfCalls, 'f', 2));
+    this->Internal->setItem(row, MAX_TIME, QString::number(1e-3 * statistics.MaximumDuration, 'f', 2));
+    this->Internal->setItem(row, INPUT_POINTS, pqInternal::points(statistics.Last.NumberOfInputPoints));
+    this->Internal->setItem(row, OUTPUT_POINTS, pqInternal::points(statistics.Last.NumberOfOutputPoints));
+    this->Internal->setItem(row, MEMORY_DELTA, QString::number(statistics.Last.MemoryDelta));
+    this->Internal->setItem(row, ALLOCATIONS, QString::number(statistics.Last.NumberOfAllocations));
+    this->Internal->setItem(row, ALLOCATED_BYTES,
+      QString::number(statistics.Last.AllocatedBytes / 1024.0, 'f', 1));
+    ++row;
+  }
+
+  this->Internal->Status->setText(QString("%1 samples, %2 dropped")
+                                    .arg(kept.size())
+                                    .arg(profiler->GetNumberOfDroppedSamples()));
+}
+
+//-----------------------------------------------------------------------------
+void vvPipelineProfilerWidget::onExportTrace()
+{
+  this->onRefresh();
+  const QString filename = QFileDialog::getSaveFileName(
+    this, "Export Chrome Trace", QString(), "Chrome Trace (*.json)");
+  if (filename.isEmpty())
+  {
+    return;
+  }
+  if (!PipelineProfiler::GetInstance()->WriteChromeTrace(filename.toStdString(), this->Internal->Samples))
+  {
+    QMessageBox::warning(this, "Export Chrome Trace", "Could not write " + filename);
+  }
+}
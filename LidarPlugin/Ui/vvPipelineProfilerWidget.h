@@ -0,0 +1,61 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+#ifndef __vvPipelineProfilerWidget_h
+#define __vvPipelineProfilerWidget_h
+
+#include <QWidget>
+
+#include "vvConfigure.h"
+
+class pqPipelineSource;
+class pqView;
+
+/**
+ * @brief vvPipelineProfilerWidget shows the time spent by each source and filter of
+ * the pipeline, and by each render of the views, as recorded by PipelineProfiler.
+ *
+ * The sources are watched as soon as they are created. While recording, the table is
+ * refreshed twice per second with, for each source, its number of executions, its last,
+ * mean and maximum wall time, its last number of input and output points and its last
+ * memory delta. The samples can be exported as a Chrome trace.
+ */
+class LidarPlugin_EXPORT vvPipelineProfilerWidget : public QWidget
+{
+  Q_OBJECT
+public:
+  vvPipelineProfilerWidget(QWidget* p = 0);
+  virtual ~vvPipelineProfilerWidget();
+
+public slots:
+  void onRecord(bool record);
+  void onReset();
+  void onExportTrace();
+
+protected slots:
+  void onSourceAdded(pqPipelineSource* source);
+  void onSourceRemoved(pqPipelineSource* source);
+  void onViewAdded(pqView* view);
+  void onRefresh();
+
+private:
+  class pqInternal;
+  pqInternal* Internal;
+
+  Q_DISABLE_COPY(vvPipelineProfilerWidget)
+};
+
+#endif
@@ -0,0 +1,270 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+#include "vvPointTableModel.h"
+
+#include <vtkAbstractArray.h>
+#include <vtkDataArray.h>
+#include <vtkDataSet.h>
+#include <vtkPointData.h>
+#include <vtkPointSet.h>
+#include <vtkPoints.h>
+#include <vtkSmartPointer.h>
+#include <vtkVariant.h>
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+//! Format the value at an index of an array, with a precision for the floating point values
+typedef QString (*Formatter)(vtkAbstractArray* array, vtkIdType index, int precision);
+
+template <typename T>
+QString FormatInteger(vtkAbstractArray* array, vtkIdType index, int)
+{
+  const T value = static_cast<const T*>(array->GetVoidPointer(0))[index];
+  return std::is_signed<T>::value ? QString::number(static_cast<qlonglong>(value))
+                                  : QString::number(static_cast<qulonglong>(value));
+}
+
+template <typename T>
+QString FormatReal(vtkAbstractArray* array, vtkIdType index, int precision)
+{
+  const T value = static_cast<const T*>(array->GetVoidPointer(0))[index];
+  return QString::number(static_cast<double>(value), 'f', precision);
+}
+
+QString FormatVariant(vtkAbstractArray* array, vtkIdType index, int)
+{
+  return QString::fromStdString(array->GetVariantValue(index).ToString());
+}
+
+template <typename T>
+Formatter GetFormatter(T*)
+{
+  return std::is_floating_point<T>::value ? &FormatReal<T> : &FormatInteger<T>;
+}
+
+//! A component of an array of the point data, or a coordinate of the points
+struct Column
+{
+  QString Name;
+  vtkAbstractArray* Array = nullptr;
+  int Component = 0;
+  Formatter Format = nullptr;
+  bool IsNumeric = false;
+
+  bool operator==(const Column& other) const
+  {
+    return this->Name == other.Name && this->Component == other.Component
+           && this->Format == other.Format;
+  }
+};
+
+//-----------------------------------------------------------------------------
+void AddColumns(vtkAbstractArray* array, const QString& name, std::vector<Column>& columns,
+                const QStringList& componentNames = QStringList())
+{
+  Column column;
+  column.Array = array;
+  column.IsNumeric = vtkDataArray::SafeDownCast(array) != nullptr;
+  switch (array->GetDataType())
+  {
+    vtkTemplateMacro(column.Format = GetFormatter(static_cast<VTK_TT*>(nullptr)));
+    default:
+      column.Format = &FormatVariant;
+  }
+  // the values are read straight from the memory of the numeric arrays
+  if (column.IsNumeric && !array->HasStandardMemoryLayout())
+  {
+    column.Format = &FormatVariant;
+  }
+  const int numberOfComponents = array->GetNumberOfComponents();
+  for (int i = 0; i < numberOfComponents; ++i)
+  {
+    column.Component = i;
+    column.Name = numberOfComponents == 1 ? name
+      : i < componentNames.size() ? componentNames[i] : QString("%1_%2").arg(name).arg(i);
+    columns.push_back(column);
+  }
+}
+}
+
+//-----------------------------------------------------------------------------
+class vvPointTableModel::pqInternal
+{
+public:
+  //! Shallow copy of the dataset shown, which keeps its arrays alive
+  vtkSmartPointer<vtkDataSet> DataSet;
+  std::vector<Column> Columns;
+  int NumberOfRows = 0;
+  int Precision = 3;
+};
+
+//-----------------------------------------------------------------------------
+vvPointTableModel::vvPointTableModel(QObject* p)
+  : QAbstractTableModel(p)
+{
+  this->Internal = new pqInternal;
+}
+
+//-----------------------------------------------------------------------------
+vvPointTableModel::~vvPointTableModel()
+{
+  delete this->Internal;
+}
+
+//-----------------------------------------------------------------------------
+void vvPointTableModel::setDataSet(vtkDataSet* dataSet)
+{
+  vtkSmartPointer<vtkDataSet> copy;
+  std::vector<Column> columns;
+  int numberOfRows = 0;
+  if (dataSet)
+  {
+    copy.TakeReference(dataSet->NewInstance());
+    copy->ShallowCopy(dataSet);
+    vtkPointSet* pointSet = vtkPointSet::SafeDownCast(copy);
+    if (pointSet && pointSet->GetPoints())
+    {
+      AddColumns(pointSet->GetPoints()->GetData(), "Points", columns, QStringList() << "X" << "Y" << "Z");
+    }
+    vtkPointData* pointData = copy->GetPointData();
+    for (int i = 0; i < pointData->GetNumberOfArrays(); ++i)
+    {
+      vtkAbstractArray* array = pointData->GetAbstractArray(i);
+      if (array && array->GetName())
+      {
+        AddColumns(array, array->GetName(), columns);
+      }
+    }
+    numberOfRows = static_cast<int>(copy->GetNumberOfPoints());
+  }
+
+  // a new set of columns resets the view, otherwise only the rows are updated
+  if (columns != this->Internal->Columns)
+  {
+    this->beginResetModel();
+    this->Internal->DataSet = copy;
+    this->Internal->Columns = columns;
+    this->Internal->NumberOfRows = numberOfRows;
+    this->endResetModel();
+    return;
+  }
+
+  const int previousNumberOfRows = this->Internal->NumberOfRows;
+  if (numberOfRows > previousNumberOfRows)
+  {
+    this->beginInsertRows(QModelIndex(), previousNumberOfRows, numberOfRows - 1);
+  }
+  else if (numberOfRows < previousNumberOfRows)
+  {
+    this->beginRemoveRows(QModelIndex(), numberOfRows, previousNumberOfRows - 1);
+  }
+  this->Internal->DataSet = copy;
+  this->Internal->Columns = columns;
+  this->Internal->NumberOfRows = numberOfRows;
+  if (numberOfRows > previousNumberOfRows)
+  {
+    this->endInsertRows();
+  }
+  else if (numberOfRows < previousNumberOfRows)
+  {
+    this->endRemoveRows();
+  }
+
+  // the view only fetches again the cells it shows
+  const int numberOfUpdatedRows = std::min(numberOfRows, previousNumberOfRows);
+  if (numberOfUpdatedRows > 0 && !columns.empty())
+  {
+    emit this->dataChanged(this->index(0, 0),
+                           this->index(numberOfUpdatedRows - 1, static_cast<int>(columns.size()) - 1));
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vvPointTableModel::setPrecision(int precision)
+{
+  if (precision != this->Internal->Precision)
+  {
+    this->Internal->Precision = precision;
+    if (this->Internal->NumberOfRows > 0 && !this->Internal->Columns.empty())
+    {
+      emit this->dataChanged(this->index(0, 0), this->index(this->Internal->NumberOfRows - 1,
+                                                 static_cast<int>(this->Internal->Columns.size()) - 1));
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vvPointTableModel::precision() const
+{
+  return this->Internal->Precision;
+}
+
+//-----------------------------------------------------------------------------
+int vvPointTableModel::rowCount(const QModelIndex& parent) const
+{
+  return parent.isValid() ? 0 : this->Internal->NumberOfRows;
+}
+
+//-----------------------------------------------------------------------------
+int vvPointTableModel::columnCount(const QModelIndex& parent) const
+{
+  return parent.isValid() ? 0 : static_cast<int>(this->Internal->Columns.size());
+}
+
+//-----------------------------------------------------------------------------
+QVariant vvPointTableModel::data(const QModelIndex& index, int role) const
+{
+  if (!index.isValid() || index.row() >= this->Internal->NumberOfRows
+      || index.column() >= static_cast<int>(this->Internal->Columns.size()))
+  {
+    return QVariant();
+  }
+  const Column& column = this->Internal->Columns[index.column()];
+  if (role == Qt::DisplayRole)
+  {
+    const vtkIdType valueIndex =
+      static_cast<vtkIdType>(index.row()) * column.Array->GetNumberOfComponents() + column.Component;
+    return column.Format(column.Array, valueIndex, this->Internal->Precision);
+  }
+  if (role == Qt::TextAlignmentRole && column.IsNumeric)
+  {
+    return static_cast<int>(Qt::AlignRight | Qt::AlignVCenter);
+  }
+  return QVariant();
+}
+
+//-----------------------------------------------------------------------------
+QVariant vvPointTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if (role != Qt::DisplayRole)
+  {
+    return QVariant();
+  }
+  if (orientation == Qt::Vertical)
+  {
+    return section;
+  }
+  if (section < static_cast<int>(this->Internal->Columns.size()))
+  {
+    return this->Internal->Columns[section].Name;
+  }
+  return QVariant();
+}
@@ -0,0 +1,65 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+#ifndef __vvPointTableModel_h
+#define __vvPointTableModel_h
+
+#include <QAbstractTableModel>
+
+#include "vvConfigure.h"
+
+class vtkDataSet;
+
+/**
+ * @brief vvPointTableModel presents the points of a dataset as a table, a row per point
+ * and a column per coordinate and per component of the point data arrays.
+ *
+ * Nothing is fetched nor formatted in advance: the values are read from the arrays
+ * when the view asks for them, that is only for the visible rows. Each column gets a
+ * formatter for the type of its array when the dataset is set, so that the integers
+ * are printed as such and the floating point values with a fixed precision.
+ *
+ * The dataset is shallow copied, so that its arrays stay valid while the pipeline
+ * produces the next frames. When a dataset with the same columns is set, the rows
+ * are only updated, so that the view keeps its scroll position and selection.
+ */
+class LidarPlugin_EXPORT vvPointTableModel : public QAbstractTableModel
+{
+  Q_OBJECT
+public:
+  vvPointTableModel(QObject* p = 0);
+  virtual ~vvPointTableModel();
+
+  //! Show the points of a dataset, nullptr to clear the table
+  void setDataSet(vtkDataSet* dataSet);
+
+  //! Number of decimals of the floating point values
+  void setPrecision(int precision);
+  int precision() const;
+
+  int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+  QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+  class pqInternal;
+  pqInternal* Internal;
+
+  Q_DISABLE_COPY(vvPointTableModel)
+};
+
+#endif
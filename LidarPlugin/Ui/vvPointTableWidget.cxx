@@ -0,0 +1,185 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+#include "vvPointTableWidget.h"
+
+#include "vvPointTableModel.h"
+
+#include <pqActiveObjects.h>
+#include <pqPipelineSource.h>
+
+#include <vtkAlgorithm.h>
+#include <vtkDataSet.h>
+#include <vtkSMProxy.h>
+
+#include <QElapsedTimer>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPointer>
+#include <QSpinBox>
+#include <QTableView>
+#include <QTimer>
+#include <QVBoxLayout>
+
+#include <algorithm>
+
+//-----------------------------------------------------------------------------
+class vvPointTableWidget::pqInternal
+{
+public:
+  vvPointTableModel* Model;
+  QTableView* Table;
+  QLabel* Status;
+
+  QPointer<pqPipelineSource> Source;
+  //! True if the source has been updated since the last refresh
+  bool IsDirty = true;
+  QTimer Timer;
+  QElapsedTimer LastRefresh;
+  int RefreshInterval = 500;
+};
+
+//-----------------------------------------------------------------------------
+vvPointTableWidget::vvPointTableWidget(QWidget* p)
+  : QWidget(p)
+{
+  this->Internal = new pqInternal;
+
+  this->Internal->Model = new vvPointTableModel(this);
+  this->Internal->Table = new QTableView(this);
+  this->Internal->Table->setModel(this->Internal->Model);
+  this->Internal->Table->setWordWrap(false);
+  this->Internal->Table->setSelectionBehavior(QAbstractItemView::SelectRows);
+  // sizing the rows or the columns to their contents would format all the values
+  this->Internal->Table->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+  this->Internal->Table->verticalHeader()->setDefaultSectionSize(
+    this->Internal->Table->fontMetrics().height() + 4);
+  this->Internal->Table->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+
+  QSpinBox* precision = new QSpinBox(this);
+  precision->setRange(0, 12);
+  precision->setValue(this->Internal->Model->precision());
+  precision->setPrefix("Precision: ");
+  this->Internal->Status = new QLabel(this);
+
+  QHBoxLayout* controls = new QHBoxLayout;
+  controls->addWidget(this->Internal->Status);
+  controls->addStretch();
+  controls->addWidget(precision);
+  QVBoxLayout* layout = new QVBoxLayout(this);
+  layout->addLayout(controls);
+  layout->addWidget(this->Internal->Table);
+
+  QObject::connect(precision, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+                   this->Internal->Model, &vvPointTableModel::setPrecision);
+  this->Internal->Timer.setSingleShot(true);
+  this->connect(&this->Internal->Timer, SIGNAL(timeout()), SLOT(onRefresh()));
+  this->Internal->LastRefresh.start();
+
+  this->connect(&pqActiveObjects::instance(), SIGNAL(sourceChanged(pqPipelineSource*)),
+                SLOT(onSourceChanged(pqPipelineSource*)));
+  this->onSourceChanged(pqActiveObjects::instance().activeSource());
+}
+
+//-----------------------------------------------------------------------------
+vvPointTableWidget::~vvPointTableWidget()
+{
+  delete this->Internal;
+}
+
+//-----------------------------------------------------------------------------
+void vvPointTableWidget::setRefreshInterval(int milliseconds)
+{
+  this->Internal->RefreshInterval = std::max(0, milliseconds);
+}
+
+//-----------------------------------------------------------------------------
+void vvPointTableWidget::onSourceChanged(pqPipelineSource* source)
+{
+  if (this->Internal->Source)
+  {
+    this->Internal->Source->disconnect(this);
+  }
+  this->Internal->Source = source;
+  if (source)
+  {
+    this->connect(source, SIGNAL(dataUpdated(pqPipelineSource*)), SLOT(onDataUpdated()));
+  }
+  // a new source is shown right away
+  this->Internal->IsDirty = true;
+  this->Internal->Timer.stop();
+  this->onRefresh();
+}
+
+//-----------------------------------------------------------------------------
+void vvPointTableWidget::onDataUpdated()
+{
+  this->Internal->IsDirty = true;
+  if (this->isVisible() && !this->Internal->Timer.isActive())
+  {
+    const qint64 elapsed = this->Internal->LastRefresh.elapsed();
+    this->Internal->Timer.start(
+      static_cast<int>(std::max<qint64>(0, this->Internal->RefreshInterval - elapsed)));
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vvPointTableWidget::onRefresh()
+{
+  if (!this->isVisible() || !this->Internal->IsDirty)
+  {
+    return;
+  }
+  this->Internal->IsDirty = false;
+  this->Internal->LastRefresh.restart();
+
+  // the output is the one of the client side object, as the session is builtin
+  vtkDataSet* dataSet = nullptr;
+  pqPipelineSource* source = this->Internal->Source;
+  vtkAlgorithm* algorithm =
+    source ? vtkAlgorithm::SafeDownCast(source->getProxy()->GetClientSideObject()) : nullptr;
+  if (algorithm && algorithm->GetNumberOfOutputPorts() > 0)
+  {
+    dataSet = vtkDataSet::SafeDownCast(algorithm->GetOutputDataObject(0));
+  }
+  this->Internal->Model->setDataSet(dataSet);
+
+  if (!source)
+  {
+    this->Internal->Status->setText("No active source");
+  }
+  else if (!dataSet)
+  {
+    this->Internal->Status->setText(source->getSMName() + ": no points");
+  }
+  else
+  {
+    this->Internal->Status->setText(
+      QString("%1: %2 points").arg(source->getSMName()).arg(dataSet->GetNumberOfPoints()));
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vvPointTableWidget::showEvent(QShowEvent* event)
+{
+  this->QWidget::showEvent(event);
+  // the updates received while hidden are shown now
+  if (this->Internal->IsDirty && !this->Internal->Timer.isActive())
+  {
+    this->Internal->Timer.start(0);
+  }
+}
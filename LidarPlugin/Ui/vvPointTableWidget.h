@@ -0,0 +1,60 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+#ifndef __vvPointTableWidget_h
+#define __vvPointTableWidget_h
+
+#include <QWidget>
+
+#include "vvConfigure.h"
+
+class pqPipelineSource;
+
+/**
+ * @brief vvPointTableWidget shows the points of the output of the active source in a
+ * vvPointTableModel, as a light alternative to the spreadsheet view for large frames.
+ *
+ * The output is read in the client process (builtin session), so that no data is
+ * delivered to a view. The table is refreshed when the source is updated, but at most
+ * once per refresh interval, so that it does not slow down the playback. It is not
+ * refreshed at all while it is hidden.
+ */
+class LidarPlugin_EXPORT vvPointTableWidget : public QWidget
+{
+  Q_OBJECT
+public:
+  vvPointTableWidget(QWidget* p = 0);
+  virtual ~vvPointTableWidget();
+
+  //! Minimum time between two refreshes of the table, in milliseconds
+  void setRefreshInterval(int milliseconds);
+
+protected slots:
+  void onSourceChanged(pqPipelineSource* source);
+  void onDataUpdated();
+  void onRefresh();
+
+protected:
+  void showEvent(QShowEvent* event) override;
+
+private:
+  class pqInternal;
+  pqInternal* Internal;
+
+  Q_DISABLE_COPY(vvPointTableWidget)
+};
+
+#endif
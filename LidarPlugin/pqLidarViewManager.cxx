@@ -14,8 +14,12 @@
 #include "pqLidarViewManager.h"
 
 #include "LASFileWriter.h"
+#include "MemoryBudget.h"
 #include "vtkPVConfig.h" //  needed for PARAVIEW_VERSION
 #include "vtkLidarReader.h"
+#include "Ui/vvLevelOfDetailBehavior.h"
+#include "Ui/vvPipelineProfilerWidget.h"
+#include "Ui/vvPointTableWidget.h"
 #include "vvPythonQtDecorators.h"
 
 #include <pqActiveObjects.h>
@@ -36,29 +40,94 @@
 #include <vtkSMSourceProxy.h>
 #include <vtkSMViewProxy.h>
 
+#include <vtkCallbackCommand.h>
+#include <vtkCommand.h>
 #include <vtkFieldData.h>
+#include <vtkNew.h>
 #include <vtkPointData.h>
 #include <vtkPythonInterpreter.h>
 #include <vtkTimerLog.h>
 
 #include <QApplication>
 #include <QDir>
+#include <QDockWidget>
+#include <QElapsedTimer>
 #include <QFileDialog>
 #include <QFileInfo>
+#include <QHBoxLayout>
 #include <QLabel>
 #include <QMainWindow>
 #include <QMessageBox>
 #include <QProcess>
+#include <QPointer>
+#include <QProgressBar>
 #include <QProgressDialog>
+#include <QStatusBar>
 #include <QTimer>
+#include <QToolButton>
 
+#include <algorithm>
+#include <cstdio>
 #include <sstream>
+#include <vector>
 
 //-----------------------------------------------------------------------------
 class pqLidarViewManager::pqInternal
 {
+public:
+  //! Created the first time they are shown
+  QPointer<QDockWidget> PipelineProfilerDock;
+  QPointer<QDockWidget> PointTableDock;
+
+  //! Frames saved in the background
+  vvExportJobQueue* ExportJobs = nullptr;
+  //! Progress of the running export, shown in the status bar while exporting
+  QPointer<QWidget> ExportStatus;
+  QPointer<QLabel> ExportLabel;
+  QPointer<QProgressBar> ExportProgress;
+  int RunningExport = -1;
 };
 
+namespace
+{
+//! Forward the progress of a reader saving frames, and abort it if the export is canceled
+void ForwardExportProgress(vtkObject* caller, unsigned long, void* clientData, void* callData)
+{
+  const auto& progress = *static_cast<const vvExportJobQueue::ProgressCallback*>(clientData);
+  if (!progress(*static_cast<double*>(callData)))
+  {
+    vtkAlgorithm::SafeDownCast(caller)->SetAbortExecute(1);
+  }
+}
+
+//! Print the duration of the steps of the startup, if LIDARVIEW_STARTUP_TIMING is set
+class StartupTimer
+{
+public:
+  StartupTimer()
+    : Enabled(qEnvironmentVariableIsSet("LIDARVIEW_STARTUP_TIMING"))
+  {
+    this->Timer.start();
+  }
+
+  void Step(const char* name)
+  {
+    if (this->Enabled)
+    {
+      const qint64 elapsed = this->Timer.restart();
+      this->Total += elapsed;
+      std::cout << "Startup: " << name << " " << elapsed << " ms (total " << this->Total << " ms)"
+                << std::endl;
+    }
+  }
+
+private:
+  const bool Enabled;
+  QElapsedTimer Timer;
+  qint64 Total = 0;
+};
+}
+
 //-----------------------------------------------------------------------------
 QPointer<pqLidarViewManager> pqLidarViewManagerInstance = NULL;
 
@@ -78,11 +147,15 @@ pqLidarViewManager::pqLidarViewManager(QObject* p)
   : QObject(p)
 {
   this->Internal = new pqInternal;
+  this->Internal->ExportJobs = new vvExportJobQueue(this);
 }
 
 //-----------------------------------------------------------------------------
 pqLidarViewManager::~pqLidarViewManager()
 {
+  // the running export is stopped before the widgets showing it are removed
+  delete this->Internal->ExportJobs;
+  delete this->Internal->ExportStatus;
   delete this->Internal;
 }
 
@@ -111,16 +184,23 @@ void pqLidarViewManager::pythonStartup()
     }
   }
 
+  // the duration of each step is printed if LIDARVIEW_STARTUP_TIMING is set
+  StartupTimer timer;
+
   vtkPythonInterpreter::RunSimpleString("import PythonQt");
   PythonQt::self()->addDecorators(new vvPythonQtDecorators());
+  timer.Step("import PythonQt");
   vtkPythonInterpreter::RunSimpleString("import lidarview");
+  timer.Step("import lidarview");
 
   this->runPython(QString(
       "import PythonQt\n"
       "QtGui = PythonQt.QtGui\n"
       "QtCore = PythonQt.QtCore\n"
-      "import lidarview.applogic as lv\n"
-      "lv.start()\n"));
+      "import lidarview.applogic as lv\n"));
+  timer.Step("import lidarview.applogic");
+  this->runPython(QString("lv.start()\n"));
+  timer.Step("lidarview.applogic.start");
 
   pqSettings* const settings = pqApplicationCore::instance()->settings();
   const QVariant& gridVisible =
@@ -156,6 +236,7 @@ void pqLidarViewManager::pythonStartup()
   }
 
   this->onMeasurementGrid(gridVisible.toBool());
+  timer.Step("main window state");
 
   bool showDialogAtStartup = false;
   if (showDialogAtStartup)
@@ -218,6 +299,38 @@ void pqLidarViewManager::onResetDefaultSettings()
   }
 }
 
+//-----------------------------------------------------------------------------
+void pqLidarViewManager::onShowPipelineProfiler()
+{
+  QMainWindow* const mainWindow = qobject_cast<QMainWindow*>(getMainWindow());
+  if (!this->Internal->PipelineProfilerDock)
+  {
+    QDockWidget* dock = new QDockWidget("Pipeline Profiler", mainWindow);
+    dock->setObjectName("pipelineProfilerDock");
+    dock->setWidget(new vvPipelineProfilerWidget(dock));
+    mainWindow->addDockWidget(Qt::BottomDockWidgetArea, dock);
+    this->Internal->PipelineProfilerDock = dock;
+  }
+  this->Internal->PipelineProfilerDock->show();
+  this->Internal->PipelineProfilerDock->raise();
+}
+
+//-----------------------------------------------------------------------------
+void pqLidarViewManager::onShowPointTable()
+{
+  QMainWindow* const mainWindow = qobject_cast<QMainWindow*>(getMainWindow());
+  if (!this->Internal->PointTableDock)
+  {
+    QDockWidget* dock = new QDockWidget("Point Table", mainWindow);
+    dock->setObjectName("pointTableDock");
+    dock->setWidget(new vvPointTableWidget(dock));
+    mainWindow->addDockWidget(Qt::BottomDockWidgetArea, dock);
+    this->Internal->PointTableDock = dock;
+  }
+  this->Internal->PointTableDock->show();
+  this->Internal->PointTableDock->raise();
+}
+
 //-----------------------------------------------------------------------------
 void pqLidarViewManager::saveFramesToPCAP(
   vtkSMSourceProxy* proxy, int startFrame, int endFrame, const QString& filename)
@@ -233,14 +346,30 @@ void pqLidarViewManager::saveFramesToPCAP(
     return;
   }
 
-  reader->Open();
-  reader->SaveFrame(startFrame, endFrame, filename.toLatin1().data());
-  reader->Close();
+  const std::string fileName = filename.toLatin1().data();
+  instance()->runExport(reader, QString("Exporting PCAP %1").arg(QFileInfo(filename).fileName()),
+    [startFrame, endFrame, fileName](vtkLidarReader* frameReader,
+                                     const vvExportJobQueue::ProgressCallback& progress)
+    {
+      vtkNew<vtkCallbackCommand> observer;
+      observer->SetCallback(ForwardExportProgress);
+      observer->SetClientData(const_cast<vvExportJobQueue::ProgressCallback*>(&progress));
+      const unsigned long tag = frameReader->AddObserver(vtkCommand::ProgressEvent, observer.GetPointer());
+      frameReader->SetAbortExecute(0);
+      frameReader->Open();
+      frameReader->SaveFrame(startFrame, endFrame, fileName);
+      frameReader->Close();
+      frameReader->RemoveObserver(tag);
+      const bool isCompleted = !frameReader->GetAbortExecute();
+      frameReader->SetAbortExecute(0);
+      return isCompleted;
+    });
 }
 
 //-----------------------------------------------------------------------------
 void pqLidarViewManager::saveFramesToLAS(vtkLidarReader* reader, vtkPolyData* position,
-  int startFrame, int endFrame, const QString& filename, int positionMode)
+  int startFrame, int endFrame, const QString& filename, int positionMode, int frameStride,
+  bool filePerFrame)
 {
   if (!reader || (positionMode > 0 && !position))
   {
@@ -313,51 +442,197 @@ void pqLidarViewManager::saveFramesToLAS(vtkLidarReader* reader, vtkPolyData* po
   std::cout << "origin : [" << northing << ";" << easting << ";" << height << "]" << std::endl;
   std::cout << "gcs : " << gcs << std::endl;
 
-  writer.SetPrecision(neTol, hTol);
-  writer.SetGeoConversionUTM(utmZone, isLatLon);
-  writer.SetOrigin(easting, northing, height);
-
-  QProgressDialog progress("Exporting LAS...", "Abort Export", startFrame,
-    startFrame + (endFrame - startFrame) * 2, getMainWindow());
-  progress.setWindowModality(Qt::WindowModal);
-
-  reader->Open();
-  for (int frame = startFrame; frame <= endFrame; ++frame)
+  const std::string fileName = qPrintable(filename);
+  const QFileInfo fileInfo(filename);
+  const std::string prefix = qPrintable(fileInfo.absolutePath() + "/" + fileInfo.completeBaseName());
+  const std::string extension = qPrintable("." + fileInfo.suffix());
+  const bool isCompressed = fileInfo.suffix().toLower() == "laz";
+  std::vector<int> frameNumbers;
+  for (int frame = startFrame; frame <= endFrame; frame += std::max(1, frameStride))
   {
-    progress.setValue(frame);
-
-    if (progress.wasCanceled())
+    frameNumbers.push_back(frame);
+  }
+  instance()->runExport(reader, QString("Exporting LAS %1").arg(fileInfo.fileName()),
+    [=](vtkLidarReader* frameReader, const vvExportJobQueue::ProgressCallback& progress)
     {
-      reader->Close();
-      return;
-    }
+      auto openWriter = [=](LASFileWriter& writer, const std::string& name)
+      {
+        writer.Open(name.c_str());
+        writer.SetPrecision(neTol, hTol);
+        writer.SetGeoConversionUTM(utmZone, isLatLon);
+        writer.SetOrigin(easting, northing, height);
+        writer.SetCompressed(isCompressed);
+      };
+      LASFileWriter writer;
+      if (!filePerFrame)
+      {
+        openWriter(writer, fileName);
+      }
 
-    const vtkSmartPointer<vtkPolyData>& data = reader->GetFrame(frame);
-    writer.UpdateMetaData(data.GetPointer());
-  }
+      // the frames are decoded in parallel and given in order to the thread of the
+      // export, which writes them while the next ones are decoded. The header of a
+      // file is completed by the writer once all its frames are written
+      size_t savedFrames = 0;
+      frameReader->Open();
+      const bool isCompleted = frameReader->DecodeFrames(frameNumbers,
+        [&](int frame, vtkPolyData* data)
+        {
+          if (filePerFrame)
+          {
+            char frameName[32];
+            std::snprintf(frameName, sizeof(frameName), " (Frame %04d)", frame);
+            LASFileWriter frameWriter;
+            openWriter(frameWriter, prefix + frameName + extension);
+            frameWriter.WriteFrame(data);
+            frameWriter.Close();
+          }
+          else
+          {
+            writer.WriteFrame(data);
+          }
+          return progress(static_cast<double>(++savedFrames) / frameNumbers.size());
+        });
+      if (!filePerFrame)
+      {
+        writer.Close();
+      }
+      frameReader->Close();
+      return isCompleted;
+    });
+}
 
-  writer.FlushMetaData();
+//-----------------------------------------------------------------------------
+void pqLidarViewManager::waitForExports()
+{
+  QApplication::setOverrideCursor(Qt::WaitCursor);
+  instance()->Internal->ExportJobs->waitForAllJobs();
+  QApplication::restoreOverrideCursor();
+}
 
-  for (int frame = startFrame; frame <= endFrame; ++frame)
+//-----------------------------------------------------------------------------
+void pqLidarViewManager::runExport(vtkLidarReader* reader, const QString& name,
+  const ExportFunction& exportFrames)
+{
+  vtkSmartPointer<vtkLidarReader> exportReader;
+  exportReader.TakeReference(reader->NewExportInstance());
+  if (exportReader)
   {
-    progress.setValue(endFrame + (frame - startFrame));
+    this->Internal->ExportJobs->enqueue(name,
+      [exportReader, exportFrames](const vvExportJobQueue::ProgressCallback& progress)
+      {
+        return exportFrames(exportReader, progress);
+      });
+    return;
+  }
 
-    if (progress.wasCanceled())
+  // the reader is used by the application, so the export blocks it
+  QProgressDialog progressDialog(name, "Abort Export", 0, 1000, getMainWindow());
+  progressDialog.setWindowModality(Qt::WindowModal);
+  exportFrames(reader, [&progressDialog](double progress)
     {
-      reader->Close();
-      return;
-    }
+      progressDialog.setValue(static_cast<int>(1000 * progress));
+      return !progressDialog.wasCanceled();
+    });
+}
 
-    const vtkSmartPointer<vtkPolyData>& data = reader->GetFrame(frame);
-    writer.WriteFrame(data.GetPointer());
+//-----------------------------------------------------------------------------
+void pqLidarViewManager::setupExportStatus()
+{
+  QMainWindow* const mainWindow = qobject_cast<QMainWindow*>(getMainWindow());
+  if (!mainWindow)
+  {
+    return;
   }
 
-  reader->Close();
+  QWidget* status = new QWidget(mainWindow);
+  QHBoxLayout* layout = new QHBoxLayout(status);
+  layout->setContentsMargins(0, 0, 0, 0);
+  QLabel* label = new QLabel(status);
+  QProgressBar* progressBar = new QProgressBar(status);
+  progressBar->setRange(0, 100);
+  progressBar->setMaximumWidth(150);
+  QToolButton* cancelButton = new QToolButton(status);
+  cancelButton->setText("Cancel");
+  cancelButton->setToolTip("Cancel the running export");
+  layout->addWidget(label);
+  layout->addWidget(progressBar);
+  layout->addWidget(cancelButton);
+  mainWindow->statusBar()->addPermanentWidget(status);
+  status->hide();
+  this->Internal->ExportStatus = status;
+  this->Internal->ExportLabel = label;
+  this->Internal->ExportProgress = progressBar;
+
+  vvExportJobQueue* jobs = this->Internal->ExportJobs;
+  pqInternal* internal = this->Internal;
+  QObject::connect(cancelButton, &QToolButton::clicked, jobs, [internal]()
+    {
+      internal->ExportJobs->cancel(internal->RunningExport);
+    });
+  QObject::connect(jobs, &vvExportJobQueue::jobStarted, status, [internal](int id, const QString& name)
+    {
+      internal->RunningExport = id;
+      const int nbQueued = internal->ExportJobs->numberOfJobs() - 1;
+      internal->ExportLabel->setText(nbQueued > 0 ? QString("%1 (%2 queued)").arg(name).arg(nbQueued) : name);
+      internal->ExportProgress->setValue(0);
+      internal->ExportStatus->show();
+    });
+  QObject::connect(jobs, &vvExportJobQueue::jobProgress, status, [internal](int id, double progress)
+    {
+      if (id == internal->RunningExport)
+      {
+        internal->ExportProgress->setValue(static_cast<int>(100 * progress));
+      }
+    });
+  QObject::connect(jobs, &vvExportJobQueue::jobFinished, status,
+    [internal, mainWindow](int id, const QString& name, bool completed)
+    {
+      mainWindow->statusBar()->showMessage(
+        QString("%1 %2").arg(name, completed ? "done" : "canceled"), 5000);
+      if (id == internal->RunningExport)
+      {
+        internal->RunningExport = -1;
+      }
+      if (internal->ExportJobs->numberOfJobs() == 0)
+      {
+        internal->ExportStatus->hide();
+      }
+    });
+}
+
+//-----------------------------------------------------------------------------
+void pqLidarViewManager::setupMemoryStatus()
+{
+  // limit in MiB, 0 for the default limit
+  pqSettings* const settings = pqApplicationCore::instance()->settings();
+  const unsigned long limit = settings->value("LidarPlugin/MemoryBudget/Limit", 0).toUInt();
+  MemoryBudget::GetInstance().SetLimit(limit << 10);
+
+  QMainWindow* const mainWindow = qobject_cast<QMainWindow*>(getMainWindow());
+  if (!mainWindow)
+  {
+    return;
+  }
+  QLabel* label = new QLabel(mainWindow);
+  mainWindow->statusBar()->addPermanentWidget(label);
+  QTimer* timer = new QTimer(label);
+  QObject::connect(timer, &QTimer::timeout, label, [label]()
+    {
+      MemoryBudget& budget = MemoryBudget::GetInstance();
+      const double size = budget.GetSize() / (1024. * 1024.);
+      const double limit = budget.GetLimit() / (1024. * 1024.);
+      label->setText(QString("Cache %1 / %2 GiB").arg(size, 0, 'f', 1).arg(limit, 0, 'f', 1));
+      label->setToolTip(QString::fromStdString(budget.GetSummary()));
+    });
+  timer->start(1000);
 }
 
 //-----------------------------------------------------------------------------
 void pqLidarViewManager::setup()
 {
+  new vvLevelOfDetailBehavior(this);
+  this->setupExportStatus();
+  this->setupMemoryStatus();
   QTimer::singleShot(0, this, SLOT(pythonStartup()));
 }
 
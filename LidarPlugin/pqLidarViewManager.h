@@ -18,6 +18,7 @@
 #include <QObject>
 
 #include "vvConfigure.h"
+#include "Ui/vvExportJobQueue.h"
 
 class vtkLidarReader;
 class vvAppLogic;
@@ -70,8 +71,16 @@ public:
   static void saveFramesToPCAP(
     vtkSMSourceProxy* proxy, int startFrame, int endFrame, const QString& filename);
 
+  /// Save the frames in a LAS file, or in a file per frame named
+  /// "<filename without extension> (Frame n).<extension>" if filePerFrame is set.
+  /// Only one frame every frameStride frames from startFrame is saved.
   static void saveFramesToLAS(vtkLidarReader* reader, vtkPolyData* position, int startFrame,
-    int endFrame, const QString& filename, int positionMode);
+    int endFrame, const QString& filename, int positionMode, int frameStride = 1,
+    bool filePerFrame = false);
+
+  /// Block until the frames being saved in the background are written,
+  /// for the scripts which use the files right after saving them.
+  static void waitForExports();
 
 public slots:
 
@@ -81,6 +90,8 @@ public slots:
   void onMeasurementGrid(bool gridVisible);
   void onEnableCrashAnalysis(bool crashAnalysisEnabled);
   void onResetDefaultSettings();
+  void onShowPipelineProfiler();
+  void onShowPointTable();
 
 signals:
 
@@ -89,6 +100,21 @@ signals:
 private:
   pqLidarViewManager(QObject* p);
 
+  /// Saves frames with the given reader, reporting its progress
+  typedef std::function<bool(vtkLidarReader*, const vvExportJobQueue::ProgressCallback&)>
+    ExportFunction;
+
+  /// Run an export in the background with a copy of the reader, see
+  /// vtkLidarReader::NewExportInstance, or with the reader itself and a modal
+  /// progress dialog if it can not be copied.
+  void runExport(vtkLidarReader* reader, const QString& name, const ExportFunction& exportFrames);
+
+  void setupExportStatus();
+
+  /// Show the memory used by the caches in the status bar, and set the limit
+  /// of the memory budget from the settings
+  void setupMemoryStatus();
+
   class pqInternal;
   pqInternal* Internal;
 
@@ -59,10 +59,9 @@ def GeometricMedian(X):
 def GetSelectedLandmark():
     # first, get the selected points
     src = lv.smp.GetActiveSource()
-    selection = src.GetSelectionOutput(0)
-    extractSelection = lv.smp.ExtractSelection(Input=src,Selection=selection.Selection)
-    extractSelection.UpdatePipeline()
-    cloud = extractSelection.GetClientSideObject().GetOutput().GetPoints()
+    extraction, isTemporary = lv.extractSelectedPoints(src)
+    extraction.UpdatePipeline()
+    cloud = extraction.GetClientSideObject().GetOutput().GetPoints()
 
     # then, get the camera position and compute
     # the distance to the camera center
@@ -99,6 +98,7 @@ def GetSelectedLandmark():
     sphere.Radius = 0.05
     lv.smp.Show(sphere)
     lv.smp.Render()
-    lv.smp.Delete(extractSelection)
+    if isTemporary:
+        lv.smp.Delete(extraction)
 
     return y
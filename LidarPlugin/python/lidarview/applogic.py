@@ -26,12 +26,11 @@ import PythonQt
 from PythonQt import QtCore, QtGui
 
 from vtkIOXMLPython import vtkXMLPolyDataWriter
-import kiwiviewerExporter
-import gridAdjustmentDialog
-import aboutDialog
-import planefit
 import bisect
 
+# kiwiviewerExporter, gridAdjustmentDialog, aboutDialog and planefit are imported
+# when they are first used, to shorten the startup
+
 from PythonQt.paraview import vvCalibrationDialog, vvCropReturnsDialog, vvSelectFramesDialog
 
 _repCache = {}
@@ -74,6 +73,7 @@ class AppLogic(object):
         self.sensor = None
 
         self.laserSelectionDialog = None
+        self.pointCloudSelector = None
 
         self.gridProperties = None
 
@@ -162,6 +162,7 @@ def openData(filename):
 
 
 def planeFit():
+    import planefit
     planefit.fitPlane()
 
 
@@ -424,10 +425,6 @@ def openSensor():
     onLaserSelection(False)
 
     rep = smp.Show(sensor)
-#    rep.InterpolateScalarsBeforeMapping = 0
-#    if app.sensor.GetClientSideObject().GetNumberOfChannels() == 128:
-#        rep.Representation = 'Point Cloud'
-#        rep.ColorArrayName = 'intensity'
 
     if SAMPLE_PROCESSING_MODE:
         prep = smp.Show(processor)
@@ -435,6 +432,7 @@ def openSensor():
 
     showSourceInSpreadSheet(sensor)
     colorByIntensity(sensor)
+    fastRendererChanged()
 
     app.actions['actionShowRPM'].enabled = True
     app.actions['actionCorrectIntensityValues'].enabled = True
@@ -575,6 +573,7 @@ def openPCAP(filename, positionFilename=None, calibrationFilename=None, calibrat
     smp.SetActiveView(app.mainView)
 
     colorByIntensity(app.trailingFrame)
+    fastRendererChanged()
 
     showSourceInSpreadSheet(reader)
 
@@ -740,15 +739,36 @@ def saveCSVCurrentFrame(filename):
     smp.Delete(w)
     rotateCSVFile(filename)
 
+def extractSelectedPoints(source):
+    '''
+    Returns a filter extracting the points of source selected in the views, and whether
+    this filter must be deleted once used. The frustum selections are extracted by a
+    PointCloudSelector kept from one selection to the next, which indexes each frame
+    once, the other selections by ExtractSelection.
+    '''
+    selection = source.GetSelectionOutput(0).Selection
+    if selection is not None and selection.GetXMLName() == 'FrustumSelectionSource' \
+       and not selection.InsideOut:
+        selector = app.pointCloudSelector
+        if selector is None or selector.Input != source:
+            # not registered, so that it does not appear in the pipeline browser
+            selector = servermanager.filters.PointCloudSelector(Input=source)
+            app.pointCloudSelector = selector
+        selector.Region = 'Frustum'
+        selector.Frustum = selection.Frustum
+        return selector, False
+    return smp.ExtractSelection(Input=source, Selection=selection), True
+
 def saveCSVCurrentFrameSelection(filename):
     source = getReader()
-    selection = source.GetSelectionOutput(0)
-    extractSelection = smp.ExtractSelection(Input = source, Selection = selection.Selection)
-    w = smp.CreateWriter(filename, extractSelection)
+    extraction, isTemporary = extractSelectedPoints(source)
+    w = smp.CreateWriter(filename, extraction)
     w.Precision = 16
     w.FieldAssociation = 'Points'
     w.UpdatePipeline()
     smp.Delete(w)
+    if isTemporary:
+        smp.Delete(extraction)
     rotateCSVFile(filename)
 
 # transform parameter indicates the coordinates system and
@@ -759,7 +779,10 @@ def saveCSVCurrentFrameSelection(filename):
 # - 2: Absolute Geoposition: NED base centered at the corresponding
 #      UTM zone, cartesian coordinate system
 # - 3: Absolute Geoposition Lat/Lon: Lat / Lon coordinate system
-def saveLASFrames(filename, first, last, transform = 0):
+# stride: only one frame every stride frames from first is saved
+# filePerFrame: save each frame in its own file, named after filename
+#               with the ' (Frame %04d)' suffix
+def saveLASFrames(filename, first, last, transform = 0, stride = 1, filePerFrame = False):
     reader = getReader().GetClientSideObject()
 
     # Check that we have a position provider
@@ -767,11 +790,11 @@ def saveLASFrames(filename, first, last, transform = 0):
         position = getPosition().GetClientSideObject().GetOutput()
 
         PythonQt.paraview.pqLidarViewManager.saveFramesToLAS(
-            reader, position, first, last, filename, transform)
+            reader, position, first, last, filename, transform, stride, filePerFrame)
 
     else:
         PythonQt.paraview.pqLidarViewManager.saveFramesToLAS(
-            reader, None, first, last, filename, transform)
+            reader, None, first, last, filename, transform, stride, filePerFrame)
 
 
 # transform parameter indicates the coordinates system and
@@ -787,6 +810,18 @@ def saveLASCurrentFrame(filename, transform = 0):
     saveLASFrames(filename, t, t, transform)
 
 
+# Save the decoded frames, so that they can be opened again
+# without decoding the packets with the Lidar Frame Archive Reader.
+# compressionLevel: 0 to store the arrays raw, up to 9 for the smallest file
+# positionTolerance: maximal error in meters on the coordinates of the points,
+#                    0 to store them exactly. With a tolerance, the points are
+#                    quantized and the order of the points of a frame is not kept
+# stride: only one frame every stride frames from first is saved
+def saveFrameArchive(filename, first, last, compressionLevel = 0, positionTolerance = 0., stride = 1):
+    reader = getReader().GetClientSideObject()
+    reader.SaveFramesToArchive(first, last, filename, compressionLevel, positionTolerance, stride)
+
+
 def saveAllFrames(filename, saveFunction):
     saveFunction(filename, getLidar.TimestepValues())
 
@@ -796,7 +831,58 @@ def saveFrameRange(filename, frameStart, frameStop, saveFunction):
     saveFunction(filename, timesteps)
 
 
+# Save the frames of the reader in csv files, one per frame, packed in a zip file.
+# The frames are decoded and formatted in parallel, without updating the pipeline.
+# compressionLevel: 0 for plain csv files, up to 9 for the smallest gzip files
+# stride: only one frame every stride frames from first is saved
+def saveCSVFrames(filename, first, last, compressionLevel = 0, stride = 1):
+    import kiwiviewerExporter
+    reader = getReader().GetClientSideObject()
+
+    tempDir = kiwiviewerExporter.tempfile.mkdtemp()
+    basenameWithoutExtension = os.path.splitext(os.path.basename(filename))[0]
+    outDir = os.path.join(tempDir, basenameWithoutExtension)
+    os.makedirs(outDir)
+
+    reader.SaveFramesToCSV(first, last, os.path.join(outDir, basenameWithoutExtension + '.csv'),
+                           compressionLevel, stride)
+
+    kiwiviewerExporter.zipDir(outDir, filename)
+    kiwiviewerExporter.shutil.rmtree(tempDir)
+
+
+# Save the raw signal images of the frames (range, intensity, x, y, z per laser
+# and azimuth bin) in a single float32 NPY file of shape
+# (frames, 5, lasers, width), which numpy.load can map in memory.
+# The frames are decoded in parallel, without updating the pipeline.
+# stride: only one frame every stride frames from first is saved
+def saveFrameTensors(filename, first, last, width = 1024, stride = 1):
+    reader = getReader().GetClientSideObject()
+    reader.SaveFramesToTensors(first, last, filename, width, stride)
+
+
+# Save the frames of the reader for a web viewer, packed in a zip file: a binary
+# file per frame, with the points quantized and split in tiles with levels of
+# detail, and a manifest.json listing the tiles for a progressive loading.
+# The frames are decoded and encoded in parallel, without updating the pipeline.
+# positionTolerance: maximal error in meters on the coordinates of the points
+# tileSize: size of the edges of the tiles, in meters
+# stride: only one frame every stride frames from first is saved
+def saveWebFrames(filename, first, last, positionTolerance = 0.005, tileSize = 16., stride = 1):
+    import kiwiviewerExporter
+    reader = getReader().GetClientSideObject()
+
+    tempDir = kiwiviewerExporter.tempfile.mkdtemp()
+    outDir = os.path.join(tempDir, os.path.splitext(os.path.basename(filename))[0])
+
+    reader.SaveFramesToWeb(first, last, outDir, positionTolerance, tileSize, stride)
+
+    kiwiviewerExporter.zipDir(outDir, filename)
+    kiwiviewerExporter.shutil.rmtree(tempDir)
+
+
 def saveCSV(filename, timesteps):
+    import kiwiviewerExporter
 
     tempDir = kiwiviewerExporter.tempfile.mkdtemp()
     basenameWithoutExtension = os.path.splitext(os.path.basename(filename))[0]
@@ -827,17 +913,21 @@ def saveCSV(filename, timesteps):
 # - 2: Absolute Geoposition: NED base centered at the corresponding
 #      UTM zone, cartesian coordinate system
 # - 3: Absolute Geoposition Lat/Lon: Lat / Lon coordinate system
-def saveLAS(filename, timesteps, transform = 0):
+# The frames are saved in a LAS file per frame, packed in a zip file, all
+# decoded in a single pass over the frames.
+def saveLAS(filename, first, last, transform = 0, stride = 1):
+    import kiwiviewerExporter
 
     tempDir = kiwiviewerExporter.tempfile.mkdtemp()
     basenameWithoutExtension = os.path.splitext(os.path.basename(filename))[0]
     outDir = os.path.join(tempDir, basenameWithoutExtension)
-    filenameTemplate = os.path.join(outDir, basenameWithoutExtension + ' (Frame %04d).csv')
     os.makedirs(outDir)
 
-    for t in sorted(timesteps):
-        saveLASFrames(filenameTemplate % t, t, t, transform)
+    saveLASFrames(os.path.join(outDir, basenameWithoutExtension + '.las'), first, last,
+                  transform, stride, True)
 
+    # the frames are saved in the background
+    PythonQt.paraview.pqLidarViewManager.waitForExports()
     kiwiviewerExporter.zipDir(outDir, filename)
     kiwiviewerExporter.shutil.rmtree(tempDir)
 
@@ -904,7 +994,7 @@ def getFrameSelectionFromUser(frameStrideVisibility=False, framePackVisibility=F
 
 def onSaveCSV():
 
-    frameOptions = getFrameSelectionFromUser()
+    frameOptions = getFrameSelectionFromUser(frameStrideVisibility=True)
     if frameOptions is None:
         return
 
@@ -925,12 +1015,16 @@ def onSaveCSV():
             oldTransform = transformMode()
             setTransformMode(1 if frameOptions.transform else 0)
 
-            if frameOptions.mode == vvSelectFramesDialog.ALL_FRAMES:
+            if getReader():
+                if frameOptions.mode == vvSelectFramesDialog.ALL_FRAMES:
+                    frameOptions.start = int(app.scene.StartTime)
+                    frameOptions.stop = int(app.scene.EndTime)
+                saveCSVFrames(fileName, frameOptions.start, frameOptions.stop,
+                              stride=frameOptions.stride)
+            elif frameOptions.mode == vvSelectFramesDialog.ALL_FRAMES:
                 saveAllFrames(fileName, saveCSV)
             else:
-                start = frameOptions.start
-                stop = frameOptions.stop
-                saveFrameRange(fileName, start, stop, saveCSV)
+                saveCSV(fileName, range(frameOptions.start, frameOptions.stop + 1, frameOptions.stride))
 
             setTransformMode(oldTransform)
 
@@ -943,7 +1037,8 @@ def onSavePosition():
 
 def onSaveLAS():
 
-    frameOptions = getFrameSelectionFromUser(framePackVisibility=True, frameTransformVisibility=False)
+    frameOptions = getFrameSelectionFromUser(frameStrideVisibility=True, framePackVisibility=True,
+                                             frameTransformVisibility=False)
     if frameOptions is None:
         return
 
@@ -970,15 +1065,8 @@ def onSaveLAS():
             oldTransform = transformMode()
             setTransformMode(1 if frameOptions.transform else 0)
 
-            def saveTransformedLAS(filename, timesteps):
-                saveLAS(filename, timesteps, frameOptions.transform)
-
-            if frameOptions.mode == vvSelectFramesDialog.ALL_FRAMES:
-                saveAllFrames(fileName, saveTransformedLAS)
-            else:
-                start = frameOptions.start
-                stop = frameOptions.stop
-                saveFrameRange(fileName, start, stop, saveTransformedLAS)
+            saveLAS(fileName, frameOptions.start, frameOptions.stop,
+                    frameOptions.transform, frameOptions.stride)
 
             setTransformMode(oldTransform)
 
@@ -993,7 +1081,7 @@ def onSaveLAS():
         setTransformMode(1 if frameOptions.transform else 0)
 
         saveLASFrames(fileName, frameOptions.start, frameOptions.stop,
-                      frameOptions.transform)
+                      frameOptions.transform, frameOptions.stride)
 
         setTransformMode(oldTransform)
 
@@ -1052,6 +1140,7 @@ def onKiwiViewerExport():
 
 
 def saveToKiwiViewer(filename, timesteps):
+    import kiwiviewerExporter
 
     tempDir = kiwiviewerExporter.tempfile.mkdtemp()
     outDir = os.path.join(tempDir, os.path.splitext(os.path.basename(filename))[0])
@@ -1118,6 +1207,7 @@ def onUserGuide():
             QtGui.QDesktopServices.openUrl(QtCore.QUrl('file:///%s' % filename, QtCore.QUrl.TolerantMode))
 
 def onAbout():
+    import aboutDialog
     aboutDialog.showDialog(getMainWindow())
 
 
@@ -1137,6 +1227,7 @@ def close():
     app.reader = None
     app.sensor = None
     app.trailingFrame = None
+    app.pointCloudSelector = None
     smp.Delete(app.grid)
 
     smp.HideUnusedScalarBars()
@@ -1260,6 +1351,7 @@ def unloadData():
     app.trailingFrame = None
     app.position = None
     app.sensor = None
+    app.pointCloudSelector = None
 
     clearSpreadSheetView()
 
@@ -1536,6 +1628,7 @@ def setupStatusBar():
 
 
 def onGridProperties():
+    import gridAdjustmentDialog
     if gridAdjustmentDialog.showDialog(getMainWindow(), app.grid, app.gridProperties):
         rep = smp.Show(app.grid, None)
         rep.LineWidth = app.grid.LineWidth
@@ -1823,17 +1916,18 @@ def geolocationChanged(setting):
     smp.Render(view=app.mainView)
 
 def fastRendererChanged():
-    """ Enable/Disable fast rendering by using the point cloud representation (currently only for VLS-128)
-    this representation hardcode the color map and their LookUpTable, which improve execution speed significantly """
+    """ Enable/Disable fast rendering by using the point cloud representation
+    this representation maps the colors on the GPU instead of building an array of colors
+    at each frame, and keeps the values of the colored array uploaded between the frames """
 
-    source = smp.FindSource("TrailingFrame")
-    if source:
-        rep = smp.GetRepresentation(source)
+    for source in [smp.FindSource("TrailingFrame"), getSensor()]:
+        if source:
+            rep = smp.GetRepresentation(source, view=app.mainView)
 
-        if app.actions['actionFastRenderer'].isChecked():
-            rep.Representation = 'Point Cloud'
-        else:
-            rep.Representation = 'Surface'
+            if app.actions['actionFastRenderer'].isChecked():
+                rep.Representation = 'Point Cloud'
+            else:
+                rep.Representation = 'Surface'
 
 def intensitiesCorrectedChanged():
     lidarInterpreter = getLidarPacketInterpreter()
@@ -0,0 +1,102 @@
+# Copyright 2019 Kitware, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""NumPy access to the frames of LidarView without copying them.
+
+The arrays are views of the memory of the VTK objects of the client, they are
+only valid as long as these objects are not modified, and keep them alive as
+long as they are referenced. In a client/server session, the data of the
+server is not on the client, use servermanager.Fetch there.
+
+    import lidarview.frames as frames
+    points = frames.getFrameArrays()['points']
+
+    for number, frame in frames.iterFrames(reader):
+        print number, frame['intensity'].mean()
+"""
+
+import numpy
+from vtk.util import numpy_support
+
+import LidarPluginPython as vvmod
+
+
+def _clientSideObject(proxyOrObject):
+    if hasattr(proxyOrObject, 'GetClientSideObject'):
+        return proxyOrObject.GetClientSideObject()
+    return proxyOrObject
+
+
+def frameArrays(polyData):
+    """Return a dictionary of NumPy views of the points (key 'points') and of
+       the point data arrays of a vtkPolyData"""
+    arrays = {}
+    if polyData is None:
+        return arrays
+    if polyData.GetPoints() is not None:
+        arrays['points'] = numpy_support.vtk_to_numpy(polyData.GetPoints().GetData())
+    pointData = polyData.GetPointData()
+    for i in range(pointData.GetNumberOfArrays()):
+        array = pointData.GetArray(i)
+        if array is not None and array.GetName():
+            arrays[array.GetName()] = numpy_support.vtk_to_numpy(array)
+    return arrays
+
+
+def getFrameArrays(source=None):
+    """Return the NumPy views of the current frame of a source, by default
+       the sensor or the reader of the application, see frameArrays"""
+    if source is None:
+        import applogic
+        return frameArrays(applogic.getPointCloudData())
+    return frameArrays(_clientSideObject(source).GetOutput())
+
+
+def _recordType(batch):
+    names, formats, offsets = [], [], []
+    for i in range(batch.GetNumberOfFields()):
+        dtype = numpy.dtype(numpy_support.get_numpy_array_type(batch.GetFieldDataType(i)))
+        components = batch.GetFieldNumberOfComponents(i)
+        names.append(batch.GetFieldName(i))
+        formats.append(dtype if components == 1 else (dtype, (components,)))
+        offsets.append(batch.GetFieldOffset(i))
+    return numpy.dtype({'names': names, 'formats': formats, 'offsets': offsets,
+                        'itemsize': batch.GetRecordSize()})
+
+
+def iterFrames(reader, start=0, stop=None, batchSize=16, numberOfThreads=0):
+    """Yield the frame number and the points of the frames [start, stop[ of a
+       lidar reader, as a NumPy structured array with the fields x, y, z and
+       one field per point data array.
+
+       The frames are decoded by batches of batchSize with several threads and
+       packed in a single buffer per batch, of which the arrays are views."""
+    reader = _clientSideObject(reader)
+    if stop is None:
+        stop = reader.GetNumberOfFrames()
+    batch = vvmod.vtkLidarFrameBatch()
+    batch.SetReader(reader)
+    try:
+        for first in range(start, stop, batchSize):
+            count = batch.Decode(first, min(batchSize, stop - first), numberOfThreads)
+            if count == 0:
+                return
+            dtype = _recordType(batch)
+            records = numpy_support.vtk_to_numpy(batch.GetRecords())
+            records = records.view(dtype) if records.size else numpy.empty(0, dtype)
+            offsets = numpy_support.vtk_to_numpy(batch.GetFrameOffsets())
+            for i in range(count):
+                yield batch.GetFrameNumber(i), records[offsets[i]:offsets[i + 1]]
+    finally:
+        batch.SetReader(None)
@@ -12,9 +12,8 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 
-import LidarPluginPython as vvmod
 import paraview.simple as smp
-from paraview import vtk
+from paraview import servermanager
 import math
 
 def GetSelectionSource(proxy=None):
@@ -38,61 +37,29 @@ def fitPlane():
     if not selection:
         return
 
-    extracter = smp.ExtractSelection()
-    extracter.Selection = selection
-    extracter.Input = src
-    smp.Show(extracter)
+    # The plane is fitted on the server, to the points read in place in the frame,
+    # only the table of the results is fetched
+    fitter = smp.SelectedPointsPlaneFitter(Input=src, Selection=selection)
 
     try:
-        pd = extracter.GetClientSideObject().GetOutput()
+        table = servermanager.Fetch(fitter)
+        columns = ['channel', 'originx', 'originy', 'originz', 'normalx', 'normaly', 'normalz',
+                   'mean', 'stddev', 'RMS', 'npts']
+        arrays = [table.GetColumnByName(name) for name in columns]
 
-        if pd.IsTypeOf("vtkMultiBlockDataSet"):
-            appendFilter = vtk.vtkAppendFilter()
-            for i in range(pd.GetNumberOfBlocks()):
-                appendFilter.AddInputData(pd.GetBlock(i))
-            appendFilter.Update()
-            pd = appendFilter.GetOutput()
+        def cellconverter(name, value, row):
+            if name == 'channel':
+                return 'overall' if row == 0 else '%d' % value
+            if name == 'npts':
+                return '%d' % value
+            if math.isnan(value):
+                return 'nan'
+            return '%.4f' % value
 
-        max_laser_id = pd.GetPointData().GetArray("laser_id").GetRange()[1]
-        nchannels = 2**vtk.vtkMath.CeilLog2(int(max_laser_id))
-
-        origin = range(3)
-        normal = range(3)
-        mind, maxd, stddev = vtk.mutable(0), vtk.mutable(0), vtk.mutable(0)
-
-        channelMean = range(nchannels)
-        channelStdDev = range(nchannels)
-        channelNpts = range(nchannels)
-
-        vvmod.vtkPlaneFitter.PlaneFit(pd, origin, normal, mind, maxd, stddev, channelMean, channelStdDev, channelNpts, nchannels)
-        rows = [['overall', origin, normal, 0.0, stddev, stddev, pd.GetNumberOfPoints()]]
-        rows = rows + [['%d' % i, origin, normal,
-                        channelMean[i], channelStdDev[i],
-                        math.sqrt(channelMean[i]**2 + channelStdDev[i]**2),
-                        channelNpts[i]]
-                       for i in range(nchannels)]
-
-        def rowconverter(x):
-            try:
-                return '\t'.join(['%.4f' % d for d in x])
-            except TypeError:
-                try:
-                    x = x.get()
-                except AttributeError:
-                    pass
-                if type(x) == float:
-                    return '%.4f' % x
-                elif type(x) in (int, long):
-                    return '%d' % x
-                else:
-                    return x
-
-        print '\t'.join(['channel','originx','originy','originz','normalx','normaly','normalz',
-                         'mean','stddev','RMS','npts'])
-        for r in rows:
-            if r[-1] == 0:
-                r[-4:-1] = ['nan', 'nan', 'nan']
-            print '\t'.join([rowconverter(x) for x in r])
+        print '\t'.join(columns)
+        for row in range(table.GetNumberOfRows()):
+            print '\t'.join([cellconverter(name, array.GetValue(row), row)
+                             for name, array in zip(columns, arrays)])
     finally:
-        smp.Delete(extracter)
+        smp.Delete(fitter)
         smp.SetActiveSource(src)
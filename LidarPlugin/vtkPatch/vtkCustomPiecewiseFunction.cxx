@@ -13,12 +13,14 @@
 
 =========================================================================*/
 #include "vtkCustomPiecewiseFunction.h"
+#include "vtkCustomUniformTimeIndex.h"
 
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
 
 #include <cassert>
+#include <cmath>
 #include <vector>
 #include <set>
 #include <algorithm>
@@ -93,8 +95,214 @@ public:
   vtkPiecewiseFunctionFindNodeEqual       FindNodeEqual;
   vtkPiecewiseFunctionFindNodeInRange     FindNodeInRange;
   vtkPiecewiseFunctionFindNodeOutOfRange  FindNodeOutOfRange;
+  vtkCustomUniformTimeIndex               UniformIndex;
+
+  // Contiguous copy of the sorted nodes, rebuilt by Modified(), which the
+  // dichotomic and batch evaluations read instead of the node pointers
+  std::vector<double> X;
+  std::vector<double> Y;
+  std::vector<double> Midpoint;
+  std::vector<double> Sharpness;
+  // all the segments are linear with a centered midpoint
+  bool IsLinear = true;
+  // the nodes are uniformly spaced, up to a small fraction of the step
+  bool IsUniform = false;
+  double InverseStep = 0.0;
+
+  void UpdateLayout();
+  int FindSegment(double x) const;
+  double Evaluate(int k, double x) const;
+  double GetOutsideValue(int k, int clamping) const;
 };
 
+//----------------------------------------------------------------------------
+void vtkPiecewiseFunctionInternals::UpdateLayout()
+{
+  const int size = static_cast<int>(this->Nodes.size());
+  // an index of other node locations would be wrong
+  bool isSameX = static_cast<int>(this->X.size()) == size;
+  for (int i = 0; i < size && isSameX; ++i)
+    {
+    isSameX = this->X[i] == this->Nodes[i]->X;
+    }
+  if (!isSameX)
+    {
+    this->UniformIndex.Clear();
+    }
+
+  this->X.resize(size);
+  this->Y.resize(size);
+  this->Midpoint.resize(size);
+  this->Sharpness.resize(size);
+  this->IsLinear = true;
+  for (int i = 0; i < size; ++i)
+    {
+    this->X[i] = this->Nodes[i]->X;
+    this->Y[i] = this->Nodes[i]->Y;
+    this->Midpoint[i] = this->Nodes[i]->Midpoint;
+    this->Sharpness[i] = this->Nodes[i]->Sharpness;
+    // the values of the last node do not control any segment
+    if (i + 1 < size)
+      {
+      this->IsLinear &= this->Sharpness[i] < 0.01 && this->Midpoint[i] == 0.5;
+      }
+    }
+
+  // the segment of a location is then found after a single division,
+  // the tolerance keeps the estimate within one segment of the right one
+  this->IsUniform = size >= 2 && this->X[size - 1] > this->X[0];
+  if (this->IsUniform)
+    {
+    const double step = (this->X[size - 1] - this->X[0]) / (size - 1);
+    for (int i = 1; i < size - 1 && this->IsUniform; ++i)
+      {
+      this->IsUniform = std::abs(this->X[i] - (this->X[0] + i * step)) <= 0.01 * step;
+      }
+    this->InverseStep = 1.0 / step;
+    }
+}
+
+//----------------------------------------------------------------------------
+// Index k of the segment [X[k], X[k+1]) containing x, -1 before the first
+// node and the index of the last node from it on (and for nan), like the
+// upper bound of x minus one
+int vtkPiecewiseFunctionInternals::FindSegment(double x) const
+{
+  const int size = static_cast<int>(this->X.size());
+  if (!this->IsUniform)
+    {
+    const std::vector<double>& nodes = this->X;
+    return this->UniformIndex.UpperBound(x, size, [&nodes](int j) { return nodes[j]; }) - 1;
+    }
+  const int last = size - 1;
+  const double u = (x - this->X[0]) * this->InverseStep;
+  int k = u < last ? (u >= 0.0 ? static_cast<int>(u) : -1) : last;
+  if (k >= 0)
+    {
+    if (x < this->X[k])
+      {
+      --k;
+      }
+    else if (k < last && x >= this->X[k + 1])
+      {
+      ++k;
+      }
+    }
+  return k;
+}
+
+//----------------------------------------------------------------------------
+// Value outside of the nodes, for a segment index k returned by FindSegment()
+double vtkPiecewiseFunctionInternals::GetOutsideValue(int k, int clamping) const
+{
+  if (!clamping || this->Y.empty())
+    {
+    return 0.0;
+    }
+  return k < 0 ? this->Y.front() : this->Y.back();
+}
+
+//----------------------------------------------------------------------------
+// Value at x in the segment [X[k], X[k+1])
+double vtkPiecewiseFunctionInternals::Evaluate(int k, double x) const
+{
+  const double x1 = this->X[k];
+  const double x2 = this->X[k + 1];
+  const double y1 = this->Y[k];
+  const double y2 = this->Y[k + 1];
+
+  // We only need the previous midpoint and sharpness
+  // since these control this region
+  double midpoint = this->Midpoint[k];
+  const double sharpness = this->Sharpness[k];
+
+  // Move midpoint away from extreme ends of range to avoid
+  // degenerate math
+  if ( midpoint < 0.00001 )
+    {
+    midpoint = 0.00001;
+    }
+
+  if ( midpoint > 0.99999 )
+    {
+    midpoint = 0.99999;
+    }
+
+  // Our first attempt at a normalized location [0,1] -
+  // we will be modifying this based on midpoint and
+  // sharpness to get the curve shape we want and to have
+  // it pass through (y1+y2)/2 at the midpoint.
+  double s = (x - x1) / (x2 - x1);
+
+  // Readjust based on the midpoint - linear adjustment
+  if ( s < midpoint )
+    {
+    s = 0.5 * s / midpoint;
+    }
+  else
+    {
+    s = 0.5 + 0.5*(s-midpoint)/(1.0-midpoint);
+    }
+
+  // override for sharpness > 0.99
+  // In this case we just want piecewise constant
+  if ( sharpness > 0.99 )
+    {
+    // Use the first value since we are below the midpoint,
+    // the second value at or above the midpoint
+    return s < 0.5 ? y1 : y2;
+    }
+
+  // Override for sharpness < 0.01
+  // In this case we want piecewise linear
+  if ( sharpness < 0.01 )
+    {
+    // Simple linear interpolation
+    return (1-s)*y1 + s*y2;
+    }
+
+  // We have a sharpness between [0.01, 0.99] - we will
+  // used a modified hermite curve interpolation where we
+  // derive the slope based on the sharpness, and we compress
+  // the curve non-linearly based on the sharpness
+
+  // First, we will adjust our position based on sharpness in
+  // order to make the curve sharper (closer to piecewise constant)
+  if ( s < .5 )
+    {
+    s = 0.5 * pow(s*2,1.0 + 10*sharpness);
+    }
+  else if ( s > .5 )
+    {
+    s = 1.0 - 0.5 * pow((1.0-s)*2,1+10*sharpness);
+    }
+
+  // Compute some coefficients we will need for the hermite curve
+  double ss = s*s;
+  double sss = ss*s;
+
+  double h1 =  2*sss - 3*ss + 1;
+  double h2 = -2*sss + 3*ss;
+  double h3 =    sss - 2*ss + s;
+  double h4 =    sss -   ss;
+
+  // Use one slope for both end points
+  double slope = y2 - y1;
+  double t = (1.0 - sharpness)*slope;
+
+  // Compute the value
+  double value = h1*y1 + h2*y2 + h3*t + h4*t;
+
+  // Final error check to make sure we don't go outside
+  // the Y range
+  double min = (y1<y2)?(y1):(y2);
+  double max = (y1>y2)?(y1):(y2);
+
+  value = (value < min)?(min):(value);
+  value = (value > max)?(max):(value);
+  return value;
+}
+
 // Construct a new vtkPiecewiseFunction with default values
 vtkCustomPiecewiseFunction::vtkCustomPiecewiseFunction()
 {
@@ -177,181 +385,114 @@ void vtkCustomPiecewiseFunction::Initialize()
 void vtkCustomPiecewiseFunction::GetTableDichotomic( double xStart, double xEnd,
                                      int size, double* table,
                                      int stride )
- {
-   int i;
-  int numNodes = static_cast<int>(this->Internal->Nodes.size());
-
-  // Need to keep track of the last value so that
-  // we can fill in table locations past this with
-  // this value if Clamping is On.
-  double lastValue = 0.0;
-  if ( numNodes != 0 )
-  {
-    lastValue = this->Internal->Nodes[numNodes-1]->Y;
-  }
-
-  double *tptr     = NULL;
-  double x         = 0.0;
-  double x1        = 0.0;
-  double x2        = 0.0;
-  double y1        = 0.0;
-  double y2        = 0.0;
-  double midpoint  = 0.0;
-  double sharpness = 0.0;
-
-  // For each table entry
-  for ( i = 0; i < size; i++ )
-  {
-    // Find our location in the table
-    tptr = table + stride*i;
-
+{
+  const vtkPiecewiseFunctionInternals& internal = *this->Internal;
+  const int last = static_cast<int>(internal.X.size()) - 1;
+  for (int i = 0; i < size; i++)
+    {
     // Find our X location. If we are taking only 1 sample, make
     // it halfway between start and end (usually start and end will
     // be the same in this case)
-    if ( size > 1 )
-    {
-      x = xStart + (double(i)/double(size-1))*(xEnd-xStart);
+    const double x = size > 1 ? xStart + (double(i)/double(size-1))*(xEnd-xStart)
+                              : 0.5*(xStart+xEnd);
+    const int k = internal.FindSegment(x);
+    table[stride*i] = (k < 0 || k >= last) ? internal.GetOutsideValue(k, this->Clamping)
+                                           : internal.Evaluate(k, x);
     }
-    else
-    {
-      x = 0.5*(xStart+xEnd);
-    }
-
-    vtkPiecewiseFunctionCompareNodes comparator;
-    vtkPiecewiseFunctionNode node;
-    node.X = x;
-    std::vector<vtkPiecewiseFunctionNode*>::iterator lowBound;
-    std::vector<vtkPiecewiseFunctionNode*>::iterator upBound;
-    upBound = std::upper_bound(this->Internal->Nodes.begin(), this->Internal->Nodes.end(), &node, comparator);
+}
 
-    // Are we at the end? If so, just use the last value
-    if (upBound == this->Internal->Nodes.end())
-    {
-      *tptr = (this->Clamping)?(lastValue):(0.0);
-    }
-    // Are we before the first node? If so, duplicate this nodes values
-    else if ( upBound == this->Internal->Nodes.begin() )
-    {
-      *tptr = (this->Clamping)?(this->Internal->Nodes[0]->Y):(0.0);
-    }
-    // If we are at a valid point index, fill in
-    // the value at this node, and the one before (the
-    // two that surround our current sample location)
-    else
+//----------------------------------------------------------------------------
+namespace
+{
+template<typename T>
+void GetPiecewiseValues(const vtkPiecewiseFunctionInternals& internal, int clamping,
+                        vtkIdType n, const T* x, T* values, int stride)
+{
+  const int last = static_cast<int>(internal.X.size()) - 1;
+  const double before = internal.GetOutsideValue(-1, clamping);
+  const double after = internal.GetOutsideValue(last, clamping);
+  if (last < 1)
     {
-      lowBound = upBound - 1;
-      x1 = (*lowBound)->X;
-      x2 = (*upBound)->X;
-
-      y1 = (*lowBound)->Y;
-      y2 = (*upBound)->Y;
-
-      // We only need the previous midpoint and sharpness
-      // since these control this region
-      midpoint  = (*lowBound)->Midpoint;
-      sharpness = (*lowBound)->Sharpness;
-
-      // Move midpoint away from extreme ends of range to avoid
-      // degenerate math
-      if ( midpoint < 0.00001 )
+    for (vtkIdType i = 0; i < n; ++i)
       {
-        midpoint = 0.00001;
+      values[i * stride] = static_cast<T>(internal.FindSegment(x[i]) < 0 ? before : after);
       }
+    return;
+    }
 
-      if ( midpoint > 0.99999 )
-      {
-        midpoint = 0.99999;
-      }
-
-      // Our first attempt at a normalized location [0,1] -
-      // we will be modifying this based on midpoint and
-      // sharpness to get the curve shape we want and to have
-      // it pass through (y1+y2)/2 at the midpoint.
-      double s = (x - x1) / (x2 - x1);
-
-      // Readjust based on the midpoint - linear adjustment
-      if ( s < midpoint )
-      {
-        s = 0.5 * s / midpoint;
-      }
-      else
+  // the segments of a block of locations are found first, then the
+  // values of the linear segments are blended in a loop without branch
+  const int blockSize = 256;
+  int segments[blockSize];
+  const double* X = internal.X.data();
+  const double* Y = internal.Y.data();
+  for (vtkIdType begin = 0; begin < n; begin += blockSize)
+    {
+    const int size = static_cast<int>(std::min<vtkIdType>(blockSize, n - begin));
+    const T* xBlock = x + begin;
+    T* valuesBlock = values + begin * stride;
+    for (int i = 0; i < size; ++i)
       {
-        s = 0.5 + 0.5*(s-midpoint)/(1.0-midpoint);
+      segments[i] = internal.FindSegment(xBlock[i]);
       }
 
-      // override for sharpness > 0.99
-      // In this case we just want piecewise constant
-      if ( sharpness > 0.99 )
+    if (!internal.IsLinear)
       {
-        // Use the first value since we are below the midpoint
-        if ( s < 0.5 )
+      for (int i = 0; i < size; ++i)
         {
-          *tptr = y1;
-          continue;
-        }
-        // Use the second value at or above the midpoint
-        else
-        {
-          *tptr = y2;
-          continue;
+        const int k = segments[i];
+        valuesBlock[i * stride] = static_cast<T>((k < 0 || k >= last) ?
+          (k < 0 ? before : after) : internal.Evaluate(k, xBlock[i]));
         }
+      continue;
       }
 
-      // Override for sharpness < 0.01
-      // In this case we want piecewise linear
-      if ( sharpness < 0.01 )
+    for (int i = 0; i < size; ++i)
       {
-        // Simple linear interpolation
-        *tptr = (1-s)*y1 + s*y2;
-        continue;
+      const int k = segments[i];
+      // same arithmetic as Evaluate() with a centered midpoint
+      const int j = k < 0 ? 0 : (k >= last ? last - 1 : k);
+      const double s = (xBlock[i] - X[j]) / (X[j + 1] - X[j]);
+      const double value = (1 - s) * Y[j] + s * Y[j + 1];
+      valuesBlock[i * stride] = static_cast<T>(k < 0 ? before : (k >= last ? after : value));
       }
+    }
+}
+}
 
-      // We have a sharpness between [0.01, 0.99] - we will
-      // used a modified hermite curve interpolation where we
-      // derive the slope based on the sharpness, and we compress
-      // the curve non-linearly based on the sharpness
-
-      // First, we will adjust our position based on sharpness in
-      // order to make the curve sharper (closer to piecewise constant)
-      if ( s < .5 )
-      {
-        s = 0.5 * pow(s*2,1.0 + 10*sharpness);
-      }
-      else if ( s > .5 )
-      {
-        s = 1.0 - 0.5 * pow((1.0-s)*2,1+10*sharpness);
-      }
-
-      // Compute some coefficients we will need for the hermite curve
-      double ss = s*s;
-      double sss = ss*s;
-
-      double h1 =  2*sss - 3*ss + 1;
-      double h2 = -2*sss + 3*ss;
-      double h3 =    sss - 2*ss + s;
-      double h4 =    sss -   ss;
-
-      double slope;
-      double t;
-
-      // Use one slope for both end points
-      slope = y2 - y1;
-      t = (1.0 - sharpness)*slope;
-
-      // Compute the value
-      *tptr = h1*y1 + h2*y2 + h3*t + h4*t;
-
-      // Final error check to make sure we don't go outside
-      // the Y range
-      double min = (y1<y2)?(y1):(y2);
-      double max = (y1>y2)?(y1):(y2);
+//----------------------------------------------------------------------------
+void vtkCustomPiecewiseFunction::GetValues(vtkIdType n, const double* x, double* values,
+                                           int stride)
+{
+  GetPiecewiseValues(*this->Internal, this->Clamping, n, x, values, stride);
+}
 
-      *tptr = (*tptr < min)?(min):(*tptr);
-      *tptr = (*tptr > max)?(max):(*tptr);
+//----------------------------------------------------------------------------
+void vtkCustomPiecewiseFunction::GetValues(vtkIdType n, const float* x, float* values,
+                                           int stride)
+{
+  GetPiecewiseValues(*this->Internal, this->Clamping, n, x, values, stride);
+}
 
+//----------------------------------------------------------------------------
+void vtkCustomPiecewiseFunction::Modified()
+{
+  this->Superclass::Modified();
+  // the index is built on demand, the layout on every modification so that
+  // the evaluations never write, and may be called concurrently
+  if (this->Internal)
+    {
+    this->Internal->UpdateLayout();
     }
-  }
- }
+}
+
+ //----------------------------------------------------------------------------
+void vtkCustomPiecewiseFunction::BuildUniformIndex()
+{
+  const std::vector<double>& nodes = this->Internal->X;
+  this->Internal->UniformIndex.Build(static_cast<int>(nodes.size()),
+    [&nodes](int j) { return nodes[j]; });
+}
 
  // Return the value of the function at a position
 double vtkCustomPiecewiseFunction::GetValueDichotomic( double x )
@@ -650,6 +791,7 @@ int vtkCustomPiecewiseFunction::AddPoint( double x, double y,
 // the Range
 void vtkCustomPiecewiseFunction::SortAndUpdateRange()
 {
+  this->Internal->UniformIndex.Clear();
   std::sort( this->Internal->Nodes.begin(),
                 this->Internal->Nodes.end(),
                 this->Internal->CompareNodes );
@@ -729,6 +871,7 @@ int vtkCustomPiecewiseFunction::RemovePoint( double x )
     {
     delete *iter;
     this->Internal->Nodes.erase(iter);
+    this->Internal->UniformIndex.Clear();
     // if the first or last point has been removed, then we update the range
     // No need to sort here as the order of points hasn't changed.
     bool modifiedInvoked = false;
@@ -82,6 +82,29 @@ public:
   double GetValue( double x );
   double GetValueDichotomic( double x );
 
+  // Description:
+  // Evaluate the function at n locations at once, like GetValueDichotomic(),
+  // writing the values every stride elements of the values array. The nodes
+  // are read from a contiguous copy made when the function is modified. When
+  // they are uniformly spaced, the segment of a location is found after a
+  // single multiplication, and when the function is piecewise linear with
+  // centered midpoints (as with the legacy AddPoint()), the values of a block
+  // of locations are computed in a loop that the compiler can vectorize.
+  void GetValues(vtkIdType n, const double* x, double* values, int stride=1);
+  void GetValues(vtkIdType n, const float* x, float* values, int stride=1);
+
+  // Description:
+  // Index the nodes so that GetValueDichotomic(), GetTableDichotomic() and
+  // GetValues() find the segment of a location after a single division when
+  // the nodes are almost uniformly spaced. Otherwise they keep using a binary
+  // search. The index is discarded when the nodes change. The nodes that are
+  // uniformly spaced up to 1% of their spacing need no index.
+  void BuildUniformIndex();
+
+  // Description:
+  // Update the contiguous copy of the nodes read by the evaluations.
+  virtual void Modified();
+
   // Description:
   // For the node specified by index, set/get the
   // location (X), value (Y), midpoint, and sharpness
@@ -196,6 +196,28 @@ public:
   vtkCustomQuaternion<T> InnerPoint(const vtkCustomQuaternion<T>& q1,
     const vtkCustomQuaternion<T>& q2) const;
 
+  // Description:
+  // Interpolate n pairs of unit quaternions at once: q[k] is the Slerp() of
+  // q0[k] and q1[k] at t[k]. The quaternions are stored as consecutive
+  // (w, x, y, z) tuples, q may be q0 or q1, and the results are normalized.
+  // The pairs are processed by blocks, in loops without branches that the
+  // compiler can vectorize, except for the sines of the pairs far apart.
+  // When the angle between the quaternions of a pair is below maxNlerpAngle
+  // (radians), no trigonometric function is evaluated: the pair is linearly
+  // interpolated with weights corrected to fourth order in the angle, then
+  // normalized, which differs from the slerp by less than 1e-10 for angles
+  // up to 0.1 rad.
+  // @sa Slerp()
+  static void BatchSlerp(int n, const T* t, const T* q0, const T* q1, T* q,
+    T maxNlerpAngle = 0);
+
+  // Description:
+  // Convert n quaternions, stored as consecutive (w, x, y, z) tuples, to n
+  // 3x3 rotation matrices stored as consecutive arrays of 9 values in row
+  // major order. Same as ToMatrix3x3() on each quaternion, without branch.
+  // @sa ToMatrix3x3()
+  static void BatchToMatrix3x3(int n, const T* q, T* A);
+
   // Description:
   // Performs addition of quaternion of the same basic type.
   vtkCustomQuaternion<T> operator+(const vtkCustomQuaternion<T>& q) const;
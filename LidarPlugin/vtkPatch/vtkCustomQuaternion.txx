@@ -20,6 +20,7 @@
 
 #include "vtkMath.h"
 
+#include <algorithm>
 #include <cmath>
 
 //----------------------------------------------------------------------------
@@ -473,10 +474,6 @@ template<typename T> void vtkCustomQuaternion<T>::FromMatrix3x3(const T A[3][3])
 template<typename T> vtkCustomQuaternion<T> vtkCustomQuaternion<T>
 ::Slerp(T t, const vtkCustomQuaternion<T>& q1) const
 {
-  T axis0[3], axis1[3];
-  this->GetRotationAngleAndAxis(axis0);
-  q1.GetRotationAngleAndAxis(axis1);
-
   // Canonical scalar product on quaternion
 
   T dot = this->GetW() * q1.GetW() +
@@ -540,6 +537,124 @@ template<typename T> vtkCustomQuaternion<T> vtkCustomQuaternion<T>
   return q1*qExp;
 }
 
+//----------------------------------------------------------------------------
+template<typename T> void vtkCustomQuaternion<T>
+::BatchSlerp(int n, const T* t, const T* q0, const T* q1, T* q, T maxNlerpAngle)
+{
+  // the weights are computed for a block of pairs at once, so that each
+  // pass is a simple loop over arrays
+  const int blockSize = 64;
+  T dots[blockSize], w0[blockSize], w1[blockSize];
+  // above 1 when the nlerp is disabled, so that every pair is a slerp
+  const T minNlerpDot = maxNlerpAngle > 0 ? static_cast<T>(cos(maxNlerpAngle)) : T(2);
+
+  for (int begin = 0; begin < n; begin += blockSize)
+  {
+    const int size = std::min(blockSize, n - begin);
+    const T* a = q0 + 4 * begin;
+    const T* b = q1 + 4 * begin;
+    const T* u = t + begin;
+    T* r = q + 4 * begin;
+
+    // Weights of the corrected nlerp. For unit quaternions at an angle theta,
+    // with e = 1 - cos(theta), the series of the slerp weights is
+    // sin(s theta) / sin(theta) = s (1 + (1 - s^2) e (1/3 + e (4 - s^2) / 30))
+    // + O(theta^6). As in Slerp(), the opposite of q1 is used when it is
+    // closer to q0.
+    for (int k = 0; k < size; ++k)
+    {
+      const T dot = a[4 * k] * b[4 * k] + a[4 * k + 1] * b[4 * k + 1] +
+                    a[4 * k + 2] * b[4 * k + 2] + a[4 * k + 3] * b[4 * k + 3];
+      const T absDot = std::abs(dot);
+      const T e = T(1) - absDot;
+      const T s0 = T(1) - u[k];
+      const T s1 = u[k];
+      dots[k] = dot;
+      w0[k] = s0 * (T(1) + (T(1) - s0 * s0) * e * (T(1) / T(3) + e * (T(4) - s0 * s0) / T(30)));
+      w1[k] = (dot < 0 ? -s1 : s1) *
+              (T(1) + (T(1) - s1 * s1) * e * (T(1) / T(3) + e * (T(4) - s1 * s1) / T(30)));
+    }
+
+    // exact weights of the pairs too far apart, with the same
+    // linear fallback as Slerp() for the nearly equal quaternions
+    for (int k = 0; k < size; ++k)
+    {
+      const T absDot = std::abs(dots[k]);
+      if (absDot < minNlerpDot)
+      {
+        T s0 = T(1) - u[k];
+        T s1 = u[k];
+        if (T(1) - absDot >= T(1e-6))
+        {
+          const T theta = acos(absDot);
+          const T sinTheta = sin(theta);
+          s0 = sin(s0 * theta) / sinTheta;
+          s1 = sin(s1 * theta) / sinTheta;
+        }
+        w0[k] = s0;
+        w1[k] = dots[k] < 0 ? -s1 : s1;
+      }
+    }
+
+    // blend and normalize, each result is written after its pair is read
+    for (int k = 0; k < size; ++k)
+    {
+      const T w = w0[k] * a[4 * k] + w1[k] * b[4 * k];
+      const T x = w0[k] * a[4 * k + 1] + w1[k] * b[4 * k + 1];
+      const T y = w0[k] * a[4 * k + 2] + w1[k] * b[4 * k + 2];
+      const T z = w0[k] * a[4 * k + 3] + w1[k] * b[4 * k + 3];
+      const T squaredNorm = w * w + x * x + y * y + z * z;
+      const T f = squaredNorm > 0 ? T(1) / std::sqrt(squaredNorm) : T(0);
+      r[4 * k] = w * f;
+      r[4 * k + 1] = x * f;
+      r[4 * k + 2] = y * f;
+      r[4 * k + 3] = z * f;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+template<typename T> void vtkCustomQuaternion<T>
+::BatchToMatrix3x3(int n, const T* q, T* A)
+{
+  for (int k = 0; k < n; ++k)
+  {
+    const T* Q = q + 4 * k;
+    T* M = A + 9 * k;
+    const T ww = Q[0] * Q[0];
+    const T wx = Q[0] * Q[1];
+    const T wy = Q[0] * Q[2];
+    const T wz = Q[0] * Q[3];
+
+    const T xx = Q[1] * Q[1];
+    const T yy = Q[2] * Q[2];
+    const T zz = Q[3] * Q[3];
+
+    const T xy = Q[1] * Q[2];
+    const T xz = Q[1] * Q[3];
+    const T yz = Q[2] * Q[3];
+
+    // a null quaternion gives a null matrix, as in ToMatrix3x3()
+    const T rr = xx + yy + zz;
+    const T squaredNorm = ww + rr;
+    const T f = squaredNorm != 0 ? T(1) / squaredNorm : T(0);
+    const T s = (ww - rr) * f;
+    const T f2 = T(2) * f;
+
+    M[0] = xx * f2 + s;
+    M[1] = (xy - wz) * f2;
+    M[2] = (xz + wy) * f2;
+
+    M[3] = (xy + wz) * f2;
+    M[4] = yy * f2 + s;
+    M[5] = (yz - wx) * f2;
+
+    M[6] = (xz - wy) * f2;
+    M[7] = (yz + wx) * f2;
+    M[8] = zz * f2 + s;
+  }
+}
+
 //----------------------------------------------------------------------------
 template<typename T> void vtkCustomQuaternion<T>::ToUnitLog()
 {
@@ -16,6 +16,7 @@
 #include "vtkObjectFactory.h"
 #include "vtkCustomQuaternion.h"
 #include "vtkCustomQuaternionInterpolator.h"
+#include "vtkCustomUniformTimeIndex.h"
 #include <vector>
 
 vtkStandardNewMacro(vtkCustomQuaternionInterpolator);
@@ -51,7 +52,9 @@ vtkCustomQuaternionInterpolator::vtkCustomQuaternionInterpolator()
 {
   // Set up the interpolation
   this->QuaternionList = new vtkCustomQuaternionList;
+  this->TimeIndex = new vtkCustomUniformTimeIndex;
   this->InterpolationType = INTERPOLATION_TYPE_SPLINE;
+  this->MaximumNlerpAngle = 0.0;
 }
 
 //----------------------------------------------------------------------------
@@ -59,6 +62,7 @@ vtkCustomQuaternionInterpolator::~vtkCustomQuaternionInterpolator()
 {
   this->Initialize();
   delete this->QuaternionList;
+  delete this->TimeIndex;
 }
 
 //----------------------------------------------------------------------------
@@ -101,6 +105,7 @@ void vtkCustomQuaternionInterpolator::Initialize()
 {
   // Wipe out old data
   this->QuaternionList->clear();
+  this->TimeIndex->Clear();
 }
 
 //----------------------------------------------------------------------------
@@ -115,6 +120,7 @@ void vtkCustomQuaternionInterpolator::AddQuaternion(double t,
                                               const vtkCustomQuaterniond& q)
 {
   int size = static_cast<int>(this->QuaternionList->size());
+  this->TimeIndex->Clear();
 
   // Check special cases: t at beginning or end of list
   if ( size <= 0 || t < this->QuaternionList->front().Time )
@@ -169,6 +175,7 @@ void vtkCustomQuaternionInterpolator::RemoveQuaternion(double t)
   if ( iter != this->QuaternionList->end() )
     {
     this->QuaternionList->erase(iter);
+    this->TimeIndex->Clear();
     }
 
   this->Modified();
@@ -185,6 +192,24 @@ void vtkCustomQuaternionInterpolator::InterpolateQuaternion(double t, double q[4
     }
 }
 
+//----------------------------------------------------------------------------
+void vtkCustomQuaternionInterpolator::BuildUniformTimeIndex()
+{
+  const vtkCustomQuaternionList& quaternions = *this->QuaternionList;
+  this->TimeIndex->Build(static_cast<int>(quaternions.size()),
+    [&quaternions](int i) { return quaternions[i].Time; });
+}
+
+//----------------------------------------------------------------------------
+int vtkCustomQuaternionInterpolator::FindInterval(double t)
+{
+  const vtkCustomQuaternionList& quaternions = *this->QuaternionList;
+  const int size = static_cast<int>(quaternions.size());
+  int i = this->TimeIndex->UpperBound(t, size,
+    [&quaternions](int j) { return quaternions[j].Time; }) - 1;
+  return (i < 0 ? 0 : (i > size - 2 ? size - 2 : i));
+}
+
 //----------------------------------------------------------------------------
 void vtkCustomQuaternionInterpolator::InterpolateQuaternion(double t,
                                                       vtkCustomQuaterniond& q)
@@ -199,7 +224,7 @@ void vtkCustomQuaternionInterpolator::InterpolateQuaternion(double t,
 
   else if ( t >= this->QuaternionList->back().Time )
     {
-    TimedQuaternion &Q = this->QuaternionList->front();
+    TimedQuaternion &Q = this->QuaternionList->back();
     q = Q.Q;
     return;
     }
@@ -209,17 +234,10 @@ void vtkCustomQuaternionInterpolator::InterpolateQuaternion(double t,
   int numQuats = this->GetNumberOfQuaternions();
   if ( this->InterpolationType == INTERPOLATION_TYPE_LINEAR || numQuats < 3 )
     {
-    QuaternionListIterator iter = this->QuaternionList->begin();
+    QuaternionListIterator iter = this->QuaternionList->begin() + this->FindInterval(t);
     QuaternionListIterator nextIter = iter + 1;
-    for ( ; nextIter != this->QuaternionList->end(); ++iter, ++nextIter)
-      {
-      if ( iter->Time <= t && t <= nextIter->Time )
-        {
-        double T = (t - iter->Time) / (nextIter->Time - iter->Time);
-        q = iter->Q.Slerp(T,nextIter->Q);
-        break;
-        }
-      }
+    double T = (t - iter->Time) / (nextIter->Time - iter->Time);
+    q = iter->Q.Slerp(T,nextIter->Q);
     }//if linear quaternion interpolation
 
   else // this->InterpolationType == INTERPOLATION_TYPE_SPLINE
@@ -229,16 +247,10 @@ void vtkCustomQuaternionInterpolator::InterpolateQuaternion(double t,
     QuaternionListIterator iter0, iter1, iter2, iter3;
 
     //find the interval
-    double T=0.0;
-    int i;
-    for (i=0; nextIter != this->QuaternionList->end(); ++iter, ++nextIter, ++i)
-      {
-      if ( iter->Time <= t && t <= nextIter->Time )
-        {
-        T = (t - iter->Time) / (nextIter->Time - iter->Time);
-        break;
-        }
-      }
+    int i = this->FindInterval(t);
+    iter += i;
+    nextIter += i;
+    double T = (t - iter->Time) / (nextIter->Time - iter->Time);
 
     vtkCustomQuaterniond ai, bi, qc, qd;
     if ( i == 0 ) //initial interval
@@ -287,6 +299,50 @@ void vtkCustomQuaternionInterpolator::InterpolateQuaternion(double t,
   return;
 }
 
+//----------------------------------------------------------------------------
+void vtkCustomQuaternionInterpolator::InterpolateQuaternions(int n, const double* t,
+                                                             double* q)
+{
+  const vtkCustomQuaternionList& quaternions = *this->QuaternionList;
+  if (quaternions.empty() || n <= 0)
+    {
+    return;
+    }
+  if (this->InterpolationType != INTERPOLATION_TYPE_LINEAR && quaternions.size() > 2)
+    {
+    vtkCustomQuaterniond quat;
+    for (int k = 0; k < n; ++k)
+      {
+      this->InterpolateQuaternion(t[k], quat);
+      quat.Get(q + 4 * k);
+      }
+    return;
+    }
+
+  // gather the quaternions bracketing each time, the first ones directly
+  // in the output, then slerp them all at once
+  std::vector<double> next(4 * n), u(n);
+  for (int k = 0; k < n; ++k)
+    {
+    int i = 0;
+    double T = 0.0;
+    if (t[k] >= quaternions.back().Time)
+      {
+      i = static_cast<int>(quaternions.size()) - 1;
+      }
+    else if (t[k] > quaternions.front().Time)
+      {
+      i = this->FindInterval(t[k]);
+      T = (t[k] - quaternions[i].Time) / (quaternions[i + 1].Time - quaternions[i].Time);
+      }
+    const int j = T > 0.0 ? i + 1 : i;
+    quaternions[i].Q.Get(q + 4 * k);
+    quaternions[j].Q.Get(next.data() + 4 * k);
+    u[k] = T;
+    }
+  vtkCustomQuaterniond::BatchSlerp(n, u.data(), q, next.data(), q, this->MaximumNlerpAngle);
+}
+
 //----------------------------------------------------------------------------
 void vtkCustomQuaternionInterpolator::PrintSelf(ostream& os, vtkIndent indent)
 {
@@ -298,6 +354,7 @@ void vtkCustomQuaternionInterpolator::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "InterpolationType: "
      << (this->InterpolationType == INTERPOLATION_TYPE_LINEAR ?
          "Linear\n" : "Spline\n");
+  os << indent << "MaximumNlerpAngle: " << this->MaximumNlerpAngle << "\n";
 }
 
 
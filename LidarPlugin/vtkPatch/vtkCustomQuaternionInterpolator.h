@@ -57,6 +57,7 @@
 
 class vtkCustomQuaterniond;
 class vtkCustomQuaternionList;
+class vtkCustomUniformTimeIndex;
 
 class vtkCustomQuaternionInterpolator : public vtkObject
 {
@@ -106,6 +107,30 @@ public:
   void InterpolateQuaternion(double t, vtkCustomQuaterniond& q);
   void InterpolateQuaternion(double t, double q[4]);
 
+  // Description:
+  // Interpolate the quaternions at n times at once, filling the caller
+  // provided array with n unit quaternions stored as (w, x, y, z) tuples.
+  // The linear interpolation slerps all the intervals in a single call to
+  // vtkCustomQuaternion::BatchSlerp(), the spline one evaluates each time
+  // with InterpolateQuaternion().
+  void InterpolateQuaternions(int n, const double* t, double* q);
+
+  // Description:
+  // Angle (in radians) under which the linear interpolation of
+  // InterpolateQuaternions() between two consecutive quaternions is
+  // approximated by a corrected normalized linear interpolation, which needs
+  // no trigonometric function (see vtkCustomQuaternion::BatchSlerp()).
+  // 0, the default, always uses the exact slerp.
+  vtkSetClampMacro(MaximumNlerpAngle, double, 0.0, 1.0);
+  vtkGetMacro(MaximumNlerpAngle, double);
+
+  // Description:
+  // Index the quaternion times so that InterpolateQuaternion() finds the
+  // interval of a time after a single division when the quaternions are
+  // almost uniformly sampled, instead of a binary search. The index is
+  // discarded when the quaternions change.
+  void BuildUniformTimeIndex();
+
 //BTX
   // Description:
   // Enums to control the type of interpolation to use.
@@ -134,9 +159,15 @@ protected:
 
   // Specify the type of interpolation to use
   int InterpolationType;
+  double MaximumNlerpAngle;
 
   // Internal variables for interpolation functions
   vtkCustomQuaternionList *QuaternionList; //used for linear quaternion interpolation
+  vtkCustomUniformTimeIndex *TimeIndex; //used to find the interval of a time
+
+  // Index i of the interval [t_i, t_i+1] containing t, there must be
+  // at least two quaternions
+  int FindInterval(double t);
 
 private:
   vtkCustomQuaternionInterpolator(const vtkCustomQuaternionInterpolator&);  // Not implemented.
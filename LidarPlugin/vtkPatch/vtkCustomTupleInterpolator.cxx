@@ -337,6 +337,18 @@ void vtkCustomTupleInterpolator::InterpolateTupleDichotomic(double t, double tup
   }
 }
 
+//----------------------------------------------------------------------------
+void vtkCustomTupleInterpolator::BuildUniformTimeIndex()
+{
+  if ( this->InterpolationType == INTERPOLATION_TYPE_LINEAR && this->Linear )
+  {
+    for (int i=0; i<this->NumberOfComponents; i++)
+    {
+      this->Linear[i]->BuildUniformIndex();
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 void vtkCustomTupleInterpolator::PrintSelf(ostream& os, vtkIndent indent)
 {
@@ -115,6 +115,14 @@ public:
    */
   void InterpolateTupleDichotomic(double t, double tuple[]);
 
+  /**
+   * Index the tuple times so that InterpolateTupleDichotomic() finds the
+   * interval of a time after a single division when the tuples are almost
+   * uniformly sampled, instead of a binary search. This applies to the
+   * linear interpolation and must be called again when the tuples change.
+   */
+  void BuildUniformTimeIndex();
+
 //BTX
   // Description:
   // Enums to control the type of interpolation to use.
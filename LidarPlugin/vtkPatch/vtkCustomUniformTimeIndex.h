@@ -0,0 +1,138 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef vtkCustomUniformTimeIndex_h
+#define vtkCustomUniformTimeIndex_h
+
+#include <vector>
+
+/**
+ * @brief vtkCustomUniformTimeIndex speeds up the search of the keyframe
+ * bracketing a time among sorted keyframe times.
+ *
+ * The time range is cut in as many buckets as there are intervals between
+ * the keyframes, each bucket storing the first keyframe after its start.
+ * When the keyframes are almost uniformly sampled, as GPS or IMU logs are,
+ * a search is a division followed by a few steps. The index is not built
+ * when a bucket would hold too many keyframes, and the search then falls
+ * back to a binary search.
+ *
+ * The keyframe times are given by a functor returning the time of the
+ * keyframe i, the index must be built again when they change.
+ */
+class vtkCustomUniformTimeIndex
+{
+public:
+  //! Remove the index, the searches become binary searches
+  void Clear()
+  {
+    this->Buckets.clear();
+  }
+
+  //! Is the index built
+  bool IsValid() const
+  {
+    return !this->Buckets.empty();
+  }
+
+  //! Build the index of the n sorted times given by timeOf
+  template<typename TimeOf>
+  void Build(int n, TimeOf timeOf)
+  {
+    this->Clear();
+    if (n < 2 || !(timeOf(n - 1) > timeOf(0)))
+    {
+      return;
+    }
+    const int nbBuckets = n - 1;
+    this->Origin = timeOf(0);
+    this->Rate = nbBuckets / (timeOf(n - 1) - this->Origin);
+
+    this->Buckets.resize(nbBuckets);
+    int j = 0;
+    for (int b = 0; b < nbBuckets; ++b)
+    {
+      const double start = this->Origin + b / this->Rate;
+      while (j < n && timeOf(j) <= start)
+      {
+        ++j;
+      }
+      this->Buckets[b] = j;
+    }
+
+    // the sampling is not uniform enough for the index to help
+    for (int b = 0; b < nbBuckets; ++b)
+    {
+      const int next = b + 1 < nbBuckets ? this->Buckets[b + 1] : n;
+      if (next - this->Buckets[b] > MaxKeyframesPerBucket)
+      {
+        this->Clear();
+        return;
+      }
+    }
+  }
+
+  //! Index of the first of the n times given by timeOf that is greater than t
+  template<typename TimeOf>
+  int UpperBound(double t, int n, TimeOf timeOf) const
+  {
+    if (!this->IsValid())
+    {
+      int first = 0;
+      int count = n;
+      while (count > 0)
+      {
+        const int step = count / 2;
+        if (!(t < timeOf(first + step)))
+        {
+          first += step + 1;
+          count -= step + 1;
+        }
+        else
+        {
+          count = step;
+        }
+      }
+      return first;
+    }
+
+    const int nbBuckets = static_cast<int>(this->Buckets.size());
+    const double u = (t - this->Origin) * this->Rate;
+    const int b = u > 0.0 ? (u < nbBuckets ? static_cast<int>(u) : nbBuckets - 1) : 0;
+    // the steps handle the rounding of the bucket and the times out of range
+    int i = this->Buckets[b];
+    while (i > 0 && timeOf(i - 1) > t)
+    {
+      --i;
+    }
+    while (i < n && timeOf(i) <= t)
+    {
+      ++i;
+    }
+    return i;
+  }
+
+private:
+  //! Maximum number of keyframes in a bucket for the index to be kept
+  static const int MaxKeyframesPerBucket = 8;
+
+  //! First keyframe after the start of each bucket
+  std::vector<int> Buckets;
+  //! Time of the first keyframe
+  double Origin = 0.0;
+  //! Number of buckets per unit of time
+  double Rate = 0.0;
+};
+
+#endif // vtkCustomUniformTimeIndex_h
@@ -94,6 +94,17 @@ public slots:
   {
     pqLidarViewManager::saveFramesToLAS(arg0, arg1, arg2, arg3, arg4, arg5);
   }
+
+  void static_pqLidarViewManager_saveFramesToLAS(vtkLidarReader* arg0, vtkPolyData* arg1,
+    int arg2, int arg3, const QString& arg4, int arg5, int arg6, bool arg7)
+  {
+    pqLidarViewManager::saveFramesToLAS(arg0, arg1, arg2, arg3, arg4, arg5, arg6, arg7);
+  }
+
+  void static_pqLidarViewManager_waitForExports()
+  {
+    pqLidarViewManager::waitForExports();
+  }
 };
 
 #endif
@@ -349,6 +349,12 @@ private:
     connect(this->Ui.actionResetDefaultSettings, SIGNAL(triggered()),
       pqLidarViewManager::instance(), SLOT(onResetDefaultSettings()));
 
+    connect(this->Ui.actionPipelineProfiler, SIGNAL(triggered()),
+      pqLidarViewManager::instance(), SLOT(onShowPipelineProfiler()));
+
+    connect(this->Ui.actionPointTable, SIGNAL(triggered()),
+      pqLidarViewManager::instance(), SLOT(onShowPointTable()));
+
     connect(this->Ui.actionShowErrorDialog, SIGNAL(triggered()), pqApplicationCore::instance(),
       SLOT(showOutputWindow()));
   }
@@ -434,7 +440,7 @@ void vvMainWindow::dropEvent(QDropEvent* evt)
     return;
   }
 
-  if (files[0].endsWith(".pcap"))
+  if (files[0].endsWith(".pcap") || files[0].endsWith(".pcapng"))
   {
     pqLidarViewManager::instance()->runPython(QString("lv.openPCAP('" + files[0] + "')"));
   }
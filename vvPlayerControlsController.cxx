@@ -34,6 +34,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // ParaView Server Manager includes.
 #include "vtkSMIntRangeDomain.h"
 #include "vtkSMIntVectorProperty.h"
+#include "vtkSMPropertyHelper.h"
 #include "vtkSMProxy.h"
 #include "vtkSMTrace.h"
 
@@ -47,10 +48,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "pqApplicationCore.h"
 #include "pqEventDispatcher.h"
 #include "pqPipelineSource.h"
+#include "pqServerManagerModel.h"
 #include "pqSMAdaptor.h"
 #include "pqUndoStack.h"
 #include "vtkAnimationScene.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace {
 void SetProperty(QPointer<pqAnimationScene> scene, const char* property, int value)
 {
@@ -58,14 +63,61 @@ void SetProperty(QPointer<pqAnimationScene> scene, const char* property, int val
       (scene->getProxy()->GetProperty(property))->SetElements1(value);
   scene->getProxy()->UpdateProperty(property);
 }
+
+// Tell the readers in which direction the frames are going to be played,
+// so that they can decode the next ones in advance
+void SetPlaybackDirection(int direction)
+{
+  pqServerManagerModel* smModel = pqApplicationCore::instance()->getServerManagerModel();
+  foreach (pqPipelineSource* source, smModel->findItems<pqPipelineSource*>())
+  {
+    vtkSMIntVectorProperty* property = vtkSMIntVectorProperty::SafeDownCast(
+      source->getProxy()->GetProperty("PlaybackDirection"));
+    if (property && property->GetElement(0) != direction)
+    {
+      property->SetElements1(direction);
+      source->getProxy()->UpdateProperty("PlaybackDirection");
+    }
+  }
+}
+
+// Tell the readers how many frames are skipped from one frame played to the
+// next, so that they only decode in advance the frames which will be shown
+void SetPlaybackStride(int stride)
+{
+  pqServerManagerModel* smModel = pqApplicationCore::instance()->getServerManagerModel();
+  foreach (pqPipelineSource* source, smModel->findItems<pqPipelineSource*>())
+  {
+    vtkSMIntVectorProperty* property = vtkSMIntVectorProperty::SafeDownCast(
+      source->getProxy()->GetProperty("PlaybackStride"));
+    if (property && property->GetElement(0) != stride)
+    {
+      property->SetElements1(stride);
+      source->getProxy()->UpdateProperty("PlaybackStride");
+    }
+  }
+}
+
+// Weight of the last measure in the smoothed cost of a time step
+const double CostSmoothing = 0.2;
 }
 
 //-----------------------------------------------------------------------------
 vvPlayerControlsController::vvPlayerControlsController(QObject* _parent/*=null*/)
   : QObject(_parent),
     speed(1),
-    duration(0)
+    duration(0),
+    realTime(false),
+    realTimePlaying(false),
+    realTimeStart(0),
+    realTimeIndex(0),
+    realTimeCost(0),
+    realTimeShown(0),
+    realTimeSkipped(0),
+    realTimeStride(1)
 {
+  this->realTimeTimer.setSingleShot(true);
+  QObject::connect(&this->realTimeTimer, SIGNAL(timeout()), this, SLOT(onRealTimeStep()));
 }
 
 //-----------------------------------------------------------------------------
@@ -85,6 +137,7 @@ void vvPlayerControlsController::setAnimationScene(pqAnimationScene* scene)
     {
     return;
     }
+  this->stopRealTime();
   if (this->Scene)
     {
     QObject::disconnect(this->Scene, 0, this, 0);
@@ -136,6 +189,16 @@ void vvPlayerControlsController::onPlay()
     .arg(this->Scene->getProxy())
     .arg("Play");
 
+  SetPlaybackDirection(1);
+
+  if (this->realTime && this->speed != 0 && this->Scene->getTimeSteps().size() > 1)
+  {
+    // the playback is driven by a timer, this call returns immediately
+    this->startRealTime();
+    END_UNDO_EXCLUDE();
+    return;
+  }
+
   if (speed != 0)
   {
     SetProperty(this->Scene, "Duration", this->duration / this->speed);
@@ -206,6 +269,11 @@ void vvPlayerControlsController::onPause()
     qDebug() << "No active scene. Cannot play.";
     return;
     }
+  if (this->realTimePlaying)
+  {
+    this->stopRealTime();
+    return;
+  }
   this->Scene->getProxy()->InvokeCommand("Stop");
   SetProperty(this->Scene, "PlayMode", 2);
 }
@@ -226,6 +294,7 @@ void vvPlayerControlsController::onPreviousFrame()
 {
   emit this->beginNonUndoableChanges();
   SetProperty(this->Scene, "PlayMode", 2);
+  SetPlaybackDirection(-1);
   this->Scene->getProxy()->InvokeCommand("GoToPrevious");
   SM_SCOPED_TRACE(CallMethod)
     .arg(this->Scene->getProxy())
@@ -238,6 +307,7 @@ void vvPlayerControlsController::onNextFrame()
 {
   emit this->beginNonUndoableChanges();
   SetProperty(this->Scene, "PlayMode", 2);
+  SetPlaybackDirection(1);
   this->Scene->getProxy()->InvokeCommand("GoToNext");
   SM_SCOPED_TRACE(CallMethod)
     .arg(this->Scene->getProxy())
@@ -263,3 +333,129 @@ void vvPlayerControlsController::onSpeedChange(double speed)
   this->onPause();
 }
 
+//-----------------------------------------------------------------------------
+void vvPlayerControlsController::onRealTimeChange(bool realTime)
+{
+  this->realTime = realTime;
+  if (this->Scene)
+  {
+    this->onPause();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vvPlayerControlsController::startRealTime()
+{
+  this->realTimeSteps = this->Scene->getTimeSteps();
+  std::sort(this->realTimeSteps.begin(), this->realTimeSteps.end());
+
+  // start from the time step shown, or from the first one at the end
+  const double time = this->Scene->getAnimationTime();
+  this->realTimeIndex = static_cast<int>(
+    std::lower_bound(this->realTimeSteps.begin(), this->realTimeSteps.end(), time)
+    - this->realTimeSteps.begin());
+  if (this->realTimeIndex >= this->realTimeSteps.size() - 1)
+  {
+    this->realTimeIndex = 0;
+    this->Scene->setAnimationTime(this->realTimeSteps.first());
+  }
+  this->realTimeStart = this->realTimeSteps[this->realTimeIndex];
+  this->realTimeCost = 0;
+  this->realTimeShown = 0;
+  this->realTimeSkipped = 0;
+  this->realTimeStride = 1;
+  SetPlaybackStride(1);
+
+  this->realTimePlaying = true;
+  this->onBeginPlay();
+  this->realTimeClock.start();
+  this->realTimeTimer.start(0);
+}
+
+//-----------------------------------------------------------------------------
+void vvPlayerControlsController::stopRealTime()
+{
+  if (!this->realTimePlaying)
+  {
+    return;
+  }
+  this->realTimeTimer.stop();
+  this->realTimePlaying = false;
+  SetPlaybackStride(1);
+  this->onEndPlay();
+}
+
+//-----------------------------------------------------------------------------
+void vvPlayerControlsController::onRealTimeStep()
+{
+  if (!this->Scene || !this->realTimePlaying)
+  {
+    this->stopRealTime();
+    return;
+  }
+
+  // show the time step which will be due once it is rendered
+  const double elapsed = 1e-9 * this->realTimeClock.nsecsElapsed();
+  const double target = this->realTimeStart + (elapsed + this->realTimeCost) * this->speed;
+  const int last = this->realTimeSteps.size() - 1;
+  int next = static_cast<int>(
+    std::upper_bound(this->realTimeSteps.begin(), this->realTimeSteps.end(), target)
+    - this->realTimeSteps.begin()) - 1;
+
+  if (next >= last && this->realTimeIndex == last)
+  {
+    const bool loop = vtkSMPropertyHelper(this->Scene->getProxy(), "Loop").GetAsInt() != 0;
+    if (!loop)
+    {
+      this->stopRealTime();
+      return;
+    }
+    // restart the clock from the first time step
+    this->realTimeIndex = -1;
+    this->realTimeStart = this->realTimeSteps.first();
+    this->realTimeClock.restart();
+    next = 0;
+  }
+  next = std::min(next, last);
+
+  if (next <= this->realTimeIndex)
+  {
+    // ahead of time, wait until the next time step is due
+    const double due = (this->realTimeSteps[this->realTimeIndex + 1] - this->realTimeStart)
+                       / this->speed - this->realTimeCost;
+    this->realTimeTimer.start(std::max(0, static_cast<int>(1000 * (due - elapsed))));
+    return;
+  }
+
+  if (this->realTimeIndex >= 0)
+  {
+    this->realTimeSkipped += next - this->realTimeIndex - 1;
+  }
+  this->realTimeShown++;
+
+  // the readers decode in advance the time steps that should be shown next,
+  // given the number of time steps elapsed while one is shown
+  const double interval = (this->realTimeSteps.last() - this->realTimeSteps.first()) / last;
+  const int stride = interval > 0 ?
+    std::max(1, static_cast<int>(std::floor(this->realTimeCost * this->speed / interval + 0.5))) : 1;
+  if (stride != this->realTimeStride)
+  {
+    this->realTimeStride = stride;
+    SetPlaybackStride(stride);
+  }
+
+  QElapsedTimer cost;
+  cost.start();
+  this->Scene->setAnimationTime(this->realTimeSteps[next]);
+  const double measured = 1e-9 * cost.nsecsElapsed();
+  this->realTimeCost = this->realTimeShown == 1 ?
+    measured : (1 - CostSmoothing) * this->realTimeCost + CostSmoothing * measured;
+  this->realTimeIndex = next;
+
+  emit this->timestepChanged();
+  emit this->realTimeStatistics(this->realTimeShown, this->realTimeSkipped);
+
+  // let the events be processed before the next time step
+  this->realTimeTimer.start(0);
+}
+
@@ -34,8 +34,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
 #include "pqComponentsModule.h"
+#include <QElapsedTimer>
+#include <QList>
 #include <QPointer>
 #include <QObject>
+#include <QTimer>
 
 class pqPipelineSource;
 class pqAnimationScene;
@@ -81,6 +84,10 @@ signals:
   /// emitted when the animation ends playing.
   void endNonUndoableChanges();
 
+  // Emitted after each time step shown by the real-time playback, with the
+  // number of time steps shown and skipped since the playback started.
+  void realTimeStatistics(int shown, int skipped);
+
 public slots:
   // Set the animation scene. If null, the VCR control is disabled
   // (emits enabled(false)).
@@ -99,19 +106,44 @@ public slots:
   void onLoop(bool checked);
   void onSpeedChange(double speed);
 
+  // In real-time mode, the playback holds the speed by skipping the time steps
+  // which can not be shown in time, instead of slowing down. The cost of a time
+  // step, from the update of the pipeline to the end of the render, is measured
+  // to show the time step which is due when the render ends.
+  void onRealTimeChange(bool realTime);
+
 protected slots:
   void onTick();
   void onLoopPropertyChanged();
   void onBeginPlay();
   void onEndPlay();
+  void onRealTimeStep();
 
 private:
   vvPlayerControlsController(const vvPlayerControlsController&); // Not implemented.
   void operator=(const vvPlayerControlsController&); // Not implemented.
 
+  void startRealTime();
+  void stopRealTime();
+
   QPointer<pqAnimationScene> Scene;
   double speed;
   double duration;
+
+  bool realTime;
+  bool realTimePlaying;
+  QTimer realTimeTimer;
+  QElapsedTimer realTimeClock;
+  QList<double> realTimeSteps;
+  // time of the scene when the clock was started
+  double realTimeStart;
+  // index in realTimeSteps of the time step shown
+  int realTimeIndex;
+  // smoothed cost of a time step in seconds, from the update to the end of the render
+  double realTimeCost;
+  int realTimeShown;
+  int realTimeSkipped;
+  int realTimeStride;
 };
 
 #endif // VVPLAYERCONTROLSCONTROLLER_H
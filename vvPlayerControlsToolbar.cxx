@@ -36,6 +36,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <limits>
 
 #include <QLabel>
+#include <QCheckBox>
 #include <QComboBox>
 #include <QSlider>
 #include <QSpinBox>
@@ -64,6 +65,7 @@ public:
   pqPropertyLinks Links;
   QList<QPair<double, QString> > speedFactor;
   QComboBox* speedComboBox;
+  QCheckBox* realTimeCheckBox;
   QSlider* frameSlider;
   QDoubleSpinBox* timeSpinBox;
   QSpinBox* frameQSpinBox;
@@ -163,6 +165,16 @@ vvPlayerControlsToolbar::vvPlayerControlsToolbar(QWidget* parentObject)
   QObject::connect(this, SIGNAL(speedChange(double)),
     controller, SLOT(onSpeedChange(double)));
 
+  // hold the speed by skipping frames when they can not be shown in time
+  this->UI->realTimeCheckBox = new QCheckBox("Skip frames", this);
+  this->UI->realTimeCheckBox->setToolTip(
+    "Hold the playback speed by skipping the frames which can not be shown in time");
+  this->addWidget(this->UI->realTimeCheckBox);
+  QObject::connect(this->UI->realTimeCheckBox, SIGNAL(toggled(bool)),
+    controller, SLOT(onRealTimeChange(bool)));
+  QObject::connect(controller, SIGNAL(realTimeStatistics(int, int)),
+    this, SLOT(onRealTimeStatistics(int, int)));
+
   // add a separator to visualy group the element together
   this->addSeparator();
 
@@ -287,6 +299,14 @@ void vvPlayerControlsToolbar::onSpeedChanged()
   }
 }
 
+//-----------------------------------------------------------------------------
+void vvPlayerControlsToolbar::onRealTimeStatistics(int shown, int skipped)
+{
+  this->UI->realTimeCheckBox->setToolTip(
+    QString("Hold the playback speed by skipping the frames which can not be shown in time\n"
+            "Since the playback started: %1 frame(s) shown, %2 skipped").arg(shown).arg(skipped));
+}
+
 //-----------------------------------------------------------------------------
 void vvPlayerControlsToolbar::setAnimationScene(pqAnimationScene* scene)
 {
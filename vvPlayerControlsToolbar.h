@@ -61,6 +61,7 @@ public slots:
 protected slots:
   void onPlaying(bool);
   void onSpeedChanged();
+  void onRealTimeStatistics(int shown, int skipped);
   void setAnimationScene(pqAnimationScene*);
   void PressSlider();
   void ReleaseSlider();